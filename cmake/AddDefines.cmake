@@ -32,3 +32,21 @@ if(SOLARUS_DEFAULT_QUEST_HEIGHT)
   add_definitions(-DSOLARUS_DEFAULT_QUEST_HEIGHT=${SOLARUS_DEFAULT_QUEST_HEIGHT})
 endif()
 
+
+# Count heap allocations per frame and per part of the engine.
+option(SOLARUS_ALLOCATION_TRACKING "Replace operator new to count allocations per frame (for profiling)" OFF)
+if(SOLARUS_ALLOCATION_TRACKING)
+  add_definitions(-DSOLARUS_ALLOCATION_TRACKING)
+endif()
+
+# Keep the internal checks of SOLARUS_ASSERT in release builds.
+option(SOLARUS_CHECKED_ASSERTIONS "Check internal invariants of hot paths even in release builds (slower)" OFF)
+if(SOLARUS_CHECKED_ASSERTIONS)
+  add_definitions(-DSOLARUS_CHECKED_ASSERTIONS)
+endif()
+
+# Record scope markers of the engine in a trace viewable in Perfetto.
+option(SOLARUS_TRACING "Compile trace markers to record a timeline of each frame (for profiling)" OFF)
+if(SOLARUS_TRACING)
+  add_definitions(-DSOLARUS_TRACING)
+endif()
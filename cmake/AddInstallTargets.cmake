@@ -17,8 +17,8 @@ set(SOLARUS_MANUAL_INSTALL_DESTINATION "share/man" CACHE PATH "Manual install de
 set(SOLARUS_HEADERS_INSTALL_DESTINATION "include" CACHE PATH "Headers install destination")
 
 # Files to install with make install.
-# Install the shared library and the solarus-run executable.
-install(TARGETS solarus solarus-run
+# Install the shared library, the solarus-run executable and the quest compiler.
+install(TARGETS solarus solarus-run solarus-quest-compiler
   LIBRARY DESTINATION ${SOLARUS_LIBRARY_INSTALL_DESTINATION}
   RUNTIME DESTINATION ${SOLARUS_EXECUTABLE_INSTALL_DESTINATION}
 )
@@ -29,3 +29,45 @@ target_link_libraries(solarus-run
   "${MODPLUG_LIBRARY}"
 )
 
+
+# Offline tool that converts data files of a quest to binary data files.
+add_executable(solarus-quest-compiler
+  src/main/QuestCompiler.cpp
+)
+
+target_link_libraries(solarus-quest-compiler
+  solarus
+  "${SDL2_LIBRARY}"
+  "${SDL2_IMAGE_LIBRARY}"
+  "${SDL2_TTF_LIBRARY}"
+  "${OPENAL_LIBRARY}"
+  "${LUA_LIBRARY}"
+  "${DL_LIBRARY}"
+  "${PHYSFS_LIBRARY}"
+  "${VORBISFILE_LIBRARY}"
+  "${OGG_LIBRARY}"
+  "${MODPLUG_LIBRARY}"
+)
+
+# Headless benchmark that runs the simulation of a map as fast as possible.
+add_executable(solarus-bench
+  src/main/Bench.cpp
+)
+
+target_link_libraries(solarus-bench
+  solarus
+  "${SDL2_LIBRARY}"
+  "${SDL2_IMAGE_LIBRARY}"
+  "${SDL2_TTF_LIBRARY}"
+  "${OPENAL_LIBRARY}"
+  "${LUA_LIBRARY}"
+  "${DL_LIBRARY}"
+  "${PHYSFS_LIBRARY}"
+  "${VORBISFILE_LIBRARY}"
+  "${OGG_LIBRARY}"
+  "${MODPLUG_LIBRARY}"
+)
+
+if(WIN32)
+  target_link_libraries(solarus-bench psapi)
+endif()
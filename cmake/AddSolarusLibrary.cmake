@@ -6,16 +6,24 @@ file(
 	include/solarus/audio/ItDecoder.h
 	include/solarus/audio/Music.h
 	include/solarus/audio/OggDecoder.h
+	include/solarus/audio/PcmChunkQueue.h
 	include/solarus/audio/Sound.h
 	include/solarus/audio/SpcDecoder.h
 
 	include/solarus/containers/Grid.h
 	include/solarus/containers/Quadtree.h
 	include/solarus/containers/Quadtree.inl
+	include/solarus/containers/ResourceCache.h
+	include/solarus/containers/ResourceCache.inl
+	include/solarus/containers/SpatialHash.h
+	include/solarus/containers/SpatialHash.inl
 
 	include/solarus/core/Ability.h
 	include/solarus/core/AbilityInfo.h
+	include/solarus/core/AllocationTracker.h
 	include/solarus/core/Arguments.h
+	include/solarus/core/BinaryReader.h
+	include/solarus/core/BinaryWriter.h
 	include/solarus/core/CommandsEffects.h
 	include/solarus/core/Common.h
 	include/solarus/core/config.h
@@ -30,15 +38,20 @@ file(
 	include/solarus/core/EquipmentItem.h
 	include/solarus/core/EquipmentItemUsage.h
 	include/solarus/core/FontResource.h
+	include/solarus/core/FrameTimings.h
 	include/solarus/core/GameCommand.h
 	include/solarus/core/GameCommands.h
 	include/solarus/core/Game.h
 	include/solarus/core/Geometry.h
 	include/solarus/core/InputEvent.h
+	include/solarus/core/InputRecording.h
 	include/solarus/core/Logger.h
 	include/solarus/core/MainLoop.h
 	include/solarus/core/Map.h
 	include/solarus/core/MapData.h
+	include/solarus/core/MapOverview.h
+	include/solarus/core/MemoryStats.h
+	include/solarus/core/PerformanceOverlay.h
 	include/solarus/core/PixelBits.h
 	include/solarus/core/Point.h
 	include/solarus/core/Point.inl
@@ -47,8 +60,10 @@ file(
 	include/solarus/core/QuestProperties.h
 	include/solarus/core/Random.h
 	include/solarus/core/Rectangle.h
+	include/solarus/core/RecyclingPool.h
 	include/solarus/core/ResourceProvider.h
 	include/solarus/core/ResourceType.h
+	include/solarus/core/ResourceWatcher.h
 	include/solarus/core/SavegameConverterV1.h
 	include/solarus/core/Savegame.h
 	include/solarus/core/Settings.h
@@ -58,9 +73,12 @@ file(
 	include/solarus/core/String.h
 	include/solarus/core/StringResources.h
 	include/solarus/core/System.h
+	include/solarus/core/ThreadPool.h
 	include/solarus/core/Timer.h
 	include/solarus/core/TimerPtr.h
+	include/solarus/core/Trace.h
 	include/solarus/core/Treasure.h
+	include/solarus/core/WorldStateHash.h
 
 	include/solarus/entities/AnimatedTilePattern.h
 	include/solarus/entities/Arrow.h
@@ -89,12 +107,16 @@ file(
 	include/solarus/entities/EntityData.h
 	include/solarus/entities/EntityPtr.h
 	include/solarus/entities/EntityState.h
+	include/solarus/entities/EntityStreaming.h
+	include/solarus/entities/EntityTransforms.h
 	include/solarus/entities/EntityType.h
 	include/solarus/entities/EntityTypeInfo.h
+	include/solarus/entities/EntityTypeRange.h
 	include/solarus/entities/Explosion.h
 	include/solarus/entities/Fire.h
 	include/solarus/entities/Ground.h
 	include/solarus/entities/GroundInfo.h
+	include/solarus/entities/GroundRaster.h
 	include/solarus/entities/Hero.h
 	include/solarus/entities/HeroPtr.h
 	include/solarus/entities/Hookshot.h
@@ -102,8 +124,10 @@ file(
 	include/solarus/entities/Layer.h
 	include/solarus/entities/NonAnimatedRegions.h
 	include/solarus/entities/Npc.h
+	include/solarus/entities/ObstacleTable.h
 	include/solarus/entities/ParallaxScrollingTilePattern.h
 	include/solarus/entities/Pickable.h
+	include/solarus/entities/ProjectilePool.h
 	include/solarus/entities/SelfScrollingTilePattern.h
 	include/solarus/entities/Sensor.h
 	include/solarus/entities/Separator.h
@@ -130,13 +154,20 @@ file(
 	include/solarus/graphics/Color.h
 	include/solarus/graphics/Drawable.h
 	include/solarus/graphics/DrawablePtr.h
+	include/solarus/graphics/DrawList.h
+	include/solarus/graphics/DynamicResolution.h
         include/solarus/graphics/DrawProxies.h
+	include/solarus/graphics/DrawTransform.h
 	include/solarus/graphics/GlArbShader.h
 	include/solarus/graphics/GlShader.h
 	include/solarus/graphics/GlTextureHandle.h
+	include/solarus/graphics/GlyphAtlas.h
 	include/solarus/graphics/Hq2xFilter.h
 	include/solarus/graphics/Hq3xFilter.h
 	include/solarus/graphics/Hq4xFilter.h
+	include/solarus/graphics/ParticleEmitter.h
+	include/solarus/graphics/PixelBuffer.h
+	include/solarus/graphics/PostProcessChain.h
 	include/solarus/graphics/RenderTexture.h
 	include/solarus/graphics/Scale2xFilter.h
 	include/solarus/graphics/SDLPtrs.h
@@ -149,6 +180,7 @@ file(
 	include/solarus/graphics/SpriteAnimationDirection.h
 	include/solarus/graphics/SpriteAnimation.h
 	include/solarus/graphics/SpriteAnimationSet.h
+	include/solarus/graphics/SpriteBatch.h
 	include/solarus/graphics/Sprite.h
 	include/solarus/graphics/SpriteData.h
 	include/solarus/graphics/SpritePtr.h
@@ -157,6 +189,7 @@ file(
 	include/solarus/graphics/SurfacePtr.h
 	include/solarus/graphics/TextSurface.h
 	include/solarus/graphics/Texture.h
+	include/solarus/graphics/TextureAtlas.h
 	include/solarus/graphics/TransitionFade.h
 	include/solarus/graphics/Transition.h
 	include/solarus/graphics/TransitionImmediate.h
@@ -197,9 +230,12 @@ file(
 
 	include/solarus/lua/ExportableToLua.h
 	include/solarus/lua/ExportableToLuaPtr.h
+	include/solarus/lua/FfiApi.h
+	include/solarus/lua/LuaAllocator.h
 	include/solarus/lua/LuaContext.h
 	include/solarus/lua/LuaData.h
 	include/solarus/lua/LuaException.h
+	include/solarus/lua/LuaProfiler.h
 	include/solarus/lua/LuaTools.h
 	include/solarus/lua/LuaTools.inl
 	include/solarus/lua/ScopedLuaRef.h
@@ -210,6 +246,7 @@ file(
 	include/solarus/movements/JumpMovement.h
 	include/solarus/movements/Movement.h
 	include/solarus/movements/PathFinding.h
+	include/solarus/movements/PathFindingCache.h
 	include/solarus/movements/PathFindingMovement.h
 	include/solarus/movements/PathMovement.h
 	include/solarus/movements/PixelMovement.h
@@ -237,12 +274,16 @@ file(
 	src/audio/ItDecoder.cpp
 	src/audio/Music.cpp
 	src/audio/OggDecoder.cpp
+	src/audio/PcmChunkQueue.cpp
 	src/audio/Sound.cpp
 	src/audio/SpcDecoder.cpp
 
 
 	src/core/AbilityInfo.cpp
+	src/core/AllocationTracker.cpp
 	src/core/Arguments.cpp
+	src/core/BinaryReader.cpp
+	src/core/BinaryWriter.cpp
 	src/core/CommandsEffects.cpp
 	src/core/CurrentQuest.cpp
 	src/core/Debug.cpp
@@ -253,14 +294,19 @@ file(
 	src/core/EquipmentItem.cpp
 	src/core/EquipmentItemUsage.cpp
 	src/core/FontResource.cpp
+	src/core/FrameTimings.cpp
 	src/core/GameCommands.cpp
 	src/core/Game.cpp
 	src/core/Geometry.cpp
 	src/core/InputEvent.cpp
+	src/core/InputRecording.cpp
 	src/core/Logger.cpp
 	src/core/MainLoop.cpp
 	src/core/Map.cpp
 	src/core/MapData.cpp
+	src/core/MapOverview.cpp
+	src/core/MemoryStats.cpp
+	src/core/PerformanceOverlay.cpp
 	src/core/PixelBits.cpp
 	src/core/Point.cpp
 	src/core/QuestFiles.cpp
@@ -268,7 +314,9 @@ file(
 	src/core/QuestProperties.cpp
 	src/core/Random.cpp
 	src/core/Rectangle.cpp
+	src/core/RecyclingPool.cpp
 	src/core/ResourceProvider.cpp
+	src/core/ResourceWatcher.cpp
 	src/core/SavegameConverterV1.cpp
 	src/core/Savegame.cpp
 	src/core/Settings.cpp
@@ -277,8 +325,11 @@ file(
 	src/core/String.cpp
 	src/core/System.cpp
 	src/core/StringResources.cpp
+	src/core/ThreadPool.cpp
 	src/core/Timer.cpp
+	src/core/Trace.cpp
 	src/core/Treasure.cpp
+	src/core/WorldStateHash.cpp
 
 	src/entities/AnimatedTilePattern.cpp
 	src/entities/Arrow.cpp
@@ -303,17 +354,22 @@ file(
 	src/entities/Entity.cpp
 	src/entities/EntityData.cpp
 	src/entities/EntityState.cpp
+	src/entities/EntityStreaming.cpp
+	src/entities/EntityTransforms.cpp
 	src/entities/EntityTypeInfo.cpp
 	src/entities/Explosion.cpp
 	src/entities/Fire.cpp
 	src/entities/GroundInfo.cpp
+	src/entities/GroundRaster.cpp
 	src/entities/Hero.cpp
 	src/entities/Hookshot.cpp
 	src/entities/Jumper.cpp
 	src/entities/NonAnimatedRegions.cpp
 	src/entities/Npc.cpp
+	src/entities/ObstacleTable.cpp
 	src/entities/ParallaxScrollingTilePattern.cpp
 	src/entities/Pickable.cpp
+	src/entities/ProjectilePool.cpp
 	src/entities/SelfScrollingTilePattern.cpp
 	src/entities/Sensor.cpp
 	src/entities/Separator.cpp
@@ -335,12 +391,19 @@ file(
 	src/graphics/BlendModeInfo.cpp
 	src/graphics/Color.cpp
 	src/graphics/Drawable.cpp
+	src/graphics/DrawList.cpp
+	src/graphics/DrawTransform.cpp
+	src/graphics/DynamicResolution.cpp
 	src/graphics/GlArbShader.cpp
 	src/graphics/GlShader.cpp
 	src/graphics/GlTextureHandle.cpp
+	src/graphics/GlyphAtlas.cpp
 	src/graphics/Hq2xFilter.cpp
 	src/graphics/Hq3xFilter.cpp
 	src/graphics/Hq4xFilter.cpp
+	src/graphics/ParticleEmitter.cpp
+	src/graphics/PixelBuffer.cpp
+	src/graphics/PostProcessChain.cpp
 	src/graphics/RenderTexture.cpp
 	src/graphics/Scale2xFilter.cpp
 	src/graphics/ShaderContext.cpp
@@ -351,12 +414,14 @@ file(
 	src/graphics/SpriteAnimation.cpp
 	src/graphics/SpriteAnimationDirection.cpp
 	src/graphics/SpriteAnimationSet.cpp
+	src/graphics/SpriteBatch.cpp
 	src/graphics/Sprite.cpp
 	src/graphics/SpriteData.cpp
 	src/graphics/Surface.cpp
 	src/graphics/SurfaceImpl.cpp
 	src/graphics/TextSurface.cpp
 	src/graphics/Texture.cpp
+	src/graphics/TextureAtlas.cpp
 	src/graphics/Transition.cpp
 	src/graphics/TransitionFade.cpp
 	src/graphics/TransitionImmediate.cpp
@@ -398,19 +463,25 @@ file(
 	src/lua/DrawableApi.cpp
 	src/lua/EntityApi.cpp
 	src/lua/ExportableToLua.cpp
+	src/lua/FfiApi.cpp
 	src/lua/FileApi.cpp
 	src/lua/GameApi.cpp
 	src/lua/InputApi.cpp
 	src/lua/ItemApi.cpp
 	src/lua/LanguageApi.cpp
+	src/lua/LuaAllocator.cpp
 	src/lua/LuaContext.cpp
 	src/lua/LuaData.cpp
 	src/lua/LuaException.cpp
+	src/lua/LuaProfiler.cpp
 	src/lua/LuaTools.cpp
 	src/lua/MainApi.cpp
 	src/lua/MapApi.cpp
 	src/lua/MenuApi.cpp
 	src/lua/MovementApi.cpp
+	src/lua/ParticleEmitterApi.cpp
+	src/lua/PixelBufferApi.cpp
+	src/lua/ProjectilePoolApi.cpp
 	src/lua/ScopedLuaRef.cpp
 	src/lua/ShaderApi.cpp
 	src/lua/SpriteApi.cpp
@@ -418,12 +489,14 @@ file(
 	src/lua/TextSurfaceApi.cpp
 	src/lua/TimerApi.cpp
 	src/lua/VideoApi.cpp
+	src/lua/WorkerApi.cpp
 
 	src/movements/CircleMovement.cpp
 	src/movements/FallingOnFloorMovement.cpp
 	src/movements/JumpMovement.cpp
 	src/movements/Movement.cpp
 	src/movements/PathFinding.cpp
+	src/movements/PathFindingCache.cpp
 	src/movements/PathFindingMovement.cpp
 	src/movements/PathMovement.cpp
 	src/movements/PixelMovement.cpp
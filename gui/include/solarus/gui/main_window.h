@@ -46,6 +46,7 @@ private slots:
   void on_action_exit_triggered();
   void on_action_play_quest_triggered();
   void on_action_stop_quest_triggered();
+  void on_action_run_in_process_triggered();
   void on_action_fullscreen_triggered();
   void on_action_zoom_x1_triggered();
   void on_action_zoom_x2_triggered();
@@ -54,6 +55,7 @@ private slots:
   void on_action_about_triggered();
 
   void selected_quest_changed();
+  void quest_data_changed(const QModelIndex& index);
   void update_run_quest();
 
   void setting_changed_in_quest(const QString& key, const QVariant& value);
@@ -66,6 +68,7 @@ private:
   void initialize_menus();
   void update_menus();
   void update_fullscreen_action();
+  void update_run_in_process_action();
 
   Ui::MainWindow ui;         /**< The widgets. */
   QuestRunner quest_runner;  /**< The quest executor. */
@@ -22,8 +22,15 @@
 
 namespace SolarusGui {
 
+class QuestThread;
+
 /**
  * @brief Class to run a quest in a dedicated process.
+ *
+ * With the setting "run_in_process", the quest runs instead in a thread
+ * of the GUI process that is kept between runs, see QuestThread.
+ * This starts faster, but a crash of the quest also closes the GUI.
+ * It is not available on macOS, where SDL video needs the main thread.
  */
 class SOLARUS_GUI_API QuestRunner : public QObject {
   Q_OBJECT
@@ -38,6 +45,8 @@ public:
   int execute_command(const QString& command);
   bool apply_settings();
 
+  static bool is_in_process_supported();
+
 public slots:
 
   void start(const QString& quest_path);
@@ -61,6 +70,8 @@ private:
   QStringList get_quest_lua_commands_from_settings() const;
 
   QProcess process;     /**< The Solarus process. */
+  QuestThread* thread;  /**< Thread of in-process quests, created when first needed. */
+  bool in_process;      /**< Whether the current quest runs in the thread. */
   int last_command_id;  /**< Id of the last command executed (-1 if none). */
 };
 
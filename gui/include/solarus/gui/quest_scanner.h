@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GUI_QUEST_SCANNER_H
+#define SOLARUS_GUI_QUEST_SCANNER_H
+
+#include "solarus/gui/gui_common.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QThread>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace SolarusGui {
+
+/**
+ * @brief Thread that reads the properties and images of quests.
+ *
+ * Quests may be on slow drives, so they are read here instead of blocking
+ * the GUI.
+ * Results contain raw file contents: pixmaps can only be created
+ * in the GUI thread.
+ *
+ * Quest files are process-wide in Solarus: every code of the GUI that
+ * opens a quest locks get_quest_files_mutex().
+ */
+class SOLARUS_GUI_API QuestScanner : public QThread {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief What was read from a quest.
+   */
+  struct Result {
+    QString path;                   /**< Path of the quest directory. */
+    bool valid;                     /**< Whether a quest was found there. */
+    QDateTime modification_date;    /**< Last change of the files read. */
+    QByteArray properties;          /**< Content of quest.dat. */
+    QByteArray logo;                /**< Content of logos/logo.png, if any. */
+    QList<QByteArray> icons;        /**< Content of each icon file found. */
+  };
+
+  explicit QuestScanner(QObject* parent = nullptr);
+  ~QuestScanner();
+
+  void scan(const QString& quest_path, const QDateTime& known_date);
+
+  static bool is_quest_directory(const QString& quest_path);
+  static std::mutex& get_quest_files_mutex();
+
+signals:
+
+  void quest_scanned(const SolarusGui::QuestScanner::Result& result);
+
+protected:
+
+  void run() override;
+
+private:
+
+  Result scan_quest(const QString& quest_path) const;
+
+  const QString program_name;         /**< Name of the executable, for PhysicsFS. */
+  std::mutex mutex;                   /**< Protects the fields below. */
+  std::condition_variable condition;  /**< Wakes up the thread. */
+  std::deque<std::pair<QString, QDateTime>>
+      pending_scans;                  /**< Quests to read and the date already known. */
+  bool quitting;                      /**< Whether the thread should finish. */
+};
+
+}
+
+Q_DECLARE_METATYPE(SolarusGui::QuestScanner::Result)
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GUI_QUEST_THREAD_H
+#define SOLARUS_GUI_QUEST_THREAD_H
+
+#include "solarus/gui/gui_common.h"
+#include <QStringList>
+#include <QThread>
+#include <condition_variable>
+#include <mutex>
+
+namespace Solarus {
+
+class MainLoop;
+
+}
+
+namespace SolarusGui {
+
+/**
+ * @brief Thread that runs quests inside the GUI process.
+ *
+ * The thread lives as long as this object and runs one quest at a time.
+ * SDL stays initialized between quests, so that starting a quest again
+ * does not need a new process nor a new video and input initialization.
+ *
+ * Quest files are process-wide in Solarus: a running quest holds
+ * QuestScanner::get_quest_files_mutex() until it finishes.
+ */
+class SOLARUS_GUI_API QuestThread : public QThread {
+  Q_OBJECT
+
+public:
+
+  explicit QuestThread(QObject* parent = nullptr);
+  ~QuestThread();
+
+  bool is_quest_started() const;
+  bool is_quest_running() const;
+  void start_quest(const QStringList& arguments);
+  void stop_quest();
+  bool push_lua_command(const QString& command);
+
+signals:
+
+  void quest_running();
+  void quest_finished();
+  void solarus_fatal(const QString& what);
+  void output_produced(const QStringList& lines);
+
+protected:
+
+  void run() override;
+
+private:
+
+  void run_quest(const QStringList& arguments);
+
+  mutable std::mutex mutex;             /**< Protects the fields below. */
+  std::condition_variable condition;    /**< Wakes up the thread. */
+  QStringList pending_arguments;        /**< Arguments of the quest to start. */
+  bool quest_pending;                   /**< Whether a quest waits to be started. */
+  bool quest_started;                   /**< Whether a quest is pending or running. */
+  bool stop_requested;                  /**< Whether the current quest should stop. */
+  bool quitting;                        /**< Whether the thread should finish. */
+  Solarus::MainLoop* main_loop;         /**< The quest running, or nullptr. */
+};
+
+}
+
+#endif
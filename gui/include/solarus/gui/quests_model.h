@@ -18,6 +18,7 @@
 #define SOLARUS_GUI_QUESTS_MODEL_H
 
 #include "solarus/gui/gui_common.h"
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/core/QuestProperties.h"
 #include <QAbstractListModel>
 #include <QIcon>
@@ -27,6 +28,11 @@ namespace SolarusGui {
 
 /**
  * @brief List of quests added to Solarus.
+ *
+ * Quests are shown right away with what was read the last time,
+ * cached in the settings.
+ * A QuestScanner reads them again in the background if their files have
+ * changed, and quests that no longer exist are removed.
  */
 class SOLARUS_GUI_API QuestsModel : public QAbstractListModel {
 
@@ -81,10 +87,13 @@ public:
 private:
 
   void do_sort(QuestSort sort, Qt::SortOrder order = Qt::AscendingOrder);
-  void load_icon(int quest_index) const;
+  QDateTime load_cached_info(QuestInfo& info) const;
+  void apply_scan_result(const QuestScanner::Result& result);
+  bool apply_files_content(QuestInfo& info, const QuestScanner::Result& content) const;
 
-  mutable std::vector<QuestInfo>
+  std::vector<QuestInfo>
       quests;                   /**< Info of each quest in the list. */
+  QuestScanner scanner;         /**< Reads quests in the background. */
 };
 
 }
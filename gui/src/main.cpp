@@ -15,13 +15,13 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/gui/main_window.h"
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/gui/settings.h"
 #include "solarus/core/Arguments.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MainLoop.h"
 #include <QApplication>
 #include <QDesktopWidget>
-#include <QFile>
 #include <QFileInfo>
 #include <QMainWindow>
 #include <QLibraryInfo>
@@ -121,9 +121,7 @@ int add_quest(int argc, char* argv[]) {
 
   QString new_path = argv[2];
   const QString& canonical_path = QFileInfo(new_path).canonicalFilePath();
-  if (!QFile(canonical_path + "/data/quest.dat").exists() &&
-      !QFile(canonical_path + "/data.solarus").exists() &&
-      !QFile(canonical_path + "/data.solarus.zip").exists()) {
+  if (!QuestScanner::is_quest_directory(canonical_path)) {
     std::cerr << "Not a valid Solarus quest: " << new_path.toStdString() << std::endl;
     return 1;
   }
@@ -17,6 +17,7 @@
 #include "solarus/gui/about_dialog.h"
 #include "solarus/gui/gui_tools.h"
 #include "solarus/gui/main_window.h"
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/gui/quests_view.h"
 #include "solarus/gui/settings.h"
 #include <QDesktopWidget>
@@ -78,6 +79,8 @@ MainWindow::MainWindow(QWidget* parent) :
   // Make connections.
   connect(ui.quests_view->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
           this, SLOT(selected_quest_changed()));
+  connect(ui.quests_view->model(), SIGNAL(dataChanged(QModelIndex, QModelIndex)),
+          this, SLOT(quest_data_changed(QModelIndex)));
   connect(ui.play_button, SIGNAL(clicked()),
           this, SLOT(on_action_play_quest_triggered()));
   connect(ui.quests_view, SIGNAL(activated(QModelIndex)),
@@ -128,6 +131,10 @@ void MainWindow::initialize_menus() {
   delete ui.menu_audio;
   ui.menu_audio = nullptr;
 
+  if (!QuestRunner::is_in_process_supported()) {
+    ui.action_run_in_process->setVisible(false);
+  }
+
   update_menus();
 }
 
@@ -137,6 +144,7 @@ void MainWindow::initialize_menus() {
 void MainWindow::update_menus() {
 
   update_fullscreen_action();
+  update_run_in_process_action();
 }
 
 /**
@@ -150,6 +158,18 @@ void MainWindow::update_fullscreen_action() {
   ui.action_fullscreen->setChecked(fullscreen);
 }
 
+/**
+ * @brief Updates the "Run inside the launcher" action with the current
+ * settings.
+ */
+void MainWindow::update_run_in_process_action() {
+
+  Settings settings;
+
+  bool run_in_process = settings.value("run_in_process", false).toBool();
+  ui.action_run_in_process->setChecked(run_in_process);
+}
+
 /**
  * @brief Receives a window close event.
  * @param event The event to handle.
@@ -221,12 +241,14 @@ void MainWindow::on_action_add_quest_triggered() {
     return;
   }
 
-  // Add to the quest list view.
-  if (!ui.quests_view->add_quest(quest_path)) {
+  if (!QuestScanner::is_quest_directory(quest_path)) {
     GuiTools::error_dialog("No quest was found in this directory");
     return;
   }
 
+  // Add to the quest list view.
+  ui.quests_view->add_quest(quest_path);
+
   // Remember the quest list.
   Settings settings;
   settings.setValue("quests_paths", ui.quests_view->get_paths());
@@ -308,6 +330,18 @@ void MainWindow::on_action_stop_quest_triggered() {
   update_run_quest();
 }
 
+/**
+ * @brief Slot called when the user triggers the "Run inside the launcher"
+ * action.
+ *
+ * The change applies to the next quest started.
+ */
+void MainWindow::on_action_run_in_process_triggered() {
+
+  Settings settings;
+  settings.setValue("run_in_process", ui.action_run_in_process->isChecked());
+}
+
 /**
  * @brief Slot called when the user triggers the "Fullscreen" action.
  */
@@ -384,6 +418,17 @@ void MainWindow::update_run_quest() {
   ui.menu_zoom->setEnabled(playing);
 }
 
+/**
+ * @brief Slot called when the info of a quest was read again.
+ * @param index Index of the quest in the list.
+ */
+void MainWindow::quest_data_changed(const QModelIndex& index) {
+
+  if (index.row() == ui.quests_view->get_selected_index()) {
+    selected_quest_changed();
+  }
+}
+
 /**
  * @brief Slot called when the selection changes in the quest list.
  */
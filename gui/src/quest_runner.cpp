@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/gui/quest_runner.h"
+#include "solarus/gui/quest_thread.h"
 #include "solarus/gui/settings.h"
 #include <QApplication>
 #include <QMessageBox>
@@ -30,6 +31,8 @@ namespace SolarusGui {
 QuestRunner::QuestRunner(QObject* parent) :
   QObject(parent),
   process(this),
+  thread(nullptr),
+  in_process(false),
   last_command_id(-1) {
 
   // Connect to QProcess signals to know when the quest is running and finished.
@@ -46,7 +49,7 @@ QuestRunner::QuestRunner(QObject* parent) :
   // while reading on its stdin on windows.
   QTimer* timer = new QTimer(this);
   connect(timer, &QTimer::timeout, [this] () {
-    if (is_started()) {
+    if (!in_process && is_started()) {
       process.write("\n");
     }
   });
@@ -68,10 +71,26 @@ QuestRunner::~QuestRunner() {
       process.kill();
     }
   }
+
+  // Stops the quest of the thread and waits for it.
+  delete thread;
+}
+
+/**
+ * @brief Returns whether quests can run in a thread of the GUI process.
+ * @return @c false on systems where SDL video needs the main thread.
+ */
+bool QuestRunner::is_in_process_supported() {
+
+#ifdef Q_OS_MAC
+  return false;
+#else
+  return true;
+#endif
 }
 
 /**
- * @brief Creates and returns the list of arguments to pass to the process.
+ * @brief Creates and returns the list of engine arguments.
  * @param quest_path The path of the quest to run.
  */
 QStringList QuestRunner::create_arguments(const QString& quest_path) const {
@@ -80,10 +99,6 @@ QStringList QuestRunner::create_arguments(const QString& quest_path) const {
 
   Settings settings;
 
-  // -run quest_path
-  arguments << "-run";
-  arguments << quest_path;
-
   // no-audio
   if (settings.value("no_audio", false).toBool()) {
     arguments << "-no-audio";
@@ -114,6 +129,9 @@ QStringList QuestRunner::create_arguments(const QString& quest_path) const {
  */
 bool QuestRunner::is_started() const {
 
+  if (in_process) {
+    return thread->is_quest_started();
+  }
   return process.state() != QProcess::NotRunning;
 }
 
@@ -123,6 +141,9 @@ bool QuestRunner::is_started() const {
  */
 bool QuestRunner::is_running() const {
 
+  if (in_process) {
+    return thread->is_quest_running();
+  }
   return process.state() == QProcess::Running;
 }
 
@@ -144,6 +165,29 @@ void QuestRunner::start(const QString& quest_path) {
     return;
   }
 
+  Settings settings;
+  in_process = is_in_process_supported() &&
+      settings.value("run_in_process", false).toBool();
+  if (in_process) {
+    if (thread == nullptr) {
+      thread = new QuestThread(this);
+      connect(thread, SIGNAL(quest_running()),
+              this, SIGNAL(running()));
+      connect(thread, SIGNAL(quest_finished()),
+              this, SLOT(on_finished()));
+      connect(thread, SIGNAL(solarus_fatal(QString)),
+              this, SIGNAL(solarus_fatal(QString)));
+      connect(thread, SIGNAL(output_produced(QStringList)),
+              this, SIGNAL(output_produced(QStringList)));
+    }
+
+    // The Lua console reads commands from execute_command() instead of stdin.
+    QStringList arguments = create_arguments(quest_path);
+    arguments.prepend("-lua-console=no");
+    thread->start_quest(arguments);
+    return;
+  }
+
   // Run the current executable itself with the special option "-run quest_path".
   QStringList editor_arguments = QApplication::arguments();
   if (editor_arguments.isEmpty()) {
@@ -155,6 +199,8 @@ void QuestRunner::start(const QString& quest_path) {
   }
   QString program_name = editor_arguments.at(0);
   QStringList arguments = create_arguments(quest_path);
+  arguments.prepend(quest_path);
+  arguments.prepend("-run");
 
   process.start(program_name, arguments);
 
@@ -168,7 +214,14 @@ void QuestRunner::start(const QString& quest_path) {
  */
 void QuestRunner::stop() {
 
-  if (is_started()) {
+  if (!is_started()) {
+    return;
+  }
+
+  if (in_process) {
+    thread->stop_quest();
+  }
+  else {
     process.terminate();
   }
 }
@@ -197,7 +250,7 @@ void QuestRunner::standard_output_data_available() {
 }
 
 /**
- * @brief Executes some Lua code in the quest process.
+ * @brief Executes some Lua code in the quest process or thread.
  * @param command The Lua code.
  * @return The id of the command executed, or -1 if it could not be sent
  * to the process.
@@ -212,14 +265,26 @@ int QuestRunner::execute_command(const QString& command) {
     return -1;
   }
 
-  QByteArray command_utf8 = command.toUtf8();
+  // Give the id explicitly so that the engine reports the same one
+  // even if a previous command was lost.
+  const int command_id = last_command_id + 1;
+  if (in_process) {
+    if (!thread->push_lua_command(QString("@%1 ").arg(command_id) + command)) {
+      return -1;
+    }
+    last_command_id = command_id;
+    return last_command_id;
+  }
+
+  QByteArray command_utf8 = QString("@%1 ").arg(command_id).toUtf8();
+  command_utf8.append(command.toUtf8());
   command_utf8.append("\n");
   qint64 bytes_written = process.write(command_utf8);
   if (bytes_written != command_utf8.size()) {
     return -1;
   }
 
-  ++last_command_id;
+  last_command_id = command_id;
   return last_command_id;
 }
 
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/gui/quest_scanner.h"
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/QuestProperties.h"
+#include <QApplication>
+#include <QFileInfo>
+#include <QStringList>
+#include <string>
+
+namespace SolarusGui {
+
+namespace {
+
+/**
+ * @brief Files of a quest whose changes invalidate what was read.
+ *
+ * Paths are relative to the quest directory.
+ */
+const QStringList watched_files = {
+  "data/quest.dat",
+  "data/logos",
+  "data/logos/logo.png",
+  "data/logos/icon_16.png",
+  "data/logos/icon_24.png",
+  "data/logos/icon_32.png",
+  "data/logos/icon_48.png",
+  "data/logos/icon_64.png",
+  "data/logos/icon_128.png",
+  "data/logos/icon_256.png",
+  "data/logos/icon_512.png",
+  "data/logos/icon_1024.png",
+  "data.solarus",
+  "data.solarus.zip",
+};
+
+/**
+ * @brief Icon files read in a quest, relative to its data directory.
+ */
+const QStringList icon_file_names = {
+  "logos/icon_16.png",
+  "logos/icon_24.png",
+  "logos/icon_32.png",
+  "logos/icon_48.png",
+  "logos/icon_64.png",
+  "logos/icon_128.png",
+  "logos/icon_256.png",
+  "logos/icon_512.png",
+  "logos/icon_1024.png",
+};
+
+/**
+ * @brief Returns the last modification date of the files read in a quest.
+ * @param quest_path Path of the quest directory.
+ * @return The most recent date, or an invalid date if there is no file.
+ */
+QDateTime get_modification_date(const QString& quest_path) {
+
+  QDateTime date;
+  for (const QString& file_name : watched_files) {
+    const QFileInfo info(quest_path + "/" + file_name);
+    if (info.exists() && (!date.isValid() || info.lastModified() > date)) {
+      date = info.lastModified();
+    }
+  }
+  return date;
+}
+
+/**
+ * @brief Reads a data file of the quest currently open.
+ * @param file_name Name of the file, relative to the data directory.
+ * @return The content, or an empty array if there is no such file.
+ */
+QByteArray read_data_file(const std::string& file_name) {
+
+  if (!Solarus::QuestFiles::data_file_exists(file_name)) {
+    return QByteArray();
+  }
+  const std::string& buffer = Solarus::QuestFiles::data_file_read(file_name);
+  return QByteArray(buffer.data(), static_cast<int>(buffer.size()));
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Creates a quest scanner and starts its thread.
+ * @param parent The parent object of the thread.
+ */
+QuestScanner::QuestScanner(QObject* parent) :
+  QThread(parent),
+  program_name(QApplication::arguments().isEmpty() ?
+                 QString() : QApplication::arguments().first()),
+  mutex(),
+  condition(),
+  pending_scans(),
+  quitting(false) {
+
+  qRegisterMetaType<SolarusGui::QuestScanner::Result>();
+  start();
+}
+
+/**
+ * @brief Destroys the quest scanner.
+ *
+ * Quests not scanned yet are dropped.
+ * Waits for the quest being read, if any.
+ */
+QuestScanner::~QuestScanner() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quitting = true;
+    pending_scans.clear();
+  }
+  condition.notify_one();
+  wait();
+}
+
+/**
+ * @brief Returns whether a directory contains a quest.
+ *
+ * This only checks that a data directory or archive exists,
+ * without opening the quest.
+ *
+ * @param quest_path Path of the directory to test.
+ * @return @c true if it looks like a quest.
+ */
+bool QuestScanner::is_quest_directory(const QString& quest_path) {
+
+  return QFileInfo(quest_path + "/data/quest.dat").exists() ||
+      QFileInfo(quest_path + "/data.solarus").exists() ||
+      QFileInfo(quest_path + "/data.solarus.zip").exists();
+}
+
+/**
+ * @brief Returns the mutex to lock while a quest is open in this process.
+ * @return The quest files mutex.
+ */
+std::mutex& QuestScanner::get_quest_files_mutex() {
+
+  static std::mutex quest_files_mutex;
+  return quest_files_mutex;
+}
+
+/**
+ * @brief Asks the thread to read a quest.
+ *
+ * This function returns immediately.
+ * The signal quest_scanned() is emitted when the quest is read,
+ * unless its files have not changed since the date given.
+ *
+ * @param quest_path Path of the quest directory.
+ * @param known_date Modification date of the quest when it was last read,
+ * or an invalid date to read it in any case.
+ */
+void QuestScanner::scan(const QString& quest_path, const QDateTime& known_date) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_scans.emplace_back(quest_path, known_date);
+  }
+  condition.notify_one();
+}
+
+/**
+ * @brief Body of the thread: reads each quest requested in order.
+ */
+void QuestScanner::run() {
+
+  while (true) {
+    std::pair<QString, QDateTime> pending_scan;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] { return !pending_scans.empty() || quitting; });
+      if (quitting) {
+        break;
+      }
+      pending_scan = pending_scans.front();
+      pending_scans.pop_front();
+    }
+
+    const QString& quest_path = pending_scan.first;
+    const QDateTime& date = get_modification_date(quest_path);
+    if (date.isValid() && date == pending_scan.second) {
+      // Nothing changed since the last time.
+      continue;
+    }
+
+    Result result = scan_quest(quest_path);
+    result.modification_date = date;
+    emit quest_scanned(result);
+  }
+}
+
+/**
+ * @brief Opens a quest and reads its properties and images.
+ * @param quest_path Path of the quest directory.
+ * @return What was read.
+ */
+QuestScanner::Result QuestScanner::scan_quest(const QString& quest_path) const {
+
+  Result result;
+  result.path = quest_path;
+  result.valid = false;
+
+  if (!is_quest_directory(quest_path)) {
+    return result;
+  }
+
+  std::lock_guard<std::mutex> lock(get_quest_files_mutex());
+  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
+                                       quest_path.toStdString())) {
+    Solarus::QuestFiles::close_quest();
+    return result;
+  }
+
+  std::string properties_buffer;
+  if (Solarus::CurrentQuest::get_properties().export_to_buffer(properties_buffer)) {
+    result.valid = true;
+    result.properties = QByteArray(properties_buffer.data(), static_cast<int>(properties_buffer.size()));
+    result.logo = read_data_file("logos/logo.png");
+    for (const QString& file_name : icon_file_names) {
+      const QByteArray& icon = read_data_file(file_name.toStdString());
+      if (!icon.isEmpty()) {
+        result.icons << icon;
+      }
+    }
+  }
+  Solarus::QuestFiles::close_quest();
+
+  return result;
+}
+
+}
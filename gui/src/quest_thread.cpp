@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/gui/quest_scanner.h"
+#include "solarus/gui/quest_thread.h"
+#include "solarus/core/Arguments.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/SolarusFatal.h"
+#include <QApplication>
+#include <SDL.h>
+#include <memory>
+
+namespace SolarusGui {
+
+/**
+ * @brief Creates a quest thread and starts it.
+ * @param parent The parent object of the thread.
+ */
+QuestThread::QuestThread(QObject* parent) :
+  QThread(parent),
+  mutex(),
+  condition(),
+  pending_arguments(),
+  quest_pending(false),
+  quest_started(false),
+  stop_requested(false),
+  quitting(false),
+  main_loop(nullptr) {
+
+  start();
+}
+
+/**
+ * @brief Destroys the quest thread.
+ *
+ * If a quest is running, stops it and waits for the thread to finish.
+ */
+QuestThread::~QuestThread() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quitting = true;
+  }
+  stop_quest();
+  condition.notify_one();
+  wait();
+}
+
+/**
+ * @brief Returns whether a quest is started.
+ *
+ * The quest is started as soon as you call start_quest(),
+ * but it then takes a slight delay for it to be loaded.
+ *
+ * @return @c true if a quest is started.
+ */
+bool QuestThread::is_quest_started() const {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return quest_started;
+}
+
+/**
+ * @brief Returns whether a quest is loaded and running.
+ * @return @c true if the main loop of a quest exists.
+ */
+bool QuestThread::is_quest_running() const {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return main_loop != nullptr;
+}
+
+/**
+ * @brief Asks the thread to run a quest.
+ *
+ * Does nothing if a quest is already started.
+ * This function returns immediately.
+ * The signal quest_running() is emitted when the quest is loaded.
+ *
+ * @param arguments Command-line arguments of the engine,
+ * ending with the quest path.
+ */
+void QuestThread::start_quest(const QStringList& arguments) {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (quest_started) {
+      return;
+    }
+    pending_arguments = arguments;
+    quest_pending = true;
+    quest_started = true;
+    stop_requested = false;
+  }
+  condition.notify_one();
+}
+
+/**
+ * @brief Asks the current quest to stop.
+ *
+ * Returns immediately.
+ * The signal quest_finished() is emitted when the quest is closed.
+ */
+void QuestThread::stop_quest() {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  stop_requested = true;
+  if (main_loop != nullptr) {
+    main_loop->set_exiting();
+  }
+}
+
+/**
+ * @brief Schedules some Lua code to be executed by the running quest.
+ * @param command The Lua code, possibly with an "@id " prefix.
+ * @return @c false if no quest is running.
+ */
+bool QuestThread::push_lua_command(const QString& command) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (main_loop == nullptr) {
+    return false;
+  }
+  main_loop->push_lua_command(command.toStdString());
+  return true;
+}
+
+/**
+ * @brief Body of the thread: runs each quest requested.
+ *
+ * SDL is initialized once for all quests run by this thread.
+ */
+void QuestThread::run() {
+
+  SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK);
+
+  while (true) {
+    QStringList arguments;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] { return quest_pending || quitting; });
+      if (quitting && !quest_pending) {
+        break;
+      }
+      arguments = pending_arguments;
+      quest_pending = false;
+    }
+
+    run_quest(arguments);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quest_started = false;
+    }
+    emit quest_finished();
+  }
+
+  SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK);
+}
+
+/**
+ * @brief Runs a quest until it finishes, in the quest thread.
+ * @param arguments Command-line arguments of the engine.
+ */
+void QuestThread::run_quest(const QStringList& arguments) {
+
+  Solarus::Arguments args;
+  const QStringList& gui_arguments = QApplication::arguments();
+  if (!gui_arguments.isEmpty()) {
+    args.set_program_name(gui_arguments.first().toStdString());
+  }
+  for (const QString& argument : arguments) {
+    args.add_argument(argument.toStdString());
+  }
+
+  // Lines logged by the engine replace the standard output of a process.
+  Solarus::Logger::set_output_handler([this](const std::string& line) {
+    emit output_produced(QStringList() << QString::fromStdString(line));
+  });
+
+  // Other parts of the GUI wait for the quest to finish before opening quests.
+  std::lock_guard<std::mutex> quest_files_lock(QuestScanner::get_quest_files_mutex());
+
+  std::unique_ptr<Solarus::MainLoop> quest_main_loop;
+  try {
+    quest_main_loop = std::unique_ptr<Solarus::MainLoop>(new Solarus::MainLoop(args));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      main_loop = quest_main_loop.get();
+      if (stop_requested) {
+        main_loop->set_exiting();
+      }
+    }
+    emit quest_running();
+    quest_main_loop->run();
+  }
+  catch (const Solarus::SolarusFatal& ex) {
+    emit solarus_fatal(QString::fromStdString(ex.what()));
+  }
+
+  // Other threads must not see the main loop while it is destroyed.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    main_loop = nullptr;
+  }
+  quest_main_loop = nullptr;
+
+  Solarus::Logger::set_output_handler(Solarus::Logger::OutputHandler());
+}
+
+}
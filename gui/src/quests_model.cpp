@@ -15,22 +15,44 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/gui/quests_model.h"
-#include "solarus/core/CurrentQuest.h"
-#include "solarus/core/QuestFiles.h"
+#include "solarus/gui/settings.h"
 #include "solarus/core/QuestProperties.h"
-#include <QApplication>
+#include <QCryptographicHash>
+#include <QVariantList>
 #include <algorithm>
+#include <string>
 
 namespace SolarusGui {
 
+namespace {
+
+/**
+ * @brief Returns the settings group where the info of a quest is cached.
+ *
+ * Paths are hashed because slashes separate groups in settings keys.
+ *
+ * @param quest_path Path of a quest.
+ * @return The settings group of this quest.
+ */
+QString get_cache_key(const QString& quest_path) {
+
+  return "quests_cache/" + QString::fromLatin1(
+        QCryptographicHash::hash(quest_path.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+}  // Anonymous namespace.
+
 /**
  * @brief Creates a quests view.
  * @param parent Parent object or nullptr.
  */
 QuestsModel::QuestsModel(QObject* parent) :
   QAbstractListModel(parent),
-  quests() {
+  quests(),
+  scanner() {
 
+  connect(&scanner, &QuestScanner::quest_scanned,
+          this, &QuestsModel::apply_scan_result);
 }
 
 /**
@@ -59,7 +81,6 @@ QVariant QuestsModel::data(const QModelIndex& index, int role) const {
   switch (role) {
 
   case Qt::ItemDataRole::DisplayRole:
-    load_icon(index.row());
     return QVariant::fromValue(quests.at(index.row()));
 
   case Qt::ItemDataRole::ToolTipRole:
@@ -113,9 +134,14 @@ bool QuestsModel::has_quest(const QString& quest_path) {
 
 /**
  * @brief Adds a quest to the model.
+ *
+ * The quest is added right away with its cached info, or with its
+ * directory name as title the first time.
+ * It is then read in the background, and removed if it turns out not to be
+ * a quest.
+ *
  * @param quest_path Path of the quest to add.
- * @return @c true if it was added, @c false if there is no such quest
- * or if it is already there.
+ * @return @c true if it was added, @c false if it is already there.
  */
 bool QuestsModel::add_quest(const QString& quest_path) {
 
@@ -124,27 +150,20 @@ bool QuestsModel::add_quest(const QString& quest_path) {
   }
 
   QuestInfo info;
-
-  // Open the quest to get its quest.dat file.
-  QStringList arguments = QApplication::arguments();
-  QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                       quest_path.toStdString())) {
-    Solarus::QuestFiles::close_quest();
-    return false;
-  }
-  info.properties = Solarus::CurrentQuest::get_properties();
-  Solarus::QuestFiles::close_quest();
+  info.path = quest_path;
+  info.directory_name = quest_path.section('/', -1, -1, QString::SectionSkipEmpty);
+  info.icon = get_quest_default_icon();
+  info.logo = get_quest_default_logo();
+  info.properties.set_title(info.directory_name.toStdString());
+  const QDateTime& cached_date = load_cached_info(info);
 
   const int num_quests = rowCount();
   beginInsertRows(QModelIndex(), num_quests, num_quests);
-
-  info.path = quest_path;
-  info.directory_name = quest_path.section('/', -1, -1, QString::SectionSkipEmpty);
   quests.push_back(info);
-
   endInsertRows();
 
+  scanner.scan(quest_path, cached_date);
+
   return true;
 }
 
@@ -160,6 +179,9 @@ bool QuestsModel::remove_quest(int quest_index) {
     return false;
   }
 
+  Settings settings;
+  settings.remove(get_cache_key(quests[quest_index].path));
+
   beginRemoveRows(QModelIndex(), quest_index, quest_index);
   quests.erase(quests.begin() + quest_index);
   endRemoveRows();
@@ -215,28 +237,7 @@ const QPixmap& QuestsModel::get_quest_logo(int quest_index) const {
     return get_quest_default_logo();
   }
 
-  QuestInfo& quest = quests[quest_index];
-  if (quest.logo.isNull()) {
-    // Lazily load the logo.
-    quest.logo = get_quest_default_logo();
-
-    QStringList arguments = QApplication::arguments();
-    QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-    if (Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                        quest.path.toStdString())) {
-      std::string file_name = "logos/logo.png";
-      if (Solarus::QuestFiles::data_file_exists(file_name)) {
-        std::string buffer = Solarus::QuestFiles::data_file_read(file_name);
-        QPixmap pixmap;
-        if (pixmap.loadFromData((const uchar*) buffer.data(), (uint) buffer.size())) {
-          quests[quest_index].logo = pixmap;
-        }
-      }
-    }
-    Solarus::QuestFiles::close_quest();
-  }
-
-  return quest.logo;
+  return quests[quest_index].logo;
 }
 
 /**
@@ -251,57 +252,105 @@ const QIcon& QuestsModel::get_quest_default_icon() const {
 }
 
 /**
- * @brief Loads the icon of the given quest.
- * @param quest_index Index of a quest.
+ * @brief Fills the info of a quest with what was cached in the settings.
+ * @param info The quest info to fill. Its path must be set.
+ * @return Modification date of the quest files when they were cached,
+ * or an invalid date if the quest is not in the cache.
  */
-void QuestsModel::load_icon(int quest_index) const {
+QDateTime QuestsModel::load_cached_info(QuestInfo& info) const {
+
+  Settings settings;
+  settings.beginGroup(get_cache_key(info.path));
+
+  QuestScanner::Result content;
+  content.path = info.path;
+  content.valid = true;
+  content.modification_date = settings.value("modification_date").toDateTime();
+  content.properties = settings.value("properties").toByteArray();
+  content.logo = settings.value("logo").toByteArray();
+  for (const QVariant& icon : settings.value("icons").toList()) {
+    content.icons << icon.toByteArray();
+  }
 
-  if (quest_index < 0 || quest_index > rowCount()) {
-    return;
+  if (!content.modification_date.isValid() ||
+      !apply_files_content(info, content)) {
+    return QDateTime();
   }
+  return content.modification_date;
+}
 
-  QuestInfo& quest = quests[quest_index];
-  QIcon& icon = quest.icon;
-  if (!icon.isNull()) {
-    // Already loaded.
+/**
+ * @brief Slot called when a quest was read by the scanner.
+ *
+ * Updates the quest and its cached info.
+ * Quests that are not valid are removed from the list.
+ *
+ * @param result What was read.
+ */
+void QuestsModel::apply_scan_result(const QuestScanner::Result& result) {
+
+  const int quest_index = path_to_index(result.path);
+  if (quest_index == -1) {
+    // Removed in the meantime.
     return;
   }
 
-  QStringList arguments = QApplication::arguments();
-  QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                       quest.path.toStdString())) {
-    Solarus::QuestFiles::close_quest();
-    icon = get_quest_default_icon();
+  QuestInfo& info = quests[quest_index];
+  if (!result.valid || !apply_files_content(info, result)) {
+    remove_quest(quest_index);
     return;
   }
 
-  QStringList file_names = {
-    "logos/icon_16.png",
-    "logos/icon_24.png",
-    "logos/icon_32.png",
-    "logos/icon_48.png",
-    "logos/icon_64.png",
-    "logos/icon_128.png",
-    "logos/icon_256.png",
-    "logos/icon_512.png",
-    "logos/icon_1024.png",
-  };
-  for (const QString& file_name : file_names) {
-    if (Solarus::QuestFiles::data_file_exists(file_name.toStdString())) {
-      std::string buffer = Solarus::QuestFiles::data_file_read(file_name.toStdString());
-      QPixmap pixmap;
-      if (!pixmap.loadFromData((const uchar*) buffer.data(), (uint) buffer.size())) {
-        continue;
-      }
-      icon.addPixmap(pixmap);
+  Settings settings;
+  settings.beginGroup(get_cache_key(result.path));
+  settings.setValue("path", result.path);
+  settings.setValue("modification_date", result.modification_date);
+  settings.setValue("properties", result.properties);
+  settings.setValue("logo", result.logo);
+  QVariantList icons;
+  for (const QByteArray& icon : result.icons) {
+    icons << icon;
+  }
+  settings.setValue("icons", icons);
+
+  const QModelIndex& model_index = index(quest_index);
+  emit dataChanged(model_index, model_index);
+}
+
+/**
+ * @brief Decodes the properties and images of a quest.
+ * @param info The quest info to fill.
+ * @param content Content of the quest files.
+ * @return @c false if the properties cannot be parsed.
+ */
+bool QuestsModel::apply_files_content(
+    QuestInfo& info, const QuestScanner::Result& content) const {
+
+  Solarus::QuestProperties properties;
+  const std::string properties_buffer(content.properties.constData(), content.properties.size());
+  if (!properties.import_from_buffer(properties_buffer, "quest.dat")) {
+    return false;
+  }
+  info.properties = properties;
+
+  info.logo = get_quest_default_logo();
+  if (!content.logo.isEmpty()) {
+    QPixmap logo;
+    if (logo.loadFromData(content.logo)) {
+      info.logo = logo;
     }
   }
-  Solarus::QuestFiles::close_quest();
 
-  if (icon.isNull()) {
-    icon = get_quest_default_icon();
+  QIcon icon;
+  for (const QByteArray& icon_content : content.icons) {
+    QPixmap pixmap;
+    if (pixmap.loadFromData(icon_content)) {
+      icon.addPixmap(pixmap);
+    }
   }
+  info.icon = icon.isNull() ? get_quest_default_icon() : icon;
+
+  return true;
 }
 
 /**
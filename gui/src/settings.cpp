@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/gui/settings.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Settings.h"
@@ -40,6 +41,8 @@ Settings::Settings(Scope scope) :
  */
 void Settings::export_to_quest(const QString& quest_path) const {
 
+  std::lock_guard<std::mutex> lock(QuestScanner::get_quest_files_mutex());
+
   if (Solarus::QuestFiles::is_open()) {
     Solarus::QuestFiles::close_quest();
   }
@@ -88,6 +91,7 @@ void Settings::export_to_quest(const QString& quest_path) const {
   }
 
   solarus_settings.save(file_name);
+  Solarus::QuestFiles::close_quest();
 }
 
 }
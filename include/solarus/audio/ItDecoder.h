@@ -36,7 +36,7 @@ class ItDecoder {
 
     ItDecoder();
 
-    void load(const std::string& sound_buffer);
+    void load(const char* sound_data, size_t sound_size);
     void unload();
     int decode(void* decoded_data, int nb_samples);
 
@@ -18,14 +18,21 @@
 #define SOLARUS_MUSIC_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/PcmChunkQueue.h"
 #include "solarus/audio/Sound.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Solarus {
 
+class Arguments;
 class ItDecoder;
 class OggDecoder;
 class SpcDecoder;
@@ -40,6 +47,12 @@ class SpcDecoder;
  * initialized, by calling Sound::initialize().
  * Sound and Music are the only classes that depends on audio libraries.
  *
+ * Musics are decoded ahead of time by a thread dedicated to the current
+ * music. The main thread only gives the decoded chunks to OpenAL,
+ * so that a slow decoding does not delay frames.
+ * How far ahead is configurable with -music-lookahead, and the cost of the
+ * decoding is measured to detect quests whose musics are too heavy.
+ *
  * TODO move the non-static parts to an internal private class.
  * TODO make a subclass for each format?
  */
@@ -62,7 +75,9 @@ class SOLARUS_API Music {
     static const std::vector<std::string>
         format_names;                            /**< Name of each format. */
 
-    static void initialize();
+    ~Music();
+
+    static void initialize(const Arguments& args);
     static void quit();
     static bool is_initialized();
     static void update();
@@ -86,29 +101,41 @@ class SOLARUS_API Music {
     static void play(
         const std::string& music_id,
         bool loop,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
     static void stop_playing();
     static const std::string& get_current_music_id();
 
+    static int get_lookahead();
+    static double get_decoding_load();
+    static int get_num_underruns();
+
   private:
 
     Music();
     Music(
         const std::string& music_id,
         bool loop,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
 
     bool start();
     void stop();
     bool is_paused();
     void set_paused(bool pause);
-    void set_callback(const ScopedLuaRef& callback_ref);
+    void set_callback(ScopedLuaRef callback_ref);
+
+    static int get_num_chunks_ahead();
 
-    void decode_spc(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_it(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_ogg(ALuint destination_buffer, ALsizei nb_samples);
+    bool decode_chunk(PcmChunk& chunk);
+    void decode_spc(PcmChunk& chunk, int nb_samples);
+    void decode_it(PcmChunk& chunk, int nb_samples);
+    void decode_ogg(PcmChunk& chunk, int nb_samples);
+    bool fill_buffer(ALuint buffer, const PcmChunk& chunk);
+
+    void start_decoding_thread();
+    void stop_decoding_thread();
+    void run_decoding_thread();
 
     bool update_playing();
 
@@ -118,10 +145,30 @@ class SOLARUS_API Music {
     bool loop;                                   /**< Whether the music should loop. */
     ScopedLuaRef callback_ref;                   /**< Lua ref to a function to call when the music finishes. */
 
-    static constexpr int nb_buffers = 8;
-    ALuint buffers[nb_buffers];                  /**< multiple buffers used to stream the music */
+    static constexpr int chunk_size = 16384;     /**< Samples decoded at once. */
+    static int num_buffers;                      /**< Number of buffers used to stream a music. */
+    static int lookahead;                        /**< Duration to decode in advance in milliseconds,
+                                                  * or 0 to decode num_buffers chunks. */
+    static std::atomic<int> num_underruns;       /**< Number of times a music stopped because
+                                                  * the decoding could not keep up. */
+
+    std::vector<ALuint> buffers;                 /**< multiple buffers used to stream the music */
+    std::vector<ALuint> free_buffers;            /**< Buffers waiting for decoded data. */
     ALuint source;                               /**< the OpenAL source streaming the buffers */
 
+    PcmChunkQueue decoded_chunks;                /**< Chunks decoded in advance by the decoding thread. */
+    std::thread decoding_thread;                 /**< Thread that decodes this music. */
+    std::mutex decoding_mutex;                   /**< Protects the decoders and decoding_stopping. */
+    std::condition_variable
+        decoding_condition;                      /**< Wakes up the decoding thread. */
+    bool decoding_stopping;                      /**< Whether the decoding thread should exit. */
+    std::atomic<bool> decoding_finished;         /**< Whether the end of the music was decoded. */
+    std::atomic<int64_t>
+        decoding_time;                           /**< Time spent decoding in microseconds. */
+    std::atomic<int64_t>
+        decoded_time;                            /**< Duration of the decoded audio in microseconds. */
+    bool playing_started;                        /**< Whether the source was started once. */
+
     static std::unique_ptr<SpcDecoder>
         spc_decoder;                             /**< The SPC decoder. */
     static std::unique_ptr<ItDecoder>
@@ -19,6 +19,8 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/audio/Sound.h"
+#include <SDL_rwops.h>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -33,9 +35,11 @@ class OggDecoder {
 
     OggDecoder();
 
-    bool load(std::string&& ogg_data, bool loop);
+    bool load(SDL_RWops* rw, bool loop);
     void unload();
-    void decode(ALuint destination_buffer, ALsizei nb_samples);
+    int get_num_channels() const;
+    int get_sample_rate() const;
+    long decode(int16_t* decoded_data, int nb_samples);
 
   private:
 
@@ -47,8 +51,16 @@ class OggDecoder {
     };
     using OggFileUniquePtr = std::unique_ptr<OggVorbis_File, OggFileDeleter>;
 
+    struct SDL_RWops_Deleter {
+      void operator()(SDL_RWops* rw) {
+        SDL_RWclose(rw);
+      }
+    };
+    using SDL_RWops_UniquePtr = std::unique_ptr<SDL_RWops, SDL_RWops_Deleter>;
+
+    SDL_RWops_UniquePtr ogg_rw;        /**< The encoded music file, read progressively. */
     OggFileUniquePtr ogg_file;         /**< The file used by the vorbisfile lib. */
-    Sound::SoundFromMemory ogg_mem;    /**< The encoded music loaded in memory,
+    Sound::SoundStream ogg_stream;     /**< The encoded music stream,
                                         * passed to the vorbisfile lib as user data. */
     vorbis_info* ogg_info;             /**< Info about the OGG file. */
     ogg_int64_t loop_start_pcm;        /**< Where to loop to in PCM samples.
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PCM_CHUNK_QUEUE_H
+#define SOLARUS_PCM_CHUNK_QUEUE_H
+
+#include "solarus/core/Common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A chunk of decoded music, ready to be given to OpenAL.
+ */
+struct PcmChunk {
+  std::vector<int16_t> samples;  /**< Decoded 16-bit samples (may be larger than needed). */
+  int num_bytes = 0;             /**< Number of bytes of samples actually decoded. */
+  int num_channels = 2;          /**< 1 for mono, 2 for stereo. */
+  int sample_rate = 44100;       /**< Sampling rate in Hz. */
+};
+
+/**
+ * \brief A fixed-size queue of decoded chunks between two threads.
+ *
+ * One thread (the producer) writes chunks and another one (the consumer)
+ * reads them. No lock is taken: each side only moves its own index.
+ * Chunks are reused, so their sample buffers are only allocated once.
+ */
+class SOLARUS_API PcmChunkQueue {
+
+  public:
+
+    explicit PcmChunkQueue(int capacity);
+
+    PcmChunkQueue(const PcmChunkQueue& other) = delete;
+    PcmChunkQueue& operator=(const PcmChunkQueue& other) = delete;
+
+    int get_capacity() const;
+    int get_num_chunks() const;
+    bool is_empty() const;
+    bool is_full() const;
+
+    // Producer side.
+    PcmChunk* get_chunk_to_write();
+    void push();
+
+    // Consumer side.
+    const PcmChunk* get_chunk_to_read() const;
+    void pop();
+
+  private:
+
+    std::vector<PcmChunk> chunks;         /**< One more slot than the capacity. */
+    std::atomic<size_t> read_index;       /**< Next chunk to read, only moved by the consumer. */
+    std::atomic<size_t> write_index;      /**< Next chunk to write, only moved by the producer. */
+
+};
+
+}
+
+#endif
+
@@ -17,25 +17,46 @@
 #ifndef SOLARUS_SOUND_H
 #define SOLARUS_SOUND_H
 
+#include "solarus/containers/ResourceCache.h"
 #include "solarus/core/Common.h"
-#include <string>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 #include <al.h>
 #include <alc.h>
 #include <vorbis/vorbisfile.h>
 
+struct SDL_RWops;
+
 namespace Solarus {
 
 class Arguments;
+class OggDecoder;
+
+namespace QuestFiles {
+class DataFileBuffer;
+}
 
 /**
- * \brief Represents a sound effect that can be played in the program.
+ * \brief Plays sound effects.
  *
  * This class also handles the initialization of the whole audio system.
- * To create a sound, prefer the Sound::play() method
- * rather than calling directly the constructor of Sound.
- * This class is the only one that depends on the sound decoding library (libsndfile).
+ * Sounds are decoded the first time they are played, or in advance on
+ * a separate thread when they are preloaded.
+ * Decoded sounds are kept in a cache with a memory limit: the least
+ * recently played ones are released first, except when they are playing.
+ * A fixed pool of OpenAL sources is allocated at initialization.
+ * When all sources are busy, a new sound interrupts the oldest sound
+ * of the lowest priority that is not higher than its own.
+ * Plays of the same sound during the same cycle are merged.
+ * Sounds longer than a duration set by the quest are not decoded in advance:
+ * their compressed data stays in memory and they are decoded while playing.
+ * This class is the only one that depends on the sound decoding library (libvorbisfile).
  * This class and the Music class are the only ones that depend on the audio mixer library (OpenAL).
  */
 class SOLARUS_API Sound {
@@ -45,26 +66,33 @@ class SOLARUS_API Sound {
     // libvorbisfile
 
     /**
-     * \brief Buffer containing an encoded sound file.
+     * \brief Stream of an encoded sound file.
      */
-    struct SoundFromMemory {
-      std::string data;         /**< The OGG encded data. */
-      size_t position;          /**< Current position in the buffer. */
+    struct SoundStream {
+      SDL_RWops* rw;            /**< The OGG encoded data. */
       bool loop;                /**< \c true to restart the sound if it finishes. */
     };
 
-    // functions to load the encoded sound from memory
-    static ov_callbacks ogg_callbacks;           /**< vorbisfile object used to load the encoded sound from memory */
+    // functions to load the encoded sound from a stream
+    static ov_callbacks ogg_callbacks;           /**< vorbisfile object used to load the encoded sound from a stream */
 
-    Sound();
-    explicit Sound(const std::string& sound_id);
-    ~Sound();
-    void load();
-    bool start();
+    /**
+     * \brief How a sound effect competes with other ones for sources.
+     */
+    struct PlayOptions {
+      int priority = 0;         /**< Sounds can interrupt ones with a lower or equal priority. */
+      int max_instances = 0;    /**< Maximum simultaneous plays of this sound, 0 means no limit. */
+      float volume = 1.0f;      /**< Volume of this play relative to the sound volume (0.0 to 1.0). */
+    };
+
+    static constexpr size_t default_max_memory_size = 32 * 1024 * 1024;  /**< 32 MiB. */
+    static constexpr int default_num_sources = 32;   /**< Size of the pool of sources. */
 
     static void load_all();
+    static void preload(const std::vector<std::string>& sound_ids);
     static bool exists(const std::string& sound_id);
     static void play(const std::string& sound_id);
+    static void play(const std::string& sound_id, const PlayOptions& options);
 
     static void initialize(const Arguments& args);
     static void quit();
@@ -74,22 +102,135 @@ class SOLARUS_API Sound {
     static int get_volume();
     static void set_volume(int volume);
 
+    static size_t get_max_memory_size();
+    static void set_max_memory_size(size_t max_memory_size);
+    static ResourceCacheStatistics get_statistics();
+    static uint32_t get_streaming_duration();
+    static void set_streaming_duration(uint32_t streaming_duration);
+
   private:
 
-    ALuint decode_file(const std::string& file_name);
-    bool update_playing();
+    /**
+     * \brief A decoded sound in an OpenAL buffer.
+     *
+     * The buffer is destroyed with this object.
+     */
+    struct Buffer {
+      Buffer(ALuint buffer, uint32_t duration, size_t num_bytes);
+      ~Buffer();
+      Buffer(const Buffer& other) = delete;
+      Buffer& operator=(const Buffer& other) = delete;
+
+      ALuint buffer;            /**< The OpenAL buffer. */
+      uint32_t duration;        /**< Length of the sound in milliseconds. */
+      size_t num_bytes;         /**< Size of the samples. */
+    };
+    using BufferPtr = std::shared_ptr<Buffer>;
+
+    /**
+     * \brief PCM samples of a sound, decoded but not given to OpenAL yet.
+     */
+    struct DecodedSound {
+      std::vector<char> samples;  /**< 16-bit stereo samples. */
+      ALsizei sample_rate = 0;    /**< Sampling rate in Hz. */
+    };
+    using DecodedSoundPtr = std::shared_ptr<DecodedSound>;
+
+    /**
+     * \brief Compressed data of a sound decoded while playing.
+     */
+    using EncodedSoundPtr = std::shared_ptr<const QuestFiles::DataFileBuffer>;
+
+    /**
+     * \brief Progressive decoding of a long sound into the buffers
+     * queued on its source.
+     *
+     * The buffers are destroyed with this object, so the source must
+     * be detached from them first.
+     */
+    class Stream {
+
+      public:
+
+        explicit Stream(const EncodedSoundPtr& encoded_sound);
+        ~Stream();
+        Stream(const Stream& other) = delete;
+        Stream& operator=(const Stream& other) = delete;
+
+        bool start(ALuint source);
+        bool update(ALuint source);
+
+      private:
+
+        bool fill_buffer(ALuint buffer);
+
+        static constexpr int num_buffers = 4;      /**< Buffers queued on the source. */
+        static constexpr int chunk_size = 8192;    /**< Samples per channel decoded at once. */
+
+        EncodedSoundPtr encoded_sound;             /**< The compressed data, kept alive while decoding. */
+        std::unique_ptr<OggDecoder> decoder;       /**< Decoder reading the compressed data. */
+        std::vector<ALuint> buffers;               /**< Buffers decoded in turn. */
+        std::vector<int16_t> samples;              /**< Decoded samples of the current chunk. */
+        std::vector<int16_t> stereo_samples;       /**< Samples converted to stereo if needed. */
+        bool finished;                             /**< Whether the end of the sound was decoded. */
+    };
+    using StreamPtr = std::shared_ptr<Stream>;
+
+    /**
+     * \brief A source currently playing a sound.
+     */
+    struct PlayingSource {
+      ALuint source;            /**< The OpenAL source. */
+      BufferPtr buffer;         /**< The sound it plays, kept alive until the end. */
+      std::string sound_id;     /**< Id of this sound. */
+      int priority;             /**< Priority given when playing it. */
+      uint64_t start_date;      /**< Value of the clock when it started. */
+      uint64_t start_update;    /**< Cycle when it started. */
+      uint32_t end_time;        /**< Real time when it should be finished,
+                                 * before which its state is not polled. */
+      StreamPtr stream;         /**< Decoding in progress if the sound is
+                                 * streamed, nullptr otherwise. */
+    };
+
+    static std::string get_file_name(const std::string& sound_id);
+    static BufferPtr get_buffer(const std::string& sound_id);
+    static BufferPtr create_buffer(const std::string& sound_id, const DecodedSound& decoded_sound);
+    static DecodedSoundPtr decode_file(const std::string& file_name);
+    static EncodedSoundPtr get_encoded_sound(const std::string& sound_id);
+    static uint32_t get_duration(const QuestFiles::DataFileBuffer& encoded_sound);
+    static void enforce_max_memory_size();
+
+    static void update_preloading();
+    static void finish_preloading();
+
+    static void create_sources();
+    static int find_source_to_steal(int priority);
+    static ALuint stop_playing_source(int index);
+    static void release_source(ALuint source);
 
     static ALCdevice* device;
     static ALCcontext* context;
 
-    std::string id;                              /**< id of this sound */
-    ALuint buffer;                               /**< the OpenAL buffer containing the PCM decoded data of this sound */
-    std::list<ALuint> sources;                   /**< the sources currently playing this sound */
-    static std::list<Sound*> current_sounds;     /**< the sounds currently playing */
-    static std::map<std::string, Sound> all_sounds;   /**< all sounds created before */
+    static ResourceCache<Buffer> buffers;        /**< Decoded sounds by id. */
+    static uint64_t clock;                       /**< Incremented at each play, dates the uses of buffers. */
+    static size_t max_memory_size;               /**< Memory allowed for decoded sounds in bytes. */
+    static std::vector<PlayingSource>
+        playing_sources;                         /**< The sources currently playing a sound. */
+    static std::vector<ALuint> free_sources;     /**< Sources not playing. */
+    static int num_sources;                      /**< Number of sources to allocate. */
+    static uint64_t num_updates;                 /**< Number of calls to update(). */
+    static std::deque<std::string>
+        sounds_to_preload;                       /**< Sounds waiting to be decoded in advance. */
+    static std::string preloading_sound_id;      /**< Sound being decoded in advance, if any. */
+    static std::future<DecodedSoundPtr>
+        preloading_sound;                        /**< Result of this decoding. */
+    static uint32_t streaming_duration;          /**< Sounds at least this long in milliseconds
+                                                  * are streamed (0 means never). */
+    static std::map<std::string, EncodedSoundPtr>
+        encoded_sounds;                          /**< Compressed data of streamed sounds by id,
+                                                  * nullptr for sounds that are not streamed. */
 
     static bool initialized;                     /**< indicates that the audio system is initialized */
-    static bool sounds_preloaded;                /**< true if load_all() was called */
     static float volume;                         /**< the volume of sound effects (0.0 to 1.0) */
 
 };
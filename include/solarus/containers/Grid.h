@@ -21,7 +21,8 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
-#include <set>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 namespace Solarus {
@@ -29,7 +30,10 @@ namespace Solarus {
 /**
  * \brief A collection of objects spatially located in a grid.
  *
- * In the current implementation, objects cannot move or be resized.
+ * An object is stored in every cell its bounding box overlaps.
+ * Objects can be removed, provided that the same bounding box is given.
+ * Queries of a rectangle avoid duplicates with a visit stamp per object,
+ * so they are not thread-safe even though they are const.
  */
 template <typename T>
 class Grid {
@@ -44,20 +48,36 @@ class Grid {
     size_t get_num_columns() const;
     size_t get_num_cells() const;
 
+    Rectangle get_cells(const Rectangle& where) const;
+
     void clear();
     void add(const T& element, const Rectangle& bounding_box);
+    bool remove(const T& element, const Rectangle& bounding_box);
 
     const std::vector<T>& get_elements(size_t cell_index) const;
+    std::vector<T>& get_elements(size_t cell_index);
     void get_elements(const Rectangle& where,
         std::vector<T>& elements) const;
+    template<typename F>
+    void for_each_element(const Rectangle& where, F function) const;
 
   private:
 
+    uint32_t get_new_visit_stamp() const;
+
     const Size grid_size;
     const Size cell_size;
     size_t num_rows;
     size_t num_columns;
     std::vector<std::vector<T>> elements;     /**< Two-dimensional array of cells. */
+    std::vector<std::vector<uint32_t>>
+        element_ids;                          /**< Id of each element of each cell,
+                                               * shared by all cells of an element. */
+    std::vector<uint32_t> free_ids;           /**< Ids of removed elements. */
+    mutable std::vector<uint32_t>
+        visit_stamps;                         /**< Stamp of the last query that
+                                               * visited each element id. */
+    mutable uint32_t last_visit_stamp;        /**< Stamp of the last query. */
 
 };
 
@@ -72,7 +92,12 @@ Grid<T>::Grid(const Size& grid_size, const Size& cell_size):
     grid_size(grid_size),
     cell_size(cell_size),
     num_rows(0),
-    num_columns(0) {
+    num_columns(0),
+    elements(),
+    element_ids(),
+    free_ids(),
+    visit_stamps(),
+    last_visit_stamp(0) {
 
   Debug::check_assertion(grid_size.width > 0 && grid_size.height > 0,
       "Invalid grid size");
@@ -89,6 +114,7 @@ Grid<T>::Grid(const Size& grid_size, const Size& cell_size):
     ++num_columns;
   }
   elements.resize(num_rows * num_columns);
+  element_ids.resize(num_rows * num_columns);
 }
 
 /**
@@ -150,6 +176,58 @@ const std::vector<T>& Grid<T>::get_elements(size_t cell_index) const {
   return elements[cell_index];
 }
 
+/**
+ * \brief Returns all elements in the specified cell.
+ *
+ * Elements can be modified but must stay in the same cells.
+ *
+ * \param cell_index Index of a cell in the grid.
+ * \return The elements in this cell.
+ */
+template <typename T>
+std::vector<T>& Grid<T>::get_elements(size_t cell_index) {
+
+  Debug::check_assertion(cell_index < get_num_cells(),
+      "Invalid index");
+
+  return elements[cell_index];
+}
+
+/**
+ * \brief Returns the cells overlapped by a rectangle.
+ * \param where A rectangle in grid coordinates.
+ * \return The cells as a rectangle of columns and rows, clipped to the grid.
+ * Its size is empty if no cell is overlapped.
+ */
+template <typename T>
+Rectangle Grid<T>::get_cells(const Rectangle& where) const {
+
+  if (where.is_flat()) {
+    return Rectangle();
+  }
+
+  // Round towards minus infinity for coordinates before the grid.
+  const auto get_cell = [](int coordinate, int size) {
+    return coordinate >= 0 ? coordinate / size : (coordinate + 1) / size - 1;
+  };
+  const int column1 = std::max(get_cell(where.get_x(), cell_size.width), 0);
+  const int column2 = std::min(
+      get_cell(where.get_x() + where.get_width() - 1, cell_size.width),
+      static_cast<int>(num_columns) - 1
+  );
+  const int row1 = std::max(get_cell(where.get_y(), cell_size.height), 0);
+  const int row2 = std::min(
+      get_cell(where.get_y() + where.get_height() - 1, cell_size.height),
+      static_cast<int>(num_rows) - 1
+  );
+
+  if (column1 > column2 || row1 > row2) {
+    // No cell.
+    return Rectangle();
+  }
+  return Rectangle(column1, row1, column2 - column1 + 1, row2 - row1 + 1);
+}
+
 /**
  * \brief Returns all elements in the specified rectangle.
  *
@@ -163,38 +241,65 @@ void Grid<T>::get_elements(
     const Rectangle& where,
     std::vector<T>& elements) const {
 
-  const size_t row1 = where.get_y() / num_rows;
-  const size_t row2 = where.get_y() + where.get_height() / num_rows;
-  const size_t column1 = where.get_x() / num_columns;
-  const size_t column2 = where.get_x() + where.get_width() / num_columns;
+  for_each_element(where, [&elements](const T& element) {
+    elements.push_back(element);
+  });
+}
 
-  if (row1 > row2 || column1 > column2) {
-    // No cell.
+/**
+ * \brief Calls a function on each element of the cells overlapped by a
+ * rectangle.
+ *
+ * Elements that are in several cells are visited only once.
+ * The function must not modify or query the grid.
+ *
+ * \param where The area to get.
+ * \param function Function to call with each element as a const reference.
+ */
+template <typename T>
+template <typename F>
+void Grid<T>::for_each_element(const Rectangle& where, F function) const {
+
+  const Rectangle& cells = get_cells(where);
+  if (cells.is_flat()) {
     return;
   }
 
-  std::set<T> elements_added;
-  for (size_t i = row1; i <= row2; ++i) {
-    if (i >= num_rows) {
-      continue;
-    }
-
-    for (size_t j = column1; j <= column2; ++j) {
-      if (j >= num_columns) {
-        continue;
-      }
-
-      const std::vector<T>& in_cell = this->elements[i * num_columns + j];
-      for (const T& element: in_cell) {
-        if (elements_added.find(element) == elements_added.end()) {
-          elements_added.insert(element);
-          elements.push_back(element);
+  const uint32_t visit_stamp = get_new_visit_stamp();
+  for (int i = cells.get_y(); i < cells.get_y() + cells.get_height(); ++i) {
+    for (int j = cells.get_x(); j < cells.get_x() + cells.get_width(); ++j) {
+      const size_t cell_index = i * num_columns + j;
+      const std::vector<T>& in_cell = this->elements[cell_index];
+      const std::vector<uint32_t>& ids = element_ids[cell_index];
+      for (size_t k = 0; k < in_cell.size(); ++k) {
+        if (visit_stamps[ids[k]] != visit_stamp) {
+          visit_stamps[ids[k]] = visit_stamp;
+          function(in_cell[k]);
         }
       }
     }
   }
 }
 
+/**
+ * \brief Returns a new stamp to mark elements visited by a query.
+ *
+ * When the stamp counter wraps around, all elements are reset.
+ *
+ * \return A stamp different from all stamps currently stored.
+ */
+template <typename T>
+uint32_t Grid<T>::get_new_visit_stamp() const {
+
+  ++last_visit_stamp;
+  if (last_visit_stamp == 0) {
+    // Overflow: elements may have any old stamp.
+    std::fill(visit_stamps.begin(), visit_stamps.end(), 0);
+    last_visit_stamp = 1;
+  }
+  return last_visit_stamp;
+}
+
 /**
  * \brief Removes all elements in the grid.
  */
@@ -203,6 +308,11 @@ void Grid<T>::clear() {
 
   elements.clear();
   elements.resize(num_rows * num_columns);
+  element_ids.clear();
+  element_ids.resize(num_rows * num_columns);
+  free_ids.clear();
+  visit_stamps.clear();
+  last_visit_stamp = 0;
 }
 
 /**
@@ -216,29 +326,67 @@ void Grid<T>::clear() {
 template <typename T>
 void Grid<T>::add(const T& element, const Rectangle& bounding_box) {
 
-  const int row1 = bounding_box.get_y() / cell_size.height;
-  const int row2 = (bounding_box.get_y() + bounding_box.get_height()) / cell_size.height;
-  const int column1 = bounding_box.get_x() / cell_size.width;
-  const int column2 = (bounding_box.get_x() + bounding_box.get_width()) / cell_size.width;
-
-  if (row1 > row2 || column1 > column2) {
+  const Rectangle& cells = get_cells(bounding_box);
+  if (cells.is_flat()) {
     // No cell.
     return;
   }
 
-  for (int i = row1; i <= row2; ++i) {
-    if (i < 0 || i >= (int) num_rows) {
-      continue;
+  uint32_t id = 0;
+  if (!free_ids.empty()) {
+    id = free_ids.back();
+    free_ids.pop_back();
+  }
+  else {
+    id = static_cast<uint32_t>(visit_stamps.size());
+    visit_stamps.push_back(0);
+  }
+
+  for (int i = cells.get_y(); i < cells.get_y() + cells.get_height(); ++i) {
+    for (int j = cells.get_x(); j < cells.get_x() + cells.get_width(); ++j) {
+      const size_t cell_index = i * num_columns + j;
+      elements[cell_index].push_back(element);
+      element_ids[cell_index].push_back(id);
     }
+  }
+}
 
-    for (int j = column1; j <= column2; ++j) {
-      if (j < 0 || j >= (int) num_columns) {
+/**
+ * \brief Removes an element from the grid.
+ *
+ * The order of other elements in each cell is preserved.
+ *
+ * \param element The element to remove.
+ * \param bounding_box Bounding box the element was added with.
+ * \return \c true if the element was found.
+ */
+template <typename T>
+bool Grid<T>::remove(const T& element, const Rectangle& bounding_box) {
+
+  const Rectangle& cells = get_cells(bounding_box);
+  bool found = false;
+  uint32_t id = 0;
+  for (int i = cells.get_y(); i < cells.get_y() + cells.get_height(); ++i) {
+    for (int j = cells.get_x(); j < cells.get_x() + cells.get_width(); ++j) {
+      const size_t cell_index = i * num_columns + j;
+      std::vector<T>& in_cell = elements[cell_index];
+      const auto& it = std::find(in_cell.begin(), in_cell.end(), element);
+      if (it == in_cell.end()) {
         continue;
       }
-
-      elements[i * num_columns + j].push_back(element);
+      std::vector<uint32_t>& ids = element_ids[cell_index];
+      const auto& id_it = ids.begin() + (it - in_cell.begin());
+      id = *id_it;
+      found = true;
+      ids.erase(id_it);
+      in_cell.erase(it);
     }
   }
+
+  if (found) {
+    free_ids.push_back(id);
+  }
+  return found;
 }
 
 }
@@ -18,14 +18,16 @@
 #define SOLARUS_QUADTREE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include <array>
-#include <map>
+#include <cstdint>
 #include <memory>
-#include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
@@ -38,7 +40,16 @@ class Color;
  * The main goal of this container is to get objects in a given rectangle as
  * quickly as possible.
  *
- * \param T Type of objects.
+ * Elements are stored in a flat array of slots and nodes only store slot
+ * indices. Queries avoid duplicates with a visit stamp per slot, so
+ * they don't allocate memory if the result vector is reused.
+ * As a consequence, queries are not thread-safe even though they are const.
+ *
+ * The quadtree can be loose: elements are then placed in nodes with
+ * a bounding box enlarged by a margin, so that moving an element by less
+ * than this margin does not change the nodes it is in.
+ *
+ * \param T Type of objects. It must be hashable with std::hash.
  */
 template <typename T>
 class Quadtree {
@@ -47,19 +58,33 @@ class Quadtree {
 
     Quadtree();
     explicit Quadtree(const Rectangle& space);
+    Quadtree(const Rectangle& space, const std::vector<std::pair<T, Rectangle>>& elements);
 
     void clear();
     void initialize(const Rectangle& space);
 
     Rectangle get_space() const;
+    int get_looseness() const;
+    void set_looseness(int looseness);
 
     bool add(const T& element, const Rectangle& bounding_box);
+    int add_all(const std::vector<std::pair<T, Rectangle>>& elements);
     bool remove(const T& element);
     bool move(const T& element, const Rectangle& bounding_box);
+    void rebuild();
 
     std::vector<T> get_elements(
         const Rectangle& where
     ) const;
+    void get_elements(
+        const Rectangle& where,
+        std::vector<T>& result
+    ) const;
+    template<typename F>
+    void for_each_element(
+        const Rectangle& where,
+        F function
+    ) const;
 
     int get_num_elements() const;
     bool contains(const T& element) const;
@@ -87,6 +112,7 @@ class Quadtree {
 
         explicit Node(const Quadtree& quadtree);
         Node(const Quadtree& quadtree, const Rectangle& cell);
+        ~Node();
 
         void clear();
         void initialize(const Rectangle& cell);
@@ -94,18 +120,15 @@ class Quadtree {
         Rectangle get_cell() const;
         Size get_cell_size() const;
 
-        bool add(
-            const T& element,
-            const Rectangle& bounding_box
-        );
-        bool remove(
-            const T& element,
-            const Rectangle& bounding_box
-        );
+        bool add(int slot_index);
+        void add_all(const std::vector<int>& slot_indices);
+        bool remove(int slot_index);
 
-        void get_elements(
+        template<typename F>
+        void for_each_element(
             const Rectangle& region,
-            std::set<T>& result
+            uint32_t visit_stamp,
+            F& function
         ) const;
 
         int get_num_elements() const;
@@ -127,8 +150,15 @@ class Quadtree {
         void merge();
         bool is_main_cell(const Rectangle& bounding_box) const;
 
+        const Rectangle& get_node_box(int slot_index) const;
+
         const Quadtree& quadtree;
-        std::vector<std::pair<T, Rectangle>> elements;
+        std::vector<int> elements;      /**< Slot indices of elements in this
+                                         * cell if it is a leaf. */
+        std::vector<Rectangle>
+            element_node_boxes;         /**< Node box of each element of
+                                         * elements, stored contiguously
+                                         * to skip slots far from queries. */
         std::array<std::unique_ptr<Node>, 4> children;
         Rectangle cell;
         Point center;
@@ -136,15 +166,41 @@ class Quadtree {
 
     };
 
-    struct ElementInfo {
-        Rectangle bounding_box;
+    /**
+     * \brief Storage of an element of the quadtree.
+     */
+    struct Slot {
+        T element;                          /**< The element or an empty value
+                                             * if the slot is free. */
+        Rectangle bounding_box;             /**< Bounding box of the element. */
+        Rectangle node_box;                 /**< Bounding box enlarged by the
+                                             * looseness, used to place the
+                                             * element in nodes. */
+        bool used;                          /**< Whether the slot is used. */
+        bool outside;                       /**< Whether the element is currently
+                                             * outside the quadtree space. */
+        mutable uint32_t visit_stamp;       /**< Stamp of the last query that
+                                             * visited this slot. */
     };
 
-    std::map<T, ElementInfo> elements;      /**< Elements in the quadtree and
-                                             * intersecting its space. */
-    std::set<T> elements_outside;           /**< Elements that were added to
-                                             * the quadtree but that are
-                                             * currently outside its space. */
+    int find_slot(const T& element) const;
+    int create_slot(const T& element, const Rectangle& bounding_box);
+    Rectangle get_node_box(const Rectangle& bounding_box) const;
+    void free_slot(int slot_index);
+    bool insert_slot(int slot_index);
+    bool erase_slot(int slot_index);
+    uint32_t get_new_visit_stamp() const;
+
+    std::vector<Slot> slots;                /**< Elements of the quadtree,
+                                             * including the ones outside its
+                                             * space. */
+    std::vector<int> free_slots;            /**< Indices of unused slots. */
+    std::unordered_map<T, int>
+        slot_indices;                       /**< Slot index of each element. */
+    int num_elements;                       /**< Number of used slots. */
+    int looseness;                          /**< Margin added around elements
+                                             * to place them in nodes. */
+    mutable uint32_t last_visit_stamp;      /**< Stamp of the last query. */
     Node root;                              /** The root node of the tree. */
 
 };
@@ -19,7 +19,6 @@
 #include "solarus/graphics/Surface.h"
 #include <algorithm>
 #include <iterator>
-#include <set>
 
 namespace Solarus {
 
@@ -40,20 +39,46 @@ Quadtree<T>::Quadtree() :
  */
 template<typename T>
 Quadtree<T>::Quadtree(const Rectangle& space) :
-    elements(),
+    slots(),
+    free_slots(),
+    slot_indices(),
+    num_elements(0),
+    looseness(0),
+    last_visit_stamp(0),
     root(*this) {
 
     initialize(space);
 }
 
+/**
+ * \brief Creates a quadtree and fills it with elements.
+ *
+ * This is faster than adding elements one by one.
+ *
+ * \param space Rectangle representing the space to create partitions of.
+ * \param elements The elements to add with their bounding box.
+ */
+template<typename T>
+Quadtree<T>::Quadtree(
+    const Rectangle& space,
+    const std::vector<std::pair<T, Rectangle>>& elements
+) :
+    Quadtree(space) {
+
+  add_all(elements);
+}
+
 /**
  * \brief Removes all elements of the quadtree.
  */
 template<typename T>
 void Quadtree<T>::clear() {
 
-  elements.clear();
-  elements_outside.clear();
+  slots.clear();
+  free_slots.clear();
+  slot_indices.clear();
+  num_elements = 0;
+  last_visit_stamp = 0;
   root.clear();
 }
 
@@ -89,6 +114,41 @@ Rectangle Quadtree<T>::get_space() const {
     return root.get_cell();
 }
 
+/**
+ * \brief Returns the margin added around elements to place them in nodes.
+ * \return The looseness in pixels (0 by default).
+ */
+template<typename T>
+int Quadtree<T>::get_looseness() const {
+  return looseness;
+}
+
+/**
+ * \brief Sets the margin added around elements to place them in nodes.
+ *
+ * Elements that move by less than this margin stay in the same nodes,
+ * at the cost of being in more nodes.
+ * Elements already in the quadtree are placed again.
+ *
+ * \param looseness The looseness in pixels.
+ */
+template<typename T>
+void Quadtree<T>::set_looseness(int looseness) {
+
+  Debug::check_assertion(looseness >= 0, "Invalid quadtree looseness");
+  if (looseness == this->looseness) {
+    return;
+  }
+
+  this->looseness = looseness;
+  for (Slot& slot : slots) {
+    if (slot.used) {
+      slot.node_box = get_node_box(slot.bounding_box);
+    }
+  }
+  rebuild();
+}
+
 /**
  * \brief Adds an element to the quadtree.
  *
@@ -107,21 +167,53 @@ bool Quadtree<T>::add(const T& element, const Rectangle& bounding_box) {
     return false;
   }
 
-  if (!bounding_box.overlaps(get_space())) {
-    // Out of the space of the quadtree.
-    elements_outside.insert(element);
-  }
-  else if (!root.add(element, bounding_box)) {
+  const int slot_index = create_slot(element, bounding_box);
+  if (!insert_slot(slot_index)) {
     // Add failed.
+    free_slot(slot_index);
     return false;
   }
 
-  ElementInfo info = { bounding_box };
-  elements.emplace(element, info);
-
   return true;
 }
 
+/**
+ * \brief Adds many elements to the quadtree at once.
+ *
+ * This is faster than adding them one by one: memory is reserved once and
+ * each node is split at most once, before distributing all its elements.
+ * Elements already in the quadtree are ignored.
+ *
+ * \param elements The elements to add with their bounding box.
+ * \return The number of elements added.
+ */
+template<typename T>
+int Quadtree<T>::add_all(const std::vector<std::pair<T, Rectangle>>& elements) {
+
+  slots.reserve(slots.size() + elements.size());
+  slot_indices.reserve(slot_indices.size() + elements.size());
+
+  std::vector<int> inside_slots;
+  inside_slots.reserve(elements.size());
+  int num_added = 0;
+  for (const std::pair<T, Rectangle>& element: elements) {
+    if (contains(element.first)) {
+      continue;
+    }
+    const int slot_index = create_slot(element.first, element.second);
+    ++num_added;
+    if (!slots[slot_index].node_box.overlaps(get_space())) {
+      // Out of the space of the quadtree.
+      slots[slot_index].outside = true;
+      continue;
+    }
+    inside_slots.push_back(slot_index);
+  }
+
+  root.add_all(inside_slots);
+  return num_added;
+}
+
 /**
  * \brief Removes an element from the quadtree.
  * \param element The element to remove.
@@ -130,21 +222,15 @@ bool Quadtree<T>::add(const T& element, const Rectangle& bounding_box) {
 template<typename T>
 bool Quadtree<T>::remove(const T& element) {
 
-  const auto& it = elements.find(element);
-  if (it == elements.end()) {
+  const int slot_index = find_slot(element);
+  if (slot_index == -1) {
     // Unknown element.
     return false;
   }
 
-  Rectangle box = it->second.bounding_box;
-  elements.erase(element);
-  if (elements_outside.erase(element) > 0) {
-    // It was outside the quadtree space.
-    return true;
-  }
-
-  // Normal case.
-  return root.remove(element, box);
+  const bool success = erase_slot(slot_index);
+  free_slot(slot_index);
+  return success;
 }
 
 /**
@@ -164,30 +250,67 @@ bool Quadtree<T>::remove(const T& element) {
 template<typename T>
 bool Quadtree<T>::move(const T& element, const Rectangle& bounding_box) {
 
-  const auto& it = elements.find(element);
-  if (it == elements.end()) {
+  const int slot_index = find_slot(element);
+  if (slot_index == -1) {
     // Not in the quadtree: error.
     return false;
   }
-  else {
-    if (it->second.bounding_box == bounding_box) {
-      // Already in the quadtree and no change.
-      return true;
-    }
 
-    if (!remove(element)) {
-      // Failed to remove.
-      return false;
-    }
+  Slot& slot = slots[slot_index];
+  if (slot.bounding_box == bounding_box) {
+    // Already in the quadtree and no change.
+    return true;
   }
 
-  if (!add(element, bounding_box)) {
+  if (slot.node_box.contains(bounding_box) && !slot.outside) {
+    // Still in the enlarged box: the nodes don't change.
+    slot.bounding_box = bounding_box;
+    return true;
+  }
+
+  // Keep the same slot: only the nodes change.
+  if (!erase_slot(slot_index)) {
+    // Failed to remove.
+    free_slot(slot_index);
+    return false;
+  }
+
+  slot.bounding_box = bounding_box;
+  slot.node_box = get_node_box(bounding_box);
+  if (!insert_slot(slot_index)) {
     // Failed to add.
+    free_slot(slot_index);
     return false;
   }
   return true;
 }
 
+/**
+ * \brief Rebuilds the nodes of the quadtree from its elements.
+ *
+ * Nodes are otherwise only split and merged when elements come and go,
+ * so after many moves the tree may no longer fit their positions.
+ */
+template<typename T>
+void Quadtree<T>::rebuild() {
+
+  root.initialize(root.get_cell());
+
+  std::vector<int> inside_slots;
+  inside_slots.reserve(num_elements);
+  for (size_t i = 0; i < slots.size(); ++i) {
+    Slot& slot = slots[i];
+    if (!slot.used) {
+      continue;
+    }
+    slot.outside = !slot.node_box.overlaps(get_space());
+    if (!slot.outside) {
+      inside_slots.push_back(static_cast<int>(i));
+    }
+  }
+  root.add_all(inside_slots);
+}
+
 /**
  * \brief Returns the total number of elements in the quadtree.
  * \return The number of elements, including elements outside the quadtree
@@ -195,7 +318,7 @@ bool Quadtree<T>::move(const T& element, const Rectangle& bounding_box) {
  */
 template<typename T>
 int Quadtree<T>::get_num_elements() const {
-  return root.get_num_elements() + elements_outside.size();
+  return num_elements;
 }
 
 /**
@@ -209,9 +332,53 @@ template<typename T>
 std::vector<T> Quadtree<T>::get_elements(
     const Rectangle& region
 ) const {
-  std::set<T> element_set;
-  root.get_elements(region, element_set);
-  return std::vector<T>(element_set.begin(), element_set.end());
+  std::vector<T> result;
+  get_elements(region, result);
+  return result;
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle into an
+ * existing vector.
+ *
+ * Reusing the same vector for several queries avoids memory allocations.
+ *
+ * \param[in] region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * \param[in,out] result Vector where to append the elements intersecting the
+ * rectangle, in arbitrary order.
+ * Elements outside the quadtree space are not added there.
+ */
+template<typename T>
+void Quadtree<T>::get_elements(
+    const Rectangle& region,
+    std::vector<T>& result
+) const {
+  for_each_element(region, [&result](const T& element) {
+    result.push_back(element);
+  });
+}
+
+/**
+ * \brief Calls a function on each element intersecting the given rectangle.
+ *
+ * Unlike get_elements(), this does not copy elements,
+ * which matters when they are smart pointers.
+ * The function must not modify or query the quadtree.
+ *
+ * \param region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * \param function Function to call with each element as a const reference,
+ * in arbitrary order.
+ * Elements outside the quadtree space are not visited.
+ */
+template<typename T>
+template<typename F>
+void Quadtree<T>::for_each_element(
+    const Rectangle& region,
+    F function
+) const {
+  root.for_each_element(region, get_new_visit_stamp(), function);
 }
 
 /**
@@ -223,8 +390,162 @@ std::vector<T> Quadtree<T>::get_elements(
 template<typename T>
 bool Quadtree<T>::contains(const T& element) const {
 
-  const auto& it = elements.find(element);
-  return it != elements.end();
+  return find_slot(element) != -1;
+}
+
+/**
+ * \brief Returns the slot of an element.
+ * \param element The element to find.
+ * \return Index of its slot, or -1 if it is not in the quadtree.
+ */
+template<typename T>
+int Quadtree<T>::find_slot(const T& element) const {
+
+  const auto& it = slot_indices.find(element);
+  if (it == slot_indices.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+/**
+ * \brief Stores a new element in a slot, without adding it to nodes.
+ *
+ * Free slots are reused if any.
+ *
+ * \param element The element to store.
+ * \param bounding_box Bounding box of the element.
+ * \return Index of the slot.
+ */
+template<typename T>
+int Quadtree<T>::create_slot(const T& element, const Rectangle& bounding_box) {
+
+  int slot_index = 0;
+  if (!free_slots.empty()) {
+    slot_index = free_slots.back();
+    free_slots.pop_back();
+  }
+  else {
+    slot_index = static_cast<int>(slots.size());
+    slots.emplace_back();
+  }
+
+  Slot& slot = slots[slot_index];
+  slot.element = element;
+  slot.bounding_box = bounding_box;
+  slot.node_box = get_node_box(bounding_box);
+  slot.used = true;
+  slot.outside = false;
+  slot.visit_stamp = 0;
+
+  slot_indices.emplace(element, slot_index);
+  ++num_elements;
+  return slot_index;
+}
+
+/**
+ * \brief Returns the box used to place an element in nodes.
+ * \param bounding_box Bounding box of the element.
+ * \return The bounding box enlarged by the looseness.
+ */
+template<typename T>
+Rectangle Quadtree<T>::get_node_box(const Rectangle& bounding_box) const {
+
+  if (looseness == 0) {
+    return bounding_box;
+  }
+  return Rectangle(
+      bounding_box.get_x() - looseness,
+      bounding_box.get_y() - looseness,
+      bounding_box.get_width() + 2 * looseness,
+      bounding_box.get_height() + 2 * looseness
+  );
+}
+
+/**
+ * \brief Releases a slot previously returned by create_slot().
+ *
+ * The element must already be removed from nodes.
+ *
+ * \param slot_index Index of the slot to release.
+ */
+template<typename T>
+void Quadtree<T>::free_slot(int slot_index) {
+
+  Slot& slot = slots[slot_index];
+  Debug::check_assertion(slot.used, "Quadtree slot already free");
+
+  slot_indices.erase(slot.element);
+  slot.element = T();
+  slot.used = false;
+  slot.outside = false;
+  free_slots.push_back(slot_index);
+  --num_elements;
+}
+
+/**
+ * \brief Adds the element of a slot to the nodes it overlaps.
+ *
+ * If the element is outside the quadtree space, it is only marked as such.
+ *
+ * \param slot_index Index of the slot to insert.
+ * \return \c true in case of success.
+ */
+template<typename T>
+bool Quadtree<T>::insert_slot(int slot_index) {
+
+  Slot& slot = slots[slot_index];
+  if (!slot.node_box.overlaps(get_space())) {
+    // Out of the space of the quadtree.
+    slot.outside = true;
+    return true;
+  }
+
+  slot.outside = false;
+  return root.add(slot_index);
+}
+
+/**
+ * \brief Removes the element of a slot from the nodes it overlaps.
+ *
+ * The slot itself is not released.
+ *
+ * \param slot_index Index of the slot to erase.
+ * \return \c true in case of success.
+ */
+template<typename T>
+bool Quadtree<T>::erase_slot(int slot_index) {
+
+  Slot& slot = slots[slot_index];
+  if (slot.outside) {
+    // It was outside the quadtree space.
+    slot.outside = false;
+    return true;
+  }
+
+  // Normal case.
+  return root.remove(slot_index);
+}
+
+/**
+ * \brief Returns a new stamp to mark slots visited by a traversal.
+ *
+ * When the stamp counter wraps around, all slots are reset.
+ *
+ * \return A stamp different from all stamps currently stored in slots.
+ */
+template<typename T>
+uint32_t Quadtree<T>::get_new_visit_stamp() const {
+
+  ++last_visit_stamp;
+  if (last_visit_stamp == 0) {
+    // Overflow: slots may have any old stamp.
+    for (const Slot& slot : slots) {
+      slot.visit_stamp = 0;
+    }
+    last_visit_stamp = 1;
+  }
+  return last_visit_stamp;
 }
 
 /**
@@ -260,6 +581,7 @@ template<typename T>
 Quadtree<T>::Node::Node(const Quadtree& quadtree, const Rectangle& cell) :
     quadtree(quadtree),
     elements(),
+    element_node_boxes(),
     children(),
     cell(cell),
     center(cell.get_center()),
@@ -270,6 +592,16 @@ Quadtree<T>::Node::Node(const Quadtree& quadtree, const Rectangle& cell) :
   if (debug_quadtrees) {
     color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
   }
+  MemoryStats::add(MemoryStats::Category::QUADTREE_NODES, sizeof(Node));
+}
+
+/**
+ * \brief Destroys this node and its children.
+ */
+template<typename T>
+Quadtree<T>::Node::~Node() {
+
+  MemoryStats::remove(MemoryStats::Category::QUADTREE_NODES, sizeof(Node));
 }
 
 /**
@@ -281,6 +613,7 @@ template<typename T>
 void Quadtree<T>::Node::clear() {
 
   elements.clear();
+  element_node_boxes.clear();
   std::fill(std::begin(children), std::end(children), nullptr);
 }
 
@@ -294,6 +627,7 @@ void Quadtree<T>::Node::initialize(const Rectangle& cell) {
   clear();
   this->cell = cell;
   elements.reserve(max_in_cell);
+  element_node_boxes.reserve(max_in_cell);
 }
 
 /**
@@ -314,20 +648,28 @@ Size Quadtree<T>::Node::get_cell_size() const {
     return get_cell().get_size();
 }
 
+/**
+ * \brief Returns the box used to place an element stored in the quadtree.
+ * \param slot_index Slot index of the element.
+ * \return Its bounding box enlarged by the looseness.
+ */
+template<typename T>
+const Rectangle& Quadtree<T>::Node::get_node_box(int slot_index) const {
+  return quadtree.slots[slot_index].node_box;
+}
+
 /**
  * \brief Adds an element to this node if its bounding box intersects it.
  *
  * Splits the node if necessary when the threshold is exceeded.
  *
- * \param element The element to add.
- * \param bounding_box Bounding box of the element.
+ * \param slot_index Slot index of the element to add.
  * \return \c true in case of success.
  */
 template<typename T>
-bool Quadtree<T>::Node::add(
-    const T& element,
-    const Rectangle& bounding_box
-) {
+bool Quadtree<T>::Node::add(int slot_index) {
+
+  const Rectangle& bounding_box = get_node_box(slot_index);
   if (!get_cell().overlaps(bounding_box)) {
     // Nothing to do.
     return false;
@@ -348,51 +690,107 @@ bool Quadtree<T>::Node::add(
 
   if (!is_split()) {
     // Add it to the current node.
-    elements.emplace_back(element, bounding_box);
+    elements.push_back(slot_index);
+    element_node_boxes.push_back(quadtree.slots[slot_index].node_box);
     return true;
   }
 
   // Add it to children cells.
   for (const std::unique_ptr<Node>& child : children) {
-    child->add(element, bounding_box);
+    child->add(slot_index);
   }
   return true;
 }
 
+/**
+ * \brief Adds elements to this node or to its children.
+ *
+ * The node is split first if it would contain too many elements.
+ *
+ * \param slot_indices Slots of the elements to add.
+ * They must all overlap this cell.
+ */
+template<typename T>
+void Quadtree<T>::Node::add_all(const std::vector<int>& slot_indices) {
+
+  if (slot_indices.empty()) {
+    return;
+  }
+
+  if (!is_split()) {
+    int num_new_main_elements = 0;
+    for (int slot_index : slot_indices) {
+      if (is_main_cell(get_node_box(slot_index))) {
+        ++num_new_main_elements;
+      }
+    }
+
+    if (num_new_main_elements == 0 ||
+        get_num_elements() + num_new_main_elements <= max_in_cell ||
+        get_cell_size().width <= min_cell_size ||
+        get_cell_size().height <= min_cell_size) {
+      // Everything fits in the current node.
+      for (int slot_index : slot_indices) {
+        elements.push_back(slot_index);
+        element_node_boxes.push_back(quadtree.slots[slot_index].node_box);
+      }
+      return;
+    }
+    split();
+  }
+
+  // Distribute them to children cells.
+  std::vector<int> child_slot_indices;
+  child_slot_indices.reserve(slot_indices.size());
+  for (const std::unique_ptr<Node>& child : children) {
+    child_slot_indices.clear();
+    for (int slot_index : slot_indices) {
+      if (child->get_cell().overlaps(get_node_box(slot_index))) {
+        child_slot_indices.push_back(slot_index);
+      }
+    }
+    child->add_all(child_slot_indices);
+  }
+}
+
 /**
  * \brief Removes an element from this node if its bounding box intersects it.
  *
  * Merges nodes when necessary.
  *
- * \param element The element to remove.
- * \param bounding_box Bounding box of the element.
+ * The bounding box stored in the slot must be the one used when adding it.
+ *
+ * \param slot_index Slot index of the element to remove.
  * \return \c true in the element was found and removed.
  */
 template<typename T>
-bool Quadtree<T>::Node::remove(
-    const T& element,
-    const Rectangle& bounding_box
-) {
-  if (!get_cell().overlaps(bounding_box)) {
+bool Quadtree<T>::Node::remove(int slot_index) {
+
+  if (!get_cell().overlaps(get_node_box(slot_index))) {
     // Nothing to do.
     return false;
   }
 
   if (!is_split()) {
     // Remove from this cell.
-    const auto& it = std::find(elements.begin(), elements.end(), std::make_pair(element, bounding_box));
+    // The order of elements in a cell does not matter.
+    const auto& it = std::find(elements.begin(), elements.end(), slot_index);
     if (it == elements.end()) {
       // The element was not here.
       return false;
     }
-    elements.erase(it);
+    const size_t index = it - elements.begin();
+    elements[index] = elements.back();
+    elements.pop_back();
+    element_node_boxes[index] = element_node_boxes.back();
+    element_node_boxes.pop_back();
     return true;
   }
 
   // Remove from children cells.
   bool removed = false;
   for (const std::unique_ptr<Node>& child : children) {
-    removed |= child->remove(element, bounding_box);
+    removed |= child->remove(slot_index);
   }
 
   if (removed &&
@@ -442,12 +840,13 @@ void Quadtree<T>::Node::split() {
   );
 
   // Move existing elements into them.
-  for (const std::pair<T, Rectangle>& pair : elements) {
+  for (int slot_index : elements) {
     for (const std::unique_ptr<Node>& child : children) {
-      child->add(pair.first, pair.second);
+      child->add(slot_index);
     }
   }
   elements.clear();
+  element_node_boxes.clear();
 
   Debug::check_assertion(is_split(), "Quadtree node split failed");
 }
@@ -463,13 +862,15 @@ void Quadtree<T>::Node::merge() {
   Debug::check_assertion(is_split(), "Quadtree node already merged");
 
   // We want to avoid duplicates while preserving a deterministic order.
-  std::set<T> merged_elements;
+  const uint32_t visit_stamp = quadtree.get_new_visit_stamp();
   for (const std::unique_ptr<Node>& child : children) {
     Debug::check_assertion(!child->is_split(), "Quadtree node child is not a leaf");
-    for (const std::pair<T, Rectangle>& pair : child->elements) {
-      const T& element = pair.first;
-      if (merged_elements.insert(element).second) {
-        elements.push_back(pair);
+    for (int slot_index : child->elements) {
+      const Slot& slot = quadtree.slots[slot_index];
+      if (slot.visit_stamp != visit_stamp) {
+        slot.visit_stamp = visit_stamp;
+        elements.push_back(slot_index);
+        element_node_boxes.push_back(slot.node_box);
       }
     }
   }
@@ -521,9 +922,8 @@ int Quadtree<T>::Node::get_num_elements() const {
     // Some elements can overlap several cells.
     // To avoid duplicates, we count an element if this cell is its main cell.
     // TODO This information could be stored for better performance.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& box = pair.second;
-      if (is_main_cell(box)) {
+    for (int slot_index : elements) {
+      if (is_main_cell(get_node_box(slot_index))) {
         ++num_elements;
       }
     }
@@ -538,14 +938,19 @@ int Quadtree<T>::Node::get_num_elements() const {
 }
 
 /**
- * \brief Gets the elements intersecting the given rectangle under this node.
- * \param[in] region The rectangle to check.
- * \param[in/out] result A list that will be filled with elements.
+ * \brief Calls a function on the elements intersecting the given rectangle
+ * under this node.
+ * \param region The rectangle to check.
+ * \param visit_stamp Stamp of the current query, used to skip elements
+ * already visited from another cell.
+ * \param function The function to call with each element.
  */
 template<typename T>
-void Quadtree<T>::Node::get_elements(
+template<typename F>
+void Quadtree<T>::Node::for_each_element(
     const Rectangle& region,
-    std::set<T>& result
+    uint32_t visit_stamp,
+    F& function
 ) const {
 
   if (!get_cell().overlaps(region)) {
@@ -554,16 +959,23 @@ void Quadtree<T>::Node::get_elements(
   }
 
   if (!is_split()) {
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      if (pair.second.overlaps(region)) {
-        result.insert(pair.first);
+    // Only read the slots of elements whose node box overlaps the region.
+    for (size_t i = 0; i < element_node_boxes.size(); ++i) {
+      if (!element_node_boxes[i].overlaps(region)) {
+        continue;
+      }
+      const Slot& slot = quadtree.slots[elements[i]];
+      if (slot.visit_stamp != visit_stamp &&
+          slot.bounding_box.overlaps(region)) {
+        slot.visit_stamp = visit_stamp;
+        function(slot.element);
       }
     }
   }
   else {
     // Get from from children cells.
     for (const std::unique_ptr<Node>& child : children) {
-      child->get_elements(region, result);
+      child->for_each_element(region, visit_stamp, function);
     }
   }
 }
@@ -581,8 +993,8 @@ void Quadtree<T>::Node::draw(const SurfacePtr& dst_surface, const Point& dst_pos
     draw_rectangle(get_cell(), color, dst_surface, dst_position);
 
     // Draw bounding boxes of elements.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& bounding_box = pair.second;
+    for (int slot_index : elements) {
+      const Rectangle& bounding_box = get_node_box(slot_index);
       if (is_main_cell(bounding_box)) {
         draw_rectangle(bounding_box, color, dst_surface, dst_position);
       }
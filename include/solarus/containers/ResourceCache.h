@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_RESOURCE_CACHE_H
+#define SOLARUS_RESOURCE_CACHE_H
+
+#include "solarus/core/Common.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Counters of accesses to a resource cache.
+ */
+struct ResourceCacheStatistics {
+  uint64_t hits = 0;           /**< Requests satisfied by the cache. */
+  uint64_t misses = 0;         /**< Requests that had to load the element. */
+  uint64_t evictions = 0;      /**< Elements removed to respect the memory budget. */
+  size_t num_elements = 0;     /**< Elements currently in the cache. */
+  size_t memory_size = 0;      /**< Estimated memory used by these elements in bytes. */
+};
+
+/**
+ * \brief Keeps loaded elements of one type by id, with their
+ * estimated memory size and the date of their last use.
+ *
+ * Elements are shared pointers. An element that is still referenced
+ * outside the cache is in use and is never evicted:
+ * evicting it would not free anything anyway.
+ *
+ * Dates come from a clock shared by the caller between several caches,
+ * so that the least recently used element can be found among all of them.
+ *
+ * Elements are hashed by id: an access does not compare long ids
+ * along a tree. Only rare operations like remove_prefix() visit all elements.
+ */
+template<typename T>
+class ResourceCache {
+
+  public:
+
+    using ElementPtr = std::shared_ptr<T>;
+
+    ResourceCache();
+
+    ElementPtr get(const std::string& id, uint64_t now);
+    bool contains(const std::string& id) const;
+    ElementPtr peek(const std::string& id) const;
+    std::vector<ElementPtr> get_elements() const;
+    void add(const std::string& id, const ElementPtr& element, size_t memory_size, uint64_t now);
+    bool remove(const std::string& id);
+    void remove_prefix(const std::string& prefix);
+    void clear();
+
+    size_t get_memory_size() const;
+    ResourceCacheStatistics get_statistics() const;
+
+    bool get_least_recently_used(uint64_t& last_use) const;
+    void evict_least_recently_used();
+
+  private:
+
+    /**
+     * \brief An element and its bookkeeping.
+     */
+    struct Entry {
+      ElementPtr element;           /**< The cached element. */
+      size_t memory_size;           /**< Estimated memory size in bytes. */
+      uint64_t last_use;            /**< Date of the last access. */
+    };
+
+    using EntryMap = std::unordered_map<std::string, Entry>;
+
+    typename EntryMap::const_iterator find_least_recently_used() const;
+
+    EntryMap entries;               /**< Cached elements by id. */
+    size_t memory_size;             /**< Sum of the memory size of entries. */
+    ResourceCacheStatistics
+        statistics;                 /**< Access counters. */
+
+};
+
+}
+
+#include "solarus/containers/ResourceCache.inl"
+
+#endif
+
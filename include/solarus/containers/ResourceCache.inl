@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+
+/**
+ * \brief Creates an empty cache.
+ */
+template<typename T>
+ResourceCache<T>::ResourceCache():
+  entries(),
+  memory_size(0),
+  statistics() {
+
+}
+
+/**
+ * \brief Returns an element of the cache and marks it as used.
+ *
+ * Counts a hit or a miss.
+ *
+ * \param id Id of the element.
+ * \param now Current date of the clock shared between caches.
+ * \return The element, or nullptr if it is not in the cache.
+ */
+template<typename T>
+typename ResourceCache<T>::ElementPtr ResourceCache<T>::get(
+    const std::string& id, uint64_t now) {
+
+  const auto& it = entries.find(id);
+  if (it == entries.end()) {
+    ++statistics.misses;
+    return nullptr;
+  }
+
+  ++statistics.hits;
+  it->second.last_use = now;
+  return it->second.element;
+}
+
+/**
+ * \brief Returns whether an element is in the cache.
+ *
+ * This does not count as an access.
+ *
+ * \param id Id of the element.
+ * \return \c true if it is cached.
+ */
+template<typename T>
+bool ResourceCache<T>::contains(const std::string& id) const {
+  return entries.find(id) != entries.end();
+}
+
+/**
+ * \brief Returns an element of the cache without marking it as used.
+ *
+ * No hit or miss is counted.
+ *
+ * \param id Id of the element.
+ * \return The element, or nullptr if it is not in the cache.
+ */
+template<typename T>
+typename ResourceCache<T>::ElementPtr ResourceCache<T>::peek(const std::string& id) const {
+
+  const auto& it = entries.find(id);
+  if (it == entries.end()) {
+    return nullptr;
+  }
+  return it->second.element;
+}
+
+/**
+ * \brief Returns all elements of the cache without marking them as used.
+ * \return The elements, sorted by id.
+ */
+template<typename T>
+std::vector<typename ResourceCache<T>::ElementPtr> ResourceCache<T>::get_elements() const {
+
+  std::vector<const typename EntryMap::value_type*> sorted_entries;
+  sorted_entries.reserve(entries.size());
+  for (const auto& kvp: entries) {
+    sorted_entries.push_back(&kvp);
+  }
+  std::sort(sorted_entries.begin(), sorted_entries.end(), [](
+      const typename EntryMap::value_type* first,
+      const typename EntryMap::value_type* second
+  ) {
+    return first->first < second->first;
+  });
+
+  std::vector<ElementPtr> elements;
+  elements.reserve(sorted_entries.size());
+  for (const auto* entry: sorted_entries) {
+    elements.push_back(entry->second.element);
+  }
+  return elements;
+}
+
+/**
+ * \brief Adds or replaces an element.
+ * \param id Id of the element.
+ * \param element The element to store.
+ * \param memory_size Estimated memory size of the element in bytes.
+ * \param now Current date of the clock shared between caches.
+ */
+template<typename T>
+void ResourceCache<T>::add(
+    const std::string& id,
+    const ElementPtr& element,
+    size_t memory_size,
+    uint64_t now) {
+
+  remove(id);
+  entries.emplace(id, Entry{ element, memory_size, now });
+  this->memory_size += memory_size;
+}
+
+/**
+ * \brief Removes an element from the cache.
+ *
+ * The element itself is only destroyed when nobody else uses it.
+ *
+ * \param id Id of the element.
+ * \return \c true if there was such an element.
+ */
+template<typename T>
+bool ResourceCache<T>::remove(const std::string& id) {
+
+  const auto& it = entries.find(id);
+  if (it == entries.end()) {
+    return false;
+  }
+
+  memory_size -= it->second.memory_size;
+  entries.erase(it);
+  return true;
+}
+
+/**
+ * \brief Removes all elements whose id starts with the given prefix.
+ * \param prefix Prefix of ids to remove.
+ */
+template<typename T>
+void ResourceCache<T>::remove_prefix(const std::string& prefix) {
+
+  auto it = entries.begin();
+  while (it != entries.end()) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      memory_size -= it->second.memory_size;
+      it = entries.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * \brief Removes all elements.
+ */
+template<typename T>
+void ResourceCache<T>::clear() {
+
+  entries.clear();
+  memory_size = 0;
+}
+
+/**
+ * \brief Returns the estimated memory used by the elements of the cache.
+ * \return The memory size in bytes.
+ */
+template<typename T>
+size_t ResourceCache<T>::get_memory_size() const {
+  return memory_size;
+}
+
+/**
+ * \brief Returns the access counters and the current size of the cache.
+ * \return The statistics.
+ */
+template<typename T>
+ResourceCacheStatistics ResourceCache<T>::get_statistics() const {
+
+  ResourceCacheStatistics result = statistics;
+  result.num_elements = entries.size();
+  result.memory_size = memory_size;
+  return result;
+}
+
+/**
+ * \brief Returns the date of last use of the oldest element that can be evicted.
+ * \param[out] last_use The date found.
+ * \return \c false if no element can be evicted.
+ */
+template<typename T>
+bool ResourceCache<T>::get_least_recently_used(uint64_t& last_use) const {
+
+  const auto& it = find_least_recently_used();
+  if (it == entries.end()) {
+    return false;
+  }
+  last_use = it->second.last_use;
+  return true;
+}
+
+/**
+ * \brief Removes the oldest element that can be evicted, if any.
+ */
+template<typename T>
+void ResourceCache<T>::evict_least_recently_used() {
+
+  const auto& it = find_least_recently_used();
+  if (it == entries.end()) {
+    return;
+  }
+  memory_size -= it->second.memory_size;
+  entries.erase(it);
+  ++statistics.evictions;
+}
+
+/**
+ * \brief Finds the oldest element not used outside the cache.
+ * \return An iterator to this element or the end iterator.
+ */
+template<typename T>
+typename ResourceCache<T>::EntryMap::const_iterator
+ResourceCache<T>::find_least_recently_used() const {
+
+  auto result = entries.end();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->second.element.use_count() > 1) {
+      continue;
+    }
+    if (result == entries.end() || it->second.last_use < result->second.last_use) {
+      result = it;
+    }
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SPATIAL_HASH_H
+#define SOLARUS_SPATIAL_HASH_H
+
+#include "solarus/core/Common.h"
+#include "solarus/containers/Grid.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A collection of objects spatially located in a uniform grid.
+ *
+ * This is an alternative to Quadtree for spaces densely filled with objects
+ * of similar sizes. There is no tree to traverse: a query only visits the
+ * cells it overlaps, and moving an object that stays in the same cells
+ * only updates its bounding box.
+ *
+ * The cell size should be close to the usual size of objects.
+ * Big objects are stored in many cells, which makes them expensive.
+ *
+ * \param T Type of objects. It must be hashable with std::hash.
+ */
+template <typename T>
+class SpatialHash {
+
+  public:
+
+    SpatialHash(const Rectangle& space, const Size& cell_size);
+
+    void clear();
+
+    Rectangle get_space() const;
+    Size get_cell_size() const;
+
+    bool add(const T& element, const Rectangle& bounding_box);
+    int add_all(const std::vector<std::pair<T, Rectangle>>& elements);
+    bool remove(const T& element);
+    bool move(const T& element, const Rectangle& bounding_box);
+
+    std::vector<T> get_elements(
+        const Rectangle& where
+    ) const;
+    void get_elements(
+        const Rectangle& where,
+        std::vector<T>& result
+    ) const;
+    template<typename F>
+    void for_each_element(
+        const Rectangle& where,
+        F function
+    ) const;
+
+    int get_num_elements() const;
+    bool contains(const T& element) const;
+
+  private:
+
+    /**
+     * \brief Storage of an element of the spatial hash.
+     */
+    struct Slot {
+        T element;                          /**< The element or an empty value
+                                             * if the slot is free. */
+        Rectangle bounding_box;             /**< Bounding box of the element. */
+        Rectangle cells;                    /**< Cells overlapped by the element
+                                             * in the grid. */
+        bool used;                          /**< Whether the slot is used. */
+    };
+
+    int find_slot(const T& element) const;
+    Rectangle get_grid_box(const Rectangle& bounding_box) const;
+
+    Rectangle space;                        /**< The space covered by the grid. */
+    Grid<int> grid;                         /**< Slot indices of elements in
+                                             * each cell. */
+    std::vector<Slot> slots;                /**< Elements of the spatial hash,
+                                             * including the ones outside its
+                                             * space. */
+    std::vector<int> free_slots;            /**< Indices of unused slots. */
+    std::unordered_map<T, int>
+        slot_indices;                       /**< Slot index of each element. */
+    int num_elements;                       /**< Number of used slots. */
+
+};
+
+}
+
+#include "solarus/containers/SpatialHash.inl"
+
+#endif
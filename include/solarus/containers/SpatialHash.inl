@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+
+/**
+ * \brief Creates an empty spatial hash.
+ * \param space Rectangle representing the space to divide in cells.
+ * \param cell_size Size of a cell of the grid.
+ */
+template<typename T>
+SpatialHash<T>::SpatialHash(const Rectangle& space, const Size& cell_size) :
+    space(space),
+    grid(space.get_size(), cell_size),
+    slots(),
+    free_slots(),
+    slot_indices(),
+    num_elements(0) {
+
+}
+
+/**
+ * \brief Removes all elements of the spatial hash.
+ */
+template<typename T>
+void SpatialHash<T>::clear() {
+
+  grid.clear();
+  slots.clear();
+  free_slots.clear();
+  slot_indices.clear();
+  num_elements = 0;
+}
+
+/**
+ * \brief Returns the space covered by the grid.
+ * \return The space.
+ */
+template<typename T>
+Rectangle SpatialHash<T>::get_space() const {
+  return space;
+}
+
+/**
+ * \brief Returns the size of the cells of the grid.
+ * \return The cell size.
+ */
+template<typename T>
+Size SpatialHash<T>::get_cell_size() const {
+  return grid.get_cell_size();
+}
+
+/**
+ * \brief Adds an element to the spatial hash.
+ *
+ * It is allowed to add it outside the space: it is then stored but never
+ * returned by queries until it comes back.
+ *
+ * \param element The element to add.
+ * \param bounding_box Bounding box of the element.
+ * \return \c true in case of success, \c false if the element is already
+ * there.
+ */
+template<typename T>
+bool SpatialHash<T>::add(const T& element, const Rectangle& bounding_box) {
+
+  if (contains(element)) {
+    return false;
+  }
+
+  int slot_index = 0;
+  if (!free_slots.empty()) {
+    slot_index = free_slots.back();
+    free_slots.pop_back();
+  }
+  else {
+    slot_index = static_cast<int>(slots.size());
+    slots.emplace_back();
+  }
+
+  Slot& slot = slots[slot_index];
+  const Rectangle& grid_box = get_grid_box(bounding_box);
+  slot.element = element;
+  slot.bounding_box = bounding_box;
+  slot.cells = grid.get_cells(grid_box);
+  slot.used = true;
+  slot_indices.emplace(element, slot_index);
+  ++num_elements;
+
+  grid.add(slot_index, grid_box);
+  return true;
+}
+
+/**
+ * \brief Adds several elements to the spatial hash.
+ *
+ * Elements already in the spatial hash are ignored.
+ *
+ * \param elements The elements to add with their bounding box.
+ * \return The number of elements added.
+ */
+template<typename T>
+int SpatialHash<T>::add_all(const std::vector<std::pair<T, Rectangle>>& elements) {
+
+  slots.reserve(slots.size() + elements.size());
+  slot_indices.reserve(slot_indices.size() + elements.size());
+
+  int num_added = 0;
+  for (const std::pair<T, Rectangle>& element : elements) {
+    if (add(element.first, element.second)) {
+      ++num_added;
+    }
+  }
+  return num_added;
+}
+
+/**
+ * \brief Removes an element from the spatial hash.
+ * \param element The element to remove.
+ * \return \c true in case of success, \c false if it was not there.
+ */
+template<typename T>
+bool SpatialHash<T>::remove(const T& element) {
+
+  const int slot_index = find_slot(element);
+  if (slot_index == -1) {
+    return false;
+  }
+
+  Slot& slot = slots[slot_index];
+  grid.remove(slot_index, get_grid_box(slot.bounding_box));
+  slot_indices.erase(slot.element);
+  slot.element = T();
+  slot.used = false;
+  free_slots.push_back(slot_index);
+  --num_elements;
+  return true;
+}
+
+/**
+ * \brief Changes the bounding box of an element.
+ *
+ * This is cheap if the element stays in the same cells.
+ *
+ * \param element The element to move.
+ * \param bounding_box Its new bounding box.
+ * \return \c true in case of success, \c false if it is not there.
+ */
+template<typename T>
+bool SpatialHash<T>::move(const T& element, const Rectangle& bounding_box) {
+
+  const int slot_index = find_slot(element);
+  if (slot_index == -1) {
+    return false;
+  }
+
+  Slot& slot = slots[slot_index];
+  const Rectangle& grid_box = get_grid_box(bounding_box);
+  const Rectangle& cells = grid.get_cells(grid_box);
+  if (cells != slot.cells) {
+    grid.remove(slot_index, get_grid_box(slot.bounding_box));
+    grid.add(slot_index, grid_box);
+    slot.cells = cells;
+  }
+  slot.bounding_box = bounding_box;
+  return true;
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle.
+ * \param region The rectangle to check.
+ * \return A list of elements intersecting the rectangle, in arbitrary order.
+ */
+template<typename T>
+std::vector<T> SpatialHash<T>::get_elements(
+    const Rectangle& region
+) const {
+  std::vector<T> result;
+  get_elements(region, result);
+  return result;
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle into an
+ * existing vector.
+ * \param[in] region The rectangle to check.
+ * \param[in,out] result Vector where to append the elements intersecting the
+ * rectangle, in arbitrary order.
+ */
+template<typename T>
+void SpatialHash<T>::get_elements(
+    const Rectangle& region,
+    std::vector<T>& result
+) const {
+  for_each_element(region, [&result](const T& element) {
+    result.push_back(element);
+  });
+}
+
+/**
+ * \brief Calls a function on each element intersecting the given rectangle.
+ *
+ * The function must not modify or query the spatial hash.
+ *
+ * \param region The rectangle to check.
+ * \param function Function to call with each element as a const reference,
+ * in arbitrary order.
+ */
+template<typename T>
+template<typename F>
+void SpatialHash<T>::for_each_element(
+    const Rectangle& region,
+    F function
+) const {
+
+  grid.for_each_element(get_grid_box(region), [&](int slot_index) {
+    const Slot& slot = slots[slot_index];
+    if (slot.bounding_box.overlaps(region)) {
+      function(slot.element);
+    }
+  });
+}
+
+/**
+ * \brief Returns the total number of elements in the spatial hash.
+ * \return The number of elements, including elements outside the space.
+ */
+template<typename T>
+int SpatialHash<T>::get_num_elements() const {
+  return num_elements;
+}
+
+/**
+ * \brief Returns whether an element is in the spatial hash.
+ * \param element The element to check.
+ * \return \c true if it is there, even if it is outside the space.
+ */
+template<typename T>
+bool SpatialHash<T>::contains(const T& element) const {
+  return find_slot(element) != -1;
+}
+
+/**
+ * \brief Returns the slot of an element.
+ * \param element The element to find.
+ * \return Index of its slot, or -1 if it is not in the spatial hash.
+ */
+template<typename T>
+int SpatialHash<T>::find_slot(const T& element) const {
+
+  const auto& it = slot_indices.find(element);
+  if (it == slot_indices.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+/**
+ * \brief Converts a rectangle to the coordinates of the grid.
+ * \param bounding_box A rectangle in the coordinates of the space.
+ * \return The rectangle relative to the top-left corner of the space.
+ */
+template<typename T>
+Rectangle SpatialHash<T>::get_grid_box(const Rectangle& bounding_box) const {
+
+  return Rectangle(
+      bounding_box.get_x() - space.get_x(),
+      bounding_box.get_y() - space.get_y(),
+      bounding_box.get_width(),
+      bounding_box.get_height()
+  );
+}
+
+}
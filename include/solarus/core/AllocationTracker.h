@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ALLOCATION_TRACKER_H
+#define SOLARUS_ALLOCATION_TRACKER_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Counts heap allocations per frame and per part of the engine.
+ *
+ * This only works when the engine is built with the
+ * SOLARUS_ALLOCATION_TRACKING option: global operator new and delete are
+ * then replaced to count calls.
+ * Otherwise, scope markers compile to nothing and all counters stay zero.
+ *
+ * Allocations are attributed to the innermost scope marker of the current
+ * thread. Allocations made by Lua go through the Lua allocator and are not
+ * counted.
+ */
+class SOLARUS_API AllocationTracker {
+
+  public:
+
+    /**
+     * \brief Parts of the engine whose allocations are counted separately.
+     */
+    enum class Scope {
+      OTHER,              /**< Everything not in another scope. */
+      STEP,               /**< MainLoop::step() outside the scopes below. */
+      ENTITIES_UPDATE,    /**< Entities::update(). */
+      ENTITIES_DRAW,      /**< Entities::draw(). */
+      LUA_UPDATE          /**< LuaContext::update(). */
+    };
+
+    static constexpr int num_scopes = 5;  /**< Number of values of Scope. */
+
+    /**
+     * \brief Allocations counted in a scope.
+     */
+    struct Counters {
+      uint64_t num_allocations = 0;   /**< Calls to operator new. */
+      uint64_t num_bytes = 0;         /**< Bytes requested to operator new. */
+      uint64_t num_frees = 0;         /**< Calls to operator delete. */
+    };
+
+    /**
+     * \brief Attributes allocations of the current thread to a scope
+     * during its lifetime.
+     */
+    class ScopeMarker {
+
+      public:
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+        explicit ScopeMarker(Scope scope);
+        ~ScopeMarker();
+#else
+        explicit ScopeMarker(Scope /* scope */) {}
+#endif
+
+        ScopeMarker(const ScopeMarker& other) = delete;
+        ScopeMarker& operator=(const ScopeMarker& other) = delete;
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+      private:
+
+        Scope previous_scope;         /**< Scope to restore at the end. */
+#endif
+    };
+
+    static bool is_enabled();
+    static const std::string& get_scope_name(Scope scope);
+
+    static void finish_frame();
+    static Counters get_frame_counters(Scope scope);
+    static Counters get_total_counters(Scope scope);
+
+    static void notify_allocation(size_t size);
+    static void notify_free();
+
+};
+
+}
+
+#endif
+
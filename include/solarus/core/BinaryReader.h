@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BINARY_READER_H
+#define SOLARUS_BINARY_READER_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Reads the values of a binary data file directly from its buffer.
+ *
+ * The buffer is not copied and may be memory-mapped:
+ * it must live as long as the reader.
+ *
+ * Reading past the end or an invalid string index makes the reader invalid
+ * instead of failing immediately. Callers check is_valid() when convenient.
+ *
+ * \see BinaryWriter
+ */
+class SOLARUS_API BinaryReader {
+
+  public:
+
+    BinaryReader(const char* data, size_t size);
+
+    bool is_valid() const;
+
+    bool read_header(const std::string& magic, uint32_t version, uint64_t& source_hash);
+    bool read_string_table();
+
+    uint8_t read_uint8();
+    uint32_t read_uint32();
+    int read_int32();
+    const std::string& read_string();
+
+    bool can_read(uint32_t count, size_t item_size);
+
+  private:
+
+    const char* data;                  /**< Current position. */
+    const char* end;                   /**< End of the buffer. */
+    bool valid;                        /**< Whether everything read so far was correct. */
+    std::vector<std::string> strings;  /**< The string table. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BINARY_WRITER_H
+#define SOLARUS_BINARY_WRITER_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Writes the little-endian values of a binary data file.
+ *
+ * A binary data file starts with a magic string identifying its type,
+ * the version of its format and the hash of the data file it was compiled
+ * from. Then comes a table of strings and finally the values.
+ *
+ * Strings are not written directly but replaced by their index in the table,
+ * so that repeated values (like tile patterns or image names) are stored once.
+ *
+ * \see BinaryReader
+ */
+class SOLARUS_API BinaryWriter {
+
+  public:
+
+    BinaryWriter();
+
+    void write_uint8(uint8_t value);
+    void write_uint32(uint32_t value);
+    void write_int32(int value);
+    void write_string(const std::string& value);
+
+    std::string get_file(const std::string& magic, uint32_t version, uint64_t source_hash);
+
+  private:
+
+    std::string body;                                /**< Values written so far. */
+    std::map<std::string, uint32_t> string_indexes;  /**< Index of each string in the table. */
+    std::vector<std::string> strings;                /**< The string table. */
+
+};
+
+}
+
+#endif
+
@@ -19,15 +19,16 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Dialog.h"
+#include "solarus/core/QuestDatabase.h"
 #include "solarus/core/ResourceType.h"
 #include <map>
 #include <string>
+#include <unordered_map>
 
 namespace Solarus {
 
 class DialogResources;
 class QuestProperties;
-class QuestDatabase;
 class StringResources;
 
 /**
@@ -43,10 +44,13 @@ SOLARUS_API QuestProperties& get_properties();
 
 SOLARUS_API QuestDatabase& get_database();
 SOLARUS_API bool resource_exists(ResourceType resource_type, const std::string& id);
+SOLARUS_API QuestDatabase::ResourceId get_resource_id(ResourceType resource_type, const std::string& id);
 SOLARUS_API const std::map<std::string, std::string>& get_resources(ResourceType resource_type);
 
 SOLARUS_API bool has_language(const std::string& language_code);
 SOLARUS_API void set_language(const std::string& language_code);
+SOLARUS_API void preload_language(const std::string& language_code);
+SOLARUS_API void forget_previous_languages();
 SOLARUS_API std::string& get_language();
 SOLARUS_API std::string get_language_name(const std::string& language_code);
 
@@ -54,7 +58,7 @@ SOLARUS_API StringResources& get_strings();
 SOLARUS_API bool string_exists(const std::string& key);
 SOLARUS_API const std::string& get_string(const std::string& key);
 
-SOLARUS_API std::map<std::string, Dialog>& get_dialogs();
+SOLARUS_API std::unordered_map<std::string, Dialog>& get_dialogs();
 SOLARUS_API bool dialog_exists(const std::string& dialog_id);
 SOLARUS_API const Dialog& get_dialog(const std::string& dialog_id);
 
@@ -20,8 +20,18 @@
 #include "solarus/core/Common.h"
 #include <string>
 
-#ifndef NDEBUG
-#define SOLARUS_ASSERT(condition, message) Debug::check_assertion(condition, message)
+/**
+ * \brief Checks an internal invariant of the engine.
+ *
+ * Unlike Debug::check_assertion(), this is only compiled in debug builds,
+ * or in any build when SOLARUS_CHECKED_ASSERTIONS is defined,
+ * so that hot paths of release builds don't even pay for the test.
+ * The condition must have no side effects.
+ * The message is only built if the assertion fails.
+ */
+#if !defined(NDEBUG) || defined(SOLARUS_CHECKED_ASSERTIONS)
+#define SOLARUS_ASSERT(condition, message) \
+  ::Solarus::Debug::check_assertion_lazy(condition, [&] { return std::string(message); })
 #else
 #define SOLARUS_ASSERT(condition, message)
 #endif
@@ -41,10 +51,63 @@ SOLARUS_API void set_abort_on_die(bool abort);
 
 SOLARUS_API void warning(const std::string& message);
 SOLARUS_API void error(const std::string& message);
-SOLARUS_API void check_assertion(bool assertion, const char* error_message);
-SOLARUS_API void check_assertion(bool assertion, const std::string& error_message);
 [[noreturn]] SOLARUS_API void die(const std::string& error_message);
 
+/**
+ * \brief Stops Solarus if the specified assertion is \c false.
+ *
+ * This is inline so that a successful check only costs a branch.
+ *
+ * \param assertion The assertion to check.
+ * \param error_message Error message to show in case of failure.
+ */
+inline void check_assertion(bool assertion, const char* error_message) {
+
+  // Don't build the std::string when the assertion succeeds.
+  if (!assertion) {
+    die(error_message);
+  }
+}
+
+/**
+ * \brief Stops Solarus if the specified assertion is \c false.
+ *
+ * The message is built by the caller even when the assertion succeeds:
+ * on hot paths, prefer check_assertion_lazy().
+ *
+ * \param assertion The assertion to check.
+ * \param error_message Error message to show in case of failure.
+ */
+inline void check_assertion(bool assertion, const std::string& error_message) {
+
+  if (!assertion) {
+    die(error_message);
+  }
+}
+
+/**
+ * \brief Stops Solarus if the specified assertion is \c false,
+ * building the error message only in this case.
+ *
+ * Use this instead of check_assertion() when the message is computed,
+ * for example by concatenating strings or calling SDL_GetError():
+ * \code
+ * Debug::check_assertion_lazy(surface != nullptr, [&] {
+ *   return std::string("Cannot load image: ") + SDL_GetError();
+ * });
+ * \endcode
+ *
+ * \param assertion The assertion to check.
+ * \param get_message Function returning the error message.
+ */
+template<typename MessageFunction>
+void check_assertion_lazy(bool assertion, const MessageFunction& get_message) {
+
+  if (!assertion) {
+    die(get_message());
+  }
+}
+
 /**
  * \brief Execute an arbitrary function in debug mode.
  */
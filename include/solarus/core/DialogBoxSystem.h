@@ -51,7 +51,7 @@ class DialogBoxSystem {
     void open(
         const std::string& dialog_id,
         const ScopedLuaRef& info_ref,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
     void close(const ScopedLuaRef& status_ref);
     bool notify_command_pressed(GameCommand command);
@@ -21,6 +21,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 namespace Solarus {
 
@@ -30,9 +31,11 @@ class SOLARUS_API EnumInfo {
   public:
 
     using names_type = std::map<E, std::string>;
+    using names_index_type = std::unordered_map<std::string, E>;
 
     static const std::list<E> enums();
     static const std::list<std::string> names();
+    static const names_index_type& names_index();
 
 };
 
@@ -44,6 +44,28 @@ const std::list<std::string> EnumInfo<E>::names() {
   return names;
 }
 
+/**
+ * \brief Returns the enum values indexed by their name.
+ *
+ * The index is built the first time and lets name_to_enum()
+ * avoid comparing the name with each name of the enum.
+ *
+ * \return The enum value of each name.
+ */
+template <typename E>
+const typename EnumInfo<E>::names_index_type& EnumInfo<E>::names_index() {
+
+  static const names_index_type index = [] {
+    names_index_type index;
+    for (const auto& kvp : EnumInfoTraits<E>::names) {
+      // Like a linear search, keep the first value if a name is repeated.
+      index.emplace(kvp.second, kvp.first);
+    }
+    return index;
+  }();
+  return index;
+}
+
 template <typename E>
 const std::string& enum_to_name(E value) {
 
@@ -59,10 +81,10 @@ const std::string& enum_to_name(E value) {
 template <typename E>
 E name_to_enum(const std::string& name) {
 
-  for (const auto& kvp : EnumInfoTraits<E>::names) {
-    if (kvp.second == name) {
-      return kvp.first;
-    }
+  const auto& index = EnumInfo<E>::names_index();
+  const auto& it = index.find(name);
+  if (it != index.end()) {
+    return it->second;
   }
 
   Debug::die(std::string("Invalid ") + EnumInfoTraits<E>::pretty_name + " name: '" + name + "'");
@@ -78,11 +100,11 @@ E name_to_enum(const std::string& name, E default_value) {
 template <typename E>
 E name_to_enum(const std::string& name, E default_value, bool& success) {
 
-  for (const auto& kvp : EnumInfoTraits<E>::names) {
-    if (kvp.second == name) {
-      success = true;
-      return kvp.first;
-    }
+  const auto& index = EnumInfo<E>::names_index();
+  const auto& it = index.find(name);
+  if (it != index.end()) {
+    success = true;
+    return it->second;
   }
 
   success = false;
@@ -22,6 +22,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 struct lua_State;
 
@@ -87,6 +88,7 @@ class SOLARUS_API Equipment {
 
     // equipment items
     void load_items();
+    void notify_item_events_changed();
     bool item_exists(const std::string& item_name) const;
     EquipmentItem& get_item(const std::string& item_name);
     const EquipmentItem& get_item(const std::string& item_name) const;
@@ -110,6 +112,9 @@ class SOLARUS_API Equipment {
     // items
     std::map<std::string, std::shared_ptr<EquipmentItem>>
         items;                                   /**< Each item (properties loaded from item scripts). */
+    std::vector<EquipmentItem*>
+        items_to_update;                         /**< Items defining on_update() in their own table. */
+    bool items_to_update_dirty;                  /**< Whether items_to_update needs to be rebuilt. */
 
     std::string get_ability_savegame_variable(Ability ability) const;
 
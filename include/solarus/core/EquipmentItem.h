@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Ability.h"
+#include "solarus/core/Savegame.h"
 #include "solarus/lua/ExportableToLua.h"
 #include <string>
 
@@ -95,14 +96,17 @@ class EquipmentItem: public ExportableToLua {
     void set_max_amount(int max_amount);
 
     virtual const std::string& get_lua_type_name() const override;
+    virtual void notify_lua_event_mask_changed() override;
 
   private:
 
     Equipment& equipment;                /**< the equipment object that manages all items */
     std::string name;                    /**< name that identifies this item */
     std::string savegame_variable;       /**< savegame variable that stores the possession state */
+    Savegame::Key savegame_key;          /**< interned savegame_variable if any */
     std::string amount_savegame_variable; /**< savegame variable that stores the amount associated to this item
                                           * or an empty string if there is no amount */
+    Savegame::Key amount_savegame_key;   /**< interned amount_savegame_variable if any */
     int max_amount;                      /**< limit of the amount associated to this item, or 0 */
     bool obtainable;                     /**< whether the player can receive this item */
     bool assignable;                     /**< indicates that this item can be assigned to an item key an then
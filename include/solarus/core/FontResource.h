@@ -18,7 +18,10 @@
 #define SOLARUS_FONT_RESOURCE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/graphics/GlyphAtlas.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -35,12 +38,19 @@ class FontResource {
 
     static void initialize();
     static void quit();
+    static void preload_fonts();
 
     static std::string get_default_font_id();
     static bool exists(const std::string& font_id);
     static bool is_bitmap_font(const std::string& font_id);
     static SurfacePtr get_bitmap_font(const std::string& font_id);
     static TTF_Font& get_outline_font(const std::string& font_id, int size);
+    static GlyphAtlas& get_glyph_atlas(
+        const std::string& font_id,
+        int size,
+        bool antialiasing,
+        const Color& color
+    );
 
   private:
 
@@ -64,6 +74,9 @@ class FontResource {
     struct OutlineFontReader {
         SDL_RWops_UniquePtr rw;
         TTF_Font_UniquePtr outline_font;
+        std::map<uint64_t, std::unique_ptr<GlyphAtlas>>
+            glyph_atlases;                            /**< Glyphs rendered with this size,
+                                                       * by rendering mode and color. */
     };
 
     /**
@@ -72,6 +85,7 @@ class FontResource {
     struct FontFile {
       std::string file_name;                          /**< Name of the font file, relative to the data directory. */
       std::string buffer;                             /**< The font file loaded into memory. */
+      bool is_bitmap = false;                         /**< Whether the file is an image of characters. */
 
       SurfacePtr bitmap_font;                         /**< The font bitmap. Only used for bitmap fonts. */
       std::map<int, OutlineFontReader>
@@ -79,10 +93,13 @@ class FontResource {
                                                        * Only used for outline fonts. */
     };
 
+    static std::map<std::string, FontFile> read_font_files();
     static void load_fonts();
 
     static bool fonts_loaded;
     static std::map<std::string, FontFile> fonts;
+    static std::future<std::map<std::string, FontFile>>
+        fonts_loading;                                /**< Font files being read by preload_fonts(). */
 
 };
 
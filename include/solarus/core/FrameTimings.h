@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FRAME_TIMINGS_H
+#define SOLARUS_FRAME_TIMINGS_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Records how long each phase of the main loop takes.
+ *
+ * The measures of the last frames are kept in a fixed-size ring buffer.
+ * They can be read from Lua and saved to a CSV file.
+ */
+class SOLARUS_API FrameTimings {
+
+  public:
+
+    /**
+     * \brief Phases of a main loop iteration that are measured.
+     */
+    enum class Phase {
+      INPUT,      /**< check_input(). */
+      GAME,       /**< Game::update(). */
+      LUA,        /**< LuaContext::update(). */
+      SYSTEM,     /**< System::update(). */
+      DRAW,       /**< draw(). */
+      GC          /**< Lua garbage collection in the idle time. */
+    };
+
+    /**
+     * \brief Measures of one main loop iteration.
+     *
+     * Durations are in milliseconds.
+     */
+    struct Frame {
+      uint32_t date = 0;          /**< Real time when the frame started. */
+      int num_updates = 0;        /**< Number of simulation steps done. */
+      uint32_t time_dropped = 0;  /**< Lag given up because it was too big. */
+      double input_time = 0.0;    /**< Time spent in check_input(). */
+      double game_time = 0.0;     /**< Time spent in Game::update(). */
+      double lua_time = 0.0;      /**< Time spent in LuaContext::update(). */
+      double system_time = 0.0;   /**< Time spent in System::update(). */
+      double draw_time = 0.0;     /**< Time spent in draw(). */
+      double gc_time = 0.0;       /**< Time spent collecting Lua garbage at the end of the frame. */
+      double total_time = 0.0;    /**< Duration of the whole iteration, including sleep. */
+      int num_readbacks = 0;      /**< GPU to CPU pixel transfers done. */
+      int num_full_readbacks = 0; /**< Readbacks that had to transfer a whole surface. */
+      int num_draw_calls = 0;     /**< Batched draw calls sent to the renderer. */
+    };
+
+    explicit FrameTimings(size_t capacity = default_capacity);
+
+    size_t get_capacity() const;
+    size_t get_num_frames() const;
+    const Frame& get_frame(size_t index) const;
+    void clear();
+
+    void start_frame(uint32_t date);
+    void add_phase_time(Phase phase, double start_time);
+    void add_update();
+    void add_time_dropped(uint32_t time_dropped);
+    void add_readbacks(int num_readbacks, int num_full_readbacks);
+    void add_draw_calls(int num_draw_calls);
+    void finish_frame();
+
+    bool save_csv(const std::string& file_name) const;
+
+    static double get_time();
+
+    static constexpr size_t
+        default_capacity = 1024;  /**< Number of frames kept by default. */
+
+  private:
+
+    std::vector<Frame> frames;    /**< Ring buffer of the last frames. */
+    size_t first;                 /**< Index of the oldest frame in the ring buffer. */
+    size_t num_frames;            /**< Number of frames currently stored. */
+    Frame current;                /**< Frame being measured. */
+    double current_start_time;    /**< High-resolution time when the current frame started. */
+
+};
+
+}
+
+#endif
+
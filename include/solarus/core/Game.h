@@ -118,7 +118,7 @@ class SOLARUS_API Game {
     void start_dialog(
         const std::string& dialog_id,
         const ScopedLuaRef& info_ref,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
     void stop_dialog(const ScopedLuaRef& status_ref);
 
@@ -161,7 +161,7 @@ private:
         next_map;              /**< the map where the hero is going to; if not nullptr, it means that the hero
                                 * is changing from current_map to next_map */
     SurfacePtr
-        previous_map_surface;  /**< a copy of the previous map surface for transition effects that display two maps */
+        previous_map_surface;  /**< the previous map surface for transition effects that display two maps */
 
     Transition::Style
         transition_style;      /**< the transition style between the current map and the next one */
@@ -174,8 +174,10 @@ private:
     // update functions
     void update_commands_effects();
     void update_transitions();
+    void load_next_map();
     void update_gameover_sequence();
     void notify_map_changed();
+    void prefetch_next_maps();
 
 };
 
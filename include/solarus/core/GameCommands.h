@@ -57,7 +57,7 @@ class GameCommands {
     bool is_command_pressed(GameCommand command) const;
     int get_wanted_direction8() const;
 
-    void customize(GameCommand command, const ScopedLuaRef& callback_ref);
+    void customize(GameCommand command, ScopedLuaRef callback_ref);
     bool is_customizing() const;
     GameCommand get_command_to_customize() const;
 
@@ -66,6 +66,12 @@ constexpr double SQRT_2 = 1.41421356237309504880;
 int radians_to_degrees(double radians);
 double degrees_to_radians(double degrees);
 
+bool are_trigonometry_tables_enabled();
+void set_trigonometry_tables_enabled(bool enabled);
+double get_cos(double angle);
+double get_sin(double angle);
+double get_atan2(double y, double x);
+
 double get_distance(int x1, int y1, int x2, int y2);
 int get_distance2(int x1, int y1, int x2, int y2);
 double get_distance(const Point& point1, const Point& point2);
@@ -19,9 +19,11 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
 #include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <vector>
 #include <SDL_events.h>
@@ -208,6 +210,8 @@ class InputEvent {
 
     // retrieve the current event
     static std::unique_ptr<InputEvent> get_event();
+    static void get_events(std::vector<InputEvent>& events);
+    static std::unique_ptr<InputEvent> create_replayed_event(const SDL_Event& internal_event);
 
     // global information
     static void set_key_repeat(bool repeat);
@@ -227,6 +231,7 @@ class InputEvent {
     static bool get_global_finger_pressure(int finger_id, float& finger_pressure);
 
     // event type
+    const SDL_Event& get_internal_event() const;
     bool is_valid() const;
     bool is_keyboard_event() const;
     bool is_joypad_event() const;
@@ -306,26 +311,45 @@ class InputEvent {
 
     // window event
     bool is_window_closing() const;
+    bool is_window_hidden() const;
+    bool is_window_shown() const;
+    bool is_window_focus_lost() const;
+    bool is_window_focus_gained() const;
 
   private:
 
     explicit InputEvent(const SDL_Event& event);
 
+    static void update_state(SDL_Event& internal_event);
+    static bool merge_axis_motion(std::vector<InputEvent>& events, const InputEvent& event);
+    static void update_joypad_state();
+    static SDL_Scancode get_scancode(SDL_Keycode key);
+    static SDL_Scancode get_scancode(const SDL_Event& internal_event);
+
     static const KeyboardKey directional_keys[];  /**< array of the keyboard directional keys */
     static bool initialized;                      /**< Whether the input manager is initialized. */
     static bool joypad_enabled;                   /**< true if joypad support is enabled
                                                    * (may be true even without joypad plugged) */
     static SDL_Joystick* joystick;                /**< the joystick object if enabled and plugged */
-    static std::vector<int> joypad_axis_state;    /**< keep track of the current horizontal and vertical axis states */
+    static std::vector<int16_t>
+      joypad_axis_values;                         /**< Last value of each axis of the joystick. */
+    static std::vector<uint8_t>
+      joypad_button_states;                       /**< Whether each button of the joystick is down. */
+    static std::vector<uint8_t>
+      joypad_hat_states;                          /**< Last SDL position of each hat of the joystick. */
     static std::map<KeyboardKey, std::string>
       keyboard_key_names;                         /**< Names of all existing keyboard keys. */
     static std::map<MouseButton, std::string>
       mouse_button_names;                         /**< Names of all existing mouse buttons. */
     static bool repeat_keyboard;                  /**< True to handle repeat KEYDOWN and KEYUP events. */
-    static std::set<SDL_Keycode> keys_pressed;    /**< Keys currently down, only according to SDL_KEYDOWN and SDL_KEYUP events
+    static std::bitset<SDL_NUM_SCANCODES>
+      keys_pressed;                               /**< Scancodes currently down, only according to SDL_KEYDOWN and SDL_KEYUP events
                                                    * (i.e. independently of the real current state SDL_GetKeyboardState()). */
+    static std::array<int16_t, 128 + SDL_NUM_SCANCODES>
+      key_scancodes;                              /**< Scancode of each keycode in the current layout, or -1 if not computed yet.
+                                                   * ASCII keycodes come first, then keycodes made from a scancode. */
 
-    const SDL_Event internal_event;               /**< the internal event encapsulated */
+    SDL_Event internal_event;                     /**< the internal event encapsulated */
 
 };
 
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_INPUT_RECORDING_H
+#define SOLARUS_INPUT_RECORDING_H
+
+#include "solarus/core/Common.h"
+#include <SDL_events.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class InputEvent;
+
+/**
+ * \brief Records input events of a session and replays them.
+ *
+ * Each event is saved with the simulated time when it was handled,
+ * together with the seed of the random number generator.
+ * Since the simulation advances by a fixed timestep, giving the same
+ * events back at the same simulated times reproduces the session exactly,
+ * which makes profiling runs comparable.
+ *
+ * Events are stored as raw SDL events, so a recording should be replayed
+ * with the same build of the engine.
+ * State polled directly from devices (like sol.input.is_key_pressed())
+ * is not replayed.
+ */
+class SOLARUS_API InputRecording {
+
+  public:
+
+    InputRecording();
+
+    InputRecording(const InputRecording& other) = delete;
+    InputRecording& operator=(const InputRecording& other) = delete;
+
+    bool start_recording(const std::string& file_name, uint32_t random_seed);
+    bool start_replaying(const std::string& file_name);
+
+    bool is_recording() const;
+    bool is_replaying() const;
+    bool is_replay_finished() const;
+    uint32_t get_random_seed() const;
+
+    void record_event(const InputEvent& event, uint32_t date);
+    std::unique_ptr<InputEvent> get_replayed_event(uint32_t date);
+
+    static bool is_recordable(const InputEvent& event);
+
+  private:
+
+    /**
+     * \brief An event read from a recording.
+     */
+    struct Record {
+      uint32_t date;           /**< Simulated time when the event was handled. */
+      SDL_Event event;         /**< The SDL event. */
+    };
+
+    static const std::string file_signature;
+
+    std::ofstream out;               /**< The file being recorded or closed. */
+    std::vector<Record> records;     /**< Events being replayed. */
+    size_t next_record_index;        /**< Index of the next event to replay. */
+    bool replaying;                  /**< Whether a recording was loaded. */
+    uint32_t random_seed;            /**< Seed of the random number generator. */
+
+};
+
+}
+
+#endif
+
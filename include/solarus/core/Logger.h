@@ -18,6 +18,7 @@
 #define SOLARUS_LOGGER_H
 
 #include "solarus/core/Common.h"
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -30,19 +31,81 @@ namespace Solarus {
  * simulated time.
  * This allows to better distinguish messages from the engine and messages
  * from the quest.
+ *
+ * Messages have a level and an optional category, and can be filtered on both
+ * at runtime.
+ * They are written as text lines by default, or as JSON objects (one per line)
+ * for tools that parse the output.
+ *
+ * In asynchronous mode, messages are put in a lock-free queue and written by
+ * a background thread, so that the thread that logs never waits for stdout.
+ * Their order is preserved.
+ *
+ * Programs that run the engine in their own process can also receive each
+ * line written on stdout through an output handler.
  */
 namespace Logger {
 
+/**
+ * \brief Severity of messages.
+ *
+ * VERBOSE and SEVERE are the debug and error levels: DEBUG and ERROR
+ * are macros in some builds and system headers.
+ */
+enum class Level {
+  VERBOSE,     /**< Debug messages. */
+  INFO,
+  WARNING,
+  SEVERE,      /**< Errors. */
+  FATAL
+};
+
+/**
+ * \brief How messages are written.
+ */
+enum class Format {
+  TEXT,        /**< Human-readable lines (default). */
+  JSON         /**< One JSON object per line. */
+};
+
+/**
+ * \brief Function called with each line written on stdout, without the
+ * final newline.
+ *
+ * It is called from the thread that writes: the thread that logs,
+ * or the background thread in asynchronous mode.
+ */
+using OutputHandler = std::function<void(const std::string& line)>;
+
 SOLARUS_API void print(const std::string& message, std::ostream& out = std::cout);
+SOLARUS_API void print_output(const std::string& line);
+
+SOLARUS_API void debug(const std::string& message, const std::string& category = "");
+SOLARUS_API void info(const std::string& message, const std::string& category = "");
+SOLARUS_API void warning(const std::string& message, const std::string& category = "");
+SOLARUS_API void error(const std::string& message, const std::string& category = "");
+SOLARUS_API void fatal(const std::string& message, const std::string& category = "");
 
-SOLARUS_API void debug(const std::string& message);
-SOLARUS_API void info(const std::string& message);
-SOLARUS_API void warning(const std::string& message);
-SOLARUS_API void error(const std::string& message);
-SOLARUS_API void fatal(const std::string& message);
+SOLARUS_API Level get_min_level();
+SOLARUS_API void set_min_level(Level level);
+SOLARUS_API bool set_min_level(const std::string& level_name);
+SOLARUS_API bool is_category_enabled(const std::string& category);
+SOLARUS_API void set_category_enabled(const std::string& category, bool enabled);
+SOLARUS_API bool is_enabled(Level level, const std::string& category = "");
+
+SOLARUS_API Format get_format();
+SOLARUS_API void set_format(Format format);
+SOLARUS_API bool set_format(const std::string& format_name);
+
+SOLARUS_API bool is_asynchronous();
+SOLARUS_API void set_asynchronous(bool asynchronous);
+SOLARUS_API void flush();
+
+SOLARUS_API void set_output_handler(const OutputHandler& handler);
 
 }  // namespace Logger
 
 }  // namespace Solarus
 
 #endif
+
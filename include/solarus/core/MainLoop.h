@@ -18,8 +18,16 @@
 #define SOLARUS_MAIN_LOOP_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/InputEvent.h"
+#include "solarus/core/InputRecording.h"
+#include "solarus/core/PerformanceOverlay.h"
 #include "solarus/core/ResourceProvider.h"
+#include "solarus/core/ResourceWatcher.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/core/WorldStateHash.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/LuaProfiler.h"
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -30,13 +38,17 @@ namespace Solarus {
 
 class Arguments;
 class Game;
-class InputEvent;
 class LuaContext;
 
 /**
  * \brief Main class of the game engine.
  *
  * It starts the program and handles the succession of its screens.
+ *
+ * The simulated time, the random generator and the Lua state belong to the
+ * thread that runs the main loop.
+ * Quest files, video, audio, input devices and decoded resources are still
+ * process-wide, so only one main loop can exist at a time.
  */
 class SOLARUS_API MainLoop {
 
@@ -55,20 +67,38 @@ class SOLARUS_API MainLoop {
     Game* get_game();
     void set_game(Game* game);
     ResourceProvider& get_resource_provider();
+    const FrameTimings& get_frame_timings() const;
+    FrameTimings& get_frame_timings();
+    LuaProfiler& get_lua_profiler();
+    ThreadPool& get_thread_pool();
+    const std::string& get_background_mode() const;
+    void set_background_mode(const std::string& background_mode);
     int push_lua_command(const std::string& command);
+    void notify_resource_file_changed(const std::string& file_name);
 
     LuaContext& get_lua_context();
 
   private:
 
+    /**
+     * \brief A Lua command received on the console and its identifier.
+     */
+    struct LuaCommand {
+      int id;                     /**< Number reported in the command delimiters. */
+      std::string code;           /**< Lua code to execute. */
+    };
+
     void check_input();
     void notify_input(const InputEvent& event);
-    void draw();
+    void notify_window_event(const InputEvent& event);
+    bool is_in_background() const;
+    bool draw();
     void update();
 
     void load_quest_properties();
     void initialize_lua_console();
     void quit_lua_console();
+    bool run_lua_command(const std::string& code);
 
     std::unique_ptr<LuaContext>
         lua_context;              /**< The Lua world where scripts are run. */
@@ -82,15 +112,52 @@ class SOLARUS_API MainLoop {
                                    * Useful to debug issues that only happen on slow systems. */
     bool turbo;                   /**< Whether to run the simulation as fast as possible
                                    * rather than following real time. */
+    bool interpolation;           /**< Whether to draw once per display refresh and
+                                   * interpolate positions between simulation steps. */
+    int draw_rate;                /**< Maximum draws per second, 0 for no limit. */
+    std::string background_mode;  /**< What to do while the window is unfocused
+                                   * or hidden: "continue", "throttle" or "pause". */
+    bool window_hidden;           /**< Whether the window is minimized or hidden. */
+    bool window_focused;          /**< Whether the window has the keyboard focus. */
+    FrameTimings frame_timings;   /**< Duration of each phase of the last frames. */
+    std::string
+        frame_timings_file_name;  /**< CSV file where to save frame timings at exit,
+                                   * or an empty string. */
+    LuaProfiler lua_profiler;     /**< Time and memory spent in Lua callbacks. */
+    std::string
+        lua_profile_file_name;    /**< Folded stack file where to save the Lua
+                                   * profile at exit, or an empty string. */
+    std::string trace_file_name;  /**< JSON file where to save the trace of engine
+                                   * scopes at exit, or an empty string. */
+    std::string
+        startup_manifest_file_name; /**< File where to save the data files read
+                                   * at startup, or an empty string. */
+    InputRecording
+        input_recording;          /**< Input events being recorded or replayed. */
+    WorldStateHash
+        world_state_hash;         /**< Simulation state hashes being recorded or checked. */
+    PerformanceOverlay
+        performance_overlay;      /**< Performance numbers drawn over the quest (Ctrl+F12). */
+    std::vector<InputEvent>
+        input_events;             /**< Events taken from the queue, reused at each cycle. */
+    ResourceWatcher
+        resource_watcher;         /**< Detects data files modified while running. */
+    ThreadPool thread_pool;       /**< Worker threads for parallel parts of the simulation. */
 
     std::thread stdin_thread;     /**< Separate thread that reads Lua commands on stdin. */
-    std::vector<std::string>
+    std::vector<LuaCommand>
         lua_commands;             /**< Lua commands to run next cycle. */
     std::mutex
         lua_commands_mutex;       /**< Lock for the list of scheduled Lua commands. */
+    std::atomic<bool>
+        lua_commands_pending;     /**< Whether lua_commands is not empty. */
     int num_lua_commands_pushed;  /**< Counter of Lua commands requested. */
     int num_lua_commands_done;    /**< Counter of Lua commands executed. */
 
+    static constexpr uint32_t
+        background_period = 100;  /**< Duration of an iteration of the main loop
+                                   * when throttled or paused in background. */
+
 };
 
 }
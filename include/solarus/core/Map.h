@@ -20,6 +20,7 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MapData.h"
+#include "solarus/core/MapOverview.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/entities/Camera.h"
 #include "solarus/entities/Entities.h"
@@ -30,12 +31,18 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/ExportableToLua.h"
+#include "solarus/movements/PathFinding.h"
+#include "solarus/movements/PathFindingCache.h"
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace Solarus {
 
 class Destination;
 class InputEvent;
 class LuaContext;
+class ProjectilePool;
 class Tileset;
 class Sprite;
 
@@ -61,6 +68,7 @@ class SOLARUS_API Map: public ExportableToLua {
     const Tileset& get_tileset() const;
     const std::string& get_tileset_id() const;
     void set_tileset(const std::string& tileset_id);
+    const Tileset& get_used_tileset(const std::string& tileset_id);
     const std::string& get_music_id() const;
     bool has_world() const;
     const std::string& get_world() const;
@@ -68,6 +76,9 @@ class SOLARUS_API Map: public ExportableToLua {
     bool has_floor() const;
     int get_floor() const;
     void set_floor(int floor);
+    int get_entity_cell_size() const;
+    int get_activity_distance() const;
+    void set_activity_distance(int activity_distance);
     const Rectangle& get_location() const;
 
     Size get_size() const;
@@ -82,6 +93,8 @@ class SOLARUS_API Map: public ExportableToLua {
 
     // camera
     const CameraPtr& get_camera() const;
+    const std::vector<CameraPtr>& get_cameras() const;
+    const CameraPtr& get_drawing_camera() const;
     SurfacePtr get_camera_surface();  // TODO remove
 
     // loading
@@ -99,6 +112,15 @@ class SOLARUS_API Map: public ExportableToLua {
     // entities
     Entities& get_entities();
     const Entities& get_entities() const;
+    PathFinding::Workspace& get_path_finding_workspace();
+    PathFindingCache& get_path_finding_cache();
+
+    // projectiles
+    void add_projectile_pool(const std::shared_ptr<ProjectilePool>& projectile_pool);
+    void remove_projectile_pool(ProjectilePool& projectile_pool);
+
+    // overview
+    MapOverview& get_overview();
 
     // presence of the hero
     bool is_started() const;
@@ -122,6 +144,11 @@ class SOLARUS_API Map: public ExportableToLua {
         const Entity& entity_to_check,
         bool& found_diagonal_wall
     ) const;
+    bool test_collision_with_ground(
+        int layer,
+        const Rectangle& collision_box,
+        const Entity& entity_to_check
+    ) const;
     bool test_collision_with_entities(
         int layer,
         const Rectangle& collision_box,
@@ -143,6 +170,19 @@ class SOLARUS_API Map: public ExportableToLua {
         const Point& point,
         Entity& entity_to_check
     );
+    bool is_free_of_obstacles(
+        int layer,
+        const Rectangle& region,
+        const Entity& entity_to_check
+    ) const;
+    int cast_ray(
+        int layer,
+        const Rectangle& collision_box,
+        const Point& step,
+        int max_distance,
+        Entity& entity_to_check,
+        Entity*& obstacle_entity
+    );
     bool has_empty_ground(
         int layer,
         const Rectangle& collision_box
@@ -164,10 +204,20 @@ class SOLARUS_API Map: public ExportableToLua {
 
     // collisions with detectors (checked after a move)
     void check_collision_with_detectors(Entity& entity);
+    void check_collision_with_detectors(Entity& entity, const EntityPointerVector& entities_nearby);
     void check_collision_with_detectors(Entity& entity, Sprite& sprite);
+    void check_collision_with_detectors(
+        Entity& entity,
+        Sprite& sprite,
+        const EntityPointerVector& entities_nearby
+    );
     void check_collision_from_detector(Entity& detector);
     void check_collision_from_detector(Entity& detector, Sprite& detector_sprite);
 
+    static constexpr int
+        detector_margin = 8;      /**< Detectors this close to an entity are checked
+                                   * because some collision tests work without overlapping. */
+
     // main loop
     bool notify_input(const InputEvent& event);
     void update();
@@ -182,8 +232,42 @@ class SOLARUS_API Map: public ExportableToLua {
   private:
 
     void set_suspended(bool suspended);
-    void build_background_surface();
-    void build_foreground_surface();
+    void update_projectile_pools();
+    bool test_collision_with_entities(
+        int layer,
+        const Rectangle& collision_box,
+        Entity& entity_to_check,
+        const EntityPointerVector& entities_nearby
+    );
+    Entity* get_obstacle_entity(
+        int layer,
+        const Rectangle& collision_box,
+        Entity& entity_to_check,
+        const EntityPointerVector& entities_nearby
+    );
+    bool test_collision_with_terrain(
+        int layer,
+        const Rectangle& collision_box,
+        Entity& entity_to_check,
+        bool use_ground_raster
+    );
+    bool can_use_ground_raster(
+        int layer,
+        const Rectangle& collision_box,
+        const Entity& entity_to_check,
+        const EntityPointerVector& entities_nearby
+    ) const;
+    bool has_modified_ground(
+        int layer,
+        const Rectangle& collision_box,
+        const Entity& entity_to_check
+    ) const;
+    bool test_collision_with_tile_ground_squares(
+        int layer,
+        const Rectangle& collision_box,
+        const Entity& entity_to_check
+    ) const;
+    void build_foreground_bars();
     void draw_background(const SurfacePtr& dst_surface);
     void draw_foreground(const SurfacePtr& dst_surface);
 
@@ -201,8 +285,12 @@ class SOLARUS_API Map: public ExportableToLua {
     int max_layer;                /**< Highest layer of the map (0 or more). */
 
     std::string tileset_id;       /**< Id of the current tileset. */
-    const Tileset* tileset;       /**< Tileset of the map: every tile of this map
+    std::shared_ptr<const Tileset>
+        tileset;                  /**< Tileset of the map: every tile of this map
                                    * is extracted from this tileset. */
+    std::map<std::string, std::shared_ptr<const Tileset>>
+        used_tilesets;            /**< All tilesets used by tiles of this map,
+                                   * kept in memory while the map is loaded. */
 
     std::string music_id;         /**< Id of the current music of the map:
                                    * can be a valid music, Music::none or Music::unchanged. */
@@ -212,15 +300,17 @@ class SOLARUS_API Map: public ExportableToLua {
 
     int floor;                    /**< The floor where this map is (possibly MapData::NO_FLOOR). */
 
+    int entity_cell_size;         /**< Side of the grid cells locating entities, or 0 for a quadtree. */
+    int activity_distance;        /**< Distance from the camera beyond which entities are dormant,
+                                   * or 0 to keep them all active. */
+
     Rectangle location;           /**< Location of the map in its context: the width and height fields
                                    * indicate the map size in pixel, and the x and y field indicate the position.
                                    * This is used to correctly scroll between adjacent maps. */
 
     // Quest screen
-    SurfacePtr
-        background_surface;       /**< A surface filled with the background color of the tileset. */
-    SurfacePtr
-        foreground_surface;       /**< A surface with black bars when the map is smaller than the screen. */
+    std::vector<Rectangle>
+        foreground_bars;          /**< Black bars to draw when the map is smaller than the screen. */
 
     // map state
     bool loaded;                  /**< Whether the loading phase is done. */
@@ -231,9 +321,18 @@ class SOLARUS_API Map: public ExportableToLua {
                                    * to place the hero on a side of the map,
                                    * or an empty string to use the one saved. */
 
+    PathFinding::Workspace
+        path_finding_workspace;   /**< Memory reused by path finding searches on this map. */
+    PathFindingCache
+        path_finding_cache;       /**< Paths shared by entities of this map. */
     std::unique_ptr<Entities>
         entities;                 /**< The entities on the map. */
+    std::vector<std::shared_ptr<ProjectilePool>>
+        projectile_pools;         /**< Projectiles of the map, drawn above entities. */
+    std::unique_ptr<MapOverview>
+        overview;                 /**< Minimap image, created on demand. */
     bool suspended;               /**< Whether the game is suspended. */
+    CameraPtr drawing_camera;     /**< The camera being drawn during draw(), or nullptr. */
 };
 
 /**
@@ -287,6 +386,22 @@ inline Entities& Map::get_entities() {
   return *entities;
 }
 
+/**
+ * \brief Returns the memory reused by path finding searches on this map.
+ * \return The path finding workspace.
+ */
+inline PathFinding::Workspace& Map::get_path_finding_workspace() {
+  return path_finding_workspace;
+}
+
+/**
+ * \brief Returns the path finding results shared by entities of this map.
+ * \return The path finding cache.
+ */
+inline PathFindingCache& Map::get_path_finding_cache() {
+  return path_finding_cache;
+}
+
 /**
  * \brief Returns the camera of the map.
  * \return The camera, or nullptr if there is no camera.
@@ -296,6 +411,31 @@ inline const CameraPtr& Map::get_camera() const {
   return get_entities().get_camera();
 }
 
+/**
+ * \brief Returns all cameras of the map.
+ * \return The cameras, the main one first.
+ */
+inline const std::vector<CameraPtr>& Map::get_cameras() const {
+
+  return get_entities().get_cameras();
+}
+
+/**
+ * \brief Returns the camera where things are drawn.
+ *
+ * During draw(), this is the camera being drawn.
+ * Otherwise, this is the main camera.
+ *
+ * \return The camera to draw on, or nullptr if there is no camera.
+ */
+inline const CameraPtr& Map::get_drawing_camera() const {
+
+  if (drawing_camera != nullptr) {
+    return drawing_camera;
+  }
+  return get_camera();
+}
+
 }
 
 #endif
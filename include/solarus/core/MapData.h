@@ -21,6 +21,7 @@
 #include "solarus/core/Size.h"
 #include "solarus/entities/EntityData.h"
 #include <array>
+#include <cstdint>
 #include <deque>
 #include <iosfwd>
 #include <map>
@@ -160,6 +161,15 @@ class SOLARUS_API MapData : public LuaData {
     bool has_music() const;
     const std::string& get_music_id() const;
     void set_music_id(const std::string& music_id);
+    bool has_entity_cell_size() const;
+    int get_entity_cell_size() const;
+    void set_entity_cell_size(int entity_cell_size);
+    bool has_activity_distance() const;
+    int get_activity_distance() const;
+    void set_activity_distance(int activity_distance);
+    bool has_chunk_size() const;
+    int get_chunk_size() const;
+    void set_chunk_size(int chunk_size);
 
     int get_num_entities() const;
     int get_num_entities(int layer) const;
@@ -188,7 +198,14 @@ class SOLARUS_API MapData : public LuaData {
     virtual bool import_from_lua(lua_State* l) override;
     virtual bool export_to_lua(std::ostream& out) const override;
 
+    virtual std::string get_binary_magic() const override;
+    virtual uint32_t get_binary_format_version() const override;
+    virtual bool import_from_binary(BinaryReader& reader) override;
+    virtual bool export_to_binary(BinaryWriter& writer) const override;
+
     static constexpr int NO_FLOOR = -9999;  /**< Represents a non-existent floor (nil in Lua data files). */
+    static constexpr uint32_t
+        binary_format_version = 4;          /**< Version of the binary map format written. */
 
   private:
 
@@ -203,6 +220,12 @@ class SOLARUS_API MapData : public LuaData {
     int floor;                    /**< Floor of the map or NO_FLOOR. */
     std::string tileset_id;       /**< Tileset to use as skin for the map. */
     std::string music_id;         /**< Background music id or "none" or "same". */
+    int entity_cell_size;         /**< Side of the grid cells used to locate
+                                   * entities, or 0 to use a quadtree. */
+    int activity_distance;        /**< Distance from the camera beyond which
+                                   * entities are dormant, or 0 for none. */
+    int chunk_size;               /**< Side of the chunks used to stream
+                                   * entities, or 0 to create them all. */
 
     std::map<int, EntityDataList>
         entities;                 /**< The entities on each layer. */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MAP_OVERVIEW_H
+#define SOLARUS_MAP_OVERVIEW_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Color;
+class Map;
+
+/**
+ * \brief A small image of a map for minimaps, with an optional fog of war.
+ *
+ * Each 8x8 square of the map is one pixel of the overview, whose color
+ * depends on the ground of the highest non-empty tile at this place.
+ * The image is computed from the grounds of tiles, so it costs nothing
+ * more than reading these grounds once, and it does not depend on which
+ * parts of the map were drawn.
+ *
+ * When the fog of war is enabled, squares are hidden until they are
+ * revealed, either explicitly or automatically in a radius around the hero.
+ * Only the squares that change are written again to the surface,
+ * and only their rectangle is uploaded to the GPU.
+ */
+class SOLARUS_API MapOverview {
+
+  public:
+
+    explicit MapOverview(Map& map);
+
+    const SurfacePtr& get_surface();
+
+    bool is_fog_enabled() const;
+    int get_reveal_radius() const;
+    void set_reveal_radius(int reveal_radius);
+    void disable_fog();
+
+    bool is_revealed(const Point& xy) const;
+    void reveal(const Point& xy, int radius);
+    std::string get_revealed_squares() const;
+    void set_revealed_squares(const std::string& revealed_squares);
+
+    void update();
+
+    static constexpr int square_size = 8;   /**< Size of the map square of each pixel. */
+
+  private:
+
+    Color get_square_color(int square_x, int square_y) const;
+    void add_dirty_squares(const Rectangle& squares);
+    void update_surface();
+
+    Map& map;                               /**< The map. */
+    int width8;                             /**< Width of the overview in squares. */
+    int height8;                            /**< Height of the overview in squares. */
+    bool fog_enabled;                       /**< Whether squares not revealed are hidden. */
+    int reveal_radius;                      /**< Distance revealed around the hero in pixels,
+                                             * or 0 to only reveal squares explicitly. */
+    std::vector<bool> revealed;             /**< Whether each square is revealed. */
+    Point hero_square;                      /**< Square of the hero at the last reveal. */
+    SurfacePtr surface;                     /**< The overview image, created on demand. */
+    Rectangle dirty_squares;                /**< Squares to write again to the surface. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MEMORY_STATS_H
+#define SOLARUS_MEMORY_STATS_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class LuaContext;
+
+/**
+ * \brief Memory used by each part of the engine.
+ *
+ * Counters are maintained by the classes that own the memory, when they
+ * allocate or release it, so reading them costs nothing. Textures are
+ * attributed to the origin marked on the current thread when they are
+ * created.
+ *
+ * Sizes are estimates: they count pixels, samples and objects, not the
+ * overhead of the allocator or of the graphics driver.
+ */
+class SOLARUS_API MemoryStats {
+
+  public:
+
+    /**
+     * \brief Kinds of memory counted separately.
+     */
+    enum class Category {
+      TILESET_TEXTURES,   /**< Images of tilesets and pre-drawn tiles. */
+      SPRITE_TEXTURES,    /**< Images of sprites. */
+      TEXT_TEXTURES,      /**< Rendered texts and glyphs. */
+      SCRIPT_TEXTURES,    /**< Surfaces created by sol.surface.create(). */
+      OTHER_TEXTURES,     /**< Textures of no other category. */
+      SOUND_BUFFERS,      /**< Decoded sounds. */
+      ENTITIES,           /**< Map entity objects. */
+      QUADTREE_NODES      /**< Nodes of quadtrees. */
+    };
+
+    static constexpr int num_categories = 8;  /**< Number of values of Category. */
+
+    /**
+     * \brief Memory currently used in a category.
+     */
+    struct Counters {
+      int64_t num_bytes = 0;        /**< Bytes allocated. */
+      int64_t num_objects = 0;      /**< Objects alive. */
+    };
+
+    /**
+     * \brief A line of a memory report.
+     */
+    struct Entry {
+      std::string name;             /**< Name of the category, like "sprite_textures". */
+      int64_t num_bytes;            /**< Bytes used. */
+      int64_t num_objects;          /**< Objects alive, or 0 if not counted. */
+    };
+
+    /**
+     * \brief Attributes textures created by the current thread to a
+     * category during its lifetime.
+     */
+    class TextureOrigin {
+
+      public:
+
+        explicit TextureOrigin(Category category);
+        ~TextureOrigin();
+
+        TextureOrigin(const TextureOrigin& other) = delete;
+        TextureOrigin& operator=(const TextureOrigin& other) = delete;
+
+      private:
+
+        Category previous_category;   /**< Origin to restore at the end. */
+    };
+
+    static const std::string& get_category_name(Category category);
+    static Category get_texture_category();
+
+    static void add(Category category, int64_t num_bytes);
+    static void remove(Category category, int64_t num_bytes);
+    static Counters get_counters(Category category);
+
+    static std::vector<Entry> get_report(LuaContext& lua_context);
+
+};
+
+}
+
+#endif
+
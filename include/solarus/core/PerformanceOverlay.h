@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PERFORMANCE_OVERLAY_H
+#define SOLARUS_PERFORMANCE_OVERLAY_H
+
+#include "solarus/core/Common.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class FrameTimings;
+class Game;
+class LuaContext;
+class TextSurface;
+
+/**
+ * \brief Performance numbers drawn by the engine over the quest screen.
+ *
+ * Shows a graph of the update and draw time of the last frames,
+ * entity counts by type, timers, Lua memory, texture memory, draw calls
+ * and the cost of music decoding,
+ * so that performance issues can be reported with numbers.
+ * It does not depend on quest scripts and is toggled with Ctrl+F12.
+ *
+ * Texts use the default font of the quest. Without fonts, only the graph is
+ * shown.
+ */
+class SOLARUS_API PerformanceOverlay {
+
+  public:
+
+    PerformanceOverlay();
+
+    bool is_visible() const;
+    void set_visible(bool visible);
+
+    void draw(
+        const SurfacePtr& dst_surface,
+        const FrameTimings& frame_timings,
+        LuaContext& lua_context,
+        Game* game
+    );
+
+  private:
+
+    std::vector<std::string> compute_lines(
+        const FrameTimings& frame_timings,
+        LuaContext& lua_context,
+        Game* game
+    ) const;
+    void rebuild_panel(const std::vector<std::string>& lines, const FrameTimings& frame_timings);
+
+    static constexpr int graph_width = 120;       /**< Number of frames in the graph (one pixel each). */
+    static constexpr int graph_height = 32;       /**< Height of the graph in pixels. */
+    static constexpr double graph_max_time = 33.3;  /**< Duration at the top of the graph (milliseconds). */
+    static constexpr int refresh_interval = 15;   /**< Number of frames between two updates of the numbers. */
+    static constexpr int margin = 2;              /**< Space around the graph and texts in pixels. */
+
+    bool visible;                                 /**< Whether the overlay is drawn. */
+    int num_frames_drawn;                         /**< Frames drawn since the overlay became visible. */
+    bool texts_enabled;                           /**< \c false if the quest has no font. */
+    std::vector<std::shared_ptr<TextSurface>>
+        line_surfaces;                            /**< One text surface per line of numbers. */
+    SurfacePtr panel;                             /**< Graph and texts on a translucent background. */
+
+};
+
+}
+
+#endif
+
@@ -32,6 +32,9 @@ class Surface;
  *
  * This class stores efficiently the location of the non-transparent pixels of a surface.
  * For each pixel of the image, a bit indicates whether this pixel is transparent.
+ * Rows are stored contiguously as 64-bit words, with the leftmost pixel in
+ * the most significant bit, and each row remembers the range of its opaque
+ * pixels so that most rows are rejected without looking at their bits.
  * This class perform fast pixel-perfect collision checks.
  */
 class PixelBits {
@@ -45,17 +48,29 @@ class PixelBits {
 
   private:
 
+    /**
+     * \brief Range of the opaque pixels of a row.
+     */
+    struct RowSpan {
+      int first;    /**< X of the first opaque pixel. */
+      int end;      /**< X after the last opaque pixel (equal to first if none). */
+    };
+
+    uint64_t get_bits(int row, int x) const;
+
     void print() const;
-    void print_mask(uint32_t mask) const;
+    void print_mask(uint64_t mask) const;
 
     int width;               /**< width of the image in pixels */
     int height;              /**< height of the image in pixels */
-    int nb_integers_per_row; /**< number of uint32_t necessary to store
-                              * the bits of a row of the image */
+    int nb_words_per_row;    /**< number of uint64_t storing a row of the image,
+                              * including a padding word */
 
-    std::vector<std::vector<uint32_t>>
-        bits;                /**< A two-dimensional array representing the
-                              * transparency bit of each pixel in the image. */
+    std::vector<uint64_t>
+        bits;                /**< The transparency bit of each pixel in the image,
+                              * one row after the other. */
+    std::vector<RowSpan>
+        row_spans;           /**< Opaque pixels of each row. */
 
 };
 
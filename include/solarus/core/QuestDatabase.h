@@ -21,9 +21,12 @@
 #include "solarus/core/EnumInfo.h"
 #include "solarus/core/ResourceType.h"
 #include "solarus/lua/LuaData.h"
+#include <cstdint>
 #include <iosfwd>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Solarus {
 
@@ -40,6 +43,9 @@ struct SOLARUS_API EnumInfoTraits<ResourceType> {
  * This class stores the content of a quest database file
  * project_db.dat.
  * It does not create, remove or rename any file.
+ *
+ * Element ids are also hashed and interned into numeric ids,
+ * so that checking whether an element exists does not compare strings.
  */
 class SOLARUS_API QuestDatabase : public LuaData {
 
@@ -50,6 +56,16 @@ class SOLARUS_API QuestDatabase : public LuaData {
      */
     using ResourceMap = std::map<std::string, std::string>;
 
+    /**
+     * Numeric id of a resource element, unique in its resource type.
+     * An element keeps the same numeric id until clear() is called,
+     * even if it is removed and added again.
+     */
+    using ResourceId = uint32_t;
+
+    static constexpr ResourceId
+        invalid_resource_id = 0xffffffff;  /**< Numeric id of no element. */
+
     /**
      * Information about a file of the quest.
      */
@@ -68,12 +84,10 @@ class SOLARUS_API QuestDatabase : public LuaData {
     void clear();
 
     bool resource_exists(ResourceType resource_type, const std::string& id) const;
+    ResourceId get_resource_id(ResourceType resource_type, const std::string& id) const;
     const ResourceMap& get_resource_elements(
         ResourceType resource_type
     ) const;
-    ResourceMap& get_resource_elements(
-        ResourceType resource_type
-    );
 
     bool add(
         ResourceType resource_type,
@@ -109,7 +123,21 @@ class SOLARUS_API QuestDatabase : public LuaData {
 
   private:
 
-    std::map<ResourceType, ResourceMap> resource_maps;
+    /**
+     * \brief Numeric ids of the elements of a resource type.
+     */
+    struct ResourceIndex {
+      std::unordered_map<std::string, ResourceId>
+          ids;                        /**< Numeric id of each element declared so far. */
+      std::vector<bool> declared;     /**< Whether each numeric id is currently declared. */
+    };
+
+    ResourceMap& get_resource_map(ResourceType resource_type);
+
+    std::vector<ResourceMap>
+        resource_maps;                /**< Elements and descriptions, indexed by resource type. */
+    std::vector<ResourceIndex>
+        resource_indexes;             /**< Numeric ids, indexed by resource type. */
     std::map<std::string, FileInfo> files;
 
 };
@@ -18,10 +18,14 @@
 #define SOLARUS_QUEST_FILES_H
 
 #include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 struct lua_State;
+struct SDL_RWops;
 
 namespace Solarus {
 
@@ -50,6 +54,35 @@ enum class DataFileLocation {
   LOCATION_WRITE_DIRECTORY,
 };
 
+/**
+ * \brief Read-only content of a data file.
+ *
+ * Files of the data directory are memory-mapped when the system allows it.
+ * Other files are read into memory.
+ */
+class SOLARUS_API DataFileBuffer {
+
+  public:
+
+    explicit DataFileBuffer(std::string&& content);
+    DataFileBuffer(void* mapping, size_t mapping_size);
+    ~DataFileBuffer();
+
+    DataFileBuffer(const DataFileBuffer& other) = delete;
+    DataFileBuffer& operator=(const DataFileBuffer& other) = delete;
+
+    const char* data() const;
+    size_t size() const;
+    bool is_mapped() const;
+
+  private:
+
+    std::string content;        /**< The content when it was read into memory. */
+    void* mapping;              /**< The mapped memory, or nullptr. */
+    size_t mapping_size;        /**< Size of the mapped memory. */
+
+};
+
 // Initialization.
 SOLARUS_API bool open_quest(
     const std::string& program_name,
@@ -67,16 +100,39 @@ SOLARUS_API bool data_file_exists(
     const std::string& file_name,
     bool language_specific = false
 );
+SOLARUS_API int64_t data_file_get_modification_date(
+    const std::string& file_name
+);
 SOLARUS_API std::string data_file_read(
     const std::string& file_name,
     bool language_specific = false
 );
+SOLARUS_API std::shared_ptr<const DataFileBuffer> data_file_map(
+    const std::string& file_name,
+    bool language_specific = false
+);
+SOLARUS_API SDL_RWops* data_file_open_rw(
+    const std::string& file_name,
+    bool language_specific = false
+);
 SOLARUS_API void data_file_save(
     const std::string& file_name,
     const std::string& buffer
 );
+SOLARUS_API bool data_file_replace(
+    const std::string& file_name,
+    const std::string& buffer
+);
+SOLARUS_API bool data_file_append(
+    const std::string& file_name,
+    const std::string& buffer
+);
 SOLARUS_API bool data_file_delete(const std::string& file_name);
 SOLARUS_API bool data_file_mkdir(const std::string& dir_name);
+SOLARUS_API bool mount_patch(
+    const std::string& file_name,
+    std::vector<std::string>& overridden_files
+);
 
 // Writing files.
 SOLARUS_API std::string get_base_write_dir();
@@ -89,6 +145,11 @@ SOLARUS_API std::string get_full_quest_write_dir();
 SOLARUS_API std::string create_temporary_file(const std::string& content);
 SOLARUS_API bool remove_temporary_files();
 
+// Startup manifest.
+SOLARUS_API bool prefetch_files(const std::string& manifest_file_name);
+SOLARUS_API void start_manifest_recording(uint32_t duration);
+SOLARUS_API bool save_manifest(const std::string& file_name);
+
 }  // namespace QuestFiles
 
 }  // namespace Solarus
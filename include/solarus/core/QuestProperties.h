@@ -72,6 +72,37 @@ class SOLARUS_API QuestProperties : public LuaData {
     void set_min_quest_size(const Size& min_quest_size);
     Size get_max_quest_size() const;
     void set_max_quest_size(const Size& max_quest_size);
+    int get_lua_gc_step_time() const;
+    void set_lua_gc_step_time(int lua_gc_step_time);
+    int get_lua_gc_pause() const;
+    void set_lua_gc_pause(int lua_gc_pause);
+    int get_lua_gc_step_multiplier() const;
+    void set_lua_gc_step_multiplier(int lua_gc_step_multiplier);
+    int get_lua_memory_limit() const;
+    void set_lua_memory_limit(int lua_memory_limit);
+    bool is_collision_broad_phase_enabled() const;
+    void set_collision_broad_phase_enabled(bool collision_broad_phase);
+    bool is_compact_textures_enabled() const;
+    void set_compact_textures_enabled(bool compact_textures);
+    bool are_position_notifications_batched() const;
+    void set_position_notifications_batched(bool batch_position_notifications);
+    int get_sound_streaming_duration() const;
+    void set_sound_streaming_duration(int sound_streaming_duration);
+    std::string get_vsync() const;
+    void set_vsync(const std::string& vsync);
+    int get_draw_rate() const;
+    void set_draw_rate(int draw_rate);
+    bool are_movements_deterministic() const;
+    void set_movements_deterministic(bool deterministic_movements);
+    std::string get_background_mode() const;
+    void set_background_mode(const std::string& background_mode);
+
+    static constexpr int
+        default_lua_gc_step_time = 2;         /**< Default GC time per frame in ms. */
+    static constexpr int
+        default_lua_gc_pause = 200;           /**< Default GC pause in percent. */
+    static constexpr int
+        default_lua_gc_step_multiplier = 200; /**< Default GC step multiplier in percent. */
 
   private:
 
@@ -91,6 +122,40 @@ class SOLARUS_API QuestProperties : public LuaData {
     Size normal_quest_size;            /**< Default quest size. */
     Size min_quest_size;               /**< Minimum quest size. */
     Size max_quest_size;               /**< Maximum quest size. */
+    int lua_gc_step_time;              /**< Maximum time of Lua garbage
+                                        * collection per frame in milliseconds,
+                                        * or 0 to let Lua collect by itself. */
+    int lua_gc_pause;                  /**< Memory growth in percent before
+                                        * a new garbage collection cycle. */
+    int lua_gc_step_multiplier;        /**< Speed of garbage collection
+                                        * relative to allocation in percent. */
+    int lua_memory_limit;              /**< Maximum size of the Lua heap in KiB,
+                                        * or 0 for no limit. */
+    bool collision_broad_phase;        /**< Whether collisions with detectors
+                                        * are checked once per cycle
+                                        * instead of at each move. */
+    bool compact_textures;             /**< Whether large opaque images may
+                                        * use 16-bit textures. */
+    bool batch_position_notifications; /**< Default for movements: whether
+                                        * Lua position events are sent once
+                                        * per update instead of at each move. */
+    int sound_streaming_duration;      /**< Sounds at least this long in
+                                        * milliseconds stay compressed and
+                                        * are decoded while playing,
+                                        * 0 to decode all sounds fully. */
+    std::string vsync;                 /**< Synchronization of presented frames
+                                        * with the display: "on", "adaptive"
+                                        * or "off". */
+    int draw_rate;                     /**< Maximum number of draws per second,
+                                        * 0 to draw after each simulation
+                                        * step or display refresh. */
+    bool deterministic_movements;      /**< Whether movements use
+                                        * trigonometry lookup tables
+                                        * that give the same results
+                                        * on all platforms. */
+    std::string background_mode;       /**< What the main loop does while
+                                        * the window is unfocused or hidden:
+                                        * "continue", "throttle" or "pause". */
 
 };
 
@@ -18,17 +18,80 @@
 #define SOLARUS_RANDOM_H
 
 #include "solarus/core/Common.h"
+#include <cstdint>
 
 namespace Solarus {
 
 /**
  * \brief Provides some functions to compute random numbers.
+ *
+ * Numbers come from the generator of the calling thread, unless a stream
+ * is made current with a StreamScope.
  */
 namespace Random {
 
+/**
+ * \brief An independent sequence of random numbers.
+ *
+ * The n-th number of a stream only depends on its key and on n:
+ * it is a hash of both (a splitmix64 finalizer).
+ * Streams have no shared state, so they can be used from any thread
+ * without locks, and the numbers of a stream do not depend on how other
+ * streams are used.
+ */
+class SOLARUS_API Stream {
+
+  public:
+
+    Stream();
+    explicit Stream(uint64_t key);
+
+    uint64_t get_key() const;
+    uint64_t get_counter() const;
+
+    uint32_t get_raw();
+    int get_number(unsigned int x);
+    int get_number(int x, int y);
+
+  private:
+
+    uint64_t key;          /**< Identifies the sequence. */
+    uint64_t counter;      /**< Number of values produced so far. */
+
+};
+
+/**
+ * \brief Makes a stream current for the calling thread during its lifetime.
+ *
+ * Random::get_number() then takes its numbers from this stream.
+ * Scopes can be nested.
+ */
+class SOLARUS_API StreamScope {
+
+  public:
+
+    explicit StreamScope(Stream& stream);
+    ~StreamScope();
+
+    StreamScope(const StreamScope& other) = delete;
+    StreamScope& operator=(const StreamScope& other) = delete;
+
+  private:
+
+    Stream* previous_stream;   /**< The stream current before this scope. */
+
+};
+
 void initialize();
 void quit();
 
+uint32_t get_seed();
+void set_seed(uint32_t new_seed);
+uint32_t get_state_hash();
+
+uint64_t create_key();
+uint64_t derive_key(uint64_t key, uint64_t id);
+
 int get_number(unsigned int x);
 int get_number(int x, int y);
 
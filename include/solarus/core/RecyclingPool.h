@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_RECYCLING_POOL_H
+#define SOLARUS_RECYCLING_POOL_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Solarus {
+
+/**
+ * \brief Keeps freed memory blocks of small sizes for the next allocations
+ * of the same size.
+ *
+ * Objects created and destroyed very often, like states and movements of
+ * the hero, take their memory here instead of the heap, so that after
+ * a few transitions they don't allocate anymore.
+ * Objects are still constructed and destroyed normally: only their memory
+ * is reused.
+ *
+ * Each thread has its own blocks, so this can be used from any thread.
+ * A block freed by another thread than the one that allocated it just
+ * goes to the blocks of that other thread.
+ */
+class SOLARUS_API RecyclingPool {
+
+  public:
+
+    static void* allocate(std::size_t size);
+    static void deallocate(void* block, std::size_t size);
+
+    static std::size_t get_num_free_blocks();
+    static void clear();
+
+    static constexpr std::size_t
+        granularity = 16;             /**< Sizes are rounded up to a multiple of this. */
+    static constexpr std::size_t
+        max_block_size = 1024;        /**< Bigger blocks always come from the heap. */
+    static constexpr std::size_t
+        max_free_blocks_per_size = 8; /**< Freed blocks kept for each size. */
+
+};
+
+/**
+ * \brief Standard allocator whose memory comes from RecyclingPool.
+ *
+ * Use it with std::allocate_shared() to reuse the memory of a shared object
+ * and of its control block.
+ */
+template<typename T>
+class RecyclingAllocator {
+
+  public:
+
+    using value_type = T;
+
+    RecyclingAllocator() = default;
+    template<typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>& /* other */) {}
+
+    T* allocate(std::size_t n) {
+      return static_cast<T*>(RecyclingPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* block, std::size_t n) {
+      RecyclingPool::deallocate(block, n * sizeof(T));
+    }
+
+};
+
+template<typename T, typename U>
+bool operator==(const RecyclingAllocator<T>&, const RecyclingAllocator<U>&) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const RecyclingAllocator<T>&, const RecyclingAllocator<U>&) {
+  return false;
+}
+
+/**
+ * \brief Like std::make_shared(), but with memory from RecyclingPool.
+ * \param args Arguments of the constructor of T.
+ * \return The object created.
+ */
+template<typename T, typename... Args>
+std::shared_ptr<T> make_recycled_shared(Args&&... args) {
+  return std::allocate_shared<T>(RecyclingAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}
+
+#endif
+
@@ -17,36 +17,133 @@
 #ifndef SOLARUS_RESOURCE_PROVIDER_H
 #define SOLARUS_RESOURCE_PROVIDER_H
 
+#include "solarus/containers/ResourceCache.h"
 #include "solarus/core/Common.h"
 #include "solarus/core/ResourceType.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/TilePattern.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
+
+struct SDL_Surface;
 
 namespace Solarus {
 
+class MapData;
+class SpriteAnimationSet;
+class SpriteData;
+class ThreadPool;
+class TilesetData;
+
 /**
  * \brief Provides fast access to quest resources.
  *
  * Maintains a cache of already loaded quest resources
- * so that next accesses are faster.
+ * so that next accesses are faster:
+ * map data, tilesets, sprite animation sets and decoded images.
+ *
+ * All caches share a memory budget. When it is exceeded, the least recently
+ * used elements that are no longer used elsewhere are evicted,
+ * whatever their type.
+ *
+ * Maps can also be preloaded: their data file, their tileset data file,
+ * the data files of the sprites they use and the images of these sprites
+ * are parsed and decoded on a separate thread. Textures are created later
+ * on the main thread, when the map is actually loaded.
+ *
+ * Sprites of a map that is loaded without preloading are parsed and decoded
+ * in parallel on worker threads before its entities are created.
+ *
+ * Maps likely to be visited next can also be prefetched: they are preloaded
+ * one at a time in the background and put in the caches as soon as they are
+ * ready, as long as the caches use less than a part of the memory budget.
  */
 class SOLARUS_API ResourceProvider {
 
   public:
 
+    static constexpr size_t default_memory_budget = 128 * 1024 * 1024;  /**< 128 MiB. */
+
     ResourceProvider();
+    ~ResourceProvider();
+
+    ResourceProvider(const ResourceProvider& other) = delete;
+    ResourceProvider& operator=(const ResourceProvider& other) = delete;
 
-    const Tileset& get_tileset(const std::string& tileset_id);
-    // TODO other types of resources
+    static ResourceProvider* get_instance();
+
+    std::shared_ptr<const MapData> get_map_data(const std::string& map_id);
+    std::shared_ptr<const Tileset> get_tileset(const std::string& tileset_id);
+    std::shared_ptr<SpriteAnimationSet> get_animation_set(const std::string& animation_set_id);
+    std::shared_ptr<SDL_Surface> get_image(const std::string& image_key);
+    void add_image(const std::string& image_key, const std::shared_ptr<SDL_Surface>& image);
+    void load_animation_sets(const MapData& map_data, ThreadPool& thread_pool);
+
+    void start_preloading_map(const std::string& map_id);
+    bool is_map_preloaded(const std::string& map_id) const;
+    void finish_preloads();
+    void prefetch_maps(const std::vector<std::string>& map_ids);
+    void update();
+
+    size_t get_memory_budget() const;
+    void set_memory_budget(size_t memory_budget);
+    size_t get_memory_size() const;
+    ResourceCacheStatistics get_statistics(ResourceType resource_type) const;
+    ResourceCacheStatistics get_image_statistics() const;
 
     void invalidate_resource_element(ResourceType resource_type, const std::string& element_id);
+    void notify_file_changed(const std::string& file_name);
+    void clear();
 
   private:
 
-    std::map<std::string, std::unique_ptr<Tileset>> tileset_cache;          /**< Cache of loaded tilesets. */
+    /**
+     * \brief Data files of a map parsed in advance.
+     */
+    struct PreloadedMap {
+      std::shared_ptr<MapData> map_data;                    /**< The map data, or nullptr if it failed. */
+      std::shared_ptr<TilesetData> tileset_data;            /**< Its tileset data, or nullptr. */
+      std::map<std::string, std::shared_ptr<SpriteData>>
+          sprites_data;                                     /**< Data of sprites used by entities. */
+      std::map<std::string, std::shared_ptr<SDL_Surface>>
+          images;                                           /**< Decoded images of these sprites. */
+    };
+
+    static std::shared_ptr<PreloadedMap> preload_map(const std::string& map_id);
+    std::shared_ptr<MapData> get_preloaded_map_data(const std::string& map_id);
+
+    void add_tileset(const std::string& tileset_id, const std::shared_ptr<Tileset>& tileset);
+    void add_animation_set(
+        const std::string& animation_set_id,
+        const std::shared_ptr<SpriteAnimationSet>& animation_set
+    );
+    void enforce_memory_budget();
+
+    static constexpr int max_prefetched_maps = 4;            /**< Maps queued by prefetch_maps() at most. */
+    static constexpr size_t prefetch_memory_ratio = 2;        /**< Prefetching stops when caches use more
+                                                               * than the budget divided by this. */
+
+    static ResourceProvider* instance;                        /**< The provider used by sprites and
+                                                               * surfaces, or nullptr. */
+
+    ResourceCache<const MapData> map_data_cache;              /**< Cache of parsed map data files. */
+    ResourceCache<Tileset> tileset_cache;                     /**< Cache of loaded tilesets. */
+    ResourceCache<SpriteAnimationSet> animation_set_cache;    /**< Cache of loaded sprite animation sets. */
+    ResourceCache<SDL_Surface> image_cache;                   /**< Cache of decoded images. */
+    uint64_t clock;                                           /**< Incremented at each access,
+                                                               * dates the uses of elements. */
+    size_t memory_budget;                                     /**< Memory allowed for all caches in bytes. */
+    std::map<std::string, std::future<std::shared_ptr<PreloadedMap>>>
+        map_preloads;                                         /**< Maps being parsed or parsed
+                                                               * in advance and not used yet. */
+    std::deque<std::string> prefetch_queue;                   /**< Maps to prefetch next, most likely first. */
+    std::string prefetching_map_id;                           /**< Map being prefetched, or an empty string. */
 };
 
 }
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_RESOURCE_WATCHER_H
+#define SOLARUS_RESOURCE_WATCHER_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Detects data files of the quest modified while the program runs.
+ *
+ * Only works when the quest is a data directory, not an archive.
+ * Modification dates are polled a few files at each update, so that
+ * watching a large quest does not cost a long frame.
+ * The directory tree is listed again at the start of each round,
+ * so that new files are watched too.
+ */
+class SOLARUS_API ResourceWatcher {
+
+  public:
+
+    ResourceWatcher();
+
+    bool is_enabled() const;
+    void set_enabled(bool enabled);
+
+    std::vector<std::string> update();
+
+  private:
+
+    void list_files();
+    void list_directory(const std::string& dir_name);
+
+    static constexpr size_t files_per_update = 64;  /**< Files checked at each update. */
+
+    bool enabled;                          /**< Whether files are watched. */
+    std::vector<std::string> file_names;   /**< Files of the current round. */
+    std::map<std::string, int64_t>
+        modification_dates;                /**< Last known date of each file. */
+    size_t next_file_index;                /**< Next file to check in file_names. */
+
+};
+
+}
+
+#endif
+
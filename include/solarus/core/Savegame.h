@@ -20,8 +20,12 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/lua/ExportableToLua.h"
-#include <map>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
 
 struct lua_State;
 
@@ -41,49 +45,86 @@ class SOLARUS_API Savegame: public ExportableToLua {
 
     static const int SAVEGAME_VERSION;  /**< Version number of the savegame file format. */
 
+    /**
+     * \brief Identifies the name of a saved value.
+     *
+     * Names are interned the first time they are used, so that accessing
+     * a value does not compare strings.
+     * Built-in keys have ids known at compile time.
+     */
+    class SOLARUS_API Key {
+
+      public:
+
+        Key();
+        explicit Key(uint32_t id);
+
+        uint32_t get_id() const;
+        bool is_valid() const;
+        const std::string& get_name() const;
+        operator const std::string&() const;
+
+      private:
+
+        uint32_t id;          /**< Index of the name in the interned names. */
+
+    };
+
+    static Key get_key(const std::string& name);
+    static bool find_key(const std::string& name, Key& key);
+
+    /**
+     * \brief Function called when a watched value has changed.
+     *
+     * It receives the key of the value and returns \c false to stop
+     * watching it.
+     */
+    using ValueWatcher = std::function<bool(const Key& key)>;
+    using ValueWatcherPtr = std::shared_ptr<ValueWatcher>;
+
     // Keys to built-in values saved.
-    static const std::string KEY_SAVEGAME_VERSION;
-    static const std::string KEY_STARTING_MAP;
-    static const std::string KEY_STARTING_POINT;
-    static const std::string KEY_KEYBOARD_ACTION;
-    static const std::string KEY_KEYBOARD_ATTACK;
-    static const std::string KEY_KEYBOARD_ITEM_1;
-    static const std::string KEY_KEYBOARD_ITEM_2;
-    static const std::string KEY_KEYBOARD_PAUSE;
-    static const std::string KEY_KEYBOARD_RIGHT;
-    static const std::string KEY_KEYBOARD_UP;
-    static const std::string KEY_KEYBOARD_LEFT;
-    static const std::string KEY_KEYBOARD_DOWN;
-    static const std::string KEY_JOYPAD_ACTION;
-    static const std::string KEY_JOYPAD_ATTACK;
-    static const std::string KEY_JOYPAD_ITEM_1;
-    static const std::string KEY_JOYPAD_ITEM_2;
-    static const std::string KEY_JOYPAD_PAUSE;
-    static const std::string KEY_JOYPAD_RIGHT;
-    static const std::string KEY_JOYPAD_UP;
-    static const std::string KEY_JOYPAD_LEFT;
-    static const std::string KEY_JOYPAD_DOWN;
-    static const std::string KEY_CURRENT_LIFE;
-    static const std::string KEY_CURRENT_MONEY;
-    static const std::string KEY_CURRENT_MAGIC;
-    static const std::string KEY_MAX_LIFE;
-    static const std::string KEY_MAX_MONEY;
-    static const std::string KEY_MAX_MAGIC;
-    static const std::string KEY_ITEM_SLOT_1;
-    static const std::string KEY_ITEM_SLOT_2;
-    static const std::string KEY_ABILITY_TUNIC;
-    static const std::string KEY_ABILITY_SWORD;
-    static const std::string KEY_ABILITY_SWORD_KNOWLEDGE;
-    static const std::string KEY_ABILITY_SHIELD;
-    static const std::string KEY_ABILITY_LIFT;
-    static const std::string KEY_ABILITY_SWIM;
-    static const std::string KEY_ABILITY_JUMP_OVER_WATER;
-    static const std::string KEY_ABILITY_RUN;
-    static const std::string KEY_ABILITY_PUSH;
-    static const std::string KEY_ABILITY_GRAB;
-    static const std::string KEY_ABILITY_PULL;
-    static const std::string KEY_ABILITY_DETECT_WEAK_WALLS;
-    static const std::string KEY_ABILITY_GET_BACK_FROM_DEATH;
+    static const Key KEY_SAVEGAME_VERSION;
+    static const Key KEY_STARTING_MAP;
+    static const Key KEY_STARTING_POINT;
+    static const Key KEY_KEYBOARD_ACTION;
+    static const Key KEY_KEYBOARD_ATTACK;
+    static const Key KEY_KEYBOARD_ITEM_1;
+    static const Key KEY_KEYBOARD_ITEM_2;
+    static const Key KEY_KEYBOARD_PAUSE;
+    static const Key KEY_KEYBOARD_RIGHT;
+    static const Key KEY_KEYBOARD_UP;
+    static const Key KEY_KEYBOARD_LEFT;
+    static const Key KEY_KEYBOARD_DOWN;
+    static const Key KEY_JOYPAD_ACTION;
+    static const Key KEY_JOYPAD_ATTACK;
+    static const Key KEY_JOYPAD_ITEM_1;
+    static const Key KEY_JOYPAD_ITEM_2;
+    static const Key KEY_JOYPAD_PAUSE;
+    static const Key KEY_JOYPAD_RIGHT;
+    static const Key KEY_JOYPAD_UP;
+    static const Key KEY_JOYPAD_LEFT;
+    static const Key KEY_JOYPAD_DOWN;
+    static const Key KEY_CURRENT_LIFE;
+    static const Key KEY_CURRENT_MONEY;
+    static const Key KEY_CURRENT_MAGIC;
+    static const Key KEY_MAX_LIFE;
+    static const Key KEY_MAX_MONEY;
+    static const Key KEY_MAX_MAGIC;
+    static const Key KEY_ITEM_SLOT_1;
+    static const Key KEY_ITEM_SLOT_2;
+    static const Key KEY_ABILITY_TUNIC;
+    static const Key KEY_ABILITY_SWORD;
+    static const Key KEY_ABILITY_SWORD_KNOWLEDGE;
+    static const Key KEY_ABILITY_SHIELD;
+    static const Key KEY_ABILITY_LIFT;
+    static const Key KEY_ABILITY_SWIM;
+    static const Key KEY_ABILITY_JUMP_OVER_WATER;
+    static const Key KEY_ABILITY_RUN;
+    static const Key KEY_ABILITY_PUSH;
+    static const Key KEY_ABILITY_GRAB;
+    static const Key KEY_ABILITY_PULL;
+    static const Key KEY_ABILITY_DETECT_WEAK_WALLS;
+    static const Key KEY_ABILITY_GET_BACK_FROM_DEATH;
 
     // creation and destruction
     Savegame(MainLoop& main_loop, const std::string& file_name);
@@ -92,6 +133,8 @@ class SOLARUS_API Savegame: public ExportableToLua {
     bool is_empty() const;
     void initialize();
     void save();
+    std::shared_future<bool> save_async();
+    static void wait_for_pending_saves();
     const std::string& get_file_name() const;
 
     // data
@@ -106,11 +149,29 @@ class SOLARUS_API Savegame: public ExportableToLua {
     void set_boolean(const std::string& key, bool value);
     bool is_set(const std::string& key) const;
     void unset(const std::string& key);
+    bool is_string(const Key& key) const;
+    std::string get_string(const Key& key) const;
+    void set_string(const Key& key, const std::string& value);
+    bool is_integer(const Key& key) const;
+    int get_integer(const Key& key) const;
+    void set_integer(const Key& key, int value);
+    bool is_boolean(const Key& key) const;
+    bool get_boolean(const Key& key) const;
+    void set_boolean(const Key& key, bool value);
+    bool is_set(const Key& key) const;
+    void unset(const Key& key);
+
+    // watching values
+    void add_value_watcher(const Key& key, const ValueWatcherPtr& watcher);
+    void add_value_watcher(const Key& key, const ValueWatcher& watcher);
+    void remove_value_watcher(const Key& key, const ValueWatcher* watcher);
+    void notify_value_watchers();
 
     void set_initial_values();
     void set_default_keyboard_controls();
     void set_default_joypad_controls();
     void post_process_existing_savegame();
+    uint64_t get_values_hash() const;
 
     // unsaved data
     MainLoop& get_main_loop();
@@ -130,6 +191,7 @@ class SOLARUS_API Savegame: public ExportableToLua {
     struct SavedValue {
 
       enum {
+        VALUE_NONE,
         VALUE_STRING,
         VALUE_INTEGER,
         VALUE_BOOLEAN
@@ -139,7 +201,29 @@ class SOLARUS_API Savegame: public ExportableToLua {
       int int_data;  // Also used for boolean
     };
 
-    std::map<std::string, SavedValue> saved_values;
+    /**
+     * \brief A saved value with its name, copied to be written.
+     */
+    struct NamedValue {
+      const std::string* name;  /**< Interned name, never moved. */
+      SavedValue value;         /**< The value. */
+    };
+
+    /**
+     * \brief A function watching a value.
+     */
+    struct ValueWatcherSlot {
+      std::weak_ptr<ValueWatcher> watcher;  /**< The function. */
+      ValueWatcherPtr owned_watcher;        /**< The function if the savegame
+                                             * owns it, nullptr otherwise. */
+    };
+
+    const SavedValue* get_value(const Key& key) const;
+    SavedValue& get_value_to_set(const Key& key);
+    void notify_value_changed(const Key& key);
+
+    std::vector<SavedValue>
+        saved_values;        /**< Values indexed by the id of their key. */
 
     bool empty;
     std::string file_name;   /**< Savegame file name relative to the quest write directory. */
@@ -147,9 +231,27 @@ class SOLARUS_API Savegame: public ExportableToLua {
     Equipment equipment;
     Game* game;              /**< nullptr if this savegame is not currently running */
 
+    std::vector<std::vector<ValueWatcherSlot>>
+        value_watchers;      /**< Watchers of each value, indexed by the id of its key. */
+    std::vector<Key>
+        changed_keys;        /**< Watched values changed since the last notification. */
+    std::vector<bool>
+        changed_key_flags;   /**< Whether each key is in changed_keys,
+                              * indexed by the id of the key. */
+
     void import_from_file();
+    std::vector<NamedValue> get_named_values() const;
+    static std::string serialize(std::vector<NamedValue>& values);
+    static bool write_values(
+        const std::string& file_name,
+        std::vector<NamedValue> values,
+        const std::shared_future<bool>& previous_save
+    );
     static int l_newindex(lua_State* l);
 
+    static std::shared_future<bool>
+        last_save;           /**< The most recent save started by save_async(). */
+
 };
 
 }
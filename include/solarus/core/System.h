@@ -44,12 +44,14 @@ class SOLARUS_API System {
     static uint32_t get_real_time();
     static void sleep(uint32_t duration);
 
+    static double get_interpolation_factor();
+    static void set_interpolation_factor(double factor);
+
     static constexpr uint32_t timestep = 10;  /**< Timestep added to the simulated time at each update. */
 
   private:
 
     static uint32_t initial_time;         /**< Initial real time in milliseconds. */
-    static uint32_t ticks;                /**< Simulated time in milliseconds. */
 
 };
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_THREAD_POOL_H
+#define SOLARUS_THREAD_POOL_H
+
+#include "solarus/core/Common.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A fixed set of worker threads that run parallel loops.
+ *
+ * The index range of a loop is split into one contiguous range per thread.
+ * A thread that finishes its own range steals the remaining indices
+ * of the other ones, so that uneven workloads stay balanced.
+ *
+ * The calling thread takes part in the work and parallel_for() only returns
+ * when all indices are processed.
+ */
+class SOLARUS_API ThreadPool {
+
+  public:
+
+    explicit ThreadPool(int num_workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    static int get_default_num_workers();
+
+    int get_num_threads() const;
+    void parallel_for(int count, const std::function<void (int)>& function);
+
+  private:
+
+    /**
+     * \brief Indices still to process by one thread.
+     */
+    struct Range {
+      std::atomic<int> next;      /**< Next index to process. */
+      int end;                    /**< End of the range (excluded). */
+    };
+
+    void worker_loop(int thread_index);
+    void run_ranges(int thread_index);
+
+    std::vector<std::thread> workers;   /**< Worker threads (the caller is thread 0). */
+    std::unique_ptr<Range[]> ranges;    /**< One range per thread including the caller. */
+    std::mutex mutex;                   /**< Protects the fields below. */
+    std::condition_variable
+        work_available;                 /**< Signaled when a new loop starts or when stopping. */
+    std::condition_variable
+        work_done;                      /**< Signaled when the last worker finishes a loop. */
+    const std::function<void (int)>*
+        function;                       /**< Body of the current loop. */
+    uint64_t generation;                /**< Incremented at each new loop. */
+    int num_busy_workers;               /**< Workers that did not finish the current loop yet. */
+    bool stopping;                      /**< Whether workers should exit. */
+
+};
+
+}
+
+#endif
+
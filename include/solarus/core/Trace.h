@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_TRACE_H
+#define SOLARUS_TRACE_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Records a timeline of engine scopes in the Chrome trace format.
+ *
+ * Scopes are marked with the SOLARUS_TRACE_SCOPE macros below.
+ * They only exist when the engine is built with the SOLARUS_TRACING option:
+ * otherwise they compile to nothing and no trace is recorded.
+ *
+ * The saved JSON file can be opened with Perfetto (ui.perfetto.dev)
+ * or chrome://tracing.
+ * Events are recorded from any thread, up to a fixed maximum number.
+ */
+class SOLARUS_API Trace {
+
+  public:
+
+    /**
+     * \brief Records a complete event for its lifetime.
+     *
+     * Use the SOLARUS_TRACE_SCOPE macros instead of this class directly.
+     */
+    class Scope {
+
+      public:
+
+#ifdef SOLARUS_TRACING
+        explicit Scope(const char* name);
+        Scope(const char* name, const std::string& detail);
+        ~Scope();
+#else
+        explicit Scope(const char* /* name */) {}
+        Scope(const char* /* name */, const std::string& /* detail */) {}
+#endif
+
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+
+#ifdef SOLARUS_TRACING
+      private:
+
+        const char* name;         /**< Name of the event, valid during the scope. */
+        std::string detail;       /**< Argument shown with the event or an empty string. */
+        double start_time;        /**< Start date in milliseconds,
+                                   * or a negative value if not recording. */
+#endif
+    };
+
+    static bool is_enabled();
+
+    static void start();
+    static void stop();
+    static bool is_recording();
+    static bool save_json(const std::string& file_name);
+
+    static void add_event(
+        const char* name,
+        const std::string& detail,
+        double start_time,
+        double end_time
+    );
+    static void add_counters(
+        const char* name,
+        const std::vector<std::pair<std::string, int64_t>>& values
+    );
+
+};
+
+}
+
+#ifdef SOLARUS_TRACING
+#define SOLARUS_TRACE_CONCAT_IMPL(a, b) a##b
+#define SOLARUS_TRACE_CONCAT(a, b) SOLARUS_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * \brief Records the rest of the enclosing block as a trace event.
+ * \param name Name of the event, a string that lives until the end of the block.
+ */
+#define SOLARUS_TRACE_SCOPE(name) \
+  ::Solarus::Trace::Scope SOLARUS_TRACE_CONCAT(solarus_trace_scope_, __LINE__)(name)
+
+/**
+ * \brief Like SOLARUS_TRACE_SCOPE, with an additional argument like an id.
+ * \param name Name of the event, a string that lives until the end of the block.
+ * \param detail A std::string shown with the event. It is not evaluated
+ * when tracing is disabled.
+ */
+#define SOLARUS_TRACE_SCOPE_DETAIL(name, detail) \
+  ::Solarus::Trace::Scope SOLARUS_TRACE_CONCAT(solarus_trace_scope_, __LINE__)(name, detail)
+#else
+#define SOLARUS_TRACE_SCOPE(name) ((void) 0)
+#define SOLARUS_TRACE_SCOPE_DETAIL(name, detail) ((void) 0)
+#endif
+
+#endif
+
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_WORLD_STATE_HASH_H
+#define SOLARUS_WORLD_STATE_HASH_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class MainLoop;
+
+/**
+ * \brief Hashes the state of the simulation at each tick to compare runs.
+ *
+ * The state is made of the entities of the current map (positions, layers,
+ * directions, states), the savegame values, the timers and the random
+ * number generator.
+ * A run records the hashes to a file, and another run of the same input
+ * replay, with another build or other engine options, checks its hashes
+ * against this reference.
+ * The first tick and the first part of the state that differ are reported,
+ * which validates optimized code paths that must not change the behavior.
+ */
+class SOLARUS_API WorldStateHash {
+
+  public:
+
+    /**
+     * \brief Hash of a part of the world state.
+     */
+    struct Component {
+      std::string name;             /**< Part of the state, like "entity 3 enemy 'bat'". */
+      uint64_t hash;                /**< Hash of this part. */
+    };
+
+    WorldStateHash();
+
+    WorldStateHash(const WorldStateHash& other) = delete;
+    WorldStateHash& operator=(const WorldStateHash& other) = delete;
+
+    bool start_recording(const std::string& file_name);
+    bool start_checking(const std::string& reference_file_name);
+
+    bool is_enabled() const;
+    bool add_tick(const std::vector<Component>& components);
+    const std::string& get_divergence() const;
+
+    static std::vector<Component> compute(MainLoop& main_loop);
+    static uint64_t get_world_hash(const std::vector<Component>& components);
+
+    static uint64_t combine(uint64_t hash, uint64_t value);
+    static uint64_t combine(uint64_t hash, const std::string& value);
+
+    static constexpr uint64_t initial_hash = 14695981039346656037ULL;  /**< Hash of nothing. */
+
+  private:
+
+    bool read_reference_tick(
+        uint64_t& tick,
+        uint64_t& world_hash,
+        std::vector<Component>& components
+    );
+
+    std::ofstream out;                /**< File being recorded or closed. */
+    std::ifstream reference;          /**< File being checked against or closed. */
+    std::string next_reference_line;  /**< Line of the reference read in advance. */
+    uint64_t num_ticks;               /**< Number of ticks hashed so far. */
+    std::string divergence;           /**< Description of the first difference
+                                       * with the reference, or an empty string. */
+
+};
+
+}
+
+#endif
+
@@ -46,7 +46,6 @@ class AnimatedTilePattern: public TilePattern {
         bool parallax);
 
     static void initialize();
-    static void update();
     static void quit();
 
     virtual void draw(
@@ -59,10 +58,9 @@ class AnimatedTilePattern: public TilePattern {
 
   private:
 
-    // static variables to handle the animations of all tiles
-    static int frame_counter;         /**< Frame counter (0 to 11), increased every 250 ms. */
-    static int current_frames[3];     /**< Current frame (0 to 2) for both sequences. */
-    static uint32_t next_frame_date;  /**< Date of the next frame change. */
+    int get_current_frame() const;
+
+    static uint32_t start_date;       /**< Date when all tile animations started. */
 
     const AnimationSequence sequence; /**< Animation sequence type of this tile pattern: 0-1-2-1 or 0-1-2. */
 
@@ -59,6 +59,8 @@ class Camera : public Entity {
     Point get_position_on_screen() const;
     void set_position_on_screen(const Point& position_on_screen);
     Point get_position_to_track(const Point& tracked_xy) const;
+    Point get_interpolated_top_left_xy() const;
+    Rectangle get_interpolated_bounding_box() const;
 
     void start_tracking(const EntityPtr& entity);
     void start_manual();
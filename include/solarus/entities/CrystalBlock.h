@@ -51,10 +51,10 @@ class CrystalBlock: public Entity {
     virtual bool is_obstacle_for(Entity& other) override;
     virtual void notify_collision(Entity& entity_overlapping, CollisionMode collision_mode) override;
 
-    virtual void update() override;
     virtual void draw_on_map() override;
 
     bool is_raised() const;
+    void notify_crystal_state_changed(bool orange_raised);
 
   private:
 
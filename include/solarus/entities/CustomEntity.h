@@ -18,9 +18,13 @@
 #define SOLARUS_CUSTOM_ENTITY_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -39,6 +43,22 @@ class SOLARUS_API CustomEntity: public Entity {
 
     static constexpr EntityType ThisType = EntityType::CUSTOM;
 
+    /**
+     * \brief Declarative collision test evaluated without calling Lua.
+     *
+     * All conditions set must be fulfilled to detect a collision.
+     */
+    struct CollisionRules {
+      CollisionMode mode = COLLISION_NONE;   /**< Built-in test to do, or COLLISION_NONE. */
+      std::set<EntityType> entity_types;     /**< Types to detect, or empty for all types. */
+      bool same_layer = false;               /**< Only detect entities on the same layer. */
+      bool has_layer = false;                /**< Only detect entities on the layer below. */
+      int layer = 0;                         /**< Layer to detect if has_layer is set. */
+      bool has_rectangle = false;            /**< Only detect entities overlapping the rectangle below. */
+      Rectangle rectangle;                   /**< Rectangle relative to the origin of the custom entity. */
+      bool ignore_same_group = false;        /**< Ignore custom entities of the same collision group. */
+    };
+
     CustomEntity(
         Game& game,
         const std::string& name,
@@ -68,22 +88,25 @@ class SOLARUS_API CustomEntity: public Entity {
     // What can traverse this custom entity.
     bool is_traversable_by_entity(Entity& entity);
     void set_traversable_by_entities(bool traversable);
-    void set_traversable_by_entities(const ScopedLuaRef& traversable_test_ref);
+    void set_traversable_by_entities(ScopedLuaRef traversable_test_ref);
     void reset_traversable_by_entities();
     void set_traversable_by_entities(EntityType type, bool traversable);
-    void set_traversable_by_entities(EntityType type, const ScopedLuaRef& traversable_test_ref);
+    void set_traversable_by_entities(EntityType type, ScopedLuaRef traversable_test_ref);
     void reset_traversable_by_entities(EntityType type);
 
     bool is_obstacle_for(Entity& other) override;
 
+    bool is_traversable_cache_enabled() const;
+    void set_traversable_cache_enabled(bool enabled);
+
     // What this custom entity can traverse.
     void set_can_traverse_entities(bool traversable);
-    void set_can_traverse_entities(const ScopedLuaRef& traversable_test_ref);
+    void set_can_traverse_entities(ScopedLuaRef traversable_test_ref);
     void reset_can_traverse_entities();
     void set_can_traverse_entities(EntityType type, bool traversable);
     void set_can_traverse_entities(
         EntityType type,
-        const ScopedLuaRef& traversable_test_ref
+        ScopedLuaRef traversable_test_ref
     );
     void reset_can_traverse_entities(EntityType type);
 
@@ -122,13 +145,19 @@ class SOLARUS_API CustomEntity: public Entity {
     // Collisions.
     void add_collision_test(
         CollisionMode collision_test,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
+    );
+    void add_collision_test(
+        ScopedLuaRef collision_test_ref,
+        ScopedLuaRef callback_ref
     );
     void add_collision_test(
-        const ScopedLuaRef& collision_test_ref,
-        const ScopedLuaRef& callback_ref
+        const CollisionRules& collision_rules,
+        ScopedLuaRef callback_ref
     );
     void clear_collision_tests();
+    const std::string& get_collision_group() const;
+    void set_collision_group(const std::string& collision_group);
 
     bool test_collision_custom(Entity& entity) override;
     void notify_collision(
@@ -184,10 +213,11 @@ class SOLARUS_API CustomEntity: public Entity {
         );
         TraversableInfo(
             LuaContext& lua_context,
-            const ScopedLuaRef& traversable_test_ref
+            ScopedLuaRef traversable_test_ref
         );
 
         bool is_empty() const;
+        bool has_test_function() const;
         bool is_traversable(
             CustomEntity& current_entity,
             Entity& other_entity
@@ -217,16 +247,23 @@ class SOLARUS_API CustomEntity: public Entity {
         CollisionInfo(
             LuaContext& lua_context,
             CollisionMode built_in_test,
-            const ScopedLuaRef& callback_ref
+            ScopedLuaRef callback_ref
+        );
+        CollisionInfo(
+            LuaContext& lua_context,
+            ScopedLuaRef custom_test_ref,
+            ScopedLuaRef callback_ref
         );
         CollisionInfo(
             LuaContext& lua_context,
-            const ScopedLuaRef& custom_test_ref,
-            const ScopedLuaRef& callback_ref
+            const CollisionRules& rules,
+            ScopedLuaRef callback_ref
         );
 
         CollisionMode get_built_in_test() const;
         const ScopedLuaRef& get_custom_test_ref() const;
+        bool has_rules() const;
+        const CollisionRules& get_rules() const;
         const ScopedLuaRef& get_callback_ref() const;
 
       private:
@@ -237,13 +274,34 @@ class SOLARUS_API CustomEntity: public Entity {
                                           * or COLLISION_CUSTOM. */
         ScopedLuaRef custom_test_ref;    /**< Ref to a custom collision test
                                           * or LUA_REFNIL. */
+        bool rules_set;                  /**< Whether the custom test is
+                                          * given by rules instead of Lua. */
+        CollisionRules rules;            /**< Rules of the custom test if any. */
         ScopedLuaRef callback_ref;       /**< Ref to the function to called when
                                           * a collision is detected. */
 
     };
 
+    /**
+     * \brief Result of a traversable test function kept for the current tick.
+     */
+    struct TraversableCacheEntry {
+      uint32_t date = 0;          /**< Simulated time of the result. */
+      bool valid = false;         /**< Whether a result was stored. */
+      bool traversable = false;   /**< The result. */
+    };
+
     const TraversableInfo& get_traversable_by_entity_info(EntityType type);
     const TraversableInfo& get_can_traverse_entity_info(EntityType type);
+    bool test_traversable(
+        const TraversableInfo& info,
+        Entity& other_entity,
+        std::vector<TraversableCacheEntry>& cache
+    );
+    void clear_traversable_caches();
+
+    bool test_collision_built_in(CollisionMode collision_mode, Entity& entity);
+    bool test_collision_rules(const CollisionRules& rules, Entity& entity);
 
     void notify_collision_from(Entity& other_entity);
     void notify_collision_from(Entity& other_entity, Sprite& this_sprite, Sprite& other_sprite);
@@ -262,15 +320,25 @@ class SOLARUS_API CustomEntity: public Entity {
     std::map<EntityType, TraversableInfo>
         can_traverse_entities_type;                   /**< Whether I can traverse entities of a type. */
     std::map<Ground, bool> can_traverse_grounds;      /**< Whether I can traverse each kind of ground. */
+    bool traversable_cache_enabled;                   /**< Whether results of traversable test functions
+                                                       * are reused during a tick for each entity type. */
+    std::vector<TraversableCacheEntry>
+        traversable_by_entities_cache;                /**< Results of traversable_by functions by entity type. */
+    std::vector<TraversableCacheEntry>
+        can_traverse_entities_cache;                  /**< Results of can_traverse functions by entity type. */
 
     // Collisions.
 
-    std::vector<CollisionInfo>
-        collision_tests;               /**< The collision tests to perform. */
-    std::vector<CollisionInfo>
+    std::vector<std::shared_ptr<const CollisionInfo>>
+        collision_tests;               /**< The collision tests to perform.
+                                        * Shared so that iterating on a copy
+                                        * is cheap. */
+    std::vector<std::shared_ptr<const CollisionInfo>>
         successful_collision_tests;    /**< Collision test that detected
                                         * collisions other than
                                         * COLLISION_SPRITE. */
+    std::string collision_group;       /**< Custom entities of the same group
+                                        * can ignore each other in collision rules. */
 
     bool ground_observer;              /**< Whether this custom entity is a ground observer. */
     Ground modified_ground;            /**< The ground defined by this custom
@@ -18,6 +18,7 @@
 #define SOLARUS_DOOR_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Savegame.h"
 #include "solarus/entities/Entity.h"
 #include <map>
 #include <string>
@@ -144,6 +145,9 @@ class Door: public Entity {
     bool initialized;                             /**< \c true if update() was called at least once. */
     uint32_t next_hint_sound_date;                /**< If the player has the ability to detect weak walls,
                                                    * indicates when a hint sound is played next time. */
+    Savegame::ValueWatcherPtr savegame_watcher;   /**< Called when the savegame variable changes. */
+    bool savegame_state_outdated;                 /**< \c true if the savegame variable has changed since
+                                                   * the door state was last compared to it. */
 
 };
 
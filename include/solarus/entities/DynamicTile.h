@@ -57,12 +57,18 @@ class DynamicTile: public Entity {
     Ground get_modified_ground() const override;
     bool is_drawn_at_its_position() const override;
     void draw_on_map() override;
+    void switch_tileset(
+        const Tileset& old_tileset,
+        const Tileset& new_tileset,
+        bool same_patterns
+    );
 
   private:
 
     const std::string tile_pattern_id; /**< Id of the tile pattern. */
-    const TilePattern& tile_pattern;   /**< Pattern of the tile. */
-    const Tileset& tileset;                  /**< Tileet of the pattern. */
+    const int tile_pattern_index;      /**< Interned index of the tile pattern id. */
+    const TilePattern* tile_pattern;   /**< Pattern of the tile. */
+    const Tileset* tileset;            /**< Tileset of the pattern. */
 
 };
 
@@ -24,7 +24,9 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/entities/EntityPtr.h"
 #include "solarus/entities/Explosion.h"
+#include <array>
 #include <map>
+#include <memory>
 #include <string>
 
 namespace Solarus {
@@ -124,20 +126,20 @@ class Enemy: public Entity {
     void set_can_hurt_hero_running(bool can_hurt_hero_running);
     int get_minimum_shield_needed() const;
     void set_minimum_shield_needed(int minimum_shield_needed);
-    EnemyReaction::Reaction get_attack_consequence(
+    const EnemyReaction::Reaction& get_attack_consequence(
         EnemyAttack attack,
         const Sprite* this_sprite) const;
     void set_attack_consequence(
         EnemyAttack attack,
         EnemyReaction::ReactionType reaction,
         int life_lost = 0,
-        const ScopedLuaRef& callback = ScopedLuaRef());
+        ScopedLuaRef callback = ScopedLuaRef());
     void set_attack_consequence_sprite(
         const Sprite& sprite,
         EnemyAttack attack,
         EnemyReaction::ReactionType reaction,
         int life_lost = 0,
-        const ScopedLuaRef& callback = ScopedLuaRef());
+        ScopedLuaRef callback = ScopedLuaRef());
     void set_no_attack_consequences();
     void set_no_attack_consequences_sprite(const Sprite& sprite);
     void set_default_attack_consequences();
@@ -212,6 +214,17 @@ class Enemy: public Entity {
     void notify_immobilized();
     bool is_saved() const;
 
+    // attack consequences
+    static constexpr size_t num_attacks =
+        static_cast<size_t>(EnemyAttack::SCRIPT) + 1;   /**< Number of EnemyAttack values. */
+    using AttackReactions = std::array<EnemyReaction, num_attacks>;
+
+    static const std::shared_ptr<AttackReactions>& get_default_attack_reactions();
+    static std::map<std::string, std::weak_ptr<AttackReactions>>& get_breed_attack_reactions();
+    static bool is_shareable(const AttackReactions& reactions);
+    EnemyReaction& get_attack_reaction_to_modify(EnemyAttack attack);
+    void share_attack_reactions();
+
     // enemy characteristics
     std::string breed;                 /**< breed of the enemy (determines its sprites and behavior) */
 
@@ -227,9 +240,11 @@ class Enemy: public Entity {
     bool can_hurt_hero_running;        /**< indicates that the enemy can attack the hero even when the hero is running */
     int minimum_shield_needed;         /**< shield number needed by the hero to avoid the attack of this enemy,
                                         * or 0 to make the attack unavoidable (default: 0) */
-    std::map<EnemyAttack, EnemyReaction>
-        attack_reactions;              /**< how the enemy reacts to each attack
-                                           * (by default, it depends on the attacks) */
+    std::shared_ptr<AttackReactions>
+        attack_reactions;              /**< how the enemy reacts to each attack, indexed by attack
+                                        * (by default, it depends on the attacks);
+                                        * shared with other enemies and copied before
+                                        * being modified if not unique */
     std::string savegame_variable;     /**< name of the boolean variable indicating whether this enemy is killed,
                                         * or an empty string if it is not saved */
     bool traversable;                  /**< Whether this enemy can be traversed by other entities. */
@@ -20,8 +20,9 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
 #include "solarus/lua/ScopedLuaRef.h"
-#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
@@ -31,6 +32,8 @@ class Sprite;
  * \brief Describes how an enemy reacts when it receives an attack.
  *
  * The reaction may be different between different sprites of the enemy.
+ * Enemies rarely have more than a few sprites, so sprite-specific reactions
+ * are kept in a small list rather than in a map.
  */
 class SOLARUS_API EnemyReaction {
 
@@ -68,14 +71,21 @@ class SOLARUS_API EnemyReaction {
     EnemyReaction();
 
     void set_default_reaction();
-    void set_general_reaction(ReactionType reaction, int life_lost = 0, const ScopedLuaRef& callback = ScopedLuaRef());
-    void set_sprite_reaction(const Sprite* sprite, ReactionType reaction, int life_lost = 0, const ScopedLuaRef& callback = ScopedLuaRef());
+    void set_general_reaction(ReactionType reaction, int life_lost = 0, ScopedLuaRef callback = ScopedLuaRef());
+    void set_sprite_reaction(const Sprite* sprite, ReactionType reaction, int life_lost = 0, ScopedLuaRef callback = ScopedLuaRef());
     const Reaction& get_reaction(const Sprite* sprite) const;
 
+    bool is_shareable() const;
+    bool has_same_reaction(const EnemyReaction& other) const;
+    void copy_shareable(const EnemyReaction& other);
+
   private:
 
+    Reaction& get_sprite_reaction(const Sprite* sprite);
+
     Reaction general_reaction;                             /**< Reaction to make unless there are sprite-specific overrides. */
-    std::map<const Sprite*, Reaction> sprite_reactions;    /**< Sprite-specific reaction (overrides the default one). */
+    std::vector<std::pair<const Sprite*, Reaction>>
+        sprite_reactions;                                  /**< Sprite-specific reactions (override the default one). */
 
 };
 
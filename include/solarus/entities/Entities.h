@@ -18,15 +18,22 @@
 #define SOLARUS_ENTITIES_H
 
 #include "solarus/core/Common.h"
+#include "solarus/containers/Grid.h"
 #include "solarus/containers/Quadtree.h"
+#include "solarus/containers/SpatialHash.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/entities/Camera.h"
 #include "solarus/entities/CameraPtr.h"
 #include "solarus/entities/EntityPtr.h"
 #include "solarus/entities/EntityType.h"
+#include "solarus/entities/EntityStreaming.h"
+#include "solarus/entities/EntityTransforms.h"
+#include "solarus/entities/EntityTypeRange.h"
 #include "solarus/entities/Ground.h"
+#include "solarus/entities/GroundRaster.h"
 #include "solarus/entities/HeroPtr.h"
 #include "solarus/entities/TilePtr.h"
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
@@ -38,11 +45,14 @@
 namespace Solarus {
 
 class Destination;
+class EntityData;
 class Hero;
 class Map;
 class MapData;
 class NonAnimatedRegions;
 class Rectangle;
+class Separator;
+class Sprite;
 class Tileset;
 class TilePattern;
 struct TileInfo;
@@ -51,7 +61,10 @@ using EntityList = std::list<EntityPtr>;
 using EntitySet = std::set<EntityPtr>;
 using EntityVector = std::vector<EntityPtr>;
 using ConstEntityVector = std::vector<ConstEntityPtr>;
+using EntityPointerVector = std::vector<Entity*>;
+using ConstEntityPointerVector = std::vector<const Entity*>;
 using EntityTree = Quadtree<EntityPtr>;
+using EntityGrid = SpatialHash<EntityPtr>;
 
 /**
  * \brief Manages the whole content of a map.
@@ -65,13 +78,19 @@ class SOLARUS_API Entities {
 
   public:
 
+    static constexpr size_t max_cameras = 8;   /**< Maximum number of cameras of a map
+                                                * (one bit each in slots_in_camera). */
+
     // Creation and destruction.
     Entities(Game& game, Map& map);
 
     // Get entities.
     Hero& get_hero();
     const CameraPtr& get_camera() const;
+    const std::vector<CameraPtr>& get_cameras() const;
     Ground get_tile_ground(int layer, int x, int y) const;
+    const GroundRaster& get_ground_raster(int layer) const;
+    uint64_t get_obstacle_generation() const;
     EntityVector get_entities();
     const std::shared_ptr<Destination>& get_default_destination();
 
@@ -86,25 +105,32 @@ class SOLARUS_API Entities {
     bool has_entity_with_prefix(const std::string& prefix) const;
 
     // By type.
-    EntitySet get_entities_by_type(EntityType type);
+    EntityVector get_entities_by_type(EntityType type);
     EntityVector get_entities_by_type_sorted(EntityType type);
-    EntitySet get_entities_by_type(EntityType type, int layer);
+    const EntityVector& get_entities_by_type(EntityType type, int layer) const;
 
-    // By type, template versions to avoid casts.
+    // By type, template versions to avoid casts and copies.
     template<typename T>
-    std::set<std::shared_ptr<const T>> get_entities_by_type() const;
+    EntityTypeRange<const T> get_entities_by_type() const;
     template<typename T>
-    std::set<std::shared_ptr<T>> get_entities_by_type();
+    EntityTypeRange<T> get_entities_by_type();
     template<typename T>
-    std::set<std::shared_ptr<const T>> get_entities_by_type(int layer) const;
+    EntityTypeRange<const T> get_entities_by_type(int layer) const;
     template<typename T>
-    std::set<std::shared_ptr<T>> get_entities_by_type(int layer);
+    EntityTypeRange<T> get_entities_by_type(int layer);
 
     // By coordinates.
     void get_entities_in_rectangle(const Rectangle& rectangle, ConstEntityVector& result) const;
     void get_entities_in_rectangle(const Rectangle& rectangle, EntityVector& result);
     void get_entities_in_rectangle_sorted(const Rectangle& rectangle, ConstEntityVector& result) const;
     void get_entities_in_rectangle_sorted(const Rectangle& rectangle, EntityVector& result);
+    void get_entities_in_rectangle(const Rectangle& rectangle, ConstEntityPointerVector& result) const;
+    void get_entities_in_rectangle(const Rectangle& rectangle, EntityPointerVector& result);
+    void get_entities_in_rectangle_sorted(const Rectangle& rectangle, ConstEntityPointerVector& result) const;
+    int get_num_entities_in_rectangle(const Rectangle& rectangle) const;
+    int get_num_entities_in_rectangle(const Rectangle& rectangle, EntityType type) const;
+    EntityPtr get_first_entity_in_rectangle(const Rectangle& rectangle) const;
+    EntityPtr get_first_entity_in_rectangle(const Rectangle& rectangle, EntityType type) const;
 
     // By separator region.
     void get_entities_in_region(const Point& xy, EntityVector& result);
@@ -113,34 +139,61 @@ class SOLARUS_API Entities {
 
     // Handle entities.
     void create_entities(const MapData& data);
+    void start_creation_batch(const std::vector<EntityData>& entities_data);
+    void finish_creation_batch();
+    bool is_creation_batch_started() const;
     void add_tile_info(const TileInfo& tile);
+    void add_tiles(int layer, const Rectangle& box, const Tileset& tileset, const std::string& pattern_id);
     void add_entity(const EntityPtr& entity);
     void add_tile(const TilePtr& entity);
     void remove_entity(Entity& entity);
     void remove_entity(const std::string& name);
     void remove_entities_with_prefix(const std::string& prefix);
-    int get_entity_relative_z_order(const ConstEntityPtr& entity) const;
+    int get_entity_relative_z_order(const Entity& entity) const;
     void bring_to_front(Entity& entity);
     void bring_to_back(Entity& entity);
     void set_entity_layer(Entity& entity, int layer);
     void notify_entity_bounding_box_changed(Entity& entity);
+    void notify_entity_drawing_order_changed(Entity& entity);
 
     // Specific to some entity types.
-    bool overlaps_raised_blocks(int layer, const Rectangle& rectangle) ;
+    bool overlaps_raised_blocks(int layer, const Rectangle& rectangle) const;
+    void notify_crystal_state_changed();
+    void get_separators_crossing(
+        const Rectangle& rectangle,
+        std::vector<const Separator*>& result
+    ) const;
+
+    // Collisions.
+    bool is_collision_broad_phase_enabled() const;
+    void add_pending_collision_check(Entity& entity);
 
     // Map events.
     void notify_map_started();
     void notify_map_opening_transition_finished();
-    void notify_tileset_changed();
+    void notify_tileset_changed(
+        const Tileset& old_tileset,
+        const Tileset& new_tileset,
+        bool same_patterns
+    );
     void notify_map_finished();
 
     // Game loop.
     void set_suspended(bool suspended);
     void update();
-    void draw();
+    void prepare_drawing();
+    void draw(Camera& camera);
+    void finish_drawing();
 
   private:
 
+    static constexpr int min_parallel_sprites = 32;  /**< Below this number of sprites,
+                                                      * frames are not precomputed in parallel. */
+    static constexpr int quadtree_looseness = 8;     /**< Entities moving by less than this number
+                                                      * of pixels stay in the same quadtree nodes. */
+    static constexpr int static_detector_cell_size = 8;  /**< Side of the grid cells of static
+                                                          * detectors in pixels. */
+
     /**
      * \brief Mapping from layer to a type T.
      */
@@ -150,7 +203,10 @@ class SOLARUS_API Entities {
     /**
      * \brief Ordered list of entities to be drawn.
      */
-    using EntitiesToDraw = std::vector<EntityPtr>;
+    struct EntitiesToDraw {
+      EntityVector entities;      /**< Entities of a layer in drawing order. */
+      bool sorted = true;         /**< Whether the drawing order is up to date. */
+    };
 
     /**
      * \brief Internal fast cached information about the entity insertion order.
@@ -161,30 +217,57 @@ class SOLARUS_API Entities {
 
         ZCache();
 
-        int get_z(const ConstEntityPtr& entity) const;
-        void add(const ConstEntityPtr& entity);
-        void remove(const ConstEntityPtr& entity);
-        void bring_to_front(const ConstEntityPtr& entity);
-        void bring_to_back(const ConstEntityPtr& entity);
+        int get_z(const Entity& entity) const;
+        void add(const Entity& entity);
+        void remove(const Entity& entity);
+        void bring_to_front(const Entity& entity);
+        void bring_to_back(const Entity& entity);
 
       private:
 
-        std::unordered_map<ConstEntityPtr, int> z_values;
+        std::unordered_map<const Entity*, int> z_values;
         int min;
         int max;
     };
 
+    /**
+     * \brief Separation line of a separator, in lists sorted by position.
+     */
+    struct SeparatorLine {
+      int position;                   /**< X coordinate of a vertical line
+                                       * or Y coordinate of a horizontal one. */
+      const Separator* separator;     /**< The separator. */
+    };
+
     void initialize_layers();
+    void update_separator_lines() const;
+    void reserve_entities(const MapData& data);
+    void reserve_entities(const std::vector<const EntityData*>& entities_data);
+    void create_tiles(const EntityData& data);
+    void add_quadtree_batch() const;
+    template<typename F>
+    void for_each_entity_in_rectangle(const Rectangle& rectangle, F function) const;
     void set_tile_ground(int layer, int x8, int y8, Ground ground);
     void remove_marked_entities();
+    void update_dormant_entities();
+    void precompute_sprite_frames();
     void notify_entity_removed(Entity& entity);
-    void update_crystal_blocks();
+    void add_entity_to_draw(const EntityPtr& entity);
+    bool remove_entity_to_draw(const EntityPtr& entity, int layer);
+    void sort_entities_to_draw(int layer);
+    void add_entity_by_type(const EntityPtr& entity, int layer);
+    void remove_entity_by_type(const EntityPtr& entity, int layer);
+    void check_pending_collisions();
+    void get_animated_tiles_to_draw(int layer, const Camera& camera, std::vector<size_t>& indexes) const;
+    bool is_around_camera(const Entity& entity, size_t camera_index) const;
+    const std::vector<EntityVector>& get_layers_of_type(EntityType type) const;
 
     // map
     Game& game;                                     /**< The game running this map */
     Map& map;                                       /**< The map */
     int map_width8;                                 /**< Number of 8x8 squares on a row of the map grid */
     int map_height8;                                /**< Number of 8x8 squares on a column of the map grid */
+    int map_min_layer;                              /**< Lowest layer of the map */
 
     // tiles
     int tiles_grid_size;                            /**< Number of 8x8 squares in the map
@@ -192,32 +275,89 @@ class SOLARUS_API Entities {
     ByLayer<std::vector<Ground>> tiles_ground;      /**< For each layer, list of size tiles_grid_size
                                                      * representing the ground property
                                                      * of each 8x8 square. */
+    ByLayer<GroundRaster> ground_rasters;           /**< For each layer, the same grounds as tiles_ground
+                                                     * as one bit per pixel, for fast obstacle tests. */
+    uint64_t obstacle_generation;                   /**< Incremented when an entity is added, moves
+                                                     * or is removed or when the ground of tiles changes. */
+    uint64_t random_key;                            /**< Seed of the random streams of entities. */
+    uint64_t num_random_streams;                    /**< Number of random streams given to entities. */
     ByLayer<std::unique_ptr<NonAnimatedRegions>>
         non_animated_regions;                       /**< For each layer, all non-animated tiles are managed
                                                      * here for performance. */
     ByLayer<std::vector<TilePtr>>
         tiles_in_animated_regions;                  /**< For each layer, animated tiles and tiles overlapping them. */
+    ByLayer<std::unique_ptr<Grid<size_t>>>
+        animated_tiles_grids;                       /**< For each layer, indexes in tiles_in_animated_regions
+                                                     * of the tiles drawn at their position, by area of the map. */
+    ByLayer<std::vector<size_t>>
+        animated_tiles_not_at_position;             /**< For each layer, indexes in tiles_in_animated_regions
+                                                     * of the tiles that can be drawn anywhere (parallax). */
+    std::vector<size_t> animated_tiles_to_draw;     /**< Indexes of tiles to draw in the current layer. */
+    static constexpr int
+        animated_tiles_cell_size = 64;              /**< Side of the grid cells of animated tiles in pixels. */
 
     // dynamic entities
     HeroPtr hero;                                   /**< The hero, also stored in Game because
                                                      * it is kept when changing maps. */
-    CameraPtr camera;                               /**< The visible area of the map. */
+    CameraPtr camera;                               /**< The main visible area of the map. */
+    std::vector<CameraPtr> cameras;                 /**< All cameras, the main one first. */
+    std::vector<Rectangle> camera_boxes;            /**< Bounding boxes of cameras during an update. */
+    std::vector<Rectangle> around_cameras;          /**< Areas where each camera draws entities. */
 
     std::map<std::string, EntityPtr>
         named_entities;                             /**< Entities identified by a name. */
     EntityList all_entities;                        /**< All map entities except tiles and the hero. */
-    std::map<EntityType, ByLayer<EntitySet>>
-        entities_by_type;                           /**< All map entities except tiles, by type and then layer. */
-
-    EntityTree quadtree;                            /**< All map entities except tiles.
-                                                     * Optimized for fast spatial search. */
+    std::vector<std::vector<EntityVector>>
+        entities_by_type;                           /**< All map entities except tiles, indexed by type
+                                                     * and then by layer minus the min layer.
+                                                     * Entities know their position in these lists
+                                                     * so that they are removed in constant time. */
+    EntityTransforms transforms;                    /**< Boxes of all map entities except tiles,
+                                                     * in contiguous arrays for linear sweeps. */
+    std::vector<uint8_t> slots_in_camera;           /**< For each transform slot, one bit per camera
+                                                     * around which the entity is drawn. */
+    std::unique_ptr<EntityStreaming>
+        streaming;                                  /**< Creates unnamed entities by chunks around
+                                                     * the camera if the map has a chunk size,
+                                                     * or nullptr. */
+
+    mutable EntityTree quadtree;                    /**< All map entities except tiles.
+                                                     * Optimized for fast spatial search.
+                                                     * Mutable to add the batch lazily. */
+    std::unique_ptr<EntityGrid>
+        entity_grid;                                /**< Replaces the quadtree if the map has
+                                                     * an entity cell size, or nullptr. */
+    std::unique_ptr<EntityGrid>
+        static_detector_grid;                       /**< Sensors, teletransporters, stairs, jumpers and
+                                                     * destinations, kept out of the quadtree. */
+    bool quadtree_batch_enabled;                    /**< Whether new entities go to quadtree_batch. */
+    mutable EntityVector quadtree_batch;            /**< Entities created by create_entities()
+                                                     * and not in the quadtree yet. */
+    bool creation_batch_started;                    /**< Whether new entities wait for
+                                                     * finish_creation_batch() to be initialized. */
+    bool quadtree_batch_enabled_before;             /**< Value of quadtree_batch_enabled when
+                                                     * the creation batch started. */
+    EntityVector creation_batch;                    /**< Entities added since start_creation_batch(). */
     ByLayer<ZCache> z_caches;                       /**< For each layer, tracks the relative Z order of entities. */
-    ByLayer<EntityVector>
-        entities_drawn_not_at_their_position;       /**< For each layer, entities to draw even if there position
-                                                     * is outside the camera. */
-    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities to be drawn at this cycle. */
+    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, all entities that can be drawn,
+                                                     * kept in drawing order across cycles. */
 
     EntityList entities_to_remove;                  /**< List of entities that need to be removed right now. */
+    bool collision_broad_phase;                     /**< Whether collisions with detectors are checked
+                                                     * once per cycle instead of at each move. */
+    EntityPointerVector
+        pending_collision_checks;                   /**< Entities that moved or changed since the last
+                                                     * collision pass (only with collision_broad_phase). */
+    std::vector<Sprite*>
+        sprites_to_precompute;                      /**< Sprites whose frames are computed in parallel
+                                                     * at the beginning of update(). */
+
+    mutable std::vector<SeparatorLine>
+        vertical_separator_lines;                   /**< Vertical separators sorted by X coordinate. */
+    mutable std::vector<SeparatorLine>
+        horizontal_separator_lines;                 /**< Horizontal separators sorted by Y coordinate. */
+    mutable bool separator_lines_outdated;          /**< Whether separators changed since the
+                                                     * separator lines were built. */
 
     std::shared_ptr<Destination>
         default_destination;                        /**< Default destination of this map or nullptr. */
@@ -244,6 +384,34 @@ inline Ground Entities::get_tile_ground(int layer, int x, int y) const {
   return tiles_ground.at(layer)[(y >> 3) * map_width8 + (x >> 3)];
 }
 
+/**
+ * \brief Returns the ground of static tiles of a layer as bitmaps.
+ *
+ * Only static tiles are considered here (not the dynamic entities).
+ *
+ * \param layer A layer of the map.
+ * \return The ground raster of this layer.
+ */
+inline const GroundRaster& Entities::get_ground_raster(int layer) const {
+
+  return ground_rasters.at(layer);
+}
+
+/**
+ * \brief Returns a counter of the changes that may create obstacles.
+ *
+ * It is incremented whenever an entity is added, changes its bounding box
+ * or is removed, or when the ground of tiles changes.
+ * Results of obstacle tests that depend on nothing else remain valid
+ * as long as this value does not change.
+ *
+ * \return The current generation.
+ */
+inline uint64_t Entities::get_obstacle_generation() const {
+
+  return obstacle_generation;
+}
+
 /**
  * \brief Returns the camera of the map.
  * \return The camera, or nullptr if there is no camera.
@@ -253,27 +421,37 @@ inline const CameraPtr& Entities::get_camera() const {
   return camera;
 }
 
+/**
+ * \brief Returns all cameras of the map.
+ *
+ * The first one is the main camera returned by get_camera().
+ *
+ * \return The cameras.
+ */
+inline const std::vector<CameraPtr>& Entities::get_cameras() const {
+
+  return cameras;
+}
+
+/**
+ * \brief Returns the per-layer lists of entities of a type.
+ * \param type A type of entity.
+ * \return The lists of this type, indexed by layer minus the min layer.
+ */
+inline const std::vector<EntityVector>& Entities::get_layers_of_type(EntityType type) const {
+
+  return entities_by_type[static_cast<size_t>(type)];
+}
+
 /**
  * \brief Returns all entities of a type.
  * \return All entities of the type.
  */
 template<typename T>
-std::set<std::shared_ptr<const T>> Entities::get_entities_by_type() const {
-
-  std::set<std::shared_ptr<const T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  for (const auto& kvp : it->second) {
-    for (const ConstEntityPtr& entity : kvp.second) {
-      result.insert(std::static_pointer_cast<const T>(entity));
-    }
-  }
-  return result;
+EntityTypeRange<const T> Entities::get_entities_by_type() const {
+
+  const std::vector<EntityVector>& layers = get_layers_of_type(T::ThisType);
+  return EntityTypeRange<const T>(layers, 0, layers.size());
 }
 
 /**
@@ -281,22 +459,10 @@ std::set<std::shared_ptr<const T>> Entities::get_entities_by_type() const {
  * \return All entities of the type.
  */
 template<typename T>
-std::set<std::shared_ptr<T>> Entities::get_entities_by_type() {
-
-  std::set<std::shared_ptr<T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  for (const auto& kvp : it->second) {
-    for (const EntityPtr& entity : kvp.second) {
-      result.insert(std::static_pointer_cast<T>(entity));
-    }
-  }
-  return result;
+EntityTypeRange<T> Entities::get_entities_by_type() {
+
+  const std::vector<EntityVector>& layers = get_layers_of_type(T::ThisType);
+  return EntityTypeRange<T>(layers, 0, layers.size());
 }
 
 /**
@@ -305,25 +471,10 @@ std::set<std::shared_ptr<T>> Entities::get_entities_by_type() {
  * \return All entities of the type on this layer.
  */
 template<typename T>
-std::set<std::shared_ptr<const T>> Entities::get_entities_by_type(int layer) const {
-
-  std::set<std::shared_ptr<const T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
-  }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(std::static_pointer_cast<const T>(entity));
-  }
-  return result;
+EntityTypeRange<const T> Entities::get_entities_by_type(int layer) const {
+
+  const size_t layer_index = static_cast<size_t>(layer - map_min_layer);
+  return EntityTypeRange<const T>(get_layers_of_type(T::ThisType), layer_index, layer_index + 1);
 }
 
 /**
@@ -332,25 +483,10 @@ std::set<std::shared_ptr<const T>> Entities::get_entities_by_type(int layer) con
  * \return All entities of the type on this layer.
  */
 template<typename T>
-std::set<std::shared_ptr<T>> Entities::get_entities_by_type(int layer) {
-
-  std::set<std::shared_ptr<T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
-  }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(std::static_pointer_cast<T>(entity));
-  }
-  return result;
+EntityTypeRange<T> Entities::get_entities_by_type(int layer) {
+
+  const size_t layer_index = static_cast<size_t>(layer - map_min_layer);
+  return EntityTypeRange<T>(get_layers_of_type(T::ThisType), layer_index, layer_index + 1);
 }
 
 }
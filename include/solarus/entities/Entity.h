@@ -20,6 +20,7 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/GameCommand.h"
 #include "solarus/core/Common.h"
+#include "solarus/core/Random.h"
 #include "solarus/entities/EntityType.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/CollisionMode.h"
@@ -64,6 +65,7 @@ class Savegame;
 class Separator;
 class Sensor;
 class Sprite;
+class SpriteAnimationSet;
 class Stairs;
 class Stream;
 class StreamAction;
@@ -120,6 +122,7 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     // Adding to a map.
     bool is_initialized() const;
+    void finish_initialization();
     bool is_on_map() const;
     void set_map(Map& map);
     Map& get_map() const;
@@ -134,6 +137,10 @@ class SOLARUS_API Entity: public ExportableToLua {
     // Position in the map.
     int get_layer() const;
     void set_layer(int layer);
+    int get_type_list_index() const;
+    void set_type_list_index(int index);
+    int get_transform_slot() const;
+    void set_transform_slot(int slot);
     Ground get_ground_below() const;
 
     int get_x() const;
@@ -144,6 +151,9 @@ class SOLARUS_API Entity: public ExportableToLua {
     void set_xy(const Point& xy);
     void set_xy(int x, int y);
     Point get_displayed_xy() const;
+    void store_previous_xy();
+    Point get_interpolated_xy() const;
+    Point get_interpolated_displayed_xy() const;
 
     int get_width() const;
     int get_height() const;
@@ -181,6 +191,13 @@ class SOLARUS_API Entity: public ExportableToLua {
     int get_optimization_distance() const;
     int get_optimization_distance2() const;
     void set_optimization_distance(int distance);
+    bool is_always_active() const;
+    void set_always_active(bool always_active);
+    bool is_dormant() const;
+    void set_dormant(bool dormant);
+    Random::Stream& get_random_stream();
+    const Random::Stream& get_random_stream() const;
+    void set_random_stream(const Random::Stream& random_stream);
 
     bool is_enabled() const;
     void set_enabled(bool enable);
@@ -206,6 +223,8 @@ class SOLARUS_API Entity: public ExportableToLua {
     bool has_sprite() const;
     SpritePtr get_sprite(const std::string& sprite_name = "") const;
     std::vector<SpritePtr> get_sprites() const;
+    template<typename F>
+    void for_each_sprite(F function) const;
     std::vector<NamedSprite> get_named_sprites() const;
     SpritePtr create_sprite(
         const std::string& animation_set_id,
@@ -223,6 +242,7 @@ class SOLARUS_API Entity: public ExportableToLua {
     void set_visible(bool visible);
     void set_animation_ignore_suspend(bool ignore_suspend);
     void update_sprite(Sprite& sprite);
+    void get_sprites_to_precompute(std::vector<Sprite*>& result) const;
 
     // Movement.
     const std::shared_ptr<Movement>& get_movement();
@@ -273,6 +293,7 @@ class SOLARUS_API Entity: public ExportableToLua {
     int get_distance(int x, int y) const;
     int get_distance(const Point& point) const;
     int get_distance(const Entity& other) const;
+    int get_distance_to_camera() const;
     bool is_in_same_region(const Entity& other) const;
     bool is_in_same_region(const Point& xy) const;
 
@@ -302,8 +323,8 @@ class SOLARUS_API Entity: public ExportableToLua {
     virtual bool test_collision_custom(Entity& entity);
 
     // Being detected by other entities.
-    void check_collision_with_detectors();
-    void check_collision_with_detectors(Sprite& sprite);
+    virtual void check_collision_with_detectors();
+    virtual void check_collision_with_detectors(Sprite& sprite);
 
     virtual void check_position();
     virtual void notify_collision_with_destructible(Destructible& destructible, CollisionMode collision_mode);
@@ -434,15 +455,19 @@ class SOLARUS_API Entity: public ExportableToLua {
 
   private:
 
-    void finish_initialization();
     void clear_old_movements();
     void clear_old_sprites();
+    bool is_max_bounding_box_outdated() const;
 
     MainLoop* main_loop;                        /**< The Solarus main loop. */
     Map* map;                                   /**< The map where this entity is, or nullptr. */
 
     int layer;                                  /**< Layer of the entity on the map.
                                                  * The layer is constant for the tiles and can change for the hero and the dynamic entities. */
+    int type_list_index;                        /**< Position of the entity in the list of its type and layer
+                                                 * in Entities, or -1. */
+    int transform_slot;                         /**< Position of the entity in the transform arrays
+                                                 * of Entities, or -1. */
 
     Rectangle bounding_box;                     /**< This rectangle represents the position of the entity of the map and is
                                                  * used for the collision tests. It corresponds to the bounding box of the entity.
@@ -450,6 +475,9 @@ class SOLARUS_API Entity: public ExportableToLua {
                                                  * For example, the hero's bounding box is a 16*16 rectangle, but its sprite may be
                                                  * a 24*32 rectangle. */
 
+    Point previous_xy;                          /**< Position of the origin point at the previous
+                                                 * simulation step, used to interpolate drawings. */
+
     Ground ground_below;                        /**< Kind of ground under this entity: grass, shallow water, etc.
                                                  * Only used by entities sensible to their ground. */
 
@@ -472,6 +500,20 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     std::vector<NamedSprite>
         sprites;                                /**< Sprites representing the entity. */
+
+    /**
+     * \brief What the bounding box of a sprite depends on.
+     */
+    struct SpriteBoxStamp {
+      Point xy;                                 /**< Offset of the sprite. */
+      const SpriteAnimationSet* animation_set;  /**< Animation set of the sprite. */
+    };
+    mutable Rectangle max_bounding_box;         /**< Last result of get_max_bounding_box(). */
+    mutable bool max_bounding_box_outdated;     /**< Whether max_bounding_box was never computed. */
+    mutable Rectangle max_bounding_box_base;    /**< Bounding box when max_bounding_box was computed. */
+    mutable Point max_bounding_box_xy;          /**< Coordinates when max_bounding_box was computed. */
+    mutable std::vector<SpriteBoxStamp>
+        max_bounding_box_stamps;                /**< Each sprite when max_bounding_box was computed. */
     std::string default_sprite_name;            /**< Name of the sprite to get in get_sprite() without parameter. */
     bool visible;                               /**< Whether this entity's sprites are currently displayed. */
     bool drawn_in_y_order;                      /**< Whether this entity is drawn in Y order or in Z order. */
@@ -490,8 +532,9 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     // state
     std::unique_ptr<State> state;               /**< The current internal state */
-    std::list<std::unique_ptr<State>>
-        old_states;                             /**< Previous state objects to delete as soon as possible. */
+    std::vector<std::unique_ptr<State>>
+        old_states;                             /**< Previous state objects to delete as soon as possible.
+                                                 * A vector keeps its capacity after being cleared. */
 
     bool initialized;                           /**< Whether all initializations were done. */
     bool being_removed;                         /**< indicates that the entity is not valid anymore because it is about to be removed */
@@ -504,8 +547,16 @@ class SOLARUS_API Entity: public ExportableToLua {
     int optimization_distance;                  /**< Above this distance from the visible area,
                                                  * the engine may skip updates (0 means infinite). */
     int optimization_distance2;                 /**< Square of optimization_distance. */
+    bool always_active;                         /**< Whether the entity never becomes dormant. */
+    bool dormant;                               /**< Whether the entity is suspended because it is
+                                                 * too far from the camera. */
+    Random::Stream random_stream;               /**< Random numbers used while this entity is updated. */
     static constexpr int
         default_optimization_distance = 0;      /**< Default value. */
+    static constexpr int
+        max_interpolation_distance = 32;        /**< Above this distance between two steps,
+                                                 * the entity is considered as teleported and
+                                                 * its position is not interpolated. */
 
 };
 
@@ -567,6 +618,25 @@ inline bool Entity::overlaps(const Entity& other) const {
   return overlaps(other.get_bounding_box());
 }
 
+/**
+ * \brief Calls a function on each sprite of this entity.
+ *
+ * Unlike get_sprites(), this does not copy the list of sprites.
+ * Sprites marked to be removed are skipped.
+ * The function must not create sprites on this entity.
+ *
+ * \param function Function to call with each sprite as a const SpritePtr&.
+ */
+template<typename F>
+inline void Entity::for_each_sprite(F function) const {
+
+  for (const NamedSprite& named_sprite: sprites) {
+    if (!named_sprite.removed) {
+      function(named_sprite.sprite);
+    }
+  }
+}
+
 }
 
 #endif
@@ -20,6 +20,7 @@
 #include "solarus/core/Common.h"
 #include "solarus/entities/CarriedObject.h"
 #include "solarus/entities/Hero.h"
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -33,12 +34,17 @@ namespace Solarus {
  * and provide a default implementation for them.
  * Most of them are almost empty here because they depend on the state.
  * Redefine for each state the functions that you need to implement or change.
+ *
+ * Entities like the hero and the camera change their state very often,
+ * so the memory of states is recycled instead of being allocated each time.
  */
 class Entity::State {
 
   public:
 
     // creation and destruction
+    static void* operator new(std::size_t size);
+    static void operator delete(void* state, std::size_t size);
     virtual ~State();
     const std::string& get_name() const;
     virtual void start(const State* previous_state);
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ENTITY_STREAMING_H
+#define SOLARUS_ENTITY_STREAMING_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/EntityData.h"
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Map;
+
+/**
+ * \brief Creates and drops entities of a map by chunks around the camera.
+ *
+ * The map is split into square chunks. The data of entities that can be
+ * streamed is kept here instead of creating them when the map is loaded.
+ * Entities of chunks close to the camera are created a few at a time,
+ * and entities of chunks far from the camera are dropped and go back
+ * to their data.
+ *
+ * Only unnamed entities are streamed because scripts have no way to find
+ * them by name. An entity is only dropped if it is still as created:
+ * at its initial position, without movement and without fields set from Lua.
+ * Other entities are kept. An entity removed by the game is not created
+ * again.
+ *
+ * Separators, destinations and tiles are never streamed: tiles are light
+ * and their surfaces are already built lazily, and the camera and the
+ * hero rely on the others being always there.
+ */
+class EntityStreaming {
+
+  public:
+
+    EntityStreaming(Map& map, int chunk_size);
+
+    static bool can_be_streamed(const EntityData& entity_data);
+
+    int get_chunk_size() const;
+    int get_num_entities() const;
+    void add_entity_data(const EntityData& entity_data);
+    void update(const Rectangle& visible_area, bool all_at_once);
+    void notify_entity_removed(const Entity& entity);
+
+  private:
+
+    /**
+     * \brief An entity of the map data and the entity created from it.
+     */
+    struct Record {
+      EntityData data;              /**< Description of the entity. */
+      Entity* entity = nullptr;     /**< The entity created or nullptr. */
+      bool removed = false;         /**< Whether the game removed the entity created. */
+    };
+
+    /**
+     * \brief Entities whose initial position is in a square of the map.
+     */
+    struct Chunk {
+      std::vector<Record> records;  /**< Entities of this chunk. */
+      size_t num_loaded = 0;        /**< Number of records already examined for creation. */
+    };
+
+    Rectangle get_chunk_box(size_t chunk_index) const;
+    void load_chunk(size_t chunk_index, int& budget);
+    void unload_chunk(size_t chunk_index);
+    static bool is_unchanged(const Entity& entity, const EntityData& entity_data);
+
+    static constexpr int
+        max_entities_created_per_update = 16;  /**< Creation budget of update(). */
+
+    Map& map;                       /**< The map. */
+    int chunk_size;                 /**< Side of a chunk in pixels. */
+    int num_columns;                /**< Number of chunks in a row. */
+    int num_rows;                   /**< Number of chunks in a column. */
+    std::vector<Chunk> chunks;      /**< All chunks, row by row. */
+    std::unordered_map<const Entity*, std::pair<size_t, size_t>>
+        records_by_entity;          /**< Chunk and record of each entity created here. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ENTITY_TRANSFORMS_H
+#define SOLARUS_ENTITY_TRANSFORMS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+
+/**
+ * \brief Bounding boxes of the entities of a map in contiguous arrays.
+ *
+ * Entities keep their own position, but passes over all entities like
+ * camera culling or the collision broad phase only need boxes.
+ * Reading them here is a linear sweep over memory instead of a visit of
+ * each entity object, and get_max_bounding_box() is not recomputed from
+ * the sprites each time.
+ *
+ * Each entity knows its slot in the arrays.
+ * Removing an entity moves the last one to its slot.
+ * Boxes are refreshed by Entities when an entity notifies that its bounding
+ * box changed, like the quadtree.
+ */
+class EntityTransforms {
+
+  public:
+
+    EntityTransforms();
+
+    size_t get_num_slots() const;
+    bool contains(const Entity& entity) const;
+    void reserve(size_t num_entities);
+    void add(Entity& entity);
+    void remove(Entity& entity);
+    void update(Entity& entity);
+    void update_all();
+
+    Entity& get_entity(size_t slot) const;
+    const Rectangle& get_bounding_box(size_t slot) const;
+    const Rectangle& get_max_bounding_box(size_t slot) const;
+
+    void get_slots_overlapping(const std::vector<Rectangle>& rectangles, std::vector<uint8_t>& result) const;
+
+  private:
+
+    std::vector<Entity*> entities;          /**< Entity of each slot. */
+    std::vector<Rectangle> bounding_boxes;  /**< Bounding box of each slot. */
+    std::vector<Rectangle>
+        max_bounding_boxes;                 /**< Bounding box of each slot including sprites. */
+
+};
+
+}
+
+#endif
+
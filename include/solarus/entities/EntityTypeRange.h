@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ENTITY_TYPE_RANGE_H
+#define SOLARUS_ENTITY_TYPE_RANGE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/EntityPtr.h"
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A view on the entities of one type kept by Entities.
+ *
+ * It iterates the per-layer lists of a type without copying them,
+ * and gives entities already cast to their concrete type.
+ *
+ * The view reads the lists when it progresses, so adding entities
+ * during the iteration is allowed (they may or may not be visited).
+ * Entities must not change layer during the iteration.
+ *
+ * \tparam T The concrete entity class, possibly const.
+ */
+template<typename T>
+class EntityTypeRange {
+
+  public:
+
+    /**
+     * \brief Forward iterator over the entities of the range.
+     */
+    class iterator {
+
+      public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        /**
+         * \brief Creates an iterator.
+         * \param layers The per-layer lists of the type.
+         * \param layer_index Index of the current list.
+         * \param end_layer_index Index after the last list of the range.
+         */
+        iterator(
+            const std::vector<std::vector<EntityPtr>>* layers,
+            size_t layer_index,
+            size_t end_layer_index
+        ):
+          layers(layers),
+          layer_index(layer_index),
+          end_layer_index(end_layer_index),
+          position(0) {
+          skip_empty_layers();
+        }
+
+        T& operator*() const {
+          return static_cast<T&>(*(*layers)[layer_index][position]);
+        }
+
+        T* operator->() const {
+          return &**this;
+        }
+
+        iterator& operator++() {
+          ++position;
+          skip_empty_layers();
+          return *this;
+        }
+
+        iterator operator++(int) {
+          iterator old = *this;
+          ++*this;
+          return old;
+        }
+
+        bool operator==(const iterator& other) const {
+          return layer_index == other.layer_index && position == other.position;
+        }
+
+        bool operator!=(const iterator& other) const {
+          return !(*this == other);
+        }
+
+      private:
+
+        /**
+         * \brief Moves to the next element if the current list is finished.
+         */
+        void skip_empty_layers() {
+          while (layer_index < end_layer_index &&
+              position >= (*layers)[layer_index].size()) {
+            ++layer_index;
+            position = 0;
+          }
+        }
+
+        const std::vector<std::vector<EntityPtr>>*
+            layers;                   /**< The per-layer lists of the type. */
+        size_t layer_index;           /**< Index of the current list. */
+        size_t end_layer_index;       /**< Index after the last list of the range. */
+        size_t position;              /**< Position in the current list. */
+    };
+
+    /**
+     * \brief Creates a range over some layers of a type.
+     * \param layers The per-layer lists of the type.
+     * \param first_layer_index Index of the first list of the range.
+     * \param end_layer_index Index after the last list of the range.
+     */
+    EntityTypeRange(
+        const std::vector<std::vector<EntityPtr>>& layers,
+        size_t first_layer_index,
+        size_t end_layer_index
+    ):
+      layers(&layers),
+      first_layer_index(first_layer_index),
+      end_layer_index(end_layer_index) {
+    }
+
+    iterator begin() const {
+      return iterator(layers, first_layer_index, end_layer_index);
+    }
+
+    iterator end() const {
+      return iterator(layers, end_layer_index, end_layer_index);
+    }
+
+    /**
+     * \brief Returns whether there is no entity in the range.
+     * \return \c true if the range is empty.
+     */
+    bool empty() const {
+      return begin() == end();
+    }
+
+    /**
+     * \brief Returns the number of entities in the range.
+     * \return The number of entities.
+     */
+    size_t size() const {
+      size_t size = 0;
+      for (size_t i = first_layer_index; i < end_layer_index; ++i) {
+        size += (*layers)[i].size();
+      }
+      return size;
+    }
+
+  private:
+
+    const std::vector<std::vector<EntityPtr>>*
+        layers;                       /**< The per-layer lists of the type. */
+    size_t first_layer_index;         /**< Index of the first list of the range. */
+    size_t end_layer_index;           /**< Index after the last list of the range. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GROUND_RASTER_H
+#define SOLARUS_GROUND_RASTER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/Ground.h"
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+class Rectangle;
+
+/**
+ * \brief Bitmaps of the static ground of a layer, one bit per pixel.
+ *
+ * The ground of tiles is stored per 8x8 square, but diagonal walls make
+ * only some pixels of a square obstacles.
+ * This class keeps two bitmaps of the layer so that obstacles of a whole
+ * rectangle border can be tested with a few word operations:
+ * - wall pixels: walls and the wall half of diagonal walls,
+ * - conditional pixels: grounds that are obstacles for some entities only
+ *   (water, holes, low walls...).
+ *
+ * Other pixels (empty, traversable and the traversable half of diagonal
+ * walls) have no bit set.
+ * Rows are stored as 64-bit words, the leftmost pixel in the most
+ * significant bit.
+ *
+ * The wall pixels of each ground are also available as an 8x8 square mask,
+ * so that a single square can be tested without the bitmaps.
+ */
+class GroundRaster {
+
+  public:
+
+    GroundRaster();
+
+    void initialize(int width8, int height8);
+    void set_ground(int x8, int y8, Ground ground);
+
+    bool is_wall(int x, int y) const;
+    bool is_conditional(int x, int y) const;
+    bool has_wall_on_border(const Rectangle& box) const;
+    bool has_conditional_on_border(const Rectangle& box) const;
+    bool has_wall(const Rectangle& box) const;
+    bool has_conditional(const Rectangle& box) const;
+
+    static uint64_t get_wall_square_mask(Ground ground);
+
+  private:
+
+    bool has_bit_on_border(const std::vector<uint64_t>& bits, const Rectangle& box) const;
+    bool has_bit_in_box(const std::vector<uint64_t>& bits, const Rectangle& box) const;
+    bool has_bit_in_row(const std::vector<uint64_t>& bits, int y, int x1, int x2) const;
+    bool is_bit_set(const std::vector<uint64_t>& bits, int x, int y) const;
+    static void set_row_byte(std::vector<uint64_t>& bits, size_t word_index, int shift, uint8_t value);
+    static uint8_t get_wall_row_mask(Ground ground, int y_in_square);
+
+    int nb_words_per_row;             /**< Number of 64-bit words in a row of pixels. */
+    std::vector<uint64_t> walls;      /**< Pixels that are walls. */
+    std::vector<uint64_t> conditional;  /**< Pixels that are obstacles for some entities only. */
+
+};
+
+}
+
+#endif
+
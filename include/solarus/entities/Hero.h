@@ -22,12 +22,15 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/hero/HeroSprites.h"
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
 class CarriedObject;
+class Entities;
 class Equipment;
 class EquipmentItem;
 class EquipmentItemUsage;
@@ -155,7 +158,7 @@ class Hero: public Entity {
     ScopedLuaRef make_solid_ground_callback(
         const Point& xy, int layer) const;
     const ScopedLuaRef& get_target_solid_ground_callback() const;
-    void set_target_solid_ground_callback(const ScopedLuaRef& callback);
+    void set_target_solid_ground_callback(ScopedLuaRef callback);
     void reset_target_solid_ground_callback();
 
     /**
@@ -185,6 +188,8 @@ class Hero: public Entity {
      * Handle collisions between the hero and other entities.
      */
     virtual void check_position() override;
+    virtual void check_collision_with_detectors() override;
+    virtual void check_collision_with_detectors(Sprite& sprite) override;
     virtual void notify_collision_with_destructible(Destructible& destructible, CollisionMode collision_mode) override;
     virtual void notify_collision_with_enemy(Enemy& enemy, CollisionMode) override;
     virtual void notify_collision_with_enemy(Enemy& enemy, Sprite& this_sprite, Sprite& enemy_sprite) override;
@@ -258,13 +263,13 @@ class Hero: public Entity {
     void start_free_carrying_loading_or_running();
     void start_treasure(
         const Treasure& treasure,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
     void start_forced_walking(const std::string& path, bool loop, bool ignore_obstacles);
     void start_jumping(int direction8, int distance, bool ignore_obstacles,
         bool with_sound);
     void start_frozen();
-    void start_victory(const ScopedLuaRef& callback_ref);
+    void start_victory(ScopedLuaRef callback_ref);
     void start_lifting(const std::shared_ptr<CarriedObject>& item_to_lift);
     void start_running();
     void start_pushing();
@@ -331,6 +336,10 @@ class Hero: public Entity {
     std::shared_ptr<Teletransporter> get_delayed_teletransporter();
     std::shared_ptr<CarriedObject> get_carried_object();
 
+    // collisions
+    std::shared_ptr<const std::vector<Entity*>> get_entities_nearby();
+    void clear_position_caches();
+
     // ground
     void update_ground_effects();
     void update_ice();
@@ -359,6 +368,23 @@ class Hero: public Entity {
     bool on_raised_blocks;                 /**< indicates that the hero is currently on
                                             * raised crystal blocks */
 
+    // collisions
+    std::shared_ptr<std::vector<Entity*>>
+        entities_nearby;                   /**< Entities whose max bounding box overlaps
+                                            * entities_nearby_box, or nullptr if unknown. */
+    Rectangle entities_nearby_box;         /**< Region where entities_nearby were searched. */
+    const Entities*
+        entities_nearby_owner;             /**< Entities of the map where entities_nearby were searched. */
+    uint64_t entities_nearby_generation;   /**< Obstacle generation of the map when entities_nearby
+                                            * were searched. They stay valid until it changes. */
+    const Entities*
+        ground_below_owner;                /**< Entities of the map where the ground below was last
+                                            * determined, or nullptr. */
+    Point ground_below_xy;                 /**< Position where the ground below was last determined. */
+    int ground_below_layer;                /**< Layer where the ground below was last determined. */
+    uint64_t ground_below_generation;      /**< Obstacle generation of the map when the ground below
+                                            * was last determined. */
+
     // ground
     Point last_solid_ground_coords;        /**< coordinates of the last hero position on a ground
                                             * where he can walk (e.g. before jumping or falling into a hole) */
@@ -18,13 +18,18 @@
 #define SOLARUS_NON_ANIMATED_REGIONS_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/containers/Grid.h"
 #include "solarus/entities/TileInfo.h"
+#include "solarus/graphics/SDLPtrs.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
 
+class Camera;
 class Map;
 
 /**
@@ -34,22 +39,62 @@ class Map;
  * tile. The tiles in such rectangles of the map can be pre-drawn once for all
  * on an intermediate surface for performance. Furthermore, this intermediate
  * surface is drawn lazily when the camera moves.
+ *
+ * Cells about to become visible are drawn in software on the thread pool
+ * of the main loop, and only uploaded to the GPU when they are displayed.
+ *
+ * Cells far from the camera are released and rebuilt on demand, and the
+ * memory of all cells of all layers is kept under a global limit.
  */
 class NonAnimatedRegions {
 
   public:
 
     NonAnimatedRegions(Map& map, int layer);
+    ~NonAnimatedRegions();
 
     void add_tile(const TileInfo& tile);
     void build(std::vector<TileInfo>& rejected_tiles);
-    void notify_tileset_changed();
-    void draw_on_map();
+    void notify_tileset_changed(
+        const Tileset& old_tileset,
+        const Tileset& new_tileset,
+        bool same_patterns
+    );
+    void draw_on_map(Camera& camera);
+    void release_far_cells();
+
+    static int get_cell_radius();
+    static void set_cell_radius(int cell_radius);
+    static int64_t get_max_memory_size();
+    static void set_max_memory_size(int64_t max_memory_size);
+    static int64_t get_memory_size();
 
   private:
 
+    /**
+     * \brief Software pixels of the tiles image of each tileset used.
+     */
+    using TilesImages = std::vector<std::pair<const Tileset*, const SDL_Surface*>>;
+
     bool overlaps_animated_tile(const TileInfo& tile) const;
     void build_cell(int cell_index);
+    void build_cells_pixels(const std::vector<int>& cell_indexes);
+    bool draw_cell_pixels(int cell_index, const TilesImages& tiles_images) const;
+    void add_built_cell(int cell_index);
+    void release_cell(int cell_index);
+    int64_t get_cell_memory_size() const;
+
+    static constexpr int
+        prebuilt_margin = 1;                /**< Number of cells to prepare around the visible ones. */
+    static constexpr int
+        default_cell_radius = 2;            /**< Default value of cell_radius. */
+    static constexpr int64_t
+        default_max_memory_size = 64 * 1024 * 1024;  /**< Default value of max_memory_size. */
+
+    static int cell_radius;                 /**< Cells further than this number of cells from
+                                             * the visible ones are released. */
+    static int64_t max_memory_size;         /**< Memory allowed for the cells of all layers in bytes. */
+    static int64_t memory_size;             /**< Memory used by the cells of all layers in bytes. */
 
     Map& map;                               /**< The map. */
     int layer;                              /**< Layer of the map managed by this object. */
@@ -67,6 +112,16 @@ class NonAnimatedRegions {
         optimized_tiles_surfaces;           /**< All non-animated tiles are drawn here once for all
                                              * for performance. Each cell of the grid has a surface
                                              * or nullptr before it is drawn. */
+    std::vector<SDL_Surface_UniquePtr>
+        optimized_tiles_pixels;             /**< Cells drawn in software but not uploaded yet,
+                                             * or nullptr. */
+    std::vector<int> cells_to_build;        /**< Cells to draw at the current frame. */
+    std::vector<int> built_cells;           /**< Cells that have a surface or pixels. */
+    std::vector<uint64_t>
+        cells_last_drawn;                   /**< Value of num_draws when each cell was last displayed. */
+    uint64_t num_draws;                     /**< Number of frames where cells were drawn. */
+    std::vector<Rectangle> drawn_cells;     /**< Columns and rows of the cells drawn by each camera
+                                             * since the last call to release_far_cells(). */
 
 };
 
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_OBSTACLE_TABLE_H
+#define SOLARUS_OBSTACLE_TABLE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/EntityType.h"
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Obstacle relationships between entity types known without
+ * calling the virtual tests.
+ *
+ * Deciding whether an entity is an obstacle for another one takes two
+ * virtual calls (Entity::is_obstacle_for() on the obstacle, then a hook like
+ * Entity::is_sensor_obstacle() on the other entity), and this is done for
+ * each candidate entity at each pixel of a movement.
+ * For many pairs of types, the answer does not depend on the entities:
+ * a pickable treasure never blocks anything, a chest always does,
+ * and a sensor only blocks entities whose class overrides
+ * is_sensor_obstacle().
+ * This table gives these answers directly.
+ *
+ * The other pairs are left to the virtual tests: entities whose answer
+ * depends on their state (doors, switches, enemies, raised blocks...),
+ * walls, and custom entities whose rules come from Lua.
+ */
+class SOLARUS_API ObstacleTable {
+
+  public:
+
+    /**
+     * \brief What the table knows about two entity types.
+     */
+    enum class Relation : uint8_t {
+      NEVER,      /**< The first entity is never an obstacle for the second one. */
+      ALWAYS,     /**< The first entity is always an obstacle for the second one. */
+      TEST        /**< Call Entity::is_obstacle_for() to know. */
+    };
+
+    static Relation get_relation(EntityType obstacle_type, EntityType other_type);
+
+  private:
+
+    ObstacleTable();
+
+    void set_relation(EntityType obstacle_type, EntityType other_type, Relation relation);
+    void set_obstacle_relation(EntityType obstacle_type, Relation relation);
+    void set_hook_relation(
+        EntityType obstacle_type,
+        bool hook_default,
+        const std::vector<EntityType>& types_overriding_hook
+    );
+
+    static const ObstacleTable& get_instance();
+
+    size_t num_types;                   /**< Number of entity types. */
+    std::vector<Relation> relations;    /**< Relation of each pair of types,
+                                         * indexed by obstacle type then other type. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PROJECTILE_POOL_H
+#define SOLARUS_PROJECTILE_POOL_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include "solarus/entities/EntityType.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/ExportableToLua.h"
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Map;
+
+/**
+ * \brief Many projectiles of a map moved and collided together.
+ *
+ * Projectiles are not entities: they are stored as one array per property,
+ * and only have a position, a speed and an integer id known by Lua.
+ * They all use the same image, drawn centered on them above the entities,
+ * and the same collision box size.
+ *
+ * At each cycle, projectiles move in a straight line and are tested
+ * against the walls of the ground raster along their path.
+ * Then the entities of the target types are looked up once around all
+ * projectiles, and each projectile is tested against them.
+ * Projectiles that hit a wall or a target are removed, and all hits
+ * of the cycle are notified to Lua in one call.
+ * Projectiles leaving the map are removed silently.
+ *
+ * Only static walls stop projectiles: entities that change the ground,
+ * like dynamic tiles, are only seen if they are among the targets.
+ */
+class ProjectilePool: public ExportableToLua {
+
+  public:
+
+    /**
+     * \brief A projectile that hit something during the last cycle.
+     */
+    struct Hit {
+      uint32_t id;              /**< Id of the projectile, no longer valid. */
+      Point xy;                 /**< Position of the projectile when it hit. */
+      Entity* entity;           /**< The entity hit, or nullptr for a wall. */
+    };
+
+    ProjectilePool(const SurfacePtr& image, const Size& size, int layer);
+
+    const SurfacePtr& get_image() const;
+    const Size& get_size() const;
+    int get_layer() const;
+    const std::set<EntityType>& get_target_types() const;
+    void set_target_types(const std::set<EntityType>& target_types);
+    int get_max_projectiles() const;
+    void set_max_projectiles(int max_projectiles);
+
+    int get_num_projectiles() const;
+    uint32_t create_projectile(double x, double y, double angle, double speed);
+    bool has_projectile(uint32_t id) const;
+    Point get_projectile_xy(uint32_t id) const;
+    void remove_projectile(uint32_t id);
+    void clear();
+
+    void update(Map& map, std::vector<Hit>& hits);
+    void draw(Map& map) const;
+
+    virtual const std::string& get_lua_type_name() const override;
+
+    static constexpr int default_max_projectiles = 1000;  /**< Default limit of projectiles alive. */
+
+  private:
+
+    Rectangle get_box(float x, float y) const;
+    void remove_projectile_at(size_t index);
+    bool move_projectile(Map& map, size_t index, float delta, std::vector<Hit>& hits);
+    void check_targets(Map& map, std::vector<Hit>& hits);
+
+    SurfacePtr image;               /**< Image of each projectile. */
+    Size size;                      /**< Size of the collision box of each projectile. */
+    int layer;                      /**< Layer of all projectiles. */
+    std::set<EntityType>
+        target_types;               /**< Types of entities that projectiles hit. */
+    int max_projectiles;            /**< Projectiles beyond this number are not created. */
+    uint32_t next_id;               /**< Id of the next projectile created. */
+    uint32_t last_update_date;      /**< Date of the previous update. */
+
+    std::vector<uint32_t> ids;      /**< Id of each projectile. */
+    std::vector<float> xs;          /**< X of each projectile. */
+    std::vector<float> ys;          /**< Y of each projectile. */
+    std::vector<float> speeds_x;    /**< X speed of each projectile in pixels per second. */
+    std::vector<float> speeds_y;    /**< Y speed of each projectile in pixels per second. */
+    std::unordered_map<uint32_t, size_t>
+        indexes;                    /**< Index in the arrays of each projectile id. */
+    std::vector<Entity*> targets;   /**< Entities found by the last broad-phase query. */
+
+};
+
+}
+
+#endif
@@ -41,6 +41,11 @@ class SimpleTilePattern: public TilePattern {
         const Tileset& tileset,
         const Point& viewport
     ) const override;
+    virtual bool draw_software(
+        SDL_Surface& dst_surface,
+        const Point& dst_position,
+        const SDL_Surface& tiles_image
+    ) const override;
 
     virtual bool is_animated() const override;
 
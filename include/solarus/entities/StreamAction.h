@@ -51,6 +51,7 @@ class StreamAction {
 
   private:
 
+    void update_stream_parameters();
     void recompute_movement();
     bool test_obstacles(int dx, int dy);
     bool has_reached_target() const;
@@ -70,6 +71,14 @@ class StreamAction {
     uint32_t next_move_date;      /**< Date of the next one-pixel move. */
     uint32_t delay;               /**< Interval between two one-pixel moves. */
 
+    int stream_direction;         /**< Direction of the stream when the
+                                   * values below were computed. */
+    int stream_speed;             /**< Speed of the stream when the values
+                                   * below were computed. */
+    Point stream_step;            /**< One-pixel move in the stream direction. */
+    uint32_t straight_delay;      /**< Delay between two moves along the stream. */
+    uint32_t diagonal_delay;      /**< Delay adjusted to a diagonal movement. */
+
 };
 
 }
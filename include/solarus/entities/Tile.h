@@ -58,12 +58,18 @@ class Tile: public Entity {
     const TilePattern& get_tile_pattern() const;
     const std::string& get_tile_pattern_id() const;
     bool is_animated() const;
+    void switch_tileset(
+        const Tileset& old_tileset,
+        const Tileset& new_tileset,
+        bool same_patterns
+    );
 
   private:
 
     const std::string tile_pattern_id;       /**< Id of the tile pattern. */
-    const TilePattern& tile_pattern;         /**< Pattern of the tile. */
-    const Tileset& tileset;                  /**< Tileet of the pattern. */
+    const int tile_pattern_index;            /**< Interned index of the tile pattern id. */
+    const TilePattern* tile_pattern;         /**< Pattern of the tile. */
+    const Tileset* tileset;                  /**< Tileset of the pattern. */
 
 };
 
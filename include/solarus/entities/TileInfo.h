@@ -34,6 +34,7 @@ struct TileInfo {
   int layer;
   Rectangle box;
   std::string pattern_id;
+  int pattern_index = -1;
   const TilePattern* pattern = nullptr;
   const Tileset* tileset = nullptr;
 };
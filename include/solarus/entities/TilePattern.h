@@ -22,6 +22,8 @@
 #include "solarus/entities/Ground.h"
 #include "solarus/graphics/SurfacePtr.h"
 
+struct SDL_Surface;
+
 namespace Solarus {
 
 class Point;
@@ -49,7 +51,6 @@ class TilePattern {
 
     static void initialize();
     static void quit();
-    static void update();
     void fill_surface(
         const SurfacePtr& dst_surface,
         const Rectangle& dst_position,
@@ -71,6 +72,16 @@ class TilePattern {
         const Tileset& tileset,
         const Point& viewport
     ) const = 0;
+    bool fill_software_surface(
+        SDL_Surface& dst_surface,
+        const Rectangle& dst_position,
+        const SDL_Surface& tiles_image
+    ) const;
+    virtual bool draw_software(
+        SDL_Surface& dst_surface,
+        const Point& dst_position,
+        const SDL_Surface& tiles_image
+    ) const;
     virtual bool is_animated() const;
     virtual bool is_drawn_at_its_position() const;
 
@@ -22,7 +22,7 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 struct lua_State;
 
@@ -30,11 +30,18 @@ namespace Solarus {
 
 class TilePattern;
 class TilePatternData;
+class TilesetData;
 
 /**
  * \brief A set of tile patterns that are used to compose a map.
  *
  * A tileset represents the skin of a map.
+ *
+ * Tile patterns are stored in a flat array indexed by interned pattern ids,
+ * shared by all tilesets: once a tile knows the index of its pattern,
+ * finding the same pattern in another tileset is a direct access.
+ * Tilesets whose patterns have the same ids and properties are siblings:
+ * switching between them only changes the images.
  */
 class Tileset {
 
@@ -43,6 +50,7 @@ class Tileset {
     explicit Tileset(const std::string& id);
 
     void load();
+    void load(const TilesetData& data);
     void unload();
 
     const std::string& get_id() const;
@@ -51,18 +59,36 @@ class Tileset {
     const SurfacePtr& get_tiles_image() const;
     const SurfacePtr& get_entities_image() const;
     const TilePattern& get_tile_pattern(const std::string& id) const;
+    const TilePattern& get_tile_pattern(int index) const;
+    const TilePattern* find_tile_pattern(int index) const;
+    bool has_same_patterns(const Tileset& other) const;
     void set_images(const std::string& other_id);
 
+    static int get_tile_pattern_index(const std::string& id);
+    static void switch_tile(
+        const Tileset& old_tileset,
+        const Tileset& new_tileset,
+        bool same_patterns,
+        int pattern_index,
+        const Tileset*& tileset,
+        const TilePattern*& pattern
+    );
+
   private:
 
+    void load_images();
     void add_tile_pattern(
         const std::string& id,
         const TilePatternData& pattern_data
     );
 
     const std::string id;          /**< Id of the tileset. */
-    std::unordered_map<std::string, std::unique_ptr<TilePattern>>
-        tile_patterns;             /**< Tile patterns in this tileset. */
+    std::vector<std::unique_ptr<TilePattern>>
+        tile_patterns;             /**< Tile patterns in this tileset indexed
+                                    * by interned id, nullptr if missing. */
+    std::vector<int>
+        patterns_layout;           /**< Indexes and properties of all patterns,
+                                    * to detect siblings. */
     Color background_color;        /**< Background color of the tileset. */
     SurfacePtr tiles_image;        /**< Image from which the tile patterns are extracted. */
     SurfacePtr entities_image;     /**< Image from which the tileset-dependent sprites are
@@ -37,7 +37,6 @@ class TimeScrollingTilePattern: public SimpleTilePattern {
 
     static void initialize();
     static void quit();
-    static void update();
     virtual void draw(
         const SurfacePtr& dst_surface,
         const Point& dst_position,
@@ -49,8 +48,7 @@ class TimeScrollingTilePattern: public SimpleTilePattern {
 
   private:
 
-    static int shift;                   /**< number of pixels to shift, increased with the time */
-    static uint32_t next_shift_date;    /**< when the shift variable is incremented */
+    static uint32_t start_date;         /**< Date when all scrollings started. */
 
 };
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DRAW_LIST_H
+#define SOLARUS_DRAW_LIST_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/DrawablePtr.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <functional>
+#include <vector>
+
+namespace Solarus {
+
+class Drawable;
+
+/**
+ * \brief Recorded operations on a destination surface, to be replayed later.
+ *
+ * Drawables are kept by reference: replaying the list draws them as they are
+ * at that time, with their current frame, position and effects.
+ * Only the operations themselves and their parameters are frozen.
+ */
+class SOLARUS_API DrawList {
+
+  public:
+
+    DrawList();
+
+    bool is_empty() const;
+    size_t get_num_commands() const;
+    void clear();
+
+    void add_draw(const DrawablePtr& drawable, const Point& dst_position);
+    void add_draw_region(
+        const DrawablePtr& drawable,
+        const Rectangle& region,
+        const Point& dst_position
+    );
+    void add_clear();
+    void add_fill(const Color& color);
+    void add_fill(const Color& color, const Rectangle& where);
+
+    void replay(
+        const SurfacePtr& dst_surface,
+        const std::function<void (Drawable&)>& before_draw
+    ) const;
+
+  private:
+
+    /**
+     * \brief Kinds of recorded operations.
+     */
+    enum class CommandType {
+      DRAW,                     /**< Drawing a whole drawable. */
+      DRAW_REGION,              /**< Drawing a region of a drawable. */
+      CLEAR,                    /**< Clearing the whole destination. */
+      FILL,                     /**< Filling the whole destination with a color. */
+      FILL_RECTANGLE            /**< Filling a rectangle of the destination with a color. */
+    };
+
+    /**
+     * \brief A recorded operation.
+     */
+    struct Command {
+      CommandType type;         /**< Kind of operation. */
+      DrawablePtr drawable;     /**< Drawable to draw, or nullptr. */
+      Rectangle region;         /**< Source region or filled rectangle. */
+      Point dst_position;       /**< Where to draw the drawable. */
+      Color color;              /**< Fill color. */
+    };
+
+    std::vector<Command> commands;  /**< Operations in their order. */
+
+};
+
+}
+
+#endif
+
@@ -3,6 +3,7 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/graphics/BlendMode.h"
+#include "solarus/graphics/DrawTransform.h"
 
 #include <array>
 
@@ -14,30 +15,33 @@ struct DrawProxy;
  * @brief Struct used to pass drawing arguments trough the drawing pipeline
  *
  * It contains all the information needed to perform a draw of a drawable to another,
- * it could be updated in the future to support more parameters, such as rotation and scale
+ * including the rotation, scale and color modulation that the terminal proxy applies
+ * to the quads it emits.
  */
 struct DrawInfos {
   inline constexpr DrawInfos(const Rectangle& region,const Point& dst_position,
             BlendMode blend_mode, uint8_t opacity,
-            const DrawProxy& proxy):
+            const DrawProxy& proxy,
+            const DrawTransform& transform = DrawTransform::identity()):
     region(region),dst_position(dst_position),
     blend_mode(blend_mode), opacity(opacity),
-    proxy(proxy) {}
+    proxy(proxy), transform(transform) {}
   inline constexpr DrawInfos(const DrawInfos& other, const DrawProxy& proxy) :
-    DrawInfos(other.region,other.dst_position,other.blend_mode,other.opacity,proxy) {}
+    DrawInfos(other.region,other.dst_position,other.blend_mode,other.opacity,proxy,other.transform) {}
   inline constexpr DrawInfos(const DrawInfos &other, const Rectangle& region,
             const Point& dst_position) :
-    DrawInfos(region,dst_position,other.blend_mode,other.opacity,other.proxy) {}
+    DrawInfos(region,dst_position,other.blend_mode,other.opacity,other.proxy,other.transform) {}
   inline constexpr DrawInfos(const DrawInfos &other, const Point& dst_position) :
-    DrawInfos(other.region,dst_position,other.blend_mode,other.opacity,other.proxy) {}
+    DrawInfos(other.region,dst_position,other.blend_mode,other.opacity,other.proxy,other.transform) {}
   inline constexpr DrawInfos(const DrawInfos& other,uint8_t opacity):
-    DrawInfos(other.region,other.dst_position,other.blend_mode,opacity,other.proxy) {}
+    DrawInfos(other.region,other.dst_position,other.blend_mode,opacity,other.proxy,other.transform) {}
   //TODO more helper constructors
   const Rectangle& region; /**< The region of the source surface that will be drawn*/
   const Point& dst_position; /**< The position in the target surface where the surface will be drawn */
   BlendMode blend_mode; /**< blend mode that will be used */
   uint8_t   opacity; /**< opacity modulator */
   const DrawProxy& proxy; /**< proxy that drawer should use when drawing */
+  const DrawTransform& transform; /**< rotation, scale and color applied to the emitted quads */
 };
 
 /**
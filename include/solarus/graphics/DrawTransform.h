@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DRAW_TRANSFORM_H
+#define SOLARUS_DRAW_TRANSFORM_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Color.h"
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * \brief Rotation, scale and color modulation applied while drawing.
+ *
+ * The renderer applies it to each quad it emits: drawing a rotated or
+ * scaled drawable costs the same as drawing it normally,
+ * without any intermediate surface.
+ * The scale is applied first, then the rotation, both around the pivot.
+ */
+struct SOLARUS_API DrawTransform {
+
+  DrawTransform();
+
+  bool is_identity() const;
+  bool is_geometric() const;
+  bool is_color_modulated() const;
+
+  void apply(double& x, double& y) const;
+  Rectangle get_scaled_rectangle(const Rectangle& rect) const;
+  Rectangle get_bounding_box(const Rectangle& rect) const;
+  uint64_t combine_signature(uint64_t signature) const;
+
+  static const DrawTransform& identity();
+
+  double rotation;        /**< Counter-clockwise angle in radians. */
+  double scale_x;         /**< Horizontal scale, negative to flip. */
+  double scale_y;         /**< Vertical scale, negative to flip. */
+  Point pivot;            /**< Center of the rotation and scale
+                           * in destination coordinates. */
+  Color color;            /**< Multiplies the color of drawn pixels
+                           * (the alpha component is ignored). */
+
+};
+
+}
+
+#endif
+
@@ -26,6 +26,7 @@
 #include "solarus/lua/ExportableToLua.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include "solarus/graphics/DrawProxies.h"
+#include "solarus/graphics/DrawTransform.h"
 #include <memory>
 
 namespace Solarus {
@@ -63,7 +64,7 @@ class Drawable: public ExportableToLua {
 
     void start_transition(
         std::unique_ptr<Transition> transition,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
     void stop_transition();
     Transition* get_transition();
@@ -112,6 +113,7 @@ class Drawable: public ExportableToLua {
     ) const = 0;
 
     virtual void update();
+    virtual bool needs_update() const;
     bool is_suspended() const;
     virtual void set_suspended(bool suspended);
 
@@ -121,11 +123,22 @@ class Drawable: public ExportableToLua {
     uint8_t get_opacity() const;
     void set_opacity(uint8_t opacity);
 
+    double get_rotation() const;
+    void set_rotation(double rotation);
+    double get_scale_x() const;
+    double get_scale_y() const;
+    void set_scale(double scale_x, double scale_y);
+    const Point& get_transformation_origin() const;
+    void set_transformation_origin(const Point& origin);
+    const Color& get_color_modulation() const;
+    void set_color_modulation(const Color& color);
+
     virtual Rectangle get_region() const = 0;
   protected:
     Drawable();
   private:
     const DrawProxy& terminal() const;
+    DrawTransform get_dst_transform(const Point& dst_position) const;
 
     Point xy;                     /**< Current position of this object
                                    * (result of movements). */
@@ -140,6 +153,8 @@ class Drawable: public ExportableToLua {
     BlendMode blend_mode;         /**< How to draw this object on a surface. */
     ShaderPtr shader;             /**< Optional shader used to draw the object */
     uint8_t opacity = 255;              /**< Opacity of this drawable object */
+    DrawTransform transform;      /**< Rotation, scale and color modulation,
+                                   * with a pivot relative to the origin. */
 };
 
 }
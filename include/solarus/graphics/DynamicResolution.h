@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DYNAMIC_RESOLUTION_H
+#define SOLARUS_DYNAMIC_RESOLUTION_H
+
+#include "solarus/core/Common.h"
+
+namespace Solarus {
+
+/**
+ * \brief Chooses the resolution of the final rendering pass from the load.
+ *
+ * The load of a frame is its work time divided by the frame budget.
+ * After each window of frames, the scale goes down one step if the average
+ * load was high, and up one step if it was low.
+ * The gap between both thresholds and the restart of the window after each
+ * change avoid oscillating between two scales.
+ */
+class SOLARUS_API DynamicResolution {
+
+  public:
+
+    DynamicResolution();
+
+    bool is_enabled() const;
+    void set_enabled(bool enabled);
+    double get_scale() const;
+
+    void add_frame(double work_time, double budget);
+
+    static constexpr double min_scale = 0.5;    /**< Lowest scale of the resolution. */
+    static constexpr double scale_step = 0.125; /**< Change of scale at each decision. */
+    static constexpr int window_size = 30;      /**< Frames averaged before each decision. */
+    static constexpr double high_load = 0.9;    /**< Average load over which the scale goes down. */
+    static constexpr double low_load = 0.6;     /**< Average load under which the scale goes up. */
+
+  private:
+
+    bool enabled;                               /**< Whether the scale can be lower than 1. */
+    double scale;                               /**< Current scale of the resolution. */
+    double total_load;                          /**< Sum of the loads of the current window. */
+    int num_frames;                             /**< Frames in the current window. */
+
+};
+
+}
+
+#endif
+
@@ -40,39 +40,25 @@ class GlArbShader : public Shader {
 #ifdef SOLARUS_HAVE_OPENGL
     static bool initialize();
 
-    explicit GlArbShader(const std::string& shader_id);
+    explicit GlArbShader(
+        const std::string& shader_id,
+        const std::string& built_in_fragment_source = ""
+    );
     ~GlArbShader();
 
-    void set_uniform_1b(
-        const std::string& uniform_name, bool value) override;
-    void set_uniform_1i(
-        const std::string& uniform_name, int value) override;
-    void set_uniform_1f(
-        const std::string& uniform_name, float value) override;
-    void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2) override;
-    void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3) override;
-    void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-    bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
-
-    void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
+    using Shader::render;
+    void render(const VertexArray &array, SDL_Texture* texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
 
     std::string default_vertex_source() const override;
     std::string default_fragment_source() const override;
   protected:
     void load() override;
+    int find_uniform_location(const std::string& uniform_name) const override;
+    void upload_uniform(const Uniform& uniform) override;
   private:
 
-    struct TextureUniform{
-      SurfacePtr surface;
-      GLuint unit;
-    };
-
     GLhandleARB create_shader(unsigned int type, const char* source);
     static void set_rendering_settings();
-    GLint get_uniform_location(const std::string& uniform_name) const;
 
     GLhandleARB program;                         /**< The program which bind the vertex and fragment shader. */
     GLhandleARB vertex_shader;                   /**< The vertex shader. */
@@ -80,20 +66,25 @@ class GlArbShader : public Shader {
     GLint position_location;                     /**< The location of the position attrib. */
     GLint tex_coord_location;                    /**< The location of the tex_coord attrib. */
     GLint color_location;                        /**< The location of the color attrib. */
-    mutable std::map<std::string, GLint>
-        uniform_locations;                       /**< Cache of uniform locations. */
-    mutable std::map<std::string, TextureUniform>
-        uniform_textures;                        /**< Uniform texture value of surfaces. */
-    GLuint current_texture_unit = 0;
+    GLint mvp_matrix_location;                   /**< The location of the MVP matrix uniform. */
+    GLint uv_matrix_location;                    /**< The location of the UV matrix uniform. */
 #else
 
   static bool initialize() { return false; }
-  explicit GlArbShader(const std::string& shader_id): Shader(shader_id)  {}
+  explicit GlArbShader(
+      const std::string& shader_id,
+      const std::string& built_in_fragment_source = ""
+  ): Shader(shader_id, built_in_fragment_source)  {}
 
-  void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) {}
+  using Shader::render;
+  void render(const VertexArray &array, SDL_Texture* texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) {}
 
   std::string default_vertex_source() const { return ""; }
   std::string default_fragment_source() const { return ""; }
+
+protected:
+  int find_uniform_location(const std::string& /* uniform_name */) const override { return -1; }
+  void upload_uniform(const Uniform& /* uniform */) override {}
 #endif // SOLARUS_HAVE_OPENGL
 };
 
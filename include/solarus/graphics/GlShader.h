@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/graphics/Shader.h"
+#include <memory>
 #include <unordered_map>
 #include <SDL.h>
 #include <string>
@@ -39,56 +40,68 @@ class GlShader : public Shader {
 
   static bool initialize();
 
-  explicit GlShader(const std::string& shader_id);
+  explicit GlShader(
+      const std::string& shader_id,
+      const std::string& built_in_fragment_source = ""
+  );
   ~GlShader();
 
-  void set_uniform_1b(
-      const std::string& uniform_name, bool value) override;
-  void set_uniform_1i(
-      const std::string& uniform_name, int value) override;
-  void set_uniform_1f(
-      const std::string& uniform_name, float value) override;
-  void set_uniform_2f(
-      const std::string& uniform_name, float value_1, float value_2) override;
-  void set_uniform_3f(
-      const std::string& uniform_name, float value_1, float value_2, float value_3) override;
-  void set_uniform_4f(
-      const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-  bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
-
-  void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
+  using Shader::render;
+  void render(const VertexArray &array, SDL_Texture* texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) override;
 
   std::string default_vertex_source() const override;
   std::string default_fragment_source() const override;
 protected:
   void load() override;
+  int find_uniform_location(const std::string& uniform_name) const override;
+  void upload_uniform(const Uniform& uniform) override;
 private:
 
+  /**
+   * \brief A linked program, shared by shaders with the same sources.
+   */
+  struct Program {
+    Program();
+    ~Program();
+
+    GLuint program;                       /**< The program which bind the vertex and fragment shader. */
+    GLuint vertex_shader;                 /**< The vertex shader, or 0 if loaded from a binary. */
+    GLuint fragment_shader;               /**< The fragment shader, or 0 if loaded from a binary. */
+    const GlShader* user;                 /**< Shader whose uniform values are in the program. */
+  };
+
+  std::shared_ptr<Program> create_program(
+      const std::string& key,
+      const std::string& vertex_source,
+      const std::string& fragment_source
+  );
+  bool link_program(GLuint program);
+  static bool load_program_binary(GLuint program, const std::string& key);
+  static void save_program_binary(GLuint program, const std::string& key);
+
   void check_gl_error();
   void enable_attribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer);
   void restore_attribute_states();
 
-  struct TextureUniform{
-    SurfacePtr surface;
-    GLuint unit;
-  };
-
   GLuint create_shader(unsigned int type, const char* source);
   static void set_rendering_settings();
-  GLint get_uniform_location(const std::string& uniform_name) const;
 
+  std::shared_ptr<Program> shared_program;     /**< The program, possibly shared with other shaders. */
   GLuint program;                         /**< The program which bind the vertex and fragment shader. */
-  GLuint vertex_shader;                   /**< The vertex shader. */
-  GLuint fragment_shader;                 /**< The fragment shader. */
   GLint position_location;                     /**< The location of the position attrib. */
   GLint tex_coord_location;                    /**< The location of the tex_coord attrib. */
   GLint color_location;                        /**< The location of the color attrib. */
-  mutable std::map<std::string, GLint>
-      uniform_locations;                       /**< Cache of uniform locations. */
-  mutable std::map<std::string, TextureUniform>
-      uniform_textures;                        /**< Uniform texture value of surfaces. */
+  GLint mvp_matrix_location;                   /**< The location of the MVP matrix uniform. */
+  GLint uv_matrix_location;                    /**< The location of the UV matrix uniform. */
+  glm::mat4 uploaded_mvp_matrix;               /**< MVP matrix uploaded to the program. */
+  glm::mat3 uploaded_uv_matrix;                /**< UV matrix uploaded to the program. */
+  std::unordered_map<int, SDL_Texture*>
+      wrapped_textures;                        /**< Texture of each texture uniform whose
+                                                * wrap mode was set, by uniform handle. */
   std::unordered_map<GLuint, GLint> attribute_states;    /**< Previous attrib states. */
-  GLuint current_texture_unit = 0;
+
+  static std::unordered_map<std::string, std::weak_ptr<Program>>
+      programs;                                /**< Programs alive, by key of their sources. */
 
 };
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GLYPH_ATLAS_H
+#define SOLARUS_GLYPH_ATLAS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <unordered_map>
+#include <SDL_ttf.h>
+
+namespace Solarus {
+
+/**
+ * \brief Glyphs of an outline font rendered once for a size, mode and color.
+ *
+ * Each glyph is rendered the first time it is needed and kept as a small
+ * immutable surface. Such surfaces are placed in the shared texture atlas,
+ * so that a line of text is drawn as batched quads of the same texture
+ * instead of being rendered to a new surface whenever it changes.
+ */
+class GlyphAtlas {
+
+  public:
+
+    /**
+     * \brief A rendered glyph and its metrics.
+     */
+    struct Glyph {
+      SurfacePtr surface;     /**< Pixels of the glyph, or nullptr if blank. */
+      Point offset;           /**< Position of the surface relative to the pen
+                               * on the top of the line. */
+      int advance;            /**< Horizontal distance to the next pen position. */
+    };
+
+    GlyphAtlas(TTF_Font& font, bool antialiasing, const Color& color);
+
+    TTF_Font& get_font() const;
+    const Glyph& get_glyph(uint16_t code_point);
+    int get_kerning(uint16_t previous_code_point, uint16_t code_point) const;
+
+  private:
+
+    Glyph render_glyph(uint16_t code_point) const;
+
+    TTF_Font& font;                                 /**< The font at the size of this atlas. */
+    bool antialiasing;                              /**< Whether glyphs are blended or solid. */
+    Color color;                                    /**< Color of glyphs. */
+    bool kerning;                                   /**< Whether the font applies kerning. */
+    std::unordered_map<uint16_t, Glyph> glyphs;     /**< Glyphs rendered so far. */
+
+};
+
+}
+
+#endif
+
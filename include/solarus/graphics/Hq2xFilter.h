@@ -33,11 +33,16 @@ class Hq2xFilter: public SoftwarePixelFilter {
     Hq2xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+
+  protected:
+
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int end_row
     ) const override;
 
 };
@@ -33,15 +33,20 @@ class Hq4xFilter: public SoftwarePixelFilter {
     Hq4xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+
+    static void initialize_hqx();
+
+  protected:
+
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int end_row
     ) const override;
 
-    static void initialize_hqx();
-
 };
 
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PARTICLE_EMITTER_H
+#define SOLARUS_PARTICLE_EMITTER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A drawable that emits and moves many small images.
+ *
+ * Particles all use the same image and are drawn centered on their position,
+ * relative to the position where the emitter is drawn.
+ * They appear at a random point of the emission area, whose top-left corner
+ * is the position of the emitter.
+ * Each particle moves in a straight line with some gravity
+ * and disappears at the end of its lifetime, optionally fading out.
+ *
+ * Particles are stored as one array per property, so that updating
+ * thousands of them is a few simple loops, and drawing them is a sequence
+ * of draws of the same texture that are batched together.
+ */
+class ParticleEmitter: public Drawable {
+
+  public:
+
+    explicit ParticleEmitter(const SurfacePtr& image);
+
+    const SurfacePtr& get_image() const;
+    const Size& get_emission_size() const;
+    void set_emission_size(const Size& emission_size);
+    int get_max_particles() const;
+    void set_max_particles(int max_particles);
+    double get_rate() const;
+    void set_rate(double rate);
+    uint32_t get_lifetime() const;
+    void set_lifetime(uint32_t lifetime);
+    double get_speed() const;
+    double get_speed_variation() const;
+    void set_speed(double speed, double speed_variation);
+    double get_angle() const;
+    double get_angle_variation() const;
+    void set_angle(double angle, double angle_variation);
+    double get_gravity_x() const;
+    double get_gravity_y() const;
+    void set_gravity(double gravity_x, double gravity_y);
+    bool is_fading_out() const;
+    void set_fading_out(bool fading_out);
+
+    int get_num_particles() const;
+    void emit(int count);
+    void clear();
+
+    virtual void update() override;
+    virtual bool needs_update() const override;
+
+    virtual Size get_size() const override;
+    virtual Rectangle get_region() const override;
+    virtual void raw_draw(Surface& dst_surface, const DrawInfos& infos) const override;
+    virtual void raw_draw_region(Surface& dst_surface, const DrawInfos& infos) const override;
+
+    virtual const std::string& get_lua_type_name() const override;
+
+    static constexpr int default_max_particles = 1000;  /**< Default limit of particles alive. */
+    static constexpr uint32_t default_lifetime = 1000;   /**< Default lifetime in milliseconds. */
+
+  private:
+
+    void remove_particle(size_t index);
+    void draw_particles(Surface& dst_surface, const DrawInfos& infos, const Rectangle* region) const;
+
+    SurfacePtr image;               /**< Image of each particle. */
+    Size emission_size;             /**< Size of the area where particles appear. */
+    int max_particles;              /**< Particles beyond this number are not emitted. */
+    double rate;                    /**< Particles emitted per second. */
+    double emission_credit;         /**< Fraction of particle not emitted yet. */
+    uint32_t lifetime;              /**< Lifetime of particles in milliseconds. */
+    double speed;                   /**< Initial speed in pixels per second. */
+    double speed_variation;         /**< Maximum random change of the initial speed. */
+    double angle;                   /**< Initial direction in radians. */
+    double angle_variation;         /**< Maximum random change of the initial direction. */
+    float gravity_x;                /**< Horizontal acceleration in pixels per second squared. */
+    float gravity_y;                /**< Vertical acceleration in pixels per second squared. */
+    bool fading_out;                /**< Whether particles become transparent with age. */
+    uint32_t last_update_date;      /**< Date of the previous update. */
+
+    std::vector<float> xs;          /**< X of each particle. */
+    std::vector<float> ys;          /**< Y of each particle. */
+    std::vector<float> speeds_x;    /**< X speed of each particle. */
+    std::vector<float> speeds_y;    /**< Y speed of each particle. */
+    std::vector<uint32_t> ages;     /**< Age of each particle in milliseconds. */
+
+};
+
+}
+
+#endif
+
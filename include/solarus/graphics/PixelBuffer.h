@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PIXEL_BUFFER_H
+#define SOLARUS_PIXEL_BUFFER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/ExportableToLua.h"
+#include <cstdint>
+#include <string>
+#include <SDL.h>
+
+namespace Solarus {
+
+/**
+ * \brief Direct access to the pixels of a region of a surface.
+ *
+ * While locked, pixels are read and written in the CPU copy of the surface
+ * without any conversion to a string.
+ * Locking reads back from the GPU at most what was drawn on the surface
+ * since the last readback, and unlocking only uploads the smallest rectangle
+ * containing the pixels changed.
+ *
+ * Coordinates are relative to the region.
+ * The surface should not be drawn on while it is locked: a later readback
+ * could replace pixels not uploaded yet.
+ */
+class SOLARUS_API PixelBuffer: public ExportableToLua {
+
+  public:
+
+    PixelBuffer(const SurfacePtr& surface, const Rectangle& region);
+    ~PixelBuffer();
+
+    const SurfacePtr& get_surface() const;
+    const Rectangle& get_region() const;
+    const Rectangle& get_dirty_region() const;
+
+    bool is_locked() const;
+    void lock();
+    void unlock();
+
+    bool contains(int x, int y) const;
+    Color get_pixel(int x, int y) const;
+    void set_pixel(int x, int y, const Color& color);
+    void fill_with_color(const Color& color);
+
+    std::string get_pixels() const;
+    void set_pixels(const std::string& buffer);
+
+    virtual const std::string& get_lua_type_name() const override;
+
+  private:
+
+    uint32_t* get_row(int y) const;
+    void add_dirty_region(const Rectangle& dirty_rectangle);
+
+    SurfacePtr surface;               /**< The surface whose pixels are accessed. */
+    Rectangle region;                 /**< Region of the surface, clipped to it. */
+    SDL_Surface* pixels;              /**< CPU pixels of the surface while locked, or nullptr. */
+    Rectangle dirty_region;           /**< Pixels changed since the lock, in surface coordinates. */
+
+};
+
+}
+
+#endif
+
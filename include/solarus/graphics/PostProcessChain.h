@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_POST_PROCESS_CHAIN_H
+#define SOLARUS_POST_PROCESS_CHAIN_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/ShaderPtr.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Shaders applied one after the other to the quest surface.
+ *
+ * Each pass renders the output of the previous one into an intermediate
+ * target whose size is the quest size multiplied by the scale of the pass,
+ * for example 0.5 for a half-resolution blur.
+ * Targets are kept in a pool and reused from one frame to the next,
+ * alternating between two targets of the same size, so that no texture is
+ * created or read back while the chain does not change.
+ * The final shader of the video then renders the result to the screen.
+ */
+class SOLARUS_API PostProcessChain {
+
+  public:
+
+    /**
+     * \brief A shader of the chain.
+     */
+    struct Pass {
+      ShaderPtr shader;     /**< The shader to apply. */
+      double scale;         /**< Size of the output relative to the quest size. */
+    };
+
+    PostProcessChain();
+
+    bool is_empty() const;
+    const std::vector<Pass>& get_passes() const;
+    void set_passes(const std::vector<Pass>& passes);
+    void clear();
+
+    SurfacePtr apply(const SurfacePtr& source_surface);
+
+    static constexpr double min_scale = 0.0625;  /**< Lowest scale of a pass. */
+    static constexpr double max_scale = 4.0;     /**< Highest scale of a pass. */
+
+  private:
+
+    SurfacePtr get_target(const Size& size, const SurfacePtr& input);
+
+    std::vector<Pass> passes;                    /**< Shaders of the chain in order. */
+    std::vector<SurfacePtr> targets;             /**< Intermediate targets that can be reused. */
+
+};
+
+}
+
+#endif
+
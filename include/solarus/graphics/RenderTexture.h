@@ -1,11 +1,14 @@
 #pragma once
 
 #include "solarus/graphics/SurfaceImpl.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/core/Debug.h"
 #include "DrawProxies.h"
+#include <vector>
 
 
 namespace Solarus {
@@ -32,13 +35,26 @@ public:
     SDL_Texture* get_texture() const override;
     SDL_Surface* get_surface() const override;
 
+    SDL_Surface* get_surface_to_overwrite() const override;
+
     template<typename Func>
     /**
      * @brief setup draw environnement for drawing on the target texture
      * @param closure work to achieve while the target texture is bound
      */
     void with_target(Func closure) const {
-      surface_dirty = true;
+      with_target(Rectangle(0,0,get_width(),get_height()),closure);
+    }
+
+    template<typename Func>
+    /**
+     * @brief setup draw environnement for drawing on a region of the target texture
+     * @param damaged region that the closure is allowed to change
+     * @param closure work to achieve while the target texture is bound
+     */
+    void with_target(const Rectangle& damaged, Func closure) const {
+      SpriteBatch::flush();
+      dirty_region |= damaged;
       auto renderer = Video::get_renderer();
       SOLARUS_CHECK_SDL(SDL_SetRenderTarget(renderer,target.get()));
       closure(renderer);
@@ -56,12 +72,41 @@ public:
 
     void clear();
     void clear(const Rectangle& where);
-    ~RenderTexture(){
-    }
+    ~RenderTexture();
+
+    /**
+     * @brief Pixel transfers from the GPU since the last call to take_readback_statistics()
+     */
+    struct ReadbackStatistics {
+      int num_readbacks = 0;      /**< number of reads */
+      int num_full_readbacks = 0; /**< reads of a whole surface */
+      int64_t num_pixels = 0;     /**< total pixels transferred */
+    };
+
+    static ReadbackStatistics take_readback_statistics();
+    static void quit();
 private:
-    mutable bool surface_dirty = true; /**< is the surface not up to date*/
-    mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data */
+    /**
+     * @brief A target texture released by a render texture, kept for reuse
+     */
+    struct PooledTarget {
+      Size size;                      /**< size of the texture */
+      SDL_Texture_UniquePtr target;   /**< the texture */
+    };
+
+    SDL_Surface* get_backup_surface() const;
+
+    int width;                      /**< width of the texture */
+    int height;                     /**< height of the texture */
+    mutable Rectangle dirty_region; /**< region where the surface is not up to date */
+    mutable bool surface_cleared = false; /**< whether the surface must be cleared before use */
+    mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data, created on the first readback */
     mutable SDL_Texture_UniquePtr target; /**< gpu side pixels data */
+    MemoryStats::Category memory_category; /**< origin of the texture in memory stats */
+
+    static ReadbackStatistics readback_statistics; /**< readbacks of the current frame */
+    static constexpr size_t max_pooled_targets = 8; /**< released targets kept for reuse */
+    static std::vector<PooledTarget> target_pool;  /**< released targets, oldest first */
 };
 
 }
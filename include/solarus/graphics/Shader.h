@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Debug.h"
+#include "solarus/graphics/DrawTransform.h"
 #include "solarus/graphics/ShaderData.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/VertexArrayPtr.h"
@@ -31,7 +32,9 @@
 
 #include "solarus/graphics/Drawable.h"
 
+#include <map>
 #include <string>
+#include <vector>
 
 #ifdef SOLARUS_HAVE_OPENGL
 #  include <SDL_opengl.h>
@@ -39,6 +42,8 @@
 #  include <SDL_opengles2.h>
 #endif
 
+struct SDL_Texture;
+
 namespace Solarus {
 
 /**
@@ -57,7 +62,10 @@ class Shader : public DrawProxy, public ExportableToLua {
     constexpr static const char* TIME_NAME = "sol_time";
     constexpr static const char* OPACITY_NAME = "sol_opacity";
 
-    explicit Shader(const std::string& shader_id);
+    explicit Shader(
+        const std::string& shader_id,
+        const std::string& built_in_fragment_source = ""
+    );
     virtual ~Shader();
 
     bool is_valid() const;
@@ -65,6 +73,7 @@ class Shader : public DrawProxy, public ExportableToLua {
 
     const std::string& get_id() const;
     const ShaderData& get_data() const;
+    const std::string& get_built_in_fragment_source() const;
 
     std::string get_vertex_source() const;
     std::string get_fragment_source() const;
@@ -72,47 +81,133 @@ class Shader : public DrawProxy, public ExportableToLua {
     virtual std::string default_vertex_source() const = 0;
     virtual std::string default_fragment_source() const = 0;
 
-    virtual void set_uniform_1b(
-        const std::string& uniform_name, bool value);  // TODO make pure virtual
-    virtual void set_uniform_1i(
+    int get_uniform_handle(const std::string& uniform_name);
+    bool is_uniform_handle_valid(int uniform_handle) const;
+
+    void set_uniform_1b(
+        const std::string& uniform_name, bool value);
+    void set_uniform_1i(
         const std::string& uniform_name, int value);
-    virtual void set_uniform_1f(
+    void set_uniform_1f(
         const std::string& uniform_name, float value);
-    virtual void set_uniform_2f(
+    void set_uniform_2f(
         const std::string& uniform_name, float value_1, float value_2);
-    virtual void set_uniform_3f(
+    void set_uniform_3f(
         const std::string& uniform_name, float value_1, float value_2, float value_3);
-    virtual void set_uniform_4f(
+    void set_uniform_4f(
         const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4);
-    virtual bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value);
-
-    void render(const Surface &surface, const Rectangle &region, const Size &dst_size, const Point &dst_position = Point(), bool flip_y = false);
+    bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value);
+
+    void set_uniform_1b(int uniform_handle, bool value);
+    void set_uniform_1i(int uniform_handle, int value);
+    void set_uniform_1f(int uniform_handle, float value);
+    void set_uniform_2f(int uniform_handle, float value_1, float value_2);
+    void set_uniform_3f(int uniform_handle, float value_1, float value_2, float value_3);
+    void set_uniform_4f(int uniform_handle, float value_1, float value_2, float value_3, float value_4);
+    bool set_uniform_texture(int uniform_handle, const SurfacePtr& value);
+
+    void render(const Surface &surface, const Rectangle &region, const Size &dst_size, const Point &dst_position = Point(), bool flip_y = false,
+                const DrawTransform& transform = DrawTransform::identity());
+    void render_stretched(const Surface& surface, const Size& dst_size);
     virtual void draw(Surface& dst_surface, const Surface &src_surface, const DrawInfos &infos) const override;
 
+    void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3());
+
     /**
      * @brief render the given vertex array with this shader, passing the texture and matrices as uniforms
      * @param array a vertex array
-     * @param texture a valid surface
+     * @param texture a valid SDL texture
      * @param mvp_matrix model view projection matrix
      * @param uv_matrix uv_matrix
      */
-    virtual void render(const VertexArray &array, const Surface &texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) = 0;
+    virtual void render(const VertexArray &array, SDL_Texture* texture, const glm::mat4& mvp_matrix = glm::mat4(), const glm::mat3& uv_matrix = glm::mat3()) = 0;
 
     const std::string& get_lua_type_name() const override;
 
   protected:
+
+    /**
+     * \brief Kind of value of a uniform variable.
+     */
+    enum class UniformType {
+      NONE,          /**< No value was set yet. */
+      INTEGER,       /**< Boolean or integer value. */
+      FLOAT_1,       /**< float value. */
+      FLOAT_2,       /**< vec2 value. */
+      FLOAT_3,       /**< vec3 value. */
+      FLOAT_4,       /**< vec4 value. */
+      TEXTURE        /**< Surface sampled on its own texture unit. */
+    };
+
+    /**
+     * \brief Last value given to a uniform variable.
+     *
+     * Values are only uploaded to the program when it renders,
+     * and only if they changed since the previous upload.
+     */
+    struct Uniform {
+      int location;              /**< Location in the program, -1 if the
+                                  * program does not use this uniform. */
+      UniformType type;          /**< Kind of the value. */
+      int int_value;             /**< Value of an INTEGER uniform,
+                                  * or texture unit of a TEXTURE uniform. */
+      float float_values[4];     /**< Components of a FLOAT_N uniform. */
+      SurfacePtr texture;        /**< Surface of a TEXTURE uniform. */
+      bool dirty;                /**< Whether the value needs to be uploaded. */
+    };
+
     void set_valid(bool valid);
     void set_error(const std::string& error);
     void set_data(const ShaderData& data);
     virtual void load();  // TODO make pure virtual
+
+    /**
+     * \brief Returns the location of a uniform in the program.
+     * \param uniform_name Name of the uniform.
+     * \return The location, or -1 if the program has no such uniform.
+     */
+    virtual int find_uniform_location(const std::string& uniform_name) const = 0;
+
+    /**
+     * \brief Uploads the value of a uniform to the program.
+     *
+     * The program is the current one when this function is called.
+     *
+     * \param uniform A uniform with a valid location.
+     */
+    virtual void upload_uniform(const Uniform& uniform) = 0;
+
+    void upload_dirty_uniforms();
+    void mark_all_uniforms_dirty();
+    std::vector<Uniform>& get_uniforms();
+    const std::vector<int>& get_texture_uniforms() const;
+
     static VertexArray screen_quad; /**< The quad used to draw surfaces with shaders*/
 
   private:
 
+    Uniform* get_uniform_to_set(int uniform_handle, UniformType type);
+    void set_uniform_floats(int uniform_handle, UniformType type, const float* values);
+    void find_built_in_uniforms();
+
     const std::string shader_id;  /**< The id of the shader (filename without extension). */
     ShaderData data;              /**< The loaded shader data file. */
+    const std::string
+        built_in_fragment_source; /**< Fragment source of a shader provided by
+                                   * the engine, or an empty string. */
     bool valid;                   /**< \c true if the compilation succedeed. */
     std::string error;            /**< Error message of the last operation if any. */
+
+    std::map<std::string, int>
+        uniform_handles;          /**< Handle of each uniform name requested. */
+    std::vector<Uniform> uniforms;  /**< Uniform values indexed by handle. */
+    std::vector<int> dirty_uniforms;  /**< Handles of uniforms to upload. */
+    std::vector<int> texture_uniforms;  /**< Handles of TEXTURE uniforms. */
+    int num_texture_units;        /**< Texture units used by TEXTURE uniforms. */
+    int time_handle;              /**< Handle of the sol_time uniform, or -1 if not found yet. */
+    int output_size_handle;       /**< Handle of the sol_output_size uniform. */
+    int input_size_handle;        /**< Handle of the sol_input_size uniform. */
+    int opacity_handle;           /**< Handle of the sol_opacity uniform. */
 };
 
 }
@@ -37,10 +37,16 @@ class ShaderContext {
     static void quit();
 
     static const std::string& get_opengl_version();
+    static const std::string& get_opengl_vendor();
+    static const std::string& get_opengl_renderer();
     static const std::string& get_shading_language_version();
     static void make_current();
 
     static ShaderPtr create_shader(const std::string& shader_id);
+    static ShaderPtr create_built_in_shader(
+        const std::string& name,
+        const std::string& fragment_source
+    );
 
   private:
 
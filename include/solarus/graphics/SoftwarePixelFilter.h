@@ -22,6 +22,8 @@
 
 namespace Solarus {
 
+class ThreadPool;
+
 /**
  * \brief Abstract class for software pixel filtering algorithms.
  *
@@ -41,23 +43,53 @@ class SoftwarePixelFilter {
      */
     virtual int get_scaling_factor() const = 0;
 
+    void filter(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst
+    ) const;
+    void filter(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst,
+        ThreadPool& thread_pool
+    ) const;
+
+  protected:
+
     /**
-     * \brief Applies the algorithm on a rectangle of pixels.
+     * \brief Applies the algorithm on some rows of a rectangle of pixels.
+     *
+     * Rows outside the range are only read, as neighbors of the filtered
+     * ones. This function may be called from several threads at the same
+     * time with different ranges.
+     *
      * \param src The rectangle of pixels in RGBA format.
-     * Must be a buffer of size src_width * dst_width.
+     * Must be a buffer of size src_width * src_height.
      * \param src_width Width of the rectangle.
      * \param src_height Height of the rectangle.
      * \param dst The destination rectangle to write.
      * Must be a buffer of size
-     * src_width * dst_width * get_scaling_factor().
+     * src_width * src_height * get_scaling_factor()^2.
+     * \param first_row First source row to filter.
+     * \param end_row Source row after the last one to filter.
      */
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int end_row
     ) const = 0;
 
+  private:
+
+    static constexpr int min_band_height = 16;  /**< Minimum number of rows
+                                                 * filtered by a thread. */
+
 };
 
 }
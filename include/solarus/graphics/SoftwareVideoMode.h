@@ -25,12 +25,13 @@
 namespace Solarus {
 
 class SoftwarePixelFilter;
-class Shader;
 
 /**
  * \brief Represents a method to display the quest content on the screen.
  *
  * The video mode may include a scaling algorithm.
+ * When shaders are supported, the scaling can be done on the GPU by a
+ * built-in fragment shader instead of the software filter.
  *
  * \deprecated Software video modes are deprecated since Solarus 1.6.
  * The new recommended way is to use shaders.
@@ -42,12 +43,14 @@ class SoftwareVideoMode {
     SoftwareVideoMode(
         const std::string& name,
         const Size& initial_window_size,
-        std::unique_ptr<SoftwarePixelFilter> software_filter
+        std::unique_ptr<SoftwarePixelFilter> software_filter,
+        const std::string& shader_source = ""
     );
 
     const std::string& get_name() const;
     const Size& get_initial_window_size() const;
     const SoftwarePixelFilter* get_software_filter() const;
+    const std::string& get_shader_source() const;
 
   private:
 
@@ -57,6 +60,8 @@ class SoftwareVideoMode {
 
     std::unique_ptr<SoftwarePixelFilter>
         software_filter;           /**< Software scaling pixel filter to use or nullptr. */
+    std::string shader_source;     /**< Fragment shader doing the same scaling
+                                    * on the GPU, or an empty string. */
 
 };
 
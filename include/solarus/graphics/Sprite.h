@@ -23,6 +23,7 @@
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <map>
+#include <memory>
 #include <string>
 
 namespace Solarus {
@@ -85,6 +86,8 @@ class Sprite: public Drawable {
     void set_frame_delay(uint32_t frame_delay);
     uint32_t get_next_frame_date() const;
     void set_synchronized_to(const SpritePtr& other);
+    bool is_global_clock_enabled() const;
+    void set_global_clock_enabled(bool global_clock_enabled);
 
     bool is_animation_started() const;
     void start_animation();
@@ -108,7 +111,10 @@ class Sprite: public Drawable {
     bool test_collision(const Sprite& other, int x1, int y1, int x2, int y2) const;
 
     // update and draw
+    bool can_precompute_frames() const;
+    void precompute_frames(uint32_t now);
     virtual void update() override;
+    virtual bool needs_update() const override;
     void draw_intermediate() const;
 
     Rectangle clamp_region(const Rectangle& region) const;
@@ -120,21 +126,41 @@ class Sprite: public Drawable {
 
     // Lua
     const ScopedLuaRef& get_finished_callback() const;
-    void set_finished_callback(const ScopedLuaRef& finished_callback_ref);
+    void set_finished_callback(ScopedLuaRef finished_callback_ref);
     virtual const std::string& get_lua_type_name() const override;
 
   private:
 
-    static SpriteAnimationSet& get_animation_set(const std::string& id);
+    static std::shared_ptr<SpriteAnimationSet> get_animation_set(const std::string& id);
+    void reload_animation_set();
     int get_next_frame() const;
+    uint32_t get_first_frame_date(uint32_t now) const;
+    void update_global_clock_frame(uint32_t now);
     Surface& get_intermediate_surface() const ;
     void set_frame_changed(bool frame_changed);
+    bool has_frame_observers() const;
     void notify_finished();
+    void cancel_precomputed_frames();
+    void commit_precomputed_frames();
+
+    /**
+     * \brief Frame state computed ahead of update() by a parallel phase.
+     */
+    struct PrecomputedFrames {
+      bool valid = false;                  /**< Whether the fields below can be committed. */
+      uint32_t date = 0;                   /**< Simulated time of the computation. */
+      bool frame_changed = false;          /**< Whether the frame changed. */
+      bool finished_now = false;           /**< Whether the animation has just finished. */
+      int current_frame = -1;              /**< New current frame. */
+      uint32_t next_frame_date = 0;        /**< New date of the next frame. */
+      bool blink_is_sprite_visible = true; /**< New blink visibility. */
+      uint32_t blink_next_change_date = 0; /**< New date of the next blink change. */
+    };
 
     // animation set
-    static std::map<std::string, SpriteAnimationSet*> all_animation_sets;
     const std::string animation_set_id;  /**< id of this sprite's animation set */
-    SpriteAnimationSet& animation_set;   /**< animation set of this sprite */
+    std::shared_ptr<SpriteAnimationSet>
+        animation_set;                   /**< animation set of this sprite */
 
     // current state of the sprite
 
@@ -156,6 +182,9 @@ class Sprite: public Drawable {
     SpritePtr
         synchronize_to;                /**< another sprite to synchronize the frame to
                                         * when they have the same animation name (or nullptr) */
+    bool global_clock_enabled;         /**< true to derive the frame from the current date
+                                        * rather than from when the animation started */
+    bool has_synchronized_sprites;     /**< true if other sprites were synchronized to this one */
 
     // effects
     mutable SurfacePtr
@@ -168,6 +197,8 @@ class Sprite: public Drawable {
         finished_callback_ref;         /**< Lua ref to an action to do when this movement finishes.
                                         * Automatically cleared when executed. */
 
+    PrecomputedFrames precomputed;     /**< Result of precompute_frames() not committed yet. */
+
 };
 
 }
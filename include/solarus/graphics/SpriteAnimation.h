@@ -22,6 +22,7 @@
 #include "solarus/graphics/Drawable.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,7 @@ class SpriteAnimation {
     void set_tileset(const Tileset& tileset);
 
     int get_next_frame(int current_direction, int current_frame) const;
+    int get_frame_at_step(int current_direction, uint32_t step) const;
     void draw(Surface& dst_surface, const Point& dst_position,
         int current_direction, int current_frame, const DrawInfos& infos) const;
 
@@ -60,6 +62,8 @@ class SpriteAnimation {
     void enable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
 
+    size_t get_memory_size() const;
+
   private:
 
     void do_enable_pixel_collisions();
@@ -22,6 +22,8 @@
 #include "solarus/core/PixelBits.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <memory>
 #include <vector>
 
 namespace Solarus {
@@ -55,7 +57,7 @@ class SpriteAnimationDirection {
         int current_frame, Surface& src_image, const DrawInfos &infos) const;
 
     // pixel collisions
-    void enable_pixel_collisions(Surface& src_image);
+    void enable_pixel_collisions(const SurfacePtr& src_image);
     void disable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
     const PixelBits& get_pixel_bits(int frame) const;
@@ -66,9 +68,13 @@ class SpriteAnimationDirection {
     Point origin;                       /**< coordinates of the sprite's origin from the
                                          * upper-left corner of its image. */
 
-    std::vector<PixelBits>
-        pixel_bits;                    /**< bit masks representing the non-transparent pixels of each frame,
-                                         * computed only if enable_pixel_collisions() is called */
+    const PixelBits& compute_pixel_bits(int frame) const;
+
+    SurfacePtr pixel_bits_image;        /**< Image to compute the bit masks from,
+                                         * or nullptr if pixel collisions are disabled. */
+    mutable std::vector<std::shared_ptr<const PixelBits>>
+        pixel_bits;                     /**< bit masks representing the non-transparent pixels of each frame,
+                                         * computed the first time the frame is tested */
 };
 
 /**
@@ -85,6 +91,7 @@ inline const Point& SpriteAnimationDirection::get_origin() const {
  * It represents the transparent bits of the frame and permits to detect
  * pixel-precise collisions.
  * The pixel collisions must be enabled.
+ * The bits are computed the first time a frame is needed.
  *
  * \param frame A frame of the animation.
  * \return The pixel bits object of a frame.
@@ -95,7 +102,10 @@ inline const PixelBits& SpriteAnimationDirection::get_pixel_bits(int frame) cons
       "Pixel-precise collisions are not enabled for this sprite");
   SOLARUS_ASSERT(frame >= 0 && frame < get_nb_frames(), "Invalid frame number");
 
-  return pixel_bits[frame];
+  if (pixel_bits[frame] == nullptr) {
+    return compute_pixel_bits(frame);
+  }
+  return *pixel_bits[frame];
 }
 
 }
@@ -20,6 +20,7 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
+#include <cstddef>
 #include <map>
 #include <string>
 
@@ -29,6 +30,7 @@ namespace Solarus {
 
 class SpriteAnimation;
 class SpriteAnimationData;
+class SpriteData;
 class Tileset;
 
 /**
@@ -44,6 +46,7 @@ class SpriteAnimationSet {
   public:
 
     explicit SpriteAnimationSet(const std::string& id);
+    SpriteAnimationSet(const std::string& id, const SpriteData& data);
 
     void set_tileset(const Tileset& tileset);
 
@@ -57,9 +60,15 @@ class SpriteAnimationSet {
     const Size& get_max_size() const;
     const Rectangle& get_max_bounding_box() const;
 
+    size_t get_memory_size() const;
+
+    bool is_obsolete() const;
+    void set_obsolete();
+
   private:
 
     void load();
+    void load(const SpriteData& data);
 
     void add_animation(const std::string& animation_name,
         const SpriteAnimationData& animation_data);
@@ -72,6 +81,8 @@ class SpriteAnimationSet {
     Rectangle max_bounding_box;              /**< Rectangle big enough to contain any frame.
                                               * Can be larger than max_size if
                                               * the origin changes. */
+    bool obsolete;                           /**< Whether a newer version of this
+                                              * animation set should be used. */
 
 };
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SPRITE_BATCH_H
+#define SOLARUS_SPRITE_BATCH_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/DrawTransform.h"
+#include "solarus/graphics/ShaderPtr.h"
+#include <SDL_render.h>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+class RenderTexture;
+class SurfaceImpl;
+
+/**
+ * \brief Collects surface draws that share their state.
+ *
+ * Draws of a texture onto a render texture are not done immediately:
+ * they are queued as long as the destination and the blend mode stay the
+ * same. The queue is flushed when they change, before any other operation
+ * on a render texture (fills, shaders, readbacks...) and before rendering
+ * the frame.
+ *
+ * Queued draws are grouped in batches of the same source texture.
+ * A draw joins an earlier batch of its texture when it does not overlap
+ * the batches queued after that one, since drawing it sooner then gives
+ * the same pixels. Repeated tiles and sprites interleaved with other
+ * textures are therefore still drawn together.
+ *
+ * With OpenGL shaders, a flush is a single draw call of a vertex array
+ * where each quad has its own opacity, color modulation and transformed
+ * corners.
+ * Otherwise, the render target and the blend mode are set once per flush
+ * and quads are drawn with SDL_RenderCopy(), or SDL_RenderCopyEx() when
+ * they are rotated or scaled.
+ */
+class SpriteBatch {
+
+  public:
+
+    static void quit();
+
+    static void add(
+        RenderTexture& dst_texture,
+        const SurfaceImpl& src_texture,
+        const Rectangle& src_rect,
+        const Rectangle& dst_rect,
+        SDL_BlendMode blend_mode,
+        uint8_t opacity,
+        const DrawTransform& transform = DrawTransform::identity()
+    );
+    static void flush();
+    static void notify_texture_destroyed(const SDL_Texture* texture);
+    static int take_num_draw_calls();
+    static int take_num_texture_binds();
+
+  private:
+
+    /**
+     * \brief A queued draw.
+     */
+    struct Quad {
+      Rectangle src_rect;       /**< Region of the source texture. */
+      Rectangle dst_rect;       /**< Where to draw it on the destination. */
+      uint8_t opacity;          /**< Opacity of this draw. */
+      DrawTransform transform;  /**< Rotation, scale and color of this draw. */
+    };
+
+    /**
+     * \brief Queued draws of the same source texture.
+     */
+    struct Batch {
+      SDL_Texture* src_texture = nullptr;  /**< Source texture of the draws. */
+      Size src_texture_size;               /**< Size of the source texture. */
+      Rectangle bounding_box;              /**< Union of the destination rectangles. */
+      std::vector<Quad> quads;             /**< Draws in their order. */
+    };
+
+    static void flush_batches(size_t count);
+    static void render_batch(const Batch& batch);
+    static void render_sdl(SDL_Renderer* renderer, SDL_Texture* texture, const std::vector<Quad>& quads);
+    static void render_sdl_transformed(SDL_Renderer* renderer, SDL_Texture* texture, const Quad& quad);
+    static void render_gl(
+        const Size& dst_size, SDL_Texture* texture, const Size& texture_size, const std::vector<Quad>& quads
+    );
+
+    static constexpr size_t max_batches = 8;  /**< Older batches are flushed beyond this. */
+
+    static RenderTexture* dst_texture;      /**< Destination of queued draws, or nullptr. */
+    static SDL_BlendMode blend_mode;        /**< Blend mode of queued draws. */
+    static std::vector<Batch> batches;      /**< Queued batches in drawing order,
+                                             * followed by unused ones kept for their storage. */
+    static size_t num_batches;              /**< Number of queued batches. */
+    static bool flushing;                   /**< Whether batches are being drawn. */
+    static ShaderPtr shader;                /**< Built-in shader for OpenGL flushes, or nullptr. */
+    static int num_draw_calls;              /**< Draw calls done since the last call
+                                             * to take_num_draw_calls(). */
+    static int num_texture_binds;           /**< Source textures bound since the last call
+                                             * to take_num_texture_binds(). */
+
+};
+
+}
+
+#endif
+
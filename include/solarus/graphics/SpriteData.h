@@ -144,6 +144,10 @@ class SOLARUS_API SpriteData : public LuaData {
     virtual bool import_from_lua(lua_State* l) override;
     virtual bool export_to_lua(std::ostream& out) const override;
 
+    virtual std::string get_binary_magic() const override;
+    virtual bool import_from_binary(BinaryReader& reader) override;
+    virtual bool export_to_binary(BinaryWriter& writer) const override;
+
   private:
 
     static int l_animation(lua_State* l);
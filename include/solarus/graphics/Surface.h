@@ -18,6 +18,7 @@
 #define SOLARUS_SURFACE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/PixelBits.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Drawable.h"
@@ -26,6 +27,7 @@
 
 
 #include <cstdint>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,6 +38,7 @@ class Color;
 class Size;
 class SoftwarePixelFilter;
 class Surface;
+class ThreadPool;
 
 /**
  * \brief Represents a graphic surface.
@@ -47,6 +50,7 @@ class Surface;
 class Surface: public Drawable {
 
     friend class Shader;
+    friend class Texture;
     friend class VertexArray; //TODO find cleaner way
   public:
     using SurfaceImpl_UniquePtr = std::unique_ptr<SurfaceImpl>;
@@ -80,6 +84,15 @@ class Surface: public Drawable {
     static SurfacePtr create(const Size& size, bool premultiplied = false);
     static SurfacePtr create(const std::string& file_name,
         ImageDirectory base_directory = DIR_SPRITES, bool premultiplied = false);
+    static SurfacePtr create_async(const std::string& file_name,
+        ImageDirectory base_directory = DIR_SPRITES, bool premultiplied = false);
+    static SDL_Surface* decode_image(
+        const std::string& prefixed_file_name, bool language_specific);
+    static void update_async_loads();
+    static void finish_async_loads();
+
+    bool is_loading() const;
+    void finish_loading();
 
     int get_width() const;
     int get_height() const;
@@ -115,7 +128,9 @@ class Surface: public Drawable {
     virtual Rectangle get_region() const override;
 
     void apply_pixel_filter(
-        const SoftwarePixelFilter& pixel_filter, Surface& dst_surface) const;
+        const SoftwarePixelFilter& pixel_filter,
+        Surface& dst_surface,
+        ThreadPool* thread_pool = nullptr) const;
 
     static SDL_BlendMode make_sdl_blend_mode(const SurfaceImpl &dst_surface, const SurfaceImpl &src_surface, BlendMode blend_mode);
 
@@ -127,13 +142,26 @@ class Surface: public Drawable {
     uint32_t get_color_value(const Color& color) const;
 
 
+    static std::string get_prefixed_file_name(
+        const std::string& file_name,
+        ImageDirectory base_directory);
+    static std::string get_image_key(
+        const std::string& prefixed_file_name,
+        bool language_specific);
     static SurfaceImpl* get_surface_from_file(
         const std::string& file_name,
         ImageDirectory base_directory);
+    static SDL_Surface* copy_sdl_surface(const SDL_Surface& surface);
 
 
     SurfaceImpl_UniquePtr
         internal_surface;                 /**< The SDL_Surface encapsulated. */
+    std::future<std::shared_ptr<SDL_Surface>>
+        loading_image;                    /**< Image being decoded by create_async(),
+                                           * invalid once loaded. */
+    std::string loading_image_key;        /**< Cache key of the image being decoded. */
+    MemoryStats::Category
+        loading_memory_category;          /**< Origin of the texture of the image being decoded. */
 };
 
 }
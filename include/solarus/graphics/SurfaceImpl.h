@@ -4,6 +4,7 @@
 #include "solarus/core/Point.h"
 
 #include <SDL_render.h>
+#include <cstdint>
 
 namespace Solarus {
 
@@ -34,6 +35,16 @@ public:
      */
     virtual SDL_Surface* get_surface() const = 0;
 
+    /**
+     * @brief get the SDL_Surface to replace all its pixels
+     *
+     * The current pixels may be stale, the caller must overwrite
+     * them all and then call upload_surface().
+     *
+     * @return a valid SDL_Surface
+     */
+    virtual SDL_Surface* get_surface_to_overwrite() const;
+
     /**
      * @brief get texture width
      * @return width
@@ -46,6 +57,23 @@ public:
      */
     virtual int get_height() const = 0;
 
+    /**
+     * @brief get the position of the pixels in the texture
+     *
+     * Non-zero when the texture is an atlas page shared with other images.
+     *
+     * @return position of the top-left pixel in get_texture()
+     */
+    virtual Point get_texture_offset() const;
+
+    /**
+     * @brief get the size of the whole texture
+     * @return size of get_texture(), bigger than the surface in an atlas
+     */
+    virtual Size get_texture_size() const;
+
+    Rectangle to_texture_region(const Rectangle& region) const;
+
     /**
      * @brief upload potentially modified surface
      *
@@ -54,6 +82,17 @@ public:
      */
     void upload_surface();
 
+    /**
+     * @brief upload a region of a potentially modified surface
+     * @param region region to upload in surface coordinates, clipped to the surface
+     */
+    void upload_surface(const Rectangle& region);
+
+    /**
+     * @brief called after the pixels of the surface were modified and uploaded
+     */
+    virtual void notify_pixels_changed();
+
     /**
      * @brief ~SurfaceImpl
      */
@@ -67,8 +106,30 @@ public:
 
     bool is_premultiplied() const;
     void set_premultiplied(bool a_premultiplied);
+
+    /**
+     * @brief get a value identifying the current pixels
+     *
+     * Equal signatures mean equal pixels, which allows to detect
+     * that a surface was redrawn with the same content.
+     *
+     * @return signature of the content
+     */
+    uint64_t get_content_signature() const;
+
+    /**
+     * @brief give a new unique signature after an unknown change of the pixels
+     */
+    void invalidate_content_signature() const;
+
+    static uint64_t combine_signature(uint64_t signature, uint64_t value);
+protected:
+    mutable uint64_t content_signature = make_unique_signature(); /**< identifies the current pixels */
 private:
+    static uint64_t make_unique_signature();
+
     bool premultiplied = false;
+    static uint64_t num_unique_signatures; /**< unique signatures given so far */
 };
 
 }
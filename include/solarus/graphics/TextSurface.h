@@ -19,16 +19,17 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Drawable.h"
 #include <map>
 #include <string>
+#include <vector>
 #include <SDL_ttf.h>
 
 namespace Solarus {
 
-class Size;
-
 /**
  * \brief Draws a line of text on a surface.
  *
@@ -39,6 +40,10 @@ class Size;
  * Two types of fonts are supported:
  * - usual fonts (TTF and other formats are supported),
  * - an image containing characters drawn.
+ *
+ * Characters are drawn as quads of an image shared by all texts:
+ * the glyph atlas of outline fonts or the bitmap of bitmap fonts.
+ * Changing the text only computes their positions.
  */
 class TextSurface: public Drawable {
 
@@ -116,9 +121,21 @@ class TextSurface: public Drawable {
 
   private:
 
+    /**
+     * \brief A character to draw.
+     */
+    struct GlyphQuad {
+      SurfacePtr surface;                             /**< Image containing the character. */
+      Rectangle src_rect;                             /**< Region of the character in the image. */
+      Point dst_position;                             /**< Position of the character in the text. */
+    };
+
     void rebuild();
-    void rebuild_bitmap();
-    void rebuild_ttf();
+    void add_bitmap_glyphs(size_t first_byte);
+    void add_ttf_glyphs(size_t first_byte);
+    void update_text_position();
+    void draw_glyphs(Surface& dst_surface, const DrawInfos& infos) const;
+    const Surface& get_composed_surface() const;
 
     std::string font_id;                              /**< id of the font of the current text surface */
     HorizontalAlignment horizontal_alignment;         /**< horizontal alignment of the current text surface */
@@ -130,8 +147,15 @@ class TextSurface: public Drawable {
     int x;                                            /**< x coordinate of where the text is aligned */
     int y;                                            /**< y coordinate of where the text is aligned */
 
-    SurfacePtr surface;                               /**< the surface to draw */
-    Point text_position;                              /**< position of the top-left corner of the surface on the screen */
+    std::vector<GlyphQuad> glyphs;                    /**< the characters to draw */
+    Point pen_position;                               /**< where the character after the text would go */
+    uint16_t previous_code_point;                     /**< last character of the text, for kerning */
+    Size text_size;                                   /**< size of the text */
+    Point text_position;                              /**< position of the top-left corner of the text on the screen */
+    mutable SurfacePtr
+        composed_surface;                             /**< the characters drawn on one surface, for draw proxies
+                                                       * that need it, or nullptr */
+    mutable bool composed_surface_valid;              /**< whether composed_surface shows the current text */
 
     std::string text;                                 /**< the string to draw (only one line) */
 
@@ -1,29 +1,70 @@
 #pragma once
 
 #include "solarus/graphics/SurfaceImpl.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/TextureAtlas.h"
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace Solarus {
 
 /**
  * @brief SurfaceImpl representing immutable surface data
  *
- * Textures are mainly created from image files
+ * Textures are mainly created from image files.
+ * Small images from files are placed in a shared atlas page instead of
+ * having their own SDL texture.
+ *
+ * With a memory budget, textures of image files that were not modified
+ * can release their CPU copy and then their GPU texture, least recently
+ * used first. They are loaded again from the file data when needed.
+ * This is only done from the main thread.
  */
 class Texture : public SurfaceImpl
 {
 public:
-    Texture(SDL_Surface* surface);
+    Texture(SDL_Surface* surface, bool allow_atlas = false);
+    ~Texture();
     SDL_Texture* get_texture() const override;
     SDL_Surface* get_surface() const override;
+    void notify_pixels_changed() override;
+
+    void set_source_image(const std::string& image_key);
+
+    static int64_t get_memory_budget();
+    static void set_memory_budget(int64_t memory_budget);
+    static void enforce_memory_budget();
 
     int get_width() const override;
     int get_height() const override;
+    Point get_texture_offset() const override;
+    Size get_texture_size() const override;
 
     RenderTexture* to_render_texture() override;
 private:
-    mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data */
-    mutable SDL_Texture_UniquePtr texture; /**< gpu side pixels data */
+    void create_texture() const;
+    void release_surface();
+    void release_texture();
+    int64_t get_surface_memory_size() const;
+
+    mutable SDL_Surface_UniquePtr surface; /**< cpu side pixels data, or nullptr if released */
+    mutable SDL_Texture_UniquePtr texture; /**< gpu side pixels data, unless in an atlas or released */
+    TextureAtlas::PagePtr atlas_page; /**< atlas page containing the pixels, or nullptr */
+    Point atlas_position; /**< position of the pixels in the atlas page */
+    int width; /**< width of the image */
+    int height; /**< height of the image */
+    mutable int bytes_per_pixel; /**< size of a pixel in the gpu side texture */
+    MemoryStats::Category memory_category; /**< origin of the texture in memory stats */
+    std::string source_image_key; /**< image file to load pixels released, or an empty string
+                                   * if they cannot be released */
+    mutable uint64_t last_use; /**< value of num_budget_checks when last used */
+
+    static int64_t memory_budget; /**< bytes allowed for textures and releasable cpu copies, 0 for no limit */
+    static int64_t surfaces_memory_size; /**< bytes of cpu copies of textures with a source image */
+    static uint64_t num_budget_checks; /**< number of calls to enforce_memory_budget() */
+    static std::vector<Texture*> releasable_textures; /**< textures with a source image */
 };
 
 }
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_TEXTURE_ATLAS_H
+#define SOLARUS_TEXTURE_ATLAS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include <memory>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Packs small immutable images into shared textures.
+ *
+ * Images loaded from files are uploaded to a sub-rectangle of an atlas
+ * page rather than to their own texture, so that consecutive draws of
+ * different sprite sheets do not switch textures.
+ *
+ * Pages are owned by the textures placed in them: a page is destroyed
+ * when its last image is. Space freed by other images is reused by the
+ * next ones of the same shelf, so pages don't grow while images change.
+ * Images are separated by a transparent pixel so that filtering does not
+ * pick colors of their neighbors.
+ */
+class TextureAtlas {
+
+  public:
+
+    /**
+     * \brief A texture containing several images.
+     */
+    class Page {
+
+      public:
+
+        explicit Page(const Size& size);
+        ~Page();
+
+        SDL_Texture* get_texture() const;
+        const Size& get_size() const;
+        bool allocate(const Size& image_size, Point& position);
+        void release(const Point& position, const Size& image_size);
+
+      private:
+
+        /**
+         * \brief Free horizontal space in a shelf.
+         */
+        struct Span {
+          int x;                        /**< Left of the space. */
+          int width;                    /**< Width of the space. */
+        };
+
+        /**
+         * \brief A row of images of similar heights.
+         */
+        struct Shelf {
+          int y;                        /**< Top of the shelf in the page. */
+          int height;                   /**< Height of the shelf. */
+          int next_x;                   /**< Where the next image of the shelf goes. */
+          std::vector<Span> free_spans; /**< Space freed before next_x, sorted by x. */
+        };
+
+        static int find_free_span(const Shelf& shelf, int width);
+
+        Size size;                      /**< Size of the page. */
+        SDL_Texture_UniquePtr texture;  /**< The page texture. */
+        std::vector<Shelf> shelves;     /**< Shelves from top to bottom. */
+        int next_shelf_y;               /**< Where the next shelf goes. */
+    };
+
+    using PagePtr = std::shared_ptr<Page>;
+
+    static bool can_contain(const SDL_Surface& image);
+    static PagePtr add_image(const SDL_Surface& image, Point& position);
+    static void remove_image(Page& page, const Point& position, const Size& image_size);
+    static int get_num_pages();
+
+  private:
+
+    static Size get_page_size();
+
+    static constexpr int max_page_size = 2048;   /**< Page side unless the renderer has a lower limit. */
+    static constexpr int max_image_size = 512;   /**< Bigger images get their own texture. */
+    static constexpr int padding = 1;            /**< Transparent pixels between images. */
+
+    static std::vector<std::weak_ptr<Page>>
+        pages;                                   /**< Pages still used by some texture. */
+
+};
+
+}
+
+#endif
+
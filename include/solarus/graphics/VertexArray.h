@@ -98,6 +98,7 @@ public:
     Vertex* data();
     const Vertex* data() const;
     void add_vertex(const Vertex& v);
+    void clear();
     VerticeView add_quad(const Rectangle& rect, const Rectangle& uvs, const Color &color);
     VerticeView make_view(size_t size);
     size_t vertex_count() const;
@@ -19,8 +19,10 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
+#include "solarus/graphics/PostProcessChain.h"
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -37,6 +39,7 @@ class Arguments;
 class Rectangle;
 class Size;
 class SoftwareVideoMode;
+class ThreadPool;
 
 /**
  * \brief Draws the window and handles the video mode.
@@ -66,8 +69,11 @@ namespace Video {
     std::string get_window_title();
     void set_window_title(const std::string& window_title);
 
+    bool are_shaders_enabled();
     const ShaderPtr& get_shader();
     void set_shader(const ShaderPtr& shader);
+    const std::vector<PostProcessChain::Pass>& get_post_process_passes();
+    void set_post_process_passes(const std::vector<PostProcessChain::Pass>& passes);
 
     const SoftwareVideoMode& get_video_mode();
     std::vector<const SoftwareVideoMode*> get_video_modes();
@@ -100,7 +106,22 @@ namespace Video {
     Point window_to_quest_coordinates(const Point& window_xy);
     bool renderer_to_quest_coordinates(const Point& renderer_xy, Point& quest_xy);
 
-    void render(const SurfacePtr& quest_surface);
+    bool render(const SurfacePtr& quest_surface, ThreadPool* thread_pool = nullptr);
+    void invalidate_screen();
+    void present();
+    bool is_present_deferred();
+    void set_present_deferred(bool present_deferred);
+    void set_vsync(const std::string& vsync);
+
+    bool is_dynamic_resolution_enabled();
+    void set_dynamic_resolution_enabled(bool enabled);
+    double get_dynamic_resolution_scale();
+    void update_dynamic_resolution(double frame_time, bool drawn, double budget);
+
+    int64_t get_texture_memory();
+    void notify_texture_memory(const Size& size, bool created, int bytes_per_pixel = 4);
+    uint32_t get_compact_texture_format();
+    void set_compact_textures_enabled(bool compact_textures_enabled);
 
 }  // namespace Video
 
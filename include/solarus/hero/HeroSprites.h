@@ -123,7 +123,7 @@ class HeroSprites {
     void set_animation(const std::string& animation);
     void set_animation(
         const std::string& animation,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
 
     void create_ground(Ground grond);
@@ -152,7 +152,7 @@ class HeroSprites {
     void stop_displaying_trail();
 
     void set_tunic_animation(const std::string& animation);
-    void set_tunic_animation(const std::string& animation, const ScopedLuaRef& callback_ref);
+    void set_tunic_animation(const std::string& animation, ScopedLuaRef callback_ref);
 
     LuaContext& get_lua_context();
 
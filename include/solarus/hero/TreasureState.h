@@ -34,7 +34,7 @@ class Hero::TreasureState: public HeroState {
     TreasureState(
         Hero& hero,
         const Treasure& treasure,
-        const ScopedLuaRef& callback_ref
+        ScopedLuaRef callback_ref
     );
 
     void start(const State* previous_state) override;
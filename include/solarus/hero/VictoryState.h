@@ -30,7 +30,7 @@ class Hero::VictoryState: public HeroState {
 
   public:
 
-    VictoryState(Hero& hero, const ScopedLuaRef& callback_ref);
+    VictoryState(Hero& hero, ScopedLuaRef callback_ref);
 
     virtual void start(const State* previous_state) override;
     virtual void stop(const State* next_state) override;
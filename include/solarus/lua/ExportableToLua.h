@@ -18,8 +18,11 @@
 #define SOLARUS_EXPORTABLE_TO_LUA_H
 
 #include "solarus/core/Common.h"
+#include <bitset>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -36,6 +39,10 @@ class ExportableToLua:
 
   public:
 
+    static constexpr size_t
+        max_known_lua_fields = 128;  /**< Number of field names known by the
+                                      * Lua context that have their own bit. */
+
     ExportableToLua();
     virtual ~ExportableToLua();
 
@@ -45,6 +52,14 @@ class ExportableToLua:
     void set_known_to_lua(bool known_to_lua);
     bool is_with_lua_table() const;
     void set_with_lua_table(bool with_lua_table);
+    uint32_t get_lua_event_mask() const;
+    void set_lua_event_mask(uint32_t lua_event_mask);
+    virtual void notify_lua_event_mask_changed();
+    bool has_known_lua_field(size_t index) const;
+    void set_known_lua_field(size_t index, bool exists);
+    bool has_other_lua_field(const char* key) const;
+    void set_other_lua_field(const char* key, bool exists);
+    void clear_lua_fields();
 
     /**
      * \brief Returns the name identifying this type in Lua.
@@ -61,6 +76,16 @@ class ExportableToLua:
                                   * at least once. */
     bool with_lua_table;         /**< Whether a Lua table was created to make
                                   * this userdata indexable like a table. */
+    uint32_t lua_event_mask;     /**< Frequent callbacks defined in the Lua
+                                  * table of this userdata
+                                  * (see LuaContext::CachedEvent). */
+    std::bitset<max_known_lua_fields>
+        known_lua_fields;        /**< Fields with a name known by the Lua
+                                  * context that exist in the Lua table of
+                                  * this userdata, by index of the name. */
+    std::vector<std::string>
+        other_lua_fields;        /**< Other string keys that exist in the Lua
+                                  * table of this userdata, sorted. */
 
 };
 
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FFI_API_H
+#define SOLARUS_FFI_API_H
+
+#include "solarus/core/Common.h"
+
+/**
+ * \file FfiApi.h
+ * \brief C functions called by Lua scripts through the LuaJIT FFI.
+ *
+ * They are fast paths of some read-only functions of the Lua API that
+ * LuaJIT can compile into traces, unlike classic Lua C functions.
+ * Each userdata parameter is the payload of a Solarus userdata,
+ * which LuaJIT passes when a userdata is given to a \c void* parameter.
+ * The Lua side checks the metatable of values before calling them:
+ * they don't check anything themselves.
+ *
+ * When FFI is not available, the classic functions are used instead.
+ */
+extern "C" {
+
+SOLARUS_API void solarus_ffi_entity_get_position(const void* entity, int* position);
+SOLARUS_API void solarus_ffi_entity_get_bounding_box(const void* entity, int* bounding_box);
+SOLARUS_API int solarus_ffi_entity_get_layer(const void* entity);
+SOLARUS_API int solarus_ffi_sprite_get_frame(const void* sprite);
+SOLARUS_API int solarus_ffi_timer_get_remaining_time(const void* lua_context, const void* timer);
+
+}
+
+#endif
+
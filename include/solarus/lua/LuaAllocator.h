@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LUA_ALLOCATOR_H
+#define SOLARUS_LUA_ALLOCATOR_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Memory allocator of a Lua state.
+ *
+ * Small blocks, like most tables, closures and strings created by scripts,
+ * are taken from pools of blocks of the same size class carved in big
+ * chunks, instead of each going through malloc() and free().
+ * Bigger blocks still come from the heap.
+ *
+ * The allocator counts the memory used by its Lua state and can refuse
+ * allocations above a limit, which makes Lua raise a
+ * "not enough memory" error in the script that allocates.
+ *
+ * A Lua state is only used by one thread at a time, so there is no locking.
+ * Pools are only given back to the heap by clear(), once the Lua state
+ * is closed.
+ */
+class SOLARUS_API LuaAllocator {
+
+  public:
+
+    LuaAllocator();
+    ~LuaAllocator();
+
+    LuaAllocator(const LuaAllocator& other) = delete;
+    LuaAllocator& operator=(const LuaAllocator& other) = delete;
+
+    static void* allocate(void* allocator, void* block, size_t old_size, size_t new_size);
+
+    int64_t get_num_bytes() const;
+    int64_t get_peak_num_bytes() const;
+    int64_t get_num_blocks() const;
+    int64_t get_pool_size() const;
+
+    int64_t get_memory_limit() const;
+    void set_memory_limit(int64_t memory_limit);
+
+    void clear();
+
+    static constexpr size_t
+        granularity = 16;             /**< Small sizes are rounded up to a multiple of this. */
+    static constexpr size_t
+        max_small_block_size = 256;   /**< Bigger blocks always come from the heap. */
+    static constexpr size_t
+        chunk_size = 16384;           /**< Size of the chunks where small blocks are carved. */
+
+  private:
+
+    void* reallocate(void* block, size_t old_size, size_t new_size);
+    void* allocate_block(size_t size);
+    void free_block(void* block, size_t size);
+
+    std::vector<void*> free_blocks;   /**< First free small block of each
+                                       * size class, each free block storing
+                                       * the address of the next one. */
+    std::vector<void*> chunks;        /**< Chunks allocated for small blocks. */
+    int64_t num_bytes;                /**< Bytes currently used by Lua. */
+    int64_t peak_num_bytes;           /**< Highest value of num_bytes. */
+    int64_t num_blocks;               /**< Blocks currently used by Lua. */
+    int64_t memory_limit;             /**< Maximum value of num_bytes, or 0. */
+
+};
+
+}
+
+#endif
+
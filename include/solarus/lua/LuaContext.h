@@ -30,18 +30,24 @@
 #include "solarus/entities/EntityType.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/HeroPtr.h"
+#include "solarus/entities/ProjectilePool.h"
 #include "solarus/graphics/DrawablePtr.h"
+#include "solarus/graphics/DrawList.h"
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
+#include "solarus/lua/LuaAllocator.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <lua.hpp>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
@@ -69,10 +75,12 @@ class MainLoop;
 class Map;
 class Movement;
 class Npc;
+class ParticleEmitter;
 class PathFindingMovement;
 class PathMovement;
 class PixelMovement;
 class Pickable;
+class PixelBuffer;
 class Point;
 class RandomMovement;
 class RandomPathMovement;
@@ -122,8 +130,11 @@ class LuaContext {
     static const std::string map_module_name;
     static const std::string item_module_name;
     static const std::string surface_module_name;
+    static const std::string pixel_buffer_module_name;
     static const std::string text_surface_module_name;
     static const std::string sprite_module_name;
+    static const std::string particle_emitter_module_name;
+    static const std::string projectile_pool_module_name;
     static const std::string menu_module_name;
     static const std::string language_module_name;
     static const std::string shader_module_name;
@@ -137,12 +148,14 @@ class LuaContext {
     static const std::string movement_circle_module_name;
     static const std::string movement_jump_module_name;
     static const std::string movement_pixel_module_name;
+    static const std::string worker_module_name;
 
     explicit LuaContext(MainLoop& main_loop);
     ~LuaContext();
 
     static LuaContext& get_lua_context(lua_State* l);
     lua_State* get_internal_state();
+    const LuaAllocator& get_allocator() const;
 
     MainLoop& get_main_loop();
 
@@ -150,6 +163,8 @@ class LuaContext {
     void initialize();
     void exit();
     void update();
+    bool is_garbage_collector_driven() const;
+    void step_garbage_collector(double max_time);
     bool notify_input(const InputEvent& event);
     void notify_map_suspended(Map& map, bool suspended);
     void notify_shop_treasure_interaction(ShopTreasure& shop_treasure);
@@ -187,6 +202,7 @@ class LuaContext {
     static bool load_file(lua_State* l, const std::string& script_name);
     static void do_file(lua_State* l, const std::string& script_name);
     static bool do_file_if_exists(lua_State* l, const std::string& script_name);
+    void notify_script_changed(const std::string& script_name);
 
     // Calling Lua functions.
     bool call_function(
@@ -195,6 +211,13 @@ class LuaContext {
         const char* function_name
     );
 
+    // Coroutines.
+    bool resume_coroutine(lua_State* thread, int nb_arguments);
+    static ScopedLuaRef create_coroutine_resumer(
+        lua_State* l,
+        const std::string& function_name
+    );
+
     bool userdata_has_field(
         const ExportableToLua& userdata,
         const char* key
@@ -210,7 +233,7 @@ class LuaContext {
     void add_timer(
         const TimerPtr& timer,
         int context_index,
-        const ScopedLuaRef& callback_index
+        ScopedLuaRef callback_ref
     );
     void remove_timer(const TimerPtr& timer);
     void remove_timers(int context_index);
@@ -219,10 +242,14 @@ class LuaContext {
     void notify_timers_map_suspended(bool suspended);
     void set_entity_timers_suspended(Entity& entity, bool suspended);
     void do_timer_callback(const TimerPtr& timer);
+    void schedule_timer(const TimerPtr& timer);
+    int get_num_timers() const;
+    uint64_t get_timers_hash() const;
+    int get_timer_remaining_time(const TimerPtr& timer) const;
 
     // Menus.
     void add_menu(
-        const ScopedLuaRef& menu_ref,
+        ScopedLuaRef menu_ref,
         int context_index,
         bool on_top
     );
@@ -231,12 +258,27 @@ class LuaContext {
     void destroy_menus();
     void update_menus();
 
+    // Savegames.
+    void update_pending_saves();
+
+    // Surfaces.
+    void update_pending_images();
+
+    // Files.
+    void update_pending_file_operations();
+    static int write_file(lua_State* l, bool append);
+
+    // Workers.
+    void update_workers();
+
     // Drawable objects.
     bool has_drawable(const DrawablePtr& drawable);
+    void update_skipped_drawable(Drawable& drawable);
     void add_drawable(const DrawablePtr& drawable);
     void remove_drawable(const DrawablePtr& drawable);
     void destroy_drawables();
     void update_drawables();
+    int get_num_drawables() const;
 
     // Movements.
     void start_movement_on_point(
@@ -252,6 +294,7 @@ class LuaContext {
     // Entities.
     static const std::string& get_entity_internal_type_name(EntityType entity_type);
     bool create_map_entity_from_data(Map& map, const EntityData& entity_data);
+    EntityPtr create_map_entity(Map& map, const EntityData& entity_data);
 
     bool do_custom_entity_traversable_test_function(
         const ScopedLuaRef& traversable_test_ref,
@@ -282,6 +325,7 @@ class LuaContext {
     void main_on_update();
     void main_on_draw(const SurfacePtr& dst_surface);
     bool main_on_input(const InputEvent& event);
+    void main_on_window_state_changed(const std::string& state);
 
     // Menu events.
     void menu_on_started(const ScopedLuaRef& menu_ref);
@@ -324,6 +368,8 @@ class LuaContext {
     void item_on_started(EquipmentItem& item);
     void item_on_finished(EquipmentItem& item);
     void item_on_update(EquipmentItem& item);
+    bool item_table_has_on_update(const EquipmentItem& item) const;
+    bool item_metatable_has_on_update();
     void item_on_suspended(EquipmentItem& item, bool suspended);
     void item_on_map_changed(EquipmentItem& item, Map& map);
     void item_on_pickable_created(EquipmentItem& item, Pickable& pickable);
@@ -372,6 +418,12 @@ class LuaContext {
     bool map_on_command_pressed(Map& map, GameCommand command);
     bool map_on_command_released(Map& map, GameCommand command);
 
+    // Projectile events.
+    void projectile_pool_on_hits(
+        ProjectilePool& projectile_pool,
+        const std::vector<ProjectilePool::Hit>& hits
+    );
+
     // Map entity events.
     void entity_on_update(Entity& entity);
     void entity_on_suspended(Entity& entity, bool suspended);
@@ -457,6 +509,17 @@ class LuaContext {
       main_api_get_type,
       main_api_get_metatable,
       main_api_get_os,
+      main_api_get_frame_timings,
+      main_api_get_allocation_stats,
+      main_api_get_memory_stats,
+      main_api_preload_map,
+      main_api_start_lua_profiler,
+      main_api_stop_lua_profiler,
+      main_api_get_lua_profile,
+      main_api_start_coroutine,
+      main_api_wait,
+      main_api_get_background_mode,
+      main_api_set_background_mode,
 
       // Audio API.
       audio_api_get_sound_volume,
@@ -493,6 +556,11 @@ class LuaContext {
       video_api_reset_window_size,
       video_api_get_shader,
       video_api_set_shader,
+      video_api_get_post_process,
+      video_api_set_post_process,
+      video_api_is_dynamic_resolution_enabled,
+      video_api_set_dynamic_resolution_enabled,
+      video_api_get_dynamic_resolution_scale,
 
       // Input API.
       input_api_is_joypad_enabled,
@@ -517,12 +585,23 @@ class LuaContext {
       file_api_exists,
       file_api_remove,
       file_api_mkdir,
+      file_api_read,
+      file_api_write,
+      file_api_append,
+      file_api_mount_patch,
+
+      // Worker API.
+      worker_api_run,
+      worker_api_get_num_running,
 
       // Menu API.
       menu_api_start,
       menu_api_stop,
       menu_api_stop_all,
       menu_api_is_started,
+      menu_api_set_retained,
+      menu_api_is_retained,
+      menu_api_invalidate,
 
       // Timer API.
       timer_api_start,
@@ -559,6 +638,14 @@ class LuaContext {
       drawable_api_fade_out,
       drawable_api_get_xy,
       drawable_api_set_xy,
+      drawable_api_get_rotation,
+      drawable_api_set_rotation,
+      drawable_api_get_scale,
+      drawable_api_set_scale,
+      drawable_api_get_transformation_origin,
+      drawable_api_set_transformation_origin,
+      drawable_api_get_color_modulation,
+      drawable_api_set_color_modulation,
       drawable_api_get_movement,
       drawable_api_stop_movement,
       drawable_meta_gc,
@@ -572,6 +659,19 @@ class LuaContext {
       surface_api_set_opacity,
       surface_api_get_pixels,
       surface_api_set_pixels,
+      surface_api_lock_pixels,
+
+      // Pixel buffer API.
+      pixel_buffer_api_get_surface,
+      pixel_buffer_api_get_region,
+      pixel_buffer_api_is_locked,
+      pixel_buffer_api_lock,
+      pixel_buffer_api_unlock,
+      pixel_buffer_api_get_pixel,
+      pixel_buffer_api_set_pixel,
+      pixel_buffer_api_fill_color,
+      pixel_buffer_api_get_pixels,
+      pixel_buffer_api_set_pixels,
 
       // Text surface API.
       text_surface_api_create,
@@ -613,6 +713,17 @@ class LuaContext {
       sprite_api_set_paused,
       sprite_api_set_ignore_suspend,  // TODO rename to set_suspended_with_map() like timers
       sprite_api_synchronize,
+      sprite_api_is_global_clock_enabled,
+      sprite_api_set_global_clock_enabled,
+
+      // Particle emitter API.
+      particle_emitter_api_create,
+      particle_emitter_api_emit,
+      particle_emitter_api_clear,
+      particle_emitter_api_get_num_particles,
+      particle_emitter_api_get_rate,
+      particle_emitter_api_set_rate,
+      particle_emitter_api_get_size,
 
       // Shader API.
       shader_api_create,
@@ -621,6 +732,7 @@ class LuaContext {
       shader_api_get_id,
       shader_api_get_vertex_file,
       shader_api_get_fragment_file,
+      shader_api_get_uniform_handle,
       shader_api_set_uniform,
 
       // Movement API.
@@ -632,6 +744,8 @@ class LuaContext {
       movement_api_start,
       movement_api_stop,
       movement_api_get_direction4,
+      movement_api_are_position_notifications_batched,
+      movement_api_set_position_notifications_batched,
       straight_movement_api_get_speed,
       straight_movement_api_set_speed,
       straight_movement_api_get_angle,
@@ -715,6 +829,7 @@ class LuaContext {
       game_api_is_dialog_enabled,
       game_api_start_dialog,
       game_api_stop_dialog,
+      game_api_wait_dialog,
       game_api_is_game_over_enabled,
       game_api_start_game_over,
       game_api_stop_game_over,
@@ -722,6 +837,7 @@ class LuaContext {
       game_api_get_hero,
       game_api_get_value,
       game_api_set_value,
+      game_api_watch_value,
       game_api_get_starting_location,
       game_api_set_starting_location,  // TODO don't do it automatically, use on_map_changed
       game_api_get_life,
@@ -802,6 +918,8 @@ class LuaContext {
       map_api_set_world,
       map_api_get_floor,
       map_api_set_floor,
+      map_api_get_activity_distance,
+      map_api_set_activity_distance,
       map_api_get_min_layer,
       map_api_get_max_layer,
       map_api_get_size,
@@ -810,6 +928,8 @@ class LuaContext {
       map_api_set_tileset,
       map_api_get_music,
       map_api_get_camera,
+      map_api_get_cameras,
+      map_api_create_camera,
       map_api_get_camera_position,
       map_api_move_camera,
       map_api_get_ground,
@@ -827,12 +947,39 @@ class LuaContext {
       map_api_get_entities_count,
       map_api_has_entities,
       map_api_get_entities_by_type,
+      map_api_get_entities_count_by_type,
+      map_api_iterate_entities_by_type,
       map_api_get_entities_in_rectangle,
       map_api_get_entities_in_region,
+      map_api_get_entities_count_in_rectangle,
+      map_api_get_first_entity_in_rectangle,
+      map_api_cast_ray,
+      map_api_get_entities_positions,
       map_api_get_hero,
       map_api_set_entities_enabled,
       map_api_remove_entities,
+      map_api_create_projectile_pool,
+      map_api_remove_projectile_pool,
+      map_api_get_overview_surface,
+      map_api_get_overview_reveal_radius,
+      map_api_set_overview_reveal_radius,
+      map_api_reveal_overview,
+      map_api_is_overview_revealed,
+      map_api_get_overview_revealed_squares,
+      map_api_set_overview_revealed_squares,
       map_api_create_entity,  // Same function used for all entity types.
+      map_api_create_entities,
+
+      // Projectile pool API.
+      projectile_pool_api_create_projectile,
+      projectile_pool_api_remove_projectile,
+      projectile_pool_api_has_projectile,
+      projectile_pool_api_get_projectile_position,
+      projectile_pool_api_get_num_projectiles,
+      projectile_pool_api_get_max_projectiles,
+      projectile_pool_api_clear,
+      projectile_pool_api_get_layer,
+      projectile_pool_api_get_size,
 
       // Map entity API.
       entity_api_get_type,
@@ -860,7 +1007,10 @@ class LuaContext {
       entity_api_set_layer,
       entity_api_overlaps,
       entity_api_get_distance,
+      entity_api_get_distances,
       entity_api_get_angle,
+      entity_api_get_angles,
+      entity_api_play_sound,
       entity_api_get_direction4_to,
       entity_api_get_direction8_to,
       entity_api_bring_to_front,
@@ -876,11 +1026,15 @@ class LuaContext {
       entity_api_set_visible,
       entity_api_get_movement,  // TODO some movement types are not in the Lua API
       entity_api_stop_movement,
+      entity_api_wait_movement,
       entity_api_has_layer_independent_collisions,
       entity_api_set_layer_independent_collisions,
       entity_api_test_obstacles,
       entity_api_get_optimization_distance,
       entity_api_set_optimization_distance,
+      entity_api_is_always_active,
+      entity_api_set_always_active,
+      entity_api_is_dormant,
       entity_api_is_in_same_region,
       entity_api_get_state,
       entity_api_get_property,
@@ -1041,6 +1195,10 @@ class LuaContext {
       custom_entity_api_set_can_traverse_ground,
       custom_entity_api_add_collision_test,
       custom_entity_api_clear_collision_tests,
+      custom_entity_api_get_collision_group,
+      custom_entity_api_set_collision_group,
+      custom_entity_api_is_traversable_cache_enabled,
+      custom_entity_api_set_traversable_cache_enabled,
       custom_entity_api_get_modified_ground,
       custom_entity_api_set_modified_ground,
 
@@ -1060,11 +1218,21 @@ class LuaContext {
                               * LUA_REFNIL means that the menu will be removed. */
       const void* context;   /**< Lua table or userdata the menu is attached to. */
       bool recently_added;   /**< Used to avoid elements added during an iteration. */
-
-      LuaMenuData(const ScopedLuaRef& ref, const void* context):
-        ref(ref),
+      bool retained;         /**< Whether on_draw() is recorded and replayed
+                              * until the menu is invalidated. */
+      bool invalidated;      /**< Whether on_draw() has to be recorded again. */
+      DrawList draw_list;    /**< Recorded draws of on_draw() if retained. */
+      std::weak_ptr<Surface>
+          draw_list_surface; /**< Destination surface of the recording. */
+
+      LuaMenuData(ScopedLuaRef ref, const void* context):
+        ref(std::move(ref)),
         context(context),
-        recently_added(true) {
+        recently_added(true),
+        retained(false),
+        invalidated(true),
+        draw_list(),
+        draw_list_surface() {
       }
     };
 
@@ -1076,14 +1244,94 @@ class LuaContext {
       const void* context;        /**< Lua table or userdata the timer is attached to. */
     };
 
+    /**
+     * \brief A savegame being written by game:save() with a callback.
+     */
+    struct PendingSave {
+      std::shared_future<bool> result;  /**< Whether the save succeeded. */
+      ScopedLuaRef callback_ref;        /**< Lua function to call when finished. */
+    };
+
+    /**
+     * \brief A file being read or written by sol.file functions with a callback.
+     */
+    struct PendingFileOperation {
+      std::shared_future<bool> result;       /**< Whether the operation succeeded. */
+      std::shared_ptr<std::string> content;  /**< Content read, or nullptr for writes. */
+      std::string error_message;             /**< Message given to the callback on failure. */
+      ScopedLuaRef callback_ref;             /**< Lua function to call when finished. */
+    };
+
+    /**
+     * \brief A script running on a separate thread started by sol.worker.run().
+     */
+    struct PendingWorker {
+      std::shared_future<bool> result;       /**< Whether the script succeeded. */
+      std::shared_ptr<std::string> output;   /**< Serialized value returned by
+                                              * the script, or error message. */
+      ScopedLuaRef callback_ref;             /**< Lua function to call when finished. */
+    };
+
+    /**
+     * \brief A surface being loaded by sol.surface.create() with a callback.
+     */
+    struct PendingImage {
+      SurfacePtr surface;               /**< The surface, placeholder until loaded. */
+      ScopedLuaRef callback_ref;        /**< Lua function to call when loaded. */
+    };
+
+    /**
+     * \brief Callbacks tried at each cycle, whose existence is cached.
+     *
+     * Fields created on a userdata are tracked by our __newindex.
+     * Fields of type metatables are looked up again at each cycle.
+     */
+    enum class CachedEvent {
+      ON_UPDATE,
+      ON_DRAW,
+      ON_PRE_DRAW,
+      ON_POST_DRAW
+    };
+
+    /**
+     * \brief An entry of the queue of timers to update.
+     *
+     * Entries are not removed when their timer changes: an entry is obsolete
+     * when its date is no longer the next update date of its timer.
+     */
+    struct ScheduledTimer {
+      uint32_t date;              /**< When the timer needs to be updated. */
+      TimerPtr timer;             /**< The timer. */
+
+      /**
+       * \brief Comparator that puts the earliest date on top of a heap.
+       */
+      static bool is_later(const ScheduledTimer& lhs, const ScheduledTimer& rhs) {
+        return lhs.date > rhs.date;
+      }
+    };
+
     // Executing Lua code.
     bool userdata_has_metafield(
         const ExportableToLua& userdata, const char* key) const;
     bool find_method(int index, const char* function_name);
+    bool userdata_has_event(const ExportableToLua& userdata, CachedEvent event);
+    uint32_t get_metatable_event_mask(const ExportableToLua& userdata);
+    uint32_t get_metatable_event_mask(const std::string& type_name);
+    static void update_userdata_event_mask(
+        ExportableToLua& userdata, const char* key, bool exists);
+    static void update_userdata_field(
+        ExportableToLua& userdata, const char* key, bool exists);
     bool find_method(const char* function_name);
+    bool load_model_script(const std::string& file_name);
     void print_stack(lua_State* l);
     void print_lua_version();
 
+    // Menus.
+    LuaMenuData* find_menu(int menu_index);
+    void retained_menu_on_draw(LuaMenuData& menu, const SurfacePtr& dst_surface);
+    DrawList* get_draw_recording(const Surface& dst_surface);
+
     // Initialization of modules.
     void register_functions(
         const std::string& module_name,
@@ -1101,18 +1349,23 @@ class LuaContext {
     void register_video_module();
     void register_input_module();
     void register_file_module();
+    void register_worker_module();
     void register_timer_module();
     void register_item_module();
     void register_surface_module();
+    void register_pixel_buffer_module();
     void register_text_surface_module();
     void register_sprite_module();
+    void register_particle_emitter_module();
     void register_shader_module();
     void register_movement_module();
     void register_menu_module();
     void register_language_module();
     void register_game_module();
     void register_map_module();
+    void register_projectile_pool_module();
     void register_entity_module();
+    void register_ffi_functions();
     void register_testing_module();
 
     // Pushing objects to Lua.
@@ -1123,15 +1376,18 @@ class LuaContext {
     static void push_dialog(lua_State* l, const Dialog& dialog);
     static void push_timer(lua_State* l, const TimerPtr& timer);
     static void push_surface(lua_State* l, Surface& surface);
+    static void push_pixel_buffer(lua_State* l, PixelBuffer& pixel_buffer);
     static void push_text_surface(lua_State* l, TextSurface& text_surface);
     static void push_sprite(lua_State* l, Sprite& sprite);
+    static void push_particle_emitter(lua_State* l, ParticleEmitter& particle_emitter);
     static void push_shader(lua_State* l, Shader& shader);
     static void push_item(lua_State* l, EquipmentItem& item);
     static void push_movement(lua_State* l, Movement& movement);
     static void push_game(lua_State* l, Savegame& game);
     static void push_map(lua_State* l, Map& map);
+    static void push_projectile_pool(lua_State* l, ProjectilePool& projectile_pool);
     static void push_entity(lua_State* l, Entity& entity);
-    static void push_entity_iterator(lua_State* l, const EntityVector& entities);
+    static void push_entity_iterator(lua_State* l, EntityVector entities);
     static void push_named_sprite_iterator(
         lua_State* l,
         const std::vector<Entity::NamedSprite>& sprites
@@ -1172,10 +1428,14 @@ class LuaContext {
     static DrawablePtr check_drawable(lua_State* l, int index);
     static bool is_surface(lua_State* l, int index);
     static SurfacePtr check_surface(lua_State* l, int index);
+    static bool is_pixel_buffer(lua_State* l, int index);
+    static std::shared_ptr<PixelBuffer> check_pixel_buffer(lua_State* l, int index);
     static bool is_text_surface(lua_State* l, int index);
     static std::shared_ptr<TextSurface> check_text_surface(lua_State* l, int index);
     static bool is_sprite(lua_State* l, int index);
     static SpritePtr check_sprite(lua_State* l, int index);
+    static bool is_particle_emitter(lua_State* l, int index);
+    static std::shared_ptr<ParticleEmitter> check_particle_emitter(lua_State* l, int index);
     static bool is_shader(lua_State* l, int index);
     static ShaderPtr check_shader(lua_State* l, int index);
     static bool is_item(lua_State* l, int index);
@@ -1204,8 +1464,11 @@ class LuaContext {
     static std::shared_ptr<Savegame> check_game(lua_State* l, int index);
     static bool is_map(lua_State* l, int index);
     static std::shared_ptr<Map> check_map(lua_State* l, int index);
+    static bool is_projectile_pool(lua_State* l, int index);
+    static std::shared_ptr<ProjectilePool> check_projectile_pool(lua_State* l, int index);
     static bool is_entity(lua_State* l, int index);
     static EntityPtr check_entity(lua_State* l, int index);
+    static const Entity& check_entity_in_array(lua_State* l, int array_index, int i);
     static bool is_hero(lua_State* l, int index);
     static HeroPtr check_hero(lua_State* l, int index);
     static bool is_camera(lua_State* l, int index);
@@ -1340,9 +1603,13 @@ class LuaContext {
     // Functions exported to Lua for internal needs.
     static FunctionExportedToLua
       l_panic,
+      l_print,
       l_loader,
+      l_resume_coroutine,
       l_get_map_entity_or_global,
       l_entity_iterator_next,
+      l_entity_by_type_iterator_next,
+      l_entity_list_gc,
       l_named_sprite_iterator_next,
       l_treasure_brandish_finished,
       l_shop_treasure_description_dialog_finished,
@@ -1374,37 +1641,78 @@ class LuaContext {
       l_create_fire;
 
     // Script data.
+    LuaAllocator allocator;            /**< Memory of the Lua state. */
     lua_State* l;                      /**< The Lua state encapsulated. */
+    bool gc_driven;                    /**< Whether garbage is collected by
+                                        * step_garbage_collector() rather than
+                                        * automatically while scripts run. */
+    bool gc_cycle_running;             /**< Whether a driven collection cycle
+                                        * is in progress. */
+    int gc_pause;                      /**< Memory growth in percent before
+                                        * starting a new driven cycle. */
+    int gc_threshold;                  /**< Memory in KiB above which a new
+                                        * driven cycle starts. */
     MainLoop& main_loop;               /**< The Solarus main loop. */
 
-    std::list<LuaMenuData> menus;      /**< The menus currently running in their context.
+    std::map<const void*, std::list<LuaMenuData>>
+        menus;                         /**< The menus currently running, by context.
                                         * Invalid ones are to be removed at the next cycle. */
+    DrawList* draw_recording;          /**< Where draws of a retained menu are being
+                                        * recorded, or nullptr. */
+    const Surface* draw_recording_surface;
+                                       /**< Destination surface of the recording. */
     std::map<TimerPtr, LuaTimerData>
         timers;                        /**< The timers currently running, with
                                         * their context and callback. */
     std::list<TimerPtr>
         timers_to_remove;              /**< Timers to be removed at the next cycle. */
-
-    std::set<DrawablePtr>
+    std::map<const void*, std::set<TimerPtr>>
+        timers_by_context;             /**< The timers of each context. */
+    std::vector<ScheduledTimer>
+        timers_schedule;               /**< Min-heap of the next update date of
+                                        * running timers. Suspended timers are
+                                        * added back when they are resumed. */
+
+    std::vector<PendingSave>
+        pending_saves;                 /**< Savegames written in the background
+                                        * whose callback is not called yet. */
+    std::vector<PendingImage>
+        pending_images;                /**< Surfaces decoded in the background
+                                        * whose callback is not called yet. */
+    std::vector<PendingFileOperation>
+        pending_file_operations;       /**< Files read or written in the background
+                                        * whose callback is not called yet. */
+    std::shared_future<bool>
+        last_file_write;               /**< Last write started by sol.file functions.
+                                        * Later operations wait for it. */
+    std::vector<PendingWorker>
+        pending_workers;               /**< Worker scripts running in the background
+                                        * whose callback is not called yet. */
+
+    std::map<std::string, ScopedLuaRef>
+        model_scripts;                 /**< Loaded scripts of enemy breeds and
+                                        * custom entity models of the current
+                                        * map, run again for each instance. */
+
+    std::vector<DrawablePtr>
         drawables;                     /**< All drawable objects created by
-                                        * this script. */
-    std::set<DrawablePtr>
+                                        * this script, in no particular order. */
+    std::unordered_map<const Drawable*, size_t>
+        drawable_indexes;              /**< Index of each drawable object
+                                        * in drawables. */
+    std::vector<DrawablePtr>
         drawables_to_remove;           /**< Drawable objects to be removed at the
                                         * next cycle. */
-    std::map<const ExportableToLua*, std::set<std::string>>
-        userdata_fields;               /**< Existing string keys created on each
-                                        * userdata with our __newindex. This is
-                                        * only for performance, to avoid Lua
-                                        * lookups for callbacks like on_update. */
+    std::map<const std::string*, uint32_t>
+        metatable_event_masks;         /**< CachedEvent values defined in the
+                                        * metatable of each userdata type,
+                                        * computed at most once per cycle. */
     std::set<std::string>
         warning_deprecated_functions;  /**< Names of deprecated functions of
                                         * the API for which a warning was emitted. */
 
     static const std::map<EntityType, lua_CFunction>
         entity_creation_functions;     /**< Creation function of each entity type. */
-    static std::map<lua_State*, LuaContext*>
-        lua_contexts;                  /**< Mapping to get the encapsulating object
-                                        * from the lua_State pointer. */
 
 };
 
@@ -18,6 +18,8 @@
 #define SOLARUS_LUA_DATA_FILE_H
 
 #include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 
@@ -25,8 +27,16 @@ struct lua_State;
 
 namespace Solarus {
 
+class BinaryReader;
+class BinaryWriter;
+
 /**
  * \brief Abstract class for data the can be loaded and optionally saved as Lua.
+ *
+ * Subclasses may also provide a binary format, produced offline by
+ * solarus-quest-compiler and much faster to load than Lua.
+ * import_from_quest_file() then uses the binary file "xx.bin" next to the
+ * data file "xx.dat" when it is up to date with it.
  */
 class SOLARUS_API LuaData {
 
@@ -48,6 +58,22 @@ class SOLARUS_API LuaData {
     bool export_to_buffer(std::string& buffer) const;
     bool export_to_file(const std::string& file_name) const;
 
+    // Optional binary format.
+    virtual std::string get_binary_magic() const;
+    virtual uint32_t get_binary_format_version() const;
+    virtual bool import_from_binary(BinaryReader& reader);
+    virtual bool export_to_binary(BinaryWriter& writer) const;
+
+    bool has_binary_format() const;
+    bool import_from_binary_buffer(const char* data, size_t size, const std::string& file_name);
+    bool import_from_binary_buffer(const std::string& buffer, const std::string& file_name);
+    bool export_to_binary_buffer(std::string& buffer, uint64_t source_hash) const;
+    bool get_binary_source_hash(const char* data, size_t size, uint64_t& source_hash) const;
+    bool get_binary_source_hash(const std::string& buffer, uint64_t& source_hash) const;
+
+    static uint64_t compute_source_hash(const std::string& source_buffer);
+    static std::string get_binary_file_name(const std::string& file_name);
+
     static std::string escape_string(std::string value);
     static std::string escape_multiline_string(std::string value);
     static std::string unescape_multiline_string(std::string value);
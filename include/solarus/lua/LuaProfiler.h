@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LUA_PROFILER_H
+#define SOLARUS_LUA_PROFILER_H
+
+#include "solarus/core/Common.h"
+#include <lua.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Measures the time and memory spent in Lua callbacks.
+ *
+ * Every function called through LuaTools::call_function() while the
+ * profiler is enabled is measured, and attributed to its call stack.
+ * A frame of the stack identifies the script file and line of the function,
+ * the event name (like on_update or timer callback) and, for methods,
+ * the object they are called on.
+ *
+ * The time and memory of callbacks called from other callbacks are only
+ * counted in the stack of the inner one.
+ * Memory is the growth of the Lua heap during the call, so it is zero
+ * for calls during which the garbage collector freed more than allocated.
+ *
+ * Results can be saved in the folded stack format of flame graph tools.
+ */
+class SOLARUS_API LuaProfiler {
+
+  public:
+
+    /**
+     * \brief Measures of one call stack.
+     */
+    struct Entry {
+      std::string stack;          /**< Frames from the outermost one, separated by ';'. */
+      double time = 0.0;          /**< Time spent in the innermost frame itself (milliseconds). */
+      uint64_t num_calls = 0;     /**< Number of calls of the innermost frame. */
+      uint64_t memory = 0;        /**< Bytes allocated by the innermost frame itself. */
+    };
+
+    /**
+     * \brief Measures a Lua call if a profiler is enabled.
+     */
+    class Scope {
+
+      public:
+
+        Scope(lua_State* l, int function_index, int nb_arguments, const char* function_name);
+        ~Scope();
+
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+
+      private:
+
+        LuaProfiler* profiler;    /**< The profiler measuring the call or nullptr. */
+        lua_State* l;             /**< The Lua state where the call happens. */
+
+    };
+
+    LuaProfiler();
+    ~LuaProfiler();
+
+    LuaProfiler(const LuaProfiler& other) = delete;
+    LuaProfiler& operator=(const LuaProfiler& other) = delete;
+
+    bool is_enabled() const;
+    void set_enabled(bool enabled);
+    void clear();
+
+    std::vector<Entry> get_entries() const;
+    bool save_folded(const std::string& file_name) const;
+
+  private:
+
+    /**
+     * \brief A call being measured.
+     */
+    struct Frame {
+      std::string stack;          /**< Key of this call in the results. */
+      double start_time;          /**< Value of FrameTimings::get_time() at the start. */
+      double children_time;       /**< Time spent in callbacks called from this one. */
+      int64_t start_memory;       /**< Size of the Lua heap at the start. */
+      uint64_t children_memory;   /**< Memory allocated by callbacks called from this one. */
+    };
+
+    void enter(lua_State* l, int function_index, int nb_arguments, const char* function_name);
+    void leave(lua_State* l);
+
+    static std::string get_frame_name(
+        lua_State* l, int function_index, int nb_arguments, const char* function_name);
+    static int64_t get_memory_used(lua_State* l);
+
+    static LuaProfiler* enabled_profiler;  /**< The profiler currently enabled if any. */
+
+    std::vector<Frame> call_stack;         /**< Calls currently running. */
+    std::map<std::string, Entry> entries;  /**< Results indexed by call stack. */
+
+};
+
+}
+
+#endif
+
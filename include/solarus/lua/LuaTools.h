@@ -45,6 +45,8 @@ namespace LuaTools {
 // Helpers.
 int get_positive_index(lua_State* l, int index);
 bool is_valid_lua_identifier(const std::string& name);
+void set_main_thread(lua_State* l);
+lua_State* get_main_thread(lua_State* l);
 ScopedLuaRef create_ref(lua_State* l);
 ScopedLuaRef create_ref(lua_State* l, int index);
 bool call_function(
@@ -58,6 +60,16 @@ bool do_string(
     const std::string& code,
     const std::string& chunk_name
 );
+void push_result_array(
+    lua_State* l,
+    int index,
+    int size
+);
+void set_array_size(
+    lua_State* l,
+    int table_index,
+    int size
+);
 
 // Error handling.
 template<typename Callable>
@@ -30,7 +30,14 @@ E check_enum(
     lua_State* l,
     int index
 ) {
-  return check_enum(l, index, EnumInfoTraits<E>::names);
+  const std::string& name = LuaTools::check_string(l, index);
+  bool success = false;
+  E value = name_to_enum<E>(name, E(), success);
+  if (!success) {
+    // Raise the error with the allowed names.
+    value = check_enum(l, index, EnumInfoTraits<E>::names);
+  }
+  return value;
 }
 
 /**
@@ -47,7 +54,17 @@ E check_enum_field(
     int table_index,
     const std::string& key
 ) {
-  return check_enum_field(l, table_index, key, EnumInfoTraits<E>::names);
+  lua_getfield(l, table_index, key.c_str());
+  if (!lua_isstring(l, -1)) {
+    arg_error(l, table_index,
+        std::string("Bad field '") + key + "' (string expected, got "
+        + luaL_typename(l, -1)
+    );
+  }
+
+  E value = check_enum<E>(l, -1);
+  lua_pop(l, 1);
+  return value;
 }
 
 /**
@@ -63,7 +80,11 @@ E opt_enum(
     int index,
     E default_value
 ) {
-  return opt_enum(l, index, EnumInfoTraits<E>::names, default_value);
+  if (lua_isnoneornil(l, index)) {
+    return default_value;
+  }
+
+  return check_enum<E>(l, index);
 }
 
 /**
@@ -81,7 +102,21 @@ E opt_enum_field(
     const std::string& key,
     E default_value
 ) {
-  return opt_enum_field(l, table_index, key, EnumInfoTraits<E>::names, default_value);
+  lua_getfield(l, table_index, key.c_str());
+  if (lua_isnil(l, -1)) {
+    lua_pop(l, 1);
+    return default_value;
+  }
+
+  if (!lua_isstring(l, -1)) {
+    arg_error(l, table_index,
+        std::string("Bad field '") + key + "' (string expected, got "
+        + luaL_typename(l, -1) + ")"
+    );
+  }
+  E value = check_enum<E>(l, -1);
+  lua_pop(l, 1);
+  return value;
 }
 
 /**
@@ -25,41 +25,51 @@ struct lua_State;
 namespace Solarus {
 
 /**
- * \brief Holds a Lua ref and does luaL_unref() on destruction.
+ * \brief Holds a Lua ref and releases it on destruction.
  *
  * This class is meant to make the usage of Lua refs safer, by making sure
- * that for each luaL_ref() call, there is exactly one luaL_unref() call.
- * This avoids memory leaks and duplicate luaL_unref() calls.
+ * that for each ref created, there is exactly one release.
+ * This avoids memory leaks and duplicate releases.
  *
- * It is recommended to use this class rather than calling luaL_unref()
- * directly.
+ * Refs are not stored in the registry but in a pool: an engine-owned table
+ * with its own free list, so that creating and releasing many short-lived
+ * callbacks does not grow the registry.
+ * A ref can only be moved, never copied, so that each Lua value
+ * referenced by the engine costs exactly one slot of the pool.
+ *
+ * Refs created from a coroutine belong to the main thread and can be
+ * pushed onto any thread of the same Lua state.
  */
 class ScopedLuaRef {
 
   public:
 
     ScopedLuaRef();
-    ScopedLuaRef(lua_State* l, int ref);
-    ScopedLuaRef(const ScopedLuaRef& other);
+    ScopedLuaRef(const ScopedLuaRef& other) = delete;
     ScopedLuaRef(ScopedLuaRef&& other);
     ~ScopedLuaRef();
 
-    ScopedLuaRef& operator=(const ScopedLuaRef& other);
+    ScopedLuaRef& operator=(const ScopedLuaRef& other) = delete;
     ScopedLuaRef& operator=(ScopedLuaRef&& other);
 
+    static ScopedLuaRef create(lua_State* l);
+
     lua_State* get_lua_state() const;
     bool is_empty() const;
     int get() const;
     void clear();
 
     void push() const;
+    void push(lua_State* dst_l) const;
     void call(const std::string& function_name) const;
     void clear_and_call(const std::string& function_name);
 
   private:
 
+    ScopedLuaRef(lua_State* l, int ref);
+
     lua_State* l;  /**< The Lua state. nullptr means no ref. */
-    int ref;       /**< Lua ref to a value. */
+    int ref;       /**< Index of the value in the pool. */
 
 };
 
@@ -27,6 +27,7 @@
 namespace Solarus {
 
 class Drawable;
+class Entities;
 class Entity;
 
 /**
@@ -54,6 +55,8 @@ class SOLARUS_API Movement: public ExportableToLua {
 
     // update
     virtual void update(); // called repeatedly
+    virtual uint32_t get_next_update_date() const;
+    bool is_update_needed(uint32_t now) const;
     bool is_suspended() const;
     virtual void set_suspended(bool suspended);
 
@@ -94,9 +97,12 @@ class SOLARUS_API Movement: public ExportableToLua {
 
     // Lua
     const ScopedLuaRef& get_finished_callback() const;
-    void set_finished_callback(const ScopedLuaRef& finished_callback_ref);
+    void set_finished_callback(ScopedLuaRef finished_callback_ref);
     bool are_lua_notifications_enabled() const;
     void set_lua_notifications_enabled(bool lua_notifications_enabled);
+    bool are_position_notifications_batched() const;
+    void set_position_notifications_batched(bool position_notifications_batched);
+    bool is_position_notification_pending() const;
     virtual const std::string& get_lua_type_name() const override;
 
   protected:
@@ -110,16 +116,40 @@ class SOLARUS_API Movement: public ExportableToLua {
     // obstacles (only when the movement is applied to an entity)
     void set_default_ignore_obstacles(bool ignore_obstacles);
 
+    // Lua
+    void notify_batched_position_changed();
+
   private:
 
+    /**
+     * \brief A rectangle ahead of the entity checked for obstacles at once.
+     */
+    struct SweptRegion {
+      Rectangle box;                  /**< The rectangle checked. */
+      bool free = false;              /**< Whether no obstacle can be in it. */
+      const Entities* entities = nullptr;  /**< The entities of the map where it was checked. */
+      int layer = 0;                  /**< Layer where it was checked. */
+      uint64_t generation = 0;        /**< Obstacle generation of the map when it was checked. */
+      uint64_t num_moves = 0;         /**< Value of num_moves when it was checked. */
+    };
+
+    bool is_in_free_region(const Rectangle& collision_box) const;
+    void update_swept_region(const Rectangle& collision_box, int dx, int dy) const;
+
+    static constexpr int swept_region_length = 16;  /**< Pixels checked ahead of the entity. */
+
     // Object to move (can be an entity, a drawable or a point).
     Entity* entity;                              /**< The entity controlled by this movement. */
     Drawable* drawable;                          /**< The drawable controlled by this movement. */
     Point xy;                                    /**< Coordinates of the point controlled by this movement. */
 
     uint32_t last_move_date;                     /**< Date of the last x or y move. */
+    uint64_t num_moves;                          /**< Number of x or y moves made so far. */
     bool finished;                               /**< true if is_finished() returns true. */
     bool lua_notifications_enabled;              /**< Whether Lua events and callbacks should be called for this movement. */
+    bool position_notifications_batched;         /**< Whether Lua position events are sent once per update
+                                                  * instead of at each move. */
+    bool position_notification_pending;          /**< Whether a batched position event waits for the next update. */
 
     // suspended
     bool suspended;                              /**< Indicates whether the movement is suspended. */
@@ -132,6 +162,7 @@ class SOLARUS_API Movement: public ExportableToLua {
 
     bool default_ignore_obstacles;               /**< Indicates that this movement normally ignores obstacles. */
     bool current_ignore_obstacles;               /**< Indicates that this movement currently ignores obstacles. */
+    mutable SweptRegion swept_region;            /**< Last region checked at once ahead of the entity. */
 
     ScopedLuaRef finished_callback_ref;          /**< Lua ref to a function to call when this movement finishes. */
 
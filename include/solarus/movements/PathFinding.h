@@ -19,9 +19,9 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
-#include <list>
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,11 +35,23 @@ class Rectangle;
  * In the current implementation, the computed path always corresponds to a
  * shape of 16*16. If the entity to move is bigger, some obstacles may prevent
  * it from following the computed path.
+ *
+ * Nodes are 8*8 squares within a fixed distance of the target,
+ * so they are stored in a flat array indexed by their square
+ * relative to the target and the open list is a binary heap.
+ * These arrays live in a workspace owned by the map and are reused
+ * from one search to the next: computing a path allocates no memory.
+ *
+ * A flow field is the result of a reverse search from the target:
+ * for each square of the window, the direction that leads to the target.
+ * Paths of all entities that share the same obstacles can be read from it.
  */
 class SOLARUS_API PathFinding {
 
   public:
 
+    class Workspace;
+
     PathFinding(
         Map& map,
         Entity& source_entity,
@@ -47,37 +59,31 @@ class SOLARUS_API PathFinding {
 
     std::string compute_path();
     std::string compute_path(const Point& offset);
+    void compute_flow_field(const Point& target, std::vector<char>& directions);
 
-  private:
-
-    /**
-     * \brief Represents a node in the path to compute.
-     *
-     * A node is the location of a 16*16 square of the map.
-     * The algorithm tries to find the best sequence of nodes leading to the target.
-     */
-    class Node {
-
-     public:
-
-      Point location;     /**< location of this node on the map */
-      int index;          /**< index of this node's square on the map (depends on the location) */
+    static Point get_target_square(const Point& target_xy);
+    static std::string get_path_from_flow_field(
+        const std::vector<char>& directions,
+        const Point& source,
+        const Point& target
+    );
 
-      // total_cost = previous_cost + heuristic
-      int previous_cost;  /**< cost of the best path that leads to this node */
-      int heuristic;      /**< estimation of the remaining cost to the target */
-      int total_cost;     /**< total cost of this node */
+    static constexpr int max_distance = 200;      /**< Manhattan distance to the target beyond which
+                                                   * no node is explored. */
+    static constexpr int window_radius = max_distance / 8;  /**< Half size of the node window in squares. */
+    static constexpr int window_side = 2 * window_radius + 1;  /**< Size of the node window in squares. */
 
-      int parent_index;   /**< index of the square containing the best node leading to this node */
-      char direction;     /**< direction from the parent node to this node (0 to 7) */
-
-      bool operator<(const Node& other) const;
-    };
+  private:
 
-    int get_square_index(const Point& location) const;
-    bool is_node_transition_valid(const Node& node, int direction) const;
-    void add_index_sorted(Node* node);
-    std::string rebuild_path(const Node* final_node);
+    int pop_open_node();
+    void push_open_node(int cell);
+    void sift_up(int heap_position);
+    void sift_down(int heap_position);
+    bool is_before(int cell1, int cell2) const;
+    int get_cell(const Point& location, const Point& target) const;
+    Point get_location(int cell, const Point& target) const;
+    bool is_node_transition_valid(const Point& location, int direction) const;
+    std::string rebuild_path(int final_cell);
 
     static const Point neighbours_locations[];
     static const Rectangle transition_collision_boxes[];
@@ -85,14 +91,50 @@ class SOLARUS_API PathFinding {
     Map& map;                          /**< the map */
     Entity& source_entity;             /**< the entity to move */
     Entity& target_entity;             /**< the target point */
+    Workspace& workspace;              /**< the node arrays, shared by searches on the map */
 
-    std::map<int, Node> closed_list;   /**< the closed list, indexed by the node locations on the map */
-    std::map<int, Node> open_list;     /**< the open list, indexed by the node locations on the map */
-    std::list<int> open_list_indices;  /**< indices of the open list elements, sorted by priority */
+};
+
+/**
+ * \brief Memory reused by successive path searches on a map.
+ */
+class SOLARUS_API PathFinding::Workspace {
+
+  public:
+
+    Workspace();
+
+  private:
+
+    friend class PathFinding;
+
+    /**
+     * \brief State of a node (an 8*8 square) during a search.
+     *
+     * Fields other than search_id are only meaningful when search_id
+     * is the id of the current search.
+     */
+    struct Node {
+      uint32_t search_id;   /**< id of the last search that reached this node */
+      bool closed;          /**< whether this node is in the closed list */
+      char direction;       /**< direction from the parent node to this node ('0' to '7'), or ' ' */
+      int parent_cell;      /**< cell of the best node leading to this node, or -1 */
+      int previous_cost;    /**< cost of the best path that leads to this node */
+      int total_cost;       /**< previous cost plus estimated remaining cost */
+      uint32_t order;       /**< when this node was added to the open list, to break ties */
+      int heap_position;    /**< position in the open list heap, or -1 */
+    };
+
+    uint32_t start_search();
+
+    std::vector<Node> nodes;           /**< all nodes of the window, indexed by cell */
+    std::vector<int> open_heap;        /**< cells of the open list, as a binary heap */
+    std::string path;                  /**< buffer to rebuild paths */
+    uint32_t search_id;                /**< id of the current search */
+    uint32_t next_order;               /**< order of the next node added to the open list */
 
 };
 
 }
 
 #endif
-
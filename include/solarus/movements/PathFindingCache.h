@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PATH_FINDING_CACHE_H
+#define SOLARUS_PATH_FINDING_CACHE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Map;
+
+/**
+ * \brief Shares path finding results between entities of a map.
+ *
+ * When several entities look for a path to the same target,
+ * a single reverse search from the target (a flow field) is done
+ * and each entity reads its own path from it.
+ * Requests made during the same cycle are therefore computed only once.
+ *
+ * Only enemies share flow fields, and only when they have the same
+ * obstacles: the same breed, size and obstacle behavior.
+ * Other entities, like custom entities with their own traversable rules,
+ * each get their own flow field.
+ *
+ * A flow field is dropped when an entity other than its target is added,
+ * removed or moves near it, unless this entity cannot be an obstacle
+ * for the users of the field,
+ * and in any case after a short delay, since obstacles may also change
+ * without moving (doors, dynamic tiles, Lua traversable rules...).
+ */
+class SOLARUS_API PathFindingCache {
+
+  public:
+
+    explicit PathFindingCache(Map& map);
+
+    std::string compute_path(Entity& source_entity, Entity& target_entity);
+
+    void notify_entity_changed(const Entity& entity);
+    void notify_entity_removed(const Entity& entity);
+    void clear();
+
+  private:
+
+    /**
+     * \brief Directions to a target for entities with the same obstacles.
+     */
+    struct FlowField {
+      const Entity* target_entity;     /**< The target (only used to compare). */
+      Point target;                    /**< Target square, including the offset. */
+      int layer;                       /**< Layer where the search was done. */
+      const Entity* source_entity;     /**< The only user of this field, or nullptr
+                                        * if it is shared by enemies (only used to compare). */
+      std::string source_breed;        /**< Breed of the enemies using this field. */
+      Size source_size;                /**< Size of the entities using this field. */
+      int obstacle_behavior;           /**< Enemy::ObstacleBehavior of the enemies using this field. */
+      Rectangle region;                /**< Area where obstacles affect this field. */
+      uint32_t date;                   /**< When this field was computed. */
+      std::vector<char> directions;    /**< Result of PathFinding::compute_flow_field(). */
+    };
+
+    std::string compute_path(
+        Entity& source_entity, Entity& target_entity, const Point& offset);
+    FlowField& get_flow_field(
+        Entity& source_entity, Entity& target_entity, const Point& target);
+
+    static bool is_shared(const FlowField& flow_field, const Entity& source_entity);
+    static bool is_obstacle_for_users(const Entity& entity, const FlowField& flow_field);
+
+    static constexpr int max_flow_fields = 16;    /**< Flow fields kept at most. */
+    static constexpr uint32_t max_age = 300;      /**< Lifetime of a flow field in milliseconds. */
+
+    Map& map;                          /**< The map. */
+    std::vector<FlowField> flow_fields;  /**< The flow fields currently valid. */
+
+};
+
+}
+
+#endif
+
@@ -21,6 +21,7 @@
 #include "solarus/movements/PixelMovement.h"
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -50,6 +51,7 @@ class SOLARUS_API PathMovement: public PixelMovement {
 
     virtual void notify_object_controlled() override;
     virtual void update() override;
+    virtual uint32_t get_next_update_date() const override;
     virtual void set_suspended(bool suspended) override;
     virtual bool is_finished() const override;
 
@@ -78,6 +80,14 @@ class SOLARUS_API PathMovement: public PixelMovement {
 
   private:
 
+    /**
+     * \brief Consecutive moves of the path in the same direction.
+     */
+    struct PathSegment {
+      int direction;                   /**< direction of the moves (0 to 7) */
+      int length;                      /**< number of 8-pixel moves */
+    };
+
     static uint32_t speed_to_delay(int speed, int direction);
 
     void start_next_elementary_move();
@@ -89,7 +99,9 @@ class SOLARUS_API PathMovement: public PixelMovement {
 
     std::string initial_path;          /**< the path: each character is a direction ('0' to '7')
                                         * and corresponds to a trajectory of 8 pixels (performed by PixelMovement) */
-    std::string remaining_path;        /**< the remaining part of the path */
+    std::vector<PathSegment> segments; /**< the path compiled once into runs of moves in the same direction */
+    size_t segment_index;              /**< segment of the next move (segments.size() if the path is finished) */
+    int segment_moves_done;            /**< number of moves of the current segment already started */
     int current_direction;             /**< current element in the path (0 to 7) */
     int total_distance_covered;        /**< total number of pixels covered (each element of the path counts for 8) */
     bool stopped_by_obstacle;          /**< true if the movement was stopped by an obstacle */
@@ -102,9 +114,6 @@ class SOLARUS_API PathMovement: public PixelMovement {
     bool snapping;                     /**< indicates that the entity is currently being aligned to the grid */
     uint32_t stop_snapping_date;       /**< date when we stop trying to snap the entity if it is unsuccessful */
 
-    static const std::string
-        elementary_moves[];            /**< 8 pixel trajectory (in the PixelMovement sense) for each direction (0 to 7) */
-
 };
 
 }
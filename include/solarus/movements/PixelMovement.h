@@ -40,6 +40,7 @@ class SOLARUS_API PixelMovement: public Movement {
     const std::list<Point>& get_trajectory() const;
     void set_trajectory(const std::list<Point>& trajectory);
     void set_trajectory(const std::string &trajectory_string);
+    void set_trajectory(const Point& step, int num_steps);
     uint32_t get_delay() const;
     void set_delay(uint32_t delay);
     bool get_loop() const;
@@ -51,6 +52,7 @@ class SOLARUS_API PixelMovement: public Movement {
     int get_length() const;
 
     virtual void update() override;
+    virtual uint32_t get_next_update_date() const override;
     virtual void set_suspended(bool suspended) override;
 
     virtual const std::string& get_lua_type_name() const override;
@@ -37,6 +37,7 @@ class PlayerMovement: public StraightMovement {
     explicit PlayerMovement(int speed);
 
     virtual void update() override;
+    virtual uint32_t get_next_update_date() const override;
 
     int get_moving_speed() const;
     void set_moving_speed(int moving_speed);
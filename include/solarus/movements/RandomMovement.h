@@ -38,6 +38,7 @@ class RandomMovement: public StraightMovement {
 
     virtual void notify_object_controlled() override;
     virtual void update() override;
+    virtual uint32_t get_next_update_date() const override;
     virtual void set_suspended(bool suspended) override;
 
     double get_normal_speed() const;
@@ -37,6 +37,7 @@ class StraightMovement: public Movement {
 
     virtual void notify_object_controlled() override;
     virtual void update() override;
+    virtual uint32_t get_next_update_date() const override;
     virtual void set_suspended(bool suspended) override;
     bool has_to_move_now() const;
 
@@ -60,14 +60,17 @@ class TargetMovement: public StraightMovement {
 
     void notify_object_controlled() override;
     void notify_position_changed() override;
+    void notify_obstacle_reached() override;
     bool is_finished() const override;
     void update() override;
+    uint32_t get_next_update_date() const override;
 
     virtual const std::string& get_lua_type_name() const override;
 
   private:
 
     void recompute_movement();
+    bool needs_recomputation() const;
     void check_target_reached();
 
     Point target;                      /**< Coordinates of the point or entity to track. */
@@ -79,7 +82,9 @@ class TargetMovement: public StraightMovement {
     int sign_y;                        /**< Sign of the y movement (1: down, -1: up) */
     int moving_speed;                  /**< Speed when moving */
 
-    uint32_t next_recomputation_date;  /**< Date when the movement is recalculated. */
+    uint32_t next_recomputation_date;  /**< Date when the movement may be recalculated next. */
+    bool obstacle_reached;             /**< Whether an obstacle deviated the movement
+                                        * since the last computation. */
     bool finished;                     /**< \c true if the target is reached. */
     bool recomputing_movement;         /**< Whether we are in \c recompute_movement(). */
 
@@ -18,18 +18,25 @@
 #include "solarus/audio/Music.h"
 #include "solarus/audio/OggDecoder.h"
 #include "solarus/audio/SpcDecoder.h"
+#include "solarus/core/Arguments.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
+#include "solarus/core/Trace.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
 #include <algorithm>
+#include <chrono>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
-constexpr int Music::nb_buffers;
+constexpr int Music::chunk_size;
+int Music::num_buffers = 16;
+int Music::lookahead = 0;
+std::atomic<int> Music::num_underruns(0);
 std::unique_ptr<SpcDecoder> Music::spc_decoder = nullptr;
 std::unique_ptr<ItDecoder> Music::it_decoder = nullptr;
 std::unique_ptr<OggDecoder> Music::ogg_decoder = nullptr;
@@ -57,11 +64,19 @@ Music::Music():
   format(NO_FORMAT),
   loop(false),
   callback_ref(),
-  source(AL_NONE) {
+  buffers(num_buffers, AL_NONE),
+  free_buffers(),
+  source(AL_NONE),
+  decoded_chunks(get_num_chunks_ahead()),
+  decoding_thread(),
+  decoding_mutex(),
+  decoding_condition(),
+  decoding_stopping(false),
+  decoding_finished(false),
+  decoding_time(0),
+  decoded_time(0),
+  playing_started(false) {
 
-  for (int i = 0; i < nb_buffers; i++) {
-    buffers[i] = AL_NONE;
-  }
 }
 
 /**
@@ -75,26 +90,64 @@ Music::Music():
 Music::Music(
     const std::string& music_id,
     bool loop,
-    const ScopedLuaRef& callback_ref):
+    ScopedLuaRef callback_ref):
   id(music_id),
   format(OGG),
   loop(loop),
-  callback_ref(callback_ref),
-  source(AL_NONE) {
-
-  Debug::check_assertion(!loop || callback_ref.is_empty(),
+  callback_ref(std::move(callback_ref)),
+  buffers(num_buffers, AL_NONE),
+  free_buffers(),
+  source(AL_NONE),
+  decoded_chunks(get_num_chunks_ahead()),
+  decoding_thread(),
+  decoding_mutex(),
+  decoding_condition(),
+  decoding_stopping(false),
+  decoding_finished(false),
+  decoding_time(0),
+  decoded_time(0),
+  playing_started(false) {
+
+  Debug::check_assertion(!loop || this->callback_ref.is_empty(),
       "Attempt to set both a loop and a callback to music"
   );
+}
 
-  for (int i = 0; i < nb_buffers; i++) {
-    buffers[i] = AL_NONE;
-  }
+/**
+ * \brief Destroys a music.
+ *
+ * The decoding thread is stopped if it is still running.
+ */
+Music::~Music() {
+
+  stop_decoding_thread();
 }
 
 /**
  * \brief Initializes the music system.
+ * \param args Command-line arguments.
  */
-void Music::initialize() {
+void Music::initialize(const Arguments& args) {
+
+  // Check the -music-buffers option.
+  const std::string& num_buffers_arg = args.get_argument_value("-music-buffers");
+  if (!num_buffers_arg.empty()) {
+    std::istringstream iss(num_buffers_arg);
+    int num_buffers = 0;
+    if (iss >> num_buffers && num_buffers >= 2) {
+      Music::num_buffers = num_buffers;
+    }
+  }
+
+  // Check the -music-lookahead option.
+  const std::string& lookahead_arg = args.get_argument_value("-music-lookahead");
+  if (!lookahead_arg.empty()) {
+    std::istringstream iss(lookahead_arg);
+    int lookahead = 0;
+    if (iss >> lookahead && lookahead >= 0) {
+      Music::lookahead = lookahead;
+    }
+  }
 
   // initialize the decoding features
   spc_decoder = std::unique_ptr<SpcDecoder>(new SpcDecoder());
@@ -175,6 +228,7 @@ int Music::get_num_channels() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(current_music->decoding_mutex);
   return it_decoder->get_num_channels();
 }
 
@@ -191,6 +245,7 @@ int Music::get_channel_volume(int channel) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(current_music->decoding_mutex);
   return it_decoder->get_channel_volume(channel);
 }
 
@@ -207,6 +262,7 @@ void Music::set_channel_volume(int channel, int volume) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(current_music->decoding_mutex);
   it_decoder->set_channel_volume(channel, volume);
 }
 
@@ -222,6 +278,7 @@ int Music::get_tempo() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(current_music->decoding_mutex);
   return it_decoder->get_tempo();
 }
 
@@ -237,6 +294,7 @@ void Music::set_tempo(int tempo) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(current_music->decoding_mutex);
   it_decoder->set_tempo(tempo);
 }
 
@@ -324,7 +382,7 @@ void Music::play(const std::string& music_id, bool loop) {
 void Music::play(
     const std::string& music_id,
     bool loop,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   if (music_id != unchanged && music_id != get_current_music_id()) {
     // The music is changed.
@@ -338,7 +396,7 @@ void Music::play(
     if (music_id != none) {
       // Play another music.
       current_music = std::unique_ptr<Music>(
-          new Music(music_id, loop, callback_ref)
+          new Music(music_id, loop, std::move(callback_ref))
       );
       if (!current_music->start()) {
         // Could not play the music.
@@ -358,6 +416,61 @@ void Music::stop_playing() {
   play(none, false);
 }
 
+/**
+ * \brief Returns how far ahead musics are decoded.
+ * \return The duration decoded in advance in milliseconds,
+ * or 0 if it is a number of chunks set with -music-buffers.
+ */
+int Music::get_lookahead() {
+  return lookahead;
+}
+
+/**
+ * \brief Returns the cost of decoding the current music.
+ * \return The time spent decoding divided by the duration decoded,
+ * or 0.0 if no music is playing.
+ * Values close to 1.0 mean that the decoding hardly keeps up.
+ */
+double Music::get_decoding_load() {
+
+  if (current_music == nullptr) {
+    return 0.0;
+  }
+
+  const int64_t decoded_time = current_music->decoded_time;
+  if (decoded_time == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(current_music->decoding_time) / decoded_time;
+}
+
+/**
+ * \brief Returns how many times a music stopped because the decoding
+ * could not keep up.
+ * \return The number of underruns since the program started.
+ */
+int Music::get_num_underruns() {
+  return num_underruns;
+}
+
+/**
+ * \brief Returns the number of chunks to decode in advance.
+ *
+ * With a lookahead duration, chunks are assumed to be stereo 44.1 kHz,
+ * which is the format with the shortest chunks.
+ *
+ * \return The capacity of the queue of decoded chunks.
+ */
+int Music::get_num_chunks_ahead() {
+
+  if (lookahead == 0) {
+    return num_buffers;
+  }
+
+  const int chunk_duration = chunk_size * 1000 / (2 * 44100);
+  return std::max(1, (lookahead + chunk_duration - 1) / chunk_duration);
+}
+
 /**
  * \brief Updates the music system.
  *
@@ -369,11 +482,13 @@ void Music::update() {
     return;
   }
 
+  SOLARUS_TRACE_SCOPE("Music::update");
+
   if (current_music != nullptr) {
     bool playing = current_music->update_playing();
     if (!playing) {
       // Music is finished.
-      ScopedLuaRef callback_ref = current_music->callback_ref;
+      ScopedLuaRef callback_ref = std::move(current_music->callback_ref);
       current_music->stop();
       current_music = nullptr;
       callback_ref.call("music callback");
@@ -384,7 +499,8 @@ void Music::update() {
 /**
  * \brief Updates this music when it is playing.
  *
- * This function handles the double buffering.
+ * This function gives the chunks decoded by the decoding thread
+ * to the buffers already played.
  *
  * \return \c true if the music keeps playing, \c false if the end is reached.
  */
@@ -393,106 +509,234 @@ bool Music::update_playing() {
   // Get the empty buffers.
   ALint nb_empty;
   alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
-
-  // Refill them.
   for (int i = 0; i < nb_empty; i++) {
     ALuint buffer;
     alSourceUnqueueBuffers(source, 1, &buffer);  // Unqueue the buffer.
+    free_buffers.push_back(buffer);
+  }
 
-    // Fill it by decoding more data.
-    switch (format) {
-
-      case SPC:
-        decode_spc(buffer, 16384);
-        break;
-
-      case IT:
-        decode_it(buffer, 16384);
-        break;
-
-      case OGG:
-        decode_ogg(buffer, 16384);
-        break;
-
-      case NO_FORMAT:
-        Debug::die("Invalid music format");
-        break;
+  // Refill them with the data decoded in the meantime.
+  bool consumed = false;
+  while (!free_buffers.empty()) {
+    const PcmChunk* chunk = decoded_chunks.get_chunk_to_read();
+    if (chunk == nullptr) {
+      break;
     }
-
-    alSourceQueueBuffers(source, 1, &buffer);  // Queue it again.
+    const ALuint buffer = free_buffers.back();
+    if (fill_buffer(buffer, *chunk)) {
+      free_buffers.pop_back();
+      alSourceQueueBuffers(source, 1, &buffer);  // Queue it again.
+    }
+    decoded_chunks.pop();
+    consumed = true;
+  }
+  if (consumed) {
+    // Not waiting for the decoding thread: it also wakes up periodically.
+    decoding_condition.notify_one();
   }
 
   // Check whether there is still something playing.
   ALint status;
   alGetSourcei(source, AL_SOURCE_STATE, &status);
-  if (status != AL_PLAYING) {
-    // The end of the file is reached, or we need to decode more data.
+  if (status == AL_PLAYING || status == AL_PAUSED) {
+    return true;
+  }
+
+  ALint nb_queued;
+  alGetSourcei(source, AL_BUFFERS_QUEUED, &nb_queued);
+  if (nb_queued > 0) {
+    // Not started yet, or the decoding could not keep up.
+    if (playing_started) {
+      ++num_underruns;
+    }
+    playing_started = true;
     alSourcePlay(source);
+    return true;
   }
 
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
-  return status == AL_PLAYING;
+  // Nothing to play: either the end is reached or we wait for more data.
+  return !decoding_finished || !decoded_chunks.is_empty();
+}
+
+/**
+ * \brief Decodes the next chunk of the current music.
+ *
+ * This function is called from the decoding thread.
+ *
+ * \param chunk The chunk to fill.
+ * \return \c false if the end of the music is reached.
+ */
+bool Music::decode_chunk(PcmChunk& chunk) {
+
+  const auto start_time = std::chrono::steady_clock::now();
+
+  chunk.num_bytes = 0;
+  switch (format) {
+
+    case SPC:
+      decode_spc(chunk, chunk_size);
+      break;
+
+    case IT:
+      decode_it(chunk, chunk_size);
+      break;
+
+    case OGG:
+      decode_ogg(chunk, chunk_size);
+      break;
+
+    case NO_FORMAT:
+      Debug::die("Invalid music format");
+      break;
+  }
+
+  decoding_time += std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+  if (chunk.num_bytes > 0 && chunk.num_channels > 0 && chunk.sample_rate > 0) {
+    decoded_time += static_cast<int64_t>(chunk.num_bytes) * 1000000 /
+        (2 * chunk.num_channels * chunk.sample_rate);
+  }
+
+  return chunk.num_bytes > 0;
 }
 
 /**
  * \brief Decodes a chunk of SPC data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
+ * \param chunk The chunk to fill.
  * \param nb_samples number of samples to write
  */
-void Music::decode_spc(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_spc(PcmChunk& chunk, int nb_samples) {
 
   // decode the SPC data
-  std::vector<ALushort> raw_data(nb_samples);
-  spc_decoder->decode((int16_t*) raw_data.data(), nb_samples);
+  chunk.samples.resize(nb_samples);
+  spc_decoder->decode(chunk.samples.data(), nb_samples);
 
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples * 2, 32000);
-
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded SPC data for music file '"
-      << file_name << ": error " << error;
-    Debug::error(oss.str());
-  }
+  chunk.num_bytes = nb_samples * 2;
+  chunk.num_channels = 2;
+  chunk.sample_rate = 32000;
 }
 
 /**
  * \brief Decodes a chunk of IT data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
- * \param nb_samples number of samples to write
+ * \param chunk The chunk to fill.
+ * \param nb_samples number of bytes to write
  */
-void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_it(PcmChunk& chunk, int nb_samples) {
 
   // Decode the IT data.
-  std::vector<ALushort> raw_data(nb_samples);
-  int bytes_read = it_decoder->decode(raw_data.data(), nb_samples);
+  chunk.samples.resize(nb_samples);
+  int bytes_read = it_decoder->decode(chunk.samples.data(), nb_samples);
+
+  chunk.num_bytes = bytes_read;
+  chunk.num_channels = 2;
+  chunk.sample_rate = 44100;
+}
 
-  if (bytes_read == 0) {
-    // End of file.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), 0, 44100);
+/**
+ * \brief Decodes a chunk of OGG data into PCM data for the current music.
+ * \param chunk The chunk to fill.
+ * \param nb_samples Number of samples to write for each channel.
+ */
+void Music::decode_ogg(PcmChunk& chunk, int nb_samples) {
+
+  const int num_channels = ogg_decoder->get_num_channels();
+  chunk.samples.resize(nb_samples * std::max(num_channels, 1));
+  long bytes_read = ogg_decoder->decode(chunk.samples.data(), nb_samples);
+
+  chunk.num_bytes = static_cast<int>(std::max(bytes_read, 0L));
+  chunk.num_channels = num_channels;
+  chunk.sample_rate = ogg_decoder->get_sample_rate();
+}
+
+/**
+ * \brief Copies a decoded chunk into an OpenAL buffer.
+ * \param buffer The buffer to fill.
+ * \param chunk The decoded data.
+ * \return \c true in case of success.
+ */
+bool Music::fill_buffer(ALuint buffer, const PcmChunk& chunk) {
+
+  ALenum al_format = AL_NONE;
+  if (chunk.num_channels == 1) {
+    al_format = AL_FORMAT_MONO16;
+  }
+  else if (chunk.num_channels == 2) {
+    al_format = AL_FORMAT_STEREO16;
   }
   else {
-    // Put this decoded data into the buffer.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples, 44100);
+    Debug::error(std::string("Invalid audio format for music file '")
+        + file_name + "'");
+    return false;
   }
+
+  alBufferData(buffer, al_format, chunk.samples.data(), chunk.num_bytes, chunk.sample_rate);
+
   int error = alGetError();
   if (error != AL_NO_ERROR) {
     std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded IT data for music file '"
-        << file_name << ": error " << error;
+    oss << "Failed to fill the audio buffer with decoded data for music file '"
+        << file_name << "': error " << error;
     Debug::error(oss.str());
+    return false;
   }
+  return true;
 }
 
 /**
- * \brief Decodes a chunk of OGG data into PCM data for the current music.
- * \param destination_buffer The destination buffer to write.
- * \param nb_samples Number of samples to write.
+ * \brief Starts decoding this music ahead in a separate thread.
+ */
+void Music::start_decoding_thread() {
+
+  decoding_stopping = false;
+  decoding_thread = std::thread(&Music::run_decoding_thread, this);
+}
+
+/**
+ * \brief Stops the decoding thread and waits for it to finish.
+ *
+ * Does nothing if the thread is not running.
  */
-void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::stop_decoding_thread() {
 
-  ogg_decoder->decode(destination_buffer, nb_samples);
+  if (!decoding_thread.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(decoding_mutex);
+    decoding_stopping = true;
+  }
+  decoding_condition.notify_one();
+  decoding_thread.join();
+}
+
+/**
+ * \brief Main function of the decoding thread.
+ *
+ * Keeps the queue of decoded chunks full until the end of the music
+ * or until the thread is stopped.
+ */
+void Music::run_decoding_thread() {
+
+  std::unique_lock<std::mutex> lock(decoding_mutex);
+  while (!decoding_stopping) {
+
+    PcmChunk* chunk = decoded_chunks.get_chunk_to_write();
+    if (chunk == nullptr || decoding_finished) {
+      // Nothing to do until the main thread consumes chunks.
+      // The main thread does not lock the mutex before notifying,
+      // so also wake up periodically in case a notification is missed.
+      decoding_condition.wait_for(lock, std::chrono::milliseconds(10));
+      continue;
+    }
+
+    if (decode_chunk(*chunk)) {
+      decoded_chunks.push();
+    }
+    else {
+      decoding_finished = true;
+    }
+  }
 }
 
 /**
@@ -523,49 +767,34 @@ bool Music::start() {
   bool success = true;
 
   // create the buffers and the source
-  alGenBuffers(nb_buffers, buffers);
+  alGenBuffers(num_buffers, buffers.data());
   alGenSources(1, &source);
   alSourcef(source, AL_GAIN, volume);
 
-  // load the music into memory
-  std::string sound_buffer;
+  // load the music
+  std::shared_ptr<const QuestFiles::DataFileBuffer> sound_buffer;
   switch (format) {
 
     case SPC:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
+      sound_buffer = QuestFiles::data_file_map(file_name);
 
       // Give the SPC data into the SPC decoder.
-      spc_decoder->load((int16_t*) sound_buffer.data(), sound_buffer.size());
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_spc(buffers[i], 16384);
-      }
+      spc_decoder->load((int16_t*) sound_buffer->data(), sound_buffer->size());
       break;
 
     case IT:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
+      sound_buffer = QuestFiles::data_file_map(file_name);
 
       // Give the IT data to the IT decoder
-      it_decoder->load(sound_buffer);
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_it(buffers[i], 16384);
-      }
+      it_decoder->load(sound_buffer->data(), sound_buffer->size());
       break;
 
     case OGG:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
-      // Give the OGG data to the OGG decoder.
-      success = ogg_decoder->load(std::move(sound_buffer), this->loop);
-      if (success) {
-        for (int i = 0; i < nb_buffers; i++) {
-          decode_ogg(buffers[i], 16384);
-        }
-      }
+      // Give the OGG stream to the OGG decoder: it is read progressively.
+      success = ogg_decoder->load(QuestFiles::data_file_open_rw(file_name), this->loop);
       break;
 
     case NO_FORMAT:
@@ -575,20 +804,26 @@ bool Music::start() {
 
   if (!success) {
     Debug::error("Cannot load music file '" + file_name + "'");
+    alDeleteSources(1, &source);
+    alDeleteBuffers(num_buffers, buffers.data());
+    return false;
   }
 
-  // start the streaming
-  alSourceQueueBuffers(source, nb_buffers, buffers);
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Cannot initialize buffers for music '"
-        << file_name << "': error " << error;
-    Debug::error(oss.str());
-    success = false;
+  // Decode the beginning right now so that the music starts immediately.
+  free_buffers = buffers;
+  PcmChunk* chunk = decoded_chunks.get_chunk_to_write();
+  if (decode_chunk(*chunk)) {
+    decoded_chunks.push();
   }
+  else {
+    decoding_finished = true;
+  }
+
+  // The rest is decoded ahead by a separate thread.
+  start_decoding_thread();
 
-  alSourcePlay(source);
+  // start the streaming
+  update_playing();
 
   // The update() function will then take care of filling the buffers
 
@@ -606,6 +841,9 @@ void Music::stop() {
     return;
   }
 
+  // The decoders are no longer used after this.
+  stop_decoding_thread();
+
   // Release the callback if any.
   callback_ref.clear();
 
@@ -624,7 +862,7 @@ void Music::stop() {
   alDeleteSources(1, &source);
 
   // delete the buffers
-  alDeleteBuffers(nb_buffers, buffers);
+  alDeleteBuffers(num_buffers, buffers.data());
 
   switch (format) {
 
@@ -686,8 +924,8 @@ void Music::set_paused(bool pause) {
  * \param callback_ref Lua ref to a function to call when the music ends
  * or an empty ref.
  */
-void Music::set_callback(const ScopedLuaRef& callback_ref) {
-  this->callback_ref = callback_ref;
+void Music::set_callback(ScopedLuaRef callback_ref) {
+  this->callback_ref = std::move(callback_ref);
 }
 
 }
@@ -17,9 +17,8 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/audio/OggDecoder.h"
-#include <al.h>
+#include <cstdint>
 #include <sstream>
-#include <vector>
 
 namespace Solarus {
 
@@ -27,8 +26,9 @@ namespace Solarus {
  * \brief Creates an Ogg decoder.
  */
 OggDecoder::OggDecoder():
+  ogg_rw(),
   ogg_file(),
-  ogg_mem(),
+  ogg_stream(),
   ogg_info(nullptr),
   loop_start_pcm(-1),
   loop_end_pcm(-1) {
@@ -36,21 +36,24 @@ OggDecoder::OggDecoder():
 }
 
 /**
- * \brief Loads an OGG file from the memory.
- * \param ogg_data The memory area to read.
+ * \brief Opens an OGG stream.
+ *
+ * The data is then read progressively while decoding.
+ *
+ * \param rw The stream to read. The decoder takes ownership of it.
  * \param loop Whether the music should loop if reaching the end.
  * \return \c true in case of success.
  */
-bool OggDecoder::load(std::string&& ogg_data, bool loop) {
+bool OggDecoder::load(SDL_RWops* rw, bool loop) {
 
+  ogg_file = nullptr;
+  ogg_rw = SDL_RWops_UniquePtr(rw);
   ogg_file = OggFileUniquePtr(new OggVorbis_File());
 
-  ogg_mem.position = 0;
-  ogg_mem.loop = loop;
-  ogg_mem.data = ogg_data;
-  // Now, ogg_mem contains the encoded data.
+  ogg_stream.rw = rw;
+  ogg_stream.loop = loop;
 
-  int error = ov_open_callbacks(&ogg_mem, ogg_file.get(), nullptr, 0, Sound::ogg_callbacks);
+  int error = ov_open_callbacks(&ogg_stream, ogg_file.get(), nullptr, 0, Sound::ogg_callbacks);
 
   if (error != 0) {
     return false;
@@ -103,48 +106,64 @@ bool OggDecoder::load(std::string&& ogg_data, bool loop) {
  */
 void OggDecoder::unload() {
   ogg_file = nullptr;
-  ogg_mem.data.clear();
+  ogg_rw = nullptr;
+  ogg_stream.rw = nullptr;
   ogg_info = nullptr;
   loop_start_pcm = -1;
   loop_end_pcm = -1;
 }
 
 /**
- * \brief Decodes a chunk of the previously loaded OGG data into PCM data
- * and plays it.
- * \param decoded_data Pointer to where you want the decoded data to be written.
- * \param nb_samples Number of samples to write.
+ * \brief Returns the number of channels of the loaded OGG data.
+ * \return 1 for mono, 2 for stereo or 0 if nothing is loaded.
  */
-void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
+int OggDecoder::get_num_channels() const {
 
   if (ogg_info == nullptr) {
-    return;
+    return 0;
   }
+  return ogg_info->channels;
+}
 
-  // Read the encoded music properties.
-  const int num_channels = ogg_info->channels;
-  ALsizei sample_rate = ALsizei(ogg_info->rate);
-  ALenum al_format = AL_NONE;
-  if (num_channels == 1) {
-    al_format = AL_FORMAT_MONO16;
+/**
+ * \brief Returns the sampling rate of the loaded OGG data.
+ * \return The sampling rate in Hz or 0 if nothing is loaded.
+ */
+int OggDecoder::get_sample_rate() const {
+
+  if (ogg_info == nullptr) {
+    return 0;
   }
-  else if (num_channels == 2) {
-    al_format = AL_FORMAT_STEREO16;
+  return static_cast<int>(ogg_info->rate);
+}
+
+/**
+ * \brief Decodes a chunk of the previously loaded OGG data into PCM data.
+ * \param decoded_data Pointer to where you want the decoded data to be written.
+ * It must have room for nb_samples samples of each channel.
+ * \param nb_samples Number of samples to write for each channel.
+ * \return The number of bytes written, 0 if the end is reached
+ * or -1 in case of error.
+ */
+long OggDecoder::decode(int16_t* decoded_data, int nb_samples) {
+
+  if (ogg_info == nullptr) {
+    return -1;
   }
 
-  const ogg_int64_t loop_end_byte = loop_end_pcm * num_channels * sizeof(ALshort);
+  const int num_channels = ogg_info->channels;
+  const ogg_int64_t loop_end_byte = loop_end_pcm * num_channels * sizeof(int16_t);
 
   // Decode the OGG data.
-  std::vector<ALshort> raw_data(nb_samples * num_channels);
   int bitstream = 0;
   long bytes_read = 0;
   long total_bytes_read = 0;
-  long remaining_bytes = nb_samples * num_channels * sizeof(ALshort);
+  long remaining_bytes = nb_samples * num_channels * sizeof(int16_t);
 
   do {
     long max_bytes_to_read = remaining_bytes;
     ogg_int64_t current_pcm = ov_pcm_tell(ogg_file.get());
-    ogg_int64_t current_byte = current_pcm * num_channels * sizeof(ALshort);
+    ogg_int64_t current_byte = current_pcm * num_channels * sizeof(int16_t);
 
     if (loop_end_pcm != -1 &&
         current_byte + max_bytes_to_read > loop_end_byte) {
@@ -154,7 +173,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
 
     bytes_read = ov_read(
         ogg_file.get(),
-        ((char*) raw_data.data()) + total_bytes_read,
+        ((char*) decoded_data) + total_bytes_read,
         max_bytes_to_read,
         0,
         2,
@@ -167,7 +186,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
         std::ostringstream oss;
         oss << "Error while decoding ogg chunk: " << bytes_read;
         Debug::error(oss.str());
-        return;
+        return -1;
       }
     }
     else {
@@ -191,16 +210,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
   }
   while (remaining_bytes > 0 && bytes_read > 0);
 
-  // Put this decoded data into the buffer.
-  alBufferData(destination_buffer, al_format, raw_data.data(), ALsizei(total_bytes_read), sample_rate);
-
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded OGG data: error " << error;
-    Debug::error(oss.str());
-  }
+  return total_bytes_read;
 }
 
 }
-
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/PcmChunkQueue.h"
+#include "solarus/core/Debug.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty queue.
+ * \param capacity Maximum number of chunks in the queue.
+ */
+PcmChunkQueue::PcmChunkQueue(int capacity):
+  chunks(static_cast<size_t>(std::max(capacity, 1)) + 1),
+  read_index(0),
+  write_index(0) {
+
+}
+
+/**
+ * \brief Returns the maximum number of chunks in the queue.
+ * \return The capacity.
+ */
+int PcmChunkQueue::get_capacity() const {
+  return static_cast<int>(chunks.size()) - 1;
+}
+
+/**
+ * \brief Returns the number of chunks ready to be read.
+ *
+ * When called from a thread that is neither the producer nor the consumer,
+ * the value may be outdated.
+ *
+ * \return The number of chunks in the queue.
+ */
+int PcmChunkQueue::get_num_chunks() const {
+
+  const size_t read = read_index.load(std::memory_order_acquire);
+  const size_t write = write_index.load(std::memory_order_acquire);
+  return static_cast<int>((write + chunks.size() - read) % chunks.size());
+}
+
+/**
+ * \brief Returns whether there is no chunk to read.
+ * \return \c true if the queue is empty.
+ */
+bool PcmChunkQueue::is_empty() const {
+  return get_num_chunks() == 0;
+}
+
+/**
+ * \brief Returns whether no chunk can be written.
+ * \return \c true if the queue is full.
+ */
+bool PcmChunkQueue::is_full() const {
+  return get_num_chunks() == get_capacity();
+}
+
+/**
+ * \brief Returns the chunk the producer can fill next.
+ *
+ * The chunk only becomes visible to the consumer after push().
+ *
+ * \return The chunk to fill, or nullptr if the queue is full.
+ */
+PcmChunk* PcmChunkQueue::get_chunk_to_write() {
+
+  const size_t write = write_index.load(std::memory_order_relaxed);
+  const size_t next = (write + 1) % chunks.size();
+  if (next == read_index.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &chunks[write];
+}
+
+/**
+ * \brief Makes the chunk returned by get_chunk_to_write() readable.
+ */
+void PcmChunkQueue::push() {
+
+  Debug::check_assertion(!is_full(), "PCM chunk queue is full");
+  const size_t write = write_index.load(std::memory_order_relaxed);
+  write_index.store((write + 1) % chunks.size(), std::memory_order_release);
+}
+
+/**
+ * \brief Returns the oldest chunk of the queue.
+ * \return The chunk to read, or nullptr if the queue is empty.
+ */
+const PcmChunk* PcmChunkQueue::get_chunk_to_read() const {
+
+  const size_t read = read_index.load(std::memory_order_relaxed);
+  if (read == write_index.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &chunks[read];
+}
+
+/**
+ * \brief Releases the chunk returned by get_chunk_to_read().
+ *
+ * The producer can then reuse it.
+ */
+void PcmChunkQueue::pop() {
+
+  Debug::check_assertion(!is_empty(), "PCM chunk queue is empty");
+  const size_t read = read_index.load(std::memory_order_relaxed);
+  read_index.store((read + 1) % chunks.size(), std::memory_order_release);
+}
+
+}
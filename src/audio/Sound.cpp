@@ -15,32 +15,47 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include <algorithm>
-#include <cstring>  // memcpy
 #include <sstream>
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Logger.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
+#include "solarus/core/System.h"
 #include "solarus/audio/Music.h"
+#include "solarus/audio/OggDecoder.h"
 #include "solarus/audio/Sound.h"
+#include <SDL_rwops.h>
+#include <chrono>
 #include <cstdio>
 
 namespace Solarus {
 
+constexpr size_t Sound::default_max_memory_size;
+constexpr int Sound::default_num_sources;
 ALCdevice* Sound::device = nullptr;
 ALCcontext* Sound::context = nullptr;
+ResourceCache<Sound::Buffer> Sound::buffers;
+uint64_t Sound::clock = 0;
+size_t Sound::max_memory_size = Sound::default_max_memory_size;
+std::vector<Sound::PlayingSource> Sound::playing_sources;
+std::vector<ALuint> Sound::free_sources;
+int Sound::num_sources = Sound::default_num_sources;
+uint64_t Sound::num_updates = 0;
+std::deque<std::string> Sound::sounds_to_preload;
+std::string Sound::preloading_sound_id;
+std::future<Sound::DecodedSoundPtr> Sound::preloading_sound;
+uint32_t Sound::streaming_duration = 0;
+std::map<std::string, Sound::EncodedSoundPtr> Sound::encoded_sounds;
 bool Sound::initialized = false;
-bool Sound::sounds_preloaded = false;
 float Sound::volume = 1.0;
-std::list<Sound*> Sound::current_sounds;
-std::map<std::string, Sound> Sound::all_sounds;
 
 namespace {
 
 /**
- * \brief Loads an encoded sound from memory.
+ * \brief Loads an encoded sound from a stream.
  *
  * This function respects the prototype specified by libvorbisfile.
  *
@@ -52,25 +67,16 @@ namespace {
  */
 size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource) {
 
-  Sound::SoundFromMemory* mem = static_cast<Sound::SoundFromMemory*>(datasource);
+  Sound::SoundStream* stream = static_cast<Sound::SoundStream*>(datasource);
 
-  const size_t total_size = mem->data.size();
-  if (mem->position >= total_size) {
-    if (mem->loop) {
-      mem->position = 0;
-    }
-    else {
-      return 0;
+  size_t bytes_read = SDL_RWread(stream->rw, ptr, 1, nb_bytes);
+  if (bytes_read == 0 && nb_bytes > 0 && stream->loop) {
+    if (SDL_RWseek(stream->rw, 0, RW_SEEK_SET) == 0) {
+      bytes_read = SDL_RWread(stream->rw, ptr, 1, nb_bytes);
     }
   }
-  else if (mem->position + nb_bytes >= total_size) {
-    nb_bytes = total_size - mem->position;
-  }
-
-  std::memcpy(ptr, mem->data.data() + mem->position, nb_bytes);
-  mem->position += nb_bytes;
 
-  return nb_bytes;
+  return bytes_read;
 }
 
 /**
@@ -85,25 +91,29 @@ size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource)
  */
 int cb_seek(void* datasource, ogg_int64_t offset, int whence) {
 
-  Sound::SoundFromMemory* mem = static_cast<Sound::SoundFromMemory*>(datasource);
+  Sound::SoundStream* stream = static_cast<Sound::SoundStream*>(datasource);
 
+  int rw_whence = RW_SEEK_SET;
   switch (whence) {
 
   case SEEK_SET:
-    mem->position = offset;
+    rw_whence = RW_SEEK_SET;
     break;
 
   case SEEK_CUR:
-    mem->position += offset;
+    rw_whence = RW_SEEK_CUR;
     break;
 
   case SEEK_END:
-    mem->position = mem->data.size() - offset;
+    rw_whence = RW_SEEK_END;
     break;
+
+  default:
+    return -1;
   }
 
-  if (mem->position >= mem->data.size()) {
-    mem->position = mem->data.size();
+  if (SDL_RWseek(stream->rw, offset, rw_whence) < 0) {
+    return -1;
   }
 
   return 0;
@@ -119,8 +129,8 @@ int cb_seek(void* datasource, ogg_int64_t offset, int whence) {
  */
 long cb_tell(void* datasource) {
 
-  Sound::SoundFromMemory* mem = static_cast<Sound::SoundFromMemory*>(datasource);
-  return mem->position;
+  Sound::SoundStream* stream = static_cast<Sound::SoundStream*>(datasource);
+  return static_cast<long>(SDL_RWtell(stream->rw));
 }
 
 }  // Anonymous namespace.
@@ -133,39 +143,27 @@ ov_callbacks Sound::ogg_callbacks = {
 };
 
 /**
- * \brief Creates a new Ogg Vorbis sound.
- */
-Sound::Sound():
-  Sound(std::string("")) {
-
-}
-
-/**
- * \brief Creates a new Ogg Vorbis sound.
- * \param sound_id id of the sound: name of a .ogg file in the sounds subdirectory,
- * without the extension (.ogg is added automatically)
+ * \brief Wraps an OpenAL buffer.
+ * \param buffer The buffer. It will be destroyed with this object.
+ * \param duration Length of the sound in milliseconds.
+ * \param num_bytes Size of the samples.
  */
-Sound::Sound(const std::string& sound_id):
-  id(sound_id),
-  buffer(AL_NONE) {
+Sound::Buffer::Buffer(ALuint buffer, uint32_t duration, size_t num_bytes):
+  buffer(buffer),
+  duration(duration),
+  num_bytes(num_bytes) {
 
+  MemoryStats::add(MemoryStats::Category::SOUND_BUFFERS, static_cast<int64_t>(num_bytes));
 }
 
 /**
- * \brief Destroys the sound.
+ * \brief Destroys the OpenAL buffer.
  */
-Sound::~Sound() {
+Sound::Buffer::~Buffer() {
 
+  MemoryStats::remove(MemoryStats::Category::SOUND_BUFFERS, static_cast<int64_t>(num_bytes));
   if (is_initialized() && buffer != AL_NONE) {
-
-    // stop the sources where this buffer is attached
-    for (ALuint source: sources) {
-      alSourceStop(source);
-      alSourcei(source, AL_BUFFER, 0);
-      alDeleteSources(1, &source);
-    }
     alDeleteBuffers(1, &buffer);
-    current_sounds.remove(this);
   }
 }
 
@@ -186,6 +184,26 @@ void Sound::initialize(const Arguments& args) {
     return;
   }
 
+  // Check the -sound-cache-size option.
+  const std::string& cache_size_arg = args.get_argument_value("-sound-cache-size");
+  if (!cache_size_arg.empty()) {
+    std::istringstream iss(cache_size_arg);
+    int cache_size = -1;
+    if (iss >> cache_size && cache_size >= 0) {
+      max_memory_size = static_cast<size_t>(cache_size) * 1024 * 1024;
+    }
+  }
+
+  // Check the -sound-sources option.
+  const std::string& num_sources_arg = args.get_argument_value("-sound-sources");
+  if (!num_sources_arg.empty()) {
+    std::istringstream iss(num_sources_arg);
+    int num_sources = 0;
+    if (iss >> num_sources && num_sources > 0) {
+      Sound::num_sources = num_sources;
+    }
+  }
+
   // Initialize OpenAL.
 
   device = alcOpenDevice(nullptr);
@@ -212,9 +230,10 @@ void Sound::initialize(const Arguments& args) {
 
   initialized = true;
   set_volume(100);
+  create_sources();
 
   // initialize the music system
-  Music::initialize();
+  Music::initialize(args);
 }
 
 /**
@@ -229,8 +248,27 @@ void Sound::quit() {
     // uninitialize the music subsystem
     Music::quit();
 
+    // stop preloading
+    if (preloading_sound.valid()) {
+      preloading_sound.wait();
+    }
+    preloading_sound = std::future<DecodedSoundPtr>();
+    preloading_sound_id.clear();
+    sounds_to_preload.clear();
+
     // clear the sounds
-    all_sounds.clear();
+    for (const PlayingSource& playing_source: playing_sources) {
+      alSourceStop(playing_source.source);
+      alSourcei(playing_source.source, AL_BUFFER, 0);
+      alDeleteSources(1, &playing_source.source);
+    }
+    playing_sources.clear();
+    for (ALuint source: free_sources) {
+      alDeleteSources(1, &source);
+    }
+    free_sources.clear();
+    buffers.clear();
+    encoded_sounds.clear();
 
     // uninitialize OpenAL
 
@@ -254,23 +292,47 @@ bool Sound::is_initialized() {
 }
 
 /**
- * \brief Loads and decodes all sounds listed in the game database.
+ * \brief Decodes in advance all sounds listed in the quest database.
+ *
+ * Sounds are decoded on a separate thread, as long as
+ * the memory limit of decoded sounds is not reached.
  */
 void Sound::load_all() {
 
-  if (is_initialized() && !sounds_preloaded) {
+  const std::map<std::string, std::string>& sound_elements =
+      CurrentQuest::get_resources(ResourceType::SOUND);
+  std::vector<std::string> sound_ids;
+  for (const auto& kvp: sound_elements) {
+    sound_ids.push_back(kvp.first);
+  }
+  preload(sound_ids);
+}
 
-    const std::map<std::string, std::string>& sound_elements =
-        CurrentQuest::get_resources(ResourceType::SOUND);
-    for (const auto& kvp: sound_elements) {
-      const std::string& sound_id = kvp.first;
+/**
+ * \brief Decodes some sounds in advance.
+ *
+ * Sounds are decoded one by one on a separate thread, as long as
+ * the memory limit of decoded sounds is not reached.
+ * A sound played before being preloaded is simply decoded at this time.
+ *
+ * \param sound_ids Ids of the sounds to preload.
+ */
+void Sound::preload(const std::vector<std::string>& sound_ids) {
 
-      all_sounds[sound_id] = Sound(sound_id);
-      all_sounds[sound_id].load();
-    }
+  if (!is_initialized()) {
+    return;
+  }
 
-    sounds_preloaded = true;
+  for (const std::string& sound_id: sound_ids) {
+    if (buffers.contains(sound_id) ||
+        sound_id == preloading_sound_id ||
+        std::find(sounds_to_preload.begin(), sounds_to_preload.end(), sound_id) != sounds_to_preload.end()) {
+      continue;
+    }
+    sounds_to_preload.push_back(sound_id);
   }
+
+  update_preloading();
 }
 
 /**
@@ -286,16 +348,112 @@ bool Sound::exists(const std::string& sound_id) {
 }
 
 /**
- * \brief Starts playing the specified sound.
+ * \brief Starts playing the specified sound with default options.
  * \param sound_id id of the sound to play
  */
 void Sound::play(const std::string& sound_id) {
 
-  if (all_sounds.find(sound_id) == all_sounds.end()) {
-    all_sounds[sound_id] = Sound(sound_id);
+  play(sound_id, PlayOptions());
+}
+
+/**
+ * \brief Starts playing the specified sound.
+ *
+ * The sound is decoded first if it is not in memory yet.
+ * If the same sound was already started during this cycle,
+ * nothing more is played.
+ *
+ * \param sound_id id of the sound to play
+ * \param options Priority and concurrency rules of this play.
+ */
+void Sound::play(const std::string& sound_id, const PlayOptions& options) {
+
+  if (!is_initialized()) {
+    return;
+  }
+
+  int num_instances = 0;
+  int oldest_instance = -1;
+  for (size_t i = 0; i < playing_sources.size(); ++i) {
+    PlayingSource& playing_source = playing_sources[i];
+    if (playing_source.sound_id != sound_id) {
+      continue;
+    }
+    if (playing_source.start_update == num_updates) {
+      // Already started during this cycle: merge both plays.
+      playing_source.priority = std::max(playing_source.priority, options.priority);
+      return;
+    }
+    ++num_instances;
+    if (oldest_instance == -1 ||
+        playing_source.start_date < playing_sources[oldest_instance].start_date) {
+      oldest_instance = static_cast<int>(i);
+    }
+  }
+
+  const EncodedSoundPtr& encoded_sound = get_encoded_sound(sound_id);
+  BufferPtr buffer = nullptr;
+  if (encoded_sound == nullptr) {
+    buffer = get_buffer(sound_id);
+    if (buffer == nullptr) {
+      return;
+    }
+  }
+
+  ALuint source = AL_NONE;
+  if (options.max_instances > 0 && num_instances >= options.max_instances) {
+    // Too many instances of this sound: restart the oldest one.
+    source = stop_playing_source(oldest_instance);
+  }
+  else if (!free_sources.empty()) {
+    source = free_sources.back();
+    free_sources.pop_back();
+  }
+  else {
+    const int index = find_source_to_steal(options.priority);
+    if (index == -1) {
+      // All sources play more important sounds.
+      return;
+    }
+    source = stop_playing_source(index);
   }
 
-  all_sounds[sound_id].start();
+  StreamPtr stream = nullptr;
+  if (encoded_sound != nullptr) {
+    // Long sound: decode the beginning now and the rest while playing.
+    stream = std::make_shared<Stream>(encoded_sound);
+    if (!stream->start(source)) {
+      Debug::error(std::string("Cannot stream sound '") + sound_id + "'");
+      release_source(source);
+      return;
+    }
+  }
+  else {
+    alSourcei(source, AL_BUFFER, buffer->buffer);
+  }
+  alSourcef(source, AL_GAIN, volume * options.volume);
+
+  // play the sound
+  int error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot attach the buffers of sound '" << sound_id
+        << "' to its source: error " << error;
+    Debug::error(oss.str());
+    release_source(source);
+    return;
+  }
+
+  // Streamed sounds are checked at each cycle to refill their buffers.
+  const uint32_t end_time = buffer != nullptr ? System::get_real_time() + buffer->duration : 0;
+  playing_sources.push_back({ source, buffer, sound_id, options.priority, clock, num_updates, end_time, stream });
+  alSourcePlay(source);
+  error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot play sound '" << sound_id << "': error " << error;
+    Debug::error(oss.str());
+  }
 }
 
 /**
@@ -318,6 +476,59 @@ void Sound::set_volume(int volume) {
   Logger::info(std::string("Sound volume: ") + String::to_string(get_volume()));
 }
 
+/**
+ * \brief Returns the memory allowed for decoded sounds.
+ * \return The maximum memory size in bytes.
+ */
+size_t Sound::get_max_memory_size() {
+  return max_memory_size;
+}
+
+/**
+ * \brief Sets the memory allowed for decoded sounds.
+ *
+ * Sounds that are playing are kept even if the limit is exceeded.
+ *
+ * \param max_memory_size The maximum memory size in bytes.
+ */
+void Sound::set_max_memory_size(size_t max_memory_size) {
+
+  Sound::max_memory_size = max_memory_size;
+  enforce_max_memory_size();
+}
+
+/**
+ * \brief Returns statistics about decoded sounds.
+ * \return Hits, misses and evictions of decoded sounds,
+ * with their number and memory size.
+ */
+ResourceCacheStatistics Sound::get_statistics() {
+  return buffers.get_statistics();
+}
+
+/**
+ * \brief Returns the duration above which sounds are decoded while playing.
+ * \return The duration in milliseconds, or 0 if all sounds are fully decoded.
+ */
+uint32_t Sound::get_streaming_duration() {
+  return streaming_duration;
+}
+
+/**
+ * \brief Sets the duration above which sounds are decoded while playing.
+ *
+ * Such sounds are kept compressed in memory instead of being decoded
+ * in advance.
+ *
+ * \param streaming_duration The duration in milliseconds,
+ * or 0 to fully decode all sounds.
+ */
+void Sound::set_streaming_duration(uint32_t streaming_duration) {
+
+  Sound::streaming_duration = streaming_duration;
+  encoded_sounds.clear();
+}
+
 /**
  * \brief Updates the audio (music and sound) system.
  *
@@ -325,170 +536,317 @@ void Sound::set_volume(int volume) {
  */
 void Sound::update() {
 
-  // update the playing sounds
-  std::list<Sound*> sounds_to_remove;
-  for (Sound* sound: current_sounds) {
-    if (!sound->update_playing()) {
-      sounds_to_remove.push_back(sound);
+  ++num_updates;
+
+  // Release the sources that finished playing.
+  // Their state is only asked to OpenAL once they are expected to be finished.
+  const uint32_t now = System::get_real_time();
+  size_t i = 0;
+  while (i < playing_sources.size()) {
+    const StreamPtr& stream = playing_sources[i].stream;
+    if (stream != nullptr) {
+      if (stream->update(playing_sources[i].source)) {
+        ++i;
+        continue;
+      }
+      release_source(playing_sources[i].source);
+      playing_sources[i] = std::move(playing_sources.back());
+      playing_sources.pop_back();
+      continue;
+    }
+    if (now < playing_sources[i].end_time) {
+      ++i;
+      continue;
     }
+    ALint status;
+    alGetSourcei(playing_sources[i].source, AL_SOURCE_STATE, &status);
+    if (status == AL_PLAYING) {
+      ++i;
+      continue;
+    }
+    release_source(playing_sources[i].source);
+    playing_sources[i] = std::move(playing_sources.back());
+    playing_sources.pop_back();
   }
 
-  for (Sound* sound: sounds_to_remove) {
-    current_sounds.remove(sound);
-  }
+  update_preloading();
 
   // also update the music
   Music::update();
 }
 
 /**
- * \brief Updates this sound when it is playing.
- * \return true if the sound is still playing, false if it is finished.
+ * \brief Returns the name of the file of a sound.
+ * \param sound_id Id of the sound.
+ * \return The file name relative to the data directory.
  */
-bool Sound::update_playing() {
+std::string Sound::get_file_name(const std::string& sound_id) {
 
-  // See if this sound is still playing.
-  if (sources.empty()) {
-    return false;
+  std::string file_name = std::string("sounds/" + sound_id);
+  if (sound_id.find(".") == std::string::npos) {
+    file_name += ".ogg";
   }
+  return file_name;
+}
 
-  ALuint source = *sources.begin();
-  ALint status;
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
+/**
+ * \brief Returns the decoded buffer of a sound, decoding it if necessary.
+ * \param sound_id Id of the sound.
+ * \return The buffer, or nullptr if the sound could not be loaded.
+ */
+Sound::BufferPtr Sound::get_buffer(const std::string& sound_id) {
+
+  ++clock;
+  if (sound_id == preloading_sound_id) {
+    // Already being decoded: wait for it instead of decoding it twice.
+    finish_preloading();
+  }
 
-  if (status != AL_PLAYING) {
-    sources.pop_front();
-    alSourcei(source, AL_BUFFER, 0);
-    alDeleteSources(1, &source);
+  BufferPtr buffer = buffers.get(sound_id, clock);
+  if (buffer != nullptr) {
+    return buffer;
   }
 
-  return !sources.empty();
+  if (alGetError() != AL_NONE) {
+    Debug::error("Previous audio error not cleaned");
+  }
+
+  const DecodedSoundPtr& decoded_sound = decode_file(get_file_name(sound_id));
+  if (decoded_sound == nullptr) {
+    return nullptr;
+  }
+  return create_buffer(sound_id, *decoded_sound);
 }
 
 /**
- * \brief Loads and decodes the sound into memory.
+ * \brief Copies decoded samples into a new OpenAL buffer and adds it to the cache.
+ * \param sound_id Id of the sound.
+ * \param decoded_sound The decoded samples.
+ * \return The buffer created, or nullptr in case of error.
  */
-void Sound::load() {
+Sound::BufferPtr Sound::create_buffer(
+    const std::string& sound_id,
+    const DecodedSound& decoded_sound
+) {
+  ALuint al_buffer = AL_NONE;
+  alGenBuffers(1, &al_buffer);
+  if (alGetError() != AL_NO_ERROR) {
+    Debug::error("Failed to generate audio buffer");
+    return nullptr;
+  }
+  // 16-bit stereo samples.
+  const uint32_t duration = decoded_sound.sample_rate > 0 ?
+      static_cast<uint32_t>(decoded_sound.samples.size() / 4 * 1000 / decoded_sound.sample_rate) : 0;
+  BufferPtr buffer = std::make_shared<Buffer>(
+      al_buffer, duration, decoded_sound.samples.size());
+
+  alBufferData(al_buffer,
+      AL_FORMAT_STEREO16,
+      decoded_sound.samples.data(),
+      ALsizei(decoded_sound.samples.size()),
+      decoded_sound.sample_rate);
+  ALenum error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot copy the sound samples of '"
+        << sound_id << "' into buffer " << al_buffer
+        << ": error " << error;
+    Debug::error(oss.str());
+    return nullptr;
+  }
 
-  if (alGetError() != AL_NONE) {
-    Debug::error("Previous audio error not cleaned");
+  buffers.add(sound_id, buffer, decoded_sound.samples.size(), clock);
+  enforce_max_memory_size();
+  return buffer;
+}
+
+/**
+ * \brief Releases the least recently played sounds until the memory
+ * limit is respected.
+ *
+ * Sounds currently playing are never released.
+ */
+void Sound::enforce_max_memory_size() {
+
+  uint64_t last_use = 0;
+  while (buffers.get_memory_size() > max_memory_size &&
+      buffers.get_least_recently_used(last_use)) {
+    buffers.evict_least_recently_used();
   }
+}
 
-  std::string file_name = std::string("sounds/" + id);
-  if (id.find(".") == std::string::npos) {
-    file_name += ".ogg";
+/**
+ * \brief Collects the sound decoded in advance if it is ready and
+ * starts decoding the next one.
+ */
+void Sound::update_preloading() {
+
+  if (preloading_sound.valid() &&
+      preloading_sound.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    finish_preloading();
   }
 
-  // Create an OpenAL buffer with the sound decoded by the library.
-  buffer = decode_file(file_name);
+  while (!preloading_sound.valid() && !sounds_to_preload.empty()) {
 
-  // buffer is now AL_NONE if there was an error.
+    if (buffers.get_memory_size() >= max_memory_size) {
+      // No room for more sounds: the remaining ones will be decoded when played.
+      sounds_to_preload.clear();
+      break;
+    }
+
+    const std::string sound_id = sounds_to_preload.front();
+    sounds_to_preload.pop_front();
+    if (buffers.contains(sound_id) || get_encoded_sound(sound_id) != nullptr) {
+      continue;
+    }
+    preloading_sound_id = sound_id;
+    preloading_sound = std::async(std::launch::async, &Sound::decode_file, get_file_name(sound_id));
+  }
 }
 
 /**
- * \brief Plays the sound.
- * \return true if the sound was loaded successfully, false otherwise
+ * \brief Waits for the sound being decoded in advance and adds it to the cache.
  */
-bool Sound::start() {
+void Sound::finish_preloading() {
 
-  bool success = false;
+  if (!preloading_sound.valid()) {
+    return;
+  }
 
-  if (is_initialized()) {
+  const DecodedSoundPtr& decoded_sound = preloading_sound.get();
+  const std::string sound_id = preloading_sound_id;
+  preloading_sound_id.clear();
+
+  if (decoded_sound != nullptr && !buffers.contains(sound_id)) {
+    create_buffer(sound_id, *decoded_sound);
+  }
+}
+
+/**
+ * \brief Allocates the pool of sources.
+ *
+ * Stops early if the system does not provide that many sources.
+ */
+void Sound::create_sources() {
 
-    if (buffer == AL_NONE) { // first time: load and decode the file
-      load();
+  for (int i = 0; i < num_sources; ++i) {
+    ALuint source = AL_NONE;
+    alGenSources(1, &source);
+    if (alGetError() != AL_NO_ERROR) {
+      break;
     }
+    free_sources.push_back(source);
+  }
 
-    if (buffer != AL_NONE) {
-
-      // create a source
-      ALuint source;
-      alGenSources(1, &source);
-      alSourcei(source, AL_BUFFER, buffer);
-      alSourcef(source, AL_GAIN, volume);
-
-      // play the sound
-      int error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot attach buffer " << buffer
-            << " to the source to play sound '" << id << "': error " << error;
-        Debug::error(oss.str());
-        alDeleteSources(1, &source);
-      }
-      else {
-        sources.push_back(source);
-        current_sounds.remove(this); // to avoid duplicates
-        current_sounds.push_back(this);
-        alSourcePlay(source);
-        error = alGetError();
-        if (error != AL_NO_ERROR) {
-          std::ostringstream oss;
-          oss << "Cannot play sound '" << id << "': error " << error;
-          Debug::error(oss.str());
-        }
-        else {
-          success = true;
-        }
-      }
+  if (free_sources.size() < static_cast<size_t>(num_sources)) {
+    std::ostringstream oss;
+    oss << "Could only create " << free_sources.size()
+        << " audio sources out of " << num_sources;
+    Logger::info(oss.str());
+  }
+}
+
+/**
+ * \brief Chooses a playing sound to interrupt for a new one.
+ * \param priority Priority of the new sound.
+ * \return Index in playing_sources of the oldest sound with the lowest
+ * priority not higher than the new one, or -1 if there is none.
+ */
+int Sound::find_source_to_steal(int priority) {
+
+  int result = -1;
+  for (size_t i = 0; i < playing_sources.size(); ++i) {
+    const PlayingSource& candidate = playing_sources[i];
+    if (candidate.priority > priority) {
+      continue;
+    }
+    if (result == -1) {
+      result = static_cast<int>(i);
+      continue;
+    }
+    const PlayingSource& best = playing_sources[result];
+    if (candidate.priority < best.priority ||
+        (candidate.priority == best.priority && candidate.start_date < best.start_date)) {
+      result = static_cast<int>(i);
     }
   }
-  return success;
+  return result;
 }
 
 /**
- * \brief Loads the specified sound file and decodes its content into an OpenAL buffer.
- * \param file_name name of the file to open
- * \return the buffer created, or AL_NONE if the sound could not be loaded
+ * \brief Interrupts a playing sound and returns its source.
+ * \param index Index in playing_sources.
+ * \return The source, stopped and ready to be reused.
  */
-ALuint Sound::decode_file(const std::string& file_name) {
+ALuint Sound::stop_playing_source(int index) {
+
+  const ALuint source = playing_sources[index].source;
+  alSourceStop(source);
+  alSourcei(source, AL_BUFFER, 0);
+  playing_sources[index] = std::move(playing_sources.back());
+  playing_sources.pop_back();
+  return source;
+}
+
+/**
+ * \brief Detaches the sound of a source and puts the source back in the pool.
+ * \param source A source that no longer plays.
+ */
+void Sound::release_source(ALuint source) {
 
-  ALuint buffer = AL_NONE;
+  alSourceStop(source);
+  alSourcei(source, AL_BUFFER, 0);
+  free_sources.push_back(source);
+}
+
+/**
+ * \brief Loads the specified sound file and decodes its content.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * \param file_name name of the file to open
+ * \return the decoded sound, or nullptr if the sound could not be loaded
+ */
+Sound::DecodedSoundPtr Sound::decode_file(const std::string& file_name) {
 
   if (!QuestFiles::data_file_exists(file_name)) {
     Debug::error(std::string("Cannot find sound file '") + file_name + "'");
-    return AL_NONE;
+    return nullptr;
   }
 
-  // load the sound file
-  SoundFromMemory mem;
-  mem.loop = false;
-  mem.position = 0;
-  mem.data = QuestFiles::data_file_read(file_name);
+  DecodedSoundPtr decoded_sound = nullptr;
+
+  // open the sound file
+  SoundStream stream;
+  stream.loop = false;
+  stream.rw = QuestFiles::data_file_open_rw(file_name);
 
   OggVorbis_File file;
-  int error = ov_open_callbacks(&mem, &file, nullptr, 0, ogg_callbacks);
+  int error = ov_open_callbacks(&stream, &file, nullptr, 0, ogg_callbacks);
 
   if (error) {
     std::ostringstream oss;
     oss << "Cannot load sound file '" << file_name
-        << "' from memory: error " << error;
+        << "': error " << error;
     Debug::error(oss.str());
   }
   else {
 
     // read the encoded sound properties
     vorbis_info* info = ov_info(&file, -1);
-    ALsizei sample_rate = ALsizei(info->rate);
+    const int num_channels = info->channels;
 
-    ALenum format = AL_NONE;
-    if (info->channels == 1) {
-      format = AL_FORMAT_MONO16;
-    }
-    else if (info->channels == 2) {
-      format = AL_FORMAT_STEREO16;
-    }
-
-    if (format == AL_NONE) {
+    if (num_channels != 1 && num_channels != 2) {
       Debug::error(std::string("Invalid audio format for sound file '")
           + file_name + "'");
     }
     else {
       // decode the sound with vorbisfile
-      std::vector<char> samples;
+      decoded_sound = std::make_shared<DecodedSound>();
+      decoded_sound->sample_rate = ALsizei(info->rate);
+      std::vector<char>& samples = decoded_sound->samples;
       int bitstream;
       long bytes_read;
-      long total_bytes_read = 0;
       const int buffer_size = 16384;
       char samples_buffer[buffer_size];
       do {
@@ -500,8 +858,7 @@ ALuint Sound::decode_file(const std::string& file_name) {
           Debug::error(oss.str());
         }
         else {
-          total_bytes_read += bytes_read;
-          if (format == AL_FORMAT_STEREO16) {
+          if (num_channels == 2) {
             samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
           }
           else {
@@ -512,39 +869,195 @@ ALuint Sound::decode_file(const std::string& file_name) {
               samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
               samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
             }
-            total_bytes_read += bytes_read;
           }
         }
       }
       while (bytes_read > 0);
+    }
+    ov_clear(&file);
+  }
 
-      // copy the samples into an OpenAL buffer
-      alGenBuffers(1, &buffer);
-      if (alGetError() != AL_NO_ERROR) {
-          Debug::error("Failed to generate audio buffer");
-      }
-      alBufferData(buffer,
-          AL_FORMAT_STEREO16,
-          reinterpret_cast<ALshort*>(samples.data()),
-          ALsizei(total_bytes_read),
-          sample_rate);
-      ALenum error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot copy the sound samples of '"
-            << file_name << "' into buffer " << buffer
-            << ": error " << error;
-        Debug::error(oss.str());
-        buffer = AL_NONE;
-      }
+  SDL_RWclose(stream.rw);
+
+  return decoded_sound;
+}
+
+
+/**
+ * \brief Returns the compressed data of a sound if it is long enough to be
+ * decoded while playing.
+ *
+ * The result is remembered, so that files are only inspected once.
+ *
+ * \param sound_id Id of a sound.
+ * \return The compressed data, or nullptr if the sound should be fully
+ * decoded.
+ */
+Sound::EncodedSoundPtr Sound::get_encoded_sound(const std::string& sound_id) {
+
+  if (streaming_duration == 0) {
+    return nullptr;
+  }
+
+  const auto& it = encoded_sounds.find(sound_id);
+  if (it != encoded_sounds.end()) {
+    return it->second;
+  }
+
+  EncodedSoundPtr encoded_sound = nullptr;
+  const std::string& file_name = get_file_name(sound_id);
+  if (!buffers.contains(sound_id) && QuestFiles::data_file_exists(file_name)) {
+    EncodedSoundPtr data = QuestFiles::data_file_map(file_name);
+    if (get_duration(*data) >= streaming_duration) {
+      encoded_sound = data;
+    }
+  }
+  encoded_sounds.emplace(sound_id, encoded_sound);
+  return encoded_sound;
+}
+
+/**
+ * \brief Reads the length of a compressed sound from its header.
+ * \param encoded_sound The OGG data.
+ * \return The duration in milliseconds, or 0 in case of error.
+ */
+uint32_t Sound::get_duration(const QuestFiles::DataFileBuffer& encoded_sound) {
+
+  SoundStream stream;
+  stream.loop = false;
+  stream.rw = SDL_RWFromConstMem(encoded_sound.data(), static_cast<int>(encoded_sound.size()));
+
+  uint32_t duration = 0;
+  OggVorbis_File file;
+  if (ov_open_callbacks(&stream, &file, nullptr, 0, ogg_callbacks) == 0) {
+    const double seconds = ov_time_total(&file, -1);
+    if (seconds > 0.0) {
+      duration = static_cast<uint32_t>(seconds * 1000.0);
     }
     ov_clear(&file);
   }
+  SDL_RWclose(stream.rw);
+  return duration;
+}
 
-  mem.data.clear();
+/**
+ * \brief Prepares the decoding of a streamed sound.
+ * \param encoded_sound The compressed data to decode.
+ */
+Sound::Stream::Stream(const EncodedSoundPtr& encoded_sound):
+  encoded_sound(encoded_sound),
+  decoder(new OggDecoder()),
+  buffers(num_buffers, AL_NONE),
+  samples(),
+  stereo_samples(),
+  finished(false) {
+
+  alGenBuffers(num_buffers, buffers.data());
+}
 
-  return buffer;
+/**
+ * \brief Destroys the buffers of this stream.
+ */
+Sound::Stream::~Stream() {
+
+  if (is_initialized()) {
+    alDeleteBuffers(num_buffers, buffers.data());
+  }
 }
 
+/**
+ * \brief Decodes the beginning of the sound and queues it on a source.
+ * \param source The source that will play the sound.
+ * \return \c false in case of error.
+ */
+bool Sound::Stream::start(ALuint source) {
+
+  SDL_RWops* rw = SDL_RWFromConstMem(encoded_sound->data(), static_cast<int>(encoded_sound->size()));
+  if (!decoder->load(rw, false)) {
+    return false;
+  }
+
+  const int num_channels = decoder->get_num_channels();
+  if (num_channels != 1 && num_channels != 2) {
+    return false;
+  }
+
+  for (ALuint buffer: buffers) {
+    if (finished || !fill_buffer(buffer)) {
+      break;
+    }
+    alSourceQueueBuffers(source, 1, &buffer);
+  }
+  return true;
 }
 
+/**
+ * \brief Gives newly decoded data to the buffers already played.
+ * \param source The source playing the sound.
+ * \return \c true if the sound is still playing.
+ */
+bool Sound::Stream::update(ALuint source) {
+
+  ALint num_processed = 0;
+  alGetSourcei(source, AL_BUFFERS_PROCESSED, &num_processed);
+  for (int i = 0; i < num_processed && !finished; ++i) {
+    ALuint buffer = AL_NONE;
+    alSourceUnqueueBuffers(source, 1, &buffer);
+    if (fill_buffer(buffer)) {
+      alSourceQueueBuffers(source, 1, &buffer);
+    }
+  }
+
+  ALint status = AL_STOPPED;
+  alGetSourcei(source, AL_SOURCE_STATE, &status);
+  if (status == AL_PLAYING) {
+    return true;
+  }
+
+  ALint num_queued = 0;
+  alGetSourcei(source, AL_BUFFERS_QUEUED, &num_queued);
+  ALint num_still_processed = 0;
+  alGetSourcei(source, AL_BUFFERS_PROCESSED, &num_still_processed);
+  if (num_queued > num_still_processed) {
+    // The decoding did not keep up: continue with the new buffers.
+    alSourcePlay(source);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * \brief Decodes the next chunk of the sound into a buffer.
+ *
+ * Mono sounds are converted to stereo like fully decoded sounds.
+ *
+ * \param buffer The buffer to fill.
+ * \return \c false if there is nothing more to decode.
+ */
+bool Sound::Stream::fill_buffer(ALuint buffer) {
+
+  const int num_channels = decoder->get_num_channels();
+  samples.resize(chunk_size * num_channels);
+  const long bytes_read = decoder->decode(samples.data(), chunk_size);
+  if (bytes_read <= 0) {
+    finished = true;
+    return false;
+  }
+
+  const int16_t* data = samples.data();
+  long num_bytes = bytes_read;
+  if (num_channels == 1) {
+    const long num_samples = bytes_read / 2;
+    stereo_samples.resize(num_samples * 2);
+    for (long i = 0; i < num_samples; ++i) {
+      stereo_samples[2 * i] = samples[i];
+      stereo_samples[2 * i + 1] = samples[i];
+    }
+    data = stereo_samples.data();
+    num_bytes = bytes_read * 2;
+  }
+
+  alBufferData(buffer, AL_FORMAT_STEREO16, data, static_cast<ALsizei>(num_bytes), decoder->get_sample_rate());
+  return alGetError() == AL_NO_ERROR;
+}
+}
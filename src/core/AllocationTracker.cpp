@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Counters being filled, updated from any thread.
+ */
+struct AtomicCounters {
+  std::atomic<uint64_t> num_allocations;
+  std::atomic<uint64_t> num_bytes;
+  std::atomic<uint64_t> num_frees;
+};
+
+AtomicCounters current_counters[AllocationTracker::num_scopes];
+AllocationTracker::Counters frame_counters[AllocationTracker::num_scopes];
+AllocationTracker::Counters total_counters[AllocationTracker::num_scopes];
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+thread_local AllocationTracker::Scope current_scope = AllocationTracker::Scope::OTHER;
+#endif
+
+}  // Anonymous namespace.
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+/**
+ * \brief Starts attributing allocations of this thread to a scope.
+ * \param scope The scope.
+ */
+AllocationTracker::ScopeMarker::ScopeMarker(Scope scope):
+  previous_scope(current_scope) {
+
+  current_scope = scope;
+}
+
+/**
+ * \brief Restores the scope of the enclosing marker.
+ */
+AllocationTracker::ScopeMarker::~ScopeMarker() {
+
+  current_scope = previous_scope;
+}
+#endif
+
+/**
+ * \brief Returns whether allocations are counted in this build.
+ * \return \c true if the engine was built with SOLARUS_ALLOCATION_TRACKING.
+ */
+bool AllocationTracker::is_enabled() {
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * \brief Returns the name of a scope.
+ * \param scope A scope.
+ * \return Its name, like "entities_update".
+ */
+const std::string& AllocationTracker::get_scope_name(Scope scope) {
+
+  static const std::string names[num_scopes] = {
+      "other",
+      "step",
+      "entities_update",
+      "entities_draw",
+      "lua_update"
+  };
+  return names[static_cast<int>(scope)];
+}
+
+/**
+ * \brief Ends the current frame.
+ *
+ * Counters of allocations done since the previous call become the ones
+ * of the last frame.
+ */
+void AllocationTracker::finish_frame() {
+
+  for (int i = 0; i < num_scopes; ++i) {
+    Counters& frame = frame_counters[i];
+    frame.num_allocations = current_counters[i].num_allocations.exchange(0);
+    frame.num_bytes = current_counters[i].num_bytes.exchange(0);
+    frame.num_frees = current_counters[i].num_frees.exchange(0);
+
+    Counters& total = total_counters[i];
+    total.num_allocations += frame.num_allocations;
+    total.num_bytes += frame.num_bytes;
+    total.num_frees += frame.num_frees;
+  }
+}
+
+/**
+ * \brief Returns the allocations of the last frame in a scope.
+ * \param scope A scope.
+ * \return The counters of the last finished frame.
+ */
+AllocationTracker::Counters AllocationTracker::get_frame_counters(Scope scope) {
+  return frame_counters[static_cast<int>(scope)];
+}
+
+/**
+ * \brief Returns the allocations of all finished frames in a scope.
+ * \param scope A scope.
+ * \return The counters since the start of the program.
+ */
+AllocationTracker::Counters AllocationTracker::get_total_counters(Scope scope) {
+  return total_counters[static_cast<int>(scope)];
+}
+
+/**
+ * \brief Counts an allocation in the scope of the current thread.
+ * \param size Number of bytes allocated.
+ */
+void AllocationTracker::notify_allocation(size_t size) {
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+  AtomicCounters& counters = current_counters[static_cast<int>(current_scope)];
+  counters.num_allocations.fetch_add(1, std::memory_order_relaxed);
+  counters.num_bytes.fetch_add(size, std::memory_order_relaxed);
+#else
+  (void) size;
+#endif
+}
+
+/**
+ * \brief Counts a deallocation in the scope of the current thread.
+ */
+void AllocationTracker::notify_free() {
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+  current_counters[static_cast<int>(current_scope)].num_frees.fetch_add(
+      1, std::memory_order_relaxed);
+#endif
+}
+
+}
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+
+// Replacements of the global allocation functions.
+// They keep using malloc() and free() so that memory can still cross
+// module boundaries.
+
+void* operator new(std::size_t size) {
+
+  Solarus::AllocationTracker::notify_allocation(size);
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+
+  Solarus::AllocationTracker::notify_allocation(size);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+
+  if (pointer != nullptr) {
+    Solarus::AllocationTracker::notify_free();
+    std::free(pointer);
+  }
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+
+#endif
+
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/BinaryReader.h"
+#include <cstring>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a reader on a buffer.
+ * \param data Content of a binary data file.
+ * It must live as long as the reader.
+ * \param size Size of the content in bytes.
+ */
+BinaryReader::BinaryReader(const char* data, size_t size):
+  data(data),
+  end(data + size),
+  valid(true),
+  strings() {
+
+}
+
+/**
+ * \brief Returns whether everything read so far was correct.
+ * \return \c false if the reader went past the end or met an invalid value.
+ */
+bool BinaryReader::is_valid() const {
+  return valid;
+}
+
+/**
+ * \brief Reads the header of the file.
+ * \param magic The first bytes expected, identifying the type of file.
+ * \param version The version of the format expected.
+ * \param[out] source_hash Hash of the data file the values come from.
+ * \return \c false if the file is not of this type and version.
+ */
+bool BinaryReader::read_header(
+    const std::string& magic,
+    uint32_t version,
+    uint64_t& source_hash
+) {
+  if (static_cast<size_t>(end - data) < magic.size() ||
+      std::memcmp(data, magic.data(), magic.size()) != 0) {
+    valid = false;
+    return false;
+  }
+  data += magic.size();
+  if (read_uint32() != version) {
+    valid = false;
+    return false;
+  }
+  const uint64_t low = read_uint32();
+  const uint64_t high = read_uint32();
+  source_hash = low | (high << 32);
+  return valid;
+}
+
+/**
+ * \brief Reads the string table that follows the header.
+ * \return \c false if the table is invalid.
+ */
+bool BinaryReader::read_string_table() {
+
+  const uint32_t num_strings = read_uint32();
+  if (!valid || num_strings > static_cast<size_t>(end - data) / 4) {
+    valid = false;
+    return false;
+  }
+  strings.reserve(num_strings);
+  for (uint32_t i = 0; i < num_strings; ++i) {
+    const uint32_t size = read_uint32();
+    if (!valid || size > static_cast<size_t>(end - data)) {
+      valid = false;
+      return false;
+    }
+    strings.emplace_back(data, size);
+    data += size;
+  }
+  return true;
+}
+
+/**
+ * \brief Reads an unsigned 8-bit value.
+ * \return The value, or 0 if there is nothing left to read.
+ */
+uint8_t BinaryReader::read_uint8() {
+
+  if (end - data < 1) {
+    valid = false;
+    return 0;
+  }
+  return static_cast<uint8_t>(*data++);
+}
+
+/**
+ * \brief Reads an unsigned 32-bit value.
+ * \return The value, or 0 if there is nothing left to read.
+ */
+uint32_t BinaryReader::read_uint32() {
+
+  if (end - data < 4) {
+    valid = false;
+    data = end;
+    return 0;
+  }
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+  }
+  data += 4;
+  return value;
+}
+
+/**
+ * \brief Reads a signed 32-bit value.
+ * \return The value, or 0 if there is nothing left to read.
+ */
+int BinaryReader::read_int32() {
+  return static_cast<int>(read_uint32());
+}
+
+/**
+ * \brief Reads a string from its index in the string table.
+ * \return The string, or an empty string if the index is invalid.
+ */
+const std::string& BinaryReader::read_string() {
+
+  static const std::string empty_string;
+  const uint32_t index = read_uint32();
+  if (index >= strings.size()) {
+    valid = false;
+    return empty_string;
+  }
+  return strings[index];
+}
+
+/**
+ * \brief Returns whether a number of items of a given size can still be read.
+ *
+ * Call this before reserving or looping on a count read from the file.
+ *
+ * \param count Number of items.
+ * \param item_size Minimum size of an item in bytes.
+ * \return \c false if the rest of the buffer is too small.
+ */
+bool BinaryReader::can_read(uint32_t count, size_t item_size) {
+
+  if (count > static_cast<size_t>(end - data) / item_size) {
+    valid = false;
+  }
+  return valid;
+}
+
+}
+
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/BinaryWriter.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty writer.
+ */
+BinaryWriter::BinaryWriter():
+  body(),
+  string_indexes(),
+  strings() {
+
+}
+
+/**
+ * \brief Writes an unsigned 8-bit value.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_uint8(uint8_t value) {
+  body.push_back(static_cast<char>(value));
+}
+
+/**
+ * \brief Writes an unsigned 32-bit value.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_uint32(uint32_t value) {
+
+  for (int i = 0; i < 4; ++i) {
+    body.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+/**
+ * \brief Writes a signed 32-bit value.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_int32(int value) {
+  write_uint32(static_cast<uint32_t>(value));
+}
+
+/**
+ * \brief Writes a string as its index in the string table.
+ * \param value The string to write.
+ */
+void BinaryWriter::write_string(const std::string& value) {
+
+  const auto it = string_indexes.find(value);
+  if (it != string_indexes.end()) {
+    write_uint32(it->second);
+    return;
+  }
+  const uint32_t index = static_cast<uint32_t>(strings.size());
+  string_indexes.emplace(value, index);
+  strings.push_back(value);
+  write_uint32(index);
+}
+
+/**
+ * \brief Returns the whole file: header, string table then values.
+ *
+ * The writer is empty afterwards.
+ *
+ * \param magic First bytes of the file, identifying its type.
+ * \param version Version of the format of the values.
+ * \param source_hash Hash of the data file the values come from.
+ * \return The content of the binary data file.
+ */
+std::string BinaryWriter::get_file(
+    const std::string& magic,
+    uint32_t version,
+    uint64_t source_hash
+) {
+  std::string values;
+  values.swap(body);
+
+  body.append(magic);
+  write_uint32(version);
+  write_uint32(static_cast<uint32_t>(source_hash & 0xffffffff));
+  write_uint32(static_cast<uint32_t>(source_hash >> 32));
+  write_uint32(static_cast<uint32_t>(strings.size()));
+  for (const std::string& value : strings) {
+    write_uint32(static_cast<uint32_t>(value.size()));
+    body.append(value);
+  }
+  body.append(values);
+
+  string_indexes.clear();
+  strings.clear();
+  std::string file;
+  file.swap(body);
+  return file;
+}
+
+}
+
@@ -23,6 +23,10 @@
 #include "solarus/core/QuestProperties.h"
 #include "solarus/core/StringResources.h"
 #include <lua.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 
 namespace Solarus {
 
@@ -30,18 +34,131 @@ namespace CurrentQuest {
 
 namespace {
 
+/**
+ * \brief Strings and dialogs of a language.
+ */
+struct LanguageData {
+  StringResources strings;                  /**< Content of text/strings.dat. */
+  std::unordered_map<std::string, Dialog>
+      dialogs;                              /**< Content of text/dialogs.dat. */
+};
+
 bool initialized = false;
 
+std::future<void> database_loading;         /**< Parsing of project_db.dat in progress. */
+std::atomic<bool> database_pending(false);  /**< Whether database_loading was not waited yet. */
+std::mutex database_mutex;                  /**< Protects database_loading. */
+
+std::string preloaded_language;             /**< Language being preloaded or an empty string. */
+std::future<std::shared_ptr<LanguageData>>
+    preloaded_language_data;                /**< Result of the language preloading. */
+std::map<std::string, std::shared_ptr<LanguageData>>
+    previous_languages;                     /**< Data of languages set before,
+                                             * to switch back to them without parsing. */
+
+/**
+ * \brief Returns the strings and dialogs of the current language.
+ * \return The current language data. Switching languages replaces it.
+ */
+std::shared_ptr<LanguageData>& get_language_data() {
+
+  // The language data must be in a function to avoid static initialization
+  // order problems.
+  static std::shared_ptr<LanguageData> data = std::make_shared<LanguageData>();
+  return data;
+}
+
+/**
+ * \brief Returns the quest database without waiting for it to be parsed.
+ * \return The database object.
+ */
+QuestDatabase& get_database_object() {
+
+  // The database object must be in a function to avoid static initialization
+  // order problems.
+  static QuestDatabase database;
+  return database;
+}
+
+/**
+ * \brief Waits for the end of the parsing of project_db.dat if needed.
+ *
+ * Parsing errors are reported here.
+ */
+void wait_for_database() {
+
+  if (!database_pending) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(database_mutex);
+  if (database_loading.valid()) {
+    database_pending = false;
+    database_loading.get();
+  }
+}
+
+/**
+ * \brief Parses the strings and dialogs of a language.
+ *
+ * This function can run on a separate thread: it only reads quest files.
+ *
+ * \param language_code Code of the language.
+ * \return The parsed data.
+ */
+std::shared_ptr<LanguageData> load_language_data(const std::string& language_code) {
+
+  std::shared_ptr<LanguageData> data = std::make_shared<LanguageData>();
+  const std::string& directory = std::string("languages/") + language_code + "/";
+
+  // The two files are independent: parse them at the same time.
+  std::future<void> strings_loading = std::async(std::launch::async, [&]() {
+    data->strings.import_from_quest_file(directory + "text/strings.dat");
+  });
+
+  DialogResources resources;
+  if (resources.import_from_quest_file(directory + "text/dialogs.dat")) {
+    data->dialogs.reserve(resources.get_dialogs().size());
+    for (const auto& kvp : resources.get_dialogs()) {
+
+      const std::string& id = kvp.first;
+      const DialogData& dialog_data = kvp.second;
+
+      Dialog dialog;
+      dialog.set_id(id);
+      dialog.set_text(dialog_data.get_text());
+
+      for (const auto& pkvp : dialog_data.get_properties()) {
+        dialog.set_property(pkvp.first, pkvp.second);
+      }
+
+      data->dialogs.emplace(id, std::move(dialog));
+    }
+  }
+
+  strings_loading.get();
+  return data;
+}
+
 }
 
 /**
  * \brief Reads the resource list, the quest properties and stores them.
+ *
+ * The resource list is parsed on a separate thread: functions that need it
+ * wait for the end of the parsing.
  */
 void initialize() {
 
-  // Read the quest database file.
-  QuestDatabase& database = get_database();
-  database .import_from_quest_file("project_db.dat");
+  // Start reading the quest database file.
+  wait_for_database();
+  {
+    std::lock_guard<std::mutex> lock(database_mutex);
+    database_loading = std::async(std::launch::async, []() {
+      get_database_object().import_from_quest_file("project_db.dat");
+    });
+    database_pending = true;
+  }
 
   // Read the quest properties file.
   QuestProperties& properties = get_properties();
@@ -82,6 +199,9 @@ void initialize() {
  */
 void quit() {
 
+  preloaded_language_data = std::future<std::shared_ptr<LanguageData>>();
+  preloaded_language.clear();
+  previous_languages.clear();
   get_database().clear();
   get_strings().clear();
   get_dialogs().clear();
@@ -116,10 +236,8 @@ QuestProperties& get_properties() {
  */
 QuestDatabase& get_database() {
 
-  // The database object must be in a function to avoid static initialization
-  // order problems.
-  static QuestDatabase database;
-  return database;
+  wait_for_database();
+  return get_database_object();
 }
 
 /**
@@ -134,6 +252,18 @@ bool resource_exists(ResourceType resource_type, const std::string& id) {
   return get_database().resource_exists(resource_type, id);
 }
 
+/**
+ * \brief Returns the numeric id of an element.
+ * \param resource_type A type of resource.
+ * \param id The id to look for.
+ * \return The numeric id of this element, or QuestDatabase::invalid_resource_id
+ * if there is no element with this id in this resource type.
+ */
+QuestDatabase::ResourceId get_resource_id(ResourceType resource_type, const std::string& id) {
+
+  return get_database().get_resource_id(resource_type, id);
+}
+
 /**
  * \brief Returns the list of element ids and descriptions of the specified resource type.
  * \param resource_type A type of resource.
@@ -162,46 +292,72 @@ bool has_language(const std::string& language_code) {
  * The language-specific data will be loaded from the directory of this language.
  * This function must be called before the first language-specific file is loaded.
  *
+ * The strings and dialogs of the previous language are kept, so that
+ * switching back to it later is immediate.
+ * Setting the current language again parses its files again.
+ *
  * \param language_code Code of the language to set.
  */
 void set_language(const std::string& language_code) {
 
-  Debug::check_assertion(has_language(language_code),
-      std::string("No such language: '") + language_code + "'");
-
-  get_language() = language_code;
-
-  // Read the quest string list file.
-  get_strings().clear();
-  get_strings().import_from_quest_file("text/strings.dat", true);
-
-  // Read the quest dialog list file.
-  DialogResources resources;
-  std::map<std::string, Dialog>& dialogs = get_dialogs();
+  Debug::check_assertion_lazy(has_language(language_code), [&] {
+    return std::string("No such language: '") + language_code + "'";
+  });
 
-  bool success = resources.import_from_quest_file("text/dialogs.dat", true);
+  const std::string previous_language = get_language();
+  std::shared_ptr<LanguageData> data;
+  const auto& it = previous_languages.find(language_code);
+  if (preloaded_language == language_code && preloaded_language_data.valid()) {
+    data = preloaded_language_data.get();
+  }
+  else if (it != previous_languages.end() && language_code != previous_language) {
+    data = it->second;
+  }
+  else {
+    data = load_language_data(language_code);
+  }
+  preloaded_language_data = std::future<std::shared_ptr<LanguageData>>();
+  preloaded_language.clear();
+  previous_languages.erase(language_code);
 
-  // Create dialogs.
-  dialogs.clear();
-  if (success) {
-    for (const auto& kvp : resources.get_dialogs()) {
+  std::shared_ptr<LanguageData>& current_data = get_language_data();
+  if (!previous_language.empty() && previous_language != language_code) {
+    previous_languages[previous_language] = current_data;
+  }
 
-      const std::string& id = kvp.first;
-      const DialogData& data = kvp.second;
+  get_language() = language_code;
+  current_data = data;
 
-      Dialog dialog;
-      dialog.set_id(id);
-      dialog.set_text(data.get_text());
+  Logger::info(std::string("Language: ") + language_code);
+}
 
-      for (const auto& pkvp : data.get_properties()) {
-        dialog.set_property(pkvp.first, pkvp.second);
-      }
+/**
+ * \brief Starts parsing the data of a language on a separate thread.
+ *
+ * Call this function when the language that will be set soon is known,
+ * so that set_language() does not need to parse it.
+ * Does nothing if the language does not exist.
+ *
+ * \param language_code Code of the language to preload.
+ */
+void preload_language(const std::string& language_code) {
 
-      dialogs.emplace(id, dialog);
-    }
+  if (!has_language(language_code) || preloaded_language == language_code) {
+    return;
   }
 
-  Logger::info(std::string("Language: ") + language_code);
+  preloaded_language = language_code;
+  preloaded_language_data = std::async(std::launch::async, &load_language_data, language_code);
+}
+
+/**
+ * \brief Drops the strings and dialogs kept from languages set before.
+ *
+ * Call this function when their files change, so that they are parsed again
+ * the next time they are set.
+ */
+void forget_previous_languages() {
+  previous_languages.clear();
 }
 
 /**
@@ -242,11 +398,7 @@ std::string get_language_name(const std::string& language_code) {
  * \return The current quest string list.
  */
 StringResources& get_strings() {
-
-  // The string resources object must be in a function to avoid static
-  // initialization order problems.
-  static StringResources strings;
-  return strings;
+  return get_language_data()->strings;
 }
 
 /**
@@ -275,12 +427,8 @@ const std::string& get_string(const std::string& key) {
  * \brief Returns the dialog list of the current quest.
  * \return The current quest dialog list.
  */
-std::map<std::string, Dialog>& get_dialogs() {
-
-  // The dialog objects must be in a function to avoid static initialization
-  // order problems.
-  static std::map<std::string, Dialog> dialogs;
-  return dialogs;
+std::unordered_map<std::string, Dialog>& get_dialogs() {
+  return get_language_data()->dialogs;
 }
 
 /**
@@ -302,9 +450,12 @@ bool dialog_exists(const std::string& dialog_id) {
  */
 const Dialog& get_dialog(const std::string& dialog_id) {
 
-  Debug::check_assertion(dialog_exists(dialog_id), std::string(
-    "No such dialog: '") + dialog_id + "'");
-  return get_dialogs()[dialog_id];
+  const auto& dialogs = get_dialogs();
+  const auto& it = dialogs.find(dialog_id);
+  Debug::check_assertion_lazy(it != dialogs.end(), [&] {
+    return std::string( "No such dialog: '") + dialog_id + "'";
+  });
+  return it->second;
 }
 
 /**
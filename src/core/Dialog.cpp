@@ -98,8 +98,9 @@ const std::string& Dialog::get_property(const std::string& key) const {
 
   const auto it = properties.find(key);
 
-  Debug::check_assertion(it != properties.end(),
-      std::string("No such dialog property: '") + key + "'");
+  Debug::check_assertion_lazy(it != properties.end(), [&] {
+    return std::string("No such dialog property: '") + key + "'";
+  });
 
   return it->second;
 }
@@ -26,6 +26,7 @@
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -89,13 +90,13 @@ const std::string& DialogBoxSystem::get_dialog_id() const {
 void DialogBoxSystem::open(
     const std::string& dialog_id,
     const ScopedLuaRef& info_ref,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   Debug::check_assertion(!is_enabled(), "A dialog is already active");
 
   this->dialog_id = dialog_id;
   this->dialog = CurrentQuest::get_dialog(dialog_id);
-  this->callback_ref = callback_ref;
+  this->callback_ref = std::move(callback_ref);
 
   // Save commands.
   CommandsEffects& keys_effect = game.get_commands_effects();
@@ -175,8 +176,7 @@ void DialogBoxSystem::close(const ScopedLuaRef& status_ref) {
 
   Debug::check_assertion(is_enabled(), "No dialog is active");
 
-  ScopedLuaRef callback_ref = this->callback_ref;
-  this->callback_ref.clear();
+  ScopedLuaRef callback_ref = std::move(this->callback_ref);
   this->dialog_id = "";
 
   // Restore commands.
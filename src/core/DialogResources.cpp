@@ -15,10 +15,13 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/DialogResources.h"
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -72,8 +75,9 @@ bool DialogData::has_property(const std::string& key) const {
  */
 const std::string& DialogData::get_property(const std::string& key) const {
 
-  Debug::check_assertion(has_property(key),
-    std::string("No such property: '") + key + "'");
+  Debug::check_assertion_lazy(has_property(key), [&] {
+    return std::string("No such property: '") + key + "'";
+  });
   return properties.at(key);
 }
 
@@ -138,8 +142,9 @@ const DialogData& DialogResources::get_dialog(
     const std::string& dialog_id) const {
 
   const auto& it = dialogs.find(dialog_id);
-  Debug::check_assertion(it != dialogs.end(),
-    std::string("No such dialog: '") + dialog_id + "'");
+  Debug::check_assertion_lazy(it != dialogs.end(), [&] {
+    return std::string("No such dialog: '") + dialog_id + "'";
+  });
 
   return it->second;
 }
@@ -156,8 +161,9 @@ DialogData& DialogResources::get_dialog(
     const std::string& dialog_id) {
 
   const auto& it = dialogs.find(dialog_id);
-  Debug::check_assertion(it != dialogs.end(),
-    std::string("No such dialog: '") + dialog_id + "'");
+  Debug::check_assertion_lazy(it != dialogs.end(), [&] {
+    return std::string("No such dialog: '") + dialog_id + "'";
+  });
 
   return it->second;
 }
@@ -320,4 +326,65 @@ bool DialogResources::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::get_binary_magic
+ */
+std::string DialogResources::get_binary_magic() const {
+  return { 'S', 'O', 'L', 'D', 'L', 'G', '\r', '\n' };
+}
+
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool DialogResources::import_from_binary(BinaryReader& reader) {
+
+  DialogResources resources;
+  const uint32_t num_dialogs = reader.read_uint32();
+  if (!reader.can_read(num_dialogs, 12)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_dialogs; ++i) {
+    const std::string& dialog_id = reader.read_string();
+    DialogData dialog;
+    dialog.set_text(reader.read_string());
+    const uint32_t num_properties = reader.read_uint32();
+    if (!reader.can_read(num_properties, 8)) {
+      return false;
+    }
+    for (uint32_t j = 0; j < num_properties; ++j) {
+      const std::string& key = reader.read_string();
+      dialog.set_property(key, reader.read_string());
+    }
+    if (dialog_id.empty() || !resources.add_dialog(dialog_id, dialog)) {
+      return false;
+    }
+  }
+
+  if (!reader.is_valid()) {
+    return false;
+  }
+
+  *this = std::move(resources);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool DialogResources::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_uint32(static_cast<uint32_t>(dialogs.size()));
+  for (const auto& kvp : dialogs) {
+    const DialogData& dialog = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(dialog.get_text());
+    writer.write_uint32(static_cast<uint32_t>(dialog.get_properties().size()));
+    for (const auto& pkvp : dialog.get_properties()) {
+      writer.write_string(pkvp.first);
+      writer.write_string(pkvp.second);
+    }
+  }
+  return true;
+}
+
 }
@@ -25,6 +25,7 @@
 #include "solarus/core/Savegame.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Hero.h"
+#include "solarus/lua/LuaContext.h"
 #include <algorithm>
 #include <sstream>
 
@@ -36,7 +37,10 @@ namespace Solarus {
  */
 Equipment::Equipment(Savegame& savegame):
   savegame(savegame),
-  suspended(true) {
+  suspended(true),
+  items(),
+  items_to_update(),
+  items_to_update_dirty(true) {
 
 }
 
@@ -109,9 +113,30 @@ void Equipment::update() {
   }
 
   // Update item scripts.
-  for (const auto& kvp: items) {
-    EquipmentItem& item = *kvp.second;
-    item.update();
+  // Usually, only a few items define on_update(): don't visit the others.
+  LuaContext& lua_context = game->get_lua_context();
+  if (lua_context.item_metatable_has_on_update()) {
+    // Every item has it.
+    for (const auto& kvp: items) {
+      EquipmentItem& item = *kvp.second;
+      item.update();
+    }
+    return;
+  }
+
+  if (items_to_update_dirty) {
+    items_to_update.clear();
+    for (const auto& kvp: items) {
+      if (lua_context.item_table_has_on_update(*kvp.second)) {
+        items_to_update.push_back(kvp.second.get());
+      }
+    }
+    items_to_update_dirty = false;
+  }
+
+  // Callbacks defining or removing on_update() take effect at the next cycle.
+  for (size_t i = 0; i < items_to_update.size(); ++i) {
+    items_to_update[i]->update();
   }
 }
 
@@ -380,6 +405,14 @@ void Equipment::restore_all_magic() {
   set_magic(get_max_magic());
 }
 
+/**
+ * \brief Notifies the equipment that an item started or stopped defining
+ * frequent callbacks like on_update().
+ */
+void Equipment::notify_item_events_changed() {
+  items_to_update_dirty = true;
+}
+
 /**
  * \brief Runs the Lua script of each equipment item.
  */
@@ -425,8 +458,9 @@ bool Equipment::item_exists(const std::string& item_name) const {
  */
 EquipmentItem& Equipment::get_item(const std::string& item_name) {
 
-  Debug::check_assertion(item_exists(item_name),
-      std::string("No such item: '") + item_name + "'");
+  Debug::check_assertion_lazy(item_exists(item_name), [&] {
+    return std::string("No such item: '") + item_name + "'";
+  });
 
   return *items.find(item_name)->second;
 }
@@ -438,8 +472,9 @@ EquipmentItem& Equipment::get_item(const std::string& item_name) {
  */
 const EquipmentItem& Equipment::get_item(const std::string& item_name) const {
 
-  Debug::check_assertion(item_exists(item_name),
-      std::string("No such item: '") + item_name + "'");
+  Debug::check_assertion_lazy(item_exists(item_name), [&] {
+    return std::string("No such item: '") + item_name + "'";
+  });
 
   return *items.find(item_name)->second;
 }
@@ -506,12 +541,13 @@ void Equipment::set_item_assigned(int slot, EquipmentItem* item) {
   oss << "_item_slot_" << slot;
 
   if (item != nullptr) {
-    Debug::check_assertion(item->get_variant() > 0,
-        std::string("Cannot assign item '") + item->get_name()
-        + "' because the player does not have it");
-    Debug::check_assertion(item->is_assignable(),
-        std::string("The item '") + item->get_name()
-        + "' cannot be assigned");
+    Debug::check_assertion_lazy(item->get_variant() > 0, [&] {
+      return std::string("Cannot assign item '") + item->get_name()
+          + "' because the player does not have it";
+    });
+    Debug::check_assertion_lazy(item->is_assignable(), [&] {
+      return std::string("The item '") + item->get_name() + "' cannot be assigned";
+    });
     savegame.set_string(oss.str(), item->get_name());
   }
   else {
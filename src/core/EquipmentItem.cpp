@@ -33,6 +33,9 @@ EquipmentItem::EquipmentItem(Equipment& equipment):
   equipment(equipment),
   name(""),
   savegame_variable(""),
+  savegame_key(),
+  amount_savegame_variable(""),
+  amount_savegame_key(),
   max_amount(1000),
   obtainable(true),
   assignable(false),
@@ -124,7 +127,10 @@ const std::string& EquipmentItem::get_savegame_variable() const {
  * possession state, or an empty string.
  */
 void EquipmentItem::set_savegame_variable(const std::string& savegame_variable) {
+
   this->savegame_variable = savegame_variable;
+  savegame_key = savegame_variable.empty() ?
+      Savegame::Key() : Savegame::get_key(savegame_variable);
 }
 
 /**
@@ -153,7 +159,10 @@ const std::string& EquipmentItem::get_amount_savegame_variable() const {
  */
 void EquipmentItem::set_amount_savegame_variable(
     const std::string& amount_savegame_variable) {
+
   this->amount_savegame_variable = amount_savegame_variable;
+  amount_savegame_key = amount_savegame_variable.empty() ?
+      Savegame::Key() : Savegame::get_key(amount_savegame_variable);
 }
 
 /**
@@ -388,10 +397,11 @@ void EquipmentItem::notify_pickable_appeared(Pickable& pickable) {
  */
 int EquipmentItem::get_variant() const {
 
-  Debug::check_assertion(is_saved(),
-      std::string("The item '") + get_name() + "' is not saved");
+  Debug::check_assertion_lazy(is_saved(), [&] {
+    return std::string("The item '") + get_name() + "' is not saved";
+  });
 
-  return get_savegame().get_integer(get_savegame_variable());
+  return get_savegame().get_integer(savegame_key);
 }
 
 /**
@@ -403,11 +413,12 @@ int EquipmentItem::get_variant() const {
  */
 void EquipmentItem::set_variant(int variant) {
 
-  Debug::check_assertion(is_saved(),
-      std::string("The item '") + get_name() + "' is not saved");
+  Debug::check_assertion_lazy(is_saved(), [&] {
+    return std::string("The item '") + get_name() + "' is not saved";
+  });
 
   // Set the possession state in the savegame.
-  get_savegame().set_integer(get_savegame_variable(), variant);
+  get_savegame().set_integer(savegame_key, variant);
 
   // If we are removing the item, unassign it.
   if (variant == 0) {
@@ -427,10 +438,11 @@ void EquipmentItem::set_variant(int variant) {
  */
 int EquipmentItem::get_amount() const {
 
-  Debug::check_assertion(has_amount(),
-      std::string("The item '") + get_name() + "' has no amount");
+  Debug::check_assertion_lazy(has_amount(), [&] {
+    return std::string("The item '") + get_name() + "' has no amount";
+  });
 
-  return get_savegame().get_integer(get_amount_savegame_variable());
+  return get_savegame().get_integer(amount_savegame_key);
 }
 
 /**
@@ -439,11 +451,12 @@ int EquipmentItem::get_amount() const {
  */
 void EquipmentItem::set_amount(int amount) {
 
-  Debug::check_assertion(has_amount(),
-      std::string("The item '") + get_name() + "' has no amount");
+  Debug::check_assertion_lazy(has_amount(), [&] {
+    return std::string("The item '") + get_name() + "' has no amount";
+  });
 
   amount = std::max(0, std::min(get_max_amount(), amount));
-  get_savegame().set_integer(get_amount_savegame_variable(), amount);
+  get_savegame().set_integer(amount_savegame_key, amount);
 
   notify_amount_changed(amount);
 }
@@ -454,8 +467,9 @@ void EquipmentItem::set_amount(int amount) {
  */
 int EquipmentItem::get_max_amount() const {
 
-  Debug::check_assertion(has_amount(),
-      std::string("The item '") + get_name() + "' has no amount");
+  Debug::check_assertion_lazy(has_amount(), [&] {
+    return std::string("The item '") + get_name() + "' has no amount";
+  });
 
   return max_amount;
 }
@@ -466,8 +480,9 @@ int EquipmentItem::get_max_amount() const {
  */
 void EquipmentItem::set_max_amount(int max_amount) {
 
-  Debug::check_assertion(has_amount(),
-      std::string("The item '") + get_name() + "' has no amount");
+  Debug::check_assertion_lazy(has_amount(), [&] {
+    return std::string("The item '") + get_name() + "' has no amount";
+  });
 
   this->max_amount = max_amount;
 
@@ -486,5 +501,13 @@ const std::string& EquipmentItem::get_lua_type_name() const {
   return LuaContext::item_module_name;
 }
 
+/**
+ * \brief Tells the equipment that this item may have started or stopped
+ * defining on_update().
+ */
+void EquipmentItem::notify_lua_event_mask_changed() {
+  equipment.notify_item_events_changed();
+}
+
 }
 
@@ -47,9 +47,9 @@ EquipmentItem& EquipmentItemUsage::get_item() {
  */
 void EquipmentItemUsage::start() {
 
-  Debug::check_assertion(variant > 0,
-      std::string("Attempt to use equipment item '") + item.get_name()
-      + "' without having it");
+  Debug::check_assertion_lazy(variant > 0, [&] {
+    return std::string("Attempt to use equipment item '") + item.get_name() + "' without having it";
+  });
 
   this->finished = false;
   item.notify_using();
@@ -17,6 +17,7 @@
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/FontResource.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/graphics/Surface.h"
 #include <utility>
@@ -25,6 +26,7 @@ namespace Solarus {
 
 bool FontResource::fonts_loaded = false;
 std::map<std::string, FontResource::FontFile> FontResource::fonts;
+std::future<std::map<std::string, FontResource::FontFile>> FontResource::fonts_loading;
 
 /**
  * \brief Initializes the font system.
@@ -39,15 +41,38 @@ void FontResource::initialize() {
  */
 void FontResource::quit() {
 
+  fonts_loading = std::future<std::map<std::string, FontFile>>();
   fonts.clear();
   fonts_loaded = false;
   TTF_Quit();
 }
 
 /**
- * \brief Loads the fonts declared in the quest resource list.
+ * \brief Starts reading the font files on a separate thread.
+ *
+ * Fonts are then ready when they are first used.
  */
-void FontResource::load_fonts() {
+void FontResource::preload_fonts() {
+
+  if (fonts_loaded || fonts_loading.valid()) {
+    return;
+  }
+
+  fonts_loading = std::async(std::launch::async, &FontResource::read_font_files);
+}
+
+/**
+ * \brief Finds the files of the fonts declared in the quest resource list.
+ *
+ * Outline font files are read into memory.
+ * This function can run on a separate thread: bitmap fonts are only created
+ * by load_fonts().
+ *
+ * \return The font files found, indexed by font id.
+ */
+std::map<std::string, FontResource::FontFile> FontResource::read_font_files() {
+
+  std::map<std::string, FontFile> font_files;
 
   // Get the list of available fonts.
   const std::map<std::string, std::string>& font_resource =
@@ -96,18 +121,38 @@ void FontResource::load_fonts() {
       continue;
     }
 
-    if (bitmap_font) {
-      // It's a bitmap font.
-      font.bitmap_font = Surface::create(font.file_name, Surface::DIR_DATA);
-    }
-
-    else {
+    font.is_bitmap = bitmap_font;
+    if (!bitmap_font) {
       // It's an outline font.
       font.buffer = QuestFiles::data_file_read(font.file_name);
-      font.bitmap_font = nullptr;
     }
+    font.bitmap_font = nullptr;
 
-    fonts.emplace(font_id, std::move(font));
+    font_files.emplace(font_id, std::move(font));
+  }
+
+  return font_files;
+}
+
+/**
+ * \brief Loads the fonts declared in the quest resource list.
+ */
+void FontResource::load_fonts() {
+
+  if (fonts_loading.valid()) {
+    fonts = fonts_loading.get();
+  }
+  else {
+    fonts = read_font_files();
+  }
+
+  for (auto& kvp: fonts) {
+    FontFile& font = kvp.second;
+    if (font.is_bitmap) {
+      // It's a bitmap font.
+      MemoryStats::TextureOrigin origin(MemoryStats::Category::TEXT_TEXTURES);
+      font.bitmap_font = Surface::create(font.file_name, Surface::DIR_DATA);
+    }
   }
 
   fonts_loaded = true;
@@ -158,7 +203,9 @@ bool FontResource::is_bitmap_font(const std::string& font_id) {
   }
 
   const auto& kvp = fonts.find(font_id);
-  Debug::check_assertion(kvp != fonts.end(), std::string("No such font: '") + font_id + "'");
+  Debug::check_assertion_lazy(kvp != fonts.end(), [&] {
+    return std::string("No such font: '") + font_id + "'";
+  });
   return kvp->second.bitmap_font != nullptr;
 }
 
@@ -174,8 +221,12 @@ SurfacePtr FontResource::get_bitmap_font(const std::string& font_id) {
   }
 
   const auto& kvp = fonts.find(font_id);
-  Debug::check_assertion(kvp != fonts.end(), std::string("No such font: '") + font_id + "'");
-  Debug::check_assertion(kvp->second.bitmap_font != nullptr, std::string("This is not a bitmap font: '") + font_id + "'");
+  Debug::check_assertion_lazy(kvp != fonts.end(), [&] {
+    return std::string("No such font: '") + font_id + "'";
+  });
+  Debug::check_assertion_lazy(kvp->second.bitmap_font != nullptr, [&] {
+    return std::string("This is not a bitmap font: '") + font_id + "'";
+  });
   return kvp->second.bitmap_font;
 }
 
@@ -192,9 +243,13 @@ TTF_Font& FontResource::get_outline_font(const std::string& font_id, int size) {
   }
 
   const auto& kvp = fonts.find(font_id);
-  Debug::check_assertion(kvp != fonts.end(), std::string("No such font: '") + font_id + "'");
+  Debug::check_assertion_lazy(kvp != fonts.end(), [&] {
+    return std::string("No such font: '") + font_id + "'";
+  });
   FontFile& font = kvp->second;
-  Debug::check_assertion(font.bitmap_font == nullptr, std::string("This is not an outline font: '") + font_id + "'");
+  Debug::check_assertion_lazy(font.bitmap_font == nullptr, [&] {
+    return std::string("This is not an outline font: '") + font_id + "'";
+  });
 
   std::map<int, OutlineFontReader>& outline_fonts = kvp->second.outline_fonts;
 
@@ -209,14 +264,49 @@ TTF_Font& FontResource::get_outline_font(const std::string& font_id, int size) {
       (int) font.buffer.size()
   ));
   TTF_Font_UniquePtr outline_font(TTF_OpenFontRW(rw.get(), 0, size));
-  Debug::check_assertion(outline_font != nullptr,
-      std::string("Cannot load font from file '") + font.file_name
-      + "': " + TTF_GetError()
-  );
-  OutlineFontReader reader = { std::move(rw), std::move(outline_font) };
+  Debug::check_assertion_lazy(outline_font != nullptr, [&] {
+    return std::string("Cannot load font from file '") + font.file_name + "': " + TTF_GetError();
+  });
+  OutlineFontReader reader = { std::move(rw), std::move(outline_font), {} };
   outline_fonts.emplace(size, std::move(reader));
   return *outline_fonts.at(size).outline_font;
 }
 
+/**
+ * \brief Returns the atlas of glyphs of an outline font.
+ *
+ * The atlas is created the first time and kept with the font.
+ *
+ * \param font_id Id of the outline font to get. It must exist.
+ * \param size Size to use.
+ * \param antialiasing \c true for smooth glyphs, \c false for solid ones.
+ * \param color Color of the glyphs.
+ * \return The glyph atlas.
+ */
+GlyphAtlas& FontResource::get_glyph_atlas(
+    const std::string& font_id,
+    int size,
+    bool antialiasing,
+    const Color& color
+) {
+  TTF_Font& outline_font = get_outline_font(font_id, size);
+  OutlineFontReader& reader = fonts.at(font_id).outline_fonts.at(size);
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  const uint64_t key =
+      (static_cast<uint64_t>(antialiasing) << 32) |
+      (static_cast<uint64_t>(r) << 24) |
+      (static_cast<uint64_t>(g) << 16) |
+      (static_cast<uint64_t>(b) << 8) |
+      static_cast<uint64_t>(a);
+
+  std::unique_ptr<GlyphAtlas>& glyph_atlas = reader.glyph_atlases[key];
+  if (glyph_atlas == nullptr) {
+    glyph_atlas = std::unique_ptr<GlyphAtlas>(
+        new GlyphAtlas(outline_font, antialiasing, color));
+  }
+  return *glyph_atlas;
 }
 
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/FrameTimings.h"
+#include <chrono>
+#include <fstream>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty frame timing recorder.
+ * \param capacity Maximum number of frames to keep.
+ */
+FrameTimings::FrameTimings(size_t capacity):
+  frames(capacity),
+  first(0),
+  num_frames(0),
+  current(),
+  current_start_time(0.0) {
+
+  Debug::check_assertion(capacity > 0, "Invalid frame timings capacity");
+}
+
+/**
+ * \brief Returns the maximum number of frames kept.
+ * \return The capacity of the ring buffer.
+ */
+size_t FrameTimings::get_capacity() const {
+  return frames.size();
+}
+
+/**
+ * \brief Returns the number of frames currently recorded.
+ * \return The number of frames, at most get_capacity().
+ */
+size_t FrameTimings::get_num_frames() const {
+  return num_frames;
+}
+
+/**
+ * \brief Returns a recorded frame.
+ * \param index Index of the frame, 0 being the oldest one.
+ * \return The measures of this frame.
+ */
+const FrameTimings::Frame& FrameTimings::get_frame(size_t index) const {
+
+  Debug::check_assertion(index < num_frames, "Wrong frame index");
+  return frames[(first + index) % frames.size()];
+}
+
+/**
+ * \brief Forgets all recorded frames.
+ */
+void FrameTimings::clear() {
+
+  first = 0;
+  num_frames = 0;
+}
+
+/**
+ * \brief Starts measuring a new frame.
+ * \param date Real time when the frame starts, in milliseconds.
+ */
+void FrameTimings::start_frame(uint32_t date) {
+
+  current = Frame();
+  current.date = date;
+  current_start_time = get_time();
+}
+
+/**
+ * \brief Adds the duration of a phase to the current frame.
+ *
+ * A phase may be measured several times per frame, for example when several
+ * simulation steps are done to catch up.
+ *
+ * \param phase The phase that was measured.
+ * \param start_time Value of get_time() when the phase started.
+ */
+void FrameTimings::add_phase_time(Phase phase, double start_time) {
+
+  const double duration = get_time() - start_time;
+  switch (phase) {
+
+  case Phase::INPUT:
+    current.input_time += duration;
+    break;
+
+  case Phase::GAME:
+    current.game_time += duration;
+    break;
+
+  case Phase::LUA:
+    current.lua_time += duration;
+    break;
+
+  case Phase::SYSTEM:
+    current.system_time += duration;
+    break;
+
+  case Phase::DRAW:
+    current.draw_time += duration;
+    break;
+
+  case Phase::GC:
+    current.gc_time += duration;
+    break;
+  }
+}
+
+/**
+ * \brief Counts one more simulation step in the current frame.
+ */
+void FrameTimings::add_update() {
+  ++current.num_updates;
+}
+
+/**
+ * \brief Records that some lag was given up during the current frame.
+ * \param time_dropped Time given up in milliseconds.
+ */
+void FrameTimings::add_time_dropped(uint32_t time_dropped) {
+  current.time_dropped += time_dropped;
+}
+
+/**
+ * \brief Records pixel transfers from the GPU done during the current frame.
+ * \param num_readbacks Number of readbacks.
+ * \param num_full_readbacks How many of them transferred a whole surface.
+ */
+void FrameTimings::add_readbacks(int num_readbacks, int num_full_readbacks) {
+  current.num_readbacks += num_readbacks;
+  current.num_full_readbacks += num_full_readbacks;
+}
+
+/**
+ * \brief Records draw calls done during the current frame.
+ * \param num_draw_calls Number of draw calls.
+ */
+void FrameTimings::add_draw_calls(int num_draw_calls) {
+  current.num_draw_calls += num_draw_calls;
+}
+
+/**
+ * \brief Stores the current frame in the ring buffer.
+ *
+ * If the buffer is full, the oldest frame is overwritten.
+ */
+void FrameTimings::finish_frame() {
+
+  current.total_time = get_time() - current_start_time;
+
+  if (num_frames < frames.size()) {
+    frames[(first + num_frames) % frames.size()] = current;
+    ++num_frames;
+  }
+  else {
+    frames[first] = current;
+    first = (first + 1) % frames.size();
+  }
+}
+
+/**
+ * \brief Writes the recorded frames to a CSV file.
+ *
+ * The file name is a regular path of the filesystem,
+ * not a path in the quest write directory.
+ *
+ * \param file_name The file to write.
+ * \return \c true in case of success.
+ */
+bool FrameTimings::save_csv(const std::string& file_name) const {
+
+  std::ofstream out(file_name.c_str());
+  if (!out) {
+    return false;
+  }
+
+  out << "date,num_updates,time_dropped,input,game,lua,system,draw,gc,total,readbacks,full_readbacks,draw_calls\n";
+  for (size_t i = 0; i < num_frames; ++i) {
+    const Frame& frame = get_frame(i);
+    out << frame.date << ","
+        << frame.num_updates << ","
+        << frame.time_dropped << ","
+        << frame.input_time << ","
+        << frame.game_time << ","
+        << frame.lua_time << ","
+        << frame.system_time << ","
+        << frame.draw_time << ","
+        << frame.gc_time << ","
+        << frame.total_time << ","
+        << frame.num_readbacks << ","
+        << frame.num_full_readbacks << ","
+        << frame.num_draw_calls << "\n";
+  }
+
+  return static_cast<bool>(out);
+}
+
+/**
+ * \brief Returns a high-resolution real time.
+ *
+ * Only differences between two values are meaningful.
+ *
+ * \return The current time in milliseconds.
+ */
+double FrameTimings::get_time() {
+
+  using Clock = std::chrono::steady_clock;
+  const Clock::duration now = Clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::milli>(now).count();
+}
+
+}
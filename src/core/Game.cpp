@@ -22,7 +22,9 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
+#include "solarus/core/Trace.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Entities.h"
@@ -30,6 +32,7 @@
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/StartingLocationMode.h"
+#include "solarus/entities/Teletransporter.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Color.h"
@@ -37,7 +40,10 @@
 #include "solarus/graphics/TransitionFade.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
@@ -352,6 +358,8 @@ void Game::notify_command_released(GameCommand command) {
  */
 void Game::update() {
 
+  SOLARUS_TRACE_SCOPE("Game::update");
+
   // Update the transitions between maps.
   update_transitions();
 
@@ -362,6 +370,9 @@ void Game::update() {
   // Update the map.
   current_map->update();
 
+  // Notify watchers of savegame values changed during this cycle.
+  savegame->notify_value_watchers();
+
   // Call game:on_update() in Lua.
   get_lua_context().game_on_update(*this);
 
@@ -418,6 +429,7 @@ void Game::update_transitions() {
     }
     else if (transition_direction == Transition::Direction::CLOSING) {
 
+      load_next_map();
       bool world_changed = next_map != current_map &&
           (!next_map->has_world() || next_map->get_world() != current_map->get_world());
 
@@ -474,11 +486,18 @@ void Game::update_transitions() {
       // before closing the map, draw it on a backup surface for transition effects
       // that want to display both maps at the same time
       if (needs_previous_surface && current_map->get_camera() != nullptr) {
-        previous_map_surface = Surface::create(
-            current_map->get_camera()->get_size()
-        );
         current_map->draw();
-        current_map->get_camera_surface()->draw(previous_map_surface);
+        if (next_map == current_map) {
+          // The camera keeps drawing on its surface: make a copy.
+          previous_map_surface = Surface::create(
+              current_map->get_camera()->get_size()
+          );
+          current_map->get_camera_surface()->draw(previous_map_surface);
+        }
+        else {
+          // The camera is destroyed with the map: keep its texture as is.
+          previous_map_surface = current_map->get_camera_surface();
+        }
       }
 
       if (next_map == current_map) {
@@ -573,10 +592,10 @@ void Game::draw(const SurfacePtr& dst_surface) {
   if (current_map->is_loaded()) {
     dst_surface->fill_with_color(current_map->get_tileset().get_background_color());
     current_map->draw();
-    const CameraPtr& camera = current_map->get_camera();
-    if (camera != nullptr) {
+    // With several cameras, the transition is only applied to the main one.
+    for (const CameraPtr& camera: current_map->get_cameras()) {
       const SurfacePtr& camera_surface = camera->get_surface();
-      if (transition != nullptr) {
+      if (transition != nullptr && camera == current_map->get_camera()) {
         transition->draw(*dst_surface,*camera_surface,DrawInfos(Rectangle(camera_surface->get_size()),camera->get_position_on_screen(),BlendMode::BLEND,255,Surface::draw_proxy));
       } else {
         camera_surface->draw(dst_surface, camera->get_position_on_screen());
@@ -639,8 +658,13 @@ void Game::set_current_map(
   if (current_map == nullptr || map_id != current_map->get_id()) {
     // another map
     next_map = std::make_shared<Map>(map_id);
-    next_map->load(*this);
-    next_map->check_suspended();
+    if (current_map == nullptr) {
+      load_next_map();
+    }
+    else {
+      // Parse its files while the closing transition plays.
+      get_resource_provider().start_preloading_map(map_id);
+    }
   }
   else {
     // same map
@@ -655,6 +679,22 @@ void Game::set_current_map(
   this->transition_style = transition_style;
 }
 
+/**
+ * \brief Loads the map where the hero is going to if it is not loaded yet.
+ *
+ * The map is created by set_current_map() but only loaded when the closing
+ * transition is finished, so that its files can be preloaded in the meantime.
+ */
+void Game::load_next_map() {
+
+  if (next_map == nullptr || next_map->is_loaded()) {
+    return;
+  }
+
+  next_map->load(*this);
+  next_map->check_suspended();
+}
+
 /**
  * \brief Notifies the game objects that the another map has just become active.
  */
@@ -665,6 +705,39 @@ void Game::notify_map_changed() {
 
   // Notify the equipment.
   get_equipment().notify_map_changed(*current_map);
+
+  prefetch_next_maps();
+}
+
+/**
+ * \brief Prefetches the maps where teletransporters of the current map lead.
+ *
+ * The destination maps of the teletransporters nearest to the hero come
+ * first, so that the most likely map changes find their files in the caches.
+ * Maps on the sides of the current map are reached this way too.
+ */
+void Game::prefetch_next_maps() {
+
+  std::vector<std::pair<int, std::string>> destinations;
+  for (const Teletransporter& teletransporter:
+      current_map->get_entities().get_entities_by_type<Teletransporter>()) {
+    const std::string& map_id = teletransporter.get_destination_map_id();
+    if (map_id != current_map->get_id()) {
+      destinations.emplace_back(teletransporter.get_distance(*hero), map_id);
+    }
+  }
+  std::stable_sort(destinations.begin(), destinations.end(), [](
+      const std::pair<int, std::string>& first,
+      const std::pair<int, std::string>& second
+  ) {
+    return first.first < second.first;
+  });
+
+  std::vector<std::string> map_ids;
+  for (const std::pair<int, std::string>& destination: destinations) {
+    map_ids.push_back(destination.second);
+  }
+  get_resource_provider().prefetch_maps(map_ids);
 }
 
 /**
@@ -682,7 +755,11 @@ bool Game::get_crystal_state() const {
  * \brief Changes the state of the crystal blocks.
  */
 void Game::change_crystal_state() {
+
   crystal_state = !crystal_state;
+  if (current_map != nullptr && current_map->is_loaded()) {
+    current_map->get_entities().notify_crystal_state_changed();
+  }
 }
 
 /**
@@ -749,13 +826,13 @@ bool Game::is_dialog_enabled() const {
 void Game::start_dialog(
     const std::string& dialog_id,
     const ScopedLuaRef& info_ref,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   if (!CurrentQuest::dialog_exists(dialog_id)) {
     Debug::error(std::string("No such dialog: '") + dialog_id + "'");
   }
   else {
-    dialog_box.open(dialog_id, info_ref, callback_ref);
+    dialog_box.open(dialog_id, info_ref, std::move(callback_ref));
   }
 }
 
@@ -23,6 +23,7 @@
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -765,11 +766,11 @@ GameCommand GameCommands::get_command_from_joypad(
  */
 void GameCommands::customize(
     GameCommand command,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   this->customizing = true;
   this->command_to_customize = command;
-  this->customize_callback_ref = callback_ref;
+  this->customize_callback_ref = std::move(callback_ref);
 }
 
 /**
@@ -16,10 +16,116 @@
  */
 
 #include "solarus/core/Geometry.h"
+#include <array>
+#include <cstdint>
 
 namespace Solarus {
 namespace Geometry {
 
+namespace {
+
+/**
+ * \brief Number of fractional bits of table values.
+ */
+constexpr int fixed_point_shift = 16;
+
+/**
+ * \brief The value 1 in table values.
+ */
+constexpr double fixed_point_one = 1 << fixed_point_shift;
+
+/**
+ * \brief Number of angles in a full turn for table lookups.
+ */
+constexpr int num_table_angles = 4096;
+
+/**
+ * \brief Number of ratios between 0 and 1 in the arc tangent table.
+ */
+constexpr int num_table_ratios = 1024;
+
+/**
+ * \brief Whether trigonometry uses the lookup tables.
+ */
+bool trigonometry_tables_enabled = false;
+
+/**
+ * \brief Returns the sine of angles of the first quadrant as fixed-point values.
+ *
+ * Values are rounded to 16 fractional bits, so that differences between
+ * implementations of std::sin() are lost and all platforms get the same
+ * table.
+ *
+ * \return The table of num_table_angles / 4 + 1 values.
+ */
+const std::array<int32_t, num_table_angles / 4 + 1>& get_sine_table() {
+
+  static const std::array<int32_t, num_table_angles / 4 + 1> table = [] {
+    std::array<int32_t, num_table_angles / 4 + 1> values;
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<int32_t>(std::lround(
+          std::sin(i * TWO_PI / num_table_angles) * fixed_point_one));
+    }
+    return values;
+  }();
+  return table;
+}
+
+/**
+ * \brief Returns the arc tangent of ratios between 0 and 1
+ * as fixed-point radians.
+ * \return The table of num_table_ratios + 1 values.
+ */
+const std::array<int32_t, num_table_ratios + 1>& get_atan_table() {
+
+  static const std::array<int32_t, num_table_ratios + 1> table = [] {
+    std::array<int32_t, num_table_ratios + 1> values;
+    for (size_t i = 0; i < values.size(); ++i) {
+      values[i] = static_cast<int32_t>(std::lround(
+          std::atan(static_cast<double>(i) / num_table_ratios) * fixed_point_one));
+    }
+    return values;
+  }();
+  return table;
+}
+
+/**
+ * \brief Returns the sine of a table angle.
+ * \param index Index of the angle in a full turn (any integer).
+ * \return The fixed-point sine.
+ */
+int32_t get_table_sin(int64_t index) {
+
+  constexpr int quarter = num_table_angles / 4;
+  int64_t angle = index % num_table_angles;
+  if (angle < 0) {
+    angle += num_table_angles;
+  }
+
+  const std::array<int32_t, quarter + 1>& table = get_sine_table();
+  if (angle <= quarter) {
+    return table[angle];
+  }
+  if (angle <= 2 * quarter) {
+    return table[2 * quarter - angle];
+  }
+  if (angle <= 3 * quarter) {
+    return -table[angle - 2 * quarter];
+  }
+  return -table[num_table_angles - angle];
+}
+
+/**
+ * \brief Returns the index of the table angle closest to an angle.
+ * \param angle An angle in radians.
+ * \return Index of the angle in a full turn.
+ */
+int64_t get_table_angle(double angle) {
+  return std::llround(angle * (num_table_angles / TWO_PI));
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Converts an angle in radians into an angle in degrees.
  * \param radians Angle in radians.
@@ -38,6 +144,95 @@ double degrees_to_radians(double degrees) {
   return degrees * TWO_PI / 360.0;
 }
 
+/**
+ * \brief Returns whether trigonometry functions use lookup tables.
+ * \return \c true if get_cos(), get_sin() and get_atan2() use tables.
+ */
+bool are_trigonometry_tables_enabled() {
+  return trigonometry_tables_enabled;
+}
+
+/**
+ * \brief Sets whether trigonometry functions use lookup tables.
+ *
+ * Tables only use integer operations and basic floating-point operations,
+ * which give the same results on all platforms.
+ * Movements using them are then reproducible, for example to replay
+ * recorded inputs.
+ * They are also fast without a floating-point unit.
+ * Angles are rounded to 1/4096 of a turn.
+ *
+ * \param enabled \c true to use lookup tables,
+ * \c false to use the standard functions.
+ */
+void set_trigonometry_tables_enabled(bool enabled) {
+  trigonometry_tables_enabled = enabled;
+}
+
+/**
+ * \brief Returns the cosine of an angle.
+ * \param angle An angle in radians.
+ * \return The cosine, from a lookup table if enabled.
+ */
+double get_cos(double angle) {
+
+  if (!trigonometry_tables_enabled) {
+    return std::cos(angle);
+  }
+  return get_table_sin(get_table_angle(angle) + num_table_angles / 4) / fixed_point_one;
+}
+
+/**
+ * \brief Returns the sine of an angle.
+ * \param angle An angle in radians.
+ * \return The sine, from a lookup table if enabled.
+ */
+double get_sin(double angle) {
+
+  if (!trigonometry_tables_enabled) {
+    return std::sin(angle);
+  }
+  return get_table_sin(get_table_angle(angle)) / fixed_point_one;
+}
+
+/**
+ * \brief Returns the angle of a vector like std::atan2().
+ * \param y Y coordinate of the vector.
+ * \param x X coordinate of the vector.
+ * \return The angle in radians, between -PI and PI,
+ * from a lookup table if enabled.
+ */
+double get_atan2(double y, double x) {
+
+  if (!trigonometry_tables_enabled) {
+    return std::atan2(y, x);
+  }
+
+  const double abs_x = std::abs(x);
+  const double abs_y = std::abs(y);
+  if (abs_x == 0.0 && abs_y == 0.0) {
+    return 0.0;
+  }
+
+  // Reduce to the first octant, then unfold.
+  const std::array<int32_t, num_table_ratios + 1>& table = get_atan_table();
+  const int32_t pi = static_cast<int32_t>(std::lround(PI * fixed_point_one));
+  int32_t angle = 0;
+  if (abs_y <= abs_x) {
+    angle = table[std::lround(abs_y / abs_x * num_table_ratios)];
+  }
+  else {
+    angle = pi / 2 - table[std::lround(abs_x / abs_y * num_table_ratios)];
+  }
+  if (x < 0.0) {
+    angle = pi - angle;
+  }
+  if (y < 0.0) {
+    angle = -angle;
+  }
+  return angle / fixed_point_one;
+}
+
 /**
  * \brief Returns the angle of the vector formed by two points.
  * \param x1 X coordinate of the first point.
@@ -56,7 +251,7 @@ double get_angle(double x1, double y1, double x2, double y2) {
     return PI_OVER_2;
   }
 
-  double angle = std::atan2(-dy, dx);
+  double angle = get_atan2(-dy, dx);
 
   // Normalize.
   if (angle < 0.0) {
@@ -85,8 +280,8 @@ double get_angle(const Point& point1, const Point& point2) {
 Point get_xy(double angle, int distance) {
 
   return {
-      static_cast<int>(distance * std::cos(angle)),
-      static_cast<int>(-distance * std::sin(angle))
+      static_cast<int>(distance * get_cos(angle)),
+      static_cast<int>(-distance * get_sin(angle))
   };
 }
 
@@ -35,9 +35,11 @@ bool InputEvent::initialized = false;
 bool InputEvent::joypad_enabled = false;
 SDL_Joystick* InputEvent::joystick = nullptr;
 bool InputEvent::repeat_keyboard = false;
-std::set<SDL_Keycode> InputEvent::keys_pressed;
-// Default the axis states to centered
-std::vector<int> InputEvent::joypad_axis_state;
+std::bitset<SDL_NUM_SCANCODES> InputEvent::keys_pressed;
+std::array<int16_t, 128 + SDL_NUM_SCANCODES> InputEvent::key_scancodes;
+std::vector<int16_t> InputEvent::joypad_axis_values;
+std::vector<uint8_t> InputEvent::joypad_button_states;
+std::vector<uint8_t> InputEvent::joypad_hat_states;
 
 // Keyboard key names.
 const std::string EnumInfoTraits<InputEvent::KeyboardKey>::pretty_name = "keyboard key";
@@ -189,6 +191,7 @@ const EnumInfo<InputEvent::MouseButton>::names_type EnumInfoTraits<InputEvent::M
 void InputEvent::initialize() {
 
   initialized = true;
+  key_scancodes.fill(-1);
 
   // Initialize text events.
   SDL_StartTextInput();
@@ -210,8 +213,9 @@ void InputEvent::quit() {
   joypad_enabled = false;
   joystick = nullptr;
   repeat_keyboard = false;
-  keys_pressed.clear();
-  joypad_axis_state.clear();
+  keys_pressed.reset();
+  key_scancodes.fill(-1);
+  update_joypad_state();
   initialized = false;
 }
 
@@ -245,66 +249,213 @@ std::unique_ptr<InputEvent> InputEvent::get_event() {
   InputEvent* result = nullptr;
   SDL_Event internal_event;
   if (SDL_PollEvent(&internal_event)) {
+    update_state(internal_event);
 
-    // If this is a joypad axis event
-    if (internal_event.type == SDL_JOYAXISMOTION) {
-      // Determine the current state of the axis
-      int axis = internal_event.jaxis.axis;
-      int value = internal_event.jaxis.value;
-      int joystick_deadzone = 8000;
-      if (axis == 0) {  // X axis
-        int x_dir = 0;
-        if (value < -joystick_deadzone) {
-          // Left of dead zone
-          x_dir = -1;
-        } else if(value > joystick_deadzone) {
-          // Right of dead zone
-          x_dir =  1;
-        } else {
-          x_dir = 0;
-        }
-        joypad_axis_state[axis] = x_dir;
-      } else if (axis == 1) {  // Y axis
-        int y_dir = 0;
-        if (value < -joystick_deadzone) {
-          // Below dead zone
-          y_dir = -1;
-        } else if(value > joystick_deadzone) {
-          // Above dead zone
-          y_dir =  1;
-        } else {
-          y_dir = 0;
-        }
-        joypad_axis_state[axis] = y_dir;
-      }
+    // Always return a Solarus event if an SDL event occurred, so that
+    // multiple SDL events in the same frame are all treated.
+    result = new InputEvent(internal_event);
+  }
+
+  return std::unique_ptr<InputEvent>(result);
+}
+
+/**
+ * \brief Takes all events currently in the event queue.
+ *
+ * Unlike get_event(), events are stored by value so that the same vector
+ * can be reused at each cycle without allocating.
+ * Consecutive motions of a joypad axis that do not change its state are
+ * merged into one event with the last value: an analog stick produces many
+ * of them per frame but only the direction matters.
+ *
+ * \param[out] events The events of the queue, in order.
+ * The vector is cleared first.
+ */
+void InputEvent::get_events(std::vector<InputEvent>& events) {
+
+  events.clear();
+  SDL_Event internal_event;
+  while (SDL_PollEvent(&internal_event)) {
+    update_state(internal_event);
+    InputEvent event(internal_event);
+
+    if (event.is_joypad_axis_moved() && merge_axis_motion(events, event)) {
+      continue;
     }
+    events.push_back(event);
+  }
+}
+
+/**
+ * \brief Merges a joypad axis motion into a previous event if possible.
+ *
+ * The axis motion replaces the last event about the same axis if its state
+ * is unchanged and if only axis motions come after it.
+ *
+ * \param events Events taken from the queue so far.
+ * \param event A joypad axis motion event.
+ * \return \c true if the event was merged, \c false if it has to be added.
+ */
+bool InputEvent::merge_axis_motion(std::vector<InputEvent>& events, const InputEvent& event) {
 
-    // Check if keyboard events are correct.
-    // For some reason, when running Solarus from a Qt application
-    // (which is not recommended)
-    // multiple SDL_KEYUP events are generated when a key remains pressed
-    // (Qt/SDL conflict). This fixes most problems but not all of them.
-    else if (internal_event.type == SDL_KEYDOWN) {
-      SDL_Keycode key = internal_event.key.keysym.sym;
-      if (!keys_pressed.insert(key).second) {
-        // Already known as pressed: mark repeated.
-        internal_event.key.repeat = 1;
+  for (auto it = events.rbegin(); it != events.rend() && it->is_joypad_axis_moved(); ++it) {
+    if (it->internal_event.jaxis.which == event.internal_event.jaxis.which &&
+        it->internal_event.jaxis.axis == event.internal_event.jaxis.axis) {
+      if (it->get_joypad_axis_state() != event.get_joypad_axis_state()) {
+        return false;
       }
+      it->internal_event = event.internal_event;
+      return true;
     }
-    else if (internal_event.type == SDL_KEYUP) {
-      SDL_Keycode key = internal_event.key.keysym.sym;
-      if (keys_pressed.erase(key) == 0) {
-        // Already known as not pressed: mark repeated.
-        internal_event.key.repeat = 1;
-      }
+  }
+  return false;
+}
+
+/**
+ * \brief Creates an event from an SDL event recorded earlier.
+ *
+ * The state kept by InputEvent (joypad axes, keys pressed) is updated
+ * like for events coming from the event queue.
+ *
+ * \param internal_event A value previously returned by get_internal_event().
+ * \return The corresponding event.
+ */
+std::unique_ptr<InputEvent> InputEvent::create_replayed_event(
+    const SDL_Event& internal_event
+) {
+  SDL_Event event = internal_event;
+  update_state(event);
+  return std::unique_ptr<InputEvent>(new InputEvent(event));
+}
+
+/**
+ * \brief Updates the joypad and keyboard state from a new SDL event.
+ * \param internal_event The event. Keyboard events may be marked as
+ * repeated.
+ */
+void InputEvent::update_state(SDL_Event& internal_event) {
+
+  // Joypad state, only for the joystick in use.
+  if (internal_event.type == SDL_JOYAXISMOTION) {
+    const size_t axis = internal_event.jaxis.axis;
+    if (axis < joypad_axis_values.size()) {
+      joypad_axis_values[axis] = internal_event.jaxis.value;
     }
+  }
+  else if (internal_event.type == SDL_JOYBUTTONDOWN ||
+           internal_event.type == SDL_JOYBUTTONUP) {
+    const size_t button = internal_event.jbutton.button;
+    if (button < joypad_button_states.size()) {
+      joypad_button_states[button] = internal_event.jbutton.state == SDL_PRESSED;
+    }
+  }
+  else if (internal_event.type == SDL_JOYHATMOTION) {
+    const size_t hat = internal_event.jhat.hat;
+    if (hat < joypad_hat_states.size()) {
+      joypad_hat_states[hat] = internal_event.jhat.value;
+    }
+  }
+  else if (internal_event.type == SDL_KEYMAPCHANGED) {
+    // Keycodes may now correspond to other scancodes.
+    key_scancodes.fill(-1);
+  }
 
-    // Always return a Solarus event if an SDL event occurred, so that
-    // multiple SDL events in the same frame are all treated.
-    result = new InputEvent(internal_event);
+  // Check if keyboard events are correct.
+  // For some reason, when running Solarus from a Qt application
+  // (which is not recommended)
+  // multiple SDL_KEYUP events are generated when a key remains pressed
+  // (Qt/SDL conflict). This fixes most problems but not all of them.
+  else if (internal_event.type == SDL_KEYDOWN) {
+    const SDL_Scancode scancode = get_scancode(internal_event);
+    if (keys_pressed.test(scancode)) {
+      // Already known as pressed: mark repeated.
+      internal_event.key.repeat = 1;
+    }
+    keys_pressed.set(scancode);
   }
+  else if (internal_event.type == SDL_KEYUP) {
+    const SDL_Scancode scancode = get_scancode(internal_event);
+    if (!keys_pressed.test(scancode)) {
+      // Already known as not pressed: mark repeated.
+      internal_event.key.repeat = 1;
+    }
+    keys_pressed.reset(scancode);
+  }
+}
 
-  return std::unique_ptr<InputEvent>(result);
+/**
+ * \brief Reads the initial state of the joystick in use.
+ *
+ * Then, the joypad state is only updated from joypad events.
+ * Without joystick, the state is cleared.
+ */
+void InputEvent::update_joypad_state() {
+
+  joypad_axis_values.clear();
+  joypad_button_states.clear();
+  joypad_hat_states.clear();
+  if (joystick == nullptr) {
+    return;
+  }
+
+  for (int i = 0; i < SDL_JoystickNumAxes(joystick); ++i) {
+    joypad_axis_values.push_back(SDL_JoystickGetAxis(joystick, i));
+  }
+  for (int i = 0; i < SDL_JoystickNumButtons(joystick); ++i) {
+    joypad_button_states.push_back(SDL_JoystickGetButton(joystick, i));
+  }
+  for (int i = 0; i < SDL_JoystickNumHats(joystick); ++i) {
+    joypad_hat_states.push_back(SDL_JoystickGetHat(joystick, i));
+  }
+}
+
+/**
+ * \brief Returns the scancode of a keycode in the current keyboard layout.
+ *
+ * Results are cached in a flat table until the layout changes.
+ *
+ * \param key A keycode.
+ * \return The corresponding scancode, or SDL_SCANCODE_UNKNOWN.
+ */
+SDL_Scancode InputEvent::get_scancode(SDL_Keycode key) {
+
+  int index = -1;
+  if ((key & SDLK_SCANCODE_MASK) != 0) {
+    const int scancode = key & ~SDLK_SCANCODE_MASK;
+    if (scancode >= 0 && scancode < SDL_NUM_SCANCODES) {
+      index = 128 + scancode;
+    }
+  }
+  else if (key >= 0 && key < 128) {
+    index = key;
+  }
+
+  if (index == -1) {
+    // Not an ASCII key: ask SDL.
+    return SDL_GetScancodeFromKey(key);
+  }
+
+  if (key_scancodes[index] == -1) {
+    key_scancodes[index] = static_cast<int16_t>(SDL_GetScancodeFromKey(key));
+  }
+  return static_cast<SDL_Scancode>(key_scancodes[index]);
+}
+
+/**
+ * \brief Returns the scancode of a keyboard event.
+ *
+ * Simulated events may only have a keycode.
+ *
+ * \param internal_event A keyboard event.
+ * \return The scancode of the event, valid as an index of keys_pressed.
+ */
+SDL_Scancode InputEvent::get_scancode(const SDL_Event& internal_event) {
+
+  SDL_Scancode scancode = internal_event.key.keysym.scancode;
+  if (scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES) {
+    scancode = get_scancode(internal_event.key.keysym.sym);
+  }
+  return scancode;
 }
 
 // global information
@@ -388,8 +539,8 @@ bool InputEvent::is_key_down(KeyboardKey key) {
 
   int num_keys = 0;
   const Uint8* keys_state = SDL_GetKeyboardState(&num_keys);
-  SDL_Scancode scan_code = SDL_GetScancodeFromKey(SDL_Keycode(key));
-  return keys_state[scan_code];
+  const SDL_Scancode scan_code = get_scancode(SDL_Keycode(key));
+  return scan_code < num_keys && keys_state[scan_code] != 0;
 }
 
 /**
@@ -399,11 +550,11 @@ bool InputEvent::is_key_down(KeyboardKey key) {
  */
 bool InputEvent::is_joypad_button_down(int button) {
 
-  if (joystick == nullptr) {
+  if (button < 0 || button >= static_cast<int>(joypad_button_states.size())) {
     return false;
   }
 
-  return SDL_JoystickGetButton(joystick, button) != 0;
+  return joypad_button_states[button] != 0;
 }
 
 /**
@@ -440,11 +591,11 @@ bool InputEvent::is_finger_down(int finger_id) {
  */
 int InputEvent::get_joypad_axis_state(int axis) {
 
-  if (joystick == nullptr) {
+  if (axis < 0 || axis >= static_cast<int>(joypad_axis_values.size())) {
     return 0;
   }
 
-  int state = SDL_JoystickGetAxis(joystick, axis);
+  int state = joypad_axis_values[axis];
 
   int result;
   if (std::abs(state) < 10000) {
@@ -464,11 +615,11 @@ int InputEvent::get_joypad_axis_state(int axis) {
  */
 int InputEvent::get_joypad_hat_direction(int hat) {
 
-  if (joystick == nullptr) {
+  if (hat < 0 || hat >= static_cast<int>(joypad_hat_states.size())) {
     return -1;
   }
 
-  int state = SDL_JoystickGetHat(joystick, hat);
+  int state = joypad_hat_states[hat];
   int result = -1;
 
   switch (state) {
@@ -576,6 +727,17 @@ bool InputEvent::get_global_finger_pressure(int finger_id, float& finger_pressur
 
 // event type
 
+/**
+ * \brief Returns the SDL event encapsulated.
+ *
+ * It can be saved and given later to create_replayed_event().
+ *
+ * \return The internal event.
+ */
+const SDL_Event& InputEvent::get_internal_event() const {
+  return internal_event;
+}
+
 /**
  * \brief Returns whether this is a valid event.
  * \return \c false if this object represents no event.
@@ -635,7 +797,8 @@ bool InputEvent::is_finger_event() const {
  */
 bool InputEvent::is_window_event() const {
 
-  return internal_event.type == SDL_QUIT; // other SDL window events are ignored
+  return internal_event.type == SDL_QUIT
+      || internal_event.type == SDL_WINDOWEVENT;
 }
 
 // keyboard
@@ -861,6 +1024,7 @@ void InputEvent::simulate_key_pressed(KeyboardKey key) {
   SDL_Event event;
   event.type = SDL_KEYDOWN;
   event.key.keysym.sym = static_cast<SDL_Keycode>(key);
+  event.key.keysym.scancode = get_scancode(event.key.keysym.sym);
   event.key.repeat = 0;
 
   SDL_PushEvent(&event);
@@ -875,6 +1039,7 @@ void InputEvent::simulate_key_released(KeyboardKey key) {
   SDL_Event event;
   event.type = SDL_KEYUP;
   event.key.keysym.sym = static_cast<SDL_Keycode>(key);
+  event.key.keysym.scancode = get_scancode(event.key.keysym.sym);
   event.key.repeat = 0;
 
   SDL_PushEvent(&event);
@@ -910,19 +1075,19 @@ void InputEvent::set_joypad_enabled(bool joypad_enabled) {
     if (joystick != nullptr) {
       SDL_JoystickClose(joystick);
       joystick = nullptr;
-      joypad_axis_state.clear();
     }
 
     if (joypad_enabled && SDL_NumJoysticks() > 0) {
         SDL_InitSubSystem(SDL_INIT_JOYSTICK);
         joystick = SDL_JoystickOpen(0);
-        joypad_axis_state.assign(SDL_JoystickNumAxes(joystick), 0);
     }
     else {
       SDL_JoystickEventState(SDL_IGNORE);
       SDL_QuitSubSystem(SDL_INIT_JOYSTICK);
     }
 
+    update_joypad_state();
+
     Logger::info(std::string("Joypad support enabled: ") + (joypad_enabled ? "true" : "false"));
   }
 }
@@ -1471,5 +1636,52 @@ bool InputEvent::is_window_closing() const {
   return internal_event.type == SDL_QUIT;
 }
 
+/**
+ * \brief Returns whether this event corresponds to
+ * the window being minimized or hidden.
+ * \return true if the window can no longer be seen
+ */
+bool InputEvent::is_window_hidden() const {
+
+  return internal_event.type == SDL_WINDOWEVENT &&
+      (internal_event.window.event == SDL_WINDOWEVENT_HIDDEN ||
+       internal_event.window.event == SDL_WINDOWEVENT_MINIMIZED);
+}
+
+/**
+ * \brief Returns whether this event corresponds to
+ * the window being shown or restored.
+ * \return true if the window can be seen again
+ */
+bool InputEvent::is_window_shown() const {
+
+  return internal_event.type == SDL_WINDOWEVENT &&
+      (internal_event.window.event == SDL_WINDOWEVENT_SHOWN ||
+       internal_event.window.event == SDL_WINDOWEVENT_RESTORED ||
+       internal_event.window.event == SDL_WINDOWEVENT_MAXIMIZED);
+}
+
+/**
+ * \brief Returns whether this event corresponds to
+ * the window losing the keyboard focus.
+ * \return true if the window is no longer focused
+ */
+bool InputEvent::is_window_focus_lost() const {
+
+  return internal_event.type == SDL_WINDOWEVENT &&
+      internal_event.window.event == SDL_WINDOWEVENT_FOCUS_LOST;
+}
+
+/**
+ * \brief Returns whether this event corresponds to
+ * the window getting the keyboard focus.
+ * \return true if the window is focused again
+ */
+bool InputEvent::is_window_focus_gained() const {
+
+  return internal_event.type == SDL_WINDOWEVENT &&
+      internal_event.window.event == SDL_WINDOWEVENT_FOCUS_GAINED;
+}
+
 }
 
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/InputEvent.h"
+#include "solarus/core/InputRecording.h"
+#include "solarus/core/Logger.h"
+#include <cstring>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Writes an unsigned integer in little-endian order.
+ * \param out The stream to write.
+ * \param value The value.
+ * \param num_bytes Number of bytes to write.
+ */
+void write_uint(std::ostream& out, uint32_t value, int num_bytes) {
+
+  for (int i = 0; i < num_bytes; ++i) {
+    out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+/**
+ * \brief Reads an unsigned integer in little-endian order.
+ * \param in The stream to read.
+ * \param num_bytes Number of bytes to read.
+ * \param[out] value The value read.
+ * \return \c false if the end of the stream was reached.
+ */
+bool read_uint(std::istream& in, int num_bytes, uint32_t& value) {
+
+  value = 0;
+  for (int i = 0; i < num_bytes; ++i) {
+    const int c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+      return false;
+    }
+    value |= static_cast<uint32_t>(c & 0xFF) << (8 * i);
+  }
+  return true;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief First bytes of input recording files.
+ */
+const std::string InputRecording::file_signature = "solarus-input-1\n";
+
+/**
+ * \brief Creates an input recording that neither records nor replays.
+ */
+InputRecording::InputRecording():
+  out(),
+  records(),
+  next_record_index(0),
+  replaying(false),
+  random_seed(0) {
+
+}
+
+/**
+ * \brief Starts recording events to a file.
+ *
+ * The file name is a regular path of the filesystem,
+ * not a path in the quest write directory.
+ *
+ * \param file_name The file to create.
+ * \param random_seed Seed of the random number generator for this session.
+ * \return \c true in case of success.
+ */
+bool InputRecording::start_recording(const std::string& file_name, uint32_t random_seed) {
+
+  out.open(file_name.c_str(), std::ios::binary);
+  if (!out) {
+    Logger::error("Cannot create input recording file '" + file_name + "'");
+    return false;
+  }
+
+  this->random_seed = random_seed;
+  out.write(file_signature.data(), static_cast<std::streamsize>(file_signature.size()));
+  write_uint(out, random_seed, 4);
+  return out.good();
+}
+
+/**
+ * \brief Loads a recording to replay it.
+ *
+ * The file name is a regular path of the filesystem,
+ * not a path in the quest write directory.
+ *
+ * \param file_name A file created by start_recording().
+ * \return \c true in case of success.
+ */
+bool InputRecording::start_replaying(const std::string& file_name) {
+
+  std::ifstream in(file_name.c_str(), std::ios::binary);
+  if (!in) {
+    Logger::error("Cannot open input recording file '" + file_name + "'");
+    return false;
+  }
+
+  std::string signature(file_signature.size(), '\0');
+  in.read(&signature[0], static_cast<std::streamsize>(signature.size()));
+  if (!in || signature != file_signature || !read_uint(in, 4, random_seed)) {
+    Logger::error("Invalid input recording file '" + file_name + "'");
+    return false;
+  }
+
+  records.clear();
+  uint32_t date = 0;
+  while (read_uint(in, 4, date)) {
+    uint32_t size = 0;
+    Record record;
+    std::memset(&record.event, 0, sizeof(record.event));
+    record.date = date;
+    if (!read_uint(in, 2, size) || size != sizeof(SDL_Event) ||
+        !in.read(reinterpret_cast<char*>(&record.event), size)) {
+      Logger::error("Invalid input recording file '" + file_name +
+          "': it may have been made with another build of the engine");
+      records.clear();
+      return false;
+    }
+    records.push_back(record);
+  }
+
+  next_record_index = 0;
+  replaying = true;
+  return true;
+}
+
+/**
+ * \brief Returns whether events are being recorded.
+ * \return \c true if start_recording() succeeded.
+ */
+bool InputRecording::is_recording() const {
+  return out.is_open();
+}
+
+/**
+ * \brief Returns whether events are being replayed.
+ * \return \c true if start_replaying() succeeded.
+ */
+bool InputRecording::is_replaying() const {
+  return replaying;
+}
+
+/**
+ * \brief Returns whether all events of the replay were given.
+ * \return \c true if there is no more event to replay.
+ */
+bool InputRecording::is_replay_finished() const {
+  return next_record_index >= records.size();
+}
+
+/**
+ * \brief Returns the seed of the random number generator of the session.
+ * \return The seed recorded or replayed.
+ */
+uint32_t InputRecording::get_random_seed() const {
+  return random_seed;
+}
+
+/**
+ * \brief Saves an event in the recording.
+ *
+ * Events that cannot be saved are ignored (see is_recordable()).
+ *
+ * \param event The event.
+ * \param date The simulated time when the event is handled.
+ */
+void InputRecording::record_event(const InputEvent& event, uint32_t date) {
+
+  if (!is_recording() || !is_recordable(event)) {
+    return;
+  }
+
+  write_uint(out, date, 4);
+  write_uint(out, sizeof(SDL_Event), 2);
+  out.write(reinterpret_cast<const char*>(&event.get_internal_event()), sizeof(SDL_Event));
+}
+
+/**
+ * \brief Returns the next event to replay if it is due.
+ *
+ * Call this until it returns nullptr before each simulation step.
+ *
+ * \param date The current simulated time.
+ * \return The next event if it was recorded at this date or before,
+ * nullptr otherwise.
+ */
+std::unique_ptr<InputEvent> InputRecording::get_replayed_event(uint32_t date) {
+
+  if (is_replay_finished() || records[next_record_index].date > date) {
+    return nullptr;
+  }
+
+  const Record& record = records[next_record_index];
+  ++next_record_index;
+  return InputEvent::create_replayed_event(record.event);
+}
+
+/**
+ * \brief Returns whether an event can be saved in a recording.
+ *
+ * Only keyboard, text, joypad, mouse and finger events are saved.
+ * Window events depend on the window system and other events may carry
+ * pointers.
+ *
+ * \param event An event.
+ * \return \c true if the event can be recorded.
+ */
+bool InputRecording::is_recordable(const InputEvent& event) {
+
+  switch (event.get_internal_event().type) {
+
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    case SDL_TEXTINPUT:
+    case SDL_JOYAXISMOTION:
+    case SDL_JOYHATMOTION:
+    case SDL_JOYBUTTONDOWN:
+    case SDL_JOYBUTTONUP:
+    case SDL_MOUSEMOTION:
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEWHEEL:
+    case SDL_FINGERMOTION:
+    case SDL_FINGERDOWN:
+    case SDL_FINGERUP:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+}
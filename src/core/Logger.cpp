@@ -16,8 +16,18 @@
  */
 #include "solarus/core/Logger.h"
 #include "solarus/core/System.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
 
 namespace Solarus {
 
@@ -40,6 +50,387 @@ namespace {
     }
     return error_log_file;
   }
+
+  /**
+   * \brief Kinds of lines written by the logger.
+   */
+  enum class EntryType {
+    MESSAGE,     /**< A message with a level, from debug() to fatal(). */
+    PRINT,       /**< A message from print(), with the prefix but no level. */
+    OUTPUT       /**< A line of script output, written as is. */
+  };
+
+  /**
+   * \brief A line to write.
+   */
+  struct Entry {
+    EntryType type;
+    Level level;
+    uint32_t time;
+    std::string category;
+    std::string message;
+    bool to_error_file;
+  };
+
+  const char* const level_names[] = { "Debug", "Info", "Warning", "Error", "Fatal" };
+  const char* const level_ids[] = { "debug", "info", "warning", "error", "fatal" };
+
+  std::atomic<int> min_level(static_cast<int>(Level::VERBOSE));
+  std::atomic<int> format(static_cast<int>(Format::TEXT));
+  std::atomic<bool> has_disabled_categories(false);
+  std::set<std::string> disabled_categories;
+  std::mutex categories_mutex;
+  std::mutex write_mutex;
+  OutputHandler output_handler;
+  std::mutex output_handler_mutex;
+
+  /**
+   * \brief Appends a string as a JSON string literal.
+   * \param oss The stream to write to.
+   * \param value The string to escape.
+   */
+  void write_json_string(std::ostream& oss, const std::string& value) {
+
+    oss << '"';
+    for (char c: value) {
+      switch (c) {
+        case '"': oss << "\\\""; break;
+        case '\\': oss << "\\\\"; break;
+        case '\n': oss << "\\n"; break;
+        case '\r': oss << "\\r"; break;
+        case '\t': oss << "\\t"; break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            const char* digits = "0123456789abcdef";
+            oss << "\\u00" << digits[(c >> 4) & 0xF] << digits[c & 0xF];
+          }
+          else {
+            oss << c;
+          }
+      }
+    }
+    oss << '"';
+  }
+
+  /**
+   * \brief Writes an entry as a text line.
+   * \param entry The entry to write.
+   * \param out The output stream.
+   */
+  void write_text(const Entry& entry, std::ostream& out) {
+
+    if (entry.type == EntryType::OUTPUT) {
+      out << entry.message << '\n';
+      return;
+    }
+
+    out << "[Solarus] [" << entry.time << "] ";
+    if (entry.type == EntryType::MESSAGE) {
+      out << level_names[static_cast<int>(entry.level)] << ": ";
+      if (!entry.category.empty()) {
+        out << '[' << entry.category << "] ";
+      }
+    }
+    out << entry.message << '\n';
+  }
+
+  /**
+   * \brief Writes an entry as a JSON object on one line.
+   * \param entry The entry to write.
+   * \param out The output stream.
+   */
+  void write_json(const Entry& entry, std::ostream& out) {
+
+    if (entry.type == EntryType::OUTPUT) {
+      out << "{\"output\": ";
+      write_json_string(out, entry.message);
+      out << "}\n";
+      return;
+    }
+
+    out << "{\"time\": " << entry.time;
+    if (entry.type == EntryType::MESSAGE) {
+      out << ", \"level\": \"" << level_ids[static_cast<int>(entry.level)] << '"';
+      if (!entry.category.empty()) {
+        out << ", \"category\": ";
+        write_json_string(out, entry.category);
+      }
+    }
+    out << ", \"message\": ";
+    write_json_string(out, entry.message);
+    out << "}\n";
+  }
+
+  /**
+   * \brief Writes an entry on stdout and maybe in the error log file.
+   *
+   * Callers must ensure that only one thread writes at a time.
+   * The output handler, if any, also receives the lines written on stdout.
+   *
+   * \param entry The entry to write.
+   */
+  void write_entry(const Entry& entry) {
+
+    std::ostringstream oss;
+    if (static_cast<Format>(format.load()) == Format::JSON) {
+      write_json(entry, oss);
+    }
+    else {
+      write_text(entry, oss);
+    }
+    const std::string& text = oss.str();
+    std::cout << text;
+
+    {
+      std::lock_guard<std::mutex> lock(output_handler_mutex);
+      if (output_handler) {
+        // Each line without its final newline.
+        size_t start = 0;
+        size_t end = text.find('\n');
+        while (end != std::string::npos) {
+          output_handler(text.substr(start, end - start));
+          start = end + 1;
+          end = text.find('\n', start);
+        }
+      }
+    }
+
+    if (entry.to_error_file) {
+      write_text(entry, get_error_log_file());
+    }
+  }
+
+  /**
+   * \brief Writes stdout and the error log file to the system.
+   */
+  void flush_streams() {
+
+    std::cout.flush();
+    if (error_log_file.is_open()) {
+      error_log_file.flush();
+    }
+  }
+
+  /**
+   * \brief Writes entries from a background thread.
+   *
+   * Entries are pushed to an intrusive multiple-producer, single-consumer
+   * queue: pushing is one atomic exchange, without locks,
+   * and the order of entries is preserved.
+   * The background thread sleeps when the queue is empty.
+   */
+  class AsyncWriter {
+
+    public:
+
+      AsyncWriter();
+      ~AsyncWriter();
+
+      void push(Entry&& entry);
+      void flush();
+
+    private:
+
+      /**
+       * \brief A node of the queue.
+       */
+      struct Node {
+        std::atomic<Node*> next;
+        Entry entry;
+      };
+
+      void run();
+      bool write_pending();
+
+      std::atomic<Node*> head;                     /**< Last node pushed. */
+      Node* tail;                                  /**< Node before the next one to write
+                                                    * (only used by the writer thread). */
+      std::atomic<uint64_t> num_pushed;            /**< Number of entries pushed so far. */
+      std::atomic<uint64_t> num_written;           /**< Number of entries written so far. */
+      std::atomic<bool> waiting;                   /**< Whether the writer thread sleeps. */
+      std::atomic<bool> stopping;                  /**< Whether the writer thread should stop. */
+      std::mutex mutex;                            /**< Protects the waits of both conditions. */
+      std::condition_variable wake_condition;      /**< Wakes up the writer thread. */
+      std::condition_variable written_condition;   /**< Signals that entries were written. */
+      std::thread thread;                          /**< The writer thread. */
+
+  };
+
+  /**
+   * \brief Creates the queue and starts the writer thread.
+   */
+  AsyncWriter::AsyncWriter():
+    head(new Node()),
+    tail(head.load()),
+    num_pushed(0),
+    num_written(0),
+    waiting(false),
+    stopping(false),
+    mutex(),
+    wake_condition(),
+    written_condition(),
+    thread() {
+
+    tail->next.store(nullptr);
+    thread = std::thread([this] { run(); });
+  }
+
+  /**
+   * \brief Writes remaining entries and stops the writer thread.
+   */
+  AsyncWriter::~AsyncWriter() {
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake_condition.notify_one();
+    thread.join();
+
+    delete tail;
+  }
+
+  /**
+   * \brief Adds an entry to write.
+   *
+   * This can be called from any thread.
+   *
+   * \param entry The entry.
+   */
+  void AsyncWriter::push(Entry&& entry) {
+
+    Node* node = new Node();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->entry = std::move(entry);
+    Node* previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+    ++num_pushed;
+
+    if (waiting.load(std::memory_order_relaxed)) {
+      wake_condition.notify_one();
+    }
+  }
+
+  /**
+   * \brief Waits until all entries pushed so far are written.
+   */
+  void AsyncWriter::flush() {
+
+    const uint64_t target = num_pushed.load();
+    std::unique_lock<std::mutex> lock(mutex);
+    wake_condition.notify_one();
+    written_condition.wait(lock, [this, target] {
+      return num_written.load() >= target;
+    });
+  }
+
+  /**
+   * \brief Loop of the writer thread.
+   */
+  void AsyncWriter::run() {
+
+    while (true) {
+      const bool wrote = write_pending();
+      if (stopping) {
+        write_pending();
+        return;
+      }
+      if (!wrote) {
+        // Also wake up regularly: a push may not see the waiting flag.
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting = true;
+        wake_condition.wait_for(lock, std::chrono::milliseconds(20), [this] {
+          return stopping.load() || tail->next.load(std::memory_order_acquire) != nullptr;
+        });
+        waiting = false;
+      }
+    }
+  }
+
+  /**
+   * \brief Writes all entries of the queue.
+   * \return \c true if there was something to write.
+   */
+  bool AsyncWriter::write_pending() {
+
+    uint64_t count = 0;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    while (next != nullptr) {
+      {
+        // Threads may already write directly if the asynchronous mode
+        // is being disabled.
+        std::lock_guard<std::mutex> lock(write_mutex);
+        write_entry(next->entry);
+      }
+      // The written node becomes the tail and the old tail is freed.
+      delete tail;
+      tail = next;
+      tail->entry = Entry();
+      ++count;
+      next = tail->next.load(std::memory_order_acquire);
+    }
+
+    if (count == 0) {
+      return false;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(write_mutex);
+      flush_streams();
+    }
+    num_written += count;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+    }
+    written_condition.notify_all();
+    return true;
+  }
+
+  /**
+   * \brief The writer thread in asynchronous mode, or nullptr.
+   *
+   * Always accessed with std::atomic_load() and std::atomic_store():
+   * threads that log keep it alive while they push an entry,
+   * even if the asynchronous mode is being disabled.
+   */
+  std::shared_ptr<AsyncWriter> async_writer;
+
+  /**
+   * \brief Writes an entry now or gives it to the writer thread.
+   * \param entry The entry to log.
+   */
+  void log(Entry&& entry) {
+
+    const std::shared_ptr<AsyncWriter> writer = std::atomic_load(&async_writer);
+    if (writer != nullptr) {
+      writer->push(std::move(entry));
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex);
+    write_entry(entry);
+    flush_streams();
+  }
+
+  /**
+   * \brief Logs a message with a level if it is not filtered.
+   * \param level Level of the message.
+   * \param message The message.
+   * \param category Category of the message or an empty string.
+   * \param to_error_file Whether to also write the message in error.txt.
+   */
+  void log_message(
+      Level level,
+      const std::string& message,
+      const std::string& category,
+      bool to_error_file
+  ) {
+    if (!is_enabled(level, category)) {
+      return;
+    }
+
+    log(Entry{ EntryType::MESSAGE, level, System::now(), category, message, to_error_file });
+  }
 }
 
 /**
@@ -47,65 +438,285 @@ namespace {
  *
  * The message is prepended by "[Solarus] [t] " where t is the current
  * simulated time.
+ * It is not filtered.
  *
  * \param message The message to log.
  * \param out The output stream.
  */
 SOLARUS_API void print(const std::string& message, std::ostream& out) {
 
-  uint32_t simulated_time = System::now();
-  out << "[Solarus] [" << simulated_time << "] " << message << std::endl;
+  if (&out == &std::cout) {
+    log(Entry{ EntryType::PRINT, Level::INFO, System::now(), "", message, false });
+    return;
+  }
+
+  // Other streams are written right now, after what is already logged.
+  flush();
+  std::lock_guard<std::mutex> lock(write_mutex);
+  write_text(Entry{ EntryType::PRINT, Level::INFO, System::now(), "", message, false }, out);
+  out.flush();
+}
+
+/**
+ * \brief Logs a line printed by a script on stdout, without prefix.
+ *
+ * Lines printed this way stay in order with the messages of the engine.
+ * They belong to the category "lua".
+ *
+ * \param line The line to print.
+ */
+SOLARUS_API void print_output(const std::string& line) {
+
+  if (!is_category_enabled("lua")) {
+    return;
+  }
+
+  log(Entry{ EntryType::OUTPUT, Level::INFO, System::now(), "lua", line, false });
 }
 
 /**
  * \brief Logs a debug message on stdout.
  * \param message The message to log.
+ * \param category Category of the message or an empty string.
  */
-SOLARUS_API void debug(const std::string& message) {
+SOLARUS_API void debug(const std::string& message, const std::string& category) {
 
-  print("Debug: " + message);
+  log_message(Level::VERBOSE, message, category, false);
 }
 
 /**
  * \brief Logs an information message on stdout.
  * \param message The message to log.
+ * \param category Category of the message or an empty string.
  */
-SOLARUS_API void info(const std::string& message) {
+SOLARUS_API void info(const std::string& message, const std::string& category) {
 
-  print("Info: " + message);
+  log_message(Level::INFO, message, category, false);
 }
 
 /**
  * \brief Logs a warning message on stdout and error.txt.
  * \param message The message to log.
+ * \param category Category of the message or an empty string.
  */
-SOLARUS_API void warning(const std::string& message) {
+SOLARUS_API void warning(const std::string& message, const std::string& category) {
 
-  std::string prefixed_message = "Warning: " + message;
-  print(prefixed_message);
-  print(prefixed_message, get_error_log_file());
+  log_message(Level::WARNING, message, category, true);
 }
 
 /**
  * \brief Logs an error message on stdout and error.txt.
  * \param message The message to log.
+ * \param category Category of the message or an empty string.
  */
-SOLARUS_API void error(const std::string& message) {
+SOLARUS_API void error(const std::string& message, const std::string& category) {
 
-  std::string prefixed_message = "Error: " + message;
-  print(prefixed_message);
-  print(prefixed_message, get_error_log_file());
+  log_message(Level::SEVERE, message, category, true);
 }
 
 /**
  * \brief Logs a fatal error message on stdout and error.txt.
+ *
+ * Fatal messages are never filtered, and are written before returning
+ * since the program is about to stop.
+ *
  * \param message The message to log.
+ * \param category Category of the message or an empty string.
+ */
+SOLARUS_API void fatal(const std::string& message, const std::string& category) {
+
+  log(Entry{ EntryType::MESSAGE, Level::FATAL, System::now(), category, message, true });
+  flush();
+}
+
+/**
+ * \brief Returns the lowest level of messages that are logged.
+ * \return The minimum level.
+ */
+SOLARUS_API Level get_min_level() {
+  return static_cast<Level>(min_level.load());
+}
+
+/**
+ * \brief Sets the lowest level of messages that are logged.
+ *
+ * The default is Level::VERBOSE, so that debug messages are shown.
+ *
+ * \param level The minimum level.
+ */
+SOLARUS_API void set_min_level(Level level) {
+  min_level = static_cast<int>(level);
+}
+
+/**
+ * \brief Sets the lowest level of messages that are logged from its name.
+ * \param level_name "debug", "info", "warning", "error" or "fatal".
+ * \return \c false if the name is invalid.
+ */
+SOLARUS_API bool set_min_level(const std::string& level_name) {
+
+  for (int i = 0; i <= static_cast<int>(Level::FATAL); ++i) {
+    if (level_name == level_ids[i]) {
+      set_min_level(static_cast<Level>(i));
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Returns whether messages of a category are logged.
+ * \param category A category.
+ * \return \c true if this category is enabled.
+ */
+SOLARUS_API bool is_category_enabled(const std::string& category) {
+
+  if (!has_disabled_categories) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(categories_mutex);
+  return disabled_categories.find(category) == disabled_categories.end();
+}
+
+/**
+ * \brief Enables or disables the messages of a category.
+ *
+ * All categories are enabled by default.
+ *
+ * \param category A category.
+ * \param enabled \c true to log messages of this category.
+ */
+SOLARUS_API void set_category_enabled(const std::string& category, bool enabled) {
+
+  std::lock_guard<std::mutex> lock(categories_mutex);
+  if (enabled) {
+    disabled_categories.erase(category);
+  }
+  else {
+    disabled_categories.insert(category);
+  }
+  has_disabled_categories = !disabled_categories.empty();
+}
+
+/**
+ * \brief Returns whether a message would be logged.
+ *
+ * Use this to avoid building messages that would be filtered.
+ *
+ * \param level Level of the message.
+ * \param category Category of the message.
+ * \return \c true if such a message is logged.
+ */
+SOLARUS_API bool is_enabled(Level level, const std::string& category) {
+
+  return static_cast<int>(level) >= min_level.load() &&
+      is_category_enabled(category);
+}
+
+/**
+ * \brief Returns how messages are written.
+ * \return The output format.
+ */
+SOLARUS_API Format get_format() {
+  return static_cast<Format>(format.load());
+}
+
+/**
+ * \brief Sets how messages are written on stdout.
+ *
+ * error.txt is always written as text.
+ *
+ * \param format The output format.
+ */
+SOLARUS_API void set_format(Format format) {
+
+  flush();
+  Logger::format = static_cast<int>(format);
+}
+
+/**
+ * \brief Sets how messages are written on stdout from the name of a format.
+ * \param format_name "text" or "json".
+ * \return \c false if the name is invalid.
+ */
+SOLARUS_API bool set_format(const std::string& format_name) {
+
+  if (format_name == "text") {
+    set_format(Format::TEXT);
+    return true;
+  }
+  if (format_name == "json") {
+    set_format(Format::JSON);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * \brief Returns whether messages are written by a background thread.
+ * \return \c true in asynchronous mode.
+ */
+SOLARUS_API bool is_asynchronous() {
+  return std::atomic_load(&async_writer) != nullptr;
+}
+
+/**
+ * \brief Sets whether messages are written by a background thread.
+ *
+ * When disabling it, pending messages are written first.
+ * Other threads may keep logging: messages they are pushing at the same time
+ * are still written by the background thread before it stops.
+ * Enabling and disabling must be done by the same thread.
+ *
+ * \param asynchronous \c true to enable the asynchronous mode.
+ */
+SOLARUS_API void set_asynchronous(bool asynchronous) {
+
+  if (asynchronous == is_asynchronous()) {
+    return;
+  }
+
+  if (asynchronous) {
+    std::atomic_store(&async_writer, std::make_shared<AsyncWriter>());
+  }
+  else {
+    // The last thread that uses the writer stops it.
+    std::atomic_store(&async_writer, std::shared_ptr<AsyncWriter>());
+  }
+}
+
+/**
+ * \brief Waits until all messages logged so far are written.
+ *
+ * Call this before writing on stdout without the logger.
+ */
+SOLARUS_API void flush() {
+
+  const std::shared_ptr<AsyncWriter> writer = std::atomic_load(&async_writer);
+  if (writer != nullptr) {
+    writer->flush();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(write_mutex);
+  flush_streams();
+}
+
+/**
+ * \brief Sets a function to call with each line written on stdout.
+ *
+ * Lines are still written on stdout.
+ * Lines already logged are written before the handler changes.
+ *
+ * \param handler The function to call, or an empty function to remove
+ * the current one.
  */
-SOLARUS_API void fatal(const std::string& message) {
+SOLARUS_API void set_output_handler(const OutputHandler& handler) {
 
-  std::string prefixed_message = "Fatal: " + message;
-  print(prefixed_message);
-  print(prefixed_message, get_error_log_file());
+  flush();
+  std::lock_guard<std::mutex> lock(output_handler_mutex);
+  output_handler = handler;
 }
 
 }  // namespace Logger
@@ -15,25 +15,39 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Music.h"
+#include "solarus/audio/Sound.h"
+#include "solarus/core/AllocationTracker.h"
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/FontResource.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/Geometry.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
+#include "solarus/core/Random.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Settings.h"
 #include "solarus/core/String.h"
 #include "solarus/core/System.h"
+#include "solarus/core/Trace.h"
+#include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Texture.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -114,6 +128,36 @@ std::string get_quest_path(const Arguments& args) {
   return SOLARUS_DEFAULT_QUEST;
 }
 
+/**
+ * \brief Guesses the language that the quest will set at startup.
+ *
+ * This is the language of the default settings file if any,
+ * or the only language of the quest.
+ *
+ * \return The language code, or an empty string if it cannot be guessed.
+ */
+std::string get_startup_language() {
+
+  const std::string settings_file_name = "settings.dat";
+  if (!QuestFiles::get_quest_write_dir().empty() &&
+      QuestFiles::data_file_exists(settings_file_name)) {
+    Settings settings;
+    if (settings.load(settings_file_name)) {
+      const std::pair<std::string, bool>& language = settings.get_string(Settings::key_language);
+      if (language.second && CurrentQuest::has_language(language.first)) {
+        return language.first;
+      }
+    }
+  }
+
+  const std::map<std::string, std::string>& languages =
+      CurrentQuest::get_resources(ResourceType::LANGUAGE);
+  if (languages.size() == 1) {
+    return languages.begin()->first;
+  }
+  return "";
+}
+
 }  // Anonymous namespace.
 
 /**
@@ -128,11 +172,41 @@ MainLoop::MainLoop(const Arguments& args):
   exiting(false),
   debug_lag(0),
   turbo(false),
+  interpolation(false),
+  draw_rate(0),
+  background_mode("continue"),
+  window_hidden(false),
+  window_focused(true),
+  frame_timings(),
+  frame_timings_file_name(),
+  lua_profiler(),
+  lua_profile_file_name(),
+  trace_file_name(),
+  startup_manifest_file_name(),
+  input_recording(),
+  world_state_hash(),
+  performance_overlay(),
+  input_events(),
+  resource_watcher(),
+  thread_pool(ThreadPool::get_default_num_workers()),
   lua_commands(),
   lua_commands_mutex(),
+  lua_commands_pending(false),
   num_lua_commands_pushed(0),
   num_lua_commands_done(0) {
 
+  // Log settings.
+  const std::string& log_level_arg = args.get_argument_value("-log-level");
+  if (!log_level_arg.empty() && !Logger::set_min_level(log_level_arg)) {
+    Logger::warning("Ignoring invalid -log-level: '" + log_level_arg + "'");
+  }
+  const std::string& log_format_arg = args.get_argument_value("-log-format");
+  if (!log_format_arg.empty() && !Logger::set_format(log_format_arg)) {
+    Logger::warning("Ignoring invalid -log-format: '" + log_format_arg + "'");
+  }
+  // Don't let the simulation wait for stdout.
+  Logger::set_asynchronous(true);
+
   Logger::info(std::string("Solarus ") + SOLARUS_VERSION);
 
   // Main loop settings.
@@ -143,6 +217,64 @@ MainLoop::MainLoop(const Arguments& args):
   }
   const std::string& turbo_arg = args.get_argument_value("-turbo");
   turbo = (turbo_arg == "yes");
+  const std::string& interpolation_arg = args.get_argument_value("-interpolation");
+  interpolation = (interpolation_arg == "yes");
+  const std::string& deferred_present_arg = args.get_argument_value("-deferred-present");
+  Video::set_present_deferred(deferred_present_arg == "yes");
+  frame_timings_file_name = args.get_argument_value("-frame-timings-file");
+  lua_profile_file_name = args.get_argument_value("-lua-profile");
+  const std::string& perf_overlay_arg = args.get_argument_value("-perf-overlay");
+  performance_overlay.set_visible(perf_overlay_arg == "yes");
+  if (!lua_profile_file_name.empty()) {
+    // Start now to also measure the main script.
+    lua_profiler.set_enabled(true);
+  }
+  trace_file_name = args.get_argument_value("-trace-file");
+  if (!trace_file_name.empty()) {
+    if (Trace::is_enabled()) {
+      // Start now to also trace the loading of the quest.
+      Trace::start();
+    }
+    else {
+      Logger::warning("Ignoring -trace-file: this build has no trace markers (see the SOLARUS_TRACING option)");
+      trace_file_name.clear();
+    }
+  }
+  startup_manifest_file_name = args.get_argument_value("-record-startup-manifest");
+  if (!startup_manifest_file_name.empty()) {
+    uint32_t manifest_duration = 10;
+    const std::string& manifest_duration_arg = args.get_argument_value("-startup-manifest-duration");
+    if (!manifest_duration_arg.empty()) {
+      std::istringstream iss(manifest_duration_arg);
+      iss >> manifest_duration;
+    }
+    // Start now to also record the files read when opening the quest.
+    QuestFiles::start_manifest_recording(manifest_duration * 1000);
+  }
+  const std::string& tile_cache_radius_arg = args.get_argument_value("-tile-cache-radius");
+  if (!tile_cache_radius_arg.empty()) {
+    std::istringstream iss(tile_cache_radius_arg);
+    int tile_cache_radius = -1;
+    if (iss >> tile_cache_radius && tile_cache_radius >= 0) {
+      NonAnimatedRegions::set_cell_radius(tile_cache_radius);
+    }
+  }
+  const std::string& tile_cache_size_arg = args.get_argument_value("-tile-cache-size");
+  if (!tile_cache_size_arg.empty()) {
+    std::istringstream iss(tile_cache_size_arg);
+    int tile_cache_size = -1;
+    if (iss >> tile_cache_size && tile_cache_size >= 0) {
+      NonAnimatedRegions::set_max_memory_size(static_cast<int64_t>(tile_cache_size) * 1024 * 1024);
+    }
+  }
+  const std::string& texture_budget_arg = args.get_argument_value("-texture-budget");
+  if (!texture_budget_arg.empty()) {
+    std::istringstream iss(texture_budget_arg);
+    int texture_budget = -1;
+    if (iss >> texture_budget && texture_budget >= 0) {
+      Texture::set_memory_budget(static_cast<int64_t>(texture_budget) * 1024 * 1024);
+    }
+  }
 
   // Try to open the quest.
   const std::string& quest_path = get_quest_path(args);
@@ -152,11 +284,63 @@ MainLoop::MainLoop(const Arguments& args):
     return;
   }
 
+  // The quest resource list is now being parsed on a separate thread.
+  // Also read font files while SDL, audio and video initialize.
+  FontResource::preload_fonts();
+
+  // Read ahead the other files that the quest needs at startup, if known.
+  if (startup_manifest_file_name.empty()) {
+    QuestFiles::prefetch_files("startup_manifest.txt");
+  }
+
   // Initialize engine features (audio, video...).
   System::initialize(args);
 
-  // Read the quest resource list from data.
-  CurrentQuest::initialize();
+  // Parse the strings and dialogs of the quest while Lua starts.
+  const std::string& startup_language = get_startup_language();
+  if (!startup_language.empty()) {
+    CurrentQuest::preload_language(startup_language);
+  }
+
+  // Make the run reproducible if requested.
+  const std::string& random_seed_arg = args.get_argument_value("-random-seed");
+  if (!random_seed_arg.empty()) {
+    std::istringstream iss(random_seed_arg);
+    uint32_t random_seed = 0;
+    if (iss >> random_seed) {
+      Random::set_seed(random_seed);
+    }
+  }
+  const std::string& replay_input_arg = args.get_argument_value("-replay-input");
+  const std::string& record_input_arg = args.get_argument_value("-record-input");
+  if (!replay_input_arg.empty()) {
+    if (input_recording.start_replaying(replay_input_arg)) {
+      Random::set_seed(input_recording.get_random_seed());
+      Logger::info("Replaying input from '" + replay_input_arg + "'");
+    }
+  }
+  else if (!record_input_arg.empty()) {
+    if (input_recording.start_recording(record_input_arg, Random::get_seed())) {
+      Logger::info("Recording input to '" + record_input_arg + "'");
+    }
+  }
+  const std::string& world_hash_output_arg = args.get_argument_value("-world-hash-output");
+  const std::string& world_hash_reference_arg = args.get_argument_value("-world-hash-reference");
+  if (!world_hash_output_arg.empty()) {
+    if (world_state_hash.start_recording(world_hash_output_arg)) {
+      Logger::info("Recording world state hashes to '" + world_hash_output_arg + "'");
+    }
+  }
+  if (!world_hash_reference_arg.empty()) {
+    if (world_state_hash.start_checking(world_hash_reference_arg)) {
+      Logger::info("Checking world state hashes against '" + world_hash_reference_arg + "'");
+    }
+    else {
+      Debug::error("Cannot open world state hash reference '" + world_hash_reference_arg + "'");
+    }
+  }
+
+  // The quest resource list was read when opening the quest.
   TilePattern::initialize();
 
   // Read the quest general properties.
@@ -170,10 +354,10 @@ MainLoop::MainLoop(const Arguments& args):
   // Run the Lua world.
   // Do this after the creation of the window, but before showing the window,
   // because Lua might change the video mode initially.
+  // The window stays hidden until then, so that its final size and
+  // fullscreen state are applied at once.
   lua_context = std::unique_ptr<LuaContext>(new LuaContext(*this));
-  Video::show_window();
   lua_context->initialize();
-  Video::hide_window();
 
   // Set up the Lua console.
   const std::string& lua_console_arg = args.get_argument_value("-lua-console");
@@ -186,6 +370,19 @@ MainLoop::MainLoop(const Arguments& args):
     Logger::info("Lua console: no");
   }
 
+  // Reload changed resources while the quest runs.
+  const std::string& watch_resources_arg = args.get_argument_value("-watch-resources");
+  if (watch_resources_arg == "yes") {
+    if (QuestFiles::data_file_get_location("quest.dat") ==
+        QuestFiles::DataFileLocation::LOCATION_DATA_DIRECTORY) {
+      resource_watcher.set_enabled(true);
+      Logger::info("Watching resources: yes");
+    }
+    else {
+      Logger::warning("Ignoring -watch-resources: the quest is not a data directory");
+    }
+  }
+
   if (turbo) {
     Logger::info("Turbo mode: yes");
   }
@@ -193,7 +390,14 @@ MainLoop::MainLoop(const Arguments& args):
     Logger::info("Turbo mode: no");
   }
 
-  // Finally show the window.
+  if (interpolation && !turbo) {
+    Logger::info("Render interpolation: yes");
+  }
+  else {
+    Logger::info("Render interpolation: no");
+  }
+
+  // Finally show the window, once.
   Video::show_window();
 }
 
@@ -214,11 +418,15 @@ MainLoop::~MainLoop() {
   if (lua_context != nullptr) {
     lua_context->exit();
   }
+  resource_provider.clear();
+  Surface::finish_async_loads();
   TilePattern::quit();
   CurrentQuest::quit();
+  Savegame::wait_for_pending_saves();
   QuestFiles::close_quest();
   System::quit();
   quit_lua_console();
+  Logger::set_asynchronous(false);
 }
 
 /**
@@ -237,6 +445,85 @@ ResourceProvider& MainLoop::get_resource_provider() {
   return resource_provider;
 }
 
+/**
+ * \brief Returns the duration of each phase of the last frames.
+ * \return The frame timings.
+ */
+const FrameTimings& MainLoop::get_frame_timings() const {
+  return frame_timings;
+}
+
+/**
+ * \brief Returns the duration of each phase of the last frames.
+ *
+ * Non-const version, for programs that call step() themselves and measure
+ * frames with FrameTimings::start_frame() and FrameTimings::finish_frame().
+ *
+ * \return The frame timings.
+ */
+FrameTimings& MainLoop::get_frame_timings() {
+  return frame_timings;
+}
+
+/**
+ * \brief Returns the profiler of Lua callbacks.
+ * \return The Lua profiler.
+ */
+LuaProfiler& MainLoop::get_lua_profiler() {
+  return lua_profiler;
+}
+
+/**
+ * \brief Returns the worker threads available to the simulation.
+ *
+ * Work given to them must not run Lua code nor depend on the order
+ * of execution.
+ *
+ * \return The thread pool.
+ */
+ThreadPool& MainLoop::get_thread_pool() {
+  return thread_pool;
+}
+
+/**
+ * \brief Returns what the main loop does while the window is unfocused
+ * or hidden.
+ * \return "continue", "throttle" or "pause".
+ */
+const std::string& MainLoop::get_background_mode() const {
+  return background_mode;
+}
+
+/**
+ * \brief Sets what the main loop does while the window is unfocused
+ * or hidden.
+ *
+ * Nothing is drawn while the window is hidden, whatever the mode.
+ * With "throttle", the simulation is done in bursts of several steps
+ * a few times per second, so the simulated time stays in sync with the
+ * real time.
+ * With "pause", no step is done and the simulated time stops:
+ * System::now() continues from the same value when the window comes back.
+ *
+ * \param background_mode "continue", "throttle" or "pause".
+ */
+void MainLoop::set_background_mode(const std::string& background_mode) {
+
+  Debug::check_assertion(background_mode == "continue" ||
+      background_mode == "throttle" ||
+      background_mode == "pause",
+      "Invalid background mode: '" + background_mode + "'");
+  this->background_mode = background_mode;
+}
+
+/**
+ * \brief Returns whether the window is unfocused or hidden.
+ * \return \c true if the background mode applies.
+ */
+bool MainLoop::is_in_background() const {
+  return window_hidden || !window_focused;
+}
+
 /**
  * \brief Returns whether the user just closed the window.
  *
@@ -301,14 +588,40 @@ void MainLoop::set_game(Game* game) {
  * This function is thread safe, it can be called from a separate thread
  * while the main loop is running.
  *
+ * The command may start with a prefix \c "@<id> " to choose the number
+ * reported in its delimiters, so that a tool sending many commands can match
+ * each output to its request.
+ * This prefix is not valid Lua, so it cannot be confused with code.
+ * Otherwise, commands are numbered in the order they are pushed.
+ *
  * \param command The Lua string to execute.
  * \return A number identifying your command.
  */
 int MainLoop::push_lua_command(const std::string& command) {
 
+  LuaCommand lua_command = { 0, command };
+  bool explicit_id = false;
+  if (command.size() > 1 && command[0] == '@') {
+    const size_t space_index = command.find(' ');
+    const std::string& id = command.substr(1, space_index - 1);
+    if (space_index != std::string::npos &&
+        !id.empty() &&
+        id.size() < 10 &&
+        std::all_of(id.begin(), id.end(), [](char c) { return std::isdigit(c); })) {
+      lua_command.id = std::stoi(id);
+      lua_command.code = command.substr(space_index + 1);
+      explicit_id = true;
+    }
+  }
+
   std::lock_guard<std::mutex> lock(lua_commands_mutex);
-  lua_commands.push_back(command);
-  return num_lua_commands_pushed++;
+  if (!explicit_id) {
+    lua_command.id = num_lua_commands_pushed;
+  }
+  ++num_lua_commands_pushed;
+  lua_commands.emplace_back(std::move(lua_command));
+  lua_commands_pending = true;
+  return lua_commands.back().id;
 }
 
 /**
@@ -335,6 +648,13 @@ void MainLoop::run() {
   // The main loop basically repeats
   // check_input(), update(), draw() and sleep().
   // Each call to update() makes the simulated time advance one fixed step.
+  // With render interpolation, draw() is called at every iteration instead,
+  // synchronized with the display refresh rate, and nothing sleeps.
+  const bool interpolating = interpolation && !turbo;
+
+  // With a draw rate, draws are skipped until the next draw date
+  // while the simulation keeps its own rate.
+  double next_draw_date = 0.0;
 
   while (!is_exiting()) {
 
@@ -346,18 +666,33 @@ void MainLoop::run() {
     // At this point, lag represents how much late the simulated time with
     // compared to the real time.
 
-    if (lag >= 200) {
+    frame_timings.start_frame(System::get_real_time());
+    const double frame_start_time = FrameTimings::get_time();
+
+    const bool background = is_in_background() && !turbo;
+    const bool paused = background && background_mode == "pause";
+    const bool throttled = background && background_mode == "throttle";
+    if (paused) {
+      // The simulated time stops with the simulation.
+      frame_timings.add_time_dropped(lag);
+      time_dropped += lag;
+      lag = 0;
+    }
+    else if (lag >= 200) {
       // Huge lag: don't try to catch up.
       // Maybe we have just made a one-time heavy operation like loading a
       // big file, or the process was just unsuspended.
       // Let's fake the real time instead.
+      frame_timings.add_time_dropped(lag - System::timestep);
       time_dropped += lag - System::timestep;
       lag = System::timestep;
       last_frame_date = System::get_real_time() - time_dropped;
     }
 
     // 1. Detect and handle input events.
+    const double input_start_time = FrameTimings::get_time();
     check_input();
+    frame_timings.add_phase_time(FrameTimings::Phase::INPUT, input_start_time);
 
     // 2. Update the world once, or several times (skipping some draws)
     // to catch up if the system is slow.
@@ -379,23 +714,118 @@ void MainLoop::run() {
     }
 
     // 3. Redraw the screen.
-    if (num_updates > 0) {
-      draw();
+    // With a deferred present, the previous frame is shown now that
+    // the simulation is done.
+    Video::present();
+    bool screen_updated = false;
+    bool draw_wanted = !window_hidden && (interpolating || num_updates > 0 || paused);
+    if (draw_wanted && draw_rate > 0 && !turbo) {
+      // Accept a draw up to half a step early, so that the rate is kept
+      // on average even if it is not a multiple of the simulation rate.
+      draw_wanted = now + System::timestep / 2.0 >= next_draw_date;
+      if (draw_wanted) {
+        next_draw_date = std::max(next_draw_date + 1000.0 / draw_rate, static_cast<double>(now));
+      }
+    }
+    if (draw_wanted) {
+      if (interpolating) {
+        // Draw between the last two simulation steps,
+        // depending on the time not simulated yet.
+        System::set_interpolation_factor(
+            static_cast<double>(lag) / System::timestep
+        );
+        screen_updated = draw();
+        System::set_interpolation_factor(1.0);
+      }
+      else {
+        draw();
+      }
+      Texture::enforce_memory_budget();
     }
+    Video::update_dynamic_resolution(
+        FrameTimings::get_time() - frame_start_time,
+        draw_wanted,
+        draw_rate > 0 ? 1000.0 / draw_rate : 1000.0 / 60.0
+    );
 
-    // 4. Sleep if we have time, to save CPU and GPU cycles.
+    // 4. Collect Lua garbage in the remaining time.
+    last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
+    if (lua_context->is_garbage_collector_driven()) {
+      const int idle_time = turbo ? 0 :
+          static_cast<int>(System::timestep) - static_cast<int>(last_frame_duration);
+      const int gc_time = std::min(
+          idle_time - 1,  // Keep some margin to wake up on time.
+          CurrentQuest::get_properties().get_lua_gc_step_time()
+      );
+      const double gc_start_time = FrameTimings::get_time();
+      lua_context->step_garbage_collector(std::max(gc_time, 0));
+      frame_timings.add_phase_time(FrameTimings::Phase::GC, gc_start_time);
+    }
+
+    // 5. Sleep if we have time, to save CPU and GPU cycles.
     if (debug_lag > 0 && !turbo) {
       // Extra sleep time for debugging, useful to simulate slower systems.
       System::sleep(debug_lag);
     }
 
     last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
-    if (last_frame_duration < System::timestep && !turbo) {
+    if (paused || throttled) {
+      // Wake up only a few times per second in background.
+      if (last_frame_duration < background_period) {
+        System::sleep(background_period - last_frame_duration);
+      }
+    }
+    // When interpolating, presenting the screen waits for the display refresh,
+    // so only sleep if an unchanged frame was skipped.
+    else if (last_frame_duration < System::timestep && !turbo && (!interpolating || !screen_updated)) {
       System::sleep(System::timestep - last_frame_duration);
     }
+
+    const RenderTexture::ReadbackStatistics readbacks = RenderTexture::take_readback_statistics();
+    frame_timings.add_readbacks(readbacks.num_readbacks, readbacks.num_full_readbacks);
+    frame_timings.add_draw_calls(SpriteBatch::take_num_draw_calls());
+    frame_timings.finish_frame();
+    AllocationTracker::finish_frame();
   }
 
   Logger::info("Simulation finished");
+
+  if (!frame_timings_file_name.empty()) {
+    if (frame_timings.save_csv(frame_timings_file_name)) {
+      Logger::info("Frame timings saved to '" + frame_timings_file_name + "'");
+    }
+    else {
+      Logger::error("Failed to save frame timings to '" + frame_timings_file_name + "'");
+    }
+  }
+
+  if (!lua_profile_file_name.empty()) {
+    if (lua_profiler.save_folded(lua_profile_file_name)) {
+      Logger::info("Lua profile saved to '" + lua_profile_file_name + "'");
+    }
+    else {
+      Logger::error("Failed to save Lua profile to '" + lua_profile_file_name + "'");
+    }
+  }
+
+  if (!trace_file_name.empty()) {
+    Trace::stop();
+    if (Trace::save_json(trace_file_name)) {
+      Logger::info("Trace saved to '" + trace_file_name + "'");
+    }
+    else {
+      Logger::error("Failed to save trace to '" + trace_file_name + "'");
+    }
+  }
+
+  if (!startup_manifest_file_name.empty()) {
+    if (QuestFiles::save_manifest(startup_manifest_file_name)) {
+      Logger::info("Startup manifest saved to '" + startup_manifest_file_name + "'");
+    }
+    else {
+      Logger::error("Failed to save startup manifest to '" + startup_manifest_file_name + "'");
+    }
+  }
 }
 
 /**
@@ -406,11 +836,51 @@ void MainLoop::run() {
  */
 void MainLoop::step() {
 
+  AllocationTracker::ScopeMarker allocation_scope(AllocationTracker::Scope::STEP);
+  SOLARUS_TRACE_SCOPE("MainLoop::step");
+
+  // Replayed events come at the simulated time they were recorded.
+  if (input_recording.is_replaying()) {
+    std::unique_ptr<InputEvent> event = input_recording.get_replayed_event(System::now());
+    while (event != nullptr) {
+      notify_input(*event);
+      event = input_recording.get_replayed_event(System::now());
+    }
+  }
+
+  for (const std::string& file_name: resource_watcher.update()) {
+    notify_resource_file_changed(file_name);
+  }
+  Surface::update_async_loads();
+  resource_provider.update();
+
+  double start_time = FrameTimings::get_time();
   if (game != nullptr) {
     game->update();
   }
+  frame_timings.add_phase_time(FrameTimings::Phase::GAME, start_time);
+
+  start_time = FrameTimings::get_time();
   lua_context->update();
+  frame_timings.add_phase_time(FrameTimings::Phase::LUA, start_time);
+
+  start_time = FrameTimings::get_time();
   System::update();
+  frame_timings.add_phase_time(FrameTimings::Phase::SYSTEM, start_time);
+  frame_timings.add_update();
+
+  if (Trace::is_recording()) {
+    std::vector<std::pair<std::string, int64_t>> memory_values;
+    for (const MemoryStats::Entry& entry: MemoryStats::get_report(*lua_context)) {
+      memory_values.emplace_back(entry.name, entry.num_bytes);
+    }
+    Trace::add_counters("memory_bytes", memory_values);
+  }
+
+  if (world_state_hash.is_enabled() &&
+      !world_state_hash.add_tick(WorldStateHash::compute(*this))) {
+    Debug::die(world_state_hash.get_divergence());
+  }
 
   // Go to another game?
   if (next_game != game.get()) {
@@ -428,36 +898,86 @@ void MainLoop::step() {
   }
 }
 
+/**
+ * \brief Reloads what depends on a data file modified on disk.
+ *
+ * Sprites, the tileset of the current map, dialogs and strings
+ * are replaced without restarting.
+ * Other resources like maps, images and Lua scripts are reloaded
+ * the next time they are used.
+ *
+ * \param file_name Name of the changed file relative to the data directory.
+ */
+void MainLoop::notify_resource_file_changed(const std::string& file_name) {
+
+  Logger::info("Reloading '" + file_name + "'");
+  resource_provider.notify_file_changed(file_name);
+
+  const auto& starts_with = [&file_name](const std::string& prefix) {
+    return file_name.compare(0, prefix.size(), prefix) == 0;
+  };
+  const std::string lua_extension = ".lua";
+  if (file_name.size() > lua_extension.size() &&
+      file_name.compare(file_name.size() - lua_extension.size(), lua_extension.size(), lua_extension) == 0) {
+    lua_context->notify_script_changed(file_name.substr(0, file_name.size() - lua_extension.size()));
+    return;
+  }
+
+  if (starts_with("tilesets/") && game != nullptr && game->has_current_map()) {
+    Map& map = game->get_current_map();
+    const std::string& tileset_prefix = "tilesets/" + map.get_tileset_id() + ".";
+    if (map.is_started() && starts_with(tileset_prefix)) {
+      map.set_tileset(map.get_tileset_id());
+    }
+    return;
+  }
+
+  if (starts_with("languages/")) {
+    // Other languages kept in memory are outdated too.
+    CurrentQuest::forget_previous_languages();
+  }
+  const std::string& language = CurrentQuest::get_language();
+  if (!language.empty() && starts_with("languages/" + language + "/text/")) {
+    CurrentQuest::set_language(language);
+  }
+}
+
 /**
  * \brief Detects whether there were input events and if yes, handles them.
  */
 void MainLoop::check_input() {
 
   // Check SDL events.
-  std::unique_ptr<InputEvent> event = InputEvent::get_event();
-  while (event != nullptr) {
-    notify_input(*event);
-    event = InputEvent::get_event();
+  // During a replay, recorded kinds of events only come from the recording.
+  InputEvent::get_events(input_events);
+  for (const InputEvent& event: input_events) {
+    if (!input_recording.is_replaying() || !InputRecording::is_recordable(event)) {
+      input_recording.record_event(event, System::now());
+      notify_input(event);
+    }
   }
 
   // Check Lua requests.
-  if (!lua_commands.empty()) {
-    std::lock_guard<std::mutex> lock(lua_commands_mutex);
-    for (const std::string& command : lua_commands) {
-      std::cout << "\n";  // To make sure that the command delimiter starts on a new line.
-      Logger::info("====== Begin Lua command #" + String::to_string(num_lua_commands_done) + " ======");
-      const bool success = LuaTools::do_string(get_lua_context().get_internal_state(), command, "Lua command");
-      if (success) {
-        std::cout << "\n";
-        Logger::info("====== End Lua command #" + String::to_string(num_lua_commands_done) + ": success ======");
-      }
-      else {
-        std::cout << "\n";
-        Logger::info("====== End Lua command #" + String::to_string(num_lua_commands_done) + ": error ======");
-      }
+  if (lua_commands_pending) {
+    // Take the commands and run them without holding the lock,
+    // so that the console thread is never blocked by a long command.
+    std::vector<LuaCommand> commands;
+    {
+      std::lock_guard<std::mutex> lock(lua_commands_mutex);
+      commands.swap(lua_commands);
+      lua_commands_pending = false;
+    }
+    for (const LuaCommand& command : commands) {
+      const std::string& id = String::to_string(command.id);
+      Logger::print_output("");  // To make sure that the command delimiter starts on a new line.
+      Logger::info("====== Begin Lua command #" + id + " ======");
+      // The command may also write to stdout directly with io.write().
+      Logger::flush();
+      const bool success = run_lua_command(command.code);
+      Logger::print_output("");
+      Logger::info("====== End Lua command #" + id + ": " + (success ? "success" : "error") + " ======");
       ++num_lua_commands_done;
     }
-    lua_commands.clear();
   }
 }
 
@@ -472,6 +992,17 @@ void MainLoop::notify_input(const InputEvent& event) {
   if (event.is_window_closing()) {
     set_exiting();
   }
+  else if (event.is_window_event()) {
+    // The window content may have been lost.
+    Video::invalidate_screen();
+    notify_window_event(event);
+  }
+  else if (event.is_keyboard_key_pressed(InputEvent::KeyboardKey::F12) &&
+      event.is_with_control()) {
+    // Debug key: not forwarded to the quest.
+    performance_overlay.set_visible(!performance_overlay.is_visible());
+    return;
+  }
   else if (event.is_keyboard_key_pressed()) {
     // A key was pressed.
 #if defined(PANDORA)
@@ -489,12 +1020,51 @@ void MainLoop::notify_input(const InputEvent& event) {
   }
 }
 
+/**
+ * \brief Updates the state of the window from a window event.
+ *
+ * sol.main:on_window_state_changed() is called if the state changes.
+ *
+ * \param event A window event.
+ */
+void MainLoop::notify_window_event(const InputEvent& event) {
+
+  const bool was_hidden = window_hidden;
+  const bool was_focused = window_focused;
+  if (event.is_window_hidden()) {
+    window_hidden = true;
+  }
+  else if (event.is_window_shown()) {
+    window_hidden = false;
+  }
+  else if (event.is_window_focus_lost()) {
+    window_focused = false;
+  }
+  else if (event.is_window_focus_gained()) {
+    window_focused = true;
+  }
+
+  if (window_hidden == was_hidden && window_focused == was_focused) {
+    return;
+  }
+
+  const std::string state = window_hidden ? "hidden" : (window_focused ? "visible" : "unfocused");
+  Logger::info("Window state: " + state);
+  lua_context->main_on_window_state_changed(state);
+}
+
 /**
  * \brief Redraws the current screen.
  *
  * This function is called repeatedly by the main loop.
+ *
+ * \return \c true if the screen was updated, \c false if the frame
+ * was identical to the previous one.
  */
-void MainLoop::draw() {
+bool MainLoop::draw() {
+
+  SOLARUS_TRACE_SCOPE("MainLoop::draw");
+  const double start_time = FrameTimings::get_time();
 
   root_surface->clear();
 
@@ -502,7 +1072,11 @@ void MainLoop::draw() {
     game->draw(root_surface);
   }
   lua_context->main_on_draw(root_surface);
-  Video::render(root_surface);
+  performance_overlay.draw(root_surface, frame_timings, *lua_context, game.get());
+  const bool screen_updated = Video::render(root_surface, &thread_pool);
+
+  frame_timings.add_phase_time(FrameTimings::Phase::DRAW, start_time);
+  return screen_updated;
 }
 
 /**
@@ -534,6 +1108,12 @@ void MainLoop::load_quest_properties() {
       properties.get_max_quest_size()
   );
 
+  Video::set_compact_textures_enabled(properties.is_compact_textures_enabled());
+  Sound::set_streaming_duration(static_cast<uint32_t>(properties.get_sound_streaming_duration()));
+  Video::set_vsync(properties.get_vsync());
+  draw_rate = properties.get_draw_rate();
+  background_mode = properties.get_background_mode();
+  Geometry::set_trigonometry_tables_enabled(properties.are_movements_deterministic());
 }
 
 /**
@@ -562,6 +1142,39 @@ void MainLoop::initialize_lua_console() {
   stdin_thread.detach();
 }
 
+/**
+ * \brief Executes a Lua command received on the console.
+ *
+ * Values returned by the command are printed like with print(),
+ * so that tools can query the engine without wrapping commands.
+ *
+ * \param code The Lua code to execute.
+ * \return \c true in case of success.
+ */
+bool MainLoop::run_lua_command(const std::string& code) {
+
+  lua_State* l = get_lua_context().get_internal_state();
+  const int top = lua_gettop(l);
+  if (luaL_loadstring(l, code.c_str()) != 0) {
+    Debug::error(std::string("In Lua command: ") + lua_tostring(l, -1));
+    lua_settop(l, top);
+    return false;
+  }
+  if (!LuaTools::call_function(l, 0, LUA_MULTRET, "Lua command")) {
+    return false;
+  }
+
+  const int num_results = lua_gettop(l) - top;
+  bool success = true;
+  if (num_results > 0) {
+    lua_getglobal(l, "print");
+    lua_insert(l, top + 1);
+    success = LuaTools::call_function(l, num_results, 0, "Lua command");
+  }
+  lua_settop(l, top);
+  return success;
+}
+
 /**
  * \brief Cleans resources started by initialize_lua_console().
  */
@@ -17,24 +17,70 @@
 #include "solarus/audio/Music.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
+#include "solarus/core/Trace.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/GroundInfo.h"
+#include "solarus/entities/GroundRaster.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/NonAnimatedRegions.h"
-#include "solarus/entities/TilePattern.h"
+#include "solarus/entities/ObstacleTable.h"
+#include "solarus/entities/ProjectilePool.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/Surface.h"
-#include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Returns the pixels of the border of a rectangle in an 8x8 square.
+ * \param box A rectangle.
+ * \param square_x X coordinate of the square, multiple of 8.
+ * \param square_y Y coordinate of the square, multiple of 8.
+ * \return The border pixels in the layout of
+ * GroundRaster::get_wall_square_mask().
+ */
+uint64_t get_border_square_mask(const Rectangle& box, int square_x, int square_y) {
+
+  // Coordinates of the rectangle relative to the square (may be outside).
+  const int x1 = box.get_x() - square_x;
+  const int x2 = x1 + box.get_width() - 1;
+  const int y1 = box.get_y() - square_y;
+  const int y2 = y1 + box.get_height() - 1;
+  if (x2 < 0 || x1 > 7 || y2 < 0 || y1 > 7) {
+    return 0;
+  }
+
+  // Row bytes have the leftmost pixel in the most significant bit.
+  const uint8_t full_row = static_cast<uint8_t>(
+      (0xFF >> std::max(x1, 0)) & (0xFF << (7 - std::min(x2, 7))));
+  uint8_t sides_row = 0;
+  if (x1 >= 0) {
+    sides_row |= static_cast<uint8_t>(0x80 >> x1);
+  }
+  if (x2 <= 7) {
+    sides_row |= static_cast<uint8_t>(0x80 >> x2);
+  }
+
+  uint64_t mask = 0;
+  for (int y = std::max(y1, 0); y <= std::min(y2, 7); ++y) {
+    const uint8_t row = (y == y1 || y == y2) ? full_row : sides_row;
+    mask |= uint64_t(row) << (56 - (y << 3));
+  }
+  return mask;
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a map.
  * \param id Id of the map, used to determine the data file and
@@ -49,14 +95,21 @@ Map::Map(const std::string& id):
   min_layer(0),
   max_layer(0),
   tileset(nullptr),
+  used_tilesets(),
   floor(MapData::NO_FLOOR),
-  background_surface(nullptr),
-  foreground_surface(nullptr),
+  entity_cell_size(0),
+  activity_distance(0),
+  foreground_bars(),
   loaded(false),
   started(false),
   destination_name(""),
+  path_finding_workspace(),
+  path_finding_cache(*this),
   entities(nullptr),
-  suspended(false) {
+  projectile_pools(),
+  overview(nullptr),
+  suspended(false),
+  drawing_camera(nullptr) {
 
 }
 
@@ -83,16 +136,49 @@ const std::string& Map::get_tileset_id() const {
  * i.e. every tile of the previous tileset must exist in the new one
  * and have the same properties.
  *
+ * If both tilesets are siblings (same patterns, different images),
+ * tiles keep their patterns and only their image changes.
+ *
  * \param tileset_id Id of the new tileset.
  */
 void Map::set_tileset(const std::string& tileset_id) {
 
   Debug::check_assertion(is_game_running(), "The game of this map does not exist");
   ResourceProvider& resource_provider = get_game().get_resource_provider();
-  tileset = &resource_provider.get_tileset(tileset_id);
-  get_entities().notify_tileset_changed();
+  std::shared_ptr<const Tileset> old_tileset = tileset;
+  tileset = resource_provider.get_tileset(tileset_id);
+  used_tilesets[tileset_id] = tileset;
+
+  // Patterns of the old tileset are only kept in memory if it is still used
+  // under its own id.
+  const bool same_patterns =
+      tileset_id != this->tileset_id &&
+      tileset->has_same_patterns(*old_tileset);
+  get_entities().notify_tileset_changed(*old_tileset, *tileset, same_patterns);
   this->tileset_id = tileset_id;
-  build_background_surface();
+}
+
+/**
+ * \brief Returns a tileset used by some tiles of this map.
+ *
+ * The tileset stays in memory until the map is unloaded,
+ * since tiles refer to its patterns.
+ *
+ * \param tileset_id Id of the tileset.
+ * \return The tileset.
+ */
+const Tileset& Map::get_used_tileset(const std::string& tileset_id) {
+
+  const auto& it = used_tilesets.find(tileset_id);
+  if (it != used_tilesets.end()) {
+    return *it->second;
+  }
+
+  Debug::check_assertion(is_game_running(), "The game of this map does not exist");
+  ResourceProvider& resource_provider = get_game().get_resource_provider();
+  std::shared_ptr<const Tileset> used_tileset = resource_provider.get_tileset(tileset_id);
+  used_tilesets[tileset_id] = used_tileset;
+  return *used_tileset;
 }
 
 /**
@@ -157,6 +243,39 @@ void Map::set_floor(int floor) {
   this->floor = floor;
 }
 
+/**
+ * \brief Returns the side of the grid cells used to locate entities.
+ * \return The cell size in pixels, or 0 if entities use a quadtree.
+ */
+int Map::get_entity_cell_size() const {
+  return entity_cell_size;
+}
+
+/**
+ * \brief Returns the distance from the camera beyond which entities
+ * become dormant.
+ * \return The distance in pixels, or 0 if all entities stay active.
+ */
+int Map::get_activity_distance() const {
+  return activity_distance;
+}
+
+/**
+ * \brief Sets the distance from the camera beyond which entities
+ * become dormant.
+ *
+ * Dormant entities are suspended and skipped by updates until they come
+ * close to the camera again, unless they are always active.
+ *
+ * \param activity_distance The distance in pixels,
+ * or 0 to keep all entities active.
+ */
+void Map::set_activity_distance(int activity_distance) {
+
+  Debug::check_assertion(activity_distance >= 0, "Invalid activity distance");
+  this->activity_distance = activity_distance;
+}
+
 /**
  * \brief Returns the location of this map in its context.
  *
@@ -263,8 +382,10 @@ void Map::unload() {
 
   if (is_loaded()) {
     tileset = nullptr;
-    background_surface = nullptr;
-    foreground_surface = nullptr;
+    used_tilesets.clear();
+    foreground_bars.clear();
+    projectile_pools.clear();
+    overview = nullptr;
     entities = nullptr;
     game = nullptr;
 
@@ -281,24 +402,15 @@ void Map::unload() {
  */
 void Map::load(Game& game) {
 
-  background_surface = Surface::create(
-      Video::get_quest_size()
-  );
-
-  // Read the map data file.
-  MapData data;
-  const std::string& file_name = std::string("maps/") + get_id() + ".dat";
-  bool success = data.import_from_quest_file(file_name);
-
-  if (!success) {
-    Debug::die("Failed to load map data file '" + file_name + "'");
-  }
+  // Read the map data file, unless it was preloaded or cached.
+  ResourceProvider& resource_provider = game.get_resource_provider();
+  std::shared_ptr<const MapData> map_data = resource_provider.get_map_data(get_id());
+  const MapData& data = *map_data;
 
   // Initialize the map from the data just read.
   this->game = &game;
   this->savegame = std::static_pointer_cast<Savegame>(
         game.get_savegame().shared_from_this());  // TODO make Game::get_savegame() return a shared_ptr.
-  ResourceProvider& resource_provider = game.get_resource_provider();
   location.set_xy(data.get_location());
   location.set_size(data.get_size());
   width8 = data.get_size().width / 8;
@@ -309,12 +421,15 @@ void Map::load(Game& game) {
   set_world(data.get_world());
   set_floor(data.get_floor());
   tileset_id = data.get_tileset_id();
-  tileset = &resource_provider.get_tileset(tileset_id);
+  entity_cell_size = data.get_entity_cell_size();
+  activity_distance = data.get_activity_distance();
+  tileset = resource_provider.get_tileset(tileset_id);
+  used_tilesets[tileset_id] = tileset;
+  resource_provider.load_animation_sets(data, game.get_main_loop().get_thread_pool());
   entities = std::unique_ptr<Entities>(new Entities(game, *this));
   entities->create_entities(data);
 
-  build_background_surface();
-  build_foreground_surface();
+  build_foreground_bars();
 
   loaded = true;
 }
@@ -463,7 +578,7 @@ SurfacePtr Map::get_camera_surface() {
   if (!is_loaded()) {
     return nullptr;
   }
-  const CameraPtr& camera = get_camera();
+  const CameraPtr& camera = get_drawing_camera();
   if (camera == nullptr) {
     return nullptr;
   }
@@ -498,20 +613,86 @@ bool Map::notify_input(const InputEvent& event) {
   return handled;
 }
 
+/**
+ * \brief Adds projectiles to this map.
+ * \param projectile_pool The projectiles to move, collide and draw
+ * with the map.
+ */
+void Map::add_projectile_pool(const std::shared_ptr<ProjectilePool>& projectile_pool) {
+  projectile_pools.push_back(projectile_pool);
+}
+
+/**
+ * \brief Removes projectiles from this map.
+ * \param projectile_pool The projectiles to remove.
+ * Nothing happens if they are not on this map.
+ */
+void Map::remove_projectile_pool(ProjectilePool& projectile_pool) {
+
+  projectile_pools.erase(std::remove_if(
+      projectile_pools.begin(),
+      projectile_pools.end(),
+      [&projectile_pool](const std::shared_ptr<ProjectilePool>& element) {
+    return element.get() == &projectile_pool;
+  }), projectile_pools.end());
+}
+
+/**
+ * \brief Returns the overview image of this map, creating it if needed.
+ *
+ * The map must be loaded.
+ *
+ * \return The overview.
+ */
+MapOverview& Map::get_overview() {
+
+  Debug::check_assertion(is_loaded(), "This map is not loaded");
+  if (overview == nullptr) {
+    overview = std::unique_ptr<MapOverview>(new MapOverview(*this));
+  }
+  return *overview;
+}
+
 /**
  * \brief Updates the animation and the position of each map elements, including the hero.
  */
 void Map::update() {
 
+  SOLARUS_TRACE_SCOPE("Map::update");
+
   // detect whether the game has just been suspended or resumed
   check_suspended();
 
   // update the elements
-  TilePattern::update();
   entities->update();
+  update_projectile_pools();
+  if (overview != nullptr) {
+    overview->update();
+  }
   get_lua_context().map_on_update(*this);
 }
 
+/**
+ * \brief Moves the projectiles of the map and notifies what they hit.
+ */
+void Map::update_projectile_pools() {
+
+  if (projectile_pools.empty()) {
+    return;
+  }
+
+  // Hit callbacks may add or remove pools.
+  const std::vector<std::shared_ptr<ProjectilePool>> pools = projectile_pools;
+  std::vector<ProjectilePool::Hit> hits;
+  for (const std::shared_ptr<ProjectilePool>& projectile_pool: pools) {
+    hits.clear();
+    projectile_pool->update(*this, hits);
+    if (!hits.empty()) {
+      get_lua_context().projectile_pool_on_hits(*projectile_pool, hits);
+    }
+  }
+}
+
 /**
  * \brief Returns whether the map is currently suspended.
  * \return true if the map is suspended.
@@ -537,60 +718,70 @@ void Map::check_suspended() {
 }
 
 /**
- * \brief Draws the map with all its entities on the screen.
+ * \brief Draws the map with all its entities on the surface of each camera.
+ *
+ * The visibility of entities is computed once for all cameras,
+ * and tiles cells are shared between them.
  */
 void Map::draw() {
 
-  if (!is_loaded()) {
-    return;
-  }
+  SOLARUS_TRACE_SCOPE("Map::draw");
 
-  const SurfacePtr& camera_surface = get_camera_surface();
-
-  if (camera_surface == nullptr) {
+  if (!is_loaded() || get_camera() == nullptr) {
     return;
   }
 
-  // background
-  draw_background(camera_surface);
+  entities->prepare_drawing();
 
-  // draw all entities (including the hero)
-  entities->draw();
+  // Iterate with an index because Lua code may add or remove cameras.
+  for (size_t i = 0; i < get_cameras().size(); ++i) {
+    drawing_camera = get_cameras()[i];
+    const SurfacePtr& camera_surface = drawing_camera->get_surface();
 
-  // foreground
-  draw_foreground(camera_surface);
+    // background
+    draw_background(camera_surface);
 
-  // Lua
-  get_lua_context().map_on_draw(*this, camera_surface);
-}
+    // draw all entities (including the hero)
+    entities->draw(*drawing_camera);
 
-/**
- * \brief Builds or rebuilds the surface corresponding to the background of
- * the tileset.
- */
-void Map::build_background_surface() {
+    // projectiles
+    for (const std::shared_ptr<ProjectilePool>& projectile_pool: projectile_pools) {
+      projectile_pool->draw(*this);
+    }
 
-  if (tileset != nullptr) {
-    background_surface->clear();
-    background_surface->fill_with_color(tileset->get_background_color());
+    // foreground
+    draw_foreground(camera_surface);
+
+    // Lua
+    get_lua_context().map_on_draw(*this, camera_surface);
   }
+  drawing_camera = nullptr;
+
+  entities->finish_drawing();
 }
 
 /**
  * \brief Draws the background of the map.
+ *
+ * The background color of the tileset is filled directly on the destination
+ * surface rather than copied from an intermediate surface.
+ *
  * \param dst_surface The surface where to draw.
  */
 void Map::draw_background(const SurfacePtr& dst_surface) {
-  background_surface->draw(dst_surface);
+
+  if (tileset != nullptr) {
+    dst_surface->fill_with_color(tileset->get_background_color());
+  }
 }
 
 /**
- * \brief Builds a surface with black bars when the map is smaller than the
+ * \brief Computes the black bars to draw when the map is smaller than the
  * camera size.
  */
-void Map::build_foreground_surface() {
+void Map::build_foreground_bars() {
 
-  foreground_surface = nullptr;
+  foreground_bars.clear();
 
   const CameraPtr& camera = get_camera();
   if (camera != nullptr) {
@@ -611,23 +802,20 @@ void Map::build_foreground_surface() {
     return;
   }
 
-  foreground_surface = Surface::create(camera_size);
-  // Keep this surface as software destination because it is built only once.
-
   if (map_width < camera_width) {
     int bar_width = (camera_width - map_width) / 2;
     Rectangle dst_position(0, 0, bar_width, camera_height);
-    foreground_surface->fill_with_color(Color::black, dst_position);
+    foreground_bars.push_back(dst_position);
     dst_position.set_x(bar_width + map_width);
-    foreground_surface->fill_with_color(Color::black, dst_position);
+    foreground_bars.push_back(dst_position);
   }
 
   if (map_height < camera_height) {
     int bar_height = (camera_height - map_height) / 2;
     Rectangle dst_position(0, 0, camera_width, bar_height);
-    foreground_surface->fill_with_color(Color::black, dst_position);
+    foreground_bars.push_back(dst_position);
     dst_position.set_y(bar_height + map_height);
-    foreground_surface->fill_with_color(Color::black, dst_position);
+    foreground_bars.push_back(dst_position);
   }
 }
 
@@ -637,8 +825,8 @@ void Map::build_foreground_surface() {
  */
 void Map::draw_foreground(const SurfacePtr& dst_surface) {
 
-  if (foreground_surface != nullptr) {
-    foreground_surface->draw(dst_surface);
+  for (const Rectangle& bar: foreground_bars) {
+    dst_surface->fill_with_color(Color::black, bar);
   }
 }
 
@@ -662,14 +850,15 @@ void Map::draw_visual(Drawable& drawable, int x, int y) {
 
   // the position is given in the map coordinate system:
   // convert it to the visible surface coordinate system
-  const CameraPtr& camera = get_camera();
+  const CameraPtr& camera = get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
   const SurfacePtr& camera_surface = camera->get_surface();
+  const Point& camera_xy = camera->get_interpolated_top_left_xy();
   drawable.draw(camera_surface,
-      x - camera->get_top_left_x(),
-      y - camera->get_top_left_y()
+      x - camera_xy.x,
+      y - camera_xy.y
   );
 }
 
@@ -690,7 +879,7 @@ void Map::draw_visual(Drawable& drawable, int x, int y,
     return;
   }
 
-  const CameraPtr& camera = get_camera();
+  const CameraPtr& camera = get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
@@ -702,10 +891,7 @@ void Map::draw_visual(Drawable& drawable, int x, int y,
       clipping_area.get_width(),
       clipping_area.get_height()
   );
-  const Point dst_position = {
-      x - camera->get_top_left_x(),
-      y - camera->get_top_left_y()
-  };
+  const Point dst_position = Point(x, y) - camera->get_interpolated_top_left_xy();
   drawable.draw_region(
       region_in_frame,
       camera_surface,
@@ -872,58 +1058,26 @@ bool Map::test_collision_with_ground(
 }
 
 /**
- * \brief Tests whether a rectangle overlaps an obstacle dynamic entity.
- * \param layer The layer.
- * \param collision_box The rectangle to check.
- * \param entity_to_check The entity to check (used to decide what is
- * considered as obstacle).
- * \return \c true if there is an obstacle entity at this point.
- */
-bool Map::test_collision_with_entities(
-    int layer,
-    const Rectangle& collision_box,
-    Entity& entity_to_check) {
-
-  if (!is_loaded()) {
-    return false;
-  }
-
-  EntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
-
-    if (entity_nearby->overlaps(collision_box) &&
-        (entity_nearby->get_layer() == layer || entity_nearby->has_layer_independent_collisions()) &&
-        entity_nearby->is_obstacle_for(entity_to_check, collision_box) &&
-        entity_nearby->is_enabled() &&
-        !entity_nearby->is_being_removed() &&
-        entity_nearby.get() != &entity_to_check) {
-      return true;
-    }
-  }
-
-  return false;
-}
-
-/**
- * \brief Tests whether a rectangle collides with the map obstacles.
+ * \brief Tests whether the border of a rectangle collides with the ground
+ * of the map.
+ *
+ * Like test_collision_with_ground() for a single point, dynamic entities
+ * that change the ground are taken into account.
+ *
  * \param layer Layer of the rectangle in the map.
  * \param collision_box The rectangle to check (its dimensions should be
  * multiples of 8).
- * \param entity_to_check The entity to check (used to decide what is
+ * \param entity_to_check The entity to check (used to decide what grounds are
  * considered as obstacle).
- * \return \c true if the rectangle is overlapping an obstacle.
+ * \return \c true if the border of the rectangle is on an obstacle.
  */
-bool Map::test_collision_with_obstacles(
+bool Map::test_collision_with_ground(
     int layer,
     const Rectangle& collision_box,
-    Entity& entity_to_check) {
+    const Entity& entity_to_check) const {
 
   // This function is called very often.
   // For performance reasons, we only check the border of the of the collision box.
-
-  // Collisions with the terrain
-  // (i.e., tiles and dynamic entities that may change it).
   const int x1 = collision_box.get_x();
   const int x2 = x1 + collision_box.get_width() - 1;
   const int y1 = collision_box.get_y();
@@ -959,6 +1113,12 @@ bool Map::test_collision_with_obstacles(
     // In this case, we need to test all points of the border of the collision
     // box. Otherwise, walls with sharp angles like 'V' become
     // partially traversable.
+    if (!has_modified_ground(layer, collision_box, entity_to_check)) {
+      // Usual case: the ground only depends on tiles, so it is the same
+      // in each 8x8 square and whole squares can be tested at once.
+      return test_collision_with_tile_ground_squares(layer, collision_box, entity_to_check);
+    }
+
     for (int x = x1; x <= x2; ++x) {
       if (test_collision_with_ground(layer, x, y1, entity_to_check, found_diagonal_wall)
           || test_collision_with_ground(layer, x, y2, entity_to_check, found_diagonal_wall)) {
@@ -974,8 +1134,295 @@ bool Map::test_collision_with_obstacles(
     }
   }
 
+  return false;
+}
+
+/**
+ * \brief Returns whether an entity changes the ground in a rectangle.
+ * \param layer Layer of the rectangle.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity whose own modified ground does not count.
+ * \return \c true if get_ground() may depend on dynamic entities
+ * in this rectangle.
+ */
+bool Map::has_modified_ground(
+    int layer,
+    const Rectangle& collision_box,
+    const Entity& entity_to_check) const {
+
+  if (!is_loaded()) {
+    return true;
+  }
+
+  // Same criteria as get_ground().
+  ConstEntityPointerVector entities_nearby;
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
+  for (const Entity* entity_nearby: entities_nearby) {
+    if (entity_nearby != &entity_to_check &&
+        entity_nearby->get_modified_ground() != Ground::EMPTY &&
+        entity_nearby->overlaps(collision_box) &&
+        entity_nearby->get_layer() == layer &&
+        entity_nearby->is_enabled() &&
+        !entity_nearby->is_being_removed()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Tests whether the border of a rectangle collides with the ground
+ * of tiles, one 8x8 square at a time.
+ *
+ * This gives the same result as testing each point of the border with
+ * test_collision_with_ground(), provided that no dynamic entity changes
+ * the ground there.
+ * The pixels of the border in each square are compared to the wall mask of
+ * the ground of that square.
+ *
+ * \param layer Layer of the rectangle in the map.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check (used to decide what grounds are
+ * considered as obstacle).
+ * \return \c true if the border of the rectangle is on an obstacle.
+ */
+bool Map::test_collision_with_tile_ground_squares(
+    int layer,
+    const Rectangle& collision_box,
+    const Entity& entity_to_check) const {
+
+  const int x1 = collision_box.get_x();
+  const int x2 = x1 + collision_box.get_width() - 1;
+  const int y1 = collision_box.get_y();
+  const int y2 = y1 + collision_box.get_height() - 1;
+
+  if (test_collision_with_border(x1, y1) ||
+      test_collision_with_border(x2, y2)) {
+    return true;
+  }
+
+  const auto& test_square = [&](int square_x, int square_y) {
+    const Ground ground = entities->get_tile_ground(layer, square_x, square_y);
+    uint64_t obstacle_mask = GroundRaster::get_wall_square_mask(ground);
+    if (!GroundInfo::is_ground_diagonal(ground) &&
+        entity_to_check.is_ground_obstacle(ground)) {
+      obstacle_mask = ~uint64_t(0);
+    }
+    // The other half of diagonal walls is never an obstacle.
+    return (get_border_square_mask(collision_box, square_x, square_y) & obstacle_mask) != 0;
+  };
+
+  const int first_square_x = x1 & ~7;
+  const int last_square_x = x2 & ~7;
+  for (int square_y = y1 & ~7; square_y <= y2; square_y += 8) {
+    if (square_y <= y1 || square_y + 7 >= y2) {
+      // Squares of the top or bottom side.
+      for (int square_x = first_square_x; square_x <= last_square_x; square_x += 8) {
+        if (test_square(square_x, square_y)) {
+          return true;
+        }
+      }
+    }
+    else if (test_square(first_square_x, square_y) ||
+             (last_square_x != first_square_x && test_square(last_square_x, square_y))) {
+      // Squares of the left or right side.
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * \brief Tests whether a rectangle overlaps an obstacle dynamic entity.
+ * \param layer The layer.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \return \c true if there is an obstacle entity at this point.
+ */
+bool Map::test_collision_with_entities(
+    int layer,
+    const Rectangle& collision_box,
+    Entity& entity_to_check) {
+
+  if (!is_loaded()) {
+    return false;
+  }
+
+  EntityPointerVector entities_nearby;
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
+  return test_collision_with_entities(layer, collision_box, entity_to_check, entities_nearby);
+}
+
+/**
+ * \brief Tests whether a rectangle overlaps an obstacle dynamic entity
+ * among some candidates.
+ * \param layer The layer.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \param entities_nearby Entities in the rectangle.
+ * \return \c true if there is an obstacle entity at this point.
+ */
+bool Map::test_collision_with_entities(
+    int layer,
+    const Rectangle& collision_box,
+    Entity& entity_to_check,
+    const EntityPointerVector& entities_nearby) {
+
+  return get_obstacle_entity(layer, collision_box, entity_to_check, entities_nearby) != nullptr;
+}
+
+/**
+ * \brief Returns a dynamic entity that is an obstacle in a rectangle
+ * among some candidates.
+ * \param layer The layer.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \param entities_nearby Entities in the rectangle.
+ * \return The first obstacle entity found, or nullptr.
+ */
+Entity* Map::get_obstacle_entity(
+    int layer,
+    const Rectangle& collision_box,
+    Entity& entity_to_check,
+    const EntityPointerVector& entities_nearby) {
+
+  const EntityType type_to_check = entity_to_check.get_type();
+  for (Entity* entity_nearby: entities_nearby) {
+
+    const ObstacleTable::Relation relation =
+        ObstacleTable::get_relation(entity_nearby->get_type(), type_to_check);
+    if (relation == ObstacleTable::Relation::NEVER) {
+      continue;
+    }
+
+    if (entity_nearby->overlaps(collision_box) &&
+        (entity_nearby->get_layer() == layer || entity_nearby->has_layer_independent_collisions()) &&
+        (relation == ObstacleTable::Relation::ALWAYS ||
+         entity_nearby->is_obstacle_for(entity_to_check, collision_box)) &&
+        entity_nearby->is_enabled() &&
+        !entity_nearby->is_being_removed() &&
+        entity_nearby != &entity_to_check) {
+      return entity_nearby;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * \brief Returns whether the ground of static tiles is enough to know
+ * the ground obstacles of a rectangle.
+ *
+ * This is the case when no dynamic entity changes the ground there,
+ * and when the entity has the usual obstacles
+ * (walls are obstacles but traversable grounds are not).
+ *
+ * \param layer The layer.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check.
+ * \param entities_nearby Entities in the rectangle.
+ * \return \c true if the ground raster of the layer can be used.
+ */
+bool Map::can_use_ground_raster(
+    int layer,
+    const Rectangle& collision_box,
+    const Entity& entity_to_check,
+    const EntityPointerVector& entities_nearby) const {
+
+  if (!entity_to_check.is_ground_obstacle(Ground::WALL) ||
+      entity_to_check.is_ground_obstacle(Ground::TRAVERSABLE)) {
+    return false;
+  }
+
+  // Same criteria as get_ground().
+  for (const Entity* entity_nearby: entities_nearby) {
+    if (entity_nearby != &entity_to_check &&
+        entity_nearby->get_modified_ground() != Ground::EMPTY &&
+        entity_nearby->overlaps(collision_box) &&
+        entity_nearby->get_layer() == layer &&
+        entity_nearby->is_enabled() &&
+        !entity_nearby->is_being_removed()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * \brief Tests whether a rectangle collides with the map obstacles.
+ * \param layer Layer of the rectangle in the map.
+ * \param collision_box The rectangle to check (its dimensions should be
+ * multiples of 8).
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \return \c true if the rectangle is overlapping an obstacle.
+ */
+bool Map::test_collision_with_obstacles(
+    int layer,
+    const Rectangle& collision_box,
+    Entity& entity_to_check) {
+
+  if (!is_loaded() || collision_box.is_flat()) {
+    return test_collision_with_ground(layer, collision_box, entity_to_check) ||
+        test_collision_with_entities(layer, collision_box, entity_to_check);
+  }
+
+  EntityPointerVector entities_nearby;
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
+
+  // Collisions with the terrain
+  // (i.e., tiles and dynamic entities that may change it).
+  const bool use_ground_raster =
+      can_use_ground_raster(layer, collision_box, entity_to_check, entities_nearby);
+  if (test_collision_with_terrain(layer, collision_box, entity_to_check, use_ground_raster)) {
+    return true;
+  }
+
   // No collision with the terrain: check collisions with dynamic entities.
-  return test_collision_with_entities(layer, collision_box, entity_to_check);
+  return test_collision_with_entities(layer, collision_box, entity_to_check, entities_nearby);
+}
+
+/**
+ * \brief Tests whether a rectangle collides with the terrain.
+ * \param layer Layer of the rectangle in the map.
+ * \param collision_box The rectangle to check.
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \param use_ground_raster \c true if can_use_ground_raster() is known to be
+ * \c true for this rectangle.
+ * \return \c true if the rectangle is overlapping an obstacle of the terrain.
+ */
+bool Map::test_collision_with_terrain(
+    int layer,
+    const Rectangle& collision_box,
+    Entity& entity_to_check,
+    bool use_ground_raster) {
+
+  if (!use_ground_raster) {
+    return test_collision_with_ground(layer, collision_box, entity_to_check);
+  }
+
+  // Usual case: the ground only depends on static tiles.
+  // Walls are tested with bitmaps, and only the other grounds
+  // that may be obstacles need the entity to decide.
+  const int x2 = collision_box.get_x() + collision_box.get_width() - 1;
+  const int y2 = collision_box.get_y() + collision_box.get_height() - 1;
+  if (test_collision_with_border(collision_box.get_xy()) ||
+      test_collision_with_border(x2, y2)) {
+    return true;
+  }
+
+  const GroundRaster& ground_raster = entities->get_ground_raster(layer);
+  if (ground_raster.has_wall_on_border(collision_box)) {
+    return true;
+  }
+  return ground_raster.has_conditional_on_border(collision_box) &&
+      test_collision_with_ground(layer, collision_box, entity_to_check);
 }
 
 /**
@@ -994,15 +1441,34 @@ bool Map::test_collision_with_obstacles(
     Entity& entity_to_check
 ) {
 
-  bool is_diagonal_wall = false;
+  if (!is_loaded()) {
+    bool is_diagonal_wall = false;
+    return test_collision_with_ground(layer, x, y, entity_to_check, is_diagonal_wall);
+  }
+
+  const Rectangle collision_box(x, y, 1, 1);
+  EntityPointerVector entities_nearby;
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
 
   // Test the terrain.
-  bool collision = test_collision_with_ground(layer, x, y, entity_to_check, is_diagonal_wall);
+  bool collision = false;
+  if (can_use_ground_raster(layer, collision_box, entity_to_check, entities_nearby)) {
+    if (test_collision_with_border(x, y)) {
+      return true;
+    }
+    const GroundRaster& ground_raster = entities->get_ground_raster(layer);
+    collision = ground_raster.is_wall(x, y) ||
+        (ground_raster.is_conditional(x, y) &&
+         entity_to_check.is_ground_obstacle(entities->get_tile_ground(layer, x, y)));
+  }
+  else {
+    bool is_diagonal_wall = false;
+    collision = test_collision_with_ground(layer, x, y, entity_to_check, is_diagonal_wall);
+  }
 
   // Test dynamic entities.
   if (!collision) {
-    Rectangle collision_box(x, y, 1, 1);
-    collision = test_collision_with_entities(layer, collision_box, entity_to_check);
+    collision = test_collision_with_entities(layer, collision_box, entity_to_check, entities_nearby);
   }
 
   return collision;
@@ -1024,6 +1490,133 @@ bool Map::test_collision_with_obstacles(
   return test_collision_with_obstacles(layer, point.x, point.y, entity_to_check);
 }
 
+/**
+ * \brief Returns whether an entity can be anywhere in a rectangle without
+ * reaching obstacles.
+ *
+ * This is a conservative test used to skip obstacle tests of movements:
+ * the rectangle must be inside the map, have no wall and no ground that
+ * depends on the entity, and overlap no other entity at all
+ * (except the camera).
+ * If it returns \c true, test_collision_with_obstacles() returns \c false
+ * for every box inside this rectangle, until
+ * Entities::get_obstacle_generation() changes.
+ *
+ * \param layer The layer.
+ * \param region The rectangle to check.
+ * \param entity_to_check The entity that would move there.
+ * \return \c true if the rectangle is known to be free for this entity.
+ */
+bool Map::is_free_of_obstacles(
+    int layer,
+    const Rectangle& region,
+    const Entity& entity_to_check) const {
+
+  if (!is_loaded() || region.is_flat()) {
+    return false;
+  }
+
+  const int x2 = region.get_x() + region.get_width() - 1;
+  const int y2 = region.get_y() + region.get_height() - 1;
+  if (test_collision_with_border(region.get_xy()) ||
+      test_collision_with_border(x2, y2)) {
+    return false;
+  }
+
+  if (entity_to_check.is_ground_obstacle(Ground::TRAVERSABLE)) {
+    return false;
+  }
+
+  const GroundRaster& ground_raster = entities->get_ground_raster(layer);
+  if (ground_raster.has_wall(region) ||
+      ground_raster.has_conditional(region)) {
+    return false;
+  }
+
+  ConstEntityPointerVector entities_nearby;
+  entities->get_entities_in_rectangle(region, entities_nearby);
+  for (const Entity* entity_nearby: entities_nearby) {
+    if (entity_nearby != &entity_to_check &&
+        entity_nearby->get_type() != EntityType::CAMERA) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * \brief Moves a rectangle step by step until it reaches an obstacle.
+ *
+ * This gives in one call how far an entity can go in a straight line,
+ * for example a projectile.
+ * Entities along the whole path are looked up once in the quadtree,
+ * and the terrain is tested with the ground raster when possible.
+ * The terrain and entities are considered as they are now:
+ * nothing is actually moved.
+ *
+ * \param layer Layer of the rectangle.
+ * \param collision_box The rectangle to move, initially free of obstacles.
+ * \param step Move to apply at each step, for example (1, 0) to go right.
+ * \param max_distance Maximum number of steps.
+ * \param entity_to_check The entity that would move
+ * (used to decide what is considered as obstacle).
+ * \param[out] obstacle_entity The dynamic entity reached, or nullptr if the
+ * obstacle is the terrain or if no obstacle was reached.
+ * \return The number of steps done before reaching an obstacle,
+ * or \c max_distance if there is no obstacle on the way.
+ */
+int Map::cast_ray(
+    int layer,
+    const Rectangle& collision_box,
+    const Point& step,
+    int max_distance,
+    Entity& entity_to_check,
+    Entity*& obstacle_entity) {
+
+  obstacle_entity = nullptr;
+  if (max_distance <= 0 || step == Point()) {
+    return 0;
+  }
+
+  Rectangle end_box = collision_box;
+  end_box.add_xy(step * max_distance);
+  const Rectangle& region = collision_box | end_box;
+
+  if (!is_loaded() || collision_box.is_flat()) {
+    Rectangle box = collision_box;
+    for (int distance = 0; distance < max_distance; ++distance) {
+      box.add_xy(step);
+      if (test_collision_with_obstacles(layer, box, entity_to_check)) {
+        return distance;
+      }
+    }
+    return max_distance;
+  }
+
+  if (is_free_of_obstacles(layer, region, entity_to_check)) {
+    return max_distance;
+  }
+
+  EntityPointerVector entities_nearby;
+  get_entities().get_entities_in_rectangle(region, entities_nearby);
+  const bool use_ground_raster =
+      can_use_ground_raster(layer, region, entity_to_check, entities_nearby);
+
+  Rectangle box = collision_box;
+  for (int distance = 0; distance < max_distance; ++distance) {
+    box.add_xy(step);
+    if (test_collision_with_terrain(layer, box, entity_to_check, use_ground_raster)) {
+      return distance;
+    }
+    obstacle_entity = get_obstacle_entity(layer, box, entity_to_check, entities_nearby);
+    if (obstacle_entity != nullptr) {
+      return distance;
+    }
+  }
+  return max_distance;
+}
+
 /**
  * \brief Returns whether there is empty ground in the specified rectangle.
  *
@@ -1113,7 +1706,7 @@ Ground Map::get_ground(
 
   // See if a dynamic entity changes the ground.
   const Rectangle box(xy, Size(1, 1));
-  ConstEntityVector entities_nearby;
+  ConstEntityPointerVector entities_nearby;
   get_entities().get_entities_in_rectangle_sorted(box, entities_nearby);
 
   const auto& rend = entities_nearby.rend();
@@ -1306,13 +1899,50 @@ void Map::check_collision_with_detectors(Entity& entity) {
     return;
   }
 
+  EntityPointerVector entities_nearby;
+  if (!entities->is_collision_broad_phase_enabled()) {
+    entities->get_entities_in_rectangle(
+        entity.get_extended_bounding_box(detector_margin), entities_nearby
+    );
+  }
+  check_collision_with_detectors(entity, entities_nearby);
+}
+
+/**
+ * \brief Checks the collisions between an entity and some detectors
+ * already known to be near it.
+ *
+ * Like check_collision_with_detectors(Entity&), but without searching the
+ * candidates on the map. Candidates too far from the entity are ignored.
+ *
+ * \param entity The entity that has just moved.
+ * \param entities_nearby Entities that contain at least the ones
+ * near the entity.
+ */
+void Map::check_collision_with_detectors(
+    Entity& entity,
+    const EntityPointerVector& entities_nearby
+) {
+  if (suspended) {
+    return;
+  }
+
+  if (entity.is_being_removed() ||
+      !entity.is_enabled()) {
+    return;
+  }
+
+  if (entities->is_collision_broad_phase_enabled()) {
+    // Checked at the end of the cycle with all other entities.
+    entities->add_pending_collision_check(entity);
+    return;
+  }
+
   // Check this entity with each detector.
 
   // Extend the box because some collision tests work without overlapping.
-  Rectangle box = entity.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  const Rectangle& box = entity.get_extended_bounding_box(detector_margin);
+  for (Entity* entity_nearby: entities_nearby) {
 
     if (entity.is_being_removed()) {
       return;
@@ -1323,6 +1953,10 @@ void Map::check_collision_with_detectors(Entity& entity) {
       continue;
     }
 
+    if (!entity_nearby->get_max_bounding_box().overlaps(box)) {
+      continue;
+    }
+
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
         !entity_nearby->is_being_removed()) {
@@ -1351,14 +1985,20 @@ void Map::check_collision_from_detector(Entity& detector) {
     return;
   }
 
+  if (entities->is_collision_broad_phase_enabled()) {
+    // Checked at the end of the cycle with all other entities.
+    entities->add_pending_collision_check(detector);
+    return;
+  }
+
   // First check the hero.
   detector.check_collision(get_entities().get_hero());
 
   // Check each entity with this detector.
-  Rectangle box = detector.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
+  Rectangle box = detector.get_extended_bounding_box(detector_margin);
+  EntityPointerVector entities_nearby;
   entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  for (Entity* entity_nearby: entities_nearby) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1367,8 +2007,8 @@ void Map::check_collision_from_detector(Entity& detector) {
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
         !entity_nearby->is_being_removed() &&
-        entity_nearby.get() != &detector &&
-        entity_nearby.get() != &get_entities().get_hero()
+        entity_nearby != &detector &&
+        entity_nearby != &get_entities().get_hero()
     ) {
       detector.check_collision(*entity_nearby);
     }
@@ -1402,9 +2042,9 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
 
   // Check each entity with this detector.
   Rectangle box = detector.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
+  EntityPointerVector entities_nearby;
   entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  for (Entity* entity_nearby: entities_nearby) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1413,8 +2053,8 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
         !entity_nearby->is_being_removed() &&
-        entity_nearby.get() != &detector &&
-        entity_nearby.get() != &get_entities().get_hero()
+        entity_nearby != &detector &&
+        entity_nearby != &get_entities().get_hero()
     ) {
       detector.check_collision(detector_sprite, *entity_nearby);
     }
@@ -1443,11 +2083,40 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
     return;
   }
 
+  EntityPointerVector entities_nearby;
+  entities->get_entities_in_rectangle(entity.get_max_bounding_box(), entities_nearby);
+  check_collision_with_detectors(entity, sprite, entities_nearby);
+}
+
+/**
+ * \brief Checks the pixel-precise collisions between an entity and some
+ * detectors already known to be near it.
+ *
+ * Like check_collision_with_detectors(Entity&, Sprite&), but without
+ * searching the candidates on the map. Candidates too far from the entity
+ * are ignored.
+ *
+ * \param entity A map entity.
+ * \param sprite The sprite of this entity to check.
+ * \param entities_nearby Entities that contain at least the ones
+ * near the entity.
+ */
+void Map::check_collision_with_detectors(
+    Entity& entity,
+    Sprite& sprite,
+    const EntityPointerVector& entities_nearby
+) {
+  if (suspended) {
+    return;
+  }
+
+  if (!entity.is_enabled()) {
+    return;
+  }
+
   // Check each detector.
-  Rectangle box = entity.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  const Rectangle& box = entity.get_max_bounding_box();
+  for (Entity* entity_nearby: entities_nearby) {
 
     if (entity.is_being_removed()) {
       return;
@@ -1457,6 +2126,10 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
       continue;
     }
 
+    if (!entity_nearby->get_max_bounding_box().overlaps(box)) {
+      continue;
+    }
+
     if (!entity_nearby->is_being_removed()
         && !entity_nearby->is_suspended()
         && entity_nearby->is_enabled()) {
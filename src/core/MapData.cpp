@@ -14,12 +14,15 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MapData.h"
 #include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,6 +38,9 @@ MapData::MapData():
     floor(NO_FLOOR),
     tileset_id(),
     music_id("none"),
+    entity_cell_size(0),
+    activity_distance(0),
+    chunk_size(0),
     entities(),
     named_entities() {
 
@@ -268,6 +274,102 @@ void MapData::set_music_id(const std::string& music_id) {
   this->music_id = music_id;
 }
 
+/**
+ * \brief Returns whether entities of this map are located with a grid.
+ * \return \c true if an entity cell size is set.
+ */
+bool MapData::has_entity_cell_size() const {
+  return entity_cell_size != 0;
+}
+
+/**
+ * \brief Returns the side of the grid cells used to locate entities.
+ *
+ * A grid is faster than the default quadtree for maps filled with many
+ * entities of similar sizes.
+ *
+ * \return The cell size in pixels, or 0 to use a quadtree.
+ */
+int MapData::get_entity_cell_size() const {
+  return entity_cell_size;
+}
+
+/**
+ * \brief Sets the side of the grid cells used to locate entities.
+ * \param entity_cell_size The cell size in pixels, or 0 to use a quadtree.
+ */
+void MapData::set_entity_cell_size(int entity_cell_size) {
+
+  Debug::check_assertion(entity_cell_size >= 0, "Invalid entity cell size");
+  this->entity_cell_size = entity_cell_size;
+}
+
+/**
+ * \brief Returns whether entities far from the camera become dormant.
+ * \return \c true if an activity distance is set.
+ */
+bool MapData::has_activity_distance() const {
+  return activity_distance != 0;
+}
+
+/**
+ * \brief Returns the distance from the camera beyond which entities
+ * become dormant.
+ *
+ * Dormant entities are suspended and not updated until they come
+ * close to the camera again.
+ *
+ * \return The distance in pixels, or 0 to keep all entities active.
+ */
+int MapData::get_activity_distance() const {
+  return activity_distance;
+}
+
+/**
+ * \brief Sets the distance from the camera beyond which entities
+ * become dormant.
+ * \param activity_distance The distance in pixels,
+ * or 0 to keep all entities active.
+ */
+void MapData::set_activity_distance(int activity_distance) {
+
+  Debug::check_assertion(activity_distance >= 0, "Invalid activity distance");
+  this->activity_distance = activity_distance;
+}
+
+/**
+ * \brief Returns whether entities of this map are created by chunks
+ * around the camera.
+ * \return \c true if a chunk size is set.
+ */
+bool MapData::has_chunk_size() const {
+  return chunk_size != 0;
+}
+
+/**
+ * \brief Returns the side of the chunks used to stream entities.
+ *
+ * Unnamed entities of chunks close to the camera are created,
+ * and the ones of chunks far from the camera are dropped.
+ *
+ * \return The chunk size in pixels, or 0 to create all entities
+ * when the map starts.
+ */
+int MapData::get_chunk_size() const {
+  return chunk_size;
+}
+
+/**
+ * \brief Sets the side of the chunks used to stream entities.
+ * \param chunk_size The chunk size in pixels,
+ * or 0 to create all entities when the map starts.
+ */
+void MapData::set_chunk_size(int chunk_size) {
+
+  Debug::check_assertion(chunk_size >= 0, "Invalid chunk size");
+  this->chunk_size = chunk_size;
+}
+
 /**
  * \brief Returns the total number of entities on this map.
  * \return The number of entities.
@@ -853,6 +955,9 @@ int l_properties(lua_State* l) {
     const int floor = LuaTools::opt_int_field(l, 1, "floor", MapData::NO_FLOOR);
     const std::string& tileset_id = LuaTools::check_string_field(l, 1, "tileset");
     const std::string& music_id = LuaTools::opt_string_field(l, 1, "music", "none");
+    const int entity_cell_size = LuaTools::opt_int_field(l, 1, "entity_cell_size", 0);
+    const int activity_distance = LuaTools::opt_int_field(l, 1, "activity_distance", 0);
+    const int chunk_size = LuaTools::opt_int_field(l, 1, "chunk_size", 0);
 
     if (min_layer > 0) {
       LuaTools::arg_error(l, 1, "min_layer must be lower than or equal to 0");
@@ -860,6 +965,15 @@ int l_properties(lua_State* l) {
     if (max_layer < 0) {
       LuaTools::arg_error(l, 1, "max_layer must be higher than or equal to 0");
     }
+    if (entity_cell_size < 0) {
+      LuaTools::arg_error(l, 1, "entity_cell_size must be positive or 0");
+    }
+    if (activity_distance < 0) {
+      LuaTools::arg_error(l, 1, "activity_distance must be positive or 0");
+    }
+    if (chunk_size < 0) {
+      LuaTools::arg_error(l, 1, "chunk_size must be positive or 0");
+    }
 
     // Initialize the map data.
     map.set_location({ x, y });
@@ -870,6 +984,9 @@ int l_properties(lua_State* l) {
     map.set_world(world);
     map.set_floor(floor);
     map.set_tileset_id(tileset_id);
+    map.set_entity_cell_size(entity_cell_size);
+    map.set_activity_distance(activity_distance);
+    map.set_chunk_size(chunk_size);
 
     // Properties are set: we now allow the data file to declare entities.
 
@@ -884,6 +1001,95 @@ int l_properties(lua_State* l) {
   });
 }
 
+/**
+ * \brief First bytes of a binary map file.
+ */
+const std::string binary_magic = { 'S', 'O', 'L', 'M', 'A', 'P', '\r', '\n' };
+
+/**
+ * \brief Writes the user properties and the specific properties of an entity.
+ * \param writer The binary writer.
+ * \param entity The entity to write.
+ */
+void write_entity_properties(BinaryWriter& writer, const EntityData& entity) {
+
+  writer.write_uint32(static_cast<uint32_t>(entity.get_user_property_count()));
+  for (const EntityData::UserProperty& user_property : entity.get_user_properties()) {
+    writer.write_string(user_property.first);
+    writer.write_string(user_property.second);
+  }
+
+  const std::map<std::string, EntityData::FieldValue>& specific_properties =
+      entity.get_specific_properties();
+  writer.write_uint32(static_cast<uint32_t>(specific_properties.size()));
+  for (const auto& kvp : specific_properties) {
+    const EntityData::FieldValue& value = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_uint8(static_cast<uint8_t>(value.value_type));
+    if (value.value_type == EntityData::EntityFieldType::STRING) {
+      writer.write_string(value.string_value);
+    }
+    else {
+      writer.write_int32(value.int_value);
+    }
+  }
+}
+
+/**
+ * \brief Reads what write_entity_properties() wrote.
+ * \param reader The binary reader.
+ * \param entity The entity to fill.
+ * \return \c false if the properties are invalid.
+ */
+bool read_entity_properties(BinaryReader& reader, EntityData& entity) {
+
+  const uint32_t num_user_properties = reader.read_uint32();
+  if (!reader.can_read(num_user_properties, 8)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_user_properties; ++i) {
+    const std::string& key = reader.read_string();
+    const std::string& value = reader.read_string();
+    if (!reader.is_valid() || !EntityData::is_user_property_key_valid(key)) {
+      return false;
+    }
+    entity.add_user_property(std::make_pair(key, value));
+  }
+
+  const uint32_t num_specific_properties = reader.read_uint32();
+  if (!reader.can_read(num_specific_properties, 9)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_specific_properties; ++i) {
+    const std::string& key = reader.read_string();
+    const EntityData::EntityFieldType value_type =
+        static_cast<EntityData::EntityFieldType>(reader.read_uint8());
+    if (!reader.is_valid() ||
+        !entity.has_specific_property(key) ||
+        entity.get_specific_property(key).value_type != value_type) {
+      return false;
+    }
+    switch (value_type) {
+
+    case EntityData::EntityFieldType::STRING:
+      entity.set_string(key, reader.read_string());
+      break;
+
+    case EntityData::EntityFieldType::INTEGER:
+      entity.set_integer(key, reader.read_int32());
+      break;
+
+    case EntityData::EntityFieldType::BOOLEAN:
+      entity.set_boolean(key, reader.read_int32() != 0);
+      break;
+
+    case EntityData::EntityFieldType::NIL:
+      return false;
+    }
+  }
+  return reader.is_valid();
+}
+
 }  // Anonymous namespace
 
 /**
@@ -926,6 +1132,15 @@ bool MapData::export_to_lua(std::ostream& out) const {
   if (has_music()) {
     out << "  music = \"" << escape_string(get_music_id()) << "\",\n";
   }
+  if (has_entity_cell_size()) {
+    out << "  entity_cell_size = " << get_entity_cell_size() << ",\n";
+  }
+  if (has_activity_distance()) {
+    out << "  activity_distance = " << get_activity_distance() << ",\n";
+  }
+  if (has_chunk_size()) {
+    out << "  chunk_size = " << get_chunk_size() << ",\n";
+  }
   out << "}\n\n";
 
   for (const auto& kvp : entities) {
@@ -939,5 +1154,204 @@ bool MapData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
-}  // namespace Solarus
+/**
+ * \copydoc LuaData::get_binary_magic
+ */
+std::string MapData::get_binary_magic() const {
+  return binary_magic;
+}
 
+/**
+ * \copydoc LuaData::get_binary_format_version
+ */
+uint32_t MapData::get_binary_format_version() const {
+  return binary_format_version;
+}
+
+/**
+ * \brief Loads this map from the values of a binary map file.
+ *
+ * Tiles are stored as flat arrays of fixed-size records.
+ * Other entities and user properties are stored generically.
+ *
+ * \param reader The binary reader.
+ * \return \c true in case of success. In case of failure,
+ * this object is not modified.
+ */
+bool MapData::import_from_binary(BinaryReader& reader) {
+
+  MapData map;
+  const int x = reader.read_int32();
+  const int y = reader.read_int32();
+  const int width = reader.read_int32();
+  const int height = reader.read_int32();
+  const int min_layer = reader.read_int32();
+  const int max_layer = reader.read_int32();
+  const int floor = reader.read_int32();
+  const std::string& world = reader.read_string();
+  const std::string& tileset_id = reader.read_string();
+  const std::string& music_id = reader.read_string();
+  const int entity_cell_size = reader.read_int32();
+  const int activity_distance = reader.read_int32();
+  const int chunk_size = reader.read_int32();
+  if (!reader.is_valid() || min_layer > 0 || max_layer < 0 ||
+      entity_cell_size < 0 || activity_distance < 0 || chunk_size < 0) {
+    return false;
+  }
+  map.set_location({ x, y });
+  map.set_size({ width, height });
+  map.set_min_layer(min_layer);
+  map.set_max_layer(max_layer);
+  map.set_floor(floor);
+  map.set_world(world);
+  map.set_tileset_id(tileset_id);
+  map.set_music_id(music_id);
+  map.set_entity_cell_size(entity_cell_size);
+  map.set_activity_distance(activity_distance);
+  map.set_chunk_size(chunk_size);
+
+  for (int layer = min_layer; layer <= max_layer; ++layer) {
+
+    // Tiles.
+    const uint32_t num_tiles = reader.read_uint32();
+    if (!reader.can_read(num_tiles, 24)) {
+      return false;
+    }
+    EntityData tile(EntityType::TILE);
+    tile.set_layer(layer);
+    for (uint32_t i = 0; i < num_tiles; ++i) {
+      tile.set_string("pattern", reader.read_string());
+      tile.set_string("tileset", reader.read_string());
+      const int tile_x = reader.read_int32();
+      const int tile_y = reader.read_int32();
+      tile.set_xy({ tile_x, tile_y });
+      tile.set_integer("width", reader.read_int32());
+      tile.set_integer("height", reader.read_int32());
+      map.add_entity(tile);
+    }
+
+    // User properties of tiles, which are rare.
+    const uint32_t num_tiles_with_properties = reader.read_uint32();
+    if (!reader.can_read(num_tiles_with_properties, 8)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_tiles_with_properties; ++i) {
+      const uint32_t order = reader.read_uint32();
+      if (order >= num_tiles) {
+        return false;
+      }
+      EntityData& tile_with_properties = map.get_entity({ layer, static_cast<int>(order) });
+      const uint32_t num_properties = reader.read_uint32();
+      if (!reader.can_read(num_properties, 8)) {
+        return false;
+      }
+      for (uint32_t j = 0; j < num_properties; ++j) {
+        const std::string& key = reader.read_string();
+        const std::string& value = reader.read_string();
+        if (!reader.is_valid() || !EntityData::is_user_property_key_valid(key)) {
+          return false;
+        }
+        tile_with_properties.add_user_property(std::make_pair(key, value));
+      }
+    }
+
+    // Dynamic entities.
+    const uint32_t num_dynamic_entities = reader.read_uint32();
+    if (!reader.can_read(num_dynamic_entities, 20)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_dynamic_entities; ++i) {
+      const std::string& type_name = reader.read_string();
+      bool type_found = false;
+      const EntityType type = name_to_enum(type_name, EntityType::TILE, type_found);
+      if (!reader.is_valid() || !type_found || type == EntityType::TILE ||
+          !EntityTypeInfo::can_be_stored_in_map_file(type)) {
+        return false;
+      }
+      EntityData entity(type);
+      entity.set_layer(layer);
+      entity.set_name(reader.read_string());
+      const int entity_x = reader.read_int32();
+      const int entity_y = reader.read_int32();
+      entity.set_xy({ entity_x, entity_y });
+      if (!read_entity_properties(reader, entity) ||
+          !map.add_entity(entity).is_valid()) {
+        return false;
+      }
+    }
+  }
+
+  if (!reader.is_valid()) {
+    return false;
+  }
+
+  *this = std::move(map);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool MapData::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_int32(get_location().x);
+  writer.write_int32(get_location().y);
+  writer.write_int32(get_size().width);
+  writer.write_int32(get_size().height);
+  writer.write_int32(get_min_layer());
+  writer.write_int32(get_max_layer());
+  writer.write_int32(get_floor());
+  writer.write_string(get_world());
+  writer.write_string(get_tileset_id());
+  writer.write_string(get_music_id());
+  writer.write_int32(get_entity_cell_size());
+  writer.write_int32(get_activity_distance());
+  writer.write_int32(get_chunk_size());
+
+  for (int layer = get_min_layer(); layer <= get_max_layer(); ++layer) {
+
+    const std::deque<EntityData>& layer_entities = get_entities(layer);
+    const int num_tiles = get_num_tiles(layer);
+
+    writer.write_uint32(static_cast<uint32_t>(num_tiles));
+    std::vector<int> tiles_with_properties;
+    for (int i = 0; i < num_tiles; ++i) {
+      const EntityData& tile = layer_entities[i];
+      Debug::check_assertion(tile.get_type() == EntityType::TILE, "Tile expected");
+      writer.write_string(tile.get_string("pattern"));
+      writer.write_string(tile.get_string("tileset"));
+      writer.write_int32(tile.get_xy().x);
+      writer.write_int32(tile.get_xy().y);
+      writer.write_int32(tile.get_integer("width"));
+      writer.write_int32(tile.get_integer("height"));
+      if (tile.get_user_property_count() > 0) {
+        tiles_with_properties.push_back(i);
+      }
+    }
+
+    writer.write_uint32(static_cast<uint32_t>(tiles_with_properties.size()));
+    for (int order : tiles_with_properties) {
+      const EntityData& tile = layer_entities[order];
+      writer.write_uint32(static_cast<uint32_t>(order));
+      writer.write_uint32(static_cast<uint32_t>(tile.get_user_property_count()));
+      for (const EntityData::UserProperty& user_property : tile.get_user_properties()) {
+        writer.write_string(user_property.first);
+        writer.write_string(user_property.second);
+      }
+    }
+
+    writer.write_uint32(static_cast<uint32_t>(get_num_dynamic_entities(layer)));
+    for (size_t i = num_tiles; i < layer_entities.size(); ++i) {
+      const EntityData& entity = layer_entities[i];
+      writer.write_string(entity.get_type_name());
+      writer.write_string(entity.get_name());
+      writer.write_int32(entity.get_xy().x);
+      writer.write_int32(entity.get_xy().y);
+      write_entity_properties(writer, entity);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace Solarus
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/core/MapOverview.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Ground.h"
+#include "solarus/entities/Hero.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/graphics/Surface.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates the overview of a loaded map, without fog of war.
+ * \param map The map.
+ */
+MapOverview::MapOverview(Map& map):
+  map(map),
+  width8(map.get_width8()),
+  height8(map.get_height8()),
+  fog_enabled(false),
+  reveal_radius(0),
+  revealed(width8 * height8, false),
+  hero_square(-1, -1),
+  surface(nullptr),
+  dirty_squares() {
+
+}
+
+/**
+ * \brief Returns the overview image, one pixel per 8x8 square of the map.
+ *
+ * Squares hidden by the fog of war are transparent.
+ *
+ * \return The overview surface.
+ */
+const SurfacePtr& MapOverview::get_surface() {
+
+  if (surface == nullptr) {
+    surface = Surface::create(width8, height8);
+    add_dirty_squares(Rectangle(0, 0, width8, height8));
+  }
+  update_surface();
+  return surface;
+}
+
+/**
+ * \brief Returns whether squares not revealed are hidden.
+ * \return \c true if the fog of war is enabled.
+ */
+bool MapOverview::is_fog_enabled() const {
+  return fog_enabled;
+}
+
+/**
+ * \brief Returns the distance revealed around the hero.
+ * \return The radius in pixels, or 0 if squares are only revealed explicitly.
+ */
+int MapOverview::get_reveal_radius() const {
+  return reveal_radius;
+}
+
+/**
+ * \brief Enables the fog of war and sets the distance revealed around the hero.
+ * \param reveal_radius The radius in pixels,
+ * or 0 to only reveal squares explicitly.
+ */
+void MapOverview::set_reveal_radius(int reveal_radius) {
+
+  this->reveal_radius = reveal_radius;
+  hero_square = Point(-1, -1);
+  if (!fog_enabled) {
+    fog_enabled = true;
+    add_dirty_squares(Rectangle(0, 0, width8, height8));
+  }
+}
+
+/**
+ * \brief Shows all squares of the overview.
+ *
+ * Revealed squares are remembered if the fog is enabled again.
+ */
+void MapOverview::disable_fog() {
+
+  if (fog_enabled) {
+    fog_enabled = false;
+    add_dirty_squares(Rectangle(0, 0, width8, height8));
+  }
+}
+
+/**
+ * \brief Returns whether a place of the map is visible on the overview.
+ * \param xy Coordinates of a point of the map.
+ * \return \c true if the fog is disabled or if its square is revealed.
+ */
+bool MapOverview::is_revealed(const Point& xy) const {
+
+  if (!fog_enabled) {
+    return true;
+  }
+
+  const int square_x = xy.x / square_size;
+  const int square_y = xy.y / square_size;
+  if (xy.x < 0 || xy.y < 0 || square_x >= width8 || square_y >= height8) {
+    return false;
+  }
+  return revealed[square_y * width8 + square_x];
+}
+
+/**
+ * \brief Reveals the squares of the overview around a point.
+ * \param xy Coordinates of a point of the map.
+ * \param radius Squares whose center is at this distance or less are
+ * revealed. With 0, only the square of the point is revealed.
+ */
+void MapOverview::reveal(const Point& xy, int radius) {
+
+  const int min_x = std::max(0, (xy.x - radius) / square_size);
+  const int max_x = std::min(width8 - 1, (xy.x + radius) / square_size);
+  const int min_y = std::max(0, (xy.y - radius) / square_size);
+  const int max_y = std::min(height8 - 1, (xy.y + radius) / square_size);
+  const int square_radius2 = radius * radius;
+
+  for (int square_y = min_y; square_y <= max_y; ++square_y) {
+    for (int square_x = min_x; square_x <= max_x; ++square_x) {
+      const int dx = square_x * square_size + square_size / 2 - xy.x;
+      const int dy = square_y * square_size + square_size / 2 - xy.y;
+      const bool own_square = square_x == xy.x / square_size && square_y == xy.y / square_size;
+      if (!own_square && dx * dx + dy * dy > square_radius2) {
+        continue;
+      }
+      const int index = square_y * width8 + square_x;
+      if (!revealed[index]) {
+        revealed[index] = true;
+        add_dirty_squares(Rectangle(square_x, square_y, 1, 1));
+      }
+    }
+  }
+}
+
+/**
+ * \brief Returns the squares revealed so far, for example to save them.
+ * \return One character per square, row by row:
+ * \c '1' if the square is revealed, \c '0' otherwise.
+ */
+std::string MapOverview::get_revealed_squares() const {
+
+  std::string revealed_squares(revealed.size(), '0');
+  for (size_t i = 0; i < revealed.size(); ++i) {
+    if (revealed[i]) {
+      revealed_squares[i] = '1';
+    }
+  }
+  return revealed_squares;
+}
+
+/**
+ * \brief Sets the squares revealed, for example to restore saved ones.
+ * \param revealed_squares One character per square, row by row:
+ * \c '1' if the square is revealed, anything else otherwise.
+ * Missing squares are not revealed.
+ */
+void MapOverview::set_revealed_squares(const std::string& revealed_squares) {
+
+  for (size_t i = 0; i < revealed.size(); ++i) {
+    revealed[i] = i < revealed_squares.size() && revealed_squares[i] == '1';
+  }
+  if (fog_enabled) {
+    add_dirty_squares(Rectangle(0, 0, width8, height8));
+  }
+}
+
+/**
+ * \brief Reveals the squares around the hero and updates the surface.
+ *
+ * This function is called at each cycle by the map.
+ * Squares are only computed again when the hero enters another square.
+ */
+void MapOverview::update() {
+
+  if (fog_enabled && reveal_radius > 0) {
+    const Point& hero_xy = map.get_entities().get_hero().get_xy();
+    const Point square(hero_xy.x / square_size, hero_xy.y / square_size);
+    if (square != hero_square) {
+      hero_square = square;
+      reveal(hero_xy, reveal_radius);
+    }
+  }
+  update_surface();
+}
+
+/**
+ * \brief Returns the color of a square of the overview.
+ * \param square_x X coordinate of the square.
+ * \param square_y Y coordinate of the square.
+ * \return The color of the ground of the highest non-empty tile there.
+ */
+Color MapOverview::get_square_color(int square_x, int square_y) const {
+
+  const Entities& entities = map.get_entities();
+  Ground ground = Ground::EMPTY;
+  for (int layer = map.get_max_layer(); layer >= map.get_min_layer(); --layer) {
+    ground = entities.get_tile_ground(layer, square_x * square_size, square_y * square_size);
+    if (ground != Ground::EMPTY) {
+      break;
+    }
+  }
+
+  switch (ground) {
+
+  case Ground::EMPTY:
+    return Color(0, 0, 0, 0);
+
+  case Ground::TRAVERSABLE:
+    return Color(224, 208, 160);
+
+  case Ground::WALL:
+  case Ground::WALL_TOP_RIGHT:
+  case Ground::WALL_TOP_LEFT:
+  case Ground::WALL_BOTTOM_LEFT:
+  case Ground::WALL_BOTTOM_RIGHT:
+    return Color(64, 56, 48);
+
+  case Ground::LOW_WALL:
+    return Color(128, 112, 96);
+
+  case Ground::WALL_TOP_RIGHT_WATER:
+  case Ground::WALL_TOP_LEFT_WATER:
+  case Ground::WALL_BOTTOM_LEFT_WATER:
+  case Ground::WALL_BOTTOM_RIGHT_WATER:
+  case Ground::DEEP_WATER:
+    return Color(40, 80, 200);
+
+  case Ground::SHALLOW_WATER:
+    return Color(96, 160, 232);
+
+  case Ground::GRASS:
+    return Color(88, 168, 64);
+
+  case Ground::HOLE:
+    return Color(16, 16, 16);
+
+  case Ground::ICE:
+    return Color(176, 232, 240);
+
+  case Ground::LADDER:
+    return Color(160, 112, 48);
+
+  case Ground::PRICKLE:
+    return Color(144, 64, 144);
+
+  case Ground::LAVA:
+    return Color(224, 72, 24);
+  }
+
+  return Color(0, 0, 0, 0);
+}
+
+/**
+ * \brief Marks squares to write again to the surface.
+ * \param squares The squares that changed.
+ */
+void MapOverview::add_dirty_squares(const Rectangle& squares) {
+
+  if (surface == nullptr) {
+    // Everything is written when the surface is created.
+    return;
+  }
+  dirty_squares |= squares;
+}
+
+/**
+ * \brief Writes the squares that changed to the surface.
+ */
+void MapOverview::update_surface() {
+
+  if (surface == nullptr || dirty_squares.is_flat()) {
+    return;
+  }
+
+  PixelBuffer pixel_buffer(surface, dirty_squares);
+  pixel_buffer.lock();
+  const Rectangle& region = pixel_buffer.get_region();
+  for (int y = 0; y < region.get_height(); ++y) {
+    const int square_y = region.get_y() + y;
+    for (int x = 0; x < region.get_width(); ++x) {
+      const int square_x = region.get_x() + x;
+      const bool visible = !fog_enabled || revealed[square_y * width8 + square_x];
+      pixel_buffer.set_pixel(x, y, visible ?
+          get_square_color(square_x, square_y) : Color(0, 0, 0, 0));
+    }
+  }
+  pixel_buffer.unlock();
+  dirty_squares = Rectangle();
+}
+
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/MemoryStats.h"
+#include "solarus/entities/NonAnimatedRegions.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/lua/LuaContext.h"
+#include <lua.hpp>
+#include <atomic>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Counters of a category, updated from any thread.
+ */
+struct AtomicCounters {
+  std::atomic<int64_t> num_bytes;
+  std::atomic<int64_t> num_objects;
+};
+
+AtomicCounters counters[MemoryStats::num_categories];
+
+thread_local MemoryStats::Category texture_category = MemoryStats::Category::OTHER_TEXTURES;
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Starts attributing textures of this thread to a category.
+ * \param category A texture category.
+ */
+MemoryStats::TextureOrigin::TextureOrigin(Category category):
+  previous_category(texture_category) {
+
+  texture_category = category;
+}
+
+/**
+ * \brief Restores the origin of the enclosing marker.
+ */
+MemoryStats::TextureOrigin::~TextureOrigin() {
+
+  texture_category = previous_category;
+}
+
+/**
+ * \brief Returns the name of a category.
+ * \param category A category.
+ * \return Its name, like "sprite_textures".
+ */
+const std::string& MemoryStats::get_category_name(Category category) {
+
+  static const std::string names[num_categories] = {
+      "tileset_textures",
+      "sprite_textures",
+      "text_textures",
+      "script_textures",
+      "other_textures",
+      "sound_buffers",
+      "entities",
+      "quadtree_nodes"
+  };
+  return names[static_cast<int>(category)];
+}
+
+/**
+ * \brief Returns the category of textures created now by the current thread.
+ * \return The category of the innermost TextureOrigin marker,
+ * or OTHER_TEXTURES.
+ */
+MemoryStats::Category MemoryStats::get_texture_category() {
+  return texture_category;
+}
+
+/**
+ * \brief Counts an object created in a category.
+ * \param category A category.
+ * \param num_bytes Size of the object in bytes.
+ */
+void MemoryStats::add(Category category, int64_t num_bytes) {
+
+  AtomicCounters& category_counters = counters[static_cast<int>(category)];
+  category_counters.num_bytes.fetch_add(num_bytes, std::memory_order_relaxed);
+  category_counters.num_objects.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Counts an object destroyed in a category.
+ * \param category The category given to add().
+ * \param num_bytes The size given to add().
+ */
+void MemoryStats::remove(Category category, int64_t num_bytes) {
+
+  AtomicCounters& category_counters = counters[static_cast<int>(category)];
+  category_counters.num_bytes.fetch_sub(num_bytes, std::memory_order_relaxed);
+  category_counters.num_objects.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the memory currently used in a category.
+ * \param category A category.
+ * \return Its counters.
+ */
+MemoryStats::Counters MemoryStats::get_counters(Category category) {
+
+  const AtomicCounters& category_counters = counters[static_cast<int>(category)];
+  Counters result;
+  result.num_bytes = category_counters.num_bytes.load(std::memory_order_relaxed);
+  result.num_objects = category_counters.num_objects.load(std::memory_order_relaxed);
+  return result;
+}
+
+/**
+ * \brief Returns the memory used by each part of the engine.
+ *
+ * In addition to the categories, the report has the Lua heap,
+ * the pools of small Lua blocks with the number of blocks used by Lua,
+ * the cells of non-animated regions (also counted in tileset textures),
+ * the total of textures (atlas pages and pooled render targets included)
+ * and the number of drawable objects kept by Lua.
+ *
+ * \param lua_context The Lua world.
+ * \return One entry per category.
+ */
+std::vector<MemoryStats::Entry> MemoryStats::get_report(LuaContext& lua_context) {
+
+  std::vector<Entry> report;
+  for (int i = 0; i < num_categories; ++i) {
+    const Category category = static_cast<Category>(i);
+    const Counters& category_counters = get_counters(category);
+    report.push_back(Entry{
+        get_category_name(category),
+        category_counters.num_bytes,
+        category_counters.num_objects
+    });
+  }
+
+  lua_State* l = lua_context.get_internal_state();
+  const int64_t lua_heap_size = static_cast<int64_t>(lua_gc(l, LUA_GCCOUNT, 0)) * 1024 +
+      static_cast<int64_t>(lua_gc(l, LUA_GCCOUNTB, 0));
+  report.push_back(Entry{ "lua_heap", lua_heap_size, 0 });
+  const LuaAllocator& lua_allocator = lua_context.get_allocator();
+  report.push_back(Entry{ "lua_pools", lua_allocator.get_pool_size(), lua_allocator.get_num_blocks() });
+  report.push_back(Entry{ "non_animated_regions", NonAnimatedRegions::get_memory_size(), 0 });
+  report.push_back(Entry{ "textures_total", Video::get_texture_memory(), 0 });
+  report.push_back(Entry{ "lua_drawables", 0, lua_context.get_num_drawables() });
+  return report;
+}
+
+}
+
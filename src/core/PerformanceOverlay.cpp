@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/Music.h"
+#include "solarus/core/FontResource.h"
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/PerformanceOverlay.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/TextSurface.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/lua/LuaContext.h"
+#include <lua.hpp>
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the time spent working during a frame, without sleeping.
+ * \param frame A frame.
+ * \return The work time in milliseconds.
+ */
+double get_update_time(const FrameTimings::Frame& frame) {
+  return frame.input_time + frame.game_time + frame.lua_time + frame.system_time + frame.gc_time;
+}
+
+/**
+ * \brief Converts a graph duration to a height in pixels.
+ * \param time A duration in milliseconds.
+ * \param max_time Duration at the top of the graph.
+ * \param height Height of the graph.
+ * \return The height of a bar of this duration, clipped to the graph.
+ */
+int get_bar_height(double time, double max_time, int height) {
+  return std::min(height, static_cast<int>(time * height / max_time + 0.5));
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a hidden overlay.
+ */
+PerformanceOverlay::PerformanceOverlay():
+  visible(false),
+  num_frames_drawn(0),
+  texts_enabled(false),
+  line_surfaces(),
+  panel(nullptr) {
+
+}
+
+/**
+ * \brief Returns whether the overlay is drawn.
+ * \return \c true if it is visible.
+ */
+bool PerformanceOverlay::is_visible() const {
+  return visible;
+}
+
+/**
+ * \brief Shows or hides the overlay.
+ * \param visible \c true to show it.
+ */
+void PerformanceOverlay::set_visible(bool visible) {
+
+  this->visible = visible;
+  num_frames_drawn = 0;
+  if (!visible) {
+    // Free the memory while hidden.
+    line_surfaces.clear();
+    panel = nullptr;
+  }
+}
+
+/**
+ * \brief Draws the overlay if it is visible.
+ *
+ * Numbers are only recomputed every few frames to stay readable
+ * and to keep the cost of the overlay low.
+ *
+ * \param dst_surface The quest surface.
+ * \param frame_timings Measures of the last frames.
+ * \param lua_context The Lua world.
+ * \param game The current game, or nullptr.
+ */
+void PerformanceOverlay::draw(
+    const SurfacePtr& dst_surface,
+    const FrameTimings& frame_timings,
+    LuaContext& lua_context,
+    Game* game
+) {
+  if (!visible) {
+    return;
+  }
+
+  if (panel == nullptr || num_frames_drawn % refresh_interval == 0) {
+    if (panel == nullptr) {
+      // Fonts can only be used once the quest is loaded.
+      texts_enabled = !FontResource::get_default_font_id().empty();
+    }
+    rebuild_panel(compute_lines(frame_timings, lua_context, game), frame_timings);
+  }
+  ++num_frames_drawn;
+
+  panel->draw(dst_surface, margin, margin);
+}
+
+/**
+ * \brief Computes the text of the overlay.
+ * \param frame_timings Measures of the last frames.
+ * \param lua_context The Lua world.
+ * \param game The current game, or nullptr.
+ * \return The lines of text to show.
+ */
+std::vector<std::string> PerformanceOverlay::compute_lines(
+    const FrameTimings& frame_timings,
+    LuaContext& lua_context,
+    Game* game
+) const {
+
+  // Averages over the frames of the graph.
+  const size_t num_frames = std::min(frame_timings.get_num_frames(), static_cast<size_t>(graph_width));
+  const size_t first_frame = frame_timings.get_num_frames() - num_frames;
+  double total_time = 0.0;
+  double update_time = 0.0;
+  double draw_time = 0.0;
+  double max_work_time = 0.0;
+  int num_draw_calls = 0;
+  int num_readbacks = 0;
+  for (size_t i = first_frame; i < frame_timings.get_num_frames(); ++i) {
+    const FrameTimings::Frame& frame = frame_timings.get_frame(i);
+    total_time += frame.total_time;
+    update_time += get_update_time(frame);
+    draw_time += frame.draw_time;
+    max_work_time = std::max(max_work_time, get_update_time(frame) + frame.draw_time);
+    num_draw_calls += frame.num_draw_calls;
+    num_readbacks += frame.num_readbacks;
+  }
+  const double divisor = static_cast<double>(std::max(num_frames, static_cast<size_t>(1)));
+
+  std::vector<std::string> lines;
+  std::ostringstream oss;
+  oss.setf(std::ios::fixed);
+  oss.precision(1);
+
+  oss << "Frame " << total_time / divisor << " ms, work max "
+      << max_work_time << " ms";
+  lines.push_back(oss.str());
+
+  oss.str("");
+  oss << "Update " << update_time / divisor << " ms, draw "
+      << draw_time / divisor << " ms";
+  lines.push_back(oss.str());
+
+  oss.str("");
+  oss << "Draw calls " << static_cast<int>(num_draw_calls / divisor + 0.5)
+      << ", readbacks " << static_cast<int>(num_readbacks / divisor + 0.5);
+  lines.push_back(oss.str());
+
+  if (game != nullptr && game->has_current_map() && game->get_current_map().is_started()) {
+    const Map& map = game->get_current_map();
+    const Entities& entities = map.get_entities();
+    std::vector<std::pair<int, std::string>> counts;
+    int num_entities = 0;
+    for (const auto& kvp: EnumInfoTraits<EntityType>::names) {
+      int count = 0;
+      for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+        count += static_cast<int>(entities.get_entities_by_type(kvp.first, layer).size());
+      }
+      if (count > 0) {
+        counts.emplace_back(count, kvp.second);
+        num_entities += count;
+      }
+    }
+    std::sort(counts.begin(), counts.end(), [](
+        const std::pair<int, std::string>& first,
+        const std::pair<int, std::string>& second
+    ) {
+      return first.first > second.first;
+    });
+
+    oss.str("");
+    oss << "Entities " << num_entities;
+    for (size_t i = 0; i < counts.size() && i < 3; ++i) {
+      oss << (i == 0 ? ": " : ", ") << counts[i].second << " " << counts[i].first;
+    }
+    lines.push_back(oss.str());
+  }
+
+  oss.str("");
+  oss << "Timers " << lua_context.get_num_timers() << ", Lua "
+      << lua_gc(lua_context.get_internal_state(), LUA_GCCOUNT, 0) << " KiB";
+  lines.push_back(oss.str());
+
+  oss.str("");
+  oss << "Textures " << Video::get_texture_memory() / 1024 << " KiB";
+  lines.push_back(oss.str());
+
+  if (Music::get_format() != Music::NO_FORMAT) {
+    oss.str("");
+    oss << "Music decoding " << Music::get_decoding_load() * 100.0
+        << "%, underruns " << Music::get_num_underruns();
+    lines.push_back(oss.str());
+  }
+
+  return lines;
+}
+
+/**
+ * \brief Redraws the graph and the texts on the panel surface.
+ * \param lines Lines of text to show.
+ * \param frame_timings Measures of the last frames.
+ */
+void PerformanceOverlay::rebuild_panel(
+    const std::vector<std::string>& lines,
+    const FrameTimings& frame_timings
+) {
+  // Prepare texts to know the size of the panel.
+  int width = graph_width;
+  int height = graph_height;
+  if (texts_enabled) {
+    while (line_surfaces.size() < lines.size()) {
+      line_surfaces.push_back(std::make_shared<TextSurface>(
+          0,
+          0,
+          TextSurface::HorizontalAlignment::LEFT,
+          TextSurface::VerticalAlignment::TOP
+      ));
+    }
+    for (size_t i = 0; i < lines.size(); ++i) {
+      line_surfaces[i]->set_text(lines[i]);
+      width = std::max(width, line_surfaces[i]->get_width());
+      height += margin + line_surfaces[i]->get_height();
+    }
+  }
+  width += 2 * margin;
+  height += 2 * margin;
+
+  if (panel == nullptr || panel->get_width() != width || panel->get_height() != height) {
+    panel = Surface::create(width, height);
+  }
+  panel->clear();
+  panel->fill_with_color(Color(0, 0, 0, 160));
+
+  // One bar per frame: update time at the bottom, draw time above.
+  const size_t num_frames = std::min(frame_timings.get_num_frames(), static_cast<size_t>(graph_width));
+  const size_t first_frame = frame_timings.get_num_frames() - num_frames;
+  const int graph_x = margin + graph_width - static_cast<int>(num_frames);
+  const int graph_bottom = margin + graph_height;
+  for (size_t i = 0; i < num_frames; ++i) {
+    const FrameTimings::Frame& frame = frame_timings.get_frame(first_frame + i);
+    const int x = graph_x + static_cast<int>(i);
+    const int update_height = get_bar_height(get_update_time(frame), graph_max_time, graph_height);
+    const int work_height = get_bar_height(
+        get_update_time(frame) + frame.draw_time, graph_max_time, graph_height);
+    if (update_height > 0) {
+      panel->fill_with_color(Color(64, 192, 64),
+          Rectangle(x, graph_bottom - update_height, 1, update_height));
+    }
+    if (work_height > update_height) {
+      panel->fill_with_color(Color(64, 128, 255),
+          Rectangle(x, graph_bottom - work_height, 1, work_height - update_height));
+    }
+  }
+
+  // Budget of a 60 Hz frame.
+  const int budget_height = get_bar_height(1000.0 / 60.0, graph_max_time, graph_height);
+  panel->fill_with_color(Color(255, 64, 64, 192),
+      Rectangle(margin, graph_bottom - budget_height, graph_width, 1));
+
+  if (texts_enabled) {
+    int y = graph_bottom + margin;
+    for (size_t i = 0; i < lines.size(); ++i) {
+      line_surfaces[i]->draw(panel, margin, y);
+      y += margin + line_surfaces[i]->get_height();
+    }
+  }
+}
+
+}
@@ -33,8 +33,9 @@ namespace Solarus {
 PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
   width(0),
   height(0),
-  nb_integers_per_row(0),
-  bits() {
+  nb_words_per_row(0),
+  bits(),
+  row_spans() {
 
   // Create a list of boolean values representing the transparency of each pixel.
   // This list is implemented as bit fields.
@@ -51,40 +52,55 @@ PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
   width = clipped_image_position.get_width();
   height = clipped_image_position.get_height();
 
-  nb_integers_per_row = width >> 5; // width / 32
-  if ((width & 31) != 0) { // width % 32 != 0
-    nb_integers_per_row++;
-  }
+  // One more word so that reading 64 bits at any position of a row
+  // never goes past the end of the row.
+  nb_words_per_row = ((width + 63) >> 6) + 1;
 
   int pixel_index = clipped_image_position.get_y() * surface.get_width() + clipped_image_position.get_x();
 
-  bits.resize(height);
+  bits.assign(height * nb_words_per_row, 0);
+  row_spans.resize(height);
   for (int i = 0; i < height; ++i) {
-    bits[i].resize(nb_integers_per_row);
+    uint64_t* row_bits = &bits[i * nb_words_per_row];
+    RowSpan& span = row_spans[i];
+    span.first = width;
+    span.end = 0;
 
-    // Fill the bits for this row, using nb_integers_per_row sequences of 32 bits.
-    int k = -1;
-    uint32_t mask = 0x00000000;  // Current bit in the sequence of 32 bits.
     for (int j = 0; j < width; ++j) {
-      if (mask == 0x00000000) {
-        // Time for a new sequence of 32 bits.
-        k++;
-        mask = 0x80000000;
-        bits[i][k] = 0x00000000;  // Initialize the sequence to transparent.
-      }
-
       // If the pixel is opaque.
       if (!surface.is_pixel_transparent(pixel_index)) {
-        bits[i][k] |= mask;
+        row_bits[j >> 6] |= uint64_t(0x8000000000000000) >> (j & 63);
+        span.first = std::min(span.first, j);
+        span.end = j + 1;
       }
-
-      mask >>= 1;
       ++pixel_index;
     }
+
+    if (span.end == 0) {
+      // Fully transparent row.
+      span.first = 0;
+    }
     pixel_index += surface.get_width() - width;
   }
 }
 
+/**
+ * \brief Returns 64 consecutive bits of a row.
+ * \param row A row of the image.
+ * \param x X coordinate of the first pixel, between 0 and the width.
+ * \return The bits of pixels x to x + 63, the first one in the most
+ * significant bit. Pixels after the end of the row are transparent.
+ */
+inline uint64_t PixelBits::get_bits(int row, int x) const {
+
+  const uint64_t* row_bits = &bits[row * nb_words_per_row + (x >> 6)];
+  const int shift = x & 63;
+  if (shift == 0) {
+    return row_bits[0];
+  }
+  return (row_bits[0] << shift) | (row_bits[1] >> (64 - shift));
+}
+
 /**
  * \brief Detects whether the image represented by these pixel bits is
  * overlapping another image.
@@ -100,7 +116,7 @@ bool PixelBits::test_collision(
 ) const {
   const bool debug_pixel_collisions = false;
 
-  if (bits.empty()) {
+  if (bits.empty() || other.bits.empty()) {
     // No image.
     return false;
   }
@@ -122,109 +138,31 @@ bool PixelBits::test_collision(
     other.print();
   }
 
-  // Compute the intersection between both rectangles.
-  const int intersection_x = std::max(bounding_box1.get_x(), bounding_box2.get_x());
-  const int intersection_y = std::max(bounding_box1.get_y(), bounding_box2.get_y());
-  const Rectangle intersection(
-      intersection_x,
-      intersection_y,
-      std::min(bounding_box1.get_x() + bounding_box1.get_width(),
-          bounding_box2.get_x() + bounding_box2.get_width()) - intersection_x,
-      std::min(bounding_box1.get_y() + bounding_box1.get_height(),
-          bounding_box2.get_y() + bounding_box2.get_height()) - intersection_y);
-
-  if (debug_pixel_collisions) {
-    std::cout << "intersection: " << intersection << "\n";
-  }
-
-  // compute the relative position of the intersection rectangle for each bounding_box
-  Point offset1 = intersection.get_xy() - bounding_box1.get_xy();
-  Point offset2 = intersection.get_xy() - bounding_box2.get_xy();
-
-  if (debug_pixel_collisions) {
-    std::cout << "offset1.x = " << offset1.x << ", offset1.y = " << offset1.y;
-    std::cout << ", offset2.x = " << offset2.x << ", offset2.y = " << offset2.y << std::endl;
-  }
-
-  // For each row of the intersection, we will call row 'a' the row coming from the right bounding box
-  // and row 'b' the one coming from the left bounding box.
+  // Rows of the intersection.
+  const int top = std::max(location1.y, location2.y);
+  const int bottom = std::min(location1.y + height, location2.y + other.height);
 
-  std::vector<std::vector<uint32_t>>::const_iterator rows_a;           // for each row: array of masks of the right bounding box
-  std::vector<std::vector<uint32_t>>::const_iterator rows_b;           // for each row: array of masks of the left bounding box
+  for (int y = top; y < bottom; ++y) {
 
-  int nb_masks_per_row_a;    // number of masks on row a that are in the intersection (row b may have one more mask)
-  int nb_masks_per_row_b;    // number of masks on row b that are in the intersection
-  int nb_unused_masks_row_b; // number of unused masks on row b (i.e. before the intersection)
-  int nb_unused_bits_row_b;  // number of unused bits on the first used mask of row b
-  int nb_used_bits_row_b;    // number of bits used on the first used mask of row b
+    const int row1 = y - location1.y;
+    const int row2 = y - location2.y;
+    const RowSpan& span1 = row_spans[row1];
+    const RowSpan& span2 = other.row_spans[row2];
 
-  // make sure row a starts after row b
-  if (bounding_box1.get_x() > bounding_box2.get_x()) {
-    rows_a = this->bits.begin() + offset1.y;
-    rows_b = other.bits.begin() + offset2.y;
-    nb_unused_masks_row_b = offset2.x >> 5;
-    nb_unused_bits_row_b = offset2.x & 31;
-  }
-  else {
-    rows_a = other.bits.begin() + offset2.y;
-    rows_b = this->bits.begin() + offset1.y;
-    nb_unused_masks_row_b = offset1.x >> 5;
-    nb_unused_bits_row_b = offset1.x & 31;
-  }
-  nb_used_bits_row_b = 32 - nb_unused_bits_row_b;
-
-  // compute the number of masks in the intersection on row a
-  nb_masks_per_row_a = intersection.get_width() >> 5;
-  if ((intersection.get_width() & 31) != 0) {
-    nb_masks_per_row_a++;
-  }
-
-  // compute the number of masks in the intersection on row b
-  nb_masks_per_row_b = (intersection.get_width() + nb_unused_bits_row_b) >> 5;
-  if (((intersection.get_width() + nb_unused_bits_row_b) & 31) != 0) {
-    nb_masks_per_row_b++;
-  }
-
-  // check the collisions each row of the intersection rectangle
-  for (int i = 0; i < intersection.get_height(); ++i) {
-
-    // current row
-    const std::vector<uint32_t>& bits_a = *rows_a;
-    const std::vector<uint32_t>& bits_b = *rows_b;
-
-    ++rows_a;
-    ++rows_b;
+    // Only the pixels that are opaque in both rows matter.
+    // Bits outside a span are transparent, so whole words can be compared
+    // until the end of the shortest span.
+    const int start = std::max(location1.x + span1.first, location2.x + span2.first);
+    const int end = std::min(location1.x + span1.end, location2.x + span2.end);
 
     if (debug_pixel_collisions) {
-      std::cout << "*** checking row " << i << " of the intersection rectangle\n";
+      std::cout << "row " << y << ": checking x from " << start << " to " << end << "\n";
     }
 
-    // Check each mask.
-    for (int j = 0; j < nb_masks_per_row_a; ++j) {
-
-      // We compare the left of a with the right part of b,
-      // and the right part of a with the right part of the next b if any.
-
-      uint32_t mask_a = bits_a[j];
-      uint32_t mask_b = bits_b[j + nb_unused_masks_row_b];
-      uint32_t mask_a_left = mask_a >> nb_unused_bits_row_b;
-      uint32_t next_mask_b_left = 0x00000000;
-      if (j + 1 < nb_masks_per_row_a ||            // Not the last a-mask.
-          nb_masks_per_row_b > nb_masks_per_row_a  // Last a-mask but there exists one more b-mask.
-          ) {
-        // We are still inside the intersection: next_mask_b_left exists.
-        next_mask_b_left = bits_b[j + nb_unused_masks_row_b + 1] >> nb_used_bits_row_b;
-      }
-
-      if (debug_pixel_collisions) {
-        std::cout << "mask_a = ";
-        print_mask(mask_a);
-        std::cout << ", mask b = ";
-        print_mask(mask_b);
-        std::cout << "\n";
-      }
-
-      if (((mask_a_left & mask_b) | (mask_a & next_mask_b_left)) != 0x00000000) {
+    for (int x = start; x < end; x += 64) {
+      const uint64_t mask1 = get_bits(row1, x - location1.x);
+      const uint64_t mask2 = other.get_bits(row2, x - location2.x);
+      if ((mask1 & mask2) != 0) {
         return true;
       }
     }
@@ -240,35 +178,24 @@ void PixelBits::print() const {
 
   std::cout << "frame size is " << width << " x " << height << std::endl;
   for (int i = 0; i < height; i++) {
-    int k = -1;
-    uint32_t mask = 0x00000000;
-    for (int j = 0; j < width; j++) {
-
-      if (mask == 0x00000000) {
-        k++;
-        mask = 0x80000000;
-      }
-
-      if (bits[i][k] & mask) {
-        std::cout << "X";
+    for (int j = 0; j < width; j += 64) {
+      uint64_t mask = get_bits(i, j);
+      for (int k = j; k < std::min(j + 64, width); ++k) {
+        std::cout << (((mask & 0x8000000000000000) != 0) ? "X" : ".");
+        mask <<= 1;
       }
-      else {
-        std::cout << ".";
-      }
-
-      mask >>= 1;
     }
     std::cout << std::endl;
   }
 }
 
 /**
- * \brief Prints an ASCII representation of a 32-bit mask (for debugging purposes only).
+ * \brief Prints an ASCII representation of a 64-bit mask (for debugging purposes only).
  */
-void PixelBits::print_mask(uint32_t mask) const {
+void PixelBits::print_mask(uint64_t mask) const {
 
-  for (int i = 0; i < 32; i++) {
-    std::cout << (((mask & 0x80000000) != 0x00000000) ? "X" : ".");
+  for (int i = 0; i < 64; i++) {
+    std::cout << (((mask & 0x8000000000000000) != 0) ? "X" : ".");
     mask <<= 1;
   }
 }
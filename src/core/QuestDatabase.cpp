@@ -97,11 +97,11 @@ int l_file(lua_State* l) {
 /**
  * \brief Creates an empty quest database object.
  */
-QuestDatabase::QuestDatabase() {
+QuestDatabase::QuestDatabase():
+  resource_maps(EnumInfoTraits<ResourceType>::names.size()),
+  resource_indexes(EnumInfoTraits<ResourceType>::names.size()),
+  files() {
 
-  for (size_t i = 0 ; i < EnumInfoTraits<ResourceType>::names.size(); ++i) {
-    resource_maps.emplace(static_cast<ResourceType>(i), ResourceMap());
-  }
 }
 
 /**
@@ -109,8 +109,12 @@ QuestDatabase::QuestDatabase() {
  */
 void QuestDatabase::clear() {
 
-  for (size_t i = 0; i < EnumInfoTraits<ResourceType>::names.size(); ++i) {
-    resource_maps[static_cast<ResourceType>(i)].clear();
+  for (ResourceMap& resource : resource_maps) {
+    resource.clear();
+  }
+  for (ResourceIndex& index : resource_indexes) {
+    index.ids.clear();
+    index.declared.clear();
   }
 
   files.clear();
@@ -125,8 +129,27 @@ void QuestDatabase::clear() {
  */
 bool QuestDatabase::resource_exists(ResourceType resource_type, const std::string& id) const {
 
-  const ResourceMap& resource = get_resource_elements(resource_type);
-  return resource.find(id) != resource.end();
+  return get_resource_id(resource_type, id) != invalid_resource_id;
+}
+
+/**
+ * \brief Returns the numeric id of a resource element.
+ * \param resource_type A type of resource.
+ * \param id The id to look for.
+ * \return The numeric id of this element, or invalid_resource_id if there is
+ * no element with this id in this resource type.
+ */
+QuestDatabase::ResourceId QuestDatabase::get_resource_id(
+    ResourceType resource_type,
+    const std::string& id
+) const {
+
+  const ResourceIndex& index = resource_indexes[static_cast<size_t>(resource_type)];
+  const auto& it = index.ids.find(id);
+  if (it == index.ids.end() || !index.declared[it->second]) {
+    return invalid_resource_id;
+  }
+  return it->second;
 }
 
 /**
@@ -137,18 +160,18 @@ bool QuestDatabase::resource_exists(ResourceType resource_type, const std::strin
 const QuestDatabase::ResourceMap& QuestDatabase::get_resource_elements(
     ResourceType resource_type) const {
 
-  return resource_maps.find(resource_type)->second;
+  return resource_maps[static_cast<size_t>(resource_type)];
 }
 
 /**
- * \brief Returns the list of element IDs of the specified resource type.
+ * \brief Returns the modifiable list of element IDs of the specified resource type.
  * \param resource_type A type of resource.
  * \return The ids of all declared element of this type
  */
-QuestDatabase::ResourceMap& QuestDatabase::get_resource_elements(
+QuestDatabase::ResourceMap& QuestDatabase::get_resource_map(
     ResourceType resource_type) {
 
-  return resource_maps.find(resource_type)->second;
+  return resource_maps[static_cast<size_t>(resource_type)];
 }
 
 /**
@@ -164,9 +187,21 @@ bool QuestDatabase::add(
     const std::string& id,
     const std::string& description
 ) {
-  ResourceMap& resource = get_resource_elements(resource_type);
+  ResourceMap& resource = get_resource_map(resource_type);
   auto result = resource.emplace(id, description);
-  return result.second;
+  if (!result.second) {
+    return false;
+  }
+
+  ResourceIndex& index = resource_indexes[static_cast<size_t>(resource_type)];
+  const auto& id_result = index.ids.emplace(id, static_cast<ResourceId>(index.declared.size()));
+  if (id_result.second) {
+    index.declared.push_back(true);
+  }
+  else {
+    index.declared[id_result.first->second] = true;
+  }
+  return true;
 }
 
 /**
@@ -180,8 +215,14 @@ bool QuestDatabase::remove(
     ResourceType resource_type,
     const std::string& id
 ) {
-  ResourceMap& resource = get_resource_elements(resource_type);
-  return resource.erase(id) > 0;
+  ResourceMap& resource = get_resource_map(resource_type);
+  if (resource.erase(id) == 0) {
+    return false;
+  }
+
+  ResourceIndex& index = resource_indexes[static_cast<size_t>(resource_type)];
+  index.declared[index.ids.at(id)] = false;
+  return true;
 }
 
 /**
@@ -247,7 +288,7 @@ bool QuestDatabase::set_description(
     return false;
   }
 
-  ResourceMap& resource = get_resource_elements(resource_type);
+  ResourceMap& resource = get_resource_map(resource_type);
   resource[id] = description;
   return true;
 }
@@ -21,12 +21,31 @@
 #include "solarus/core/QuestProperties.h"
 #include "solarus/lua/LuaContext.h"
 #include <physfs.h>
+#include <SDL_rwops.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 #include <cstdlib>  // exit(), mkstemp(), tmpnam()
 #include <cstdio>   // remove()
+#include <sys/types.h>
+#include <sys/stat.h>  // stat()
 #ifdef HAVE_UNISTD_H
 #  include <unistd.h>  // close()
 #endif
+#if defined(HAVE_UNISTD_H) && defined(HAVE_SYS_MMAN_H)
+#  include <fcntl.h>     // open()
+#  include <sys/mman.h>  // mmap()
+#  define SOLARUS_HAVE_MMAP
+#endif
 
 #if defined(SOLARUS_OSX) || defined(SOLARUS_IOS)
 #   include "solarus/core/AppleInterface.h"
@@ -61,6 +80,99 @@ std::string quest_write_dir_;
  */
 std::vector<std::string> temporary_files_;
 
+/**
+ * \brief Maximum memory of files read in advance from a startup manifest.
+ */
+constexpr size_t max_prefetched_size = 32 * 1024 * 1024;
+
+/**
+ * \brief Files read in advance and not used yet,
+ * indexed by name relative to the search path.
+ */
+std::map<std::string, std::string> prefetched_files_;
+
+/**
+ * \brief Files already read directly while prefetching was running.
+ */
+std::set<std::string> files_read_during_prefetch_;
+
+/**
+ * \brief Total size of prefetched_files_ in bytes.
+ */
+size_t prefetched_size_ = 0;
+
+/**
+ * \brief Protects the prefetching data above.
+ */
+std::mutex prefetch_mutex_;
+
+/**
+ * \brief Thread that reads the files of the startup manifest.
+ */
+std::thread prefetch_thread_;
+
+/**
+ * \brief Whether the prefetching thread should exit.
+ */
+std::atomic<bool> prefetch_stopping_(false);
+
+/**
+ * \brief Whether data files read are recorded into a startup manifest.
+ */
+std::atomic<bool> manifest_recording_(false);
+
+/**
+ * \brief When the recording of the startup manifest stops.
+ */
+std::chrono::steady_clock::time_point manifest_end_date_;
+
+/**
+ * \brief Files recorded in the startup manifest, in their first reading order.
+ */
+std::vector<std::string> manifest_files_;
+
+/**
+ * \brief The same files as manifest_files_, for quick lookups.
+ */
+std::set<std::string> manifest_file_set_;
+
+/**
+ * \brief Protects the manifest data above.
+ */
+std::mutex manifest_mutex_;
+
+/**
+ * \brief Name of the file that saves the archive index in the quest write
+ * directory.
+ */
+constexpr const char* archive_index_file_name = "archive_index.dat";
+
+/**
+ * \brief Files of the data archive and of its patches, when the quest data
+ * only comes from one archive, or nullptr.
+ *
+ * Archives do not change while the quest runs, so a file found here exists
+ * without asking PhysFS. Mounting a patch replaces the set, so it is
+ * accessed with std::atomic_load() and std::atomic_store().
+ */
+std::shared_ptr<const std::unordered_set<std::string>> archive_files_;
+
+/**
+ * \brief Directory where patch archives are looked for at startup,
+ * relative to the quest write directory.
+ */
+constexpr const char* patches_dir_name = "patches";
+
+/**
+ * \brief Mount point used to list the files of a patch before mounting it.
+ */
+constexpr const char* patch_listing_mount_point = "solarus_patch_listing";
+
+/**
+ * \brief Real paths of the patch archives mounted, from the lowest priority.
+ */
+std::vector<std::string> patch_archives_;
+
 /**
  * \brief Sets the directory where the engine can write files.
  *
@@ -102,8 +214,681 @@ void set_solarus_write_dir(const std::string& solarus_write_dir) {
   }
 }
 
+/**
+ * \brief Returns the name of a data file relative to the search path.
+ * \param file_name Name of a data file.
+ * \param language_specific \c true if the file is specific to the current language.
+ * \return The file name, prefixed by the language directory if necessary.
+ */
+std::string get_data_file_name(
+    const std::string& file_name,
+    bool language_specific
+) {
+  if (!language_specific) {
+    return file_name;
+  }
+
+  Debug::check_assertion_lazy(!CurrentQuest::get_language().empty(), [&] {
+    return std::string("Cannot open language-specific file '") + file_name + "': no language was set";
+  });
+  return std::string("languages/") +
+      CurrentQuest::get_language() + "/" + file_name;
+}
+
+/**
+ * \brief Opens a data file for reading.
+ * \param full_file_name Name of the file relative to the search path.
+ * \return The PHYSFS file handle.
+ */
+PHYSFS_file* open_data_file(const std::string& full_file_name) {
+
+  Debug::check_assertion_lazy(PHYSFS_exists(full_file_name.c_str()), [&] {
+    return std::string("Data file '") + full_file_name + "' does not exist";
+  });
+  PHYSFS_file* file = PHYSFS_openRead(full_file_name.c_str());
+  Debug::check_assertion_lazy(file != nullptr, [&] {
+    return std::string("Cannot open data file '") + full_file_name + "'";
+  });
+  return file;
+}
+
+/**
+ * \brief Maps a file of the data directory into memory.
+ * \param full_file_name Name of the file relative to the search path.
+ * \return The mapped buffer, or nullptr if the file is not in the data
+ * directory or cannot be mapped.
+ */
+std::shared_ptr<const DataFileBuffer> map_data_directory_file(
+    const std::string& full_file_name) {
+
+#ifdef SOLARUS_HAVE_MMAP
+  if (data_file_get_location(full_file_name) !=
+      DataFileLocation::LOCATION_DATA_DIRECTORY) {
+    return nullptr;
+  }
+
+  const std::string& path =
+      std::string(PHYSFS_getRealDir(full_file_name.c_str())) + "/" + full_file_name;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  void* mapping = nullptr;
+  struct stat file_info;
+  if (fstat(fd, &file_info) == 0 && file_info.st_size > 0) {
+    mapping = mmap(nullptr, static_cast<size_t>(file_info.st_size),
+                   PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);  // The mapping stays valid.
+
+  if (mapping == nullptr || mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::make_shared<DataFileBuffer>(
+      mapping, static_cast<size_t>(file_info.st_size));
+#else
+  (void) full_file_name;
+  return nullptr;
+#endif
+}
+
+/**
+ * \brief Returns the size of a PHYSFS stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+Sint64 SDLCALL rw_size(SDL_RWops* rw) {
+
+  PHYSFS_file* file = static_cast<PHYSFS_file*>(rw->hidden.unknown.data1);
+  return PHYSFS_fileLength(file);
+}
+
+/**
+ * \brief Seeks a PHYSFS stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+Sint64 SDLCALL rw_seek(SDL_RWops* rw, Sint64 offset, int whence) {
+
+  PHYSFS_file* file = static_cast<PHYSFS_file*>(rw->hidden.unknown.data1);
+  Sint64 position = offset;
+  switch (whence) {
+
+  case RW_SEEK_SET:
+    break;
+
+  case RW_SEEK_CUR:
+    position += PHYSFS_tell(file);
+    break;
+
+  case RW_SEEK_END:
+    position += PHYSFS_fileLength(file);
+    break;
+
+  default:
+    return -1;
+  }
+
+  if (position < 0 || !PHYSFS_seek(file, static_cast<PHYSFS_uint64>(position))) {
+    return -1;
+  }
+  return position;
+}
+
+/**
+ * \brief Reads from a PHYSFS stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+size_t SDLCALL rw_read(SDL_RWops* rw, void* ptr, size_t size, size_t max_num) {
+
+  PHYSFS_file* file = static_cast<PHYSFS_file*>(rw->hidden.unknown.data1);
+  if (size == 0) {
+    return 0;
+  }
+  PHYSFS_sint64 num_read = PHYSFS_read(
+      file, ptr, static_cast<PHYSFS_uint32>(size), static_cast<PHYSFS_uint32>(max_num));
+  return num_read < 0 ? 0 : static_cast<size_t>(num_read);
+}
+
+/**
+ * \brief Rejects writing to a data file stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+size_t SDLCALL rw_write(SDL_RWops* /* rw */, const void* /* ptr */,
+    size_t /* size */, size_t /* num */) {
+
+  SDL_SetError("Data files are read-only");
+  return 0;
+}
+
+/**
+ * \brief Closes a PHYSFS stream and frees it.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+int SDLCALL rw_close(SDL_RWops* rw) {
+
+  PHYSFS_file* file = static_cast<PHYSFS_file*>(rw->hidden.unknown.data1);
+  const int result = PHYSFS_close(file) ? 0 : -1;
+  SDL_FreeRW(rw);
+  return result;
+}
+
+/**
+ * \brief Content of a prefetched file being read as a stream.
+ */
+struct MemoryStream {
+  std::string content;        /**< The whole file. */
+  Sint64 position;            /**< Current reading position. */
+};
+
+/**
+ * \brief Returns the size of a memory stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+Sint64 SDLCALL memory_rw_size(SDL_RWops* rw) {
+
+  const MemoryStream* stream = static_cast<const MemoryStream*>(rw->hidden.unknown.data1);
+  return static_cast<Sint64>(stream->content.size());
+}
+
+/**
+ * \brief Seeks a memory stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+Sint64 SDLCALL memory_rw_seek(SDL_RWops* rw, Sint64 offset, int whence) {
+
+  MemoryStream* stream = static_cast<MemoryStream*>(rw->hidden.unknown.data1);
+  const Sint64 size = static_cast<Sint64>(stream->content.size());
+  Sint64 position = offset;
+  switch (whence) {
+
+  case RW_SEEK_SET:
+    break;
+
+  case RW_SEEK_CUR:
+    position += stream->position;
+    break;
+
+  case RW_SEEK_END:
+    position += size;
+    break;
+
+  default:
+    return -1;
+  }
+
+  if (position < 0 || position > size) {
+    return -1;
+  }
+  stream->position = position;
+  return position;
+}
+
+/**
+ * \brief Reads from a memory stream.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+size_t SDLCALL memory_rw_read(SDL_RWops* rw, void* ptr, size_t size, size_t max_num) {
+
+  MemoryStream* stream = static_cast<MemoryStream*>(rw->hidden.unknown.data1);
+  if (size == 0) {
+    return 0;
+  }
+  const size_t available = stream->content.size() - static_cast<size_t>(stream->position);
+  const size_t num_read = std::min(max_num, available / size);
+  std::memcpy(ptr, stream->content.data() + stream->position, num_read * size);
+  stream->position += static_cast<Sint64>(num_read * size);
+  return num_read;
+}
+
+/**
+ * \brief Closes a memory stream and frees it.
+ *
+ * This function respects the prototype specified by SDL_RWops.
+ */
+int SDLCALL memory_rw_close(SDL_RWops* rw) {
+
+  delete static_cast<MemoryStream*>(rw->hidden.unknown.data1);
+  SDL_FreeRW(rw);
+  return 0;
+}
+
+/**
+ * \brief Records that a data file is read, if a startup manifest is being
+ * recorded.
+ * \param full_file_name Name of the file relative to the search path.
+ */
+void notify_file_read(const std::string& full_file_name) {
+
+  if (!manifest_recording_) {
+    return;
+  }
+
+  if (std::chrono::steady_clock::now() > manifest_end_date_) {
+    manifest_recording_ = false;
+    return;
+  }
+
+  // Files of the write directory like savegames may change.
+  if (data_file_get_location(full_file_name) == DataFileLocation::LOCATION_WRITE_DIRECTORY) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(manifest_mutex_);
+  if (manifest_file_set_.insert(full_file_name).second) {
+    manifest_files_.push_back(full_file_name);
+  }
+}
+
+/**
+ * \brief Takes the content of a file read in advance.
+ *
+ * The file is removed from the prefetched ones: it is only used once.
+ *
+ * \param[in] full_file_name Name of the file relative to the search path.
+ * \param[out] content The content of the file if it was prefetched.
+ * \return \c true if the file was prefetched.
+ */
+bool take_prefetched_file(const std::string& full_file_name, std::string& content) {
+
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  const auto& it = prefetched_files_.find(full_file_name);
+  if (it == prefetched_files_.end()) {
+    if (prefetch_thread_.joinable()) {
+      files_read_during_prefetch_.insert(full_file_name);
+    }
+    return false;
+  }
+
+  content = std::move(it->second);
+  prefetched_size_ -= content.size();
+  prefetched_files_.erase(it);
+  return true;
+}
+
+/**
+ * \brief Drops the prefetched content of a file that is being modified.
+ * \param full_file_name Name of the file relative to the search path.
+ */
+void forget_prefetched_file(const std::string& full_file_name) {
+
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  const auto& it = prefetched_files_.find(full_file_name);
+  if (it != prefetched_files_.end()) {
+    prefetched_size_ -= it->second.size();
+    prefetched_files_.erase(it);
+  }
+  files_read_during_prefetch_.insert(full_file_name);
+}
+
+/**
+ * \brief Reads files in advance until the memory limit is reached.
+ *
+ * This function runs on the prefetching thread.
+ *
+ * \param file_names Names of the files relative to the search path,
+ * none of them in the write directory.
+ */
+void run_prefetching(const std::vector<std::string>& file_names) {
+
+  for (const std::string& file_name : file_names) {
+
+    if (prefetch_stopping_) {
+      return;
+    }
+
+    PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
+    if (file == nullptr) {
+      continue;
+    }
+    const size_t size = static_cast<size_t>(PHYSFS_fileLength(file));
+    {
+      std::lock_guard<std::mutex> lock(prefetch_mutex_);
+      if (prefetched_size_ + size > max_prefetched_size) {
+        PHYSFS_close(file);
+        return;
+      }
+      if (files_read_during_prefetch_.find(file_name) != files_read_during_prefetch_.end()) {
+        PHYSFS_close(file);
+        continue;
+      }
+    }
+
+    std::string buffer(size, '\0');
+    if (size > 0) {
+      PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) size);
+    }
+    PHYSFS_close(file);
+
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    if (files_read_during_prefetch_.find(file_name) == files_read_during_prefetch_.end() &&
+        prefetched_files_.emplace(file_name, std::move(buffer)).second) {
+      prefetched_size_ += size;
+    }
+  }
+}
+
+/**
+ * \brief Stops the prefetching thread and drops the prefetched files.
+ */
+void stop_prefetching() {
+
+  if (prefetch_thread_.joinable()) {
+    prefetch_stopping_ = true;
+    prefetch_thread_.join();
+    prefetch_stopping_ = false;
+  }
+
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  prefetched_files_.clear();
+  files_read_during_prefetch_.clear();
+  prefetched_size_ = 0;
+}
+
+/**
+ * \brief Returns the data archive of the quest if it is the only source
+ * of data files.
+ * \return The archive path as in the search path, or an empty string if
+ * there is a data directory or several archives.
+ */
+std::string get_single_archive_path() {
+
+  char** search_path = PHYSFS_getSearchPath();
+  if (search_path == nullptr) {
+    return "";
+  }
+
+  const char* write_dir = quest_write_dir_.empty() ? nullptr : PHYSFS_getWriteDir();
+  std::string archive_path;
+  int num_sources = 0;
+  for (char** path_ptr = search_path; *path_ptr != nullptr; ++path_ptr) {
+    const std::string path = *path_ptr;
+    if (write_dir != nullptr && path == write_dir) {
+      continue;
+    }
+    ++num_sources;
+    if (path.rfind("data.solarus") == path.size() - 12
+        || path.rfind("data.solarus.zip") == path.size() - 16) {
+      archive_path = path;
+    }
+  }
+  PHYSFS_freeList(search_path);
+
+  return num_sources == 1 ? archive_path : "";
+}
+
+/**
+ * \brief Returns a string that changes whenever an archive is rebuilt.
+ * \param archive_path Path of the archive.
+ * \return Its size and modification date, or an empty string if the
+ * archive is not a regular file.
+ */
+std::string get_archive_key(const std::string& archive_path) {
+
+  struct stat info;
+  if (stat(archive_path.c_str(), &info) != 0 ||
+      (info.st_mode & S_IFMT) != S_IFREG) {
+    return "";
+  }
+
+  std::ostringstream oss;
+  oss << "size " << static_cast<int64_t>(info.st_size)
+      << " date " << static_cast<int64_t>(info.st_mtime);
+  return oss.str();
+}
+
+/**
+ * \brief Lists the files of an archive.
+ * \param archive_path The archive as in the search path.
+ * \param dir_name A directory relative to the search path,
+ * or an empty string for the root.
+ * \param file_names Receives the files of this directory and of its
+ * subdirectories that come from the archive.
+ */
+void list_archive_files(
+    const std::string& archive_path,
+    const std::string& dir_name,
+    std::vector<std::string>& file_names
+) {
+  char** files = PHYSFS_enumerateFiles(dir_name.c_str());
+  if (files == nullptr) {
+    return;
+  }
+
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = dir_name.empty() ?
+        std::string(*file) : dir_name + "/" + *file;
+
+    if (PHYSFS_isDirectory(file_name.c_str())) {
+      list_archive_files(archive_path, file_name, file_names);
+      continue;
+    }
+
+    // Skip files of the write directory.
+    const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+    if (real_dir != nullptr && archive_path == real_dir) {
+      file_names.push_back(file_name);
+    }
+  }
+  PHYSFS_freeList(files);
+}
+
+/**
+ * \brief Fills the index of archive files if the quest only comes from an
+ * archive.
+ *
+ * The index is saved in the quest write directory with the size and date
+ * of the archive, so that it only has to be built again when the archive
+ * changes.
+ */
+void load_archive_index() {
+
+  const std::string& archive_path = get_single_archive_path();
+  if (archive_path.empty()) {
+    return;
+  }
+  const std::string& key = get_archive_key(archive_path);
+  if (key.empty()) {
+    return;
+  }
+
+  std::vector<std::string> file_names;
+  bool up_to_date = false;
+  if (!quest_write_dir_.empty()) {
+    std::ifstream index_file(get_full_quest_write_dir() + "/" + archive_index_file_name);
+    std::string line;
+    if (std::getline(index_file, line) && line == key) {
+      while (std::getline(index_file, line)) {
+        if (!line.empty()) {
+          file_names.push_back(line);
+        }
+      }
+      up_to_date = true;
+    }
+  }
+
+  if (!up_to_date) {
+    list_archive_files(archive_path, "", file_names);
+    if (!quest_write_dir_.empty()) {
+      std::sort(file_names.begin(), file_names.end());
+      std::ostringstream oss;
+      oss << key << '\n';
+      for (const std::string& file_name: file_names) {
+        oss << file_name << '\n';
+      }
+      data_file_replace(archive_index_file_name, oss.str());
+    }
+  }
+
+  std::atomic_store(&archive_files_, std::shared_ptr<const std::unordered_set<std::string>>(
+      std::make_shared<std::unordered_set<std::string>>(file_names.begin(), file_names.end())
+  ));
+}
+
+/**
+ * \brief Lists the files of a directory of the search path and of its
+ * subdirectories.
+ * \param dir_name A directory relative to the search path.
+ * \param file_names Receives the files found, relative to the search path.
+ */
+void list_files(const std::string& dir_name, std::vector<std::string>& file_names) {
+
+  char** files = PHYSFS_enumerateFiles(dir_name.c_str());
+  if (files == nullptr) {
+    return;
+  }
+
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = dir_name + "/" + *file;
+    if (PHYSFS_isDirectory(file_name.c_str())) {
+      list_files(file_name, file_names);
+    }
+    else {
+      file_names.push_back(file_name);
+    }
+  }
+  PHYSFS_freeList(files);
+}
+
+/**
+ * \brief Lists the files of an archive that is not mounted yet.
+ *
+ * The archive is mounted alone under a temporary mount point, so that
+ * other archives are not enumerated.
+ *
+ * \param archive_path Real path of the archive.
+ * \param file_names Receives its files, relative to the archive root.
+ * \return \c false if the archive cannot be opened.
+ */
+bool list_patch_files(const std::string& archive_path, std::vector<std::string>& file_names) {
+
+  if (!PHYSFS_mount(archive_path.c_str(), patch_listing_mount_point, 1)) {
+    return false;
+  }
+
+  std::vector<std::string> mounted_names;
+  list_files(patch_listing_mount_point, mounted_names);
+  PHYSFS_removeFromSearchPath(archive_path.c_str());
+
+  const size_t prefix_size = std::strlen(patch_listing_mount_point) + 1;
+  for (const std::string& mounted_name: mounted_names) {
+    file_names.push_back(mounted_name.substr(prefix_size));
+  }
+  return true;
+}
+
+/**
+ * \brief Mounts the patch archives of the patches directory of the quest
+ * write directory, in the order of their names.
+ */
+void mount_startup_patches() {
+
+  if (quest_write_dir_.empty()) {
+    return;
+  }
+
+  char** files = PHYSFS_enumerateFiles(patches_dir_name);
+  if (files == nullptr) {
+    return;
+  }
+
+  const std::string write_dir = PHYSFS_getWriteDir();
+  std::vector<std::string> patch_names;
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = std::string(patches_dir_name) + "/" + *file;
+    const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+    if (real_dir != nullptr && write_dir == real_dir &&
+        !PHYSFS_isDirectory(file_name.c_str())) {
+      patch_names.push_back(file_name);
+    }
+  }
+  PHYSFS_freeList(files);
+
+  std::sort(patch_names.begin(), patch_names.end());
+  for (const std::string& patch_name: patch_names) {
+    std::vector<std::string> overridden_files;
+    if (!mount_patch(patch_name, overridden_files)) {
+      Debug::error(std::string("Cannot mount patch archive '") + patch_name + "'");
+    }
+  }
+}
+
 } // Anonymous namespace
 
+/**
+ * \brief Creates a buffer from content read into memory.
+ * \param content The content of the file.
+ */
+DataFileBuffer::DataFileBuffer(std::string&& content):
+  content(std::move(content)),
+  mapping(nullptr),
+  mapping_size(0) {
+
+}
+
+/**
+ * \brief Creates a buffer from memory-mapped content.
+ * \param mapping The mapped memory. The buffer unmaps it when destroyed.
+ * \param mapping_size Size of the mapped memory in bytes.
+ */
+DataFileBuffer::DataFileBuffer(void* mapping, size_t mapping_size):
+  content(),
+  mapping(mapping),
+  mapping_size(mapping_size) {
+
+}
+
+/**
+ * \brief Destroys the buffer and unmaps its memory if any.
+ */
+DataFileBuffer::~DataFileBuffer() {
+
+#ifdef SOLARUS_HAVE_MMAP
+  if (mapping != nullptr) {
+    munmap(mapping, mapping_size);
+  }
+#endif
+}
+
+/**
+ * \brief Returns the content of the file.
+ * \return The first byte of the file.
+ */
+const char* DataFileBuffer::data() const {
+
+  if (mapping != nullptr) {
+    return static_cast<const char*>(mapping);
+  }
+  return content.data();
+}
+
+/**
+ * \brief Returns the size of the file.
+ * \return The size in bytes.
+ */
+size_t DataFileBuffer::size() const {
+
+  if (mapping != nullptr) {
+    return mapping_size;
+  }
+  return content.size();
+}
+
+/**
+ * \brief Returns whether the content is memory-mapped.
+ * \return \c true if the content is mapped, \c false if it was read into memory.
+ */
+bool DataFileBuffer::is_mapped() const {
+  return mapping != nullptr;
+}
+
 /**
  * \brief Opens a quest.
  *
@@ -151,6 +936,8 @@ SOLARUS_API bool open_quest(const std::string& program_name, const std::string&
   // Set the quest write directory.
   CurrentQuest::initialize();
   set_quest_write_dir(CurrentQuest::get_properties().get_quest_write_dir());
+  load_archive_index();
+  mount_startup_patches();
 
   return true;
 }
@@ -164,8 +951,12 @@ SOLARUS_API void close_quest() {
     return;
   }
 
+  stop_prefetching();
   CurrentQuest::quit();
 
+  std::atomic_store(&archive_files_, std::shared_ptr<const std::unordered_set<std::string>>());
+  patch_archives_.clear();
+
   remove_temporary_files();
 
   quest_path_ = "";
@@ -234,8 +1025,9 @@ SOLARUS_API DataFileLocation data_file_get_location(
     return DataFileLocation::LOCATION_DATA_DIRECTORY;
   }
 
-  if (path.rfind("data.solarus") == path.size() - 12
-      || path.rfind("data.solarus.zip") == path.size() - 16) {
+  // data.solarus, data.solarus.zip or a patch archive.
+  if (path.rfind(".solarus") == path.size() - 8
+      || path.rfind(".zip") == path.size() - 4) {
     return DataFileLocation::LOCATION_DATA_ARCHIVE;
   }
 
@@ -266,9 +1058,27 @@ SOLARUS_API bool data_file_exists(const std::string& file_name,
     full_file_name = file_name;
   }
 
+  const std::shared_ptr<const std::unordered_set<std::string>>& archive_files =
+      std::atomic_load(&archive_files_);
+  if (archive_files != nullptr &&
+      archive_files->find(full_file_name) != archive_files->end()) {
+    return true;
+  }
+
   return PHYSFS_exists(full_file_name.c_str()) && !PHYSFS_isDirectory(full_file_name.c_str());
 }
 
+/**
+ * \brief Returns the last modification date of a data file.
+ * \param file_name Name of the file.
+ * \return The modification date in seconds since the epoch,
+ * or -1 if it cannot be determined.
+ */
+SOLARUS_API int64_t data_file_get_modification_date(const std::string& file_name) {
+
+  return PHYSFS_getLastModTime(file_name.c_str());
+}
+
 /**
  * \brief Opens a data file an loads its content into memory.
  * \param file_name Name of the file to open.
@@ -279,36 +1089,112 @@ SOLARUS_API std::string data_file_read(
     const std::string& file_name,
     bool language_specific
 ) {
-  std::string full_file_name;
-  if (language_specific) {
-    Debug::check_assertion(!CurrentQuest::get_language().empty(),
-        std::string("Cannot open language-specific file '") + file_name
-        + "': no language was set"
-    );
-    full_file_name = std::string("languages/") +
-        CurrentQuest::get_language() + "/" + file_name;
-  }
-  else {
-    full_file_name = file_name;
+  const std::string& full_file_name = get_data_file_name(file_name, language_specific);
+  notify_file_read(full_file_name);
+
+  std::string prefetched_content;
+  if (take_prefetched_file(full_file_name, prefetched_content)) {
+    return prefetched_content;
   }
 
-  // open the file
-  Debug::check_assertion(PHYSFS_exists(full_file_name.c_str()),
-      std::string("Data file '") + full_file_name + "' does not exist"
-  );
-  PHYSFS_file* file = PHYSFS_openRead(full_file_name.c_str());
-  Debug::check_assertion(file != nullptr,
-      std::string("Cannot open data file '") + full_file_name + "'"
-  );
+  PHYSFS_file* file = open_data_file(full_file_name);
 
-  // load it into memory
-  size_t size =  static_cast<size_t>(PHYSFS_fileLength(file));
-  std::vector<char> buffer(size);
+  // Load it into memory.
+  size_t size = static_cast<size_t>(PHYSFS_fileLength(file));
+  std::string buffer(size, '\0');
 
-  PHYSFS_read(file, buffer.data(), 1, (PHYSFS_uint32) size);
+  if (size > 0) {
+    PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) size);
+  }
   PHYSFS_close(file);
 
-  return std::string(buffer.data(), size);
+  return buffer;
+}
+
+/**
+ * \brief Returns the content of a data file without copying it when possible.
+ *
+ * Files of the data directory are memory-mapped.
+ * Files from an archive or from the write directory are read into memory
+ * like with data_file_read().
+ *
+ * \param file_name Name of the file to open.
+ * \param language_specific \c true if the file is specific to the current language.
+ * \return The content of the file.
+ */
+SOLARUS_API std::shared_ptr<const DataFileBuffer> data_file_map(
+    const std::string& file_name,
+    bool language_specific
+) {
+  const std::string& full_file_name = get_data_file_name(file_name, language_specific);
+  Debug::check_assertion_lazy(PHYSFS_exists(full_file_name.c_str()), [&] {
+    return std::string("Data file '") + full_file_name + "' does not exist";
+  });
+
+  // data_file_read() uses the prefetched content if any.
+  std::shared_ptr<const DataFileBuffer> mapped_buffer =
+      map_data_directory_file(full_file_name);
+  if (mapped_buffer != nullptr) {
+    notify_file_read(full_file_name);
+    std::string prefetched_content;
+    take_prefetched_file(full_file_name, prefetched_content);  // Not needed anymore.
+    return mapped_buffer;
+  }
+
+  return std::make_shared<DataFileBuffer>(data_file_read(full_file_name));
+}
+
+/**
+ * \brief Opens a data file as a stream, without loading it into memory.
+ *
+ * This is useful for data that is decoded progressively, like musics.
+ *
+ * \param file_name Name of the file to open.
+ * \param language_specific \c true if the file is specific to the current language.
+ * \return A read-only SDL stream. Close it with SDL_RWclose().
+ */
+SOLARUS_API SDL_RWops* data_file_open_rw(
+    const std::string& file_name,
+    bool language_specific
+) {
+  const std::string& full_file_name = get_data_file_name(file_name, language_specific);
+  notify_file_read(full_file_name);
+
+  std::string prefetched_content;
+  if (take_prefetched_file(full_file_name, prefetched_content)) {
+    SDL_RWops* rw = SDL_AllocRW();
+    Debug::check_assertion_lazy(rw != nullptr, [&] {
+      return std::string("Cannot create stream for data file '") + full_file_name + "'";
+    });
+    rw->size = memory_rw_size;
+    rw->seek = memory_rw_seek;
+    rw->read = memory_rw_read;
+    rw->write = rw_write;
+    rw->close = memory_rw_close;
+    rw->type = SDL_RWOPS_UNKNOWN;
+    rw->hidden.unknown.data1 = new MemoryStream{ std::move(prefetched_content), 0 };
+    rw->hidden.unknown.data2 = nullptr;
+    return rw;
+  }
+
+  PHYSFS_file* file = open_data_file(full_file_name);
+
+  // Avoid small reads from the archive or from the system.
+  PHYSFS_setBuffer(file, 16384);
+
+  SDL_RWops* rw = SDL_AllocRW();
+  Debug::check_assertion_lazy(rw != nullptr, [&] {
+    return std::string("Cannot create stream for data file '") + full_file_name + "'";
+  });
+  rw->size = rw_size;
+  rw->seek = rw_seek;
+  rw->read = rw_read;
+  rw->write = rw_write;
+  rw->close = rw_close;
+  rw->type = SDL_RWOPS_UNKNOWN;
+  rw->hidden.unknown.data1 = file;
+  rw->hidden.unknown.data2 = nullptr;
+  return rw;
 }
 
 /**
@@ -321,6 +1207,8 @@ SOLARUS_API void data_file_save(
     const std::string& file_name,
     const std::string& buffer
 ) {
+  forget_prefetched_file(file_name);
+
   // open the file to write
   PHYSFS_file* file = PHYSFS_openWrite(file_name.c_str());
   if (file == nullptr) {
@@ -337,6 +1225,78 @@ SOLARUS_API void data_file_save(
   PHYSFS_close(file);
 }
 
+/**
+ * \brief Saves a buffer into a data file without ever leaving it half-written.
+ *
+ * The buffer is written to a temporary file that then replaces the
+ * destination. Unlike data_file_save(), errors are returned instead of
+ * stopping the program, and this function can be called from any thread.
+ *
+ * \param file_name Name of the file to write, relative to Solarus write directory.
+ * \param buffer The buffer to save.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool data_file_replace(
+    const std::string& file_name,
+    const std::string& buffer
+) {
+  forget_prefetched_file(file_name);
+
+  const std::string& temporary_file_name = file_name + ".tmp";
+  PHYSFS_file* file = PHYSFS_openWrite(temporary_file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = PHYSFS_write(file, buffer.data(), (PHYSFS_uint32) buffer.size(), 1) != -1;
+  success = PHYSFS_close(file) != 0 && success;
+  if (!success) {
+    PHYSFS_delete(temporary_file_name.c_str());
+    return false;
+  }
+
+  // PhysicsFS cannot rename files: do it in the real directory.
+  const std::string& write_dir = PHYSFS_getWriteDir();
+  const std::string& path = write_dir + "/" + file_name;
+  const std::string& temporary_path = write_dir + "/" + temporary_file_name;
+  if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+    // Some systems cannot rename onto an existing file.
+    std::remove(path.c_str());
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+      PHYSFS_delete(temporary_file_name.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Adds a buffer at the end of a data file, creating it if needed.
+ *
+ * Like data_file_replace(), errors are returned and this function can be
+ * called from any thread.
+ *
+ * \param file_name Name of the file to write, relative to Solarus write directory.
+ * \param buffer The buffer to add.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool data_file_append(
+    const std::string& file_name,
+    const std::string& buffer
+) {
+  forget_prefetched_file(file_name);
+
+  PHYSFS_file* file = PHYSFS_openAppend(file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = buffer.empty() ||
+      PHYSFS_write(file, buffer.data(), (PHYSFS_uint32) buffer.size(), 1) != -1;
+  success = PHYSFS_close(file) != 0 && success;
+  return success;
+}
+
 /**
  * \brief Removes a file from the write directory.
  * \param file_name Name of the file to delete, relative to the Solarus
@@ -345,6 +1305,7 @@ SOLARUS_API void data_file_save(
  */
 SOLARUS_API bool data_file_delete(const std::string& file_name) {
 
+  forget_prefetched_file(file_name);
   if (!PHYSFS_delete(file_name.c_str())) {
     return false;
   }
@@ -367,6 +1328,72 @@ SOLARUS_API bool data_file_mkdir(const std::string& dir_name) {
   return true;
 }
 
+/**
+ * \brief Mounts a patch archive over the quest data.
+ *
+ * Files of the patch replace the ones of the data directory, of the data
+ * archive and of patches mounted before. The quest write directory keeps
+ * the priority. The index of archive files is completed with the files of
+ * the patch only, without enumerating the base archive again.
+ *
+ * Patches found in the patches/ directory of the quest write directory
+ * are mounted when the quest is opened. This function must be called from
+ * the main thread.
+ *
+ * \param file_name Name of the patch archive, relative to the quest write
+ * directory.
+ * \param overridden_files Receives the files of the patch that already
+ * existed, so that what depends on them can be reloaded.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool mount_patch(
+    const std::string& file_name,
+    std::vector<std::string>& overridden_files
+) {
+  if (quest_write_dir_.empty()) {
+    return false;
+  }
+
+  const std::string write_dir = PHYSFS_getWriteDir();
+  const std::string& archive_path = write_dir + "/" + file_name;
+  if (std::find(patch_archives_.begin(), patch_archives_.end(), archive_path) !=
+      patch_archives_.end()) {
+    // Already mounted.
+    return true;
+  }
+
+  std::vector<std::string> file_names;
+  if (!list_patch_files(archive_path, file_names)) {
+    return false;
+  }
+
+  for (const std::string& patch_file_name: file_names) {
+    if (data_file_exists(patch_file_name, false)) {
+      overridden_files.push_back(patch_file_name);
+    }
+    forget_prefetched_file(patch_file_name);
+  }
+
+  // Insert the patch just below the write directory.
+  PHYSFS_removeFromSearchPath(write_dir.c_str());
+  const bool success = PHYSFS_addToSearchPath(archive_path.c_str(), 0) != 0;
+  PHYSFS_addToSearchPath(write_dir.c_str(), 0);
+  if (!success) {
+    return false;
+  }
+  patch_archives_.push_back(archive_path);
+
+  const std::shared_ptr<const std::unordered_set<std::string>>& archive_files =
+      std::atomic_load(&archive_files_);
+  if (archive_files != nullptr) {
+    std::shared_ptr<std::unordered_set<std::string>> merged_files =
+        std::make_shared<std::unordered_set<std::string>>(*archive_files);
+    merged_files->insert(file_names.begin(), file_names.end());
+    std::atomic_store(&archive_files_, std::shared_ptr<const std::unordered_set<std::string>>(merged_files));
+  }
+  return true;
+}
+
 /**
  * \brief Returns the directory where the engine can write files.
  * \returns The directory where the engine can write files, relative to the
@@ -513,6 +1540,94 @@ SOLARUS_API bool remove_temporary_files() {
   return success;
 }
 
+/**
+ * \brief Starts reading in the background the data files listed in a
+ * startup manifest.
+ *
+ * The manifest is a text data file with one file name per line,
+ * relative to the quest data directory. Empty lines and lines starting with
+ * '#' are ignored.
+ * Files are kept in memory until they are read with data_file_read(),
+ * data_file_map() or data_file_open_rw(), up to a fixed memory limit.
+ * Files of the quest write directory are never prefetched.
+ *
+ * \param manifest_file_name Name of the manifest data file.
+ * \return \c true if the manifest exists and prefetching has started.
+ */
+SOLARUS_API bool prefetch_files(const std::string& manifest_file_name) {
+
+  if (!data_file_exists(manifest_file_name)) {
+    return false;
+  }
+
+  stop_prefetching();
+
+  std::vector<std::string> file_names;
+  std::istringstream iss(data_file_read(manifest_file_name));
+  std::string line;
+  while (std::getline(iss, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (!data_file_exists(line) ||
+        data_file_get_location(line) == DataFileLocation::LOCATION_WRITE_DIRECTORY) {
+      continue;
+    }
+    file_names.push_back(line);
+  }
+
+  if (file_names.empty()) {
+    return false;
+  }
+
+  prefetch_thread_ = std::thread(run_prefetching, std::move(file_names));
+  return true;
+}
+
+/**
+ * \brief Starts recording the data files read, to build a startup manifest.
+ *
+ * Each file is recorded once, in the order of its first reading.
+ * Files of the quest write directory are not recorded.
+ *
+ * \param duration Time in milliseconds after which files are not recorded
+ * anymore.
+ */
+SOLARUS_API void start_manifest_recording(uint32_t duration) {
+
+  std::lock_guard<std::mutex> lock(manifest_mutex_);
+  manifest_files_.clear();
+  manifest_file_set_.clear();
+  manifest_end_date_ = std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(duration);
+  manifest_recording_ = true;
+}
+
+/**
+ * \brief Writes the files recorded since start_manifest_recording().
+ *
+ * The result can be copied to the quest data directory as
+ * a startup manifest for prefetch_files().
+ *
+ * \param file_name Path of the manifest to write, in the real filesystem.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool save_manifest(const std::string& file_name) {
+
+  manifest_recording_ = false;
+
+  std::lock_guard<std::mutex> lock(manifest_mutex_);
+  std::ofstream out(file_name.c_str());
+  out << "# Data files read at startup, prefetched in this order." << std::endl;
+  for (const std::string& manifest_file: manifest_files_) {
+    out << manifest_file << std::endl;
+  }
+  return static_cast<bool>(out);
+}
+
 }  // namespace QuestFiles
 
 }  // namespace Solarus
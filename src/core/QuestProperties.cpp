@@ -75,6 +75,55 @@ int l_quest(lua_State* l) {
     const std::string& max_quest_size_string =
         LuaTools::opt_string_field(l, 1, "max_quest_size", normal_quest_size_string);
 
+    const int lua_gc_step_time =
+        LuaTools::opt_int_field(l, 1, "lua_gc_step_time", QuestProperties::default_lua_gc_step_time);
+    const int lua_gc_pause =
+        LuaTools::opt_int_field(l, 1, "lua_gc_pause", QuestProperties::default_lua_gc_pause);
+    const int lua_gc_step_multiplier =
+        LuaTools::opt_int_field(l, 1, "lua_gc_step_multiplier", QuestProperties::default_lua_gc_step_multiplier);
+    const int lua_memory_limit =
+        LuaTools::opt_int_field(l, 1, "lua_memory_limit", 0);
+    const bool collision_broad_phase =
+        LuaTools::opt_boolean_field(l, 1, "collision_broad_phase", false);
+    const bool compact_textures =
+        LuaTools::opt_boolean_field(l, 1, "compact_textures", false);
+    const bool batch_position_notifications =
+        LuaTools::opt_boolean_field(l, 1, "batch_position_notifications", false);
+    const int sound_streaming_duration =
+        LuaTools::opt_int_field(l, 1, "sound_streaming_duration", 0);
+    const std::string& vsync =
+        LuaTools::opt_string_field(l, 1, "vsync", "adaptive");
+    const int draw_rate =
+        LuaTools::opt_int_field(l, 1, "draw_rate", 0);
+    const bool deterministic_movements =
+        LuaTools::opt_boolean_field(l, 1, "deterministic_movements", false);
+    const std::string& background_mode =
+        LuaTools::opt_string_field(l, 1, "background_mode", "continue");
+    if (lua_gc_step_time < 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'lua_gc_step_time' (must be positive or zero)");
+    }
+    if (lua_gc_pause < 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'lua_gc_pause' (must be positive or zero)");
+    }
+    if (lua_gc_step_multiplier <= 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'lua_gc_step_multiplier' (must be positive)");
+    }
+    if (lua_memory_limit < 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'lua_memory_limit' (must be positive or zero)");
+    }
+    if (sound_streaming_duration < 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'sound_streaming_duration' (must be positive or zero)");
+    }
+    if (vsync != "on" && vsync != "adaptive" && vsync != "off") {
+      LuaTools::arg_error(l, 1, "Bad field 'vsync' (must be \"on\", \"adaptive\" or \"off\")");
+    }
+    if (draw_rate < 0) {
+      LuaTools::arg_error(l, 1, "Bad field 'draw_rate' (must be positive or zero)");
+    }
+    if (background_mode != "continue" && background_mode != "throttle" && background_mode != "pause") {
+      LuaTools::arg_error(l, 1, "Bad field 'background_mode' (must be \"continue\", \"throttle\" or \"pause\")");
+    }
+
     properties.set_solarus_version(solarus_version);
     properties.set_quest_write_dir(quest_write_dir);
     properties.set_title(title);
@@ -118,6 +167,19 @@ int l_quest(lua_State* l) {
     properties.set_min_quest_size(min_quest_size);
     properties.set_max_quest_size(max_quest_size);
 
+    properties.set_lua_gc_step_time(lua_gc_step_time);
+    properties.set_lua_gc_pause(lua_gc_pause);
+    properties.set_lua_gc_step_multiplier(lua_gc_step_multiplier);
+    properties.set_lua_memory_limit(lua_memory_limit);
+    properties.set_collision_broad_phase_enabled(collision_broad_phase);
+    properties.set_compact_textures_enabled(compact_textures);
+    properties.set_position_notifications_batched(batch_position_notifications);
+    properties.set_sound_streaming_duration(sound_streaming_duration);
+    properties.set_vsync(vsync);
+    properties.set_draw_rate(draw_rate);
+    properties.set_movements_deterministic(deterministic_movements);
+    properties.set_background_mode(background_mode);
+
     return 0;
   });
 }
@@ -127,7 +189,19 @@ int l_quest(lua_State* l) {
 /**
  * \brief Creates quest properties.
  */
-QuestProperties::QuestProperties() {
+QuestProperties::QuestProperties():
+  lua_gc_step_time(default_lua_gc_step_time),
+  lua_gc_pause(default_lua_gc_pause),
+  lua_gc_step_multiplier(default_lua_gc_step_multiplier),
+  lua_memory_limit(0),
+  collision_broad_phase(false),
+  compact_textures(false),
+  batch_position_notifications(false),
+  sound_streaming_duration(0),
+  vsync("adaptive"),
+  draw_rate(0),
+  deterministic_movements(false),
+  background_mode("continue") {
 }
 
 /**
@@ -164,8 +238,46 @@ bool QuestProperties::export_to_lua(std::ostream& out) const {
       << "  website = \"" << escape_string(website) << "\",\n"
       << "  normal_quest_size = \"" << normal_quest_size.width << 'x' << normal_quest_size.height << "\",\n"
       << "  min_quest_size = \"" << min_quest_size.width << 'x' << min_quest_size.height << "\",\n"
-      << "  max_quest_size = \"" << max_quest_size.width << 'x' << max_quest_size.height << "\",\n"
-      << "}\n\n";
+      << "  max_quest_size = \"" << max_quest_size.width << 'x' << max_quest_size.height << "\",\n";
+
+  // Only write garbage collector settings that are not the default ones.
+  if (lua_gc_step_time != default_lua_gc_step_time) {
+    out << "  lua_gc_step_time = " << lua_gc_step_time << ",\n";
+  }
+  if (lua_gc_pause != default_lua_gc_pause) {
+    out << "  lua_gc_pause = " << lua_gc_pause << ",\n";
+  }
+  if (lua_gc_step_multiplier != default_lua_gc_step_multiplier) {
+    out << "  lua_gc_step_multiplier = " << lua_gc_step_multiplier << ",\n";
+  }
+  if (lua_memory_limit != 0) {
+    out << "  lua_memory_limit = " << lua_memory_limit << ",\n";
+  }
+  if (collision_broad_phase) {
+    out << "  collision_broad_phase = true,\n";
+  }
+  if (compact_textures) {
+    out << "  compact_textures = true,\n";
+  }
+  if (batch_position_notifications) {
+    out << "  batch_position_notifications = true,\n";
+  }
+  if (sound_streaming_duration != 0) {
+    out << "  sound_streaming_duration = " << sound_streaming_duration << ",\n";
+  }
+  if (vsync != "adaptive") {
+    out << "  vsync = \"" << vsync << "\",\n";
+  }
+  if (draw_rate != 0) {
+    out << "  draw_rate = " << draw_rate << ",\n";
+  }
+  if (deterministic_movements) {
+    out << "  deterministic_movements = true,\n";
+  }
+  if (background_mode != "continue") {
+    out << "  background_mode = \"" << background_mode << "\",\n";
+  }
+  out << "}\n\n";
 
   return true;
 }
@@ -389,4 +501,240 @@ void QuestProperties::set_max_quest_size(const Size& max_quest_size) {
   this->max_quest_size = max_quest_size;
 }
 
+/**
+ * \brief Returns the maximum time spent collecting Lua garbage per frame.
+ * \return The "lua_gc_step_time" value in milliseconds.
+ * 0 means that Lua collects garbage by itself while scripts run.
+ */
+int QuestProperties::get_lua_gc_step_time() const {
+  return lua_gc_step_time;
+}
+
+/**
+ * \brief Sets the maximum time spent collecting Lua garbage per frame.
+ * \param lua_gc_step_time The "lua_gc_step_time" value in milliseconds.
+ * 0 means that Lua collects garbage by itself while scripts run.
+ */
+void QuestProperties::set_lua_gc_step_time(int lua_gc_step_time) {
+  this->lua_gc_step_time = lua_gc_step_time;
+}
+
+/**
+ * \brief Returns the pause of the Lua garbage collector.
+ * \return The "lua_gc_pause" value in percent.
+ */
+int QuestProperties::get_lua_gc_pause() const {
+  return lua_gc_pause;
+}
+
+/**
+ * \brief Sets the pause of the Lua garbage collector.
+ * \param lua_gc_pause The "lua_gc_pause" value in percent.
+ */
+void QuestProperties::set_lua_gc_pause(int lua_gc_pause) {
+  this->lua_gc_pause = lua_gc_pause;
+}
+
+/**
+ * \brief Returns the step multiplier of the Lua garbage collector.
+ * \return The "lua_gc_step_multiplier" value in percent.
+ */
+int QuestProperties::get_lua_gc_step_multiplier() const {
+  return lua_gc_step_multiplier;
+}
+
+/**
+ * \brief Sets the step multiplier of the Lua garbage collector.
+ * \param lua_gc_step_multiplier The "lua_gc_step_multiplier" value in percent.
+ */
+void QuestProperties::set_lua_gc_step_multiplier(int lua_gc_step_multiplier) {
+  this->lua_gc_step_multiplier = lua_gc_step_multiplier;
+}
+
+/**
+ * \brief Returns the maximum size of the Lua heap.
+ *
+ * Allocations of scripts that would exceed it fail with a Lua
+ * "not enough memory" error.
+ *
+ * \return The "lua_memory_limit" value in KiB, or 0 if there is no limit.
+ */
+int QuestProperties::get_lua_memory_limit() const {
+  return lua_memory_limit;
+}
+
+/**
+ * \brief Sets the maximum size of the Lua heap.
+ * \param lua_memory_limit The "lua_memory_limit" value in KiB,
+ * or 0 for no limit.
+ */
+void QuestProperties::set_lua_memory_limit(int lua_memory_limit) {
+  this->lua_memory_limit = lua_memory_limit;
+}
+
+/**
+ * \brief Returns whether collisions with detectors are checked once per cycle.
+ *
+ * When enabled, entities that move or change only record that they need
+ * collision checks, and all candidate pairs are then found at the end of
+ * the cycle of entities.
+ *
+ * \return The "collision_broad_phase" value.
+ */
+bool QuestProperties::is_collision_broad_phase_enabled() const {
+  return collision_broad_phase;
+}
+
+/**
+ * \brief Sets whether collisions with detectors are checked once per cycle.
+ * \param collision_broad_phase The "collision_broad_phase" value.
+ */
+void QuestProperties::set_collision_broad_phase_enabled(bool collision_broad_phase) {
+  this->collision_broad_phase = collision_broad_phase;
+}
+
+/**
+ * \brief Returns whether large opaque images may use 16-bit textures.
+ *
+ * When enabled and supported by the renderer, large images without
+ * transparent pixels are uploaded in a 16-bit format, which halves their
+ * texture memory at the cost of some color precision.
+ *
+ * \return The "compact_textures" value.
+ */
+bool QuestProperties::is_compact_textures_enabled() const {
+  return compact_textures;
+}
+
+/**
+ * \brief Sets whether large opaque images may use 16-bit textures.
+ * \param compact_textures The "compact_textures" value.
+ */
+void QuestProperties::set_compact_textures_enabled(bool compact_textures) {
+  this->compact_textures = compact_textures;
+}
+
+/**
+ * \brief Returns whether movements send position events to Lua once per update.
+ *
+ * This is only the default value of new movements.
+ * Scripts that need an event at each pixel can change it per movement.
+ *
+ * \return The "batch_position_notifications" value.
+ */
+bool QuestProperties::are_position_notifications_batched() const {
+  return batch_position_notifications;
+}
+
+/**
+ * \brief Sets whether movements send position events to Lua once per update.
+ * \param batch_position_notifications The "batch_position_notifications" value.
+ */
+void QuestProperties::set_position_notifications_batched(bool batch_position_notifications) {
+  this->batch_position_notifications = batch_position_notifications;
+}
+
+/**
+ * \brief Returns the duration above which sounds are decoded while playing.
+ *
+ * Long sounds like ambient loops then stay compressed in memory.
+ *
+ * \return The "sound_streaming_duration" value in milliseconds,
+ * or 0 if all sounds are fully decoded.
+ */
+int QuestProperties::get_sound_streaming_duration() const {
+  return sound_streaming_duration;
+}
+
+/**
+ * \brief Sets the duration above which sounds are decoded while playing.
+ * \param sound_streaming_duration The "sound_streaming_duration" value
+ * in milliseconds, or 0 to fully decode all sounds.
+ */
+void QuestProperties::set_sound_streaming_duration(int sound_streaming_duration) {
+  this->sound_streaming_duration = sound_streaming_duration;
+}
+
+/**
+ * \brief Returns how presented frames are synchronized with the display.
+ * \return The "vsync" value: "on", "adaptive" (late frames are presented
+ * immediately when supported) or "off".
+ */
+std::string QuestProperties::get_vsync() const {
+  return vsync;
+}
+
+/**
+ * \brief Sets how presented frames are synchronized with the display.
+ * \param vsync The "vsync" value: "on", "adaptive" or "off".
+ */
+void QuestProperties::set_vsync(const std::string& vsync) {
+  this->vsync = vsync;
+}
+
+/**
+ * \brief Returns the maximum number of draws per second.
+ *
+ * The simulation keeps its own fixed rate: a lower draw rate only
+ * skips drawing, for example to save battery on handheld devices.
+ *
+ * \return The "draw_rate" value, or 0 if draws are not limited.
+ */
+int QuestProperties::get_draw_rate() const {
+  return draw_rate;
+}
+
+/**
+ * \brief Sets the maximum number of draws per second.
+ * \param draw_rate The "draw_rate" value, or 0 to not limit draws.
+ */
+void QuestProperties::set_draw_rate(int draw_rate) {
+  this->draw_rate = draw_rate;
+}
+
+/**
+ * \brief Returns whether movements use trigonometry lookup tables.
+ *
+ * Movements then give the same trajectories on all platforms.
+ * Angles are rounded to 1/4096 of a turn, so trajectories are slightly
+ * different from the ones of quests that don't enable it.
+ *
+ * \return The "deterministic_movements" value.
+ */
+bool QuestProperties::are_movements_deterministic() const {
+  return deterministic_movements;
+}
+
+/**
+ * \brief Sets whether movements use trigonometry lookup tables.
+ * \param deterministic_movements The "deterministic_movements" value.
+ */
+void QuestProperties::set_movements_deterministic(bool deterministic_movements) {
+  this->deterministic_movements = deterministic_movements;
+}
+
+/**
+ * \brief Returns what the main loop does while the window is unfocused
+ * or hidden.
+ *
+ * Nothing is drawn while the window is hidden, whatever the mode.
+ *
+ * \return The "background_mode" value: "continue" (the simulation keeps
+ * its normal rate), "throttle" (the simulation is done in a few bursts per
+ * second) or "pause" (the simulation stops and the simulated time with it).
+ */
+std::string QuestProperties::get_background_mode() const {
+  return background_mode;
+}
+
+/**
+ * \brief Sets what the main loop does while the window is unfocused
+ * or hidden.
+ * \param background_mode The "background_mode" value: "continue",
+ * "throttle" or "pause".
+ */
+void QuestProperties::set_background_mode(const std::string& background_mode) {
+  this->background_mode = background_mode;
+}
+
 }
@@ -15,17 +15,147 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Random.h"
+#include <cstdlib>
 #include <ctime>
 #include <random>
 
 namespace Solarus {
 namespace Random {
 
+namespace {
+
+// The engine is not initialized with std::random_device
+// because not every main platform support non-deterministic
+// random numbers generation yet.
+// Each thread that runs a main loop has its own sequence.
+thread_local std::mt19937 engine;
+thread_local uint32_t seed = std::mt19937::default_seed;
+thread_local Stream* current_stream = nullptr;
+
+constexpr uint64_t golden_gamma = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * \brief Mixes the bits of a 64-bit value.
+ *
+ * This is the finalizer of splitmix64: close values give unrelated results.
+ *
+ * \param value The value to mix.
+ * \return The mixed value.
+ */
+uint64_t mix(uint64_t value) {
+
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+/**
+ * \brief Maps a raw random number to [x, y[.
+ * \param raw A uniform 32-bit number.
+ * \param x The inferior bound.
+ * \param y The superior bound.
+ * \return A number in [x, y[, or x if the interval is empty.
+ */
+int to_interval(uint32_t raw, int x, int y) {
+
+  if (y <= x) {
+    return x;
+  }
+  const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(y) - x);
+  return static_cast<int>(x + static_cast<int64_t>((raw * range) >> 32));
+}
+
+}
+
+/**
+ * \brief Creates a stream of key zero.
+ */
+Stream::Stream():
+  Stream(0) {
+
+}
+
+/**
+ * \brief Creates a stream.
+ * \param key Identifies the sequence of numbers.
+ * Use create_key() or derive_key() to get a key.
+ */
+Stream::Stream(uint64_t key):
+  key(key),
+  counter(0) {
+
+}
+
+/**
+ * \brief Returns the key of this stream.
+ * \return The key.
+ */
+uint64_t Stream::get_key() const {
+  return key;
+}
+
+/**
+ * \brief Returns how many numbers this stream has produced.
+ * \return The number of calls to get_raw() so far.
+ */
+uint64_t Stream::get_counter() const {
+  return counter;
+}
+
+/**
+ * \brief Returns the next 32 bits of the stream.
+ * \return A uniform random number.
+ */
+uint32_t Stream::get_raw() {
+
+  ++counter;
+  return static_cast<uint32_t>(mix(key + counter * golden_gamma) >> 32);
+}
+
+/**
+ * \brief Returns a random integer number in [0, x[ with a uniform distribution.
+ * \param x The superior bound.
+ * \return A random integer number in [0, x[.
+ */
+int Stream::get_number(unsigned int x) {
+  return get_number(0, static_cast<int>(x));
+}
+
+/**
+ * \brief Returns a random integer number in [x, y[ with a uniform distribution.
+ * \param x The inferior bound.
+ * \param y The superior bound.
+ * \return A random integer number in [x, y[.
+ */
+int Stream::get_number(int x, int y) {
+  return to_interval(get_raw(), x, y);
+}
+
+/**
+ * \brief Makes a stream current.
+ * \param stream The stream to use until this object is destroyed.
+ */
+StreamScope::StreamScope(Stream& stream):
+  previous_stream(current_stream) {
+
+  current_stream = &stream;
+}
+
+/**
+ * \brief Restores the stream that was current before.
+ */
+StreamScope::~StreamScope() {
+
+  current_stream = previous_stream;
+}
+
 /**
  * \brief Initializes the random number generator.
+ *
+ * The seed depends on the current time.
  */
 void initialize() {
-  // nothing to do
+  set_seed(static_cast<uint32_t>(std::time(nullptr)));
 }
 
 /**
@@ -35,6 +165,75 @@ void quit() {
   // nothing to do
 }
 
+/**
+ * \brief Returns the seed of the random number generator.
+ * \return The last seed set.
+ */
+uint32_t get_seed() {
+  return seed;
+}
+
+/**
+ * \brief Restarts the random number generator from a seed.
+ *
+ * The same seed gives the same sequence of numbers, which makes runs
+ * reproducible.
+ * Only the generator of the calling thread is affected.
+ * The C library generator is also seeded, since the Lua math.random
+ * function may use it, but it is shared by all threads.
+ *
+ * \param new_seed The seed.
+ */
+void set_seed(uint32_t new_seed) {
+
+  seed = new_seed;
+  engine.seed(seed);
+  std::srand(seed);
+}
+
+/**
+ * \brief Returns a number that identifies the current state of the generator.
+ *
+ * The generator itself is not advanced, so calling this function does not
+ * change the numbers returned next.
+ *
+ * \return The next raw number the generator would produce.
+ */
+uint32_t get_state_hash() {
+
+  std::mt19937 copy = engine;
+  return static_cast<uint32_t>(copy());
+}
+
+/**
+ * \brief Returns a new key for a stream.
+ *
+ * The key is taken from the generator of the calling thread,
+ * so the same seed gives the same keys in the same order.
+ *
+ * \return A stream key.
+ */
+uint64_t create_key() {
+
+  const uint64_t high = engine();
+  return mix((high << 32) | engine());
+}
+
+/**
+ * \brief Returns the key of a sub-stream.
+ *
+ * This gives independent streams to the parts of a context,
+ * like the entities of a map, without consuming numbers of the parent.
+ *
+ * \param key Key of the parent context.
+ * \param id Identifies the sub-stream in the context.
+ * \return The key of the sub-stream.
+ */
+uint64_t derive_key(uint64_t key, uint64_t id) {
+
+  return mix(key ^ mix(id + golden_gamma));
+}
+
 /**
  * \brief Returns a random integer number in [0, x[ with a uniform distribution.
  *
@@ -49,19 +248,20 @@ int get_number(unsigned int x) {
 
 /**
  * \brief Returns a random integer number in [x, y[ with a uniform distribution.
+ *
+ * The number comes from the current stream if any,
+ * or from the generator of the calling thread.
+ *
  * \param x The inferior bound.
  * \param y The superior bound.
  * \return A random integer number in [x, y[.
  */
 int get_number(int x, int y) {
 
-  // Initialize the engine and the distribution
-  //
-  // The engine is not initialized with std::random_device
-  // because not every main platform support non-deterministic
-  // random numbers generation yet.
-  //
-  static std::mt19937 engine(std::time(nullptr));
+  if (current_stream != nullptr) {
+    return current_stream->get_number(x, y);
+  }
+
   static std::uniform_int_distribution<int> dist{};
 
   // Type of the parameters of the distribution
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/RecyclingPool.h"
+#include <new>
+#include <vector>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Whether the free blocks of the current thread were destroyed.
+ *
+ * Objects destroyed after them at the exit of the thread
+ * directly go back to the heap.
+ */
+thread_local bool free_blocks_destroyed = false;
+
+/**
+ * \brief Freed blocks of the current thread, by size.
+ */
+class FreeBlocks {
+
+  public:
+
+    FreeBlocks():
+      blocks_by_size(RecyclingPool::max_block_size / RecyclingPool::granularity) {
+    }
+
+    ~FreeBlocks() {
+      clear();
+      free_blocks_destroyed = true;
+    }
+
+    std::vector<void*>& get_blocks(std::size_t size_index) {
+      return blocks_by_size[size_index];
+    }
+
+    std::size_t get_num_blocks() const {
+      std::size_t num_blocks = 0;
+      for (const std::vector<void*>& blocks: blocks_by_size) {
+        num_blocks += blocks.size();
+      }
+      return num_blocks;
+    }
+
+    void clear() {
+      for (std::vector<void*>& blocks: blocks_by_size) {
+        for (void* block: blocks) {
+          ::operator delete(block);
+        }
+        blocks.clear();
+      }
+    }
+
+  private:
+
+    std::vector<std::vector<void*>> blocks_by_size;  /**< Free blocks of each size. */
+
+};
+
+/**
+ * \brief Returns the freed blocks of the current thread.
+ * \return The free blocks, or nullptr if they are already destroyed.
+ */
+FreeBlocks* get_free_blocks() {
+
+  if (free_blocks_destroyed) {
+    return nullptr;
+  }
+  static thread_local FreeBlocks free_blocks;
+  return &free_blocks;
+}
+
+/**
+ * \brief Returns the index of the blocks of a size.
+ * \param size A size in bytes, not zero and not bigger than max_block_size.
+ * \return The index where blocks of this size are stored.
+ */
+std::size_t get_size_index(std::size_t size) {
+  return (size - 1) / RecyclingPool::granularity;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Allocates a block of memory.
+ *
+ * A block freed before with the same size is reused if any.
+ *
+ * \param size Size of the block in bytes.
+ * \return The block. Throws std::bad_alloc in case of failure,
+ * like operator new.
+ */
+void* RecyclingPool::allocate(std::size_t size) {
+
+  if (size == 0 || size > max_block_size) {
+    return ::operator new(size);
+  }
+
+  const std::size_t size_index = get_size_index(size);
+  FreeBlocks* free_blocks = get_free_blocks();
+  if (free_blocks != nullptr) {
+    std::vector<void*>& blocks = free_blocks->get_blocks(size_index);
+    if (!blocks.empty()) {
+      void* block = blocks.back();
+      blocks.pop_back();
+      return block;
+    }
+  }
+
+  // Allocate the whole rounded size so that any size of this index can reuse it.
+  return ::operator new((size_index + 1) * granularity);
+}
+
+/**
+ * \brief Frees a block of memory allocated by allocate().
+ *
+ * The block is kept for the next allocations of the same size,
+ * unless enough blocks of this size are already kept.
+ *
+ * \param block The block to free or nullptr.
+ * \param size The size that was passed to allocate().
+ */
+void RecyclingPool::deallocate(void* block, std::size_t size) {
+
+  if (block == nullptr) {
+    return;
+  }
+
+  FreeBlocks* free_blocks = get_free_blocks();
+  if (size == 0 || size > max_block_size || free_blocks == nullptr) {
+    ::operator delete(block);
+    return;
+  }
+
+  std::vector<void*>& blocks = free_blocks->get_blocks(get_size_index(size));
+  if (blocks.size() >= max_free_blocks_per_size) {
+    ::operator delete(block);
+    return;
+  }
+
+  if (blocks.capacity() == 0) {
+    // Once for all, so that freeing blocks later does not allocate.
+    blocks.reserve(max_free_blocks_per_size);
+  }
+  blocks.push_back(block);
+}
+
+/**
+ * \brief Returns the number of freed blocks kept by the current thread.
+ * \return The number of blocks ready to be reused.
+ */
+std::size_t RecyclingPool::get_num_free_blocks() {
+
+  const FreeBlocks* free_blocks = get_free_blocks();
+  return free_blocks != nullptr ? free_blocks->get_num_blocks() : 0;
+}
+
+/**
+ * \brief Gives back to the heap the blocks kept by the current thread.
+ */
+void RecyclingPool::clear() {
+
+  FreeBlocks* free_blocks = get_free_blocks();
+  if (free_blocks != nullptr) {
+    free_blocks->clear();
+  }
+}
+
+}
+
@@ -14,14 +14,215 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/core/Trace.h"
+#include "solarus/entities/EntityData.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteAnimation.h"
+#include "solarus/graphics/SpriteAnimationSet.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/graphics/Surface.h"
+#include <SDL_surface.h>
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <vector>
 
 namespace Solarus {
 
+ResourceProvider* ResourceProvider::instance = nullptr;
+
+namespace {
+
+/**
+ * \brief Estimated memory used by parsed map data.
+ *
+ * Only entities are counted, with an average size of their properties.
+ *
+ * \param map_data A map data.
+ * \return The estimated size in bytes.
+ */
+size_t get_map_data_memory_size(const MapData& map_data) {
+
+  size_t num_entities = 0;
+  for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+    num_entities += map_data.get_num_entities(layer);
+  }
+  return sizeof(MapData) + num_entities * 512;
+}
+
+/**
+ * \brief Loads the data of a map.
+ *
+ * The binary map file "maps/<map_id>.bin" is used if it exists and is up to
+ * date with the map data file. Otherwise, the map data file is parsed.
+ *
+ * \param map_id Id of the map to load.
+ * \param[out] map_data The map data to fill.
+ * \return \c true in case of success.
+ */
+bool load_map_data(const std::string& map_id, MapData& map_data) {
+
+  const std::string& file_name = std::string("maps/") + map_id + ".dat";
+  return map_data.import_from_quest_file(file_name);
+}
+
+/**
+ * \brief Returns the sprites of entities declared in a map data file.
+ * \param map_data A map data.
+ * \return The distinct sprite ids, in the order of entities.
+ */
+std::vector<std::string> get_sprite_ids(const MapData& map_data) {
+
+  std::vector<std::string> sprite_ids;
+  std::set<std::string> known_ids;
+  for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+    for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+      const EntityData& entity_data = map_data.get_entity({ layer, i });
+      if (!entity_data.is_string("sprite")) {
+        continue;
+      }
+      const std::string& sprite_id = entity_data.get_string("sprite");
+      if (!sprite_id.empty() && known_ids.insert(sprite_id).second) {
+        sprite_ids.push_back(sprite_id);
+      }
+    }
+  }
+  return sprite_ids;
+}
+
+/**
+ * \brief Parses the data file of a sprite.
+ *
+ * This function can run on any thread.
+ *
+ * \param sprite_id Id of a sprite animation set.
+ * \return The sprite data, or nullptr if the file does not exist or is
+ * invalid.
+ */
+std::shared_ptr<SpriteData> load_sprite_data(const std::string& sprite_id) {
+
+  const std::string& sprite_file_name = std::string("sprites/") + sprite_id + ".dat";
+  if (!QuestFiles::data_file_exists(sprite_file_name)) {
+    return nullptr;
+  }
+  std::shared_ptr<SpriteData> sprite_data = std::make_shared<SpriteData>();
+  if (!sprite_data->import_from_quest_file(sprite_file_name)) {
+    return nullptr;
+  }
+  return sprite_data;
+}
+
+/**
+ * \brief Adds the keys of the images used by a sprite to a set.
+ *
+ * Keys are the ones of Surface images loaded from the sprites directory.
+ * The tileset image is not included.
+ *
+ * \param sprite_data A sprite data.
+ * \param[in,out] image_keys The set to fill.
+ */
+void add_image_keys(const SpriteData& sprite_data, std::set<std::string>& image_keys) {
+
+  for (const auto& kvp: sprite_data.get_animations()) {
+    if (!kvp.second.src_image_is_tileset()) {
+      image_keys.insert(std::string("sprites/") + kvp.second.get_src_image());
+    }
+  }
+}
+
+/**
+ * \brief Estimated memory used by an image.
+ * \param surface An image or nullptr.
+ * \return Its size in bytes, assuming 32-bit pixels.
+ */
+size_t get_image_memory_size(const SurfacePtr& surface) {
+
+  if (surface == nullptr) {
+    return 0;
+  }
+  return static_cast<size_t>(surface->get_width()) * surface->get_height() * 4;
+}
+
+}
+
 /**
  * \brief Creates a resource provider.
+ *
+ * The first provider created becomes the one used by sprites and surfaces
+ * until it is destroyed.
+ */
+ResourceProvider::ResourceProvider():
+  map_data_cache(),
+  tileset_cache(),
+  animation_set_cache(),
+  image_cache(),
+  clock(0),
+  memory_budget(default_memory_budget),
+  map_preloads(),
+  prefetch_queue(),
+  prefetching_map_id() {
+
+  if (instance == nullptr) {
+    instance = this;
+  }
+}
+
+/**
+ * \brief Destroys the resource provider.
  */
-ResourceProvider::ResourceProvider() {
+ResourceProvider::~ResourceProvider() {
+
+  finish_preloads();
+  if (instance == this) {
+    instance = nullptr;
+  }
+}
+
+/**
+ * \brief Returns the resource provider of the main loop.
+ *
+ * Sprites and surfaces use it to share their animation sets and images.
+ *
+ * \return The current resource provider, or nullptr if there is none.
+ */
+ResourceProvider* ResourceProvider::get_instance() {
+  return instance;
+}
+
+/**
+ * \brief Provides the parsed data file of the map with the given id.
+ *
+ * Uses the result of a preloading if any.
+ * Stops with an error if the map data file cannot be parsed.
+ *
+ * \param map_id A map id.
+ * \return The corresponding map data.
+ */
+std::shared_ptr<const MapData> ResourceProvider::get_map_data(const std::string& map_id) {
+
+  std::shared_ptr<const MapData> map_data = map_data_cache.get(map_id, ++clock);
+  if (map_data != nullptr) {
+    return map_data;
+  }
+
+  SOLARUS_TRACE_SCOPE_DETAIL("ResourceProvider::get_map_data", map_id);
+  std::shared_ptr<MapData> loaded_data = get_preloaded_map_data(map_id);
+  if (loaded_data == nullptr) {
+    loaded_data = std::make_shared<MapData>();
+    if (!load_map_data(map_id, *loaded_data)) {
+      Debug::die("Failed to load map data file 'maps/" + map_id + ".dat'");
+    }
+  }
+
+  map_data_cache.add(map_id, loaded_data, get_map_data_memory_size(*loaded_data), clock);
+  enforce_memory_budget();
+  return loaded_data;
 }
 
 /**
@@ -29,22 +230,521 @@ ResourceProvider::ResourceProvider() {
  * \param tileset_id A tileset id.
  * \return The corresponding tileset.
  */
-const Tileset& ResourceProvider::get_tileset(const std::string& tileset_id) {
+std::shared_ptr<const Tileset> ResourceProvider::get_tileset(const std::string& tileset_id) {
 
-  auto it = tileset_cache.find(tileset_id);
-  if (it != tileset_cache.end()) {
-    return *it->second;
+  std::shared_ptr<Tileset> tileset = tileset_cache.get(tileset_id, ++clock);
+  if (tileset != nullptr) {
+    return tileset;
   }
 
-  it = tileset_cache.emplace(
-        tileset_id,
-        std::unique_ptr<Tileset>(new Tileset(tileset_id))
-  ).first;
-  Tileset& tileset = *it->second;
-  tileset.load();
+  SOLARUS_TRACE_SCOPE_DETAIL("ResourceProvider::get_tileset", tileset_id);
+  tileset = std::make_shared<Tileset>(tileset_id);
+  tileset->load();
+  add_tileset(tileset_id, tileset);
   return tileset;
 }
 
+/**
+ * \brief Provides the sprite animation set with the given id.
+ * \param animation_set_id A sprite animation set id.
+ * \return The corresponding animation set.
+ */
+std::shared_ptr<SpriteAnimationSet> ResourceProvider::get_animation_set(
+    const std::string& animation_set_id) {
+
+  std::shared_ptr<SpriteAnimationSet> animation_set =
+      animation_set_cache.get(animation_set_id, ++clock);
+  if (animation_set != nullptr) {
+    return animation_set;
+  }
+
+  SOLARUS_TRACE_SCOPE_DETAIL("ResourceProvider::get_animation_set", animation_set_id);
+  animation_set = std::make_shared<SpriteAnimationSet>(animation_set_id);
+  add_animation_set(animation_set_id, animation_set);
+  return animation_set;
+}
+
+/**
+ * \brief Returns a decoded image previously stored with add_image().
+ *
+ * The image is shared with the cache and must not be modified:
+ * callers should copy its pixels.
+ *
+ * \param image_key File name of the image, qualified by its language
+ * if it is language-specific.
+ * \return The decoded image, or nullptr if it is not in the cache.
+ */
+std::shared_ptr<SDL_Surface> ResourceProvider::get_image(const std::string& image_key) {
+
+  return image_cache.get(image_key, ++clock);
+}
+
+/**
+ * \brief Stores a decoded image so that next loadings avoid decoding it again.
+ * \param image_key File name of the image, qualified by its language
+ * if it is language-specific.
+ * \param image The decoded image. It must not be modified afterwards.
+ */
+void ResourceProvider::add_image(
+    const std::string& image_key,
+    const std::shared_ptr<SDL_Surface>& image) {
+
+  image_cache.add(
+        image_key,
+        image,
+        static_cast<size_t>(image->pitch) * image->h,
+        ++clock
+  );
+  enforce_memory_budget();
+}
+
+/**
+ * \brief Loads the sprite animation sets used by entities of a map.
+ *
+ * Sprite data files of animation sets not in memory yet are parsed and
+ * their images are decoded in parallel. Then animation sets and their
+ * textures are created on the calling thread, which must be the main thread.
+ *
+ * \param map_data A map data about to be loaded.
+ * \param thread_pool Worker threads to parse and decode files.
+ */
+void ResourceProvider::load_animation_sets(const MapData& map_data, ThreadPool& thread_pool) {
+
+  std::vector<std::string> sprite_ids;
+  for (const std::string& sprite_id: get_sprite_ids(map_data)) {
+    if (!animation_set_cache.contains(sprite_id)) {
+      sprite_ids.push_back(sprite_id);
+    }
+  }
+  if (sprite_ids.empty()) {
+    return;
+  }
+
+  SOLARUS_TRACE_SCOPE("ResourceProvider::load_animation_sets");
+
+  std::vector<std::shared_ptr<SpriteData>> sprites_data(sprite_ids.size());
+  thread_pool.parallel_for(static_cast<int>(sprite_ids.size()), [&](int i) {
+    sprites_data[i] = load_sprite_data(sprite_ids[i]);
+  });
+
+  std::set<std::string> all_image_keys;
+  for (const std::shared_ptr<SpriteData>& sprite_data: sprites_data) {
+    if (sprite_data != nullptr) {
+      add_image_keys(*sprite_data, all_image_keys);
+    }
+  }
+  std::vector<std::string> image_keys;
+  for (const std::string& image_key: all_image_keys) {
+    if (!image_cache.contains(image_key)) {
+      image_keys.push_back(image_key);
+    }
+  }
+
+  std::vector<SDL_Surface*> images(image_keys.size(), nullptr);
+  thread_pool.parallel_for(static_cast<int>(image_keys.size()), [&](int i) {
+    images[i] = Surface::decode_image(image_keys[i], false);
+  });
+  for (size_t i = 0; i < image_keys.size(); ++i) {
+    if (images[i] != nullptr) {
+      add_image(image_keys[i], std::shared_ptr<SDL_Surface>(images[i], SDL_FreeSurface));
+    }
+  }
+
+  // Textures need the main thread.
+  for (size_t i = 0; i < sprite_ids.size(); ++i) {
+    if (sprites_data[i] != nullptr) {
+      add_animation_set(
+          sprite_ids[i],
+          std::make_shared<SpriteAnimationSet>(sprite_ids[i], *sprites_data[i])
+      );
+    }
+  }
+}
+
+/**
+ * \brief Puts a loaded tileset in the cache.
+ * \param tileset_id Id of the tileset.
+ * \param tileset The loaded tileset.
+ */
+void ResourceProvider::add_tileset(
+    const std::string& tileset_id,
+    const std::shared_ptr<Tileset>& tileset) {
+
+  const size_t memory_size =
+      get_image_memory_size(tileset->get_tiles_image()) +
+      get_image_memory_size(tileset->get_entities_image());
+  tileset_cache.add(tileset_id, tileset, memory_size, ++clock);
+  enforce_memory_budget();
+}
+
+/**
+ * \brief Puts a loaded sprite animation set in the cache.
+ * \param animation_set_id Id of the animation set.
+ * \param animation_set The loaded animation set.
+ */
+void ResourceProvider::add_animation_set(
+    const std::string& animation_set_id,
+    const std::shared_ptr<SpriteAnimationSet>& animation_set) {
+
+  animation_set_cache.add(
+        animation_set_id,
+        animation_set,
+        animation_set->get_memory_size(),
+        ++clock
+  );
+  enforce_memory_budget();
+}
+
+/**
+ * \brief Evicts least recently used elements until the memory budget is
+ * respected or until every remaining element is in use.
+ */
+void ResourceProvider::enforce_memory_budget() {
+
+  while (get_memory_size() > memory_budget) {
+
+    // Find the cache whose oldest evictable element is the oldest of all.
+    uint64_t oldest_use = 0;
+    int oldest_cache = -1;
+    uint64_t last_use = 0;
+    if (map_data_cache.get_least_recently_used(last_use) &&
+        (oldest_cache == -1 || last_use < oldest_use)) {
+      oldest_use = last_use;
+      oldest_cache = 0;
+    }
+    if (tileset_cache.get_least_recently_used(last_use) &&
+        (oldest_cache == -1 || last_use < oldest_use)) {
+      oldest_use = last_use;
+      oldest_cache = 1;
+    }
+    if (animation_set_cache.get_least_recently_used(last_use) &&
+        (oldest_cache == -1 || last_use < oldest_use)) {
+      oldest_use = last_use;
+      oldest_cache = 2;
+    }
+    if (image_cache.get_least_recently_used(last_use) &&
+        (oldest_cache == -1 || last_use < oldest_use)) {
+      oldest_use = last_use;
+      oldest_cache = 3;
+    }
+
+    switch (oldest_cache) {
+
+    case 0:
+      map_data_cache.evict_least_recently_used();
+      break;
+
+    case 1:
+      tileset_cache.evict_least_recently_used();
+      break;
+
+    case 2:
+      animation_set_cache.evict_least_recently_used();
+      break;
+
+    case 3:
+      image_cache.evict_least_recently_used();
+      break;
+
+    default:
+      // Everything left is in use.
+      return;
+    }
+  }
+}
+
+/**
+ * \brief Returns the memory allowed for cached resources.
+ * \return The memory budget in bytes.
+ */
+size_t ResourceProvider::get_memory_budget() const {
+  return memory_budget;
+}
+
+/**
+ * \brief Sets the memory allowed for cached resources.
+ *
+ * Elements are evicted immediately if needed.
+ *
+ * \param memory_budget The memory budget in bytes.
+ */
+void ResourceProvider::set_memory_budget(size_t memory_budget) {
+
+  this->memory_budget = memory_budget;
+  enforce_memory_budget();
+}
+
+/**
+ * \brief Returns the estimated memory used by all cached resources.
+ * \return The memory size in bytes.
+ */
+size_t ResourceProvider::get_memory_size() const {
+
+  return map_data_cache.get_memory_size() +
+      tileset_cache.get_memory_size() +
+      animation_set_cache.get_memory_size() +
+      image_cache.get_memory_size();
+}
+
+/**
+ * \brief Returns the access counters of the cache of a resource type.
+ * \param resource_type A type of resource.
+ * \return The statistics of this cache. They are all zero for types
+ * that are not cached here.
+ */
+ResourceCacheStatistics ResourceProvider::get_statistics(ResourceType resource_type) const {
+
+  switch (resource_type) {
+
+  case ResourceType::MAP:
+    return map_data_cache.get_statistics();
+
+  case ResourceType::TILESET:
+    return tileset_cache.get_statistics();
+
+  case ResourceType::SPRITE:
+    return animation_set_cache.get_statistics();
+
+  default:
+    return ResourceCacheStatistics();
+  }
+}
+
+/**
+ * \brief Returns the access counters of the cache of decoded images.
+ * \return The statistics of the image cache.
+ */
+ResourceCacheStatistics ResourceProvider::get_image_statistics() const {
+  return image_cache.get_statistics();
+}
+
+/**
+ * \brief Starts parsing the data files of a map on a separate thread.
+ *
+ * Nothing is done if this map is already being preloaded or is already
+ * in the cache.
+ * The result is used by the next map loading of this map.
+ *
+ * \param map_id Id of the map to preload.
+ */
+void ResourceProvider::start_preloading_map(const std::string& map_id) {
+
+  if (map_preloads.find(map_id) != map_preloads.end() ||
+      map_data_cache.contains(map_id)) {
+    return;
+  }
+
+  map_preloads.emplace(map_id, std::async(std::launch::async, &ResourceProvider::preload_map, map_id));
+}
+
+/**
+ * \brief Returns whether a map was preloaded and is ready to be used.
+ * \param map_id Id of a map.
+ * \return \c true if the preloading of this map is finished
+ * or if its data is already in the cache.
+ */
+bool ResourceProvider::is_map_preloaded(const std::string& map_id) const {
+
+  if (map_data_cache.contains(map_id)) {
+    return true;
+  }
+
+  const auto& it = map_preloads.find(map_id);
+  if (it == map_preloads.end()) {
+    return false;
+  }
+
+  return it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+/**
+ * \brief Returns the preloaded data of a map if any and forgets the preload.
+ *
+ * If the preloading is not finished yet, waits for it.
+ * The tileset and the sprites that were preloaded with the map are
+ * created at this point, unless they were already in memory.
+ *
+ * \param map_id Id of a map.
+ * \return The parsed map data, or nullptr if this map was not preloaded
+ * or if the preloading failed.
+ */
+std::shared_ptr<MapData> ResourceProvider::get_preloaded_map_data(const std::string& map_id) {
+
+  const auto& it = map_preloads.find(map_id);
+  if (it == map_preloads.end()) {
+    return nullptr;
+  }
+
+  std::shared_ptr<PreloadedMap> preloaded_map = it->second.get();
+  map_preloads.erase(it);
+
+  if (preloaded_map->map_data == nullptr) {
+    return nullptr;
+  }
+
+  // Images need the main thread: create them now.
+  const std::string& tileset_id = preloaded_map->map_data->get_tileset_id();
+  if (preloaded_map->tileset_data != nullptr &&
+      !tileset_cache.contains(tileset_id)) {
+    std::shared_ptr<Tileset> tileset = std::make_shared<Tileset>(tileset_id);
+    tileset->load(*preloaded_map->tileset_data);
+    add_tileset(tileset_id, tileset);
+  }
+
+  for (const auto& kvp: preloaded_map->images) {
+    if (!image_cache.contains(kvp.first)) {
+      add_image(kvp.first, kvp.second);
+    }
+  }
+
+  for (const auto& kvp: preloaded_map->sprites_data) {
+    if (!animation_set_cache.contains(kvp.first)) {
+      add_animation_set(kvp.first, std::make_shared<SpriteAnimationSet>(kvp.first, *kvp.second));
+    }
+  }
+
+  return preloaded_map->map_data;
+}
+
+/**
+ * \brief Waits for all preloads in progress and drops their results.
+ *
+ * This function must be called before closing the quest files.
+ */
+void ResourceProvider::finish_preloads() {
+
+  for (auto& kvp: map_preloads) {
+    kvp.second.wait();
+  }
+  map_preloads.clear();
+  prefetch_queue.clear();
+  prefetching_map_id.clear();
+}
+
+/**
+ * \brief Sets the maps to prefetch in the background.
+ *
+ * Unlike start_preloading_map(), maps are preloaded one at a time with
+ * update() and go to the caches when they are ready, so they are subject
+ * to the memory budget like other resources.
+ * Prefetching stops when the caches use more than a part of the budget,
+ * to keep resources in use from being evicted.
+ *
+ * The previous maps to prefetch are forgotten.
+ *
+ * \param map_ids Ids of maps likely to be loaded soon, most likely first.
+ * Only the first ones are prefetched.
+ */
+void ResourceProvider::prefetch_maps(const std::vector<std::string>& map_ids) {
+
+  prefetch_queue.clear();
+  for (const std::string& map_id: map_ids) {
+    if (static_cast<int>(prefetch_queue.size()) >= max_prefetched_maps) {
+      break;
+    }
+    if (map_id != prefetching_map_id &&
+        std::find(prefetch_queue.begin(), prefetch_queue.end(), map_id) == prefetch_queue.end()) {
+      prefetch_queue.push_back(map_id);
+    }
+  }
+  update();
+}
+
+/**
+ * \brief Moves a prefetched map to the caches when it is ready and starts
+ * prefetching the next one.
+ *
+ * This function must be called at each cycle by the main thread.
+ */
+void ResourceProvider::update() {
+
+  if (!prefetching_map_id.empty()) {
+    const auto& it = map_preloads.find(prefetching_map_id);
+    if (it != map_preloads.end()) {
+      if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        // Still in progress.
+        return;
+      }
+      SOLARUS_TRACE_SCOPE_DETAIL("ResourceProvider::prefetch", prefetching_map_id);
+      std::shared_ptr<MapData> map_data = get_preloaded_map_data(prefetching_map_id);
+      if (map_data != nullptr) {
+        map_data_cache.add(prefetching_map_id, map_data, get_map_data_memory_size(*map_data), ++clock);
+        enforce_memory_budget();
+      }
+    }
+    // Otherwise the map was already loaded for real in the meantime.
+    prefetching_map_id.clear();
+  }
+
+  while (!prefetch_queue.empty()) {
+    if (get_memory_size() > memory_budget / prefetch_memory_ratio) {
+      prefetch_queue.clear();
+      return;
+    }
+
+    const std::string map_id = prefetch_queue.front();
+    prefetch_queue.pop_front();
+    if (map_data_cache.contains(map_id) ||
+        map_preloads.find(map_id) != map_preloads.end() ||
+        !QuestFiles::data_file_exists(std::string("maps/") + map_id + ".dat")) {
+      continue;
+    }
+
+    start_preloading_map(map_id);
+    prefetching_map_id = map_id;
+    return;
+  }
+}
+
+/**
+ * \brief Parses the data files of a map.
+ *
+ * This function runs on a separate thread: it must only read quest files,
+ * build data objects and decode images.
+ *
+ * \param map_id Id of the map to preload.
+ * \return The parsed data.
+ */
+std::shared_ptr<ResourceProvider::PreloadedMap> ResourceProvider::preload_map(
+    const std::string& map_id) {
+
+  SOLARUS_TRACE_SCOPE_DETAIL("ResourceProvider::preload_map", map_id);
+
+  std::shared_ptr<PreloadedMap> preloaded_map = std::make_shared<PreloadedMap>();
+
+  std::shared_ptr<MapData> map_data = std::make_shared<MapData>();
+  if (!load_map_data(map_id, *map_data)) {
+    Logger::error("Failed to preload map '" + map_id + "'");
+    return preloaded_map;
+  }
+  preloaded_map->map_data = map_data;
+
+  std::shared_ptr<TilesetData> tileset_data = std::make_shared<TilesetData>();
+  const std::string& tileset_file_name = std::string("tilesets/") + map_data->get_tileset_id() + ".dat";
+  if (tileset_data->import_from_quest_file(tileset_file_name)) {
+    preloaded_map->tileset_data = tileset_data;
+  }
+
+  // Sprites of entities declared in the map file and their images.
+  std::set<std::string> image_keys;
+  for (const std::string& sprite_id: get_sprite_ids(*map_data)) {
+    std::shared_ptr<SpriteData> sprite_data = load_sprite_data(sprite_id);
+    if (sprite_data != nullptr) {
+      preloaded_map->sprites_data.emplace(sprite_id, sprite_data);
+      add_image_keys(*sprite_data, image_keys);
+    }
+  }
+
+  for (const std::string& image_key: image_keys) {
+    SDL_Surface* image = Surface::decode_image(image_key, false);
+    if (image != nullptr) {
+      preloaded_map->images.emplace(image_key, std::shared_ptr<SDL_Surface>(image, SDL_FreeSurface));
+    }
+  }
+
+  return preloaded_map;
+}
+
 /**
  * \brief Notifies the resource provider that cached data (if any) is no longer valid.
  *
@@ -59,8 +759,35 @@ void ResourceProvider::invalidate_resource_element(
 
   switch (resource_type) {
 
+  case ResourceType::MAP:
+    {
+      // Wait for a preload in progress before dropping it.
+      const auto& it = map_preloads.find(element_id);
+      if (it != map_preloads.end()) {
+        it->second.wait();
+        map_preloads.erase(it);
+      }
+      map_data_cache.remove(element_id);
+    }
+    break;
+
   case ResourceType::TILESET:
-    tileset_cache.erase(element_id);
+    tileset_cache.remove(element_id);
+    image_cache.remove(std::string("tilesets/") + element_id + ".tiles.png");
+    image_cache.remove(std::string("tilesets/") + element_id + ".entities.png");
+    break;
+
+  case ResourceType::SPRITE:
+    {
+      // Sprites still using the old version will load it again.
+      std::shared_ptr<SpriteAnimationSet> animation_set = animation_set_cache.peek(element_id);
+      if (animation_set != nullptr) {
+        animation_set->set_obsolete();
+      }
+    }
+    // The images of the sprite are not known anymore: drop all sprite images.
+    animation_set_cache.remove(element_id);
+    image_cache.remove_prefix("sprites/");
     break;
 
   default:
@@ -68,4 +795,80 @@ void ResourceProvider::invalidate_resource_element(
   }
 }
 
+/**
+ * \brief Notifies the resource provider that a data file has changed on disk.
+ *
+ * Unlike invalidate_resource_element(), only what depends on this file
+ * is dropped, so that other resources are not decoded again.
+ * Sprites using a changed animation set load the new version at their
+ * next update.
+ *
+ * \param file_name Name of the file relative to the data directory.
+ */
+void ResourceProvider::notify_file_changed(const std::string& file_name) {
+
+  const auto& get_element_id = [&file_name](const std::string& prefix, const std::string& suffix) {
+    if (file_name.size() <= prefix.size() + suffix.size() ||
+        file_name.compare(0, prefix.size(), prefix) != 0 ||
+        file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+      return std::string();
+    }
+    return file_name.substr(prefix.size(), file_name.size() - prefix.size() - suffix.size());
+  };
+
+  std::string element_id = get_element_id("maps/", ".dat");
+  if (!element_id.empty()) {
+    invalidate_resource_element(ResourceType::MAP, element_id);
+    return;
+  }
+
+  element_id = get_element_id("tilesets/", ".dat");
+  if (element_id.empty()) {
+    element_id = get_element_id("tilesets/", ".tiles.png");
+  }
+  if (element_id.empty()) {
+    element_id = get_element_id("tilesets/", ".entities.png");
+  }
+  if (!element_id.empty()) {
+    tileset_cache.remove(element_id);
+    image_cache.remove(file_name);
+    return;
+  }
+
+  element_id = get_element_id("sprites/", ".dat");
+  if (!element_id.empty()) {
+    // Its images did not change.
+    std::shared_ptr<SpriteAnimationSet> animation_set = animation_set_cache.peek(element_id);
+    if (animation_set != nullptr) {
+      animation_set->set_obsolete();
+    }
+    animation_set_cache.remove(element_id);
+    return;
+  }
+
+  image_cache.remove(file_name);
+  if (!get_element_id("sprites/", ".png").empty()) {
+    // Any animation set may use this image.
+    for (const std::shared_ptr<SpriteAnimationSet>& animation_set: animation_set_cache.get_elements()) {
+      animation_set->set_obsolete();
+    }
+    animation_set_cache.clear();
+  }
+}
+
+/**
+ * \brief Drops all cached resources and waits for preloads in progress.
+ *
+ * Resources still in use elsewhere stay alive until they are released.
+ * This function must be called before the video system is closed.
+ */
+void ResourceProvider::clear() {
+
+  finish_preloads();
+  map_data_cache.clear();
+  tileset_cache.clear();
+  animation_set_cache.clear();
+  image_cache.clear();
+}
+
 }
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceWatcher.h"
+#include <physfs.h>
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a disabled watcher.
+ */
+ResourceWatcher::ResourceWatcher():
+  enabled(false),
+  file_names(),
+  modification_dates(),
+  next_file_index(0) {
+
+}
+
+/**
+ * \brief Returns whether files are watched.
+ * \return \c true if update() detects changes.
+ */
+bool ResourceWatcher::is_enabled() const {
+  return enabled;
+}
+
+/**
+ * \brief Starts or stops watching files.
+ *
+ * Changes are detected relative to the dates of files when watching starts.
+ *
+ * \param enabled \c true to watch files.
+ */
+void ResourceWatcher::set_enabled(bool enabled) {
+
+  this->enabled = enabled;
+  file_names.clear();
+  modification_dates.clear();
+  next_file_index = 0;
+  if (enabled) {
+    list_files();
+    for (const std::string& file_name: file_names) {
+      modification_dates[file_name] = PHYSFS_getLastModTime(file_name.c_str());
+    }
+  }
+}
+
+/**
+ * \brief Checks the next files of the round.
+ * \return Names of the files modified since the last check,
+ * relative to the data directory.
+ */
+std::vector<std::string> ResourceWatcher::update() {
+
+  std::vector<std::string> changed_files;
+  if (!enabled) {
+    return changed_files;
+  }
+
+  if (next_file_index >= file_names.size()) {
+    // Start a new round.
+    list_files();
+    next_file_index = 0;
+  }
+
+  const size_t end = std::min(next_file_index + files_per_update, file_names.size());
+  for (; next_file_index < end; ++next_file_index) {
+    const std::string& file_name = file_names[next_file_index];
+    const int64_t date = PHYSFS_getLastModTime(file_name.c_str());
+    if (date < 0) {
+      // The file was removed in the meantime.
+      modification_dates.erase(file_name);
+      continue;
+    }
+
+    const auto& it = modification_dates.find(file_name);
+    if (it == modification_dates.end()) {
+      // New file: nothing can depend on its old content.
+      modification_dates.emplace(file_name, date);
+    }
+    else if (it->second != date) {
+      it->second = date;
+      changed_files.push_back(file_name);
+    }
+  }
+
+  return changed_files;
+}
+
+/**
+ * \brief Lists the files of the data directory for the next round.
+ */
+void ResourceWatcher::list_files() {
+
+  file_names.clear();
+  list_directory("");
+}
+
+/**
+ * \brief Adds the files of a data directory and its subdirectories
+ * to the list of files to check.
+ * \param dir_name A directory relative to the data directory,
+ * or an empty string for the data directory itself.
+ */
+void ResourceWatcher::list_directory(const std::string& dir_name) {
+
+  char** files = PHYSFS_enumerateFiles(dir_name.c_str());
+  if (files == nullptr) {
+    return;
+  }
+
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = dir_name.empty() ?
+        std::string(*file) : dir_name + "/" + *file;
+
+    // Savegames and other files of the write directory are not quest data.
+    if (QuestFiles::data_file_get_location(file_name) !=
+        QuestFiles::DataFileLocation::LOCATION_DATA_DIRECTORY) {
+      continue;
+    }
+
+    if (PHYSFS_isDirectory(file_name.c_str())) {
+      list_directory(file_name);
+    }
+    else {
+      file_names.push_back(file_name);
+    }
+  }
+  PHYSFS_freeList(files);
+}
+
+}
@@ -20,61 +20,149 @@
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/SavegameConverterV1.h"
+#include "solarus/core/WorldStateHash.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 namespace Solarus {
 
 const int Savegame::SAVEGAME_VERSION = 2;
 
-const std::string Savegame::KEY_SAVEGAME_VERSION = "_version";         /**< Format of this savegame file. */
-const std::string Savegame::KEY_STARTING_MAP = "_starting_map";        /**< Map id where to start the savegame. */
-const std::string Savegame::KEY_STARTING_POINT = "_starting_point";    /**< Destination name on the starting map. */
-const std::string Savegame::KEY_KEYBOARD_ACTION = "_keyboard_action";  /**< Keyboard key mapped to the action command. */
-const std::string Savegame::KEY_KEYBOARD_ATTACK = "_keyboard_attack";  /**< Keyboard key mapped to the attack command. */
-const std::string Savegame::KEY_KEYBOARD_ITEM_1 = "_keyboard_item_1";  /**< Keyboard key mapped to the item 1 command. */
-const std::string Savegame::KEY_KEYBOARD_ITEM_2 = "_keyboard_item_2";  /**< Keyboard key mapped to the item 2 command. */
-const std::string Savegame::KEY_KEYBOARD_PAUSE = "_keyboard_pause";    /**< Keyboard key mapped to the pause command. */
-const std::string Savegame::KEY_KEYBOARD_RIGHT = "_keyboard_right";    /**< Keyboard key mapped to the right command. */
-const std::string Savegame::KEY_KEYBOARD_UP = "_keyboard_up";          /**< Keyboard key mapped to the up command. */
-const std::string Savegame::KEY_KEYBOARD_LEFT = "_keyboard_left";      /**< Keyboard key mapped to the left command. */
-const std::string Savegame::KEY_KEYBOARD_DOWN = "_keyboard_down";      /**< Keyboard key mapped to the down command. */
-const std::string Savegame::KEY_JOYPAD_ACTION = "_joypad_action";      /**< Joypad string mapped to the action command. */
-const std::string Savegame::KEY_JOYPAD_ATTACK = "_joypad_attack";      /**< Joypad string mapped to the attack command. */
-const std::string Savegame::KEY_JOYPAD_ITEM_1 = "_joypad_item_1";      /**< Joypad string mapped to the item 1 command. */
-const std::string Savegame::KEY_JOYPAD_ITEM_2 = "_joypad_item_2";      /**< Joypad string mapped to the item 2 command. */
-const std::string Savegame::KEY_JOYPAD_PAUSE = "_joypad_pause";        /**< Joypad string mapped to the pause command. */
-const std::string Savegame::KEY_JOYPAD_RIGHT = "_joypad_right";        /**< Joypad string mapped to the right command. */
-const std::string Savegame::KEY_JOYPAD_UP = "_joypad_up_key";          /**< Joypad string mapped to the up command. */
-const std::string Savegame::KEY_JOYPAD_LEFT = "_joypad_left_key";      /**< Joypad string mapped to the left command. */
-const std::string Savegame::KEY_JOYPAD_DOWN = "_joypad_down_key";      /**< Joypad string mapped to the down command. */
-const std::string Savegame::KEY_CURRENT_LIFE = "_current_life";        /**< Number of life points. */
-const std::string Savegame::KEY_CURRENT_MONEY = "_current_money";      /**< Amount of money. */
-const std::string Savegame::KEY_CURRENT_MAGIC = "_current_magic";      /**< Number of magic points. */
-const std::string Savegame::KEY_MAX_LIFE = "_max_life";                /**< Maximum allowed life points. */
-const std::string Savegame::KEY_MAX_MONEY = "_max_money";              /**< Maximum allowed money. */
-const std::string Savegame::KEY_MAX_MAGIC = "_max_magic";              /**< Maximum allowed magic points. */
-const std::string Savegame::KEY_ITEM_SLOT_1 = "_item_slot_1";          /**< Name of the equipment item in slot 1. */
-const std::string Savegame::KEY_ITEM_SLOT_2 = "_item_slot_2";          /**< Name of the equipment item in slot 2. */
-const std::string Savegame::KEY_ABILITY_TUNIC = "_ability_tunic";      /**< Resistance level. */
-const std::string Savegame::KEY_ABILITY_SWORD = "_ability_sword";      /**< Attack level. */
-const std::string Savegame::KEY_ABILITY_SWORD_KNOWLEDGE =
-    "_ability_sword_knowledge";                                        /**< Super spin attack ability level. */
-const std::string Savegame::KEY_ABILITY_SHIELD = "_ability_shield";    /**< Protection level. */
-const std::string Savegame::KEY_ABILITY_LIFT = "_ability_lift";        /**< Lift level. */
-const std::string Savegame::KEY_ABILITY_SWIM = "_ability_swim";        /**< Swim level. */
-const std::string Savegame::KEY_ABILITY_JUMP_OVER_WATER =
-    "_ability_jump_over_water";                                        /**< Jump over water level. */
-const std::string Savegame::KEY_ABILITY_RUN = "_ability_run";          /**< Run level. */
-const std::string Savegame::KEY_ABILITY_PUSH = "_ability_push";        /**< Push level. */
-const std::string Savegame::KEY_ABILITY_GRAB = "_ability_grab";        /**< Grab level. */
-const std::string Savegame::KEY_ABILITY_PULL = "_ability_pull";        /**< Pull level. */
-const std::string Savegame::KEY_ABILITY_DETECT_WEAK_WALLS =
-    "_ability_detect_weak_walls";                                      /**< Weak walls detection level. */
-const std::string Savegame::KEY_ABILITY_GET_BACK_FROM_DEATH =
-    "_ability_get_back_from_death";                                    /**< Resurrection ability level. */
+std::shared_future<bool> Savegame::last_save;
+
+namespace {
+
+/**
+ * \brief Names of the built-in keys, indexed by their id.
+ */
+const char* const builtin_key_names[] = {
+  "_version",
+  "_starting_map",
+  "_starting_point",
+  "_keyboard_action",
+  "_keyboard_attack",
+  "_keyboard_item_1",
+  "_keyboard_item_2",
+  "_keyboard_pause",
+  "_keyboard_right",
+  "_keyboard_up",
+  "_keyboard_left",
+  "_keyboard_down",
+  "_joypad_action",
+  "_joypad_attack",
+  "_joypad_item_1",
+  "_joypad_item_2",
+  "_joypad_pause",
+  "_joypad_right",
+  "_joypad_up_key",
+  "_joypad_left_key",
+  "_joypad_down_key",
+  "_current_life",
+  "_current_money",
+  "_current_magic",
+  "_max_life",
+  "_max_money",
+  "_max_magic",
+  "_item_slot_1",
+  "_item_slot_2",
+  "_ability_tunic",
+  "_ability_sword",
+  "_ability_sword_knowledge",
+  "_ability_shield",
+  "_ability_lift",
+  "_ability_swim",
+  "_ability_jump_over_water",
+  "_ability_run",
+  "_ability_push",
+  "_ability_grab",
+  "_ability_pull",
+  "_ability_detect_weak_walls",
+  "_ability_get_back_from_death",
+};
+
+/**
+ * \brief Names of the savegame keys interned so far.
+ *
+ * They are shared by the main loops of all threads.
+ */
+struct InternedKeys {
+
+  /**
+   * \brief Interns the built-in keys first, so that their ids are the
+   * constant ones of the built-in key constants.
+   */
+  InternedKeys() {
+    for (const char* name: builtin_key_names) {
+      ids.emplace(name, static_cast<uint32_t>(names.size()));
+      names.emplace_back(name);
+    }
+  }
+
+  std::deque<std::string> names;                   /**< Names indexed by id, never moved. */
+  std::unordered_map<std::string, uint32_t> ids;   /**< Id of each name. */
+  std::mutex mutex;                                /**< Lock for names and ids. */
+};
+
+/**
+ * \brief Returns the interned keys.
+ * \return The interned keys.
+ */
+InternedKeys& get_interned_keys() {
+
+  static InternedKeys interned_keys;
+  return interned_keys;
+}
+
+}  // Anonymous namespace.
+
+const Savegame::Key Savegame::KEY_SAVEGAME_VERSION(0);             /**< Format of this savegame file. */
+const Savegame::Key Savegame::KEY_STARTING_MAP(1);                 /**< Map id where to start the savegame. */
+const Savegame::Key Savegame::KEY_STARTING_POINT(2);               /**< Destination name on the starting map. */
+const Savegame::Key Savegame::KEY_KEYBOARD_ACTION(3);              /**< Keyboard key mapped to the action command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_ATTACK(4);              /**< Keyboard key mapped to the attack command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_ITEM_1(5);              /**< Keyboard key mapped to the item 1 command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_ITEM_2(6);              /**< Keyboard key mapped to the item 2 command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_PAUSE(7);               /**< Keyboard key mapped to the pause command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_RIGHT(8);               /**< Keyboard key mapped to the right command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_UP(9);                  /**< Keyboard key mapped to the up command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_LEFT(10);               /**< Keyboard key mapped to the left command. */
+const Savegame::Key Savegame::KEY_KEYBOARD_DOWN(11);               /**< Keyboard key mapped to the down command. */
+const Savegame::Key Savegame::KEY_JOYPAD_ACTION(12);               /**< Joypad string mapped to the action command. */
+const Savegame::Key Savegame::KEY_JOYPAD_ATTACK(13);               /**< Joypad string mapped to the attack command. */
+const Savegame::Key Savegame::KEY_JOYPAD_ITEM_1(14);               /**< Joypad string mapped to the item 1 command. */
+const Savegame::Key Savegame::KEY_JOYPAD_ITEM_2(15);               /**< Joypad string mapped to the item 2 command. */
+const Savegame::Key Savegame::KEY_JOYPAD_PAUSE(16);                /**< Joypad string mapped to the pause command. */
+const Savegame::Key Savegame::KEY_JOYPAD_RIGHT(17);                /**< Joypad string mapped to the right command. */
+const Savegame::Key Savegame::KEY_JOYPAD_UP(18);                   /**< Joypad string mapped to the up command. */
+const Savegame::Key Savegame::KEY_JOYPAD_LEFT(19);                 /**< Joypad string mapped to the left command. */
+const Savegame::Key Savegame::KEY_JOYPAD_DOWN(20);                 /**< Joypad string mapped to the down command. */
+const Savegame::Key Savegame::KEY_CURRENT_LIFE(21);                /**< Number of life points. */
+const Savegame::Key Savegame::KEY_CURRENT_MONEY(22);               /**< Amount of money. */
+const Savegame::Key Savegame::KEY_CURRENT_MAGIC(23);               /**< Number of magic points. */
+const Savegame::Key Savegame::KEY_MAX_LIFE(24);                    /**< Maximum allowed life points. */
+const Savegame::Key Savegame::KEY_MAX_MONEY(25);                   /**< Maximum allowed money. */
+const Savegame::Key Savegame::KEY_MAX_MAGIC(26);                   /**< Maximum allowed magic points. */
+const Savegame::Key Savegame::KEY_ITEM_SLOT_1(27);                 /**< Name of the equipment item in slot 1. */
+const Savegame::Key Savegame::KEY_ITEM_SLOT_2(28);                 /**< Name of the equipment item in slot 2. */
+const Savegame::Key Savegame::KEY_ABILITY_TUNIC(29);               /**< Resistance level. */
+const Savegame::Key Savegame::KEY_ABILITY_SWORD(30);               /**< Attack level. */
+const Savegame::Key Savegame::KEY_ABILITY_SWORD_KNOWLEDGE(31);     /**< Super spin attack ability level. */
+const Savegame::Key Savegame::KEY_ABILITY_SHIELD(32);              /**< Protection level. */
+const Savegame::Key Savegame::KEY_ABILITY_LIFT(33);                /**< Lift level. */
+const Savegame::Key Savegame::KEY_ABILITY_SWIM(34);                /**< Swim level. */
+const Savegame::Key Savegame::KEY_ABILITY_JUMP_OVER_WATER(35);     /**< Jump over water level. */
+const Savegame::Key Savegame::KEY_ABILITY_RUN(36);                 /**< Run level. */
+const Savegame::Key Savegame::KEY_ABILITY_PUSH(37);                /**< Push level. */
+const Savegame::Key Savegame::KEY_ABILITY_GRAB(38);                /**< Grab level. */
+const Savegame::Key Savegame::KEY_ABILITY_PULL(39);                /**< Pull level. */
+const Savegame::Key Savegame::KEY_ABILITY_DETECT_WEAK_WALLS(40);   /**< Weak walls detection level. */
+const Savegame::Key Savegame::KEY_ABILITY_GET_BACK_FROM_DEATH(41); /**< Resurrection ability level. */
 
 /**
  * \brief Creates a savegame with a specified file name, existing or not.
@@ -88,7 +176,10 @@ Savegame::Savegame(MainLoop& main_loop, const std::string& file_name):
   file_name(file_name),
   main_loop(main_loop),
   equipment(*this),
-  game(nullptr) {
+  game(nullptr),
+  value_watchers(),
+  changed_keys(),
+  changed_key_flags() {
 
   // Don't call initialize() manually because the shared_ptr does not exist
   // at this point, but is needed by initialize() when calling item scripts.
@@ -108,6 +199,9 @@ void Savegame::initialize() {
   Debug::check_assertion(!quest_write_dir.empty(),
       "The quest write directory for savegames was not set in quest.dat");
 
+  // The file may still be being written.
+  wait_for_pending_saves();
+
   if (!QuestFiles::data_file_exists(file_name)) {
     // This save does not exist yet.
     empty = true;
@@ -218,6 +312,20 @@ void Savegame::post_process_existing_savegame() {
   }
 }
 
+/**
+ * \brief Returns a hash of all values of this savegame.
+ *
+ * This is the hash of the text that save() would write, so it does not
+ * depend on the order values were set in.
+ *
+ * \return The hash of the values.
+ */
+uint64_t Savegame::get_values_hash() const {
+
+  std::vector<NamedValue> values = get_named_values();
+  return WorldStateHash::combine(WorldStateHash::initial_hash, serialize(values));
+}
+
 /**
  * \brief Import the savegame data from the file.
  */
@@ -309,14 +417,107 @@ int Savegame::l_newindex(lua_State* l) {
 
 /**
  * \brief Saves the data into a file.
+ *
+ * The file is replaced at once, so that it is never left half-written.
+ * Saves started by save_async() are finished first.
  */
 void Savegame::save() {
 
+  wait_for_pending_saves();
+  std::vector<NamedValue> values = get_named_values();
+  if (!QuestFiles::data_file_replace(file_name, serialize(values))) {
+    Debug::die(std::string("Cannot save file '") + file_name + "'");
+  }
+  empty = false;
+}
+
+/**
+ * \brief Saves the data into a file from a separate thread.
+ *
+ * The current values are copied: they can be changed right away without
+ * affecting this save. Saves are written in the order they were started.
+ *
+ * \return The result of the save: \c true in case of success.
+ */
+std::shared_future<bool> Savegame::save_async() {
+
+  last_save = std::async(
+      std::launch::async,
+      &Savegame::write_values,
+      file_name,
+      get_named_values(),
+      last_save
+  ).share();
+  empty = false;
+  return last_save;
+}
+
+/**
+ * \brief Blocks until all saves started by save_async() are finished.
+ *
+ * Call this before reading, deleting or moving savegame files.
+ */
+void Savegame::wait_for_pending_saves() {
+
+  if (last_save.valid()) {
+    last_save.wait();
+  }
+}
+
+/**
+ * \brief Writes saved values to a file.
+ *
+ * This function runs on the thread of a save started by save_async().
+ *
+ * \param file_name The file to write.
+ * \param values The values to save.
+ * \param previous_save Save to wait for before writing, if valid.
+ * \return \c true in case of success.
+ */
+bool Savegame::write_values(
+    const std::string& file_name,
+    std::vector<NamedValue> values,
+    const std::shared_future<bool>& previous_save
+) {
+  if (previous_save.valid()) {
+    previous_save.wait();
+  }
+  return QuestFiles::data_file_replace(file_name, serialize(values));
+}
+
+/**
+ * \brief Copies the values that are set with their name.
+ * \return The values to save.
+ */
+std::vector<Savegame::NamedValue> Savegame::get_named_values() const {
+
+  std::vector<NamedValue> values;
+  for (size_t i = 0; i < saved_values.size(); ++i) {
+    if (saved_values[i].type != SavedValue::VALUE_NONE) {
+      values.push_back(NamedValue{ &Key(static_cast<uint32_t>(i)).get_name(), saved_values[i] });
+    }
+  }
+  return values;
+}
+
+/**
+ * \brief Converts saved values to the text of a savegame file.
+ *
+ * Values are written in the alphabetical order of their names.
+ *
+ * \param values The values to convert. They are sorted.
+ * \return The Lua code of the savegame file.
+ */
+std::string Savegame::serialize(std::vector<NamedValue>& values) {
+
+  std::sort(values.begin(), values.end(), [](const NamedValue& first, const NamedValue& second) {
+    return *first.name < *second.name;
+  });
+
   std::ostringstream oss;
-  for (const auto& kvp: saved_values) {
-    const std::string& key = kvp.first;
-    oss << key << " = ";
-    const SavedValue& value = kvp.second;
+  for (const NamedValue& named_value: values) {
+    oss << *named_value.name << " = ";
+    const SavedValue& value = named_value.value;
     if (value.type == SavedValue::VALUE_BOOLEAN) {
       oss << (value.int_data ? "true" : "false");
     }
@@ -329,9 +530,7 @@ void Savegame::save() {
     oss << "\n";
   }
 
-  const std::string& text = oss.str();
-  QuestFiles::data_file_save(file_name, text);
-  empty = false;
+  return oss.str();
 }
 
 /**
@@ -410,6 +609,141 @@ void Savegame::notify_game_started() {
 void Savegame::notify_game_finished() {
 
   equipment.notify_game_finished();
+
+  // Watchers owned by the savegame were added by scripts for this game.
+  for (std::vector<ValueWatcherSlot>& watchers: value_watchers) {
+    watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+        [](const ValueWatcherSlot& slot) { return slot.owned_watcher != nullptr; }),
+        watchers.end()
+    );
+  }
+}
+
+/**
+ * \brief Creates an invalid key.
+ */
+Savegame::Key::Key():
+  id(static_cast<uint32_t>(-1)) {
+
+}
+
+/**
+ * \brief Creates a key from its id.
+ * \param id Id of an interned name.
+ */
+Savegame::Key::Key(uint32_t id):
+  id(id) {
+
+}
+
+/**
+ * \brief Returns the id of this key.
+ * \return The index of its name in the interned names.
+ */
+uint32_t Savegame::Key::get_id() const {
+  return id;
+}
+
+/**
+ * \brief Returns whether this key was interned.
+ * \return \c false if this key was created with the default constructor.
+ */
+bool Savegame::Key::is_valid() const {
+  return id != static_cast<uint32_t>(-1);
+}
+
+/**
+ * \brief Returns the name of this key.
+ * \return The name as written in savegame files.
+ */
+const std::string& Savegame::Key::get_name() const {
+
+  SOLARUS_ASSERT(is_valid(), "Invalid savegame key");
+  InternedKeys& interned_keys = get_interned_keys();
+  std::lock_guard<std::mutex> lock(interned_keys.mutex);
+  return interned_keys.names[id];
+}
+
+/**
+ * \brief Converts this key to its name.
+ * \return The name as written in savegame files.
+ */
+Savegame::Key::operator const std::string&() const {
+  return get_name();
+}
+
+/**
+ * \brief Returns the key of a name, interning it the first time.
+ * \param name Name of a value. It must be a valid Lua identifier.
+ * \return The corresponding key.
+ */
+Savegame::Key Savegame::get_key(const std::string& name) {
+
+  InternedKeys& interned_keys = get_interned_keys();
+  std::lock_guard<std::mutex> lock(interned_keys.mutex);
+  const auto& it = interned_keys.ids.find(name);
+  if (it != interned_keys.ids.end()) {
+    return Key(it->second);
+  }
+
+  // Names are only checked once.
+  Debug::check_assertion_lazy(LuaTools::is_valid_lua_identifier(name), [&] {
+    return std::string("Savegame variable '") + name + "' is not a valid key";
+  });
+
+  const uint32_t id = static_cast<uint32_t>(interned_keys.names.size());
+  interned_keys.names.push_back(name);
+  interned_keys.ids.emplace(name, id);
+  return Key(id);
+}
+
+/**
+ * \brief Returns the key of a name if it was already interned.
+ *
+ * No value can exist for a name that was never interned.
+ *
+ * \param[in] name Name of a value.
+ * \param[out] key The corresponding key if any.
+ * \return \c true if the name was already interned.
+ */
+bool Savegame::find_key(const std::string& name, Key& key) {
+
+  InternedKeys& interned_keys = get_interned_keys();
+  std::lock_guard<std::mutex> lock(interned_keys.mutex);
+  const auto& it = interned_keys.ids.find(name);
+  if (it == interned_keys.ids.end()) {
+    return false;
+  }
+  key = Key(it->second);
+  return true;
+}
+
+/**
+ * \brief Returns a value saved.
+ * \param key Key of the value to get.
+ * \return The value, or nullptr if it is not set.
+ */
+const Savegame::SavedValue* Savegame::get_value(const Key& key) const {
+
+  if (key.get_id() >= saved_values.size() ||
+      saved_values[key.get_id()].type == SavedValue::VALUE_NONE) {
+    return nullptr;
+  }
+  return &saved_values[key.get_id()];
+}
+
+/**
+ * \brief Returns the storage of a value, creating it if needed.
+ * \param key Key of the value to set.
+ * \return The value to modify.
+ */
+Savegame::SavedValue& Savegame::get_value_to_set(const Key& key) {
+
+  SOLARUS_ASSERT(key.is_valid(), "Invalid savegame key");
+  if (key.get_id() >= saved_values.size()) {
+    saved_values.resize(key.get_id() + 1, SavedValue{ SavedValue::VALUE_NONE, "", 0 });
+  }
+  return saved_values[key.get_id()];
 }
 
 /**
@@ -422,13 +756,19 @@ bool Savegame::is_string(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_STRING);
-  }
-  return result;
+  Key found_key;
+  return find_key(key, found_key) && is_string(found_key);
+}
+
+/**
+ * \brief Returns whether a saved value is a string.
+ * \param key Key of the value to get.
+ * \return true if this value exists and is a string.
+ */
+bool Savegame::is_string(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_STRING;
 }
 
 /**
@@ -441,18 +781,31 @@ std::string Savegame::get_string(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  Key found_key;
+  if (!find_key(key, found_key)) {
+    return "";
+  }
+  return get_string(found_key);
+}
+
+/**
+ * \brief Returns a string value saved.
+ * \param key Key of the value to get.
+ * \return The string value associated with this key or an empty string.
+ */
+std::string Savegame::get_string(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  if (value == nullptr) {
     return "";
   }
 
-  const SavedValue& value = it->second;
-  if (value.type != SavedValue::VALUE_STRING) {
-    Debug::error(std::string("Value '") + key + "' is not a string");
+  if (value->type != SavedValue::VALUE_STRING) {
+    Debug::error(std::string("Value '") + key.get_name() + "' is not a string");
     return "";
   }
 
-  return value.string_data;
+  return value->string_data;
 }
 
 /**
@@ -461,12 +814,24 @@ std::string Savegame::get_string(const std::string& key) const {
  * \param value The string value to associate with this key.
  */
 void Savegame::set_string(const std::string& key, const std::string& value) {
+  set_string(get_key(key), value);
+}
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+/**
+ * \brief Sets a string value saved.
+ * \param key Key of the value to set.
+ * \param value The string value to associate with this key.
+ */
+void Savegame::set_string(const Key& key, const std::string& value) {
 
-  saved_values[key].type = SavedValue::VALUE_STRING;
-  saved_values[key].string_data = value;
+  SavedValue& saved_value = get_value_to_set(key);
+  if (saved_value.type == SavedValue::VALUE_STRING &&
+      saved_value.string_data == value) {
+    return;
+  }
+  saved_value.type = SavedValue::VALUE_STRING;
+  saved_value.string_data = value;
+  notify_value_changed(key);
 }
 
 /**
@@ -479,13 +844,19 @@ bool Savegame::is_integer(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_INTEGER);
-  }
-  return result;
+  Key found_key;
+  return find_key(key, found_key) && is_integer(found_key);
+}
+
+/**
+ * \brief Returns whether a saved value is an integer.
+ * \param key Key of the value to get.
+ * \return true if this value exists and is an integer.
+ */
+bool Savegame::is_integer(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_INTEGER;
 }
 
 /**
@@ -498,17 +869,30 @@ int Savegame::get_integer(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  Key found_key;
+  if (!find_key(key, found_key)) {
     return 0;
   }
+  return get_integer(found_key);
+}
 
-  const SavedValue& value = it->second;
-  if (value.type != SavedValue::VALUE_INTEGER) {
-    Debug::error(std::string("Value '") + key + "' is not an integer");
+/**
+ * \brief Returns a integer value saved.
+ * \param key Key of the value to get.
+ * \return The integer value associated with this key or 0.
+ */
+int Savegame::get_integer(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  if (value == nullptr) {
+    return 0;
+  }
+
+  if (value->type != SavedValue::VALUE_INTEGER) {
+    Debug::error(std::string("Value '") + key.get_name() + "' is not an integer");
   }
 
-  return value.int_data;
+  return value->int_data;
 }
 
 /**
@@ -517,12 +901,24 @@ int Savegame::get_integer(const std::string& key) const {
  * \param value The integer value to associate with this key.
  */
 void Savegame::set_integer(const std::string& key, int value) {
+  set_integer(get_key(key), value);
+}
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+/**
+ * \brief Sets an integer value saved.
+ * \param key Key of the value to set.
+ * \param value The integer value to associate with this key.
+ */
+void Savegame::set_integer(const Key& key, int value) {
 
-  saved_values[key].type = SavedValue::VALUE_INTEGER;
-  saved_values[key].int_data = value;
+  SavedValue& saved_value = get_value_to_set(key);
+  if (saved_value.type == SavedValue::VALUE_INTEGER &&
+      saved_value.int_data == value) {
+    return;
+  }
+  saved_value.type = SavedValue::VALUE_INTEGER;
+  saved_value.int_data = value;
+  notify_value_changed(key);
 }
 
 /**
@@ -535,13 +931,19 @@ bool Savegame::is_boolean(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_BOOLEAN);
-  }
-  return result;
+  Key found_key;
+  return find_key(key, found_key) && is_boolean(found_key);
+}
+
+/**
+ * \brief Returns whether a saved value is a boolean.
+ * \param key Key of the value to get.
+ * \return true if this value exists and is a boolean.
+ */
+bool Savegame::is_boolean(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_BOOLEAN;
 }
 
 /**
@@ -554,17 +956,30 @@ bool Savegame::get_boolean(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  Key found_key;
+  if (!find_key(key, found_key)) {
+    return false;
+  }
+  return get_boolean(found_key);
+}
+
+/**
+ * \brief Returns a boolean value saved.
+ * \param key Key of the value to get.
+ * \return The boolean value associated with this key or false.
+ */
+bool Savegame::get_boolean(const Key& key) const {
+
+  const SavedValue* value = get_value(key);
+  if (value == nullptr) {
     return false;
   }
 
-  const SavedValue& value = it->second;
-  if (value.type != SavedValue::VALUE_BOOLEAN) {
-    Debug::error(std::string("Value '") + key + "' is not a boolean");
+  if (value->type != SavedValue::VALUE_BOOLEAN) {
+    Debug::error(std::string("Value '") + key.get_name() + "' is not a boolean");
     return false;
   }
-  return value.int_data != 0;
+  return value->int_data != 0;
 }
 
 /**
@@ -573,12 +988,24 @@ bool Savegame::get_boolean(const std::string& key) const {
  * \param value The boolean value to associate with this key.
  */
 void Savegame::set_boolean(const std::string& key, bool value) {
+  set_boolean(get_key(key), value);
+}
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+/**
+ * \brief Sets a boolean value saved.
+ * \param key Key of the value to set.
+ * \param value The boolean value to associate with this key.
+ */
+void Savegame::set_boolean(const Key& key, bool value) {
 
-  saved_values[key].type = SavedValue::VALUE_BOOLEAN;
-  saved_values[key].int_data = value;
+  SavedValue& saved_value = get_value_to_set(key);
+  if (saved_value.type == SavedValue::VALUE_BOOLEAN &&
+      (saved_value.int_data != 0) == value) {
+    return;
+  }
+  saved_value.type = SavedValue::VALUE_BOOLEAN;
+  saved_value.int_data = value;
+  notify_value_changed(key);
 }
 
 /**
@@ -588,7 +1015,17 @@ void Savegame::set_boolean(const std::string& key, bool value) {
  */
 bool Savegame::is_set(const std::string& key) const {
 
-  return saved_values.find(key) != saved_values.end();
+  Key found_key;
+  return find_key(key, found_key) && is_set(found_key);
+}
+
+/**
+ * \brief Returns whether a value is defined in the savegame.
+ * \param key Key of the value to check.
+ * \return \c true if such a value is defined.
+ */
+bool Savegame::is_set(const Key& key) const {
+  return get_value(key) != nullptr;
 }
 
 /**
@@ -597,10 +1034,138 @@ bool Savegame::is_set(const std::string& key) const {
  */
 void Savegame::unset(const std::string& key) {
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+  Debug::check_assertion_lazy(LuaTools::is_valid_lua_identifier(key), [&] {
+    return std::string("Savegame variable '") + key + "' is not a valid key";
+  });
+
+  Key found_key;
+  if (find_key(key, found_key)) {
+    unset(found_key);
+  }
+}
+
+/**
+ * \brief Unsets a value saved.
+ * \param key Key of the value to unset.
+ */
+void Savegame::unset(const Key& key) {
+
+  if (key.get_id() < saved_values.size()) {
+    SavedValue& value = saved_values[key.get_id()];
+    if (value.type == SavedValue::VALUE_NONE) {
+      return;
+    }
+    value.type = SavedValue::VALUE_NONE;
+    value.string_data.clear();
+    value.int_data = 0;
+    notify_value_changed(key);
+  }
+}
+
+/**
+ * \brief Calls a function when a value changes.
+ *
+ * The savegame does not own the function: it stops being called
+ * when the caller releases it.
+ * Changes are notified in batch by notify_value_watchers(),
+ * at most once per value.
+ *
+ * \param key Key of the value to watch.
+ * \param watcher The function to call.
+ */
+void Savegame::add_value_watcher(const Key& key, const ValueWatcherPtr& watcher) {
 
-  saved_values.erase(key);
+  SOLARUS_ASSERT(key.is_valid(), "Invalid savegame key");
+  if (key.get_id() >= value_watchers.size()) {
+    value_watchers.resize(key.get_id() + 1);
+    changed_key_flags.resize(key.get_id() + 1, false);
+  }
+  value_watchers[key.get_id()].push_back({ watcher, nullptr });
+}
+
+/**
+ * \brief Calls a function when a value changes, until it returns \c false
+ * or the game finishes.
+ *
+ * The savegame owns a copy of the function.
+ *
+ * \param key Key of the value to watch.
+ * \param watcher The function to call.
+ */
+void Savegame::add_value_watcher(const Key& key, const ValueWatcher& watcher) {
+
+  const ValueWatcherPtr& owned_watcher = std::make_shared<ValueWatcher>(watcher);
+  add_value_watcher(key, owned_watcher);
+  value_watchers[key.get_id()].back().owned_watcher = owned_watcher;
+}
+
+/**
+ * \brief Stops calling a function when a value changes.
+ * \param key Key of the value watched.
+ * \param watcher The function to stop calling.
+ */
+void Savegame::remove_value_watcher(const Key& key, const ValueWatcher* watcher) {
+
+  if (key.get_id() >= value_watchers.size()) {
+    return;
+  }
+  std::vector<ValueWatcherSlot>& watchers = value_watchers[key.get_id()];
+  watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+      [watcher](const ValueWatcherSlot& slot) {
+        const ValueWatcherPtr& locked_watcher = slot.watcher.lock();
+        return locked_watcher == nullptr || locked_watcher.get() == watcher;
+      }),
+      watchers.end()
+  );
+}
+
+/**
+ * \brief Remembers that a value has changed if it is watched.
+ * \param key Key of the value changed.
+ */
+void Savegame::notify_value_changed(const Key& key) {
+
+  const uint32_t id = key.get_id();
+  if (id >= value_watchers.size() ||
+      value_watchers[id].empty() ||
+      changed_key_flags[id]) {
+    return;
+  }
+  changed_key_flags[id] = true;
+  changed_keys.push_back(key);
+}
+
+/**
+ * \brief Calls the watchers of the values changed since the last call.
+ *
+ * This is done once per cycle by the game.
+ * Values changed by watchers are notified at the next call.
+ */
+void Savegame::notify_value_watchers() {
+
+  if (changed_keys.empty()) {
+    return;
+  }
+
+  std::vector<Key> keys;
+  keys.swap(changed_keys);
+  for (const Key& key: keys) {
+    changed_key_flags[key.get_id()] = false;
+  }
+
+  for (const Key& key: keys) {
+    // Watchers may add or remove watchers.
+    const std::vector<ValueWatcherSlot> watchers = value_watchers[key.get_id()];
+    for (const ValueWatcherSlot& slot: watchers) {
+      const ValueWatcherPtr& watcher = slot.watcher.lock();
+      if (watcher == nullptr) {
+        remove_value_watcher(key, nullptr);
+      }
+      else if (!(*watcher)(key)) {
+        remove_value_watcher(key, watcher.get());
+      }
+    }
+  }
 }
 
 /**
@@ -31,17 +31,15 @@ namespace Solarus {
  */
 SavegameConverterV1::SavegameConverterV1(const std::string& file_name) {
 
-  Debug::check_assertion(QuestFiles::data_file_exists(file_name),
-      std::string("Cannot convert savegame '") + file_name
-      + "': file does not exist"
-  );
+  Debug::check_assertion_lazy(QuestFiles::data_file_exists(file_name), [&] {
+    return std::string("Cannot convert savegame '") + file_name + "': file does not exist";
+  });
 
   // Let's load this obsolete savegame.
   const std::string& buffer = QuestFiles::data_file_read(file_name);
-  Debug::check_assertion(buffer.size() == sizeof(SavedData),
-      std::string("Cannot read savegame file version 1 '")
-      + file_name + "': invalid file size"
-  );
+  Debug::check_assertion_lazy(buffer.size() == sizeof(SavedData), [&] {
+    return std::string("Cannot read savegame file version 1 '") + file_name + "': invalid file size";
+  });
   std::memcpy(&saved_data, buffer.data(), sizeof(SavedData));
 }
 
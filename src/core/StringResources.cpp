@@ -14,11 +14,14 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/StringResources.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -61,8 +64,9 @@ const std::string& StringResources::get_string(
     const std::string& key) const {
 
   const auto& it = strings.find(key);
-  Debug::check_assertion(it != strings.end(),
-    std::string("No such string: '") + key + "'");
+  Debug::check_assertion_lazy(it != strings.end(), [&] {
+    return std::string("No such string: '") + key + "'";
+  });
 
   return it->second;
 }
@@ -78,8 +82,9 @@ const std::string& StringResources::get_string(
 std::string& StringResources::get_string(const std::string& key) {
 
   const auto& it = strings.find(key);
-  Debug::check_assertion(it != strings.end(),
-    std::string("No such string: '") + key + "'");
+  Debug::check_assertion_lazy(it != strings.end(), [&] {
+    return std::string("No such string: '") + key + "'";
+  });
 
   return it->second;
 }
@@ -199,4 +204,47 @@ bool StringResources::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::get_binary_magic
+ */
+std::string StringResources::get_binary_magic() const {
+  return { 'S', 'O', 'L', 'S', 'T', 'R', '\r', '\n' };
+}
+
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool StringResources::import_from_binary(BinaryReader& reader) {
+
+  StringResources resources;
+  const uint32_t num_strings = reader.read_uint32();
+  if (!reader.can_read(num_strings, 8)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_strings; ++i) {
+    const std::string& key = reader.read_string();
+    resources.add_string(key, reader.read_string());
+  }
+
+  if (!reader.is_valid()) {
+    return false;
+  }
+
+  *this = std::move(resources);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool StringResources::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_uint32(static_cast<uint32_t>(strings.size()));
+  for (const auto& kvp : strings) {
+    writer.write_string(kvp.first);
+    writer.write_string(kvp.second);
+  }
+  return true;
+}
+
 }
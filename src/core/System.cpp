@@ -24,6 +24,7 @@
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/Video.h"
 #include <SDL.h>
+#include <algorithm>
 #ifdef SOLARUS_USE_APPLE_POOL
 #  include "lowlevel/apple/AppleInterface.h"
 #endif
@@ -31,7 +32,18 @@
 namespace Solarus {
 
 uint32_t System::initial_time = 0;
-uint32_t System::ticks = 0;
+
+namespace {
+
+// Each thread that runs a main loop has its own simulation clock.
+// These are not static members because exported classes
+// cannot have thread-local data members on every platform.
+thread_local uint32_t ticks = 0;                    /**< Simulated time in milliseconds. */
+thread_local double interpolation_factor = 1.0;     /**< Progress of the real time between the
+                                                     * last two simulation steps, in [0, 1].
+                                                     * 1 means drawing the last step as is. */
+
+}  // Anonymous namespace.
 
 /**
  * \brief Initializes the basic low-level system.
@@ -67,6 +79,9 @@ void System::initialize(const Arguments& args) {
  * \brief Closes the low-level system.
  *
  * This closes all initializations made in initialize().
+ * SDL itself is only shut down if nothing else in the process still uses
+ * it, so that a program running several quests in a row can keep it
+ * initialized between them.
  */
 void System::quit() {
 
@@ -77,7 +92,10 @@ void System::quit() {
   FontResource::quit();
   Video::quit();
 
-  SDL_Quit();
+  SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK);
+  if (SDL_WasInit(SDL_INIT_EVERYTHING) == 0) {
+    SDL_Quit();
+  }
 }
 
 /**
@@ -112,6 +130,9 @@ std::string System::get_os() {
  *
  * Follows to the real time unless the system is too slow to play at
  * normal speed.
+ * Each thread has its own simulated time, advanced by the main loop that
+ * runs on it, so that simulations on different threads do not share a clock.
+ * Work sent to other threads gets the time as a parameter.
  *
  * \return The number of simulated milliseconds elapsed since the
  * initialization.
@@ -143,5 +164,31 @@ void System::sleep(uint32_t duration) {
   SDL_Delay(duration);
 }
 
+/**
+ * \brief Returns how far the real time is between the last two simulation
+ * steps.
+ *
+ * This is used when drawing to interpolate positions between the previous
+ * and the current simulation state.
+ *
+ * \return The interpolation factor, between 0 (previous state) and 1
+ * (current state).
+ */
+double System::get_interpolation_factor() {
+  return interpolation_factor;
+}
+
+/**
+ * \brief Sets how far the real time is between the last two simulation
+ * steps.
+ *
+ * This function is called by the main loop before drawing.
+ *
+ * \param factor The interpolation factor, between 0 (previous state)
+ * and 1 (current state).
+ */
+void System::set_interpolation_factor(double factor) {
+  interpolation_factor = std::max(0.0, std::min(factor, 1.0));
 }
 
+}
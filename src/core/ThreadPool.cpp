@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/ThreadPool.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a thread pool.
+ * \param num_workers Number of threads to create in addition to the caller.
+ * With zero, parallel loops are simply run on the calling thread.
+ */
+ThreadPool::ThreadPool(int num_workers):
+  workers(),
+  ranges(new Range[std::max(num_workers, 0) + 1]),
+  mutex(),
+  work_available(),
+  work_done(),
+  function(nullptr),
+  generation(0),
+  num_busy_workers(0),
+  stopping(false) {
+
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(&ThreadPool::worker_loop, this, i + 1);
+  }
+}
+
+/**
+ * \brief Stops and joins all worker threads.
+ */
+ThreadPool::~ThreadPool() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+}
+
+/**
+ * \brief Returns a reasonable number of worker threads for this machine.
+ *
+ * One core is left for the calling thread.
+ *
+ * \return The number of workers to create, possibly zero.
+ */
+int ThreadPool::get_default_num_workers() {
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::min(std::max(num_cores - 1, 0), 7);
+}
+
+/**
+ * \brief Returns the number of threads that process parallel loops.
+ * \return The number of workers plus the calling thread.
+ */
+int ThreadPool::get_num_threads() const {
+  return static_cast<int>(workers.size()) + 1;
+}
+
+/**
+ * \brief Calls a function for every index in [0, count), in parallel.
+ *
+ * The order of calls is unspecified, so the function must only touch
+ * data that belongs to its index. It must not throw.
+ *
+ * \param count Number of indices.
+ * \param function The function to call with each index.
+ */
+void ThreadPool::parallel_for(int count, const std::function<void (int)>& function) {
+
+  if (count <= 0) {
+    return;
+  }
+
+  if (workers.empty() || count == 1) {
+    for (int i = 0; i < count; ++i) {
+      function(i);
+    }
+    return;
+  }
+
+  const int num_threads = get_num_threads();
+  for (int i = 0; i < num_threads; ++i) {
+    ranges[i].next = static_cast<int>(static_cast<int64_t>(count) * i / num_threads);
+    ranges[i].end = static_cast<int>(static_cast<int64_t>(count) * (i + 1) / num_threads);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->function = &function;
+    num_busy_workers = static_cast<int>(workers.size());
+    ++generation;
+  }
+  work_available.notify_all();
+
+  run_ranges(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  work_done.wait(lock, [this]() { return num_busy_workers == 0; });
+  this->function = nullptr;
+}
+
+/**
+ * \brief Main function of a worker thread.
+ * \param thread_index Index of this worker's range.
+ */
+void ThreadPool::worker_loop(int thread_index) {
+
+  uint64_t last_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_available.wait(lock, [&]() {
+      return stopping || generation != last_generation;
+    });
+    if (stopping) {
+      return;
+    }
+    last_generation = generation;
+
+    lock.unlock();
+    run_ranges(thread_index);
+    lock.lock();
+
+    --num_busy_workers;
+    if (num_busy_workers == 0) {
+      work_done.notify_one();
+    }
+  }
+}
+
+/**
+ * \brief Processes the range of a thread, then steals from the other ones.
+ * \param thread_index Index of the range of the current thread.
+ */
+void ThreadPool::run_ranges(int thread_index) {
+
+  const int num_threads = get_num_threads();
+  for (int i = 0; i < num_threads; ++i) {
+    Range& range = ranges[(thread_index + i) % num_threads];
+    int index = range.next.fetch_add(1);
+    while (index < range.end) {
+      (*function)(index);
+      index = range.next.fetch_add(1);
+    }
+  }
+}
+
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/Trace.h"
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief A recorded complete event.
+ */
+struct Event {
+  std::string name;           /**< Name of the event. */
+  std::string detail;         /**< Argument of the event or an empty string. */
+  double start_time;          /**< Start date in milliseconds. */
+  double duration;            /**< Duration in milliseconds. */
+  int thread_id;              /**< Small number identifying the thread. */
+};
+
+/**
+ * \brief Recorded values of a group of counters at a date.
+ */
+struct CounterEvent {
+  std::string name;           /**< Name of the group of counters. */
+  double time;                /**< Date in milliseconds. */
+  std::vector<std::pair<std::string, int64_t>>
+      values;                 /**< Name and value of each counter. */
+};
+
+constexpr size_t max_events = 1000000;  /**< Further events are dropped. */
+
+std::atomic<bool> recording(false);
+std::mutex events_mutex;
+std::vector<Event> events;
+std::vector<CounterEvent> counter_events;
+size_t num_dropped_events = 0;
+std::atomic<int> next_thread_id(0);
+
+/**
+ * \brief Returns a small number identifying the current thread.
+ * \return The thread id, 0 for the first thread that records an event.
+ */
+int get_thread_id() {
+
+  static thread_local int thread_id = next_thread_id++;
+  return thread_id;
+}
+
+/**
+ * \brief Escapes a string for JSON.
+ * \param value The string to escape.
+ * \return The string between double quotes.
+ */
+std::string to_json(const std::string& value) {
+
+  std::ostringstream oss;
+  oss << '"';
+  for (char c: value) {
+    if (c == '"' || c == '\\') {
+      oss << '\\' << c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      oss << ' ';
+    }
+    else {
+      oss << c;
+    }
+  }
+  oss << '"';
+  return oss.str();
+}
+
+}  // Anonymous namespace.
+
+#ifdef SOLARUS_TRACING
+/**
+ * \brief Starts an event if a trace is being recorded.
+ * \param name Name of the event. It must live until the end of the scope.
+ */
+Trace::Scope::Scope(const char* name):
+  name(name),
+  detail(),
+  start_time(recording ? FrameTimings::get_time() : -1.0) {
+
+}
+
+/**
+ * \brief Starts an event with an argument if a trace is being recorded.
+ * \param name Name of the event. It must live until the end of the scope.
+ * \param detail Argument shown with the event.
+ */
+Trace::Scope::Scope(const char* name, const std::string& detail):
+  name(name),
+  detail(),
+  start_time(-1.0) {
+
+  if (recording) {
+    this->detail = detail;
+    start_time = FrameTimings::get_time();
+  }
+}
+
+/**
+ * \brief Records the event.
+ */
+Trace::Scope::~Scope() {
+
+  if (start_time >= 0.0) {
+    add_event(name, detail, start_time, FrameTimings::get_time());
+  }
+}
+#endif
+
+/**
+ * \brief Returns whether trace markers exist in this build.
+ * \return \c true if the engine was built with SOLARUS_TRACING.
+ */
+bool Trace::is_enabled() {
+
+#ifdef SOLARUS_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * \brief Starts recording events, discarding previous ones.
+ */
+void Trace::start() {
+
+  std::lock_guard<std::mutex> lock(events_mutex);
+  events.clear();
+  counter_events.clear();
+  num_dropped_events = 0;
+  recording = true;
+}
+
+/**
+ * \brief Stops recording events.
+ *
+ * Events already recorded are kept until the next call to start().
+ */
+void Trace::stop() {
+  recording = false;
+}
+
+/**
+ * \brief Returns whether events are being recorded.
+ * \return \c true if start() was called and not stop().
+ */
+bool Trace::is_recording() {
+  return recording;
+}
+
+/**
+ * \brief Records a complete event.
+ * \param name Name of the event.
+ * \param detail Argument shown with the event or an empty string.
+ * \param start_time Start date in milliseconds.
+ * \param end_time End date in milliseconds.
+ */
+void Trace::add_event(
+    const char* name,
+    const std::string& detail,
+    double start_time,
+    double end_time
+) {
+  if (!recording) {
+    return;
+  }
+
+  const int thread_id = get_thread_id();
+  std::lock_guard<std::mutex> lock(events_mutex);
+  if (events.size() >= max_events) {
+    ++num_dropped_events;
+    return;
+  }
+  events.push_back(Event{ name, detail, start_time, end_time - start_time, thread_id });
+}
+
+/**
+ * \brief Records the current values of a group of counters.
+ *
+ * Viewers show each group as a graph, like memory by category.
+ *
+ * \param name Name of the group of counters.
+ * \param values Name and value of each counter.
+ */
+void Trace::add_counters(
+    const char* name,
+    const std::vector<std::pair<std::string, int64_t>>& values
+) {
+  if (!recording) {
+    return;
+  }
+
+  const double time = FrameTimings::get_time();
+  std::lock_guard<std::mutex> lock(events_mutex);
+  if (counter_events.size() >= max_events) {
+    ++num_dropped_events;
+    return;
+  }
+  counter_events.push_back(CounterEvent{ name, time, values });
+}
+
+/**
+ * \brief Writes the recorded events in the JSON trace event format.
+ * \param file_name The file to write.
+ * \return \c true in case of success.
+ */
+bool Trace::save_json(const std::string& file_name) {
+
+  std::lock_guard<std::mutex> lock(events_mutex);
+
+  std::ofstream out(file_name.c_str());
+  out.precision(3);
+  out << std::fixed;
+  out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":"
+      << num_dropped_events << "},\"traceEvents\":[" << std::endl;
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+      << "\"args\":{\"name\":\"solarus\"}}";
+
+  // Dates are in microseconds in this format.
+  for (const Event& event: events) {
+    out << "," << std::endl
+        << "{\"name\":" << to_json(event.name)
+        << ",\"ph\":\"X\",\"ts\":" << event.start_time * 1000.0
+        << ",\"dur\":" << event.duration * 1000.0
+        << ",\"pid\":1,\"tid\":" << event.thread_id;
+    if (!event.detail.empty()) {
+      out << ",\"args\":{\"detail\":" << to_json(event.detail) << "}";
+    }
+    out << "}";
+  }
+  for (const CounterEvent& event: counter_events) {
+    out << "," << std::endl
+        << "{\"name\":" << to_json(event.name)
+        << ",\"ph\":\"C\",\"ts\":" << event.time * 1000.0
+        << ",\"pid\":1,\"tid\":0,\"args\":{";
+    for (size_t i = 0; i < event.values.size(); ++i) {
+      out << (i == 0 ? "" : ",") << to_json(event.values[i].first)
+          << ":" << event.values[i].second;
+    }
+    out << "}}";
+  }
+  out << std::endl << "]}" << std::endl;
+
+  return static_cast<bool>(out);
+}
+
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/EnumInfo.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/Savegame.h"
+#include "solarus/core/WorldStateHash.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/entities/Hero.h"
+#include "solarus/lua/LuaContext.h"
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+namespace Solarus {
+
+constexpr uint64_t WorldStateHash::initial_hash;
+
+namespace {
+
+/**
+ * \brief Hashes the simulated state of an entity.
+ * \param entity An entity.
+ * \return Its hash.
+ */
+uint64_t get_entity_hash(const Entity& entity) {
+
+  uint64_t hash = WorldStateHash::initial_hash;
+  hash = WorldStateHash::combine(hash, static_cast<uint64_t>(entity.get_type()));
+  hash = WorldStateHash::combine(hash, entity.get_name());
+  hash = WorldStateHash::combine(hash, static_cast<uint64_t>(static_cast<int64_t>(entity.get_x())));
+  hash = WorldStateHash::combine(hash, static_cast<uint64_t>(static_cast<int64_t>(entity.get_y())));
+  hash = WorldStateHash::combine(hash, static_cast<uint64_t>(static_cast<int64_t>(entity.get_layer())));
+  hash = WorldStateHash::combine(hash, static_cast<uint64_t>(static_cast<int64_t>(entity.get_direction())));
+  hash = WorldStateHash::combine(hash, entity.is_enabled() ? 1 : 0);
+  hash = WorldStateHash::combine(hash, entity.get_state_name());
+  hash = WorldStateHash::combine(hash, entity.get_random_stream().get_counter());
+  return hash;
+}
+
+/**
+ * \brief Returns the name of the component of an entity.
+ * \param index Index of the entity in the map.
+ * \param entity The entity.
+ * \return A name like "entity 3 enemy 'bat'".
+ */
+std::string get_entity_component_name(int index, const Entity& entity) {
+
+  std::ostringstream oss;
+  oss << "entity " << index << " " << enum_to_name(entity.get_type())
+      << " '" << entity.get_name() << "'";
+  return oss.str();
+}
+
+/**
+ * \brief Formats a hash as 16 hexadecimal digits.
+ * \param hash A hash.
+ * \return The text of the hash.
+ */
+std::string to_hex(uint64_t hash) {
+
+  std::ostringstream oss;
+  oss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return oss.str();
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a disabled world state hash.
+ */
+WorldStateHash::WorldStateHash():
+  out(),
+  reference(),
+  next_reference_line(),
+  num_ticks(0),
+  divergence() {
+
+}
+
+/**
+ * \brief Starts writing the hash of each tick to a file.
+ * \param file_name The file to write.
+ * \return \c true in case of success.
+ */
+bool WorldStateHash::start_recording(const std::string& file_name) {
+
+  out.open(file_name.c_str());
+  num_ticks = 0;
+  return static_cast<bool>(out);
+}
+
+/**
+ * \brief Starts comparing the hash of each tick to a recorded file.
+ * \param reference_file_name A file written by start_recording().
+ * \return \c true in case of success.
+ */
+bool WorldStateHash::start_checking(const std::string& reference_file_name) {
+
+  reference.open(reference_file_name.c_str());
+  if (!reference) {
+    return false;
+  }
+  num_ticks = 0;
+  divergence.clear();
+  std::getline(reference, next_reference_line);
+  return true;
+}
+
+/**
+ * \brief Returns whether ticks are being recorded or checked.
+ * \return \c true if add_tick() should be called at each tick.
+ */
+bool WorldStateHash::is_enabled() const {
+  return out.is_open() || (reference.is_open() && divergence.empty());
+}
+
+/**
+ * \brief Records or checks the state of a tick.
+ * \param components The state of the tick returned by compute().
+ * \return \c false if this tick diverges from the reference.
+ * The divergence is then described by get_divergence() and checking stops.
+ */
+bool WorldStateHash::add_tick(const std::vector<Component>& components) {
+
+  const uint64_t tick = num_ticks++;
+  const uint64_t world_hash = get_world_hash(components);
+
+  if (out.is_open()) {
+    out << "tick " << tick << " " << to_hex(world_hash) << std::endl;
+    for (const Component& component: components) {
+      out << to_hex(component.hash) << " " << component.name << std::endl;
+    }
+  }
+
+  if (!reference.is_open() || !divergence.empty()) {
+    return true;
+  }
+
+  uint64_t reference_tick = 0;
+  uint64_t reference_world_hash = 0;
+  std::vector<Component> reference_components;
+  std::ostringstream oss;
+  oss << "World state diverges at tick " << tick << ": ";
+  if (!read_reference_tick(reference_tick, reference_world_hash, reference_components) ||
+      reference_tick != tick) {
+    oss << "the reference has no such tick";
+    divergence = oss.str();
+    return false;
+  }
+
+  if (reference_world_hash == world_hash) {
+    return true;
+  }
+
+  // Find the first part of the state that differs.
+  std::map<std::string, uint64_t> reference_hashes;
+  for (const Component& component: reference_components) {
+    reference_hashes.emplace(component.name, component.hash);
+  }
+  std::string component_name;
+  for (const Component& component: components) {
+    const auto& it = reference_hashes.find(component.name);
+    if (it == reference_hashes.end()) {
+      component_name = component.name + " (not in the reference)";
+      break;
+    }
+    if (it->second != component.hash) {
+      component_name = component.name;
+      break;
+    }
+    reference_hashes.erase(it);
+  }
+  if (component_name.empty()) {
+    component_name = reference_hashes.empty() ?
+        "order of the state" :
+        reference_hashes.begin()->first + " (only in the reference)";
+  }
+
+  oss << component_name;
+  divergence = oss.str();
+  return false;
+}
+
+/**
+ * \brief Returns the first difference found with the reference.
+ * \return A description of the diverging tick and part of the state,
+ * or an empty string.
+ */
+const std::string& WorldStateHash::get_divergence() const {
+  return divergence;
+}
+
+/**
+ * \brief Reads the state of the next tick of the reference file.
+ * \param[out] tick Number of the tick.
+ * \param[out] world_hash Hash of the whole state.
+ * \param[out] components Hash of each part of the state.
+ * \return \c false if the reference has no more ticks.
+ */
+bool WorldStateHash::read_reference_tick(
+    uint64_t& tick,
+    uint64_t& world_hash,
+    std::vector<Component>& components
+) {
+  std::istringstream header(next_reference_line);
+  std::string keyword;
+  if (!(header >> keyword >> tick >> std::hex >> world_hash) || keyword != "tick") {
+    return false;
+  }
+
+  next_reference_line.clear();
+  std::string line;
+  while (std::getline(reference, line)) {
+    if (line.compare(0, 5, "tick ") == 0) {
+      next_reference_line = line;
+      break;
+    }
+    std::istringstream iss(line);
+    Component component;
+    if (iss >> std::hex >> component.hash) {
+      iss.get();  // Space.
+      std::getline(iss, component.name);
+      components.push_back(component);
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Computes the hash of each part of the simulation state.
+ * \param main_loop The main loop.
+ * \return The hashes, in an order that only depends on the simulation.
+ */
+std::vector<WorldStateHash::Component> WorldStateHash::compute(MainLoop& main_loop) {
+
+  std::vector<Component> components;
+  components.push_back(Component{ "random", combine(initial_hash, Random::get_state_hash()) });
+  components.push_back(Component{ "timers", main_loop.get_lua_context().get_timers_hash() });
+
+  Game* game = main_loop.get_game();
+  if (game == nullptr) {
+    return components;
+  }
+  components.push_back(Component{ "savegame", game->get_savegame().get_values_hash() });
+
+  if (!game->has_current_map() || !game->get_current_map().is_loaded()) {
+    return components;
+  }
+  const HeroPtr& hero = game->get_hero();
+  if (hero != nullptr) {
+    components.push_back(Component{ "hero", get_entity_hash(*hero) });
+  }
+  int index = 0;
+  for (const EntityPtr& entity: game->get_current_map().get_entities().get_entities()) {
+    components.push_back(Component{
+        get_entity_component_name(index, *entity),
+        get_entity_hash(*entity)
+    });
+    ++index;
+  }
+  return components;
+}
+
+/**
+ * \brief Combines the hashes of all parts of the state.
+ * \param components Hash of each part of the state.
+ * \return The hash of the whole state.
+ */
+uint64_t WorldStateHash::get_world_hash(const std::vector<Component>& components) {
+
+  uint64_t hash = initial_hash;
+  for (const Component& component: components) {
+    hash = combine(hash, component.hash);
+  }
+  return hash;
+}
+
+/**
+ * \brief Adds an integer to a hash.
+ * \param hash The hash so far.
+ * \param value The value to add.
+ * \return The new hash.
+ */
+uint64_t WorldStateHash::combine(uint64_t hash, uint64_t value) {
+
+  // FNV-1a, byte by byte.
+  for (int i = 0; i < 8; ++i) {
+    hash ^= (value >> (i * 8)) & 0xFF;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * \brief Adds a string to a hash.
+ * \param hash The hash so far.
+ * \param value The value to add.
+ * \return The new hash.
+ */
+uint64_t WorldStateHash::combine(uint64_t hash, const std::string& value) {
+
+  for (char c: value) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  // Also the size, so that consecutive strings cannot be confused.
+  return combine(hash, static_cast<uint64_t>(value.size()));
+}
+
+}
+
@@ -38,11 +38,7 @@ static constexpr short frames[2][12] = {
   {0, 1, 2, 1, 0, 1, 2, 1, 0, 1, 2, 1}, // sequence 0-1-2-1
 };
 
-int AnimatedTilePattern::frame_counter = 0;
-
-int AnimatedTilePattern::current_frames[3] = {0, 0, 0};
-
-uint32_t AnimatedTilePattern::next_frame_date = 0;
+uint32_t AnimatedTilePattern::start_date = 0;
 
 /**
  * \brief Constructor.
@@ -81,41 +77,28 @@ AnimatedTilePattern::AnimatedTilePattern(Ground ground,
  * \brief Initializes the animated tile pattern system.
  */
 void AnimatedTilePattern::initialize() {
-  next_frame_date = System::now();
-  frame_counter = 0;
-  for (int i = 0; i < 3; ++i) {
-    current_frames[i] = 0;
-  }
+  start_date = System::now();
 }
 
 /**
  * \brief Cleans the animated tile pattern system.
  */
 void AnimatedTilePattern::quit() {
-  next_frame_date = 0;
-  frame_counter = 0;
-  for (int i = 0; i < 3; ++i) {
-    current_frames[i] = 0;
-  }
+  start_date = 0;
 }
 
 /**
- * \brief Updates the current frame of all tiles.
+ * \brief Returns the frame of this tile pattern to draw now.
+ *
+ * All animated tiles are synchronized: the frame only depends on the time,
+ * so nothing needs to be updated at each cycle.
  *
- * This function is called repeatedly by the map.
+ * \return The current frame (0 to 2).
  */
-void AnimatedTilePattern::update() {
+int AnimatedTilePattern::get_current_frame() const {
 
-  uint32_t now = System::now();
-
-  while (now >= next_frame_date) {
-
-    frame_counter = (frame_counter + 1) % 12;
-    current_frames[1] = frames[0][frame_counter];
-    current_frames[2] = frames[1][frame_counter];
-
-    next_frame_date += TILE_FRAME_INTERVAL; // the frame changes every 250 ms
-  }
+  const uint32_t frame_counter = ((System::now() - start_date) / TILE_FRAME_INTERVAL) % 12;
+  return frames[sequence - 1][frame_counter];
 }
 
 /**
@@ -133,7 +116,7 @@ void AnimatedTilePattern::draw(
     const Point& viewport
 ) const {
   const SurfacePtr& tileset_image = tileset.get_tiles_image();
-  const Rectangle& src = position_in_tileset[current_frames[sequence]];
+  const Rectangle& src = position_in_tileset[get_current_frame()];
   Point dst = dst_position;
 
   if (parallax) {
@@ -299,6 +299,31 @@ void Camera::set_position_on_screen(const Point& position_on_screen) {
   this->position_on_screen = position_on_screen;
 }
 
+/**
+ * \brief Returns the top-left corner of the visible area to use when
+ * drawing.
+ *
+ * This is the same as get_top_left_xy() unless render interpolation is
+ * enabled.
+ *
+ * \return The interpolated top-left position of the camera on the map.
+ */
+Point Camera::get_interpolated_top_left_xy() const {
+  return get_interpolated_xy() - get_origin();
+}
+
+/**
+ * \brief Returns the visible area of the map to use when drawing.
+ *
+ * This is the same as get_bounding_box() unless render interpolation is
+ * enabled.
+ *
+ * \return The interpolated visible area of the map.
+ */
+Rectangle Camera::get_interpolated_bounding_box() const {
+  return Rectangle(get_interpolated_top_left_xy(), get_size());
+}
+
 /**
  * \brief Returns the position this camera should take to track the specified point.
  * \param tracked_xy A point in map coordinates.
@@ -442,27 +467,20 @@ Rectangle Camera::apply_separators(const Rectangle& area) const {
   // TODO simplify: treat horizontal separators first and then all vertical ones.
   int adjusted_x = x;  // Updated coordinates after applying separators.
   int adjusted_y = y;
-  std::vector<std::shared_ptr<const Separator>> applied_separators;
-  const std::set<std::shared_ptr<const Separator>>& separators =
-      get_entities().get_entities_by_type<Separator>();
-  for (const std::shared_ptr<const Separator>& separator: separators) {
+  std::vector<const Separator*> applied_separators;
+  get_entities().get_separators_crossing(area, applied_separators);
+  for (const Separator* separator: applied_separators) {
 
     if (separator->is_vertical()) {
       // Vertical separator.
       int separation_x = separator->get_x() + 8;
-
-      if (x < separation_x && separation_x < x + width
-          && separator->get_y() < y + height
-          && y < separator->get_y() + separator->get_height()) {
-        int left = separation_x - x;
-        int right = x + width - separation_x;
-        if (left > right) {
-          adjusted_x = separation_x - width;
-        }
-        else {
-          adjusted_x = separation_x;
-        }
-        applied_separators.push_back(separator);
+      int left = separation_x - x;
+      int right = x + width - separation_x;
+      if (left > right) {
+        adjusted_x = separation_x - width;
+      }
+      else {
+        adjusted_x = separation_x;
       }
     }
     else {
@@ -470,18 +488,13 @@ Rectangle Camera::apply_separators(const Rectangle& area) const {
 
       // Horizontal separator.
       int separation_y = separator->get_y() + 8;
-      if (y < separation_y && separation_y < y + height
-          && separator->get_x() < x + width
-          && x < separator->get_x() + separator->get_width()) {
-        int top = separation_y - y;
-        int bottom = y + height - separation_y;
-        if (top > bottom) {
-          adjusted_y = separation_y - height;
-        }
-        else {
-          adjusted_y = separation_y;
-        }
-        applied_separators.push_back(separator);
+      int top = separation_y - y;
+      int bottom = y + height - separation_y;
+      if (top > bottom) {
+        adjusted_y = separation_y - height;
+      }
+      else {
+        adjusted_y = separation_y;
       }
     }
   }  // End for each separator.
@@ -494,7 +507,7 @@ Rectangle Camera::apply_separators(const Rectangle& area) const {
 
     must_adjust_x = false;
     must_adjust_y = false;
-    for (const std::shared_ptr<const Separator>& separator: applied_separators) {
+    for (const Separator* separator: applied_separators) {
 
       if (separator->is_vertical()) {
         // Vertical separator.
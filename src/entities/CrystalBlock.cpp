@@ -178,30 +178,31 @@ bool CrystalBlock::try_jump(Hero& hero, const Rectangle& collision_box,
 }
 
 /**
- * \brief Updates the entity.
+ * \brief Notifies this block that the state of crystals may have changed.
+ *
+ * Blocks do not check the state of the game at each cycle:
+ * this function is called on all of them when a crystal is activated.
+ *
+ * \param orange_raised \c true if the orange blocks are now raised.
  */
-void CrystalBlock::update() {
-
-  const SpritePtr& sprite = get_sprite();
+void CrystalBlock::notify_crystal_state_changed(bool orange_raised) {
 
-  // see if the state has to be changed
-  bool orange_raised = get_game().get_crystal_state();
-  if (orange_raised != this->orange_raised) {
+  if (orange_raised == this->orange_raised) {
+    return;
+  }
 
-    this->orange_raised = orange_raised;
+  this->orange_raised = orange_raised;
 
-    if (sprite != nullptr) {
+  const SpritePtr& sprite = get_sprite();
+  if (sprite != nullptr) {
 
-      if (subtype == ORANGE) {
-        sprite->set_current_animation(orange_raised ? "orange_raised" : "orange_lowered");
-      }
-      else {
-        sprite->set_current_animation(orange_raised ? "blue_lowered" : "blue_raised");
-      }
+    if (subtype == ORANGE) {
+      sprite->set_current_animation(orange_raised ? "orange_raised" : "orange_lowered");
+    }
+    else {
+      sprite->set_current_animation(orange_raised ? "blue_lowered" : "blue_raised");
     }
   }
-
-  Entity::update();
 }
 
 /**
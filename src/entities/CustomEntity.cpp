@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/System.h"
 #include "solarus/entities/CustomEntity.h"
 #include "solarus/entities/Block.h"
 #include "solarus/entities/Bomb.h"
@@ -24,6 +25,7 @@
 #include "solarus/entities/Door.h"
 #include "solarus/entities/Enemy.h"
 #include "solarus/entities/Entities.h"
+#include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/entities/Fire.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/Jumper.h"
@@ -37,6 +39,8 @@
 #include "solarus/graphics/Sprite.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
+#include <algorithm>
+#include <utility>
 
 namespace Solarus {
 
@@ -65,6 +69,10 @@ CustomEntity::CustomEntity(
       name, 0, layer, xy, size
   ),
   model(model),
+  traversable_cache_enabled(false),
+  traversable_by_entities_cache(),
+  can_traverse_entities_cache(),
+  collision_group(),
   ground_observer(false),
   modified_ground(Ground::EMPTY) {
 
@@ -163,7 +171,7 @@ bool CustomEntity::is_traversable_by_entity(Entity& entity) {
     return true;
   }
 
-  return info.is_traversable(*this, entity);
+  return test_traversable(info, entity, traversable_by_entities_cache);
 }
 
 /**
@@ -172,13 +180,14 @@ bool CustomEntity::is_traversable_by_entity(Entity& entity) {
  * This applies to entities that are not overridden by
  * set_traversable_by_entities(EntityType, bool)
  * or
- * set_traversable_by_entities(EntityType, const ScopedLuaRef&).
+ * set_traversable_by_entities(EntityType, ScopedLuaRef).
  *
  * \param traversable \c true to allow other entities to traverse this custom
  * entity.
  */
 void CustomEntity::set_traversable_by_entities(bool traversable) {
 
+  clear_traversable_caches();
   traversable_by_entities_general = TraversableInfo(
       *get_lua_context(),
       traversable
@@ -192,16 +201,17 @@ void CustomEntity::set_traversable_by_entities(bool traversable) {
  * This applies to entities that are not overridden by
  * set_traversable_by_entities(EntityType, bool)
  * or
- * set_traversable_by_entities(EntityType, const ScopedLuaRef&).
+ * set_traversable_by_entities(EntityType, ScopedLuaRef).
  *
  * \param traversable_test_ref Lua ref to a function that will do the test.
  */
 void CustomEntity::set_traversable_by_entities(
-    const ScopedLuaRef& traversable_test_ref
+    ScopedLuaRef traversable_test_ref
 ) {
+  clear_traversable_caches();
   traversable_by_entities_general = TraversableInfo(
       *get_lua_context(),
-      traversable_test_ref
+      std::move(traversable_test_ref)
   );
 }
 
@@ -212,10 +222,11 @@ void CustomEntity::set_traversable_by_entities(
  * This reverts the settings of previous calls to
  * set_traversable_by_entities(bool)
  * and
- * set_traversable_by_entities(const ScopedLuaRef&).
+ * set_traversable_by_entities(ScopedLuaRef).
  */
 void CustomEntity::reset_traversable_by_entities() {
 
+  clear_traversable_caches();
   traversable_by_entities_general = TraversableInfo();
 }
 
@@ -226,7 +237,7 @@ void CustomEntity::reset_traversable_by_entities() {
  * This overrides for a specific type whatever was set by
  * set_traversable_by_entities(bool)
  * or
- * set_traversable_by_entities(const ScopedLuaRef&).
+ * set_traversable_by_entities(ScopedLuaRef).
  *
  * \param type A type of entities.
  * \param traversable \c true to allow other entities to traverse this custom
@@ -235,6 +246,7 @@ void CustomEntity::reset_traversable_by_entities() {
 void CustomEntity::set_traversable_by_entities(
     EntityType type, bool traversable) {
 
+  clear_traversable_caches();
   traversable_by_entities_type[type] = TraversableInfo(
       *get_lua_context(),
       traversable
@@ -248,18 +260,19 @@ void CustomEntity::set_traversable_by_entities(
  * This overrides for a specific type whatever was set by
  * set_traversable_by_entities(bool)
  * or
- * set_traversable_by_entities(const ScopedLuaRef&).
+ * set_traversable_by_entities(ScopedLuaRef).
  *
  * \param type A type of entities.
  * \param traversable_test_ref Lua ref to a function that will do the test.
  */
 void CustomEntity::set_traversable_by_entities(
     EntityType type,
-    const ScopedLuaRef& traversable_test_ref
+    ScopedLuaRef traversable_test_ref
 ) {
+  clear_traversable_caches();
   traversable_by_entities_type[type] = TraversableInfo(
       *get_lua_context(),
-      traversable_test_ref
+      std::move(traversable_test_ref)
   );
 }
 
@@ -270,12 +283,13 @@ void CustomEntity::set_traversable_by_entities(
  * This reverts the settings of previous calls to
  * set_traversable_by_entities(EntityType, bool)
  * and
- * set_traversable_by_entities(EntityType, const ScopedLuaRef&).
+ * set_traversable_by_entities(EntityType, ScopedLuaRef).
  *
  * \param type A type of entities.
  */
 void CustomEntity::reset_traversable_by_entities(EntityType type) {
 
+  clear_traversable_caches();
   traversable_by_entities_type.erase(type);
 }
 
@@ -287,6 +301,70 @@ bool CustomEntity::is_obstacle_for(Entity& other) {
   return !is_traversable_by_entity(other);
 }
 
+/**
+ * \brief Returns whether results of traversable test functions are cached.
+ * \return \c true if the cache is enabled.
+ */
+bool CustomEntity::is_traversable_cache_enabled() const {
+  return traversable_cache_enabled;
+}
+
+/**
+ * \brief Sets whether results of traversable test functions are cached.
+ *
+ * When enabled, the Lua functions set by set_traversable_by_entities()
+ * and set_can_traverse_entities() are called at most once per tick
+ * for each type of entity, and their result is reused for all other
+ * entities of that type during the tick.
+ * Only enable it if the functions don't depend on the other entity
+ * beyond its type.
+ *
+ * \param enabled \c true to enable the cache.
+ */
+void CustomEntity::set_traversable_cache_enabled(bool enabled) {
+
+  traversable_cache_enabled = enabled;
+  clear_traversable_caches();
+}
+
+/**
+ * \brief Tests a traversable property, using the cache if enabled.
+ * \param info A traversable property that is not empty.
+ * \param other_entity The other entity.
+ * \param cache Results of this property by entity type.
+ * \return \c true if traversing is allowed.
+ */
+bool CustomEntity::test_traversable(
+    const TraversableInfo& info,
+    Entity& other_entity,
+    std::vector<TraversableCacheEntry>& cache
+) {
+  if (!traversable_cache_enabled || !info.has_test_function()) {
+    return info.is_traversable(*this, other_entity);
+  }
+
+  if (cache.empty()) {
+    cache.resize(EnumInfoTraits<EntityType>::names.size());
+  }
+  const uint32_t now = System::now();
+  TraversableCacheEntry& entry = cache[static_cast<size_t>(other_entity.get_type())];
+  if (!entry.valid || entry.date != now) {
+    entry.traversable = info.is_traversable(*this, other_entity);
+    entry.date = now;
+    entry.valid = true;
+  }
+  return entry.traversable;
+}
+
+/**
+ * \brief Forgets cached results of traversable test functions.
+ */
+void CustomEntity::clear_traversable_caches() {
+
+  traversable_by_entities_cache.clear();
+  can_traverse_entities_cache.clear();
+}
+
 /**
  * \brief Returns the info about whether this custom entity can traverse a
  * type of entity.
@@ -312,12 +390,13 @@ const CustomEntity::TraversableInfo& CustomEntity::get_can_traverse_entity_info(
  * This applies to entities that are not overridden by
  * set_can_traverse_entities(EntityType, bool)
  * or
- * set_can_traverse_entities(EntityType, const ScopedLuaRef&).
+ * set_can_traverse_entities(EntityType, ScopedLuaRef).
  *
  * \param traversable \c true to allow this entity to traverse other entities.
  */
 void CustomEntity::set_can_traverse_entities(bool traversable) {
 
+  clear_traversable_caches();
   can_traverse_entities_general = TraversableInfo(
       *get_lua_context(),
       traversable
@@ -331,15 +410,16 @@ void CustomEntity::set_can_traverse_entities(bool traversable) {
  * This applies to entities that are not overridden by
  * set_can_traverse_entities(EntityType, bool)
  * or
- * set_can_traverse_entities(EntityType, const ScopedLuaRef&).
+ * set_can_traverse_entities(EntityType, ScopedLuaRef).
  *
  * \param traversable_test_ref Lua ref to a function that will do the test.
  */
-void CustomEntity::set_can_traverse_entities(const ScopedLuaRef& traversable_test_ref) {
+void CustomEntity::set_can_traverse_entities(ScopedLuaRef traversable_test_ref) {
 
+  clear_traversable_caches();
   can_traverse_entities_general = TraversableInfo(
       *get_lua_context(),
-      traversable_test_ref
+      std::move(traversable_test_ref)
   );
 }
 
@@ -350,10 +430,11 @@ void CustomEntity::set_can_traverse_entities(const ScopedLuaRef& traversable_tes
  * This reverts the settings of previous calls to
  * set_can_traverse_entities(bool)
  * and
- * set_can_traverse_entities(const ScopedLuaRef&).
+ * set_can_traverse_entities(ScopedLuaRef).
  */
 void CustomEntity::reset_can_traverse_entities() {
 
+  clear_traversable_caches();
   can_traverse_entities_general = TraversableInfo();
 }
 
@@ -364,7 +445,7 @@ void CustomEntity::reset_can_traverse_entities() {
  * This overrides for a specific type whatever was set by
  * set_can_traverse_entities(bool)
  * or
- * set_can_traverse_entities(const ScopedLuaRef&).
+ * set_can_traverse_entities(ScopedLuaRef).
  *
  * \param type A type of entities.
  * \param traversable \c true to allow this entity to traverse other entities
@@ -375,6 +456,7 @@ void CustomEntity::set_can_traverse_entities(
     bool traversable
 ) {
 
+  clear_traversable_caches();
   can_traverse_entities_type[type] = TraversableInfo(
       *get_lua_context(),
       traversable
@@ -388,19 +470,20 @@ void CustomEntity::set_can_traverse_entities(
  * This overrides for a specific type whatever was set by
  * set_can_traverse_entities(bool)
  * or
- * set_can_traverse_entities(const ScopedLuaRef&).
+ * set_can_traverse_entities(ScopedLuaRef).
  *
  * \param type A type of entities.
  * \param traversable_test_ref Lua ref to a function that will do the test.
  */
 void CustomEntity::set_can_traverse_entities(
     EntityType type,
-    const ScopedLuaRef& traversable_test_ref
+    ScopedLuaRef traversable_test_ref
 ) {
 
+  clear_traversable_caches();
   can_traverse_entities_type[type] = TraversableInfo(
       *get_lua_context(),
-      traversable_test_ref
+      std::move(traversable_test_ref)
   );
 }
 
@@ -410,12 +493,13 @@ void CustomEntity::set_can_traverse_entities(
  callback_ref This reverts the settings of previous calls to
  * set_can_traverse_entities(EntityType, bool)
  * and
- * set_can_traverse_entities(EntityType, const ScopedLuaRef&).
+ * set_can_traverse_entities(EntityType, ScopedLuaRef).
  *
  * \param type A type of entities.
  */
 void CustomEntity::reset_can_traverse_entities(EntityType type) {
 
+  clear_traversable_caches();
   can_traverse_entities_type.erase(type);
 }
 
@@ -426,7 +510,7 @@ bool CustomEntity::is_hero_obstacle(Hero& hero) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(hero.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, hero);
+    return !test_traversable(info, hero, can_traverse_entities_cache);
   }
   return Entity::is_hero_obstacle(hero);
 }
@@ -438,7 +522,7 @@ bool CustomEntity::is_block_obstacle(Block& block) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(block.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, block);
+    return !test_traversable(info, block, can_traverse_entities_cache);
   }
   return Entity::is_block_obstacle(block);
 }
@@ -450,7 +534,7 @@ bool CustomEntity::is_teletransporter_obstacle(Teletransporter& teletransporter)
 
   const TraversableInfo& info = get_can_traverse_entity_info(teletransporter.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, teletransporter);
+    return !test_traversable(info, teletransporter, can_traverse_entities_cache);
   }
   return Entity::is_teletransporter_obstacle(teletransporter);
 }
@@ -462,7 +546,7 @@ bool CustomEntity::is_stream_obstacle(Stream& stream) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(stream.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, stream);
+    return !test_traversable(info, stream, can_traverse_entities_cache);
   }
   return Entity::is_stream_obstacle(stream);
 }
@@ -474,7 +558,7 @@ bool CustomEntity::is_stairs_obstacle(Stairs& stairs) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(stairs.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, stairs);
+    return !test_traversable(info, stairs, can_traverse_entities_cache);
   }
   return Entity::is_stairs_obstacle(stairs);
 }
@@ -486,7 +570,7 @@ bool CustomEntity::is_sensor_obstacle(Sensor& sensor) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(sensor.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, sensor);
+    return !test_traversable(info, sensor, can_traverse_entities_cache);
   }
   return Entity::is_sensor_obstacle(sensor);
 }
@@ -498,7 +582,7 @@ bool CustomEntity::is_switch_obstacle(Switch& sw) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(sw.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, sw);
+    return !test_traversable(info, sw, can_traverse_entities_cache);
   }
   return Entity::is_switch_obstacle(sw);
 }
@@ -510,7 +594,7 @@ bool CustomEntity::is_raised_block_obstacle(CrystalBlock& raised_block) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(raised_block.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, raised_block);
+    return !test_traversable(info, raised_block, can_traverse_entities_cache);
   }
   return Entity::is_raised_block_obstacle(raised_block);
 }
@@ -522,7 +606,7 @@ bool CustomEntity::is_crystal_obstacle(Crystal& crystal) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(crystal.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, crystal);
+    return !test_traversable(info, crystal, can_traverse_entities_cache);
   }
   return Entity::is_crystal_obstacle(crystal);
 }
@@ -534,7 +618,7 @@ bool CustomEntity::is_npc_obstacle(Npc& npc) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(npc.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, npc);
+    return !test_traversable(info, npc, can_traverse_entities_cache);
   }
   return Entity::is_npc_obstacle(npc);
 }
@@ -550,7 +634,7 @@ bool CustomEntity::is_door_obstacle(Door& door) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(door.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, door);
+    return !test_traversable(info, door, can_traverse_entities_cache);
   }
   return Entity::is_door_obstacle(door);
 }
@@ -562,7 +646,7 @@ bool CustomEntity::is_enemy_obstacle(Enemy& enemy) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(enemy.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, enemy);
+    return !test_traversable(info, enemy, can_traverse_entities_cache);
   }
   return Entity::is_enemy_obstacle(enemy);
 }
@@ -574,7 +658,7 @@ bool CustomEntity::is_jumper_obstacle(Jumper& jumper, const Rectangle& candidate
 
   const TraversableInfo& info = get_can_traverse_entity_info(jumper.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, jumper);
+    return !test_traversable(info, jumper, can_traverse_entities_cache);
   }
   return Entity::is_jumper_obstacle(jumper, candidate_position);
 }
@@ -586,7 +670,7 @@ bool CustomEntity::is_destructible_obstacle(Destructible& destructible) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(destructible.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, destructible);
+    return !test_traversable(info, destructible, can_traverse_entities_cache);
   }
   return Entity::is_destructible_obstacle(destructible);
 }
@@ -598,7 +682,7 @@ bool CustomEntity::is_separator_obstacle(Separator& separator) {
 
   const TraversableInfo& info = get_can_traverse_entity_info(separator.get_type());
   if (!info.is_empty()) {
-    return !info.is_traversable(*this, separator);
+    return !test_traversable(info, separator, can_traverse_entities_cache);
   }
   return Entity::is_separator_obstacle(separator);
 }
@@ -769,16 +853,16 @@ bool CustomEntity::is_ladder_obstacle() const {
  */
 void CustomEntity::add_collision_test(
     CollisionMode collision_test,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   Debug::check_assertion(collision_test != COLLISION_NONE, "Invalid collision mode");
   Debug::check_assertion(!callback_ref.is_empty(), "Missing collision callback");
 
-  collision_tests.emplace_back(
+  collision_tests.push_back(std::make_shared<CollisionInfo>(
       *get_lua_context(),
       collision_test,
-      callback_ref
-  );
+      std::move(callback_ref)
+  ));
 
   check_collision_with_detectors();
 }
@@ -791,18 +875,49 @@ void CustomEntity::add_collision_test(
  * detected.
  */
 void CustomEntity::add_collision_test(
-    const ScopedLuaRef& collision_test_ref,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef collision_test_ref,
+    ScopedLuaRef callback_ref
 ) {
   Debug::check_assertion(!callback_ref.is_empty(), "Missing collision callback");
 
   add_collision_mode(COLLISION_CUSTOM);
 
-  collision_tests.emplace_back(
+  collision_tests.push_back(std::make_shared<CollisionInfo>(
       *get_lua_context(),
-      collision_test_ref,
-      callback_ref
-  );
+      std::move(collision_test_ref),
+      std::move(callback_ref)
+  ));
+
+  check_collision_with_detectors();
+}
+
+/**
+ * \brief Registers a function to be called when the specified rules detect a
+ * collision.
+ *
+ * Rules are evaluated without calling Lua, which is much faster than
+ * a custom Lua collision test.
+ *
+ * \param collision_rules The conditions of a collision.
+ * \param callback_ref Lua ref to a function to call when this collision is
+ * detected.
+ */
+void CustomEntity::add_collision_test(
+    const CollisionRules& collision_rules,
+    ScopedLuaRef callback_ref
+) {
+  Debug::check_assertion(!callback_ref.is_empty(), "Missing collision callback");
+  Debug::check_assertion(collision_rules.mode != COLLISION_SPRITE &&
+      collision_rules.mode != COLLISION_CUSTOM,
+      "Invalid collision mode for collision rules");
+
+  add_collision_mode(COLLISION_CUSTOM);
+
+  collision_tests.push_back(std::make_shared<CollisionInfo>(
+      *get_lua_context(),
+      collision_rules,
+      std::move(callback_ref)
+  ));
 
   check_collision_with_detectors();
 }
@@ -817,6 +932,109 @@ void CustomEntity::clear_collision_tests() {
   set_collision_modes(COLLISION_FACING);
 }
 
+/**
+ * \brief Returns the collision group of this custom entity.
+ * \return The collision group or an empty string.
+ */
+const std::string& CustomEntity::get_collision_group() const {
+  return collision_group;
+}
+
+/**
+ * \brief Sets the collision group of this custom entity.
+ *
+ * Collision rules can ignore custom entities of the same group,
+ * for example bullets of the same pattern.
+ *
+ * \param collision_group The collision group or an empty string.
+ */
+void CustomEntity::set_collision_group(const std::string& collision_group) {
+  this->collision_group = collision_group;
+}
+
+/**
+ * \brief Performs a built-in collision test with another entity.
+ * \param collision_mode A built-in collision test, or COLLISION_NONE
+ * to always succeed.
+ * \param entity The other entity.
+ * \return \c true if there is a collision.
+ */
+bool CustomEntity::test_collision_built_in(CollisionMode collision_mode, Entity& entity) {
+
+  switch (collision_mode) {
+
+    case COLLISION_NONE:
+      return true;
+
+    case COLLISION_OVERLAPPING:
+      return test_collision_rectangle(entity);
+
+    case COLLISION_CONTAINING:
+      return test_collision_inside(entity);
+
+    case COLLISION_ORIGIN:
+      return test_collision_origin_point(entity);
+
+    case COLLISION_FACING:
+      return test_collision_facing_point(entity);
+
+    case COLLISION_TOUCHING:
+      return test_collision_touching(entity);
+
+    case COLLISION_CENTER:
+      return test_collision_center(entity);
+
+    case COLLISION_CUSTOM:
+    case COLLISION_SPRITE:
+      // Not handled here.
+      break;
+  }
+  return false;
+}
+
+/**
+ * \brief Evaluates collision rules with another entity.
+ * \param rules The rules to check.
+ * \param entity The other entity.
+ * \return \c true if all conditions of the rules are met.
+ */
+bool CustomEntity::test_collision_rules(const CollisionRules& rules, Entity& entity) {
+
+  if (!rules.entity_types.empty() &&
+      rules.entity_types.find(entity.get_type()) == rules.entity_types.end()) {
+    return false;
+  }
+
+  if (rules.same_layer && entity.get_layer() != get_layer()) {
+    return false;
+  }
+
+  if (rules.has_layer && entity.get_layer() != rules.layer) {
+    return false;
+  }
+
+  if (rules.ignore_same_group &&
+      !collision_group.empty() &&
+      entity.get_type() == EntityType::CUSTOM &&
+      static_cast<CustomEntity&>(entity).get_collision_group() == collision_group) {
+    return false;
+  }
+
+  if (rules.has_rectangle) {
+    Rectangle rectangle = rules.rectangle;
+    rectangle.add_xy(get_xy());
+    if (!entity.get_bounding_box().overlaps(rectangle)) {
+      return false;
+    }
+  }
+
+  if (rules.mode == COLLISION_NONE && !rules.has_rectangle) {
+    // No geometric condition: use the bounding boxes.
+    return test_collision_rectangle(entity);
+  }
+  return test_collision_built_in(rules.mode, entity);
+}
+
 /**
  * \copydoc Entity::test_collision_custom
  */
@@ -829,59 +1047,42 @@ bool CustomEntity::test_collision_custom(Entity& entity) {
 
   bool collision = false;
 
-  const std::vector<CollisionInfo> collision_tests = this->collision_tests;
-  for (const CollisionInfo& info: collision_tests) {
+  // Lua collision tests may change the list: iterate on a copy in this case.
+  const bool lua_tests = std::any_of(
+      this->collision_tests.begin(),
+      this->collision_tests.end(),
+      [](const std::shared_ptr<const CollisionInfo>& info) {
+    return info->get_built_in_test() == COLLISION_CUSTOM && !info->has_rules();
+  });
+  std::vector<std::shared_ptr<const CollisionInfo>> collision_tests_copy;
+  if (lua_tests) {
+    collision_tests_copy = this->collision_tests;
+  }
+  const std::vector<std::shared_ptr<const CollisionInfo>>& collision_tests =
+      lua_tests ? collision_tests_copy : this->collision_tests;
+  for (const std::shared_ptr<const CollisionInfo>& info_ptr: collision_tests) {
+
+    const CollisionInfo& info = *info_ptr;
 
+    bool detected = false;
     switch (info.get_built_in_test()) {
 
       case COLLISION_OVERLAPPING:
-        if (test_collision_rectangle(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
-        break;
-
       case COLLISION_CONTAINING:
-        if (test_collision_inside(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
-        break;
-
       case COLLISION_ORIGIN:
-        if (test_collision_origin_point(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
-        break;
-
       case COLLISION_FACING:
-        if (test_collision_facing_point(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
-        break;
-
       case COLLISION_TOUCHING:
-        if (test_collision_touching(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
-        break;
-
       case COLLISION_CENTER:
-        if (test_collision_center(entity)) {
-          collision = true;
-          successful_collision_tests.push_back(info);
-        }
+        detected = test_collision_built_in(info.get_built_in_test(), entity);
         break;
 
       case COLLISION_CUSTOM:
-        if (get_lua_context()->do_custom_entity_collision_test_function(
-              info.get_custom_test_ref(), *this, entity)
-        ) {
-          collision = true;
-          successful_collision_tests.push_back(info);
+        if (info.has_rules()) {
+          detected = test_collision_rules(info.get_rules(), entity);
+        }
+        else {
+          detected = get_lua_context()->do_custom_entity_collision_test_function(
+              info.get_custom_test_ref(), *this, entity);
         }
         break;
 
@@ -893,6 +1094,11 @@ bool CustomEntity::test_collision_custom(Entity& entity) {
         Debug::die("Invalid collision mode");
         break;
     }
+
+    if (detected) {
+      collision = true;
+      successful_collision_tests.push_back(info_ptr);
+    }
   }
 
   return collision;
@@ -918,9 +1124,9 @@ void CustomEntity::notify_collision(Entity& entity_overlapping, CollisionMode co
       "Unexpected collision mode");
 
   // There is a collision: execute the callbacks.
-  for (const CollisionInfo& info: successful_collision_tests) {
+  for (const std::shared_ptr<const CollisionInfo>& info: successful_collision_tests) {
     get_lua_context()->do_custom_entity_collision_callback(
-        info.get_callback_ref(), *this, entity_overlapping
+        info->get_callback_ref(), *this, entity_overlapping
     );
   }
 
@@ -936,13 +1142,13 @@ void CustomEntity::notify_collision(
     Sprite& other_sprite
 ) {
   // A collision was detected with a sprite of another entity.
-  const std::vector<CollisionInfo> collision_tests = this->collision_tests;
-  for (const CollisionInfo& info: collision_tests) {
+  const std::vector<std::shared_ptr<const CollisionInfo>> collision_tests = this->collision_tests;
+  for (const std::shared_ptr<const CollisionInfo>& info: collision_tests) {
 
-    if (info.get_built_in_test() == COLLISION_SPRITE) {
+    if (info->get_built_in_test() == COLLISION_SPRITE) {
       // Execute the callback.
       get_lua_context()->do_custom_entity_collision_callback(
-          info.get_callback_ref(),
+          info->get_callback_ref(),
           *this,
           other_entity,
           this_sprite,
@@ -1308,10 +1514,10 @@ CustomEntity::TraversableInfo::TraversableInfo(
  */
 CustomEntity::TraversableInfo::TraversableInfo(
     LuaContext& lua_context,
-    const ScopedLuaRef& traversable_test_ref
+    ScopedLuaRef traversable_test_ref
 ):
     lua_context(&lua_context),
-    traversable_test_ref(traversable_test_ref),
+    traversable_test_ref(std::move(traversable_test_ref)),
     traversable(false) {
 
 }
@@ -1325,6 +1531,15 @@ bool CustomEntity::TraversableInfo::is_empty() const {
   return lua_context == nullptr;
 }
 
+/**
+ * \brief Returns whether this traversable property is a Lua function.
+ * \return \c true if a Lua function decides.
+ */
+bool CustomEntity::TraversableInfo::has_test_function() const {
+
+  return !traversable_test_ref.is_empty();
+}
+
 /**
  * \brief Tests this traversable property with the specified other entity.
  *
@@ -1359,6 +1574,8 @@ CustomEntity::CollisionInfo::CollisionInfo():
     lua_context(nullptr),
     built_in_test(COLLISION_NONE),
     custom_test_ref(),
+    rules_set(false),
+    rules(),
     callback_ref() {
 
 }
@@ -1373,14 +1590,16 @@ CustomEntity::CollisionInfo::CollisionInfo():
 CustomEntity::CollisionInfo::CollisionInfo(
     LuaContext& lua_context,
     CollisionMode built_in_test,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ):
     lua_context(&lua_context),
     built_in_test(built_in_test),
     custom_test_ref(),
-    callback_ref(callback_ref) {
+    rules_set(false),
+    rules(),
+    callback_ref(std::move(callback_ref)) {
 
-  Debug::check_assertion(!callback_ref.is_empty(), "Missing callback ref");
+  Debug::check_assertion(!this->callback_ref.is_empty(), "Missing callback ref");
 }
 
 /**
@@ -1392,15 +1611,39 @@ CustomEntity::CollisionInfo::CollisionInfo(
  */
 CustomEntity::CollisionInfo::CollisionInfo(
     LuaContext& lua_context,
-    const ScopedLuaRef& custom_test_ref,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef custom_test_ref,
+    ScopedLuaRef callback_ref
 ):
     lua_context(&lua_context),
     built_in_test(COLLISION_CUSTOM),
-    custom_test_ref(custom_test_ref),
-    callback_ref(callback_ref) {
+    custom_test_ref(std::move(custom_test_ref)),
+    rules_set(false),
+    rules(),
+    callback_ref(std::move(callback_ref)) {
 
-  Debug::check_assertion(!callback_ref.is_empty(), "Missing callback ref");
+  Debug::check_assertion(!this->callback_ref.is_empty(), "Missing callback ref");
+}
+
+/**
+ * \brief Creates a collision test info evaluated natively.
+ * \param lua_context The Lua context.
+ * \param rules The conditions of a collision.
+ * \param callback_ref Lua ref to a function to call when this collision is
+ * detected.
+ */
+CustomEntity::CollisionInfo::CollisionInfo(
+    LuaContext& lua_context,
+    const CollisionRules& rules,
+    ScopedLuaRef callback_ref
+):
+    lua_context(&lua_context),
+    built_in_test(COLLISION_CUSTOM),
+    custom_test_ref(),
+    rules_set(true),
+    rules(rules),
+    callback_ref(std::move(callback_ref)) {
+
+  Debug::check_assertion(!this->callback_ref.is_empty(), "Missing callback ref");
 }
 
 /**
@@ -1421,6 +1664,22 @@ const ScopedLuaRef& CustomEntity::CollisionInfo::get_custom_test_ref() const {
   return custom_test_ref;
 }
 
+/**
+ * \brief Returns whether this collision test is given by rules.
+ * \return \c true if get_rules() decides instead of a Lua function.
+ */
+bool CustomEntity::CollisionInfo::has_rules() const {
+  return rules_set;
+}
+
+/**
+ * \brief Returns the rules of this collision test.
+ * \return The rules. Only meaningful if has_rules() is \c true.
+ */
+const CustomEntity::CollisionRules& CustomEntity::CollisionInfo::get_rules() const {
+  return rules;
+}
+
 /**
  * \brief Returns the function to call when the collision is detected.
  * \return A Lua ref to the callback.
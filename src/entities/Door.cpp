@@ -80,7 +80,9 @@ Door::Door(Game& game,
   cannot_open_dialog_id(),
   state(OPEN),
   initialized(false),
-  next_hint_sound_date(0) {
+  next_hint_sound_date(0),
+  savegame_watcher(nullptr),
+  savegame_state_outdated(false) {
 
   set_collision_modes(CollisionMode::COLLISION_FACING | CollisionMode::COLLISION_SPRITE);
 
@@ -90,7 +92,15 @@ Door::Door(Game& game,
   set_direction(direction);
 
   if (is_saved()) {
-    set_open(game.get_savegame().get_boolean(savegame_variable));
+    Savegame& savegame = game.get_savegame();
+    set_open(savegame.get_boolean(savegame_variable));
+
+    // Follow changes made by scripts instead of polling the savegame.
+    savegame_watcher = std::make_shared<Savegame::ValueWatcher>([this](const Savegame::Key&) {
+      savegame_state_outdated = true;
+      return true;
+    });
+    savegame.add_value_watcher(Savegame::get_key(savegame_variable), savegame_watcher);
   }
   else {
     set_open(false);
@@ -529,7 +539,8 @@ void Door::update() {
     set_open(is_opening());
   }
 
-  if (is_saved() && !is_changing()) {
+  if (savegame_state_outdated && !is_changing()) {
+    savegame_state_outdated = false;
     bool open_in_savegame = get_savegame().get_boolean(savegame_variable);
     if (open_in_savegame && is_closed()) {
       set_opening();
@@ -46,8 +46,9 @@ DynamicTile::DynamicTile(
 ) :
   Entity(name, 0, layer, xy, size),
   tile_pattern_id(tile_pattern_id),
-  tile_pattern(tileset.get_tile_pattern(tile_pattern_id)),
-  tileset(tileset) {
+  tile_pattern_index(Tileset::get_tile_pattern_index(tile_pattern_id)),
+  tile_pattern(&tileset.get_tile_pattern(tile_pattern_index)),
+  tileset(&tileset) {
 
   set_enabled(enabled);
 }
@@ -74,14 +75,14 @@ const std::string& DynamicTile::get_tile_pattern_id() const {
  * \return The ground defined by this entity.
  */
 Ground DynamicTile::get_modified_ground() const {
-  return tile_pattern.get_ground();
+  return tile_pattern->get_ground();
 }
 
 /**
  * \copydoc Entity::is_drawn_at_its_position()
  */
 bool DynamicTile::is_drawn_at_its_position() const {
-  return tile_pattern.is_drawn_at_its_position();
+  return tile_pattern->is_drawn_at_its_position();
 }
 
 /**
@@ -89,23 +90,39 @@ bool DynamicTile::is_drawn_at_its_position() const {
  */
 void DynamicTile::draw_on_map() {
 
-  const CameraPtr& camera = get_map().get_camera();
+  const CameraPtr& camera = get_map().get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
-  const Rectangle& camera_position = camera->get_bounding_box();
+  const Rectangle& camera_position = camera->get_interpolated_bounding_box();
 
   Rectangle dst_position(get_top_left_x() - camera_position.get_x(),
       get_top_left_y() - camera_position.get_y(),
       get_width(), get_height());
 
-  tile_pattern.fill_surface(
+  tile_pattern->fill_surface(
       get_map().get_camera_surface(),
       dst_position,
-      tileset,
+      *tileset,
       camera_position.get_xy()
   );
 }
 
+/**
+ * \brief Makes this tile use another tileset if it uses the one replaced.
+ * \param old_tileset The tileset being replaced.
+ * \param new_tileset The tileset replacing it.
+ * \param same_patterns \c true to keep the current pattern object.
+ */
+void DynamicTile::switch_tileset(
+    const Tileset& old_tileset,
+    const Tileset& new_tileset,
+    bool same_patterns
+) {
+  Tileset::switch_tile(
+      old_tileset, new_tileset, same_patterns, tile_pattern_index, tileset, tile_pattern
+  );
+}
+
 }
 
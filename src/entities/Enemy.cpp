@@ -40,6 +40,7 @@
 #include "solarus/movements/FallingHeight.h"
 #include "solarus/movements/StraightMovement.h"
 #include <memory>
+#include <utility>
 
 namespace Solarus {
 
@@ -54,6 +55,8 @@ const std::map<EnemyAttack, std::string> Enemy::attack_names = {
     { EnemyAttack::SCRIPT, "script" }
 };
 
+constexpr size_t Enemy::num_attacks;
+
 const std::map<Enemy::HurtStyle, std::string> Enemy::hurt_style_names = {
     { HurtStyle::NORMAL, "normal" },
     { HurtStyle::MONSTER, "monster" },
@@ -92,6 +95,7 @@ Enemy::Enemy(
   push_hero_on_sword(false),
   can_hurt_hero_running(false),
   minimum_shield_needed(0),
+  attack_reactions(),
   savegame_variable(),
   traversable(true),
   attacking_collision_mode(CollisionMode::COLLISION_SPRITE),
@@ -211,6 +215,7 @@ void Enemy::notify_created() {
   Entity::notify_created();
 
   // At this point, enemy:on_created() was called.
+  share_attack_reactions();
   enable_pixel_collisions();
 
   // Give sprites their initial direction.
@@ -644,16 +649,125 @@ void Enemy::set_minimum_shield_needed(int minimum_shield_needed) {
  * a pixel-precise collision test
  * \return the corresponding reaction
  */
-EnemyReaction::Reaction Enemy::get_attack_consequence(
+const EnemyReaction::Reaction& Enemy::get_attack_consequence(
     EnemyAttack attack,
     const Sprite* this_sprite) const {
 
-  const auto& it = attack_reactions.find(attack);
-  if (it == attack_reactions.end()) {
-    // Attack consequence was not initialized. Return a default value.
-    return EnemyReaction::Reaction();
+  if (attack_reactions == nullptr) {
+    // Attack consequences were not initialized. Return a default value.
+    static const EnemyReaction::Reaction default_reaction;
+    return default_reaction;
+  }
+  return (*attack_reactions)[static_cast<size_t>(attack)].get_reaction(this_sprite);
+}
+
+/**
+ * \brief Returns the reaction to an attack, ready to be modified.
+ *
+ * The reactions of this enemy are copied first if they are shared
+ * with other enemies.
+ *
+ * \param attack An attack.
+ * \return The reaction of this enemy to this attack.
+ */
+EnemyReaction& Enemy::get_attack_reaction_to_modify(EnemyAttack attack) {
+
+  if (attack_reactions == nullptr) {
+    attack_reactions = std::make_shared<AttackReactions>();
   }
-  return it->second.get_reaction(this_sprite);
+  else if (attack_reactions.use_count() > 1) {
+    // Shared tables are always shareable: they can be copied.
+    std::shared_ptr<AttackReactions> copy = std::make_shared<AttackReactions>();
+    for (size_t i = 0; i < num_attacks; ++i) {
+      (*copy)[i].copy_shareable((*attack_reactions)[i]);
+    }
+    attack_reactions = copy;
+  }
+  return (*attack_reactions)[static_cast<size_t>(attack)];
+}
+
+/**
+ * \brief Returns the reactions of enemies created with the default
+ * attack consequences.
+ * \return The default reactions, shared by all these enemies.
+ */
+const std::shared_ptr<Enemy::AttackReactions>& Enemy::get_default_attack_reactions() {
+
+  static const std::shared_ptr<AttackReactions> default_reactions = [] {
+    std::shared_ptr<AttackReactions> reactions = std::make_shared<AttackReactions>();
+    const auto set_reaction = [&](EnemyAttack attack, EnemyReaction::ReactionType reaction, int life_lost) {
+      (*reactions)[static_cast<size_t>(attack)].set_general_reaction(reaction, life_lost);
+    };
+    set_reaction(EnemyAttack::SWORD, EnemyReaction::ReactionType::HURT, 1); // multiplied by the sword strength
+    set_reaction(EnemyAttack::THROWN_ITEM, EnemyReaction::ReactionType::HURT, 1); // multiplied depending on the item
+    set_reaction(EnemyAttack::EXPLOSION, EnemyReaction::ReactionType::HURT, 2);
+    set_reaction(EnemyAttack::ARROW, EnemyReaction::ReactionType::HURT, 2);
+    set_reaction(EnemyAttack::HOOKSHOT, EnemyReaction::ReactionType::IMMOBILIZED, 0);
+    set_reaction(EnemyAttack::BOOMERANG, EnemyReaction::ReactionType::IMMOBILIZED, 0);
+    set_reaction(EnemyAttack::FIRE, EnemyReaction::ReactionType::HURT, 3);
+    return reactions;
+  }();
+  return default_reactions;
+}
+
+/**
+ * \brief Returns the last shareable reactions set by each breed.
+ *
+ * Each thread has its own tables since enemies of different simulations
+ * never share them.
+ *
+ * \return The reactions of each breed.
+ */
+std::map<std::string, std::weak_ptr<Enemy::AttackReactions>>& Enemy::get_breed_attack_reactions() {
+
+  static thread_local std::map<std::string, std::weak_ptr<AttackReactions>> breed_reactions;
+  return breed_reactions;
+}
+
+/**
+ * \brief Returns whether a table of reactions can be shared by several enemies.
+ * \param reactions The reactions of an enemy.
+ * \return \c true if no reaction depends on a sprite or a Lua function.
+ */
+bool Enemy::is_shareable(const AttackReactions& reactions) {
+
+  for (const EnemyReaction& reaction: reactions) {
+    if (!reaction.is_shareable()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Shares the attack reactions of this enemy with previous enemies
+ * of the same breed that react in the same way.
+ *
+ * This is done once the breed script has set the attack consequences,
+ * so that many enemies of a breed use a single table.
+ */
+void Enemy::share_attack_reactions() {
+
+  if (attack_reactions == nullptr ||
+      attack_reactions == get_default_attack_reactions() ||
+      !is_shareable(*attack_reactions)) {
+    return;
+  }
+
+  std::weak_ptr<AttackReactions>& breed_reactions = get_breed_attack_reactions()[breed];
+  const std::shared_ptr<AttackReactions> previous_reactions = breed_reactions.lock();
+  if (previous_reactions != nullptr && is_shareable(*previous_reactions)) {
+    // The previous enemy may have modified its table since.
+    bool same_reactions = true;
+    for (size_t i = 0; i < num_attacks && same_reactions; ++i) {
+      same_reactions = (*attack_reactions)[i].has_same_reaction((*previous_reactions)[i]);
+    }
+    if (same_reactions) {
+      attack_reactions = previous_reactions;
+      return;
+    }
+  }
+  breed_reactions = attack_reactions;
 }
 
 /**
@@ -670,9 +784,9 @@ void Enemy::set_attack_consequence(
     EnemyAttack attack,
     EnemyReaction::ReactionType reaction,
     int life_lost,
-    const ScopedLuaRef& callback) {
+    ScopedLuaRef callback) {
 
-  attack_reactions[attack].set_general_reaction(reaction, life_lost, callback);
+  get_attack_reaction_to_modify(attack).set_general_reaction(reaction, life_lost, std::move(callback));
 }
 
 /**
@@ -687,9 +801,9 @@ void Enemy::set_attack_consequence_sprite(
     EnemyAttack attack,
     EnemyReaction::ReactionType reaction,
     int life_lost,
-    const ScopedLuaRef& callback) {
+    ScopedLuaRef callback) {
 
-  attack_reactions[attack].set_sprite_reaction(&sprite, reaction, life_lost, callback);
+  get_attack_reaction_to_modify(attack).set_sprite_reaction(&sprite, reaction, life_lost, std::move(callback));
 }
 
 /**
@@ -719,17 +833,7 @@ void Enemy::set_no_attack_consequences_sprite(const Sprite& sprite) {
  */
 void Enemy::set_default_attack_consequences() {
 
-  for (const auto& kvp : attack_names) {
-    EnemyAttack attack = kvp.first;
-    attack_reactions[attack].set_default_reaction();
-  }
-  set_attack_consequence(EnemyAttack::SWORD, EnemyReaction::ReactionType::HURT, 1); // multiplied by the sword strength
-  set_attack_consequence(EnemyAttack::THROWN_ITEM, EnemyReaction::ReactionType::HURT, 1); // multiplied depending on the item
-  set_attack_consequence(EnemyAttack::EXPLOSION, EnemyReaction::ReactionType::HURT, 2);
-  set_attack_consequence(EnemyAttack::ARROW, EnemyReaction::ReactionType::HURT, 2);
-  set_attack_consequence(EnemyAttack::HOOKSHOT, EnemyReaction::ReactionType::IMMOBILIZED);
-  set_attack_consequence(EnemyAttack::BOOMERANG, EnemyReaction::ReactionType::IMMOBILIZED);
-  set_attack_consequence(EnemyAttack::FIRE, EnemyReaction::ReactionType::HURT, 3);
+  attack_reactions = get_default_attack_reactions();
 }
 
 /**
@@ -1187,7 +1291,11 @@ bool Enemy::is_invulnerable() const {
  */
 void Enemy::try_hurt(EnemyAttack attack, Entity& source, Sprite* this_sprite) {
 
-  EnemyReaction::Reaction reaction = get_attack_consequence(attack, this_sprite);
+  // Copy the reaction without its callback since it is modified below.
+  const EnemyReaction::Reaction& attack_consequence = get_attack_consequence(attack, this_sprite);
+  EnemyReaction::Reaction reaction;
+  reaction.type = attack_consequence.type;
+  reaction.life_lost = attack_consequence.life_lost;
   if (invulnerable || reaction.type == EnemyReaction::ReactionType::IGNORED) {
     // ignore the attack
     return;
@@ -1231,7 +1339,7 @@ void Enemy::try_hurt(EnemyAttack attack, Entity& source, Sprite* this_sprite) {
   case EnemyReaction::ReactionType::LUA_CALLBACK:
     // Lua callback.
     if (is_in_normal_state()) {
-      reaction.callback.call("Enemy reaction callback");
+      attack_consequence.callback.call("Enemy reaction callback");
     }
     else {
       // no attack was made: notify the source correctly
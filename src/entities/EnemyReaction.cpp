@@ -18,6 +18,7 @@
 #include "solarus/entities/EnemyReaction.h"
 #include "solarus/graphics/Sprite.h"
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -34,7 +35,9 @@ const EnumInfo<EnemyReaction::ReactionType>::names_type EnumInfoTraits<EnemyReac
 /**
  * \brief Constructor.
  */
-EnemyReaction::EnemyReaction() {
+EnemyReaction::EnemyReaction():
+  general_reaction(),
+  sprite_reactions() {
 
   set_default_reaction();
 }
@@ -56,7 +59,7 @@ void EnemyReaction::set_default_reaction() {
  * \param life_lost Number of life points to remove (only for reaction HURT).
  * \param callback Lua function to call (only for reaction LUA_CALLBACK).
  */
-void EnemyReaction::set_general_reaction(ReactionType reaction, int life_lost, const ScopedLuaRef& callback) {
+void EnemyReaction::set_general_reaction(ReactionType reaction, int life_lost, ScopedLuaRef callback) {
 
   general_reaction.type = reaction;
   if (reaction == ReactionType::HURT) {
@@ -69,7 +72,7 @@ void EnemyReaction::set_general_reaction(ReactionType reaction, int life_lost, c
   }
   else if (reaction == ReactionType::LUA_CALLBACK) {
     Debug::check_assertion(!callback.is_empty(), "Missing enemy reaction callback");
-    general_reaction.callback = callback;
+    general_reaction.callback = std::move(callback);
   }
 }
 
@@ -80,28 +83,45 @@ void EnemyReaction::set_general_reaction(ReactionType reaction, int life_lost, c
  * \param life_lost Number of life points to remove (only for reaction HURT).
  * \param callback Lua function to call (only for reaction LUA_CALLBACK).
  */
-void EnemyReaction::set_sprite_reaction(const Sprite* sprite, ReactionType reaction, int life_lost, const ScopedLuaRef& callback) {
+void EnemyReaction::set_sprite_reaction(const Sprite* sprite, ReactionType reaction, int life_lost, ScopedLuaRef callback) {
 
   if (sprite == nullptr) {
     set_general_reaction(reaction, life_lost);
   }
   else {
-    sprite_reactions[sprite].type = reaction;
+    Reaction& sprite_reaction = get_sprite_reaction(sprite);
+    sprite_reaction.type = reaction;
     if (reaction == ReactionType::HURT) {
       if (life_lost < 0) {
         std::ostringstream oss;
         oss << "Invalid amount of life: " << life_lost;
         Debug::die(oss.str());
       }
-      sprite_reactions[sprite].life_lost = life_lost;
+      sprite_reaction.life_lost = life_lost;
     }
     else if (reaction == ReactionType::LUA_CALLBACK) {
       Debug::check_assertion(!callback.is_empty(), "Missing enemy reaction callback");
-      sprite_reactions[sprite].callback = callback;
+      sprite_reaction.callback = std::move(callback);
     }
   }
 }
 
+/**
+ * \brief Returns the specific reaction of a sprite, creating it if needed.
+ * \param sprite A sprite of the enemy.
+ * \return The reaction of this sprite.
+ */
+EnemyReaction::Reaction& EnemyReaction::get_sprite_reaction(const Sprite* sprite) {
+
+  for (auto& kvp: sprite_reactions) {
+    if (kvp.first == sprite) {
+      return kvp.second;
+    }
+  }
+  sprite_reactions.emplace_back(sprite, Reaction());
+  return sprite_reactions.back().second;
+}
+
 /**
  * \brief Returns the reaction to an attack on a sprite.
  * \param sprite the sprite that receives the attack
@@ -111,12 +131,52 @@ const EnemyReaction::Reaction& EnemyReaction::get_reaction(
     const Sprite* sprite) const {
 
   if (sprite != nullptr) {
-    auto it = sprite_reactions.find(sprite);
-    if (it != sprite_reactions.end()) {
-      return it->second;
+    for (const auto& kvp: sprite_reactions) {
+      if (kvp.first == sprite) {
+        return kvp.second;
+      }
     }
   }
   return general_reaction;
 }
 
+/**
+ * \brief Returns whether this reaction can be shared by several enemies.
+ *
+ * This is the case if it does not depend on sprites or Lua functions of
+ * a particular enemy.
+ *
+ * \return \c true if this reaction is shareable.
+ */
+bool EnemyReaction::is_shareable() const {
+
+  return sprite_reactions.empty() &&
+      general_reaction.type != ReactionType::LUA_CALLBACK;
+}
+
+/**
+ * \brief Returns whether two shareable reactions are the same.
+ * \param other Another shareable reaction.
+ * \return \c true if they react in the same way.
+ */
+bool EnemyReaction::has_same_reaction(const EnemyReaction& other) const {
+
+  return general_reaction.type == other.general_reaction.type &&
+      general_reaction.life_lost == other.general_reaction.life_lost;
+}
+
+/**
+ * \brief Makes this reaction a copy of a shareable one.
+ * \param other A shareable reaction.
+ */
+void EnemyReaction::copy_shareable(const EnemyReaction& other) {
+
+  Debug::check_assertion(other.is_shareable(), "This enemy reaction cannot be copied");
+
+  general_reaction.type = other.general_reaction.type;
+  general_reaction.life_lost = other.general_reaction.life_lost;
+  general_reaction.callback.clear();
+  sprite_reactions.clear();
+}
+
 }
@@ -15,12 +15,21 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Music.h"
+#include "solarus/core/AllocationTracker.h"
+#include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/QuestProperties.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/System.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/core/Trace.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/CrystalBlock.h"
 #include "solarus/entities/Destination.h"
+#include "solarus/entities/DynamicTile.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/entities/Hero.h"
@@ -32,8 +41,10 @@
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
 #include <sstream>
 #include <lua.hpp>
 
@@ -59,12 +70,17 @@ class ZOrderComparator {
     }
 
     /**
-     * \brief Compares two con entities.
+     * \brief Compares two entities.
+     *
+     * This is a template to accept both smart and raw pointers
+     * without creating temporary shared_ptr objects.
+     *
      * \param first An entity.
      * \param second Another entity.
      * \return \c true if the first entity's Z index is lower than the second one's.
      */
-    bool operator()(const ConstEntityPtr& first, const ConstEntityPtr& second) const {
+    template<typename P>
+    bool operator()(const P& first, const P& second) const {
 
       if (first->get_layer() < second->get_layer()) {
         return true;
@@ -75,7 +91,7 @@ class ZOrderComparator {
       }
 
       // Same layer.
-      return entities.get_entity_relative_z_order(first) < entities.get_entity_relative_z_order(second);
+      return entities.get_entity_relative_z_order(*first) < entities.get_entity_relative_z_order(*second);
     }
 
   private:
@@ -125,11 +141,47 @@ class DrawingOrderComparator {
 
       // Both entities are displayed in Z order.
       const Entities& entities = first->get_entities();
-      return entities.get_entity_relative_z_order(first) < entities.get_entity_relative_z_order(second);
+      return entities.get_entity_relative_z_order(*first) < entities.get_entity_relative_z_order(*second);
     }
 
 };
 
+/**
+ * \brief Returns whether a name starts with a prefix.
+ * \param name A name.
+ * \param prefix The prefix to test.
+ * \return \c true if the name has this prefix.
+ */
+bool has_prefix(const std::string& name, const std::string& prefix) {
+  return name.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * \brief Returns whether entities of a type are detectors that normally
+ * never move.
+ *
+ * They are kept in a grid of small cells apart from other entities.
+ * Scripts can still move them: the grid supports that, only more slowly.
+ *
+ * \param type A type of entity.
+ * \return \c true if this is a static detector type.
+ */
+bool is_static_detector(EntityType type) {
+
+  switch (type) {
+
+    case EntityType::DESTINATION:
+    case EntityType::JUMPER:
+    case EntityType::SENSOR:
+    case EntityType::STAIRS:
+    case EntityType::TELETRANSPORTER:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
 }  // Anonymous namespace.
 
 /**
@@ -142,19 +194,46 @@ Entities::Entities(Game& game, Map& map):
   map(map),
   map_width8(0),
   map_height8(0),
+  map_min_layer(map.get_min_layer()),
   tiles_grid_size(0),
   tiles_ground(),
+  ground_rasters(),
+  obstacle_generation(0),
+  random_key(Random::create_key()),
+  num_random_streams(0),
   non_animated_regions(),
   tiles_in_animated_regions(),
+  animated_tiles_grids(),
+  animated_tiles_not_at_position(),
+  animated_tiles_to_draw(),
   hero(game.get_hero()),
   camera(nullptr),
+  cameras(),
+  camera_boxes(),
+  around_cameras(),
   named_entities(),
   all_entities(),
+  entities_by_type(),
+  transforms(),
+  slots_in_camera(),
+  streaming(nullptr),
   quadtree(),
+  entity_grid(nullptr),
+  static_detector_grid(nullptr),
+  quadtree_batch_enabled(false),
+  quadtree_batch(),
+  creation_batch_started(false),
+  quadtree_batch_enabled_before(false),
+  creation_batch(),
   z_caches(),
-  entities_drawn_not_at_their_position(),
   entities_to_draw(),
   entities_to_remove(),
+  collision_broad_phase(CurrentQuest::get_properties().is_collision_broad_phase_enabled()),
+  pending_collision_checks(),
+  sprites_to_precompute(),
+  vertical_separator_lines(),
+  horizontal_separator_lines(),
+  separator_lines_outdated(true),
   default_destination(nullptr) {
 
   // Initialize the size.
@@ -166,16 +245,29 @@ Entities::Entities(Game& game, Map& map):
 
     Ground initial_ground = (layer == map.get_min_layer()) ? Ground::TRAVERSABLE : Ground::EMPTY;
     tiles_ground[layer].assign(tiles_grid_size, initial_ground);
+    ground_rasters[layer].initialize(map_width8, map_height8);
 
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>(
         new NonAnimatedRegions(map, layer)
     );
   }
 
-  // Initialize the quadtree.
+  // Initialize the quadtree, or the grid if the map prefers it.
   const int margin = 64;
   Rectangle quadtree_space(-margin, -margin, map.get_width() + 2 * margin, map.get_height() + 2 * margin);
-  quadtree.initialize(quadtree_space);
+  const int entity_cell_size = map.get_entity_cell_size();
+  if (entity_cell_size > 0) {
+    entity_grid = std::unique_ptr<EntityGrid>(new EntityGrid(
+        quadtree_space, Size(entity_cell_size, entity_cell_size)
+    ));
+  }
+  else {
+    quadtree.initialize(quadtree_space);
+    quadtree.set_looseness(quadtree_looseness);
+  }
+  static_detector_grid = std::unique_ptr<EntityGrid>(new EntityGrid(
+      quadtree_space, Size(static_detector_cell_size, static_detector_cell_size)
+  ));
 
   // Create the camera.
   add_entity(std::make_shared<Camera>(map));
@@ -186,6 +278,20 @@ Entities::Entities(Game& game, Map& map):
  */
 void Entities::create_entities(const MapData& data) {
 
+  SOLARUS_TRACE_SCOPE("Entities::create_entities");
+
+  reserve_entities(data);
+
+  // Fill the quadtree once at the end.
+  quadtree_batch_enabled = true;
+
+  // Let far unnamed entities wait for the camera if the map prefers it.
+  if (data.get_chunk_size() > 0) {
+    streaming = std::unique_ptr<EntityStreaming>(
+        new EntityStreaming(map, data.get_chunk_size())
+    );
+  }
+
   // Create entities from the map data file.
   LuaContext& lua_context = map.get_lua_context();
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
@@ -195,11 +301,170 @@ void Entities::create_entities(const MapData& data) {
       if (!EntityTypeInfo::can_be_stored_in_map_file(type)) {
         Debug::error("Illegal entity type in map data: " + enum_to_name(type));
       }
+      if (type == EntityType::TILE) {
+        // Tiles have no Lua object: create them directly.
+        create_tiles(entity_data);
+        continue;
+      }
+      if (streaming != nullptr && EntityStreaming::can_be_streamed(entity_data)) {
+        streaming->add_entity_data(entity_data);
+        continue;
+      }
       if (lua_context.create_map_entity_from_data(map, entity_data)) {
         lua_pop(lua_context.get_internal_state(), 1);  // Discard the created entity on the stack.
       }
     }
   }
+
+  quadtree_batch_enabled = false;
+  add_quadtree_batch();
+}
+
+/**
+ * \brief Reserves the lists of entities for the entities of a map data file.
+ * \param data The map data about to be created.
+ */
+void Entities::reserve_entities(const MapData& data) {
+
+  std::vector<const EntityData*> entities_data;
+  entities_data.reserve(data.get_num_entities());
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (int i = 0; i < data.get_num_entities(layer); ++i) {
+      entities_data.push_back(&data.get_entity({ layer, i }));
+    }
+  }
+  reserve_entities(entities_data);
+}
+
+/**
+ * \brief Reserves the lists of entities for entities about to be created.
+ * \param entities_data Description of the entities.
+ */
+void Entities::reserve_entities(const std::vector<const EntityData*>& entities_data) {
+
+  const size_t num_types = EnumInfoTraits<EntityType>::names.size();
+  std::vector<std::vector<size_t>> num_entities_by_type(
+      map.get_max_layer() - map_min_layer + 1, std::vector<size_t>(num_types, 0));
+  for (const EntityData* entity_data: entities_data) {
+    const EntityType type = entity_data->get_type();
+    const int layer = entity_data->get_layer();
+    if (type != EntityType::TILE && map.is_valid_layer(layer)) {
+      ++num_entities_by_type[layer - map_min_layer][static_cast<size_t>(type)];
+    }
+  }
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    size_t num_entities = 0;
+    for (size_t type_index = 0; type_index < num_types; ++type_index) {
+      const size_t num_entities_of_type = num_entities_by_type[layer - map_min_layer][type_index];
+      EntityVector& entities = entities_by_type[type_index][layer - map_min_layer];
+      entities.reserve(entities.size() + num_entities_of_type);
+      num_entities += num_entities_of_type;
+    }
+    EntityVector& entities = entities_to_draw[layer].entities;
+    entities.reserve(entities.size() + num_entities);
+  }
+  quadtree_batch.reserve(quadtree_batch.size() + entities_data.size());
+  transforms.reserve(transforms.get_num_slots() + entities_data.size());
+}
+
+/**
+ * \brief Starts creating several entities at once on a running map.
+ *
+ * Until finish_creation_batch(), new entities are not initialized and
+ * are only added to the quadtree at the end (or before a query),
+ * so that their on_created() events see all entities of the batch.
+ *
+ * \param entities_data Description of the entities about to be created,
+ * used to reserve the lists.
+ */
+void Entities::start_creation_batch(const std::vector<EntityData>& entities_data) {
+
+  Debug::check_assertion(!creation_batch_started, "A creation batch is already started");
+
+  std::vector<const EntityData*> entities_data_pointers;
+  entities_data_pointers.reserve(entities_data.size());
+  for (const EntityData& entity_data: entities_data) {
+    entities_data_pointers.push_back(&entity_data);
+  }
+  reserve_entities(entities_data_pointers);
+
+  creation_batch_started = true;
+  quadtree_batch_enabled_before = quadtree_batch_enabled;
+  quadtree_batch_enabled = true;
+  creation_batch.reserve(entities_data.size());
+}
+
+/**
+ * \brief Finishes creating entities started by start_creation_batch().
+ *
+ * Adds them to the quadtree, and then initializes them in their
+ * creation order, which calls their on_created() events.
+ */
+void Entities::finish_creation_batch() {
+
+  Debug::check_assertion(creation_batch_started, "No creation batch is started");
+
+  creation_batch_started = false;
+  quadtree_batch_enabled = quadtree_batch_enabled_before;
+  if (!quadtree_batch_enabled) {
+    add_quadtree_batch();
+  }
+
+  EntityVector entities;
+  entities.swap(creation_batch);
+  for (const EntityPtr& entity: entities) {
+    if (!entity->is_initialized() && !entity->is_being_removed() && map.is_loaded()) {
+      entity->finish_initialization();
+    }
+  }
+}
+
+/**
+ * \brief Returns whether entities are being created by a batch.
+ * \return \c true between start_creation_batch() and finish_creation_batch().
+ */
+bool Entities::is_creation_batch_started() const {
+  return creation_batch_started;
+}
+
+/**
+ * \brief Creates the tiles described by a tile of a map data file.
+ *
+ * This does the same checks as the creation from Lua,
+ * but errors only skip the tile.
+ *
+ * \param data Description of the tile.
+ */
+void Entities::create_tiles(const EntityData& data) {
+
+  const int layer = data.get_layer();
+  if (!map.is_valid_layer(layer)) {
+    std::ostringstream oss;
+    oss << "Invalid tile layer: " << layer;
+    Debug::error(oss.str());
+    return;
+  }
+
+  const Size size = { data.get_integer("width"), data.get_integer("height") };
+  if (size.width < 0 || size.width % 8 != 0 ||
+      size.height < 0 || size.height % 8 != 0) {
+    std::ostringstream oss;
+    oss << "Invalid tile size " << size << ": should be positive multiples of 8";
+    Debug::error(oss.str());
+    return;
+  }
+
+  std::string tileset_id = data.get_string("tileset");
+  if (tileset_id.empty()) {
+    tileset_id = map.get_tileset_id();
+  }
+  add_tiles(
+      layer,
+      Rectangle(data.get_xy(), size),
+      map.get_used_tileset(tileset_id),
+      data.get_string("pattern")
+  );
 }
 
 /**
@@ -257,6 +522,8 @@ void Entities::set_tile_ground(int layer, int x8, int y8, Ground ground) {
   if (x8 >= 0 && x8 < map_width8 && y8 >= 0 && y8 < map_height8) {
     int index = y8 * map_width8 + x8;
     tiles_ground[layer][index] = ground;
+    ground_rasters[layer].set_ground(x8, y8, ground);
+    ++obstacle_generation;
   }
 }
 
@@ -327,10 +594,11 @@ EntityVector Entities::get_entities_with_prefix(const std::string& prefix) {
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
-    if (entity->has_prefix(prefix) &&
-        !entity->is_being_removed()) {
+  for (auto it = named_entities.lower_bound(prefix);
+       it != named_entities.end() && has_prefix(it->first, prefix);
+       ++it) {
+    const EntityPtr& entity = it->second;
+    if (!entity->is_being_removed()) {
       entities.push_back(entity);
     }
   }
@@ -366,19 +634,22 @@ EntityVector Entities::get_entities_with_prefix(
 
   if (prefix.empty()) {
     // No prefix: return all entities of the type, no matter their name.
-    for (const EntityPtr& entity: get_entities_by_type(type)) {
-      if (!entity->is_being_removed()) {
-        entities.push_back(entity);
+    for (const EntityVector& layer_entities: get_layers_of_type(type)) {
+      for (const EntityPtr& entity: layer_entities) {
+        if (!entity->is_being_removed()) {
+          entities.push_back(entity);
+        }
       }
     }
     return entities;
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
+  for (auto it = named_entities.lower_bound(prefix);
+       it != named_entities.end() && has_prefix(it->first, prefix);
+       ++it) {
+    const EntityPtr& entity = it->second;
     if (entity->get_type() == type &&
-        entity->has_prefix(prefix) &&
         !entity->is_being_removed()
     ) {
       entities.push_back(entity);
@@ -412,8 +683,21 @@ EntityVector Entities::get_entities_with_prefix_sorted(
  */
 bool Entities::has_entity_with_prefix(const std::string& prefix) const {
 
-  for (const EntityPtr& entity: all_entities) {
-    if (entity->has_prefix(prefix) && !entity->is_being_removed()) {
+  if (prefix.empty()) {
+    for (const EntityPtr& entity: all_entities) {
+      if (!entity->is_being_removed()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for (auto it = named_entities.lower_bound(prefix);
+       it != named_entities.end() && has_prefix(it->first, prefix);
+       ++it) {
+    const EntityPtr& entity = it->second;
+    if (entity->get_type() != EntityType::HERO &&
+        !entity->is_being_removed()) {
       return true;
     }
   }
@@ -421,8 +705,35 @@ bool Entities::has_entity_with_prefix(const std::string& prefix) const {
   return false;
 }
 
+/**
+ * \brief Calls a function on each entity whose bounding box overlaps
+ * the given rectangle.
+ *
+ * Entities are taken from the quadtree or from the grid of the map,
+ * and from the grid of static detectors.
+ *
+ * \param rectangle A rectangle.
+ * \param function Function to call with each entity as a const reference,
+ * in arbitrary order.
+ */
+template<typename F>
+void Entities::for_each_entity_in_rectangle(const Rectangle& rectangle, F function) const {
+
+  add_quadtree_batch();
+  if (entity_grid != nullptr) {
+    entity_grid->for_each_element(rectangle, function);
+  }
+  else {
+    quadtree.for_each_element(rectangle, function);
+  }
+  static_detector_grid->for_each_element(rectangle, function);
+}
+
 /**
  * \brief Returns all entities whose bounding box overlaps the given rectangle.
+ *
+ * The result vector is cleared first, but its capacity is reused.
+ *
  * \param[in] rectangle A rectangle.
  * \param[out] result The entities in that rectangle, in arbitrary order.
  */
@@ -430,22 +741,25 @@ void Entities::get_entities_in_rectangle(
     const Rectangle& rectangle, ConstEntityVector& result
 ) const {
 
-  EntityVector non_const_result = quadtree.get_elements(rectangle);
-
-  result.reserve(non_const_result.size());
-  for (const ConstEntityPtr& entity : non_const_result) {
-      result.push_back(entity);
-  }
+  result.clear();
+  for_each_entity_in_rectangle(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity);
+  });
 }
 
 /**
  * \overload Non-const version.
+ *
+ * The result vector is cleared first, but its capacity is reused.
  */
 void Entities::get_entities_in_rectangle(
     const Rectangle& rectangle, EntityVector& result
 ) {
 
-  result = quadtree.get_elements(rectangle);
+  result.clear();
+  for_each_entity_in_rectangle(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity);
+  });
 }
 
 /**
@@ -475,6 +789,137 @@ void Entities::get_entities_in_rectangle_sorted(
   std::sort(result.begin(), result.end(), ZOrderComparator(*this));
 }
 
+/**
+ * \brief Returns raw pointers to all entities whose bounding box overlaps
+ * the given rectangle.
+ *
+ * This avoids the reference counting of shared_ptr copies
+ * in collision checks and other frequent queries.
+ * The pointers remain valid at least until the end of the current cycle,
+ * since entities are only destroyed by remove_marked_entities().
+ *
+ * The result vector is cleared first, but its capacity is reused.
+ *
+ * \param[in] rectangle A rectangle.
+ * \param[out] result The entities in that rectangle, in arbitrary order.
+ */
+void Entities::get_entities_in_rectangle(
+    const Rectangle& rectangle, ConstEntityPointerVector& result
+) const {
+
+  result.clear();
+  for_each_entity_in_rectangle(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity.get());
+  });
+}
+
+/**
+ * \overload Non-const version.
+ */
+void Entities::get_entities_in_rectangle(
+    const Rectangle& rectangle, EntityPointerVector& result
+) {
+
+  result.clear();
+  for_each_entity_in_rectangle(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity.get());
+  });
+}
+
+/**
+ * \brief Like get_entities_in_rectangle() with raw pointers,
+ * but sorts entities according to their Z index on the map.
+ * \param[in] rectangle A rectangle.
+ * \param[out] result The entities in that rectangle, in Z order.
+ */
+void Entities::get_entities_in_rectangle_sorted(
+    const Rectangle& rectangle,
+    ConstEntityPointerVector& result
+) const {
+
+  get_entities_in_rectangle(rectangle, result);
+  std::sort(result.begin(), result.end(), ZOrderComparator(*this));
+}
+
+/**
+ * \brief Returns the number of entities whose bounding box overlaps
+ * the given rectangle.
+ *
+ * Unlike get_entities_in_rectangle(), no list is built.
+ *
+ * \param rectangle A rectangle.
+ * \return The number of entities in that rectangle.
+ */
+int Entities::get_num_entities_in_rectangle(const Rectangle& rectangle) const {
+
+  int count = 0;
+  for_each_entity_in_rectangle(rectangle, [&count](const EntityPtr& /* entity */) {
+    ++count;
+  });
+  return count;
+}
+
+/**
+ * \brief Returns the number of entities of a type whose bounding box
+ * overlaps the given rectangle.
+ * \param rectangle A rectangle.
+ * \param type The type of entities to count.
+ * \return The number of entities of this type in that rectangle.
+ */
+int Entities::get_num_entities_in_rectangle(const Rectangle& rectangle, EntityType type) const {
+
+  int count = 0;
+  for_each_entity_in_rectangle(rectangle, [&count, type](const EntityPtr& entity) {
+    if (entity->get_type() == type) {
+      ++count;
+    }
+  });
+  return count;
+}
+
+/**
+ * \brief Returns the first entity in Z order whose bounding box overlaps
+ * the given rectangle.
+ *
+ * This is the first entity of get_entities_in_rectangle_sorted(),
+ * but no list is built.
+ *
+ * \param rectangle A rectangle.
+ * \return The lowest entity in that rectangle, or nullptr if there is none.
+ */
+EntityPtr Entities::get_first_entity_in_rectangle(const Rectangle& rectangle) const {
+
+  const ZOrderComparator comparator(*this);
+  const EntityPtr* first = nullptr;
+  for_each_entity_in_rectangle(rectangle, [&first, &comparator](const EntityPtr& entity) {
+    if (first == nullptr || comparator(entity, *first)) {
+      first = &entity;
+    }
+  });
+  return first != nullptr ? *first : nullptr;
+}
+
+/**
+ * \brief Returns the first entity of a type in Z order whose bounding box
+ * overlaps the given rectangle.
+ * \param rectangle A rectangle.
+ * \param type The type of entity to get.
+ * \return The lowest entity of this type in that rectangle,
+ * or nullptr if there is none.
+ */
+EntityPtr Entities::get_first_entity_in_rectangle(const Rectangle& rectangle, EntityType type) const {
+
+  const ZOrderComparator comparator(*this);
+  const EntityPtr* first = nullptr;
+  for_each_entity_in_rectangle(rectangle, [&first, &comparator, type](const EntityPtr& entity) {
+    if (entity->get_type() == type &&
+        (first == nullptr || comparator(entity, *first))) {
+      first = &entity;
+    }
+  });
+  return first != nullptr ? *first : nullptr;
+}
+
 /**
  * \brief Returns all entities in the same separator region as the given point.
  *
@@ -513,17 +958,15 @@ Rectangle Entities::get_region_box(const Point& point) const {
 
   // Find the closest separator in each direction.
 
-  const std::set<ConstSeparatorPtr>& separators =
-      get_entities_by_type<Separator>();
-  for (const ConstSeparatorPtr& separator: separators) {
+  for (const Separator& separator: get_entities_by_type<Separator>()) {
 
-    const Point& separator_center = separator->get_center_point();
+    const Point& separator_center = separator.get_center_point();
 
-    if (separator->is_vertical()) {
+    if (separator.is_vertical()) {
 
       // Vertical separation.
-      if (point.y < separator->get_top_left_y() ||
-          point.y >= separator->get_top_left_y() + separator->get_height()) {
+      if (point.y < separator.get_top_left_y() ||
+          point.y >= separator.get_top_left_y() + separator.get_height()) {
         // This separator is irrelevant: the point is not in either side,
         // it is too much to the north or to the south.
         //
@@ -547,8 +990,8 @@ Rectangle Entities::get_region_box(const Point& point) const {
     }
     else {
       // Horizontal separation.
-      if (point.x < separator->get_top_left_x() ||
-          point.x >= separator->get_top_left_x() + separator->get_width()) {
+      if (point.x < separator.get_top_left_x() ||
+          point.x >= separator.get_top_left_x() + separator.get_width()) {
         // This separator is irrelevant: the point is not in either side.
         continue;
       }
@@ -589,12 +1032,11 @@ void Entities::get_entities_in_region_sorted(
  * \param type An entity type.
  * \return All entities of the type.
  */
-EntitySet Entities::get_entities_by_type(EntityType type) {
+EntityVector Entities::get_entities_by_type(EntityType type) {
 
-  EntitySet result;
-  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    const EntitySet& layer_entities = get_entities_by_type(type, layer);
-    result.insert(layer_entities.begin(), layer_entities.end());
+  EntityVector result;
+  for (const EntityVector& layer_entities: get_layers_of_type(type)) {
+    result.insert(result.end(), layer_entities.begin(), layer_entities.end());
   }
   return result;
 }
@@ -607,39 +1049,26 @@ EntitySet Entities::get_entities_by_type(EntityType type) {
  */
 EntityVector Entities::get_entities_by_type_sorted(EntityType type) {
 
-  EntitySet entity_set = get_entities_by_type(type);
-  EntityVector entities;
-  entities.insert(entities.begin(), entity_set.begin(), entity_set.end());
+  EntityVector entities = get_entities_by_type(type);
   std::sort(entities.begin(), entities.end(), ZOrderComparator(*this));
   return entities;
 }
 
 /**
  * \brief Returns all entities of a type on the given layer.
+ *
+ * The list is returned without copy: it must not be kept after
+ * entities are added, removed or change layer.
+ *
  * \param type Type of entities to get.
  * \param layer The layer to get entities from.
- * \return All entities of the type on this layer.
+ * \return All entities of the type on this layer, in arbitrary order.
  */
-EntitySet Entities::get_entities_by_type(EntityType type, int layer) {
+const EntityVector& Entities::get_entities_by_type(EntityType type, int layer) const {
 
   Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
 
-  EntitySet result;
-
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
-  }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(entity);
-  }
-  return result;
+  return get_layers_of_type(type)[layer - map_min_layer];
 }
 
 /**
@@ -659,9 +1088,9 @@ EntitySet Entities::get_entities_by_type(EntityType type, int layer) {
  * \param entity An entity of the map.
  * \return Its relative Z order.
  */
-int Entities::get_entity_relative_z_order(const ConstEntityPtr& entity) const {
+int Entities::get_entity_relative_z_order(const Entity& entity) const {
 
-  const int layer = entity->get_layer();
+  const int layer = entity.get_layer();
   return z_caches.at(layer).get_z(entity);
 }
 
@@ -671,9 +1100,9 @@ int Entities::get_entity_relative_z_order(const ConstEntityPtr& entity) const {
  */
 void Entities::bring_to_front(Entity& entity) {
 
-  const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
-  z_caches.at(layer).bring_to_front(shared_entity);
+  z_caches.at(layer).bring_to_front(entity);
+  notify_entity_drawing_order_changed(entity);
 }
 
 /**
@@ -682,9 +1111,9 @@ void Entities::bring_to_front(Entity& entity) {
  */
 void Entities::bring_to_back(Entity& entity) {
 
-  const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
-  z_caches.at(layer).bring_to_back(shared_entity);
+  z_caches.at(layer).bring_to_back(entity);
+  notify_entity_drawing_order_changed(entity);
 }
 
 /**
@@ -692,6 +1121,9 @@ void Entities::bring_to_back(Entity& entity) {
  */
 void Entities::notify_map_started() {
 
+  // Boxes may have changed while the map was loading.
+  transforms.update_all();
+
   // Setup non-animated tiles pre-drawing.
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     std::vector<TileInfo> tiles_in_animated_regions_info;
@@ -702,8 +1134,39 @@ void Entities::notify_map_started() {
       tiles_in_animated_regions.at(layer).push_back(tile);
       add_entity(tile);
     }
+
+    // Index them by position to only visit the visible ones when drawing.
+    const std::vector<TilePtr>& tiles = tiles_in_animated_regions.at(layer);
+    std::unique_ptr<Grid<size_t>>& grid = animated_tiles_grids.at(layer);
+    grid = std::unique_ptr<Grid<size_t>>(new Grid<size_t>(
+        map.get_size(),
+        Size(animated_tiles_cell_size, animated_tiles_cell_size)
+    ));
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      if (tiles[i]->is_drawn_at_its_position()) {
+        grid->add(i, tiles[i]->get_bounding_box());
+      }
+      else {
+        animated_tiles_not_at_position.at(layer).push_back(i);
+      }
+    }
+  }
+
+  // Create the streamed entities around the hero, who is already on the destination.
+  if (streaming != nullptr) {
+    const Size camera_size = camera->get_size();
+    const Point hero_center = hero->get_center_point();
+    streaming->update(Rectangle(
+        hero_center.x - camera_size.width / 2,
+        hero_center.y - camera_size.height / 2,
+        camera_size.width,
+        camera_size.height
+    ), true);
   }
 
+  // The crystal state may have changed since crystal blocks were created.
+  notify_crystal_state_changed();
+
   // Now, tiles_in_animated_regions contains the tiles that won't be optimized.
   // Notify entities.
   for (const EntityPtr& entity: all_entities) {
@@ -729,12 +1192,33 @@ void Entities::notify_map_opening_transition_finished() {
 /**
  * \brief Notifies this entity manager that the tileset of the map has
  * changed.
+ *
+ * Tiles and dynamic tiles drawn with the old tileset switch to the new one.
+ *
+ * \param old_tileset The previous tileset of the map.
+ * \param new_tileset The new one.
+ * \param same_patterns \c true if the tilesets are siblings and the old one
+ * stays in memory: tiles then only change their image.
  */
-void Entities::notify_tileset_changed() {
-
+void Entities::notify_tileset_changed(
+    const Tileset& old_tileset,
+    const Tileset& new_tileset,
+    bool same_patterns
+) {
   // Redraw optimized tiles (i.e. non animated ones).
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    non_animated_regions[layer]->notify_tileset_changed();
+    non_animated_regions[layer]->notify_tileset_changed(old_tileset, new_tileset, same_patterns);
+    if (&new_tileset != &old_tileset) {
+      for (const TilePtr& tile: tiles_in_animated_regions[layer]) {
+        tile->switch_tileset(old_tileset, new_tileset, same_patterns);
+      }
+    }
+  }
+
+  if (&new_tileset != &old_tileset) {
+    for (DynamicTile& dynamic_tile: get_entities_by_type<DynamicTile>()) {
+      dynamic_tile.switch_tileset(old_tileset, new_tileset, same_patterns);
+    }
   }
 
   for (const EntityPtr& entity: all_entities) {
@@ -764,10 +1248,19 @@ void Entities::initialize_layers() {
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     tiles_ground[layer] = std::vector<Ground>();
+    ground_rasters[layer] = GroundRaster();
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>();
     tiles_in_animated_regions[layer] = std::vector<TilePtr>();
+    animated_tiles_grids[layer] = std::unique_ptr<Grid<size_t>>();
+    animated_tiles_not_at_position[layer] = std::vector<size_t>();
     z_caches[layer] = ZCache();
   }
+
+  const size_t num_layers = static_cast<size_t>(map.get_max_layer() - map.get_min_layer() + 1);
+  entities_by_type.assign(
+      EnumInfoTraits<EntityType>::names.size(),
+      std::vector<EntityVector>(num_layers)
+  );
 }
 
 /**
@@ -940,6 +1433,47 @@ void Entities::add_tile_info(const TileInfo& tile_info) {
   }
 }
 
+/**
+ * \brief Adds tiles of a pattern repeated in a rectangle.
+ *
+ * If the rectangle is big, it is divided in several smaller tiles so that
+ * most of them can still be optimized away.
+ * Otherwise, tiles expanded in big rectangles like a lake or a dungeon
+ * floor would be entirely redrawn at each frame when just one small
+ * animated tile overlaps them.
+ *
+ * \param layer Layer of the tiles.
+ * \param box Rectangle to fill with the pattern.
+ * \param tileset Tileset of the pattern.
+ * \param pattern_id Id of the pattern in the tileset.
+ */
+void Entities::add_tiles(
+    int layer,
+    const Rectangle& box,
+    const Tileset& tileset,
+    const std::string& pattern_id
+) {
+  const int pattern_index = Tileset::get_tile_pattern_index(pattern_id);
+  const TilePattern& pattern = tileset.get_tile_pattern(pattern_index);
+  const Size& pattern_size = pattern.get_size();
+
+  TileInfo tile_info;
+  tile_info.layer = layer;
+  tile_info.box = { Point(), pattern_size };
+  tile_info.pattern_id = pattern_id;
+  tile_info.pattern_index = pattern_index;
+  tile_info.pattern = &pattern;
+  tile_info.tileset = &tileset;
+
+  for (int current_y = box.get_y(); current_y < box.get_y() + box.get_height(); current_y += pattern.get_height()) {
+    for (int current_x = box.get_x(); current_x < box.get_x() + box.get_width(); current_x += pattern.get_width()) {
+      tile_info.box.set_xy(current_x, current_y);
+      // The tile will actually be created only if it cannot be optimized away.
+      add_tile_info(tile_info);
+    }
+  }
+}
+
 /**
  * \brief Adds an entity to the map.
  *
@@ -960,19 +1494,42 @@ void Entities::add_entity(const EntityPtr& entity) {
   Debug::check_assertion(map.is_valid_layer(entity->get_layer()),
       "No such layer on this map");
 
+  ++obstacle_generation;
+
   const EntityType type = entity->get_type();
   if (type != EntityType::TILE) {  // Tiles are optimized specifically.
     const int layer = entity->get_layer();
 
     // Update the quadtree.
-    quadtree.add(entity, entity->get_max_bounding_box());
+    if (is_static_detector(type)) {
+      static_detector_grid->add(entity, entity->get_max_bounding_box());
+    }
+    else if (quadtree_batch_enabled) {
+      quadtree_batch.push_back(entity);
+    }
+    else if (entity_grid != nullptr) {
+      entity_grid->add(entity, entity->get_max_bounding_box());
+    }
+    else {
+      quadtree.add(entity, entity->get_max_bounding_box());
+    }
+    map.get_path_finding_cache().notify_entity_changed(*entity);
+    transforms.add(*entity);
+
+    // Entities are added in a deterministic order, so each one gets
+    // the same random numbers whatever happens to the others.
+    entity->set_random_stream(Random::Stream(
+        Random::derive_key(random_key, num_random_streams++)));
 
     // Update the specific entities lists.
     switch (entity->get_type()) {
 
       case EntityType::CAMERA:
-        Debug::check_assertion(camera == nullptr, "Only one camera is supported");
-        camera = std::static_pointer_cast<Camera>(entity);
+        Debug::check_assertion(cameras.size() < max_cameras, "Too many cameras");
+        cameras.push_back(std::static_pointer_cast<Camera>(entity));
+        if (camera == nullptr) {
+          camera = cameras.back();
+        }
         break;
 
       case EntityType::DESTINATION:
@@ -989,21 +1546,14 @@ void Entities::add_entity(const EntityPtr& entity) {
       break;
     }
 
-    // Update the list of entities drawn not at their position.
-    if (!entity->is_drawn_at_its_position()) {
-      entities_drawn_not_at_their_position[layer].push_back(entity);
-    }
-
     // Track the insertion order.
-    z_caches[layer].add(entity);
+    z_caches[layer].add(*entity);
+
+    // Update the drawing list.
+    add_entity_to_draw(entity);
 
     // Update the list of entities by type.
-    auto it = entities_by_type.find(type);
-    if (it == entities_by_type.end()) {
-      it = entities_by_type.emplace(type, ByLayer<EntitySet>()).first;
-    }
-    ByLayer<EntitySet>& sets = it->second;
-    sets[layer].insert(entity);
+    add_entity_by_type(entity, layer);
 
     // Update the list of all entities.
     if (type != EntityType::HERO) {
@@ -1047,6 +1597,10 @@ void Entities::add_entity(const EntityPtr& entity) {
     named_entities[name] = entity;
   }
 
+  if (creation_batch_started) {
+    creation_batch.push_back(entity);
+  }
+
   // Notify the entity.
   if (type != EntityType::HERO) {
     entity->set_map(map);
@@ -1066,6 +1620,7 @@ void Entities::remove_entity(Entity& entity) {
 
     // Tell the entity.
     entity.notify_being_removed();
+    map.get_path_finding_cache().notify_entity_changed(entity);
 
     // Remove the entity from the by name list
     // to allow users to create a new one with
@@ -1105,27 +1660,61 @@ void Entities::remove_entities_with_prefix(const std::string& prefix) {
  */
 void Entities::remove_marked_entities() {
 
+  if (entities_to_remove.empty()) {
+    return;
+  }
+
+  // Forget pending collision checks of entities about to be destroyed.
+  pending_collision_checks.erase(
+      std::remove_if(
+          pending_collision_checks.begin(),
+          pending_collision_checks.end(),
+          [](const Entity* entity) { return entity->is_being_removed(); }
+      ),
+      pending_collision_checks.end()
+  );
+
   // Remove the marked entities.
   for (const EntityPtr& entity: entities_to_remove) {
 
     const EntityType type = entity->get_type();
     const int layer = entity->get_layer();
+    ++obstacle_generation;
 
     // Remove it from the quadtree.
-    quadtree.remove(entity);
+    if (is_static_detector(type)) {
+      static_detector_grid->remove(entity);
+    }
+    else if (entity_grid != nullptr) {
+      entity_grid->remove(entity);
+    }
+    else {
+      quadtree.remove(entity);
+    }
+    map.get_path_finding_cache().notify_entity_removed(*entity);
+    transforms.remove(*entity);
+    if (streaming != nullptr) {
+      streaming->notify_entity_removed(*entity);
+    }
 
-    // Remove it from the whole list.
-    all_entities.remove(entity);
+    // A new entity may already have taken the name.
     const std::string& name = entity->get_name();
     if (!name.empty()) {
-      named_entities.erase(name);
+      const auto& it = named_entities.find(name);
+      if (it != named_entities.end() && it->second == entity) {
+        named_entities.erase(it);
+      }
     }
 
     // Update the specific entities lists.
     switch (type) {
 
       case EntityType::CAMERA:
-        camera = nullptr;
+        cameras.erase(std::find(cameras.begin(), cameras.end(), entity));
+        if (camera == entity) {
+          // The next camera becomes the main one.
+          camera = cameras.empty() ? nullptr : cameras.front();
+        }
         break;
 
       default:
@@ -1133,18 +1722,23 @@ void Entities::remove_marked_entities() {
     }
 
     // Track the insertion order.
-    z_caches.at(layer).remove(entity);
+    z_caches.at(layer).remove(*entity);
+
+    // Update the drawing list.
+    remove_entity_to_draw(entity, layer);
 
     // Update the list of entities by type.
-    const auto& it = entities_by_type.find(type);
-    if (it != entities_by_type.end()) {
-      ByLayer<EntitySet>& sets = it->second;
-      sets[layer].erase(entity);
-    }
+    remove_entity_by_type(entity, layer);
 
     // Destroy it.
     notify_entity_removed(*entity);
   }
+
+  // Remove them from the whole list in one pass.
+  // Only entities of entities_to_remove are marked as being removed.
+  all_entities.remove_if([](const EntityPtr& entity) {
+    return entity->is_being_removed();
+  });
   entities_to_remove.clear();
 }
 
@@ -1164,7 +1758,13 @@ void Entities::set_suspended(bool suspended) {
 
   // other entities
   for (const EntityPtr& entity: all_entities) {
-    entity->set_suspended(suspended);
+    if (entity->is_dormant() && entity->is_suspended()) {
+      // Dormant entities are already suspended and stay so when the map
+      // resumes: skip them, there are often many of them on big maps.
+      // Suspending them again would also lose the date when they fell asleep.
+      continue;
+    }
+    entity->set_suspended(suspended || entity->is_dormant());
   }
 
   // note that we don't suspend the tiles
@@ -1176,84 +1776,280 @@ void Entities::set_suspended(bool suspended) {
 void Entities::update() {
 
   Debug::check_assertion(map.is_started(), "The map is not started");
+  AllocationTracker::ScopeMarker allocation_scope(AllocationTracker::Scope::ENTITIES_UPDATE);
+  SOLARUS_TRACE_SCOPE("Entities::update");
+
+  // Remember the positions of the previous step for render interpolation.
+  hero->store_previous_xy();
+  for (const EntityPtr& entity: all_entities) {
+    entity->store_previous_xy();
+  }
+
+  // Advance in parallel the sprites whose animation cannot run Lua code.
+  // Their notifications are done by the serial updates below, in order.
+  precompute_sprite_frames();
 
   // First update the hero.
-  hero->update();
+  {
+    Random::StreamScope random_scope(hero->get_random_stream());
+    hero->update();
+  }
+
+  // Put to sleep entities far from the camera, and wake up the others.
+  update_dormant_entities();
 
   // Update the dynamic entities.
   for (const EntityPtr& entity: all_entities) {
 
     if (
         !entity->is_being_removed() &&
+        !entity->is_dormant() &&
         entity->get_type() != EntityType::CAMERA  // The camera is updated after.
     ) {
+      Random::StreamScope random_scope(entity->get_random_stream());
       entity->update();
     }
   }
 
-  // Update the camera after everyone else.
-  camera->update();
-  entities_to_draw.clear();  // Invalidate entities to draw.
+  // Update the cameras after everyone else.
+  for (size_t i = 0; i < cameras.size(); ++i) {
+    // Copy the pointer: Lua code may remove a camera.
+    const CameraPtr updated_camera = cameras[i];
+    Random::StreamScope random_scope(updated_camera->get_random_stream());
+    updated_camera->update();
+  }
+
+  // Create and drop streamed entities around the new camera position.
+  if (streaming != nullptr) {
+    streaming->update(camera->get_bounding_box(), false);
+  }
+
+  // Detect the collisions of everything that moved during this cycle.
+  check_pending_collisions();
 
   // Remove the entities that have to be removed now.
   remove_marked_entities();
 }
 
 /**
- * \brief Draws the entities on the map surface.
+ * \brief Makes dormant the entities too far from the camera.
+ *
+ * The distance of an entity is its optimization distance, or the
+ * activity distance of the map if it has none.
+ * Entities that have no distance or that are always active are woken up.
+ * With several cameras, entities close to any of them are active.
+ * This is a sweep over the transform arrays.
  */
-void Entities::draw() {
+void Entities::update_dormant_entities() {
 
-  const CameraPtr& camera = get_camera();
   if (camera == nullptr) {
     return;
   }
 
-  const SurfacePtr& camera_surface = camera->get_surface();
+  camera_boxes.clear();
+  for (const CameraPtr& active_camera: cameras) {
+    camera_boxes.push_back(active_camera->get_bounding_box());
+  }
+  const int map_distance = map.get_activity_distance();
+
+  // Iterate with an index because waking up entities may call Lua code
+  // that creates entities.
+  for (size_t slot = 0; slot < transforms.get_num_slots(); ++slot) {
+    Entity& entity = transforms.get_entity(slot);
+    const EntityType type = entity.get_type();
+    if (type == EntityType::HERO || type == EntityType::CAMERA) {
+      continue;
+    }
+
+    int distance = entity.get_optimization_distance();
+    if (distance == 0) {
+      distance = map_distance;
+    }
+
+    bool dormant = false;
+    if (distance > 0 &&
+        !entity.is_always_active() &&
+        !entity.is_being_removed()) {
+      dormant = true;
+      for (const Rectangle& camera_box: camera_boxes) {
+        const Rectangle active_box(
+            camera_box.get_x() - distance,
+            camera_box.get_y() - distance,
+            camera_box.get_width() + 2 * distance,
+            camera_box.get_height() + 2 * distance
+        );
+        if (transforms.get_max_bounding_box(slot).overlaps(active_box)) {
+          dormant = false;
+          break;
+        }
+      }
+    }
+    entity.set_dormant(dormant);
+  }
+}
+
+/**
+ * \brief Computes the new frames of sprites that can be animated out of order.
+ *
+ * Sprites that are not known to Lua and are not synchronized to other
+ * sprites only need their own state to advance. Their frames are computed
+ * on the thread pool of the main loop, and each result is committed by the
+ * Sprite::update() call that the usual serial update does.
+ * Collisions and events therefore stay in the same order as before.
+ */
+void Entities::precompute_sprite_frames() {
 
-  // Lazily build the list of entities to draw.
-  if (entities_to_draw.empty()) {
+  ThreadPool& thread_pool = game.get_main_loop().get_thread_pool();
+  if (thread_pool.get_num_threads() <= 1) {
+    return;
+  }
+
+  sprites_to_precompute.clear();
+  hero->get_sprites_to_precompute(sprites_to_precompute);
+  for (const EntityPtr& entity: all_entities) {
+    entity->get_sprites_to_precompute(sprites_to_precompute);
+  }
+
+  if (static_cast<int>(sprites_to_precompute.size()) < min_parallel_sprites) {
+    // Not worth waking up the workers.
+    return;
+  }
+
+  // A sprite may be shared by several entities.
+  std::sort(sprites_to_precompute.begin(), sprites_to_precompute.end());
+  sprites_to_precompute.erase(
+      std::unique(sprites_to_precompute.begin(), sprites_to_precompute.end()),
+      sprites_to_precompute.end()
+  );
+
+  const uint32_t now = System::now();
+  thread_pool.parallel_for(
+      static_cast<int>(sprites_to_precompute.size()),
+      [this, now](int index) {
+    sprites_to_precompute[index]->precompute_frames(now);
+  });
+}
+
+/**
+ * \brief Returns the tiles in animated regions that may be visible.
+ *
+ * Only the grid cells covered by the camera are visited, so that the cost
+ * does not grow with the size of the map.
+ *
+ * \param layer The layer to get.
+ * \param camera The camera to draw.
+ * \param[out] indexes Indexes in tiles_in_animated_regions of the tiles,
+ * in increasing order. The vector is cleared first.
+ */
+void Entities::get_animated_tiles_to_draw(
+    int layer, const Camera& camera, std::vector<size_t>& indexes) const {
+
+  indexes.clear();
+  const std::unique_ptr<Grid<size_t>>& grid = animated_tiles_grids.at(layer);
+  if (grid != nullptr) {
+    const Rectangle& where = camera.get_bounding_box();
+    const Size& cell_size = grid->get_cell_size();
+    const int num_rows = static_cast<int>(grid->get_num_rows());
+    const int num_columns = static_cast<int>(grid->get_num_columns());
+    const int row1 = std::max(0, where.get_y() / cell_size.height);
+    const int row2 = std::min(num_rows - 1, where.get_bottom() / cell_size.height);
+    const int column1 = std::max(0, where.get_x() / cell_size.width);
+    const int column2 = std::min(num_columns - 1, where.get_right() / cell_size.width);
+    for (int i = row1; i <= row2; ++i) {
+      for (int j = column1; j <= column2; ++j) {
+        const std::vector<size_t>& in_cell = grid->get_elements(i * num_columns + j);
+        indexes.insert(indexes.end(), in_cell.begin(), in_cell.end());
+      }
+    }
+  }
+
+  const std::vector<size_t>& not_at_position = animated_tiles_not_at_position.at(layer);
+  indexes.insert(indexes.end(), not_at_position.begin(), not_at_position.end());
+
+  // Keep the original drawing order and draw tiles in several cells once.
+  std::sort(indexes.begin(), indexes.end());
+  indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+}
+
+/**
+ * \brief Returns whether an entity is close enough to a camera to be drawn.
+ *
+ * This uses the result of the sweep done by prepare_drawing().
+ *
+ * \param entity An entity of the map.
+ * \param camera_index Index of the camera in get_cameras().
+ * \return \c true if the entity overlaps the area drawn by this camera.
+ */
+bool Entities::is_around_camera(const Entity& entity, size_t camera_index) const {
+
+  if (transforms.contains(entity)) {
+    const size_t slot = static_cast<size_t>(entity.get_transform_slot());
+    if (slot < slots_in_camera.size()) {
+      return (slots_in_camera[slot] & (1 << camera_index)) != 0;
+    }
+  }
 
-    // Add entities in the camera,
-    // or nearby because of possible
-    // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
-    // TODO it would probably be better to detect entities with
-    // such events and make their is_drawn_at_its_position()
-    // method return false.
-    EntityVector entities_in_camera;
-    Rectangle around_camera(
+  // Added during the drawing.
+  return camera_index < around_cameras.size() &&
+      entity.get_max_bounding_box().overlaps(around_cameras[camera_index]);
+}
+
+/**
+ * \brief Prepares the drawing of all cameras.
+ *
+ * Entities around each camera are found in a single sweep,
+ * so that drawing several cameras does not multiply the visibility tests.
+ */
+void Entities::prepare_drawing() {
+
+  // Draw entities in the camera,
+  // or nearby because of possible
+  // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
+  // TODO it would probably be better to detect entities with
+  // such events and make their is_drawn_at_its_position()
+  // method return false.
+  around_cameras.clear();
+  for (const CameraPtr& drawn_camera: cameras) {
+    around_cameras.emplace_back(
         Point(
-            camera->get_x() - camera->get_size().width,
-            camera->get_y() - camera->get_size().height
+            drawn_camera->get_x() - drawn_camera->get_size().width,
+            drawn_camera->get_y() - drawn_camera->get_size().height
         ),
-        camera->get_size() * 3
+        drawn_camera->get_size() * 3
     );
-    get_entities_in_rectangle(around_camera, entities_in_camera);
+  }
+  transforms.get_slots_overlapping(around_cameras, slots_in_camera);
 
-    for (const EntityPtr& entity : entities_in_camera) {
-      int layer = entity->get_layer();
-      Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
-      entities_to_draw[layer].push_back(entity);
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    // The list is not rebuilt at each cycle: sort it again only if
+    // some entities moved in the drawing order.
+    if (!entities_to_draw[layer].sorted) {
+      sort_entities_to_draw(layer);
     }
+  }
+}
 
-    // Add entities displayed even when out of the camera.
-    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-      for (const EntityPtr& entity : entities_drawn_not_at_their_position[layer]) {
-        entities_to_draw[layer].push_back(entity);
-      }
+/**
+ * \brief Draws the entities on the surface of a camera.
+ *
+ * prepare_drawing() must be called first in the frame,
+ * and finish_drawing() after all cameras are drawn.
+ *
+ * \param camera The camera to draw.
+ */
+void Entities::draw(Camera& camera) {
 
-      // Sort them and remove duplicates.
-      // Duplicate drawings are a problem for entities with semi-transparency.
-      // Using an std::set would be slower because duplicates are rare:
-      // there are not often a lot of dynamic entities displayed out of the camera.
-      std::sort(entities_to_draw[layer].begin(), entities_to_draw[layer].end(), DrawingOrderComparator());
-      entities_to_draw[layer].erase(
-            std::unique(entities_to_draw[layer].begin(), entities_to_draw[layer].end()),
-            entities_to_draw[layer].end()
-      );
-    }
+  AllocationTracker::ScopeMarker allocation_scope(AllocationTracker::Scope::ENTITIES_DRAW);
+  SOLARUS_TRACE_SCOPE("Entities::draw");
 
+  const auto it = std::find_if(cameras.begin(), cameras.end(), [&](const CameraPtr& drawn_camera) {
+    return drawn_camera.get() == &camera;
+  });
+  if (it == cameras.end()) {
+    return;
   }
+  const size_t camera_index = static_cast<size_t>(it - cameras.begin());
+  const SurfacePtr& camera_surface = camera.get_surface();
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
 
@@ -1261,30 +2057,59 @@ void Entities::draw() {
     // in other words, draw all regions containing animated tiles
     // (and maybe more, but we don't care because non-animated tiles
     // will be drawn later).
-    for (unsigned int i = 0; i < tiles_in_animated_regions[layer].size(); i++) {
-      Tile& tile = *tiles_in_animated_regions[layer][i];
-      if (tile.overlaps(*camera) || !tile.is_drawn_at_its_position()) {
+    get_animated_tiles_to_draw(layer, camera, animated_tiles_to_draw);
+    for (size_t index: animated_tiles_to_draw) {
+      Tile& tile = *tiles_in_animated_regions[layer][index];
+      if (tile.overlaps(camera) || !tile.is_drawn_at_its_position()) {
         tile.draw_on_map();
       }
     }
 
     // Draw the non-animated tiles (with transparent rectangles on the regions of animated tiles
     // since they are already drawn).
-    non_animated_regions[layer]->draw_on_map();
-
-    // Draw dynamic entities, ordered by their data structure.
-    for (const EntityPtr& entity: entities_to_draw[layer]) {
-      if (!entity->is_being_removed() &&
-          entity->is_enabled() &&
-          entity->is_visible()) {
-        entity->draw_on_map();
+    non_animated_regions[layer]->draw_on_map(camera);
+
+    // Draw dynamic entities in their drawing order.
+    // Lua code may have changed the order since prepare_drawing().
+    if (!entities_to_draw[layer].sorted) {
+      sort_entities_to_draw(layer);
+    }
+
+    // Iterate with an index because drawing may call Lua code that adds
+    // or removes entities to draw.
+    const EntityVector& entities = entities_to_draw[layer].entities;
+    for (size_t i = 0; i < entities.size(); ++i) {
+      const EntityPtr entity = entities[i];
+      if (entity->is_being_removed() ||
+          !entity->is_enabled() ||
+          !entity->is_visible()) {
+        continue;
       }
+
+      if (entity->is_drawn_at_its_position() &&
+          !is_around_camera(*entity, camera_index)) {
+        // Too far from the camera.
+        continue;
+      }
+      entity->draw_on_map();
     }
   }
 
-  if (EntityTree::debug_quadtrees) {
+  if (EntityTree::debug_quadtrees && entity_grid == nullptr) {
     // Draw the quadtree structure for debugging.
-    quadtree.draw(camera_surface, -camera->get_top_left_xy());
+    quadtree.draw(camera_surface, -camera.get_top_left_xy());
+  }
+}
+
+/**
+ * \brief Finishes the drawing of all cameras.
+ *
+ * Tile cells far from every camera are released.
+ */
+void Entities::finish_drawing() {
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    non_animated_regions[layer]->release_far_cells();
   }
 }
 
@@ -1302,20 +2127,22 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
     const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
 
     // Track the insertion order.
-    z_caches.at(old_layer).remove(shared_entity);
-    z_caches.at(layer).add(shared_entity);
+    z_caches.at(old_layer).remove(entity);
+    z_caches.at(layer).add(entity);
+
+    // Move it to the drawing list of the new layer.
+    const bool drawn = remove_entity_to_draw(shared_entity, old_layer);
 
     // Update the list of entities by type and layer.
-    const EntityType type = entity.get_type();
-    const auto& it = entities_by_type.find(type);
-    if (it != entities_by_type.end()) {
-      ByLayer<EntitySet>& sets = it->second;
-      sets[old_layer].erase(shared_entity);
-      sets[layer].insert(shared_entity);
-    }
+    remove_entity_by_type(shared_entity, old_layer);
+    add_entity_by_type(shared_entity, layer);
 
     // Update the entity after the lists because this function might be called again.
     entity.set_layer(layer);
+
+    if (drawn) {
+      add_entity_to_draw(shared_entity);
+    }
   }
 }
 
@@ -1326,12 +2153,192 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
  */
 void Entities::notify_entity_bounding_box_changed(Entity& entity) {
 
+  ++obstacle_generation;
+  if (entity.get_type() == EntityType::SEPARATOR) {
+    separator_lines_outdated = true;
+  }
+
   // Update the quadtree.
 
   // Note that if the entity is not in the quadtree
   // (i.e. not managed by MapEntities) this does nothing.
   EntityPtr shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
-  quadtree.move(shared_entity, shared_entity->get_max_bounding_box());
+  // Entities still in the batch get their bounding box when it is added.
+  if (is_static_detector(entity.get_type())) {
+    static_detector_grid->move(shared_entity, shared_entity->get_max_bounding_box());
+  }
+  else if (entity_grid != nullptr) {
+    entity_grid->move(shared_entity, shared_entity->get_max_bounding_box());
+  }
+  else {
+    quadtree.move(shared_entity, shared_entity->get_max_bounding_box());
+  }
+  transforms.update(entity);
+
+  // Paths computed around it may not be valid anymore.
+  map.get_path_finding_cache().notify_entity_changed(entity);
+
+  // Entities drawn in Y order may now have to be drawn at another place.
+  if (entity.is_drawn_in_y_order()) {
+    notify_entity_drawing_order_changed(entity);
+  }
+}
+
+/**
+ * \brief This function should be called whenever an entity may have to be
+ * drawn at another place in the drawing order of its layer.
+ * \param entity The entity modified.
+ */
+void Entities::notify_entity_drawing_order_changed(Entity& entity) {
+
+  const auto& it = entities_to_draw.find(entity.get_layer());
+  if (it != entities_to_draw.end()) {
+    it->second.sorted = false;
+  }
+}
+
+/**
+ * \brief Inserts an entity in the drawing list of its layer.
+ *
+ * The entity is inserted at its place in the drawing order
+ * if the list is currently sorted.
+ *
+ * \param entity The entity to add.
+ */
+void Entities::add_entity_to_draw(const EntityPtr& entity) {
+
+  EntitiesToDraw& entities = entities_to_draw[entity->get_layer()];
+  const auto& it = std::upper_bound(
+      entities.entities.begin(),
+      entities.entities.end(),
+      entity,
+      DrawingOrderComparator()
+  );
+  entities.entities.insert(it, entity);
+}
+
+/**
+ * \brief Removes an entity from the drawing list of a layer.
+ * \param entity The entity to remove.
+ * \param layer The layer where it was drawn.
+ * \return \c true if the entity was found and removed.
+ */
+bool Entities::remove_entity_to_draw(const EntityPtr& entity, int layer) {
+
+  EntityVector& entities = entities_to_draw[layer].entities;
+  const auto& it = std::find(entities.begin(), entities.end(), entity);
+  if (it == entities.end()) {
+    return false;
+  }
+
+  // Removing preserves the order of other entities.
+  entities.erase(it);
+  return true;
+}
+
+/**
+ * \brief Restores the drawing order of a layer.
+ *
+ * Few entities change their place in the drawing order between two cycles,
+ * so an insertion sort is used: it is linear on a list that is almost sorted.
+ * It is also stable, so equivalent entities keep their relative order.
+ *
+ * \param layer The layer to sort.
+ */
+void Entities::sort_entities_to_draw(int layer) {
+
+  EntitiesToDraw& entities_in_layer = entities_to_draw[layer];
+  EntityVector& entities = entities_in_layer.entities;
+  const DrawingOrderComparator comparator;
+  for (size_t i = 1; i < entities.size(); ++i) {
+    if (!comparator(entities[i], entities[i - 1])) {
+      // Already at its place.
+      continue;
+    }
+    EntityPtr entity = std::move(entities[i]);
+    size_t j = i;
+    while (j > 0 && comparator(entity, entities[j - 1])) {
+      entities[j] = std::move(entities[j - 1]);
+      --j;
+    }
+    entities[j] = std::move(entity);
+  }
+  entities_in_layer.sorted = true;
+}
+
+/**
+ * \brief Adds an entity to the list of its type and layer.
+ * \param entity The entity to add.
+ * \param layer The layer of the entity.
+ */
+void Entities::add_entity_by_type(const EntityPtr& entity, int layer) {
+
+  EntityVector& entities = entities_by_type[static_cast<size_t>(entity->get_type())][layer - map_min_layer];
+  entity->set_type_list_index(static_cast<int>(entities.size()));
+  entities.push_back(entity);
+
+  if (entity->get_type() == EntityType::SEPARATOR) {
+    separator_lines_outdated = true;
+  }
+}
+
+/**
+ * \brief Adds the entities of the batch to the quadtree.
+ *
+ * Entities created by create_entities() are added all at once at the end,
+ * or before a query if one happens before.
+ */
+void Entities::add_quadtree_batch() const {
+
+  if (quadtree_batch.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<EntityPtr, Rectangle>> elements;
+  elements.reserve(quadtree_batch.size());
+  for (const EntityPtr& entity: quadtree_batch) {
+    elements.emplace_back(entity, entity->get_max_bounding_box());
+  }
+  if (entity_grid != nullptr) {
+    entity_grid->add_all(elements);
+  }
+  else {
+    quadtree.add_all(elements);
+  }
+  quadtree_batch.clear();
+}
+
+/**
+ * \brief Removes an entity from the list of its type and layer.
+ *
+ * The last entity of the list takes its place.
+ *
+ * \param entity The entity to remove.
+ * \param layer The layer where the entity was.
+ */
+void Entities::remove_entity_by_type(const EntityPtr& entity, int layer) {
+
+  EntityVector& entities = entities_by_type[static_cast<size_t>(entity->get_type())][layer - map_min_layer];
+  size_t index = static_cast<size_t>(entity->get_type_list_index());
+  if (index >= entities.size() || entities[index] != entity) {
+    // The index is for the list of another map (this happens with the hero).
+    const auto& it = std::find(entities.begin(), entities.end(), entity);
+    if (it == entities.end()) {
+      return;
+    }
+    index = static_cast<size_t>(it - entities.begin());
+  }
+
+  if (index != entities.size() - 1) {
+    entities[index] = std::move(entities.back());
+    entities[index]->set_type_list_index(static_cast<int>(index));
+  }
+  entities.pop_back();
+  entity->set_type_list_index(-1);
+
+  if (entity->get_type() == EntityType::SEPARATOR) {
+    separator_lines_outdated = true;
+  }
 }
 
 /**
@@ -1340,27 +2347,254 @@ void Entities::notify_entity_bounding_box_changed(Entity& entity) {
  * \param rectangle A rectangle.
  * \return \c true if this rectangle overlaps a raised crystal block.
  */
-bool Entities::overlaps_raised_blocks(int layer, const Rectangle& rectangle) {
+bool Entities::overlaps_raised_blocks(int layer, const Rectangle& rectangle) const {
 
-  EntityVector entities_nearby;
-  get_entities_in_rectangle(rectangle, entities_nearby);
-  for (const EntityPtr& entity : entities_nearby) {
+  if (get_entities_by_type(EntityType::CRYSTAL_BLOCK, layer).empty()) {
+    return false;
+  }
 
-    if (entity->get_type() != EntityType::CRYSTAL_BLOCK) {
-      continue;
+  bool overlaps = false;
+  for_each_entity_in_rectangle(rectangle, [&overlaps, layer](const EntityPtr& entity) {
+
+    if (overlaps ||
+        entity->get_type() != EntityType::CRYSTAL_BLOCK ||
+        entity->get_layer() != layer) {
+      return;
     }
 
-    if (entity->get_layer() != layer) {
+    const CrystalBlock& crystal_block = static_cast<const CrystalBlock&>(*entity);
+    overlaps = crystal_block.is_raised();
+  });
+
+  return overlaps;
+}
+
+/**
+ * \brief Updates all crystal blocks to the current crystal state of the game.
+ *
+ * This is called when the state changes instead of having each block
+ * check it at every cycle.
+ */
+void Entities::notify_crystal_state_changed() {
+
+  const bool orange_raised = game.get_crystal_state();
+  for (CrystalBlock& crystal_block : get_entities_by_type<CrystalBlock>()) {
+    crystal_block.notify_crystal_state_changed(orange_raised);
+  }
+}
+
+/**
+ * \brief Returns the separators whose separation line crosses a rectangle.
+ *
+ * A vertical separator is returned if its line is strictly between the
+ * left and right sides of the rectangle and if it overlaps the rectangle
+ * vertically, and similarly for horizontal separators.
+ * Separators are found by binary search in lists sorted by position.
+ *
+ * \param[in] rectangle The rectangle to check.
+ * \param[out] result The vertical separators crossing it sorted by X,
+ * followed by the horizontal ones sorted by Y.
+ * The vector is cleared first.
+ */
+void Entities::get_separators_crossing(
+    const Rectangle& rectangle,
+    std::vector<const Separator*>& result
+) const {
+
+  result.clear();
+  update_separator_lines();
+
+  const int x = rectangle.get_x();
+  const int y = rectangle.get_y();
+  const int width = rectangle.get_width();
+  const int height = rectangle.get_height();
+  const auto is_before = [](int position, const SeparatorLine& line) {
+    return position < line.position;
+  };
+
+  auto it = std::upper_bound(
+      vertical_separator_lines.begin(), vertical_separator_lines.end(), x, is_before);
+  for (; it != vertical_separator_lines.end() && it->position < x + width; ++it) {
+    const Separator& separator = *it->separator;
+    if (separator.get_y() < y + height &&
+        y < separator.get_y() + separator.get_height()) {
+      result.push_back(&separator);
+    }
+  }
+
+  it = std::upper_bound(
+      horizontal_separator_lines.begin(), horizontal_separator_lines.end(), y, is_before);
+  for (; it != horizontal_separator_lines.end() && it->position < y + height; ++it) {
+    const Separator& separator = *it->separator;
+    if (separator.get_x() < x + width &&
+        x < separator.get_x() + separator.get_width()) {
+      result.push_back(&separator);
+    }
+  }
+}
+
+/**
+ * \brief Rebuilds the sorted lists of separators if separators have changed.
+ */
+void Entities::update_separator_lines() const {
+
+  if (!separator_lines_outdated) {
+    return;
+  }
+
+  vertical_separator_lines.clear();
+  horizontal_separator_lines.clear();
+  for (const Separator& separator: get_entities_by_type<Separator>()) {
+    if (separator.is_vertical()) {
+      vertical_separator_lines.push_back({ separator.get_x() + 8, &separator });
+    }
+    else {
+      horizontal_separator_lines.push_back({ separator.get_y() + 8, &separator });
+    }
+  }
+
+  const auto compare = [](const SeparatorLine& first, const SeparatorLine& second) {
+    return first.position < second.position;
+  };
+  std::stable_sort(vertical_separator_lines.begin(), vertical_separator_lines.end(), compare);
+  std::stable_sort(horizontal_separator_lines.begin(), horizontal_separator_lines.end(), compare);
+  separator_lines_outdated = false;
+}
+
+/**
+ * \brief Returns whether collisions with detectors are checked once per cycle.
+ *
+ * See add_pending_collision_check().
+ *
+ * \return \c true if the quest enables the collision broad phase.
+ */
+bool Entities::is_collision_broad_phase_enabled() const {
+  return collision_broad_phase;
+}
+
+/**
+ * \brief Records that an entity needs its collisions with detectors to be
+ * checked, in both directions.
+ *
+ * The check is done at the end of the current cycle of entities.
+ * This is only used when the collision broad phase is enabled.
+ *
+ * \param entity An entity that moved or changed.
+ */
+void Entities::add_pending_collision_check(Entity& entity) {
+
+  pending_collision_checks.push_back(&entity);
+}
+
+/**
+ * \brief Checks the collisions of entities that moved or changed during
+ * this cycle.
+ *
+ * A sort and sweep along the x axis finds once all pairs of entities
+ * whose boxes overlap and where at least one of them is pending.
+ * Detectors then test their collision modes on these pairs,
+ * sorted by layer and Z order of the detector and then of the other entity
+ * so that notifications happen in a deterministic order.
+ *
+ * Entities moved by collision callbacks are checked at the next cycle.
+ */
+void Entities::check_pending_collisions() {
+
+  if (pending_collision_checks.empty()) {
+    return;
+  }
+
+  EntityPointerVector pending;
+  pending.swap(pending_collision_checks);
+
+  if (map.is_suspended()) {
+    // Like before batching, changes made while the map is suspended
+    // are not checked: these pending checks are dropped.
+    return;
+  }
+
+  std::sort(pending.begin(), pending.end());
+  pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+  /**
+   * \brief An entity in the sweep.
+   */
+  struct SweepItem {
+    Rectangle box;      /**< Extended box of the entity. */
+    Entity* entity;     /**< The entity. */
+    bool pending;       /**< Whether it moved or changed during this cycle. */
+  };
+
+  // The boxes come from the transform arrays, which contain the hero
+  // and all other entities.
+  std::vector<SweepItem> items;
+  items.reserve(transforms.get_num_slots());
+  for (size_t slot = 0; slot < transforms.get_num_slots(); ++slot) {
+    Entity& entity = transforms.get_entity(slot);
+    if (entity.is_being_removed() || !entity.is_enabled()) {
       continue;
     }
+    Rectangle box = transforms.get_max_bounding_box(slot);
+    box.add_xy(-8, -8);
+    box.add_width(16);
+    box.add_height(16);
+    const bool is_pending = std::binary_search(pending.begin(), pending.end(), &entity);
+    items.push_back({ box, &entity, is_pending });
+  }
 
-    const CrystalBlock& crystal_block = static_cast<CrystalBlock&>(*entity);
-    if (crystal_block.is_raised()) {
-      return true;
+  std::sort(items.begin(), items.end(), [](const SweepItem& first, const SweepItem& second) {
+    return first.box.get_x() < second.box.get_x();
+  });
+
+  // Find candidate pairs (detector, entity).
+  std::vector<std::pair<Entity*, Entity*>> pairs;
+  for (size_t i = 0; i < items.size(); ++i) {
+    const SweepItem& first = items[i];
+    const int max_x = first.box.get_right();
+    for (size_t j = i + 1; j < items.size() && items[j].box.get_x() < max_x; ++j) {
+      const SweepItem& second = items[j];
+      if (!first.pending && !second.pending) {
+        continue;
+      }
+      if (!first.box.overlaps(second.box)) {
+        continue;
+      }
+      if (first.entity->is_detector()) {
+        pairs.emplace_back(first.entity, second.entity);
+      }
+      if (second.entity->is_detector()) {
+        pairs.emplace_back(second.entity, first.entity);
+      }
     }
   }
 
-  return false;
+  const ZOrderComparator z_order(*this);
+  std::sort(pairs.begin(), pairs.end(), [&z_order](
+      const std::pair<Entity*, Entity*>& first,
+      const std::pair<Entity*, Entity*>& second
+  ) {
+    if (first.first != second.first) {
+      return z_order(first.first, second.first);
+    }
+    return z_order(first.second, second.second);
+  });
+
+  // Narrow phase.
+  for (const std::pair<Entity*, Entity*>& pair: pairs) {
+    Entity& detector = *pair.first;
+    Entity& entity = *pair.second;
+    if (map.is_suspended()) {
+      return;
+    }
+    if (detector.is_being_removed() ||
+        !detector.is_enabled() ||
+        detector.is_suspended() ||
+        entity.is_being_removed() ||
+        !entity.is_enabled()) {
+      continue;
+    }
+    detector.check_collision(entity);
+  }
 }
 
 /**
@@ -1378,18 +2612,19 @@ Entities::ZCache::ZCache() :
  * \param entity An entity of the map. It must be in the structure.
  * \return Its relative Z order.
  */
-int Entities::ZCache::get_z(const ConstEntityPtr& entity) const {
+int Entities::ZCache::get_z(const Entity& entity) const {
 
-  SOLARUS_ASSERT(z_values.find(entity) != z_values.end(),
+  const auto& it = z_values.find(&entity);
+  SOLARUS_ASSERT(it != z_values.end(),
       std::string("No such entity in Z cache: " +
-          entity->get_lua_type_name() +
+          entity.get_lua_type_name() +
           " '" +
-          entity->get_name() +
+          entity.get_name() +
           "'"
       )
   );
 
-  return z_values.at(entity);
+  return it->second;
 }
 
 /**
@@ -1397,10 +2632,10 @@ int Entities::ZCache::get_z(const ConstEntityPtr& entity) const {
  *
  * Nothing happens if the entity was already present.
  */
-void Entities::ZCache::add(const ConstEntityPtr& entity) {
+void Entities::ZCache::add(const Entity& entity) {
 
   ++max;
-  z_values.insert(std::make_pair(entity, max));
+  z_values.insert(std::make_pair(&entity, max));
 }
 
 /**
@@ -1408,9 +2643,9 @@ void Entities::ZCache::add(const ConstEntityPtr& entity) {
  *
  * Nothing happens if the entity was not present.
  */
-void Entities::ZCache::remove(const ConstEntityPtr& entity) {
+void Entities::ZCache::remove(const Entity& entity) {
 
-  z_values.erase(entity);
+  z_values.erase(&entity);
   // Z values remain unchanged: removing an entity does not break the order.
 }
 
@@ -1419,7 +2654,7 @@ void Entities::ZCache::remove(const ConstEntityPtr& entity) {
  *
  * It will then have a Z order greater than all other entities in the structure.
  */
-void Entities::ZCache::bring_to_front(const ConstEntityPtr& entity) {
+void Entities::ZCache::bring_to_front(const Entity& entity) {
 
   remove(entity);
   add(entity);
@@ -1430,11 +2665,11 @@ void Entities::ZCache::bring_to_front(const ConstEntityPtr& entity) {
  *
  * It will then have a Z order lower than all other entities in the structure.
  */
-void Entities::ZCache::bring_to_back(const ConstEntityPtr& entity) {
+void Entities::ZCache::bring_to_back(const Entity& entity) {
 
   remove(entity);
   --min;
-  z_values.insert(std::make_pair(entity, min));
+  z_values.insert(std::make_pair(&entity, min));
 }
 
 }
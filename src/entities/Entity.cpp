@@ -19,6 +19,8 @@
 #include "solarus/core/Geometry.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/MemoryStats.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/CollisionMode.h"
 #include "solarus/entities/Destructible.h"
@@ -38,6 +40,7 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/Movement.h"
 #include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <list>
 #include <utility>
@@ -62,13 +65,21 @@ Entity::Entity(
   main_loop(nullptr),
   map(nullptr),
   layer(layer),
+  type_list_index(-1),
+  transform_slot(-1),
   bounding_box(xy, size),
+  previous_xy(xy),
   ground_below(Ground::EMPTY),
   origin(0, 0),
   name(name),
   direction(direction),
   user_properties(),
   sprites(),
+  max_bounding_box(xy, size),
+  max_bounding_box_outdated(true),
+  max_bounding_box_base(),
+  max_bounding_box_xy(),
+  max_bounding_box_stamps(),
   default_sprite_name(),
   visible(true),
   drawn_in_y_order(false),
@@ -84,10 +95,16 @@ Entity::Entity(
   suspended(false),
   when_suspended(0),
   optimization_distance(default_optimization_distance),
-  optimization_distance2(default_optimization_distance * default_optimization_distance) {
+  optimization_distance2(default_optimization_distance * default_optimization_distance),
+  always_active(false),
+  dormant(false),
+  random_stream() {
 
   Debug::check_assertion(size.width % 8 == 0 && size.height % 8 == 0,
       "Invalid entity size: width and height must be multiple of 8");
+
+  // Only the common part: derived types are not known here.
+  MemoryStats::add(MemoryStats::Category::ENTITIES, sizeof(Entity));
 }
 
 /**
@@ -97,6 +114,7 @@ Entity::Entity(
  */
 Entity::~Entity() {
 
+  MemoryStats::remove(MemoryStats::Category::ENTITIES, sizeof(Entity));
   stop_stream_action();
 
   clear_sprites();
@@ -172,9 +190,9 @@ void Entity::update_ground_observers() {
 
   // Update overlapping entities that are sensible to their ground.
   const Rectangle& box = get_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
+  EntityPointerVector entities_nearby;
   get_entities().get_entities_in_rectangle(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  for (Entity* entity_nearby: entities_nearby) {
 
     if (!entity_nearby->is_ground_observer()) {
       // The entity does not care about the ground below it.
@@ -276,7 +294,15 @@ bool Entity::is_drawn_in_y_order() const {
  * as the hero.
  */
 void Entity::set_drawn_in_y_order(bool drawn_in_y_order) {
+
+  if (drawn_in_y_order == this->drawn_in_y_order) {
+    return;
+  }
+
   this->drawn_in_y_order = drawn_in_y_order;
+  if (is_on_map()) {
+    get_entities().notify_entity_drawing_order_changed(*this);
+  }
 }
 
 /**
@@ -323,7 +349,9 @@ void Entity::set_map(Map& map) {
 
   this->ground_below = Ground::EMPTY;
 
-  if (!initialized && map.is_loaded()) {
+  if (!initialized &&
+      map.is_loaded() &&
+      !map.get_entities().is_creation_batch_started()) {
     // The entity is being created on a map already running.
     // In this case, we are ready to finish the initialization right now.
     finish_initialization();
@@ -421,9 +449,9 @@ void Entity::notify_map_opening_transition_finished() {
  */
 void Entity::notify_tileset_changed() {
 
-  for (const SpritePtr& sprite: get_sprites()) {
+  for_each_sprite([&](const SpritePtr& sprite) {
     sprite->set_tileset(get_map().get_tileset());
-  }
+  });
 }
 
 /**
@@ -587,6 +615,54 @@ void Entity::set_layer(int layer) {
   notify_layer_changed();
 }
 
+/**
+ * \brief Returns the position of the entity in the list of its type
+ * and layer kept by the map.
+ *
+ * This is only used by Entities to remove entities quickly.
+ *
+ * \return The position in the list, or -1.
+ */
+int Entity::get_type_list_index() const {
+  return type_list_index;
+}
+
+/**
+ * \brief Sets the position of the entity in the list of its type
+ * and layer kept by the map.
+ *
+ * This is only used by Entities.
+ *
+ * \param index The position in the list, or -1.
+ */
+void Entity::set_type_list_index(int index) {
+  this->type_list_index = index;
+}
+
+/**
+ * \brief Returns the position of the entity in the transform arrays
+ * kept by the map.
+ *
+ * This is only used by EntityTransforms.
+ *
+ * \return The slot, or -1.
+ */
+int Entity::get_transform_slot() const {
+  return transform_slot;
+}
+
+/**
+ * \brief Sets the position of the entity in the transform arrays
+ * kept by the map.
+ *
+ * This is only used by EntityTransforms.
+ *
+ * \param slot The slot, or -1.
+ */
+void Entity::set_transform_slot(int slot) {
+  this->transform_slot = slot;
+}
+
 /**
  * \brief This function is called when the layer of this entity has just changed.
  *
@@ -809,6 +885,61 @@ void Entity::set_top_left_xy(const Point& xy) {
   return get_movement()->get_displayed_xy();
 }
 
+/**
+ * \brief Remembers the current position as the one of the previous
+ * simulation step.
+ *
+ * This function is called at the beginning of each simulation step.
+ * The position saved is used to interpolate drawings between two steps.
+ */
+void Entity::store_previous_xy() {
+  previous_xy = get_xy();
+}
+
+/**
+ * \brief Returns the position of the origin point interpolated between the
+ * previous simulation step and the current one.
+ *
+ * When render interpolation is disabled, this is the same as get_xy().
+ * When the entity moved too far since the previous step (for example because
+ * it was teleported), no interpolation is done.
+ *
+ * \return The interpolated coordinates of the entity on the map.
+ */
+Point Entity::get_interpolated_xy() const {
+
+  const Point& xy = get_xy();
+  const double factor = System::get_interpolation_factor();
+  if (factor >= 1.0) {
+    return xy;
+  }
+
+  const Point delta = xy - previous_xy;
+  if (std::abs(delta.x) > max_interpolation_distance ||
+      std::abs(delta.y) > max_interpolation_distance) {
+    return xy;
+  }
+
+  return {
+      previous_xy.x + static_cast<int>(std::lround(delta.x * factor)),
+      previous_xy.y + static_cast<int>(std::lround(delta.y * factor))
+  };
+}
+
+/**
+ * \brief Returns the coordinates where this entity should be drawn,
+ * interpolated between the previous simulation step and the current one.
+ *
+ * This is get_displayed_xy() with the same interpolation offset as
+ * get_interpolated_xy().
+ *
+ * \return The interpolated coordinates where to draw the entity.
+ */
+Point Entity::get_interpolated_displayed_xy() const {
+
+  return get_displayed_xy() + (get_interpolated_xy() - get_xy());
+}
+
 /**
  * \brief Returns the width of the entity.
  * \return the width of the entity
@@ -913,19 +1044,66 @@ Rectangle Entity::get_extended_bounding_box(int margin) const {
  * this function to return a correct bounding box, otherwise sprite collisions
  * may fail to be detected.
  *
+ * The result is cached until the position, the sprites, the offset of a
+ * sprite or the animation set of a sprite change.
+ *
  * \return The bounding box of the entity including its sprites.
  */
 Rectangle Entity::get_max_bounding_box() const {
 
-  Rectangle result = get_bounding_box();
-  for (const SpritePtr& sprite: get_sprites()) {
+  if (!is_max_bounding_box_outdated()) {
+    return max_bounding_box;
+  }
+
+  max_bounding_box = get_bounding_box();
+  max_bounding_box_base = get_bounding_box();
+  max_bounding_box_xy = get_xy();
+  max_bounding_box_stamps.clear();
+  for_each_sprite([&](const SpritePtr& sprite) {
     Rectangle box = sprite->get_max_bounding_box();
     box.add_xy(sprite->get_xy());  // Take into account the sprite's own offset.
     box.add_xy(get_xy());  // Take into account the coordinates of the entity.
-    result |= box;
-    // TODO when the sprite's offset changes, update the bounding box
+    max_bounding_box |= box;
+    max_bounding_box_stamps.push_back({ sprite->get_xy(), &sprite->get_animation_set() });
+  });
+  max_bounding_box_outdated = false;
+  return max_bounding_box;
+}
+
+/**
+ * \brief Returns whether get_max_bounding_box() has to be computed again.
+ *
+ * Sprite offsets can be changed from Lua without the entity knowing,
+ * so what the box depends on is compared instead.
+ * This is cheaper than computing the box and does not allocate.
+ *
+ * \return \c true if something the cached box depends on has changed.
+ */
+bool Entity::is_max_bounding_box_outdated() const {
+
+  if (max_bounding_box_outdated ||
+      max_bounding_box_base != get_bounding_box() ||
+      max_bounding_box_xy != get_xy()) {
+    return true;
   }
-  return result;
+
+  size_t i = 0;
+  for (const NamedSprite& named_sprite: sprites) {
+    if (named_sprite.removed) {
+      continue;
+    }
+    if (i >= max_bounding_box_stamps.size()) {
+      return true;
+    }
+    const Sprite& sprite = *named_sprite.sprite;
+    const SpriteBoxStamp& stamp = max_bounding_box_stamps[i];
+    if (stamp.xy != sprite.get_xy() ||
+        stamp.animation_set != &sprite.get_animation_set()) {
+      return true;
+    }
+    ++i;
+  }
+  return i != max_bounding_box_stamps.size();
 }
 
 /**
@@ -1159,7 +1337,7 @@ bool Entity::has_name() const {
  * \return true if the name starts with this prefix
  */
 bool Entity::has_prefix(const std::string& prefix) const {
-  return name.substr(0, prefix.size()) == prefix;
+  return name.compare(0, prefix.size(), prefix) == 0;
 }
 
 /**
@@ -1225,6 +1403,94 @@ void Entity::set_optimization_distance(int distance) {
   this->optimization_distance2 = distance * distance;
 }
 
+/**
+ * \brief Returns whether this entity is updated wherever it is.
+ *
+ * If no, the entity becomes dormant when it is farther from the camera
+ * than its optimization distance, or than the activity distance of the map
+ * if it has no optimization distance.
+ *
+ * \return \c true if this entity never becomes dormant.
+ */
+bool Entity::is_always_active() const {
+  return always_active;
+}
+
+/**
+ * \brief Sets whether this entity is updated wherever it is.
+ *
+ * A dormant entity is woken up at the next update of the map.
+ *
+ * \param always_active \c true so that this entity never becomes dormant.
+ */
+void Entity::set_always_active(bool always_active) {
+  this->always_active = always_active;
+}
+
+/**
+ * \brief Returns whether this entity is dormant.
+ *
+ * Dormant entities are suspended and not updated because they are
+ * too far from the camera.
+ *
+ * \return \c true if this entity is dormant.
+ */
+bool Entity::is_dormant() const {
+  return dormant;
+}
+
+/**
+ * \brief Makes this entity dormant or wakes it up.
+ *
+ * This is only used by Entities.
+ * The entity is suspended like when the map is suspended, so that its
+ * movement, sprites and timers resume where they were when it wakes up.
+ *
+ * \param dormant \c true to make this entity dormant.
+ */
+void Entity::set_dormant(bool dormant) {
+
+  if (dormant == this->dormant) {
+    return;
+  }
+
+  this->dormant = dormant;
+  set_suspended(dormant || (is_on_map() && get_map().is_suspended()));
+}
+
+/**
+ * \brief Returns the random numbers of this entity.
+ *
+ * The stream is current while the entity is updated, so that the random
+ * decisions of its movement and behavior only depend on the entity itself,
+ * whatever the order of updates of other entities.
+ *
+ * \return The random stream of this entity.
+ */
+Random::Stream& Entity::get_random_stream() {
+  return random_stream;
+}
+
+/**
+ * \brief Returns the random numbers of this entity.
+ * \return The random stream of this entity.
+ */
+const Random::Stream& Entity::get_random_stream() const {
+  return random_stream;
+}
+
+/**
+ * \brief Sets the random numbers of this entity.
+ *
+ * This is only used by Entities, which derives a stream for each entity
+ * from the seed of the map.
+ *
+ * \param random_stream The random stream to use.
+ */
+void Entity::set_random_stream(const Random::Stream& random_stream) {
+  this->random_stream = random_stream;
+}
+
 /**
  * \brief Returns the user-defined properties of this entity.
  * \return The user-defined properties.
@@ -1400,7 +1666,9 @@ SpritePtr Entity::create_sprite(
     const std::string& animation_set_id,
     const std::string& sprite_name
 ) {
-  SpritePtr sprite = std::make_shared<Sprite>(animation_set_id);
+  // Sprites of short-lived entities like pickables and projectiles
+  // are created very often.
+  SpritePtr sprite = make_recycled_shared<Sprite>(animation_set_id);
 
   NamedSprite named_sprite;
   named_sprite.name = sprite_name;
@@ -1740,8 +2008,9 @@ void Entity::notify_position_changed() {
   }
   update_ground_below();
 
-  // Notify Lua.
-  if (are_movement_notifications_enabled()) {
+  // Notify Lua, unless the movement does it once at its next update.
+  if (are_movement_notifications_enabled() &&
+      (movement == nullptr || !movement->is_position_notification_pending())) {
     get_lua_context()->entity_on_position_changed(*this, get_xy(), get_layer());
   }
 }
@@ -1920,10 +2189,14 @@ void Entity::check_collision(Entity& other, Sprite& other_sprite) {
 
   // We check the collision between the specified entity's sprite and
   // all sprites of the current entity.
-  // Make a copy of the sprites list in case it gets reallocated while
-  // traversing it.
-  std::vector<SpritePtr> this_sprites = get_sprites();
-  for (const SpritePtr& this_sprite: this_sprites) {
+  // Sprites may be created by notify_collision(): iterate on indexes
+  // and hold each sprite in case the list gets reallocated.
+  for (size_t i = 0; i < sprites.size(); ++i) {
+
+    if (sprites[i].removed) {
+      continue;
+    }
+    const SpritePtr this_sprite = sprites[i].sprite;
 
     if (!this_sprite->is_animation_started()) {
       continue;
@@ -1974,10 +2247,14 @@ void Entity::check_collision(Sprite& this_sprite, Entity& other) {
 
   // We check the collision between the specified detector's sprite and
   // all sprites of the other entity.
-  // Make a copy of the sprites list in case it gets reallocated while
-  // traversing it.
-  std::vector<SpritePtr> other_sprites = other.get_sprites();
-  for (const SpritePtr& other_sprite: other_sprites) {
+  // Sprites may be created by notify_collision(): iterate on indexes
+  // and hold each sprite in case the list gets reallocated.
+  for (size_t i = 0; i < other.sprites.size(); ++i) {
+
+    if (other.sprites[i].removed) {
+      continue;
+    }
+    const SpritePtr other_sprite = other.sprites[i].sprite;
 
     if (!other_sprite->is_animation_started()) {
       continue;
@@ -3008,6 +3285,31 @@ int Entity::get_distance(const Entity& other) const {
   return (int) Geometry::get_distance(get_xy(), other.get_xy());
 }
 
+/**
+ * \brief Returns the distance between the center of this entity and the
+ * visible part of the map.
+ * \return The distance in pixels, 0 if the center is visible.
+ */
+int Entity::get_distance_to_camera() const {
+
+  const CameraPtr& camera = get_map().get_camera();
+  if (camera == nullptr) {
+    return 0;
+  }
+
+  const Rectangle& visible_area = camera->get_bounding_box();
+  const Point& center = get_center_point();
+  const int dx = std::max(0, std::max(
+      visible_area.get_x() - center.x,
+      center.x - (visible_area.get_x() + visible_area.get_width())
+  ));
+  const int dy = std::max(0, std::max(
+      visible_area.get_y() - center.y,
+      center.y - (visible_area.get_y() + visible_area.get_height())
+  ));
+  return (int) std::sqrt(dx * dx + dy * dy);
+}
+
 /**
  * \brief Returns whether this entity is in the same region as another one.
  *
@@ -3036,14 +3338,12 @@ bool Entity::is_in_same_region(const Point& xy) const {
   const Point& this_xy = get_center_point();
   const Point& other_xy = xy;
 
-  const std::set<ConstSeparatorPtr>& separators =
-      get_entities().get_entities_by_type<Separator>();
-  for (const ConstSeparatorPtr& separator: separators) {
+  for (const Separator& separator: get_entities().get_entities_by_type<Separator>()) {
 
-    if (separator->is_vertical()) {
+    if (separator.is_vertical()) {
       // Vertical separation.
-      if (this_xy.y < separator->get_top_left_y() ||
-          this_xy.y >= separator->get_top_left_y() + separator->get_height()) {
+      if (this_xy.y < separator.get_top_left_y() ||
+          this_xy.y >= separator.get_top_left_y() + separator.get_height()) {
         // This separator is irrelevant: the entity is not in either side,
         // it is too much to the north or to the south.
         //
@@ -3056,8 +3356,8 @@ bool Entity::is_in_same_region(const Point& xy) const {
         continue;
       }
 
-      if (other_xy.y < separator->get_top_left_y() ||
-          other_xy.y >= separator->get_top_left_y() + separator->get_height()) {
+      if (other_xy.y < separator.get_top_left_y() ||
+          other_xy.y >= separator.get_top_left_y() + separator.get_height()) {
         // This separator is irrelevant: the other entity is not in either side.
         // it is too much to the north or to the south.
         continue;
@@ -3065,7 +3365,7 @@ bool Entity::is_in_same_region(const Point& xy) const {
 
       // Both entities are in the zone of influence of this separator.
       // See if they are in the same side.
-      const int separation_x = separator->get_center_point().x;
+      const int separation_x = separator.get_center_point().x;
       if (this_xy.x < separation_x &&
           separation_x <= other_xy.x) {
         // Different side.
@@ -3080,17 +3380,17 @@ bool Entity::is_in_same_region(const Point& xy) const {
     }
     else {
       // Horizontal separation.
-      if (this_xy.x < separator->get_top_left_x() ||
-          this_xy.x >= separator->get_top_left_x() + separator->get_width()) {
+      if (this_xy.x < separator.get_top_left_x() ||
+          this_xy.x >= separator.get_top_left_x() + separator.get_width()) {
         continue;
       }
 
-      if (other_xy.x < separator->get_top_left_x() ||
-          other_xy.x >= separator->get_top_left_x() + separator->get_width()) {
+      if (other_xy.x < separator.get_top_left_x() ||
+          other_xy.x >= separator.get_top_left_x() + separator.get_width()) {
         continue;
       }
 
-      const int separation_y = separator->get_center_point().y;
+      const int separation_y = separator.get_center_point().y;
       if (this_xy.y < separation_y &&
           separation_y <= other_xy.y) {
         return false;
@@ -3491,8 +3791,8 @@ void Entity::update() {
   }
   clear_old_sprites();
 
-  // Update the movement.
-  if (movement != nullptr) {
+  // Update the movement if it has something to do.
+  if (movement != nullptr && movement->is_update_needed(System::now())) {
     movement->update();
   }
   clear_old_movements();
@@ -3535,6 +3835,24 @@ void Entity::update_sprite(Sprite& sprite) {
   }
 }
 
+/**
+ * \brief Appends the sprites of this entity whose frames can be precomputed
+ * in parallel before the update.
+ * \param[out] result The vector to append to.
+ */
+void Entity::get_sprites_to_precompute(std::vector<Sprite*>& result) const {
+
+  if (is_being_removed()) {
+    return;
+  }
+
+  for (const NamedSprite& named_sprite: sprites) {
+    if (!named_sprite.removed && named_sprite.sprite->can_precompute_frames()) {
+      result.push_back(named_sprite.sprite.get());
+    }
+  }
+}
+
 /**
  * \brief Returns whether this entity is drawn at its position on the map.
  *
@@ -3566,7 +3884,7 @@ void Entity::draw_on_map() {
       continue;
     }
     Sprite& sprite = *named_sprite.sprite;
-    get_map().draw_visual(sprite, get_displayed_xy());
+    get_map().draw_visual(sprite, get_interpolated_displayed_xy());
   }
 }
 
@@ -689,11 +689,13 @@ bool EntityData::is_string(const std::string& key) const {
 const std::string& EntityData::get_string(const std::string& key) const {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::STRING,
-      "Field '" + key + "' is not a string");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::STRING, [&] {
+    return "Field '" + key + "' is not a string";
+  });
 
   return it->second.string_value;
 }
@@ -707,11 +709,13 @@ const std::string& EntityData::get_string(const std::string& key) const {
 void EntityData::set_string(const std::string& key, const std::string& value) {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::STRING,
-      "Field '" + key + "' is not a string");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::STRING, [&] {
+    return "Field '" + key + "' is not a string";
+  });
 
   it->second.string_value = value;
 }
@@ -739,11 +743,13 @@ bool EntityData::is_integer(const std::string& key) const {
 int EntityData::get_integer(const std::string& key) const {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::INTEGER,
-      "Field '" + key + "' is not a string");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::INTEGER, [&] {
+    return "Field '" + key + "' is not a string";
+  });
 
   return it->second.int_value;
 }
@@ -757,11 +763,13 @@ int EntityData::get_integer(const std::string& key) const {
 void EntityData::set_integer(const std::string& key, int value) {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::INTEGER,
-      "Field '" + key + "' is not an integer");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::INTEGER, [&] {
+    return "Field '" + key + "' is not an integer";
+  });
 
   it->second.int_value = value;
 }
@@ -789,11 +797,13 @@ bool EntityData::is_boolean(const std::string& key) const {
 bool EntityData::get_boolean(const std::string& key) const {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::BOOLEAN,
-      "Field '" + key + "' is not a boolean");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::BOOLEAN, [&] {
+    return "Field '" + key + "' is not a boolean";
+  });
 
   return it->second.int_value != 0;
 }
@@ -807,11 +817,13 @@ bool EntityData::get_boolean(const std::string& key) const {
 void EntityData::set_boolean(const std::string& key, bool value) {
 
   const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
+  Debug::check_assertion_lazy(it != specific_properties.end(), [&] {
+    return "No such entity field in " + get_type_name() + ": '" + key + "'";
+  });
 
-  Debug::check_assertion(it->second.value_type == EntityFieldType::BOOLEAN,
-      "Field '" + key + "' is not an boolean");
+  Debug::check_assertion_lazy(it->second.value_type == EntityFieldType::BOOLEAN, [&] {
+    return "Field '" + key + "' is not an boolean";
+  });
 
   it->second.int_value = value ? 1 : 0;
 }
@@ -20,6 +20,7 @@
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/EntityState.h"
 #include "solarus/entities/Hero.h"
@@ -49,6 +50,25 @@ Entity::State::State(Entity& entity, const std::string& state_name):
 
 }
 
+/**
+ * \brief Allocates the memory of a state, reusing the one of a previous
+ * state of the same size if possible.
+ * \param size Size of the state object.
+ * \return The memory to construct the state in.
+ */
+void* Entity::State::operator new(std::size_t size) {
+  return RecyclingPool::allocate(size);
+}
+
+/**
+ * \brief Frees the memory of a state, keeping it for the next states.
+ * \param state A destroyed state.
+ * \param size Size of the state object.
+ */
+void Entity::State::operator delete(void* state, std::size_t size) {
+  RecyclingPool::deallocate(state, size);
+}
+
 /**
  * \brief Destructor.
  *
@@ -209,8 +229,9 @@ void Entity::State::start(const State* /* previous_state */) {
  */
 void Entity::State::stop(const State* /* next_state */) {
 
-  Debug::check_assertion(!is_stopping(),
-      std::string("This state is already stopping: ") + get_name());
+  Debug::check_assertion_lazy(!is_stopping(), [&] {
+    return std::string("This state is already stopping: ") + get_name();
+  });
 
   this->stopping = true;
 }
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/EntityStreaming.h"
+#include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <limits>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns a rectangle enlarged on all sides.
+ * \param rectangle A rectangle.
+ * \param margin Number of pixels to add on each side.
+ * \return The enlarged rectangle.
+ */
+Rectangle get_enlarged(const Rectangle& rectangle, int margin) {
+
+  return Rectangle(
+      rectangle.get_x() - margin,
+      rectangle.get_y() - margin,
+      rectangle.get_width() + 2 * margin,
+      rectangle.get_height() + 2 * margin
+  );
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates the chunks of a map.
+ * \param map The map. Its size must be known.
+ * \param chunk_size Side of a chunk in pixels.
+ */
+EntityStreaming::EntityStreaming(Map& map, int chunk_size):
+  map(map),
+  chunk_size(chunk_size),
+  num_columns((map.get_width() + chunk_size - 1) / chunk_size),
+  num_rows((map.get_height() + chunk_size - 1) / chunk_size),
+  chunks(),
+  records_by_entity() {
+
+  Debug::check_assertion(chunk_size > 0, "Invalid chunk size");
+  num_columns = std::max(num_columns, 1);
+  num_rows = std::max(num_rows, 1);
+  chunks.resize(num_columns * num_rows);
+}
+
+/**
+ * \brief Returns whether an entity of the map data can be streamed.
+ * \param entity_data Description of an entity.
+ * \return \c true if the entity can be created and dropped by chunks.
+ */
+bool EntityStreaming::can_be_streamed(const EntityData& entity_data) {
+
+  switch (entity_data.get_type()) {
+
+    case EntityType::TILE:
+    case EntityType::DESTINATION:
+    case EntityType::SEPARATOR:
+      return false;
+
+    default:
+      return !entity_data.has_name();
+  }
+}
+
+/**
+ * \brief Returns the side of the chunks.
+ * \return The chunk size in pixels.
+ */
+int EntityStreaming::get_chunk_size() const {
+  return chunk_size;
+}
+
+/**
+ * \brief Returns the number of entities currently created by streaming.
+ * \return The number of entities created and not dropped or removed yet.
+ */
+int EntityStreaming::get_num_entities() const {
+  return static_cast<int>(records_by_entity.size());
+}
+
+/**
+ * \brief Stores an entity of the map data in its chunk.
+ *
+ * The entity will be created when the camera is close.
+ *
+ * \param entity_data Description of an entity that can be streamed.
+ */
+void EntityStreaming::add_entity_data(const EntityData& entity_data) {
+
+  Debug::check_assertion(can_be_streamed(entity_data), "This entity cannot be streamed");
+
+  const Point& xy = entity_data.get_xy();
+  const int column = std::min(std::max(xy.x / chunk_size, 0), num_columns - 1);
+  const int row = std::min(std::max(xy.y / chunk_size, 0), num_rows - 1);
+  Record record;
+  record.data = entity_data;
+  chunks[row * num_columns + column].records.push_back(record);
+}
+
+/**
+ * \brief Creates entities of chunks near the visible area and drops
+ * entities of chunks far from it.
+ *
+ * Chunks that overlap the visible area or are next to it are created.
+ * Chunks farther than two chunks from the visible area are dropped.
+ *
+ * \param visible_area The rectangle of the map seen by the camera.
+ * \param all_at_once \c true to create all entities needed right now,
+ * \c false to only create a few of them, the next ones being created
+ * by the next calls.
+ */
+void EntityStreaming::update(const Rectangle& visible_area, bool all_at_once) {
+
+  const Rectangle load_box = get_enlarged(visible_area, chunk_size);
+  const Rectangle keep_box = get_enlarged(visible_area, 2 * chunk_size);
+  int budget = all_at_once ?
+      std::numeric_limits<int>::max() : max_entities_created_per_update;
+
+  // Visible chunks first.
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (get_chunk_box(i).overlaps(visible_area)) {
+      load_chunk(i, budget);
+    }
+  }
+
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    const Rectangle& chunk_box = get_chunk_box(i);
+    if (chunk_box.overlaps(load_box)) {
+      load_chunk(i, budget);
+    }
+    else if (!chunk_box.overlaps(keep_box)) {
+      unload_chunk(i);
+    }
+  }
+}
+
+/**
+ * \brief Notifies this object that an entity is being removed from the map.
+ *
+ * If the entity was created here, it will not be created again.
+ *
+ * \param entity The entity removed.
+ */
+void EntityStreaming::notify_entity_removed(const Entity& entity) {
+
+  const auto& it = records_by_entity.find(&entity);
+  if (it == records_by_entity.end()) {
+    // Not created here, or dropped by unload_chunk().
+    return;
+  }
+
+  Record& record = chunks[it->second.first].records[it->second.second];
+  record.entity = nullptr;
+  record.removed = true;
+  records_by_entity.erase(it);
+}
+
+/**
+ * \brief Returns the rectangle of a chunk.
+ * \param chunk_index Index of a chunk.
+ * \return The position and size of the chunk on the map.
+ */
+Rectangle EntityStreaming::get_chunk_box(size_t chunk_index) const {
+
+  const int row = static_cast<int>(chunk_index) / num_columns;
+  const int column = static_cast<int>(chunk_index) % num_columns;
+  return Rectangle(column * chunk_size, row * chunk_size, chunk_size, chunk_size);
+}
+
+/**
+ * \brief Creates entities of a chunk that are not created yet.
+ * \param chunk_index Index of a chunk.
+ * \param[in,out] budget Maximum number of entities to create.
+ * Decremented for each entity created.
+ */
+void EntityStreaming::load_chunk(size_t chunk_index, int& budget) {
+
+  Chunk& chunk = chunks[chunk_index];
+  LuaContext& lua_context = map.get_lua_context();
+  while (chunk.num_loaded < chunk.records.size() && budget > 0) {
+    const size_t record_index = chunk.num_loaded;
+    ++chunk.num_loaded;
+
+    // The creation may run Lua code: don't keep references to the record.
+    if (chunk.records[record_index].removed ||
+        chunk.records[record_index].entity != nullptr) {
+      continue;
+    }
+
+    --budget;
+    EntityPtr entity = lua_context.create_map_entity(
+        map, chunk.records[record_index].data
+    );
+    if (entity == nullptr) {
+      // For example a pickable treasure already obtained.
+      continue;
+    }
+    chunks[chunk_index].records[record_index].entity = entity.get();
+    records_by_entity[entity.get()] = std::make_pair(chunk_index, record_index);
+  }
+}
+
+/**
+ * \brief Drops entities of a chunk that did not change since their creation.
+ * \param chunk_index Index of a chunk.
+ */
+void EntityStreaming::unload_chunk(size_t chunk_index) {
+
+  Chunk& chunk = chunks[chunk_index];
+  if (chunk.num_loaded == 0) {
+    return;
+  }
+
+  Entities& entities = map.get_entities();
+  std::vector<Entity*> entities_to_drop;
+  for (Record& record: chunk.records) {
+    if (record.entity != nullptr && is_unchanged(*record.entity, record.data)) {
+      entities_to_drop.push_back(record.entity);
+      records_by_entity.erase(record.entity);
+      record.entity = nullptr;
+    }
+  }
+  chunk.num_loaded = 0;
+
+  // Removing entities may run Lua code.
+  for (Entity* entity: entities_to_drop) {
+    entities.remove_entity(*entity);
+  }
+}
+
+/**
+ * \brief Returns whether an entity can be dropped and created again
+ * from its data without visible difference.
+ * \param entity An entity created from data.
+ * \param entity_data Its data.
+ * \return \c true if the entity is still as created.
+ */
+bool EntityStreaming::is_unchanged(const Entity& entity, const EntityData& entity_data) {
+
+  if (entity.is_being_removed() ||
+      entity.is_with_lua_table() ||
+      entity.get_movement() != nullptr ||
+      entity.get_xy() != entity_data.get_xy() ||
+      entity.get_layer() != entity_data.get_layer()) {
+    return false;
+  }
+
+  if (entity_data.has_specific_property("enabled_at_start") &&
+      entity.is_enabled() != entity_data.get_boolean("enabled_at_start")) {
+    return false;
+  }
+
+  return true;
+}
+
+}
+
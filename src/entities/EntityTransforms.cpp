@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/EntityTransforms.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty set of transforms.
+ */
+EntityTransforms::EntityTransforms():
+  entities(),
+  bounding_boxes(),
+  max_bounding_boxes() {
+
+}
+
+/**
+ * \brief Returns the number of entities in the arrays.
+ * \return The number of slots used.
+ */
+size_t EntityTransforms::get_num_slots() const {
+  return entities.size();
+}
+
+/**
+ * \brief Returns whether an entity has a slot here.
+ * \param entity An entity.
+ * \return \c true if the entity is in the arrays.
+ */
+bool EntityTransforms::contains(const Entity& entity) const {
+
+  const int slot = entity.get_transform_slot();
+  return slot >= 0 &&
+      static_cast<size_t>(slot) < entities.size() &&
+      entities[slot] == &entity;
+}
+
+/**
+ * \brief Allocates memory for a number of entities.
+ * \param num_entities Number of entities expected.
+ */
+void EntityTransforms::reserve(size_t num_entities) {
+
+  entities.reserve(num_entities);
+  bounding_boxes.reserve(num_entities);
+  max_bounding_boxes.reserve(num_entities);
+}
+
+/**
+ * \brief Gives a slot to an entity and stores its current boxes.
+ * \param entity The entity to add. It must not be here already.
+ */
+void EntityTransforms::add(Entity& entity) {
+
+  Debug::check_assertion(!contains(entity), "Entity already has a transform slot");
+
+  entity.set_transform_slot(static_cast<int>(entities.size()));
+  entities.push_back(&entity);
+  bounding_boxes.push_back(entity.get_bounding_box());
+  max_bounding_boxes.push_back(entity.get_max_bounding_box());
+}
+
+/**
+ * \brief Frees the slot of an entity.
+ *
+ * The last entity takes its place.
+ *
+ * \param entity The entity to remove. Does nothing if it is not here.
+ */
+void EntityTransforms::remove(Entity& entity) {
+
+  if (!contains(entity)) {
+    return;
+  }
+
+  const size_t slot = static_cast<size_t>(entity.get_transform_slot());
+  const size_t last = entities.size() - 1;
+  if (slot != last) {
+    entities[slot] = entities[last];
+    bounding_boxes[slot] = bounding_boxes[last];
+    max_bounding_boxes[slot] = max_bounding_boxes[last];
+    entities[slot]->set_transform_slot(static_cast<int>(slot));
+  }
+  entities.pop_back();
+  bounding_boxes.pop_back();
+  max_bounding_boxes.pop_back();
+  entity.set_transform_slot(-1);
+}
+
+/**
+ * \brief Stores the current boxes of an entity.
+ * \param entity An entity. Does nothing if it is not here.
+ */
+void EntityTransforms::update(Entity& entity) {
+
+  if (!contains(entity)) {
+    return;
+  }
+
+  const size_t slot = static_cast<size_t>(entity.get_transform_slot());
+  bounding_boxes[slot] = entity.get_bounding_box();
+  max_bounding_boxes[slot] = entity.get_max_bounding_box();
+}
+
+/**
+ * \brief Stores the current boxes of all entities.
+ */
+void EntityTransforms::update_all() {
+
+  for (size_t slot = 0; slot < entities.size(); ++slot) {
+    bounding_boxes[slot] = entities[slot]->get_bounding_box();
+    max_bounding_boxes[slot] = entities[slot]->get_max_bounding_box();
+  }
+}
+
+/**
+ * \brief Returns the entity of a slot.
+ * \param slot A slot lower than get_num_slots().
+ * \return The entity.
+ */
+Entity& EntityTransforms::get_entity(size_t slot) const {
+  return *entities[slot];
+}
+
+/**
+ * \brief Returns the bounding box stored for a slot.
+ * \param slot A slot lower than get_num_slots().
+ * \return The bounding box of the entity.
+ */
+const Rectangle& EntityTransforms::get_bounding_box(size_t slot) const {
+  return bounding_boxes[slot];
+}
+
+/**
+ * \brief Returns the bounding box including sprites stored for a slot.
+ * \param slot A slot lower than get_num_slots().
+ * \return The max bounding box of the entity.
+ */
+const Rectangle& EntityTransforms::get_max_bounding_box(size_t slot) const {
+  return max_bounding_boxes[slot];
+}
+
+/**
+ * \brief Finds the slots of entities that overlap some rectangles
+ * in a single pass.
+ * \param rectangles The rectangles to test (at most 8).
+ * \param[out] result One value per slot: bit i is set if the bounding box
+ * including sprites overlaps rectangle i. It is resized first.
+ */
+void EntityTransforms::get_slots_overlapping(
+    const std::vector<Rectangle>& rectangles,
+    std::vector<uint8_t>& result
+) const {
+
+  Debug::check_assertion(rectangles.size() <= 8, "Too many rectangles");
+
+  result.resize(max_bounding_boxes.size());
+  for (size_t slot = 0; slot < max_bounding_boxes.size(); ++slot) {
+    const Rectangle& box = max_bounding_boxes[slot];
+    uint8_t bits = 0;
+    for (size_t i = 0; i < rectangles.size(); ++i) {
+      if (box.overlaps(rectangles[i])) {
+        bits |= static_cast<uint8_t>(1 << i);
+      }
+    }
+    result[slot] = bits;
+  }
+}
+
+}
+
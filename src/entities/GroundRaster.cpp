@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/GroundRaster.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty raster.
+ */
+GroundRaster::GroundRaster():
+  nb_words_per_row(0),
+  walls(),
+  conditional() {
+
+}
+
+/**
+ * \brief Allocates the bitmaps for a layer where no pixel is an obstacle.
+ * \param width8 Width of the layer in 8x8 squares.
+ * \param height8 Height of the layer in 8x8 squares.
+ */
+void GroundRaster::initialize(int width8, int height8) {
+
+  nb_words_per_row = (width8 + 7) >> 3;
+  const size_t nb_words = static_cast<size_t>(nb_words_per_row) * height8 * 8;
+  walls.assign(nb_words, 0);
+  conditional.assign(nb_words, 0);
+}
+
+/**
+ * \brief Updates the pixels of an 8x8 square after its ground has changed.
+ *
+ * The coordinates must be inside the layer.
+ *
+ * \param x8 X coordinate of the square (divided by 8).
+ * \param y8 Y coordinate of the square (divided by 8).
+ * \param ground The new ground of the square.
+ */
+void GroundRaster::set_ground(int x8, int y8, Ground ground) {
+
+  bool is_conditional_ground = false;
+  switch (ground) {
+
+  case Ground::LOW_WALL:
+  case Ground::DEEP_WATER:
+  case Ground::SHALLOW_WATER:
+  case Ground::GRASS:
+  case Ground::HOLE:
+  case Ground::ICE:
+  case Ground::LADDER:
+  case Ground::PRICKLE:
+  case Ground::LAVA:
+    is_conditional_ground = true;
+    break;
+
+  default:
+    break;
+  }
+
+  // A square is a byte of a word: 8 squares fit exactly in a word.
+  const int shift = 56 - ((x8 & 7) << 3);
+  const uint64_t wall_square_mask = get_wall_square_mask(ground);
+  for (int i = 0; i < 8; ++i) {
+    const size_t word_index = static_cast<size_t>(y8 * 8 + i) * nb_words_per_row + (x8 >> 3);
+    const uint8_t wall_row_mask = static_cast<uint8_t>(wall_square_mask >> (56 - (i << 3)));
+    set_row_byte(walls, word_index, shift, wall_row_mask);
+    set_row_byte(conditional, word_index, shift, is_conditional_ground ? 0xFF : 0x00);
+  }
+}
+
+/**
+ * \brief Returns whether a pixel is a wall.
+ *
+ * The coordinates must be inside the layer.
+ *
+ * \param x X coordinate of the pixel.
+ * \param y Y coordinate of the pixel.
+ * \return \c true if this pixel is a wall or in the wall half
+ * of a diagonal wall.
+ */
+bool GroundRaster::is_wall(int x, int y) const {
+  return is_bit_set(walls, x, y);
+}
+
+/**
+ * \brief Returns whether a pixel is an obstacle for some entities only.
+ *
+ * The coordinates must be inside the layer.
+ *
+ * \param x X coordinate of the pixel.
+ * \param y Y coordinate of the pixel.
+ * \return \c true if the ground of this pixel depends on the entity.
+ */
+bool GroundRaster::is_conditional(int x, int y) const {
+  return is_bit_set(conditional, x, y);
+}
+
+/**
+ * \brief Returns whether the border of a rectangle has a wall pixel.
+ *
+ * The rectangle must be inside the layer and not empty.
+ *
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of its border is a wall.
+ */
+bool GroundRaster::has_wall_on_border(const Rectangle& box) const {
+  return has_bit_on_border(walls, box);
+}
+
+/**
+ * \brief Returns whether the border of a rectangle has a pixel whose
+ * ground is an obstacle for some entities only.
+ *
+ * The rectangle must be inside the layer and not empty.
+ *
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of its border has such a ground.
+ */
+bool GroundRaster::has_conditional_on_border(const Rectangle& box) const {
+  return has_bit_on_border(conditional, box);
+}
+
+/**
+ * \brief Returns whether a rectangle has a wall pixel.
+ *
+ * The rectangle must be inside the layer and not empty.
+ *
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of the rectangle is a wall.
+ */
+bool GroundRaster::has_wall(const Rectangle& box) const {
+  return has_bit_in_box(walls, box);
+}
+
+/**
+ * \brief Returns whether a rectangle has a pixel whose ground is an obstacle
+ * for some entities only.
+ *
+ * The rectangle must be inside the layer and not empty.
+ *
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of the rectangle has such a ground.
+ */
+bool GroundRaster::has_conditional(const Rectangle& box) const {
+  return has_bit_in_box(conditional, box);
+}
+
+/**
+ * \brief Returns the wall pixels of an 8x8 square of a ground.
+ *
+ * Masks of all grounds are computed once.
+ *
+ * \param ground Ground of the square.
+ * \return The wall pixels of the square: row \c y is the byte
+ * <tt>(mask >> (56 - 8 * y)) & 0xFF</tt>, the leftmost pixel
+ * in its most significant bit.
+ */
+uint64_t GroundRaster::get_wall_square_mask(Ground ground) {
+
+  static constexpr int nb_grounds = static_cast<int>(Ground::LAVA) + 1;
+  static const std::vector<uint64_t> masks = [] {
+    std::vector<uint64_t> result(nb_grounds, 0);
+    for (int i = 0; i < nb_grounds; ++i) {
+      for (int y = 0; y < 8; ++y) {
+        result[i] |= uint64_t(get_wall_row_mask(static_cast<Ground>(i), y)) << (56 - (y << 3));
+      }
+    }
+    return result;
+  }();
+  return masks[static_cast<int>(ground)];
+}
+
+/**
+ * \brief Returns whether a bitmap has a bit set on the border of a rectangle.
+ * \param bits The bitmap.
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of its border is set.
+ */
+bool GroundRaster::has_bit_on_border(
+    const std::vector<uint64_t>& bits,
+    const Rectangle& box
+) const {
+
+  const int x1 = box.get_x();
+  const int x2 = x1 + box.get_width() - 1;
+  const int y1 = box.get_y();
+  const int y2 = y1 + box.get_height() - 1;
+
+  if (has_bit_in_row(bits, y1, x1, x2) ||
+      has_bit_in_row(bits, y2, x1, x2)) {
+    return true;
+  }
+
+  for (int y = y1 + 1; y < y2; ++y) {
+    if (is_bit_set(bits, x1, y) ||
+        is_bit_set(bits, x2, y)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Returns whether a bitmap has a bit set in a rectangle.
+ * \param bits The bitmap.
+ * \param box The rectangle to test.
+ * \return \c true if a pixel of the rectangle is set.
+ */
+bool GroundRaster::has_bit_in_box(
+    const std::vector<uint64_t>& bits,
+    const Rectangle& box
+) const {
+
+  const int x1 = box.get_x();
+  const int x2 = x1 + box.get_width() - 1;
+  const int y1 = box.get_y();
+  const int y2 = y1 + box.get_height() - 1;
+
+  for (int y = y1; y <= y2; ++y) {
+    if (has_bit_in_row(bits, y, x1, x2)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Returns whether a bitmap has a bit set in a segment of a row.
+ * \param bits The bitmap.
+ * \param y The row.
+ * \param x1 First pixel of the segment.
+ * \param x2 Last pixel of the segment (included).
+ * \return \c true if a pixel of the segment is set.
+ */
+bool GroundRaster::has_bit_in_row(
+    const std::vector<uint64_t>& bits,
+    int y,
+    int x1,
+    int x2
+) const {
+
+  const uint64_t* row = &bits[static_cast<size_t>(y) * nb_words_per_row];
+  const int first_word = x1 >> 6;
+  const int last_word = x2 >> 6;
+  const uint64_t first_mask = ~uint64_t(0) >> (x1 & 63);
+  const uint64_t last_mask = ~uint64_t(0) << (63 - (x2 & 63));
+
+  if (first_word == last_word) {
+    return (row[first_word] & first_mask & last_mask) != 0;
+  }
+
+  if ((row[first_word] & first_mask) != 0) {
+    return true;
+  }
+  for (int i = first_word + 1; i < last_word; ++i) {
+    if (row[i] != 0) {
+      return true;
+    }
+  }
+  return (row[last_word] & last_mask) != 0;
+}
+
+/**
+ * \brief Returns whether a pixel of a bitmap is set.
+ * \param bits The bitmap.
+ * \param x X coordinate of the pixel.
+ * \param y Y coordinate of the pixel.
+ * \return \c true if the bit of this pixel is set.
+ */
+bool GroundRaster::is_bit_set(const std::vector<uint64_t>& bits, int x, int y) const {
+
+  const uint64_t word = bits[static_cast<size_t>(y) * nb_words_per_row + (x >> 6)];
+  return (word & (uint64_t(0x8000000000000000) >> (x & 63))) != 0;
+}
+
+/**
+ * \brief Replaces a byte of a word of a bitmap.
+ * \param bits The bitmap.
+ * \param word_index Index of the word to change.
+ * \param shift Position of the byte in the word.
+ * \param value The new byte.
+ */
+void GroundRaster::set_row_byte(
+    std::vector<uint64_t>& bits,
+    size_t word_index,
+    int shift,
+    uint8_t value
+) {
+  uint64_t& word = bits[word_index];
+  word = (word & ~(uint64_t(0xFF) << shift)) | (uint64_t(value) << shift);
+}
+
+/**
+ * \brief Returns the wall pixels of a row of an 8x8 square.
+ *
+ * This is consistent with Map::test_collision_with_ground().
+ *
+ * \param ground Ground of the square.
+ * \param y_in_square The row in the square, between 0 and 7.
+ * \return The wall pixels of this row, the leftmost one in the most
+ * significant bit.
+ */
+uint8_t GroundRaster::get_wall_row_mask(Ground ground, int y_in_square) {
+
+  switch (ground) {
+
+  case Ground::WALL:
+    return 0xFF;
+
+  case Ground::WALL_TOP_RIGHT:
+  case Ground::WALL_TOP_RIGHT_WATER:
+    // Pixels where y_in_square <= x_in_square.
+    return static_cast<uint8_t>(0xFF >> y_in_square);
+
+  case Ground::WALL_TOP_LEFT:
+  case Ground::WALL_TOP_LEFT_WATER:
+    // Pixels where y_in_square <= 7 - x_in_square.
+    return static_cast<uint8_t>(0xFF << y_in_square);
+
+  case Ground::WALL_BOTTOM_LEFT:
+  case Ground::WALL_BOTTOM_LEFT_WATER:
+    // Pixels where y_in_square >= x_in_square.
+    return static_cast<uint8_t>(0xFF << (7 - y_in_square));
+
+  case Ground::WALL_BOTTOM_RIGHT:
+  case Ground::WALL_BOTTOM_RIGHT_WATER:
+    // Pixels where y_in_square >= 7 - x_in_square.
+    return static_cast<uint8_t>(0xFF >> (7 - y_in_square));
+
+  default:
+    return 0x00;
+  }
+}
+
+}
@@ -27,6 +27,7 @@
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/Chest.h"
 #include "solarus/entities/Crystal.h"
+#include "solarus/entities/CrystalBlock.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Destructible.h"
 #include "solarus/entities/Enemy.h"
@@ -107,6 +108,14 @@ Hero::Hero(Equipment& equipment):
   walking_speed(normal_walking_speed),
   delayed_teletransporter(nullptr),
   on_raised_blocks(false),
+  entities_nearby(nullptr),
+  entities_nearby_box(),
+  entities_nearby_owner(nullptr),
+  entities_nearby_generation(0),
+  ground_below_owner(nullptr),
+  ground_below_xy(),
+  ground_below_layer(0),
+  ground_below_generation(0),
   last_solid_ground_coords(0, 0),
   last_solid_ground_layer(0),
   target_solid_ground_callback(),
@@ -205,10 +214,20 @@ void Hero::update_movement() {
     // is not touching ground.
   }
   else {
-    on_raised_blocks = get_entities().overlaps_raised_blocks(get_layer(), get_bounding_box());
+    on_raised_blocks = false;
+    const Rectangle& box = get_bounding_box();
+    for (Entity* entity: *get_entities_nearby()) {
+      if (entity->get_type() == EntityType::CRYSTAL_BLOCK &&
+          entity->get_layer() == get_layer() &&
+          entity->get_max_bounding_box().overlaps(box) &&
+          static_cast<const CrystalBlock&>(*entity).is_raised()) {
+        on_raised_blocks = true;
+        break;
+      }
+    }
   }
 
-  if (get_movement() != nullptr) {
+  if (get_movement() != nullptr && get_movement()->is_update_needed(System::now())) {
     get_movement()->update();
   }
   // TODO clear_old_movements() is missing
@@ -517,6 +536,9 @@ void Hero::notify_creating() {
  */
 void Hero::notify_map_started() {
 
+  // A new map may reuse the address of the old one.
+  clear_position_caches();
+
   Entity::notify_map_started();
   get_hero_sprites().notify_map_started();
 
@@ -672,10 +694,8 @@ void Hero::place_on_destination(Map& map, const Rectangle& previous_map_location
       last_solid_ground_layer = get_layer();
 
       // Remove boomerangs in case the map remains the same.
-      const std::set<std::shared_ptr<Boomerang>>& boomerangs =
-          map.get_entities().get_entities_by_type<Boomerang>();
-      for (const std::shared_ptr<Boomerang>& boomerang : boomerangs) {
-        boomerang->remove_from_map();
+      for (Boomerang& boomerang : map.get_entities().get_entities_by_type<Boomerang>()) {
+        boomerang.remove_from_map();
       }
 
       if (destination != nullptr) {
@@ -850,12 +870,10 @@ bool Hero::is_on_raised_blocks() const {
  */
 std::shared_ptr<const Stairs> Hero::get_stairs_overlapping() const {
 
-  std::set<std::shared_ptr<const Stairs>> all_stairs =
-      get_entities().get_entities_by_type<Stairs>(get_layer());
-  for (const std::shared_ptr<const Stairs>& stairs: all_stairs) {
+  for (const Stairs& stairs: get_entities().get_entities_by_type<Stairs>(get_layer())) {
 
-    if (overlaps(*stairs)) {
-      return stairs;
+    if (overlaps(stairs)) {
+      return std::static_pointer_cast<const Stairs>(stairs.shared_from_this());
     }
   }
 
@@ -1103,7 +1121,19 @@ void Hero::check_position() {
   }
 
   // Determine the new ground if it has changed.
-  update_ground_below();
+  // Nothing can change it if no entity moved and no tile changed.
+  const Entities& entities = get_entities();
+  const uint64_t generation = entities.get_obstacle_generation();
+  if (ground_below_owner != &entities ||
+      get_xy() != ground_below_xy ||
+      get_layer() != ground_below_layer ||
+      generation != ground_below_generation) {
+    update_ground_below();
+    ground_below_owner = &entities;
+    ground_below_xy = get_xy();
+    ground_below_layer = get_layer();
+    ground_below_generation = generation;
+  }
 
   // Save the hero's last valid position.
   Ground ground = get_ground_below();
@@ -1144,6 +1174,87 @@ void Hero::check_position() {
   }
 }
 
+/**
+ * \copydoc Entity::check_collision_with_detectors()
+ *
+ * The hero does this at each cycle, so the entities near him are only
+ * searched again when something changed on the map.
+ */
+void Hero::check_collision_with_detectors() {
+
+  if (!is_on_map() || !is_enabled()) {
+    return;
+  }
+
+  // Keep the list alive even if a detector moves the hero meanwhile.
+  const std::shared_ptr<const std::vector<Entity*>> entities_nearby = get_entities_nearby();
+
+  // Detect simple collisions.
+  get_map().check_collision_with_detectors(*this, *entities_nearby);
+
+  // Detect pixel-precise collisions.
+  // Collisions may call Lua and create sprites: iterate on a copy.
+  for (const SpritePtr& sprite: get_sprites()) {
+    if (sprite->are_pixel_collisions_enabled()) {
+      get_map().check_collision_with_detectors(*this, *sprite, *entities_nearby);
+    }
+  }
+}
+
+/**
+ * \copydoc Entity::check_collision_with_detectors(Sprite&)
+ */
+void Hero::check_collision_with_detectors(Sprite& sprite) {
+
+  if (!is_on_map() || !is_enabled()) {
+    return;
+  }
+
+  const std::shared_ptr<const std::vector<Entity*>> entities_nearby = get_entities_nearby();
+  get_map().check_collision_with_detectors(*this, sprite, *entities_nearby);
+}
+
+/**
+ * \brief Returns the entities that may be in collision with the hero.
+ *
+ * The search is done again only if something moved or was added or removed
+ * on the map since the last one, or if the hero got bigger.
+ * Standing still therefore costs no spatial search.
+ *
+ * \return Entities whose max bounding box overlaps the hero's detection
+ * region, and possibly a few more.
+ */
+std::shared_ptr<const std::vector<Entity*>> Hero::get_entities_nearby() {
+
+  Entities& entities = get_entities();
+  const Rectangle& box =
+      get_extended_bounding_box(Map::detector_margin) | get_max_bounding_box();
+
+  if (entities_nearby == nullptr ||
+      entities_nearby_owner != &entities ||
+      entities_nearby_generation != entities.get_obstacle_generation() ||
+      !entities_nearby_box.contains(box)) {
+    // Don't modify the previous list: it may be still in use.
+    entities_nearby = std::make_shared<std::vector<Entity*>>();
+    entities.get_entities_in_rectangle(box, *entities_nearby);
+    entities_nearby_box = box;
+    entities_nearby_owner = &entities;
+    entities_nearby_generation = entities.get_obstacle_generation();
+  }
+  return entities_nearby;
+}
+
+/**
+ * \brief Forgets what was remembered about the entities and the ground
+ * near the hero.
+ */
+void Hero::clear_position_caches() {
+
+  entities_nearby = nullptr;
+  entities_nearby_owner = nullptr;
+  ground_below_owner = nullptr;
+}
+
 /**
  * \brief This function is called when the layer of this entity has just changed.
  */
@@ -1390,9 +1501,9 @@ ScopedLuaRef Hero::make_solid_ground_callback(
  * position.
  */
 void Hero::set_target_solid_ground_callback(
-    const ScopedLuaRef& target_solid_ground_callback) {
+    ScopedLuaRef target_solid_ground_callback) {
 
-  this->target_solid_ground_callback = target_solid_ground_callback;
+  this->target_solid_ground_callback = std::move(target_solid_ground_callback);
 }
 
 /**
@@ -2411,9 +2522,9 @@ void Hero::start_free_carrying_loading_or_running() {
  */
 void Hero::start_treasure(
     const Treasure& treasure,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
-  set_state(new TreasureState(*this, treasure, callback_ref));
+  set_state(new TreasureState(*this, treasure, std::move(callback_ref)));
 }
 
 /**
@@ -2462,8 +2573,8 @@ void Hero::start_jumping(
  * \param callback_ref Lua ref to a function to call when the
  * victory sequence finishes (possibly an empty ref).
  */
-void Hero::start_victory(const ScopedLuaRef& callback_ref) {
-  set_state(new VictoryState(*this, callback_ref));
+void Hero::start_victory(ScopedLuaRef callback_ref) {
+  set_state(new VictoryState(*this, std::move(callback_ref)));
 }
 
 /**
@@ -2679,9 +2790,9 @@ bool Hero::can_start_item(EquipmentItem& item) {
  * \param item The equipment item to use.
  */
 void Hero::start_item(EquipmentItem& item) {
-  Debug::check_assertion(can_start_item(item),
-      std::string("The hero cannot start using item '")
-      + item.get_name() + "' now");
+  Debug::check_assertion_lazy(can_start_item(item), [&] {
+    return std::string("The hero cannot start using item '") + item.get_name() + "' now";
+  });
   set_state(new UsingItemState(*this, item));
 }
 
@@ -229,10 +229,12 @@ void Hookshot::draw_on_map() {
   if (direction > 4) {
     return;
   }
-  int x1 = get_hero().get_x() + dxy[direction].x;
-  int y1 = get_hero().get_y() + dxy[direction].y;
-  int x2 = get_x();
-  int y2 = get_y() - 5;
+  const Point& hero_xy = get_hero().get_interpolated_xy();
+  const Point& xy = get_interpolated_xy();
+  int x1 = hero_xy.x + dxy[direction].x;
+  int y1 = hero_xy.y + dxy[direction].y;
+  int x2 = xy.x;
+  int y2 = xy.y - 5;
 
   Point link_xy;
   for (int i = 0; i < nb_links; i++) {
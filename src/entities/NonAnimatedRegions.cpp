@@ -15,14 +15,27 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/core/Trace.h"
+#include "solarus/entities/Camera.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Solarus {
 
+int NonAnimatedRegions::cell_radius = NonAnimatedRegions::default_cell_radius;
+int64_t NonAnimatedRegions::max_memory_size = NonAnimatedRegions::default_max_memory_size;
+int64_t NonAnimatedRegions::memory_size = 0;
+
 /**
  * \brief Constructor.
  * \param map The map. Its size must be known.
@@ -31,8 +44,78 @@ namespace Solarus {
 NonAnimatedRegions::NonAnimatedRegions(Map& map, int layer):
   map(map),
   layer(layer),
-  non_animated_tiles(map.get_size(), Size(512, 256)) {
+  tiles(),
+  are_squares_animated(),
+  non_animated_tiles(map.get_size(), Size(512, 256)),
+  optimized_tiles_surfaces(),
+  optimized_tiles_pixels(),
+  cells_to_build(),
+  built_cells(),
+  cells_last_drawn(),
+  num_draws(0),
+  drawn_cells() {
+
+}
+
+/**
+ * \brief Destructor.
+ */
+NonAnimatedRegions::~NonAnimatedRegions() {
+
+  memory_size -= static_cast<int64_t>(built_cells.size()) * get_cell_memory_size();
+}
+
+/**
+ * \brief Returns the distance where cells are kept.
+ * \return Cells further than this number of cells from the visible ones
+ * are released.
+ */
+int NonAnimatedRegions::get_cell_radius() {
+  return cell_radius;
+}
+
+/**
+ * \brief Sets the distance where cells are kept.
+ *
+ * Cells prepared in advance are always kept, so values lower than this
+ * margin have no more effect.
+ *
+ * \param cell_radius Cells further than this number of cells from the
+ * visible ones will be released.
+ */
+void NonAnimatedRegions::set_cell_radius(int cell_radius) {
+
+  Debug::check_assertion(cell_radius >= 0, "Invalid cell radius");
+  NonAnimatedRegions::cell_radius = cell_radius;
+}
+
+/**
+ * \brief Returns the memory allowed for the cells of all layers.
+ * \return The maximum memory in bytes.
+ */
+int64_t NonAnimatedRegions::get_max_memory_size() {
+  return max_memory_size;
+}
 
+/**
+ * \brief Sets the memory allowed for the cells of all layers.
+ *
+ * Visible cells are always kept, even if they exceed this limit.
+ *
+ * \param max_memory_size The maximum memory in bytes.
+ */
+void NonAnimatedRegions::set_max_memory_size(int64_t max_memory_size) {
+
+  Debug::check_assertion(max_memory_size >= 0, "Invalid cell memory size");
+  NonAnimatedRegions::max_memory_size = max_memory_size;
+}
+
+/**
+ * \brief Returns the memory currently used by the cells of all layers.
+ * \return The memory in bytes.
+ */
+int64_t NonAnimatedRegions::get_memory_size() {
+  return memory_size;
 }
 
 /**
@@ -56,6 +139,8 @@ void NonAnimatedRegions::add_tile(const TileInfo& tile) {
  */
 void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
 
+  SOLARUS_TRACE_SCOPE("NonAnimatedRegions::build");
+
   Debug::check_assertion(optimized_tiles_surfaces.empty(),
       "Tile regions are already built");
 
@@ -69,6 +154,8 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
 
   // Create the surfaces where all non-animated tiles will be drawn.
   optimized_tiles_surfaces.resize(non_animated_tiles.get_num_cells());
+  optimized_tiles_pixels.resize(non_animated_tiles.get_num_cells());
+  cells_last_drawn.resize(non_animated_tiles.get_num_cells(), 0);
 
   // Mark animated 8x8 squares of the map.
   for (size_t i = 0; i < tiles.size(); ++i) {
@@ -116,11 +203,32 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
 
 /**
  * \brief Clears previous drawings because the tileset has changed.
+ *
+ * Tiles of the old tileset switch to the new one.
+ * The cells stay the same since tilesets of a map must be compatible:
+ * they are only drawn again.
+ *
+ * \param old_tileset The tileset being replaced.
+ * \param new_tileset The tileset replacing it.
+ * \param same_patterns \c true if tiles can keep their pattern objects.
  */
-void NonAnimatedRegions::notify_tileset_changed() {
+void NonAnimatedRegions::notify_tileset_changed(
+    const Tileset& old_tileset,
+    const Tileset& new_tileset,
+    bool same_patterns
+) {
+  if (&new_tileset != &old_tileset) {
+    for (size_t i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
+      for (TileInfo& tile: non_animated_tiles.get_elements(i)) {
+        Tileset::switch_tile(
+            old_tileset, new_tileset, same_patterns, tile.pattern_index, tile.tileset, tile.pattern
+        );
+      }
+    }
+  }
 
-  for (unsigned i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
-    optimized_tiles_surfaces[i] = nullptr;
+  while (!built_cells.empty()) {
+    release_cell(built_cells.back());
   }
   // Everything will be redrawn when necessary.
 }
@@ -159,20 +267,21 @@ bool NonAnimatedRegions::overlaps_animated_tile(const TileInfo& tile) const {
 }
 
 /**
- * \brief Draws a layer of non-animated regions of tiles on the current map.
+ * \brief Draws a layer of non-animated regions of tiles on a camera.
+ *
+ * When there are several cameras, cells are built once and drawn
+ * into each of them.
+ * Call release_far_cells() once all cameras are drawn.
+ *
+ * \param camera The camera to draw.
  */
-void NonAnimatedRegions::draw_on_map() {
-
-  const CameraPtr& camera = map.get_camera();
-  if (camera == nullptr) {
-    return;
-  }
+void NonAnimatedRegions::draw_on_map(Camera& camera) {
 
   // Check all grid cells that overlap the camera.
   const int num_rows = non_animated_tiles.get_num_rows();
   const int num_columns = non_animated_tiles.get_num_columns();
   const Size& cell_size = non_animated_tiles.get_cell_size();
-  const Rectangle& camera_position = camera->get_bounding_box();
+  const Rectangle& camera_position = camera.get_interpolated_bounding_box();
 
   const int row1 = camera_position.get_y() / cell_size.height;
   const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
@@ -184,6 +293,31 @@ void NonAnimatedRegions::draw_on_map() {
     return;
   }
 
+  if (drawn_cells.empty()) {
+    // First camera of the frame.
+    ++num_draws;
+  }
+  drawn_cells.emplace_back(column1, row1, column2 - column1 + 1, row2 - row1 + 1);
+
+  // Prepare in parallel the missing cells that are visible or about to be.
+  cells_to_build.clear();
+  for (int i = row1 - prebuilt_margin; i <= row2 + prebuilt_margin; ++i) {
+    if (i < 0 || i >= num_rows) {
+      continue;
+    }
+    for (int j = column1 - prebuilt_margin; j <= column2 + prebuilt_margin; ++j) {
+      if (j < 0 || j >= num_columns) {
+        continue;
+      }
+      const int cell_index = i * num_columns + j;
+      if (optimized_tiles_surfaces[cell_index] == nullptr &&
+          optimized_tiles_pixels[cell_index] == nullptr) {
+        cells_to_build.push_back(cell_index);
+      }
+    }
+  }
+  build_cells_pixels(cells_to_build);
+
   for (int i = row1; i <= row2; ++i) {
     if (i < 0 || i >= num_rows) {
       continue;
@@ -197,8 +331,17 @@ void NonAnimatedRegions::draw_on_map() {
       // Make sure this cell is built.
       int cell_index = i * num_columns + j;
       if (optimized_tiles_surfaces[cell_index] == nullptr) {
-        // Lazily build the cell.
-        build_cell(cell_index);
+        if (optimized_tiles_pixels[cell_index] != nullptr) {
+          // Upload the cell now that it is visible.
+          MemoryStats::TextureOrigin origin(MemoryStats::Category::TILESET_TEXTURES);
+          optimized_tiles_surfaces[cell_index] = std::make_shared<Surface>(
+              optimized_tiles_pixels[cell_index].release(), true
+          );
+        }
+        else {
+          // Lazily build the cell.
+          build_cell(cell_index);
+        }
       }
 
       const Point cell_xy = {
@@ -208,8 +351,9 @@ void NonAnimatedRegions::draw_on_map() {
 
       const Point dst_position = cell_xy - camera_position.get_xy();
       optimized_tiles_surfaces[cell_index]->draw(
-          map.get_camera_surface(), dst_position
+          camera.get_surface(), dst_position
       );
+      cells_last_drawn[cell_index] = num_draws;
     }
   }
 }
@@ -238,8 +382,10 @@ void NonAnimatedRegions::build_cell(int cell_index) {
       row * cell_size.height
   };
 
+  MemoryStats::TextureOrigin origin(MemoryStats::Category::TILESET_TEXTURES);
   SurfacePtr cell_surface = Surface::create(cell_size,true);
   optimized_tiles_surfaces[cell_index] = cell_surface;
+  add_built_cell(cell_index);
   // Let this surface as a software destination because it is built only
   // once (here) and never changes later.
 
@@ -291,4 +437,244 @@ void NonAnimatedRegions::build_cell(int cell_index) {
   }
 }
 
+/**
+ * \brief Draws cells in software, in parallel.
+ *
+ * Cells that cannot be drawn this way are left empty.
+ * They will be built on the GPU by build_cell() when needed.
+ *
+ * \param cell_indexes Indexes of the cells to draw.
+ */
+void NonAnimatedRegions::build_cells_pixels(const std::vector<int>& cell_indexes) {
+
+  if (cell_indexes.empty()) {
+    return;
+  }
+
+  // Get the tileset pixels from this thread: workers must not use surfaces.
+  const uint32_t rgba_format = Video::get_rgba_format()->format;
+  TilesImages tiles_images;
+  for (int cell_index: cell_indexes) {
+    for (const TileInfo& tile: non_animated_tiles.get_elements(cell_index)) {
+      Debug::check_assertion(tile.tileset != nullptr, "Missing tileset");
+      bool found = false;
+      for (const std::pair<const Tileset*, const SDL_Surface*>& tiles_image: tiles_images) {
+        if (tiles_image.first == tile.tileset) {
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        const SDL_Surface* pixels =
+            tile.tileset->get_tiles_image()->get_internal_surface().get_surface();
+        if (pixels->format->format != rgba_format) {
+          pixels = nullptr;
+        }
+        tiles_images.emplace_back(tile.tileset, pixels);
+      }
+    }
+  }
+
+  // Allocate the destination pixels here too.
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  const SDL_PixelFormat* format = Video::get_rgba_format();
+  for (int cell_index: cell_indexes) {
+    optimized_tiles_pixels[cell_index].reset(SDL_CreateRGBSurface(
+        0,
+        cell_size.width,
+        cell_size.height,
+        32,
+        format->Rmask,
+        format->Gmask,
+        format->Bmask,
+        format->Amask
+    ));
+    Debug::check_assertion_lazy(optimized_tiles_pixels[cell_index] != nullptr, [&] {
+      return std::string("Failed to create cell surface: ") + SDL_GetError();
+    });
+  }
+
+  std::vector<char> success(cell_indexes.size(), false);
+  ThreadPool& thread_pool = map.get_game().get_main_loop().get_thread_pool();
+  thread_pool.parallel_for(
+      static_cast<int>(cell_indexes.size()),
+      [&](int index) {
+    success[index] = draw_cell_pixels(cell_indexes[index], tiles_images);
+  });
+
+  for (size_t i = 0; i < cell_indexes.size(); ++i) {
+    if (success[i]) {
+      add_built_cell(cell_indexes[i]);
+      cells_last_drawn[cell_indexes[i]] = num_draws;  // Don't release it right away.
+    }
+    else {
+      optimized_tiles_pixels[cell_indexes[i]] = nullptr;
+    }
+  }
+}
+
+/**
+ * \brief Draws all non-animated tiles of a cell on its software pixels.
+ *
+ * This is the software equivalent of build_cell(),
+ * and it can be called from any thread.
+ *
+ * \param cell_index Index of the cell to draw.
+ * \param tiles_images Pixels of the tilesets used by the tiles of this cell.
+ * \return \c false if the cell cannot be drawn in software.
+ */
+bool NonAnimatedRegions::draw_cell_pixels(
+    int cell_index, const TilesImages& tiles_images) const {
+
+  SDL_Surface& cell_pixels = *optimized_tiles_pixels[cell_index];
+
+  const int row = cell_index / non_animated_tiles.get_num_columns();
+  const int column = cell_index % non_animated_tiles.get_num_columns();
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  const Point cell_xy = {
+      column * cell_size.width,
+      row * cell_size.height
+  };
+
+  for (const TileInfo& tile: non_animated_tiles.get_elements(cell_index)) {
+
+    const SDL_Surface* tiles_image = nullptr;
+    for (const std::pair<const Tileset*, const SDL_Surface*>& image: tiles_images) {
+      if (image.first == tile.tileset) {
+        tiles_image = image.second;
+        break;
+      }
+    }
+    if (tiles_image == nullptr) {
+      return false;
+    }
+
+    Rectangle dst_position(
+        tile.box.get_x() - cell_xy.x,
+        tile.box.get_y() - cell_xy.y,
+        tile.box.get_width(),
+        tile.box.get_height()
+    );
+    if (!tile.pattern->fill_software_surface(cell_pixels, dst_position, *tiles_image)) {
+      return false;
+    }
+  }
+
+  // Erase 8x8 squares that contain animated tiles, like build_cell() does.
+  for (int y = cell_xy.y; y < cell_xy.y + cell_size.height; y += 8) {
+    if (y >= map.get_height()) {
+      continue;
+    }
+    for (int x = cell_xy.x; x < cell_xy.x + cell_size.width; x += 8) {
+      if (x >= map.get_width()) {
+        continue;
+      }
+
+      int square_index = (y / 8) * map.get_width8() + (x / 8);
+      if (are_squares_animated[square_index]) {
+        for (int i = 0; i < 8; ++i) {
+          uint8_t* line = static_cast<uint8_t*>(cell_pixels.pixels) +
+              (y - cell_xy.y + i) * cell_pixels.pitch + (x - cell_xy.x) * 4;
+          std::memset(line, 0, 8 * 4);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Returns the memory used by the surface or the pixels of a cell.
+ * \return The size of a cell in bytes.
+ */
+int64_t NonAnimatedRegions::get_cell_memory_size() const {
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  return static_cast<int64_t>(cell_size.width) * cell_size.height * 4;
+}
+
+/**
+ * \brief Counts a cell that just got a surface or pixels.
+ * \param cell_index Index of the cell.
+ */
+void NonAnimatedRegions::add_built_cell(int cell_index) {
+
+  built_cells.push_back(cell_index);
+  memory_size += get_cell_memory_size();
+}
+
+/**
+ * \brief Drops the surface or the pixels of a cell.
+ *
+ * The cell will be built again if it needs to be drawn.
+ *
+ * \param cell_index Index of a built cell.
+ */
+void NonAnimatedRegions::release_cell(int cell_index) {
+
+  const auto it = std::find(built_cells.begin(), built_cells.end(), cell_index);
+  Debug::check_assertion(it != built_cells.end(), "This cell is not built");
+  *it = built_cells.back();
+  built_cells.pop_back();
+
+  optimized_tiles_surfaces[cell_index] = nullptr;
+  optimized_tiles_pixels[cell_index] = nullptr;
+  memory_size -= get_cell_memory_size();
+}
+
+/**
+ * \brief Releases cells that are far from the ones visible by all cameras,
+ * then the least recently displayed ones if the memory limit is exceeded.
+ *
+ * Only visible cells and cells just prepared are guaranteed to be kept.
+ * This should be called once per frame, after all cameras are drawn.
+ */
+void NonAnimatedRegions::release_far_cells() {
+
+  if (drawn_cells.empty()) {
+    // Nothing was drawn.
+    return;
+  }
+
+  const int num_columns = non_animated_tiles.get_num_columns();
+  const int radius = std::max(cell_radius, prebuilt_margin);
+
+  for (size_t k = 0; k < built_cells.size(); ) {
+    const int cell_index = built_cells[k];
+    const int row = cell_index / num_columns;
+    const int column = cell_index % num_columns;
+    bool near = false;
+    for (const Rectangle& cells: drawn_cells) {
+      if (row >= cells.get_y() - radius && row < cells.get_bottom() + radius &&
+          column >= cells.get_x() - radius && column < cells.get_right() + radius) {
+        near = true;
+        break;
+      }
+    }
+    if (!near) {
+      release_cell(cell_index);  // Replaces this element by the last one.
+    }
+    else {
+      ++k;
+    }
+  }
+  drawn_cells.clear();
+
+  // Other layers release their own cells when they are drawn.
+  while (memory_size > max_memory_size) {
+    int oldest_cell = -1;
+    for (int cell_index: built_cells) {
+      if (cells_last_drawn[cell_index] != num_draws &&
+          (oldest_cell == -1 || cells_last_drawn[cell_index] < cells_last_drawn[oldest_cell])) {
+        oldest_cell = cell_index;
+      }
+    }
+    if (oldest_cell == -1) {
+      // Only visible cells remain.
+      return;
+    }
+    release_cell(oldest_cell);
+  }
+}
+
 }
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/entities/ObstacleTable.h"
+
+namespace Solarus {
+
+/**
+ * \brief Builds the table from what each entity class overrides.
+ *
+ * This must be kept in sync with the overrides of Entity::is_obstacle_for()
+ * and of the is_xxx_obstacle() hooks.
+ */
+ObstacleTable::ObstacleTable():
+  num_types(EnumInfoTraits<EntityType>::names.size()),
+  relations(num_types * num_types, Relation::TEST) {
+
+  // Classes that keep the default Entity::is_obstacle_for().
+  for (EntityType type: {
+      EntityType::TILE,
+      EntityType::DESTINATION,
+      EntityType::PICKABLE,
+      EntityType::DYNAMIC_TILE,
+      EntityType::CAMERA,
+      EntityType::CARRIED_OBJECT,
+      EntityType::BOOMERANG,
+      EntityType::EXPLOSION,
+      EntityType::ARROW,
+      EntityType::BOMB,
+      EntityType::FIRE,
+      EntityType::HOOKSHOT
+  }) {
+    set_obstacle_relation(type, Relation::NEVER);
+  }
+
+  set_obstacle_relation(EntityType::CHEST, Relation::ALWAYS);
+  set_obstacle_relation(EntityType::SHOP_TREASURE, Relation::ALWAYS);
+
+  // Classes whose is_obstacle_for() only calls a hook on the other entity.
+  // Hooks whose default implementation depends on the obstacle
+  // (doors, switches, NPCs...) are not listed.
+  set_hook_relation(EntityType::HERO, false, {
+      EntityType::BLOCK,
+      EntityType::NPC
+  });
+  set_hook_relation(EntityType::BLOCK, true, {
+      EntityType::ENEMY,
+      EntityType::HERO
+  });
+  set_hook_relation(EntityType::TELETRANSPORTER, true, {
+      EntityType::ARROW,
+      EntityType::BLOCK,
+      EntityType::BOMB,
+      EntityType::BOOMERANG,
+      EntityType::CARRIED_OBJECT,
+      EntityType::ENEMY,
+      EntityType::HERO,
+      EntityType::HOOKSHOT
+  });
+  set_hook_relation(EntityType::STREAM, true, {
+      EntityType::ARROW,
+      EntityType::BOMB,
+      EntityType::BOOMERANG,
+      EntityType::CARRIED_OBJECT,
+      EntityType::ENEMY,
+      EntityType::HERO,
+      EntityType::HOOKSHOT,
+      EntityType::PICKABLE
+  });
+  set_hook_relation(EntityType::STAIRS, true, {
+      EntityType::ARROW,
+      EntityType::BOOMERANG,
+      EntityType::CARRIED_OBJECT,
+      EntityType::HERO,
+      EntityType::HOOKSHOT
+  });
+  set_hook_relation(EntityType::SENSOR, false, {
+      EntityType::CARRIED_OBJECT,
+      EntityType::HERO
+  });
+  set_hook_relation(EntityType::CRYSTAL, true, {
+      EntityType::ARROW,
+      EntityType::BOOMERANG,
+      EntityType::CARRIED_OBJECT,
+      EntityType::HOOKSHOT
+  });
+  set_hook_relation(EntityType::JUMPER, true, {
+      EntityType::ARROW,
+      EntityType::BOOMERANG,
+      EntityType::CARRIED_OBJECT,
+      EntityType::HERO,
+      EntityType::HOOKSHOT
+  });
+  set_hook_relation(EntityType::SEPARATOR, true, {
+      EntityType::HERO
+  });
+}
+
+/**
+ * \brief Returns the only instance.
+ * \return The table.
+ */
+const ObstacleTable& ObstacleTable::get_instance() {
+
+  static const ObstacleTable instance;
+  return instance;
+}
+
+/**
+ * \brief Returns what is known about an entity being an obstacle for another.
+ *
+ * This describes the result of
+ * Entity::is_obstacle_for(Entity&, const Rectangle&).
+ *
+ * \param obstacle_type Type of the entity that may be an obstacle.
+ * \param other_type Type of the entity that moves.
+ * \return Whether the first one is an obstacle, or Relation::TEST if
+ * Entity::is_obstacle_for() has to be called to know.
+ */
+ObstacleTable::Relation ObstacleTable::get_relation(
+    EntityType obstacle_type, EntityType other_type) {
+
+  const ObstacleTable& table = get_instance();
+  return table.relations[static_cast<size_t>(obstacle_type) * table.num_types +
+      static_cast<size_t>(other_type)];
+}
+
+/**
+ * \brief Sets the relation of a pair of types.
+ * \param obstacle_type Type of the entity that may be an obstacle.
+ * \param other_type Type of the entity that moves.
+ * \param relation The relation.
+ */
+void ObstacleTable::set_relation(
+    EntityType obstacle_type, EntityType other_type, Relation relation) {
+
+  relations[static_cast<size_t>(obstacle_type) * num_types +
+      static_cast<size_t>(other_type)] = relation;
+}
+
+/**
+ * \brief Sets the relation of a type with all other types.
+ *
+ * Custom entities are left to the virtual test,
+ * because their rules can be changed from Lua.
+ *
+ * \param obstacle_type Type of the entity that may be an obstacle.
+ * \param relation The relation.
+ */
+void ObstacleTable::set_obstacle_relation(EntityType obstacle_type, Relation relation) {
+
+  for (const auto& kvp: EnumInfoTraits<EntityType>::names) {
+    if (kvp.first != EntityType::CUSTOM) {
+      set_relation(obstacle_type, kvp.first, relation);
+    }
+  }
+}
+
+/**
+ * \brief Sets the relations of a type whose obstacle test only calls a hook
+ * on the other entity.
+ * \param obstacle_type Type of the entity that may be an obstacle.
+ * \param hook_default Value returned by the hook in Entity.
+ * \param types_overriding_hook Types whose class overrides the hook.
+ * Custom entities always do.
+ */
+void ObstacleTable::set_hook_relation(
+    EntityType obstacle_type,
+    bool hook_default,
+    const std::vector<EntityType>& types_overriding_hook
+) {
+  set_obstacle_relation(obstacle_type, hook_default ? Relation::ALWAYS : Relation::NEVER);
+  for (EntityType type: types_overriding_hook) {
+    set_relation(obstacle_type, type, Relation::TEST);
+  }
+}
+
+}
+
@@ -20,6 +20,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/Entities.h"
@@ -113,7 +114,9 @@ std::shared_ptr<Pickable> Pickable::create(
     return nullptr;
   }
 
-  std::shared_ptr<Pickable> pickable = std::make_shared<Pickable>(
+  // Many pickables appear and disappear during fights:
+  // reuse the memory of previous ones.
+  std::shared_ptr<Pickable> pickable = make_recycled_shared<Pickable>(
       name, layer, xy, treasure
   );
 
@@ -243,7 +246,7 @@ void Pickable::notify_created() {
 void Pickable::initialize_movement() {
 
   if (is_falling()) {
-    set_movement(std::make_shared<FallingOnFloorMovement>(falling_height));
+    set_movement(make_recycled_shared<FallingOnFloorMovement>(falling_height));
   }
 }
 
@@ -321,7 +324,7 @@ void Pickable::notify_collision(Entity& entity_overlapping, CollisionMode /* col
 
     if (entity_followed != nullptr) {
       clear_movement();
-      set_movement(std::make_shared<RelativeMovement>(
+      set_movement(make_recycled_shared<RelativeMovement>(
           entity_followed, 0, 0, true
       ));
       falling_height = FALLING_NONE;
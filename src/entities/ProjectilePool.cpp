@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Geometry.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/GroundRaster.h"
+#include "solarus/entities/ProjectilePool.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a pool with no projectiles.
+ * \param image Image of each projectile.
+ * \param size Size of the collision box of each projectile.
+ * \param layer Layer of the projectiles on the map.
+ */
+ProjectilePool::ProjectilePool(const SurfacePtr& image, const Size& size, int layer):
+  ExportableToLua(),
+  image(image),
+  size(size),
+  layer(layer),
+  target_types({ EntityType::HERO }),
+  max_projectiles(default_max_projectiles),
+  next_id(1),
+  last_update_date(System::now()),
+  ids(),
+  xs(),
+  ys(),
+  speeds_x(),
+  speeds_y(),
+  indexes(),
+  targets() {
+
+  Debug::check_assertion(image != nullptr, "Missing projectile image");
+}
+
+/**
+ * \brief Returns the image of projectiles.
+ * \return The projectile image.
+ */
+const SurfacePtr& ProjectilePool::get_image() const {
+  return image;
+}
+
+/**
+ * \brief Returns the size of the collision box of projectiles.
+ * \return The size of a projectile.
+ */
+const Size& ProjectilePool::get_size() const {
+  return size;
+}
+
+/**
+ * \brief Returns the layer of projectiles.
+ * \return The layer.
+ */
+int ProjectilePool::get_layer() const {
+  return layer;
+}
+
+/**
+ * \brief Returns the types of entities that projectiles hit.
+ * \return The target types.
+ */
+const std::set<EntityType>& ProjectilePool::get_target_types() const {
+  return target_types;
+}
+
+/**
+ * \brief Sets the types of entities that projectiles hit.
+ * \param target_types The target types. Empty means only walls.
+ */
+void ProjectilePool::set_target_types(const std::set<EntityType>& target_types) {
+  this->target_types = target_types;
+}
+
+/**
+ * \brief Returns the maximum number of projectiles alive at the same time.
+ * \return The maximum number of projectiles.
+ */
+int ProjectilePool::get_max_projectiles() const {
+  return max_projectiles;
+}
+
+/**
+ * \brief Sets the maximum number of projectiles alive at the same time.
+ *
+ * Projectiles beyond this number are removed.
+ *
+ * \param max_projectiles The maximum number of projectiles.
+ */
+void ProjectilePool::set_max_projectiles(int max_projectiles) {
+
+  this->max_projectiles = std::max(max_projectiles, 0);
+  while (get_num_projectiles() > this->max_projectiles) {
+    remove_projectile_at(ids.size() - 1);
+  }
+}
+
+/**
+ * \brief Returns the number of projectiles alive.
+ * \return The number of projectiles.
+ */
+int ProjectilePool::get_num_projectiles() const {
+  return static_cast<int>(ids.size());
+}
+
+/**
+ * \brief Creates a projectile.
+ * \param x X coordinate of the center of the projectile on the map.
+ * \param y Y coordinate of the center of the projectile on the map.
+ * \param angle Direction in radians. 0 is to the right
+ * and angles increase counter-clockwise like other angles of the engine.
+ * \param speed Speed in pixels per second.
+ * \return Id of the new projectile, or 0 if the maximum is reached.
+ */
+uint32_t ProjectilePool::create_projectile(double x, double y, double angle, double speed) {
+
+  if (get_num_projectiles() >= max_projectiles) {
+    return 0;
+  }
+
+  const uint32_t id = next_id;
+  ++next_id;
+  if (next_id == 0) {
+    next_id = 1;
+  }
+
+  indexes[id] = ids.size();
+  ids.push_back(id);
+  xs.push_back(static_cast<float>(x));
+  ys.push_back(static_cast<float>(y));
+  // The y axis goes down.
+  speeds_x.push_back(static_cast<float>(speed * Geometry::get_cos(angle)));
+  speeds_y.push_back(static_cast<float>(-speed * Geometry::get_sin(angle)));
+  return id;
+}
+
+/**
+ * \brief Returns whether a projectile is still alive.
+ * \param id Id of a projectile.
+ * \return \c true if it exists.
+ */
+bool ProjectilePool::has_projectile(uint32_t id) const {
+  return indexes.find(id) != indexes.end();
+}
+
+/**
+ * \brief Returns the position of a projectile.
+ * \param id Id of an existing projectile.
+ * \return Coordinates of its center on the map.
+ */
+Point ProjectilePool::get_projectile_xy(uint32_t id) const {
+
+  const auto it = indexes.find(id);
+  Debug::check_assertion(it != indexes.end(), "No such projectile");
+  const size_t index = it->second;
+  return Point(
+      static_cast<int>(std::floor(xs[index])),
+      static_cast<int>(std::floor(ys[index]))
+  );
+}
+
+/**
+ * \brief Removes a projectile.
+ * \param id Id of a projectile. Nothing happens if it does not exist.
+ */
+void ProjectilePool::remove_projectile(uint32_t id) {
+
+  const auto it = indexes.find(id);
+  if (it != indexes.end()) {
+    remove_projectile_at(it->second);
+  }
+}
+
+/**
+ * \brief Removes all projectiles.
+ */
+void ProjectilePool::clear() {
+
+  ids.clear();
+  xs.clear();
+  ys.clear();
+  speeds_x.clear();
+  speeds_y.clear();
+  indexes.clear();
+}
+
+/**
+ * \brief Removes a projectile from the arrays.
+ *
+ * The last projectile takes its place.
+ *
+ * \param index Index of the projectile to remove.
+ */
+void ProjectilePool::remove_projectile_at(size_t index) {
+
+  const size_t last = ids.size() - 1;
+  indexes.erase(ids[index]);
+  if (index != last) {
+    ids[index] = ids[last];
+    xs[index] = xs[last];
+    ys[index] = ys[last];
+    speeds_x[index] = speeds_x[last];
+    speeds_y[index] = speeds_y[last];
+    indexes[ids[index]] = index;
+  }
+  ids.pop_back();
+  xs.pop_back();
+  ys.pop_back();
+  speeds_x.pop_back();
+  speeds_y.pop_back();
+}
+
+/**
+ * \brief Returns the collision box of a projectile.
+ * \param x X coordinate of the center of the projectile.
+ * \param y Y coordinate of the center of the projectile.
+ * \return The collision box on the map.
+ */
+Rectangle ProjectilePool::get_box(float x, float y) const {
+
+  return Rectangle(
+      static_cast<int>(std::floor(x)) - size.width / 2,
+      static_cast<int>(std::floor(y)) - size.height / 2,
+      size.width,
+      size.height
+  );
+}
+
+/**
+ * \brief Moves a projectile and tests walls along its path.
+ *
+ * The region covering the whole move is tested first.
+ * Only if it contains a wall, the path is followed pixel by pixel
+ * to find where the projectile stops.
+ *
+ * \param[in] map The map.
+ * \param[in] index Index of the projectile.
+ * \param[in] delta Elapsed time in seconds.
+ * \param[out] hits Where to add the projectile if it hits a wall.
+ * \return \c false if the projectile hit a wall or is not entirely
+ * in the map anymore. It should then be removed.
+ */
+bool ProjectilePool::move_projectile(Map& map, size_t index, float delta, std::vector<Hit>& hits) {
+
+  const float old_x = xs[index];
+  const float old_y = ys[index];
+  const float new_x = old_x + speeds_x[index] * delta;
+  const float new_y = old_y + speeds_y[index] * delta;
+  xs[index] = new_x;
+  ys[index] = new_y;
+
+  const Rectangle old_box = get_box(old_x, old_y);
+  const Rectangle new_box = get_box(new_x, new_y);
+  const Rectangle path_box = old_box | new_box;
+  if (map.test_collision_with_border(path_box)) {
+    return false;
+  }
+
+  const GroundRaster& raster = map.get_entities().get_ground_raster(layer);
+  if (!raster.has_wall(path_box)) {
+    return true;
+  }
+
+  const int num_steps = std::max(
+      std::abs(new_box.get_x() - old_box.get_x()),
+      std::abs(new_box.get_y() - old_box.get_y())
+  );
+  Point free_xy = old_box.get_center();
+  for (int i = 1; i <= num_steps; ++i) {
+    const float ratio = static_cast<float>(i) / num_steps;
+    const Rectangle box = get_box(
+        old_x + (new_x - old_x) * ratio,
+        old_y + (new_y - old_y) * ratio
+    );
+    if (raster.has_wall(box)) {
+      hits.push_back({ ids[index], free_xy, nullptr });
+      return false;
+    }
+    free_xy = box.get_center();
+  }
+  return true;
+}
+
+/**
+ * \brief Tests projectiles against the entities of the target types.
+ *
+ * Entities are looked up once in the region of all projectiles.
+ *
+ * \param[in] map The map.
+ * \param[out] hits Where to add the projectiles that hit an entity.
+ */
+void ProjectilePool::check_targets(Map& map, std::vector<Hit>& hits) {
+
+  if (ids.empty() || target_types.empty()) {
+    return;
+  }
+
+  Rectangle region = get_box(xs[0], ys[0]);
+  for (size_t i = 1; i < ids.size(); ++i) {
+    region |= get_box(xs[i], ys[i]);
+  }
+
+  map.get_entities().get_entities_in_rectangle(region, targets);
+  targets.erase(std::remove_if(targets.begin(), targets.end(), [this](const Entity* entity) {
+    return entity->get_layer() != layer ||
+        !entity->is_enabled() ||
+        entity->is_being_removed() ||
+        target_types.find(entity->get_type()) == target_types.end();
+  }), targets.end());
+  if (targets.empty()) {
+    return;
+  }
+
+  size_t i = 0;
+  while (i < ids.size()) {
+    const Rectangle box = get_box(xs[i], ys[i]);
+    Entity* entity_hit = nullptr;
+    for (Entity* target: targets) {
+      if (target->get_bounding_box().overlaps(box)) {
+        entity_hit = target;
+        break;
+      }
+    }
+    if (entity_hit != nullptr) {
+      hits.push_back({ ids[i], box.get_center(), entity_hit });
+      remove_projectile_at(i);
+    }
+    else {
+      ++i;
+    }
+  }
+}
+
+/**
+ * \brief Moves projectiles and detects what they hit.
+ *
+ * Does nothing while the map is suspended.
+ *
+ * \param[in] map The map of the projectiles.
+ * \param[out] hits Where to add the projectiles that hit a wall or an entity.
+ * They are already removed.
+ */
+void ProjectilePool::update(Map& map, std::vector<Hit>& hits) {
+
+  const uint32_t now = System::now();
+  const uint32_t elapsed = now - last_update_date;
+  last_update_date = now;
+  if (map.is_suspended() || elapsed == 0 || !map.is_valid_layer(layer)) {
+    return;
+  }
+
+  const float delta = elapsed / 1000.0f;
+  size_t i = 0;
+  while (i < ids.size()) {
+    if (move_projectile(map, i, delta, hits)) {
+      ++i;
+    }
+    else {
+      remove_projectile_at(i);
+    }
+  }
+
+  check_targets(map, hits);
+}
+
+/**
+ * \brief Draws projectiles visible by the camera of the map.
+ * \param map The map of the projectiles.
+ */
+void ProjectilePool::draw(Map& map) const {
+
+  const CameraPtr& camera = map.get_drawing_camera();
+  if (camera == nullptr) {
+    return;
+  }
+
+  const SurfacePtr& camera_surface = camera->get_surface();
+  const Size& image_size = image->get_size();
+  const Point origin = camera->get_interpolated_top_left_xy() +
+      Point(image_size.width / 2, image_size.height / 2);
+  const Rectangle visible_region(
+      Point(-image_size.width, -image_size.height),
+      camera_surface->get_size() + image_size
+  );
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const Point position = Point(
+        static_cast<int>(std::floor(xs[i])),
+        static_cast<int>(std::floor(ys[i]))
+    ) - origin;
+    if (visible_region.contains(position)) {
+      image->draw(camera_surface, position);
+    }
+  }
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return the name identifying this type in Lua
+ */
+const std::string& ProjectilePool::get_lua_type_name() const {
+  return LuaContext::projectile_pool_module_name;
+}
+
+}
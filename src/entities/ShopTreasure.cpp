@@ -212,28 +212,29 @@ void ShopTreasure::update() {
  */
 void ShopTreasure::draw_on_map() {
 
-  const CameraPtr& camera = get_map().get_camera();
+  const CameraPtr& camera = get_map().get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
 
   const SurfacePtr& map_surface = get_map().get_camera_surface();
+  const Point& camera_xy = camera->get_interpolated_top_left_xy();
   int x = get_x();
   int y = get_y();
 
   // draw the treasure
   treasure_sprite->draw(map_surface,
-      x + 16 - camera->get_top_left_x(),
-      y + 13 - camera->get_top_left_y()
+      x + 16 - camera_xy.x,
+      y + 13 - camera_xy.y
   );
 
   // also draw the price
   price_digits.draw(map_surface,
-      x + 12 - camera->get_top_left_x(),
-      y + 21 - camera->get_top_left_y());
+      x + 12 - camera_xy.x,
+      y + 21 - camera_xy.y);
   rupee_icon_sprite->draw(map_surface,
-      x - camera->get_top_left_x(),
-      y + 22 - camera->get_top_left_y());
+      x - camera_xy.x,
+      y + 22 - camera_xy.y);
 }
 
 }
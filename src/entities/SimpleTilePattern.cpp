@@ -18,9 +18,48 @@
 #include "solarus/entities/SimpleTilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Surface.h"
+#include <SDL_surface.h>
+#include <cstdint>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Blends a straight alpha pixel onto a premultiplied alpha one.
+ *
+ * This does the same as the blend mode used by the GPU for premultiplied
+ * destinations.
+ *
+ * \param src The source pixel.
+ * \param dst The destination pixel.
+ * \param alpha_shift Position of the alpha channel in pixels.
+ * \return The blended pixel.
+ */
+uint32_t blend_pixel(uint32_t src, uint32_t dst, int alpha_shift) {
+
+  const uint32_t src_alpha = (src >> alpha_shift) & 0xff;
+  const uint32_t dst_alpha = (dst >> alpha_shift) & 0xff;
+  const uint32_t inverse_alpha = 255 - src_alpha;
+
+  uint32_t result = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    const uint32_t src_value = (src >> shift) & 0xff;
+    const uint32_t dst_value = (dst >> shift) & 0xff;
+    uint32_t value;
+    if (shift == alpha_shift) {
+      value = src_alpha + (dst_alpha * inverse_alpha + 127) / 255;
+    }
+    else {
+      value = (src_value * src_alpha + dst_value * inverse_alpha + 127) / 255;
+    }
+    result |= value << shift;
+  }
+  return result;
+}
+
+}
+
 /**
  * \brief Creates a simple tile pattern.
  * \param ground Kind of the of the tile pattern.
@@ -51,6 +90,50 @@ void SimpleTilePattern::draw(
   tileset_image->draw_region(position_in_tileset, dst_surface, dst_position);
 }
 
+/**
+ * \copydoc TilePattern::draw_software
+ */
+bool SimpleTilePattern::draw_software(
+    SDL_Surface& dst_surface,
+    const Point& dst_position,
+    const SDL_Surface& tiles_image
+) const {
+
+  // Clip like draw_region() does: to the tileset image, then to the destination.
+  const Rectangle src_rect = position_in_tileset &
+      Rectangle(0, 0, tiles_image.w, tiles_image.h);
+  Rectangle dst_rect(
+      dst_position + src_rect.get_xy() - position_in_tileset.get_xy(),
+      src_rect.get_size()
+  );
+  dst_rect &= Rectangle(0, 0, dst_surface.w, dst_surface.h);
+  if (dst_rect.is_flat()) {
+    return true;
+  }
+  const Point src_xy = dst_rect.get_xy() - dst_position + position_in_tileset.get_xy();
+
+  const int alpha_shift = tiles_image.format->Ashift;
+  for (int i = 0; i < dst_rect.get_height(); ++i) {
+    const uint32_t* src = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(tiles_image.pixels) + (src_xy.y + i) * tiles_image.pitch
+    ) + src_xy.x;
+    uint32_t* dst = reinterpret_cast<uint32_t*>(
+        static_cast<uint8_t*>(dst_surface.pixels) + (dst_rect.get_y() + i) * dst_surface.pitch
+    ) + dst_rect.get_x();
+
+    for (int j = 0; j < dst_rect.get_width(); ++j) {
+      const uint32_t alpha = (src[j] >> alpha_shift) & 0xff;
+      if (alpha == 255) {
+        dst[j] = src[j];
+      }
+      else if (alpha != 0) {
+        dst[j] = blend_pixel(src[j], dst[j], alpha_shift);
+      }
+    }
+  }
+  return true;
+}
+
 /**
  * \brief Returns whether this tile pattern is animated, i.e. not always displayed
  * the same way.
@@ -37,7 +37,12 @@ StreamAction::StreamAction(Stream& stream, Entity& entity_moved):
   when_suspended(0),
   target(0, 0),
   next_move_date(0),
-  delay(0) {
+  delay(0),
+  stream_direction(-1),
+  stream_speed(-1),
+  stream_step(0, 0),
+  straight_delay(0),
+  diagonal_delay(0) {
 
   recompute_movement();
 
@@ -70,31 +75,54 @@ bool StreamAction::is_active() const {
 }
 
 /**
- * \brief Updates the direction of the movement to the target.
+ * \brief Recomputes the step and delays of the movement
+ * if the direction or the speed of the stream has changed.
  *
- * This function should be called periodically.
+ * They are called for each pixel moved but only change when a script
+ * modifies the stream.
  */
-void StreamAction::recompute_movement() {
+void StreamAction::update_stream_parameters() {
 
-  if (!is_active()) {
+  const int direction8 = stream->get_direction();
+  const int speed = stream->get_speed();
+  if (direction8 == stream_direction && speed == stream_speed) {
     return;
   }
 
-  // Compute the direction of the movement and its target point.
-  const int direction8 = stream->get_direction();
-  const Point& xy = Entity::direction_to_xy_move(direction8);
-  const int dx = xy.x;
-  const int dy = xy.y;
-  const int speed = stream->get_speed();
+  stream_direction = direction8;
+  stream_speed = speed;
+  stream_step = Entity::direction_to_xy_move(direction8);
 
   if (speed > 0) {
-    delay = (uint32_t) (1000 / speed);
+    straight_delay = (uint32_t) (1000 / speed);
   }
   else {
     // Stream of speed 0: inactive.
-    delay = 0;
+    straight_delay = 0;
+  }
+  diagonal_delay = straight_delay;
+  if (direction8 % 2 != 0) {
+    // Adjust the speed to the diagonal movement.
+    diagonal_delay = (uint32_t) (straight_delay * std::sqrt(2));
+  }
+}
+
+/**
+ * \brief Updates the direction of the movement to the target.
+ *
+ * This function should be called periodically.
+ */
+void StreamAction::recompute_movement() {
+
+  if (!is_active()) {
+    return;
   }
 
+  // Compute the direction of the movement and its target point.
+  update_stream_parameters();
+  const int dx = stream_step.x;
+  const int dy = stream_step.y;
+
   if (stream->get_allow_movement()) {
     // Don't center the entity on non-blocking streams.
     target = entity_moved->get_xy();
@@ -114,12 +142,7 @@ void StreamAction::recompute_movement() {
     target.y += dy > 0 ? 16 : -16;
   }
 
-  if (stream->get_direction() % 2 != 0) {
-    if (target != entity_moved->get_xy()) {
-      // Adjust the speed to the diagonal movement.
-      delay = (uint32_t) (delay * std::sqrt(2));
-    }
-  }
+  delay = (target != entity_moved->get_xy()) ? diagonal_delay : straight_delay;
 
   const SpritePtr& sprite = stream->get_sprite();
   if (sprite != nullptr &&
@@ -33,8 +33,9 @@ Tile::Tile(
 ):
   Entity("", 0, tile_info.layer, tile_info.box.get_xy(), tile_info.box.get_size()),
   tile_pattern_id(tile_info.pattern_id),
-  tile_pattern(*tile_info.pattern),
-  tileset(*tile_info.tileset) {
+  tile_pattern_index(tile_info.pattern_index),
+  tile_pattern(tile_info.pattern),
+  tileset(tile_info.tileset) {
 
 }
 
@@ -50,7 +51,7 @@ EntityType Tile::get_type() const {
  * \copydoc Entity::is_drawn_at_its_position()
  */
 bool Tile::is_drawn_at_its_position() const {
-  return tile_pattern.is_drawn_at_its_position();
+  return tile_pattern->is_drawn_at_its_position();
 }
 
 /**
@@ -58,7 +59,7 @@ bool Tile::is_drawn_at_its_position() const {
  */
 void Tile::draw_on_map() {
 
-  const CameraPtr& camera = get_map().get_camera();
+  const CameraPtr& camera = get_map().get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
@@ -66,7 +67,7 @@ void Tile::draw_on_map() {
   // Note that the tiles are also optimized for drawing.
   // This function is called at each frame only if the tile is in an
   // animated region. Otherwise, tiles are drawn once when loading the map.
-  draw(get_map().get_camera_surface(), camera->get_top_left_xy());
+  draw(get_map().get_camera_surface(), camera->get_interpolated_top_left_xy());
 }
 
 /**
@@ -84,10 +85,10 @@ void Tile::draw(const SurfacePtr& dst_surface, const Point& viewport) {
       get_height()
   );
 
-  tile_pattern.fill_surface(
+  tile_pattern->fill_surface(
       dst_surface,
       dst_position,
-      tileset,
+      *tileset,
       viewport
   );
 }
@@ -97,7 +98,7 @@ void Tile::draw(const SurfacePtr& dst_surface, const Point& viewport) {
  * \return The tile pattern.
  */
 const TilePattern& Tile::get_tile_pattern() const {
-  return tile_pattern;
+  return *tile_pattern;
 }
 
 /**
@@ -118,7 +119,23 @@ const std::string& Tile::get_tile_pattern_id() const {
  * \return true if the pattern of this tile is animated
  */
 bool Tile::is_animated() const {
-  return tile_pattern.is_animated();
+  return tile_pattern->is_animated();
+}
+
+/**
+ * \brief Makes this tile use another tileset if it uses the one replaced.
+ * \param old_tileset The tileset being replaced.
+ * \param new_tileset The tileset replacing it.
+ * \param same_patterns \c true to keep the current pattern object.
+ */
+void Tile::switch_tileset(
+    const Tileset& old_tileset,
+    const Tileset& new_tileset,
+    bool same_patterns
+) {
+  Tileset::switch_tile(
+      old_tileset, new_tileset, same_patterns, tile_pattern_index, tileset, tile_pattern
+  );
 }
 
 }
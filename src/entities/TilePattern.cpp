@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/entities/AnimatedTilePattern.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/TilePattern.h"
@@ -101,16 +102,6 @@ void TilePattern::quit() {
   TimeScrollingTilePattern::quit();
 }
 
-/**
- * \brief Updates the tile pattern system.
- *
- * This function is called repeatedly by the main loop.
- */
-void TilePattern::update() {
-  AnimatedTilePattern::update();
-  TimeScrollingTilePattern::update();
-}
-
 /**
  * \brief Returns whether this tile pattern is animated, i.e. not always drawn
  * the same way.
@@ -184,5 +175,65 @@ void TilePattern::fill_surface(
   }
 }
 
+/**
+ * \brief Draws the tile image on a software surface, without the GPU.
+ *
+ * This allows to prepare pixels on any thread.
+ * Only non-animated tile patterns can support this.
+ *
+ * \param dst_surface The destination pixels, in RGBA format with
+ * premultiplied alpha.
+ * \param dst_position Position where the tile pattern should be drawn.
+ * \param tiles_image Pixels of the tiles image of the tileset,
+ * in RGBA format.
+ * \return \c false if this tile pattern cannot be drawn this way.
+ */
+bool TilePattern::draw_software(
+    SDL_Surface& /* dst_surface */,
+    const Point& /* dst_position */,
+    const SDL_Surface& /* tiles_image */
+) const {
+  return false;
 }
 
+/**
+ * \brief Fills a rectangle of a software surface by repeating this tile
+ * pattern.
+ *
+ * This is the software equivalent of fill_surface(): see draw_software().
+ *
+ * \param dst_surface The destination pixels.
+ * \param dst_position Rectangle of the destination to fill.
+ * \param tiles_image Pixels of the tiles image of the tileset.
+ * \return \c false if this tile pattern cannot be drawn this way.
+ */
+bool TilePattern::fill_software_surface(
+    SDL_Surface& dst_surface,
+    const Rectangle& dst_position,
+    const SDL_Surface& tiles_image
+) const {
+
+  const int limit_x = dst_position.get_x() + dst_position.get_width();
+  const int limit_y = dst_position.get_y() + dst_position.get_height();
+
+  for (int y = dst_position.get_y(); y < limit_y; y += get_height()) {
+
+    if (y > dst_surface.h || y + get_height() <= 0) {
+      continue;
+    }
+
+    for (int x = dst_position.get_x(); x < limit_x; x += get_width()) {
+
+      if (x > dst_surface.w || x + get_width() <= 0) {
+        continue;
+      }
+
+      if (!draw_software(dst_surface, Point(x, y), tiles_image)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/entities/AnimatedTilePattern.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/ParallaxScrollingTilePattern.h"
@@ -28,10 +29,25 @@
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Interned index of each tile pattern id known so far.
+ */
+std::unordered_map<std::string, int> tile_pattern_indexes;
+
+/**
+ * \brief Tile pattern ids by interned index.
+ */
+std::vector<std::string> tile_pattern_ids;
+
+}  // Anonymous namespace.
+
 /**
  * \brief Constructor.
  * \param id Id of the tileset to create.
@@ -50,6 +66,29 @@ const std::string& Tileset::get_id() const {
   return id;
 }
 
+/**
+ * \brief Returns the interned index of a tile pattern id.
+ *
+ * The same id has the same index in all tilesets.
+ * Tilesets are only loaded from the main thread, so this is not
+ * synchronized.
+ *
+ * \param id Id of a tile pattern.
+ * \return The index of this id, created the first time.
+ */
+int Tileset::get_tile_pattern_index(const std::string& id) {
+
+  const auto& it = tile_pattern_indexes.find(id);
+  if (it != tile_pattern_indexes.end()) {
+    return it->second;
+  }
+
+  const int index = static_cast<int>(tile_pattern_ids.size());
+  tile_pattern_ids.push_back(id);
+  tile_pattern_indexes.emplace(id, index);
+  return index;
+}
+
 /**
  * \brief Adds a new tile pattern to this tileset.
  *
@@ -126,7 +165,22 @@ void Tileset::add_tile_pattern(
     );
   }
 
-  tile_patterns.emplace(id, std::unique_ptr<TilePattern>(tile_pattern));
+  const int index = get_tile_pattern_index(id);
+  if (index >= static_cast<int>(tile_patterns.size())) {
+    tile_patterns.resize(index + 1);
+  }
+  tile_patterns[index] = std::unique_ptr<TilePattern>(tile_pattern);
+
+  patterns_layout.push_back(index);
+  patterns_layout.push_back(static_cast<int>(ground));
+  patterns_layout.push_back(static_cast<int>(scrolling));
+  patterns_layout.push_back(static_cast<int>(frames.size()));
+  for (const Rectangle& frame: frames) {
+    patterns_layout.push_back(frame.get_x());
+    patterns_layout.push_back(frame.get_y());
+    patterns_layout.push_back(frame.get_width());
+    patterns_layout.push_back(frame.get_height());
+  }
 }
 
 /**
@@ -138,16 +192,36 @@ void Tileset::load() {
   std::string file_name = std::string("tilesets/") + id + ".dat";
   TilesetData data;
   bool success = data.import_from_quest_file(file_name);
-  if (success) {
-    // Get the imported data.
-    this->background_color = data.get_background_color();
-    for (const auto& kvp : data.get_patterns()) {
-      add_tile_pattern(kvp.first, kvp.second);
-    }
+  if (!success) {
+    load_images();
+    return;
   }
 
-  // Load the tileset images.
-  file_name = std::string("tilesets/") + id + ".tiles.png";
+  load(data);
+}
+
+/**
+ * \brief Loads the tileset from data already parsed and loads its images.
+ * \param data The tileset data.
+ */
+void Tileset::load(const TilesetData& data) {
+
+  // Get the imported data.
+  this->background_color = data.get_background_color();
+  for (const auto& kvp : data.get_patterns()) {
+    add_tile_pattern(kvp.first, kvp.second);
+  }
+
+  load_images();
+}
+
+/**
+ * \brief Loads the tileset images.
+ */
+void Tileset::load_images() {
+
+  MemoryStats::TextureOrigin origin(MemoryStats::Category::TILESET_TEXTURES);
+  std::string file_name = std::string("tilesets/") + id + ".tiles.png";
   tiles_image = Surface::create(file_name, Surface::DIR_DATA);
   if (tiles_image == nullptr) {
     Debug::error(std::string("Missing tiles image for tileset '") + id + "': " + file_name);
@@ -165,6 +239,7 @@ void Tileset::load() {
 void Tileset::unload() {
 
   tile_patterns.clear();
+  patterns_layout.clear();
   tiles_image = nullptr;
   entities_image = nullptr;
 }
@@ -209,13 +284,81 @@ const SurfacePtr& Tileset::get_entities_image() const {
  */
 const TilePattern& Tileset::get_tile_pattern(const std::string& id) const {
 
-  const auto& it = tile_patterns.find(id);
-  if (it == tile_patterns.end()) {
+  return get_tile_pattern(get_tile_pattern_index(id));
+}
+
+/**
+ * \brief Returns a tile pattern from this tileset.
+ * \param index Interned index of the id of the tile pattern to get.
+ * \return The tile pattern with this id.
+ */
+const TilePattern& Tileset::get_tile_pattern(int index) const {
+
+  const TilePattern* tile_pattern = find_tile_pattern(index);
+  if (tile_pattern == nullptr) {
     std::ostringstream oss;
-    oss << "No such tile pattern in tileset '" << get_id() << "': " << id;
+    oss << "No such tile pattern in tileset '" << get_id() << "': "
+        << tile_pattern_ids[index];
     Debug::die(oss.str());
   }
-  return *it->second;
+  return *tile_pattern;
+}
+
+/**
+ * \brief Returns a tile pattern from this tileset if it exists.
+ * \param index Interned index of the id of the tile pattern to get.
+ * \return The tile pattern with this id, or nullptr.
+ */
+const TilePattern* Tileset::find_tile_pattern(int index) const {
+
+  if (index < 0 || index >= static_cast<int>(tile_patterns.size())) {
+    return nullptr;
+  }
+  return tile_patterns[index].get();
+}
+
+/**
+ * \brief Returns whether another tileset is a sibling of this one.
+ *
+ * Siblings have patterns with the same ids, grounds, scrolling and
+ * frames: only their images differ.
+ *
+ * \param other Another tileset.
+ * \return \c true if both tilesets have the same patterns.
+ */
+bool Tileset::has_same_patterns(const Tileset& other) const {
+  return patterns_layout == other.patterns_layout;
+}
+
+/**
+ * \brief Makes a tile drawn with a tileset use another one.
+ *
+ * Tiles of other tilesets are unchanged.
+ *
+ * \param old_tileset The tileset being replaced.
+ * \param new_tileset The tileset replacing it.
+ * \param same_patterns \c true if the tiles can keep their pattern objects:
+ * the tilesets are siblings and the old one stays in memory.
+ * \param pattern_index Interned index of the pattern of the tile.
+ * \param[in,out] tileset Tileset of the tile.
+ * \param[in,out] pattern Pattern of the tile.
+ */
+void Tileset::switch_tile(
+    const Tileset& old_tileset,
+    const Tileset& new_tileset,
+    bool same_patterns,
+    int pattern_index,
+    const Tileset*& tileset,
+    const TilePattern*& pattern
+) {
+  if (tileset != &old_tileset) {
+    return;
+  }
+
+  if (!same_patterns) {
+    pattern = &new_tileset.get_tile_pattern(pattern_index);
+  }
+  tileset = &new_tileset;
 }
 
 /**
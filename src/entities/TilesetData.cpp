@@ -14,12 +14,15 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/TilesetData.h"
 #include "solarus/lua/LuaTools.h"
 #include <ostream>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -244,8 +247,9 @@ bool TilesetData::pattern_exists(const std::string& pattern_id) const {
 const TilePatternData& TilesetData::get_pattern(const std::string& pattern_id) const {
 
   const auto& it = patterns.find(pattern_id);
-  Debug::check_assertion(it != patterns.end(),
-    std::string("No such tile pattern: '") + pattern_id + "'");
+  Debug::check_assertion_lazy(it != patterns.end(), [&] {
+    return std::string("No such tile pattern: '") + pattern_id + "'";
+  });
 
   return it->second;
 }
@@ -262,8 +266,9 @@ const TilePatternData& TilesetData::get_pattern(const std::string& pattern_id) c
 TilePatternData& TilesetData::get_pattern(const std::string& pattern_id) {
 
   const auto& it = patterns.find(pattern_id);
-  Debug::check_assertion(it != patterns.end(),
-    std::string("No such tile pattern: '") + pattern_id + "'");
+  Debug::check_assertion_lazy(it != patterns.end(), [&] {
+    return std::string("No such tile pattern: '") + pattern_id + "'";
+  });
 
   return it->second;
 }
@@ -357,8 +362,9 @@ bool TilesetData::border_set_exists(const std::string& border_set_id) const {
 const BorderSet& TilesetData::get_border_set(const std::string& border_set_id) const {
 
   const auto& it = border_sets.find(border_set_id);
-  Debug::check_assertion(it != border_sets.end(),
-    std::string("No such border set: '") + border_set_id + "'");
+  Debug::check_assertion_lazy(it != border_sets.end(), [&] {
+    return std::string("No such border set: '") + border_set_id + "'";
+  });
 
   return it->second;
 }
@@ -375,8 +381,9 @@ const BorderSet& TilesetData::get_border_set(const std::string& border_set_id) c
 BorderSet& TilesetData::get_border_set(const std::string& border_set_id) {
 
   const auto& it = border_sets.find(border_set_id);
-  Debug::check_assertion(it != border_sets.end(),
-    std::string("No such border set: '") + border_set_id + "'");
+  Debug::check_assertion_lazy(it != border_sets.end(), [&] {
+    return std::string("No such border set: '") + border_set_id + "'";
+  });
 
   return it->second;
 }
@@ -717,4 +724,147 @@ bool TilesetData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::get_binary_magic
+ */
+std::string TilesetData::get_binary_magic() const {
+  return { 'S', 'O', 'L', 'T', 'L', 'S', '\r', '\n' };
+}
+
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool TilesetData::import_from_binary(BinaryReader& reader) {
+
+  TilesetData tileset;
+
+  // Background color.
+  const uint8_t r = reader.read_uint8();
+  const uint8_t g = reader.read_uint8();
+  const uint8_t b = reader.read_uint8();
+  const uint8_t a = reader.read_uint8();
+  tileset.set_background_color(Color(r, g, b, a));
+
+  // Tile patterns.
+  const uint32_t num_patterns = reader.read_uint32();
+  if (!reader.can_read(num_patterns, 36)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_patterns; ++i) {
+    const std::string& id = reader.read_string();
+    bool ground_found = false;
+    bool scrolling_found = false;
+    bool repeat_mode_found = false;
+    TilePatternData pattern;
+    pattern.set_ground(name_to_enum(
+        reader.read_string(), Ground::TRAVERSABLE, ground_found));
+    pattern.set_default_layer(reader.read_int32());
+    pattern.set_scrolling(name_to_enum(
+        reader.read_string(), TileScrolling::NONE, scrolling_found));
+    pattern.set_repeat_mode(name_to_enum(
+        reader.read_string(), TilePatternRepeatMode::ALL, repeat_mode_found));
+    const int width = reader.read_int32();
+    const int height = reader.read_int32();
+    const uint32_t num_frames = reader.read_uint32();
+    if (!reader.is_valid() ||
+        !ground_found ||
+        !scrolling_found ||
+        !repeat_mode_found ||
+        (num_frames != 1 && num_frames != 3 && num_frames != 4) ||
+        !reader.can_read(num_frames, 8)) {
+      return false;
+    }
+    std::vector<Rectangle> frames;
+    for (uint32_t j = 0; j < num_frames; ++j) {
+      const int x = reader.read_int32();
+      const int y = reader.read_int32();
+      frames.emplace_back(x, y, width, height);
+    }
+    pattern.set_frames(frames);
+    if (!tileset.add_pattern(id, pattern)) {
+      return false;
+    }
+  }
+
+  // Border sets.
+  const uint32_t num_border_sets = reader.read_uint32();
+  if (!reader.can_read(num_border_sets, 9)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_border_sets; ++i) {
+    const std::string& id = reader.read_string();
+    BorderSet border_set;
+    border_set.set_inner(reader.read_uint8() != 0);
+    const uint32_t num_border_patterns = reader.read_uint32();
+    if (!reader.can_read(num_border_patterns, 5)) {
+      return false;
+    }
+    for (uint32_t j = 0; j < num_border_patterns; ++j) {
+      const uint8_t border_kind = reader.read_uint8();
+      const std::string& pattern_id = reader.read_string();
+      if (border_kind >= 12) {
+        return false;
+      }
+      border_set.set_pattern(static_cast<BorderKind>(border_kind), pattern_id);
+    }
+    if (!tileset.add_border_set(id, border_set)) {
+      return false;
+    }
+  }
+
+  if (!reader.is_valid()) {
+    return false;
+  }
+
+  *this = std::move(tileset);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool TilesetData::export_to_binary(BinaryWriter& writer) const {
+
+  // Background color.
+  uint8_t r, g, b, a;
+  background_color.get_components(r, g, b, a);
+  writer.write_uint8(r);
+  writer.write_uint8(g);
+  writer.write_uint8(b);
+  writer.write_uint8(a);
+
+  // Tile patterns.
+  writer.write_uint32(static_cast<uint32_t>(patterns.size()));
+  for (const auto& kvp : patterns) {
+    const TilePatternData& pattern = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(enum_to_name(pattern.get_ground()));
+    writer.write_int32(pattern.get_default_layer());
+    writer.write_string(enum_to_name(pattern.get_scrolling()));
+    writer.write_string(enum_to_name(pattern.get_repeat_mode()));
+    writer.write_int32(pattern.get_frame().get_width());
+    writer.write_int32(pattern.get_frame().get_height());
+    writer.write_uint32(static_cast<uint32_t>(pattern.get_num_frames()));
+    for (const Rectangle& frame : pattern.get_frames()) {
+      writer.write_int32(frame.get_x());
+      writer.write_int32(frame.get_y());
+    }
+  }
+
+  // Border sets.
+  writer.write_uint32(static_cast<uint32_t>(border_sets.size()));
+  for (const auto& kvp : border_sets) {
+    const BorderSet& border_set = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_uint8(border_set.is_inner() ? 1 : 0);
+    writer.write_uint32(static_cast<uint32_t>(border_set.get_patterns().size()));
+    for (const auto& pattern_kvp : border_set.get_patterns()) {
+      writer.write_uint8(static_cast<uint8_t>(pattern_kvp.first));
+      writer.write_string(pattern_kvp.second);
+    }
+  }
+
+  return true;
+}
+
 }
@@ -21,8 +21,7 @@
 
 namespace Solarus {
 
-int TimeScrollingTilePattern::shift = 0;
-uint32_t TimeScrollingTilePattern::next_shift_date = 0;
+uint32_t TimeScrollingTilePattern::start_date = 0;
 
 /**
  * \brief Creates a tile pattern with scrolling.
@@ -40,31 +39,14 @@ TimeScrollingTilePattern::TimeScrollingTilePattern(Ground ground,
  * \brief Initializes the time-scrolling tile pattern system.
  */
 void TimeScrollingTilePattern::initialize() {
-  shift = System::now();
-  next_shift_date = System::now();
+  start_date = System::now();
 }
 
 /**
  * \brief Cleans the animated time-scrolling tile pattern system.
  */
 void TimeScrollingTilePattern::quit() {
-  shift = 0;
-  next_shift_date = 0;
-}
-
-/**
- * \brief Updates all scrolling tiles patterns.
- *
- * This function is called repeatedly by the map.
- */
-void TimeScrollingTilePattern::update() {
-
-  const uint32_t now = System::now();
-
-  while (now >= next_shift_date) {
-    shift++;
-    next_shift_date += 50;
-  }
+  start_date = 0;
 }
 
 /**
@@ -84,7 +66,10 @@ void TimeScrollingTilePattern::draw(
   Rectangle src = position_in_tileset;
   Point dst = dst_position;
 
-  Point offset; // draw the tile with an offset that depends on the time
+  // Draw the tile with an offset that depends on the time:
+  // one more pixel every 50 ms.
+  const int shift = static_cast<int>((System::now() - start_date) / 50);
+  Point offset;
 
   offset.x = src.get_width() - (shift % src.get_width());
   offset.y = shift % src.get_height();
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/DrawList.h"
+#include "solarus/graphics/Surface.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty draw list.
+ */
+DrawList::DrawList():
+  commands() {
+
+}
+
+/**
+ * \brief Returns whether nothing is recorded.
+ * \return \c true if the list has no operation.
+ */
+bool DrawList::is_empty() const {
+  return commands.empty();
+}
+
+/**
+ * \brief Returns the number of recorded operations.
+ * \return The number of operations.
+ */
+size_t DrawList::get_num_commands() const {
+  return commands.size();
+}
+
+/**
+ * \brief Removes all recorded operations.
+ *
+ * The storage is kept for the next recording.
+ */
+void DrawList::clear() {
+  commands.clear();
+}
+
+/**
+ * \brief Records the draw of a whole drawable.
+ * \param drawable The drawable to draw.
+ * \param dst_position Where to draw it on the destination.
+ */
+void DrawList::add_draw(const DrawablePtr& drawable, const Point& dst_position) {
+
+  commands.push_back({ CommandType::DRAW, drawable, Rectangle(), dst_position, Color() });
+}
+
+/**
+ * \brief Records the draw of a region of a drawable.
+ * \param drawable The drawable to draw.
+ * \param region The region of the drawable to draw.
+ * \param dst_position Where to draw it on the destination.
+ */
+void DrawList::add_draw_region(
+    const DrawablePtr& drawable,
+    const Rectangle& region,
+    const Point& dst_position) {
+
+  commands.push_back({ CommandType::DRAW_REGION, drawable, region, dst_position, Color() });
+}
+
+/**
+ * \brief Records the clearing of the destination.
+ */
+void DrawList::add_clear() {
+
+  commands.push_back({ CommandType::CLEAR, nullptr, Rectangle(), Point(), Color() });
+}
+
+/**
+ * \brief Records filling the whole destination with a color.
+ * \param color The color.
+ */
+void DrawList::add_fill(const Color& color) {
+
+  commands.push_back({ CommandType::FILL, nullptr, Rectangle(), Point(), color });
+}
+
+/**
+ * \brief Records filling a rectangle of the destination with a color.
+ * \param color The color.
+ * \param where The rectangle to fill.
+ */
+void DrawList::add_fill(const Color& color, const Rectangle& where) {
+
+  commands.push_back({ CommandType::FILL_RECTANGLE, nullptr, where, Point(), color });
+}
+
+/**
+ * \brief Does the recorded operations again.
+ * \param dst_surface The destination surface.
+ * \param before_draw Function called with each drawable before drawing it.
+ */
+void DrawList::replay(
+    const SurfacePtr& dst_surface,
+    const std::function<void (Drawable&)>& before_draw
+) const {
+
+  for (const Command& command: commands) {
+
+    switch (command.type) {
+
+    case CommandType::DRAW:
+      before_draw(*command.drawable);
+      command.drawable->draw(dst_surface, command.dst_position);
+      break;
+
+    case CommandType::DRAW_REGION:
+      before_draw(*command.drawable);
+      command.drawable->draw_region(command.region, dst_surface, command.dst_position);
+      break;
+
+    case CommandType::CLEAR:
+      dst_surface->clear();
+      break;
+
+    case CommandType::FILL:
+      dst_surface->fill_with_color(command.color);
+      break;
+
+    case CommandType::FILL_RECTANGLE:
+      dst_surface->fill_with_color(command.color, command.region);
+      break;
+    }
+  }
+}
+
+}
+
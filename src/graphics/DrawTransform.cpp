@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/DrawTransform.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the bits of a double to mix them in a signature.
+ * \param value A number.
+ * \return Its bits.
+ */
+uint64_t get_bits(double value) {
+
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a transform that changes nothing.
+ */
+DrawTransform::DrawTransform():
+  rotation(0.0),
+  scale_x(1.0),
+  scale_y(1.0),
+  pivot(),
+  color(255, 255, 255) {
+
+}
+
+/**
+ * \brief Returns whether this transform changes nothing.
+ * \return \c true if there is no rotation, scale or color modulation.
+ */
+bool DrawTransform::is_identity() const {
+  return !is_geometric() && !is_color_modulated();
+}
+
+/**
+ * \brief Returns whether this transform moves pixels.
+ * \return \c true if there is a rotation or a scale.
+ */
+bool DrawTransform::is_geometric() const {
+  return rotation != 0.0 || scale_x != 1.0 || scale_y != 1.0;
+}
+
+/**
+ * \brief Returns whether this transform changes the color of pixels.
+ * \return \c true if the color modulation is not white.
+ */
+bool DrawTransform::is_color_modulated() const {
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  return r != 255 || g != 255 || b != 255;
+}
+
+/**
+ * \brief Transforms a point of the destination.
+ * \param[in,out] x X coordinate of the point.
+ * \param[in,out] y Y coordinate of the point.
+ */
+void DrawTransform::apply(double& x, double& y) const {
+
+  const double dx = (x - pivot.x) * scale_x;
+  const double dy = (y - pivot.y) * scale_y;
+  if (rotation == 0.0) {
+    x = pivot.x + dx;
+    y = pivot.y + dy;
+    return;
+  }
+
+  // The y axis goes down: a counter-clockwise angle is negative in it.
+  const double cos_angle = std::cos(rotation);
+  const double sin_angle = std::sin(rotation);
+  x = pivot.x + dx * cos_angle + dy * sin_angle;
+  y = pivot.y - dx * sin_angle + dy * cos_angle;
+}
+
+/**
+ * \brief Applies the scale of this transform to a rectangle,
+ * ignoring the rotation.
+ * \param rect A rectangle of the destination.
+ * \return The scaled rectangle, with a positive size
+ * even if the scale flips it.
+ */
+Rectangle DrawTransform::get_scaled_rectangle(const Rectangle& rect) const {
+
+  const double x1 = pivot.x + (rect.get_x() - pivot.x) * scale_x;
+  const double x2 = pivot.x + (rect.get_x() + rect.get_width() - pivot.x) * scale_x;
+  const double y1 = pivot.y + (rect.get_y() - pivot.y) * scale_y;
+  const double y2 = pivot.y + (rect.get_y() + rect.get_height() - pivot.y) * scale_y;
+  const int left = static_cast<int>(std::lround(std::min(x1, x2)));
+  const int right = static_cast<int>(std::lround(std::max(x1, x2)));
+  const int top = static_cast<int>(std::lround(std::min(y1, y2)));
+  const int bottom = static_cast<int>(std::lround(std::max(y1, y2)));
+  return Rectangle(left, top, right - left, bottom - top);
+}
+
+/**
+ * \brief Returns the smallest rectangle containing a transformed rectangle.
+ * \param rect A rectangle of the destination.
+ * \return The bounding box of its transformed corners.
+ */
+Rectangle DrawTransform::get_bounding_box(const Rectangle& rect) const {
+
+  if (!is_geometric()) {
+    return rect;
+  }
+
+  double min_x = 0.0, min_y = 0.0, max_x = 0.0, max_y = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    double x = rect.get_x() + ((i & 1) ? rect.get_width() : 0);
+    double y = rect.get_y() + ((i & 2) ? rect.get_height() : 0);
+    apply(x, y);
+    if (i == 0) {
+      min_x = max_x = x;
+      min_y = max_y = y;
+    }
+    else {
+      min_x = std::min(min_x, x);
+      max_x = std::max(max_x, x);
+      min_y = std::min(min_y, y);
+      max_y = std::max(max_y, y);
+    }
+  }
+  const int left = static_cast<int>(std::floor(min_x));
+  const int top = static_cast<int>(std::floor(min_y));
+  return Rectangle(
+      left,
+      top,
+      static_cast<int>(std::ceil(max_x)) - left,
+      static_cast<int>(std::ceil(max_y)) - top
+  );
+}
+
+/**
+ * \brief Mixes this transform into a content signature.
+ * \param signature A content signature.
+ * \return The signature combined with this transform.
+ */
+uint64_t DrawTransform::combine_signature(uint64_t signature) const {
+
+  if (is_identity()) {
+    return signature;
+  }
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  signature = SurfaceImpl::combine_signature(signature, get_bits(rotation));
+  signature = SurfaceImpl::combine_signature(signature, get_bits(scale_x));
+  signature = SurfaceImpl::combine_signature(signature, get_bits(scale_y));
+  signature = SurfaceImpl::combine_signature(signature,
+      (static_cast<uint64_t>(static_cast<uint32_t>(pivot.x)) << 32) | static_cast<uint32_t>(pivot.y));
+  return SurfaceImpl::combine_signature(signature, (r << 16) | (g << 8) | b);
+}
+
+/**
+ * \brief Returns a transform that changes nothing.
+ * \return The identity transform.
+ */
+const DrawTransform& DrawTransform::identity() {
+
+  static const DrawTransform identity;
+  return identity;
+}
+
+}
+
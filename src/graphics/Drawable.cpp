@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/System.h"
 #include "solarus/graphics/Drawable.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/LuaContext.h"
@@ -35,7 +36,8 @@ Drawable::Drawable():
   transition_callback_ref(),
   suspended(false),
   blend_mode(BlendMode::BLEND),
-  opacity(255)
+  opacity(255),
+  transform()
 {
 
 }
@@ -119,12 +121,12 @@ void Drawable::set_xy(const Point& xy) {
  */
 void Drawable::start_transition(
     std::unique_ptr<Transition> transition,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   stop_transition();
 
   this->transition = std::move(transition);
-  this->transition_callback_ref = callback_ref;
+  this->transition_callback_ref = std::move(callback_ref);
   this->transition->start();
   this->transition->set_suspended(is_suspended());
 }
@@ -169,7 +171,7 @@ void Drawable::update() {
     }
   }
 
-  if (movement != nullptr) {
+  if (movement != nullptr && movement->is_update_needed(System::now())) {
     movement->update();
     if (movement != nullptr && movement->is_finished()) {
       stop_movement();
@@ -177,6 +179,19 @@ void Drawable::update() {
   }
 }
 
+/**
+ * \brief Returns whether update() has something to do.
+ *
+ * Objects that are static until a movement or a transition is applied
+ * can then be skipped at each cycle.
+ * Subclasses that change by themselves should redefine this function.
+ *
+ * \return \c true if there is a movement or a transition.
+ */
+bool Drawable::needs_update() const {
+  return movement != nullptr || transition != nullptr;
+}
+
 /**
  * \brief Returns whether this drawable is suspended.
  * \return \c true if this drawable is suspended.
@@ -250,7 +265,12 @@ void Drawable::draw(const SurfacePtr& dst_surface,
  */
 void Drawable::draw(const SurfacePtr &dst_surface, const Point &dst_position, const DrawProxy& proxy) const {
   Point off_dst = dst_position + xy;
-  raw_draw(*dst_surface, DrawInfos(get_region(),off_dst,get_blend_mode(),get_opacity(),proxy));
+  if (transform.is_identity()) {
+    raw_draw(*dst_surface, DrawInfos(get_region(),off_dst,get_blend_mode(),get_opacity(),proxy));
+    return;
+  }
+  const DrawTransform dst_transform = get_dst_transform(off_dst);
+  raw_draw(*dst_surface, DrawInfos(get_region(),off_dst,get_blend_mode(),get_opacity(),proxy,dst_transform));
 }
 
 /**
@@ -292,7 +312,12 @@ void Drawable::draw_region(const Rectangle& region,
     const SurfacePtr& dst_surface,
     const Point& dst_position, const DrawProxy &proxy) const {
   Point off_dst = dst_position + xy;
-  raw_draw_region(*dst_surface, DrawInfos(region,off_dst,get_blend_mode(),get_opacity(),proxy));
+  if (transform.is_identity()) {
+    raw_draw_region(*dst_surface, DrawInfos(region,off_dst,get_blend_mode(),get_opacity(),proxy));
+    return;
+  }
+  const DrawTransform dst_transform = get_dst_transform(off_dst);
+  raw_draw_region(*dst_surface, DrawInfos(region,off_dst,get_blend_mode(),get_opacity(),proxy,dst_transform));
 }
 
 /**
@@ -343,6 +368,102 @@ void Drawable::set_opacity(uint8_t opacity) {
   this->opacity = opacity;
 }
 
+/**
+ * \brief Returns the rotation of this drawable object.
+ * \return The counter-clockwise angle in radians.
+ */
+double Drawable::get_rotation() const {
+  return transform.rotation;
+}
+
+/**
+ * \brief Sets the rotation of this drawable object.
+ *
+ * The rotation is done when drawing, around the transformation origin.
+ *
+ * \param rotation The counter-clockwise angle in radians.
+ */
+void Drawable::set_rotation(double rotation) {
+  transform.rotation = rotation;
+}
+
+/**
+ * \brief Returns the horizontal scale of this drawable object.
+ * \return The horizontal scale, 1.0 means normal size.
+ */
+double Drawable::get_scale_x() const {
+  return transform.scale_x;
+}
+
+/**
+ * \brief Returns the vertical scale of this drawable object.
+ * \return The vertical scale, 1.0 means normal size.
+ */
+double Drawable::get_scale_y() const {
+  return transform.scale_y;
+}
+
+/**
+ * \brief Sets the scale of this drawable object.
+ *
+ * The scale is applied when drawing, around the transformation origin.
+ *
+ * \param scale_x The horizontal scale, negative to flip.
+ * \param scale_y The vertical scale, negative to flip.
+ */
+void Drawable::set_scale(double scale_x, double scale_y) {
+  transform.scale_x = scale_x;
+  transform.scale_y = scale_y;
+}
+
+/**
+ * \brief Returns the point around which this drawable object is rotated
+ * and scaled.
+ * \return The transformation origin, relative to the origin of the drawable.
+ */
+const Point& Drawable::get_transformation_origin() const {
+  return transform.pivot;
+}
+
+/**
+ * \brief Sets the point around which this drawable object is rotated
+ * and scaled.
+ * \param origin The transformation origin, relative to the origin of the drawable.
+ */
+void Drawable::set_transformation_origin(const Point& origin) {
+  transform.pivot = origin;
+}
+
+/**
+ * \brief Returns the color that multiplies the pixels of this drawable object.
+ * \return The color modulation, white by default.
+ */
+const Color& Drawable::get_color_modulation() const {
+  return transform.color;
+}
+
+/**
+ * \brief Sets the color that multiplies the pixels of this drawable object.
+ * \param color The color modulation. White means no change.
+ * The alpha component is ignored: use the opacity instead.
+ */
+void Drawable::set_color_modulation(const Color& color) {
+  transform.color = color;
+}
+
+/**
+ * \brief Returns the transform to use when drawing at a position.
+ * \param dst_position Where the origin of this object is drawn.
+ * \return The transform of this object around a pivot in destination
+ * coordinates.
+ */
+DrawTransform Drawable::get_dst_transform(const Point& dst_position) const {
+
+  DrawTransform dst_transform = transform;
+  dst_transform.pivot = dst_position + transform.pivot;
+  return dst_transform;
+}
+
 const DrawProxy& Drawable::terminal() const {
   if(shader)
     return (const DrawProxy&)(*shader);
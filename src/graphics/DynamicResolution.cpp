@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/DynamicResolution.h"
+#include <algorithm>
+
+namespace Solarus {
+
+constexpr double DynamicResolution::min_scale;
+constexpr double DynamicResolution::scale_step;
+constexpr int DynamicResolution::window_size;
+constexpr double DynamicResolution::high_load;
+constexpr double DynamicResolution::low_load;
+
+/**
+ * \brief Creates a disabled dynamic resolution at full scale.
+ */
+DynamicResolution::DynamicResolution():
+  enabled(false),
+  scale(1.0),
+  total_load(0.0),
+  num_frames(0) {
+
+}
+
+/**
+ * \brief Returns whether the resolution adapts to the load.
+ * \return \c true if dynamic resolution is enabled.
+ */
+bool DynamicResolution::is_enabled() const {
+  return enabled;
+}
+
+/**
+ * \brief Sets whether the resolution adapts to the load.
+ *
+ * Disabling it goes back to the full scale.
+ *
+ * \param enabled \c true to enable dynamic resolution.
+ */
+void DynamicResolution::set_enabled(bool enabled) {
+
+  this->enabled = enabled;
+  scale = 1.0;
+  total_load = 0.0;
+  num_frames = 0;
+}
+
+/**
+ * \brief Returns the current scale of the resolution.
+ * \return The scale, between min_scale and 1.
+ */
+double DynamicResolution::get_scale() const {
+  return scale;
+}
+
+/**
+ * \brief Takes into account the measures of a frame that was drawn.
+ * \param work_time Time spent working during the frame, without sleeping,
+ * in milliseconds.
+ * \param budget Time available for a frame in milliseconds.
+ */
+void DynamicResolution::add_frame(double work_time, double budget) {
+
+  if (!enabled || budget <= 0.0) {
+    return;
+  }
+
+  total_load += work_time / budget;
+  ++num_frames;
+  if (num_frames < window_size) {
+    return;
+  }
+
+  const double load = total_load / num_frames;
+  total_load = 0.0;
+  num_frames = 0;
+  if (load > high_load) {
+    scale = std::max(min_scale, scale - scale_step);
+  }
+  else if (load < low_load) {
+    scale = std::min(1.0, scale + scale_step);
+  }
+}
+
+}
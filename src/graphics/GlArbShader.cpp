@@ -231,12 +231,19 @@ bool GlArbShader::initialize() {
 /**
  * \brief Constructor.
  * \param shader_id Id of the shader to load.
+ * \param built_in_fragment_source Fragment source of a shader provided by the
+ * engine, or an empty string.
  */
-GlArbShader::GlArbShader(const std::string& shader_id):
-    Shader(shader_id),
+GlArbShader::GlArbShader(const std::string& shader_id, const std::string& built_in_fragment_source):
+    Shader(shader_id, built_in_fragment_source),
     program(0),
     vertex_shader(0),
-    fragment_shader(0) {
+    fragment_shader(0),
+    position_location(-1),
+    tex_coord_location(-1),
+    color_location(-1),
+    mvp_matrix_location(-1),
+    uv_matrix_location(-1) {
 
   glGetError();
 
@@ -256,6 +263,8 @@ GlArbShader::GlArbShader(const std::string& shader_id):
   position_location = glGetAttribLocationARB(program,POSITION_NAME);
   tex_coord_location = glGetAttribLocationARB(program,TEXCOORD_NAME);
   color_location = glGetAttribLocationARB(program,COLOR_NAME);
+  mvp_matrix_location = glGetUniformLocationARB(program, MVP_MATRIX_NAME);
+  uv_matrix_location = glGetUniformLocationARB(program, UV_MATRIX_NAME);
 
   glUseProgramObjectARB(previous_program);
 
@@ -293,25 +302,35 @@ void GlArbShader::load() {
 
   set_valid(true);
 
-  // Load the shader data file.
-  const std::string shader_file_name =
-      "shaders/" + get_id() + ".dat";
-
-  ShaderData data;
-  bool success = data.import_from_quest_file(shader_file_name);
-  if (!success) {
-    set_valid(false);
-    return;
+  // An empty id is the built-in shader: it has no data file.
+  std::string vertex_source = default_vertex_source();
+  std::string fragment_source = default_fragment_source();
+  if (!get_built_in_fragment_source().empty()) {
+    // Other shader provided by the engine: no data file either.
+    fragment_source = get_built_in_fragment_source();
+  }
+  else if (!get_id().empty()) {
+    // Load the shader data file.
+    const std::string shader_file_name =
+        "shaders/" + get_id() + ".dat";
+
+    ShaderData data;
+    bool success = data.import_from_quest_file(shader_file_name);
+    if (!success) {
+      set_valid(false);
+      return;
+    }
+    set_data(data);
+    vertex_source = get_vertex_source();
+    fragment_source = get_fragment_source();
   }
-  set_data(data);
-  uniform_locations.clear();
 
   // Create the vertex and fragment shaders.
-  vertex_shader = create_shader(GL_VERTEX_SHADER_ARB, get_vertex_source().c_str());
+  vertex_shader = create_shader(GL_VERTEX_SHADER_ARB, vertex_source.c_str());
   if (!is_valid()) {
     return;
   }
-  fragment_shader = create_shader(GL_FRAGMENT_SHADER_ARB, get_fragment_source().c_str());
+  fragment_shader = create_shader(GL_FRAGMENT_SHADER_ARB, fragment_source.c_str());
   if (!is_valid()) {
     return;
   }
@@ -330,6 +349,8 @@ void GlArbShader::load() {
   position_location = glGetAttribLocationARB(program,POSITION_NAME);
   tex_coord_location = glGetAttribLocationARB(program,TEXCOORD_NAME);
   color_location = glGetAttribLocationARB(program,COLOR_NAME);
+  mvp_matrix_location = glGetUniformLocationARB(program, MVP_MATRIX_NAME);
+  uv_matrix_location = glGetUniformLocationARB(program, UV_MATRIX_NAME);
 
   if (status == 0) {
     GLint length = 0;
@@ -380,7 +401,7 @@ GLhandleARB GlArbShader::create_shader(unsigned int type, const char* source) {
 /**
  * \copydoc Shader::render
  */
-void GlArbShader::render(const VertexArray& array, const Surface& texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
+void GlArbShader::render(const VertexArray& array, SDL_Texture* texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
   if(array.vertex_buffer == 0) {
     //Generate vertex-buffer
     glGenBuffersARB(1,&array.vertex_buffer);
@@ -395,10 +416,13 @@ void GlArbShader::render(const VertexArray& array, const Surface& texture, const
   glUseProgramObjectARB(program);
 
   glm::mat4 mvp = mvp_matrix; //TODO do more than identity
-  glUniformMatrix4fvARB(get_uniform_location(Shader::MVP_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(mvp));
+  glUniformMatrix4fvARB(mvp_matrix_location,1,GL_FALSE,glm::value_ptr(mvp));
 
   glm::mat3 uvm = uv_matrix;
-  glUniformMatrix3fvARB(get_uniform_location(Shader::UV_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(uvm));
+  glUniformMatrix3fvARB(uv_matrix_location,1,GL_FALSE,glm::value_ptr(uvm));
+
+  // Only upload values that changed since the previous render.
+  upload_dirty_uniforms();
 
   glEnableVertexAttribArrayARB(position_location);
   glVertexAttribPointerARB(position_location,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,position));
@@ -410,19 +434,26 @@ void GlArbShader::render(const VertexArray& array, const Surface& texture, const
   glVertexAttribPointerARB(color_location,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(Vertex),(void*)offsetof(Vertex,color));
 
   glActiveTextureARB(GL_TEXTURE0_ARB + 0);  // Texture unit 0.
-  SDL_GL_BindTexture(texture.get_internal_surface().get_texture(), nullptr, nullptr);
+  SDL_GL_BindTexture(texture, nullptr, nullptr);
 
-  for (const auto& kvp : uniform_textures) {
-    const GLuint texture_unit = kvp.second.unit;
-    glActiveTextureARB(GL_TEXTURE0_ARB + texture_unit);
-    SDL_GL_BindTexture(kvp.second.surface->get_internal_surface().get_texture(),nullptr,nullptr);
+  std::vector<Uniform>& uniforms = get_uniforms();
+  for (int uniform_handle : get_texture_uniforms()) {
+    const Uniform& uniform = uniforms[uniform_handle];
+    if (uniform.texture == nullptr) {
+      continue;
+    }
+    glActiveTextureARB(GL_TEXTURE0_ARB + uniform.int_value);
+    SDL_GL_BindTexture(uniform.texture->get_internal_surface().get_texture(),nullptr,nullptr);
   }
   glDrawArrays((GLenum)array.get_primitive_type(),0,array.vertex_count());
 
-  for (const auto& kvp : uniform_textures) {
-    const GLuint texture_unit = kvp.second.unit;
-    glActiveTextureARB(GL_TEXTURE0_ARB + texture_unit);
-    SDL_GL_UnbindTexture(kvp.second.surface->get_internal_surface().get_texture());
+  for (int uniform_handle : get_texture_uniforms()) {
+    const Uniform& uniform = uniforms[uniform_handle];
+    if (uniform.texture == nullptr) {
+      continue;
+    }
+    glActiveTextureARB(GL_TEXTURE0_ARB + uniform.int_value);
+    SDL_GL_UnbindTexture(uniform.texture->get_internal_surface().get_texture());
   }
 
   glActiveTextureARB(GL_TEXTURE0_ARB + 0);
@@ -432,147 +463,44 @@ void GlArbShader::render(const VertexArray& array, const Surface& texture, const
 }
 
 /**
- * \brief Returns the location of a uniform value in the shader program.
- * \param uniform_name Name of the uniform to find.
- * \return The uniform location or \c -1.
- */
-GLint GlArbShader::get_uniform_location(const std::string& uniform_name) const {
-  const auto& it = uniform_locations.find(uniform_name);
-  if (it != uniform_locations.end()) {
-    return it->second;
-  }
-
-  const GLint location = glGetUniformLocationARB(program, uniform_name.c_str());
-  uniform_locations.insert(std::make_pair(uniform_name, location));
-  return location;
-}
-
-/**
- * \copydoc Shader::set_uniform1f
+ * \copydoc Shader::find_uniform_location
  */
-void GlArbShader::set_uniform_1b(const std::string& uniform_name, bool value) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform1iARB(location, (value ? 1 : 0));
-  glUseProgramObjectARB(previous_program);
+int GlArbShader::find_uniform_location(const std::string& uniform_name) const {
+  return glGetUniformLocationARB(program, uniform_name.c_str());
 }
 
 /**
- * \copydoc Shader::set_uniform_1i
+ * \copydoc Shader::upload_uniform
  */
-void GlArbShader::set_uniform_1i(const std::string& uniform_name, int value) {
+void GlArbShader::upload_uniform(const Uniform& uniform) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
+  const float* values = uniform.float_values;
+  switch (uniform.type) {
 
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform1iARB(location, value);
-  glUseProgramObjectARB(previous_program);
-}
+  case UniformType::INTEGER:
+  case UniformType::TEXTURE:
+    glUniform1iARB(uniform.location, uniform.int_value);
+    break;
 
-/**
- * \copydoc Shader::set_uniform_1f
- */
-void GlArbShader::set_uniform_1f(const std::string& uniform_name, float value) {
+  case UniformType::FLOAT_1:
+    glUniform1fARB(uniform.location, values[0]);
+    break;
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
+  case UniformType::FLOAT_2:
+    glUniform2fARB(uniform.location, values[0], values[1]);
+    break;
 
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform1fARB(location, value);
-  glUseProgramObjectARB(previous_program);
-}
+  case UniformType::FLOAT_3:
+    glUniform3fARB(uniform.location, values[0], values[1], values[2]);
+    break;
 
-/**
- * \copydoc Shader::set_uniform_2f
- */
-void GlArbShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+  case UniformType::FLOAT_4:
+    glUniform4fARB(uniform.location, values[0], values[1], values[2], values[3]);
+    break;
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
+  case UniformType::NONE:
+    break;
   }
-
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform2fARB(location, value_1, value_2);
-  glUseProgramObjectARB(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_3f
- */
-void GlArbShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform3fARB(location, value_1, value_2, value_3);
-  glUseProgramObjectARB(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_4f
- */
-void GlArbShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-  glUniform4fARB(location, value_1, value_2, value_3, value_4);
-  glUseProgramObjectARB(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_texture
- */
-bool GlArbShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
-
-  if (location == -1) {
-    // Not an error.
-    return true;
-  }
-
-  auto it = uniform_textures.find(uniform_name);
-  if(it != uniform_textures.end()) {
-    it->second.surface = value;
-    return true; //Nothing else to do
-  }
-  //else find a new texture unit
-
-  GLhandleARB previous_program = glGetHandleARB(GL_PROGRAM_OBJECT_ARB);
-  glUseProgramObjectARB(program);
-
-  int texture_unit = ++current_texture_unit;
-  uniform_textures[uniform_name] = TextureUniform{value,(GLuint)texture_unit};
-
-  glUniform1iARB(location, texture_unit);
-
-  glUseProgramObjectARB(previous_program);
-  return true;
 }
 
 }
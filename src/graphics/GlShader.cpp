@@ -25,10 +25,14 @@
 #include "solarus/graphics/Video.h"
 #include "solarus/graphics/ShaderContext.h"
 #include "solarus/graphics/RenderTexture.h"
+#include "solarus/lua/LuaData.h"
 
 #include "solarus/third_party/glm/gtc/type_ptr.hpp"
 #include "solarus/third_party/glm/gtx/transform.hpp"
 #include "solarus/third_party/glm/gtx/matrix_transform_2d.hpp"
+#include <cstdint>
+#include <cstring>
+#include <sstream>
 
 
 namespace Solarus {
@@ -99,10 +103,71 @@ struct GlContext {
 #undef SDL_PROC
 };
 
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
 namespace {
 GlContext ctx;
+
+// Program binaries are optional: GL 4.1, ARB_get_program_binary or
+// OES_get_program_binary.
+using GetProgramBinaryFunction =
+    void (APIENTRY*)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+using ProgramBinaryFunction =
+    void (APIENTRY*)(GLuint, GLenum, const void*, GLsizei);
+using ProgramParameteriFunction =
+    void (APIENTRY*)(GLuint, GLenum, GLint);
+
+GetProgramBinaryFunction get_program_binary = nullptr;
+ProgramBinaryFunction program_binary = nullptr;
+ProgramParameteriFunction program_parameteri = nullptr;
+
+/**
+ * \brief Returns an optional OpenGL function.
+ * \param name Name of the function in desktop OpenGL.
+ * \param es_name Name of the function in the OpenGL ES extension.
+ * \return The function, or nullptr if it is not supported.
+ */
+void* get_optional_function(const char* name, const char* es_name) {
+
+  void* function = SDL_GL_GetProcAddress(name);
+  if (function == nullptr) {
+    function = SDL_GL_GetProcAddress(es_name);
+  }
+  return function;
+}
+
+/**
+ * \brief Returns whether program binaries can be saved in the write directory.
+ * \return \c true if the program binary cache is enabled.
+ */
+bool is_program_binary_cache_enabled() {
+  return get_program_binary != nullptr && !QuestFiles::get_quest_write_dir().empty();
+}
+
+/**
+ * \brief Returns the cache file of a program binary.
+ * \param key Key of the program.
+ * \return The file name, relative to the quest write directory.
+ */
+std::string get_program_binary_file_name(const std::string& key) {
+
+  std::ostringstream oss;
+  oss << "shader_cache/" << std::hex << LuaData::compute_source_hash(key) << ".bin";
+  return oss.str();
+}
+
 }
 
+std::unordered_map<std::string, std::weak_ptr<GlShader::Program>> GlShader::programs;
+
 /**
  * \brief Initializes the GL 2D shader system.
  * \return \c true if GL 2D shaders are supported.
@@ -123,6 +188,21 @@ bool GlShader::initialize() {
 #include "gles2funcs.h"
 #undef SDL_PROC
 
+  GLint num_binary_formats = 0;
+  ctx.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+  ctx.glGetError();  // The enum is unknown to old drivers.
+  if (num_binary_formats > 0) {
+    get_program_binary = reinterpret_cast<GetProgramBinaryFunction>(
+        get_optional_function("glGetProgramBinary", "glGetProgramBinaryOES"));
+    program_binary = reinterpret_cast<ProgramBinaryFunction>(
+        get_optional_function("glProgramBinary", "glProgramBinaryOES"));
+    program_parameteri = reinterpret_cast<ProgramParameteriFunction>(
+        SDL_GL_GetProcAddress("glProgramParameteri"));
+    if (get_program_binary == nullptr || program_binary == nullptr) {
+      get_program_binary = nullptr;
+      program_binary = nullptr;
+    }
+  }
 
   //Init screen quad
   screen_quad.add_quad(Rectangle(0,0,1,1),Rectangle(0,1,1,-1),Color::white);
@@ -135,12 +215,22 @@ bool GlShader::initialize() {
 /**
  * \brief Constructor.
  * \param shader_name The name of the shader to load.
+ * \param built_in_fragment_source Fragment source of a shader provided by the
+ * engine, or an empty string.
  */
-GlShader::GlShader(const std::string& shader_id):
-  Shader(shader_id),
+GlShader::GlShader(const std::string& shader_id, const std::string& built_in_fragment_source):
+  Shader(shader_id, built_in_fragment_source),
+  shared_program(),
   program(0),
-  vertex_shader(0),
-  fragment_shader(0) {
+  position_location(-1),
+  tex_coord_location(-1),
+  color_location(-1),
+  mvp_matrix_location(-1),
+  uv_matrix_location(-1),
+  uploaded_mvp_matrix(0.0f),
+  uploaded_uv_matrix(0.0f),
+  wrapped_textures(),
+  attribute_states() {
 
   GLint previous_program;
   ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
@@ -166,6 +256,8 @@ GlShader::GlShader(const std::string& shader_id):
   position_location = ctx.glGetAttribLocation(program,POSITION_NAME);
   tex_coord_location = ctx.glGetAttribLocation(program,TEXCOORD_NAME);
   color_location = ctx.glGetAttribLocation(program,COLOR_NAME);
+  mvp_matrix_location = ctx.glGetUniformLocation(program, MVP_MATRIX_NAME);
+  uv_matrix_location = ctx.glGetUniformLocation(program, UV_MATRIX_NAME);
 
   ctx.glUseProgram(previous_program);
 }
@@ -174,6 +266,28 @@ GlShader::GlShader(const std::string& shader_id):
  * \brief Destructor.
  */
 GlShader::~GlShader() {
+
+  // The program is deleted with its last shader.
+  if (shared_program != nullptr && shared_program->user == this) {
+    shared_program->user = nullptr;
+  }
+}
+
+/**
+ * \brief Creates an empty program.
+ */
+GlShader::Program::Program():
+  program(0),
+  vertex_shader(0),
+  fragment_shader(0),
+  user(nullptr) {
+
+}
+
+/**
+ * \brief Destructor.
+ */
+GlShader::Program::~Program() {
   ctx.glDeleteShader(vertex_shader);
   ctx.glDeleteShader(fragment_shader);
   ctx.glDeleteProgram(program);
@@ -184,33 +298,118 @@ GlShader::~GlShader() {
  */
 void GlShader::load() {
 
-  GLint linked;
+  // An empty id is the built-in shader: it has no data file.
+  std::string vertex_source = default_vertex_source();
+  std::string fragment_source = default_fragment_source();
+  if (!get_built_in_fragment_source().empty()) {
+    // Other shader provided by the engine: no data file either.
+    fragment_source = get_built_in_fragment_source();
+  }
+  else if (!get_id().empty()) {
+    // Load the shader data file.
+    const std::string shader_file_name =
+        "shaders/" + get_id() + ".dat";
+
+    ShaderData data;
+    bool success = data.import_from_quest_file(shader_file_name);
+    if (!success) {
+      return;
+    }
 
-  // Load the shader data file.
-  const std::string shader_file_name =
-      "shaders/" + get_id() + ".dat";
+    set_data(data);
+    vertex_source = get_vertex_source();
+    fragment_source = get_fragment_source();
+  }
 
-  ShaderData data;
-  bool success = data.import_from_quest_file(shader_file_name);
-  if (!success) {
-    return;
+  // Shaders with the same sources share their program.
+  std::ostringstream oss;
+  oss << ShaderContext::get_opengl_vendor() << '|'
+      << ShaderContext::get_opengl_renderer() << '|'
+      << ShaderContext::get_opengl_version() << '|'
+      << std::hex << LuaData::compute_source_hash(vertex_source) << '|'
+      << LuaData::compute_source_hash(fragment_source);
+  const std::string key = oss.str();
+
+  const auto& it = programs.find(key);
+  if (it != programs.end()) {
+    shared_program = it->second.lock();
   }
 
-  set_data(data);
+  if (shared_program == nullptr) {
+    shared_program = create_program(key, vertex_source, fragment_source);
+    if (shared_program == nullptr) {
+      set_valid(false);
+      return;
+    }
 
-  // Create the vertex and fragment shaders.
-  vertex_shader = create_shader(GL_VERTEX_SHADER, get_vertex_source().c_str());
-  fragment_shader = create_shader(GL_FRAGMENT_SHADER, get_fragment_source().c_str());
+    for (auto it = programs.begin(); it != programs.end();) {
+      if (it->second.expired()) {
+        it = programs.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+    programs[key] = shared_program;
+  }
+  program = shared_program->program;
+}
 
-  // Create a program object with both shaders.
-  program = ctx.glCreateProgram();
-  if (program == 0) {
+/**
+ * \brief Creates and links a program from its binary cache or its sources.
+ * \param key Key of the sources and of the OpenGL driver.
+ * \param vertex_source Source of the vertex shader.
+ * \param fragment_source Source of the fragment shader.
+ * \return The linked program, or nullptr in case of error.
+ */
+std::shared_ptr<GlShader::Program> GlShader::create_program(
+    const std::string& key,
+    const std::string& vertex_source,
+    const std::string& fragment_source
+) {
+  std::shared_ptr<Program> result = std::make_shared<Program>();
+  result->program = ctx.glCreateProgram();
+  if (result->program == 0) {
     Logger::error(std::string("Could not create OpenGL program"));
-    return;
+    return nullptr;
   }
 
-  ctx.glAttachShader(program, vertex_shader);
-  ctx.glAttachShader(program, fragment_shader);
+  if (load_program_binary(result->program, key)) {
+    result->user = this;
+    return result;
+  }
+
+  // Create the vertex and fragment shaders.
+  result->vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_source.c_str());
+  result->fragment_shader = create_shader(GL_FRAGMENT_SHADER, fragment_source.c_str());
+
+  ctx.glAttachShader(result->program, result->vertex_shader);
+  ctx.glAttachShader(result->program, result->fragment_shader);
+
+  const bool save_binary = is_program_binary_cache_enabled();
+  if (save_binary && program_parameteri != nullptr) {
+    program_parameteri(result->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  if (!link_program(result->program)) {
+    return nullptr;
+  }
+
+  if (save_binary) {
+    save_program_binary(result->program, key);
+  }
+  result->user = this;
+  return result;
+}
+
+/**
+ * \brief Links a program and logs errors.
+ * \param program The program with its shaders attached.
+ * \return \c true in case of success.
+ */
+bool GlShader::link_program(GLuint program) {
+
+  GLint linked;
 
   ctx.glLinkProgram(program);
 
@@ -227,8 +426,88 @@ void GlShader::load() {
       Logger::error(std::string("Failed to link shader ") + get_id() + std::string(" :\n") + info);
       free(info);
     }
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Loads a program from the binary cache of the write directory.
+ *
+ * The cache file starts with the key, a newline and the binary format.
+ *
+ * \param program The program to load.
+ * \param key Key of the sources and of the OpenGL driver.
+ * \return \c true if the program was loaded and linked.
+ */
+bool GlShader::load_program_binary(GLuint program, const std::string& key) {
+
+  if (!is_program_binary_cache_enabled()) {
+    return false;
+  }
 
-    ctx.glDeleteProgram(program);
+  const std::string& file_name = get_program_binary_file_name(key);
+  if (QuestFiles::data_file_get_location(file_name) !=
+      QuestFiles::DataFileLocation::LOCATION_WRITE_DIRECTORY) {
+    return false;
+  }
+
+  const std::string& buffer = QuestFiles::data_file_read(file_name);
+  const size_t header_size = key.size() + 1 + sizeof(uint32_t);
+  if (buffer.size() <= header_size ||
+      buffer.compare(0, key.size(), key) != 0 ||
+      buffer[key.size()] != '\n') {
+    // Hash collision or corrupted file.
+    return false;
+  }
+
+  uint32_t format = 0;
+  std::memcpy(&format, buffer.data() + key.size() + 1, sizeof(format));
+  program_binary(
+      program,
+      static_cast<GLenum>(format),
+      buffer.data() + header_size,
+      static_cast<GLsizei>(buffer.size() - header_size)
+  );
+
+  // A driver update can reject the binary: the caller compiles it again.
+  GLint linked = GL_FALSE;
+  ctx.glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  ctx.glGetError();
+  return linked == GL_TRUE;
+}
+
+/**
+ * \brief Saves the binary of a linked program in the write directory.
+ * \param program A linked program.
+ * \param key Key of the sources and of the OpenGL driver.
+ */
+void GlShader::save_program_binary(GLuint program, const std::string& key) {
+
+  GLint length = 0;
+  ctx.glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    ctx.glGetError();
+    return;
+  }
+
+  std::string buffer = key + '\n';
+  const size_t header_size = buffer.size() + sizeof(uint32_t);
+  buffer.resize(header_size + length);
+  GLsizei binary_length = 0;
+  GLenum binary_format = 0;
+  get_program_binary(program, length, &binary_length, &binary_format, &buffer[header_size]);
+  if (binary_length <= 0) {
+    ctx.glGetError();
+    return;
+  }
+  buffer.resize(header_size + binary_length);
+  const uint32_t format = binary_format;
+  std::memcpy(&buffer[key.size() + 1], &format, sizeof(format));
+
+  QuestFiles::data_file_mkdir("shader_cache");
+  if (!QuestFiles::data_file_replace(get_program_binary_file_name(key), buffer)) {
+    Logger::warning("Failed to save the shader program binary '" + get_program_binary_file_name(key) + "'");
   }
 }
 
@@ -319,11 +598,20 @@ std::string GlShader::default_fragment_source() const {
 /**
  * \copydoc Shader::render
  */
-void GlShader::render(const VertexArray& array, const Surface& texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
+void GlShader::render(const VertexArray& array, SDL_Texture* texture, const glm::mat4 &mvp_matrix, const glm::mat3 &uv_matrix) {
   GLint previous_program;
   ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
   ctx.glUseProgram(program);
 
+  if (shared_program != nullptr && shared_program->user != this) {
+    // Another shader with the same sources used the program:
+    // upload our values again.
+    shared_program->user = this;
+    mark_all_uniforms_dirty();
+    uploaded_mvp_matrix = glm::mat4(0.0f);
+    uploaded_uv_matrix = glm::mat3(0.0f);
+  }
+
   ctx.glDisable(GL_CULL_FACE);
 
   if(array.vertex_buffer == 0) {
@@ -338,35 +626,56 @@ void GlShader::render(const VertexArray& array, const Surface& texture, const gl
     ctx.glBufferData(GL_ARRAY_BUFFER,array.vertex_count()*sizeof(Vertex),array.data(),GL_DYNAMIC_DRAW);
     array.buffer_dirty = false;
   }
-  ctx.glUniformMatrix4fv(get_uniform_location(Shader::MVP_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(mvp_matrix));
-
-  glm::mat3 uvm = uv_matrix;
-  ctx.glUniformMatrix3fv(get_uniform_location(Shader::UV_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(uvm));
+  // Only upload values that changed since the previous render.
+  if (mvp_matrix != uploaded_mvp_matrix) {
+    ctx.glUniformMatrix4fv(mvp_matrix_location,1,GL_FALSE,glm::value_ptr(mvp_matrix));
+    uploaded_mvp_matrix = mvp_matrix;
+  }
+  if (uv_matrix != uploaded_uv_matrix) {
+    ctx.glUniformMatrix3fv(uv_matrix_location,1,GL_FALSE,glm::value_ptr(uv_matrix));
+    uploaded_uv_matrix = uv_matrix;
+  }
+  upload_dirty_uniforms();
 
   enable_attribute(position_location, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
   enable_attribute(tex_coord_location, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texcoords));
   enable_attribute(color_location, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
 
   ctx.glActiveTexture(GL_TEXTURE0 + 0);  // Texture unit 0.
-  SDL_GL_BindTexture(texture.get_internal_surface().get_texture(), nullptr, nullptr);
-
-  for (const auto& kvp : uniform_textures) {
-    const GLuint texture_unit = kvp.second.unit;
-    ctx.glActiveTexture(GL_TEXTURE0 + texture_unit);
-    SDL_GL_BindTexture(kvp.second.surface->get_internal_surface().get_texture(),nullptr,nullptr);
-
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  SDL_GL_BindTexture(texture, nullptr, nullptr);
+
+  // The SDL renderer keeps track of bound textures:
+  // uniform textures have to be unbound after drawing.
+  std::vector<Uniform>& uniforms = get_uniforms();
+  for (int uniform_handle : get_texture_uniforms()) {
+    const Uniform& uniform = uniforms[uniform_handle];
+    if (uniform.texture == nullptr) {
+      continue;
+    }
+    SDL_Texture* uniform_texture = uniform.texture->get_internal_surface().get_texture();
+    ctx.glActiveTexture(GL_TEXTURE0 + uniform.int_value);
+    SDL_GL_BindTexture(uniform_texture,nullptr,nullptr);
+
+    // The wrap mode is a state of the texture: only set it once.
+    SDL_Texture*& wrapped_texture = wrapped_textures[uniform_handle];
+    if (wrapped_texture != uniform_texture) {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      wrapped_texture = uniform_texture;
+    }
   }
 
   ctx.glDrawArrays((GLenum)array.get_primitive_type(),0,array.vertex_count());
 
   restore_attribute_states();
 
-  for (const auto& kvp : uniform_textures) {
-    const GLuint texture_unit = kvp.second.unit;
-    ctx.glActiveTexture(GL_TEXTURE0 + texture_unit);
-    SDL_GL_UnbindTexture(kvp.second.surface->get_internal_surface().get_texture());
+  for (int uniform_handle : get_texture_uniforms()) {
+    const Uniform& uniform = uniforms[uniform_handle];
+    if (uniform.texture == nullptr) {
+      continue;
+    }
+    ctx.glActiveTexture(GL_TEXTURE0 + uniform.int_value);
+    SDL_GL_UnbindTexture(uniform.texture->get_internal_surface().get_texture());
   }
 
   ctx.glActiveTexture(GL_TEXTURE0);
@@ -378,154 +687,44 @@ void GlShader::render(const VertexArray& array, const Surface& texture, const gl
 
 
 /**
- * \brief Returns the location of a uniform value in the shader program.
- * \param uniform_name Name of the uniform to find.
- * \return The uniform location or \c -1.
- */
-GLint GlShader::get_uniform_location(const std::string& uniform_name) const {
-  const auto& it = uniform_locations.find(uniform_name);
-  if (it != uniform_locations.end()) {
-    return it->second;
-  }
-
-  const GLint location = ctx.glGetUniformLocation(program, uniform_name.c_str());
-  uniform_locations.insert(std::make_pair(uniform_name, location));
-  return location;
-}
-
-/**
- * \copydoc Shader::set_uniform1f
- */
-void GlShader::set_uniform_1b(const std::string& uniform_name, bool value) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1i(location, (value ? 1 : 0));
-  ctx.glUseProgram(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_1i
- */
-void GlShader::set_uniform_1i(const std::string& uniform_name, int value) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1i(location, value);
-  ctx.glUseProgram(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_1f
- */
-void GlShader::set_uniform_1f(const std::string& uniform_name, float value) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform1f(location, value);
-  ctx.glUseProgram(previous_program);
-}
-
-/**
- * \copydoc Shader::set_uniform_2f
+ * \copydoc Shader::find_uniform_location
  */
-void GlShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
-
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform2f(location, value_1, value_2);
-  ctx.glUseProgram(previous_program);
+int GlShader::find_uniform_location(const std::string& uniform_name) const {
+  return ctx.glGetUniformLocation(program, uniform_name.c_str());
 }
 
 /**
- * \copydoc Shader::set_uniform_3f
+ * \copydoc Shader::upload_uniform
  */
-void GlShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+void GlShader::upload_uniform(const Uniform& uniform) {
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform3f(location, value_1, value_2, value_3);
-  ctx.glUseProgram(previous_program);
-}
+  const float* values = uniform.float_values;
+  switch (uniform.type) {
 
-/**
- * \copydoc Shader::set_uniform_4f
- */
-void GlShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+  case UniformType::INTEGER:
+  case UniformType::TEXTURE:
+    ctx.glUniform1i(uniform.location, uniform.int_value);
+    break;
 
-  const GLint location = get_uniform_location(uniform_name);
-  if (location == -1) {
-    return;
-  }
+  case UniformType::FLOAT_1:
+    ctx.glUniform1f(uniform.location, values[0]);
+    break;
 
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-  ctx.glUniform4f(location, value_1, value_2, value_3, value_4);
-  ctx.glUseProgram(previous_program);
-}
+  case UniformType::FLOAT_2:
+    ctx.glUniform2f(uniform.location, values[0], values[1]);
+    break;
 
-/**
- * \copydoc Shader::set_uniform_texture
- */
-bool GlShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
+  case UniformType::FLOAT_3:
+    ctx.glUniform3f(uniform.location, values[0], values[1], values[2]);
+    break;
 
-  if (location == -1) {
-    // Not an error.
-    return true;
-  }
+  case UniformType::FLOAT_4:
+    ctx.glUniform4f(uniform.location, values[0], values[1], values[2], values[3]);
+    break;
 
-  auto it = uniform_textures.find(uniform_name);
-  if(it != uniform_textures.end()) {
-    it->second.surface = value;
-    return true; //Nothing else to do
+  case UniformType::NONE:
+    break;
   }
-  //else find a new texture unit
-
-  GLint previous_program;
-  ctx.glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
-  ctx.glUseProgram(program);
-
-  int texture_unit = ++current_texture_unit;
-  uniform_textures[uniform_name] = TextureUniform{value,(GLuint)texture_unit};
-
-  ctx.glUniform1i(location, texture_unit);
-
-  ctx.glUseProgram(previous_program);
-  return true;
 }
 
 /**
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/MemoryStats.h"
+#include "solarus/graphics/GlyphAtlas.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Texture.h"
+#include "solarus/graphics/Video.h"
+#include <memory>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty glyph atlas.
+ * \param font The outline font at the size wanted.
+ * It must live as long as the atlas.
+ * \param antialiasing \c true to render smooth glyphs,
+ * \c false to render solid ones.
+ * \param color Color of the glyphs.
+ */
+GlyphAtlas::GlyphAtlas(TTF_Font& font, bool antialiasing, const Color& color):
+  font(font),
+  antialiasing(antialiasing),
+  color(color),
+  kerning(TTF_GetFontKerning(&font) != 0),
+  glyphs() {
+
+}
+
+/**
+ * \brief Returns the font of this atlas.
+ * \return The outline font.
+ */
+TTF_Font& GlyphAtlas::get_font() const {
+  return font;
+}
+
+/**
+ * \brief Returns a glyph, rendering it the first time.
+ * \param code_point A UCS-2 character.
+ * \return The glyph. Characters not in the font give a blank glyph.
+ */
+const GlyphAtlas::Glyph& GlyphAtlas::get_glyph(uint16_t code_point) {
+
+  const auto& it = glyphs.find(code_point);
+  if (it != glyphs.end()) {
+    return it->second;
+  }
+
+  return glyphs.emplace(code_point, render_glyph(code_point)).first->second;
+}
+
+/**
+ * \brief Returns the kerning between two consecutive characters.
+ * \param previous_code_point The first character.
+ * \param code_point The second character.
+ * \return The horizontal adjustment of the second character in pixels.
+ */
+int GlyphAtlas::get_kerning(uint16_t previous_code_point, uint16_t code_point) const {
+
+  if (!kerning) {
+    return 0;
+  }
+  return TTF_GetFontKerningSizeGlyphs(&font, previous_code_point, code_point);
+}
+
+/**
+ * \brief Renders a glyph to a new surface in the texture atlas.
+ * \param code_point A UCS-2 character.
+ * \return The glyph.
+ */
+GlyphAtlas::Glyph GlyphAtlas::render_glyph(uint16_t code_point) const {
+
+  Glyph glyph = { nullptr, Point(), 0 };
+
+  int min_x = 0;
+  int max_x = 0;
+  int min_y = 0;
+  int max_y = 0;
+  int advance = 0;
+  if (TTF_GlyphMetrics(&font, code_point, &min_x, &max_x, &min_y, &max_y, &advance) != 0) {
+    return glyph;
+  }
+  glyph.offset = { min_x, TTF_FontAscent(&font) - max_y };
+  glyph.advance = advance;
+
+  if (max_x <= min_x || max_y <= min_y) {
+    // Blank character like a space: only the advance matters.
+    return glyph;
+  }
+
+  SDL_Color internal_color;
+  color.get_components(
+      internal_color.r, internal_color.g, internal_color.b, internal_color.a);
+  SDL_Surface_UniquePtr rendered_surface(antialiasing ?
+      TTF_RenderGlyph_Blended(&font, code_point, internal_color) :
+      TTF_RenderGlyph_Solid(&font, code_point, internal_color)
+  );
+  if (rendered_surface == nullptr ||
+      rendered_surface->w <= 0 ||
+      rendered_surface->h <= 0) {
+    return glyph;
+  }
+
+  // Copy it in the atlas format.
+  // Solid glyphs use a color key that becomes transparent pixels here.
+  const SDL_PixelFormat* format = Video::get_rgba_format();
+  SDL_Surface* rgba_surface = SDL_CreateRGBSurface(
+      0,
+      rendered_surface->w,
+      rendered_surface->h,
+      32,
+      format->Rmask,
+      format->Gmask,
+      format->Bmask,
+      format->Amask
+  );
+  Debug::check_assertion_lazy(rgba_surface != nullptr, [&] {
+    return std::string("Failed to create glyph surface: ") + SDL_GetError();
+  });
+  SDL_SetSurfaceBlendMode(rendered_surface.get(), SDL_BLENDMODE_NONE);
+  SDL_BlitSurface(rendered_surface.get(), nullptr, rgba_surface, nullptr);
+
+  MemoryStats::TextureOrigin origin(MemoryStats::Category::TEXT_TEXTURES);
+  glyph.surface = std::make_shared<Surface>(new Texture(rgba_surface, true));
+  return glyph;
+}
+
+}
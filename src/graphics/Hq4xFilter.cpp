@@ -16,11 +16,12 @@
  */
 #include "solarus/graphics/Hq4xFilter.h"
 #include "solarus/third_party/hqx/hqx.h"
+#include <mutex>
 
 namespace Solarus {
 
 namespace {
-  bool hqx_initialized = false;   /**< Whether the common hqx initialization was done. */
+  std::once_flag hqx_initialized;   /**< Whether the common hqx initialization was done. */
 }
 
 /**
@@ -38,31 +39,34 @@ int Hq4xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Hq4xFilter::filter(
+void Hq4xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int end_row) const {
 
   // Make sure hqx is initialized.
   initialize_hqx();
 
-  hq4x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
+  const uint32_t row_bytes = src_width * sizeof(uint32_t);
+  hq4x_32_rb_rows(const_cast<uint32_t*>(src), row_bytes, dst, row_bytes * 4,
+      src_width, src_height, first_row, end_row);
 }
 
 /**
  * \brief Performs the initialization common to the 3 variants of hqx.
  *
  * Does nothing if the initialization was already done.
+ * Bands of an image may be filtered by several threads at the same time:
+ * only one of them does the initialization and the others wait for it.
  */
 void Hq4xFilter::initialize_hqx() {
 
-  if (!hqx_initialized) {
-    hqx_initialized = true;
-    hqxInit();
-  }
+  std::call_once(hqx_initialized, hqxInit);
 }
 
 }
@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/System.h"
+#include "solarus/graphics/ParticleEmitter.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns a random value between -variation and variation.
+ * \param variation Maximum absolute value.
+ * \return A random value.
+ */
+double get_random_variation(double variation) {
+
+  if (variation == 0.0) {
+    return 0.0;
+  }
+  return variation * (Random::get_number(2001) - 1000) / 1000.0;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates an emitter with no particles.
+ * \param image Image of each particle.
+ */
+ParticleEmitter::ParticleEmitter(const SurfacePtr& image):
+  Drawable(),
+  image(image),
+  emission_size(),
+  max_particles(default_max_particles),
+  rate(0.0),
+  emission_credit(0.0),
+  lifetime(default_lifetime),
+  speed(0.0),
+  speed_variation(0.0),
+  angle(0.0),
+  angle_variation(0.0),
+  gravity_x(0.0f),
+  gravity_y(0.0f),
+  fading_out(true),
+  last_update_date(System::now()),
+  xs(),
+  ys(),
+  speeds_x(),
+  speeds_y(),
+  ages() {
+
+  Debug::check_assertion(image != nullptr, "Missing particle image");
+}
+
+/**
+ * \brief Returns the image of particles.
+ * \return The particle image.
+ */
+const SurfacePtr& ParticleEmitter::get_image() const {
+  return image;
+}
+
+/**
+ * \brief Returns the size of the area where particles appear.
+ * \return The emission size. An empty size means particles appear
+ * at the position of the emitter.
+ */
+const Size& ParticleEmitter::get_emission_size() const {
+  return emission_size;
+}
+
+/**
+ * \brief Sets the size of the area where particles appear.
+ * \param emission_size The emission size.
+ */
+void ParticleEmitter::set_emission_size(const Size& emission_size) {
+  this->emission_size = emission_size;
+}
+
+/**
+ * \brief Returns the maximum number of particles alive at the same time.
+ * \return The maximum number of particles.
+ */
+int ParticleEmitter::get_max_particles() const {
+  return max_particles;
+}
+
+/**
+ * \brief Sets the maximum number of particles alive at the same time.
+ *
+ * Particles beyond this number are removed.
+ *
+ * \param max_particles The maximum number of particles.
+ */
+void ParticleEmitter::set_max_particles(int max_particles) {
+
+  this->max_particles = std::max(max_particles, 0);
+  while (get_num_particles() > this->max_particles) {
+    remove_particle(xs.size() - 1);
+  }
+}
+
+/**
+ * \brief Returns the number of particles emitted automatically per second.
+ * \return The emission rate.
+ */
+double ParticleEmitter::get_rate() const {
+  return rate;
+}
+
+/**
+ * \brief Sets the number of particles emitted automatically per second.
+ * \param rate The emission rate. 0 means only emitting with emit().
+ */
+void ParticleEmitter::set_rate(double rate) {
+
+  this->rate = std::max(rate, 0.0);
+  if (this->rate == 0.0) {
+    emission_credit = 0.0;
+  }
+}
+
+/**
+ * \brief Returns the lifetime of particles.
+ * \return The lifetime in milliseconds.
+ */
+uint32_t ParticleEmitter::get_lifetime() const {
+  return lifetime;
+}
+
+/**
+ * \brief Sets the lifetime of new particles.
+ * \param lifetime The lifetime in milliseconds.
+ */
+void ParticleEmitter::set_lifetime(uint32_t lifetime) {
+  this->lifetime = lifetime;
+}
+
+/**
+ * \brief Returns the initial speed of new particles.
+ * \return The speed in pixels per second.
+ */
+double ParticleEmitter::get_speed() const {
+  return speed;
+}
+
+/**
+ * \brief Returns the maximum random change of the initial speed.
+ * \return The speed variation in pixels per second.
+ */
+double ParticleEmitter::get_speed_variation() const {
+  return speed_variation;
+}
+
+/**
+ * \brief Sets the initial speed of new particles.
+ * \param speed The speed in pixels per second.
+ * \param speed_variation Maximum random change of the speed of each particle.
+ */
+void ParticleEmitter::set_speed(double speed, double speed_variation) {
+  this->speed = speed;
+  this->speed_variation = speed_variation;
+}
+
+/**
+ * \brief Returns the initial direction of new particles.
+ * \return The angle in radians.
+ */
+double ParticleEmitter::get_angle() const {
+  return angle;
+}
+
+/**
+ * \brief Returns the maximum random change of the initial direction.
+ * \return The angle variation in radians.
+ */
+double ParticleEmitter::get_angle_variation() const {
+  return angle_variation;
+}
+
+/**
+ * \brief Sets the initial direction of new particles.
+ * \param angle The angle in radians. 0 is to the right
+ * and angles increase counter-clockwise like other angles of the engine.
+ * \param angle_variation Maximum random change of the angle of each particle.
+ */
+void ParticleEmitter::set_angle(double angle, double angle_variation) {
+  this->angle = angle;
+  this->angle_variation = angle_variation;
+}
+
+/**
+ * \brief Returns the horizontal acceleration of particles.
+ * \return The acceleration in pixels per second squared.
+ */
+double ParticleEmitter::get_gravity_x() const {
+  return gravity_x;
+}
+
+/**
+ * \brief Returns the vertical acceleration of particles.
+ * \return The acceleration in pixels per second squared.
+ */
+double ParticleEmitter::get_gravity_y() const {
+  return gravity_y;
+}
+
+/**
+ * \brief Sets the acceleration of particles.
+ * \param gravity_x The horizontal acceleration in pixels per second squared.
+ * \param gravity_y The vertical acceleration in pixels per second squared.
+ */
+void ParticleEmitter::set_gravity(double gravity_x, double gravity_y) {
+  this->gravity_x = static_cast<float>(gravity_x);
+  this->gravity_y = static_cast<float>(gravity_y);
+}
+
+/**
+ * \brief Returns whether particles become transparent with age.
+ * \return \c true if particles fade out.
+ */
+bool ParticleEmitter::is_fading_out() const {
+  return fading_out;
+}
+
+/**
+ * \brief Sets whether particles become transparent with age.
+ * \param fading_out \c true to make particles fade out.
+ */
+void ParticleEmitter::set_fading_out(bool fading_out) {
+  this->fading_out = fading_out;
+}
+
+/**
+ * \brief Returns the number of particles alive.
+ * \return The number of particles.
+ */
+int ParticleEmitter::get_num_particles() const {
+  return static_cast<int>(xs.size());
+}
+
+/**
+ * \brief Creates new particles now.
+ *
+ * No more particles than the maximum are created.
+ *
+ * \param count Number of particles to create.
+ */
+void ParticleEmitter::emit(int count) {
+
+  count = std::min(count, max_particles - get_num_particles());
+  if (count <= 0) {
+    return;
+  }
+
+  const size_t new_size = xs.size() + count;
+  xs.reserve(new_size);
+  ys.reserve(new_size);
+  speeds_x.reserve(new_size);
+  speeds_y.reserve(new_size);
+  ages.reserve(new_size);
+  for (int i = 0; i < count; ++i) {
+    const double particle_angle = angle + get_random_variation(angle_variation);
+    const double particle_speed = speed + get_random_variation(speed_variation);
+    xs.push_back(emission_size.width > 0 ?
+        static_cast<float>(Random::get_number(emission_size.width)) : 0.0f);
+    ys.push_back(emission_size.height > 0 ?
+        static_cast<float>(Random::get_number(emission_size.height)) : 0.0f);
+    // The y axis goes down.
+    speeds_x.push_back(static_cast<float>(particle_speed * std::cos(particle_angle)));
+    speeds_y.push_back(static_cast<float>(-particle_speed * std::sin(particle_angle)));
+    ages.push_back(0);
+  }
+}
+
+/**
+ * \brief Removes all particles.
+ */
+void ParticleEmitter::clear() {
+
+  xs.clear();
+  ys.clear();
+  speeds_x.clear();
+  speeds_y.clear();
+  ages.clear();
+  emission_credit = 0.0;
+}
+
+/**
+ * \brief Removes a particle.
+ *
+ * The last particle takes its place.
+ *
+ * \param index Index of the particle to remove.
+ */
+void ParticleEmitter::remove_particle(size_t index) {
+
+  const size_t last = xs.size() - 1;
+  xs[index] = xs[last];
+  ys[index] = ys[last];
+  speeds_x[index] = speeds_x[last];
+  speeds_y[index] = speeds_y[last];
+  ages[index] = ages[last];
+  xs.pop_back();
+  ys.pop_back();
+  speeds_x.pop_back();
+  speeds_y.pop_back();
+  ages.pop_back();
+}
+
+/**
+ * \brief Moves particles, removes the old ones and emits new ones.
+ */
+void ParticleEmitter::update() {
+
+  Drawable::update();
+
+  const uint32_t now = System::now();
+  const uint32_t elapsed = now - last_update_date;
+  last_update_date = now;
+  if (is_suspended() || elapsed == 0) {
+    // Time does not pass for suspended particles.
+    return;
+  }
+
+  // Remove particles at the end of their life.
+  size_t i = 0;
+  while (i < ages.size()) {
+    ages[i] += elapsed;
+    if (ages[i] >= lifetime) {
+      remove_particle(i);
+    }
+    else {
+      ++i;
+    }
+  }
+
+  // Move the others.
+  // One loop per array lets the compiler vectorize them.
+  const size_t num_particles = xs.size();
+  const float delta = elapsed / 1000.0f;
+  const float delta_speed_x = gravity_x * delta;
+  const float delta_speed_y = gravity_y * delta;
+  for (i = 0; i < num_particles; ++i) {
+    speeds_x[i] += delta_speed_x;
+  }
+  for (i = 0; i < num_particles; ++i) {
+    speeds_y[i] += delta_speed_y;
+  }
+  for (i = 0; i < num_particles; ++i) {
+    xs[i] += speeds_x[i] * delta;
+  }
+  for (i = 0; i < num_particles; ++i) {
+    ys[i] += speeds_y[i] * delta;
+  }
+
+  // Emit new ones.
+  if (rate > 0.0) {
+    emission_credit += rate * elapsed / 1000.0;
+    const int count = static_cast<int>(emission_credit);
+    emission_credit -= count;
+    emit(count);
+  }
+}
+
+/**
+ * \brief Returns whether update() has something to do.
+ * \return \c true: particles move by themselves.
+ */
+bool ParticleEmitter::needs_update() const {
+  return true;
+}
+
+/**
+ * \brief Returns the size of the emission area.
+ * \return The emission size.
+ */
+Size ParticleEmitter::get_size() const {
+  return emission_size;
+}
+
+/**
+ * \brief Returns the emission area.
+ * \return The emission area relative to the emitter.
+ */
+Rectangle ParticleEmitter::get_region() const {
+  return Rectangle(Point(), emission_size);
+}
+
+/**
+ * \brief Draws all particles on a surface.
+ *
+ * Particles can be outside the emission area.
+ *
+ * \param dst_surface The destination surface.
+ * \param infos Draw informations.
+ */
+void ParticleEmitter::raw_draw(Surface& dst_surface, const DrawInfos& infos) const {
+  draw_particles(dst_surface, infos, nullptr);
+}
+
+/**
+ * \brief Draws the particles whose position is in a region.
+ * \param dst_surface The destination surface.
+ * \param infos Draw informations. The region is relative to the emitter.
+ */
+void ParticleEmitter::raw_draw_region(Surface& dst_surface, const DrawInfos& infos) const {
+  draw_particles(dst_surface, infos, &infos.region);
+}
+
+/**
+ * \brief Draws particles on a surface.
+ *
+ * All particles use the same texture, so they are batched.
+ *
+ * \param dst_surface The destination surface.
+ * \param infos Draw informations.
+ * \param region Only draw particles whose position is in this region,
+ * or nullptr to draw all of them.
+ */
+void ParticleEmitter::draw_particles(
+    Surface& dst_surface,
+    const DrawInfos& infos,
+    const Rectangle* region
+) const {
+
+  const Size& image_size = image->get_size();
+  const Rectangle src_rect(Point(), image_size);
+  Point origin = infos.dst_position - Point(image_size.width / 2, image_size.height / 2);
+  if (region != nullptr) {
+    origin -= region->get_xy();
+  }
+
+  for (size_t i = 0; i < xs.size(); ++i) {
+    const Point position(
+        static_cast<int>(std::floor(xs[i])),
+        static_cast<int>(std::floor(ys[i]))
+    );
+    if (region != nullptr && !region->contains(position)) {
+      continue;
+    }
+    uint8_t opacity = infos.opacity;
+    if (fading_out && lifetime > 0) {
+      opacity = static_cast<uint8_t>(opacity * (lifetime - ages[i]) / lifetime);
+    }
+    if (opacity == 0) {
+      continue;
+    }
+    const Point dst_position = origin + position;
+    infos.proxy.draw(dst_surface, *image, DrawInfos(
+        src_rect, dst_position, infos.blend_mode, opacity, infos.proxy, infos.transform
+    ));
+  }
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return the name identifying this type in Lua
+ */
+const std::string& ParticleEmitter::get_lua_type_name() const {
+  return LuaContext::particle_emitter_module_name;
+}
+
+}
+
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an unlocked pixel buffer.
+ * \param surface The surface to access.
+ * \param region Region of the surface to access.
+ * It is clipped to the surface.
+ */
+PixelBuffer::PixelBuffer(const SurfacePtr& surface, const Rectangle& region):
+  surface(surface),
+  region(region & Rectangle(surface->get_size())),
+  pixels(nullptr),
+  dirty_region() {
+
+}
+
+/**
+ * \brief Destructor. Unlocks the buffer if it is locked.
+ */
+PixelBuffer::~PixelBuffer() {
+
+  unlock();
+}
+
+/**
+ * \brief Returns the surface whose pixels are accessed.
+ * \return The surface.
+ */
+const SurfacePtr& PixelBuffer::get_surface() const {
+  return surface;
+}
+
+/**
+ * \brief Returns the region of the surface accessed.
+ * \return The region in surface coordinates.
+ */
+const Rectangle& PixelBuffer::get_region() const {
+  return region;
+}
+
+/**
+ * \brief Returns the pixels changed since the buffer was locked.
+ * \return The smallest rectangle containing them, in surface coordinates.
+ */
+const Rectangle& PixelBuffer::get_dirty_region() const {
+  return dirty_region;
+}
+
+/**
+ * \brief Returns whether pixels can be accessed.
+ * \return \c true if the buffer is locked.
+ */
+bool PixelBuffer::is_locked() const {
+  return pixels != nullptr;
+}
+
+/**
+ * \brief Gives access to the pixels.
+ *
+ * The surface becomes a render texture if it was not one.
+ * Does nothing if the buffer is already locked.
+ */
+void PixelBuffer::lock() {
+
+  if (is_locked()) {
+    return;
+  }
+
+  surface->finish_loading();
+  pixels = surface->request_render().get_surface();
+  Debug::check_assertion(pixels->format->BytesPerPixel == 4,
+      "Pixel buffers need 32-bit surfaces");
+  dirty_region = Rectangle();
+}
+
+/**
+ * \brief Uploads the pixels changed and ends the access to the pixels.
+ *
+ * Does nothing if the buffer is not locked.
+ */
+void PixelBuffer::unlock() {
+
+  if (!is_locked()) {
+    return;
+  }
+
+  pixels = nullptr;
+  if (!dirty_region.is_flat()) {
+    surface->get_internal_surface().upload_surface(dirty_region);
+    dirty_region = Rectangle();
+  }
+}
+
+/**
+ * \brief Returns whether a point is in the region.
+ * \param x X coordinate relative to the region.
+ * \param y Y coordinate relative to the region.
+ * \return \c true if this is a pixel of the buffer.
+ */
+bool PixelBuffer::contains(int x, int y) const {
+  return x >= 0 && x < region.get_width() && y >= 0 && y < region.get_height();
+}
+
+/**
+ * \brief Returns the color of a pixel.
+ *
+ * The buffer must be locked.
+ *
+ * \param x X coordinate relative to the region.
+ * \param y Y coordinate relative to the region.
+ * \return The color of this pixel.
+ */
+Color PixelBuffer::get_pixel(int x, int y) const {
+
+  Debug::check_assertion(is_locked(), "Pixel buffer is not locked");
+  Debug::check_assertion(contains(x, y), "Pixel out of the buffer");
+
+  uint8_t r, g, b, a;
+  SDL_GetRGBA(get_row(y)[x], pixels->format, &r, &g, &b, &a);
+  return Color(r, g, b, a);
+}
+
+/**
+ * \brief Changes the color of a pixel.
+ *
+ * The buffer must be locked.
+ *
+ * \param x X coordinate relative to the region.
+ * \param y Y coordinate relative to the region.
+ * \param color The new color of this pixel.
+ */
+void PixelBuffer::set_pixel(int x, int y, const Color& color) {
+
+  Debug::check_assertion(is_locked(), "Pixel buffer is not locked");
+  Debug::check_assertion(contains(x, y), "Pixel out of the buffer");
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  get_row(y)[x] = SDL_MapRGBA(pixels->format, r, g, b, a);
+  if (!dirty_region.contains(region.get_x() + x, region.get_y() + y)) {
+    add_dirty_region(Rectangle(region.get_x() + x, region.get_y() + y, 1, 1));
+  }
+}
+
+/**
+ * \brief Changes the color of all pixels of the buffer.
+ *
+ * The buffer must be locked.
+ *
+ * \param color The new color.
+ */
+void PixelBuffer::fill_with_color(const Color& color) {
+
+  Debug::check_assertion(is_locked(), "Pixel buffer is not locked");
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  const uint32_t pixel = SDL_MapRGBA(pixels->format, r, g, b, a);
+  for (int y = 0; y < region.get_height(); ++y) {
+    uint32_t* row = get_row(y);
+    std::fill(row, row + region.get_width(), pixel);
+  }
+  add_dirty_region(region);
+}
+
+/**
+ * \brief Returns a copy of the pixels of the buffer.
+ *
+ * The buffer must be locked.
+ *
+ * \return The pixels of each row of the region, in the RGBA 32-bit format
+ * of Surface::get_pixels().
+ */
+std::string PixelBuffer::get_pixels() const {
+
+  Debug::check_assertion(is_locked(), "Pixel buffer is not locked");
+
+  const size_t row_size = region.get_width() * 4;
+  std::string buffer(row_size * region.get_height(), '\0');
+  for (int y = 0; y < region.get_height(); ++y) {
+    std::copy_n(reinterpret_cast<const char*>(get_row(y)), row_size, &buffer[y * row_size]);
+  }
+  return buffer;
+}
+
+/**
+ * \brief Replaces the pixels of the buffer.
+ *
+ * The buffer must be locked.
+ *
+ * \param buffer The pixels of each row of the region, in the RGBA 32-bit
+ * format of Surface::get_pixels().
+ * If it is too short, only the first pixels are replaced.
+ */
+void PixelBuffer::set_pixels(const std::string& buffer) {
+
+  Debug::check_assertion(is_locked(), "Pixel buffer is not locked");
+
+  const size_t row_size = region.get_width() * 4;
+  if (row_size == 0) {
+    return;
+  }
+  const int num_rows = std::min(
+      region.get_height(),
+      static_cast<int>((buffer.size() + row_size - 1) / row_size)
+  );
+  for (int y = 0; y < num_rows; ++y) {
+    const size_t size = std::min(row_size, buffer.size() - y * row_size);
+    std::copy_n(&buffer[y * row_size], size, reinterpret_cast<char*>(get_row(y)));
+  }
+  add_dirty_region(Rectangle(region.get_x(), region.get_y(), region.get_width(), num_rows));
+}
+
+/**
+ * \brief Returns the pixels of a row of the region.
+ * \param y Y coordinate relative to the region.
+ * \return The first pixel of this row in the region.
+ */
+uint32_t* PixelBuffer::get_row(int y) const {
+
+  return reinterpret_cast<uint32_t*>(
+      static_cast<uint8_t*>(pixels->pixels) + (region.get_y() + y) * pixels->pitch
+  ) + region.get_x();
+}
+
+/**
+ * \brief Adds pixels to upload at the next unlock.
+ * \param dirty_rectangle The pixels changed, in surface coordinates.
+ */
+void PixelBuffer::add_dirty_region(const Rectangle& dirty_rectangle) {
+
+  if (dirty_rectangle.is_flat()) {
+    return;
+  }
+  dirty_region |= dirty_rectangle;
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return the name identifying this type in Lua
+ */
+const std::string& PixelBuffer::get_lua_type_name() const {
+  return LuaContext::pixel_buffer_module_name;
+}
+
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/PostProcessChain.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/Surface.h"
+#include <algorithm>
+#include <SDL_render.h>
+
+namespace Solarus {
+
+constexpr double PostProcessChain::min_scale;
+constexpr double PostProcessChain::max_scale;
+
+/**
+ * \brief Creates an empty chain.
+ */
+PostProcessChain::PostProcessChain():
+  passes(),
+  targets() {
+
+}
+
+/**
+ * \brief Returns whether the chain has no pass.
+ * \return \c true if there is nothing to apply.
+ */
+bool PostProcessChain::is_empty() const {
+  return passes.empty();
+}
+
+/**
+ * \brief Returns the passes of the chain.
+ * \return The passes in the order they are applied.
+ */
+const std::vector<PostProcessChain::Pass>& PostProcessChain::get_passes() const {
+  return passes;
+}
+
+/**
+ * \brief Replaces the passes of the chain.
+ *
+ * Targets of the previous passes are released.
+ *
+ * \param passes The new passes in the order to apply them.
+ * Shaders must not be \c nullptr and scales must be between min_scale and
+ * max_scale.
+ */
+void PostProcessChain::set_passes(const std::vector<Pass>& passes) {
+
+  for (const Pass& pass: passes) {
+    Debug::check_assertion(pass.shader != nullptr, "Missing post-processing shader");
+    Debug::check_assertion(pass.scale >= min_scale && pass.scale <= max_scale,
+        "Invalid post-processing scale");
+  }
+
+  this->passes = passes;
+  targets.clear();
+}
+
+/**
+ * \brief Removes all passes and releases their targets.
+ */
+void PostProcessChain::clear() {
+
+  passes.clear();
+  targets.clear();
+}
+
+/**
+ * \brief Applies all passes to a surface.
+ * \param source_surface The surface to process, usually the quest surface.
+ * It is not modified.
+ * \return The output of the last pass, or the source surface if the chain
+ * is empty. It remains valid until the next call.
+ */
+SurfacePtr PostProcessChain::apply(const SurfacePtr& source_surface) {
+
+  Debug::check_assertion(source_surface != nullptr, "Missing source surface");
+
+  const Size& source_size = source_surface->get_size();
+  SurfacePtr input = source_surface;
+  for (const Pass& pass: passes) {
+    const Size size(
+        std::max(1, static_cast<int>(source_size.width * pass.scale + 0.5)),
+        std::max(1, static_cast<int>(source_size.height * pass.scale + 0.5))
+    );
+    const SurfacePtr output = get_target(size, input);
+
+    // Shaders may depend on time: the content is always new.
+    RenderTexture& target = output->request_render();
+    target.invalidate_content_signature();
+    target.with_target([&](SDL_Renderer* renderer) {
+      // Replace the previous content instead of blending with it.
+      SDL_BlendMode current;
+      SDL_GetRenderDrawBlendMode(renderer, &current);
+      if (current != SDL_BLENDMODE_NONE) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_RenderDrawPoint(renderer, -100, -100);  // Force the blend mode change.
+      }
+      pass.shader->render_stretched(*input, size);
+    });
+    input = output;
+  }
+
+  return input;
+}
+
+/**
+ * \brief Returns an intermediate target of the given size.
+ *
+ * A target of the pool is reused when possible.
+ * Two consecutive passes of the same size alternate between two targets.
+ *
+ * \param size Size of the target wanted.
+ * \param input Input of the pass, that cannot be its target.
+ * \return A target of this size different from the input.
+ */
+SurfacePtr PostProcessChain::get_target(const Size& size, const SurfacePtr& input) {
+
+  for (const SurfacePtr& target: targets) {
+    if (target != input && target->get_size() == size) {
+      return target;
+    }
+  }
+
+  targets.push_back(Surface::create(size));
+  return targets.back();
+}
+
+}
+
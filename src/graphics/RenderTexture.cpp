@@ -5,49 +5,145 @@
 namespace Solarus {
 
 //RenderTargetAtlas RenderTexture::render_atlas;
+RenderTexture::ReadbackStatistics RenderTexture::readback_statistics;
+std::vector<RenderTexture::PooledTarget> RenderTexture::target_pool;
+
+namespace {
+
+/**
+ * @brief Operations that change the content signature of a render texture
+ */
+enum class Operation : uint64_t {
+  CLEAR = 1,
+  DRAW,
+  FILL
+};
+
+/**
+ * @brief mix a rectangle into a content signature
+ */
+uint64_t combine_rectangle(uint64_t signature, const Rectangle& rect) {
+  signature = SurfaceImpl::combine_signature(signature,static_cast<uint32_t>(rect.get_x()));
+  signature = SurfaceImpl::combine_signature(signature,static_cast<uint32_t>(rect.get_y()));
+  signature = SurfaceImpl::combine_signature(signature,static_cast<uint32_t>(rect.get_width()));
+  return SurfaceImpl::combine_signature(signature,static_cast<uint32_t>(rect.get_height()));
+}
+
+}
+
 /**
  * @brief RenderTexture::RenderTexture
  * @param width width of the render texture
  * @param height height og the render texture
  */
-RenderTexture::RenderTexture(int width, int height)
+RenderTexture::RenderTexture(int width, int height):
+  width(width),
+  height(height),
+  memory_category(MemoryStats::get_texture_category())
 {
-  auto renderer = Video::get_renderer();
-  auto tex = SDL_CreateTexture(renderer,
-                               Video::get_rgba_format()->format,
-                               SDL_TEXTUREACCESS_TARGET,
-                               width,height);
-  Debug::check_assertion(tex!=nullptr,
-                         std::string("Failed to create render texture : ") + SDL_GetError());
-  target.reset(tex);
-
-  auto format = Video::get_rgba_format();
-  auto surf_ptr = SDL_CreateRGBSurface(0,
-                                       width,
-                                       height,
-                                       32,
-                                       format->Rmask,
-                                       format->Gmask,
-                                       format->Bmask,
-                                       format->Amask);
-  Debug::check_assertion(surf_ptr!=nullptr,
-                         std::string("Failed to create backup surface ") + SDL_GetError());
-  surface.reset(surf_ptr);
+  MemoryStats::add(memory_category, static_cast<int64_t>(width) * height * 4);
+
+  // Reuse a target of the same size released recently if any.
+  for (auto it = target_pool.begin(); it != target_pool.end(); ++it) {
+    if (it->size.width == width && it->size.height == height) {
+      target = std::move(it->target);
+      target_pool.erase(it);
+      break;
+    }
+  }
+
+  if (target == nullptr) {
+    auto renderer = Video::get_renderer();
+    auto tex = SDL_CreateTexture(renderer,
+                                 Video::get_rgba_format()->format,
+                                 SDL_TEXTUREACCESS_TARGET,
+                                 width,height);
+    Debug::check_assertion_lazy(tex!=nullptr, [&] {
+      return std::string("Failed to create render texture : ") + SDL_GetError();
+    });
+    target.reset(tex);
+    Video::notify_texture_memory(Size(width, height), true);
+  }
+
+  // The CPU copy is created by the first readback.
   clear();
 }
 
+/**
+ * @brief RenderTexture::~RenderTexture
+ *
+ * The target texture is kept in the pool for a next render texture
+ * of the same size.
+ */
+RenderTexture::~RenderTexture() {
+  MemoryStats::remove(memory_category, static_cast<int64_t>(width) * height * 4);
+  SpriteBatch::notify_texture_destroyed(target.get());
+
+  if (Video::get_renderer() == nullptr) {
+    // The video system is closed: nothing to reuse.
+    Video::notify_texture_memory(Size(width, height), false);
+    return;
+  }
+
+  if (target_pool.size() >= max_pooled_targets) {
+    Video::notify_texture_memory(target_pool.front().size, false);
+    target_pool.erase(target_pool.begin());
+  }
+  target_pool.push_back(PooledTarget{ Size(width, height), std::move(target) });
+}
+
+/**
+ * @brief Destroys the target textures kept for reuse
+ *
+ * Must be called before the renderer is destroyed.
+ */
+void RenderTexture::quit() {
+  for (const PooledTarget& pooled: target_pool) {
+    Video::notify_texture_memory(pooled.size, false);
+  }
+  target_pool.clear();
+}
+
 /**
  * \copydoc SurfaceImpl::get_width
  */
 int RenderTexture::get_width() const {
-  return surface->w;
+  return width;
 }
 
 /**
  * \copydoc SurfaceImpl::get_height
  */
 int RenderTexture::get_height() const {
-  return surface->h;
+  return height;
+}
+
+/**
+ * @brief Returns the CPU copy of the pixels, creating it if needed
+ *
+ * A new copy is transparent, like the content of the target
+ * when nothing was drawn on it yet.
+ *
+ * @return the SDL surface
+ */
+SDL_Surface* RenderTexture::get_backup_surface() const {
+  if (surface == nullptr) {
+    auto format = Video::get_rgba_format();
+    auto surf_ptr = SDL_CreateRGBSurface(0,
+                                         width,
+                                         height,
+                                         32,
+                                         format->Rmask,
+                                         format->Gmask,
+                                         format->Bmask,
+                                         format->Amask);
+    Debug::check_assertion_lazy(surf_ptr!=nullptr, [&] {
+      return std::string("Failed to create backup surface ") + SDL_GetError();
+    });
+    surface.reset(surf_ptr);
+    surface_cleared = false;  // New SDL surfaces are already zeroed.
+  }
+  return surface.get();
 }
 
 /**
@@ -63,34 +159,91 @@ SDL_Texture* RenderTexture::get_texture() const {
  * @param infos draw info bundle
  */
 void RenderTexture::draw_other(const SurfaceImpl& texture, const DrawInfos& infos) {
-  with_target([&](SDL_Renderer* renderer){
-    Rectangle dst_rect(infos.dst_position,infos.region.get_size());
-    SDL_BlendMode mode = Surface::make_sdl_blend_mode(*this,texture,infos.blend_mode);
-    SOLARUS_CHECK_SDL_HIGHER(SDL_SetTextureBlendMode(texture.get_texture(),mode),-1);
-    SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(texture.get_texture(),infos.opacity));
-    SOLARUS_CHECK_SDL(SDL_RenderCopy(renderer,texture.get_texture(),infos.region,dst_rect));
-  });
+  // Clip the region to the source surface: in an atlas page,
+  // pixels outside of it belong to other images.
+  Rectangle src_rect = texture.to_texture_region(infos.region);
+  if (src_rect.is_flat()) {
+    return;
+  }
+  const Point clip_offset = src_rect.get_xy() - texture.get_texture_offset() - infos.region.get_xy();
+  Rectangle dst_rect(infos.dst_position + clip_offset,src_rect.get_size());
+  SDL_BlendMode mode = Surface::make_sdl_blend_mode(*this,texture,infos.blend_mode);
+
+  content_signature = combine_signature(content_signature,static_cast<uint64_t>(Operation::DRAW));
+  content_signature = combine_signature(content_signature,texture.get_content_signature());
+  content_signature = combine_rectangle(content_signature,src_rect);
+  content_signature = combine_rectangle(content_signature,dst_rect);
+  content_signature = combine_signature(content_signature,(static_cast<uint64_t>(mode) << 8) | infos.opacity);
+  content_signature = infos.transform.combine_signature(content_signature);
+
+  // Consecutive draws with the same state are done together.
+  SpriteBatch::add(*this,texture,src_rect,dst_rect,mode,infos.opacity,infos.transform);
 }
 
 /**
  * \copydoc SurfaceImpl::get_surface
+ *
+ * Only the region drawn since the last call is read back from the GPU.
+ * This is a synchronous transfer, so callers should avoid it in the
+ * middle of drawing when possible.
  */
 SDL_Surface *RenderTexture::get_surface() const {
-  if (surface_dirty) {
-    with_target([&](SDL_Renderer* renderer){
-      Rectangle rect(0,0,get_width(),get_height());
-      SOLARUS_CHECK_SDL(SDL_RenderReadPixels(renderer,
-                           rect,
-                           Video::get_rgba_format()->format,
-                           surface->pixels,
-                           surface->pitch
-                           ));
-    });
-    surface_dirty = false;
+  SpriteBatch::flush();
+  const Rectangle bounds(0,0,get_width(),get_height());
+  const Rectangle region = dirty_region & bounds;
+  dirty_region = Rectangle();
+  get_backup_surface();
+  if (surface_cleared) {
+    SDL_FillRect(surface.get(),nullptr,0);
+    surface_cleared = false;
+  }
+  if (region.is_flat()) {
+    return surface.get();
+  }
+
+  with_target(Rectangle(),[&](SDL_Renderer* renderer){
+    const int bytes_per_pixel = surface->format->BytesPerPixel;
+    uint8_t* pixels = static_cast<uint8_t*>(surface->pixels) +
+        region.get_y() * surface->pitch + region.get_x() * bytes_per_pixel;
+    SOLARUS_CHECK_SDL(SDL_RenderReadPixels(renderer,
+                         region,
+                         Video::get_rgba_format()->format,
+                         pixels,
+                         surface->pitch
+                         ));
+  });
+
+  ++readback_statistics.num_readbacks;
+  if (region == bounds) {
+    ++readback_statistics.num_full_readbacks;
   }
+  readback_statistics.num_pixels += region.get_width() * region.get_height();
+  return surface.get();
+}
+
+/**
+ * \copydoc SurfaceImpl::get_surface_to_overwrite
+ *
+ * No readback is done since the GPU pixels are about to be replaced.
+ */
+SDL_Surface *RenderTexture::get_surface_to_overwrite() const {
+  SpriteBatch::flush();
+  dirty_region = Rectangle();
+  get_backup_surface();
+  surface_cleared = false;
   return surface.get();
 }
 
+/**
+ * @brief Returns the readbacks done since the previous call and resets them
+ * @return the readback counters
+ */
+RenderTexture::ReadbackStatistics RenderTexture::take_readback_statistics() {
+  ReadbackStatistics statistics = readback_statistics;
+  readback_statistics = ReadbackStatistics();
+  return statistics;
+}
+
 /**
  * \copydoc SurfaceImpl::to_render_texture
  */
@@ -106,13 +259,20 @@ RenderTexture* RenderTexture::to_render_texture() {
  */
 void RenderTexture::fill_with_color(const Color& color, const Rectangle& where, SDL_BlendMode mode) {
   const SDL_Rect* rect = where;
-  with_target([&](SDL_Renderer* renderer){
+  with_target(where,[&](SDL_Renderer* renderer){
     Uint8 r,g,b,a;
     color.get_components(r,g,b,a);
     SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer,r,g,b,a));
     SOLARUS_CHECK_SDL(SDL_SetRenderDrawBlendMode(renderer,mode));
     SOLARUS_CHECK_SDL(SDL_RenderFillRect(renderer,rect));
   });
+
+  uint8_t r,g,b,a;
+  color.get_components(r,g,b,a);
+  content_signature = combine_signature(content_signature,static_cast<uint64_t>(Operation::FILL));
+  content_signature = combine_rectangle(content_signature,where);
+  content_signature = combine_signature(content_signature,
+      (static_cast<uint64_t>(mode) << 32) | (r << 24) | (g << 16) | (b << 8) | a);
 }
 
 /**
@@ -124,6 +284,15 @@ void RenderTexture::clear() {
     SOLARUS_CHECK_SDL(SDL_SetTextureBlendMode(target.get(),SDL_BLENDMODE_BLEND));
     SOLARUS_CHECK_SDL(SDL_RenderClear(renderer));
   });
+
+  // The CPU copy is cleared too, lazily, so nothing needs to be read back.
+  dirty_region = Rectangle();
+  surface_cleared = true;
+
+  // Whatever was drawn before, the content is now the same as any cleared texture
+  // of this size, which allows to detect frames redrawn identically.
+  content_signature = combine_signature(static_cast<uint64_t>(Operation::CLEAR),get_width());
+  content_signature = combine_signature(content_signature,get_height());
 }
 
 /**
@@ -33,65 +33,51 @@ int Scale2xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Scale2xFilter::filter(
+void Scale2xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int end_row) const {
 
   const int dst_width = src_width * 2;
 
-  int e1 = 0;
-  int e2, e3, e4;
-  int b, d, e = 0, f,  h;
-  for (int row = 0; row < src_height; row++) {
-    for (int col = 0; col < src_width; col++) {
-
-      // compute a to i
-
-      b = e - src_width;
-      d = e - 1;
-      f = e + 1;
-      h = e + src_width;
+  // Neighbors outside the image are replaced by the pixel itself.
+  // Left and current pixels slide along the row instead of being read again.
+  for (int row = first_row; row < end_row; row++) {
 
-      if (row == 0) {
-        b = e;
-      }
-      if (row == src_height - 1) {
-        h = e;
-      }
-      if (col == 0) {
-        d = e;
-      }
-      if (col == src_width - 1) {
-        f = e;
-      }
+    const uint32_t* above = src + (row == 0 ? row : row - 1) * src_width;
+    const uint32_t* line = src + row * src_width;
+    const uint32_t* below = src + (row == src_height - 1 ? row : row + 1) * src_width;
+    uint32_t* dst_line_1 = dst + row * 2 * dst_width;
+    uint32_t* dst_line_2 = dst_line_1 + dst_width;
 
-      // compute e1 to e4
-      e2 = e1 + 1;
-      e3 = e1 + dst_width;
-      e4 = e3 + 1;
+    uint32_t d = line[0];
+    uint32_t e = line[0];
+    for (int col = 0; col < src_width; col++) {
 
-      // compute the color
+      const uint32_t b = above[col];
+      const uint32_t f = (col == src_width - 1) ? e : line[col + 1];
+      const uint32_t h = below[col];
 
-      if (src[b] != src[h] && src[d] != src[f]) {
-        dst[e1] = src[(src[d] == src[b]) ? d : e];
-        dst[e2] = src[(src[b] == src[f]) ? f : e];
-        dst[e3] = src[(src[d] == src[h]) ? d : e];
-        dst[e4] = src[(src[h] == src[f]) ? f : e];
+      if (b != h && d != f) {
+        dst_line_1[0] = (d == b) ? d : e;
+        dst_line_1[1] = (b == f) ? f : e;
+        dst_line_2[0] = (d == h) ? d : e;
+        dst_line_2[1] = (h == f) ? f : e;
       }
       else {
-        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src[e];
+        dst_line_1[0] = dst_line_1[1] = dst_line_2[0] = dst_line_2[1] = e;
       }
-      e1 += 2;
-      e++;
+      dst_line_1 += 2;
+      dst_line_2 += 2;
+      d = e;
+      e = f;
     }
-    e1 += dst_width;
   }
-
 }
 
 }
-
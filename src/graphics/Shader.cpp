@@ -29,6 +29,8 @@
 #include "solarus/third_party/glm/gtx/transform.hpp"
 #include "solarus/third_party/glm/gtx/matrix_transform_2d.hpp"
 
+#include <algorithm>
+
 namespace Solarus {
 
 VertexArray Shader::screen_quad(TRIANGLES);
@@ -36,12 +38,26 @@ VertexArray Shader::screen_quad(TRIANGLES);
 /**
  * \brief Constructor.
  * \param shader_id The id of the shader to load (filename without extension).
+ * \param built_in_fragment_source Fragment source of a shader provided by the
+ * engine, or an empty string. Such a shader has no data file: it uses the
+ * default vertex source and the given fragment source, and \c shader_id only
+ * identifies it in messages.
  */
-Shader::Shader(const std::string& shader_id):
+Shader::Shader(const std::string& shader_id, const std::string& built_in_fragment_source):
     shader_id(shader_id),
     data(),
+    built_in_fragment_source(built_in_fragment_source),
     valid(true),
-    error() {
+    error(),
+    uniform_handles(),
+    uniforms(),
+    dirty_uniforms(),
+    texture_uniforms(),
+    num_texture_units(0),
+    time_handle(-1),
+    output_size_handle(-1),
+    input_size_handle(-1),
+    opacity_handle(-1) {
 }
 
 /**
@@ -102,6 +118,15 @@ const ShaderData& Shader::get_data() const {
   return data;
 }
 
+/**
+ * \brief Returns the fragment source of a shader provided by the engine.
+ * \return The fragment source, or an empty string if the shader comes from
+ * a data file.
+ */
+const std::string& Shader::get_built_in_fragment_source() const {
+  return built_in_fragment_source;
+}
+
 /**
  * @brief Returns the vertex source of the data or the default vertex source.
  * @return The vertex source.
@@ -143,47 +168,82 @@ void Shader::set_data(const ShaderData& data) {
 }
 
 /**
- * \fn Shader::set_uniform_1b
- * \brief Uploads a boolean uniform value to this shader program.
+ * \brief Returns a handle to set a uniform faster than by its name.
+ *
+ * The name is only looked up the first time.
+ * Handles are valid for the whole life of the shader, even if the program
+ * has no such uniform: setting it then does nothing.
+ *
+ * \param uniform_name Name of a uniform.
+ * \return The handle of this uniform.
+ */
+int Shader::get_uniform_handle(const std::string& uniform_name) {
+
+  const auto& it = uniform_handles.find(uniform_name);
+  if (it != uniform_handles.end()) {
+    return it->second;
+  }
+
+  Uniform uniform;
+  uniform.location = find_uniform_location(uniform_name);
+  uniform.type = UniformType::NONE;
+  uniform.int_value = 0;
+  std::fill(uniform.float_values, uniform.float_values + 4, 0.0f);
+  uniform.dirty = false;
+
+  const int handle = static_cast<int>(uniforms.size());
+  uniforms.push_back(uniform);
+  uniform_handles.insert(std::make_pair(uniform_name, handle));
+  return handle;
+}
+
+/**
+ * \brief Returns whether a value is a handle returned by get_uniform_handle().
+ * \param uniform_handle The value to check.
+ * \return \c true if this is a handle of this shader.
+ */
+bool Shader::is_uniform_handle_valid(int uniform_handle) const {
+  return uniform_handle >= 0 && uniform_handle < static_cast<int>(uniforms.size());
+}
+
+/**
+ * \brief Sets a boolean uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
  * \param value The boolean value to set.
  */
-void Shader::set_uniform_1b(const std::string&, bool) {
-  // TODO make pure virtual
+void Shader::set_uniform_1b(const std::string& uniform_name, bool value) {
+  set_uniform_1i(get_uniform_handle(uniform_name), value ? 1 : 0);
 }
 
 /**
- * \fn Shader::set_uniform_1i
- * \brief Uploads an integer uniform value to this shader program.
+ * \brief Sets an integer uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
  * \param value The integer value to set.
  */
-void Shader::set_uniform_1i(const std::string&, int) {
-  // TODO make pure virtual
+void Shader::set_uniform_1i(const std::string& uniform_name, int value) {
+  set_uniform_1i(get_uniform_handle(uniform_name), value);
 }
 
 /**
- * \fn Shader::set_uniform_1f
- * \brief Uploads a float uniform value to this shader program.
+ * \brief Sets a float uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
  * \param value The float value to set.
  */
-void Shader::set_uniform_1f(const std::string&, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_1f(const std::string& uniform_name, float value) {
+  set_uniform_1f(get_uniform_handle(uniform_name), value);
 }
 
 /**
- * \fn Shader::set_uniform_2f
- * \brief Uploads a vec2 uniform value to this shader program.
+ * \brief Sets a vec2 uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
@@ -191,28 +251,27 @@ void Shader::set_uniform_1f(const std::string&, float) {
  * \param value_1 The first float value to set.
  * \param value_2 The second float value to set.
  */
-void Shader::set_uniform_2f(const std::string&, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+  set_uniform_2f(get_uniform_handle(uniform_name), value_1, value_2);
 }
 
 /**
- * \fn Shader::set_uniform_3f
- * \brief Uploads a vec3 uniform value to this shader program.
+ * \brief Sets a vec3 uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
  * \param value_1 The first float value to set.
- * \param value_2 The third float value to set.
- * \param value_3 The second float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
  */
-void Shader::set_uniform_3f(const std::string&, float, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_3f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+  set_uniform_3f(get_uniform_handle(uniform_name), value_1, value_2, value_3);
 }
 
 /**
- * \fn Shader::set_uniform_4f
- * \brief Uploads a vec4 uniform value to this shader program.
+ * \brief Sets a vec4 uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
@@ -222,23 +281,259 @@ void Shader::set_uniform_3f(const std::string&, float, float, float) {
  * \param value_3 The third float value to set.
  * \param value_4 The fourth float value to set.
  */
-void Shader::set_uniform_4f(const std::string&, float, float, float, float) {
-  // TODO make pure virtual
+void Shader::set_uniform_4f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+  set_uniform_4f(get_uniform_handle(uniform_name), value_1, value_2, value_3, value_4);
 }
 
 /**
- * \fn Shader::set_uniform_texture
- * \brief Uploads a 2D texture uniform value to this shader program.
+ * \brief Sets a 2D texture uniform value of this shader program.
  *
  * Does nothing if there is no such uniform in the shader program.
  *
  * \param uniform_name Name of the uniform to set.
- * \param value The 2D texture value value to set.
+ * \param value The surface to sample.
  * \return \c true in case of success.
  */
-bool Shader::set_uniform_texture(const std::string&, const SurfacePtr&) {
-  // TODO make pure virtual
-  return false;
+bool Shader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
+  return set_uniform_texture(get_uniform_handle(uniform_name), value);
+}
+
+/**
+ * \brief Sets a boolean uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The boolean value to set.
+ */
+void Shader::set_uniform_1b(int uniform_handle, bool value) {
+  set_uniform_1i(uniform_handle, value ? 1 : 0);
+}
+
+/**
+ * \brief Sets an integer uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The integer value to set.
+ */
+void Shader::set_uniform_1i(int uniform_handle, int value) {
+
+  Uniform* uniform = get_uniform_to_set(uniform_handle, UniformType::INTEGER);
+  if (uniform == nullptr) {
+    return;
+  }
+
+  if (uniform->type == UniformType::INTEGER && uniform->int_value == value) {
+    return;
+  }
+
+  uniform->type = UniformType::INTEGER;
+  uniform->int_value = value;
+  if (!uniform->dirty) {
+    uniform->dirty = true;
+    dirty_uniforms.push_back(uniform_handle);
+  }
+}
+
+/**
+ * \brief Sets a float uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The float value to set.
+ */
+void Shader::set_uniform_1f(int uniform_handle, float value) {
+  set_uniform_floats(uniform_handle, UniformType::FLOAT_1, &value);
+}
+
+/**
+ * \brief Sets a vec2 uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ */
+void Shader::set_uniform_2f(int uniform_handle, float value_1, float value_2) {
+
+  const float values[] = { value_1, value_2 };
+  set_uniform_floats(uniform_handle, UniformType::FLOAT_2, values);
+}
+
+/**
+ * \brief Sets a vec3 uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
+ */
+void Shader::set_uniform_3f(int uniform_handle, float value_1, float value_2, float value_3) {
+
+  const float values[] = { value_1, value_2, value_3 };
+  set_uniform_floats(uniform_handle, UniformType::FLOAT_3, values);
+}
+
+/**
+ * \brief Sets a vec4 uniform value of this shader program.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value_1 The first float value to set.
+ * \param value_2 The second float value to set.
+ * \param value_3 The third float value to set.
+ * \param value_4 The fourth float value to set.
+ */
+void Shader::set_uniform_4f(
+    int uniform_handle, float value_1, float value_2, float value_3, float value_4) {
+
+  const float values[] = { value_1, value_2, value_3, value_4 };
+  set_uniform_floats(uniform_handle, UniformType::FLOAT_4, values);
+}
+
+/**
+ * \brief Sets a 2D texture uniform value of this shader program.
+ *
+ * The first time, the uniform gets its own texture unit.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param value The surface to sample.
+ * \return \c true in case of success.
+ */
+bool Shader::set_uniform_texture(int uniform_handle, const SurfacePtr& value) {
+
+  Uniform* uniform = get_uniform_to_set(uniform_handle, UniformType::TEXTURE);
+  if (uniform == nullptr) {
+    // Not an error.
+    return true;
+  }
+
+  if (value != nullptr) {
+    // The shader samples the whole texture: it must not be an atlas page.
+    value->request_render();
+  }
+
+  if (uniform->type != UniformType::TEXTURE) {
+    // Find a new texture unit.
+    uniform->type = UniformType::TEXTURE;
+    uniform->int_value = ++num_texture_units;
+    texture_uniforms.push_back(uniform_handle);
+    if (!uniform->dirty) {
+      uniform->dirty = true;
+      dirty_uniforms.push_back(uniform_handle);
+    }
+  }
+
+  uniform->texture = value;
+  return true;
+}
+
+/**
+ * \brief Returns a uniform whose value can be set.
+ *
+ * A texture uniform keeps its texture unit: it cannot become
+ * another kind of uniform.
+ *
+ * \param uniform_handle Handle of the uniform to set.
+ * \param type Kind of the new value.
+ * \return The uniform, or nullptr if it cannot be set or the program
+ * does not use it.
+ */
+Shader::Uniform* Shader::get_uniform_to_set(int uniform_handle, UniformType type) {
+
+  Debug::check_assertion(is_uniform_handle_valid(uniform_handle),
+      "Invalid uniform handle");
+
+  Uniform& uniform = uniforms[uniform_handle];
+  if (uniform.location == -1) {
+    return nullptr;
+  }
+
+  if (uniform.type == UniformType::TEXTURE && type != UniformType::TEXTURE) {
+    return nullptr;
+  }
+  return &uniform;
+}
+
+/**
+ * \brief Sets a float, vec2, vec3 or vec4 uniform value.
+ * \param uniform_handle Handle of the uniform to set.
+ * \param type Kind of value: FLOAT_1, FLOAT_2, FLOAT_3 or FLOAT_4.
+ * \param values The components to set.
+ */
+void Shader::set_uniform_floats(int uniform_handle, UniformType type, const float* values) {
+
+  Uniform* uniform = get_uniform_to_set(uniform_handle, type);
+  if (uniform == nullptr) {
+    return;
+  }
+
+  const int num_values = static_cast<int>(type) - static_cast<int>(UniformType::FLOAT_1) + 1;
+  if (uniform->type == type &&
+      std::equal(values, values + num_values, uniform->float_values)) {
+    return;
+  }
+
+  uniform->type = type;
+  std::copy(values, values + num_values, uniform->float_values);
+  if (!uniform->dirty) {
+    uniform->dirty = true;
+    dirty_uniforms.push_back(uniform_handle);
+  }
+}
+
+/**
+ * \brief Uploads the uniforms that changed since the last call.
+ *
+ * This should be called when rendering, once the program is the current one.
+ */
+void Shader::upload_dirty_uniforms() {
+
+  for (int uniform_handle: dirty_uniforms) {
+    Uniform& uniform = uniforms[uniform_handle];
+    upload_uniform(uniform);
+    uniform.dirty = false;
+  }
+  dirty_uniforms.clear();
+}
+
+/**
+ * \brief Makes all uniforms with a value be uploaded again at the next render.
+ *
+ * This is needed when the program may contain values of another shader.
+ */
+void Shader::mark_all_uniforms_dirty() {
+
+  for (size_t i = 0; i < uniforms.size(); ++i) {
+    Uniform& uniform = uniforms[i];
+    if (uniform.type != UniformType::NONE && !uniform.dirty) {
+      uniform.dirty = true;
+      dirty_uniforms.push_back(static_cast<int>(i));
+    }
+  }
+}
+
+/**
+ * \brief Returns all uniforms requested so far, indexed by handle.
+ * \return The uniforms.
+ */
+std::vector<Shader::Uniform>& Shader::get_uniforms() {
+  return uniforms;
+}
+
+/**
+ * \brief Returns the handles of the uniforms that have a texture unit.
+ * \return The texture uniform handles.
+ */
+const std::vector<int>& Shader::get_texture_uniforms() const {
+  return texture_uniforms;
+}
+
+/**
+ * \brief Gets the handles of uniforms set by the engine at each render.
+ *
+ * This cannot be done in the constructor because the program is created
+ * by subclasses.
+ */
+void Shader::find_built_in_uniforms() {
+
+  if (time_handle != -1) {
+    return;
+  }
+  time_handle = get_uniform_handle(TIME_NAME);
+  output_size_handle = get_uniform_handle(OUTPUT_SIZE_NAME);
+  input_size_handle = get_uniform_handle(INPUT_SIZE_NAME);
+  opacity_handle = get_uniform_handle(OPACITY_NAME);
 }
 
 /**
@@ -248,15 +543,29 @@ bool Shader::set_uniform_texture(const std::string&, const SurfacePtr&) {
  * @param dst_size size of the destination surface
  * @param dst_position position where to draw surface on destination
  * @param flip_y flip the drawing upside-down
+ * @param transform rotation and scale applied to the quad
  */
-void Shader::render(const Surface& surface, const Rectangle& region, const Size& dst_size, const Point & dst_position, bool flip_y) {
+void Shader::render(const Surface& surface, const Rectangle& region, const Size& dst_size, const Point & dst_position, bool flip_y, const DrawTransform& transform) {
   //TODO compute mvp and uv_matrix here
   glm::mat4 viewport = glm::ortho<float>(0,dst_size.width,0,dst_size.height); //Specify float as type to avoid integral division
   glm::mat4 dst = glm::translate(glm::mat4(),glm::vec3(dst_position.x,dst_position.y,0));
+  if (transform.is_geometric()) {
+    // Around the pivot, the y axis going down.
+    const glm::vec3 pivot(transform.pivot.x,transform.pivot.y,0);
+    glm::mat4 transform_matrix = glm::translate(glm::mat4(),pivot);
+    transform_matrix = glm::rotate(transform_matrix,static_cast<float>(-transform.rotation),glm::vec3(0,0,1));
+    transform_matrix = glm::scale(transform_matrix,glm::vec3(transform.scale_x,transform.scale_y,1));
+    transform_matrix = glm::translate(transform_matrix,-pivot);
+    dst = transform_matrix*dst;
+  }
   glm::mat4 scale = glm::scale(glm::mat4(),glm::vec3(region.get_width(),region.get_height(),1));
 
-  float uxf = 1.f/surface.get_width();
-  float uyf = 1.f/surface.get_height();
+  // The surface may only be a part of its texture (atlas page).
+  const SurfaceImpl& internal_surface = surface.get_internal_surface();
+  const Size& texture_size = internal_surface.get_texture_size();
+  const Point& texture_offset = internal_surface.get_texture_offset();
+  float uxf = 1.f/texture_size.width;
+  float uyf = 1.f/texture_size.height;
 
   glm::mat3 uv_scale = glm::scale(
         glm::mat3(1),
@@ -265,7 +574,7 @@ void Shader::render(const Surface& surface, const Rectangle& region, const Size&
           region.get_height()*uyf
           )
         );
-  glm::mat3 uv_trans = glm::translate(glm::mat3(),glm::vec2(region.get_left()*uxf,region.get_top()*uyf));
+  glm::mat3 uv_trans = glm::translate(glm::mat3(),glm::vec2((region.get_left()+texture_offset.x)*uxf,(region.get_top()+texture_offset.y)*uyf));
   glm::mat3 uvm = uv_trans*uv_scale;
   if(!flip_y){
     uvm = glm::scale(uvm,glm::vec2(1,-1));
@@ -273,13 +582,62 @@ void Shader::render(const Surface& surface, const Rectangle& region, const Size&
   }
   //Set input size
   const Size& size = flip_y ? Video::get_output_size() : dst_size;
-  set_uniform_1i(Shader::TIME_NAME, System::now());
-  set_uniform_2f(Shader::OUTPUT_SIZE_NAME, size.width, size.height);
-  set_uniform_2f(Shader::INPUT_SIZE_NAME, region.get_width(), region.get_height());
+  find_built_in_uniforms();
+  set_uniform_1i(time_handle, System::now());
+  set_uniform_2f(output_size_handle, size.width, size.height);
+  set_uniform_2f(input_size_handle, region.get_width(), region.get_height());
   render(screen_quad,surface,viewport*dst*scale,uvm);
 }
 
+/**
+ * @brief Render a whole surface stretched over the currently bound rendertarget
+ *
+ * Used by post-processing passes whose target may be smaller or larger
+ * than their input. The output size uniform is the size of the target.
+ *
+ * @param surface surface to draw
+ * @param dst_size size of the destination render target
+ */
+void Shader::render_stretched(const Surface& surface, const Size& dst_size) {
+
+  // The quad covers the whole target when the viewport is its own size.
+  const Size& size = surface.get_size();
+  glm::mat4 viewport = glm::ortho<float>(0,size.width,0,size.height);
+  glm::mat4 scale = glm::scale(glm::mat4(),glm::vec3(size.width,size.height,1));
+
+  const SurfaceImpl& internal_surface = surface.get_internal_surface();
+  const Size& texture_size = internal_surface.get_texture_size();
+  const Point& texture_offset = internal_surface.get_texture_offset();
+  float uxf = 1.f/texture_size.width;
+  float uyf = 1.f/texture_size.height;
+
+  glm::mat3 uv_scale = glm::scale(glm::mat3(1),glm::vec2(size.width*uxf,size.height*uyf));
+  glm::mat3 uv_trans = glm::translate(glm::mat3(),glm::vec2(texture_offset.x*uxf,texture_offset.y*uyf));
+  glm::mat3 uvm = uv_trans*uv_scale;
+  uvm = glm::scale(uvm,glm::vec2(1,-1));
+  uvm = glm::translate(uvm,glm::vec2(0,-1));
+
+  find_built_in_uniforms();
+  set_uniform_1i(time_handle, System::now());
+  set_uniform_2f(output_size_handle, dst_size.width, dst_size.height);
+  set_uniform_2f(input_size_handle, size.width, size.height);
+  render(screen_quad,surface,viewport*scale,uvm);
+}
+
+/**
+ * @brief render the given vertex array with this shader, passing the texture of a surface
+ * @param array a vertex array
+ * @param texture a valid surface
+ * @param mvp_matrix model view projection matrix
+ * @param uv_matrix uv_matrix
+ */
+void Shader::render(const VertexArray& array, const Surface& texture, const glm::mat4& mvp_matrix, const glm::mat3& uv_matrix) {
+  render(array,texture.get_internal_surface().get_texture(),mvp_matrix,uv_matrix);
+}
+
 void Shader::draw(Surface& dst_surface, const Surface &src_surface, const DrawInfos &infos) const {
+    // Uniforms may change the result at any time: the content becomes unknown.
+    dst_surface.request_render().invalidate_content_signature();
     dst_surface.request_render().with_target([&](SDL_Renderer* r){
       SDL_BlendMode target = Surface::make_sdl_blend_mode(dst_surface.get_internal_surface(),
                                                           src_surface.get_internal_surface(),
@@ -292,8 +650,9 @@ void Shader::draw(Surface& dst_surface, const Surface &src_surface, const DrawIn
       }
       //TODO fix this ugliness
       Shader* that = const_cast<Shader*>(this);
-      that->set_uniform_1f(OPACITY_NAME,src_surface.get_opacity()/256.f);
-      that->Shader::render(src_surface,infos.region,dst_surface.get_size(),infos.dst_position);
+      that->find_built_in_uniforms();
+      that->set_uniform_1f(that->opacity_handle,src_surface.get_opacity()/256.f);
+      that->Shader::render(src_surface,infos.region,dst_surface.get_size(),infos.dst_position,false,infos.transform);
     });
 }
 
@@ -84,6 +84,22 @@ const std::string& ShaderContext::get_opengl_version() {
   return opengl_version;
 }
 
+/**
+ * \brief Returns the name of the OpenGL vendor.
+ * \return The OpenGL vendor.
+ */
+const std::string& ShaderContext::get_opengl_vendor() {
+  return opengl_vendor;
+}
+
+/**
+ * \brief Returns the name of the OpenGL renderer, usually the GPU.
+ * \return The OpenGL renderer.
+ */
+const std::string& ShaderContext::get_opengl_renderer() {
+  return opengl_renderer;
+}
+
 /**
  * \brief Returns the shading language version.
  * \return The shading language version.
@@ -94,7 +110,8 @@ const std::string& ShaderContext::get_shading_language_version() {
 
 /**
  * \brief Construct a shader from a name.
- * \param shader_id The id of the shader to load.
+ * \param shader_id The id of the shader to load,
+ * or an empty string for the built-in shader that just draws textures.
  * \return The created shader.
  */
 ShaderPtr ShaderContext::create_shader(const std::string& shader_id) {
@@ -111,6 +128,31 @@ ShaderPtr ShaderContext::create_shader(const std::string& shader_id) {
   return shader;
 }
 
+/**
+ * \brief Constructs a shader whose fragment source is provided by the engine.
+ *
+ * It uses the default vertex source and does not need any data file.
+ *
+ * \param name A name to identify the shader in messages.
+ * \param fragment_source Source of the fragment shader.
+ * \return The created shader.
+ */
+ShaderPtr ShaderContext::create_built_in_shader(
+    const std::string& name,
+    const std::string& fragment_source
+) {
+  ShaderPtr shader = nullptr;
+
+  if (is_universal_shader_supported) {
+    shader = std::make_shared<GlShader>(name, fragment_source);
+  }
+  else {
+    shader = std::make_shared<GlArbShader>(name, fragment_source);
+  }
+
+  return shader;
+}
+
 void ShaderContext::make_current() {
   SDL_GL_MakeCurrent(Video::get_window(),gl_context);
 }
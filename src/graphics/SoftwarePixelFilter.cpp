@@ -14,7 +14,9 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/ThreadPool.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
+#include <algorithm>
 
 namespace Solarus {
 
@@ -30,5 +32,63 @@ SoftwarePixelFilter::SoftwarePixelFilter() {
 SoftwarePixelFilter::~SoftwarePixelFilter() {
 }
 
+/**
+ * \brief Applies the algorithm on a rectangle of pixels.
+ * \param src The rectangle of pixels in RGBA format.
+ * Must be a buffer of size src_width * src_height.
+ * \param src_width Width of the rectangle.
+ * \param src_height Height of the rectangle.
+ * \param dst The destination rectangle to write.
+ * Must be a buffer of size
+ * src_width * src_height * get_scaling_factor()^2.
+ */
+void SoftwarePixelFilter::filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst) const {
+
+  filter_rows(src, src_width, src_height, dst, 0, src_height);
+}
+
+/**
+ * \brief Applies the algorithm on a rectangle of pixels with several threads.
+ *
+ * The rectangle is split into horizontal bands filtered in parallel.
+ * The result is the same as with a single thread.
+ *
+ * \param src The rectangle of pixels in RGBA format.
+ * Must be a buffer of size src_width * src_height.
+ * \param src_width Width of the rectangle.
+ * \param src_height Height of the rectangle.
+ * \param dst The destination rectangle to write.
+ * Must be a buffer of size
+ * src_width * src_height * get_scaling_factor()^2.
+ * \param thread_pool Threads to use.
+ */
+void SoftwarePixelFilter::filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst,
+    ThreadPool& thread_pool) const {
+
+  // A few bands per thread so that work stealing can balance them.
+  const int num_bands = std::max(1, std::min(
+      thread_pool.get_num_threads() * 4,
+      src_height / min_band_height
+  ));
+  if (num_bands == 1) {
+    filter(src, src_width, src_height, dst);
+    return;
+  }
+
+  thread_pool.parallel_for(num_bands, [&](int band) {
+    const int first_row = src_height * band / num_bands;
+    const int end_row = src_height * (band + 1) / num_bands;
+    filter_rows(src, src_width, src_height, dst, first_row, end_row);
+  });
+}
+
 }
 
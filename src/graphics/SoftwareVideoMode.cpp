@@ -26,15 +26,19 @@ namespace Solarus {
  * \param name Lua name of the video mode.
  * \param initial_window_size Default size of the window when selecting this video mode.
  * \param software_filter Software filter to apply to the quest image or nullptr.
+ * \param shader_source Fragment shader equivalent to the software filter,
+ * or an empty string.
  */
 SoftwareVideoMode::SoftwareVideoMode(
     const std::string& name,
     const Size& initial_window_size,
-    std::unique_ptr<SoftwarePixelFilter> software_filter
+    std::unique_ptr<SoftwarePixelFilter> software_filter,
+    const std::string& shader_source
 ):
    name(name),
    initial_window_size(initial_window_size),
-   software_filter(std::move(software_filter)) {
+   software_filter(std::move(software_filter)),
+   shader_source(shader_source) {
 
 }
 
@@ -62,4 +66,15 @@ const SoftwarePixelFilter* SoftwareVideoMode::get_software_filter() const {
   return software_filter.get();
 }
 
+/**
+ * \brief Returns the fragment shader source that scales like the software filter.
+ *
+ * It is used instead of the software filter when shaders are supported.
+ *
+ * \return Fragment shader source or an empty string.
+ */
+const std::string& SoftwareVideoMode::get_shader_source() const {
+  return shader_source;
+}
+
 }
@@ -17,7 +17,9 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/PixelBits.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Size.h"
 #include "solarus/core/System.h"
 #include "solarus/graphics/Color.h"
@@ -32,15 +34,15 @@
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
 #include <lua.hpp>
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <sstream>
 #include <iostream>
+#include <utility>
 
 namespace Solarus {
 
-std::map<std::string, SpriteAnimationSet*> Sprite::all_animation_sets;
-
 /**
  * \brief Initializes the sprites system.
  */
@@ -49,40 +51,63 @@ void Sprite::initialize() {
 
 /**
  * \brief Uninitializes the sprites system.
+ *
+ * Animation sets are owned by the resource provider.
  */
 void Sprite::quit() {
-
-  // delete the animations loaded
-  for (auto& kvp: all_animation_sets) {
-    delete kvp.second;
-  }
-  all_animation_sets.clear();
 }
 
 /**
  * \brief Returns the sprite animation set corresponding to the specified id.
  *
- * The animation set may be created if it is new, or just retrieved from
- * memory if it way already used before.
+ * The animation set is shared with other sprites through the resource
+ * provider: it may be created if it is new, or just retrieved from memory
+ * if it is already used or still in the cache.
  *
  * \param id id of the animation set
  * \return the corresponding animation set
  */
-SpriteAnimationSet& Sprite::get_animation_set(const std::string& id) {
+std::shared_ptr<SpriteAnimationSet> Sprite::get_animation_set(const std::string& id) {
 
-  SpriteAnimationSet* animation_set = nullptr;
-  auto it = all_animation_sets.find(id);
-  if (it != all_animation_sets.end()) {
-    animation_set = it->second;
+  ResourceProvider* resource_provider = ResourceProvider::get_instance();
+  if (resource_provider == nullptr) {
+    // No cache: the animation set is only shared by copies of this sprite.
+    return std::make_shared<SpriteAnimationSet>(id);
   }
-  else {
-    animation_set = new SpriteAnimationSet(id);
-    all_animation_sets[id] = animation_set;
+
+  return resource_provider->get_animation_set(id);
+}
+
+/**
+ * \brief Replaces the animation set by its newer version.
+ *
+ * The current animation, direction and frame are kept if they still exist.
+ * No Lua event is called: the sprite continues as if nothing happened.
+ */
+void Sprite::reload_animation_set() {
+
+  cancel_precomputed_frames();
+  const bool pixel_collisions = animation_set->are_pixel_collisions_enabled();
+  animation_set = get_animation_set(animation_set_id);
+  if (pixel_collisions) {
+    animation_set->enable_pixel_collisions();
   }
 
-  Debug::check_assertion(animation_set != nullptr, "No animation set");
+  if (animation_set->has_animation(current_animation_name)) {
+    current_animation = &animation_set->get_animation(current_animation_name);
+  }
+  else {
+    current_animation_name = animation_set->get_default_animation();
+    current_animation = animation_set->has_animation(current_animation_name) ?
+        &animation_set->get_animation(current_animation_name) : nullptr;
+  }
 
-  return *animation_set;
+  if (current_direction < 0 || current_direction >= get_nb_directions()) {
+    current_direction = 0;
+  }
+  if (current_frame >= get_nb_frames()) {
+    current_frame = 0;
+  }
 }
 
 /**
@@ -103,12 +128,15 @@ Sprite::Sprite(const std::string& id):
   paused(false),
   finished(false),
   synchronize_to(nullptr),
+  global_clock_enabled(false),
+  has_synchronized_sprites(false),
   blink_delay(0),
   blink_is_sprite_visible(true),
   blink_next_change_date(0),
-  finished_callback_ref() {
+  finished_callback_ref(),
+  precomputed() {
 
-  set_current_animation(animation_set.get_default_animation());
+  set_current_animation(animation_set->get_default_animation());
 }
 
 /**
@@ -128,7 +156,7 @@ const std::string& Sprite::get_animation_set_id() const {
  * \return the animation set of this sprite
  */
 const SpriteAnimationSet& Sprite::get_animation_set() const {
-  return animation_set;
+  return *animation_set;
 }
 
 /**
@@ -139,7 +167,7 @@ const SpriteAnimationSet& Sprite::get_animation_set() const {
  * \param tileset The tileset.
  */
 void Sprite::set_tileset(const Tileset& tileset) {
-  animation_set.set_tileset(tileset);
+  animation_set->set_tileset(tileset);
 }
 
 /**
@@ -148,7 +176,7 @@ void Sprite::set_tileset(const Tileset& tileset) {
  * All sprites that use the same animation set as this one will be affected.
  */
 void Sprite::enable_pixel_collisions() {
-  animation_set.enable_pixel_collisions();
+  animation_set->enable_pixel_collisions();
 }
 
 /**
@@ -156,7 +184,7 @@ void Sprite::enable_pixel_collisions() {
  * \return true if the pixel-perfect collisions are enabled
  */
 bool Sprite::are_pixel_collisions_enabled() const {
-  return animation_set.are_pixel_collisions_enabled();
+  return animation_set->are_pixel_collisions_enabled();
 }
 
 /**
@@ -176,7 +204,7 @@ Size Sprite::get_size() const {
  * \return The maximum frame size.
  */
 const Size& Sprite::get_max_size() const {
-  return animation_set.get_max_size();
+  return animation_set->get_max_size();
 }
 
 /**
@@ -204,7 +232,7 @@ Point Sprite::get_origin() const {
  */
 const Rectangle& Sprite::get_max_bounding_box() const {
 
-  return animation_set.get_max_bounding_box();
+  return animation_set->get_max_bounding_box();
 }
 
 /**
@@ -231,7 +259,11 @@ uint32_t Sprite::get_frame_delay() const {
  * in milliseconds.
  */
 void Sprite::set_frame_delay(uint32_t frame_delay) {
+  cancel_precomputed_frames();
   this->frame_delay = frame_delay;
+  if (global_clock_enabled) {
+    next_frame_date = System::now();
+  }
 }
 
 /**
@@ -257,6 +289,20 @@ int Sprite::get_next_frame() const {
   return current_animation->get_next_frame(current_direction, current_frame);
 }
 
+/**
+ * \brief Returns the date of the first frame change after a (re)start.
+ * \param now The current date.
+ * \return The date of the next frame. With the global clock, this is now
+ * so that the next update catches up with the clock.
+ */
+uint32_t Sprite::get_first_frame_date(uint32_t now) const {
+
+  if (global_clock_enabled) {
+    return now;
+  }
+  return now + get_frame_delay();
+}
+
 /**
  * \brief Returns the current animation of the sprite.
  * \return the name of the current animation of the sprite
@@ -278,8 +324,8 @@ void Sprite::set_current_animation(const std::string& animation_name) {
   if (animation_name != this->current_animation_name || !is_animation_started()) {
 
     this->current_animation_name = animation_name;
-    if (animation_set.has_animation(animation_name)) {
-      this->current_animation = &animation_set.get_animation(animation_name);
+    if (animation_set->has_animation(animation_name)) {
+      this->current_animation = &animation_set->get_animation(animation_name);
       set_frame_delay(current_animation->get_frame_delay());
     }
     else {
@@ -312,7 +358,7 @@ void Sprite::set_current_animation(const std::string& animation_name) {
  * \return true if this animation exists
  */
 bool Sprite::has_animation(const std::string& animation_name) const {
-  return animation_set.has_animation(animation_name);
+  return animation_set->has_animation(animation_name);
 }
 
 /**
@@ -404,8 +450,9 @@ int Sprite::get_current_frame() const {
  */
 void Sprite::set_current_frame(int current_frame, bool notify_script) {
 
+  cancel_precomputed_frames();
   finished = false;
-  next_frame_date = System::now() + get_frame_delay();
+  next_frame_date = get_first_frame_date(System::now());
 
   if (current_frame != this->current_frame) {
     this->current_frame = current_frame;
@@ -457,7 +504,44 @@ void Sprite::set_frame_changed(bool frame_changed) {
  * \param other the sprite to synchronize to, or nullptr to stop any previous synchronization
  */
 void Sprite::set_synchronized_to(const SpritePtr& other) {
+  cancel_precomputed_frames();
   this->synchronize_to = other;
+  if (other != nullptr) {
+    // The other sprite must now keep its frame up to date.
+    other->has_synchronized_sprites = true;
+  }
+}
+
+/**
+ * \brief Returns whether the frames of this sprite follow the global clock.
+ * \return \c true if the global clock is enabled.
+ */
+bool Sprite::is_global_clock_enabled() const {
+  return global_clock_enabled;
+}
+
+/**
+ * \brief Sets whether the frames of this sprite follow the global clock.
+ *
+ * With the global clock, the current frame only depends on the current
+ * date, the animation, the direction and the frame delay, as if all
+ * animations had started at date zero.
+ * Sprites with the same animation then always show the same frame, like
+ * animated tiles, and their update does nothing between two frames.
+ * This is meant for looping scenery animations like water or torches.
+ * The global clock has priority over set_synchronized_to().
+ *
+ * \param global_clock_enabled \c true to follow the global clock.
+ */
+void Sprite::set_global_clock_enabled(bool global_clock_enabled) {
+
+  if (global_clock_enabled == this->global_clock_enabled) {
+    return;
+  }
+
+  cancel_precomputed_frames();
+  this->global_clock_enabled = global_clock_enabled;
+  next_frame_date = get_first_frame_date(System::now());
 }
 
 /**
@@ -490,6 +574,7 @@ void Sprite::restart_animation() {
  * \brief Stops the animation.
  */
 void Sprite::stop_animation() {
+  cancel_precomputed_frames();
   finished = true;
 }
 
@@ -505,12 +590,13 @@ void Sprite::set_suspended(bool suspended) {
   if (suspended != is_suspended() &&
       !ignore_suspend) {
 
+    cancel_precomputed_frames();
     Drawable::set_suspended(suspended);
 
     // compte next_frame_date if the animation is being resumed
     if (!suspended) {
       uint32_t now = System::now();
-      next_frame_date = now + get_frame_delay();
+      next_frame_date = get_first_frame_date(now);
       blink_next_change_date = now;
     }
     else {
@@ -550,12 +636,13 @@ bool Sprite::is_paused() const {
 void Sprite::set_paused(bool paused) {
 
   if (paused != this->paused) {
+    cancel_precomputed_frames();
     this->paused = paused;
 
     // compte next_frame_date if the animation is being resumed
     if (!paused) {
       uint32_t now = System::now();
-      next_frame_date = now + get_frame_delay();
+      next_frame_date = get_first_frame_date(now);
       blink_next_change_date = now;
     }
     else {
@@ -612,6 +699,7 @@ bool Sprite::is_blinking() const {
  * or zero to stop blinking.
  */
 void Sprite::set_blinking(uint32_t blink_delay) {
+  cancel_precomputed_frames();
   this->blink_delay = blink_delay;
 
   if (blink_delay > 0) {
@@ -671,6 +759,115 @@ bool Sprite::test_collision(const Sprite& other, int x1, int y1, int x2, int y2)
   return pixel_bits1.test_collision(pixel_bits2, location1, location2);
 }
 
+/**
+ * \brief Returns whether the frames of this sprite can be computed by
+ * precompute_frames() outside the serial update.
+ *
+ * This is the case when advancing the animation cannot run any Lua code
+ * and does not depend on another sprite.
+ *
+ * \return \c true if precompute_frames() can be called.
+ */
+bool Sprite::can_precompute_frames() const {
+
+  return !is_suspended() &&
+      !paused &&
+      !finished &&
+      !global_clock_enabled &&
+      synchronize_to == nullptr &&
+      get_lua_context() == nullptr &&
+      finished_callback_ref.is_empty();
+}
+
+/**
+ * \brief Computes in advance the frame changes that the next update() will do.
+ *
+ * Only the state of this sprite is read and only a private copy is written,
+ * so different sprites can be precomputed from different threads.
+ * The next call to update() commits the result and does the notifications,
+ * unless the sprite is modified in the meantime.
+ *
+ * \param now The simulated time that update() will see.
+ */
+void Sprite::precompute_frames(uint32_t now) {
+
+  PrecomputedFrames result;
+  result.date = now;
+  result.current_frame = current_frame;
+  result.next_frame_date = next_frame_date;
+  result.blink_is_sprite_visible = blink_is_sprite_visible;
+  result.blink_next_change_date = blink_next_change_date;
+
+  // Same frame loop as update(), without notifications.
+  const uint32_t frame_delay = get_frame_delay();
+  while (!result.finished_now &&
+      frame_delay > 0 &&
+      now >= result.next_frame_date
+  ) {
+    int next_frame = current_animation == nullptr ?
+        -1 : current_animation->get_next_frame(current_direction, result.current_frame);
+
+    if (next_frame == -1) {
+      result.finished_now = true;
+    }
+    else {
+      result.current_frame = next_frame;
+      uint32_t old_next_frame_date = result.next_frame_date;
+      result.next_frame_date += frame_delay;
+      if (result.next_frame_date < old_next_frame_date) {
+        result.next_frame_date = std::numeric_limits<uint32_t>::max();
+      }
+    }
+    result.frame_changed = true;
+  }
+
+  if (is_blinking()) {
+    while (now >= result.blink_next_change_date) {
+      result.blink_is_sprite_visible = !result.blink_is_sprite_visible;
+      result.blink_next_change_date += blink_delay;
+    }
+  }
+
+  result.valid = true;
+  precomputed = result;
+}
+
+/**
+ * \brief Drops the result of precompute_frames() if any.
+ *
+ * Called when the sprite is modified, so that update() computes
+ * its frames again from the new state.
+ */
+void Sprite::cancel_precomputed_frames() {
+  precomputed.valid = false;
+}
+
+/**
+ * \brief Applies the result of precompute_frames() and does the
+ * notifications that update() would have done.
+ */
+void Sprite::commit_precomputed_frames() {
+
+  precomputed.valid = false;
+
+  current_frame = precomputed.current_frame;
+  next_frame_date = precomputed.next_frame_date;
+  blink_is_sprite_visible = precomputed.blink_is_sprite_visible;
+  blink_next_change_date = precomputed.blink_next_change_date;
+  set_frame_changed(precomputed.frame_changed);
+
+  if (precomputed.finished_now) {
+    finished = true;
+    notify_finished();
+  }
+
+  // The sprite may have become known to Lua since the precomputation.
+  LuaContext* lua_context = get_lua_context();
+  if (precomputed.frame_changed && lua_context != nullptr) {
+    lua_context->sprite_on_frame_changed(*this, current_animation_name, current_frame);
+  }
+}
+
 /**
  * \brief Checks whether the frame has to be changed.
  *
@@ -680,17 +877,37 @@ void Sprite::update() {
 
   Drawable::update();
 
+  if (animation_set->is_obsolete()) {
+    reload_animation_set();
+  }
+
   if (is_suspended() || paused) {
     return;
   }
 
+  if (precomputed.valid) {
+    if (precomputed.date == System::now()) {
+      commit_precomputed_frames();
+      return;
+    }
+    // Stale result of a cycle where this sprite was not updated.
+    cancel_precomputed_frames();
+  }
+
   LuaContext* lua_context = get_lua_context();
 
   frame_changed = false;
   uint32_t now = System::now();
 
   // Update the current frame.
-  if (synchronize_to == nullptr
+  if (global_clock_enabled) {
+    if (now < next_frame_date && !is_blinking()) {
+      // Nothing can change before the next frame of the clock.
+      return;
+    }
+    update_global_clock_frame(now);
+  }
+  else if (synchronize_to == nullptr
       || current_animation_name != synchronize_to->get_current_animation()
       || synchronize_to->get_current_direction() > get_nb_directions()
       || synchronize_to->get_current_frame() > get_nb_frames()) {
@@ -757,6 +974,76 @@ void Sprite::update() {
   }
 }
 
+/**
+ * \copydoc Drawable::needs_update
+ *
+ * Sprites that nobody observes frame by frame don't need to be updated at
+ * each cycle: since frames only depend on dates, update() can catch up
+ * later, when the sprite is drawn or used.
+ */
+bool Sprite::needs_update() const {
+  return Drawable::needs_update() || has_frame_observers();
+}
+
+/**
+ * \brief Returns whether something needs to know each change of frame as
+ * soon as it happens.
+ * \return \c true if there is a Lua event, a callback or a synchronized
+ * sprite depending on the frames of this sprite.
+ */
+bool Sprite::has_frame_observers() const {
+
+  if (!finished_callback_ref.is_empty() ||
+      synchronize_to != nullptr ||
+      has_synchronized_sprites) {
+    return true;
+  }
+
+  const LuaContext* lua_context = get_lua_context();
+  return lua_context != nullptr &&
+      (lua_context->userdata_has_field(*this, "on_frame_changed") ||
+       lua_context->userdata_has_field(*this, "on_animation_finished"));
+}
+
+/**
+ * \brief Sets the frame given by the global clock at a date.
+ * \param now The current date.
+ */
+void Sprite::update_global_clock_frame(uint32_t now) {
+
+  const uint32_t frame_delay = get_frame_delay();
+  if (current_animation == nullptr ||
+      finished ||
+      frame_delay == 0 ||
+      now < next_frame_date) {
+    return;
+  }
+
+  const uint32_t step = now / frame_delay;
+  const uint64_t step_end_date = (static_cast<uint64_t>(step) + 1) * frame_delay;
+  next_frame_date = static_cast<uint32_t>(std::min<uint64_t>(
+      step_end_date, std::numeric_limits<uint32_t>::max()));
+
+  const int frame = current_animation->get_frame_at_step(current_direction, step);
+  if (frame == current_frame) {
+    return;
+  }
+
+  if (frame == -1) {
+    finished = true;
+    notify_finished();
+  }
+  else {
+    current_frame = frame;
+  }
+  set_frame_changed(true);
+
+  LuaContext* lua_context = get_lua_context();
+  if (lua_context != nullptr) {
+    lua_context->sprite_on_frame_changed(*this, current_animation_name, current_frame);
+  }
+}
+
 /**
  * @brief Sprite::draw_intermediate
  * @param region
@@ -912,6 +1199,7 @@ Rectangle Sprite::get_region() const {
 Surface& Sprite::get_intermediate_surface() const {
 
   if (intermediate_surface == nullptr) {
+    MemoryStats::TextureOrigin origin(MemoryStats::Category::SPRITE_TEXTURES);
     intermediate_surface = Surface::create(get_max_size(),true);
   }
   return *intermediate_surface;
@@ -932,13 +1220,13 @@ const ScopedLuaRef& Sprite::get_finished_callback() const {
  * \param finished_callback_ref A Lua ref to a function or string
  * (the name of an animation), or an empty ref.
  */
-void Sprite::set_finished_callback(const ScopedLuaRef& finished_callback_ref) {
+void Sprite::set_finished_callback(ScopedLuaRef finished_callback_ref) {
 
   if (!finished_callback_ref.is_empty()) {
     Debug::check_assertion(get_lua_context() != nullptr, "Undefined Lua context");
   }
 
-  this->finished_callback_ref = finished_callback_ref;
+  this->finished_callback_ref = std::move(finished_callback_ref);
 }
 
 /**
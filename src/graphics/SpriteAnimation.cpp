@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/SpriteAnimation.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
@@ -45,6 +46,7 @@ SpriteAnimation::SpriteAnimation(
   should_enable_pixel_collisions(false) {
 
   if (!src_image_is_tileset) {
+    MemoryStats::TextureOrigin origin(MemoryStats::Category::SPRITE_TEXTURES);
     src_image = Surface::create(image_file_name);
     if (src_image == nullptr) {
       Debug::error(std::string("Cannot load sprite image '" + image_file_name + "'"));
@@ -133,6 +135,46 @@ int SpriteAnimation::get_next_frame(
   return next_frame;
 }
 
+/**
+ * \brief Returns the frame shown after a number of frame delays.
+ *
+ * This gives the same result as calling get_next_frame() \c step times
+ * from the first frame, without iterating.
+ *
+ * \param current_direction A direction of this animation.
+ * \param step Number of frame delays elapsed since the first frame.
+ * \return The frame, or -1 if the animation does not loop and is finished.
+ */
+int SpriteAnimation::get_frame_at_step(
+    int current_direction, uint32_t step) const {
+
+  if (current_direction < 0
+      || current_direction >= get_nb_directions()) {
+    std::ostringstream oss;
+    oss << "Invalid sprite direction '" << current_direction
+        << "': this sprite has " << get_nb_directions()
+        << " direction(s)";
+    Debug::die(oss.str());
+  }
+
+  const uint32_t nb_frames = directions[current_direction].get_nb_frames();
+  if (step < nb_frames) {
+    return static_cast<int>(step);
+  }
+
+  if (loop_on_frame < 0) {
+    return -1;
+  }
+
+  if (static_cast<uint32_t>(loop_on_frame) >= nb_frames) {
+    // Invalid loop frame: stay on the last one.
+    return static_cast<int>(nb_frames) - 1;
+  }
+
+  const uint32_t loop_length = nb_frames - loop_on_frame;
+  return loop_on_frame + static_cast<int>((step - loop_on_frame) % loop_length);
+}
+
 /**
  * \brief Draws a specific frame of this animation on a surface.
  * \param dst_surface the surface on which the sprite will be drawn
@@ -185,7 +227,7 @@ void SpriteAnimation::do_enable_pixel_collisions() {
   }
 
   for (SpriteAnimationDirection& direction: directions) {
-    direction.enable_pixel_collisions(*src_image);
+    direction.enable_pixel_collisions(src_image);
   }
 }
 
@@ -220,5 +262,21 @@ bool SpriteAnimation::are_pixel_collisions_enabled() const {
   return directions[0].are_pixel_collisions_enabled();
 }
 
+/**
+ * \brief Returns the estimated memory used by the image of this animation.
+ *
+ * An image that comes from the tileset is not counted
+ * since the tileset owns it.
+ *
+ * \return The memory size in bytes.
+ */
+size_t SpriteAnimation::get_memory_size() const {
+
+  if (src_image == nullptr || src_image_is_tileset) {
+    return 0;
+  }
+  return static_cast<size_t>(src_image->get_width()) * src_image->get_height() * 4;
+}
+
 }
 
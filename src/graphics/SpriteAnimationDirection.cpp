@@ -32,7 +32,9 @@ SpriteAnimationDirection::SpriteAnimationDirection(
     const std::vector<Rectangle>& frames,
     const Point& origin):
   frames(frames),
-  origin(origin) {
+  origin(origin),
+  pixel_bits_image(nullptr),
+  pixel_bits() {
 
   Debug::check_assertion(!frames.empty(), "Empty sprite direction");
 }
@@ -93,21 +95,22 @@ void SpriteAnimationDirection::draw(Surface& dst_surface,
 }
 
 /**
- * \brief Calculates the bit fields representing the non-transparent pixels
- * of the images in this direction.
+ * \brief Enables the pixel-perfect collisions of the images in this direction.
  *
  * This method has to be called if you want a sprite having this animations
  * to be able to detect pixel-perfect collisions.
+ * The bit fields representing the non-transparent pixels of a frame
+ * are only calculated when the frame is tested for the first time,
+ * from the pixels kept in memory by the image.
  * If the pixel-perfect collisions are already enabled, this function does nothing.
  *
  * \param src_image the surface containing the animations
  */
-void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
+void SpriteAnimationDirection::enable_pixel_collisions(const SurfacePtr& src_image) {
 
   if (!are_pixel_collisions_enabled()) {
-    for (int i = 0; i < get_nb_frames(); i++) {
-      pixel_bits.emplace_back(src_image, frames[i]);
-    }
+    pixel_bits_image = src_image;
+    pixel_bits.assign(get_nb_frames(), nullptr);
   }
 }
 
@@ -115,6 +118,7 @@ void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
  * \brief Disables the pixel-perfect collision ability of this sprite animation direction.
  */
 void SpriteAnimationDirection::disable_pixel_collisions() {
+  pixel_bits_image = nullptr;
   pixel_bits.clear();
 }
 
@@ -123,7 +127,18 @@ void SpriteAnimationDirection::disable_pixel_collisions() {
  * \return true if the pixel-perfect collisions are enabled
  */
 bool SpriteAnimationDirection::are_pixel_collisions_enabled() const {
-  return !pixel_bits.empty();
+  return pixel_bits_image != nullptr;
+}
+
+/**
+ * \brief Calculates the bit fields of a frame not tested yet.
+ * \param frame A frame of the animation.
+ * \return The pixel bits object of this frame.
+ */
+const PixelBits& SpriteAnimationDirection::compute_pixel_bits(int frame) const {
+
+  pixel_bits[frame] = std::make_shared<PixelBits>(*pixel_bits_image, frames[frame]);
+  return *pixel_bits[frame];
 }
 
 }
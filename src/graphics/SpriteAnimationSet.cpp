@@ -34,11 +34,24 @@ namespace Solarus {
  * (name of a sprite definition file, without the ".dat" extension).
  */
 SpriteAnimationSet::SpriteAnimationSet(const std::string& id):
-  id(id) {
+  id(id),
+  obsolete(false) {
 
   load();
 }
 
+/**
+ * \brief Creates the animations of a sprite from data already parsed.
+ * \param id Id of the sprite animation set.
+ * \param data The sprite data.
+ */
+SpriteAnimationSet::SpriteAnimationSet(const std::string& id, const SpriteData& data):
+  id(id),
+  obsolete(false) {
+
+  load(data);
+}
+
 /**
  * \brief Attempts to load this animation set from its file.
  */
@@ -52,11 +65,22 @@ void SpriteAnimationSet::load() {
   SpriteData data;
   bool success = data.import_from_quest_file(file_name);
   if (success) {
-    // Get the imported data.
-    default_animation_name = data.get_default_animation_name();
-    for (const auto& kvp : data.get_animations()) {
-      add_animation(kvp.first, kvp.second);
-    }
+    load(data);
+  }
+}
+
+/**
+ * \brief Creates the animations from data already parsed.
+ * \param data The sprite data.
+ */
+void SpriteAnimationSet::load(const SpriteData& data) {
+
+  Debug::check_assertion(animations.empty(),
+      "Animation set already loaded");
+
+  default_animation_name = data.get_default_animation_name();
+  for (const auto& kvp : data.get_animations()) {
+    add_animation(kvp.first, kvp.second);
   }
 }
 
@@ -126,10 +150,9 @@ bool SpriteAnimationSet::has_animation(
 const SpriteAnimation& SpriteAnimationSet::get_animation(
     const std::string& animation_name) const {
 
-  Debug::check_assertion(has_animation(animation_name),
-      std::string("No animation '") + animation_name
-      + "' in animation set '" + id + "'"
-  );
+  Debug::check_assertion_lazy(has_animation(animation_name), [&] {
+    return std::string("No animation '") + animation_name + "' in animation set '" + id + "'";
+  });
 
   return animations.find(animation_name)->second;
 }
@@ -142,10 +165,9 @@ const SpriteAnimation& SpriteAnimationSet::get_animation(
 SpriteAnimation& SpriteAnimationSet::get_animation(
     const std::string& animation_name) {
 
-  Debug::check_assertion(has_animation(animation_name),
-      std::string("No animation '") + animation_name
-      + "' in animation set '" + id + "'"
-  );
+  Debug::check_assertion_lazy(has_animation(animation_name), [&] {
+    return std::string("No animation '") + animation_name + "' in animation set '" + id + "'";
+  });
 
   return animations.find(animation_name)->second;
 }
@@ -205,5 +227,36 @@ const Rectangle& SpriteAnimationSet::get_max_bounding_box() const {
   return max_bounding_box;
 }
 
+/**
+ * \brief Returns the estimated memory used by the images of this animation set.
+ * \return The memory size in bytes.
+ */
+size_t SpriteAnimationSet::get_memory_size() const {
+
+  size_t memory_size = 0;
+  for (const auto& kvp: animations) {
+    memory_size += kvp.second.get_memory_size();
+  }
+  return memory_size;
+}
+
+/**
+ * \brief Returns whether this animation set was replaced by a newer version.
+ * \return \c true if sprites should load the animation set again.
+ */
+bool SpriteAnimationSet::is_obsolete() const {
+  return obsolete;
+}
+
+/**
+ * \brief Marks this animation set as replaced by a newer version.
+ *
+ * Call this function when its data file or its images have changed.
+ * Sprites using it load the new version at their next update.
+ */
+void SpriteAnimationSet::set_obsolete() {
+  obsolete = true;
+}
+
 }
 
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/ShaderContext.h"
+#include "solarus/graphics/SpriteBatch.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include "solarus/graphics/VertexArray.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/third_party/glm/gtc/matrix_transform.hpp"
+#include "solarus/third_party/glm/gtx/matrix_transform_2d.hpp"
+#include <algorithm>
+
+namespace Solarus {
+
+RenderTexture* SpriteBatch::dst_texture = nullptr;
+SDL_BlendMode SpriteBatch::blend_mode = SDL_BLENDMODE_NONE;
+std::vector<SpriteBatch::Batch> SpriteBatch::batches;
+size_t SpriteBatch::num_batches = 0;
+bool SpriteBatch::flushing = false;
+ShaderPtr SpriteBatch::shader = nullptr;
+int SpriteBatch::num_draw_calls = 0;
+int SpriteBatch::num_texture_binds = 0;
+
+namespace {
+
+VertexArray vertices(TRIANGLES);  /**< Vertices of the last OpenGL flush. */
+
+}
+
+/**
+ * \brief Drops the queue and the built-in shader.
+ *
+ * This function must be called before the OpenGL context is destroyed.
+ */
+void SpriteBatch::quit() {
+
+  batches.clear();
+  num_batches = 0;
+  dst_texture = nullptr;
+  shader = nullptr;
+}
+
+/**
+ * \brief Queues the draw of a texture region onto a render texture.
+ *
+ * Queued draws are flushed first if they have another destination or
+ * blend mode.
+ *
+ * \param dst_texture The render texture to draw on.
+ * \param src_texture The surface to draw.
+ * \param src_rect Region to draw in the coordinates of the source SDL texture.
+ * \param dst_rect Where to draw on the destination.
+ * \param blend_mode SDL blend mode to use.
+ * \param opacity Opacity of the draw.
+ * \param transform Rotation, scale and color modulation of the draw.
+ */
+void SpriteBatch::add(
+    RenderTexture& dst_texture,
+    const SurfaceImpl& src_texture,
+    const Rectangle& src_rect,
+    const Rectangle& dst_rect,
+    SDL_BlendMode blend_mode,
+    uint8_t opacity,
+    const DrawTransform& transform) {
+
+  if (&dst_texture != SpriteBatch::dst_texture ||
+      blend_mode != SpriteBatch::blend_mode) {
+    flush();
+    SpriteBatch::dst_texture = &dst_texture;
+    SpriteBatch::blend_mode = blend_mode;
+  }
+
+  // Look for a batch of this texture that can be drawn this quad too:
+  // batches queued after it must not be below the quad.
+  const Rectangle bounding_box = transform.get_bounding_box(dst_rect);
+  SDL_Texture* texture = src_texture.get_texture();
+  Batch* batch = nullptr;
+  for (size_t i = num_batches; i > 0; --i) {
+    Batch& candidate = batches[i - 1];
+    if (candidate.src_texture == texture) {
+      batch = &candidate;
+      break;
+    }
+    if (candidate.bounding_box.overlaps(bounding_box)) {
+      break;
+    }
+  }
+
+  if (batch == nullptr) {
+    if (num_batches == max_batches) {
+      flush_batches(1);
+    }
+    if (num_batches == batches.size()) {
+      batches.emplace_back();
+    }
+    batch = &batches[num_batches];
+    ++num_batches;
+    batch->src_texture = texture;
+    batch->src_texture_size = src_texture.get_texture_size();
+    batch->bounding_box = bounding_box;
+  }
+  else {
+    batch->bounding_box |= bounding_box;
+  }
+
+  batch->quads.push_back(Quad{ src_rect, dst_rect, opacity, transform });
+}
+
+/**
+ * \brief Performs all queued draws.
+ */
+void SpriteBatch::flush() {
+  flush_batches(num_batches);
+}
+
+/**
+ * \brief Performs the draws of the oldest queued batches.
+ * \param count Number of batches to draw.
+ */
+void SpriteBatch::flush_batches(size_t count) {
+
+  // Drawing binds the destination, which flushes again: nothing to do then.
+  if (count == 0 || flushing) {
+    return;
+  }
+
+  flushing = true;
+  for (size_t i = 0; i < count; ++i) {
+    render_batch(batches[i]);
+  }
+  flushing = false;
+
+  // Keep the allocated storage for next draws.
+  for (size_t i = 0; i < count; ++i) {
+    batches[i].quads.clear();
+  }
+  std::rotate(batches.begin(), batches.begin() + count, batches.begin() + num_batches);
+  num_batches -= count;
+  if (num_batches == 0) {
+    dst_texture = nullptr;
+  }
+}
+
+/**
+ * \brief Does the draws of a batch on the queued destination.
+ * \param batch The batch to draw.
+ */
+void SpriteBatch::render_batch(const Batch& batch) {
+
+  if (shader == nullptr && Video::are_shaders_enabled()) {
+    shader = ShaderContext::create_shader("");
+  }
+
+  // Each batch binds its source texture once.
+  ++num_texture_binds;
+
+  // Only the covered pixels will need to be read back.
+  dst_texture->with_target(batch.bounding_box, [&](SDL_Renderer* renderer) {
+
+    if (shader == nullptr) {
+      SOLARUS_CHECK_SDL_HIGHER(SDL_SetTextureBlendMode(batch.src_texture, blend_mode), -1);
+      render_sdl(renderer, batch.src_texture, batch.quads);
+      return;
+    }
+
+    SDL_BlendMode current;
+    SDL_GetRenderDrawBlendMode(renderer, &current);
+    if (blend_mode != current) {
+      SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+      SDL_RenderDrawPoint(renderer, -100, -100);  // Draw a point offscreen to force the blend mode change.
+    }
+    const Size dst_size(dst_texture->get_width(), dst_texture->get_height());
+    render_gl(dst_size, batch.src_texture, batch.src_texture_size, batch.quads);
+  });
+}
+
+/**
+ * \brief Flushes queued draws that use a texture about to be destroyed.
+ * \param texture An SDL texture.
+ */
+void SpriteBatch::notify_texture_destroyed(const SDL_Texture* texture) {
+
+  if (num_batches == 0) {
+    return;
+  }
+
+  bool used = dst_texture != nullptr && texture == dst_texture->get_texture();
+  for (size_t i = 0; i < num_batches && !used; ++i) {
+    used = texture == batches[i].src_texture;
+  }
+  if (used) {
+    flush();
+  }
+}
+
+/**
+ * \brief Draws quads with SDL, on the current render target.
+ * \param renderer The SDL renderer.
+ * \param texture The texture to draw.
+ * \param quads Regions to draw.
+ */
+void SpriteBatch::render_sdl(
+    SDL_Renderer* renderer,
+    SDL_Texture* texture,
+    const std::vector<Quad>& quads) {
+
+  int current_opacity = -1;
+  bool color_modulated = false;
+  for (const Quad& quad: quads) {
+    if (quad.opacity != current_opacity) {
+      SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(texture, quad.opacity));
+      current_opacity = quad.opacity;
+    }
+    if (quad.transform.is_color_modulated() || color_modulated) {
+      uint8_t r, g, b, a;
+      quad.transform.color.get_components(r, g, b, a);
+      SOLARUS_CHECK_SDL(SDL_SetTextureColorMod(texture, r, g, b));
+      color_modulated = quad.transform.is_color_modulated();
+    }
+    if (quad.transform.is_geometric()) {
+      render_sdl_transformed(renderer, texture, quad);
+    }
+    else {
+      SOLARUS_CHECK_SDL(SDL_RenderCopy(renderer, texture, quad.src_rect, quad.dst_rect));
+    }
+  }
+  if (color_modulated) {
+    SOLARUS_CHECK_SDL(SDL_SetTextureColorMod(texture, 255, 255, 255));
+  }
+  num_draw_calls += static_cast<int>(quads.size());
+}
+
+/**
+ * \brief Draws a rotated or scaled quad with SDL, on the current render target.
+ * \param renderer The SDL renderer.
+ * \param texture The texture to draw.
+ * \param quad The region to draw and its transform.
+ */
+void SpriteBatch::render_sdl_transformed(
+    SDL_Renderer* renderer,
+    SDL_Texture* texture,
+    const Quad& quad) {
+
+  const DrawTransform& transform = quad.transform;
+  const Rectangle dst_rect = transform.get_scaled_rectangle(quad.dst_rect);
+  if (dst_rect.is_flat()) {
+    return;
+  }
+
+  // SDL rotates clockwise around a point relative to the destination rectangle.
+  SDL_Point center = {
+      transform.pivot.x - dst_rect.get_x(),
+      transform.pivot.y - dst_rect.get_y()
+  };
+  int flip = SDL_FLIP_NONE;
+  if (transform.scale_x < 0.0) {
+    flip |= SDL_FLIP_HORIZONTAL;
+  }
+  if (transform.scale_y < 0.0) {
+    flip |= SDL_FLIP_VERTICAL;
+  }
+  const double angle = -transform.rotation * 180.0 / 3.14159265358979323846;
+  SOLARUS_CHECK_SDL(SDL_RenderCopyEx(
+      renderer,
+      texture,
+      quad.src_rect,
+      dst_rect,
+      angle,
+      &center,
+      static_cast<SDL_RendererFlip>(flip)
+  ));
+}
+
+/**
+ * \brief Draws quads with the OpenGL built-in shader in one call,
+ * on the current render target.
+ * \param dst_size Size of the render target.
+ * \param texture The texture to draw.
+ * \param texture_size Size of the texture.
+ * \param quads Regions to draw.
+ */
+void SpriteBatch::render_gl(
+    const Size& dst_size,
+    SDL_Texture* texture,
+    const Size& texture_size,
+    const std::vector<Quad>& quads) {
+
+  vertices.clear();
+  for (const Quad& quad: quads) {
+    Color color = quad.transform.color;
+    color.set_alpha(quad.opacity);
+    VerticeView view = vertices.add_quad(quad.dst_rect, quad.src_rect, color);
+    if (quad.transform.is_geometric()) {
+      // Transform the corners: the quad stays in the same draw call.
+      for (size_t i = 0; i < view.get_size(); ++i) {
+        Vertex& vertex = view.at(i);
+        double x = vertex.position.x;
+        double y = vertex.position.y;
+        quad.transform.apply(x, y);
+        vertex.position = glm::vec2(x, y);
+      }
+    }
+  }
+
+  // Positions are in destination pixels and texture coordinates in source pixels.
+  const glm::mat4 mvp_matrix = glm::ortho<float>(0, dst_size.width, 0, dst_size.height);
+  const glm::mat3 uv_matrix = glm::scale(
+        glm::mat3(1),
+        glm::vec2(1.f / texture_size.width, 1.f / texture_size.height)
+  );
+  shader->render(vertices, texture, mvp_matrix, uv_matrix);
+  ++num_draw_calls;
+}
+
+/**
+ * \brief Returns the number of draw calls done since the previous call
+ * and resets it.
+ *
+ * With SDL, each quad is a draw call. With OpenGL, each flush is one.
+ *
+ * \return The number of draw calls.
+ */
+int SpriteBatch::take_num_draw_calls() {
+
+  const int result = num_draw_calls;
+  num_draw_calls = 0;
+  return result;
+}
+
+/**
+ * \brief Returns the number of source textures bound since the previous call
+ * and resets it.
+ *
+ * This is one per batch drawn, so fewer binds mean better batching.
+ *
+ * \return The number of texture binds.
+ */
+int SpriteBatch::take_num_texture_binds() {
+
+  const int result = num_texture_binds;
+  num_texture_binds = 0;
+  return result;
+}
+
+}
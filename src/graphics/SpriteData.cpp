@@ -14,6 +14,8 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
 #include "solarus/graphics/SpriteData.h"
 #include "solarus/lua/LuaTools.h"
@@ -454,8 +456,9 @@ const SpriteAnimationData& SpriteData::get_animation(
     const std::string& animation_name) const {
 
   const auto& it = animations.find(animation_name);
-  Debug::check_assertion(it != animations.end(),
-    std::string("No such animation: '") + animation_name + "'");
+  Debug::check_assertion_lazy(it != animations.end(), [&] {
+    return std::string("No such animation: '") + animation_name + "'";
+  });
 
   return it->second;
 }
@@ -473,8 +476,9 @@ SpriteAnimationData& SpriteData::get_animation(
     const std::string& animation_name) {
 
   const auto& it = animations.find(animation_name);
-  Debug::check_assertion(it != animations.end(),
-    std::string("No such animation: '") + animation_name + "'");
+  Debug::check_assertion_lazy(it != animations.end(), [&] {
+    return std::string("No such animation: '") + animation_name + "'";
+  });
 
   return it->second;
 }
@@ -704,6 +708,99 @@ bool SpriteData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::get_binary_magic
+ */
+std::string SpriteData::get_binary_magic() const {
+  return { 'S', 'O', 'L', 'S', 'P', 'R', '\r', '\n' };
+}
+
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool SpriteData::import_from_binary(BinaryReader& reader) {
+
+  SpriteData sprite;
+  const std::string& default_animation_name = reader.read_string();
+  const uint32_t num_animations = reader.read_uint32();
+  if (!reader.can_read(num_animations, 20)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_animations; ++i) {
+    const std::string& animation_name = reader.read_string();
+    const std::string& src_image = reader.read_string();
+    const uint32_t frame_delay = reader.read_uint32();
+    const int frame_to_loop_on = reader.read_int32();
+    const uint32_t num_directions = reader.read_uint32();
+    if (!reader.can_read(num_directions, 32) || frame_to_loop_on < -1) {
+      return false;
+    }
+
+    std::deque<SpriteAnimationDirectionData> directions;
+    for (uint32_t j = 0; j < num_directions; ++j) {
+      const int x = reader.read_int32();
+      const int y = reader.read_int32();
+      const int frame_width = reader.read_int32();
+      const int frame_height = reader.read_int32();
+      const int origin_x = reader.read_int32();
+      const int origin_y = reader.read_int32();
+      const int num_frames = reader.read_int32();
+      const int num_columns = reader.read_int32();
+      if (num_columns < 1 ||
+          num_columns > num_frames ||
+          frame_to_loop_on >= num_frames) {
+        return false;
+      }
+      directions.emplace_back(
+            Point(x, y), Size(frame_width, frame_height),
+            Point(origin_x, origin_y), num_frames, num_columns);
+    }
+
+    if (!sprite.animations.emplace(animation_name,
+        SpriteAnimationData(src_image, directions, frame_delay, frame_to_loop_on)).second) {
+      // Duplicate animation.
+      return false;
+    }
+  }
+
+  if (!reader.is_valid() ||
+      (!sprite.animations.empty() && !sprite.has_animation(default_animation_name))) {
+    return false;
+  }
+  sprite.default_animation_name = default_animation_name;
+
+  *this = std::move(sprite);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool SpriteData::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_string(default_animation_name);
+  writer.write_uint32(static_cast<uint32_t>(animations.size()));
+  for (const auto& kvp : animations) {
+    const SpriteAnimationData& animation = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(animation.get_src_image());
+    writer.write_uint32(animation.get_frame_delay());
+    writer.write_int32(animation.get_loop_on_frame());
+    writer.write_uint32(static_cast<uint32_t>(animation.get_num_directions()));
+    for (const SpriteAnimationDirectionData& direction : animation.get_directions()) {
+      writer.write_int32(direction.get_xy().x);
+      writer.write_int32(direction.get_xy().y);
+      writer.write_int32(direction.get_size().width);
+      writer.write_int32(direction.get_size().height);
+      writer.write_int32(direction.get_origin().x);
+      writer.write_int32(direction.get_origin().y);
+      writer.write_int32(direction.get_num_frames());
+      writer.write_int32(direction.get_num_columns());
+    }
+  }
+  return true;
+}
+
 /**
  * \brief Saves an animation data as Lua into a stream.
  * \param animation_name The name of animation to save.
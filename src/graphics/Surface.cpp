@@ -14,12 +14,17 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Rectangle.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Size.h"
+#include "solarus/core/Trace.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/graphics/Video.h"
@@ -29,6 +34,7 @@
 #include "solarus/graphics/Shader.h"
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 
@@ -37,6 +43,122 @@
 
 namespace Solarus {
 
+namespace {
+
+std::vector<std::weak_ptr<Surface>> loading_surfaces;  /**< Surfaces created by create_async()
+                                                        * whose image may still be decoded. */
+
+/**
+ * \brief Returns a pixel of a 32-bit format with alpha.
+ * \param format The pixel format.
+ * \param r Red component.
+ * \param g Green component.
+ * \param b Blue component.
+ * \param a Alpha component.
+ * \return The pixel value.
+ */
+uint32_t map_rgba(const SDL_PixelFormat& format, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+
+  return (uint32_t(r) << format.Rshift) |
+      (uint32_t(g) << format.Gshift) |
+      (uint32_t(b) << format.Bshift) |
+      (uint32_t(a) << format.Ashift);
+}
+
+/**
+ * \brief Converts a decoded image of a usual format to a 32-bit format
+ * with alpha in a single pass.
+ *
+ * Palette images (with or without a transparent index) go through a
+ * lookup table of 256 pixels, and 24-bit images are expanded with a simple
+ * loop that compilers vectorize.
+ * This is much faster than the generic converters of SDL_ConvertSurface(),
+ * and gives the same pixels.
+ *
+ * \param surface The decoded image.
+ * \param format The wanted pixel format.
+ * \return The converted surface, or nullptr if the format of the image is
+ * not handled here.
+ */
+SDL_Surface* convert_usual_format(SDL_Surface& surface, const SDL_PixelFormat& format) {
+
+  if (format.BytesPerPixel != 4 ||
+      format.Amask == 0 ||
+      SDL_MUSTLOCK(&surface)) {
+    return nullptr;
+  }
+
+  const uint32_t source_format = surface.format->format;
+  uint32_t color_key = 0;
+  const bool has_color_key = SDL_GetColorKey(&surface, &color_key) == 0;
+  const bool palette = source_format == SDL_PIXELFORMAT_INDEX8 &&
+      surface.format->palette != nullptr;
+  const bool rgb = (source_format == SDL_PIXELFORMAT_RGB24 ||
+      source_format == SDL_PIXELFORMAT_BGR24) &&
+      !has_color_key;
+  if (!palette && !rgb) {
+    return nullptr;
+  }
+
+  SDL_Surface* converted_surface = SDL_CreateRGBSurface(
+      0,
+      surface.w,
+      surface.h,
+      32,
+      format.Rmask,
+      format.Gmask,
+      format.Bmask,
+      format.Amask
+  );
+  if (converted_surface == nullptr) {
+    return nullptr;
+  }
+
+  const uint8_t* source_pixels = static_cast<const uint8_t*>(surface.pixels);
+  uint8_t* converted_pixels = static_cast<uint8_t*>(converted_surface->pixels);
+  if (palette) {
+    // Like SDL, indexes outside the palette are opaque black
+    // and the transparent index keeps its color with no alpha.
+    const SDL_Palette& colors = *surface.format->palette;
+    uint32_t table[256];
+    for (int i = 0; i < 256; ++i) {
+      table[i] = i < colors.ncolors ?
+          map_rgba(format, colors.colors[i].r, colors.colors[i].g, colors.colors[i].b, colors.colors[i].a) :
+          map_rgba(format, 0, 0, 0, 255);
+    }
+    if (has_color_key && color_key < 256) {
+      table[color_key] &= ~format.Amask;
+    }
+
+    for (int y = 0; y < surface.h; ++y) {
+      const uint8_t* source_row = source_pixels + y * surface.pitch;
+      uint32_t* converted_row = reinterpret_cast<uint32_t*>(converted_pixels + y * converted_surface->pitch);
+      for (int x = 0; x < surface.w; ++x) {
+        converted_row[x] = table[source_row[x]];
+      }
+    }
+  }
+  else {
+    // Bytes are in memory order in 24-bit formats.
+    const int r_index = source_format == SDL_PIXELFORMAT_RGB24 ? 0 : 2;
+    const int b_index = 2 - r_index;
+    for (int y = 0; y < surface.h; ++y) {
+      const uint8_t* source_row = source_pixels + y * surface.pitch;
+      uint32_t* converted_row = reinterpret_cast<uint32_t*>(converted_pixels + y * converted_surface->pitch);
+      for (int x = 0; x < surface.w; ++x) {
+        const uint8_t* source_pixel = source_row + 3 * x;
+        converted_row[x] = (uint32_t(source_pixel[r_index]) << format.Rshift) |
+            (uint32_t(source_pixel[1]) << format.Gshift) |
+            (uint32_t(source_pixel[b_index]) << format.Bshift) |
+            format.Amask;
+      }
+    }
+  }
+
+  return converted_surface;
+}
+
+}  // Anonymous namespace.
 
 Surface::SurfaceDraw Surface::draw_proxy;
 
@@ -57,7 +179,10 @@ void Surface::SurfaceDraw::draw(Surface& dst_surface, const Surface &src_surface
  */
 Surface::Surface(int width, int height, bool premultiplied):
   Drawable(),
-  internal_surface(nullptr)
+  internal_surface(nullptr),
+  loading_image(),
+  loading_image_key(),
+  loading_memory_category(MemoryStats::Category::OTHER_TEXTURES)
 {
 
   Debug::check_assertion(width > 0 && height > 0,
@@ -68,7 +193,10 @@ Surface::Surface(int width, int height, bool premultiplied):
 }
 
 Surface::Surface(SDL_Surface *surf, bool premultiplied)
-  : internal_surface(new Texture(surf))
+  : internal_surface(new Texture(surf)),
+    loading_image(),
+    loading_image_key(),
+    loading_memory_category(MemoryStats::Category::OTHER_TEXTURES)
 {
   internal_surface->set_premultiplied(premultiplied);
 }
@@ -84,7 +212,10 @@ Surface::Surface(SDL_Surface *surf, bool premultiplied)
  */
 Surface::Surface(SurfaceImpl* impl, bool premultiplied):
   Drawable(),
-  internal_surface(impl) //TODO refactor this...
+  internal_surface(impl), //TODO refactor this...
+  loading_image(),
+  loading_image_key(),
+  loading_memory_category(MemoryStats::Category::OTHER_TEXTURES)
 {
   internal_surface->set_premultiplied(premultiplied);
 }
@@ -143,6 +274,165 @@ SurfacePtr Surface::create(const std::string& file_name,
   return std::make_shared<Surface>(surface, premultiplied);
 }
 
+/**
+ * \brief Creates a surface from an image file decoded in the background.
+ *
+ * The surface is returned immediately as a transparent 1x1 placeholder.
+ * It gets the pixels and the size of the image at the first cycle after
+ * the decoding is finished, or when finish_loading() is called.
+ * If the image was already decoded before, the surface is loaded
+ * immediately.
+ *
+ * \param file_name Name of the image file to load, relative to the base directory specified.
+ * \param base_directory The base directory to use.
+ * \param premultiplied \c true if the image has premultiplied alpha.
+ * \return The surface created, or nullptr if the file does not exist.
+ */
+SurfacePtr Surface::create_async(const std::string& file_name,
+                                 ImageDirectory base_directory, bool premultiplied) {
+
+  const bool language_specific = base_directory == DIR_LANGUAGE;
+  const std::string& prefixed_file_name = get_prefixed_file_name(file_name, base_directory);
+  if (!QuestFiles::data_file_exists(prefixed_file_name, language_specific)) {
+    return nullptr;
+  }
+
+  const std::string& image_key = get_image_key(prefixed_file_name, language_specific);
+  ResourceProvider* resource_provider = ResourceProvider::get_instance();
+  if (resource_provider != nullptr && resource_provider->get_image(image_key) != nullptr) {
+    // Only a copy is needed.
+    return create(file_name, base_directory, premultiplied);
+  }
+
+  SurfacePtr surface = create(1, 1, premultiplied);
+  surface->loading_image_key = image_key;
+  surface->loading_memory_category = MemoryStats::get_texture_category();
+  surface->loading_image = std::async(std::launch::async, [prefixed_file_name, language_specific]() {
+    return std::shared_ptr<SDL_Surface>(
+        decode_image(prefixed_file_name, language_specific),
+        SDL_FreeSurface
+    );
+  });
+  loading_surfaces.push_back(surface);
+  return surface;
+}
+
+/**
+ * \brief Gives their image to surfaces whose background decoding is finished.
+ *
+ * This function is called at each cycle by the main loop.
+ */
+void Surface::update_async_loads() {
+
+  for (auto it = loading_surfaces.begin(); it != loading_surfaces.end();) {
+    SurfacePtr surface = it->lock();
+    if (surface == nullptr || !surface->is_loading()) {
+      it = loading_surfaces.erase(it);
+    }
+    else if (surface->loading_image.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      surface->finish_loading();
+      it = loading_surfaces.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * \brief Waits for all background decodings in progress.
+ *
+ * This function must be called before closing the quest files.
+ */
+void Surface::finish_async_loads() {
+
+  for (const std::weak_ptr<Surface>& weak_surface: loading_surfaces) {
+    SurfacePtr surface = weak_surface.lock();
+    if (surface != nullptr) {
+      surface->finish_loading();
+    }
+  }
+  loading_surfaces.clear();
+}
+
+/**
+ * \brief Returns whether the image of this surface is still being decoded.
+ * \return \c true if this surface was created by create_async() and is
+ * not loaded yet.
+ */
+bool Surface::is_loading() const {
+  return loading_image.valid();
+}
+
+/**
+ * \brief Gives its image to this surface, waiting for the decoding if needed.
+ *
+ * Does nothing if this surface is not loading.
+ * If the image cannot be decoded, the surface stays a transparent 1x1 surface.
+ */
+void Surface::finish_loading() {
+
+  if (!is_loading()) {
+    return;
+  }
+
+  std::shared_ptr<SDL_Surface> image = loading_image.get();
+  if (image == nullptr) {
+    Logger::error(std::string("Cannot load image '") + loading_image_key + "'");
+    return;
+  }
+
+  ResourceProvider* resource_provider = ResourceProvider::get_instance();
+  if (resource_provider != nullptr) {
+    resource_provider->add_image(loading_image_key, image);
+  }
+
+  const bool premultiplied = internal_surface->is_premultiplied();
+  MemoryStats::TextureOrigin origin(loading_memory_category);
+  Texture* texture = new Texture(copy_sdl_surface(*image), true);
+  if (loading_image_key.compare(0, 10, "languages/") != 0) {
+    // Images of the language directory depend on the current language.
+    texture->set_source_image(loading_image_key);
+  }
+  internal_surface.reset(texture);
+  internal_surface->set_premultiplied(premultiplied);
+}
+
+/**
+ * \brief Returns the name of an image file relative to the data directory.
+ * \param file_name Name of the image file, relative to the base directory.
+ * \param base_directory The base directory to use.
+ * \return The file name with the prefix of the base directory.
+ */
+std::string Surface::get_prefixed_file_name(
+    const std::string& file_name,
+    ImageDirectory base_directory) {
+
+  if (base_directory == DIR_SPRITES) {
+    return std::string("sprites/") + file_name;
+  }
+  if (base_directory == DIR_LANGUAGE) {
+    return std::string("images/") + file_name;
+  }
+  return file_name;
+}
+
+/**
+ * \brief Returns the key of an image in the cache of the resource provider.
+ * \param prefixed_file_name Name of the image file with its base directory.
+ * \param language_specific \c true if the file is in the language directory.
+ * \return The key, qualified by the current language if needed.
+ */
+std::string Surface::get_image_key(
+    const std::string& prefixed_file_name,
+    bool language_specific) {
+
+  if (!language_specific) {
+    return prefixed_file_name;
+  }
+  return std::string("languages/") + CurrentQuest::get_language() + "/" + prefixed_file_name;
+}
+
 /**
  * \brief Creates an SDL surface corresponding to the requested file.
  *
@@ -156,51 +446,115 @@ SurfaceImpl *Surface::get_surface_from_file(
     const std::string& file_name,
     ImageDirectory base_directory) {
 
-  std::string prefix;
-  bool language_specific = false;
-
-  if (base_directory == DIR_SPRITES) {
-    prefix = "sprites/";
-  }
-  else if (base_directory == DIR_LANGUAGE) {
-    language_specific = true;
-    prefix = "images/";
-  }
-  std::string prefixed_file_name = prefix + file_name;
+  const bool language_specific = base_directory == DIR_LANGUAGE;
+  const std::string& prefixed_file_name = get_prefixed_file_name(file_name, base_directory);
 
   if (!QuestFiles::data_file_exists(prefixed_file_name, language_specific)) {
     // File not found.
     return nullptr;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(prefixed_file_name, language_specific);
-  SDL_RWops* rw = SDL_RWFromMem(const_cast<char*>(buffer.data()), (int) buffer.size());
+  // Decoded images are shared through the resource provider.
+  ResourceProvider* resource_provider = ResourceProvider::get_instance();
+  const std::string& image_key = get_image_key(prefixed_file_name, language_specific);
+  if (resource_provider != nullptr) {
+    std::shared_ptr<SDL_Surface> cached_surface = resource_provider->get_image(image_key);
+    if (cached_surface != nullptr) {
+      Texture* texture = new Texture(copy_sdl_surface(*cached_surface), true);
+      if (!language_specific) {
+        texture->set_source_image(image_key);
+      }
+      return texture;
+    }
+  }
+
+  SDL_Surface* surface = decode_image(prefixed_file_name, language_specific);
+  Debug::check_assertion_lazy(surface != nullptr, [&] {
+    return std::string("Cannot load image '") + prefixed_file_name + "': " + SDL_GetError();
+  });
+
+  if (resource_provider != nullptr) {
+    resource_provider->add_image(
+          image_key,
+          std::shared_ptr<SDL_Surface>(copy_sdl_surface(*surface), SDL_FreeSurface)
+    );
+  }
 
-  SDL_Surface* surface = IMG_Load_RW(rw, 0);
+  Texture* texture = new Texture(surface, true);
+  if (!language_specific) {
+    texture->set_source_image(image_key);
+  }
+  return texture;
+}
+
+/**
+ * \brief Decodes an image file of the data package to the RGBA format.
+ *
+ * Unlike other surface functions, this one does not need the main thread:
+ * it only reads the file and creates a software surface.
+ * It does not stop with an error so that it can run on worker threads.
+ *
+ * The returned SDL surface has to be manually deleted.
+ *
+ * \param prefixed_file_name Name of the image file, relative to the data
+ * directory or to the language directory.
+ * \param language_specific \c true if the file is relative to the language
+ * directory.
+ * \return The decoded surface, or nullptr if the file does not exist or
+ * cannot be decoded.
+ */
+SDL_Surface* Surface::decode_image(
+    const std::string& prefixed_file_name, bool language_specific) {
 
-  SDL_RWclose(rw);
+  if (!QuestFiles::data_file_exists(prefixed_file_name, language_specific)) {
+    return nullptr;
+  }
 
-  Debug::check_assertion(surface != nullptr,
-                         std::string("Cannot load image '") + prefixed_file_name + "'");
+  SOLARUS_TRACE_SCOPE_DETAIL("Surface::load_image", prefixed_file_name);
+  SDL_RWops* rw = QuestFiles::data_file_open_rw(prefixed_file_name, language_specific);
+
+  SDL_Surface* surface = IMG_Load_RW(rw, 1);
+  if (surface == nullptr) {
+    return nullptr;
+  }
 
   SDL_PixelFormat* pixel_format = Video::get_rgba_format();
-  if (surface->format->format == pixel_format->format) {
-    return new Texture(surface);
+  if (surface->format->format != pixel_format->format) {
+    // Convert to the preferred pixel format.
+    SDL_Surface* converted_surface = convert_usual_format(*surface, *pixel_format);
+    if (converted_surface == nullptr) {
+      converted_surface = SDL_ConvertSurface(
+          surface,
+          pixel_format,
+          0
+          );
+    }
+    SDL_FreeSurface(surface);
+    surface = converted_surface;
   }
 
-  // Convert to the preferred pixel format.
-  uint8_t opacity;
-  SDL_GetSurfaceAlphaMod(surface, &opacity);
-  SDL_Surface* converted_surface = SDL_ConvertSurface(
-        surface,
-        pixel_format,
+  return surface;
+}
+
+/**
+ * \brief Creates a copy of an SDL surface with the same pixel format.
+ *
+ * The returned SDL surface has to be manually deleted.
+ *
+ * \param surface The surface to copy.
+ * \return The copy.
+ */
+SDL_Surface* Surface::copy_sdl_surface(const SDL_Surface& surface) {
+
+  SDL_Surface* copy = SDL_ConvertSurface(
+        const_cast<SDL_Surface*>(&surface),
+        surface.format,
         0
         );
-  Debug::check_assertion(converted_surface != nullptr,
-                         std::string("Failed to convert software surface: ") + SDL_GetError());
-  SDL_FreeSurface(surface);
-
-  return new Texture(converted_surface);
+  Debug::check_assertion_lazy(copy != nullptr, [&] {
+    return std::string("Failed to copy software surface: ") + SDL_GetError();
+  });
+  return copy;
 }
 
 /**
@@ -267,8 +621,9 @@ std::string Surface::get_pixels() const {
                                             format,
                                             0
                                             ));
-  Debug::check_assertion(converted_surface != nullptr,
-                         std::string("Failed to convert pixels to RGBA format") + SDL_GetError());
+  Debug::check_assertion_lazy(converted_surface != nullptr, [&] {
+    return std::string("Failed to convert pixels to RGBA format") + SDL_GetError();
+  });
   const char* buffer = static_cast<const char*>(converted_surface->pixels);
   return std::string(buffer, num_pixels * converted_surface->format->BytesPerPixel);
 }
@@ -278,7 +633,11 @@ std::string Surface::get_pixels() const {
  * @param buffer a string considerer as array of bytes with pixels in RGBA
  */
 void Surface::set_pixels(const std::string& buffer) {
-  SDL_Surface* surface = internal_surface->get_surface();
+  // No need to read back the current pixels if they are all replaced.
+  const bool full = buffer.size() >= static_cast<size_t>(get_width() * get_height() * 4);
+  SDL_Surface* surface = full ?
+      internal_surface->get_surface_to_overwrite() :
+      internal_surface->get_surface();
   if (surface->format->format == SDL_PIXELFORMAT_ABGR8888) {
     // No conversion needed.
     char* pixels = static_cast<char*>(surface->pixels);
@@ -390,9 +749,13 @@ Rectangle Surface::get_region() const {
  * \param pixel_filter The pixel filter to apply.
  * \param dst_surface The destination surface. It must have the size of the
  * this surface multiplied by the scaling factor of the filter.
+ * \param thread_pool Threads to filter bands of the image in parallel,
+ * or nullptr to only use the current thread.
  */
 void Surface::apply_pixel_filter(
-    const SoftwarePixelFilter& pixel_filter, Surface& dst_surface) const {
+    const SoftwarePixelFilter& pixel_filter,
+    Surface& dst_surface,
+    ThreadPool* thread_pool) const {
 
   const int factor = pixel_filter.get_scaling_factor();
   Debug::check_assertion(dst_surface.get_width() == get_width() * factor,
@@ -401,7 +764,7 @@ void Surface::apply_pixel_filter(
       "Wrong destination surface size");
 
   SDL_Surface* src_internal_surface = this->internal_surface->get_surface();
-  SDL_Surface* dst_internal_surface = dst_surface.internal_surface->get_surface();
+  SDL_Surface* dst_internal_surface = dst_surface.internal_surface->get_surface_to_overwrite();
 
   if (src_internal_surface == nullptr) {
     // This is possible if nothing was drawn on the surface yet.
@@ -417,7 +780,12 @@ void Surface::apply_pixel_filter(
   uint32_t* src = static_cast<uint32_t*>(src_internal_surface->pixels);
   uint32_t* dst = static_cast<uint32_t*>(dst_internal_surface->pixels);
 
-  pixel_filter.filter(src, get_width(), get_height(), dst);
+  if (thread_pool != nullptr) {
+    pixel_filter.filter(src, get_width(), get_height(), dst, *thread_pool);
+  }
+  else {
+    pixel_filter.filter(src, get_width(), get_height(), dst);
+  }
 
   SDL_UnlockSurface(dst_internal_surface);
   SDL_UnlockSurface(src_internal_surface);
@@ -575,7 +943,9 @@ SDL_BlendMode Surface::make_sdl_blend_mode(const SurfaceImpl& dst_surface, const
  * \brief Renders this surface onto a hardware texture.
  */
 void Surface::render(SDL_Renderer*& renderer) {
-  SDL_RenderCopy(renderer,internal_surface->get_texture(),NULL,NULL);
+  SpriteBatch::flush();
+  Rectangle src_rect(internal_surface->get_texture_offset(),get_size());
+  SDL_RenderCopy(renderer,internal_surface->get_texture(),src_rect,NULL);
 }
 
 /**
@@ -1,15 +1,40 @@
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/SurfaceImpl.h"
 
 namespace Solarus {
 
+uint64_t SurfaceImpl::num_unique_signatures = 0;
+
 void SurfaceImpl::upload_surface() {
-  Rectangle rect(0,0,get_width(),get_height());
+  upload_surface(Rectangle(0,0,get_width(),get_height()));
+}
+
+/**
+ * \copydoc SurfaceImpl::upload_surface(const Rectangle&)
+ */
+void SurfaceImpl::upload_surface(const Rectangle& region) {
+  const Rectangle surface_region = region & Rectangle(0,0,get_width(),get_height());
+  if (surface_region.is_flat()) {
+    return;
+  }
+  SpriteBatch::flush();  // Queued draws may use the old pixels.
   SDL_Surface* surface = get_surface();
+  const uint8_t* pixels = static_cast<const uint8_t*>(surface->pixels) +
+      surface_region.get_y() * surface->pitch +
+      surface_region.get_x() * surface->format->BytesPerPixel;
   SDL_UpdateTexture(get_texture(),
-                    rect,
-                    surface->pixels,
+                    to_texture_region(surface_region),
+                    pixels,
                     surface->pitch
                     );
+  invalidate_content_signature();
+  notify_pixels_changed();
+}
+
+/**
+ * \copydoc SurfaceImpl::notify_pixels_changed
+ */
+void SurfaceImpl::notify_pixels_changed() {
 }
 
 
@@ -17,6 +42,38 @@ SurfaceImpl::~SurfaceImpl() {
 
 }
 
+/**
+ * \copydoc SurfaceImpl::get_surface_to_overwrite
+ */
+SDL_Surface* SurfaceImpl::get_surface_to_overwrite() const {
+  return get_surface();
+}
+
+/**
+ * \copydoc SurfaceImpl::get_texture_offset
+ */
+Point SurfaceImpl::get_texture_offset() const {
+  return Point();
+}
+
+/**
+ * \copydoc SurfaceImpl::get_texture_size
+ */
+Size SurfaceImpl::get_texture_size() const {
+  return Size(get_width(),get_height());
+}
+
+/**
+ * @brief convert a region of this surface to a region of its texture
+ * @param region region in surface coordinates, clipped to the surface
+ * @return the same pixels in get_texture() coordinates
+ */
+Rectangle SurfaceImpl::to_texture_region(const Rectangle& region) const {
+  Rectangle texture_region = region.get_intersection(Rectangle(0,0,get_width(),get_height()));
+  texture_region.add_xy(get_texture_offset());
+  return texture_region;
+}
+
 /**
  * @brief is_premultiplied
  * @return
@@ -31,4 +88,37 @@ bool SurfaceImpl::is_premultiplied() const {
 void SurfaceImpl::set_premultiplied(bool a_premultiplied) {
   premultiplied = a_premultiplied;
 }
+
+/**
+ * \copydoc SurfaceImpl::get_content_signature
+ */
+uint64_t SurfaceImpl::get_content_signature() const {
+  return content_signature;
+}
+
+/**
+ * \copydoc SurfaceImpl::invalidate_content_signature
+ */
+void SurfaceImpl::invalidate_content_signature() const {
+  content_signature = make_unique_signature();
+}
+
+/**
+ * @brief mix a value into a content signature
+ * @param signature the signature so far
+ * @param value value describing an operation on the pixels
+ * @return the new signature
+ */
+uint64_t SurfaceImpl::combine_signature(uint64_t signature, uint64_t value) {
+  return signature ^ (value + 0x9e3779b97f4a7c15ULL + (signature << 6) + (signature >> 2));
+}
+
+/**
+ * @brief create a signature that is different from all previous ones
+ * @return the new signature
+ */
+uint64_t SurfaceImpl::make_unique_signature() {
+  ++num_unique_signatures;
+  return combine_signature(0x5bd1e9955bd1e995ULL,num_unique_signatures);
+}
 }
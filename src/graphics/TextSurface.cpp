@@ -16,10 +16,12 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/FontResource.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/core/System.h"
+#include "solarus/graphics/GlyphAtlas.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Shader.h"
 #include "solarus/graphics/TextSurface.h"
@@ -32,6 +34,93 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Decodes the next character of a UTF-8 string like SDL_ttf does.
+ * \param text A UTF-8 string.
+ * \param[in,out] i Index of the first byte of the character,
+ * then index of the next character.
+ * \return The UCS-2 character, or U+FFFD if it is invalid or not in the
+ * basic multilingual plane.
+ */
+uint16_t get_next_code_point(const std::string& text, size_t& i) {
+
+  static constexpr uint16_t replacement_character = 0xFFFD;
+
+  const unsigned char first_byte = static_cast<unsigned char>(text[i]);
+  ++i;
+  int num_continuation_bytes = 0;
+  uint32_t code_point = 0;
+  if (first_byte < 0x80) {
+    return first_byte;
+  }
+  else if ((first_byte & 0xE0) == 0xC0) {
+    num_continuation_bytes = 1;
+    code_point = first_byte & 0x1F;
+  }
+  else if ((first_byte & 0xF0) == 0xE0) {
+    num_continuation_bytes = 2;
+    code_point = first_byte & 0x0F;
+  }
+  else if ((first_byte & 0xF8) == 0xF0) {
+    num_continuation_bytes = 3;
+    code_point = first_byte & 0x07;
+  }
+  else {
+    return replacement_character;
+  }
+
+  for (int j = 0; j < num_continuation_bytes; ++j) {
+    if (i >= text.size() ||
+        (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+      return replacement_character;
+    }
+    code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+    ++i;
+  }
+
+  if (code_point > 0xFFFF) {
+    return replacement_character;
+  }
+  return static_cast<uint16_t>(code_point);
+}
+
+/**
+ * \brief Returns whether a UTF-8 string does not end in the middle of a
+ * character.
+ * \param text A UTF-8 string.
+ * \return \c true if its last character is complete.
+ */
+bool ends_with_complete_character(const std::string& text) {
+
+  // Go back to the first byte of the last character.
+  size_t num_continuation_bytes = 0;
+  size_t i = text.size();
+  while (i > 0 && num_continuation_bytes < 3 &&
+      (static_cast<unsigned char>(text[i - 1]) & 0xC0) == 0x80) {
+    --i;
+    ++num_continuation_bytes;
+  }
+  if (i == 0) {
+    return num_continuation_bytes == 0;
+  }
+
+  const unsigned char first_byte = static_cast<unsigned char>(text[i - 1]);
+  if ((first_byte & 0xE0) == 0xC0) {
+    return num_continuation_bytes == 1;
+  }
+  if ((first_byte & 0xF0) == 0xE0) {
+    return num_continuation_bytes == 2;
+  }
+  if ((first_byte & 0xF8) == 0xF0) {
+    return num_continuation_bytes == 3;
+  }
+  return num_continuation_bytes == 0;
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a text to draw with the default properties.
  *
@@ -70,7 +159,13 @@ TextSurface::TextSurface(int x, int y,
   font_size(11),
   x(x),
   y(y),
-  surface(nullptr),
+  glyphs(),
+  pen_position(),
+  previous_code_point(0),
+  text_size(),
+  text_position(),
+  composed_surface(nullptr),
+  composed_surface_valid(false),
   text() {
 
   if (font_id.empty()) {
@@ -250,7 +345,7 @@ void TextSurface::set_position(int x, int y) {
 
   this->x = x;
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -272,7 +367,7 @@ void TextSurface::set_x(int x) {
   }
 
   this->x = x;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -294,7 +389,7 @@ void TextSurface::set_y(int y) {
   }
 
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -322,6 +417,8 @@ const std::string& TextSurface::get_text() const {
  * \brief Sets the string drawn.
  *
  * If the specified string is the same than the current text, nothing is done.
+ * If it only adds characters to the current text, like when a dialog
+ * is revealed letter by letter, only the new characters are placed.
  *
  * \param text the text to display (cannot be nullptr)
  */
@@ -331,8 +428,26 @@ void TextSurface::set_text(const std::string& text) {
     return;
   }
 
+  const size_t old_size = this->text.size();
+  const bool append = !glyphs.empty() &&
+      text.size() > old_size &&
+      text.compare(0, old_size, this->text) == 0 &&
+      ends_with_complete_character(this->text);
+
   this->text = text;
-  rebuild();
+  if (!append) {
+    rebuild();
+    return;
+  }
+
+  if (FontResource::is_bitmap_font(font_id)) {
+    add_bitmap_glyphs(old_size);
+  }
+  else {
+    add_ttf_glyphs(old_size);
+  }
+  composed_surface_valid = false;
+  update_text_position();
 }
 
 /**
@@ -347,29 +462,19 @@ void TextSurface::add_char(char c) {
 }
 
 /**
- * \brief Returns the width of the surface containing the text.
+ * \brief Returns the width of the text.
  * \return the width in pixels
  */
 int TextSurface::get_width() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_width();
+  return text_size.width;
 }
 
 /**
- * \brief Returns the height of the surface containing the text.
+ * \brief Returns the height of the text.
  * \return the height in pixels
  */
 int TextSurface::get_height() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_height();
+  return text_size.height;
 }
 
 /**
@@ -381,35 +486,50 @@ Size TextSurface::get_size() const {
 }
 
 /**
- * \brief Redraws the text surface.
+ * \brief Computes the characters to draw.
  *
  * This function is called when there is a change.
  */
 void TextSurface::rebuild() {
 
-  surface = nullptr;
+  glyphs.clear();
+  pen_position = Point();
+  previous_code_point = 0;
+  text_size = Size();
+  composed_surface_valid = false;
 
   if (font_id.empty()) {
     return;
   }
 
   if (is_empty()) {
-    // Empty string or only whitespaces: no surface to create.
+    // Empty string or only whitespaces: nothing to draw.
     // Some fonts make TTF_Font fail if the string contains only whitespaces.
+    update_text_position();
     return;
   }
 
-  Debug::check_assertion(FontResource::exists(font_id),
-      std::string("No such font: '") + font_id + "'"
-  );
+  Debug::check_assertion_lazy(FontResource::exists(font_id), [&] {
+    return std::string("No such font: '") + font_id + "'";
+  });
 
   if (FontResource::is_bitmap_font(font_id)) {
-    rebuild_bitmap();
+    add_bitmap_glyphs(0);
   }
   else {
-    rebuild_ttf();
+    add_ttf_glyphs(0);
   }
 
+  update_text_position();
+}
+
+/**
+ * \brief Computes the top-left corner of the text from its alignment.
+ *
+ * This function is called when the position or the size changes.
+ */
+void TextSurface::update_text_position() {
+
   // calculate the coordinates of the top-left corner
   int x_left = 0, y_top = 0;
 
@@ -420,11 +540,11 @@ void TextSurface::rebuild() {
     break;
 
   case HorizontalAlignment::CENTER:
-    x_left = x - surface->get_width() / 2;
+    x_left = x - text_size.width / 2;
     break;
 
   case HorizontalAlignment::RIGHT:
-    x_left = x - surface->get_width();
+    x_left = x - text_size.width;
     break;
   }
 
@@ -435,11 +555,11 @@ void TextSurface::rebuild() {
     break;
 
   case VerticalAlignment::MIDDLE:
-    y_top = y - surface->get_height() / 2;
+    y_top = y - text_size.height / 2;
     break;
 
   case VerticalAlignment::BOTTOM:
-    y_top = y - surface->get_height();
+    y_top = y - text_size.height;
     break;
   }
 
@@ -447,22 +567,14 @@ void TextSurface::rebuild() {
 }
 
 /**
- * \brief Redraws the text surface in the case of a bitmap font.
+ * \brief Places characters in the case of a bitmap font.
  *
- * This function is called when there is a change.
+ * The bitmap is drawn directly: it already contains all characters.
+ *
+ * \param first_byte Index in the text of the first character to place.
+ * Previous ones are already placed.
  */
-void TextSurface::rebuild_bitmap() {
-
-  // First count the number of characters in the UTF-8 string.
-  int num_chars = 0;
-  for (unsigned i = 0; i < text.size(); i++) {
-    char current_char = text[i];
-    if ((current_char & 0xE0) == 0xC0) {
-      // This character uses two bytes.
-      ++i;
-    }
-    ++num_chars;
-  }
+void TextSurface::add_bitmap_glyphs(size_t first_byte) {
 
   // Determine the letter size from the surface size.
   const SurfacePtr& bitmap = FontResource::get_bitmap_font(font_id);
@@ -470,11 +582,7 @@ void TextSurface::rebuild_bitmap() {
   int char_width = bitmap_size.width / 128;
   int char_height = bitmap_size.height / 16;
 
-  surface = Surface::create((char_width - 1) * num_chars + 1, char_height);
-
-  // Traverse the string again to draw the characters.
-  Point dst_position;
-  for (unsigned i = 0; i < text.size(); i++) {
+  for (size_t i = first_byte; i < text.size(); i++) {
     char first_byte = text[i];
     Rectangle src_position(0, 0, char_width, char_height);
     if ((first_byte & 0xE0) != 0xC0) {
@@ -489,57 +597,131 @@ void TextSurface::rebuild_bitmap() {
       src_position.set_xy((code_point % 128) * char_width,
           (code_point / 128) * char_height);
     }
-    bitmap->draw_region(src_position, surface, dst_position);
-    dst_position.x += char_width - 1;
+    glyphs.push_back({ bitmap, src_position, pen_position });
+    pen_position.x += char_width - 1;
   }
+
+  const int num_chars = static_cast<int>(glyphs.size());
+  text_size = { (char_width - 1) * num_chars + 1, char_height };
 }
 
 /**
- * \brief Redraws the text surface in the case of a normal font.
+ * \brief Places characters in the case of a normal font.
  *
- * This function is called when there is a change.
+ * Glyphs come from the atlas of the font and are placed like SDL_ttf
+ * places them when rendering a whole string.
+ *
+ * \param first_byte Index in the text of the first character to place.
+ * Previous ones are already placed.
  */
-void TextSurface::rebuild_ttf() {
+void TextSurface::add_ttf_glyphs(size_t first_byte) {
 
-  // create the text surface
-
-  SDL_Surface* internal_surface = nullptr;
-  TTF_Font& internal_font = FontResource::get_outline_font(font_id, font_size);
-  SDL_Color internal_color;
-  text_color.get_components(
-      internal_color.r, internal_color.g, internal_color.b, internal_color.a);
+  GlyphAtlas& glyph_atlas = FontResource::get_glyph_atlas(
+      font_id,
+      font_size,
+      rendering_mode == RenderingMode::ANTIALIASING,
+      text_color
+  );
+  TTF_Font& internal_font = glyph_atlas.get_font();
+
+  int width = 0;
+  int height = 0;
+  Debug::check_assertion_lazy(TTF_SizeUTF8(&internal_font, text.c_str(), &width, &height) == 0, [&] {
+    return std::string("Cannot compute the size of string '") + text + "': " + TTF_GetError();
+  });
+  text_size = { width, height };
+
+  size_t i = first_byte;
+  while (i < text.size()) {
+    const bool first = (i == 0);
+    const uint16_t code_point = get_next_code_point(text, i);
+    const GlyphAtlas::Glyph& glyph = glyph_atlas.get_glyph(code_point);
+    if (first) {
+      if (glyph.offset.x < 0) {
+        // Like SDL_ttf, don't cut a first glyph that starts on the left.
+        pen_position.x = -glyph.offset.x;
+      }
+    }
+    else {
+      pen_position.x += glyph_atlas.get_kerning(previous_code_point, code_point);
+    }
 
-  switch (rendering_mode) {
+    if (glyph.surface != nullptr) {
+      glyphs.push_back({
+          glyph.surface,
+          glyph.surface->get_region(),
+          pen_position + glyph.offset
+      });
+    }
+    pen_position.x += glyph.advance;
+    previous_code_point = code_point;
+  }
+}
 
-  case RenderingMode::SOLID:
-    internal_surface = TTF_RenderUTF8_Solid(&internal_font, text.c_str(), internal_color);
-    break;
+/**
+ * \brief Draws the characters on a surface.
+ *
+ * Consecutive characters use the same texture, so they are batched.
+ *
+ * \param dst_surface The destination surface.
+ * \param infos Draw informations. The region is relative to the text.
+ */
+void TextSurface::draw_glyphs(Surface& dst_surface, const DrawInfos& infos) const {
 
-  case RenderingMode::ANTIALIASING:
-    internal_surface = TTF_RenderUTF8_Blended(&internal_font, text.c_str(), internal_color);
-    break;
+  const Rectangle visible_region = infos.region & Rectangle(Point(), text_size);
+  const Point origin = infos.dst_position + text_position - infos.region.get_xy();
+  for (const GlyphQuad& glyph: glyphs) {
+    const Rectangle dst_rect =
+        Rectangle(glyph.dst_position, glyph.src_rect.get_size()) & visible_region;
+    if (dst_rect.is_flat()) {
+      continue;
+    }
+    const Rectangle src_rect(
+        glyph.src_rect.get_xy() + dst_rect.get_xy() - glyph.dst_position,
+        dst_rect.get_size()
+    );
+    const Point dst_position = origin + dst_rect.get_xy();
+    glyph.surface->raw_draw_region(dst_surface, DrawInfos(
+        src_rect, dst_position, infos.blend_mode, infos.opacity, Surface::draw_proxy, infos.transform
+    ));
   }
+}
 
-  Debug::check_assertion(internal_surface != nullptr,
-      std::string("Cannot create the text surface for string '") + text + "': "
-      + SDL_GetError()
-  );
+/**
+ * \brief Returns the characters drawn on a single surface.
+ *
+ * Only needed for draw proxies like shaders that process one surface.
+ * The surface is kept until the text changes.
+ *
+ * \return The composed surface.
+ */
+const Surface& TextSurface::get_composed_surface() const {
+
+  if (composed_surface == nullptr || composed_surface->get_size() != text_size) {
+    MemoryStats::TextureOrigin origin(MemoryStats::Category::TEXT_TEXTURES);
+    composed_surface = Surface::create(text_size, true);
+    composed_surface_valid = false;
+  }
 
-  surface = std::make_shared<Surface>(internal_surface);
+  if (!composed_surface_valid) {
+    composed_surface->clear();
+    const Rectangle region(Point(), text_size);
+    const Point dst_position = -text_position;
+    draw_glyphs(*composed_surface, DrawInfos(
+        region, dst_position, BlendMode::BLEND, 255, Surface::draw_proxy
+    ));
+    composed_surface_valid = true;
+  }
+  return *composed_surface;
 }
 
 /**
  * \brief Draws this text on the given surface
- * \param region The subrectangle to draw in this object.
  * \param dst_surface The destination surface.
  * \param infos draw informations.
  */
 void TextSurface::raw_draw(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
-    surface->raw_draw(
-        dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
-  }
+  raw_draw_region(dst_surface, infos);
 }
 
 /**
@@ -549,11 +731,19 @@ void TextSurface::raw_draw(Surface& dst_surface,const DrawInfos& infos) const {
  * \param infos drawing infos
  */
 void TextSurface::raw_draw_region(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
-    surface->raw_draw_region(
-        dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
+
+  if (glyphs.empty()) {
+    return;
+  }
+
+  if (&infos.proxy == &Surface::draw_proxy) {
+    draw_glyphs(dst_surface, infos);
+    return;
   }
+
+  // Other proxies need the whole text in one surface.
+  const Point dst_position = infos.dst_position + text_position;
+  infos.proxy.draw(dst_surface, get_composed_surface(), DrawInfos(infos, dst_position));
 }
 
 Rectangle TextSurface::get_region() const {
@@ -1,27 +1,314 @@
 #include "solarus/graphics/Texture.h"
 #include "solarus/graphics/RenderTexture.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/ResourceProvider.h"
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <memory>
 
 namespace Solarus {
 
+namespace {
+
+constexpr int min_compact_texture_pixels = 256 * 256;  /**< Smaller images are not worth
+                                                        * losing color precision. */
+
+/**
+ * @brief Returns whether all pixels of a surface are fully opaque
+ * @param surface a 32-bit surface
+ * @return true if no pixel is transparent or semi-transparent
+ */
+bool is_opaque(const SDL_Surface& surface) {
+
+  uint32_t color_key = 0;
+  if (SDL_GetColorKey(const_cast<SDL_Surface*>(&surface), &color_key) == 0) {
+    return false;
+  }
+  const uint32_t alpha_mask = surface.format->Amask;
+  if (alpha_mask == 0) {
+    return true;
+  }
+  if (surface.format->BytesPerPixel != 4 || SDL_MUSTLOCK(&surface)) {
+    return false;
+  }
+
+  for (int y = 0; y < surface.h; ++y) {
+    const uint32_t* row = reinterpret_cast<const uint32_t*>(
+          static_cast<const uint8_t*>(surface.pixels) + y * surface.pitch);
+    for (int x = 0; x < surface.w; ++x) {
+      if ((row[x] & alpha_mask) != alpha_mask) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Uploads a surface to a texture of another format
+ * @param surface the pixels to upload
+ * @param format a texture format supported by the renderer
+ * @return the texture created, or nullptr in case of failure
+ */
+SDL_Texture* create_compact_texture(const SDL_Surface& surface, uint32_t format) {
+
+  SDL_Surface_UniquePtr converted_surface(
+        SDL_ConvertSurfaceFormat(const_cast<SDL_Surface*>(&surface), format, 0));
+  if (converted_surface == nullptr) {
+    return nullptr;
+  }
+
+  SDL_Texture* texture = SDL_CreateTexture(
+        Video::get_renderer(),
+        format,
+        SDL_TEXTUREACCESS_STATIC,
+        surface.w,
+        surface.h
+  );
+  if (texture == nullptr) {
+    return nullptr;
+  }
+  if (SDL_UpdateTexture(texture, nullptr, converted_surface->pixels, converted_surface->pitch) != 0) {
+    SDL_DestroyTexture(texture);
+    return nullptr;
+  }
+  // Like textures created from surfaces with an alpha channel.
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  return texture;
+}
+
+}  // Anonymous namespace.
+
+int64_t Texture::memory_budget = 0;
+int64_t Texture::surfaces_memory_size = 0;
+uint64_t Texture::num_budget_checks = 0;
+std::vector<Texture*> Texture::releasable_textures;
+
 /**
  * @brief Texture::Texture
  * @param surface valid sdl surface, ownership is taken by the texture
+ * @param allow_atlas whether the pixels may go to an atlas page, which
+ * should only be done for images that are not recreated often
  */
-Texture::Texture(SDL_Surface *surface)
-    : surface(surface)
+Texture::Texture(SDL_Surface *surface, bool allow_atlas)
+    : surface(surface),
+      texture(),
+      atlas_page(),
+      atlas_position(),
+      width(surface->w),
+      height(surface->h),
+      bytes_per_pixel(4),
+      memory_category(MemoryStats::get_texture_category()),
+      source_image_key(),
+      last_use(num_budget_checks)
 {
-  SDL_Texture* tex = SDL_CreateTextureFromSurface(Video::get_renderer(),surface);
-  Debug::check_assertion(tex != nullptr,
-        std::string("Failed to convert surface to texture") + SDL_GetError());
-  texture.reset(tex);
+  if (allow_atlas && TextureAtlas::can_contain(*surface)) {
+    atlas_page = TextureAtlas::add_image(*surface,atlas_position);
+    MemoryStats::add(memory_category, static_cast<int64_t>(width) * height * bytes_per_pixel);
+    return;
+  }
+
+  create_texture();
+}
+
+/**
+ * @brief Texture::~Texture
+ */
+Texture::~Texture() {
+  if (!source_image_key.empty()) {
+    notify_pixels_changed();
+  }
+  if (atlas_page == nullptr) {
+    release_texture();
+  }
+  else {
+    TextureAtlas::remove_image(*atlas_page, atlas_position, Size(width, height));
+    MemoryStats::remove(memory_category, static_cast<int64_t>(width) * height * bytes_per_pixel);
+  }
+}
+
+/**
+ * @brief Uploads the cpu side pixels to a new gpu side texture
+ */
+void Texture::create_texture() const {
+
+  SDL_Surface* pixels = get_surface();
+  bytes_per_pixel = 4;
+  const uint32_t compact_format = Video::get_compact_texture_format();
+  if (compact_format != SDL_PIXELFORMAT_UNKNOWN &&
+      pixels->w * pixels->h >= min_compact_texture_pixels &&
+      is_opaque(*pixels)) {
+    texture.reset(create_compact_texture(*pixels, compact_format));
+    if (texture != nullptr) {
+      bytes_per_pixel = SDL_BYTESPERPIXEL(compact_format);
+    }
+  }
+
+  if (texture == nullptr) {
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(Video::get_renderer(),pixels);
+    Debug::check_assertion_lazy(tex != nullptr, [&] {
+      return std::string("Failed to convert surface to texture") + SDL_GetError();
+    });
+    texture.reset(tex);
+  }
+  Video::notify_texture_memory(Size(width, height), true, bytes_per_pixel);
+  MemoryStats::add(memory_category, static_cast<int64_t>(width) * height * bytes_per_pixel);
+}
+
+/**
+ * @brief Destroys the gpu side texture, which get_texture() creates again
+ */
+void Texture::release_texture() {
+
+  if (texture == nullptr) {
+    return;
+  }
+  SpriteBatch::notify_texture_destroyed(texture.get());
+  Video::notify_texture_memory(Size(width, height), false, bytes_per_pixel);
+  MemoryStats::remove(memory_category, static_cast<int64_t>(width) * height * bytes_per_pixel);
+  texture = nullptr;
+}
+
+/**
+ * @brief Destroys the cpu side pixels, which get_surface() loads again
+ *
+ * Only possible with a source image.
+ */
+void Texture::release_surface() {
+
+  if (surface == nullptr) {
+    return;
+  }
+  surfaces_memory_size -= get_surface_memory_size();
+  surface = nullptr;
+}
+
+/**
+ * @brief Returns the size of the cpu side pixels
+ * @return size in bytes, 0 if they are released
+ */
+int64_t Texture::get_surface_memory_size() const {
+
+  if (surface == nullptr) {
+    return 0;
+  }
+  return static_cast<int64_t>(surface->pitch) * surface->h;
+}
+
+/**
+ * @brief Sets the image file these pixels come from
+ *
+ * The pixels can then be released when the memory budget is exceeded
+ * and loaded again from the file data, until they are modified.
+ *
+ * @param image_key key of the image in the resource provider, which is
+ * also its file name relative to the data directory
+ */
+void Texture::set_source_image(const std::string& image_key) {
+
+  if (!source_image_key.empty() || image_key.empty()) {
+    return;
+  }
+  source_image_key = image_key;
+  surfaces_memory_size += get_surface_memory_size();
+  releasable_textures.push_back(this);
+}
+
+/**
+ * \copydoc SurfaceImpl::notify_pixels_changed
+ *
+ * Modified pixels can no longer be loaded from the source image.
+ */
+void Texture::notify_pixels_changed() {
+
+  if (source_image_key.empty()) {
+    return;
+  }
+  surfaces_memory_size -= get_surface_memory_size();
+  source_image_key.clear();
+  const auto it = std::find(releasable_textures.begin(), releasable_textures.end(), this);
+  if (it != releasable_textures.end()) {
+    *it = releasable_textures.back();
+    releasable_textures.pop_back();
+  }
+}
+
+/**
+ * @brief Returns the memory budget of textures
+ * @return bytes allowed, 0 means no limit
+ */
+int64_t Texture::get_memory_budget() {
+  return memory_budget;
+}
+
+/**
+ * @brief Sets the memory budget of textures
+ *
+ * The budget counts all gpu side textures and the cpu side pixels that
+ * can be released.
+ *
+ * @param memory_budget bytes allowed, 0 means no limit
+ */
+void Texture::set_memory_budget(int64_t memory_budget) {
+
+  Debug::check_assertion(memory_budget >= 0, "Invalid texture memory budget");
+  Texture::memory_budget = memory_budget;
+}
+
+/**
+ * @brief Releases pixels of textures until the memory budget is respected
+ *
+ * The least recently used textures go first. Their cpu side pixels are
+ * released, then their gpu side texture if still needed. Textures used
+ * since the previous call are kept.
+ * Must be called from the main thread, once per frame.
+ */
+void Texture::enforce_memory_budget() {
+
+  const uint64_t previous_check = num_budget_checks++;
+  if (memory_budget == 0 ||
+      Video::get_texture_memory() + surfaces_memory_size <= memory_budget) {
+    return;
+  }
+
+  std::vector<Texture*> textures = releasable_textures;
+  std::sort(textures.begin(), textures.end(), [](const Texture* first, const Texture* second) {
+    return first->last_use < second->last_use;
+  });
+
+  // Cpu side pixels first because they are cheap to get back.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (Texture* texture: textures) {
+      if (Video::get_texture_memory() + surfaces_memory_size <= memory_budget) {
+        return;
+      }
+      if (texture->last_use >= previous_check) {
+        break;
+      }
+      if (pass == 0) {
+        texture->release_surface();
+      }
+      else if (texture->atlas_page == nullptr) {
+        texture->release_texture();
+      }
+    }
+  }
 }
 
 /**
  * \copydoc SurfaceImpl::get_texture
  */
 SDL_Texture *Texture::get_texture() const {
+    last_use = num_budget_checks;
+    if (atlas_page != nullptr) {
+      return atlas_page->get_texture();
+    }
+    if (texture == nullptr) {
+      // Released to respect the memory budget.
+      create_texture();
+    }
     return texture.get();
 }
 
@@ -29,6 +316,30 @@ SDL_Texture *Texture::get_texture() const {
  * \copydoc SurfaceImpl::get_surface
  */
 SDL_Surface *Texture::get_surface() const {
+    last_use = num_budget_checks;
+    if (surface == nullptr) {
+      // Released to respect the memory budget: load the source image again.
+      ResourceProvider* resource_provider = ResourceProvider::get_instance();
+      std::shared_ptr<SDL_Surface> cached_surface = resource_provider != nullptr ?
+          resource_provider->get_image(source_image_key) : nullptr;
+      if (cached_surface != nullptr) {
+        surface.reset(Surface::copy_sdl_surface(*cached_surface));
+      }
+      else {
+        surface.reset(Surface::decode_image(source_image_key, false));
+      }
+      if (surface == nullptr || surface->w != width || surface->h != height) {
+        // The file was removed or changed while running.
+        Debug::error(std::string("Cannot load image '") + source_image_key + "' again");
+        const SDL_PixelFormat* format = Video::get_rgba_format();
+        surface.reset(SDL_CreateRGBSurface(
+            0, width, height, 32, format->Rmask, format->Gmask, format->Bmask, format->Amask));
+        Debug::check_assertion_lazy(surface != nullptr, [&] {
+          return std::string("Failed to create surface: ") + SDL_GetError();
+        });
+      }
+      surfaces_memory_size += get_surface_memory_size();
+    }
     return surface.get();
 }
 
@@ -36,20 +347,38 @@ SDL_Surface *Texture::get_surface() const {
  * \copydoc SurfaceImpl::get_width
  */
 int Texture::get_width() const {
-    return surface->w;
+    return width;
 }
 
 /**
  * \copydoc SurfaceImpl::get_height
  */
 int Texture::get_height() const {
-    return surface->h;
+    return height;
+}
+
+/**
+ * \copydoc SurfaceImpl::get_texture_offset
+ */
+Point Texture::get_texture_offset() const {
+    return atlas_position;
+}
+
+/**
+ * \copydoc SurfaceImpl::get_texture_size
+ */
+Size Texture::get_texture_size() const {
+    if (atlas_page != nullptr) {
+      return atlas_page->get_size();
+    }
+    return Size(get_width(),get_height());
 }
 
 /**
  * \copydoc SurfaceImpl::to_render_texture
  */
 RenderTexture* Texture::to_render_texture() {
+    MemoryStats::TextureOrigin origin(memory_category);
     RenderTexture* rt = new RenderTexture(get_width(),get_height());
     rt->draw_other(*this,DrawInfos(Rectangle(Point(),Size(get_width(),get_height())),
                                    Point(),
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/SpriteBatch.h"
+#include "solarus/graphics/TextureAtlas.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <string>
+
+namespace Solarus {
+
+std::vector<std::weak_ptr<TextureAtlas::Page>> TextureAtlas::pages;
+
+/**
+ * \brief Creates an empty, fully transparent atlas page.
+ * \param size Size of the page.
+ */
+TextureAtlas::Page::Page(const Size& size):
+  size(size),
+  texture(),
+  shelves(),
+  next_shelf_y(0) {
+
+  SDL_Renderer* renderer = Video::get_renderer();
+  SDL_Texture* page_texture = SDL_CreateTexture(
+        renderer,
+        Video::get_rgba_format()->format,
+        SDL_TEXTUREACCESS_TARGET,
+        size.width,
+        size.height
+  );
+  Debug::check_assertion_lazy(page_texture != nullptr, [&] {
+    return std::string("Failed to create atlas page: ") + SDL_GetError();
+  });
+  texture.reset(page_texture);
+  Video::notify_texture_memory(size, true);
+
+  // The content of a new texture is undefined: clear it on the GPU
+  // rather than uploading a whole page of transparent pixels.
+  // Render textures bind their own target before drawing.
+  SpriteBatch::flush();
+  SOLARUS_CHECK_SDL(SDL_SetRenderTarget(renderer, texture.get()));
+  SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0));
+  SOLARUS_CHECK_SDL(SDL_RenderClear(renderer));
+}
+
+/**
+ * \brief Destroys the page.
+ */
+TextureAtlas::Page::~Page() {
+  SpriteBatch::notify_texture_destroyed(texture.get());
+  Video::notify_texture_memory(size, false);
+}
+
+/**
+ * \brief Returns the texture of this page.
+ * \return The page texture.
+ */
+SDL_Texture* TextureAtlas::Page::get_texture() const {
+  return texture.get();
+}
+
+/**
+ * \brief Returns the size of this page.
+ * \return The page size.
+ */
+const Size& TextureAtlas::Page::get_size() const {
+  return size;
+}
+
+/**
+ * \brief Returns the first free span of a shelf wide enough for an image.
+ * \param shelf A shelf.
+ * \param width Width of the image, padding included.
+ * \return Index of the span in the shelf, or -1.
+ */
+int TextureAtlas::Page::find_free_span(const Shelf& shelf, int width) {
+
+  for (size_t i = 0; i < shelf.free_spans.size(); ++i) {
+    if (shelf.free_spans[i].width >= width) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+/**
+ * \brief Reserves space for an image in this page.
+ *
+ * The image goes to the lowest existing shelf where it fits,
+ * in space freed by a previous image or after the other images,
+ * or to a new shelf.
+ *
+ * \param image_size Size of the image, padding included.
+ * \param[out] position Where the image goes in the page.
+ * \return \c false if there is no room left.
+ */
+bool TextureAtlas::Page::allocate(const Size& image_size, Point& position) {
+
+  Shelf* best_shelf = nullptr;
+  int best_span = -1;
+  for (Shelf& shelf: shelves) {
+    if (shelf.height < image_size.height ||
+        (best_shelf != nullptr && shelf.height >= best_shelf->height)) {
+      continue;
+    }
+    const int span = find_free_span(shelf, image_size.width);
+    if (span != -1 || shelf.next_x + image_size.width <= size.width) {
+      best_shelf = &shelf;
+      best_span = span;
+    }
+  }
+
+  if (best_shelf == nullptr) {
+    if (next_shelf_y + image_size.height > size.height) {
+      return false;
+    }
+    shelves.push_back(Shelf{ next_shelf_y, image_size.height, 0, {} });
+    next_shelf_y += image_size.height;
+    best_shelf = &shelves.back();
+  }
+
+  if (best_span != -1) {
+    Span& span = best_shelf->free_spans[best_span];
+    position = Point(span.x, best_shelf->y);
+    span.x += image_size.width;
+    span.width -= image_size.width;
+    if (span.width == 0) {
+      best_shelf->free_spans.erase(best_shelf->free_spans.begin() + best_span);
+    }
+    return true;
+  }
+
+  position = Point(best_shelf->next_x, best_shelf->y);
+  best_shelf->next_x += image_size.width;
+  return true;
+}
+
+/**
+ * \brief Gives back the space of an image to this page.
+ *
+ * Adjacent free spaces are merged. Shelves left empty at the bottom
+ * of the page are removed so that any height can use them again.
+ *
+ * \param position Where the image was in the page.
+ * \param image_size Size of the image, padding included.
+ */
+void TextureAtlas::Page::release(const Point& position, const Size& image_size) {
+
+  const auto it = std::find_if(shelves.begin(), shelves.end(), [&](const Shelf& shelf) {
+    return shelf.y == position.y;
+  });
+  Debug::check_assertion(it != shelves.end(), "No atlas shelf at this position");
+  Shelf& shelf = *it;
+
+  // Insert the span in order and merge it with its neighbors.
+  std::vector<Span>& spans = shelf.free_spans;
+  auto next = std::find_if(spans.begin(), spans.end(), [&](const Span& span) {
+    return span.x > position.x;
+  });
+  next = spans.insert(next, Span{ position.x, image_size.width });
+  if (next + 1 != spans.end() && next->x + next->width == (next + 1)->x) {
+    next->width += (next + 1)->width;
+    spans.erase(next + 1);
+  }
+  if (next != spans.begin() && (next - 1)->x + (next - 1)->width == next->x) {
+    (next - 1)->width += next->width;
+    next = spans.erase(next) - 1;
+  }
+
+  // Free space at the end of the shelf goes back to the shelf.
+  if (next->x + next->width == shelf.next_x) {
+    shelf.next_x = next->x;
+    spans.erase(next);
+  }
+
+  while (!shelves.empty() && shelves.back().next_x == 0) {
+    next_shelf_y = shelves.back().y;
+    shelves.pop_back();
+  }
+}
+
+/**
+ * \brief Returns whether an image can be placed in an atlas.
+ * \param image An image in the RGBA format of the video system.
+ * \return \c true if it is small enough and has the page format.
+ */
+bool TextureAtlas::can_contain(const SDL_Surface& image) {
+
+  if (image.format->format != Video::get_rgba_format()->format) {
+    return false;
+  }
+
+  const Size& page_size = get_page_size();
+  const int max_width = std::min(max_image_size, page_size.width - padding);
+  const int max_height = std::min(max_image_size, page_size.height - padding);
+  return image.w > 0 && image.h > 0 &&
+      image.w <= max_width && image.h <= max_height;
+}
+
+/**
+ * \brief Uploads an image to an atlas page.
+ *
+ * A new page is created if no existing one has enough room.
+ *
+ * \param image The image. can_contain() must be \c true.
+ * \param[out] position Position of the image in the page.
+ * \return The page that contains the image. The caller owns it.
+ */
+TextureAtlas::PagePtr TextureAtlas::add_image(const SDL_Surface& image, Point& position) {
+
+  const Size padded_size(image.w + padding, image.h + padding);
+  PagePtr page = nullptr;
+
+  // Forget destroyed pages and look for room in the other ones.
+  pages.erase(std::remove_if(pages.begin(), pages.end(),
+      [](const std::weak_ptr<Page>& page) { return page.expired(); }
+  ), pages.end());
+  for (const std::weak_ptr<Page>& weak_page: pages) {
+    PagePtr candidate = weak_page.lock();
+    if (candidate->allocate(padded_size, position)) {
+      page = candidate;
+      break;
+    }
+  }
+
+  if (page == nullptr) {
+    page = std::make_shared<Page>(get_page_size());
+    pages.push_back(page);
+    const bool success = page->allocate(padded_size, position);
+    Debug::check_assertion(success, "Image too big for an atlas page");
+  }
+
+  const Rectangle region(position, Size(image.w, image.h));
+  SDL_UpdateTexture(page->get_texture(), region, image.pixels, image.pitch);
+
+  // Reused space may still contain a previous image: make the padding
+  // on the right and at the bottom transparent again.
+  // The left and top neighbors are always padding of other images.
+  static const std::vector<uint32_t> transparent_pixels(max_image_size + padding, 0);
+  const Rectangle right_padding(position.x + image.w, position.y, padding, image.h + padding);
+  const Rectangle bottom_padding(position.x, position.y + image.h, image.w, padding);
+  SDL_UpdateTexture(page->get_texture(), right_padding, transparent_pixels.data(), padding * 4);
+  SDL_UpdateTexture(page->get_texture(), bottom_padding, transparent_pixels.data(), image.w * 4);
+  return page;
+}
+
+/**
+ * \brief Gives back to its page the space of an image added before.
+ * \param page The page that contains the image.
+ * \param position Position of the image in the page.
+ * \param image_size Size of the image.
+ */
+void TextureAtlas::remove_image(Page& page, const Point& position, const Size& image_size) {
+
+  page.release(position, Size(image_size.width + padding, image_size.height + padding));
+}
+
+/**
+ * \brief Returns the number of atlas pages currently in use.
+ * \return The number of pages.
+ */
+int TextureAtlas::get_num_pages() {
+
+  int num_pages = 0;
+  for (const std::weak_ptr<Page>& page: pages) {
+    if (!page.expired()) {
+      ++num_pages;
+    }
+  }
+  return num_pages;
+}
+
+/**
+ * \brief Returns the size of new atlas pages.
+ * \return The biggest size allowed by the renderer, up to max_page_size.
+ */
+Size TextureAtlas::get_page_size() {
+
+  int width = max_page_size;
+  int height = max_page_size;
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(Video::get_renderer(), &info) == 0) {
+    if (info.max_texture_width > 0) {
+      width = std::min(width, info.max_texture_width);
+    }
+    if (info.max_texture_height > 0) {
+      height = std::min(height, info.max_texture_height);
+    }
+  }
+  return Size(width, height);
+}
+
+}
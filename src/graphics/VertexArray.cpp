@@ -239,6 +239,14 @@ Vertex* VertexArray::data() {
   return vertices.data();
 }
 
+/**
+ * @brief remove all vertices, keeping the allocated storage
+ */
+void VertexArray::clear() {
+  buffer_dirty = true;
+  vertices.clear();
+}
+
 /**
  * @brief add a quad (6 vertices) to the array
  * @param rect quad position and size
@@ -17,19 +17,25 @@
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/FrameTimings.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/DynamicResolution.h"
 #include "solarus/graphics/Hq2xFilter.h"
 #include "solarus/graphics/Hq3xFilter.h"
 #include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/PostProcessChain.h"
+#include "solarus/graphics/RenderTexture.h"
 #include "solarus/graphics/Scale2xFilter.h"
 #include "solarus/graphics/ShaderContext.h"
+#include "solarus/graphics/SpriteBatch.h"
 #include "solarus/graphics/SoftwareVideoMode.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Video.h"
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -55,6 +61,9 @@ struct VideoContext {
   std::string rendering_driver_name;        /**< The name of the rendering driver. */
   bool disable_window = false;              /**< Indicates that no window is displayed (used for unit tests). */
   bool fullscreen_window = false;           /**< True if the window is in fullscreen. */
+  bool window_shown = false;                /**< False until the window is shown the first time.
+                                             * Until then, its size and fullscreen state are only
+                                             * recorded and applied once when showing it. */
   bool visible_cursor = true;               /**< True if the mouse cursor is visible. */
 
   // Sizes.
@@ -73,6 +82,8 @@ struct VideoContext {
   SDL_Texture* render_target = nullptr;     /**< The render texture used. */
   bool shaders_enabled = false;             /**< True if shaded modes support is enabled. */
   ShaderPtr current_shader = nullptr;       /**< The shader currently used or nullptr. */
+  PostProcessChain post_process_chain;      /**< Shaders applied to the quest surface before
+                                             * the current shader. */
 
   // Legacy software video modes.
   std::vector<SoftwareVideoMode>
@@ -82,11 +93,122 @@ struct VideoContext {
   const SoftwareVideoMode*
       default_video_mode = nullptr;         /**< Default software video mode. */
   SurfacePtr scaled_surface = nullptr;      /**< The screen surface used with software-scaled modes. */
+  ShaderPtr video_mode_shader = nullptr;    /**< Shader doing the scaling of the current video mode
+                                             * on the GPU instead of its software filter, or nullptr. */
+
+  // Skipping unchanged frames.
+  bool screen_outdated = true;              /**< False if the screen shows rendered_signature. */
+  uint64_t rendered_signature = 0;          /**< Content signature of the last quest surface rendered. */
+
+  // Presenting frames later.
+  bool present_deferred = false;            /**< Whether render() leaves the present to present(). */
+  bool present_pending = false;             /**< Whether a rendered frame is waiting for present(). */
+  bool present_pending_gl = false;          /**< Whether the pending frame was rendered by a shader. */
+  std::string vsync = "adaptive";           /**< Vsync mode: "on", "adaptive" or "off". */
+
+  int64_t texture_memory = 0;               /**< Estimated bytes of textures currently allocated. */
+
+  // Compact textures.
+  uint32_t compact_texture_format =
+      SDL_PIXELFORMAT_UNKNOWN;              /**< 16-bit opaque format supported by the renderer, if any. */
+  bool compact_textures_enabled = false;    /**< Whether the quest allows compact textures. */
+
+  // Dynamic resolution.
+  DynamicResolution dynamic_resolution;     /**< Scale of the final pass chosen from the load. */
+  SurfacePtr dynamic_resolution_surface =
+      nullptr;                              /**< Reduced target of the shader when the scale is lower than 1. */
+  double present_time = 0.0;                /**< Time spent waiting in present() since the last frame (ms). */
 
 };
 
 VideoContext context;
 
+/**
+ * \brief Fragment source of the scaling video modes, done on the GPU.
+ *
+ * Without SOL_SMOOTH, this is exactly the Scale2x (EPX) rule: a quarter of a
+ * pixel takes the color of its two neighbors on that side when they are
+ * equal and the two opposite neighbors are different.
+ * With SOL_SMOOTH, colors are compared with the YUV thresholds of hqx
+ * and the corner is blended progressively, which approximates hq2x, hq3x
+ * and hq4x without their lookup tables.
+ * Both work for any window size.
+ */
+constexpr auto scaling_fragment_source =
+    R"(
+    #if __VERSION__ >= 130
+    #define COMPAT_VARYING in
+    #define COMPAT_TEXTURE texture
+    out vec4 FragColor;
+    #else
+    #define COMPAT_VARYING varying
+    #define FragColor gl_FragColor
+    #define COMPAT_TEXTURE texture2D
+    #endif
+
+    #ifdef GL_ES
+    precision mediump float;
+    #define COMPAT_PRECISION mediump
+    #else
+    #define COMPAT_PRECISION
+    #endif
+
+    uniform sampler2D sol_texture;
+    uniform COMPAT_PRECISION vec2 sol_input_size;
+    COMPAT_VARYING vec2 sol_vtex_coord;
+    COMPAT_VARYING vec4 sol_vcolor;
+
+    bool similar(vec4 first, vec4 second) {
+    #if SOL_SMOOTH
+      const mat3 rgb_to_yuv = mat3(
+          0.299, -0.169, 0.5,
+          0.587, -0.331, -0.419,
+          0.114, 0.5, -0.081
+      );
+      vec3 yuv_diff = abs(rgb_to_yuv * (first.rgb - second.rgb));
+      return all(lessThanEqual(yuv_diff, vec3(48.0, 7.0, 6.0) / 255.0));
+    #else
+      return first == second;
+    #endif
+    }
+
+    void main() {
+      vec2 texel = 1.0 / sol_input_size;
+      vec2 position = sol_vtex_coord * sol_input_size;
+      vec2 center = (floor(position) + 0.5) * texel;
+
+      // Neighbors on the side of the current quarter and on the opposite side.
+      vec2 side = (step(0.5, fract(position)) * 2.0 - 1.0) * texel;
+      vec4 e = COMPAT_TEXTURE(sol_texture, center);
+      vec4 near_x = COMPAT_TEXTURE(sol_texture, center + vec2(side.x, 0.0));
+      vec4 near_y = COMPAT_TEXTURE(sol_texture, center + vec2(0.0, side.y));
+      vec4 far_x = COMPAT_TEXTURE(sol_texture, center - vec2(side.x, 0.0));
+      vec4 far_y = COMPAT_TEXTURE(sol_texture, center - vec2(0.0, side.y));
+
+      vec4 color = e;
+      if (similar(near_x, near_y) && !similar(near_x, far_y) && !similar(near_y, far_x)) {
+    #if SOL_SMOOTH
+        vec2 to_corner = abs(fract(position) - 0.5) * 2.0;
+        color = mix(e, near_x, clamp(to_corner.x + to_corner.y - 0.5, 0.0, 1.0));
+    #else
+        color = near_x;
+    #endif
+      }
+      FragColor = color * sol_vcolor;
+    }
+    )";
+
+/**
+ * \brief Returns the fragment source of a scaling video mode.
+ * \param smooth \c false for Scale2x, \c true for the hqx approximation.
+ * \return The fragment source.
+ */
+std::string get_scaling_fragment_source(bool smooth) {
+
+  return std::string("#define SOL_SMOOTH ") + (smooth ? "1" : "0") + "\n" +
+      scaling_fragment_source;
+}
+
 /**
  * \brief Creates the window but does not show it.
  * \param args Command-line arguments.
@@ -111,8 +233,10 @@ void create_window() {
       SDL_WINDOW_HIDDEN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL
   );
 
-  Debug::check_assertion(context.main_window != nullptr,
-      std::string("Cannot create the window: ") + SDL_GetError());
+  Debug::check_assertion_lazy(context.main_window != nullptr, [&] {
+    return std::string("Cannot create the window: ") + SDL_GetError();
+  });
+  context.window_size = context.wanted_quest_size;
 
   context.main_renderer = SDL_CreateRenderer(
         context.main_window,
@@ -126,8 +250,9 @@ void create_window() {
     context.main_renderer = SDL_CreateRenderer(context.main_window, -1, SDL_RENDERER_SOFTWARE);
   }
 
-  Debug::check_assertion(context.main_renderer != nullptr,
-      std::string("Cannot create the renderer: ") + SDL_GetError());
+  Debug::check_assertion_lazy(context.main_renderer != nullptr, [&] {
+    return std::string("Cannot create the renderer: ") + SDL_GetError();
+  });
 
 
 
@@ -143,6 +268,14 @@ void create_window() {
     }
   }
 
+  // Large opaque images may use a 16-bit texture format if the quest wants.
+  for (unsigned i = 0; i < renderer_info.num_texture_formats; ++i) {
+    if (renderer_info.texture_formats[i] == SDL_PIXELFORMAT_RGB565) {
+      context.compact_texture_format = SDL_PIXELFORMAT_RGB565;
+      break;
+    }
+  }
+
   Logger::info("SDL Renderer : " + std::string(renderer_info.name));
 
   context.rgba_format = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
@@ -156,6 +289,7 @@ void create_window() {
   // Decide whether we enable shaders.
   context.shaders_enabled = context.rendertarget_supported &&
       ShaderContext::initialize();
+  Video::set_vsync(context.vsync);
 }
 
 /**
@@ -171,22 +305,26 @@ void initialize_software_video_modes() {
   context.all_video_modes.emplace_back(
       "scale2x",
       context.quest_size * 2,
-      std::unique_ptr<SoftwarePixelFilter>(new Scale2xFilter())
+      std::unique_ptr<SoftwarePixelFilter>(new Scale2xFilter()),
+      get_scaling_fragment_source(false)
   );
   context.all_video_modes.emplace_back(
       "hq2x",
       context.quest_size * 2,
-      std::unique_ptr<SoftwarePixelFilter>(new Hq2xFilter())
+      std::unique_ptr<SoftwarePixelFilter>(new Hq2xFilter()),
+      get_scaling_fragment_source(true)
   );
   context.all_video_modes.emplace_back(
       "hq3x",
       context.quest_size * 3,
-      std::unique_ptr<SoftwarePixelFilter>(new Hq3xFilter())
+      std::unique_ptr<SoftwarePixelFilter>(new Hq3xFilter()),
+      get_scaling_fragment_source(true)
   );
   context.all_video_modes.emplace_back(
       "hq4x",
       context.quest_size * 4,
-      std::unique_ptr<SoftwarePixelFilter>(new Hq4xFilter())
+      std::unique_ptr<SoftwarePixelFilter>(new Hq4xFilter()),
+      get_scaling_fragment_source(true)
   );
 
   context.default_video_mode = &context.all_video_modes[0];
@@ -195,6 +333,47 @@ void initialize_software_video_modes() {
   Video::set_default_video_mode();
 }
 
+/**
+ * \brief Renders the quest surface with a shader at a reduced resolution.
+ *
+ * The shader draws into an intermediate surface smaller than the output,
+ * which is then stretched to the screen by SDL.
+ * The screen render target must be the main one.
+ *
+ * \param shader The shader of the final pass.
+ * \param quest_surface The quest surface to render.
+ * \param scale Scale of the intermediate surface relative to the output.
+ */
+void render_reduced(Shader& shader, const Surface& quest_surface, double scale) {
+
+  const Size& output_size = Video::get_output_size_no_bars();
+  const Size reduced_size(
+      std::max(1, static_cast<int>(output_size.width * scale)),
+      std::max(1, static_cast<int>(output_size.height * scale))
+  );
+  if (context.dynamic_resolution_surface == nullptr ||
+      context.dynamic_resolution_surface->get_size() != reduced_size) {
+    context.dynamic_resolution_surface = Surface::create(reduced_size);
+  }
+
+  // The quad covers the whole target when its size is the region size.
+  const Size& quest_size = quest_surface.get_size();
+  RenderTexture& target = context.dynamic_resolution_surface->request_render();
+  target.invalidate_content_signature();
+  target.with_target([&](SDL_Renderer* /* renderer */) {
+    shader.render(quest_surface, Rectangle(quest_size), quest_size, Point(), false);
+  });
+
+  SDL_Texture* texture = target.get_texture();
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+  SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+#endif
+  SDL_SetRenderTarget(context.main_renderer, nullptr);
+  SDL_RenderClear(context.main_renderer);
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+  SDL_RenderCopy(context.main_renderer, texture, nullptr, nullptr);
+}
+
 }  // Anonymous namespace.
 
 namespace Video {
@@ -265,6 +444,10 @@ void quit() {
     return;
   }
 
+  SpriteBatch::quit();
+  RenderTexture::quit();
+  context.video_mode_shader = nullptr;
+  context.post_process_chain.clear();
   ShaderContext::quit();
 
   if (is_fullscreen()) {
@@ -273,6 +456,7 @@ void quit() {
   }
 
   context.all_video_modes.clear();
+  context.present_pending = false;
 
   if (context.pixel_format != nullptr) {
     SDL_FreeFormat(context.pixel_format);
@@ -352,39 +536,105 @@ const std::string& get_rendering_driver_name() {
 }
 
 /**
- * \brief Show the window.
+ * \brief Shows the window.
+ *
+ * The first time, the size and the fullscreen state set so far are applied
+ * to the window before showing it, so that the window system only sees its
+ * final configuration.
  */
 void show_window() {
+
+  if (context.main_window == nullptr) {
+    return;
+  }
+
+  if (!context.window_shown) {
+    context.window_shown = true;
+    SDL_SetWindowSize(
+        context.main_window,
+        context.window_size.width,
+        context.window_size.height
+    );
+    SDL_SetWindowPosition(
+        context.main_window,
+        SDL_WINDOWPOS_CENTERED,
+        SDL_WINDOWPOS_CENTERED
+    );
+    if (context.fullscreen_window) {
+      SDL_SetWindowFullscreen(context.main_window, SDL_WINDOW_FULLSCREEN_DESKTOP);
+    }
+    invalidate_screen();
+  }
   SDL_ShowWindow(context.main_window);
 }
 
 /**
- * \brief hide_window
+ * \brief Hides the window.
  */
 void hide_window() {
+
+  if (context.main_window == nullptr) {
+    return;
+  }
   SDL_HideWindow(context.main_window);
 }
 
 /**
  * \brief Draws the quest surface on the screen with the current video mode.
+ *
+ * Nothing is done if the quest surface was redrawn with exactly the same
+ * content as the last time and the screen was not invalidated since.
+ * Shaders are assumed to change the result at every frame.
+ *
+ * If presenting is deferred, the frame is only submitted here and
+ * present() shows it later.
+ *
  * \param quest_surface The quest surface to render on the screen.
+ * \param thread_pool Threads to apply software pixel filters in parallel,
+ * or nullptr to only use the current thread.
+ * \return \c true if the screen was updated, \c false if this frame was skipped.
  */
-void render(const SurfacePtr& quest_surface) {
+bool render(const SurfacePtr& quest_surface, ThreadPool* thread_pool) {
 
   if (context.disable_window) {
-    return;
+    return false;
   }
 
   Debug::check_assertion(context.video_mode != nullptr,
       "Missing video mode");
 
+  // Perform draws still queued.
+  SpriteBatch::flush();
+
+  // The previous frame must be shown before the screen is cleared.
+  present();
+
+  const uint64_t signature = quest_surface->get_internal_surface().get_content_signature();
+  if (!context.screen_outdated &&
+      context.current_shader == nullptr &&
+      context.post_process_chain.is_empty() &&
+      signature == context.rendered_signature) {
+    return false;
+  }
+  context.screen_outdated = false;
+  context.rendered_signature = signature;
+
   // See if there is a filter to apply.
-  SurfacePtr surface_to_render = quest_surface;
+  // The scaling of the video mode is done on the GPU when possible.
+  const ShaderPtr& shader = context.current_shader != nullptr ?
+      context.current_shader : context.video_mode_shader;
+  // The post-processing chain works on its own targets before the final pass.
+  const SurfacePtr& processed_surface = context.post_process_chain.is_empty() ?
+      quest_surface : context.post_process_chain.apply(quest_surface);
+  SurfacePtr surface_to_render = processed_surface;
+  const double scale = context.dynamic_resolution.get_scale();
   const SoftwarePixelFilter* software_filter = context.video_mode->get_software_filter();
-  if (software_filter != nullptr) {
+  if (software_filter != nullptr && context.video_mode_shader == nullptr && scale >= 1.0 &&
+      processed_surface->get_size() == quest_surface->get_size()) {
+    // Under load, the quest surface is stretched without the filter instead.
     Debug::check_assertion(context.scaled_surface != nullptr,
         "Missing destination surface for scaling");
-    quest_surface->apply_pixel_filter(*software_filter, *context.scaled_surface);
+    processed_surface->apply_pixel_filter(*software_filter, *context.scaled_surface, thread_pool);
     surface_to_render = context.scaled_surface;
   }
 
@@ -392,18 +642,234 @@ void render(const SurfacePtr& quest_surface) {
   SDL_SetRenderDrawColor(context.main_renderer, 0, 0, 0, 255);
   SDL_RenderSetClipRect(context.main_renderer, nullptr);
   SDL_RenderClear(context.main_renderer);
-  if (context.current_shader != nullptr) {
+  bool rendered_by_shader = (shader != nullptr);
+  if (shader != nullptr && scale < 1.0) {
+    // Run the shader on fewer pixels and let SDL stretch the result.
+    render_reduced(*shader, *processed_surface, scale);
+    rendered_by_shader = false;
+  }
+  else if (shader != nullptr) {
     // OpenGL rendering with the current shader.
-    context.current_shader->render(*quest_surface,Rectangle(quest_surface->get_size()),quest_surface->get_size(),Point(),true);
-    SDL_GL_SwapWindow(Video::get_window());
+    shader->render(*processed_surface,Rectangle(processed_surface->get_size()),processed_surface->get_size(),Point(),true);
   }
   else {
     // SDL rendering.
     //Set blending mode to none to simply replace any on_screen material
     SDL_SetTextureBlendMode(surface_to_render->get_internal_surface().get_texture(),SDL_BLENDMODE_NONE);
     SDL_RenderCopy(context.main_renderer, surface_to_render->get_internal_surface().get_texture(), nullptr, nullptr);
+  }
+
+  context.present_pending = true;
+  context.present_pending_gl = rendered_by_shader;
+  if (!context.present_deferred) {
+    present();
+  }
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+  else if (!rendered_by_shader) {
+    // Let the GPU start working on the frame while the simulation continues.
+    SDL_RenderFlush(context.main_renderer);
+  }
+#endif
+  return true;
+}
+
+/**
+ * \brief Shows the last frame rendered if it is not shown yet.
+ *
+ * This may block until the next display refresh if vsync is enabled.
+ * Does nothing if there is no pending frame.
+ */
+void present() {
+
+  if (!context.present_pending) {
+    return;
+  }
+  context.present_pending = false;
+
+  // Waiting for the display is not work that a lower resolution would save.
+  const double start_time = FrameTimings::get_time();
+  if (context.present_pending_gl) {
+    SDL_GL_SwapWindow(context.main_window);
+  }
+  else {
     SDL_RenderPresent(context.main_renderer);
   }
+  context.present_time += FrameTimings::get_time() - start_time;
+}
+
+/**
+ * \brief Returns whether render() leaves the present of frames to present().
+ * \return \c true if presenting is deferred.
+ */
+bool is_present_deferred() {
+  return context.present_deferred;
+}
+
+/**
+ * \brief Sets whether render() leaves the present of frames to present().
+ *
+ * When deferred, a frame is submitted by render() but only shown by the
+ * next call to present() or render().
+ * The main loop can then simulate the next frame while the GPU works,
+ * instead of waiting for the display refresh right after drawing.
+ *
+ * \param present_deferred \c true to defer presenting.
+ */
+void set_present_deferred(bool present_deferred) {
+
+  context.present_deferred = present_deferred;
+  if (!present_deferred) {
+    present();
+  }
+}
+
+/**
+ * \brief Forces the next call to render() to update the screen.
+ *
+ * This should be called when the window content may have been lost,
+ * for example when the window is exposed or resized.
+ */
+void invalidate_screen() {
+  context.screen_outdated = true;
+}
+
+/**
+ * \brief Returns the estimated memory of textures currently allocated.
+ * \return The sum of sizes given to add_texture_memory(), in bytes.
+ */
+int64_t get_texture_memory() {
+  return context.texture_memory;
+}
+
+/**
+ * \brief Notifies that a texture was created or destroyed.
+ * \param size Size of the texture in pixels.
+ * \param created \c true if the texture was created, \c false if it was destroyed.
+ * \param bytes_per_pixel Size of a pixel in the format of the texture.
+ */
+void notify_texture_memory(const Size& size, bool created, int bytes_per_pixel) {
+
+  const int64_t num_bytes = static_cast<int64_t>(size.width) * size.height * bytes_per_pixel;
+  context.texture_memory += created ? num_bytes : -num_bytes;
+}
+
+/**
+ * \brief Returns the format to use for large opaque images.
+ *
+ * Such images lose some color precision in this format, but use half the
+ * texture memory and upload time.
+ *
+ * \return A 16-bit texture format, or SDL_PIXELFORMAT_UNKNOWN if compact
+ * textures are disabled by the quest or not supported by the renderer.
+ */
+uint32_t get_compact_texture_format() {
+
+  if (!context.compact_textures_enabled) {
+    return SDL_PIXELFORMAT_UNKNOWN;
+  }
+  return context.compact_texture_format;
+}
+
+/**
+ * \brief Sets whether large opaque images may use a 16-bit texture format.
+ *
+ * Only textures created afterwards are affected.
+ *
+ * \param compact_textures_enabled \c true to allow compact textures.
+ */
+void set_compact_textures_enabled(bool compact_textures_enabled) {
+  context.compact_textures_enabled = compact_textures_enabled;
+}
+
+/**
+ * \brief Returns whether the final pass may run at a reduced resolution under load.
+ * \return \c true if dynamic resolution is enabled.
+ */
+bool is_dynamic_resolution_enabled() {
+  return context.dynamic_resolution.is_enabled();
+}
+
+/**
+ * \brief Sets whether the final pass may run at a reduced resolution under load.
+ *
+ * Only the shader or the scaling of the video mode is affected:
+ * the quest surface keeps its size.
+ *
+ * \param enabled \c true to enable dynamic resolution.
+ */
+void set_dynamic_resolution_enabled(bool enabled) {
+
+  context.dynamic_resolution.set_enabled(enabled);
+  if (!enabled) {
+    context.dynamic_resolution_surface = nullptr;
+  }
+  context.screen_outdated = true;
+}
+
+/**
+ * \brief Returns the current scale of the final pass.
+ * \return The scale, 1.0 if the resolution is not reduced.
+ */
+double get_dynamic_resolution_scale() {
+  return context.dynamic_resolution.get_scale();
+}
+
+/**
+ * \brief Notifies the dynamic resolution of the cost of a frame.
+ *
+ * Time spent waiting for the display in present() is not counted.
+ *
+ * \param frame_time Duration of the frame in milliseconds.
+ * \param drawn \c false if the frame was not drawn, in which case it is
+ * not counted.
+ * \param budget Time available for a frame in milliseconds.
+ */
+void update_dynamic_resolution(double frame_time, bool drawn, double budget) {
+
+  const double work_time = std::max(0.0, frame_time - context.present_time);
+  context.present_time = 0.0;
+  if (!drawn) {
+    return;
+  }
+
+  const double previous_scale = context.dynamic_resolution.get_scale();
+  context.dynamic_resolution.add_frame(work_time, budget);
+  if (context.dynamic_resolution.get_scale() != previous_scale) {
+    context.screen_outdated = true;
+  }
+}
+
+/**
+ * \brief Sets how presented frames are synchronized with the display.
+ *
+ * With "adaptive", frames are synchronized but a late frame is presented
+ * immediately instead of waiting for the next refresh, if supported.
+ * The SDL renderer only supports "on" and "off" (SDL 2.0.18 or later)
+ * and keeps its default with "adaptive".
+ *
+ * \param vsync "on", "adaptive" or "off".
+ */
+void set_vsync(const std::string& vsync) {
+
+  context.vsync = vsync;
+  if (context.main_renderer == nullptr) {
+    // Applied when the renderer is created.
+    return;
+  }
+
+  if (context.shaders_enabled) {
+    if (vsync == "off") {
+      SDL_GL_SetSwapInterval(0);
+    }
+    else if (vsync == "on" || SDL_GL_SetSwapInterval(-1) == -1) {
+      SDL_GL_SetSwapInterval(1);
+    }
+  }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (vsync != "adaptive") {
+    SDL_RenderSetVSync(context.main_renderer, vsync == "on" ? 1 : 0);
+  }
+#endif
 }
 
 /**
@@ -553,7 +1019,14 @@ void set_fullscreen(bool fullscreen) {
   }
   context.fullscreen_window = fullscreen;
 
+  if (!context.window_shown) {
+    // Applied when showing the window.
+    Logger::info(std::string("Fullscreen: ") + (fullscreen ? "yes" : "no"));
+    return;
+  }
+
   SDL_SetWindowFullscreen(context.main_window, fullscreen_flag);
+  invalidate_screen();
 
   Logger::info(std::string("Fullscreen: ") + (fullscreen ? "yes" : "no"));
 }
@@ -577,6 +1050,14 @@ void set_cursor_visible(bool cursor_visible) {
   Logger::info(std::string("Cursor visible: ") + (cursor_visible ? "yes" : "no"));
 }
 
+/**
+ * \brief Returns whether OpenGL shaders are supported.
+ * \return \c true if shaders can be created.
+ */
+bool are_shaders_enabled() {
+  return context.shaders_enabled;
+}
+
 /**
  * \brief Returns the current shader applied to the rendering if any.
  * \return The current shader or nullptr.
@@ -592,6 +1073,7 @@ const ShaderPtr& get_shader() {
 void set_shader(const ShaderPtr& shader) {
 
   context.current_shader = shader;
+  invalidate_screen();
 
   if (shader != nullptr) {
     Logger::info("Shader: " + shader->get_id());
@@ -601,6 +1083,30 @@ void set_shader(const ShaderPtr& shader) {
   }
 }
 
+/**
+ * \brief Returns the shaders applied to the quest surface before the current shader.
+ * \return The post-processing passes in order.
+ */
+const std::vector<PostProcessChain::Pass>& get_post_process_passes() {
+  return context.post_process_chain.get_passes();
+}
+
+/**
+ * \brief Sets the shaders applied to the quest surface before the current shader.
+ *
+ * Each pass renders into a pooled target of its own scale,
+ * so effects can be chained without intermediate surfaces from Lua.
+ *
+ * \param passes The post-processing passes in order, or an empty list.
+ */
+void set_post_process_passes(const std::vector<PostProcessChain::Pass>& passes) {
+
+  context.post_process_chain.set_passes(passes);
+  invalidate_screen();
+
+  Logger::info("Post-processing passes: " + std::to_string(passes.size()));
+}
+
 /**
  * \brief Returns the current text of the window title bar.
  * \return The window title.
@@ -702,14 +1208,28 @@ bool set_video_mode(const SoftwareVideoMode& mode) {
   }
 
   context.video_mode = &mode;
+  invalidate_screen();
   if (!context.disable_window) {
 
     context.scaled_surface = nullptr;
+    context.video_mode_shader = nullptr;
 
     Size render_size = context.quest_size;
 
+    if (context.shaders_enabled && !mode.get_shader_source().empty()) {
+      // Scale on the GPU, the software filter is only a fallback.
+      context.video_mode_shader = ShaderContext::create_built_in_shader(
+          mode.get_name(), mode.get_shader_source());
+      if (!context.video_mode_shader->is_valid()) {
+        Logger::warning("Cannot scale video mode '" + mode.get_name() +
+            "' on the GPU, using the software filter. " +
+            context.video_mode_shader->get_error());
+        context.video_mode_shader = nullptr;
+      }
+    }
+
     const SoftwarePixelFilter* software_filter = mode.get_software_filter();
-    if (software_filter != nullptr) {
+    if (software_filter != nullptr && context.video_mode_shader == nullptr) {
       int factor = software_filter->get_scaling_factor();
       render_size = context.quest_size * factor;
       context.scaled_surface = Surface::create(render_size);
@@ -779,6 +1299,7 @@ const SoftwareVideoMode* get_video_mode_by_name(
  * It does not include the window decorations if any.
  *
  * In fullscreen mode, returns the size the window would have in windowed mode.
+ * Before the window is shown, returns the size it will have.
  *
  * \return The size of the window in pixels.
  */
@@ -786,7 +1307,7 @@ Size get_window_size() {
 
   Debug::check_assertion(context.main_window != nullptr, "No window");
 
-  if (is_fullscreen()) {
+  if (is_fullscreen() || !context.window_shown) {
     // Returns the memorized window size.
     return context.window_size;
   }
@@ -806,6 +1327,7 @@ Size get_window_size() {
  * It does not include the window decorations if any.
  *
  * In fullscreen mode, sets the size the window should have in windowed mode.
+ * Before the window is shown, the size is applied when showing it.
  *
  * \param size The size of the window in pixels.
  */
@@ -817,8 +1339,9 @@ void set_window_size(const Size& size) {
       "Wrong window size"
   );
 
-  if (is_fullscreen()) {
-    // Store the size to remember it during fullscreen.
+  if (is_fullscreen() || !context.window_shown) {
+    // Store the size to remember it during fullscreen
+    // or until the window is shown.
     context.window_size = size;
   }
   else {
@@ -18,6 +18,7 @@
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/Entities.h"
@@ -53,7 +54,9 @@ Hero::BackToSolidGroundState::BackToSolidGroundState(
 
   if (use_specified_position && !hero.get_target_solid_ground_callback().is_empty()) {
     // go back to a target position specified earlier
-    this->target_position = hero.get_target_solid_ground_callback();
+    // (the hero keeps its callback, so make another ref of it)
+    hero.get_target_solid_ground_callback().push();
+    this->target_position = hero.get_lua_context()->create_ref();
   }
   else {
     // just go back to the last solid ground location
@@ -95,15 +98,13 @@ void Hero::BackToSolidGroundState::start(const State* previous_state) {
     lua_pop(l, 3);
   }
 
-  hero.set_movement(std::make_shared<TargetMovement>(
+  hero.set_movement(make_recycled_shared<TargetMovement>(
       nullptr, xy.x, xy.y, 144, true
   ));
   get_entities().set_entity_layer(hero, layer);
 
-  const std::set<std::shared_ptr<Boomerang>>& boomerangs =
-      get_entities().get_entities_by_type<Boomerang>();
-  for (const std::shared_ptr<Boomerang>& boomerang : boomerangs) {
-    boomerang->remove_from_map();
+  for (Boomerang& boomerang : get_entities().get_entities_by_type<Boomerang>()) {
+    boomerang.remove_from_map();
   }
 }
 
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/hero/ForcedWalkingState.h"
 #include "solarus/hero/HeroSprites.h"
 #include "solarus/movements/PathMovement.h"
@@ -37,7 +38,7 @@ Hero::ForcedWalkingState::ForcedWalkingState(
     bool ignore_obstacles):
 
   HeroState(hero, "forced walking"),
-  movement(std::make_shared<PathMovement>(
+  movement(make_recycled_shared<PathMovement>(
       path, hero.get_walking_speed(), loop, ignore_obstacles, false
   )) {
 
@@ -27,6 +27,7 @@
 #include "solarus/graphics/SpriteAnimationSet.h"
 #include "solarus/lua/LuaContext.h"
 #include <sstream>
+#include <utility>
 #include <lua.hpp>
 
 namespace Solarus {
@@ -813,11 +814,16 @@ void HeroSprites::update() {
   SpritePtr sword_sprite = this->sword_sprite;
 
   // Update the frames.
+  // Sprites synchronized to the tunic take its frame in their own update():
+  // only force it when they could not, to keep their timing otherwise.
   tunic_sprite->update();
+  const int tunic_frame = tunic_sprite->get_current_frame();
 
   if (is_sword_visible()) {
     sword_sprite->update();
-    sword_sprite->set_current_frame(tunic_sprite->get_current_frame());
+    if (sword_sprite->get_current_frame() != tunic_frame) {
+      sword_sprite->set_current_frame(tunic_frame);
+    }
     hero.check_collision_with_detectors(*sword_sprite);
   }
   hero.check_collision_with_detectors(*tunic_sprite);
@@ -829,8 +835,8 @@ void HeroSprites::update() {
 
   if (is_shield_visible()) {
     shield_sprite->update();
-    if (walking) {
-      shield_sprite->set_current_frame(tunic_sprite->get_current_frame());
+    if (walking && shield_sprite->get_current_frame() != tunic_frame) {
+      shield_sprite->set_current_frame(tunic_frame);
     }
   }
 
@@ -861,16 +867,19 @@ void HeroSprites::update() {
  */
 void HeroSprites::draw_on_map() {
 
-  int x = hero.get_x();
-  int y = hero.get_y();
+  const Point& xy = hero.get_interpolated_xy();
+  int x = xy.x;
+  int y = xy.y;
 
   Map& map = hero.get_map();
 
+  // Layers are drawn in a row on the camera surface: the sprite batch
+  // merges them into one draw call when their images share an atlas page.
   if (hero.is_shadow_visible()) {
     map.draw_visual(*shadow_sprite, x, y, clipping_rectangle);
   }
 
-  const Point& displayed_xy = hero.get_displayed_xy();
+  const Point& displayed_xy = hero.get_interpolated_displayed_xy();
   x = displayed_xy.x;
   y = displayed_xy.y;
 
@@ -1510,10 +1519,10 @@ void HeroSprites::set_tunic_animation(const std::string& animation) {
  */
 void HeroSprites::set_tunic_animation(
     const std::string& animation,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
 
-  this->animation_callback_ref = callback_ref;
+  this->animation_callback_ref = std::move(callback_ref);
 
   tunic_sprite->set_current_animation(animation);
 }
@@ -1547,11 +1556,11 @@ void HeroSprites::set_animation(const std::string& animation) {
  */
 void HeroSprites::set_animation(
     const std::string& animation,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
 
   if (tunic_sprite->has_animation(animation)) {
-    set_tunic_animation(animation, callback_ref);
+    set_tunic_animation(animation, std::move(callback_ref));
   }
   else {
     Debug::error("Sprite '" + tunic_sprite->get_animation_set_id() + "': Animation '" + animation + "' not found.");
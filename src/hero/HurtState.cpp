@@ -18,6 +18,7 @@
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -71,7 +72,7 @@ void Hero::HurtState::start(const State* previous_state) {
   if (has_source) {
     double angle = Geometry::get_angle(source_xy, hero.get_xy());
     std::shared_ptr<StraightMovement> movement =
-        std::make_shared<StraightMovement>(false, true);
+        make_recycled_shared<StraightMovement>(false, true);
     movement->set_max_distance(24);
     movement->set_speed(120);
     movement->set_angle(angle);
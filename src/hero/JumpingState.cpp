@@ -18,6 +18,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/hero/CarryingState.h"
 #include "solarus/hero/FreeState.h"
@@ -50,7 +51,7 @@ Hero::JumpingState::JumpingState(
     carried_object = hero.get_carried_object();
   }
 
-  this->movement = std::make_shared<JumpMovement>(
+  this->movement = make_recycled_shared<JumpMovement>(
       direction8, distance, 0, ignore_obstacles
   );
   this->direction8 = direction8;
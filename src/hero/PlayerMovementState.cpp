@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Jumper.h"
 #include "solarus/entities/Stream.h"
@@ -82,7 +83,7 @@ void Hero::PlayerMovementState::start(const State* previous_state) {
 
   HeroState::start(previous_state);
 
-  player_movement = std::make_shared<PlayerMovement>(
+  player_movement = make_recycled_shared<PlayerMovement>(
       hero.get_walking_speed()
   );
   hero.set_movement(player_movement);
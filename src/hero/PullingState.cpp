@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/GrabbingState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -103,7 +104,7 @@ void Hero::PullingState::update() {
           std::string path = "  ";
           path[0] = path[1] = '0' + opposite_direction8;
 
-          pulling_movement = std::make_shared<PathMovement>(
+          pulling_movement = make_recycled_shared<PathMovement>(
               path, 40, false, false, false
           );
           hero.set_movement(pulling_movement);
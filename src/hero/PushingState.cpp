@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/GrabbingState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -106,7 +107,7 @@ void Hero::PushingState::update() {
           std::string path = "  ";
           path[0] = path[1] = '0' + pushing_direction4 * 2;
 
-          pushing_movement = std::make_shared<PathMovement>(
+          pushing_movement = make_recycled_shared<PathMovement>(
               path, 40, false, false, false
           );
           hero.set_movement(pushing_movement);
@@ -20,6 +20,7 @@
 #include "solarus/core/GameCommands.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -101,7 +102,7 @@ void Hero::RunningState::update() {
 
       double angle = Geometry::degrees_to_radians(get_sprites().get_animation_direction() * 90);
       std::shared_ptr<StraightMovement> movement =
-          std::make_shared<StraightMovement>(false, true);
+          make_recycled_shared<StraightMovement>(false, true);
       movement->set_max_distance(3000);
       movement->set_speed(300);
       movement->set_angle(angle);
@@ -176,7 +177,7 @@ void Hero::RunningState::notify_obstacle_reached() {
 
   if (phase == 1) {
     int opposite_direction = (get_sprites().get_animation_direction8() + 4) % 8;
-    get_entity().set_movement(std::make_shared<JumpMovement>(
+    get_entity().set_movement(make_recycled_shared<JumpMovement>(
         opposite_direction, 32, 64, false
     ));
     get_sprites().set_animation_hurt();
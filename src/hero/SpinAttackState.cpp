@@ -19,6 +19,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/entities/Enemy.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -57,7 +58,7 @@ void Hero::SpinAttackState::start(const State* previous_state) {
   if (get_equipment().has_ability(Ability::SWORD_KNOWLEDGE)) {
     get_sprites().set_animation_super_spin_attack();
     std::shared_ptr<CircleMovement> movement =
-        std::make_shared<CircleMovement>(false);
+        make_recycled_shared<CircleMovement>(false);
     movement->set_center(hero.get_xy());
     movement->set_radius_speed(128);
     movement->set_radius(24);
@@ -264,7 +265,7 @@ void Hero::SpinAttackState::notify_attacked_enemy(
     being_pushed = true;
     double angle = victim.get_angle(hero, victim_sprite, nullptr);
     std::shared_ptr<StraightMovement> movement =
-        std::make_shared<StraightMovement>(false, true);
+        make_recycled_shared<StraightMovement>(false, true);
     movement->set_max_distance(24);
     movement->set_speed(120);
     movement->set_angle(angle);
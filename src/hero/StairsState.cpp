@@ -20,6 +20,7 @@
 #include "solarus/core/Logger.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/Point.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/Teletransporter.h"
@@ -81,7 +82,7 @@ void Hero::StairsState::start(const State* previous_state) {
   // movement
   int speed = stairs->is_inside_floor() ? 40 : 24;
   std::string path = stairs->get_path(way);
-  std::shared_ptr<PathMovement> movement = std::make_shared<PathMovement>(
+  std::shared_ptr<PathMovement> movement = make_recycled_shared<PathMovement>(
       path, speed, false, true, false
   );
 
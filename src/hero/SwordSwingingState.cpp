@@ -17,6 +17,7 @@
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/entities/Enemy.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -230,7 +231,7 @@ void Hero::SwordSwingingState::notify_attacked_enemy(
       Hero& hero = get_entity();
       double angle = victim.get_angle(hero, victim_sprite, nullptr);
       std::shared_ptr<StraightMovement> movement =
-          std::make_shared<StraightMovement>(false, true);
+          make_recycled_shared<StraightMovement>(false, true);
       movement->set_max_distance(24);
       movement->set_speed(120);
       movement->set_angle(angle);
@@ -19,6 +19,7 @@
 #include "solarus/core/GameCommands.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Enemy.h"
 #include "solarus/hero/FreeState.h"
@@ -210,7 +211,7 @@ void Hero::SwordTappingState::notify_attacked_enemy(
     Hero& hero = get_entity();
     double angle = victim.get_angle(hero, victim_sprite, nullptr);
     std::shared_ptr<StraightMovement> movement =
-        std::make_shared<StraightMovement>(false, true);
+        make_recycled_shared<StraightMovement>(false, true);
     movement->set_max_distance(24);
     movement->set_speed(120);
     movement->set_angle(angle);
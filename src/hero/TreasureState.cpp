@@ -25,6 +25,7 @@
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
 #include <string>
+#include <utility>
 
 namespace Solarus {
 
@@ -38,13 +39,13 @@ namespace Solarus {
 Hero::TreasureState::TreasureState(
     Hero& hero,
     const Treasure& treasure,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ):
 
   HeroState(hero, "treasure"),
   treasure(treasure),
   treasure_sprite(),
-  callback_ref(callback_ref) {
+  callback_ref(std::move(callback_ref)) {
 
   treasure.check_obtainable();
   treasure_sprite = treasure.create_sprite();
@@ -72,8 +73,7 @@ void Hero::TreasureState::start(const State* previous_state) {
   treasure.give_to_player();
 
   // Show a dialog (Lua does the job after this).
-  ScopedLuaRef callback_ref = this->callback_ref;
-  this->callback_ref.clear();
+  ScopedLuaRef callback_ref = std::move(this->callback_ref);
   get_lua_context().notify_hero_brandish_treasure(treasure, callback_ref);
 }
 
@@ -108,16 +108,16 @@ void Hero::TreasureState::draw_on_map() {
   HeroState::draw_on_map();
 
   const Hero& hero = get_entity();
-  int x = hero.get_x();
-  int y = hero.get_y();
+  const Point& xy = hero.get_interpolated_xy();
 
-  const CameraPtr& camera = get_map().get_camera();
+  const CameraPtr& camera = get_map().get_drawing_camera();
   if (camera == nullptr) {
     return;
   }
+  const Point& camera_xy = camera->get_interpolated_top_left_xy();
   treasure_sprite->draw(get_map().get_camera_surface(),
-      x - camera->get_top_left_x(),
-      y - 24 - camera->get_top_left_y());
+      xy.x - camera_xy.x,
+      xy.y - 24 - camera_xy.y);
 }
 
 /**
@@ -23,6 +23,7 @@
 #include "solarus/hero/VictoryState.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
+#include <utility>
 
 namespace Solarus {
 
@@ -32,11 +33,11 @@ namespace Solarus {
  * \param callback_ref Lua ref to a function to call when the
  * victory sequence finishes (possibly an empty ref).
  */
-Hero::VictoryState::VictoryState(Hero& hero, const ScopedLuaRef& callback_ref):
+Hero::VictoryState::VictoryState(Hero& hero, ScopedLuaRef callback_ref):
   HeroState(hero, "victory"),
   end_victory_date(0),
   finished(false),
-  callback_ref(callback_ref) {
+  callback_ref(std::move(callback_ref)) {
 
 }
 
@@ -20,6 +20,7 @@
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -91,10 +92,25 @@ int LuaContext::audio_api_play_sound(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     const std::string& sound_id = LuaTools::check_string(l, 1);
 
+    Sound::PlayOptions options;
+    if (!lua_isnoneornil(l, 2)) {
+      LuaTools::check_type(l, 2, LUA_TTABLE);
+      options.priority = LuaTools::opt_int_field(l, 2, "priority", 0);
+      options.max_instances = LuaTools::opt_int_field(l, 2, "max_instances", 0);
+      if (options.max_instances < 0) {
+        LuaTools::arg_error(l, 2, "max_instances must be positive or zero");
+      }
+      const int volume = LuaTools::opt_int_field(l, 2, "volume", 100);
+      if (volume < 0 || volume > 100) {
+        LuaTools::arg_error(l, 2, "volume must be between 0 and 100");
+      }
+      options.volume = volume / 100.0f;
+    }
+
     if (!Sound::exists(sound_id)) {
       LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
     }
-    Sound::play(sound_id);
+    Sound::play(sound_id, options);
 
     return 0;
   });
@@ -108,7 +124,24 @@ int LuaContext::audio_api_play_sound(lua_State* l) {
 int LuaContext::audio_api_preload_sounds(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
-    Sound::load_all();
+    if (lua_isnoneornil(l, 1)) {
+      Sound::load_all();
+      return 0;
+    }
+
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+    std::vector<std::string> sound_ids;
+    lua_pushnil(l);  // first key
+    while (lua_next(l, 1) != 0) {
+      const std::string& sound_id = LuaTools::check_string(l, 3);
+      if (!Sound::exists(sound_id)) {
+        LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
+      }
+      sound_ids.push_back(sound_id);
+      lua_pop(l, 1);  // pop the value, let the key for the iteration
+    }
+    Sound::preload(sound_ids);
+
     return 0;
   });
 }
@@ -176,7 +209,7 @@ int LuaContext::audio_api_play_music(lua_State* l) {
       }
 
       // Valid music file name.
-      Music::play(music_id, loop, callback_ref);
+      Music::play(music_id, loop, std::move(callback_ref));
     }
     return 0;
   });
@@ -39,12 +39,13 @@ namespace Solarus {
 bool LuaContext::is_drawable(lua_State* l, int index) {
   return is_surface(l, index)
       || is_text_surface(l, index)
-      || is_sprite(l, index);
+      || is_sprite(l, index)
+      || is_particle_emitter(l, index);
 }
 
 /**
  * \brief Check that the userdata at the specified index is a drawable
- * object (surface, text surface of sprite) and returns it.
+ * object (surface, text surface, sprite or particle emitter) and returns it.
  * \param l a Lua context
  * \param index an index in the stack
  * \return The drawable.
@@ -70,7 +71,7 @@ DrawablePtr LuaContext::check_drawable(lua_State* l, int index) {
  */
 bool LuaContext::has_drawable(const DrawablePtr& drawable) {
 
-  return drawables.find(drawable) != drawables.end();
+  return drawable_indexes.find(drawable.get()) != drawable_indexes.end();
 }
 
 /**
@@ -82,7 +83,8 @@ void LuaContext::add_drawable(const DrawablePtr& drawable) {
   Debug::check_assertion(!has_drawable(drawable),
       "This drawable object is already registered");
 
-  drawables.insert(drawable);
+  drawable_indexes.emplace(drawable.get(), drawables.size());
+  drawables.push_back(drawable);
 }
 
 /**
@@ -94,7 +96,7 @@ void LuaContext::remove_drawable(const DrawablePtr& drawable) {
   Debug::check_assertion(has_drawable(drawable),
       "This drawable object was not created by Lua");
 
-  drawables_to_remove.insert(drawable);
+  drawables_to_remove.push_back(drawable);
 }
 
 /**
@@ -103,24 +105,71 @@ void LuaContext::remove_drawable(const DrawablePtr& drawable) {
 void LuaContext::destroy_drawables() {
 
   drawables.clear();
+  drawable_indexes.clear();
   drawables_to_remove.clear();
 }
 
+/**
+ * \brief Returns the number of drawable objects currently registered.
+ *
+ * A number that keeps growing shows drawables kept alive by scripts.
+ *
+ * \return The number of drawables created by Lua and not removed yet.
+ */
+int LuaContext::get_num_drawables() const {
+  return static_cast<int>(drawables.size());
+}
+
+/**
+ * \brief Updates a drawable object created by this script if
+ * update_drawables() skips it.
+ *
+ * This brings sprites that are not updated at each cycle up to date
+ * before they are drawn or used.
+ * Drawables not created by this script, like sprites of entities,
+ * are updated by their owner and are left unchanged.
+ *
+ * \param drawable A drawable object.
+ */
+void LuaContext::update_skipped_drawable(Drawable& drawable) {
+
+  if (!drawable.needs_update() &&
+      drawable_indexes.find(&drawable) != drawable_indexes.end()) {
+    drawable.update();
+  }
+}
+
 /**
  * \brief Updates all drawable objects created by this script.
+ *
+ * Static drawables without movement or transition are skipped,
+ * as well as sprites that nobody observes frame by frame.
  */
 void LuaContext::update_drawables() {
 
   // Update all drawables.
-  for (const DrawablePtr& drawable: drawables) {
-    if (has_drawable(drawable)) {
-      drawable->update();
+  // Callbacks may create new drawables: they are added at the end.
+  for (size_t i = 0; i < drawables.size(); ++i) {
+    Drawable& drawable = *drawables[i];
+    if (drawable.needs_update()) {
+      drawable.update();
     }
   }
 
   // Remove the ones that should be removed.
   for (const DrawablePtr& drawable: drawables_to_remove) {
-    drawables.erase(drawable);
+    const auto it = drawable_indexes.find(drawable.get());
+    if (it == drawable_indexes.end()) {
+      continue;
+    }
+    // Move the last one to the removed place.
+    const size_t index = it->second;
+    drawable_indexes.erase(it);
+    if (index != drawables.size() - 1) {
+      drawables[index] = std::move(drawables.back());
+      drawable_indexes[drawables[index].get()] = index;
+    }
+    drawables.pop_back();
   }
   drawables_to_remove.clear();
 }
@@ -133,11 +182,18 @@ void LuaContext::update_drawables() {
 int LuaContext::drawable_api_draw(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
-    Drawable& drawable = *check_drawable(l, 1);
+    DrawablePtr drawable = check_drawable(l, 1);
     SurfacePtr dst_surface = check_surface(l, 2);
     int x = LuaTools::opt_int(l, 3, 0);
     int y = LuaTools::opt_int(l, 4, 0);
-    drawable.draw(dst_surface, x, y);
+    LuaContext& lua_context = get_lua_context(l);
+    lua_context.update_skipped_drawable(*drawable);
+    drawable->draw(dst_surface, x, y);
+
+    DrawList* draw_recording = lua_context.get_draw_recording(*dst_surface);
+    if (draw_recording != nullptr) {
+      draw_recording->add_draw(drawable, Point(x, y));
+    }
 
     return 0;
   });
@@ -151,7 +207,7 @@ int LuaContext::drawable_api_draw(lua_State* l) {
 int LuaContext::drawable_api_draw_region(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
-    Drawable& drawable = *check_drawable(l, 1);
+    DrawablePtr drawable = check_drawable(l, 1);
     Rectangle region = {
         LuaTools::check_int(l, 2),
         LuaTools::check_int(l, 3),
@@ -163,7 +219,14 @@ int LuaContext::drawable_api_draw_region(lua_State* l) {
         LuaTools::opt_int(l, 7, 0),
         LuaTools::opt_int(l, 8, 0)
     };
-    drawable.draw_region(region, dst_surface, dst_position);
+    LuaContext& lua_context = get_lua_context(l);
+    lua_context.update_skipped_drawable(*drawable);
+    drawable->draw_region(region, dst_surface, dst_position);
+
+    DrawList* draw_recording = lua_context.get_draw_recording(*dst_surface);
+    if (draw_recording != nullptr) {
+      draw_recording->add_draw_region(drawable, region, dst_position);
+    }
 
     return 0;
   });
@@ -309,7 +372,7 @@ int LuaContext::drawable_api_fade_in(lua_State* l) {
     transition->set_delay(delay);
     drawable.start_transition(
         std::unique_ptr<Transition>(transition),
-        callback_ref
+        std::move(callback_ref)
     );
 
     return 0;
@@ -347,7 +410,7 @@ int LuaContext::drawable_api_fade_out(lua_State* l) {
     transition->set_delay(delay);
     drawable.start_transition(
         std::unique_ptr<Transition>(transition),
-        callback_ref
+        std::move(callback_ref)
     );
 
     return 0;
@@ -388,6 +451,139 @@ int LuaContext::drawable_api_set_xy(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of drawable:get_rotation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_get_rotation(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Drawable& drawable = *check_drawable(l, 1);
+
+    lua_pushnumber(l, drawable.get_rotation());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:set_rotation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_set_rotation(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Drawable& drawable = *check_drawable(l, 1);
+    double rotation = LuaTools::check_number(l, 2);
+
+    drawable.set_rotation(rotation);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:get_scale().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_get_scale(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Drawable& drawable = *check_drawable(l, 1);
+
+    lua_pushnumber(l, drawable.get_scale_x());
+    lua_pushnumber(l, drawable.get_scale_y());
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:set_scale().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_set_scale(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Drawable& drawable = *check_drawable(l, 1);
+    double scale_x = LuaTools::check_number(l, 2);
+    double scale_y = LuaTools::opt_number(l, 3, scale_x);
+
+    drawable.set_scale(scale_x, scale_y);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:get_transformation_origin().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_get_transformation_origin(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Drawable& drawable = *check_drawable(l, 1);
+
+    const Point& origin = drawable.get_transformation_origin();
+    lua_pushinteger(l, origin.x);
+    lua_pushinteger(l, origin.y);
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:set_transformation_origin().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_set_transformation_origin(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Drawable& drawable = *check_drawable(l, 1);
+    int x = LuaTools::check_int(l, 2);
+    int y = LuaTools::check_int(l, 3);
+
+    drawable.set_transformation_origin(Point(x, y));
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:get_color_modulation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_get_color_modulation(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Drawable& drawable = *check_drawable(l, 1);
+
+    push_color(l, drawable.get_color_modulation());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of drawable:set_color_modulation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::drawable_api_set_color_modulation(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Drawable& drawable = *check_drawable(l, 1);
+    const Color& color = LuaTools::check_color(l, 2);
+
+    drawable.set_color_modulation(color);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of drawable:get_movement().
  * \param l The Lua context that is calling this function.
@@ -52,11 +52,17 @@
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
 namespace {
 
+/**
+ * \brief Name of the metatable of entity lists used by iterators.
+ */
+const char* const entity_list_metatable_name = "sol.entity_list";
+
 /**
  * \brief Returns the Lua metatable names of each entity type.
  * \return The Lua metatable name of each entity types.
@@ -73,20 +79,109 @@ const std::map<EntityType, std::string>& get_entity_internal_type_names() {
 
   return result;
 }
+
 /**
- * \brief Returns a set of the Lua metatable names of all entity types.
- * \return The Lua metatable name of all entity types.
+ * \brief Checks that a table field is an array of 4 integers {x, y, width, height}.
+ * \param l A Lua state.
+ * \param table_index Index of a table in the stack.
+ * \param key Key of the field.
+ * \param[out] rectangle The rectangle read.
+ * \return \c true if the field exists, \c false if it is nil.
  */
-const std::set<std::string>& get_entity_internal_type_names_set() {
+bool opt_rectangle_field(
+    lua_State* l,
+    int table_index,
+    const std::string& key,
+    Rectangle& rectangle
+) {
+  lua_getfield(l, table_index, key.c_str());
+  if (lua_isnil(l, -1)) {
+    lua_pop(l, 1);
+    return false;
+  }
+  if (!lua_istable(l, -1)) {
+    LuaTools::arg_error(l, table_index, std::string("Bad field '") + key +
+        "' (table expected, got " + luaL_typename(l, -1) + ")");
+  }
 
-  static std::set<std::string> result;
-  if (result.empty()) {
-    for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
-      result.insert(LuaContext::get_entity_internal_type_name(kvp.first));
+  int values[4];
+  for (int i = 0; i < 4; ++i) {
+    lua_rawgeti(l, -1, i + 1);
+    if (!lua_isnumber(l, -1)) {
+      LuaTools::arg_error(l, table_index, std::string("Bad field '") + key +
+          "' (expected {x, y, width, height})");
     }
+    values[i] = static_cast<int>(lua_tointeger(l, -1));
+    lua_pop(l, 1);
   }
+  lua_pop(l, 1);
+  rectangle = Rectangle(values[0], values[1], values[2], values[3]);
+  return true;
+}
 
-  return result;
+/**
+ * \brief Checks that a value is a table of collision rules and returns it.
+ * \param l A Lua state.
+ * \param index Index of a table in the stack.
+ * \param map The map of the custom entity.
+ * \return The collision rules.
+ */
+CustomEntity::CollisionRules check_collision_rules(
+    lua_State* l,
+    int index,
+    const Map& map
+) {
+  LuaTools::check_type(l, index, LUA_TTABLE);
+
+  CustomEntity::CollisionRules rules;
+  rules.mode = LuaTools::opt_enum_field<CollisionMode>(
+      l, index, "mode",
+      EnumInfoTraits<CollisionMode>::names_no_none_no_custom,
+      COLLISION_NONE
+  );
+  if (rules.mode == COLLISION_SPRITE) {
+    LuaTools::arg_error(l, index, "Collision rules cannot use mode 'sprite'");
+  }
+
+  lua_getfield(l, index, "entity_type");
+  if (lua_isstring(l, -1)) {
+    rules.entity_types.insert(LuaTools::check_enum<EntityType>(l, -1));
+  }
+  else if (lua_istable(l, -1)) {
+    const int num_types = static_cast<int>(lua_objlen(l, -1));
+    for (int i = 1; i <= num_types; ++i) {
+      lua_rawgeti(l, -1, i);
+      rules.entity_types.insert(LuaTools::check_enum<EntityType>(l, -1));
+      lua_pop(l, 1);
+    }
+  }
+  else if (!lua_isnil(l, -1)) {
+    LuaTools::arg_error(l, index, std::string(
+        "Bad field 'entity_type' (string or table expected, got ") +
+        luaL_typename(l, -1) + ")");
+  }
+  lua_pop(l, 1);
+
+  lua_getfield(l, index, "layer");
+  if (lua_type(l, -1) == LUA_TSTRING) {
+    if (std::string(lua_tostring(l, -1)) != "same") {
+      LuaTools::arg_error(l, index, "Bad field 'layer' (integer or \"same\" expected)");
+    }
+    rules.same_layer = true;
+  }
+  else if (!lua_isnil(l, -1)) {
+    if (!LuaTools::is_layer(l, -1, map)) {
+      LuaTools::arg_error(l, index, "Bad field 'layer' (integer or \"same\" expected)");
+    }
+    rules.has_layer = true;
+    rules.layer = static_cast<int>(lua_tointeger(l, -1));
+  }
+  lua_pop(l, 1);
+
+  rules.has_rectangle = opt_rectangle_field(l, index, "rectangle", rules.rectangle);
+  rules.ignore_same_group = LuaTools::opt_boolean_field(l, index, "ignore_group", false);
+
+  return rules;
 }
 
 }
@@ -120,6 +215,9 @@ void LuaContext::register_entity_module() {
       { "overlaps", entity_api_overlaps },
       { "get_distance", entity_api_get_distance },
       { "get_angle", entity_api_get_angle },
+      { "get_distances", entity_api_get_distances },
+      { "get_angles", entity_api_get_angles },
+      { "play_sound", entity_api_play_sound },
       { "get_direction4_to", entity_api_get_direction4_to },
       { "get_direction8_to", entity_api_get_direction8_to },
       { "snap_to_grid", entity_api_snap_to_grid },
@@ -127,6 +225,9 @@ void LuaContext::register_entity_module() {
       { "bring_to_back", entity_api_bring_to_back },
       { "get_optimization_distance", entity_api_get_optimization_distance },
       { "set_optimization_distance", entity_api_set_optimization_distance },
+      { "is_always_active", entity_api_is_always_active },
+      { "set_always_active", entity_api_set_always_active },
+      { "is_dormant", entity_api_is_dormant },
       { "is_in_same_region", entity_api_is_in_same_region },
       { "test_obstacles", entity_api_test_obstacles },
       { "get_sprite", entity_api_get_sprite },
@@ -145,7 +246,8 @@ void LuaContext::register_entity_module() {
         { "get_property", entity_api_get_property },
         { "set_property", entity_api_set_property },
         { "get_properties", entity_api_get_properties },
-        { "set_properties", entity_api_set_properties }
+        { "set_properties", entity_api_set_properties },
+        { "wait_movement", entity_api_wait_movement }
     });
   }
 
@@ -494,6 +596,10 @@ void LuaContext::register_entity_module() {
       { "set_can_traverse_ground", custom_entity_api_set_can_traverse_ground },
       { "add_collision_test", custom_entity_api_add_collision_test },
       { "clear_collision_tests", custom_entity_api_clear_collision_tests },
+      { "get_collision_group", custom_entity_api_get_collision_group },
+      { "set_collision_group", custom_entity_api_set_collision_group },
+      { "is_traversable_cache_enabled", custom_entity_api_is_traversable_cache_enabled },
+      { "set_traversable_cache_enabled", custom_entity_api_set_traversable_cache_enabled },
       { "has_layer_independent_collisions", entity_api_has_layer_independent_collisions },
       { "set_layer_independent_collisions", entity_api_set_layer_independent_collisions },
       { "get_modified_ground", custom_entity_api_get_modified_ground },
@@ -525,6 +631,20 @@ void LuaContext::register_entity_module() {
   register_type(get_entity_internal_type_name(EntityType::ARROW), {}, common_methods, metamethods);
   register_type(get_entity_internal_type_name(EntityType::HOOKSHOT), {}, common_methods, metamethods);
   register_type(get_entity_internal_type_name(EntityType::BOOMERANG), {}, common_methods, metamethods);
+
+  // Mark entity metatables to recognize entities quickly.
+  for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
+    luaL_getmetatable(l, get_entity_internal_type_name(kvp.first).c_str());
+    lua_pushboolean(l, true);
+    lua_setfield(l, -2, "__solarus_entity");
+    lua_pop(l, 1);
+  }
+
+  // Metatable of the entity lists kept by iterators.
+  luaL_newmetatable(l, entity_list_metatable_name);
+  lua_pushcfunction(l, l_entity_list_gc);
+  lua_setfield(l, -2, "__gc");
+  lua_pop(l, 1);
 }
 
 /**
@@ -549,20 +669,13 @@ bool LuaContext::is_entity(lua_State* l, int index) {
     return false;
   }
 
-  // Get the name of the Solarus type from this userdata.
-  lua_pushstring(l, "__solarus_type");
+  // Entity metatables have a special marker field.
+  lua_pushliteral(l, "__solarus_entity");
   lua_rawget(l, -2);
-  if (!lua_isstring(l, -1)) {
-    // This is probably a userdata from some library other than Solarus.
-    lua_pop(l, 2);
-    return false;
-  }
-
-  // Check if the type name is one of the entity type names.
-  const std::string& type_name = lua_tostring(l, -1);
+  const bool result = lua_toboolean(l, -1);
   lua_pop(l, 2);
 
-  return get_entity_internal_type_names_set().find(type_name) != get_entity_internal_type_names_set().end();
+  return result;
 }
 
 /**
@@ -586,6 +699,32 @@ EntityPtr LuaContext::check_entity(lua_State* l, int index) {
   }
 }
 
+/**
+ * \brief Checks that an element of an array is an entity and returns it.
+ *
+ * Unlike check_entity(), no shared pointer is copied,
+ * which matters when processing many entities at once.
+ * The entity remains valid as long as the array contains it.
+ *
+ * \param l A Lua context.
+ * \param array_index Index of an array of entities in the stack.
+ * \param i Index of the element in the array, starting at 1.
+ * \return The entity.
+ */
+const Entity& LuaContext::check_entity_in_array(lua_State* l, int array_index, int i) {
+
+  lua_rawgeti(l, array_index, i);
+  if (!is_entity(l, -1)) {
+    LuaTools::arg_error(l, array_index, "entity expected at index " +
+        std::to_string(i) + ", got " + luaL_typename(l, -1));
+  }
+  const ExportableToLuaPtr& userdata = *(static_cast<ExportableToLuaPtr*>(
+      lua_touserdata(l, -1)
+  ));
+  lua_pop(l, 1);
+  return static_cast<const Entity&>(*userdata);
+}
+
 /**
  * \brief Pushes an entity userdata onto the stack.
  *
@@ -603,27 +742,38 @@ void LuaContext::push_entity(lua_State* l, Entity& entity) {
  * \brief Pushes a list of entities as an iterator onto the stack.
  *
  * The iterator is pushed onto the stack as one value of type function.
+ * The list is kept on the C++ side and entities are only pushed
+ * to Lua when the iterator reaches them.
  *
  * \param l A Lua context.
- * \param entity A list of entities. The iterator preserves their order.
+ * \param entities A list of entities. The iterator preserves their order.
  */
-void LuaContext::push_entity_iterator(lua_State* l, const EntityVector& entities) {
+void LuaContext::push_entity_iterator(lua_State* l, EntityVector entities) {
 
-  // Create a Lua table with the list of entities, preserving their order.
-  int i = 0;
-  lua_newtable(l);
-  for (const EntityPtr& entity: entities) {
-    ++i;
-    lua_pushinteger(l, i);
-    push_entity(l, *entity);
-    lua_rawset(l, -3);
-  }
+  // Move the list into a userdata owned by the closure.
+  EntityVector* block_address = static_cast<EntityVector*>(
+      lua_newuserdata(l, sizeof(EntityVector))
+  );
+  new (block_address) EntityVector(std::move(entities));
+  luaL_getmetatable(l, entity_list_metatable_name);
+  lua_setmetatable(l, -2);
 
-  lua_pushinteger(l, entities.size());
-  lua_pushinteger(l, 1);
-  // 3 upvalues: entities table, size, current index.
+  lua_pushinteger(l, 0);
+  // 2 upvalues: entity list, current index.
+
+  lua_pushcclosure(l, l_entity_iterator_next, 2);
+}
+
+/**
+ * \brief Finalizer of the entity list of an iterator.
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_entity_list_gc(lua_State* l) {
 
-  lua_pushcclosure(l, l_entity_iterator_next, 3);
+  EntityVector* entities = static_cast<EntityVector*>(lua_touserdata(l, 1));
+  entities->~EntityVector();
+  return 0;
 }
 
 /**
@@ -1257,6 +1407,116 @@ int LuaContext::entity_api_get_angle(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of entity:get_distances().
+ *
+ * Does the job of entity:get_distance() for an array of entities
+ * in one call.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_get_distances(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+    const int num_entities = static_cast<int>(lua_objlen(l, 2));
+
+    LuaTools::push_result_array(l, 3, num_entities);
+    const int result_index = lua_gettop(l);
+    for (int i = 1; i <= num_entities; ++i) {
+      const Entity& other_entity = check_entity_in_array(l, 2, i);
+      lua_pushinteger(l, entity.get_distance(other_entity));
+      lua_rawseti(l, result_index, i);
+    }
+    LuaTools::set_array_size(l, result_index, num_entities);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:get_angles().
+ *
+ * Does the job of entity:get_angle() for an array of entities
+ * in one call.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_get_angles(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+    const int num_entities = static_cast<int>(lua_objlen(l, 2));
+
+    LuaTools::push_result_array(l, 3, num_entities);
+    const int result_index = lua_gettop(l);
+    for (int i = 1; i <= num_entities; ++i) {
+      const Entity& other_entity = check_entity_in_array(l, 2, i);
+      lua_pushnumber(l, entity.get_angle(other_entity));
+      lua_rawseti(l, result_index, i);
+    }
+    LuaTools::set_array_size(l, result_index, num_entities);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:play_sound().
+ *
+ * The volume decreases with the distance between the entity and the visible
+ * part of the map. Sounds too far to be heard are not played at all,
+ * so they don't take an audio source.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_play_sound(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+    const std::string& sound_id = LuaTools::check_string(l, 2);
+
+    Sound::PlayOptions options;
+    int max_distance = entity.get_map().get_camera() != nullptr ?
+        entity.get_map().get_camera()->get_width() : 320;
+    if (!lua_isnoneornil(l, 3)) {
+      LuaTools::check_type(l, 3, LUA_TTABLE);
+      options.priority = LuaTools::opt_int_field(l, 3, "priority", 0);
+      options.max_instances = LuaTools::opt_int_field(l, 3, "max_instances", 0);
+      if (options.max_instances < 0) {
+        LuaTools::arg_error(l, 3, "max_instances must be positive or zero");
+      }
+      const int volume = LuaTools::opt_int_field(l, 3, "volume", 100);
+      if (volume < 0 || volume > 100) {
+        LuaTools::arg_error(l, 3, "volume must be between 0 and 100");
+      }
+      options.volume = volume / 100.0f;
+      max_distance = LuaTools::opt_int_field(l, 3, "max_distance", max_distance);
+      if (max_distance <= 0) {
+        LuaTools::arg_error(l, 3, "max_distance must be positive");
+      }
+    }
+
+    if (!Sound::exists(sound_id)) {
+      LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
+    }
+
+    const int distance = entity.get_distance_to_camera();
+    if (distance >= max_distance) {
+      lua_pushboolean(l, false);
+      return 1;
+    }
+
+    options.volume *= 1.0f - static_cast<float>(distance) / max_distance;
+    Sound::play(sound_id, options);
+    lua_pushboolean(l, true);
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of entity:get_direction4_to().
  * \param l The Lua context that is calling this function.
@@ -1547,6 +1807,41 @@ int LuaContext::entity_api_stop_movement(lua_State* l) {
   return 0;
 }
 
+/**
+ * \brief Implementation of entity:wait_movement().
+ *
+ * Suspends the running coroutine until the movement of the entity finishes.
+ * This replaces the callback of the movement.
+ * If the movement is stopped before finishing, the coroutine is never
+ * resumed.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_wait_movement(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    ScopedLuaRef resumer_ref = create_coroutine_resumer(l, "entity:wait_movement");
+
+    const std::shared_ptr<Movement>& movement = entity.get_movement();
+    if (movement == nullptr || movement->is_finished()) {
+      // Nothing to wait for.
+      return 0;
+    }
+    if (!movement->are_lua_notifications_enabled()) {
+      LuaTools::error(l, "The movement of this entity does not notify Lua");
+    }
+
+    if (movement->get_lua_context() == nullptr) {
+      movement->set_lua_context(&get_lua_context(l));
+    }
+    movement->set_finished_callback(std::move(resumer_ref));
+
+    return lua_yield(l, 0);
+  });
+}
+
 /**
  * \brief Implementation of
  * pickable:has_layer_independent_collisions() and
@@ -1642,6 +1937,53 @@ int LuaContext::entity_api_set_optimization_distance(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of entity:is_always_active().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_is_always_active(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    lua_pushboolean(l, entity.is_always_active());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:set_always_active().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_set_always_active(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    bool always_active = LuaTools::opt_boolean(l, 2, true);
+
+    entity.set_always_active(always_active);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of entity:is_dormant().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_is_dormant(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    lua_pushboolean(l, entity.is_dormant());
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of entity:is_in_same_region().
  * \param l The Lua context that is calling this function.
@@ -1944,7 +2286,7 @@ int LuaContext::hero_api_save_solid_ground(lua_State* l) {
       }
       callback = hero.make_solid_ground_callback(Point(x, y), layer);
     }
-    hero.set_target_solid_ground_callback(callback);
+    hero.set_target_solid_ground_callback(std::move(callback));
 
     return 0;
   });
@@ -2043,7 +2385,7 @@ int LuaContext::hero_api_set_animation(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     Hero& hero = *check_hero(l, 1);
     const std::string& animation = LuaTools::check_string(l, 2);
-    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 3);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 3);
 
     HeroSprites& sprites = hero.get_hero_sprites();
     if (!sprites.has_tunic_animation(animation)) {
@@ -2052,7 +2394,7 @@ int LuaContext::hero_api_set_animation(lua_State* l) {
       );
     }
 
-    sprites.set_animation(animation, callback_ref);
+    sprites.set_animation(animation, std::move(callback_ref));
 
     return 0;
   });
@@ -2410,9 +2752,9 @@ int LuaContext::hero_api_start_treasure(lua_State* l) {
       LuaTools::arg_error(l, 4, "This treasure is not obtainable");
     }
 
-    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 5);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 5);
 
-    hero.start_treasure(treasure, callback_ref);
+    hero.start_treasure(treasure, std::move(callback_ref));
 
     return 0;
   });
@@ -2429,7 +2771,7 @@ int LuaContext::hero_api_start_victory(lua_State* l) {
     Hero& hero = *check_hero(l, 1);
     ScopedLuaRef callback_ref = LuaTools::opt_function(l, 2);
 
-    hero.start_victory(callback_ref);
+    hero.start_victory(std::move(callback_ref));
 
     return 0;
   });
@@ -2572,19 +2914,19 @@ void LuaContext::notify_hero_brandish_treasure(
   push_string(l, treasure.get_savegame_variable());
   push_ref(l, callback_ref);
   lua_pushcclosure(l, l_treasure_brandish_finished, 4);
-  const ScopedLuaRef& treasure_callback_ref = create_ref();
+  ScopedLuaRef treasure_callback_ref = create_ref();
 
   if (!CurrentQuest::dialog_exists(dialog_id)) {
     // No treasure dialog: keep brandishing the treasure for some delay
     // and then execute the callback.
     TimerPtr timer = std::make_shared<Timer>(3000);
     push_map(l, game.get_current_map());
-    add_timer(timer, -1, treasure_callback_ref);
+    add_timer(timer, -1, std::move(treasure_callback_ref));
     lua_pop(l, 1);
   }
   else {
     // A treasure dialog exists. Show it and then execute the callback.
-    game.start_dialog(dialog_id, ScopedLuaRef(), treasure_callback_ref);
+    game.start_dialog(dialog_id, ScopedLuaRef(), std::move(treasure_callback_ref));
   }
 }
 
@@ -3843,12 +4185,12 @@ void LuaContext::notify_shop_treasure_interaction(ShopTreasure& shop_treasure) {
 
   push_shop_treasure(l, shop_treasure);
   lua_pushcclosure(l, l_shop_treasure_description_dialog_finished, 1);
-  const ScopedLuaRef& callback_ref = create_ref();
+  ScopedLuaRef callback_ref = create_ref();
 
   shop_treasure.get_game().start_dialog(
       shop_treasure.get_dialog_id(),
       ScopedLuaRef(),
-      callback_ref
+      std::move(callback_ref)
   );
 }
 
@@ -3879,7 +4221,7 @@ int LuaContext::l_shop_treasure_description_dialog_finished(lua_State* l) {
     lua_pushcclosure(l, l_shop_treasure_question_dialog_finished, 1);
     ScopedLuaRef callback_ref = LuaTools::create_ref(l);
 
-    game.start_dialog("_shop.question", price_ref, callback_ref);
+    game.start_dialog("_shop.question", price_ref, std::move(callback_ref));
 
     return 0;
   });
@@ -4832,7 +5174,7 @@ int LuaContext::enemy_api_set_attack_consequence(lua_State* l) {
     }
     else if (lua_isfunction(l, 3)) {
       ScopedLuaRef callback = LuaTools::check_function(l, 3);
-      enemy.set_attack_consequence(attack, EnemyReaction::ReactionType::LUA_CALLBACK, 0, callback);
+      enemy.set_attack_consequence(attack, EnemyReaction::ReactionType::LUA_CALLBACK, 0, std::move(callback));
     }
     else {
       LuaTools::type_error(l, 3, "number, string or function");
@@ -4900,7 +5242,7 @@ int LuaContext::enemy_api_set_attack_consequence_sprite(lua_State* l) {
     }
     else if (lua_isfunction(l, 4)) {
       ScopedLuaRef callback = LuaTools::check_function(l, 4);
-      enemy.set_attack_consequence_sprite(sprite, attack, EnemyReaction::ReactionType::LUA_CALLBACK, 0, callback);
+      enemy.set_attack_consequence_sprite(sprite, attack, EnemyReaction::ReactionType::LUA_CALLBACK, 0, std::move(callback));
     }
     else {
       LuaTools::type_error(l, 3, "number, string or function");
@@ -5554,12 +5896,12 @@ int LuaContext::custom_entity_api_set_traversable_by(lua_State* l) {
     else if (lua_isfunction(l, index)) {
       // Custom boolean function.
 
-      const ScopedLuaRef& traversable_test_ref = LuaTools::check_function(l, index);
+      ScopedLuaRef traversable_test_ref = LuaTools::check_function(l, index);
       if (!type_specific) {
-        entity.set_traversable_by_entities(traversable_test_ref);
+        entity.set_traversable_by_entities(std::move(traversable_test_ref));
       }
       else {
-        entity.set_traversable_by_entities(type, traversable_test_ref);
+        entity.set_traversable_by_entities(type, std::move(traversable_test_ref));
       }
     }
     else {
@@ -5613,12 +5955,12 @@ int LuaContext::custom_entity_api_set_can_traverse(lua_State* l) {
     else if (lua_isfunction(l, index)) {
       // Custom boolean function.
 
-      const ScopedLuaRef& traversable_test_ref = LuaTools::check_function(l, index);
+      ScopedLuaRef traversable_test_ref = LuaTools::check_function(l, index);
       if (!type_specific) {
-        entity.set_can_traverse_entities(traversable_test_ref);
+        entity.set_can_traverse_entities(std::move(traversable_test_ref));
       }
       else {
-        entity.set_can_traverse_entities(type, traversable_test_ref);
+        entity.set_can_traverse_entities(type, std::move(traversable_test_ref));
       }
     }
     else {
@@ -5683,22 +6025,27 @@ int LuaContext::custom_entity_api_add_collision_test(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     CustomEntity& entity = *check_custom_entity(l, 1);
 
-    const ScopedLuaRef& callback_ref = LuaTools::check_function(l, 3);
+    ScopedLuaRef callback_ref = LuaTools::check_function(l, 3);
 
     if (lua_isstring(l, 2)) {
       // Built-in collision test.
       CollisionMode collision_mode = LuaTools::check_enum<CollisionMode>(l, 2,
           EnumInfoTraits<CollisionMode>::names_no_none_no_custom
       );
-      entity.add_collision_test(collision_mode, callback_ref);
+      entity.add_collision_test(collision_mode, std::move(callback_ref));
     }
     else if (lua_isfunction(l, 2)) {
       // Custom collision test.
-      const ScopedLuaRef& collision_test_ref = LuaTools::check_function(l, 2);
-      entity.add_collision_test(collision_test_ref, callback_ref);
+      ScopedLuaRef collision_test_ref = LuaTools::check_function(l, 2);
+      entity.add_collision_test(std::move(collision_test_ref), std::move(callback_ref));
+    }
+    else if (lua_istable(l, 2)) {
+      // Collision rules evaluated natively.
+      const CustomEntity::CollisionRules& rules = check_collision_rules(l, 2, entity.get_map());
+      entity.add_collision_test(rules, std::move(callback_ref));
     }
     else {
-      LuaTools::type_error(l, 2, "string or function");
+      LuaTools::type_error(l, 2, "string, function or table");
     }
 
     return 0;
@@ -5721,6 +6068,79 @@ int LuaContext::custom_entity_api_clear_collision_tests(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of custom_entity:get_collision_group().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::custom_entity_api_get_collision_group(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const CustomEntity& entity = *check_custom_entity(l, 1);
+
+    const std::string& collision_group = entity.get_collision_group();
+    if (collision_group.empty()) {
+      lua_pushnil(l);
+    }
+    else {
+      push_string(l, collision_group);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of custom_entity:set_collision_group().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::custom_entity_api_set_collision_group(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    CustomEntity& entity = *check_custom_entity(l, 1);
+    std::string collision_group;
+    if (!lua_isnil(l, 2)) {
+      collision_group = LuaTools::check_string(l, 2);
+    }
+
+    entity.set_collision_group(collision_group);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of custom_entity:is_traversable_cache_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::custom_entity_api_is_traversable_cache_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const CustomEntity& entity = *check_custom_entity(l, 1);
+
+    lua_pushboolean(l, entity.is_traversable_cache_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of custom_entity:set_traversable_cache_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::custom_entity_api_set_traversable_cache_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    CustomEntity& entity = *check_custom_entity(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    entity.set_traversable_cache_enabled(enabled);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of custom_entity:get_modified_ground().
  * \param l The Lua context that is calling this function.
@@ -5775,10 +6195,7 @@ int LuaContext::custom_entity_api_set_modified_ground(lua_State* l) {
  */
 void LuaContext::entity_on_update(Entity& entity) {
 
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(entity, method_name)) {
+  if (!userdata_has_event(entity, CachedEvent::ON_UPDATE)) {
     return;
   }
 
@@ -5886,7 +6303,7 @@ void LuaContext::entity_on_disabled(Entity& entity) {
  */
 void LuaContext::entity_on_pre_draw(Entity& entity) {
 
-  if (!userdata_has_field(entity, "on_pre_draw")) {
+  if (!userdata_has_event(entity, CachedEvent::ON_PRE_DRAW)) {
     return;
   }
 
@@ -5904,7 +6321,7 @@ void LuaContext::entity_on_pre_draw(Entity& entity) {
  */
 void LuaContext::entity_on_post_draw(Entity& entity) {
 
-  if (!userdata_has_field(entity, "on_post_draw")) {
+  if (!userdata_has_event(entity, CachedEvent::ON_POST_DRAW)) {
     return;
   }
 
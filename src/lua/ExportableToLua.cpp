@@ -17,16 +17,37 @@
 #include "solarus/core/Debug.h"
 #include "solarus/lua/ExportableToLua.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Compares a string key with a C string.
+ * \param field A key of the sorted list.
+ * \param key The key to find.
+ * \return \c true if the field is before the key.
+ */
+bool is_field_before(const std::string& field, const char* key) {
+  return std::strcmp(field.c_str(), key) < 0;
+}
+
+}  // Anonymous namespace.
+
+constexpr size_t ExportableToLua::max_known_lua_fields;
+
 /**
  * \brief Creates an object exportable to Lua.
  */
 ExportableToLua::ExportableToLua():
   lua_context(nullptr),
   known_to_lua(false),
-  with_lua_table(false) {
+  with_lua_table(false),
+  lua_event_mask(0),
+  known_lua_fields(),
+  other_lua_fields() {
 
 }
 
@@ -96,5 +117,99 @@ void ExportableToLua::set_with_lua_table(bool with_lua_table) {
   this->with_lua_table = with_lua_table;
 }
 
+/**
+ * \brief Returns the frequent callbacks defined in the table of this userdata.
+ *
+ * This is maintained by the Lua context to avoid lookups at each cycle.
+ *
+ * \return A bit field of LuaContext::CachedEvent values.
+ */
+uint32_t ExportableToLua::get_lua_event_mask() const {
+  return lua_event_mask;
+}
+
+/**
+ * \brief Sets the frequent callbacks defined in the table of this userdata.
+ * \param lua_event_mask A bit field of LuaContext::CachedEvent values.
+ */
+void ExportableToLua::set_lua_event_mask(uint32_t lua_event_mask) {
+
+  if (lua_event_mask == this->lua_event_mask) {
+    return;
+  }
+  this->lua_event_mask = lua_event_mask;
+  notify_lua_event_mask_changed();
+}
+
+/**
+ * \brief Called when frequent callbacks are added to or removed from the
+ * table of this userdata.
+ *
+ * Redefine this function to only schedule callbacks that exist.
+ */
+void ExportableToLua::notify_lua_event_mask_changed() {
+}
+
+/**
+ * \brief Returns whether a field with a name known by the Lua context
+ * exists in the table of this userdata.
+ * \param index Index of the name in the Lua context.
+ * \return \c true if the field exists.
+ */
+bool ExportableToLua::has_known_lua_field(size_t index) const {
+  return known_lua_fields.test(index);
+}
+
+/**
+ * \brief Records whether a field with a name known by the Lua context
+ * exists in the table of this userdata.
+ * \param index Index of the name in the Lua context.
+ * \param exists \c true if the field exists.
+ */
+void ExportableToLua::set_known_lua_field(size_t index, bool exists) {
+  known_lua_fields.set(index, exists);
+}
+
+/**
+ * \brief Returns whether a string key without a known name exists in the
+ * table of this userdata.
+ * \param key The key to test.
+ * \return \c true if the field exists.
+ */
+bool ExportableToLua::has_other_lua_field(const char* key) const {
+
+  const auto& it = std::lower_bound(
+      other_lua_fields.begin(), other_lua_fields.end(), key, is_field_before);
+  return it != other_lua_fields.end() && *it == key;
+}
+
+/**
+ * \brief Records whether a string key without a known name exists in the
+ * table of this userdata.
+ * \param key The key.
+ * \param exists \c true if the field exists.
+ */
+void ExportableToLua::set_other_lua_field(const char* key, bool exists) {
+
+  const auto& it = std::lower_bound(
+      other_lua_fields.begin(), other_lua_fields.end(), key, is_field_before);
+  const bool found = it != other_lua_fields.end() && *it == key;
+  if (exists && !found) {
+    other_lua_fields.emplace(it, key);
+  }
+  else if (!exists && found) {
+    other_lua_fields.erase(it);
+  }
+}
+
+/**
+ * \brief Forgets the fields recorded in the table of this userdata.
+ */
+void ExportableToLua::clear_lua_fields() {
+
+  known_lua_fields.reset();
+  std::vector<std::string>().swap(other_lua_fields);
+}
+
 }
 
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Timer.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/lua/ExportableToLuaPtr.h"
+#include "solarus/lua/FfiApi.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <lua.hpp>
+#include <memory>
+#include <string>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Lua code that replaces some methods by their FFI fast paths.
+ *
+ * It receives the LuaContext pointer, an array of entity metatables,
+ * the sprite metatable and the timer metatable.
+ * Each fast path checks that its argument has the metatable it was
+ * installed in, otherwise it uses the classic method, which raises
+ * the usual errors.
+ * Nothing is changed without LuaJIT, or if the engine symbols cannot be
+ * resolved by FFI (for example when they are in a DLL).
+ */
+const char* ffi_code =
+"local lua_context, entity_metatables, sprite_metatable, timer_metatable = ...\n"
+"if jit == nil then return end\n"
+"local ok, ffi = pcall(require, 'ffi')\n"
+"if not ok then return end\n"
+"ffi.cdef[[\n"
+"void solarus_ffi_entity_get_position(const void* entity, int* position);\n"
+"void solarus_ffi_entity_get_bounding_box(const void* entity, int* bounding_box);\n"
+"int solarus_ffi_entity_get_layer(const void* entity);\n"
+"int solarus_ffi_sprite_get_frame(const void* sprite);\n"
+"int solarus_ffi_timer_get_remaining_time(const void* lua_context, const void* timer);\n"
+"]]\n"
+"local C = ffi.C\n"
+"if not pcall(function() return C.solarus_ffi_timer_get_remaining_time end) then return end\n"
+"local getmetatable = getmetatable\n"
+"local values = ffi.new('int[4]')\n"
+"local function install(metatable, name, make)\n"
+"  local classic = rawget(metatable, name)\n"
+"  if classic ~= nil then\n"
+"    metatable[name] = make(metatable, classic)\n"
+"  end\n"
+"end\n"
+"for _, metatable in ipairs(entity_metatables) do\n"
+"  install(metatable, 'get_position', function(metatable, classic)\n"
+"    return function(entity, ...)\n"
+"      if getmetatable(entity) ~= metatable then return classic(entity, ...) end\n"
+"      C.solarus_ffi_entity_get_position(entity, values)\n"
+"      return values[0], values[1], values[2]\n"
+"    end\n"
+"  end)\n"
+"  install(metatable, 'get_bounding_box', function(metatable, classic)\n"
+"    return function(entity, ...)\n"
+"      if getmetatable(entity) ~= metatable then return classic(entity, ...) end\n"
+"      C.solarus_ffi_entity_get_bounding_box(entity, values)\n"
+"      return values[0], values[1], values[2], values[3]\n"
+"    end\n"
+"  end)\n"
+"  install(metatable, 'get_layer', function(metatable, classic)\n"
+"    return function(entity, ...)\n"
+"      if getmetatable(entity) ~= metatable then return classic(entity, ...) end\n"
+"      return C.solarus_ffi_entity_get_layer(entity)\n"
+"    end\n"
+"  end)\n"
+"end\n"
+"install(sprite_metatable, 'get_frame', function(metatable, classic)\n"
+"  return function(sprite, ...)\n"
+"    if getmetatable(sprite) ~= metatable then return classic(sprite, ...) end\n"
+"    return C.solarus_ffi_sprite_get_frame(sprite)\n"
+"  end\n"
+"end)\n"
+"install(timer_metatable, 'get_remaining_time', function(metatable, classic)\n"
+"  return function(timer, ...)\n"
+"    if getmetatable(timer) ~= metatable then return classic(timer, ...) end\n"
+"    return C.solarus_ffi_timer_get_remaining_time(lua_context, timer)\n"
+"  end\n"
+"end)\n";
+
+/**
+ * \brief Returns the object of a Solarus userdata payload.
+ * \param userdata Payload of a userdata of the expected type.
+ * \return The object.
+ */
+template<typename T>
+const T& get_object(const void* userdata) {
+  return static_cast<const T&>(**static_cast<const ExportableToLuaPtr*>(userdata));
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Replaces some methods of the Lua API by LuaJIT FFI fast paths.
+ *
+ * Must be called after the entity, sprite and timer modules are registered.
+ * With plain Lua, this does nothing.
+ */
+void LuaContext::register_ffi_functions() {
+
+  if (luaL_loadstring(l, ffi_code) != 0) {
+    Debug::error(std::string("Failed to load FFI functions: ") + lua_tostring(l, -1));
+    lua_pop(l, 1);
+    return;
+  }
+                                  // code
+  lua_pushlightuserdata(l, this);
+                                  // code context
+  lua_newtable(l);
+                                  // code context entity_metatables
+  int i = 0;
+  for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
+    luaL_getmetatable(l, get_entity_internal_type_name(kvp.first).c_str());
+    lua_rawseti(l, -2, ++i);
+  }
+  luaL_getmetatable(l, sprite_module_name.c_str());
+                                  // code context entity_metatables sprite_mt
+  luaL_getmetatable(l, timer_module_name.c_str());
+                                  // code context entity_metatables sprite_mt timer_mt
+  LuaTools::call_function(l, 4, 0, "FFI functions");
+                                  // --
+}
+
+}
+
+using namespace Solarus;
+
+/**
+ * \brief Fast path of entity:get_position().
+ * \param entity Payload of an entity userdata.
+ * \param[out] position The x, y and layer of the entity.
+ */
+void solarus_ffi_entity_get_position(const void* entity, int* position) {
+
+  const Entity& object = get_object<Entity>(entity);
+  position[0] = object.get_x();
+  position[1] = object.get_y();
+  position[2] = object.get_layer();
+}
+
+/**
+ * \brief Fast path of entity:get_bounding_box().
+ * \param entity Payload of an entity userdata.
+ * \param[out] bounding_box The x, y, width and height of the bounding box.
+ */
+void solarus_ffi_entity_get_bounding_box(const void* entity, int* bounding_box) {
+
+  const Rectangle& box = get_object<Entity>(entity).get_bounding_box();
+  bounding_box[0] = box.get_x();
+  bounding_box[1] = box.get_y();
+  bounding_box[2] = box.get_width();
+  bounding_box[3] = box.get_height();
+}
+
+/**
+ * \brief Fast path of entity:get_layer().
+ * \param entity Payload of an entity userdata.
+ * \return The layer of the entity.
+ */
+int solarus_ffi_entity_get_layer(const void* entity) {
+
+  return get_object<Entity>(entity).get_layer();
+}
+
+/**
+ * \brief Fast path of sprite:get_frame().
+ * \param sprite Payload of a sprite userdata.
+ * \return The current frame of the sprite.
+ */
+int solarus_ffi_sprite_get_frame(const void* sprite) {
+
+  return get_object<Sprite>(sprite).get_current_frame();
+}
+
+/**
+ * \brief Fast path of timer:get_remaining_time().
+ * \param lua_context The LuaContext object.
+ * \param timer Payload of a timer userdata.
+ * \return The remaining time in milliseconds.
+ */
+int solarus_ffi_timer_get_remaining_time(const void* lua_context, const void* timer) {
+
+  const TimerPtr timer_ptr = std::static_pointer_cast<Timer>(
+      *static_cast<const ExportableToLuaPtr*>(timer)
+  );
+  return static_cast<const LuaContext*>(lua_context)->get_timer_remaining_time(timer_ptr);
+}
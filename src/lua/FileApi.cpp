@@ -14,12 +14,73 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/MainLoop.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <future>
+#include <memory>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Reads a data file once the previous writes are finished.
+ *
+ * This function can run on a separate thread.
+ *
+ * \param file_name Name of the file, relative to the quest write directory,
+ * to the data directory or to the data archive.
+ * \param content Receives the content of the file.
+ * \param previous_write The last write started before, if any.
+ * \return \c true in case of success, \c false if the file does not exist.
+ */
+bool read_data_file(
+    const std::string& file_name,
+    const std::shared_ptr<std::string>& content,
+    const std::shared_future<bool>& previous_write
+) {
+  if (previous_write.valid()) {
+    previous_write.wait();
+  }
+  if (!QuestFiles::data_file_exists(file_name, false)) {
+    return false;
+  }
+  *content = QuestFiles::data_file_read(file_name);
+  return true;
+}
+
+/**
+ * \brief Writes a file of the quest write directory once the previous
+ * writes are finished.
+ *
+ * This function can run on a separate thread.
+ *
+ * \param file_name Name of the file, relative to the quest write directory.
+ * \param buffer The content to write.
+ * \param append \c true to add the content at the end of the file,
+ * \c false to replace the file.
+ * \param previous_write The last write started before, if any.
+ * \return \c true in case of success.
+ */
+bool write_data_file(
+    const std::string& file_name,
+    const std::string& buffer,
+    bool append,
+    const std::shared_future<bool>& previous_write
+) {
+  if (previous_write.valid()) {
+    previous_write.wait();
+  }
+  return append ?
+      QuestFiles::data_file_append(file_name, buffer) :
+      QuestFiles::data_file_replace(file_name, buffer);
+}
+
+}  // Anonymous namespace.
+
 /**
  * Name of the Lua table representing the file module.
  */
@@ -30,12 +91,20 @@ const std::string LuaContext::file_module_name = "sol.file";
  */
 void LuaContext::register_file_module() {
 
-  const std::vector<luaL_Reg> functions = {
+  std::vector<luaL_Reg> functions = {
       { "open", file_api_open },
       { "exists", file_api_exists },
       { "remove", file_api_remove },
       { "mkdir", file_api_mkdir }
   };
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    functions.insert(functions.end(), {
+      { "read", file_api_read },
+      { "write", file_api_write },
+      { "append", file_api_append },
+      { "mount_patch", file_api_mount_patch },
+    });
+  }
   register_functions(file_module_name, functions);
 
   // Store the original io.open function in the registry.
@@ -190,5 +259,196 @@ int LuaContext::file_api_mkdir(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.file.read().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_read(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 2);
+
+    LuaContext& lua_context = get_lua_context(l);
+    std::shared_ptr<std::string> content = std::make_shared<std::string>();
+    const std::string& error_message = std::string("Cannot find file '") + file_name
+        + "' in the quest write directory, in data/, data.solarus or in data.solarus.zip";
+
+    if (callback_ref.is_empty()) {
+      if (!read_data_file(file_name, content, lua_context.last_file_write)) {
+        lua_pushnil(l);
+        push_string(l, error_message);
+        return 2;
+      }
+      push_string(l, *content);
+      return 1;
+    }
+
+    // Read in the background and call the function when finished.
+    lua_context.pending_file_operations.push_back(PendingFileOperation{
+        std::async(
+            std::launch::async,
+            &read_data_file,
+            file_name,
+            content,
+            lua_context.last_file_write
+        ).share(),
+        content,
+        error_message,
+        std::move(callback_ref)
+    });
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.file.write().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_write(lua_State* l) {
+
+  return write_file(l, false);
+}
+
+/**
+ * \brief Implementation of sol.file.append().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_append(lua_State* l) {
+
+  return write_file(l, true);
+}
+
+/**
+ * \brief Implementation of sol.file.mount_patch().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_mount_patch(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+
+    std::vector<std::string> overridden_files;
+    if (!QuestFiles::mount_patch(file_name, overridden_files)) {
+      lua_pushnil(l);
+      push_string(l, std::string("Cannot mount patch archive '") + file_name
+          + "' from the quest write directory");
+      return 2;
+    }
+
+    // Resources already loaded from the replaced files are outdated.
+    MainLoop& main_loop = get_lua_context(l).get_main_loop();
+    for (const std::string& overridden_file: overridden_files) {
+      main_loop.notify_resource_file_changed(overridden_file);
+    }
+
+    lua_pushboolean(l, true);
+    return 1;
+  });
+}
+
+/**
+ * \brief Common implementation of sol.file.write() and sol.file.append().
+ *
+ * With a callback, the file is written on a separate thread.
+ * Writes are done in the order they were started, and reads started
+ * afterwards see them.
+ *
+ * \param l The Lua context that is calling this function.
+ * \param append \c true to add the content at the end of the file.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::write_file(lua_State* l, bool append) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+    const std::string& buffer = LuaTools::check_string(l, 2);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 3);
+
+    if (QuestFiles::get_quest_write_dir().empty()) {
+      LuaTools::error(l,
+          "Cannot write file: no write directory was specified in quest.dat");
+    }
+
+    LuaContext& lua_context = get_lua_context(l);
+    const std::string& error_message = std::string("Failed to write file '") + file_name + "'";
+
+    if (callback_ref.is_empty()) {
+      if (!write_data_file(file_name, buffer, append, lua_context.last_file_write)) {
+        lua_pushnil(l);
+        push_string(l, error_message);
+        return 2;
+      }
+      lua_pushboolean(l, true);
+      return 1;
+    }
+
+    // Write in the background and call the function when finished.
+    lua_context.last_file_write = std::async(
+        std::launch::async,
+        &write_data_file,
+        file_name,
+        buffer,
+        append,
+        lua_context.last_file_write
+    ).share();
+    lua_context.pending_file_operations.push_back(PendingFileOperation{
+        lua_context.last_file_write,
+        nullptr,
+        error_message,
+        std::move(callback_ref)
+    });
+    return 0;
+  });
+}
+
+/**
+ * \brief Calls the callbacks of background file operations that are finished.
+ *
+ * This function is called at each cycle.
+ * The callback of a read receives the content of the file, the callback of
+ * a write receives \c true. In case of failure, they receive \c nil and an
+ * error message.
+ */
+void LuaContext::update_pending_file_operations() {
+
+  if (pending_file_operations.empty()) {
+    return;
+  }
+
+  // Callbacks may start new operations: extract the finished ones first.
+  std::vector<PendingFileOperation> finished_operations;
+  for (auto it = pending_file_operations.begin(); it != pending_file_operations.end();) {
+    if (it->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      finished_operations.push_back(std::move(*it));
+      it = pending_file_operations.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  for (const PendingFileOperation& operation: finished_operations) {
+    push_ref(l, operation.callback_ref);
+    if (!operation.result.get()) {
+      lua_pushnil(l);
+      push_string(l, operation.error_message);
+      call_function(2, 0, "file callback");
+    }
+    else if (operation.content != nullptr) {
+      push_string(l, *operation.content);
+      call_function(1, 0, "file callback");
+    }
+    else {
+      lua_pushboolean(l, true);
+      call_function(1, 0, "file callback");
+    }
+  }
+}
+
 }
 
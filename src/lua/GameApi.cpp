@@ -21,14 +21,45 @@
 #include "solarus/core/Equipment.h"
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/Logger.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Pushes a savegame value onto the stack.
+ * \param l A Lua state.
+ * \param savegame A savegame.
+ * \param key Key of the value.
+ */
+void push_savegame_value(lua_State* l, const Savegame& savegame, const Savegame::Key& key) {
+
+  if (savegame.is_boolean(key)) {
+    lua_pushboolean(l, savegame.get_boolean(key));
+  }
+  else if (savegame.is_integer(key)) {
+    lua_pushinteger(l, savegame.get_integer(key));
+  }
+  else if (savegame.is_string(key)) {
+    lua_pushstring(l, savegame.get_string(key).c_str());
+  }
+  else {
+    lua_pushnil(l);
+  }
+}
+
+}  // Anonymous namespace.
+
 /**
  * Name of the Lua table representing the game module.
  */
@@ -47,7 +78,7 @@ void LuaContext::register_game_module() {
   };
 
   // Methods of the game type.
-  const std::vector<luaL_Reg> methods = {
+  std::vector<luaL_Reg> methods = {
       { "save", game_api_save },
       { "start", game_api_start },
       { "is_started", game_api_is_started },
@@ -106,6 +137,12 @@ void LuaContext::register_game_module() {
       { "simulate_command_pressed", game_api_simulate_command_pressed },
       { "simulate_command_released", game_api_simulate_command_released }
   };
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    methods.insert(methods.end(), {
+        { "wait_dialog", game_api_wait_dialog },
+        { "watch_value", game_api_watch_value }
+    });
+  }
 
   const std::vector<luaL_Reg> metamethods = {
       { "__gc", userdata_meta_gc },
@@ -162,6 +199,7 @@ int LuaContext::game_api_exists(lua_State* l) {
       LuaTools::error(l, "Cannot check savegame: no write directory was specified in quest.dat");
     }
 
+    Savegame::wait_for_pending_saves();
     bool exists = QuestFiles::data_file_exists(file_name);
 
     lua_pushboolean(l, exists);
@@ -183,6 +221,7 @@ int LuaContext::game_api_delete(lua_State* l) {
       LuaTools::error(l, "Cannot delete savegame: no write directory was specified in quest.dat");
     }
 
+    Savegame::wait_for_pending_saves();
     QuestFiles::data_file_delete(file_name);
 
     return 0;
@@ -222,12 +261,21 @@ int LuaContext::game_api_save(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
     Savegame& savegame = *check_game(l, 1);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 2);
 
     if (QuestFiles::get_quest_write_dir().empty()) {
       LuaTools::error(l, "Cannot save game: no write directory was specified in quest.dat");
     }
 
-    savegame.save();
+    if (callback_ref.is_empty()) {
+      savegame.save();
+    }
+    else {
+      // Write in the background and call the function when finished.
+      get_lua_context(l).pending_saves.push_back(
+          PendingSave{ savegame.save_async(), std::move(callback_ref) }
+      );
+    }
 
     return 0;
   });
@@ -459,12 +507,55 @@ int LuaContext::game_api_start_dialog(lua_State* l) {
 
       callback_ref = LuaTools::opt_function(l, callback_index);
     }
-    game->start_dialog(dialog_id, info_ref, callback_ref);
+    game->start_dialog(dialog_id, info_ref, std::move(callback_ref));
 
     return 0;
   });
 }
 
+/**
+ * \brief Implementation of game:wait_dialog().
+ *
+ * Like game:start_dialog(), but suspends the running coroutine until the
+ * dialog finishes, and returns the status of the dialog.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_wait_dialog(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    const std::string& dialog_id = LuaTools::check_string(l, 2);
+    ScopedLuaRef info_ref;
+
+    if (!CurrentQuest::dialog_exists(dialog_id)) {
+      LuaTools::arg_error(l, 2, std::string("No such dialog: '") + dialog_id + "'");
+    }
+
+    Game* game = savegame.get_game();
+    if (game == nullptr) {
+      LuaTools::error(l, "Cannot start dialog: this game is not running");
+    }
+
+    if (game->is_dialog_enabled()) {
+      LuaTools::error(l, "Cannot start dialog: another dialog is already active");
+    }
+
+    ScopedLuaRef resumer_ref = create_coroutine_resumer(l, "game:wait_dialog");
+    if (!lua_isnoneornil(l, 3)) {
+      info_ref = LuaTools::create_ref(l, 3);
+    }
+    game->start_dialog(dialog_id, info_ref, std::move(resumer_ref));
+
+    if (!game->is_dialog_enabled()) {
+      // The dialog box closed the dialog right away.
+      return 0;
+    }
+    return lua_yield(l, 0);
+  });
+}
+
 /**
  * \brief Implementation of game:stop_dialog().
  * \param l The Lua context that is calling this function.
@@ -613,26 +704,20 @@ int LuaContext::game_api_get_value(lua_State* l) {
     Savegame& savegame = *check_game(l, 1);
     const std::string& key = LuaTools::check_string(l, 2);
 
-    if (!LuaTools::is_valid_lua_identifier(key)) {
-      LuaTools::arg_error(l, 3,
-          std::string("Invalid savegame variable '") + key
-          + "': the name should only contain alphanumeric characters or '_'"
-          + " and cannot start with a digit");
-    }
-
-    if (savegame.is_boolean(key)) {
-      lua_pushboolean(l, savegame.get_boolean(key));
-    }
-    else if (savegame.is_integer(key)) {
-      lua_pushinteger(l, savegame.get_integer(key));
-    }
-    else if (savegame.is_string(key)) {
-      lua_pushstring(l, savegame.get_string(key).c_str());
-    }
-    else {
+    // Names already interned are valid identifiers.
+    Savegame::Key savegame_key;
+    if (!Savegame::find_key(key, savegame_key)) {
+      if (!LuaTools::is_valid_lua_identifier(key)) {
+        LuaTools::arg_error(l, 3,
+            std::string("Invalid savegame variable '") + key
+            + "': the name should only contain alphanumeric characters or '_'"
+            + " and cannot start with a digit");
+      }
       lua_pushnil(l);
+      return 1;
     }
 
+    push_savegame_value(l, savegame, savegame_key);
     return 1;
   });
 }
@@ -690,6 +775,56 @@ int LuaContext::game_api_set_value(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of game:watch_value().
+ *
+ * The callback is called as callback(game, key, value) at the next cycle
+ * after the value changes, once even if it changed several times.
+ * It stops being called when it returns false or when the game finishes.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_watch_value(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    const std::string& key = LuaTools::check_string(l, 2);
+    const std::shared_ptr<ScopedLuaRef>& callback_ref =
+        std::make_shared<ScopedLuaRef>(LuaTools::check_function(l, 3));
+
+    if (!LuaTools::is_valid_lua_identifier(key)) {
+      LuaTools::arg_error(l, 2,
+          std::string("Invalid savegame variable '") + key
+          + "': the name should only contain alphanumeric characters or '_'"
+          + " and cannot start with a digit");
+    }
+
+    if (savegame.get_game() == nullptr) {
+      LuaTools::error(l, "Cannot watch value: this game is not running");
+    }
+
+    LuaContext& lua_context = get_lua_context(l);
+    savegame.add_value_watcher(Savegame::get_key(key),
+        [&lua_context, &savegame, callback_ref](const Savegame::Key& changed_key) {
+      lua_State* current_l = lua_context.get_internal_state();
+      callback_ref->push(current_l);
+      push_game(current_l, savegame);
+      push_string(current_l, changed_key.get_name());
+      push_savegame_value(current_l, savegame, changed_key);
+      if (!LuaTools::call_function(current_l, 3, 1, "watch_value callback")) {
+        return false;
+      }
+      // Only an explicit false stops watching.
+      const bool keep_watching = !lua_isboolean(current_l, -1) || lua_toboolean(current_l, -1);
+      lua_pop(current_l, 1);
+      return keep_watching;
+    });
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of game:get_starting_location().
  * \param l The Lua context that is calling this function.
@@ -1463,10 +1598,10 @@ int LuaContext::game_api_capture_command_binding(lua_State* l) {
     Savegame& savegame = *check_game(l, 1);
     GameCommand command = LuaTools::check_enum<GameCommand>(
         l, 2, GameCommands::command_names);
-    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 3);
+    ScopedLuaRef callback_ref = LuaTools::opt_function(l, 3);
 
     GameCommands& commands = savegame.get_game()->get_commands();
-    commands.customize(command, callback_ref);
+    commands.customize(command, std::move(callback_ref));
 
     return 0;
   });
@@ -1550,6 +1685,41 @@ int LuaContext::game_api_simulate_command_released(lua_State* l) {
   });
 }
 
+/**
+ * \brief Calls the callbacks of background saves that are finished.
+ *
+ * This function is called at each cycle.
+ * The callback receives \c true if the file was written successfully.
+ */
+void LuaContext::update_pending_saves() {
+
+  if (pending_saves.empty()) {
+    return;
+  }
+
+  // Callbacks may start new saves: extract the finished ones first.
+  std::vector<PendingSave> finished_saves;
+  for (auto it = pending_saves.begin(); it != pending_saves.end();) {
+    if (it->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      finished_saves.push_back(std::move(*it));
+      it = pending_saves.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  for (const PendingSave& save: finished_saves) {
+    const bool success = save.result.get();
+    if (!success) {
+      Logger::error("Failed to save game");
+    }
+    push_ref(l, save.callback_ref);
+    lua_pushboolean(l, success);
+    call_function(1, 0, "save callback");
+  }
+}
+
 /**
  * \brief Calls the on_started() method of a Lua game.
  *
@@ -1596,10 +1766,7 @@ void LuaContext::game_on_finished(Game& game) {
 void LuaContext::game_on_update(Game& game) {
 
   push_game(l, game.get_savegame());
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(game.get_savegame(), method_name)) {
+  if (userdata_has_event(game.get_savegame(), CachedEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -1617,7 +1784,7 @@ void LuaContext::game_on_update(Game& game) {
 void LuaContext::game_on_draw(Game& game, const SurfacePtr& dst_surface) {
 
   push_game(l, game.get_savegame());
-  if (userdata_has_field(game.get_savegame(), "on_draw")) {
+  if (userdata_has_event(game.get_savegame(), CachedEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
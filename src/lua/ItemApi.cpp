@@ -799,10 +799,7 @@ void LuaContext::item_on_finished(EquipmentItem& item) {
  */
 void LuaContext::item_on_update(EquipmentItem& item) {
 
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(item, method_name)) {
+  if (!userdata_has_event(item, CachedEvent::ON_UPDATE)) {
     return;
   }
 
@@ -811,6 +808,32 @@ void LuaContext::item_on_update(EquipmentItem& item) {
   lua_pop(l, 1);
 }
 
+/**
+ * \brief Returns whether an equipment item defines on_update() in its own
+ * table.
+ *
+ * This does not include a method defined on the item metatable.
+ *
+ * \param item An equipment item.
+ * \return \c true if the item has its own on_update().
+ */
+bool LuaContext::item_table_has_on_update(const EquipmentItem& item) const {
+
+  const uint32_t event_bit = 1 << static_cast<int>(CachedEvent::ON_UPDATE);
+  return item.is_with_lua_table() && (item.get_lua_event_mask() & event_bit) != 0;
+}
+
+/**
+ * \brief Returns whether the metatable of equipment items defines
+ * on_update(), which then applies to all of them.
+ * \return \c true if all items have on_update().
+ */
+bool LuaContext::item_metatable_has_on_update() {
+
+  const uint32_t event_bit = 1 << static_cast<int>(CachedEvent::ON_UPDATE);
+  return (get_metatable_event_mask(item_module_name) & event_bit) != 0;
+}
+
 /**
  * \brief Calls the on_suspended() method of a Lua equipment item.
  *
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/LuaAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns whether a block of this size comes from the pools.
+ * \param size A size in bytes.
+ * \return \c true for small blocks.
+ */
+bool is_small(size_t size) {
+  return size > 0 && size <= LuaAllocator::max_small_block_size;
+}
+
+/**
+ * \brief Returns the size class of a small block.
+ * \param size A size in bytes, not zero and not bigger than
+ * max_small_block_size.
+ * \return The index of its size class.
+ */
+size_t get_size_index(size_t size) {
+  return (size - 1) / LuaAllocator::granularity;
+}
+
+/**
+ * \brief Returns the address of the next free block stored in a free block.
+ * \param block A free block.
+ * \return The next free block of the same size class.
+ */
+void*& get_next_free_block(void* block) {
+  return *static_cast<void**>(block);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates an allocator without pools yet and without limit.
+ */
+LuaAllocator::LuaAllocator():
+  free_blocks(max_small_block_size / granularity, nullptr),
+  chunks(),
+  num_bytes(0),
+  peak_num_bytes(0),
+  num_blocks(0),
+  memory_limit(0) {
+
+}
+
+/**
+ * \brief Destroys the allocator and its pools.
+ */
+LuaAllocator::~LuaAllocator() {
+
+  clear();
+}
+
+/**
+ * \brief The lua_Alloc function to give to lua_newstate().
+ * \param allocator The LuaAllocator object.
+ * \param block The block to reallocate or free, or nullptr.
+ * \param old_size Size of the block, or 0 if there is no block.
+ * \param new_size New size wanted, or 0 to free the block.
+ * \return The new block, or nullptr in case of failure or if freed.
+ */
+void* LuaAllocator::allocate(void* allocator, void* block, size_t old_size, size_t new_size) {
+
+  return static_cast<LuaAllocator*>(allocator)->reallocate(block, old_size, new_size);
+}
+
+/**
+ * \brief Allocates, reallocates or frees a block like lua_Alloc.
+ *
+ * Shrinking a block never fails because of the memory limit.
+ *
+ * \param block The block to reallocate or free, or nullptr.
+ * \param old_size Size of the block, or 0 if there is no block.
+ * \param new_size New size wanted, or 0 to free the block.
+ * \return The new block, or nullptr in case of failure or if freed.
+ */
+void* LuaAllocator::reallocate(void* block, size_t old_size, size_t new_size) {
+
+  if (block == nullptr) {
+    old_size = 0;
+  }
+
+  if (new_size == 0) {
+    if (block != nullptr) {
+      free_block(block, old_size);
+      num_bytes -= old_size;
+      --num_blocks;
+    }
+    return nullptr;
+  }
+
+  if (memory_limit > 0 &&
+      new_size > old_size &&
+      num_bytes + static_cast<int64_t>(new_size - old_size) > memory_limit) {
+    return nullptr;
+  }
+
+  void* new_block = nullptr;
+  if (block != nullptr && !is_small(old_size) && !is_small(new_size)) {
+    // Both big: let the heap grow or shrink it in place if it can.
+    new_block = std::realloc(block, new_size);
+  }
+  else if (block != nullptr &&
+           is_small(old_size) &&
+           is_small(new_size) &&
+           get_size_index(old_size) == get_size_index(new_size)) {
+    // Same size class: nothing to move.
+    new_block = block;
+  }
+  else {
+    new_block = allocate_block(new_size);
+    if (new_block != nullptr && block != nullptr) {
+      std::memcpy(new_block, block, std::min(old_size, new_size));
+      free_block(block, old_size);
+    }
+  }
+
+  if (new_block == nullptr) {
+    return nullptr;
+  }
+
+  if (block == nullptr) {
+    ++num_blocks;
+  }
+  num_bytes += static_cast<int64_t>(new_size) - static_cast<int64_t>(old_size);
+  peak_num_bytes = std::max(peak_num_bytes, num_bytes);
+  return new_block;
+}
+
+/**
+ * \brief Allocates a new block from the pools or from the heap.
+ * \param size Size of the block in bytes, not zero.
+ * \return The block, or nullptr if there is not enough memory.
+ */
+void* LuaAllocator::allocate_block(size_t size) {
+
+  if (!is_small(size)) {
+    return std::malloc(size);
+  }
+
+  const size_t size_index = get_size_index(size);
+  void*& first_free_block = free_blocks[size_index];
+  if (first_free_block == nullptr) {
+    // Carve a new chunk into blocks of this size class.
+    char* chunk = static_cast<char*>(std::malloc(chunk_size));
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunks.push_back(chunk);
+
+    const size_t block_size = (size_index + 1) * granularity;
+    for (size_t i = chunk_size / block_size; i > 0; --i) {
+      void* new_free_block = chunk + (i - 1) * block_size;
+      get_next_free_block(new_free_block) = first_free_block;
+      first_free_block = new_free_block;
+    }
+  }
+
+  void* block = first_free_block;
+  first_free_block = get_next_free_block(block);
+  return block;
+}
+
+/**
+ * \brief Gives back a block to the pools or to the heap.
+ * \param block A block allocated by allocate_block().
+ * \param size The size given to allocate_block().
+ */
+void LuaAllocator::free_block(void* block, size_t size) {
+
+  if (!is_small(size)) {
+    std::free(block);
+    return;
+  }
+
+  void*& first_free_block = free_blocks[get_size_index(size)];
+  get_next_free_block(block) = first_free_block;
+  first_free_block = block;
+}
+
+/**
+ * \brief Returns the memory currently used by the Lua state.
+ * \return The size of all its blocks in bytes.
+ */
+int64_t LuaAllocator::get_num_bytes() const {
+  return num_bytes;
+}
+
+/**
+ * \brief Returns the maximum memory used so far by the Lua state.
+ * \return The highest size of all its blocks in bytes.
+ */
+int64_t LuaAllocator::get_peak_num_bytes() const {
+  return peak_num_bytes;
+}
+
+/**
+ * \brief Returns the number of blocks currently used by the Lua state.
+ * \return The number of blocks.
+ */
+int64_t LuaAllocator::get_num_blocks() const {
+  return num_blocks;
+}
+
+/**
+ * \brief Returns the memory reserved by the pools of small blocks.
+ * \return The size of all chunks in bytes, used or not.
+ */
+int64_t LuaAllocator::get_pool_size() const {
+  return static_cast<int64_t>(chunks.size() * chunk_size);
+}
+
+/**
+ * \brief Returns the maximum memory that the Lua state can use.
+ * \return The limit in bytes, or 0 if there is no limit.
+ */
+int64_t LuaAllocator::get_memory_limit() const {
+  return memory_limit;
+}
+
+/**
+ * \brief Sets the maximum memory that the Lua state can use.
+ *
+ * Blocks already allocated are kept even if they exceed it.
+ *
+ * \param memory_limit The limit in bytes, or 0 for no limit.
+ */
+void LuaAllocator::set_memory_limit(int64_t memory_limit) {
+  this->memory_limit = memory_limit;
+}
+
+/**
+ * \brief Gives back the pools to the heap.
+ *
+ * This must only be called when no block is used anymore,
+ * that is, once the Lua state is closed.
+ */
+void LuaAllocator::clear() {
+
+  for (void* chunk: chunks) {
+    std::free(chunk);
+  }
+  chunks.clear();
+  std::fill(free_blocks.begin(), free_blocks.end(), nullptr);
+  num_bytes = 0;
+  peak_num_bytes = 0;
+  num_blocks = 0;
+}
+
+}
+
@@ -15,10 +15,12 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/AbilityInfo.h"
+#include "solarus/core/AllocationTracker.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/EquipmentItem.h"
+#include "solarus/core/FrameTimings.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
@@ -41,19 +43,81 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace Solarus {
 
-std::map<lua_State*, LuaContext*> LuaContext::lua_contexts;
+namespace {
+
+/**
+ * \brief Key of the LuaContext object in the registry of its Lua state.
+ *
+ * Only the address of this variable matters.
+ */
+const char lua_context_key = 0;
+
+/**
+ * \brief Address used as registry key of the table of all userdata.
+ *
+ * A light userdata key is cheaper to look up than a string field,
+ * which matters because push_userdata() is called very often.
+ */
+char all_userdata_key;
+
+/**
+ * \brief A script compiled by a previous call to load_file().
+ */
+struct CompiledScript {
+  int64_t modification_date;      /**< Date of the script file when compiled,
+                                   * or -1 if unknown. */
+  std::string source;             /**< Content of the script file. */
+  std::string bytecode;           /**< The compiled chunk. */
+};
+
+/**
+ * \brief Scripts already compiled, indexed by file name.
+ *
+ * They survive the Lua world, so that resetting the program
+ * does not parse all scripts again.
+ */
+std::unordered_map<std::string, CompiledScript> compiled_scripts;
+
+/**
+ * \brief Appends a piece of compiled chunk to a string.
+ * \param l The Lua state.
+ * \param data Bytes to append.
+ * \param size Number of bytes.
+ * \param bytecode The string to append to.
+ * \return 0 on success.
+ */
+int write_bytecode(lua_State* /* l */, const void* data, size_t size, void* bytecode) {
+  static_cast<std::string*>(bytecode)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+}
 
 /**
  * \brief Creates a Lua context.
  * \param main_loop The Solarus main loop manager.
  */
 LuaContext::LuaContext(MainLoop& main_loop):
+  allocator(),
   l(nullptr),
-  main_loop(main_loop) {
+  gc_driven(false),
+  gc_cycle_running(false),
+  gc_pause(QuestProperties::default_lua_gc_pause),
+  gc_threshold(0),
+  main_loop(main_loop),
+  draw_recording(nullptr),
+  draw_recording_surface(nullptr) {
 
 }
 
@@ -67,17 +131,22 @@ LuaContext::~LuaContext() {
 
 /**
  * \brief Returns the LuaContext object that encapsulates a Lua state.
- * \param l A Lua state.
+ * \param l A Lua state, possibly a coroutine.
  * \return The LuaContext object encapsulating this Lua state.
  */
 LuaContext& LuaContext::get_lua_context(lua_State* l) {
 
-  auto it = lua_contexts.find(l);
+  // The registry is shared by coroutines, and each Lua state of the
+  // process has its own, so no global table is needed.
+  lua_pushlightuserdata(l, const_cast<char*>(&lua_context_key));
+  lua_rawget(l, LUA_REGISTRYINDEX);
+  LuaContext* lua_context = static_cast<LuaContext*>(lua_touserdata(l, -1));
+  lua_pop(l, 1);
 
-  Debug::check_assertion(it != lua_contexts.end(),
+  Debug::check_assertion(lua_context != nullptr,
       "This Lua state does not belong to a LuaContext object");
 
-  return *it->second;
+  return *lua_context;
 }
 
 /**
@@ -88,6 +157,14 @@ lua_State* LuaContext::get_internal_state() {
   return l;
 }
 
+/**
+ * \brief Returns the allocator of the Lua state.
+ * \return The Lua allocator.
+ */
+const LuaAllocator& LuaContext::get_allocator() const {
+  return allocator;
+}
+
 /**
  * \brief Returns the Solarus main loop object.
  * \return The main loop manager.
@@ -102,14 +179,35 @@ MainLoop& LuaContext::get_main_loop() {
 void LuaContext::initialize() {
 
   // Create an execution context.
-  l = luaL_newstate();
+  l = lua_newstate(LuaAllocator::allocate, &allocator);
+  if (l == nullptr) {
+    // LuaJIT only accepts its own allocator on some 64-bit targets.
+    l = luaL_newstate();
+  }
   lua_atpanic(l, l_panic);
   luaL_openlibs(l);
+  lua_register(l, "print", l_print);
 
   print_lua_version();
 
+  // Set up the garbage collector.
+  const QuestProperties& properties = CurrentQuest::get_properties();
+  gc_pause = properties.get_lua_gc_pause();
+  lua_gc(l, LUA_GCSETPAUSE, gc_pause);
+  lua_gc(l, LUA_GCSETSTEPMUL, properties.get_lua_gc_step_multiplier());
+  gc_driven = properties.get_lua_gc_step_time() > 0;
+  gc_cycle_running = false;
+  gc_threshold = lua_gc(l, LUA_GCCOUNT, 0) * gc_pause / 100;
+  if (gc_driven) {
+    // Only collect in step_garbage_collector().
+    lua_gc(l, LUA_GCSTOP, 0);
+  }
+
   // Associate this LuaContext object to the lua_State pointer.
-  lua_contexts[l] = this;
+  lua_pushlightuserdata(l, const_cast<char*>(&lua_context_key));
+  lua_pushlightuserdata(l, this);
+  lua_rawset(l, LUA_REGISTRYINDEX);
+  LuaTools::set_main_thread(l);
 
   // Create a table that will keep track of all userdata.
                                   // --
@@ -123,7 +221,11 @@ void LuaContext::initialize() {
                                   // all_udata meta
   lua_setmetatable(l, -2);
                                   // all_udata
-  lua_setfield(l, LUA_REGISTRYINDEX, "sol.all_userdata");
+  lua_pushlightuserdata(l, &all_userdata_key);
+                                  // all_udata key
+  lua_insert(l, -2);
+                                  // key all_udata
+  lua_rawset(l, LUA_REGISTRYINDEX);
                                   // --
 
   // Allow userdata to be indexable if they want.
@@ -163,6 +265,9 @@ void LuaContext::initialize() {
 
   Debug::check_assertion(lua_gettop(l) == 0, "Non-empty Lua stack after initialization");
 
+  // Only limit the memory of quest scripts, not the one of the engine API.
+  allocator.set_memory_limit(static_cast<int64_t>(properties.get_lua_memory_limit()) * 1024);
+
   // Execute the main file.
   do_file_if_exists(l, "main");
 
@@ -184,12 +289,17 @@ void LuaContext::exit() {
     destroy_menus();
     destroy_timers();
     destroy_drawables();
+    model_scripts.clear();
+    pending_saves.clear();  // The files are still written.
+    pending_images.clear();
+    pending_file_operations.clear();  // The files are still written.
+    pending_workers.clear();  // Waits for the workers to finish.
     userdata_close_lua();
 
     // Finalize Lua.
     lua_close(l);
-    lua_contexts.erase(l);
     l = nullptr;
+    allocator.clear();
   }
 }
 
@@ -201,24 +311,89 @@ void LuaContext::exit() {
  */
 void LuaContext::update() {
 
+  AllocationTracker::ScopeMarker allocation_scope(AllocationTracker::Scope::LUA_UPDATE);
+
   // Make sure the stack does not leak.
   Debug::check_assertion(lua_gettop(l) == 0,
       "Non-empty stack before LuaContext::update()"
   );
 
+  // Metatables may have new callbacks since the previous cycle.
+  metatable_event_masks.clear();
+
   update_drawables();
   update_movements();
   update_menus();
   update_timers();
+  update_pending_saves();
+  update_pending_images();
+  update_pending_file_operations();
+  update_workers();
 
   // Call sol.main.on_update().
   main_on_update();
 
+  if (gc_driven && lua_gc(l, LUA_GCCOUNT, 0) >= 2 * gc_threshold) {
+    // The main loop does not collect garbage fast enough,
+    // or the simulation is run step by step.
+    step_garbage_collector(0.0);
+  }
+
   Debug::check_assertion(lua_gettop(l) == 0,
       "Non-empty stack after LuaContext::update()"
   );
 }
 
+/**
+ * \brief Returns whether the main loop has to collect Lua garbage.
+ * \return \c true if automatic collection is disabled and
+ * step_garbage_collector() should be called at each frame.
+ */
+bool LuaContext::is_garbage_collector_driven() const {
+  return gc_driven;
+}
+
+/**
+ * \brief Runs the garbage collector incrementally for a limited time.
+ *
+ * This is intended to be called in the idle time at the end of each frame
+ * when the garbage collector is driven by the engine.
+ * Like the automatic collector, a new cycle only starts once the memory
+ * has grown by the pause percentage since the end of the previous one.
+ * At least one step is done, and if the memory reaches twice that
+ * threshold, the time limit is ignored until the cycle finishes,
+ * since garbage is created faster than it is collected.
+ *
+ * \param max_time Time available in milliseconds.
+ */
+void LuaContext::step_garbage_collector(double max_time) {
+
+  if (l == nullptr || !gc_driven) {
+    return;
+  }
+
+  const int memory_used = lua_gc(l, LUA_GCCOUNT, 0);
+  if (!gc_cycle_running && memory_used < gc_threshold) {
+    return;
+  }
+  gc_cycle_running = true;
+
+  const bool late = memory_used >= 2 * gc_threshold;
+  const double start_time = FrameTimings::get_time();
+  do {
+    if (lua_gc(l, LUA_GCSTEP, 0) != 0) {
+      // The cycle is finished.
+      gc_cycle_running = false;
+      gc_threshold = static_cast<int>(
+          static_cast<int64_t>(lua_gc(l, LUA_GCCOUNT, 0)) * gc_pause / 100);
+      break;
+    }
+  } while (late || FrameTimings::get_time() - start_time < max_time);
+
+  // Stepping restarts the automatic collector.
+  lua_gc(l, LUA_GCSTOP, 0);
+}
+
 /**
  * \brief Notifies Lua that an input event has just occurred.
  *
@@ -257,6 +432,9 @@ void LuaContext::run_map(Map& map, Destination* destination) {
   // Compute the file name, depending on the id of the map.
   std::string file_name = std::string("maps/") + map.get_id();
 
+  // Entering a map is when scripts modified on disk are taken into account.
+  model_scripts.clear();
+
   // Load the map's code.
   bool load_success = load_file(l, file_name);
                                   // map_fun
@@ -342,14 +520,12 @@ void LuaContext::run_enemy(Enemy& enemy) {
   std::string file_name = std::string("enemies/") + enemy.get_breed();
 
   // Load the enemy's code.
-  if (load_file(l, file_name)) {
+  if (load_model_script(file_name)) {
 
     // Run it with the enemy userdata as parameter.
     push_enemy(l, enemy);
     call_function(1, 0, file_name.c_str());
   }
-
-  // TODO parse Lua only once for each breed.
 }
 
 /**
@@ -373,14 +549,42 @@ void LuaContext::run_custom_entity(CustomEntity& custom_entity) {
   std::string file_name = std::string("entities/") + model;
 
   // Load the entity's code.
-  if (load_file(l, file_name)) {
+  if (load_model_script(file_name)) {
 
     // Run it with the entity userdata as parameter.
     push_custom_entity(l, custom_entity);
     call_function(1, 0, file_name.c_str());
   }
+}
+
+/**
+ * \brief Pushes the function of an enemy or custom entity script.
+ *
+ * The script is only loaded for the first instance on the current map.
+ * Other instances run the same function again,
+ * which still gives them their own local variables.
+ *
+ * \param file_name Name of the script without extension,
+ * relative to the data directory.
+ * \return \c true if the script exists and was pushed.
+ */
+bool LuaContext::load_model_script(const std::string& file_name) {
 
-  // TODO parse Lua only once for each model.
+  const auto& it = model_scripts.find(file_name);
+  if (it != model_scripts.end()) {
+    push_ref(l, it->second);
+    return true;
+  }
+
+  if (!load_file(l, file_name)) {
+    return false;
+  }
+                                  // script_fun
+  lua_pushvalue(l, -1);
+                                  // script_fun script_fun
+  model_scripts.emplace(file_name, create_ref());
+                                  // script_fun
+  return true;
 }
 
 /**
@@ -490,10 +694,123 @@ void LuaContext::push_ref(lua_State* l, const ScopedLuaRef& ref) {
     return;
   }
 
-  Debug::check_assertion(ref.get_lua_state() == l, "Wrong Lua state");
-  ref.push();
+  Debug::check_assertion(ref.get_lua_state() == l ||
+      ref.get_lua_state() == LuaTools::get_main_thread(l), "Wrong Lua state");
+  ref.push(l);
 }
 
+namespace {
+
+/**
+ * \brief Field names that have their own bit in userdata.
+ *
+ * These are the callbacks whose existence the engine checks.
+ * Must be sorted.
+ */
+const char* const known_field_names[] = {
+    "on_ability_used",
+    "on_activated",
+    "on_activated_repeat",
+    "on_activating",
+    "on_amount_changed",
+    "on_animation_changed",
+    "on_animation_finished",
+    "on_attacking_hero",
+    "on_bought",
+    "on_buying",
+    "on_changed",
+    "on_closed",
+    "on_collision_enemy",
+    "on_collision_explosion",
+    "on_collision_fire",
+    "on_command_pressed",
+    "on_command_released",
+    "on_created",
+    "on_custom_attack_received",
+    "on_cut",
+    "on_dead",
+    "on_dialog_finished",
+    "on_dialog_started",
+    "on_direction_changed",
+    "on_disabled",
+    "on_draw",
+    "on_dying",
+    "on_enabled",
+    "on_exploded",
+    "on_finished",
+    "on_frame_changed",
+    "on_game_over_finished",
+    "on_game_over_started",
+    "on_ground_below_changed",
+    "on_hits",
+    "on_hurt",
+    "on_hurt_by_sword",
+    "on_immobilized",
+    "on_inactivated",
+    "on_interaction",
+    "on_interaction_item",
+    "on_left",
+    "on_lifting",
+    "on_looked",
+    "on_map_changed",
+    "on_moved",
+    "on_movement_changed",
+    "on_movement_finished",
+    "on_movement_started",
+    "on_moving",
+    "on_npc_collision_fire",
+    "on_npc_interaction",
+    "on_npc_interaction_item",
+    "on_obstacle_reached",
+    "on_obtained",
+    "on_obtained_treasure",
+    "on_obtaining",
+    "on_obtaining_treasure",
+    "on_opened",
+    "on_opening_transition_finished",
+    "on_paused",
+    "on_pickable_created",
+    "on_position_changed",
+    "on_post_draw",
+    "on_pre_draw",
+    "on_regenerating",
+    "on_removed",
+    "on_restarted",
+    "on_started",
+    "on_state_changed",
+    "on_suspended",
+    "on_taking_damage",
+    "on_unpaused",
+    "on_update",
+    "on_using",
+    "on_variant_changed"
+};
+
+static_assert(
+    sizeof(known_field_names) / sizeof(known_field_names[0]) <= ExportableToLua::max_known_lua_fields,
+    "Too many known userdata field names"
+);
+
+/**
+ * \brief Returns the index of a field name in known_field_names.
+ * \param key A field name.
+ * \return Its index, or -1 if it is not a known name.
+ */
+int get_known_field_index(const char* key) {
+
+  const char* const* begin = std::begin(known_field_names);
+  const char* const* end = std::end(known_field_names);
+  const char* const* it = std::lower_bound(begin, end, key, [](const char* name, const char* key) {
+    return std::strcmp(name, key) < 0;
+  });
+  if (it == end || std::strcmp(*it, key) != 0) {
+    return -1;
+  }
+  return static_cast<int>(it - begin);
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Returns whether a userdata has an entry with the specified key.
  *
@@ -510,11 +827,6 @@ void LuaContext::push_ref(lua_State* l, const ScopedLuaRef& ref) {
 bool LuaContext::userdata_has_field(
     const ExportableToLua& userdata, const char* key) const {
 
-  // TODO since this function now also checks the metatable, check that
-  // doing the work below instead of just returning true is still useful
-  // for performance.
-  // If not, kill this function.
-
   // First check the metatable of the type.
   if (userdata_has_metafield(userdata, key)) {
     return true;
@@ -525,12 +837,11 @@ bool LuaContext::userdata_has_field(
     return false;
   }
 
-  const auto& it = userdata_fields.find(&userdata);
-  if (it == userdata_fields.end()) {
-    return false;
+  const int index = get_known_field_index(key);
+  if (index != -1) {
+    return userdata.has_known_lua_field(static_cast<size_t>(index));
   }
-
-  return it->second.find(key) != it->second.end();
+  return userdata.has_other_lua_field(key);
 }
 
 /**
@@ -539,9 +850,6 @@ bool LuaContext::userdata_has_field(
  * Userdata can have entries like tables thanks to special __index and
  * __newindex metamethods.
  *
- * Version with std::string, better for performance if you already have an
- * std::string representation of the key.
- *
  * \param userdata A userdata.
  * \param key String key to test.
  * \return \c true if this key exists on the userdata.
@@ -549,22 +857,25 @@ bool LuaContext::userdata_has_field(
 bool LuaContext::userdata_has_field(
     const ExportableToLua& userdata, const std::string& key) const {
 
-  // First check the metatable of the type.
-  if (userdata_has_metafield(userdata, key.c_str())) {
-    return true;
-  }
+  return userdata_has_field(userdata, key.c_str());
+}
 
-  // Check the userdata itself then.
-  if (!userdata.is_with_lua_table()) {
-    return false;
-  }
+/**
+ * \brief Records whether a userdata has an entry with the specified key.
+ * \param userdata A userdata with a Lua table.
+ * \param key A string key.
+ * \param exists \c false if the field is being set to \c nil.
+ */
+void LuaContext::update_userdata_field(
+    ExportableToLua& userdata, const char* key, bool exists) {
 
-  const auto& it = userdata_fields.find(&userdata);
-  if (it == userdata_fields.end()) {
-    return false;
+  const int index = get_known_field_index(key);
+  if (index != -1) {
+    userdata.set_known_lua_field(static_cast<size_t>(index), exists);
+  }
+  else {
+    userdata.set_other_lua_field(key, exists);
   }
-
-  return it->second.find(key) != it->second.end();
 }
 
 /**
@@ -591,6 +902,118 @@ bool LuaContext::userdata_has_metafield(
   return found;
 }
 
+namespace {
+
+/**
+ * \brief Names of the callbacks of LuaContext::CachedEvent.
+ */
+const char* const cached_event_names[] = {
+    "on_update",
+    "on_draw",
+    "on_pre_draw",
+    "on_post_draw"
+};
+
+}
+
+/**
+ * \brief Returns whether a userdata has a frequently called callback.
+ *
+ * This gives the same result as userdata_has_field() without any Lua lookup
+ * in most cases, which matters for callbacks tried at each cycle.
+ *
+ * \param userdata A userdata.
+ * \param event The callback to test.
+ * \return \c true if this callback exists on the userdata or its type.
+ */
+bool LuaContext::userdata_has_event(
+    const ExportableToLua& userdata, CachedEvent event) {
+
+  const uint32_t event_bit = 1 << static_cast<int>(event);
+  if (userdata.is_with_lua_table() &&
+      (userdata.get_lua_event_mask() & event_bit) != 0) {
+    return true;
+  }
+
+  return (get_metatable_event_mask(userdata) & event_bit) != 0;
+}
+
+/**
+ * \brief Returns the cached events defined in the metatable of a userdata.
+ *
+ * Metatables can be modified without us knowing, so the result is only
+ * kept until the next cycle.
+ *
+ * \param userdata A userdata.
+ * \return A bit field of CachedEvent values.
+ */
+uint32_t LuaContext::get_metatable_event_mask(const ExportableToLua& userdata) {
+
+  return get_metatable_event_mask(userdata.get_lua_type_name());
+}
+
+/**
+ * \overload
+ * \param type_name Name of a userdata type. It must be the string returned
+ * by ExportableToLua::get_lua_type_name() because its address is the key of
+ * the cache.
+ * \return A bit field of CachedEvent values.
+ */
+uint32_t LuaContext::get_metatable_event_mask(const std::string& type_name) {
+
+  const auto& it = metatable_event_masks.find(&type_name);
+  if (it != metatable_event_masks.end()) {
+    return it->second;
+  }
+
+  uint32_t mask = 0;
+                                  // ...
+  luaL_getmetatable(l, type_name.c_str());
+                                  // ... meta
+  for (size_t i = 0; i < sizeof(cached_event_names) / sizeof(cached_event_names[0]); ++i) {
+    lua_pushstring(l, cached_event_names[i]);
+                                  // ... meta key
+    lua_rawget(l, -2);
+                                  // ... meta field/nil
+    if (!lua_isnil(l, -1)) {
+      mask |= 1 << i;
+    }
+    lua_pop(l, 1);
+                                  // ... meta
+  }
+  lua_pop(l, 1);
+                                  // ...
+
+  metatable_event_masks.emplace(&type_name, mask);
+  return mask;
+}
+
+/**
+ * \brief Updates the cached events of a userdata when one of its fields
+ * is set.
+ * \param userdata A userdata.
+ * \param key The field being set.
+ * \param exists \c false if the field is being set to \c nil.
+ */
+void LuaContext::update_userdata_event_mask(
+    ExportableToLua& userdata, const char* key, bool exists) {
+
+  for (size_t i = 0; i < sizeof(cached_event_names) / sizeof(cached_event_names[0]); ++i) {
+    if (std::strcmp(key, cached_event_names[i]) == 0) {
+      const uint32_t event_bit = 1 << i;
+      uint32_t mask = userdata.get_lua_event_mask();
+      if (exists) {
+        mask |= event_bit;
+      }
+      else {
+        mask &= ~event_bit;
+      }
+      userdata.set_lua_event_mask(mask);
+      return;
+    }
+  }
+}
+
 /**
  * \brief Gets a method of the object on top of the stack.
  *
@@ -668,6 +1091,63 @@ bool LuaContext::call_function(
   return LuaTools::call_function(l, nb_arguments, nb_results, function_name);
 }
 
+/**
+ * \brief Starts or resumes a coroutine.
+ *
+ * While the coroutine runs, it is the Lua state of this context:
+ * engine functions that work on the stack of the context, like creating
+ * timers or calling events, use the stack of the coroutine.
+ *
+ * An error in the coroutine is printed and ends the coroutine.
+ * Values it returns or yields are discarded.
+ *
+ * \param thread A new coroutine with its function and arguments on its
+ * stack, or a suspended coroutine with the values to resume it with.
+ * \param nb_arguments Number of arguments on the stack of the coroutine.
+ * \return \c false in case of error.
+ */
+bool LuaContext::resume_coroutine(lua_State* thread, int nb_arguments) {
+
+  lua_State* previous_l = l;
+  l = thread;
+  const int status = lua_resume(thread, nb_arguments);
+  l = previous_l;
+
+  bool success = true;
+  if (status != 0 && status != LUA_YIELD) {
+    const char* message = lua_tostring(thread, -1);
+    Debug::error(std::string("In coroutine: ") +
+        (message != nullptr ? message : "unknown error"));
+    success = false;
+  }
+  lua_settop(thread, 0);
+  return success;
+}
+
+/**
+ * \brief Creates a function that resumes the running coroutine.
+ *
+ * Waiting functions pass it as callback of a timer, a movement or a dialog
+ * and then yield, so that the coroutine costs nothing until the
+ * callback resumes it.
+ * If the function is never called, the coroutine is garbage-collected.
+ *
+ * \param l The running coroutine.
+ * \param function_name Name of the waiting function (only used for
+ * the error message if \c l is not a coroutine).
+ * \return A ref to the resuming function.
+ */
+ScopedLuaRef LuaContext::create_coroutine_resumer(
+    lua_State* l,
+    const std::string& function_name
+) {
+  if (lua_pushthread(l) == 1) {
+    LuaTools::error(l, function_name + "() can only be called from a coroutine");
+  }
+  lua_pushcclosure(l, l_resume_coroutine, 1);
+  return LuaTools::create_ref(l);
+}
+
 /**
  * \brief Opens a script if it exists and lets it on top of the stack as a
  * function.
@@ -675,6 +1155,9 @@ bool LuaContext::call_function(
  * If the file does not exist or has a syntax error,
  * the stack is left intact and false is returned.
  *
+ * Compiled scripts are kept and reused as long as their file is unchanged,
+ * even by a new Lua world, so that each script is only parsed once.
+ *
  * \param l A Lua state.
  * \param script_name File name of the script with or without extension,
  * relative to the data directory.
@@ -698,15 +1181,54 @@ bool LuaContext::load_file(lua_State* l, const std::string& script_name) {
 
   // Load the file.
   // "@" tells Lua that the name is a file name, which is useful for better error messages.
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  int result = luaL_loadbuffer(l, buffer.data(), buffer.size(), ("@" + file_name).c_str());
+  const std::string& chunk_name = "@" + file_name;
+  const int64_t modification_date = QuestFiles::data_file_get_modification_date(file_name);
+  std::string buffer;
+  bool buffer_read = false;
+  const auto& it = compiled_scripts.find(file_name);
+  if (it != compiled_scripts.end()) {
+    bool unchanged = modification_date != -1 &&
+        modification_date == it->second.modification_date;
+    if (!unchanged) {
+      // The date is not enough to know: compare the content.
+      buffer = QuestFiles::data_file_read(file_name);
+      buffer_read = true;
+      unchanged = buffer == it->second.source;
+    }
+    if (unchanged) {
+      // Unchanged since it was compiled: skip the reading and the parsing.
+      const std::string& bytecode = it->second.bytecode;
+      if (luaL_loadbuffer(l, bytecode.data(), bytecode.size(), chunk_name.c_str()) == 0) {
+        it->second.modification_date = modification_date;
+        return true;
+      }
+      lua_pop(l, 1);
+    }
+  }
+
+  if (!buffer_read) {
+    buffer = QuestFiles::data_file_read(file_name);
+  }
+
+  int result = luaL_loadbuffer(l, buffer.data(), buffer.size(), chunk_name.c_str());
 
   if (result != 0) {
     Debug::error(std::string("Failed to load script '")
         + script_name + "': " + lua_tostring(l, -1));
     lua_pop(l, 1);
+    compiled_scripts.erase(file_name);
     return false;
   }
+
+  CompiledScript& compiled_script = compiled_scripts[file_name];
+  compiled_script.modification_date = modification_date;
+  compiled_script.bytecode.clear();
+  if (lua_dump(l, write_bytecode, &compiled_script.bytecode) == 0) {
+    compiled_script.source = std::move(buffer);
+  }
+  else {
+    compiled_scripts.erase(file_name);
+  }
   return true;
 }
 
@@ -750,6 +1272,32 @@ bool LuaContext::do_file_if_exists(lua_State* l, const std::string& script_name)
   return false;
 }
 
+/**
+ * \brief Notifies Lua that a script has changed on disk.
+ *
+ * The script is forgotten by require(), so that the next require() runs
+ * the new version. Scripts loaded without require(), like map scripts,
+ * are read again anyway each time they are used.
+ *
+ * \param script_name File name of the script without extension,
+ * relative to the data directory.
+ */
+void LuaContext::notify_script_changed(const std::string& script_name) {
+
+  std::string dotted_name = script_name;
+  std::replace(dotted_name.begin(), dotted_name.end(), '/', '.');
+
+  lua_getglobal(l, "package");
+  lua_getfield(l, -1, "loaded");
+  lua_pushnil(l);
+  lua_setfield(l, -2, script_name.c_str());
+  lua_pushnil(l);
+  lua_setfield(l, -2, dotted_name.c_str());
+  lua_pop(l, 2);
+
+  model_scripts.erase(script_name);
+}
+
 /**
  * \brief Prints on a line the content of the Lua stack for debugging purposes.
  * \param l A Lua state.
@@ -875,8 +1423,9 @@ void LuaContext::register_type(
 
   // Check that this type does not already exist.
   luaL_getmetatable(l, module_name.c_str());
-  Debug::check_assertion(lua_isnil(l, -1),
-      std::string("Type ") + module_name + " already exists");
+  Debug::check_assertion_lazy(lua_isnil(l, -1), [&] {
+    return std::string("Type ") + module_name + " already exists";
+  });
   lua_pop(l, 1);
 
   // Make sure we create the table.
@@ -945,20 +1494,25 @@ void LuaContext::register_modules() {
   register_main_module();
   register_game_module();
   register_map_module();
+  register_projectile_pool_module();
   register_entity_module();
   register_audio_module();
   register_timer_module();
   register_surface_module();
+  register_pixel_buffer_module();
   register_text_surface_module();
   register_sprite_module();
+  register_particle_emitter_module();
   register_movement_module();
   register_item_module();
   register_input_module();
   register_video_module();
   register_shader_module();
   register_file_module();
+  register_worker_module();
   register_menu_module();
   register_language_module();
+  register_ffi_functions();
 
   Debug::check_assertion(lua_gettop(l) == 0,
       "Lua stack is not empty after modules initialization");
@@ -1002,11 +1556,12 @@ void LuaContext::push_color(lua_State* l, const Color& color) {
 void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
 
   // See if this userdata already exists.
-  lua_getfield(l, LUA_REGISTRYINDEX, "sol.all_userdata");
+  lua_pushlightuserdata(l, &all_userdata_key);
+  lua_rawget(l, LUA_REGISTRYINDEX);
                                   // ... all_udata
   lua_pushlightuserdata(l, &userdata);
                                   // ... all_udata lightudata
-  lua_gettable(l, -2);
+  lua_rawget(l, -2);
                                   // ... all_udata udata/nil
   if (!lua_isnil(l, -1)) {
                                   // ... all_udata udata
@@ -1052,15 +1607,17 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
                                   // ... all_udata lightudata udata mt
 
     Debug::execute_if_debug([&] {
-      Debug::check_assertion(!lua_isnil(l, -1),
-          std::string("Userdata of type '" + userdata.get_lua_type_name()
-          + "' has no metatable, this is a memory leak"));
+      Debug::check_assertion_lazy(!lua_isnil(l, -1), [&] {
+        return std::string("Userdata of type '") + userdata.get_lua_type_name()
+            + "' has no metatable, this is a memory leak";
+      });
 
       lua_getfield(l, -1, "__gc");
                                     // ... all_udata lightudata udata mt gc
-      Debug::check_assertion(lua_isfunction(l, -1),
-          std::string("Userdata of type '") + userdata.get_lua_type_name()
-          + "' must have the __gc function LuaContext::userdata_meta_gc");
+      Debug::check_assertion_lazy(lua_isfunction(l, -1), [&] {
+        return std::string("Userdata of type '") + userdata.get_lua_type_name()
+            + "' must have the __gc function LuaContext::userdata_meta_gc";
+      });
                                     // ... all_udata lightudata udata mt gc
       lua_pop(l, 1);
                                     // ... all_udata lightudata udata mt
@@ -1073,7 +1630,7 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
                                   // ... all_udata lightudata udata udata
     lua_insert(l, -4);
                                   // ... udata all_udata lightudata udata
-    lua_settable(l, -3);
+    lua_rawset(l, -3);
                                   // ... udata all_udata
     lua_pop(l, 1);
                                   // ... udata
@@ -1189,7 +1746,7 @@ int LuaContext::userdata_meta_gc(lua_State* l) {
   // The full userdata is destroyed but the light userdata and its table persist.
   // Its table will be destroyed from ~ExportableToLua().
 
-  // We don't need to remove the entry from sol.all_userdata
+  // We don't need to remove the entry from the table of all userdata
   // because it is already done: that table is weak on its values and the
   // value was the full userdata.
 
@@ -1228,7 +1785,7 @@ void LuaContext::notify_userdata_destroyed(ExportableToLua& userdata) {
     }
     lua_pop(l, 1);
                                   // ...
-    get_lua_context(l).userdata_fields.erase(&userdata);
+    userdata.clear_lua_fields();
   }
 }
 
@@ -1241,16 +1798,18 @@ void LuaContext::notify_userdata_destroyed(ExportableToLua& userdata) {
 void LuaContext::userdata_close_lua() {
 
   // Tell userdata to forget about this Lua state.
-  lua_getfield(l, LUA_REGISTRYINDEX, "sol.all_userdata");
+  lua_pushlightuserdata(l, &all_userdata_key);
+  lua_rawget(l, LUA_REGISTRYINDEX);
   lua_pushnil(l);
   while (lua_next(l, -2) != 0) {
     ExportableToLua* userdata = static_cast<ExportableToLua*>(
         lua_touserdata(l, -2));
     userdata->set_lua_context(nullptr);
+    userdata->clear_lua_fields();
     lua_pop(l, 1);
   }
   lua_pop(l, 1);
-  userdata_fields.clear();
+  metatable_event_masks.clear();
 
   // Clear userdata tables.
   lua_pushnil(l);
@@ -1317,11 +1876,13 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
   if (lua_isstring(l, 2)) {
     if (!lua_isnil(l, 3)) {
       // Add the key to the list of existing strings keys on this userdata.
-      get_lua_context(l).userdata_fields[userdata.get()].insert(lua_tostring(l, 2));
+      update_userdata_field(*userdata, lua_tostring(l, 2), true);
+      update_userdata_event_mask(*userdata, lua_tostring(l, 2), true);
     }
     else {
       // Assigning nil: remove the key from the list.
-      get_lua_context(l).userdata_fields[userdata.get()].erase(lua_tostring(l, 2));
+      update_userdata_field(*userdata, lua_tostring(l, 2), false);
+      update_userdata_event_mask(*userdata, lua_tostring(l, 2), false);
     }
   }
 
@@ -2954,6 +3515,42 @@ int LuaContext::l_panic(lua_State* l) {
   Debug::die(error);
 }
 
+/**
+ * \brief Replacement of the print() function of Lua.
+ *
+ * Like the original one, but the line goes through the logger,
+ * so that printing from scripts does not wait for stdout and stays
+ * in order with messages of the engine.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_print(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const int num_arguments = lua_gettop(l);
+    std::string line;
+    lua_getglobal(l, "tostring");
+    for (int i = 1; i <= num_arguments; ++i) {
+      lua_pushvalue(l, -1);
+      lua_pushvalue(l, i);
+      lua_call(l, 1, 1);
+      size_t length = 0;
+      const char* value = lua_tolstring(l, -1, &length);
+      if (value == nullptr) {
+        LuaTools::error(l, "'tostring' must return a string to 'print'");
+      }
+      if (i > 1) {
+        line += '\t';
+      }
+      line.append(value, length);
+      lua_pop(l, 1);
+    }
+    Logger::print_output(line);
+    return 0;
+  });
+}
+
 /**
  * \brief A loader that makes require() able to load Lua files
  * from the quest data directory or archive.
@@ -2976,6 +3573,34 @@ int LuaContext::l_loader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Resumes the coroutine stored as upvalue.
+ *
+ * This is the function made by create_coroutine_resumer().
+ * Its arguments become the results of the waiting function.
+ * Nothing happens if the coroutine is not suspended.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_resume_coroutine(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_State* thread = lua_tothread(l, lua_upvalueindex(1));
+    if (thread == nullptr || lua_status(thread) != LUA_YIELD) {
+      return 0;
+    }
+
+    const int nb_arguments = lua_gettop(l);
+    if (!lua_checkstack(thread, nb_arguments)) {
+      LuaTools::error(l, "Too many values to resume the coroutine");
+    }
+    lua_xmove(l, thread, nb_arguments);
+    get_lua_context(l).resume_coroutine(thread, nb_arguments);
+    return 0;
+  });
+}
+
 /**
  * \brief A function that prints the stack trace of an error raised in lua
  * \param l The lua context
@@ -14,12 +14,16 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryReader.h"
+#include "solarus/core/BinaryWriter.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/lua/LuaData.h"
 #include <lua.hpp>
 #include <cstdio>
 #include <fstream>
+#include <memory>
 #include <ostream>
 #include <sstream>
 
@@ -92,14 +96,41 @@ bool LuaData::import_from_quest_file(
     const std::string& quest_file_name,
     bool language_specific
 ) {
-  if (!QuestFiles::data_file_exists(quest_file_name, language_specific)) {
+  const bool source_exists = QuestFiles::data_file_exists(quest_file_name, language_specific);
+  std::string buffer;
+
+  // Prefer the compiled binary file if it is up to date.
+  const std::string& binary_file_name = get_binary_file_name(quest_file_name);
+  if (has_binary_format() &&
+      QuestFiles::data_file_exists(binary_file_name, language_specific)) {
+    std::shared_ptr<const QuestFiles::DataFileBuffer> binary_buffer =
+        QuestFiles::data_file_map(binary_file_name, language_specific);
+    uint64_t source_hash = 0;
+    bool up_to_date = get_binary_source_hash(
+        binary_buffer->data(), binary_buffer->size(), source_hash
+    );
+    if (up_to_date && source_exists) {
+      // Hashing is still much faster than parsing.
+      buffer = QuestFiles::data_file_read(quest_file_name, language_specific);
+      up_to_date = source_hash == compute_source_hash(buffer);
+    }
+    if (!up_to_date) {
+      Logger::warning("Ignoring outdated binary data file '" + binary_file_name + "'");
+    }
+    else if (import_from_binary_buffer(
+        binary_buffer->data(), binary_buffer->size(), binary_file_name)) {
+      return true;
+    }
+  }
+
+  if (!source_exists) {
     Debug::error(std::string("Cannot find quest file '") + quest_file_name + "'");
     return false;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(
-      quest_file_name, language_specific
-  );
+  if (buffer.empty()) {
+    buffer = QuestFiles::data_file_read(quest_file_name, language_specific);
+  }
   return import_from_buffer(buffer, quest_file_name);
 }
 
@@ -180,6 +211,200 @@ bool LuaData::export_to_lua(std::ostream& /* out */) const {
   return false;
 }
 
+/**
+ * \brief Returns the first bytes of binary files of this type of data.
+ *
+ * Subclasses that have a binary format return 8 bytes that identify it.
+ *
+ * \return The magic string, or an empty string if there is no binary format.
+ */
+std::string LuaData::get_binary_magic() const {
+
+  // The binary format is optional. Not implemented by default.
+  return std::string();
+}
+
+/**
+ * \brief Returns the version of the binary format of this type of data.
+ *
+ * Binary files of another version are ignored.
+ * Subclasses increment it whenever their binary format changes.
+ *
+ * \return The current version.
+ */
+uint32_t LuaData::get_binary_format_version() const {
+  return 1;
+}
+
+/**
+ * \brief Loads data from the values of a binary file.
+ *
+ * The header and the string table were already read.
+ *
+ * \param reader The binary reader.
+ * \return \c true in case of success, \c false if the values are invalid.
+ * In case of failure, this object is not modified.
+ */
+bool LuaData::import_from_binary(BinaryReader& /* reader */) {
+  return false;
+}
+
+/**
+ * \brief Saves this data as the values of a binary file.
+ * \param writer The binary writer.
+ * \return \c true in case of success, \c false if the data
+ * could not be exported.
+ */
+bool LuaData::export_to_binary(BinaryWriter& /* writer */) const {
+  return false;
+}
+
+/**
+ * \brief Returns whether this type of data has a binary format.
+ * \return \c true if binary files can be imported and exported.
+ */
+bool LuaData::has_binary_format() const {
+  return !get_binary_magic().empty();
+}
+
+/**
+ * \brief Imports a binary data file from memory to this object.
+ *
+ * Binary data files are produced from data files by solarus-quest-compiler.
+ * The whole file is read without Lua.
+ *
+ * \param data The content of the binary file. It can be memory-mapped.
+ * \param size Size of the content in bytes.
+ * \param file_name Name of the file, used for error messages.
+ * \return \c true in case of success. In case of failure,
+ * this object is not modified.
+ */
+bool LuaData::import_from_binary_buffer(
+    const char* data,
+    size_t size,
+    const std::string& file_name
+) {
+  if (!has_binary_format()) {
+    return false;
+  }
+
+  BinaryReader reader(data, size);
+  uint64_t source_hash = 0;
+  if (!reader.read_header(get_binary_magic(), get_binary_format_version(), source_hash)) {
+    Logger::error("Invalid binary data file or wrong version: '" + file_name + "'");
+    return false;
+  }
+  if (!reader.read_string_table() ||
+      !import_from_binary(reader) ||
+      !reader.is_valid()) {
+    Logger::error("Invalid binary data file: '" + file_name + "'");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \overload
+ * \param buffer The content of the binary file.
+ * \param file_name Name of the file, used for error messages.
+ * \return \c true in case of success.
+ */
+bool LuaData::import_from_binary_buffer(
+    const std::string& buffer,
+    const std::string& file_name
+) {
+  return import_from_binary_buffer(buffer.data(), buffer.size(), file_name);
+}
+
+/**
+ * \brief Saves this object into memory as a binary data file.
+ * \param[out] buffer The content of the binary file.
+ * \param source_hash Hash of the data file this object comes from,
+ * as returned by compute_source_hash(), so that outdated binary files
+ * can be detected.
+ * \return \c true in case of success, \c false if there is no binary format.
+ */
+bool LuaData::export_to_binary_buffer(std::string& buffer, uint64_t source_hash) const {
+
+  if (!has_binary_format()) {
+    return false;
+  }
+
+  BinaryWriter writer;
+  if (!export_to_binary(writer)) {
+    return false;
+  }
+  buffer = writer.get_file(get_binary_magic(), get_binary_format_version(), source_hash);
+  return true;
+}
+
+/**
+ * \brief Returns the hash of the source data file stored in the header
+ * of a binary data file.
+ * \param data The content of a binary file.
+ * \param size Size of the content in bytes.
+ * \param[out] source_hash The hash of the source data file.
+ * \return \c false if the content is not a binary file of this type and of
+ * the current version.
+ */
+bool LuaData::get_binary_source_hash(
+    const char* data,
+    size_t size,
+    uint64_t& source_hash
+) const {
+  if (!has_binary_format()) {
+    return false;
+  }
+
+  BinaryReader reader(data, size);
+  return reader.read_header(get_binary_magic(), get_binary_format_version(), source_hash);
+}
+
+/**
+ * \overload
+ * \param buffer The content of a binary file.
+ * \param[out] source_hash The hash of the source data file.
+ * \return \c false if the buffer is not a binary file of this type and of
+ * the current version.
+ */
+bool LuaData::get_binary_source_hash(const std::string& buffer, uint64_t& source_hash) const {
+  return get_binary_source_hash(buffer.data(), buffer.size(), source_hash);
+}
+
+/**
+ * \brief Computes a hash identifying the content of a data file.
+ *
+ * This is the 64-bit FNV-1a hash of the file.
+ *
+ * \param source_buffer Content of a data file.
+ * \return The hash.
+ */
+uint64_t LuaData::compute_source_hash(const std::string& source_buffer) {
+
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : source_buffer) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * \brief Returns the name of the binary file compiled from a data file.
+ * \param file_name Name of a data file like "sprites/hero/tunic1.dat".
+ * \return The binary file name like "sprites/hero/tunic1.bin".
+ */
+std::string LuaData::get_binary_file_name(const std::string& file_name) {
+
+  std::string binary_file_name = file_name;
+  const size_t extension_index = binary_file_name.rfind(".dat");
+  if (extension_index != std::string::npos &&
+      extension_index == binary_file_name.size() - 4) {
+    binary_file_name.resize(extension_index);
+  }
+  return binary_file_name + ".bin";
+}
+
 /**
  * \brief Protects a string so that it can safely be enclosed in double quotes.
  *
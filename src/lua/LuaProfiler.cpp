@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/FrameTimings.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/lua/ExportableToLuaPtr.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace Solarus {
+
+LuaProfiler* LuaProfiler::enabled_profiler = nullptr;
+
+/**
+ * \brief Starts measuring a call if a profiler is enabled.
+ * \param l The Lua state.
+ * \param function_index Index of the function to call in the stack.
+ * \param nb_arguments Number of arguments above the function.
+ * \param function_name A name describing the Lua function.
+ */
+LuaProfiler::Scope::Scope(
+    lua_State* l,
+    int function_index,
+    int nb_arguments,
+    const char* function_name
+):
+  profiler(enabled_profiler),
+  l(l) {
+
+  if (profiler != nullptr) {
+    profiler->enter(l, function_index, nb_arguments, function_name);
+  }
+}
+
+/**
+ * \brief Finishes measuring the call.
+ */
+LuaProfiler::Scope::~Scope() {
+
+  if (profiler != nullptr) {
+    profiler->leave(l);
+  }
+}
+
+/**
+ * \brief Creates a disabled profiler.
+ */
+LuaProfiler::LuaProfiler():
+  call_stack(),
+  entries() {
+
+}
+
+/**
+ * \brief Destroys the profiler.
+ */
+LuaProfiler::~LuaProfiler() {
+
+  set_enabled(false);
+}
+
+/**
+ * \brief Returns whether this profiler is measuring calls.
+ * \return \c true if it is enabled.
+ */
+bool LuaProfiler::is_enabled() const {
+  return enabled_profiler == this;
+}
+
+/**
+ * \brief Starts or stops measuring calls.
+ *
+ * Only one profiler can be enabled at a time.
+ * Results are kept when the profiler is disabled.
+ *
+ * \param enabled \c true to enable the profiler.
+ */
+void LuaProfiler::set_enabled(bool enabled) {
+
+  if (enabled) {
+    enabled_profiler = this;
+  }
+  else if (is_enabled()) {
+    enabled_profiler = nullptr;
+  }
+}
+
+/**
+ * \brief Forgets the results measured so far.
+ *
+ * Calls currently running are still measured.
+ */
+void LuaProfiler::clear() {
+
+  entries.clear();
+}
+
+/**
+ * \brief Returns the results measured so far.
+ * \return The measures of each call stack, sorted by stack.
+ */
+std::vector<LuaProfiler::Entry> LuaProfiler::get_entries() const {
+
+  std::vector<Entry> result;
+  result.reserve(entries.size());
+  for (const auto& kvp: entries) {
+    result.push_back(kvp.second);
+  }
+  return result;
+}
+
+/**
+ * \brief Writes the results to folded stack files for flame graph tools.
+ *
+ * The time file has one line per call stack followed by the time spent
+ * in microseconds.
+ * Another file with the same name plus ".memory" has the allocated bytes.
+ *
+ * The file name is a regular path of the filesystem,
+ * not a path in the quest write directory.
+ *
+ * \param file_name The time file to write.
+ * \return \c true in case of success.
+ */
+bool LuaProfiler::save_folded(const std::string& file_name) const {
+
+  std::ofstream time_out(file_name.c_str());
+  std::ofstream memory_out((file_name + ".memory").c_str());
+  if (!time_out || !memory_out) {
+    return false;
+  }
+
+  for (const auto& kvp: entries) {
+    const Entry& entry = kvp.second;
+    const uint64_t time = static_cast<uint64_t>(entry.time * 1000.0);
+    if (time > 0) {
+      time_out << entry.stack << " " << time << "\n";
+    }
+    if (entry.memory > 0) {
+      memory_out << entry.stack << " " << entry.memory << "\n";
+    }
+  }
+
+  return time_out.good() && memory_out.good();
+}
+
+/**
+ * \brief Called when a Lua call starts.
+ * \param l The Lua state.
+ * \param function_index Index of the function to call in the stack.
+ * \param nb_arguments Number of arguments above the function.
+ * \param function_name A name describing the Lua function.
+ */
+void LuaProfiler::enter(
+    lua_State* l,
+    int function_index,
+    int nb_arguments,
+    const char* function_name
+) {
+  std::string stack = get_frame_name(l, function_index, nb_arguments, function_name);
+  if (!call_stack.empty()) {
+    stack = call_stack.back().stack + ";" + stack;
+  }
+
+  call_stack.push_back({
+      std::move(stack),
+      FrameTimings::get_time(),
+      0.0,
+      get_memory_used(l),
+      0
+  });
+}
+
+/**
+ * \brief Called when a Lua call is finished.
+ * \param l The Lua state.
+ */
+void LuaProfiler::leave(lua_State* l) {
+
+  const Frame& frame = call_stack.back();
+  const double time = FrameTimings::get_time() - frame.start_time;
+  const uint64_t memory = static_cast<uint64_t>(
+      std::max(get_memory_used(l) - frame.start_memory, int64_t(0)));
+
+  Entry& entry = entries[frame.stack];
+  if (entry.stack.empty()) {
+    entry.stack = frame.stack;
+  }
+  entry.time += std::max(time - frame.children_time, 0.0);
+  entry.memory += memory > frame.children_memory ? memory - frame.children_memory : 0;
+  ++entry.num_calls;
+
+  call_stack.pop_back();
+  if (!call_stack.empty()) {
+    call_stack.back().children_time += time;
+    call_stack.back().children_memory += memory;
+  }
+}
+
+/**
+ * \brief Describes a call as an element of a folded stack.
+ *
+ * The result looks like "on_update enemy bat_1 enemies/bat.lua:12".
+ *
+ * \param l The Lua state.
+ * \param function_index Index of the function to call in the stack.
+ * \param nb_arguments Number of arguments above the function.
+ * \param function_name A name describing the Lua function.
+ * \return A description without ';'.
+ */
+std::string LuaProfiler::get_frame_name(
+    lua_State* l,
+    int function_index,
+    int nb_arguments,
+    const char* function_name
+) {
+  std::ostringstream oss;
+  oss << function_name;
+
+  // Methods get their object as first argument.
+  if (nb_arguments > 0) {
+    const int self_index = function_index + 1;
+    if (lua_type(l, self_index) == LUA_TUSERDATA) {
+      if (luaL_getmetafield(l, self_index, "__solarus_type")) {
+        lua_pop(l, 1);
+        const ExportableToLuaPtr& userdata =
+            *(static_cast<ExportableToLuaPtr*>(lua_touserdata(l, self_index)));
+        std::string type_name = userdata->get_lua_type_name();
+        if (type_name.compare(0, 4, "sol.") == 0) {
+          type_name = type_name.substr(4);
+        }
+        oss << " " << type_name;
+        const Entity* entity = dynamic_cast<const Entity*>(userdata.get());
+        if (entity != nullptr && !entity->get_name().empty()) {
+          oss << " " << entity->get_name();
+        }
+      }
+    }
+    else if (lua_type(l, self_index) == LUA_TTABLE) {
+      lua_getfield(l, LUA_REGISTRYINDEX, LuaContext::main_module_name.c_str());
+      if (lua_rawequal(l, -1, self_index)) {
+        oss << " main";
+      }
+      lua_pop(l, 1);
+    }
+  }
+
+  // Where the function is defined.
+  lua_Debug info;
+  lua_pushvalue(l, function_index);
+  if (lua_getinfo(l, ">S", &info) != 0) {
+    if (info.source != nullptr && info.source[0] == '@') {
+      oss << " " << (info.source + 1) << ":" << info.linedefined;
+    }
+    else {
+      oss << " " << info.short_src;
+    }
+  }
+
+  std::string name = oss.str();
+  std::replace(name.begin(), name.end(), ';', ',');
+  return name;
+}
+
+/**
+ * \brief Returns the size of the Lua heap.
+ * \param l The Lua state.
+ * \return The memory used in bytes.
+ */
+int64_t LuaProfiler::get_memory_used(lua_State* l) {
+
+  return static_cast<int64_t>(lua_gc(l, LUA_GCCOUNT, 0)) * 1024 +
+      lua_gc(l, LUA_GCCOUNTB, 0);
+}
+
+}
@@ -15,10 +15,12 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Map.h"
+#include "solarus/core/Trace.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/lua/LuaException.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <cctype>
 #include <sstream>
@@ -26,6 +28,45 @@
 namespace Solarus {
 namespace LuaTools {
 
+namespace {
+
+/**
+ * \brief Key of the message handler of call_function() in the registry.
+ *
+ * Only its address is used.
+ */
+const char message_handler_key = 0;
+
+/**
+ * \brief Key of the main thread in the registry.
+ *
+ * Only its address is used.
+ */
+const char main_thread_key = 0;
+
+/**
+ * \brief Pushes the message handler that adds a traceback to errors.
+ *
+ * The handler is a single function kept in the registry:
+ * pushing a new C function at each call would allocate a closure.
+ *
+ * \param l A Lua state.
+ */
+void push_message_handler(lua_State* l) {
+
+  lua_pushlightuserdata(l, const_cast<char*>(&message_handler_key));
+  lua_rawget(l, LUA_REGISTRYINDEX);
+  if (lua_isnil(l, -1)) {
+    lua_pop(l, 1);
+    lua_pushcfunction(l, &LuaContext::l_backtrace);
+    lua_pushlightuserdata(l, const_cast<char*>(&message_handler_key));
+    lua_pushvalue(l, -2);
+    lua_rawset(l, LUA_REGISTRYINDEX);
+  }
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief For an index in the Lua stack, returns an equivalent positive index.
  *
@@ -45,6 +86,42 @@ int get_positive_index(lua_State* l, int index) {
   return positive_index;
 }
 
+/**
+ * \brief Remembers the main thread of a Lua state.
+ *
+ * This must be called once from the main thread,
+ * before get_main_thread() is called from coroutines.
+ *
+ * \param l The main thread of a Lua state.
+ */
+void set_main_thread(lua_State* l) {
+
+  lua_pushlightuserdata(l, const_cast<char*>(&main_thread_key));
+  lua_pushthread(l);
+  lua_rawset(l, LUA_REGISTRYINDEX);
+}
+
+/**
+ * \brief Returns the main thread of the Lua state a thread belongs to.
+ * \param l A thread, possibly a coroutine.
+ * \return The main thread, or \c l itself if no main thread was set.
+ */
+lua_State* get_main_thread(lua_State* l) {
+
+  if (lua_pushthread(l) == 1) {
+    // Already the main thread.
+    lua_pop(l, 1);
+    return l;
+  }
+  lua_pop(l, 1);
+
+  lua_pushlightuserdata(l, const_cast<char*>(&main_thread_key));
+  lua_rawget(l, LUA_REGISTRYINDEX);
+  lua_State* main_thread = lua_tothread(l, -1);
+  lua_pop(l, 1);
+  return main_thread != nullptr ? main_thread : l;
+}
+
 /**
  * \brief Returns whether the specified name is a valid Lua identifier.
  * \param name The name to check.
@@ -74,7 +151,7 @@ bool is_valid_lua_identifier(const std::string& name) {
  */
 ScopedLuaRef create_ref(lua_State* l) {
 
-  return ScopedLuaRef(l, luaL_ref(l, LUA_REGISTRYINDEX));
+  return ScopedLuaRef::create(l);
 }
 
 /**
@@ -87,7 +164,7 @@ ScopedLuaRef create_ref(lua_State* l) {
 ScopedLuaRef create_ref(lua_State* l, int index) {
 
   lua_pushvalue(l, index);
-  return ScopedLuaRef(l, luaL_ref(l, LUA_REGISTRYINDEX));
+  return ScopedLuaRef::create(l);
 }
 
 /**
@@ -97,6 +174,7 @@ ScopedLuaRef create_ref(lua_State* l, int index) {
  * error message if an error occurs in the Lua code (the error is printed).
  * This function leaves the results on the stack if there is no error,
  * and leaves nothing on the stack in case of error.
+ * The traceback is only computed when an error occurs.
  *
  * \param l A Lua state.
  * \param nb_arguments Number of arguments placed on the Lua stack above the
@@ -116,10 +194,15 @@ bool call_function(
     const char* function_name
 ) {
   int base = lua_gettop(l) - nb_arguments;
-  lua_pushcfunction(l, &LuaContext::l_backtrace);
-  lua_insert(l, base);
-  int status = lua_pcall(l, nb_arguments, nb_results, base);
-  lua_remove(l,base);
+  int status = 0;
+  {
+    LuaProfiler::Scope profiler_scope(l, base, nb_arguments, function_name);
+    SOLARUS_TRACE_SCOPE(function_name);
+    push_message_handler(l);
+    lua_insert(l, base);
+    status = lua_pcall(l, nb_arguments, nb_results, base);
+    lua_remove(l,base);
+  }
   if (status != 0) {
     Debug::error(std::string("In ") + function_name + ": "
         + lua_tostring(l, -1)
@@ -155,6 +238,53 @@ bool do_string(
   return call_function(l, 0, 0, chunk_name.c_str());
 }
 
+/**
+ * \brief Pushes the array where a function stores its results.
+ *
+ * This allows scripts to pass the same table at each call
+ * instead of getting a new one.
+ *
+ * \param l A Lua state.
+ * \param index Index of an optional table argument to reuse.
+ * \param size Number of values that will be stored.
+ * The array is created with this size if there is no table argument.
+ */
+void push_result_array(
+    lua_State* l,
+    int index,
+    int size
+) {
+  if (lua_isnoneornil(l, index)) {
+    lua_createtable(l, size, 0);
+    return;
+  }
+
+  check_type(l, index, LUA_TTABLE);
+  lua_pushvalue(l, index);
+}
+
+/**
+ * \brief Removes the values of an array after a given size.
+ *
+ * Use this after filling a reused array with push_result_array(),
+ * so that values of a previous call do not remain.
+ *
+ * \param l A Lua state.
+ * \param table_index Index of the array in the stack.
+ * \param size The wanted size.
+ */
+void set_array_size(
+    lua_State* l,
+    int table_index,
+    int size
+) {
+  table_index = get_positive_index(l, table_index);
+  for (int i = static_cast<int>(lua_objlen(l, table_index)); i > size; --i) {
+    lua_pushnil(l);
+    lua_rawseti(l, table_index, i);
+  }
+}
+
 /**
  * \brief Similar to luaL_error() but throws a LuaException.
  *
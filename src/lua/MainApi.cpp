@@ -14,17 +14,28 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/AllocationTracker.h"
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestDatabase.h"
 #include "solarus/core/QuestProperties.h"
+#include "solarus/core/Savegame.h"
 #include "solarus/core/Settings.h"
+#include "solarus/core/String.h"
 #include "solarus/core/System.h"
+#include "solarus/core/Timer.h"
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
+#include <memory>
+#include <utility>
 
 namespace Solarus {
 
@@ -60,7 +71,18 @@ void LuaContext::register_main_module() {
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
     functions.insert(functions.end(), {
         { "get_quest_version", main_api_get_quest_version },
-        { "get_resource_ids", main_api_get_resource_ids }
+        { "get_resource_ids", main_api_get_resource_ids },
+        { "get_frame_timings", main_api_get_frame_timings },
+        { "get_allocation_stats", main_api_get_allocation_stats },
+        { "get_memory_stats", main_api_get_memory_stats },
+        { "preload_map", main_api_preload_map },
+        { "start_lua_profiler", main_api_start_lua_profiler },
+        { "stop_lua_profiler", main_api_stop_lua_profiler },
+        { "get_lua_profile", main_api_get_lua_profile },
+        { "start_coroutine", main_api_start_coroutine },
+        { "wait", main_api_wait },
+        { "get_background_mode", main_api_get_background_mode },
+        { "set_background_mode", main_api_set_background_mode }
     });
   }
   register_functions(main_module_name, functions);
@@ -250,6 +272,7 @@ int LuaContext::main_api_set_quest_write_dir(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     const std::string& quest_write_dir = LuaTools::opt_string(l, 1, "");
 
+    Savegame::wait_for_pending_saves();
     QuestFiles::set_quest_write_dir(quest_write_dir);
 
     return 0;
@@ -427,6 +450,317 @@ int LuaContext::main_api_get_os(lua_State* l) {
   return 1;
 }
 
+/**
+ * \brief Implementation of sol.main.get_frame_timings().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_frame_timings(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const FrameTimings& frame_timings = get_lua_context(l).get_main_loop().get_frame_timings();
+    const int num_frames = static_cast<int>(frame_timings.get_num_frames());
+    int max_frames = LuaTools::opt_int(l, 1, num_frames);
+    if (max_frames < 0) {
+      LuaTools::arg_error(l, 1, "Invalid number of frames: " + String::to_string(max_frames));
+    }
+    max_frames = std::min(max_frames, num_frames);
+
+    // Build a Lua array of the most recent frames, oldest first.
+    lua_settop(l, 0);
+    lua_createtable(l, max_frames, 0);
+    int i = 1;
+    for (int index = num_frames - max_frames; index < num_frames; ++index) {
+      const FrameTimings::Frame& frame = frame_timings.get_frame(index);
+      lua_createtable(l, 0, 12);
+      lua_pushinteger(l, frame.date);
+      lua_setfield(l, -2, "date");
+      lua_pushinteger(l, frame.num_updates);
+      lua_setfield(l, -2, "num_updates");
+      lua_pushinteger(l, frame.time_dropped);
+      lua_setfield(l, -2, "time_dropped");
+      lua_pushnumber(l, frame.input_time);
+      lua_setfield(l, -2, "input");
+      lua_pushnumber(l, frame.game_time);
+      lua_setfield(l, -2, "game");
+      lua_pushnumber(l, frame.lua_time);
+      lua_setfield(l, -2, "lua");
+      lua_pushnumber(l, frame.system_time);
+      lua_setfield(l, -2, "system");
+      lua_pushnumber(l, frame.draw_time);
+      lua_setfield(l, -2, "draw");
+      lua_pushnumber(l, frame.gc_time);
+      lua_setfield(l, -2, "gc");
+      lua_pushnumber(l, frame.total_time);
+      lua_setfield(l, -2, "total");
+      lua_pushinteger(l, frame.num_readbacks);
+      lua_setfield(l, -2, "readbacks");
+      lua_pushinteger(l, frame.num_full_readbacks);
+      lua_setfield(l, -2, "full_readbacks");
+      lua_pushinteger(l, frame.num_draw_calls);
+      lua_setfield(l, -2, "draw_calls");
+      lua_rawseti(l, 1, i);
+      ++i;
+    }
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_allocation_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_allocation_stats(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const bool total = LuaTools::opt_boolean(l, 1, false);
+
+    if (!AllocationTracker::is_enabled()) {
+      // The engine was built without allocation tracking.
+      lua_pushnil(l);
+      return 1;
+    }
+
+    // One table per scope with the counters of the last frame,
+    // or of the whole run.
+    lua_createtable(l, 0, AllocationTracker::num_scopes);
+    for (int i = 0; i < AllocationTracker::num_scopes; ++i) {
+      const AllocationTracker::Scope scope = static_cast<AllocationTracker::Scope>(i);
+      const AllocationTracker::Counters counters = total ?
+          AllocationTracker::get_total_counters(scope) :
+          AllocationTracker::get_frame_counters(scope);
+      lua_createtable(l, 0, 3);
+      lua_pushnumber(l, static_cast<lua_Number>(counters.num_allocations));
+      lua_setfield(l, -2, "allocations");
+      lua_pushnumber(l, static_cast<lua_Number>(counters.num_bytes));
+      lua_setfield(l, -2, "bytes");
+      lua_pushnumber(l, static_cast<lua_Number>(counters.num_frees));
+      lua_setfield(l, -2, "frees");
+      lua_setfield(l, -2, AllocationTracker::get_scope_name(scope).c_str());
+    }
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_memory_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_memory_stats(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    // One table per category with its bytes and its number of objects.
+    const std::vector<MemoryStats::Entry>& report =
+        MemoryStats::get_report(get_lua_context(l));
+    lua_createtable(l, 0, static_cast<int>(report.size()));
+    for (const MemoryStats::Entry& entry: report) {
+      lua_createtable(l, 0, 2);
+      lua_pushnumber(l, static_cast<lua_Number>(entry.num_bytes));
+      lua_setfield(l, -2, "bytes");
+      lua_pushnumber(l, static_cast<lua_Number>(entry.num_objects));
+      lua_setfield(l, -2, "objects");
+      lua_setfield(l, -2, entry.name.c_str());
+    }
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.preload_map().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_preload_map(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const std::string& map_id = LuaTools::check_string(l, 1);
+    if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
+      LuaTools::arg_error(l, 1, std::string("No such map: '") + map_id + "'");
+    }
+
+    ResourceProvider& resource_provider = get_lua_context(l).get_main_loop().get_resource_provider();
+    resource_provider.start_preloading_map(map_id);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.start_lua_profiler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_start_lua_profiler(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    LuaProfiler& lua_profiler = get_lua_context(l).get_main_loop().get_lua_profiler();
+    lua_profiler.clear();
+    lua_profiler.set_enabled(true);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.stop_lua_profiler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_stop_lua_profiler(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    LuaProfiler& lua_profiler = get_lua_context(l).get_main_loop().get_lua_profiler();
+    lua_profiler.set_enabled(false);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_lua_profile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_lua_profile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const LuaProfiler& lua_profiler = get_lua_context(l).get_main_loop().get_lua_profiler();
+    const std::vector<LuaProfiler::Entry>& entries = lua_profiler.get_entries();
+
+    // Build a Lua array of the call stacks.
+    lua_settop(l, 0);
+    lua_createtable(l, static_cast<int>(entries.size()), 0);
+    int i = 1;
+    for (const LuaProfiler::Entry& entry: entries) {
+      lua_createtable(l, 0, 4);
+      push_string(l, entry.stack);
+      lua_setfield(l, -2, "stack");
+      lua_pushnumber(l, entry.time);
+      lua_setfield(l, -2, "time");
+      lua_pushnumber(l, static_cast<lua_Number>(entry.num_calls));
+      lua_setfield(l, -2, "num_calls");
+      lua_pushnumber(l, static_cast<lua_Number>(entry.memory));
+      lua_setfield(l, -2, "memory");
+      lua_rawseti(l, 1, i);
+      ++i;
+    }
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.start_coroutine().
+ *
+ * The coroutine runs until it returns or calls a waiting function
+ * like sol.main.wait(), and is then resumed by the engine.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_start_coroutine(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TFUNCTION);
+    LuaContext& lua_context = get_lua_context(l);
+
+    // Move the function and its arguments to a new coroutine.
+    const int nb_arguments = lua_gettop(l) - 1;
+    lua_State* thread = lua_newthread(l);
+    if (!lua_checkstack(thread, nb_arguments + 1)) {
+      LuaTools::error(l, "Too many arguments to start the coroutine");
+    }
+    lua_insert(l, 1);
+    lua_xmove(l, thread, nb_arguments + 1);
+
+    lua_context.resume_coroutine(thread, nb_arguments);
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.wait().
+ *
+ * Suspends the running coroutine until a timer expires.
+ * Like for sol.timer.start(), the timer belongs to the current map
+ * during a game and to sol.main otherwise.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_wait(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const uint32_t delay = uint32_t(LuaTools::check_int(l, 1));
+    LuaContext& lua_context = get_lua_context(l);
+    ScopedLuaRef resumer_ref = create_coroutine_resumer(l, "sol.main.wait");
+
+    // Use the stack of the context: the coroutine may have been resumed
+    // by coroutine.resume() rather than by the engine.
+    lua_State* context_l = lua_context.l;
+    Game* game = lua_context.get_main_loop().get_game();
+    if (game != nullptr && game->has_current_map()) {
+      push_map(context_l, game->get_current_map());
+    }
+    else {
+      push_main(context_l);
+    }
+    // Even with a zero delay, the coroutine is only resumed by the timer
+    // scheduler, once it has yielded.
+    lua_context.add_timer(std::make_shared<Timer>(delay), -1, std::move(resumer_ref));
+    lua_pop(context_l, 1);
+
+    return lua_yield(l, 0);
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_background_mode().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_background_mode(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    push_string(l, get_lua_context(l).get_main_loop().get_background_mode());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.set_background_mode().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_set_background_mode(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& background_mode = LuaTools::check_string(l, 1);
+    if (background_mode != "continue" &&
+        background_mode != "throttle" &&
+        background_mode != "pause") {
+      LuaTools::arg_error(l, 1, "Invalid background mode: '" + background_mode +
+          "' (should be \"continue\", \"throttle\" or \"pause\")");
+    }
+
+    get_lua_context(l).get_main_loop().set_background_mode(background_mode);
+    return 0;
+  });
+}
+
 /**
  * \brief Calls sol.main.on_started() if it exists.
  *
@@ -499,5 +833,20 @@ bool LuaContext::main_on_input(const InputEvent& event) {
   return handled;
 }
 
+/**
+ * \brief Calls sol.main.on_window_state_changed() if it exists.
+ * \param state The new state of the window:
+ * "visible", "unfocused" or "hidden".
+ */
+void LuaContext::main_on_window_state_changed(const std::string& state) {
+
+  push_main(l);
+  if (find_method("on_window_state_changed")) {
+    push_string(l, state);
+    call_function(2, 0, "on_window_state_changed");
+  }
+  lua_pop(l, 1);
+}
+
 }
 
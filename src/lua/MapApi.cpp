@@ -22,7 +22,6 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
-#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Timer.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Block.h"
@@ -45,6 +44,7 @@
 #include "solarus/entities/Jumper.h"
 #include "solarus/entities/Npc.h"
 #include "solarus/entities/Pickable.h"
+#include "solarus/entities/ProjectilePool.h"
 #include "solarus/entities/Sensor.h"
 #include "solarus/entities/Separator.h"
 #include "solarus/entities/ShopTreasure.h"
@@ -56,11 +56,13 @@
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/Wall.h"
+#include "solarus/graphics/Surface.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
 #include <lua.hpp>
 #include <sstream>
+#include <utility>
 
 namespace Solarus {
 
@@ -127,10 +129,14 @@ void LuaContext::register_map_module() {
       { "get_location", map_api_get_location },
       { "get_floor", map_api_get_floor },
       { "set_floor", map_api_set_floor },
+      { "get_activity_distance", map_api_get_activity_distance },
+      { "set_activity_distance", map_api_set_activity_distance },
       { "get_tileset", map_api_get_tileset },
       { "set_tileset", map_api_set_tileset },
       { "get_music", map_api_get_music },
       { "get_camera", map_api_get_camera },
+      { "get_cameras", map_api_get_cameras },
+      { "create_camera", map_api_create_camera },
       { "get_camera_position", map_api_get_camera_position },
       { "move_camera", map_api_move_camera },
       { "get_ground", map_api_get_ground },
@@ -148,11 +154,26 @@ void LuaContext::register_map_module() {
       { "get_entities_count", map_api_get_entities_count },
       { "has_entities", map_api_has_entities },
       { "get_entities_by_type", map_api_get_entities_by_type },
+      { "get_entities_count_by_type", map_api_get_entities_count_by_type },
       { "get_entities_in_rectangle", map_api_get_entities_in_rectangle },
+      { "get_entities_count_in_rectangle", map_api_get_entities_count_in_rectangle },
+      { "get_first_entity_in_rectangle", map_api_get_first_entity_in_rectangle },
+      { "cast_ray", map_api_cast_ray },
       { "get_entities_in_region", map_api_get_entities_in_region },
+      { "get_entities_positions", map_api_get_entities_positions },
+      { "create_entities", map_api_create_entities },
       { "get_hero", map_api_get_hero },
       { "set_entities_enabled", map_api_set_entities_enabled },
-      { "remove_entities", map_api_remove_entities }
+      { "remove_entities", map_api_remove_entities },
+      { "create_projectile_pool", map_api_create_projectile_pool },
+      { "remove_projectile_pool", map_api_remove_projectile_pool },
+      { "get_overview_surface", map_api_get_overview_surface },
+      { "get_overview_reveal_radius", map_api_get_overview_reveal_radius },
+      { "set_overview_reveal_radius", map_api_set_overview_reveal_radius },
+      { "reveal_overview", map_api_reveal_overview },
+      { "is_overview_revealed", map_api_is_overview_revealed },
+      { "get_overview_revealed_squares", map_api_get_overview_revealed_squares },
+      { "set_overview_revealed_squares", map_api_set_overview_revealed_squares }
   };
 
   const std::vector<luaL_Reg> metamethods = {
@@ -177,6 +198,12 @@ void LuaContext::register_map_module() {
     lua_setfield(l, -2, function_name.c_str());
   }
 
+  // Add map:iterate_entities_by_type() as a closure that owns the iterator
+  // function, so that calling it does not allocate a new function each time.
+  lua_pushcfunction(l, l_entity_by_type_iterator_next);
+  lua_pushcclosure(l, map_api_iterate_entities_by_type, 1);
+  lua_setfield(l, -2, "iterate_entities_by_type");
+
   // Add a Lua implementation of the deprecated map:move_camera() function.
   int result = luaL_loadstring(l, move_camera_code);
   if (result != 0) {
@@ -414,43 +441,18 @@ int LuaContext::l_create_tile(lua_State* l) {
     Map& map = *check_map(l, 1);
     EntityData& data = *(static_cast<EntityData*>(lua_touserdata(l, 2)));
     const int layer = entity_creation_check_layer(l, 1, data, map);
-    const int x = data.get_xy().x;
-    const int y = data.get_xy().y;
     const Size size =  entity_creation_check_size(l, 1, data);
-    const std::string& tile_pattern_id = data.get_string("pattern");
     std::string tileset_id = data.get_string("tileset");
 
     if (tileset_id.empty()) {
       tileset_id = map.get_tileset_id();
     }
-    ResourceProvider& resource_provider = map.get_game().get_resource_provider();
-    const Tileset& tileset = resource_provider.get_tileset(tileset_id);
-    const TilePattern& pattern = tileset.get_tile_pattern(tile_pattern_id);
-    const Size& pattern_size = pattern.get_size();
-    Entities& entities = map.get_entities();
-
-    // If the tile is big, divide it in several smaller tiles so that
-    // most of them can still be optimized away.
-    // Otherwise, tiles expanded in big rectangles like a lake or a dungeon
-    // floor would be entirely redrawn at each frame when just one small
-    // animated tile overlaps them.
-
-    TileInfo tile_info;
-    tile_info.layer = layer;
-    tile_info.box = { Point(), pattern_size };
-    tile_info.pattern_id = tile_pattern_id;
-    tile_info.pattern = &pattern;
-    tile_info.tileset = &tileset;
-
-    for (int current_y = y; current_y < y + size.height; current_y += pattern.get_height()) {
-      for (int current_x = x; current_x < x + size.width; current_x += pattern.get_width()) {
-        tile_info.box.set_xy(current_x, current_y);
-        // The tile will actually be created only if it cannot be optimized away.
-        entities.add_tile_info(
-            tile_info
-        );
-      }
-    }
+    map.get_entities().add_tiles(
+        layer,
+        Rectangle(data.get_xy(), size),
+        map.get_used_tileset(tileset_id),
+        data.get_string("pattern")
+    );
 
     return 0;
   });
@@ -831,8 +833,7 @@ int LuaContext::l_create_dynamic_tile(lua_State* l) {
     if (tileset_id.empty()) {
       tileset_id = map.get_tileset_id();
     }
-    ResourceProvider& resource_provider = map.get_game().get_resource_provider();
-    const Tileset& tileset = resource_provider.get_tileset(tileset_id);
+    const Tileset& tileset = map.get_used_tileset(tileset_id);
 
     EntityPtr entity = std::make_shared<DynamicTile>(
         data.get_name(),
@@ -1344,9 +1345,9 @@ bool LuaContext::create_map_entity_from_data(Map& map, const EntityData& entity_
   const std::string& type_name = enum_to_name(entity_data.get_type());
   std::string function_name = "create_" + type_name;
   const auto& it = entity_creation_functions.find(entity_data.get_type());
-  Debug::check_assertion(it != entity_creation_functions.end(),
-      "Missing entity creation function for type '" + type_name + "'"
-  );
+  Debug::check_assertion_lazy(it != entity_creation_functions.end(), [&] {
+    return "Missing entity creation function for type '" + type_name + "'";
+  });
   lua_CFunction function = it->second;
 
   lua_pushcfunction(l, function);
@@ -1355,6 +1356,31 @@ bool LuaContext::create_map_entity_from_data(Map& map, const EntityData& entity_
   return call_function(2, 1, function_name.c_str());
 }
 
+/**
+ * \brief Creates on the current map an entity from the specified data
+ * and returns it.
+ *
+ * Unlike create_map_entity_from_data(), nothing is left on the Lua stack.
+ *
+ * \param map The map where to create an entity. It must be started.
+ * \param entity_data Description of the entity to create.
+ * \return The entity created, or nullptr if there was an error or if no
+ * entity was created (like a treasure already obtained).
+ */
+EntityPtr LuaContext::create_map_entity(Map& map, const EntityData& entity_data) {
+
+  if (!create_map_entity_from_data(map, entity_data)) {
+    return nullptr;
+  }
+
+  EntityPtr entity;
+  if (is_entity(l, -1)) {
+    entity = check_entity(l, -1);
+  }
+  lua_pop(l, 1);
+  return entity;
+}
+
 /**
  * \brief __index function of the environment of the map's code.
  *
@@ -1389,13 +1415,70 @@ int LuaContext::l_get_map_entity_or_global(lua_State* l) {
   });
 }
 
+/**
+ * \brief Iterator function of map:iterate_entities_by_type().
+ *
+ * This is a stateless iterator: the state is the map and the control value
+ * is the type name for the first call, then the previous entity.
+ * The position of the previous entity in the list of its type and layer
+ * gives the next one, so iterating allocates nothing.
+ * Entities are visited by layer, in no particular order within a layer.
+ * The iteration stops if the previous entity was removed from the map.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_entity_by_type_iterator_next(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const Map& map = *check_map(l, 1);
+    const Entities& entities = map.get_entities();
+
+    EntityType type = EntityType::TILE;
+    int layer = map.get_min_layer();
+    size_t index = 0;
+    if (lua_type(l, 2) == LUA_TSTRING) {
+      // First call.
+      type = LuaTools::check_enum<EntityType>(l, 2);
+    }
+    else {
+      const Entity& previous = *check_entity(l, 2);
+      type = previous.get_type();
+      if (!previous.is_on_map() ||
+          &previous.get_map() != &map ||
+          previous.get_type_list_index() < 0) {
+        // Removed meanwhile: we don't know where we were.
+        return 0;
+      }
+      layer = previous.get_layer();
+      index = static_cast<size_t>(previous.get_type_list_index());
+      const EntityVector& list = entities.get_entities_by_type(type, layer);
+      if (index >= list.size() || list[index].get() != &previous) {
+        return 0;
+      }
+      ++index;
+    }
+
+    for (; layer <= map.get_max_layer(); ++layer, index = 0) {
+      const EntityVector& list = entities.get_entities_by_type(type, layer);
+      if (index < list.size()) {
+        push_entity(l, *list[index]);
+        return 1;
+      }
+    }
+
+    // Finished.
+    return 0;
+  });
+}
+
 /**
  * \brief Closure of an iterator over a list of entities.
  *
- * This closure expects 3 upvalues in this order:
- * - The array of entities.
- * - The size of the array (for performance).
- * - The current index in the array.
+ * This closure expects 2 upvalues in this order:
+ * - A userdata with the EntityVector (see push_entity_iterator()).
+ * - The current index in the list, starting at 0.
  *
  * \param l The Lua context that is calling this function.
  * \return Number of values to return to Lua.
@@ -1405,22 +1488,23 @@ int LuaContext::l_entity_iterator_next(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
 
     // Get upvalues.
-    const int table_index = lua_upvalueindex(1);
-    const int size = lua_tointeger(l, lua_upvalueindex(2));
-    int index = lua_tointeger(l, lua_upvalueindex(3));
+    const EntityVector& entities = *static_cast<EntityVector*>(
+        lua_touserdata(l, lua_upvalueindex(1))
+    );
+    size_t index = static_cast<size_t>(lua_tointeger(l, lua_upvalueindex(2)));
 
-    if (index > size) {
+    if (index >= entities.size()) {
       // Finished.
       return 0;
     }
 
     // Get the next value.
-    lua_rawgeti(l, table_index, index);
+    push_entity(l, *entities[index]);
 
     // Increment index.
     ++index;
-    lua_pushinteger(l, index);
-    lua_replace(l, lua_upvalueindex(3));
+    lua_pushinteger(l, static_cast<lua_Integer>(index));
+    lua_replace(l, lua_upvalueindex(2));
 
     return 1;
   });
@@ -1587,6 +1671,52 @@ int LuaContext::map_api_set_floor(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:get_activity_distance().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_activity_distance(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    if (map.get_activity_distance() == 0) {
+      lua_pushnil(l);
+    }
+    else {
+      lua_pushinteger(l, map.get_activity_distance());
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_activity_distance().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_activity_distance(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    int activity_distance = 0;
+    if (lua_type(l, 2) != LUA_TNUMBER && lua_type(l, 2) != LUA_TNIL) {
+      LuaTools::type_error(l, 2, "number or nil");
+    }
+    if (!lua_isnil(l, 2)) {
+      activity_distance = LuaTools::check_int(l, 2);
+      if (activity_distance <= 0) {
+        LuaTools::arg_error(l, 2, "Activity distance must be positive");
+      }
+    }
+
+    map.set_activity_distance(activity_distance);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of map:get_size().
  * \param l the Lua context that is calling this function
@@ -1700,6 +1830,50 @@ int LuaContext::map_api_get_camera(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:get_cameras().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_cameras(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    const std::vector<CameraPtr>& cameras = map.get_cameras();
+    lua_createtable(l, static_cast<int>(cameras.size()), 0);
+    int i = 1;
+    for (const CameraPtr& camera: cameras) {
+      push_camera(l, *camera);
+      lua_rawseti(l, -2, i);
+      ++i;
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:create_camera().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_create_camera(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    if (map.get_cameras().size() >= Entities::max_cameras) {
+      LuaTools::error(l, "Too many cameras on this map (the maximum is " +
+          std::to_string(Entities::max_cameras) + ")");
+    }
+
+    CameraPtr camera = std::make_shared<Camera>(map);
+    map.get_entities().add_entity(camera);
+    push_camera(l, *camera);
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of map:get_camera_position().
  * \param l The Lua context that is calling this function.
@@ -1804,6 +1978,7 @@ int LuaContext::map_api_draw_visual(lua_State* l) {
     Drawable& drawable = *check_drawable(l, 2);
     int x = LuaTools::check_int(l, 3);
     int y = LuaTools::check_int(l, 4);
+    get_lua_context(l).update_skipped_drawable(drawable);
 
     map.draw_visual(drawable, x, y);
 
@@ -2026,10 +2201,10 @@ int LuaContext::map_api_get_entities(lua_State* l) {
     Map& map = *check_map(l, 1);
     const std::string& prefix = LuaTools::opt_string(l, 2, "");
 
-    const EntityVector& entities =
+    EntityVector entities =
         map.get_entities().get_entities_with_prefix_sorted(prefix);
 
-    push_entity_iterator(l, entities);
+    push_entity_iterator(l, std::move(entities));
     return 1;
   });
 }
@@ -2080,14 +2255,59 @@ int LuaContext::map_api_get_entities_by_type(lua_State* l) {
     Map& map = *check_map(l, 1);
     EntityType type = LuaTools::check_enum<EntityType>(l, 2);
 
-    const EntityVector& entities =
+    EntityVector entities =
         map.get_entities().get_entities_by_type_sorted(type);
 
-    push_entity_iterator(l, entities);
+    push_entity_iterator(l, std::move(entities));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_entities_count_by_type().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_entities_count_by_type(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    EntityType type = LuaTools::check_enum<EntityType>(l, 2);
+
+    size_t count = 0;
+    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+      count += map.get_entities().get_entities_by_type(type, layer).size();
+    }
+
+    lua_pushinteger(l, static_cast<lua_Integer>(count));
     return 1;
   });
 }
 
+/**
+ * \brief Implementation of map:iterate_entities_by_type().
+ *
+ * Unlike map:get_entities_by_type(), no list and no closure are created:
+ * this returns the values of a stateless generic for,
+ * that is the iterator function (upvalue of this closure), the map and
+ * the name of the type as initial control value.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_iterate_entities_by_type(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    check_map(l, 1);
+    LuaTools::check_enum<EntityType>(l, 2);
+
+    lua_pushvalue(l, lua_upvalueindex(1));
+    lua_pushvalue(l, 1);
+    lua_pushvalue(l, 2);
+    return 3;
+  });
+}
+
 /**
  * \brief Implementation of map:get_entities_in_rectangle().
  * \param l The Lua context that is calling this function.
@@ -2107,11 +2327,122 @@ int LuaContext::map_api_get_entities_in_rectangle(lua_State* l) {
         Rectangle(x, y, width, height), entities
     );
 
-    push_entity_iterator(l, entities);
+    push_entity_iterator(l, std::move(entities));
     return 1;
   });
 }
 
+/**
+ * \brief Implementation of map:get_entities_count_in_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_entities_count_in_rectangle(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+    const Rectangle rectangle(x, y, width, height);
+
+    int count = 0;
+    if (lua_isnoneornil(l, 6)) {
+      count = map.get_entities().get_num_entities_in_rectangle(rectangle);
+    }
+    else {
+      EntityType type = LuaTools::check_enum<EntityType>(l, 6);
+      count = map.get_entities().get_num_entities_in_rectangle(rectangle, type);
+    }
+
+    lua_pushinteger(l, count);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_first_entity_in_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_first_entity_in_rectangle(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+    const Rectangle rectangle(x, y, width, height);
+
+    EntityPtr entity;
+    if (lua_isnoneornil(l, 6)) {
+      entity = map.get_entities().get_first_entity_in_rectangle(rectangle);
+    }
+    else {
+      EntityType type = LuaTools::check_enum<EntityType>(l, 6);
+      entity = map.get_entities().get_first_entity_in_rectangle(rectangle, type);
+    }
+
+    if (entity == nullptr) {
+      lua_pushnil(l);
+    }
+    else {
+      push_entity(l, *entity);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:cast_ray().
+ *
+ * Returns how many pixels an entity can move in a straight line before
+ * reaching an obstacle, and the obstacle entity if any.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_cast_ray(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    Entity& entity = *check_entity(l, 2);
+    const int direction8 = LuaTools::check_int(l, 3);
+    const int max_distance = LuaTools::check_int(l, 4);
+
+    if (direction8 < 0 || direction8 >= 8) {
+      LuaTools::arg_error(l, 3, "Direction must be between 0 and 7");
+    }
+    if (max_distance < 0) {
+      LuaTools::arg_error(l, 4, "Distance must be positive or zero");
+    }
+    if (!entity.is_on_map() || &entity.get_map() != &map) {
+      LuaTools::arg_error(l, 2, "This entity is not on this map");
+    }
+
+    Entity* obstacle_entity = nullptr;
+    const int distance = map.cast_ray(
+        entity.get_layer(),
+        entity.get_bounding_box(),
+        Entity::direction_to_xy_move(direction8),
+        max_distance,
+        entity,
+        obstacle_entity
+    );
+
+    lua_pushinteger(l, distance);
+    if (obstacle_entity == nullptr) {
+      lua_pushnil(l);
+    }
+    else {
+      push_entity(l, *obstacle_entity);
+    }
+    return 2;
+  });
+}
+
 /**
  * \brief Implementation of map:get_entities_in_region().
  * \param l The Lua context that is calling this function.
@@ -2149,7 +2480,39 @@ int LuaContext::map_api_get_entities_in_region(lua_State* l) {
       }
     }
 
-    push_entity_iterator(l, entities);
+    push_entity_iterator(l, std::move(entities));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_entities_positions().
+ *
+ * Does the job of entity:get_position() for an array of entities
+ * in one call. The result is a flat array x1, y1, layer1, x2, y2, ...
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_entities_positions(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    check_map(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+    const int num_entities = static_cast<int>(lua_objlen(l, 2));
+
+    LuaTools::push_result_array(l, 3, num_entities * 3);
+    const int result_index = lua_gettop(l);
+    for (int i = 1; i <= num_entities; ++i) {
+      const Entity& entity = check_entity_in_array(l, 2, i);
+      lua_pushinteger(l, entity.get_x());
+      lua_rawseti(l, result_index, i * 3 - 2);
+      lua_pushinteger(l, entity.get_y());
+      lua_rawseti(l, result_index, i * 3 - 1);
+      lua_pushinteger(l, entity.get_layer());
+      lua_rawseti(l, result_index, i * 3);
+    }
+    LuaTools::set_array_size(l, result_index, num_entities * 3);
     return 1;
   });
 }
@@ -2210,6 +2573,227 @@ int LuaContext::map_api_remove_entities(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:create_projectile_pool().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_create_projectile_pool(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+
+    const std::string& image_file_name = LuaTools::check_string_field(l, 2, "image");
+    const int layer = LuaTools::check_layer_field(l, 2, "layer", map);
+    int width = LuaTools::opt_int_field(l, 2, "width", 0);
+    int height = LuaTools::opt_int_field(l, 2, "height", 0);
+    const int max_projectiles = LuaTools::opt_int_field(
+        l, 2, "max_projectiles", ProjectilePool::default_max_projectiles);
+
+    std::set<EntityType> target_types;
+    lua_getfield(l, 2, "entity_type");
+    if (lua_isnil(l, -1)) {
+      target_types.insert(EntityType::HERO);
+    }
+    else if (lua_isstring(l, -1)) {
+      target_types.insert(LuaTools::check_enum<EntityType>(l, -1));
+    }
+    else if (lua_istable(l, -1)) {
+      const int num_types = static_cast<int>(lua_objlen(l, -1));
+      for (int i = 1; i <= num_types; ++i) {
+        lua_rawgeti(l, -1, i);
+        target_types.insert(LuaTools::check_enum<EntityType>(l, -1));
+        lua_pop(l, 1);
+      }
+    }
+    else {
+      LuaTools::arg_error(l, 2, std::string(
+          "Bad field 'entity_type' (string or table expected, got ") +
+          luaL_typename(l, -1) + ")");
+    }
+    lua_pop(l, 1);
+
+    if (width < 0 || height < 0) {
+      LuaTools::arg_error(l, 2, "The size of projectiles cannot be negative");
+    }
+    if (max_projectiles < 0) {
+      LuaTools::arg_error(l, 2, "max_projectiles cannot be negative");
+    }
+
+    const SurfacePtr& image = Surface::create(image_file_name, Surface::DIR_SPRITES);
+    if (image == nullptr) {
+      LuaTools::arg_error(l, 2, std::string("Cannot load projectile image '") + image_file_name + "'");
+    }
+    // The collision box defaults to the size of the image.
+    if (width == 0) {
+      width = image->get_width();
+    }
+    if (height == 0) {
+      height = image->get_height();
+    }
+    if (width == 0 || height == 0) {
+      LuaTools::arg_error(l, 2, "Projectiles cannot be empty");
+    }
+
+    std::shared_ptr<ProjectilePool> projectile_pool =
+        std::make_shared<ProjectilePool>(image, Size(width, height), layer);
+    projectile_pool->set_target_types(target_types);
+    projectile_pool->set_max_projectiles(max_projectiles);
+    map.add_projectile_pool(projectile_pool);
+
+    push_projectile_pool(l, *projectile_pool);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:remove_projectile_pool().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_remove_projectile_pool(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    ProjectilePool& projectile_pool = *check_projectile_pool(l, 2);
+
+    map.remove_projectile_pool(projectile_pool);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_overview_surface().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_overview_surface(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    push_surface(l, *map.get_overview().get_surface());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_overview_reveal_radius().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_overview_reveal_radius(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    const MapOverview& overview = map.get_overview();
+    if (!overview.is_fog_enabled()) {
+      lua_pushnil(l);
+    }
+    else {
+      lua_pushinteger(l, overview.get_reveal_radius());
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_overview_reveal_radius().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_overview_reveal_radius(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    MapOverview& overview = map.get_overview();
+    if (lua_isnil(l, 2)) {
+      overview.disable_fog();
+    }
+    else {
+      const int reveal_radius = LuaTools::check_int(l, 2);
+      if (reveal_radius < 0) {
+        LuaTools::arg_error(l, 2, "The reveal radius cannot be negative");
+      }
+      overview.set_reveal_radius(reveal_radius);
+    }
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:reveal_overview().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_reveal_overview(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int radius = LuaTools::opt_int(l, 4, 0);
+    if (radius < 0) {
+      LuaTools::arg_error(l, 4, "The radius cannot be negative");
+    }
+
+    map.get_overview().reveal(Point(x, y), radius);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:is_overview_revealed().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_overview_revealed(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+
+    lua_pushboolean(l, map.get_overview().is_revealed(Point(x, y)));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_overview_revealed_squares().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_overview_revealed_squares(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    push_string(l, map.get_overview().get_revealed_squares());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_overview_revealed_squares().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_overview_revealed_squares(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    const std::string& revealed_squares = LuaTools::check_string(l, 2);
+
+    map.get_overview().set_revealed_squares(revealed_squares);
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of all entity creation functions: map_api_create_*.
  * \param l The Lua context that is calling this function.
@@ -2231,6 +2815,60 @@ int LuaContext::map_api_create_entity(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:create_entities().
+ *
+ * Creates entities described by an array of tables like the ones of
+ * map:create_*(), each one with an additional field "type".
+ * All descriptions are checked before creating anything.
+ * The entities are added to the map as one batch,
+ * and their on_created() events are called once all of them exist.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_create_entities(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+
+    const int num_entities = static_cast<int>(lua_objlen(l, 2));
+    std::vector<EntityData> entities_data;
+    entities_data.reserve(num_entities);
+    for (int i = 1; i <= num_entities; ++i) {
+      lua_rawgeti(l, 2, i);
+      if (!lua_istable(l, -1)) {
+        LuaTools::arg_error(l, 2, "Entity " + std::to_string(i) + ": table expected, got "
+            + luaL_typename(l, -1));
+      }
+      const int index = lua_gettop(l);
+      const EntityType type = LuaTools::check_enum_field<EntityType>(l, index, "type");
+      if (!EntityTypeInfo::can_be_created_from_lua_api(type)) {
+        LuaTools::arg_error(l, 2, "Entity " + std::to_string(i) + ": cannot create entities of type '"
+            + enum_to_name(type) + "'");
+      }
+      entities_data.push_back(EntityData::check_entity_data(l, index, type));
+      lua_pop(l, 1);
+    }
+
+    LuaContext& lua_context = get_lua_context(l);
+    Entities& entities = map.get_entities();
+    lua_createtable(l, num_entities, 0);
+    const int result_index = lua_gettop(l);
+
+    entities.start_creation_batch(entities_data);
+    for (int i = 0; i < num_entities; ++i) {
+      if (lua_context.create_map_entity_from_data(map, entities_data[i])) {
+        lua_rawseti(l, result_index, i + 1);
+      }
+    }
+    entities.finish_creation_batch();
+
+    return 1;
+  });
+}
+
 /**
  * \brief Calls the on_started() method of a Lua map.
  *
@@ -2278,10 +2916,7 @@ void LuaContext::map_on_finished(Map& map) {
 void LuaContext::map_on_update(Map& map) {
 
   push_map(l, map);
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(map, method_name)) {
+  if (userdata_has_event(map, CachedEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -2299,7 +2934,7 @@ void LuaContext::map_on_update(Map& map) {
 void LuaContext::map_on_draw(Map& map, const SurfacePtr& dst_surface) {
 
   push_map(l, map);
-  if (userdata_has_field(map, "on_draw")) {
+  if (userdata_has_event(map, CachedEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
@@ -14,11 +14,14 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/graphics/Drawable.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <list>
+#include <utility>
 #include <lua.hpp>
 
 namespace Solarus {
@@ -34,12 +37,19 @@ const std::string LuaContext::menu_module_name = "sol.menu";
 void LuaContext::register_menu_module() {
 
   // Functions of sol.menu.
-  const std::vector<luaL_Reg> functions = {
+  std::vector<luaL_Reg> functions = {
       { "start", menu_api_start },
       { "stop", menu_api_stop },
       { "stop_all", menu_api_stop_all },
       { "is_started", menu_api_is_started }
   };
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    functions.insert(functions.end(), {
+        { "set_retained", menu_api_set_retained },
+        { "is_retained", menu_api_is_retained },
+        { "invalidate", menu_api_invalidate }
+    });
+  }
 
   register_functions(menu_module_name, functions);
 }
@@ -55,7 +65,7 @@ void LuaContext::register_menu_module() {
  * same context, \c false to place it behind.
  */
 void LuaContext::add_menu(
-    const ScopedLuaRef& menu_ref,
+    ScopedLuaRef menu_ref,
     int context_index,
     bool on_top
 ) {
@@ -69,14 +79,15 @@ void LuaContext::add_menu(
     context = lua_topointer(l, context_index);
   }
 
+  std::list<LuaMenuData>& context_menus = menus[context];
   if (on_top) {
-    menus.emplace_back(menu_ref, context);
+    context_menus.emplace_back(std::move(menu_ref), context);
+    menu_on_started(context_menus.back().ref);
   }
   else {
-    menus.emplace_front(menu_ref, context);
+    context_menus.emplace_front(std::move(menu_ref), context);
+    menu_on_started(context_menus.front().ref);
   }
-
-  menu_on_started(menu_ref);
 }
 
 /**
@@ -98,16 +109,21 @@ void LuaContext::remove_menus(int context_index) {
     context = lua_topointer(l, context_index);
   }
 
+  const auto it = menus.find(context);
+  if (it == menus.end()) {
+    return;
+  }
+  std::list<LuaMenuData>& context_menus = it->second;
+
   // Some menu:on_finished() callbacks may create menus themselves,
   // and we don't want those new menus to get removed.
-  for (LuaMenuData& menu: menus) {
+  for (LuaMenuData& menu: context_menus) {
     menu.recently_added = false;
   }
 
-  for (LuaMenuData& menu: menus) {
-    ScopedLuaRef menu_ref = menu.ref;
+  for (LuaMenuData& menu: context_menus) {
     if (menu.context == context && !menu.recently_added) {
-      menu.ref.clear();
+      ScopedLuaRef menu_ref = std::move(menu.ref);
       menu.context = nullptr;
       menu_on_finished(menu_ref);
     }
@@ -123,18 +139,22 @@ void LuaContext::remove_menus() {
 
   // Some menu:on_finished() callbacks may create menus themselves,
   // and we don't want those new menus to get removed.
-  for (LuaMenuData& menu: menus) {
-    menu.recently_added = false;
+  for (auto& kvp: menus) {
+    for (LuaMenuData& menu: kvp.second) {
+      menu.recently_added = false;
+    }
   }
 
-  for (LuaMenuData& menu: menus) {
+  // Menus created meanwhile in new contexts do not invalidate iterators.
+  for (auto& kvp: menus) {
+    for (LuaMenuData& menu: kvp.second) {
 
-    if (!menu.recently_added) {
-      ScopedLuaRef menu_ref = menu.ref;
-      if (!menu_ref.is_empty()) {
-        menu.ref.clear();
-        menu.context = nullptr;
-        menu_on_finished(menu_ref);
+      if (!menu.recently_added) {
+        ScopedLuaRef menu_ref = std::move(menu.ref);
+        if (!menu_ref.is_empty()) {
+          menu.context = nullptr;
+          menu_on_finished(menu_ref);
+        }
       }
     }
   }
@@ -157,19 +177,30 @@ void LuaContext::destroy_menus() {
 void LuaContext::update_menus() {
 
   // Destroy the ones that should be removed.
-  for (auto it = menus.begin();
-      it != menus.end();
-      // No ++it (elements may be removed while traversing).
-  ) {
-    it->recently_added = false;
-    if (it->ref.is_empty()) {
-      // Empty ref on a menu means that we should remove.
-      // In this case, context must also be nullptr.
-      Debug::check_assertion(it->context == nullptr, "Menu with context and no ref");
-      it = menus.erase(it);
+  for (auto context_it = menus.begin(); context_it != menus.end();) {
+    std::list<LuaMenuData>& context_menus = context_it->second;
+    for (auto it = context_menus.begin();
+        it != context_menus.end();
+        // No ++it (elements may be removed while traversing).
+    ) {
+      it->recently_added = false;
+      if (it->ref.is_empty()) {
+        // Empty ref on a menu means that we should remove.
+        // In this case, context must also be nullptr.
+        Debug::check_assertion(it->context == nullptr, "Menu with context and no ref");
+        it = context_menus.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+
+    // Forget contexts without menus.
+    if (context_menus.empty()) {
+      context_it = menus.erase(context_it);
     }
     else {
-      ++it;
+      ++context_it;
     }
   }
 }
@@ -192,8 +223,8 @@ int LuaContext::menu_api_start(lua_State *l) {
     lua_settop(l, 2);
 
     LuaContext& lua_context = get_lua_context(l);
-    const ScopedLuaRef& menu_ref = lua_context.create_ref();
-    lua_context.add_menu(menu_ref, 1, on_top);
+    ScopedLuaRef menu_ref = lua_context.create_ref();
+    lua_context.add_menu(std::move(menu_ref), 1, on_top);
 
     return 0;
   });
@@ -211,18 +242,18 @@ int LuaContext::menu_api_stop(lua_State* l) {
 
     LuaTools::check_type(l, 1, LUA_TTABLE);
 
-    std::list<LuaMenuData>& menus = lua_context.menus;
-    for (LuaMenuData& menu: menus) {
-      push_ref(l, menu.ref);
-      if (lua_equal(l, 1, -1)) {
-        ScopedLuaRef menu_ref = menu.ref;  // Don't erase it immediately since we may be iterating over menus.
-        menu.ref.clear();
-        menu.context = nullptr;
-        lua_context.menu_on_finished(menu_ref);
+    for (auto& kvp: lua_context.menus) {
+      for (LuaMenuData& menu: kvp.second) {
+        push_ref(l, menu.ref);
+        if (lua_equal(l, 1, -1)) {
+          ScopedLuaRef menu_ref = std::move(menu.ref);  // Don't erase it immediately since we may be iterating over menus.
+          menu.context = nullptr;
+          lua_context.menu_on_finished(menu_ref);
+          lua_pop(l, 1);
+          return 0;
+        }
         lua_pop(l, 1);
-        break;
       }
-      lua_pop(l, 1);
     }
 
     return 0;
@@ -261,23 +292,104 @@ int LuaContext::menu_api_is_started(lua_State* l) {
     LuaTools::check_type(l, 1, LUA_TTABLE);
 
     bool found = false;
-    std::list<LuaMenuData>& menus = lua_context.menus;
-    for (LuaMenuData& menu: menus) {
+    for (auto it = lua_context.menus.begin(); it != lua_context.menus.end() && !found; ++it) {
+      for (LuaMenuData& menu: it->second) {
+        push_ref(l, menu.ref);
+        found = lua_equal(l, 1, -1);
+        lua_pop(l, 1);
+
+        if (found) {
+          break;
+        }
+      }
+    }
+
+    lua_pushboolean(l, found);
+
+    return 1;
+  });
+}
+
+/**
+ * \brief Returns the data of a running menu.
+ * \param menu_index Index of a menu table in the stack.
+ * \return The data of this menu, or nullptr if it is not started.
+ */
+LuaContext::LuaMenuData* LuaContext::find_menu(int menu_index) {
+
+  menu_index = LuaTools::get_positive_index(l, menu_index);
+  for (auto& kvp: menus) {
+    for (LuaMenuData& menu: kvp.second) {
       push_ref(l, menu.ref);
-      found = lua_equal(l, 1, -1);
+      const bool found = lua_equal(l, menu_index, -1);
       lua_pop(l, 1);
-
       if (found) {
-        break;
+        return &menu;
       }
     }
+  }
+  return nullptr;
+}
 
-    lua_pushboolean(l, found);
+/**
+ * \brief Implementation of sol.menu.set_retained().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::menu_api_set_retained(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+    bool retained = LuaTools::opt_boolean(l, 2, true);
+
+    LuaMenuData* menu = get_lua_context(l).find_menu(1);
+    if (menu == nullptr) {
+      LuaTools::arg_error(l, 1, "This menu is not started");
+    }
+    menu->retained = retained;
+    menu->invalidated = true;
+    menu->draw_list.clear();
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.menu.is_retained().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::menu_api_is_retained(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+
+    const LuaMenuData* menu = get_lua_context(l).find_menu(1);
+    lua_pushboolean(l, menu != nullptr && menu->retained);
 
     return 1;
   });
 }
 
+/**
+ * \brief Implementation of sol.menu.invalidate().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::menu_api_invalidate(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+
+    LuaMenuData* menu = get_lua_context(l).find_menu(1);
+    if (menu != nullptr) {
+      menu->invalidated = true;
+    }
+
+    return 0;
+  });
+}
+
 /**
  * \brief Calls the on_started() method of a Lua menu.
  * \param menu_ref A reference to the menu object.
@@ -422,7 +534,11 @@ void LuaContext::menus_on_update(int context_index) {
     context = lua_topointer(l, context_index);
   }
 
-  for (LuaMenuData& menu: menus) {
+  const auto it = menus.find(context);
+  if (it == menus.end()) {
+    return;
+  }
+  for (LuaMenuData& menu: it->second) {
     if (menu.context == context) {
       menu_on_update(menu.ref);
     }
@@ -446,13 +562,75 @@ void LuaContext::menus_on_draw(int context_index, const SurfacePtr& dst_surface)
     context = lua_topointer(l, context_index);
   }
 
-  for (LuaMenuData& menu: menus) {
+  const auto it = menus.find(context);
+  if (it == menus.end()) {
+    return;
+  }
+  for (LuaMenuData& menu: it->second) {
     if (menu.context == context) {
-      menu_on_draw(menu.ref, dst_surface);
+      if (menu.retained) {
+        retained_menu_on_draw(menu, dst_surface);
+      }
+      else {
+        menu_on_draw(menu.ref, dst_surface);
+      }
     }
   }
 }
 
+/**
+ * \brief Draws a retained menu.
+ *
+ * The on_draw() method is only called when the menu was invalidated or
+ * when the destination surface changes.
+ * Its draws on the destination surface are recorded and replayed from
+ * C++ at the next cycles.
+ * Children menus are drawn normally.
+ *
+ * \param menu A retained menu.
+ * \param dst_surface The destination surface.
+ */
+void LuaContext::retained_menu_on_draw(LuaMenuData& menu, const SurfacePtr& dst_surface) {
+
+  push_ref(l, menu.ref);
+  if (!menu.invalidated && menu.draw_list_surface.lock() == dst_surface) {
+    menu.draw_list.replay(dst_surface, [this](Drawable& drawable) {
+      update_skipped_drawable(drawable);
+    });
+  }
+  else {
+    // Invalidating the menu from on_draw() records it again next time.
+    menu.invalidated = false;
+    menu.draw_list.clear();
+    menu.draw_list_surface = dst_surface;
+
+    DrawList* previous_recording = draw_recording;
+    const Surface* previous_recording_surface = draw_recording_surface;
+    draw_recording = &menu.draw_list;
+    draw_recording_surface = dst_surface.get();
+    on_draw(dst_surface);
+    draw_recording = previous_recording;
+    draw_recording_surface = previous_recording_surface;
+  }
+  menus_on_draw(-1, dst_surface);  // Draw children menus if any.
+  lua_pop(l, 1);
+}
+
+/**
+ * \brief Returns where to record operations on a surface if a retained
+ * menu is being drawn on it.
+ * \param dst_surface A surface about to be modified.
+ * \return The draw list to fill, or nullptr if operations on this surface
+ * are not recorded.
+ */
+DrawList* LuaContext::get_draw_recording(const Surface& dst_surface) {
+
+  if (&dst_surface != draw_recording_surface) {
+    return nullptr;
+  }
+  return draw_recording;
+}
+
 /**
  * \brief Calls the on_input() method of the menus associated to a context.
  * \param context_index Index of an object with menus.
@@ -471,9 +649,15 @@ bool LuaContext::menus_on_input(int context_index, const InputEvent& event) {
     context = lua_topointer(l, context_index);
   }
 
+  const auto context_it = menus.find(context);
+  if (context_it == menus.end()) {
+    return false;
+  }
+  std::list<LuaMenuData>& context_menus = context_it->second;
+
   bool handled = false;
   std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
+  for (it = context_menus.rbegin(); it != context_menus.rend() && !handled; ++it) {
     const ScopedLuaRef& menu_ref = it->ref;
     if (it->context == context) {
       handled = menu_on_input(menu_ref, event);
@@ -502,9 +686,15 @@ bool LuaContext::menus_on_command_pressed(int context_index,
     context = lua_topointer(l, context_index);
   }
 
+  const auto context_it = menus.find(context);
+  if (context_it == menus.end()) {
+    return false;
+  }
+  std::list<LuaMenuData>& context_menus = context_it->second;
+
   bool handled = false;
   std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
+  for (it = context_menus.rbegin(); it != context_menus.rend() && !handled; ++it) {
     const ScopedLuaRef& menu_ref = it->ref;
     if (it->context == context) {
       handled = menu_on_command_pressed(menu_ref, command);
@@ -533,9 +723,15 @@ bool LuaContext::menus_on_command_released(int context_index,
     context = lua_topointer(l, context_index);
   }
 
+  const auto context_it = menus.find(context);
+  if (context_it == menus.end()) {
+    return false;
+  }
+  std::list<LuaMenuData>& context_menus = context_it->second;
+
   bool handled = false;
   std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
+  for (it = context_menus.rbegin(); it != context_menus.rend() && !handled; ++it) {
     const ScopedLuaRef& menu_ref = it->ref;
     if (it->context == context) {
       handled = menu_on_command_released(menu_ref, command);
@@ -18,6 +18,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/System.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/graphics/Drawable.h"
@@ -104,7 +105,9 @@ void LuaContext::register_movement_module() {
       { "stop", movement_api_stop },
       { "get_ignore_obstacles", movement_api_get_ignore_obstacles },
       { "set_ignore_obstacles", movement_api_set_ignore_obstacles },
-      { "get_direction4", movement_api_get_direction4 }
+      { "get_direction4", movement_api_get_direction4 },
+      { "are_position_notifications_batched", movement_api_are_position_notifications_batched },
+      { "set_position_notifications_batched", movement_api_set_position_notifications_batched }
   };
 
   // Metamethods of all movement types.
@@ -490,8 +493,11 @@ void LuaContext::update_movements() {
   lua_pop(l, 1);  // Pop the movements table.
 
   // Work on a copy of the list because the list may be changed during the iteration.
+  const uint32_t now = System::now();
   for (const std::shared_ptr<Movement>& movement : movements) {
-    movement->update();
+    if (movement->is_update_needed(now)) {
+      movement->update();
+    }
   }
 }
 
@@ -645,7 +651,7 @@ int LuaContext::movement_api_start(lua_State* l) {
     else {
       LuaTools::type_error(l, 2, "table, entity or drawable");
     }
-    movement->set_finished_callback(callback_ref);
+    movement->set_finished_callback(std::move(callback_ref));
 
     return 0;
   });
@@ -716,6 +722,38 @@ int LuaContext::movement_api_set_ignore_obstacles(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of movement:are_position_notifications_batched().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::movement_api_are_position_notifications_batched(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    std::shared_ptr<Movement> movement = check_movement(l, 1);
+
+    lua_pushboolean(l, movement->are_position_notifications_batched());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of movement:set_position_notifications_batched().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::movement_api_set_position_notifications_batched(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    std::shared_ptr<Movement> movement = check_movement(l, 1);
+    bool batched = LuaTools::opt_boolean(l, 2, true);
+
+    movement->set_position_notifications_batched(batched);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of movement:get_direction4().
  * \param l the Lua context that is calling this function
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Size.h"
+#include "solarus/graphics/ParticleEmitter.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the particle emitter module.
+ */
+const std::string LuaContext::particle_emitter_module_name = "sol.particle_emitter";
+
+/**
+ * \brief Initializes the particle emitter features provided to Lua.
+ */
+void LuaContext::register_particle_emitter_module() {
+
+  // Functions of sol.particle_emitter.
+  const std::vector<luaL_Reg> functions = {
+      { "create", particle_emitter_api_create }
+  };
+
+  // Methods of the particle emitter type.
+  const std::vector<luaL_Reg> methods = {
+      { "emit", particle_emitter_api_emit },
+      { "clear", particle_emitter_api_clear },
+      { "get_num_particles", particle_emitter_api_get_num_particles },
+      { "get_rate", particle_emitter_api_get_rate },
+      { "set_rate", particle_emitter_api_set_rate },
+      { "get_size", particle_emitter_api_get_size },
+      { "draw", drawable_api_draw },
+      { "draw_region", drawable_api_draw_region },
+      { "get_blend_mode", drawable_api_get_blend_mode },
+      { "set_blend_mode", drawable_api_set_blend_mode },
+      { "set_shader", drawable_api_set_shader },
+      { "get_shader", drawable_api_get_shader },
+      { "get_opacity", drawable_api_get_opacity },
+      { "set_opacity", drawable_api_set_opacity },
+      { "fade_in", drawable_api_fade_in },
+      { "fade_out", drawable_api_fade_out },
+      { "get_xy", drawable_api_get_xy },
+      { "set_xy", drawable_api_set_xy },
+      { "get_rotation", drawable_api_get_rotation },
+      { "set_rotation", drawable_api_set_rotation },
+      { "get_scale", drawable_api_get_scale },
+      { "set_scale", drawable_api_set_scale },
+      { "get_transformation_origin", drawable_api_get_transformation_origin },
+      { "set_transformation_origin", drawable_api_set_transformation_origin },
+      { "get_color_modulation", drawable_api_get_color_modulation },
+      { "set_color_modulation", drawable_api_set_color_modulation },
+      { "get_movement", drawable_api_get_movement },
+      { "stop_movement", drawable_api_stop_movement }
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", drawable_meta_gc },
+      { "__newindex", userdata_meta_newindex_as_table },
+      { "__index", userdata_meta_index_as_table }
+  };
+
+  register_type(particle_emitter_module_name, functions, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type particle emitter.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return true if the value at this index is a particle emitter.
+ */
+bool LuaContext::is_particle_emitter(lua_State* l, int index) {
+  return is_userdata(l, index, particle_emitter_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * particle emitter and returns it.
+ * \param l a Lua context
+ * \param index an index in the stack
+ * \return the particle emitter
+ */
+std::shared_ptr<ParticleEmitter> LuaContext::check_particle_emitter(lua_State* l, int index) {
+  return std::static_pointer_cast<ParticleEmitter>(check_userdata(
+      l, index, particle_emitter_module_name
+  ));
+}
+
+/**
+ * \brief Pushes a particle emitter userdata onto the stack.
+ * \param l a Lua context
+ * \param particle_emitter a particle emitter
+ */
+void LuaContext::push_particle_emitter(lua_State* l, ParticleEmitter& particle_emitter) {
+  push_userdata(l, particle_emitter);
+}
+
+/**
+ * \brief Implementation of sol.particle_emitter.create().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_create(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+
+    const std::string& image_file_name = LuaTools::check_string_field(l, 1, "image");
+    const int width = LuaTools::opt_int_field(l, 1, "width", 0);
+    const int height = LuaTools::opt_int_field(l, 1, "height", 0);
+    const int max_particles = LuaTools::opt_int_field(
+        l, 1, "max_particles", ParticleEmitter::default_max_particles);
+    const double rate = LuaTools::opt_number_field(l, 1, "rate", 0.0);
+    const int lifetime = LuaTools::opt_int_field(
+        l, 1, "lifetime", ParticleEmitter::default_lifetime);
+    const double speed = LuaTools::opt_number_field(l, 1, "speed", 0.0);
+    const double speed_variation = LuaTools::opt_number_field(l, 1, "speed_variation", 0.0);
+    const double angle = LuaTools::opt_number_field(l, 1, "angle", 0.0);
+    const double angle_variation = LuaTools::opt_number_field(l, 1, "angle_variation", 0.0);
+    const double gravity_x = LuaTools::opt_number_field(l, 1, "gravity_x", 0.0);
+    const double gravity_y = LuaTools::opt_number_field(l, 1, "gravity_y", 0.0);
+    const bool fade_out = LuaTools::opt_boolean_field(l, 1, "fade_out", true);
+
+    if (width < 0 || height < 0) {
+      LuaTools::arg_error(l, 1, "The emission size cannot be negative");
+    }
+    if (max_particles < 0) {
+      LuaTools::arg_error(l, 1, "max_particles cannot be negative");
+    }
+    if (rate < 0.0) {
+      LuaTools::arg_error(l, 1, "rate cannot be negative");
+    }
+    if (lifetime < 0) {
+      LuaTools::arg_error(l, 1, "lifetime cannot be negative");
+    }
+
+    const SurfacePtr& image = Surface::create(image_file_name, Surface::DIR_SPRITES);
+    if (image == nullptr) {
+      LuaTools::arg_error(l, 1, std::string("Cannot load particle image '") + image_file_name + "'");
+    }
+
+    std::shared_ptr<ParticleEmitter> particle_emitter =
+        std::make_shared<ParticleEmitter>(image);
+    particle_emitter->set_emission_size(Size(width, height));
+    particle_emitter->set_max_particles(max_particles);
+    particle_emitter->set_rate(rate);
+    particle_emitter->set_lifetime(static_cast<uint32_t>(lifetime));
+    particle_emitter->set_speed(speed, speed_variation);
+    particle_emitter->set_angle(angle, angle_variation);
+    particle_emitter->set_gravity(gravity_x, gravity_y);
+    particle_emitter->set_fading_out(fade_out);
+    get_lua_context(l).add_drawable(particle_emitter);
+
+    push_particle_emitter(l, *particle_emitter);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:emit().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_emit(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+    int count = LuaTools::opt_int(l, 2, 1);
+
+    particle_emitter.emit(count);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:clear().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_clear(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+
+    particle_emitter.clear();
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:get_num_particles().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_get_num_particles(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+
+    lua_pushinteger(l, particle_emitter.get_num_particles());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:get_rate().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_get_rate(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+
+    lua_pushnumber(l, particle_emitter.get_rate());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:set_rate().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_set_rate(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+    double rate = LuaTools::check_number(l, 2);
+
+    if (rate < 0.0) {
+      LuaTools::arg_error(l, 2, "The rate cannot be negative");
+    }
+    particle_emitter.set_rate(rate);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of particle_emitter:get_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::particle_emitter_api_get_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ParticleEmitter& particle_emitter = *check_particle_emitter(l, 1);
+
+    const Size& size = particle_emitter.get_emission_size();
+    lua_pushinteger(l, size.width);
+    lua_pushinteger(l, size.height);
+    return 2;
+  });
+}
+
+}
+
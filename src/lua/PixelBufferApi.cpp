@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Checks that a pixel buffer is locked.
+ * \param l A Lua context.
+ * \param pixel_buffer The pixel buffer to check.
+ */
+void check_locked(lua_State* l, const PixelBuffer& pixel_buffer) {
+
+  if (!pixel_buffer.is_locked()) {
+    LuaTools::error(l, "This pixel buffer is not locked");
+  }
+}
+
+/**
+ * \brief Checks that two values are the coordinates of a pixel of a buffer.
+ * \param l A Lua context.
+ * \param index Index of the x coordinate in the stack.
+ * \param pixel_buffer The pixel buffer.
+ * \param[out] x The x coordinate.
+ * \param[out] y The y coordinate.
+ */
+void check_pixel_xy(lua_State* l, int index, const PixelBuffer& pixel_buffer, int& x, int& y) {
+
+  x = LuaTools::check_int(l, index);
+  y = LuaTools::check_int(l, index + 1);
+  if (!pixel_buffer.contains(x, y)) {
+    LuaTools::arg_error(l, index, "Pixel out of the buffer");
+  }
+}
+
+}  // Anonymous namespace.
+
+/**
+ * Name of the Lua table representing the pixel buffer module.
+ */
+const std::string LuaContext::pixel_buffer_module_name = "sol.pixel_buffer";
+
+/**
+ * \brief Initializes the pixel buffer features provided to Lua.
+ *
+ * Pixel buffers are created with surface:lock_pixels().
+ */
+void LuaContext::register_pixel_buffer_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  const std::vector<luaL_Reg> methods = {
+      { "get_surface", pixel_buffer_api_get_surface },
+      { "get_region", pixel_buffer_api_get_region },
+      { "is_locked", pixel_buffer_api_is_locked },
+      { "lock", pixel_buffer_api_lock },
+      { "unlock", pixel_buffer_api_unlock },
+      { "get_pixel", pixel_buffer_api_get_pixel },
+      { "set_pixel", pixel_buffer_api_set_pixel },
+      { "fill_color", pixel_buffer_api_fill_color },
+      { "get_pixels", pixel_buffer_api_get_pixels },
+      { "set_pixels", pixel_buffer_api_set_pixels }
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", userdata_meta_gc }
+  };
+
+  register_type(pixel_buffer_module_name, {}, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type pixel buffer.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return true if the value at this index is a pixel buffer.
+ */
+bool LuaContext::is_pixel_buffer(lua_State* l, int index) {
+  return is_userdata(l, index, pixel_buffer_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * pixel buffer and returns it.
+ * \param l a Lua context
+ * \param index an index in the stack
+ * \return the pixel buffer
+ */
+std::shared_ptr<PixelBuffer> LuaContext::check_pixel_buffer(lua_State* l, int index) {
+  return std::static_pointer_cast<PixelBuffer>(check_userdata(
+      l, index, pixel_buffer_module_name
+  ));
+}
+
+/**
+ * \brief Pushes a pixel buffer userdata onto the stack.
+ * \param l a Lua context
+ * \param pixel_buffer a pixel buffer
+ */
+void LuaContext::push_pixel_buffer(lua_State* l, PixelBuffer& pixel_buffer) {
+  push_userdata(l, pixel_buffer);
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_surface().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_surface(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    push_surface(l, *pixel_buffer.get_surface());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_region().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_region(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    const Rectangle& region = pixel_buffer.get_region();
+    lua_pushinteger(l, region.get_x());
+    lua_pushinteger(l, region.get_y());
+    lua_pushinteger(l, region.get_width());
+    lua_pushinteger(l, region.get_height());
+    return 4;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:is_locked().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_is_locked(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    lua_pushboolean(l, pixel_buffer.is_locked());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:lock().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_lock(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    pixel_buffer.lock();
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:unlock().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_unlock(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    pixel_buffer.unlock();
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_pixel().
+ *
+ * The color is returned as four integers rather than a table
+ * because this is called for many pixels.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_pixel(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    int x = 0;
+    int y = 0;
+    check_pixel_xy(l, 2, pixel_buffer, x, y);
+    check_locked(l, pixel_buffer);
+
+    uint8_t r, g, b, a;
+    pixel_buffer.get_pixel(x, y).get_components(r, g, b, a);
+    lua_pushinteger(l, r);
+    lua_pushinteger(l, g);
+    lua_pushinteger(l, b);
+    lua_pushinteger(l, a);
+    return 4;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:set_pixel().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_set_pixel(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    int x = 0;
+    int y = 0;
+    check_pixel_xy(l, 2, pixel_buffer, x, y);
+    const int r = LuaTools::check_int(l, 4);
+    const int g = LuaTools::check_int(l, 5);
+    const int b = LuaTools::check_int(l, 6);
+    const int a = LuaTools::opt_int(l, 7, 255);
+    check_locked(l, pixel_buffer);
+
+    pixel_buffer.set_pixel(x, y, Color(r, g, b, a));
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:fill_color().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_fill_color(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const Color& color = LuaTools::check_color(l, 2);
+    check_locked(l, pixel_buffer);
+
+    pixel_buffer.fill_with_color(color);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_pixels().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_pixels(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    check_locked(l, pixel_buffer);
+
+    push_string(l, pixel_buffer.get_pixels());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:set_pixels().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_set_pixels(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const std::string& buffer = LuaTools::check_string(l, 2);
+    check_locked(l, pixel_buffer);
+
+    pixel_buffer.set_pixels(buffer);
+    return 0;
+  });
+}
+
+}
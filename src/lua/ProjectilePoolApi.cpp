@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/ProjectilePool.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Checks that a value is the id of a projectile of a pool.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return The projectile id. Removed projectiles are accepted.
+ */
+uint32_t check_projectile_id(lua_State* l, int index) {
+
+  const int id = LuaTools::check_int(l, index);
+  if (id <= 0) {
+    LuaTools::arg_error(l, index, "Invalid projectile id");
+  }
+  return static_cast<uint32_t>(id);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * Name of the Lua table representing the projectile pool module.
+ */
+const std::string LuaContext::projectile_pool_module_name = "sol.projectile_pool";
+
+/**
+ * \brief Initializes the projectile pool features provided to Lua.
+ *
+ * Projectile pools are created with map:create_projectile_pool().
+ */
+void LuaContext::register_projectile_pool_module() {
+
+  const std::vector<luaL_Reg> methods = {
+      { "create_projectile", projectile_pool_api_create_projectile },
+      { "remove_projectile", projectile_pool_api_remove_projectile },
+      { "has_projectile", projectile_pool_api_has_projectile },
+      { "get_projectile_position", projectile_pool_api_get_projectile_position },
+      { "get_num_projectiles", projectile_pool_api_get_num_projectiles },
+      { "get_max_projectiles", projectile_pool_api_get_max_projectiles },
+      { "clear", projectile_pool_api_clear },
+      { "get_layer", projectile_pool_api_get_layer },
+      { "get_size", projectile_pool_api_get_size }
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", userdata_meta_gc },
+      { "__newindex", userdata_meta_newindex_as_table },
+      { "__index", userdata_meta_index_as_table }
+  };
+
+  register_type(projectile_pool_module_name, {}, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type projectile pool.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return true if the value at this index is a projectile pool.
+ */
+bool LuaContext::is_projectile_pool(lua_State* l, int index) {
+  return is_userdata(l, index, projectile_pool_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * projectile pool and returns it.
+ * \param l a Lua context
+ * \param index an index in the stack
+ * \return the projectile pool
+ */
+std::shared_ptr<ProjectilePool> LuaContext::check_projectile_pool(lua_State* l, int index) {
+  return std::static_pointer_cast<ProjectilePool>(check_userdata(
+      l, index, projectile_pool_module_name
+  ));
+}
+
+/**
+ * \brief Pushes a projectile pool userdata onto the stack.
+ * \param l a Lua context
+ * \param projectile_pool a projectile pool
+ */
+void LuaContext::push_projectile_pool(lua_State* l, ProjectilePool& projectile_pool) {
+  push_userdata(l, projectile_pool);
+}
+
+/**
+ * \brief Implementation of projectile_pool:create_projectile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_create_projectile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+    const double x = LuaTools::check_number(l, 2);
+    const double y = LuaTools::check_number(l, 3);
+    const double angle = LuaTools::check_number(l, 4);
+    const double speed = LuaTools::check_number(l, 5);
+
+    const uint32_t id = projectile_pool.create_projectile(x, y, angle, speed);
+    if (id == 0) {
+      lua_pushnil(l);
+    }
+    else {
+      lua_pushinteger(l, id);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:remove_projectile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_remove_projectile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+    const uint32_t id = check_projectile_id(l, 2);
+
+    projectile_pool.remove_projectile(id);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:has_projectile().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_has_projectile(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+    const uint32_t id = check_projectile_id(l, 2);
+
+    lua_pushboolean(l, projectile_pool.has_projectile(id));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:get_projectile_position().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_get_projectile_position(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+    const uint32_t id = check_projectile_id(l, 2);
+
+    if (!projectile_pool.has_projectile(id)) {
+      lua_pushnil(l);
+      return 1;
+    }
+    const Point& xy = projectile_pool.get_projectile_xy(id);
+    lua_pushinteger(l, xy.x);
+    lua_pushinteger(l, xy.y);
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:get_num_projectiles().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_get_num_projectiles(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+
+    lua_pushinteger(l, projectile_pool.get_num_projectiles());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:get_max_projectiles().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_get_max_projectiles(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+
+    lua_pushinteger(l, projectile_pool.get_max_projectiles());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:clear().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_clear(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+
+    projectile_pool.clear();
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:get_layer().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_get_layer(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+
+    lua_pushinteger(l, projectile_pool.get_layer());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of projectile_pool:get_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::projectile_pool_api_get_size(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const ProjectilePool& projectile_pool = *check_projectile_pool(l, 1);
+
+    const Size& size = projectile_pool.get_size();
+    lua_pushinteger(l, size.width);
+    lua_pushinteger(l, size.height);
+    return 2;
+  });
+}
+
+/**
+ * \brief Calls the on_hits() method of a projectile pool if it is defined.
+ *
+ * All projectiles that hit something during a cycle are notified at once,
+ * as an array of tables with fields id, x, y and entity
+ * (nil if a wall was hit).
+ *
+ * \param projectile_pool A projectile pool.
+ * \param hits The projectiles that hit something. They are already removed.
+ */
+void LuaContext::projectile_pool_on_hits(
+    ProjectilePool& projectile_pool,
+    const std::vector<ProjectilePool::Hit>& hits
+) {
+  if (!userdata_has_field(projectile_pool, "on_hits")) {
+    return;
+  }
+
+  push_projectile_pool(l, projectile_pool);
+  if (find_method("on_hits")) {
+    lua_createtable(l, static_cast<int>(hits.size()), 0);
+    for (size_t i = 0; i < hits.size(); ++i) {
+      const ProjectilePool::Hit& hit = hits[i];
+      lua_createtable(l, 0, 4);
+      lua_pushinteger(l, hit.id);
+      lua_setfield(l, -2, "id");
+      lua_pushinteger(l, hit.xy.x);
+      lua_setfield(l, -2, "x");
+      lua_pushinteger(l, hit.xy.y);
+      lua_setfield(l, -2, "y");
+      if (hit.entity != nullptr) {
+        push_entity(l, *hit.entity);
+        lua_setfield(l, -2, "entity");
+      }
+      lua_rawseti(l, -2, static_cast<int>(i + 1));
+    }
+    call_function(2, 0, "on_hits");
+  }
+  lua_pop(l, 1);
+}
+
+}
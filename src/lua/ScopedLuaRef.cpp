@@ -20,6 +20,37 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Key of the ref pool in the registry.
+ *
+ * Only its address is used.
+ */
+const char pool_key = 0;
+
+/**
+ * \brief Pushes the table of the ref pool onto the stack.
+ *
+ * The table is created the first time.
+ *
+ * \param l A Lua state.
+ */
+void push_pool(lua_State* l) {
+
+  lua_pushlightuserdata(l, const_cast<char*>(&pool_key));
+  lua_rawget(l, LUA_REGISTRYINDEX);
+  if (lua_isnil(l, -1)) {
+    lua_pop(l, 1);
+    lua_newtable(l);
+    lua_pushlightuserdata(l, const_cast<char*>(&pool_key));
+    lua_pushvalue(l, -2);
+    lua_rawset(l, LUA_REGISTRYINDEX);
+  }
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates an empty scoped Lua ref.
  */
@@ -31,7 +62,7 @@ ScopedLuaRef::ScopedLuaRef():
 /**
  * \brief Creates a scoped Lua ref.
  * \param l The Lua state (cannot be nullptr).
- * \param ref The Lua ref, possibly LUA_REFNIL or LUA_NOREF.
+ * \param ref Index in the pool, possibly LUA_REFNIL or LUA_NOREF.
  */
 ScopedLuaRef::ScopedLuaRef(lua_State* l, int ref):
     l(l),
@@ -39,20 +70,6 @@ ScopedLuaRef::ScopedLuaRef(lua_State* l, int ref):
   Debug::check_assertion(l != nullptr, "Missing Lua state");
 }
 
-/**
- * \brief Copy constructor.
- *
- * This creates a new reference to the same Lua value.
- *
- * \param other The object to copy.
- */
-ScopedLuaRef::ScopedLuaRef(const ScopedLuaRef& other):
-    l(other.l),
-    ref(LUA_REFNIL) {
-
-  *this = other;
-}
-
 /**
  * \brief Move constructor.
  *
@@ -75,29 +92,6 @@ ScopedLuaRef::~ScopedLuaRef() {
   clear();
 }
 
-/**
- * \brief Copy assignment operator.
- * \param other The object to copy.
- * \return The current ref after modification.
- */
-ScopedLuaRef& ScopedLuaRef::operator=(const ScopedLuaRef& other) {
-
-  clear();
-  this->l = other.l;
-  if (l != nullptr) {
-    if (other.ref == LUA_REFNIL || other.ref == LUA_NOREF) {
-      this->ref = other.ref;
-    }
-    else {
-      // Get the value and make another ref of it.
-      lua_rawgeti(l, LUA_REGISTRYINDEX, other.ref);
-      this->ref = luaL_ref(l, LUA_REGISTRYINDEX);
-    }
-  }
-
-  return *this;
-}
-
 /**
  * \brief Move assignment operator.
  * \param other The object to move.
@@ -105,6 +99,10 @@ ScopedLuaRef& ScopedLuaRef::operator=(const ScopedLuaRef& other) {
  */
 ScopedLuaRef& ScopedLuaRef::operator=(ScopedLuaRef&& other) {
 
+  if (&other == this) {
+    return *this;
+  }
+
   clear();
   this->l = other.l;
   this->ref = other.ref;
@@ -114,8 +112,31 @@ ScopedLuaRef& ScopedLuaRef::operator=(ScopedLuaRef&& other) {
   return *this;
 }
 
+/**
+ * \brief Creates a ref to the Lua value on top of the stack and pops
+ * this value.
+ *
+ * Slots of the pool released earlier are reused first.
+ * The ref belongs to the main thread even if \c l is a coroutine,
+ * so that it stays valid after the coroutine ends.
+ *
+ * \param l A Lua state.
+ * \return The ref created, empty if the value is nil.
+ */
+ScopedLuaRef ScopedLuaRef::create(lua_State* l) {
+
+  push_pool(l);
+  lua_insert(l, -2);
+  const int ref = luaL_ref(l, -2);
+  lua_pop(l, 1);
+  return ScopedLuaRef(LuaTools::get_main_thread(l), ref);
+}
+
 /**
  * \brief Returns the Lua state this ref lives in.
+ *
+ * This is always the main thread of the Lua state.
+ *
  * \return The Lua state (nullptr means that the ref is empty).
  */
 lua_State* ScopedLuaRef::get_lua_state() const {
@@ -133,7 +154,7 @@ bool ScopedLuaRef::is_empty() const {
 
 /**
  * \brief Returns the ref.
- * \return The encapsulated ref, possibly LUA_REFNIL or LUA_NOREF.
+ * \return Index of the value in the pool, possibly LUA_REFNIL or LUA_NOREF.
  */
 int ScopedLuaRef::get() const {
   return ref;
@@ -142,12 +163,14 @@ int ScopedLuaRef::get() const {
 /**
  * \brief Destroys the ref.
  *
- * This calls luaL_unref().
+ * Its slot goes back to the free list of the pool.
  */
 void ScopedLuaRef::clear() {
 
-  if (l != nullptr) {
-    luaL_unref(l, LUA_REGISTRYINDEX, ref);
+  if (l != nullptr && ref != LUA_REFNIL && ref != LUA_NOREF) {
+    push_pool(l);
+    luaL_unref(l, -1, ref);
+    lua_pop(l, 1);
   }
   l = nullptr;
   ref = LUA_REFNIL;
@@ -160,9 +183,24 @@ void ScopedLuaRef::clear() {
  */
 void ScopedLuaRef::push() const {
 
+  push(l);
+}
+
+/**
+ * \brief Pushes the referenced value onto the stack of a thread.
+ *
+ * The ref must not be empty.
+ *
+ * \param dst_l The main thread of the Lua state of this ref
+ * or one of its coroutines.
+ */
+void ScopedLuaRef::push(lua_State* dst_l) const {
+
   Debug::check_assertion(!is_empty(), "Attempt to push an empty ref");
 
-  lua_rawgeti(l, LUA_REGISTRYINDEX, ref);
+  push_pool(dst_l);
+  lua_rawgeti(dst_l, -1, ref);
+  lua_remove(dst_l, -2);
 }
 
 /**
@@ -191,9 +229,8 @@ void ScopedLuaRef::call(const std::string& function_name) const {
  *
  * This is equivalent to:
  *
- * ScopedLuaRef copy = callback_ref;
- * callback_ref.clear();  // Avoid nasty problems in case of reentrant calls.
- * copy.call(s);
+ * ScopedLuaRef moved = std::move(callback_ref);
+ * moved.call(s);
  *
  * If the reference is already empty, nothing happens.
  * \param function_name A name describing the Lua function (only used to
@@ -50,6 +50,7 @@ void LuaContext::register_shader_module() {
       { "get_id", shader_api_get_id },
       { "get_vertex_file", shader_api_get_vertex_file },
       { "get_fragment_file", shader_api_get_fragment_file },
+      { "get_uniform_handle", shader_api_get_uniform_handle },
       { "set_uniform", shader_api_set_uniform },
   };
 
@@ -194,8 +195,29 @@ int LuaContext::shader_api_get_fragment_file(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of shader:get_uniform_handle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::shader_api_get_uniform_handle(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    Shader& shader = *check_shader(l, 1);
+    const std::string& uniform_name = LuaTools::check_string(l, 2);
+
+    lua_pushinteger(l, shader.get_uniform_handle(uniform_name));
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of shader:set_uniform().
+ *
+ * The uniform is given by its name or by a handle
+ * from shader:get_uniform_handle().
+ *
  * \param l The Lua context that is calling this function.
  * \return Number of values to return to Lua.
  */
@@ -204,17 +226,26 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
 
     Shader& shader = *check_shader(l, 1);
-    const std::string& uniform_name = LuaTools::check_string(l, 2);
+    int uniform_handle = 0;
+    if (lua_type(l, 2) == LUA_TNUMBER) {
+      uniform_handle = LuaTools::check_int(l, 2);
+      if (!shader.is_uniform_handle_valid(uniform_handle)) {
+        LuaTools::arg_error(l, 2, "Invalid uniform handle");
+      }
+    }
+    else {
+      uniform_handle = shader.get_uniform_handle(LuaTools::check_string(l, 2));
+    }
 
     if (lua_isboolean(l, 3)) {
       // Boolean.
       const bool value = lua_toboolean(l, 3);
-      shader.set_uniform_1b(uniform_name, value);
+      shader.set_uniform_1b(uniform_handle, value);
     }
     else if (lua_isnumber(l, 3)) {
       // Number.
       const float value = static_cast<float>(lua_tonumber(l, 3));
-      shader.set_uniform_1f(uniform_name, value);
+      shader.set_uniform_1f(uniform_handle, value);
     }
     else if (lua_istable(l, 3)) {
       // Table of 2, 3 or 4 numbers.
@@ -235,7 +266,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 3);
       if (lua_isnil(l, -1)) {
         // 2 numbers.
-        shader.set_uniform_2f(uniform_name, value_1, value_2);
+        shader.set_uniform_2f(uniform_handle, value_1, value_2);
         return 0;
       }
 
@@ -247,7 +278,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 4);
       if (lua_isnil(l, -1)) {
         // 3 numbers.
-        shader.set_uniform_3f(uniform_name, value_1, value_2, value_3);
+        shader.set_uniform_3f(uniform_handle, value_1, value_2, value_3);
         return 0;
       }
 
@@ -256,12 +287,12 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
         LuaTools::arg_error(l, 3, table_error_message);
       }
       const float value_4 = static_cast<float>(LuaTools::check_number(l, -1));
-      shader.set_uniform_4f(uniform_name, value_1, value_2, value_3, value_4);
+      shader.set_uniform_4f(uniform_handle, value_1, value_2, value_3, value_4);
     }
     else if (is_surface(l, 3)) {
       // Surface.
       const SurfacePtr& value = check_surface(l, 3);
-      bool success = shader.set_uniform_texture(uniform_name, value);
+      bool success = shader.set_uniform_texture(uniform_handle, value);
       if (!success) {
         LuaTools::arg_error(l, 3, "Cannot use this surface in a shader");
       }
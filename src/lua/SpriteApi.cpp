@@ -75,7 +75,17 @@ void LuaContext::register_sprite_module() {
 
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
     methods.insert(methods.end(), {
-        { "get_frame_src_xy", sprite_api_get_frame_src_xy }
+        { "get_frame_src_xy", sprite_api_get_frame_src_xy },
+        { "is_global_clock_enabled", sprite_api_is_global_clock_enabled },
+        { "set_global_clock_enabled", sprite_api_set_global_clock_enabled },
+        { "get_rotation", drawable_api_get_rotation },
+        { "set_rotation", drawable_api_set_rotation },
+        { "get_scale", drawable_api_get_scale },
+        { "set_scale", drawable_api_set_scale },
+        { "get_transformation_origin", drawable_api_get_transformation_origin },
+        { "set_transformation_origin", drawable_api_set_transformation_origin },
+        { "get_color_modulation", drawable_api_get_color_modulation },
+        { "set_color_modulation", drawable_api_set_color_modulation }
     });
   }
 
@@ -105,9 +115,12 @@ bool LuaContext::is_sprite(lua_State* l, int index) {
  * \return The sprite.
  */
 SpritePtr LuaContext::check_sprite(lua_State* l, int index) {
-  return std::static_pointer_cast<Sprite>(check_userdata(
+
+  SpritePtr sprite = std::static_pointer_cast<Sprite>(check_userdata(
       l, index, sprite_module_name
   ));
+  get_lua_context(l).update_skipped_drawable(*sprite);
+  return sprite;
 }
 
 /**
@@ -199,7 +212,7 @@ int LuaContext::sprite_api_set_animation(lua_State* l) {
     }
 
     sprite.set_current_animation(animation_name);
-    sprite.set_finished_callback(callback_ref);
+    sprite.set_finished_callback(std::move(callback_ref));
     sprite.restart_animation();
 
     return 0;
@@ -619,6 +632,38 @@ int LuaContext::sprite_api_synchronize(lua_State *l) {
   });
 }
 
+/**
+ * \brief Implementation of sprite:is_global_clock_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_is_global_clock_enabled(lua_State *l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const Sprite& sprite = *check_sprite(l, 1);
+
+    lua_pushboolean(l, sprite.is_global_clock_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sprite:set_global_clock_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_set_global_clock_enabled(lua_State *l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    Sprite& sprite = *check_sprite(l, 1);
+    bool global_clock_enabled = LuaTools::opt_boolean(l, 2, true);
+
+    sprite.set_global_clock_enabled(global_clock_enabled);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Calls the on_animation_finished() method of a Lua sprite.
  *
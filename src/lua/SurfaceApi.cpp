@@ -14,7 +14,10 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/MemoryStats.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBuffer.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/TransitionFade.h"
@@ -39,7 +42,7 @@ void LuaContext::register_surface_module() {
       { "create", surface_api_create }
   };
 
-  const std::vector<luaL_Reg> methods = {
+  std::vector<luaL_Reg> methods = {
       { "get_size", surface_api_get_size },
       { "clear", surface_api_clear },
       { "fill_color", surface_api_fill_color },
@@ -61,6 +64,20 @@ void LuaContext::register_surface_module() {
       { "stop_movement", drawable_api_stop_movement }
   };
 
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    methods.insert(methods.end(), {
+        { "lock_pixels", surface_api_lock_pixels },
+        { "get_rotation", drawable_api_get_rotation },
+        { "set_rotation", drawable_api_set_rotation },
+        { "get_scale", drawable_api_get_scale },
+        { "set_scale", drawable_api_set_scale },
+        { "get_transformation_origin", drawable_api_get_transformation_origin },
+        { "set_transformation_origin", drawable_api_set_transformation_origin },
+        { "get_color_modulation", drawable_api_get_color_modulation },
+        { "set_color_modulation", drawable_api_set_color_modulation }
+    });
+  }
+
   const std::vector<luaL_Reg> metamethods = {
       { "__gc", drawable_meta_gc }
   };
@@ -108,7 +125,9 @@ void LuaContext::push_surface(lua_State* l, Surface& surface) {
 int LuaContext::surface_api_create(lua_State* l) {
 
   return LuaTools::exception_boundary_handle(l, [&] {
+    MemoryStats::TextureOrigin origin(MemoryStats::Category::SCRIPT_TEXTURES);
     SurfacePtr surface;
+    ScopedLuaRef callback_ref;
     if (lua_gettop(l) == 0) {
       // create an empty surface with the screen size
       surface = Surface::create(Video::get_quest_size());
@@ -122,9 +141,22 @@ int LuaContext::surface_api_create(lua_State* l) {
     else if (lua_type(l, 1) == LUA_TSTRING) {
       // load from a file
       const std::string& file_name = lua_tostring(l, 1);
-      bool language_specific = LuaTools::opt_boolean(l, 2, false);
-      surface = Surface::create(file_name, language_specific ?
-          Surface::DIR_LANGUAGE : Surface::DIR_SPRITES);
+      int callback_index = 2;
+      bool language_specific = false;
+      if (lua_isboolean(l, 2)) {
+        language_specific = lua_toboolean(l, 2);
+        callback_index = 3;
+      }
+      callback_ref = LuaTools::opt_function(l, callback_index);
+      const Surface::ImageDirectory base_directory = language_specific ?
+          Surface::DIR_LANGUAGE : Surface::DIR_SPRITES;
+      if (callback_ref.is_empty()) {
+        surface = Surface::create(file_name, base_directory);
+      }
+      else {
+        // Decode in the background and call the function when loaded.
+        surface = Surface::create_async(file_name, base_directory);
+      }
     }
     else {
       LuaTools::type_error(l, 1, "number, string or no value");
@@ -136,12 +168,46 @@ int LuaContext::surface_api_create(lua_State* l) {
     }
     else {
       get_lua_context(l).add_drawable(surface);
+      if (!callback_ref.is_empty()) {
+        get_lua_context(l).pending_images.push_back(PendingImage{ surface, std::move(callback_ref) });
+      }
       push_surface(l, *surface);
     }
     return 1;
   });
 }
 
+/**
+ * \brief Calls the callbacks of surfaces whose image is loaded.
+ *
+ * This function is called at each cycle.
+ * The callback receives the surface.
+ */
+void LuaContext::update_pending_images() {
+
+  if (pending_images.empty()) {
+    return;
+  }
+
+  // Callbacks may load new surfaces: extract the loaded ones first.
+  std::vector<PendingImage> loaded_images;
+  for (auto it = pending_images.begin(); it != pending_images.end();) {
+    if (!it->surface->is_loading()) {
+      loaded_images.push_back(std::move(*it));
+      it = pending_images.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  for (const PendingImage& image: loaded_images) {
+    push_ref(l, image.callback_ref);
+    push_surface(l, *image.surface);
+    call_function(1, 0, "surface callback");
+  }
+}
+
 /**
  * \brief Implementation of surface:get_size().
  * \param l The Lua context that is calling this function.
@@ -170,6 +236,11 @@ int LuaContext::surface_api_clear(lua_State* l) {
 
     surface.clear();
 
+    DrawList* draw_recording = get_lua_context(l).get_draw_recording(surface);
+    if (draw_recording != nullptr) {
+      draw_recording->add_clear();
+    }
+
     return 0;
   });
 }
@@ -185,6 +256,7 @@ int LuaContext::surface_api_fill_color(lua_State* l) {
     Surface& surface = *check_surface(l, 1);
     Color color = LuaTools::check_color(l, 2);
 
+    DrawList* draw_recording = get_lua_context(l).get_draw_recording(surface);
     if (lua_gettop(l) >= 3) {
       int x = LuaTools::check_int(l, 3);
       int y = LuaTools::check_int(l, 4);
@@ -192,9 +264,15 @@ int LuaContext::surface_api_fill_color(lua_State* l) {
       int height = LuaTools::check_int(l, 6);
       Rectangle where(x, y, width, height);
       surface.fill_with_color(color, where);
+      if (draw_recording != nullptr) {
+        draw_recording->add_fill(color, where);
+      }
     }
     else {
       surface.fill_with_color(color);
+      if (draw_recording != nullptr) {
+        draw_recording->add_fill(color);
+      }
     }
 
     return 0;
@@ -231,5 +309,34 @@ int LuaContext::surface_api_set_pixels(lua_State* l) {
     });
 }
 
+/**
+ * \brief Implementation of surface:lock_pixels().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::surface_api_lock_pixels(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const SurfacePtr& surface = check_surface(l, 1);
+    Rectangle region(surface->get_size());
+    if (lua_gettop(l) >= 2) {
+      const int x = LuaTools::check_int(l, 2);
+      const int y = LuaTools::check_int(l, 3);
+      const int width = LuaTools::check_int(l, 4);
+      const int height = LuaTools::check_int(l, 5);
+      if (width < 0 || height < 0) {
+        LuaTools::arg_error(l, 4, "The size of the region cannot be negative");
+      }
+      region = Rectangle(x, y, width, height);
+    }
+
+    std::shared_ptr<PixelBuffer> pixel_buffer =
+        std::make_shared<PixelBuffer>(surface, region);
+    pixel_buffer->lock();
+    push_pixel_buffer(l, *pixel_buffer);
+    return 1;
+  });
+}
+
 }
 
@@ -64,7 +64,7 @@ void LuaContext::register_text_surface_module() {
   };
 
   // Methods of the text_surface type.
-  const std::vector<luaL_Reg> methods = {
+  std::vector<luaL_Reg> methods = {
       { "get_horizontal_alignment", text_surface_api_get_horizontal_alignment },
       { "set_horizontal_alignment", text_surface_api_set_horizontal_alignment },
       { "get_vertical_alignment", text_surface_api_get_vertical_alignment },
@@ -97,6 +97,19 @@ void LuaContext::register_text_surface_module() {
       { "stop_movement", drawable_api_stop_movement }
   };
 
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    methods.insert(methods.end(), {
+        { "get_rotation", drawable_api_get_rotation },
+        { "set_rotation", drawable_api_set_rotation },
+        { "get_scale", drawable_api_get_scale },
+        { "set_scale", drawable_api_set_scale },
+        { "get_transformation_origin", drawable_api_get_transformation_origin },
+        { "set_transformation_origin", drawable_api_set_transformation_origin },
+        { "get_color_modulation", drawable_api_get_color_modulation },
+        { "set_color_modulation", drawable_api_set_color_modulation }
+    });
+  }
+
   const std::vector<luaL_Reg> metamethods = {
       { "__gc", drawable_meta_gc }
   };
@@ -20,12 +20,16 @@
 #include "solarus/core/Map.h"
 #include "solarus/core/System.h"
 #include "solarus/core/Timer.h"
+#include "solarus/core/WorldStateHash.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
 #include <list>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
@@ -97,6 +101,63 @@ void LuaContext::push_timer(lua_State* l, const TimerPtr& timer) {
   push_userdata(l, *timer);
 }
 
+/**
+ * \brief Returns the number of timers currently registered.
+ * \return The number of timers, including suspended ones.
+ */
+int LuaContext::get_num_timers() const {
+  return static_cast<int>(timers.size());
+}
+
+/**
+ * \brief Returns a hash of the state of the timers currently registered.
+ *
+ * Timers are indexed by address, so their hashes are sorted to give the
+ * same result from one run to another.
+ *
+ * \return The hash of expiration dates and suspended states.
+ */
+uint64_t LuaContext::get_timers_hash() const {
+
+  std::vector<uint64_t> timer_hashes;
+  for (const auto& kvp: timers) {
+    const Timer& timer = *kvp.first;
+    uint64_t hash = WorldStateHash::initial_hash;
+    hash = WorldStateHash::combine(hash, timer.get_expiration_date());
+    hash = WorldStateHash::combine(hash, timer.is_suspended() ? 1 : 0);
+    timer_hashes.push_back(hash);
+  }
+  std::sort(timer_hashes.begin(), timer_hashes.end());
+
+  uint64_t hash = WorldStateHash::initial_hash;
+  for (uint64_t timer_hash: timer_hashes) {
+    hash = WorldStateHash::combine(hash, timer_hash);
+  }
+  return hash;
+}
+
+/**
+ * \brief Returns the time remaining before a timer ends.
+ * \param timer A timer.
+ * \return The remaining time in milliseconds,
+ * or 0 if the timer is finished or was canceled.
+ */
+int LuaContext::get_timer_remaining_time(const TimerPtr& timer) const {
+
+  const auto it = timers.find(timer);
+  if (it == timers.end() ||
+      it->second.callback_ref.is_empty()) {
+    // This timer is already finished or was canceled.
+    return 0;
+  }
+
+  int remaining_time = (int) timer->get_expiration_date() - (int) System::now();
+  if (remaining_time < 0) {
+    remaining_time = 0;
+  }
+  return remaining_time;
+}
+
 /**
  * \brief Registers a timer into a context (table or a userdata).
  * \param timer A timer.
@@ -106,7 +167,7 @@ void LuaContext::push_timer(lua_State* l, const TimerPtr& timer) {
 void LuaContext::add_timer(
     const TimerPtr& timer,
     int context_index,
-    const ScopedLuaRef& callback_ref
+    ScopedLuaRef callback_ref
 ) {
   const void* context;
   if (lua_type(l, context_index) == LUA_TUSERDATA) {
@@ -134,8 +195,9 @@ void LuaContext::add_timer(
   Debug::check_assertion(timers.find(timer) == timers.end(),
       "Duplicate timer in the system");
 
-  timers[timer].callback_ref = callback_ref;
+  timers[timer].callback_ref = std::move(callback_ref);
   timers[timer].context = context;
+  timers_by_context[context].insert(timer);
 
   Game* game = main_loop.get_game();
   if (game != nullptr) {
@@ -171,6 +233,8 @@ void LuaContext::add_timer(
       timer->set_suspended(initially_suspended);
     }
   }
+
+  schedule_timer(timer);
 }
 
 /**
@@ -206,10 +270,15 @@ void LuaContext::remove_timers(int context_index) {
     context = lua_topointer(l, context_index);
   }
 
-  for (auto& kvp: timers) {
-    const TimerPtr& timer = kvp.first;
-    if (kvp.second.context == context) {
-      kvp.second.callback_ref.clear();
+  const auto& context_it = timers_by_context.find(context);
+  if (context_it == timers_by_context.end()) {
+    return;
+  }
+
+  for (const TimerPtr& timer: context_it->second) {
+    const auto& it = timers.find(timer);
+    if (it != timers.end() && !it->second.callback_ref.is_empty()) {
+      it->second.callback_ref.clear();
       timers_to_remove.push_back(timer);
     }
   }
@@ -220,24 +289,73 @@ void LuaContext::remove_timers(int context_index) {
  */
 void LuaContext::destroy_timers() {
   timers.clear();
+  timers_to_remove.clear();
+  timers_by_context.clear();
+  timers_schedule.clear();
 }
 
 /**
- * \brief Updates all timers currently running for this script.
+ * \brief Adds a timer to the queue of timers to update.
+ *
+ * This must be called whenever the next update date of a running timer
+ * might have become earlier, or when it is resumed.
+ * Suspended timers are not queued.
+ *
+ * \param timer The timer to schedule.
+ */
+void LuaContext::schedule_timer(const TimerPtr& timer) {
+
+  if (timer->is_suspended()) {
+    return;
+  }
+
+  timers_schedule.push_back({ timer->get_next_update_date(), timer });
+  std::push_heap(timers_schedule.begin(), timers_schedule.end(), ScheduledTimer::is_later);
+}
+
+/**
+ * \brief Updates the timers currently running for this script.
+ *
+ * Only the timers whose next update date is reached are updated.
  */
 void LuaContext::update_timers() {
 
-  // Update all timers.
-  for (const auto& kvp: timers) {
+  // Take the entries that are due.
+  // Timers rescheduled by this update are only processed at the next cycle.
+  const uint32_t now = System::now();
+  std::vector<TimerPtr> due_timers;
+  while (!timers_schedule.empty() && timers_schedule.front().date <= now) {
+
+    std::pop_heap(timers_schedule.begin(), timers_schedule.end(), ScheduledTimer::is_later);
+    ScheduledTimer& entry = timers_schedule.back();
+    if (!entry.timer->is_suspended() &&
+        entry.date == entry.timer->get_next_update_date()) {
+      due_timers.emplace_back(std::move(entry.timer));
+    }
+    // Otherwise, the entry is obsolete: the timer was suspended or
+    // got another date, and it was queued again if needed.
+    timers_schedule.pop_back();
+  }
 
-    const TimerPtr& timer = kvp.first;
-    const ScopedLuaRef& callback_ref = kvp.second.callback_ref;
-    if (!callback_ref.is_empty()) {
-      // The timer is not being removed: update it.
-      timer->update();
-      if (timer->is_finished()) {
-        do_timer_callback(timer);
-      }
+  // Update them.
+  for (const TimerPtr& timer: due_timers) {
+
+    const auto& it = timers.find(timer);
+    if (it == timers.end() ||
+        it->second.callback_ref.is_empty() ||
+        timer->is_suspended() ||
+        timer->get_next_update_date() > now) {
+      // Removed, suspended or already updated during this cycle.
+      continue;
+    }
+
+    timer->update();
+    if (timer->is_finished()) {
+      do_timer_callback(timer);
+    }
+    else {
+      // A clock sound was played.
+      schedule_timer(timer);
     }
   }
 
@@ -246,6 +364,13 @@ void LuaContext::update_timers() {
 
     const auto& it = timers.find(timer);
     if (it != timers.end()) {
+      const auto& context_it = timers_by_context.find(it->second.context);
+      if (context_it != timers_by_context.end()) {
+        context_it->second.erase(timer);
+        if (context_it->second.empty()) {
+          timers_by_context.erase(context_it);
+        }
+      }
       timers.erase(it);
 
       Debug::check_assertion(timers.find(timer) == timers.end(),
@@ -253,6 +378,21 @@ void LuaContext::update_timers() {
     }
   }
   timers_to_remove.clear();
+
+  // Drop obsolete entries if they accumulate,
+  // for example when long timers are stopped early.
+  if (timers_schedule.size() > 2 * timers.size() + 64) {
+    const auto& obsolete_end = std::remove_if(
+        timers_schedule.begin(),
+        timers_schedule.end(),
+        [&](const ScheduledTimer& entry) {
+      return entry.timer->is_suspended() ||
+          entry.date != entry.timer->get_next_update_date() ||
+          timers.find(entry.timer) == timers.end();
+    });
+    timers_schedule.erase(obsolete_end, timers_schedule.end());
+    std::make_heap(timers_schedule.begin(), timers_schedule.end(), ScheduledTimer::is_later);
+  }
 }
 
 /**
@@ -266,6 +406,9 @@ void LuaContext::notify_timers_map_suspended(bool suspended) {
     const TimerPtr& timer = kvp.first;
     if (timer->is_suspended_with_map()) {
       timer->notify_map_suspended(suspended);
+      if (!suspended) {
+        schedule_timer(timer);
+      }
     }
   }
 }
@@ -282,10 +425,15 @@ void LuaContext::set_entity_timers_suspended(
     Entity& entity, bool suspended
 ) {
 
-  for (const auto& kvp: timers) {
-    const TimerPtr& timer = kvp.first;
-    if (kvp.second.context == &entity) {
-      timer->set_suspended(suspended);
+  const auto& it = timers_by_context.find(&entity);
+  if (it == timers_by_context.end()) {
+    return;
+  }
+
+  for (const TimerPtr& timer: it->second) {
+    timer->set_suspended(suspended);
+    if (!suspended) {
+      schedule_timer(timer);
     }
   }
 }
@@ -325,6 +473,9 @@ void LuaContext::do_timer_callback(const TimerPtr& timer) {
         // the main loop stepsize.
         do_timer_callback(timer);
       }
+      else {
+        schedule_timer(timer);
+      }
     }
     else {
       callback_ref.clear();
@@ -369,11 +520,11 @@ int LuaContext::timer_api_start(lua_State *l) {
     // Now the first parameter is the context.
 
     uint32_t delay = uint32_t(LuaTools::check_int(l, 2));
-    const ScopedLuaRef& callback_ref = LuaTools::check_function(l, 3);
+    ScopedLuaRef callback_ref = LuaTools::check_function(l, 3);
 
     // Create the timer.
     TimerPtr timer = std::make_shared<Timer>(delay);
-    lua_context.add_timer(timer, 1, callback_ref);
+    lua_context.add_timer(timer, 1, std::move(callback_ref));
 
     if (delay == 0) {
       // The delay is zero: call the function right now.
@@ -448,6 +599,7 @@ int LuaContext::timer_api_set_with_sound(lua_State* l) {
     bool with_sound = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_with_sound(with_sound);
+    get_lua_context(l).schedule_timer(timer);
 
     return 0;
   });
@@ -480,6 +632,7 @@ int LuaContext::timer_api_set_suspended(lua_State* l) {
     bool suspended = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_suspended(suspended);
+    get_lua_context(l).schedule_timer(timer);
 
     return 0;
   });
@@ -520,6 +673,7 @@ int LuaContext::timer_api_set_suspended_with_map(lua_State* l) {
       // If the game is running, suspend/resume the timer like the map.
       timer->notify_map_suspended(game->get_current_map().is_suspended());
     }
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -535,20 +689,7 @@ int LuaContext::timer_api_get_remaining_time(lua_State* l) {
   return LuaTools::exception_boundary_handle(l, [&] {
     const TimerPtr& timer = check_timer(l, 1);
 
-    LuaContext& lua_context = get_lua_context(l);
-    const auto it = lua_context.timers.find(timer);
-    if (it == lua_context.timers.end() ||
-        it->second.callback_ref.is_empty()) {
-      // This timer is already finished or was canceled.
-      lua_pushinteger(l, 0);
-    }
-    else {
-      int remaining_time = (int) timer->get_expiration_date() - (int) System::now();
-      if (remaining_time < 0) {
-        remaining_time = 0;
-      }
-      lua_pushinteger(l, remaining_time);
-    }
+    lua_pushinteger(l, get_lua_context(l).get_timer_remaining_time(timer));
     return 1;
   });
 }
@@ -576,6 +717,9 @@ int LuaContext::timer_api_set_remaining_time(lua_State* l) {
         // Execute the callback now.
         lua_context.do_timer_callback(timer);
       }
+      else {
+        lua_context.schedule_timer(timer);
+      }
     }
 
     return 0;
@@ -55,6 +55,11 @@ void LuaContext::register_video_module() {
     functions.insert(functions.end(), {
       { "get_shader", video_api_get_shader },
       { "set_shader", video_api_set_shader},
+      { "get_post_process", video_api_get_post_process },
+      { "set_post_process", video_api_set_post_process },
+      { "is_dynamic_resolution_enabled", video_api_is_dynamic_resolution_enabled },
+      { "set_dynamic_resolution_enabled", video_api_set_dynamic_resolution_enabled },
+      { "get_dynamic_resolution_scale", video_api_get_dynamic_resolution_scale },
     });
   }
   register_functions(video_module_name, functions);
@@ -401,5 +406,123 @@ int LuaContext::video_api_set_shader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.video.get_post_process().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_post_process(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    const std::vector<PostProcessChain::Pass>& passes = Video::get_post_process_passes();
+    lua_createtable(l, static_cast<int>(passes.size()), 0);
+    int i = 1;
+    for (const PostProcessChain::Pass& pass: passes) {
+      lua_createtable(l, 0, 2);
+      push_shader(l, *pass.shader);
+      lua_setfield(l, -2, "shader");
+      lua_pushnumber(l, pass.scale);
+      lua_setfield(l, -2, "scale");
+      lua_rawseti(l, -2, i);
+      ++i;
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_post_process().
+ * \param l the Lua context that is calling this function
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::video_api_set_post_process(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+
+    std::vector<PostProcessChain::Pass> passes;
+    if (!lua_isnil(l, 1)) {
+      LuaTools::check_type(l, 1, LUA_TTABLE);
+      const int num_passes = static_cast<int>(lua_objlen(l, 1));
+      for (int i = 1; i <= num_passes; ++i) {
+        // Each pass is a shader, or a table with a shader and a scale.
+        lua_rawgeti(l, 1, i);
+        const int pass_index = lua_gettop(l);
+        PostProcessChain::Pass pass = { nullptr, 1.0 };
+        if (is_shader(l, pass_index)) {
+          pass.shader = check_shader(l, pass_index);
+        }
+        else if (lua_istable(l, pass_index)) {
+          lua_getfield(l, pass_index, "shader");
+          if (!is_shader(l, -1)) {
+            LuaTools::arg_error(l, 1, "Missing shader in post-processing pass " +
+                std::to_string(i));
+          }
+          pass.shader = check_shader(l, -1);
+          lua_pop(l, 1);
+          pass.scale = LuaTools::opt_number_field(l, pass_index, "scale", 1.0);
+          if (pass.scale < PostProcessChain::min_scale ||
+              pass.scale > PostProcessChain::max_scale) {
+            LuaTools::arg_error(l, 1, "Invalid scale in post-processing pass " +
+                std::to_string(i));
+          }
+        }
+        else {
+          LuaTools::arg_error(l, 1, "Post-processing pass " + std::to_string(i) +
+              " should be a shader or a table");
+        }
+        lua_pop(l, 1);
+        passes.push_back(pass);
+      }
+    }
+
+    Video::set_post_process_passes(passes);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.is_dynamic_resolution_enabled().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_is_dynamic_resolution_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_pushboolean(l, Video::is_dynamic_resolution_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_dynamic_resolution_enabled().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_set_dynamic_resolution_enabled(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    bool enabled = LuaTools::opt_boolean(l, 1, true);
+
+    Video::set_dynamic_resolution_enabled(enabled);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.get_dynamic_resolution_scale().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_dynamic_resolution_scale(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    lua_pushnumber(l, Video::get_dynamic_resolution_scale());
+    return 1;
+  });
+}
+
 }
 
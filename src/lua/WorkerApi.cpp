@@ -0,0 +1,494 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/QuestProperties.h"
+#include "solarus/lua/LuaAllocator.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Maximum nesting of tables sent to or from a worker.
+ *
+ * Deeper tables are most likely cyclic.
+ */
+constexpr int max_serialized_depth = 32;
+
+/**
+ * \brief Appends a 32-bit size to serialized data.
+ * \param size The size to append.
+ * \param data The serialized data.
+ */
+void write_size(uint32_t size, std::string& data) {
+  data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+}
+
+/**
+ * \brief Reads a 32-bit size from serialized data.
+ * \param data The serialized data.
+ * \param position Position of the size, moved after it.
+ * \param size Receives the size.
+ * \return \c false if the data is truncated.
+ */
+bool read_size(const std::string& data, size_t& position, uint32_t& size) {
+
+  if (data.size() - position < sizeof(size)) {
+    return false;
+  }
+  std::memcpy(&size, data.data() + position, sizeof(size));
+  position += sizeof(size);
+  return true;
+}
+
+/**
+ * \brief Converts a Lua value to bytes that another Lua state can read.
+ *
+ * Only nil, booleans, numbers, strings and tables of them can be converted.
+ *
+ * \param l A Lua state.
+ * \param index Index of the value in the stack.
+ * \param data Receives the serialized value.
+ * \param depth Number of enclosing tables.
+ * \param error_message Receives the reason of the failure if any.
+ * \return \c true in case of success.
+ */
+bool serialize_value(
+    lua_State* l,
+    int index,
+    std::string& data,
+    int depth,
+    std::string& error_message
+) {
+  index = LuaTools::get_positive_index(l, index);
+
+  switch (lua_type(l, index)) {
+
+  case LUA_TNONE:
+  case LUA_TNIL:
+    data.push_back('n');
+    return true;
+
+  case LUA_TBOOLEAN:
+    data.push_back(lua_toboolean(l, index) ? 't' : 'f');
+    return true;
+
+  case LUA_TNUMBER:
+  {
+    const lua_Number number = lua_tonumber(l, index);
+    data.push_back('d');
+    data.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    return true;
+  }
+
+  case LUA_TSTRING:
+  {
+    size_t size = 0;
+    const char* text = lua_tolstring(l, index, &size);
+    data.push_back('s');
+    write_size(static_cast<uint32_t>(size), data);
+    data.append(text, size);
+    return true;
+  }
+
+  case LUA_TTABLE:
+  {
+    if (depth >= max_serialized_depth) {
+      error_message = "Tables nested too deeply or cyclic";
+      return false;
+    }
+
+    // The number of pairs is only known at the end.
+    data.push_back('T');
+    const size_t size_position = data.size();
+    write_size(0, data);
+    uint32_t num_pairs = 0;
+    lua_pushnil(l);
+    while (lua_next(l, index) != 0) {
+      if (!serialize_value(l, -2, data, depth + 1, error_message) ||
+          !serialize_value(l, -1, data, depth + 1, error_message)) {
+        lua_pop(l, 2);
+        return false;
+      }
+      lua_pop(l, 1);
+      ++num_pairs;
+    }
+    std::memcpy(&data[size_position], &num_pairs, sizeof(num_pairs));
+    return true;
+  }
+
+  default:
+    error_message = std::string("Cannot send a value of type ") +
+        luaL_typename(l, index) + " to or from a worker";
+    return false;
+  }
+}
+
+/**
+ * \brief Pushes onto the stack a value serialized by serialize_value().
+ * \param l A Lua state.
+ * \param data The serialized data.
+ * \param position Position of the value, moved after it.
+ * \return \c false if the data is invalid. Nothing is pushed in this case.
+ */
+bool deserialize_value(lua_State* l, const std::string& data, size_t& position) {
+
+  if (position >= data.size()) {
+    return false;
+  }
+
+  const char type = data[position];
+  ++position;
+  switch (type) {
+
+  case 'n':
+    lua_pushnil(l);
+    return true;
+
+  case 't':
+  case 'f':
+    lua_pushboolean(l, type == 't');
+    return true;
+
+  case 'd':
+  {
+    lua_Number number = 0.0;
+    if (data.size() - position < sizeof(number)) {
+      return false;
+    }
+    std::memcpy(&number, data.data() + position, sizeof(number));
+    position += sizeof(number);
+    lua_pushnumber(l, number);
+    return true;
+  }
+
+  case 's':
+  {
+    uint32_t size = 0;
+    if (!read_size(data, position, size) || data.size() - position < size) {
+      return false;
+    }
+    lua_pushlstring(l, data.data() + position, size);
+    position += size;
+    return true;
+  }
+
+  case 'T':
+  {
+    uint32_t num_pairs = 0;
+    if (!read_size(data, position, num_pairs)) {
+      return false;
+    }
+    lua_createtable(l, 0, static_cast<int>(num_pairs));
+    for (uint32_t i = 0; i < num_pairs; ++i) {
+      if (!deserialize_value(l, data, position)) {
+        lua_pop(l, 1);
+        return false;
+      }
+      if (!deserialize_value(l, data, position)) {
+        lua_pop(l, 2);
+        return false;
+      }
+      if (lua_isnil(l, -2)) {
+        lua_pop(l, 2);
+        continue;
+      }
+      lua_rawset(l, -3);
+    }
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Implementation of sol.file.exists() in worker states.
+ * \param l The worker Lua state.
+ * \return Number of values to return to Lua.
+ */
+int worker_file_exists(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+
+    lua_pushboolean(l, QuestFiles::data_file_exists(file_name, false));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.file.read() in worker states.
+ *
+ * Unlike in the main Lua state, the file is always read immediately.
+ *
+ * \param l The worker Lua state.
+ * \return Number of values to return to Lua.
+ */
+int worker_file_read(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+
+    if (!QuestFiles::data_file_exists(file_name, false)) {
+      lua_pushnil(l);
+      const std::string& error_message = std::string("Cannot find file '") + file_name
+          + "' in the quest write directory, in data/, data.solarus or in data.solarus.zip";
+      lua_pushlstring(l, error_message.data(), error_message.size());
+      return 2;
+    }
+
+    const std::string& content = QuestFiles::data_file_read(file_name);
+    lua_pushlstring(l, content.data(), content.size());
+    return 1;
+  });
+}
+
+/**
+ * \brief Creates the Lua state of a worker with the API it is allowed to use.
+ *
+ * Workers have the standard libraries without the ones that access the
+ * system (io, os, package and debug), and a sol.file table to read
+ * data files.
+ *
+ * \param allocator Allocator of the new state.
+ * \return The new Lua state.
+ */
+lua_State* create_worker_state(LuaAllocator& allocator) {
+
+  lua_State* l = lua_newstate(LuaAllocator::allocate, &allocator);
+  if (l == nullptr) {
+    // LuaJIT only accepts its own allocator on some 64-bit targets.
+    l = luaL_newstate();
+  }
+  luaL_openlibs(l);
+
+  for (const char* name: { "io", "os", "package", "debug", "dofile", "loadfile", "require", "module" }) {
+    lua_pushnil(l);
+    lua_setglobal(l, name);
+  }
+
+  const luaL_Reg file_functions[] = {
+      { "exists", worker_file_exists },
+      { "read", worker_file_read },
+      { nullptr, nullptr }
+  };
+                                  // --
+  lua_newtable(l);
+                                  // sol
+  lua_newtable(l);
+                                  // sol file
+  luaL_register(l, nullptr, file_functions);
+                                  // sol file
+  lua_setfield(l, -2, "file");
+                                  // sol
+  lua_setglobal(l, "sol");
+                                  // --
+  return l;
+}
+
+/**
+ * \brief Runs the script of a worker in a new Lua state.
+ *
+ * This function runs on a separate thread.
+ *
+ * \param file_name File name of the script, for error messages.
+ * \param source Content of the script.
+ * \param input The serialized value to pass to the script.
+ * \param memory_limit Maximum memory of the Lua state in bytes, or 0.
+ * \param output Receives the serialized value returned by the script,
+ * or the error message in case of failure.
+ * \return \c true in case of success.
+ */
+bool run_worker(
+    const std::string& file_name,
+    const std::string& source,
+    const std::string& input,
+    int64_t memory_limit,
+    const std::shared_ptr<std::string>& output
+) {
+  LuaAllocator allocator;
+  lua_State* l = create_worker_state(allocator);
+
+  const std::string& chunk_name = "@" + file_name;
+  size_t position = 0;
+  bool success = false;
+  if (luaL_loadbuffer(l, source.data(), source.size(), chunk_name.c_str()) != 0) {
+    *output = lua_tostring(l, -1);
+  }
+  else if (!deserialize_value(l, input, position)) {
+    *output = "Invalid worker input";
+  }
+  else {
+    // Only limit the script itself: failures outside lua_pcall() would abort.
+    allocator.set_memory_limit(memory_limit);
+    if (lua_pcall(l, 1, 1, 0) != 0) {
+      *output = lua_isstring(l, -1) ? lua_tostring(l, -1) : "Error in worker";
+    }
+    else {
+      output->clear();
+      std::string error_message;
+      success = serialize_value(l, -1, *output, 0, error_message);
+      if (!success) {
+        *output = error_message;
+      }
+    }
+    allocator.set_memory_limit(0);
+  }
+
+  lua_close(l);
+  return success;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * Name of the Lua table representing the worker module.
+ */
+const std::string LuaContext::worker_module_name = "sol.worker";
+
+/**
+ * \brief Initializes the worker features provided to Lua.
+ */
+void LuaContext::register_worker_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  const std::vector<luaL_Reg> functions = {
+      { "run", worker_api_run },
+      { "get_num_running", worker_api_get_num_running }
+  };
+  register_functions(worker_module_name, functions);
+}
+
+/**
+ * \brief Implementation of sol.worker.run().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::worker_api_run(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const std::string& script_name = LuaTools::check_string(l, 1);
+    ScopedLuaRef callback_ref = LuaTools::check_function(l, 3);
+
+    std::string file_name = script_name;
+    if (!QuestFiles::data_file_exists(file_name)) {
+      file_name += ".lua";
+    }
+    if (!QuestFiles::data_file_exists(file_name)) {
+      LuaTools::arg_error(l, 1, std::string("No such script: '") + script_name + "'");
+    }
+
+    std::string input;
+    std::string error_message;
+    if (!serialize_value(l, 2, input, 0, error_message)) {
+      LuaTools::arg_error(l, 2, error_message);
+    }
+
+    LuaContext& lua_context = get_lua_context(l);
+    const int64_t memory_limit =
+        static_cast<int64_t>(CurrentQuest::get_properties().get_lua_memory_limit()) * 1024;
+    std::shared_ptr<std::string> output = std::make_shared<std::string>();
+    lua_context.pending_workers.push_back(PendingWorker{
+        std::async(
+            std::launch::async,
+            &run_worker,
+            file_name,
+            QuestFiles::data_file_read(file_name),
+            std::move(input),
+            memory_limit,
+            output
+        ).share(),
+        output,
+        std::move(callback_ref)
+    });
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.worker.get_num_running().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::worker_api_get_num_running(lua_State* l) {
+
+  return LuaTools::exception_boundary_handle(l, [&] {
+    const LuaContext& lua_context = get_lua_context(l);
+
+    lua_pushinteger(l, static_cast<int>(lua_context.pending_workers.size()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Calls the callbacks of workers that are finished.
+ *
+ * This function is called at each cycle.
+ * The callback receives the value returned by the worker script,
+ * or \c nil and an error message in case of failure.
+ */
+void LuaContext::update_workers() {
+
+  if (pending_workers.empty()) {
+    return;
+  }
+
+  // Callbacks may start new workers: extract the finished ones first.
+  std::vector<PendingWorker> finished_workers;
+  for (auto it = pending_workers.begin(); it != pending_workers.end();) {
+    if (it->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      finished_workers.push_back(std::move(*it));
+      it = pending_workers.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  for (const PendingWorker& worker: finished_workers) {
+    push_ref(l, worker.callback_ref);
+    size_t position = 0;
+    if (!worker.result.get()) {
+      lua_pushnil(l);
+      push_string(l, *worker.output);
+      call_function(2, 0, "worker callback");
+    }
+    else if (!deserialize_value(l, *worker.output, position)) {
+      lua_pushnil(l);
+      push_string(l, "Invalid worker output");
+      call_function(2, 0, "worker callback");
+    }
+    else {
+      call_function(1, 0, "worker callback");
+    }
+  }
+}
+
+}
+
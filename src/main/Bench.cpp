@@ -0,0 +1,694 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/AllocationTracker.h"
+#include "solarus/core/Arguments.h"
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/GameCommands.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/MemoryStats.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/QuestProperties.h"
+#include "solarus/core/Savegame.h"
+#include "solarus/core/System.h"
+#include "solarus/lua/LuaContext.h"
+#include <lua.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#ifndef SOLARUS_ALLOCATION_TRACKING
+// Without allocation tracking in the engine, count allocations here.
+namespace {
+
+/**
+ * \brief Number of C++ allocations done by the whole program.
+ *
+ * Counted by the replacements of operator new below.
+ * Allocations done by Lua go through its own allocator and are not counted.
+ */
+std::atomic<uint64_t> num_allocations(0);
+
+}
+
+void* operator new(std::size_t size) {
+
+  ++num_allocations;
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+
+  ++num_allocations;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  std::free(pointer);
+}
+#endif
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief A game command pressed or released by the input script.
+ */
+struct ScriptedCommand {
+  bool pressed;           /**< \c true for a press, \c false for a release. */
+  GameCommand command;    /**< The game command. */
+};
+
+/**
+ * \brief Options of the benchmark.
+ */
+struct BenchOptions {
+  std::string map_id;             /**< Map to start the game on. */
+  int num_ticks = 1000;           /**< Number of measured simulation steps. */
+  int num_warmup_ticks = 0;       /**< Steps done before measuring. */
+  std::string input_script;       /**< Input script file, if any. */
+  std::string output;             /**< JSON output file, empty for stdout. */
+  std::string baseline;           /**< Baseline file to check measures against, if any. */
+  bool update_baseline = false;   /**< Whether to overwrite the baseline with this run. */
+  double time_tolerance = 25.0;   /**< Time allowed above the baseline (percent). */
+  double allocation_tolerance = 5.0;  /**< Allocations allowed above the baseline (percent). */
+};
+
+/**
+ * \brief Prints the usage of the program.
+ * \param program_name Name of the executable.
+ */
+void print_help(const std::string& program_name) {
+
+  std::cout << "Usage: " << program_name << " -map=<map_id> [options] [quest_path]"
+            << std::endl << std::endl
+            << "Runs the simulation of a map without video, audio or delay"
+            << " and prints measures in JSON." << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  -help                  shows this help message and exits" << std::endl
+            << "  -map=<map_id>          map where the game starts (required)" << std::endl
+            << "  -ticks=<n>             number of simulation steps to measure (default 1000)" << std::endl
+            << "  -warmup=<n>            number of steps to run before measuring (default 0)" << std::endl
+            << "  -input-script=<file>   game commands to replay, one per line:" << std::endl
+            << "                         <tick> press|release <command>" << std::endl
+            << "  -output=<file>         writes the results to a file instead of stdout" << std::endl
+            << "  -baseline=<file>       fails if the run is slower or allocates more than" << std::endl
+            << "                         a previous run saved in this file, which is created" << std::endl
+            << "                         if it does not exist" << std::endl
+            << "  -update-baseline       overwrites the baseline file with this run" << std::endl
+            << "  -time-tolerance=<p>    percentage of time allowed above the baseline (default 25)" << std::endl
+            << "  -allocation-tolerance=<p>  percentage of allocations allowed above the" << std::endl
+            << "                         baseline (default 5)" << std::endl;
+}
+
+/**
+ * \brief Parses a non-negative integer option.
+ * \param value The value of the option.
+ * \param[out] result The integer parsed.
+ * \return \c true in case of success.
+ */
+bool parse_count(const std::string& value, int& result) {
+
+  std::istringstream iss(value);
+  int count = 0;
+  if (!(iss >> count) || !iss.eof() || count < 0) {
+    return false;
+  }
+  result = count;
+  return true;
+}
+
+/**
+ * \brief Parses a non-negative percentage option.
+ * \param value The value of the option.
+ * \param[out] result The percentage parsed.
+ * \return \c true in case of success.
+ */
+bool parse_percentage(const std::string& value, double& result) {
+
+  std::istringstream iss(value);
+  double percentage = 0.0;
+  if (!(iss >> percentage) || !iss.eof() || percentage < 0.0) {
+    return false;
+  }
+  result = percentage;
+  return true;
+}
+
+/**
+ * \brief Loads an input script.
+ *
+ * Each non-empty line is "<tick> press|release <command>",
+ * where command is a game command name like "right" or "action".
+ * Ticks count from the first measured step, warmup steps are negative.
+ * Lines starting with '#' are comments.
+ *
+ * \param file_name The file to read.
+ * \param[out] commands The commands of each tick.
+ * \return \c true in case of success.
+ */
+bool load_input_script(
+    const std::string& file_name,
+    std::map<int, std::vector<ScriptedCommand>>& commands
+) {
+  std::ifstream in(file_name.c_str());
+  if (!in) {
+    std::cerr << "Cannot open input script '" << file_name << "'" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    std::istringstream iss(line);
+    std::string first;
+    if (!(iss >> first) || first[0] == '#') {
+      continue;
+    }
+
+    std::istringstream tick_iss(first);
+    int tick = 0;
+    std::string action;
+    std::string command_name;
+    if (!(tick_iss >> tick) || !tick_iss.eof() ||
+        !(iss >> action >> command_name) ||
+        (action != "press" && action != "release")) {
+      std::cerr << file_name << ":" << line_number
+                << ": expected '<tick> press|release <command>'" << std::endl;
+      return false;
+    }
+
+    const GameCommand command = GameCommands::get_command_by_name(command_name);
+    if (command == GameCommand::NONE) {
+      std::cerr << file_name << ":" << line_number
+                << ": unknown game command '" << command_name << "'" << std::endl;
+      return false;
+    }
+    commands[tick].push_back({ action == "press", command });
+  }
+  return true;
+}
+
+/**
+ * \brief Loads the measures of a baseline file.
+ *
+ * Each non-empty line is "<measure> <value>".
+ * Lines starting with '#' are comments.
+ *
+ * \param file_name The file to read.
+ * \param[out] measures The measures of the baseline.
+ * \return \c false if the file cannot be read or is invalid.
+ */
+bool load_baseline(
+    const std::string& file_name,
+    std::map<std::string, double>& measures
+) {
+  std::ifstream in(file_name.c_str());
+  if (!in) {
+    std::cerr << "Cannot open baseline file '" << file_name << "'" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    std::istringstream iss(line);
+    std::string name;
+    if (!(iss >> name) || name[0] == '#') {
+      continue;
+    }
+    double value = 0.0;
+    if (!(iss >> value)) {
+      std::cerr << file_name << ":" << line_number
+                << ": expected '<measure> <value>'" << std::endl;
+      return false;
+    }
+    measures[name] = value;
+  }
+  return true;
+}
+
+/**
+ * \brief Saves measures as a baseline file.
+ * \param file_name The file to write.
+ * \param map_id The map measured.
+ * \param measures The measures of this run.
+ * \return \c true in case of success.
+ */
+bool save_baseline(
+    const std::string& file_name,
+    const std::string& map_id,
+    const std::map<std::string, double>& measures
+) {
+  std::ofstream out(file_name.c_str());
+  out << "# Baseline of solarus-bench on the map \"" << map_id << "\"." << std::endl
+      << "# Each line is: <measure> <value>" << std::endl;
+  for (const auto& kvp: measures) {
+    out << kvp.first << " " << kvp.second << std::endl;
+  }
+  if (!out) {
+    std::cerr << "Cannot write baseline file '" << file_name << "'" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Compares measures to a baseline.
+ *
+ * Measures missing from the baseline are not checked.
+ *
+ * \param measures The measures of this run.
+ * \param baseline The measures of the baseline.
+ * \param options Tolerances allowed.
+ * \return \c false if a measure exceeds its baseline by more than its tolerance.
+ */
+bool check_baseline(
+    const std::map<std::string, double>& measures,
+    const std::map<std::string, double>& baseline,
+    const BenchOptions& options
+) {
+  bool success = true;
+  for (const auto& kvp: measures) {
+    const auto it = baseline.find(kvp.first);
+    if (it == baseline.end()) {
+      continue;
+    }
+    const double tolerance = kvp.first == "allocations_per_tick" ?
+        options.allocation_tolerance : options.time_tolerance;
+    const double max_value = it->second * (1.0 + tolerance / 100.0);
+    if (kvp.second > max_value) {
+      std::cerr << "Performance regression: " << kvp.first << " is " << kvp.second
+                << ", the baseline is " << it->second
+                << " with a tolerance of " << tolerance << "%" << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+/**
+ * \brief Escapes a string for JSON.
+ * \param value The string to escape.
+ * \return The string between double quotes.
+ */
+std::string to_json(const std::string& value) {
+
+  std::ostringstream oss;
+  oss << '"';
+  for (char c: value) {
+    switch (c) {
+      case '"': oss << "\\\""; break;
+      case '\\': oss << "\\\\"; break;
+      case '\n': oss << "\\n"; break;
+      case '\t': oss << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          const char* digits = "0123456789abcdef";
+          oss << "\\u00" << digits[(c >> 4) & 0xF] << digits[c & 0xF];
+        }
+        else {
+          oss << c;
+        }
+    }
+  }
+  oss << '"';
+  return oss.str();
+}
+
+/**
+ * \brief Returns the peak resident memory of the process.
+ * \return The peak resident memory in bytes, or 0 if unknown.
+ */
+uint64_t get_peak_rss() {
+
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+  }
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#  ifdef __APPLE__
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#  else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#  endif
+#endif
+}
+
+/**
+ * \brief Returns the number of C++ allocations done so far.
+ *
+ * With SOLARUS_ALLOCATION_TRACKING, this only includes finished frames.
+ *
+ * \return The number of calls to operator new.
+ */
+uint64_t get_num_allocations() {
+
+#ifdef SOLARUS_ALLOCATION_TRACKING
+  uint64_t result = 0;
+  for (int i = 0; i < AllocationTracker::num_scopes; ++i) {
+    result += AllocationTracker::get_total_counters(
+        static_cast<AllocationTracker::Scope>(i)).num_allocations;
+  }
+  return result;
+#else
+  return num_allocations;
+#endif
+}
+
+/**
+ * \brief Runs one simulation step like the main loop does.
+ * \param main_loop The main loop.
+ * \param commands Game commands to simulate before the step.
+ */
+void run_tick(
+    MainLoop& main_loop,
+    const std::vector<ScriptedCommand>* commands
+) {
+  FrameTimings& frame_timings = main_loop.get_frame_timings();
+  frame_timings.start_frame(System::get_real_time());
+
+  Game* game = main_loop.get_game();
+  if (commands != nullptr && game != nullptr) {
+    for (const ScriptedCommand& command: *commands) {
+      if (command.pressed) {
+        game->simulate_command_pressed(command.command);
+      }
+      else {
+        game->simulate_command_released(command.command);
+      }
+    }
+  }
+
+  main_loop.step();
+
+  LuaContext& lua_context = main_loop.get_lua_context();
+  if (lua_context.is_garbage_collector_driven()) {
+    const double gc_start_time = FrameTimings::get_time();
+    lua_context.step_garbage_collector(
+        CurrentQuest::get_properties().get_lua_gc_step_time());
+    frame_timings.add_phase_time(FrameTimings::Phase::GC, gc_start_time);
+  }
+
+  frame_timings.finish_frame();
+  AllocationTracker::finish_frame();
+}
+
+}  // Anonymous namespace.
+
+}  // namespace Solarus.
+
+/**
+ * \brief Entry point of the simulation benchmark.
+ *
+ * Usage: solarus-bench -map=<map_id> [options] [quest_path]
+ *
+ * Starts a game on a map without video and audio, optionally replays
+ * game commands from an input script, and runs simulation steps as fast
+ * as possible.
+ * The simulated time advances by System::timestep at each step whatever
+ * the real time, so runs are reproducible.
+ * Measures are printed in JSON: steps per second, time of each phase,
+ * C++ allocations per step and peak resident memory.
+ * With -baseline, the time and allocations per step are also compared to
+ * a previous run and the program fails if they got worse.
+ * Engine logs are written to stderr instead of stdout.
+ * Drawing is not done and not measured.
+ *
+ * \param argc Number of command-line arguments.
+ * \param argv Command-line arguments.
+ * \return 0 in case of success.
+ */
+int main(int argc, char** argv) {
+
+  using namespace Solarus;
+
+  const Arguments args(argc, argv);
+  const std::string program_name = argc > 0 ? argv[0] : "solarus-bench";
+
+  if (args.has_argument("-help")) {
+    print_help(program_name);
+    return 0;
+  }
+
+  BenchOptions options;
+  options.map_id = args.get_argument_value("-map");
+  options.input_script = args.get_argument_value("-input-script");
+  options.output = args.get_argument_value("-output");
+  if (options.map_id.empty()) {
+    std::cerr << "Missing option -map=<map_id>" << std::endl;
+    print_help(program_name);
+    return 1;
+  }
+  const std::string ticks_value = args.get_argument_value("-ticks");
+  if (!ticks_value.empty() && !parse_count(ticks_value, options.num_ticks)) {
+    std::cerr << "Invalid value for -ticks: '" << ticks_value << "'" << std::endl;
+    return 1;
+  }
+  const std::string warmup_value = args.get_argument_value("-warmup");
+  if (!warmup_value.empty() && !parse_count(warmup_value, options.num_warmup_ticks)) {
+    std::cerr << "Invalid value for -warmup: '" << warmup_value << "'" << std::endl;
+    return 1;
+  }
+  options.baseline = args.get_argument_value("-baseline");
+  options.update_baseline = args.has_argument("-update-baseline");
+  const std::string time_tolerance_value = args.get_argument_value("-time-tolerance");
+  if (!time_tolerance_value.empty() &&
+      !parse_percentage(time_tolerance_value, options.time_tolerance)) {
+    std::cerr << "Invalid value for -time-tolerance: '" << time_tolerance_value << "'" << std::endl;
+    return 1;
+  }
+  const std::string allocation_tolerance_value = args.get_argument_value("-allocation-tolerance");
+  if (!allocation_tolerance_value.empty() &&
+      !parse_percentage(allocation_tolerance_value, options.allocation_tolerance)) {
+    std::cerr << "Invalid value for -allocation-tolerance: '" << allocation_tolerance_value << "'" << std::endl;
+    return 1;
+  }
+
+  std::map<int, std::vector<ScriptedCommand>> commands;
+  if (!options.input_script.empty() &&
+      !load_input_script(options.input_script, commands)) {
+    return 1;
+  }
+
+  // Run the engine without video, audio, delay or console.
+  // The quest path has to stay the last argument.
+  Arguments engine_args;
+  engine_args.set_program_name(program_name);
+  engine_args.add_argument("-no-audio");
+  engine_args.add_argument("-no-video");
+  engine_args.add_argument("-turbo", "yes");
+  engine_args.add_argument("-lua-console", "no");
+  for (const std::string& arg: args.get_arguments()) {
+    engine_args.add_argument(arg);
+  }
+
+  // Engine logs go to stdout: send them to stderr to keep the JSON clean.
+  std::streambuf* stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+
+  Debug::set_show_popup_on_die(false);
+  Debug::set_die_on_error(true);
+
+  MainLoop main_loop(engine_args);
+  if (!QuestFiles::quest_exists()) {
+    std::cerr << "No quest was found" << std::endl;
+    return 1;
+  }
+
+  std::shared_ptr<Savegame> savegame = std::make_shared<Savegame>(
+      main_loop, "save_bench.dat");
+  savegame->initialize();
+  savegame->set_string(Savegame::KEY_STARTING_MAP, options.map_id);
+  main_loop.set_game(new Game(main_loop, savegame));
+
+  // Steps not measured. The first step done starts the game.
+  for (int i = -options.num_warmup_ticks; i < 0 && !main_loop.is_exiting(); ++i) {
+    const auto it = commands.find(i);
+    run_tick(main_loop, it != commands.end() ? &it->second : nullptr);
+  }
+
+  double game_time = 0.0;
+  double lua_time = 0.0;
+  double system_time = 0.0;
+  double gc_time = 0.0;
+  int num_ticks_done = 0;
+  const uint64_t allocations_before = get_num_allocations();
+  AllocationTracker::Counters scope_counters_before[AllocationTracker::num_scopes];
+  for (int i = 0; i < AllocationTracker::num_scopes; ++i) {
+    scope_counters_before[i] = AllocationTracker::get_total_counters(
+        static_cast<AllocationTracker::Scope>(i));
+  }
+  const double start_time = FrameTimings::get_time();
+  const FrameTimings& frame_timings = main_loop.get_frame_timings();
+  for (int i = 0; i < options.num_ticks && !main_loop.is_exiting(); ++i) {
+    const auto it = commands.find(i);
+    run_tick(main_loop, it != commands.end() ? &it->second : nullptr);
+
+    const FrameTimings::Frame& frame =
+        frame_timings.get_frame(frame_timings.get_num_frames() - 1);
+    game_time += frame.game_time;
+    lua_time += frame.lua_time;
+    system_time += frame.system_time;
+    gc_time += frame.gc_time;
+    ++num_ticks_done;
+  }
+  const double total_time = FrameTimings::get_time() - start_time;
+  const uint64_t num_tick_allocations = get_num_allocations() - allocations_before;
+  const double tick_divisor = num_ticks_done > 0 ? num_ticks_done : 1;
+
+  lua_State* l = main_loop.get_lua_context().get_internal_state();
+  const uint64_t lua_memory = static_cast<uint64_t>(lua_gc(l, LUA_GCCOUNT, 0)) * 1024 +
+      static_cast<uint64_t>(lua_gc(l, LUA_GCCOUNTB, 0));
+
+  std::ostringstream json;
+  json << "{" << std::endl
+       << "  \"quest\": " << to_json(QuestFiles::get_quest_path()) << "," << std::endl
+       << "  \"map\": " << to_json(options.map_id) << "," << std::endl
+       << "  \"ticks\": " << num_ticks_done << "," << std::endl
+       << "  \"warmup_ticks\": " << options.num_warmup_ticks << "," << std::endl
+       << "  \"total_time_ms\": " << total_time << "," << std::endl
+       << "  \"ticks_per_second\": "
+       << (total_time > 0.0 ? num_ticks_done * 1000.0 / total_time : 0.0) << "," << std::endl
+       << "  \"phases_ms\": {" << std::endl
+       << "    \"game\": " << game_time << "," << std::endl
+       << "    \"lua\": " << lua_time << "," << std::endl
+       << "    \"system\": " << system_time << "," << std::endl
+       << "    \"gc\": " << gc_time << std::endl
+       << "  }," << std::endl
+       << "  \"allocations_per_tick\": " << num_tick_allocations / tick_divisor
+       << "," << std::endl;
+  if (AllocationTracker::is_enabled()) {
+    // Engine built with allocation tracking: detail by scope.
+    json << "  \"allocations_by_scope\": {";
+    for (int i = 0; i < AllocationTracker::num_scopes; ++i) {
+      const AllocationTracker::Scope scope = static_cast<AllocationTracker::Scope>(i);
+      const AllocationTracker::Counters counters = AllocationTracker::get_total_counters(scope);
+      const AllocationTracker::Counters& before = scope_counters_before[i];
+      json << (i == 0 ? "" : ",") << std::endl
+           << "    " << to_json(AllocationTracker::get_scope_name(scope)) << ": { "
+           << "\"allocations_per_tick\": "
+           << (counters.num_allocations - before.num_allocations) / tick_divisor << ", "
+           << "\"bytes_per_tick\": "
+           << (counters.num_bytes - before.num_bytes) / tick_divisor << " }";
+    }
+    json << std::endl << "  }," << std::endl;
+  }
+  json << "  \"memory\": {";
+  const std::vector<MemoryStats::Entry>& memory_report =
+      MemoryStats::get_report(main_loop.get_lua_context());
+  for (size_t i = 0; i < memory_report.size(); ++i) {
+    json << (i == 0 ? "" : ",") << std::endl
+         << "    " << to_json(memory_report[i].name) << ": { "
+         << "\"bytes\": " << memory_report[i].num_bytes << ", "
+         << "\"objects\": " << memory_report[i].num_objects << " }";
+  }
+  json << std::endl << "  }," << std::endl;
+  json
+       << "  \"lua_memory_bytes\": " << lua_memory << "," << std::endl
+       << "  \"peak_rss_bytes\": " << get_peak_rss() << std::endl
+       << "}" << std::endl;
+
+  Logger::flush();
+  std::cout.rdbuf(stdout_buffer);
+  if (options.output.empty()) {
+    std::cout << json.str();
+  }
+  else {
+    std::ofstream out(options.output.c_str());
+    out << json.str();
+    if (!out) {
+      std::cerr << "Cannot write output file '" << options.output << "'" << std::endl;
+      return 1;
+    }
+  }
+
+  if (num_ticks_done != options.num_ticks) {
+    return 1;
+  }
+
+  if (!options.baseline.empty()) {
+    std::map<std::string, double> measures;
+    measures["ms_per_tick"] = total_time / tick_divisor;
+    measures["allocations_per_tick"] = num_tick_allocations / tick_divisor;
+
+    const bool baseline_exists = std::ifstream(options.baseline.c_str()).good();
+    if (options.update_baseline || !baseline_exists) {
+      // First run on this machine, or baseline reset on purpose.
+      std::cerr << "Saving baseline '" << options.baseline << "'" << std::endl;
+      return save_baseline(options.baseline, options.map_id, measures) ? 0 : 1;
+    }
+    std::map<std::string, double> baseline;
+    if (!load_baseline(options.baseline, baseline) ||
+        !check_baseline(measures, baseline, options)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -59,6 +59,14 @@ void print_help(const Arguments& args) {
     << std::endl
     << "  -no-audio                     disables sounds and musics"
     << std::endl
+    << "  -music-buffers=N              decodes musics up to N chunks ahead in a separate thread (default 16)"
+    << std::endl
+    << "  -music-lookahead=X            decodes musics X milliseconds ahead instead (default 0: use -music-buffers)"
+    << std::endl
+    << "  -sound-cache-size=X           limits the memory of decoded sound effects to X MiB (default 32)"
+    << std::endl
+    << "  -sound-sources=N              plays at most N sound effects at the same time (default 32)"
+    << std::endl
     << "  -no-video                     disables displaying"
     << std::endl
     << "  -quest-size=<width>x<height>  sets the size of the drawing area (if compatible with the quest)"
@@ -68,6 +76,44 @@ void print_help(const Arguments& args) {
     << "  -turbo=yes|no                 runs as fast as possible rather than simulating real time (default no)"
     << std::endl
     << "  -lag=X                        slows down each frame of X milliseconds to simulate slower systems for debugging (default 0)"
+    << std::endl
+    << "  -interpolation=yes|no         draws at each display refresh and interpolates positions between simulation steps (default no)"
+    << std::endl
+    << "  -deferred-present=yes|no      shows each frame after simulating the next one instead of waiting for vsync (default no)"
+    << std::endl
+    << "  -frame-timings-file=<file>    saves the duration of each phase of the last frames to a CSV file at exit"
+    << std::endl
+    << "  -lua-profile=<file>           measures Lua callbacks and saves folded stacks for flame graphs at exit"
+    << std::endl
+    << "  -perf-overlay=yes|no          shows performance numbers over the quest at startup (toggle with Ctrl+F12)"
+    << std::endl
+    << "  -trace-file=<file>            saves a timeline of engine scopes for Perfetto at exit (SOLARUS_TRACING builds)"
+    << std::endl
+    << "  -watch-resources=yes|no       reloads sprites, tilesets, images, dialogs and scripts changed while running (default no)"
+    << std::endl
+    << "  -record-startup-manifest=<file> saves the data files read at startup, to prefetch them from data/startup_manifest.txt"
+    << std::endl
+    << "  -startup-manifest-duration=X  records the startup manifest during the first X seconds (default 10)"
+    << std::endl
+    << "  -tile-cache-radius=N          keeps static tile regions up to N cells away from the visible ones (default 2)"
+    << std::endl
+    << "  -tile-cache-size=X            limits the memory of static tile regions to X MiB (default 64)"
+    << std::endl
+    << "  -texture-budget=X             reloads least recently used images from files above X MiB of textures (default 0: no limit)"
+    << std::endl
+    << "  -random-seed=N                starts the random number generator from N instead of the current time"
+    << std::endl
+    << "  -record-input=<file>          saves input events with their simulated time to a file"
+    << std::endl
+    << "  -replay-input=<file>          replays input events and the random seed saved with -record-input"
+    << std::endl
+    << "  -world-hash-output=<file>     saves a hash of the simulation state at each tick to a file"
+    << std::endl
+    << "  -world-hash-reference=<file>  stops with an error at the first tick that differs from a -world-hash-output file"
+    << std::endl
+    << "  -log-level=<level>            logs messages of this level or higher: debug, info, warning, error (default debug)"
+    << std::endl
+    << "  -log-format=text|json         writes log messages as text lines or as JSON objects (default text)"
     << std::endl;
 }
 
@@ -92,12 +138,67 @@ void print_help(const Arguments& args) {
  * The following options are supported:
  *   -help                             Shows a help message.
  *   -no-audio                         Disables sounds and musics.
+ *   -music-buffers=N                  (Advanced) Decodes musics up to N chunks ahead
+ *                                     in a separate thread (default: 16).
+ *   -music-lookahead=X                (Advanced) Decodes musics X milliseconds ahead instead
+ *                                     of a number of chunks (default: 0, use -music-buffers).
+ *   -sound-cache-size=X               (Advanced) Limits the memory of decoded sound effects
+ *                                     to X MiB (default: 32).
+ *   -sound-sources=N                  (Advanced) Plays at most N sound effects at the same time
+ *                                     (default: 32).
  *   -no-video                         Disables displaying (used for unit tests).
  *   -quest-size=<width>x<height>      Sets the size of the drawing area (if compatible with the quest).
  *   -lua-console=yes|no               Accepts lines from standard input as Lua commands (default: yes).
+ *                                     A line "@<id> <code>" runs <code> as command number <id>.
  *   -turbo=yes|no                     Runs as fast as possible rather than simulating real time (default: no).
  *   -lag=X                            (Advanced) Artificially slows down each frame of X milliseconds
  *                                     to simulate slower systems for debugging (default: 0).
+ *   -interpolation=yes|no             Draws at each display refresh and interpolates positions
+ *                                     between simulation steps (default: no).
+ *   -deferred-present=yes|no          (Advanced) Shows each frame only after simulating the next one,
+ *                                     so that waiting for the display refresh does not delay
+ *                                     the simulation (default: no). Adds one frame of latency.
+ *   -frame-timings-file=<file>        (Advanced) Saves the duration of each phase of the last frames
+ *                                     to a CSV file when the program exits.
+ *   -lua-profile=<file>               (Advanced) Measures the time and memory of Lua callbacks
+ *                                     and saves them as folded stacks for flame graph tools
+ *                                     when the program exits (memory goes to <file>.memory).
+ *   -perf-overlay=yes|no              Shows frame times, entity counts, memory and draw calls
+ *                                     over the quest at startup (default: no).
+ *                                     Ctrl+F12 toggles it at any time.
+ *   -trace-file=<file>                (Advanced) Saves a timeline of engine scopes in the JSON
+ *                                     trace format of Perfetto and chrome://tracing when the
+ *                                     program exits. Requires a build with SOLARUS_TRACING.
+ *   -watch-resources=yes|no           Reloads sprites, tilesets, images, dialogs, strings and
+ *                                     Lua scripts modified while the quest runs, without
+ *                                     restarting (default: no). The quest must be a data directory.
+ *   -record-startup-manifest=<file>   (Advanced) Saves the list of data files read at startup
+ *                                     when the program exits. Copied to the data directory as
+ *                                     startup_manifest.txt, it lets the engine read these files
+ *                                     in advance on a separate thread.
+ *   -startup-manifest-duration=X      (Advanced) Records the startup manifest during the first
+ *                                     X seconds (default: 10).
+ *   -tile-cache-radius=N              (Advanced) Keeps static tile regions up to N cells away
+ *                                     from the visible ones (default: 2).
+ *   -tile-cache-size=X                (Advanced) Limits the memory of static tile regions
+ *                                     to X MiB (default: 64).
+ *   -texture-budget=X                 (Advanced) Above X MiB of textures, releases the pixels
+ *                                     of least recently used images and loads them again from
+ *                                     their file when needed (default: 0, no limit).
+ *   -random-seed=N                    (Advanced) Starts the random number generator from N
+ *                                     instead of the current time.
+ *   -record-input=<file>              (Advanced) Saves input events with the simulated time
+ *                                     when they are handled, and the random seed.
+ *   -replay-input=<file>              (Advanced) Replays a file saved with -record-input
+ *                                     instead of reading input devices.
+ *   -world-hash-output=<file>         (Advanced) Saves a hash of the entities, savegame,
+ *                                     timers and random state at each tick.
+ *   -world-hash-reference=<file>      (Advanced) Compares each tick to a file saved with
+ *                                     -world-hash-output and stops at the first difference.
+ *   -log-level=<level>                Only logs messages of this level or higher:
+ *                                     debug, info, warning or error (default: debug).
+ *   -log-format=text|json             (Advanced) Writes log messages on stdout as text lines
+ *                                     or as one JSON object per line for tools (default: text).
  *
  * \param argc Number of command-line arguments.
  * \param argv Command-line arguments.
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/DialogResources.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/StringResources.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteData.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace Solarus;
+
+/**
+ * \brief Creates an empty data object of the type of a data file.
+ *
+ * The type is guessed from the path of the file in the quest data directory:
+ * "maps/", "sprites/" or "tilesets/", and "text/dialogs.dat" or
+ * "text/strings.dat" for languages.
+ *
+ * \param file_name Path of a data file.
+ * \return The data object, or nullptr if the file has no binary format.
+ */
+std::unique_ptr<LuaData> create_data(const std::string& file_name) {
+
+  // Split the path, only keeping what is inside the data directory.
+  std::vector<std::string> components;
+  std::string component;
+  for (char c : file_name) {
+    if (c == '/' || c == '\\') {
+      if (component == "data") {
+        components.clear();
+      }
+      else if (!component.empty()) {
+        components.push_back(component);
+      }
+      component.clear();
+    }
+    else {
+      component.push_back(c);
+    }
+  }
+
+  if (components.empty()) {
+    return nullptr;
+  }
+  if (component == "dialogs.dat" && components.back() == "text") {
+    return std::unique_ptr<LuaData>(new DialogResources());
+  }
+  if (component == "strings.dat" && components.back() == "text") {
+    return std::unique_ptr<LuaData>(new StringResources());
+  }
+  for (const std::string& directory : components) {
+    if (directory == "maps") {
+      return std::unique_ptr<LuaData>(new MapData());
+    }
+    if (directory == "sprites") {
+      return std::unique_ptr<LuaData>(new SpriteData());
+    }
+    if (directory == "tilesets") {
+      return std::unique_ptr<LuaData>(new TilesetData());
+    }
+  }
+  return nullptr;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Entry point of the quest compiler.
+ *
+ * Usage: solarus-quest-compiler data_file.dat [other_data_file.dat...]
+ *
+ * Converts maps, sprites, tilesets, dialogs and strings data files to their
+ * binary format. For each file "xx.dat", the file "xx.bin" is written next
+ * to it. Other files are skipped, so that a whole quest can be compiled with
+ * find data -name '*.dat' | xargs solarus-quest-compiler
+ *
+ * The engine loads binary data files when they are present and up to date
+ * with their data file.
+ *
+ * \param argc Number of command-line arguments.
+ * \param argv Command-line arguments.
+ * \return 0 if all data files were converted.
+ */
+int main(int argc, char** argv) {
+
+  using namespace Solarus;
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " data_file.dat [other_data_file.dat...]" << std::endl;
+    return 1;
+  }
+
+  int num_errors = 0;
+  for (int i = 1; i < argc; ++i) {
+
+    const std::string file_name = argv[i];
+    std::unique_ptr<LuaData> data = create_data(file_name);
+    if (data == nullptr) {
+      std::cout << "Skipping '" << file_name << "': no binary format" << std::endl;
+      continue;
+    }
+
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    if (!in) {
+      std::cerr << "Cannot open data file '" << file_name << "'" << std::endl;
+      ++num_errors;
+      continue;
+    }
+    const std::string source_buffer(
+        (std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>()
+    );
+
+    if (!data->import_from_buffer(source_buffer, file_name)) {
+      std::cerr << "Failed to load data file '" << file_name << "'" << std::endl;
+      ++num_errors;
+      continue;
+    }
+
+    std::string binary_buffer;
+    data->export_to_binary_buffer(binary_buffer, LuaData::compute_source_hash(source_buffer));
+
+    const std::string& binary_file_name = LuaData::get_binary_file_name(file_name);
+    std::ofstream out(binary_file_name.c_str(), std::ios::binary);
+    out.write(binary_buffer.data(), static_cast<std::streamsize>(binary_buffer.size()));
+    if (!out) {
+      std::cerr << "Failed to write binary data file '" << binary_file_name << "'" << std::endl;
+      ++num_errors;
+      continue;
+    }
+    std::cout << file_name << " -> " << binary_file_name << std::endl;
+  }
+
+  return num_errors == 0 ? 0 : 1;
+}
@@ -15,13 +15,16 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/System.h"
+#include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/QuestProperties.h"
 #include "solarus/graphics/Drawable.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/Movement.h"
 #include <lua.hpp>
+#include <utility>
 
 namespace Solarus {
 
@@ -45,13 +48,17 @@ Movement::Movement(bool ignore_obstacles):
   drawable(nullptr),
   xy(0, 0),
   last_move_date(0),
+  num_moves(0),
   finished(false),
   lua_notifications_enabled(true),
+  position_notifications_batched(CurrentQuest::get_properties().are_position_notifications_batched()),
+  position_notification_pending(false),
   suspended(false),
   when_suspended(0),
   last_collision_box_on_obstacle(-1, -1),
   default_ignore_obstacles(ignore_obstacles),
   current_ignore_obstacles(ignore_obstacles),
+  swept_region(),
   finished_callback_ref() {
 
 }
@@ -86,6 +93,7 @@ void Movement::set_entity(Entity* entity) {
   Debug::check_assertion(drawable == nullptr, "This movement is already assigned to a drawable");
 
   this->entity = entity;
+  swept_region = SweptRegion();
 
   if (entity == nullptr) {
     this->xy = { 0, 0 };
@@ -220,6 +228,7 @@ void Movement::set_xy(const Point& xy) {
   // The object controlled is a point.
   this->xy = xy;
 
+  ++num_moves;
   notify_position_changed();
   last_move_date = System::now();
 }
@@ -263,9 +272,15 @@ void Movement::translate_xy(const Point& dxy) {
  */
 void Movement::notify_position_changed() {
 
-  LuaContext* lua_context = get_lua_context();
-  if (lua_context != nullptr && are_lua_notifications_enabled()) {
-    lua_context->movement_on_position_changed(*this, get_xy());
+  if (position_notifications_batched) {
+    // Lua will only know the final position of this update.
+    position_notification_pending = true;
+  }
+  else {
+    LuaContext* lua_context = get_lua_context();
+    if (lua_context != nullptr && are_lua_notifications_enabled()) {
+      lua_context->movement_on_position_changed(*this, get_xy());
+    }
   }
 
   if (entity != nullptr) {
@@ -363,6 +378,35 @@ bool Movement::is_finished() const {
   return false;
 }
 
+/**
+ * \brief Returns when update() has something to do next.
+ *
+ * Movements whose update() only acts at known dates can redefine this
+ * function, so that objects skip their update at other cycles.
+ *
+ * \return The date of the next work of update(), or 0 if update()
+ * has to be called at each cycle.
+ */
+uint32_t Movement::get_next_update_date() const {
+  return 0;
+}
+
+/**
+ * \brief Returns whether update() has something to do now.
+ *
+ * This is the case when the next update date has arrived,
+ * or when notifications of the base Movement::update() are pending.
+ *
+ * \param now The current date.
+ * \return \c true if update() should be called at this cycle.
+ */
+bool Movement::is_update_needed(uint32_t now) const {
+
+  return now >= get_next_update_date() ||
+      position_notification_pending ||
+      finished != is_finished();
+}
+
 /**
  * \brief Returns whether the movement is suspended.
  * \return true if the movement is suspended
@@ -411,6 +455,8 @@ uint32_t Movement::get_when_suspended() const {
  */
 void Movement::update() {
 
+  notify_batched_position_changed();
+
   if (!finished && is_finished()) {
     finished = true;
     notify_movement_finished();
@@ -443,15 +489,104 @@ bool Movement::test_collision_with_obstacles(int dx, int dy) const {
   Rectangle collision_box = entity->get_bounding_box();
   collision_box.add_xy(dx, dy);
 
+  if (!map.is_loaded()) {
+    return map.test_collision_with_obstacles(entity->get_layer(), collision_box, *entity);
+  }
+
+  if (is_in_free_region(collision_box)) {
+    // Already known to be free: no need to test again during fast moves.
+    return false;
+  }
+
   bool collision = map.test_collision_with_obstacles(entity->get_layer(), collision_box, *entity);
 
   if (collision) {
     last_collision_box_on_obstacle = collision_box;
   }
+  else {
+    update_swept_region(collision_box, dx, dy);
+  }
 
   return collision;
 }
 
+/**
+ * \brief Returns whether a collision box is in the last region known to be
+ * free of obstacles.
+ *
+ * The region stays valid as long as nothing else than the moves of this
+ * movement changed the obstacles of the map: each move of the entity
+ * increments the obstacle generation exactly once.
+ *
+ * \param collision_box The collision box to test.
+ * \return \c true if this box certainly overlaps no obstacle.
+ */
+bool Movement::is_in_free_region(const Rectangle& collision_box) const {
+
+  if (!swept_region.free ||
+      swept_region.entities != &entity->get_map().get_entities() ||
+      swept_region.layer != entity->get_layer() ||
+      !swept_region.box.contains(collision_box)) {
+    return false;
+  }
+
+  const uint64_t num_changes =
+      swept_region.entities->get_obstacle_generation() - swept_region.generation;
+  if (num_changes != num_moves - swept_region.num_moves ||
+      entity->is_being_removed() ||
+      entity->is_ground_obstacle(Ground::TRAVERSABLE)) {
+    // Something else changed: don't trust the region anymore.
+    swept_region.free = false;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * \brief Checks obstacles at once in a region ahead of a collision box.
+ *
+ * Does nothing if the collision box is still in the last region checked,
+ * so that moves near obstacles don't check the same region again.
+ *
+ * \param collision_box A collision box that has no obstacle.
+ * \param dx Direction of the move on x.
+ * \param dy Direction of the move on y.
+ */
+void Movement::update_swept_region(const Rectangle& collision_box, int dx, int dy) const {
+
+  Entities& entities = entity->get_map().get_entities();
+  const int layer = entity->get_layer();
+  if (swept_region.entities == &entities &&
+      swept_region.layer == layer &&
+      swept_region.box.contains(collision_box)) {
+    return;
+  }
+
+  Rectangle box = collision_box;
+  if (dx > 0) {
+    box.add_width(swept_region_length);
+  }
+  else if (dx < 0) {
+    box.add_x(-swept_region_length);
+    box.add_width(swept_region_length);
+  }
+  if (dy > 0) {
+    box.add_height(swept_region_length);
+  }
+  else if (dy < 0) {
+    box.add_y(-swept_region_length);
+    box.add_height(swept_region_length);
+  }
+
+  swept_region.box = box;
+  swept_region.entities = &entities;
+  swept_region.layer = layer;
+  swept_region.generation = entities.get_obstacle_generation();
+  swept_region.num_moves = num_moves;
+  swept_region.free = entity->get_map().is_free_of_obstacles(layer, box, *entity);
+}
+
 /**
  * \brief Returns whether the entity would collide with the map
  * if it was moved a few pixels from its position.
@@ -548,11 +683,11 @@ const ScopedLuaRef& Movement::get_finished_callback() const {
  * \brief Sets the function to call when this movement finishes.
  * \param finished_callback_ref The Lua ref to a function, or an empty ref.
  */
-void Movement::set_finished_callback(const ScopedLuaRef& finished_callback_ref) {
+void Movement::set_finished_callback(ScopedLuaRef finished_callback_ref) {
 
   Debug::check_assertion(get_lua_context() != nullptr, "Undefined Lua context");
 
-  this->finished_callback_ref = finished_callback_ref;
+  this->finished_callback_ref = std::move(finished_callback_ref);
 }
 
 /**
@@ -581,6 +716,70 @@ void Movement::set_lua_notifications_enabled(bool notify) {
   this->lua_notifications_enabled = notify;
 }
 
+/**
+ * \brief Returns whether position events are sent to Lua once per update.
+ *
+ * If yes, the on_position_changed() events of the movement and of its
+ * entity are called at most once per update with the final position,
+ * instead of at each pixel moved.
+ * Collisions are still checked at each move.
+ *
+ * \return \c true if position notifications are batched.
+ */
+bool Movement::are_position_notifications_batched() const {
+  return position_notifications_batched;
+}
+
+/**
+ * \brief Sets whether position events are sent to Lua once per update.
+ *
+ * The default value comes from the quest properties.
+ *
+ * \param position_notifications_batched \c true to batch position
+ * notifications, \c false to notify Lua at each move.
+ */
+void Movement::set_position_notifications_batched(bool position_notifications_batched) {
+
+  this->position_notifications_batched = position_notifications_batched;
+  if (!position_notifications_batched) {
+    notify_batched_position_changed();
+  }
+}
+
+/**
+ * \brief Returns whether a batched position event was not sent to Lua yet.
+ * \return \c true if the position changed since the last batched event.
+ */
+bool Movement::is_position_notification_pending() const {
+  return position_notification_pending;
+}
+
+/**
+ * \brief Sends to Lua the position event waiting since the last update.
+ *
+ * Does nothing if the position did not change since the last call.
+ */
+void Movement::notify_batched_position_changed() {
+
+  if (!position_notification_pending) {
+    return;
+  }
+  position_notification_pending = false;
+
+  LuaContext* lua_context = get_lua_context();
+  if (lua_context != nullptr && are_lua_notifications_enabled()) {
+    lua_context->movement_on_position_changed(*this, get_xy());
+  }
+
+  if (entity != nullptr &&
+      !entity->is_being_removed() &&
+      entity->are_movement_notifications_enabled()) {
+    entity->get_lua_context()->entity_on_position_changed(
+        *entity, entity->get_xy(), entity->get_layer()
+    );
+  }
+}
+
 /**
  * \brief Returns the name identifying this type in Lua.
  * \return the name identifying this type in Lua
@@ -45,6 +45,45 @@ const Rectangle PathFinding::transition_collision_boxes[] = {
   Rectangle( 0,  0, 24, 24 )
 };
 
+/**
+ * \brief Creates the arrays of a path finding workspace.
+ */
+PathFinding::Workspace::Workspace():
+  nodes(window_side * window_side),
+  open_heap(),
+  path(),
+  search_id(0),
+  next_order(0) {
+
+  open_heap.reserve(nodes.size());
+  for (Node& node: nodes) {
+    node.search_id = 0;
+  }
+}
+
+/**
+ * \brief Prepares the workspace for a new search.
+ *
+ * Nodes are not cleared: they are considered unvisited until
+ * their search id matches the returned one.
+ *
+ * \return The id of the new search.
+ */
+uint32_t PathFinding::Workspace::start_search() {
+
+  ++search_id;
+  if (search_id == 0) {
+    // Wrapped around: old ids could be mistaken for the new one.
+    for (Node& node: nodes) {
+      node.search_id = 0;
+    }
+    search_id = 1;
+  }
+  open_heap.clear();
+  next_order = 0;
+  return search_id;
+}
+
 /**
  * \brief Constructor.
  * \param map the map
@@ -58,7 +97,8 @@ PathFinding::PathFinding(
     Entity& target_entity):
   map(map),
   source_entity(source_entity),
-  target_entity(target_entity) {
+  target_entity(target_entity),
+  workspace(map.get_path_finding_workspace()) {
 
   Debug::check_assertion(source_entity.is_aligned_to_grid(),
       "The source must be aligned on the map grid");
@@ -77,7 +117,7 @@ std::string PathFinding::compute_path() {
   }
 
   // The target is not traversable: then try to compute a path to somewhere close.
-  const std::vector<Point> offsets = {
+  const Point offsets[] = {
       Point(target_entity.get_width(), 0),
       Point(0, -target_entity.get_height()),
       Point(-target_entity.get_width(), 0),
@@ -107,205 +147,387 @@ std::string PathFinding::compute_path() {
 std::string PathFinding::compute_path(const Point& offset) {
 
   Point source = source_entity.get_bounding_box().get_xy();
-  Point target = target_entity.get_bounding_box().get_xy() + offset;
-
-  // std::cout << "will compute a path from " << source << " to " << target << std::endl;
-
-  target.x += 4;
-  target.x += -target.x % 8;
-  target.y += 4;
-  target.y += -target.y % 8;
-  const int target_index = get_square_index(target);
-
-  Debug::check_assertion(target.x % 8 == 0 && target.y % 8 == 0,
-      "Could not snap the target to the map grid");
+  Point target = get_target_square(target_entity.get_bounding_box().get_xy() + offset);
 
   const int total_mdistance = Geometry::get_manhattan_distance(source, target);
-  if (total_mdistance > 200 || target_entity.get_layer() != source_entity.get_layer()) {
-    //std::cout << "too far, not computing a path\n";
+  if (total_mdistance > max_distance || target_entity.get_layer() != source_entity.get_layer()) {
     return ""; // too far to compute a path
   }
 
-  std::string path = "";
+  const uint32_t search_id = workspace.start_search();
+  std::vector<Workspace::Node>& nodes = workspace.nodes;
+  const int target_cell = get_cell(target, target);
 
-  Node starting_node;
-  const int index = get_square_index(source);
-  starting_node.location = source;
-  starting_node.index = index;
+  const int source_cell = get_cell(source, target);
+  Workspace::Node& starting_node = nodes[source_cell];
+  starting_node.search_id = search_id;
+  starting_node.closed = false;
+  starting_node.direction = ' ';
+  starting_node.parent_cell = -1;
   starting_node.previous_cost = 0;
-  starting_node.heuristic = total_mdistance;
   starting_node.total_cost = total_mdistance;
-  starting_node.direction = ' ';
-  starting_node.parent_index = -1;
+  push_open_node(source_cell);
 
-  open_list.clear();
-  closed_list.clear();
-  open_list_indices.clear();
+  while (!workspace.open_heap.empty()) {
 
-  open_list[index] = starting_node;
-  open_list_indices.push_front(index);
+    // pick the node with the lowest total cost in the open list
+    const int cell = pop_open_node();
+    Workspace::Node& current_node = nodes[cell];
+    current_node.closed = true;
 
-  bool finished = false;
-  while (!finished) {
+    if (cell == target_cell) {
+      return rebuild_path(cell);
+    }
 
-    // pick the node with the lowest total cost in the open list
-    const int index = open_list_indices.front();
-    Node* current_node = &open_list[index];
-    open_list_indices.pop_front();
-    closed_list[index] = *current_node;
-    open_list.erase(index);
-    current_node = &closed_list[index];
-
-    //std::cout << System::now() << " picking the lowest cost node in the open list ("
-    //  << (open_list_indices.size() + 1) << " elements): "
-    //  << current_node->location << ", index = " << current_node->index
-    //  << ", cost = " << current_node->previous_cost << " + " << current_node->heuristic << "\n";
-
-    if (index == target_index) {
-      //std::cout << "target node was added to the closed list\n";
-      finished = true;
-      path = rebuild_path(current_node);
-      //std::cout << "rebuild done\n";
+    // look at the accessible nodes from it
+    const Point location = get_location(cell, target);
+    for (int i = 0; i < 8; i++) {
+
+      const Point new_location = location + neighbours_locations[i];
+      const int heuristic = Geometry::get_manhattan_distance(new_location, target);
+      if (heuristic >= max_distance) {
+        continue;
+      }
+
+      const int new_cell = get_cell(new_location, target);
+      Workspace::Node& new_node = nodes[new_cell];
+      const bool visited = new_node.search_id == search_id;
+      if (visited && new_node.closed) {
+        continue;
+      }
+
+      if (!is_node_transition_valid(location, i)) {
+        continue;
+      }
+
+      const int immediate_cost = (i & 1) ? 11 : 8;
+      const int previous_cost = current_node.previous_cost + immediate_cost;
+
+      if (!visited) {
+        // not in the open list: add it
+        new_node.search_id = search_id;
+        new_node.closed = false;
+        new_node.direction = '0' + i;
+        new_node.parent_cell = cell;
+        new_node.previous_cost = previous_cost;
+        new_node.total_cost = previous_cost + heuristic;
+        push_open_node(new_cell);
+      }
+      else if (previous_cost < new_node.previous_cost) {
+        // already in the open list: the current path is better
+        new_node.direction = '0' + i;
+        new_node.parent_cell = cell;
+        new_node.previous_cost = previous_cost;
+        new_node.total_cost = previous_cost + heuristic;
+        sift_up(new_node.heap_position);
+      }
     }
-    else {
-      // look at the accessible nodes from it
-      //std::cout << System::now() << " looking for accessible states\n";
-      for (int i = 0; i < 8; i++) {
-
-        Node new_node;
-        const int immediate_cost = (i & 1) ? 11 : 8;
-        new_node.previous_cost = current_node->previous_cost + immediate_cost;
-        new_node.location = current_node->location;
-        new_node.location += neighbours_locations[i];
-        new_node.index = get_square_index(new_node.location);
-        //std::cout << "  node in direction " << i << ": index = " << new_node.index << std::endl;
-
-        const bool in_closed_list = (closed_list.find(new_node.index) != closed_list.end());
-        if (!in_closed_list && Geometry::get_manhattan_distance(new_node.location, target) < 200
-            && is_node_transition_valid(*current_node, i)) {
-          //std::cout << "  node in direction " << i << " is not in the closed list\n";
-          // not in the closed list: look in the open list
-
-          const bool in_open_list = open_list.find(new_node.index) != open_list.end();
-
-          if (!in_open_list) {
-            // not in the open list: add it
-            new_node.heuristic = Geometry::get_manhattan_distance(new_node.location, target);
-            new_node.total_cost = new_node.previous_cost + new_node.heuristic;
-            new_node.parent_index = index;
-            new_node.direction = '0' + i;
-            open_list[new_node.index] = new_node;
-            add_index_sorted(&open_list[new_node.index]);
-            //std::cout << "  node in direction " << i << " is not in the open list, adding it with cost "
-            //  << new_node.previous_cost << " (" << current_node->previous_cost << " + "
-            //  << immediate_cost << ") + " << new_node.heuristic << " and parent " << new_node.parent_index << "\n";
-          }
-          else {
-            //std::cout << "  node in direction " << i << " is already in the open list\n";
-            Node* existing_node = &open_list[new_node.index];
-            // already in the open list: see if the current path is better
-            if (new_node.previous_cost < existing_node->previous_cost) {
-              existing_node->previous_cost = new_node.previous_cost;
-              existing_node->total_cost = existing_node->previous_cost + existing_node->heuristic;
-              existing_node->parent_index = index;
-              open_list_indices.sort();
-            }
-          }
+  }
+
+  return "";
+}
+
+/**
+ * \brief Computes the direction to take from every square near a target.
+ *
+ * This is a Dijkstra search from the target that follows transitions
+ * backwards. Obstacles are the ones of the source entity.
+ *
+ * \param target The target square, as returned by get_target_square().
+ * \param[out] directions For each cell of the window, the direction to take
+ * ('0' to '7'), ' ' for the target or '\0' if the target cannot be reached.
+ */
+void PathFinding::compute_flow_field(const Point& target, std::vector<char>& directions) {
+
+  const uint32_t search_id = workspace.start_search();
+  std::vector<Workspace::Node>& nodes = workspace.nodes;
+
+  const int target_cell = get_cell(target, target);
+  Workspace::Node& target_node = nodes[target_cell];
+  target_node.search_id = search_id;
+  target_node.closed = false;
+  target_node.direction = ' ';
+  target_node.parent_cell = -1;
+  target_node.previous_cost = 0;
+  target_node.total_cost = 0;
+  push_open_node(target_cell);
+
+  directions.assign(nodes.size(), '\0');
+
+  while (!workspace.open_heap.empty()) {
+
+    const int cell = pop_open_node();
+    Workspace::Node& current_node = nodes[cell];
+    current_node.closed = true;
+    directions[cell] = current_node.direction;
+
+    const Point location = get_location(cell, target);
+    if (Geometry::get_manhattan_distance(location, target) >= max_distance) {
+      // Only a starting point: the forward search never goes there.
+      continue;
+    }
+
+    // look at the nodes from which this one is accessible
+    for (int i = 0; i < 8; i++) {
+
+      const Point previous_location = location - neighbours_locations[i];
+      if (Geometry::get_manhattan_distance(previous_location, target) > max_distance) {
+        continue;
+      }
+
+      const int previous_cell = get_cell(previous_location, target);
+      Workspace::Node& previous_node = nodes[previous_cell];
+      const bool visited = previous_node.search_id == search_id;
+      if (visited && previous_node.closed) {
+        continue;
+      }
+
+      if (!is_node_transition_valid(previous_location, i)) {
+        continue;
+      }
+
+      const int immediate_cost = (i & 1) ? 11 : 8;
+      const int cost = current_node.previous_cost + immediate_cost;
+
+      if (!visited || cost < previous_node.previous_cost) {
+        previous_node.direction = '0' + i;
+        previous_node.parent_cell = cell;
+        previous_node.previous_cost = cost;
+        previous_node.total_cost = cost;
+        if (!visited) {
+          previous_node.search_id = search_id;
+          previous_node.closed = false;
+          push_open_node(previous_cell);
         }
         else {
-          //std::cout << "skipping node in direction " << i << ": already in closed list = "
-          //  << in_closed_list << ", too far from target = "
-          //  << (get_manhattan_distance(new_node.location, target) >= 200) << ", invalid transition = "
-          //  << (!is_node_transition_valid(*current_node, i)) << std::endl;
+          sift_up(previous_node.heap_position);
         }
       }
-      if (open_list_indices.empty()) {
-        finished = true;
-      }
     }
   }
+}
+
+/**
+ * \brief Snaps the top-left corner of a target to the map grid.
+ * \param target_xy Top-left corner of the target's bounding box,
+ * plus an offset if any.
+ * \return The square to reach.
+ */
+Point PathFinding::get_target_square(const Point& target_xy) {
+
+  Point target = target_xy;
+  target.x += 4;
+  target.x += -target.x % 8;
+  target.y += 4;
+  target.y += -target.y % 8;
+
+  Debug::check_assertion(target.x % 8 == 0 && target.y % 8 == 0,
+      "Could not snap the target to the map grid");
+
+  return target;
+}
+
+/**
+ * \brief Reads the path from a source in a flow field.
+ * \param directions The flow field computed by compute_flow_field().
+ * \param source Top-left corner of the source (aligned to the grid).
+ * \param target The target square of the flow field.
+ * \return The path found, or an empty string if the target cannot be
+ * reached from the source or is too far.
+ */
+std::string PathFinding::get_path_from_flow_field(
+    const std::vector<char>& directions,
+    const Point& source,
+    const Point& target
+) {
+  if (Geometry::get_manhattan_distance(source, target) > max_distance) {
+    return "";
+  }
 
-  //std::cout << "path found: " << path << ", open nodes: " << open_list.size() << ", closed nodes: " << closed_list.size() << std::endl;
+  std::string path;
+  Point location = source;
+  int x = (source.x - target.x) / 8 + window_radius;
+  int y = (source.y - target.y) / 8 + window_radius;
+  char direction = directions[y * window_side + x];
+  while (direction != ' ') {
+    if (direction == '\0') {
+      return "";
+    }
+    path.push_back(direction);
+    location += neighbours_locations[direction - '0'];
+    x = (location.x - target.x) / 8 + window_radius;
+    y = (location.y - target.y) / 8 + window_radius;
+    direction = directions[y * window_side + x];
+  }
   return path;
 }
 
 /**
- * \brief Returns the index of the 8*8 square in the map
- * corresponding to the specified location.
- * \param location location of a node on the map
- * \return index of the square corresponding to the top-left part of the location
+ * \brief Returns the cell of the node window corresponding to a location.
+ * \param location location of a node on the map, at most max_distance
+ * from the target
+ * \param target the target of the search, at the center of the window
+ * \return index of the node in the workspace
  */
-int PathFinding::get_square_index(const Point& location) const {
+int PathFinding::get_cell(const Point& location, const Point& target) const {
 
-  const int x8 = location.x / 8;
-  const int y8 = location.y / 8;
-  return y8 * map.get_width8() + x8;
+  const int x = (location.x - target.x) / 8 + window_radius;
+  const int y = (location.y - target.y) / 8 + window_radius;
+  return y * window_side + x;
 }
 
 /**
- * \brief Compares two nodes according to their total estimated cost.
- * \param other the other node
+ * \brief Returns the location on the map of a cell of the node window.
+ * \param cell index of a node in the workspace
+ * \param target the target of the search, at the center of the window
+ * \return location of the node on the map
  */
-bool PathFinding::Node::operator<(const Node& other) const {
-  return total_cost < other.total_cost;
+Point PathFinding::get_location(int cell, const Point& target) const {
+
+  return {
+      target.x + (cell % window_side - window_radius) * 8,
+      target.y + (cell / window_side - window_radius) * 8
+  };
 }
 
 /**
- * \brief Adds the index of a node to the sorted list of indices of the open
- * list, making sure that the list remains sorted.
- * \param node The node.
+ * \brief Returns whether a node should be explored before another one.
+ *
+ * The lowest total cost comes first. Among equal costs,
+ * the most recently opened node comes first.
+ *
+ * \param cell1 cell of a node in the open list
+ * \param cell2 cell of another node in the open list
+ * \return true if cell1 has priority over cell2
  */
-void PathFinding::add_index_sorted(Node* node) {
-
-  bool inserted = false;
-  for (auto it = open_list_indices.begin();
-      it != open_list_indices.end() && !inserted;
-      ++it) {
-    const int index = *it;
-    const Node* current_node = &open_list[index];
-    if (current_node->total_cost >= node->total_cost) {
-      open_list_indices.insert(it, node->index);
-      inserted = true;
+bool PathFinding::is_before(int cell1, int cell2) const {
+
+  const Workspace::Node& node1 = workspace.nodes[cell1];
+  const Workspace::Node& node2 = workspace.nodes[cell2];
+  if (node1.total_cost != node2.total_cost) {
+    return node1.total_cost < node2.total_cost;
+  }
+  return node1.order > node2.order;
+}
+
+/**
+ * \brief Adds a node to the open list.
+ * \param cell cell of the node
+ */
+void PathFinding::push_open_node(int cell) {
+
+  std::vector<int>& heap = workspace.open_heap;
+  Workspace::Node& node = workspace.nodes[cell];
+  node.order = workspace.next_order++;
+  node.heap_position = static_cast<int>(heap.size());
+  heap.push_back(cell);
+  sift_up(node.heap_position);
+}
+
+/**
+ * \brief Removes the node with the highest priority from the open list.
+ * \return cell of this node
+ */
+int PathFinding::pop_open_node() {
+
+  std::vector<int>& heap = workspace.open_heap;
+  const int cell = heap.front();
+  workspace.nodes[cell].heap_position = -1;
+
+  const int last_cell = heap.back();
+  heap.pop_back();
+  if (!heap.empty()) {
+    heap[0] = last_cell;
+    workspace.nodes[last_cell].heap_position = 0;
+    sift_down(0);
+  }
+  return cell;
+}
+
+/**
+ * \brief Moves a node of the open heap up until its parent has priority.
+ * \param heap_position current position of the node in the heap
+ */
+void PathFinding::sift_up(int heap_position) {
+
+  std::vector<int>& heap = workspace.open_heap;
+  const int cell = heap[heap_position];
+  while (heap_position > 0) {
+    const int parent_position = (heap_position - 1) / 2;
+    const int parent_cell = heap[parent_position];
+    if (!is_before(cell, parent_cell)) {
+      break;
     }
+    heap[heap_position] = parent_cell;
+    workspace.nodes[parent_cell].heap_position = heap_position;
+    heap_position = parent_position;
   }
+  heap[heap_position] = cell;
+  workspace.nodes[cell].heap_position = heap_position;
+}
 
-  if (!inserted) {
-    open_list_indices.push_back(node->index);
+/**
+ * \brief Moves a node of the open heap down until it has priority over
+ * its children.
+ * \param heap_position current position of the node in the heap
+ */
+void PathFinding::sift_down(int heap_position) {
+
+  std::vector<int>& heap = workspace.open_heap;
+  const int size = static_cast<int>(heap.size());
+  const int cell = heap[heap_position];
+  while (true) {
+    int child_position = 2 * heap_position + 1;
+    if (child_position >= size) {
+      break;
+    }
+    if (child_position + 1 < size &&
+        is_before(heap[child_position + 1], heap[child_position])) {
+      ++child_position;
+    }
+    const int child_cell = heap[child_position];
+    if (!is_before(child_cell, cell)) {
+      break;
+    }
+    heap[heap_position] = child_cell;
+    workspace.nodes[child_cell].heap_position = heap_position;
+    heap_position = child_position;
   }
+  heap[heap_position] = cell;
+  workspace.nodes[cell].heap_position = heap_position;
 }
 
 /**
  * \brief Builds the string representation of the path found by the algorithm.
- * \param closed_list The closed list of A*.
- * \return final_node The final node of the path.
+ * \param final_cell The cell of the final node of the path.
+ * \return The path from the source, as a sequence of directions '0' to '7'.
  */
-std::string PathFinding::rebuild_path(const Node* final_node) {
-
-  const Node* current_node = final_node;
-  std::string path = "";
-  while (current_node->direction != ' ') {
-    path = current_node->direction + path;
-    current_node = &closed_list[current_node->parent_index];
-    //std::cout << "current_node: " << current_node->index << ", path = " << path << std::endl;
+std::string PathFinding::rebuild_path(int final_cell) {
+
+  std::string& path = workspace.path;
+  path.clear();
+  int cell = final_cell;
+  while (workspace.nodes[cell].direction != ' ') {
+    path.push_back(workspace.nodes[cell].direction);
+    cell = workspace.nodes[cell].parent_cell;
   }
-  return path;
+  return std::string(path.rbegin(), path.rend());
 }
 
 /**
  * \brief Returns whether a transition between two nodes is valid, i.e.
  * whether there is no collision with the map.
- * \param initial_node the first node
+ * \param location location of the first node
  * \param direction the direction to take (0 to 7)
  * \return true if there is no collision for this transition
  */
 bool PathFinding::is_node_transition_valid(
-    const Node& initial_node, int direction) const {
+    const Point& location, int direction) const {
 
   Rectangle collision_box = transition_collision_boxes[direction];
-  collision_box.add_xy(initial_node.location);
+  collision_box.add_xy(location);
 
   return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
 }
 
 }
-
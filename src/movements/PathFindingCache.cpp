@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Geometry.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/Enemy.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/movements/PathFinding.h"
+#include "solarus/movements/PathFindingCache.h"
+#include <algorithm>
+#include <limits>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty path finding cache.
+ * \param map The map.
+ */
+PathFindingCache::PathFindingCache(Map& map):
+  map(map),
+  flow_fields() {
+
+}
+
+/**
+ * \brief Computes a path like PathFinding::compute_path() does,
+ * possibly reusing the search of another entity.
+ * \param source_entity The entity to move (its position must be aligned
+ * on the map grid).
+ * \param target_entity The entity to reach.
+ * \return The path found, or an empty string if no path was found
+ * (because there is no path or the target is too far).
+ */
+std::string PathFindingCache::compute_path(Entity& source_entity, Entity& target_entity) {
+
+  if (!target_entity.is_obstacle_for(source_entity)) {
+    // No offset needed.
+    return compute_path(source_entity, target_entity, Point());
+  }
+
+  // The target is not traversable: then try to compute a path to somewhere close.
+  const Point offsets[] = {
+      Point(target_entity.get_width(), 0),
+      Point(0, -target_entity.get_height()),
+      Point(-target_entity.get_width(), 0),
+      Point(0, target_entity.get_height())
+  };
+
+  std::string best_path;
+  size_t minimum_steps = std::numeric_limits<int>::max();
+  for (const Point& offset : offsets) {
+    std::string path = compute_path(source_entity, target_entity, offset);
+    if (!path.empty() && path.size() < minimum_steps) {
+      best_path = path;
+      minimum_steps = path.size();
+    }
+  }
+
+  return best_path;
+}
+
+/**
+ * \brief Computes a path to the target plus an offset.
+ * \param source_entity The entity to move.
+ * \param target_entity The entity to reach.
+ * \param offset Translation to add to the target.
+ * \return The path found, or an empty string.
+ */
+std::string PathFindingCache::compute_path(
+    Entity& source_entity, Entity& target_entity, const Point& offset) {
+
+  const Point source = source_entity.get_bounding_box().get_xy();
+  const Point target = PathFinding::get_target_square(
+      target_entity.get_bounding_box().get_xy() + offset);
+
+  if (Geometry::get_manhattan_distance(source, target) > PathFinding::max_distance ||
+      target_entity.get_layer() != source_entity.get_layer()) {
+    return ""; // too far to compute a path
+  }
+
+  const FlowField& flow_field = get_flow_field(source_entity, target_entity, target);
+  return PathFinding::get_path_from_flow_field(flow_field.directions, source, target);
+}
+
+/**
+ * \brief Returns a valid flow field for an entity and a target square,
+ * computing it if there is none yet.
+ * \param source_entity The entity to move.
+ * \param target_entity The entity to reach.
+ * \param target The target square.
+ * \return The flow field.
+ */
+PathFindingCache::FlowField& PathFindingCache::get_flow_field(
+    Entity& source_entity, Entity& target_entity, const Point& target) {
+
+  const uint32_t now = System::now();
+  flow_fields.erase(std::remove_if(flow_fields.begin(), flow_fields.end(),
+      [now](const FlowField& flow_field) {
+    return now - flow_field.date >= max_age;
+  }), flow_fields.end());
+
+  const int layer = source_entity.get_layer();
+  for (FlowField& flow_field: flow_fields) {
+    if (flow_field.target_entity == &target_entity &&
+        flow_field.target == target &&
+        flow_field.layer == layer &&
+        is_shared(flow_field, source_entity)) {
+      return flow_field;
+    }
+  }
+
+  if (static_cast<int>(flow_fields.size()) >= max_flow_fields) {
+    // Fields are stored from the oldest to the newest.
+    flow_fields.erase(flow_fields.begin());
+  }
+
+  flow_fields.emplace_back();
+  FlowField& flow_field = flow_fields.back();
+  flow_field.target_entity = &target_entity;
+  flow_field.target = target;
+  flow_field.layer = layer;
+  flow_field.source_size = source_entity.get_size();
+  if (source_entity.get_type() == EntityType::ENEMY) {
+    const Enemy& enemy = static_cast<const Enemy&>(source_entity);
+    flow_field.source_entity = nullptr;
+    flow_field.source_breed = enemy.get_breed();
+    flow_field.obstacle_behavior = static_cast<int>(enemy.get_obstacle_behavior());
+  }
+  else {
+    flow_field.source_entity = &source_entity;
+    flow_field.obstacle_behavior = 0;
+  }
+  // Transitions test boxes up to one square around nodes,
+  // plus a margin for entities that were there before moving.
+  const int margin = 16 + 16;
+  flow_field.region = Rectangle(
+      target.x - PathFinding::max_distance - margin,
+      target.y - PathFinding::max_distance - margin,
+      2 * (PathFinding::max_distance + margin) + 16,
+      2 * (PathFinding::max_distance + margin) + 16
+  );
+  flow_field.date = now;
+
+  PathFinding path_finding(map, source_entity, target_entity);
+  path_finding.compute_flow_field(target, flow_field.directions);
+
+  return flow_field;
+}
+
+/**
+ * \brief Returns whether an entity can use a flow field.
+ *
+ * Enemies with the same breed, size and obstacle behavior have the same
+ * obstacles and share their fields.
+ * Other entities may have their own traversable rules
+ * and only use their own fields.
+ *
+ * \param flow_field A flow field.
+ * \param source_entity The entity to move.
+ * \return \c true if this field is valid for the entity.
+ */
+bool PathFindingCache::is_shared(const FlowField& flow_field, const Entity& source_entity) {
+
+  if (flow_field.source_size != source_entity.get_size()) {
+    return false;
+  }
+
+  if (source_entity.get_type() != EntityType::ENEMY) {
+    return flow_field.source_entity == &source_entity;
+  }
+
+  const Enemy& enemy = static_cast<const Enemy&>(source_entity);
+  return flow_field.source_entity == nullptr &&
+      flow_field.source_breed == enemy.get_breed() &&
+      flow_field.obstacle_behavior == static_cast<int>(enemy.get_obstacle_behavior());
+}
+
+/**
+ * \brief Returns whether an entity may be an obstacle for the users
+ * of a flow field.
+ *
+ * Enemies are never obstacles for enemies when they are traversable
+ * (see Enemy::is_obstacle_for()).
+ * Any other entity may be an obstacle.
+ *
+ * \param entity An entity.
+ * \param flow_field A flow field.
+ * \return \c false if the entity is certainly not an obstacle for the users
+ * of this field.
+ */
+bool PathFindingCache::is_obstacle_for_users(const Entity& entity, const FlowField& flow_field) {
+
+  if (flow_field.source_entity == &entity) {
+    // An entity is not an obstacle for itself.
+    return false;
+  }
+
+  if (flow_field.source_entity == nullptr &&
+      entity.get_type() == EntityType::ENEMY) {
+    const Enemy& enemy = static_cast<const Enemy&>(entity);
+    return enemy.is_enabled() && !enemy.is_traversable();
+  }
+
+  return true;
+}
+
+/**
+ * \brief Drops the flow fields that an entity may make wrong.
+ *
+ * Call this function when an entity is added, moved or starts being removed.
+ *
+ * \param entity The entity that changed.
+ */
+void PathFindingCache::notify_entity_changed(const Entity& entity) {
+
+  if (flow_fields.empty() ||
+      entity.get_type() == EntityType::CAMERA) {
+    return;
+  }
+
+  const Rectangle box = entity.get_max_bounding_box();
+  flow_fields.erase(std::remove_if(flow_fields.begin(), flow_fields.end(),
+      [&](const FlowField& flow_field) {
+    if (flow_field.target_entity == &entity) {
+      // The target moving changes the key, not the obstacles.
+      return false;
+    }
+    if (!is_obstacle_for_users(entity, flow_field)) {
+      return false;
+    }
+    return flow_field.region.overlaps(box);
+  }), flow_fields.end());
+}
+
+/**
+ * \brief Drops the flow fields that target or are used by an entity
+ * being destroyed.
+ * \param entity The entity destroyed.
+ */
+void PathFindingCache::notify_entity_removed(const Entity& entity) {
+
+  flow_fields.erase(std::remove_if(flow_fields.begin(), flow_fields.end(),
+      [&](const FlowField& flow_field) {
+    return flow_field.target_entity == &entity ||
+        flow_field.source_entity == &entity;
+  }), flow_fields.end());
+}
+
+/**
+ * \brief Drops all flow fields.
+ */
+void PathFindingCache::clear() {
+  flow_fields.clear();
+}
+
+}
@@ -15,11 +15,12 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
 #include "solarus/core/Random.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
-#include "solarus/movements/PathFinding.h"
+#include "solarus/movements/PathFindingCache.h"
 #include "solarus/movements/PathFindingMovement.h"
 
 namespace Solarus {
@@ -80,8 +81,9 @@ void PathFindingMovement::update() {
 void PathFindingMovement::recompute_movement() {
 
   if (target != nullptr) {
-    PathFinding path_finding(get_entity()->get_map(), *get_entity(), *target);
-    std::string path = path_finding.compute_path();
+    // Entities chasing the same target share the same search.
+    PathFindingCache& path_finding_cache = get_entity()->get_map().get_path_finding_cache();
+    std::string path = path_finding_cache.compute_path(*get_entity(), *target);
 
     uint32_t min_delay;
     if (path.size() == 0) {
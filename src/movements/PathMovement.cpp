@@ -26,17 +26,6 @@
 
 namespace Solarus {
 
-const std::string PathMovement::elementary_moves[] = {
-    " 1  0   1  0   1  0   1  0   1  0   1  0   1  0   1  0", // 8 pixels right
-    " 1 -1   1 -1   1 -1   1 -1   1 -1   1 -1   1 -1   1 -1", // 8 pixels right-up
-    " 0 -1   0 -1   0 -1   0 -1   0 -1   0 -1   0 -1   0 -1", // 8 pixels up
-    "-1 -1  -1 -1  -1 -1  -1 -1  -1 -1  -1 -1  -1 -1  -1 -1", // 8 pixels left-up
-    "-1  0  -1  0  -1  0  -1  0  -1  0  -1  0  -1  0  -1  0", // 8 pixels left
-    "-1  1  -1  1  -1  1  -1  1  -1  1  -1  1  -1  1  -1  1", // 8 pixels left-down
-    " 0  1   0  1   0  1   0  1   0  1   0  1   0  1   0  1", // 8 pixels down
-    " 1  1   1  1   1  1   1  1   1  1   1  1   1  1   1  1"  // 8 pixels right-down
-};
-
 /**
  * \brief Creates a path movement object.
  * \param path the succession of basic moves
@@ -56,6 +45,10 @@ PathMovement::PathMovement(
     bool must_be_aligned):
 
   PixelMovement("", 0, false, ignore_obstacles),
+  initial_path(),
+  segments(),
+  segment_index(0),
+  segment_moves_done(0),
   current_direction(6),
   total_distance_covered(0),
   stopped_by_obstacle(false),
@@ -86,6 +79,23 @@ const std::string& PathMovement::get_path() const {
 void PathMovement::set_path(const std::string& path) {
 
   this->initial_path = path;
+
+  // Parse the path once rather than at each move.
+  segments.clear();
+  for (char direction_char: path) {
+    const int direction = direction_char - '0';
+    Debug::check_assertion_lazy(direction >= 0 && direction < 8, [&] {
+      return std::string("Invalid path '") + path
+          + "' (bad direction '" + direction_char + "')";
+    });
+    if (!segments.empty() && segments.back().direction == direction) {
+      ++segments.back().length;
+    }
+    else {
+      segments.push_back({ direction, 1 });
+    }
+  }
+
   restart();
 }
 
@@ -124,7 +134,7 @@ void PathMovement::set_loop(bool loop) {
 
   this->loop = loop;
 
-  if (PixelMovement::is_finished() && remaining_path.size() == 0 && loop) {
+  if (PixelMovement::is_finished() && segment_index >= segments.size() && loop) {
     restart();
   }
 }
@@ -177,6 +187,14 @@ void PathMovement::update() {
   PixelMovement::update();
 }
 
+/**
+ * \brief Returns when update() has something to do next.
+ * \return 0: elementary moves and snapping are checked at each cycle.
+ */
+uint32_t PathMovement::get_next_update_date() const {
+  return 0;
+}
+
 /**
  * \brief Suspends or resumes this movement.
  * \param suspended true to suspend the movement, false to resume it
@@ -199,7 +217,7 @@ void PathMovement::set_suspended(bool suspended) {
  */
 bool PathMovement::is_finished() const {
 
-  return (PixelMovement::is_finished() && remaining_path.empty() && !loop)
+  return (PixelMovement::is_finished() && segment_index >= segments.size() && !loop)
       || stopped_by_obstacle;
 }
 
@@ -208,7 +226,8 @@ bool PathMovement::is_finished() const {
  */
 void PathMovement::restart() {
 
-  this->remaining_path = initial_path;
+  this->segment_index = 0;
+  this->segment_moves_done = 0;
   this->snapping = false;
   this->stop_snapping_date = 0;
   this->stopped_by_obstacle = false;
@@ -271,11 +290,12 @@ void PathMovement::start_next_elementary_move() {
 
     snapping = false;
 
-    if (remaining_path.empty()) {
+    if (segment_index >= segments.size()) {
       // the path is finished
       if (loop) {
         // if the property 'loop' is true, repeat the same path again
-        remaining_path = initial_path;
+        segment_index = 0;
+        segment_moves_done = 0;
       }
       else if (!is_stopped()) {
         // the movement is finished: stop the entity
@@ -283,18 +303,18 @@ void PathMovement::start_next_elementary_move() {
       }
     }
 
-    if (!remaining_path.empty()) {
+    if (segment_index < segments.size()) {
       // normal case: there is a next trajectory to do
 
-      current_direction = remaining_path[0] - '0';
-      Debug::check_assertion(current_direction >= 0 && current_direction < 8,
-          std::string("Invalid path '") + initial_path + "' (bad direction '"
-          + remaining_path[0] + "')"
-      );
+      const PathSegment& segment = segments[segment_index];
+      current_direction = segment.direction;
 
       PixelMovement::set_delay(speed_to_delay(speed, current_direction));
-      PixelMovement::set_trajectory(elementary_moves[current_direction]);
-      remaining_path = remaining_path.substr(1);
+      PixelMovement::set_trajectory(Entity::direction_to_xy_move(current_direction), 8);
+      if (++segment_moves_done >= segment.length) {
+        ++segment_index;
+        segment_moves_done = 0;
+      }
     }
   }
 }
@@ -321,10 +341,9 @@ Point PathMovement::get_xy_change() const {
 
   Point xy;
 
-  for (char direction_char: initial_path) {
-    int direction = direction_char - '0';
-    const Point& xy_move = Entity::direction_to_xy_move(direction);
-    xy += xy_move * 8;
+  for (const PathSegment& segment: segments) {
+    const Point& xy_move = Entity::direction_to_xy_move(segment.direction);
+    xy += xy_move * (8 * segment.length);
   }
 
   return xy;
@@ -19,6 +19,7 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/PixelMovement.h"
+#include <limits>
 #include <sstream>
 
 namespace Solarus {
@@ -101,6 +102,23 @@ void PixelMovement::set_trajectory(const std::string& trajectory_string) {
   restart();
 }
 
+/**
+ * \brief Sets a trajectory that repeats the same translation.
+ *
+ * Unlike the other setters, this reuses the memory of the previous
+ * trajectory and parses nothing, so it can be called very often.
+ *
+ * \param step The translation of each move.
+ * \param num_steps Number of moves.
+ */
+void PixelMovement::set_trajectory(const Point& step, int num_steps) {
+
+  trajectory.assign(num_steps, step);
+  this->trajectory_string = ""; // will be computed only on demand
+
+  restart();
+}
+
 /**
  * \brief Returns the delay between two moves.
  * \return the delay between two moves, in milliseconds
@@ -189,6 +207,19 @@ void PixelMovement::update() {
   Movement::update();
 }
 
+/**
+ * \brief Returns the date of the next step.
+ * \return The date of the next step,
+ * or the maximum date if the movement is finished or suspended.
+ */
+uint32_t PixelMovement::get_next_update_date() const {
+
+  if (is_suspended() || finished) {
+    return std::numeric_limits<uint32_t>::max();
+  }
+  return next_move_date;
+}
+
 /**
  * \brief Suspends or resumes this movement.
  * \param suspended true to suspend the movement, false to resume it
@@ -79,6 +79,14 @@ void PlayerMovement::update() {
   }
 }
 
+/**
+ * \brief Returns when update() has something to do next.
+ * \return 0: game commands are checked at each cycle.
+ */
+uint32_t PlayerMovement::get_next_update_date() const {
+  return 0;
+}
+
 /**
  * \brief Returns the direction this movement is trying to move towards.
  * \return the direction (0 to 7), or -1 if the player is not trying to go
@@ -21,6 +21,7 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/RandomMovement.h"
+#include <algorithm>
 #include <sstream>
 
 namespace Solarus {
@@ -155,6 +156,19 @@ void RandomMovement::update() {
   }
 }
 
+/**
+ * \brief Returns the date of the next move or direction change.
+ * \return The date of the next update work.
+ */
+uint32_t RandomMovement::get_next_update_date() const {
+
+  uint32_t date = StraightMovement::get_next_update_date();
+  if (!is_suspended()) {
+    date = std::min(date, next_direction_change_date);
+  }
+  return date;
+}
+
 /**
  * \brief Suspends or resumes this movement.
  * \param suspended true to suspend the movement, false to resume it
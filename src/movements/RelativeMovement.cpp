@@ -95,6 +95,8 @@ void RelativeMovement::update() {
       set_xy(next);
     }
   }
+
+  notify_batched_position_changed();
 }
 
 /**
@@ -20,7 +20,9 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/StraightMovement.h"
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace Solarus {
 
@@ -165,8 +167,8 @@ void StraightMovement::set_speed(double speed) {
 
   // compute the new speed vector
   double old_angle = this->angle;
-  set_x_speed(speed * std::cos(old_angle));
-  set_y_speed(-speed * std::sin(old_angle));
+  set_x_speed(speed * Geometry::get_cos(old_angle));
+  set_y_speed(-speed * Geometry::get_sin(old_angle));
   this->angle = old_angle;
 
   notify_movement_changed();
@@ -244,8 +246,8 @@ void StraightMovement::set_angle(double angle) {
 
   if (!is_stopped()) {
     double speed = get_speed();
-    set_x_speed(speed * std::cos(angle));
-    set_y_speed(-speed * std::sin(angle));
+    set_x_speed(speed * Geometry::get_cos(angle));
+    set_y_speed(-speed * Geometry::get_sin(angle));
   }
   this->angle = angle;
 
@@ -315,6 +317,26 @@ bool StraightMovement::has_to_move_now() const {
     || (y_move != 0 && now >= next_move_date_y);
 }
 
+/**
+ * \brief Returns the date of the next x or y move.
+ * \return The date of the next move,
+ * or the maximum date if the movement is stopped or suspended.
+ */
+uint32_t StraightMovement::get_next_update_date() const {
+
+  uint32_t date = std::numeric_limits<uint32_t>::max();
+  if (is_suspended()) {
+    return date;
+  }
+  if (x_move != 0) {
+    date = next_move_date_x;
+  }
+  if (y_move != 0) {
+    date = std::min(date, next_move_date_y);
+  }
+  return date;
+}
+
 /**
  * \brief Suspends or resumes the movement.
  *
@@ -27,7 +27,7 @@ namespace Solarus {
 namespace {
 
 /**
- * \brief Time interval between each recomputation of the angle.
+ * \brief Minimum time interval between two recomputations of the angle.
  */
 const uint32_t recomputation_delay = 150;
 
@@ -71,6 +71,7 @@ TargetMovement::TargetMovement(
   sign_y(0),
   moving_speed(moving_speed),
   next_recomputation_date(System::now()),
+  obstacle_reached(false),
   finished(false),
   recomputing_movement(false) {
 }
@@ -96,6 +97,16 @@ void TargetMovement::notify_position_changed() {
   check_target_reached();
 }
 
+/**
+ * \copydoc Movement::notify_obstacle_reached
+ */
+void TargetMovement::notify_obstacle_reached() {
+
+  StraightMovement::notify_obstacle_reached();
+
+  obstacle_reached = true;
+}
+
 /**
  * \brief Changes the target of this movement.
  * \param target_entity The entity to target or nullptr.
@@ -144,9 +155,10 @@ void TargetMovement::update() {
     set_target(nullptr, target);
   }
 
-  if (System::now() >= next_recomputation_date) {
+  const uint32_t now = System::now();
+  if (now >= next_recomputation_date && needs_recomputation()) {
     recompute_movement();
-    next_recomputation_date += recomputation_delay;
+    next_recomputation_date = now + recomputation_delay;
   }
 
   check_target_reached();
@@ -154,6 +166,14 @@ void TargetMovement::update() {
   StraightMovement::update();
 }
 
+/**
+ * \brief Returns when update() has something to do next.
+ * \return 0: the target may move at any cycle.
+ */
+uint32_t TargetMovement::get_next_update_date() const {
+  return 0;
+}
+
 /**
  * \brief Calculates the direction and the speed of the movement
  * depending on the target.
@@ -165,6 +185,7 @@ void TargetMovement::recompute_movement() {
     return;
   }
   recomputing_movement = true;
+  obstacle_reached = false;
 
   if (target_entity != nullptr) {
     // the target may be a moving entity
@@ -191,6 +212,28 @@ void TargetMovement::recompute_movement() {
   recomputing_movement = false;
 }
 
+/**
+ * \brief Returns whether the angle computed last may be wrong now.
+ *
+ * While the target does not move, the straight line computed last
+ * still leads to it, so there is no need to compute it again
+ * unless an obstacle or the end of the distance stopped the entity.
+ *
+ * \return \c true if the movement should be recomputed.
+ */
+bool TargetMovement::needs_recomputation() const {
+
+  if (target_entity != nullptr &&
+      target_entity->get_xy() + entity_offset != target) {
+    // The target has moved.
+    return true;
+  }
+
+  return !finished &&
+      get_xy() != target &&
+      (obstacle_reached || !StraightMovement::is_started());
+}
+
 /**
  * \brief Checks whether the target is reached.
  *
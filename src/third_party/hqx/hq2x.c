@@ -71,16 +71,16 @@
 #define PIXEL11_90    *(dp+dpL+1) = Interp9(w[5], w[6], w[8]);
 #define PIXEL11_100   *(dp+dpL+1) = Interp10(w[5], w[6], w[8]);
 
-HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+HQX_API void HQX_CALLCONV hq2x_32_rb_rows( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres, int first_row, int end_row )
 {
     int  i, j, k;
     int  prevline, nextline;
     uint32_t  w[10];
     int dpL = (drb >> 2);
     int spL = (srb >> 2);
-    uint8_t *sRowP = (uint8_t *) sp;
-    uint8_t *dRowP = (uint8_t *) dp;
-    uint32_t yuv1, yuv2;
+    uint8_t *sRowP = (uint8_t *) sp + first_row * srb;
+    uint8_t *dRowP = (uint8_t *) dp + first_row * drb * 2;
+    uint32_t y[10];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -93,7 +93,10 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    for (j=0; j<Yres; j++)
+    sp = (uint32_t *) sRowP;
+    dp = (uint32_t *) dRowP;
+
+    for (j=first_row; j<end_row; j++)
     {
         if (j>0)      prevline = -spL; else prevline = 0;
         if (j<Yres-1) nextline =  spL; else nextline = 0;
@@ -130,19 +133,50 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 w[9] = w[8];
             }
 
+            // YUV values of the window slide with it:
+            // only the right column is converted.
+            if (i>0)
+            {
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+                y[2] = y[3];
+                y[5] = y[6];
+                y[8] = y[9];
+            }
+            else
+            {
+                y[2] = rgb_to_yuv(w[2]);
+                y[5] = rgb_to_yuv(w[5]);
+                y[8] = rgb_to_yuv(w[8]);
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+            }
+
+            if (i<Xres-1)
+            {
+                y[3] = rgb_to_yuv(w[3]);
+                y[6] = rgb_to_yuv(w[6]);
+                y[9] = rgb_to_yuv(w[9]);
+            }
+            else
+            {
+                y[3] = y[2];
+                y[6] = y[5];
+                y[9] = y[8];
+            }
+
             int pattern = 0;
             int flag = 1;
 
-            yuv1 = rgb_to_yuv(w[5]);
-
             for (k=1; k<=9; k++)
             {
                 if (k==5) continue;
 
                 if ( w[k] != w[5] )
                 {
-                    yuv2 = rgb_to_yuv(w[k]);
-                    if (yuv_diff(yuv1, yuv2))
+                    if (yuv_diff(y[5], y[k]))
                         pattern |= flag;
                 }
                 flag <<= 1;
@@ -309,7 +343,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 50:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -327,7 +361,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_22
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -342,7 +376,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -356,7 +390,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 10:
                 case 138:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -429,7 +463,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 54:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -447,7 +481,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_22
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -462,7 +496,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -476,7 +510,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 11:
                 case 139:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -492,7 +526,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 19:
                 case 51:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_11
                             PIXEL01_10
@@ -510,7 +544,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 178:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                             PIXEL11_12
@@ -527,7 +561,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 85:
                     {
                         PIXEL00_20
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL01_11
                             PIXEL11_10
@@ -545,7 +579,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_20
                         PIXEL01_22
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL10_12
                             PIXEL11_10
@@ -562,7 +596,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                             PIXEL11_11
@@ -577,7 +611,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 73:
                 case 77:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_12
                             PIXEL10_10
@@ -594,7 +628,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 42:
                 case 170:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                             PIXEL10_11
@@ -611,7 +645,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 14:
                 case 142:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                             PIXEL01_12
@@ -692,7 +726,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 26:
                 case 31:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -700,7 +734,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -716,7 +750,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 214:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -725,7 +759,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_20
                         }
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -740,7 +774,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_22
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -748,7 +782,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -761,7 +795,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 74:
                 case 107:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -770,7 +804,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_21
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -783,7 +817,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 27:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -799,7 +833,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 86:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -816,7 +850,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_21
                         PIXEL01_22
                         PIXEL10_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -830,7 +864,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_10
                         PIXEL01_21
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -844,7 +878,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 30:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -861,7 +895,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_22
                         PIXEL01_10
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -875,7 +909,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_22
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -888,7 +922,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 75:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -999,7 +1033,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 58:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1007,7 +1041,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1022,7 +1056,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 83:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1031,7 +1065,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_70
                         }
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1045,7 +1079,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1053,7 +1087,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1065,7 +1099,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 202:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1074,7 +1108,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_70
                         }
                         PIXEL01_21
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1087,7 +1121,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 78:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1096,7 +1130,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_70
                         }
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1109,7 +1143,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 154:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1117,7 +1151,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1132,7 +1166,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 114:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1141,7 +1175,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_70
                         }
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1155,7 +1189,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_22
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1163,7 +1197,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1175,7 +1209,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 90:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1183,7 +1217,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1191,7 +1225,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_70
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1199,7 +1233,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1212,7 +1246,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 55:
                 case 23:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_11
                             PIXEL01_0
@@ -1230,7 +1264,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 150:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                             PIXEL11_12
@@ -1247,7 +1281,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 212:
                     {
                         PIXEL00_20
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL01_11
                             PIXEL11_0
@@ -1265,7 +1299,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_20
                         PIXEL01_22
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL10_12
                             PIXEL11_0
@@ -1282,7 +1316,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                             PIXEL11_11
@@ -1297,7 +1331,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 109:
                 case 105:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_12
                             PIXEL10_0
@@ -1314,7 +1348,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 171:
                 case 43:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL10_11
@@ -1331,7 +1365,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 143:
                 case 15:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_12
@@ -1349,7 +1383,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -1362,7 +1396,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 203:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -1378,7 +1412,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 62:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -1395,7 +1429,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_11
                         PIXEL01_10
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -1408,7 +1442,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 118:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -1425,7 +1459,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_12
                         PIXEL01_22
                         PIXEL10_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -1439,7 +1473,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_10
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -1452,7 +1486,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 155:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -1533,7 +1567,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1541,7 +1575,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -1553,7 +1587,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 158:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1561,7 +1595,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -1575,7 +1609,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 234:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1584,7 +1618,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_70
                         }
                         PIXEL01_21
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -1598,7 +1632,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 242:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1607,7 +1641,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_70
                         }
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -1619,7 +1653,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 59:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -1627,7 +1661,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1643,7 +1677,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_22
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -1651,7 +1685,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1664,7 +1698,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 87:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -1673,7 +1707,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_20
                         }
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1685,7 +1719,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 79:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -1694,7 +1728,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1707,7 +1741,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 122:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1715,7 +1749,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1723,7 +1757,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_70
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -1731,7 +1765,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1743,7 +1777,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 94:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1751,7 +1785,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -1759,7 +1793,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_20
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1767,7 +1801,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1779,7 +1813,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 218:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1787,7 +1821,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1795,7 +1829,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_70
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1803,7 +1837,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -1815,7 +1849,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 91:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -1823,7 +1857,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1831,7 +1865,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_70
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1839,7 +1873,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1883,7 +1917,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 186:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1891,7 +1925,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_70
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1906,7 +1940,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 115:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -1915,7 +1949,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_70
                         }
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1929,7 +1963,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1937,7 +1971,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_70
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -1949,7 +1983,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 206:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -1958,7 +1992,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_70
                         }
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1974,7 +2008,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_10
                         }
@@ -1988,7 +2022,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 174:
                 case 46:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_10
                         }
@@ -2005,7 +2039,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 147:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_10
                         }
@@ -2023,7 +2057,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_11
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_10
                         }
@@ -2052,7 +2086,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 126:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2060,7 +2094,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_20
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2073,7 +2107,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 219:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2083,7 +2117,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL01_10
                         PIXEL10_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2095,7 +2129,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 125:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_12
                             PIXEL10_0
@@ -2112,7 +2146,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 221:
                     {
                         PIXEL00_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL01_11
                             PIXEL11_0
@@ -2127,7 +2161,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 207:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_12
@@ -2145,7 +2179,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_10
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                             PIXEL11_11
@@ -2160,7 +2194,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 190:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                             PIXEL11_12
@@ -2175,7 +2209,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 187:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL10_11
@@ -2193,7 +2227,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_11
                         PIXEL01_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL10_12
                             PIXEL11_0
@@ -2207,7 +2241,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 119:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_11
                             PIXEL01_0
@@ -2226,7 +2260,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_20
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2240,7 +2274,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 175:
                 case 47:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2257,7 +2291,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 151:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2275,7 +2309,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_11
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2289,7 +2323,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_10
                         PIXEL01_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2297,7 +2331,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2309,7 +2343,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 123:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2318,7 +2352,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2331,7 +2365,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 95:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2339,7 +2373,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2354,7 +2388,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 222:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2363,7 +2397,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_20
                         }
                         PIXEL10_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2377,7 +2411,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_21
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2385,7 +2419,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2399,7 +2433,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_22
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2407,7 +2441,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_100
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2419,7 +2453,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 235:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2428,7 +2462,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_21
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2441,7 +2475,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 111:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2450,7 +2484,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_100
                         }
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2463,7 +2497,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 63:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2471,7 +2505,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_100
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2485,7 +2519,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 159:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2493,7 +2527,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2508,7 +2542,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 215:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2517,7 +2551,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_100
                         }
                         PIXEL10_21
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2530,7 +2564,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 246:
                     {
                         PIXEL00_22
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2539,7 +2573,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_20
                         }
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2552,7 +2586,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 254:
                     {
                         PIXEL00_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2560,7 +2594,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_20
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2568,7 +2602,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_20
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2582,7 +2616,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_12
                         PIXEL01_11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2590,7 +2624,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_100
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2602,7 +2636,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 251:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2611,7 +2645,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2619,7 +2653,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_100
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2631,7 +2665,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 239:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2640,7 +2674,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_100
                         }
                         PIXEL01_12
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2653,7 +2687,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 127:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2661,7 +2695,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_100
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2669,7 +2703,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_20
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2682,7 +2716,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 191:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2690,7 +2724,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_100
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2704,7 +2738,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 223:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2712,7 +2746,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_20
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2721,7 +2755,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_100
                         }
                         PIXEL10_10
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2734,7 +2768,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 247:
                     {
                         PIXEL00_11
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2743,7 +2777,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_100
                         }
                         PIXEL10_12
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2755,7 +2789,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 255:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -2763,7 +2797,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_100
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_0
                         }
@@ -2771,7 +2805,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL01_100
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_0
                         }
@@ -2779,7 +2813,7 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL10_100
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL11_0
                         }
@@ -2802,6 +2836,11 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     }
 }
 
+HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+{
+    hq2x_32_rb_rows(sp, srb, dp, drb, Xres, Yres, 0, Yres);
+}
+
 HQX_API void HQX_CALLCONV hq2x_32( uint32_t * sp, uint32_t * dp, int Xres, int Yres )
 {
     uint32_t rowBytesL = Xres * 4;
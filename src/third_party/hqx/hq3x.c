@@ -76,16 +76,16 @@
 #define PIXEL22_5   *(dp+dpL+dpL+2) = Interp5(w[6], w[8]);
 #define PIXEL22_C   *(dp+dpL+dpL+2) = w[5];
 
-HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+HQX_API void HQX_CALLCONV hq3x_32_rb_rows( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres, int first_row, int end_row )
 {
     int  i, j, k;
     int  prevline, nextline;
     uint32_t  w[10];
     int dpL = (drb >> 2);
     int spL = (srb >> 2);
-    uint8_t *sRowP = (uint8_t *) sp;
-    uint8_t *dRowP = (uint8_t *) dp;
-    uint32_t yuv1, yuv2;
+    uint8_t *sRowP = (uint8_t *) sp + first_row * srb;
+    uint8_t *dRowP = (uint8_t *) dp + first_row * drb * 3;
+    uint32_t y[10];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -98,7 +98,10 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    for (j=0; j<Yres; j++)
+    sp = (uint32_t *) sRowP;
+    dp = (uint32_t *) dRowP;
+
+    for (j=first_row; j<end_row; j++)
     {
         if (j>0)      prevline = -spL; else prevline = 0;
         if (j<Yres-1) nextline =  spL; else nextline = 0;
@@ -135,19 +138,50 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 w[9] = w[8];
             }
 
+            // YUV values of the window slide with it:
+            // only the right column is converted.
+            if (i>0)
+            {
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+                y[2] = y[3];
+                y[5] = y[6];
+                y[8] = y[9];
+            }
+            else
+            {
+                y[2] = rgb_to_yuv(w[2]);
+                y[5] = rgb_to_yuv(w[5]);
+                y[8] = rgb_to_yuv(w[8]);
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+            }
+
+            if (i<Xres-1)
+            {
+                y[3] = rgb_to_yuv(w[3]);
+                y[6] = rgb_to_yuv(w[6]);
+                y[9] = rgb_to_yuv(w[9]);
+            }
+            else
+            {
+                y[3] = y[2];
+                y[6] = y[5];
+                y[9] = y[8];
+            }
+
             int pattern = 0;
             int flag = 1;
 
-            yuv1 = rgb_to_yuv(w[5]);
-
             for (k=1; k<=9; k++)
             {
                 if (k==5) continue;
 
                 if ( w[k] != w[5] )
                 {
-                    yuv2 = rgb_to_yuv(w[k]);
-                    if (yuv_diff(yuv1, yuv2))
+                    if (yuv_diff(y[5], y[k]))
                         pattern |= flag;
                 }
                 flag <<= 1;
@@ -379,7 +413,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 50:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_1M
@@ -407,7 +441,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_1
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -429,7 +463,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_2
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_1M
@@ -447,7 +481,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 10:
                 case 138:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                             PIXEL01_C
@@ -557,7 +591,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 54:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -585,7 +619,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_1
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -607,7 +641,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_2
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -625,7 +659,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 11:
                 case 139:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -648,7 +682,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 19:
                 case 51:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_1L
                             PIXEL01_C
@@ -672,7 +706,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 146:
                 case 178:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_1M
@@ -696,7 +730,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 84:
                 case 85:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL02_1U
                             PIXEL12_C
@@ -720,7 +754,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 112:
                 case 113:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL20_1L
@@ -744,7 +778,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 200:
                 case 204:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_1M
@@ -768,7 +802,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 73:
                 case 77:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_1U
                             PIXEL10_C
@@ -792,7 +826,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 42:
                 case 170:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                             PIXEL01_C
@@ -816,7 +850,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 14:
                 case 142:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                             PIXEL01_C
@@ -944,7 +978,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 26:
                 case 31:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL10_C
@@ -955,7 +989,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_3
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                             PIXEL12_C
@@ -975,7 +1009,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 214:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -989,7 +1023,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11
                         PIXEL12_C
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL21_C
                             PIXEL22_C
@@ -1008,7 +1042,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL01_1
                         PIXEL02_1M
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1019,7 +1053,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_4
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL22_C
@@ -1034,7 +1068,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 74:
                 case 107:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1048,7 +1082,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                             PIXEL21_C
@@ -1063,7 +1097,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 27:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1086,7 +1120,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 86:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -1113,7 +1147,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -1134,7 +1168,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1152,7 +1186,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 30:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -1179,7 +1213,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_1
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -1200,7 +1234,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1217,7 +1251,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 75:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1395,7 +1429,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 58:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -1404,7 +1438,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -1424,7 +1458,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -1437,7 +1471,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1M
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -1455,7 +1489,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -1464,7 +1498,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -1476,7 +1510,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 202:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -1489,7 +1523,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -1503,7 +1537,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 78:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -1516,7 +1550,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -1530,7 +1564,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 154:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -1539,7 +1573,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -1559,7 +1593,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1M
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -1572,7 +1606,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -1590,7 +1624,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -1599,7 +1633,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -1611,7 +1645,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 90:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -1620,7 +1654,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -1631,7 +1665,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -1640,7 +1674,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -1653,7 +1687,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 55:
                 case 23:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_1L
                             PIXEL01_C
@@ -1677,7 +1711,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 182:
                 case 150:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -1701,7 +1735,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 213:
                 case 212:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL02_1U
                             PIXEL12_C
@@ -1725,7 +1759,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 241:
                 case 240:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL20_1L
@@ -1749,7 +1783,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 236:
                 case 232:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1773,7 +1807,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 109:
                 case 105:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_1U
                             PIXEL10_C
@@ -1797,7 +1831,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 171:
                 case 43:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1821,7 +1855,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 143:
                 case 15:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1849,7 +1883,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1U
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1866,7 +1900,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 203:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -1889,7 +1923,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 62:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -1916,7 +1950,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_1
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -1933,7 +1967,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 118:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -1960,7 +1994,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -1981,7 +2015,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1R
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -1998,7 +2032,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 155:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2129,7 +2163,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1U
                         PIXEL10_C
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2137,7 +2171,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL20_2
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -2153,7 +2187,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 158:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2161,7 +2195,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_2
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -2182,7 +2216,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 234:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2194,7 +2228,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -2213,7 +2247,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1M
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2224,7 +2258,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_1
                         PIXEL11
                         PIXEL20_1L
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -2240,7 +2274,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 59:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2252,7 +2286,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_3
                             PIXEL10_3
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2274,7 +2308,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -2286,7 +2320,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_4
                             PIXEL21_3
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2299,7 +2333,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 87:
                     {
                         PIXEL00_1L
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -2315,7 +2349,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11
                         PIXEL20_1M
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2327,7 +2361,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 79:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2342,7 +2376,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1R
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2356,7 +2390,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 122:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2365,7 +2399,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2375,7 +2409,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -2387,7 +2421,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_4
                             PIXEL21_3
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2399,7 +2433,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 94:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2407,7 +2441,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL00_2
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -2421,7 +2455,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL10_C
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2430,7 +2464,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2442,7 +2476,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 218:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2451,7 +2485,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2461,7 +2495,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL10_C
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2469,7 +2503,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         {
                             PIXEL20_2
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -2485,7 +2519,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 91:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2497,7 +2531,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_3
                             PIXEL10_3
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2507,7 +2541,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2516,7 +2550,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2580,7 +2614,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 186:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2589,7 +2623,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2609,7 +2643,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2622,7 +2656,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2640,7 +2674,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2649,7 +2683,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2661,7 +2695,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 206:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2674,7 +2708,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2695,7 +2729,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_1M
                         }
@@ -2710,7 +2744,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 174:
                 case 46:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_1M
                         }
@@ -2733,7 +2767,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_1M
                         }
@@ -2760,7 +2794,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_1M
                         }
@@ -2799,7 +2833,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 126:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -2812,7 +2846,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL12_3
                         }
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -2829,7 +2863,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 219:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2844,7 +2878,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -2860,7 +2894,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 125:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_1U
                             PIXEL10_C
@@ -2883,7 +2917,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 221:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL02_1U
                             PIXEL12_C
@@ -2906,7 +2940,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 207:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2929,7 +2963,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 238:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -2952,7 +2986,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 190:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -2975,7 +3009,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 187:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -2998,7 +3032,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 243:
                     {
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL20_1L
@@ -3021,7 +3055,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 119:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_1L
                             PIXEL01_C
@@ -3051,7 +3085,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3066,7 +3100,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 175:
                 case 47:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3089,7 +3123,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3116,7 +3150,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3132,7 +3166,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL01_C
                         PIXEL02_1M
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -3143,7 +3177,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_4
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL22_C
@@ -3157,7 +3191,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 123:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -3171,7 +3205,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                             PIXEL21_C
@@ -3186,7 +3220,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 95:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL10_C
@@ -3197,7 +3231,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_3
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                             PIXEL12_C
@@ -3216,7 +3250,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 222:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -3230,7 +3264,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11
                         PIXEL12_C
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL21_C
                             PIXEL22_C
@@ -3249,7 +3283,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1U
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -3260,7 +3294,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_4
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3277,7 +3311,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL02_1M
                         PIXEL10_C
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3286,7 +3320,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL22_C
@@ -3300,7 +3334,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 235:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -3314,7 +3348,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3328,7 +3362,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 111:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3341,7 +3375,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                             PIXEL21_C
@@ -3356,7 +3390,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 63:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3365,7 +3399,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                             PIXEL12_C
@@ -3384,7 +3418,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 159:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL10_C
@@ -3395,7 +3429,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_3
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3414,7 +3448,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3426,7 +3460,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11
                         PIXEL12_C
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL21_C
                             PIXEL22_C
@@ -3441,7 +3475,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 246:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -3456,7 +3490,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3469,7 +3503,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 254:
                     {
                         PIXEL00_1M
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -3480,7 +3514,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL02_4
                         }
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -3490,7 +3524,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_3
                             PIXEL20_4
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL21_C
@@ -3512,7 +3546,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3521,7 +3555,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3533,7 +3567,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 251:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -3545,7 +3579,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL02_1M
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL10_C
                             PIXEL20_C
@@ -3557,7 +3591,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                             PIXEL21_3
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL12_C
                             PIXEL22_C
@@ -3571,7 +3605,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 239:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3584,7 +3618,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_1
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3598,7 +3632,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 127:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL01_C
@@ -3610,7 +3644,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_3
                             PIXEL10_3
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                             PIXEL12_C
@@ -3621,7 +3655,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL12_3
                         }
                         PIXEL11
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                             PIXEL21_C
@@ -3636,7 +3670,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 191:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3645,7 +3679,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3663,7 +3697,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 223:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                             PIXEL10_C
@@ -3673,7 +3707,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_4
                             PIXEL10_3
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL01_C
                             PIXEL02_C
@@ -3687,7 +3721,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL11
                         PIXEL20_1M
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL21_C
                             PIXEL22_C
@@ -3703,7 +3737,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_1L
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3716,7 +3750,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_C
                         PIXEL20_1L
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3728,7 +3762,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 255:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_C
                         }
@@ -3737,7 +3771,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_2
                         }
                         PIXEL01_C
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_C
                         }
@@ -3748,7 +3782,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_C
                         PIXEL11
                         PIXEL12_C
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_C
                         }
@@ -3757,7 +3791,7 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL20_2
                         }
                         PIXEL21_C
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_C
                         }
@@ -3780,6 +3814,11 @@ HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     }
 }
 
+HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+{
+    hq3x_32_rb_rows(sp, srb, dp, drb, Xres, Yres, 0, Yres);
+}
+
 HQX_API void HQX_CALLCONV hq3x_32( uint32_t * sp, uint32_t * dp, int Xres, int Yres )
 {
     uint32_t rowBytesL = Xres * 4;
@@ -163,16 +163,16 @@
 #define PIXEL33_81    *(dp+dpL+dpL+dpL+3) = Interp8(w[5], w[6]);
 #define PIXEL33_82    *(dp+dpL+dpL+dpL+3) = Interp8(w[5], w[8]);
 
-HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+HQX_API void HQX_CALLCONV hq4x_32_rb_rows( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres, int first_row, int end_row )
 {
     int  i, j, k;
     int  prevline, nextline;
     uint32_t w[10];
     int dpL = (drb >> 2);
     int spL = (srb >> 2);
-    uint8_t *sRowP = (uint8_t *) sp;
-    uint8_t *dRowP = (uint8_t *) dp;
-    uint32_t yuv1, yuv2;
+    uint8_t *sRowP = (uint8_t *) sp + first_row * srb;
+    uint8_t *dRowP = (uint8_t *) dp + first_row * drb * 4;
+    uint32_t y[10];
 
     //   +----+----+----+
     //   |    |    |    |
@@ -185,7 +185,10 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    for (j=0; j<Yres; j++)
+    sp = (uint32_t *) sRowP;
+    dp = (uint32_t *) dRowP;
+
+    for (j=first_row; j<end_row; j++)
     {
         if (j>0)      prevline = -spL; else prevline = 0;
         if (j<Yres-1) nextline =  spL; else nextline = 0;
@@ -222,19 +225,50 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 w[9] = w[8];
             }
 
+            // YUV values of the window slide with it:
+            // only the right column is converted.
+            if (i>0)
+            {
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+                y[2] = y[3];
+                y[5] = y[6];
+                y[8] = y[9];
+            }
+            else
+            {
+                y[2] = rgb_to_yuv(w[2]);
+                y[5] = rgb_to_yuv(w[5]);
+                y[8] = rgb_to_yuv(w[8]);
+                y[1] = y[2];
+                y[4] = y[5];
+                y[7] = y[8];
+            }
+
+            if (i<Xres-1)
+            {
+                y[3] = rgb_to_yuv(w[3]);
+                y[6] = rgb_to_yuv(w[6]);
+                y[9] = rgb_to_yuv(w[9]);
+            }
+            else
+            {
+                y[3] = y[2];
+                y[6] = y[5];
+                y[9] = y[8];
+            }
+
             int pattern = 0;
             int flag = 1;
 
-            yuv1 = rgb_to_yuv(w[5]);
-
             for (k=1; k<=9; k++)
             {
                 if (k==5) continue;
 
                 if ( w[k] != w[5] )
                 {
-                    yuv2 = rgb_to_yuv(w[k]);
-                    if (yuv_diff(yuv1, yuv2))
+                    if (yuv_diff(y[5], y[k]))
                         pattern |= flag;
                 }
                 flag <<= 1;
@@ -558,7 +592,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -597,7 +631,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL13_10
                         PIXEL20_61
                         PIXEL21_30
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -626,7 +660,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_70
                         PIXEL13_60
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -649,7 +683,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 10:
                 case 138:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -810,7 +844,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -849,7 +883,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_61
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -876,7 +910,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_70
                         PIXEL13_60
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -898,7 +932,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 11:
                 case 139:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -928,7 +962,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 19:
                 case 51:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_81
                             PIXEL01_31
@@ -963,7 +997,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -997,7 +1031,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_60
                         PIXEL02_81
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL03_81
                             PIXEL13_31
@@ -1037,7 +1071,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL13_10
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -1068,7 +1102,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_70
                         PIXEL13_60
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -1093,7 +1127,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 73:
                 case 77:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_82
                             PIXEL10_32
@@ -1126,7 +1160,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 42:
                 case 170:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -1159,7 +1193,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 14:
                 case 142:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -1352,7 +1386,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 26:
                 case 31:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -1364,7 +1398,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_50
                             PIXEL10_50
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -1393,7 +1427,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -1411,7 +1445,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_61
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -1438,7 +1472,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -1452,7 +1486,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL21_0
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -1469,7 +1503,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 74:
                 case 107:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -1486,7 +1520,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_0
                         PIXEL12_30
                         PIXEL13_61
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -1507,7 +1541,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 27:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -1538,7 +1572,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -1576,7 +1610,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_10
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -1602,7 +1636,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_30
                         PIXEL13_61
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -1625,7 +1659,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -1663,7 +1697,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_61
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -1689,7 +1723,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -1710,7 +1744,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 75:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -1979,7 +2013,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 58:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -1993,7 +2027,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -2021,7 +2055,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_81
                         PIXEL01_31
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -2039,7 +2073,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_31
                         PIXEL20_61
                         PIXEL21_30
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -2067,7 +2101,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_31
                         PIXEL13_31
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -2081,7 +2115,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -2099,7 +2133,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 202:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -2117,7 +2151,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL03_80
                         PIXEL12_30
                         PIXEL13_61
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -2139,7 +2173,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 78:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -2157,7 +2191,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL03_82
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -2179,7 +2213,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 154:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -2193,7 +2227,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -2221,7 +2255,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -2239,7 +2273,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -2267,7 +2301,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_32
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -2281,7 +2315,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -2299,7 +2333,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 90:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -2313,7 +2347,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -2327,7 +2361,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL12_0
                             PIXEL13_12
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -2341,7 +2375,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -2360,7 +2394,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 55:
                 case 23:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_81
                             PIXEL01_31
@@ -2395,7 +2429,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -2429,7 +2463,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_20
                         PIXEL01_60
                         PIXEL02_81
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL03_81
                             PIXEL13_31
@@ -2469,7 +2503,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL13_10
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_0
                             PIXEL23_0
@@ -2500,7 +2534,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_70
                         PIXEL13_60
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL21_0
@@ -2525,7 +2559,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 109:
                 case 105:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_82
                             PIXEL10_32
@@ -2558,7 +2592,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 171:
                 case 43:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -2591,7 +2625,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 143:
                 case 15:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -2631,7 +2665,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_31
                         PIXEL13_31
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -2652,7 +2686,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 203:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -2683,7 +2717,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -2721,7 +2755,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_61
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -2741,7 +2775,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -2779,7 +2813,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_10
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -2805,7 +2839,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -2826,7 +2860,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 155:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -3023,7 +3057,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_31
                         PIXEL13_31
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3038,7 +3072,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL31_11
                         }
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -3054,7 +3088,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 158:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3068,7 +3102,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -3093,7 +3127,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 234:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3111,7 +3145,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL03_80
                         PIXEL12_30
                         PIXEL13_61
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -3134,7 +3168,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3153,7 +3187,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_82
                         PIXEL21_32
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -3171,7 +3205,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 59:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -3183,7 +3217,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_50
                             PIXEL10_50
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3218,7 +3252,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_32
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -3231,7 +3265,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL31_50
                         }
                         PIXEL21_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3251,7 +3285,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_81
                         PIXEL01_31
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -3268,7 +3302,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL12_0
                         PIXEL20_61
                         PIXEL21_30
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3288,7 +3322,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 79:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -3305,7 +3339,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_0
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3327,7 +3361,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 122:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3341,7 +3375,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3355,7 +3389,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL12_0
                             PIXEL13_12
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -3368,7 +3402,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL31_50
                         }
                         PIXEL21_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3386,7 +3420,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 94:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3400,7 +3434,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -3413,7 +3447,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL13_50
                         }
                         PIXEL12_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3427,7 +3461,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3445,7 +3479,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 218:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3459,7 +3493,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3473,7 +3507,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL12_0
                             PIXEL13_12
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3488,7 +3522,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL31_11
                         }
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -3504,7 +3538,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 91:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -3516,7 +3550,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_50
                             PIXEL10_50
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3531,7 +3565,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL13_12
                         }
                         PIXEL11_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3545,7 +3579,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3643,7 +3677,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 186:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3657,7 +3691,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_11
                             PIXEL11_0
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3685,7 +3719,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_81
                         PIXEL01_31
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3703,7 +3737,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_31
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3731,7 +3765,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_32
                         PIXEL12_31
                         PIXEL13_31
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3745,7 +3779,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL30_20
                             PIXEL31_11
                         }
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3763,7 +3797,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 206:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3781,7 +3815,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL03_82
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3812,7 +3846,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_32
                         PIXEL12_70
                         PIXEL13_60
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_10
                             PIXEL21_30
@@ -3835,7 +3869,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 174:
                 case 46:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_80
                             PIXEL01_10
@@ -3868,7 +3902,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_81
                         PIXEL01_31
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_10
                             PIXEL03_80
@@ -3907,7 +3941,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL13_31
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_30
                             PIXEL23_10
@@ -3969,7 +4003,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -3984,7 +4018,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_10
                         PIXEL11_30
                         PIXEL12_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4005,7 +4039,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 219:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4025,7 +4059,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_10
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4043,7 +4077,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 125:
                     {
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL00_82
                             PIXEL10_32
@@ -4078,7 +4112,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_82
                         PIXEL01_82
                         PIXEL02_81
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL03_81
                             PIXEL13_31
@@ -4107,7 +4141,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 207:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4147,7 +4181,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL21_0
@@ -4173,7 +4207,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4203,7 +4237,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 187:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4245,7 +4279,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL13_10
                         PIXEL20_82
                         PIXEL21_32
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL22_0
                             PIXEL23_0
@@ -4267,7 +4301,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 119:
                     {
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL00_81
                             PIXEL01_31
@@ -4312,7 +4346,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL21_0
                         PIXEL22_31
                         PIXEL23_81
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -4328,7 +4362,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                 case 175:
                 case 47:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -4359,7 +4393,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_81
                         PIXEL01_31
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -4399,7 +4433,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL30_82
                         PIXEL31_32
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -4419,7 +4453,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4433,7 +4467,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL21_0
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4449,7 +4483,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 123:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4466,7 +4500,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_0
                         PIXEL12_30
                         PIXEL13_10
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4487,7 +4521,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 95:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4499,7 +4533,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL01_50
                             PIXEL10_50
                         }
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4527,7 +4561,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4545,7 +4579,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_10
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4571,7 +4605,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_30
                         PIXEL12_31
                         PIXEL13_31
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4587,7 +4621,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL22_0
                         PIXEL23_0
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -4610,7 +4644,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_0
                         PIXEL21_0
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4622,7 +4656,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL32_50
                             PIXEL33_50
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -4635,7 +4669,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 235:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4656,7 +4690,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL21_0
                         PIXEL22_31
                         PIXEL23_81
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -4671,7 +4705,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 111:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -4686,7 +4720,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL11_0
                         PIXEL12_32
                         PIXEL13_82
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4707,7 +4741,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 63:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -4716,7 +4750,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4743,7 +4777,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 159:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4756,7 +4790,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_50
                         }
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -4782,7 +4816,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_81
                         PIXEL01_31
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -4797,7 +4831,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_61
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4817,7 +4851,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4839,7 +4873,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL30_82
                         PIXEL31_32
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -4853,7 +4887,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     {
                         PIXEL00_80
                         PIXEL01_10
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -4868,7 +4902,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_10
                         PIXEL11_30
                         PIXEL12_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -4884,7 +4918,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL22_0
                         PIXEL23_0
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -4908,7 +4942,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL21_0
                         PIXEL22_0
                         PIXEL23_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -4918,7 +4952,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL31_0
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -4930,7 +4964,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 251:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -4950,7 +4984,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_0
                         PIXEL21_0
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -4962,7 +4996,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL32_50
                             PIXEL33_50
                         }
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -4975,7 +5009,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 239:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -4994,7 +5028,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL21_0
                         PIXEL22_31
                         PIXEL23_81
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -5009,7 +5043,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 127:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -5018,7 +5052,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL00_20
                         }
                         PIXEL01_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL02_0
                             PIXEL03_0
@@ -5033,7 +5067,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL10_0
                         PIXEL11_0
                         PIXEL12_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL20_0
                             PIXEL30_0
@@ -5054,7 +5088,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 191:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -5064,7 +5098,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL01_0
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -5088,7 +5122,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 223:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                             PIXEL01_0
@@ -5101,7 +5135,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                             PIXEL10_50
                         }
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -5115,7 +5149,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL20_10
                         PIXEL21_30
                         PIXEL22_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL23_0
                             PIXEL32_0
@@ -5136,7 +5170,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL00_81
                         PIXEL01_31
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -5155,7 +5189,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL30_82
                         PIXEL31_32
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -5167,7 +5201,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                     }
                 case 255:
                     {
-                        if (Diff(w[4], w[2]))
+                        if (yuv_diff(y[4], y[2]))
                         {
                             PIXEL00_0
                         }
@@ -5177,7 +5211,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL01_0
                         PIXEL02_0
-                        if (Diff(w[2], w[6]))
+                        if (yuv_diff(y[2], y[6]))
                         {
                             PIXEL03_0
                         }
@@ -5193,7 +5227,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         PIXEL21_0
                         PIXEL22_0
                         PIXEL23_0
-                        if (Diff(w[8], w[4]))
+                        if (yuv_diff(y[8], y[4]))
                         {
                             PIXEL30_0
                         }
@@ -5203,7 +5237,7 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
                         }
                         PIXEL31_0
                         PIXEL32_0
-                        if (Diff(w[6], w[8]))
+                        if (yuv_diff(y[6], y[8]))
                         {
                             PIXEL33_0
                         }
@@ -5226,6 +5260,11 @@ HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     }
 }
 
+HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+{
+    hq4x_32_rb_rows(sp, srb, dp, drb, Xres, Yres, 0, Yres);
+}
+
 HQX_API void HQX_CALLCONV hq4x_32( uint32_t * sp, uint32_t * dp, int Xres, int Yres )
 {
     uint32_t rowBytesL = Xres * 4;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BENCHMARK_H
+#define SOLARUS_BENCHMARK_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Arguments.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Measures small pieces of code and reports the results in JSON.
+ *
+ * Each benchmark is a function that runs its code a given number of times.
+ * The number of iterations is increased until the run lasts at least
+ * a minimum time, like Google Benchmark does.
+ * Results are printed on stderr, and can be saved in the JSON format of
+ * Google Benchmark so that the same comparison tools can be used.
+ *
+ * Supported command-line options:
+ *   -benchmark-filter=<text>   only runs benchmarks whose name contains text
+ *   -benchmark-min-time=<ms>   minimum duration of each benchmark (default 200)
+ *   -benchmark-out=<file>      writes the results to a JSON file
+ *
+ * Benchmarks can also report counters, like draw calls per iteration.
+ * They are saved as user counters of Google Benchmark.
+ */
+class Benchmark {
+
+  public:
+
+    /**
+     * \brief Result of one benchmark.
+     */
+    struct Result {
+      std::string name;           /**< Name of the benchmark. */
+      uint64_t iterations;        /**< Number of iterations of the last run. */
+      double real_time;           /**< Wall clock time per iteration (nanoseconds). */
+      double cpu_time;            /**< Processor time per iteration (nanoseconds). */
+      std::map<std::string, double>
+          counters;               /**< Counters reported by the benchmark. */
+    };
+
+    explicit Benchmark(const Arguments& args);
+
+    bool run(const std::string& name, const std::function<void (uint64_t)>& function);
+    void set_counter(const std::string& name, double value);
+
+    const std::vector<Result>& get_results() const;
+    bool save_results() const;
+
+    /**
+     * \brief Prevents the compiler from optimizing away a computed value.
+     * \param value The value.
+     */
+    template<typename T>
+    static void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "r,m"(value) : "memory");
+#else
+      static volatile const T* sink = nullptr;
+      sink = &value;
+#endif
+    }
+
+  private:
+
+    std::string program_name;     /**< Name of the executable. */
+    std::string filter;           /**< Part of the names of benchmarks to run. */
+    double min_time;              /**< Minimum duration of a run (milliseconds). */
+    std::string output_file_name; /**< JSON file to write, or empty for stdout. */
+    std::vector<Result> results;  /**< Results of benchmarks already run. */
+
+};
+
+}
+
+#endif
+
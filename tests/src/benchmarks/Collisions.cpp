@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/PixelBits.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/CustomEntity.h"
+#include "solarus/entities/Hero.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/movements/PathFinding.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <random>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates the collision mask of a random blob of pixels.
+ */
+PixelBits create_pixel_bits(int size, unsigned seed) {
+
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::string pixels(size * size * 4, '\0');
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      const int dx = x - size / 2;
+      const int dy = y - size / 2;
+      if (dx * dx + dy * dy < size * size / 4 && percent(random) < 90) {
+        pixels[(y * size + x) * 4 + 3] = static_cast<char>(0xFF);
+      }
+    }
+  }
+
+  SurfacePtr surface = Surface::create(size, size);
+  surface->set_pixels(pixels);
+  return PixelBits(*surface, Rectangle(0, 0, size, size));
+}
+
+/**
+ * \brief Measures pixel-precise collisions of images of a size.
+ */
+void benchmark_pixel_bits(Benchmark& benchmark, int size) {
+
+  const PixelBits bits1 = create_pixel_bits(size, 1);
+  const PixelBits bits2 = create_pixel_bits(size, 2);
+
+  benchmark.run("PixelBits/test_collision/" + std::to_string(size), [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      // Overlaps from a corner to almost all the image.
+      const int offset = size - 1 - static_cast<int>(i % size);
+      Benchmark::do_not_optimize(
+          bits1.test_collision(bits2, Point(0, 0), Point(offset, offset)));
+    }
+  });
+}
+
+/**
+ * \brief Measures path finding from a custom entity to the hero.
+ */
+void benchmark_path_finding(Benchmark& benchmark, TestEnvironment& env) {
+
+  CustomEntity& entity = *env.make_entity<CustomEntity>();
+  Hero& hero = env.get_hero();
+
+  entity.set_top_left_xy(144, 104);
+  entity.notify_position_changed();
+  hero.set_top_left_xy(200, 144);
+  hero.notify_position_changed();
+
+  benchmark.run("PathFinding/compute_path", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      PathFinding path_finding(env.get_map(), entity, hero);
+      Benchmark::do_not_optimize(path_finding.compute_path());
+    }
+  });
+}
+
+}
+
+/**
+ * \brief Benchmarks of collision detection and path finding.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env.get_arguments());
+
+  for (int size: { 16, 64, 128 }) {
+    benchmark_pixel_bits(benchmark, size);
+  }
+  benchmark_path_finding(benchmark, env);
+
+  return benchmark.save_results() ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/Grid.h"
+#include "solarus/containers/Quadtree.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+const Rectangle space(0, 0, 4096, 4096);
+
+/**
+ * \brief Creates bounding boxes of entities randomly placed in the space.
+ */
+std::vector<Rectangle> create_boxes(int num_boxes) {
+
+  std::mt19937 random(num_boxes);
+  std::uniform_int_distribution<int> coordinate(0, space.get_width() - 32);
+  std::uniform_int_distribution<int> size(8, 32);
+  std::vector<Rectangle> boxes;
+  for (int i = 0; i < num_boxes; ++i) {
+    boxes.emplace_back(coordinate(random), coordinate(random), size(random), size(random));
+  }
+  return boxes;
+}
+
+/**
+ * \brief Returns a screen-sized region that changes with the iteration.
+ */
+Rectangle get_query_region(uint64_t iteration) {
+
+  const int x = static_cast<int>((iteration * 197) % (space.get_width() - 320));
+  const int y = static_cast<int>((iteration * 131) % (space.get_height() - 240));
+  return Rectangle(x, y, 320, 240);
+}
+
+/**
+ * \brief Measures quadtree operations with a number of elements.
+ */
+void benchmark_quadtree(Benchmark& benchmark, int num_elements) {
+
+  const std::vector<Rectangle> boxes = create_boxes(num_elements);
+  const std::string suffix = "/" + std::to_string(num_elements);
+
+  benchmark.run("Quadtree/add" + suffix, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      Quadtree<int> quadtree(space);
+      for (int j = 0; j < num_elements; ++j) {
+        quadtree.add(j, boxes[j]);
+      }
+      Benchmark::do_not_optimize(quadtree.get_num_elements());
+    }
+  });
+
+  Quadtree<int> quadtree(space);
+  for (int j = 0; j < num_elements; ++j) {
+    quadtree.add(j, boxes[j]);
+  }
+
+  benchmark.run("Quadtree/move" + suffix, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      const int element = static_cast<int>(i % num_elements);
+      Rectangle box = boxes[element];
+      box.add_xy((i / num_elements) % 2 == 0 ? 1 : 0, 0);
+      quadtree.move(element, box);
+    }
+  });
+
+  std::vector<int> result;
+  benchmark.run("Quadtree/get_elements" + suffix, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      result.clear();
+      quadtree.get_elements(get_query_region(i), result);
+      Benchmark::do_not_optimize(result.size());
+    }
+  });
+}
+
+/**
+ * \brief Measures grid queries with a number of elements.
+ */
+void benchmark_grid(Benchmark& benchmark, int num_elements) {
+
+  const std::vector<Rectangle> boxes = create_boxes(num_elements);
+  Grid<int> grid(space.get_size(), Size(64, 64));
+  for (int j = 0; j < num_elements; ++j) {
+    grid.add(j, boxes[j]);
+  }
+
+  std::vector<int> result;
+  benchmark.run("Grid/get_elements/" + std::to_string(num_elements), [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      result.clear();
+      grid.get_elements(get_query_region(i), result);
+      Benchmark::do_not_optimize(result.size());
+    }
+  });
+}
+
+}
+
+/**
+ * \brief Benchmarks of spatial containers.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env.get_arguments());
+
+  for (int num_elements: { 100, 1000, 10000 }) {
+    benchmark_quadtree(benchmark, num_elements);
+    benchmark_grid(benchmark, num_elements);
+  }
+
+  return benchmark.save_results() ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteData.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Measures parsing a data file of the testing quest.
+ * \tparam T Type of data to import.
+ */
+template<typename T>
+void benchmark_import(Benchmark& benchmark, const std::string& name, const std::string& file_name) {
+
+  const std::string buffer = QuestFiles::data_file_read(file_name);
+  Debug::check_assertion(!buffer.empty(), "Missing data file: '" + file_name + "'");
+
+  benchmark.run(name + "/" + file_name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      T data;
+      Benchmark::do_not_optimize(data.import_from_buffer(buffer, file_name));
+    }
+  });
+}
+
+/**
+ * \brief Measures loading a binary map file.
+ */
+void benchmark_binary_map(Benchmark& benchmark, const std::string& file_name) {
+
+  const std::string source_buffer = QuestFiles::data_file_read(file_name);
+  MapData map_data;
+  Debug::check_assertion(map_data.import_from_buffer(source_buffer, file_name),
+      "Failed to import map: '" + file_name + "'");
+  std::string binary_buffer;
+  map_data.export_to_binary_buffer(binary_buffer, MapData::compute_source_hash(source_buffer));
+
+  benchmark.run("MapData/import_from_binary_buffer/" + file_name, [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      MapData data;
+      Benchmark::do_not_optimize(data.import_from_binary_buffer(binary_buffer, file_name));
+    }
+  });
+}
+
+}
+
+/**
+ * \brief Benchmarks of data file parsing.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env.get_arguments());
+
+  benchmark_import<MapData>(benchmark, "MapData/import_from_buffer", "maps/all_entities.dat");
+  benchmark_import<MapData>(benchmark, "MapData/import_from_buffer", "maps/bugs/486_diagonal_dynamic_tiles.dat");
+  benchmark_binary_map(benchmark, "maps/bugs/486_diagonal_dynamic_tiles.dat");
+  benchmark_import<SpriteData>(benchmark, "SpriteData/import_from_buffer", "sprites/hero/tunic1.dat");
+  benchmark_import<TilesetData>(benchmark, "TilesetData/import_from_buffer", "tilesets/castle.dat");
+
+  return benchmark.save_results() ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/LuaTools.h"
+#include "solarus/lua/ScopedLuaRef.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <lua.hpp>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Measures the cost of calling Lua functions from the engine.
+ *
+ * Events of entities, menus and timers all go through
+ * LuaTools::call_function().
+ */
+void benchmark_calls(Benchmark& benchmark, lua_State* l) {
+
+  LuaTools::do_string(l, "function identity(value) return value end", "benchmark");
+  lua_getglobal(l, "identity");
+  const ScopedLuaRef function_ref = LuaTools::create_ref(l);
+
+  benchmark.run("LuaCalls/lua_pcall", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      function_ref.push();
+      lua_pushinteger(l, static_cast<lua_Integer>(i));
+      lua_pcall(l, 1, 1, 0);
+      Benchmark::do_not_optimize(lua_tointeger(l, -1));
+      lua_pop(l, 1);
+    }
+  });
+
+  benchmark.run("LuaCalls/call_function", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      function_ref.push();
+      lua_pushinteger(l, static_cast<lua_Integer>(i));
+      LuaTools::call_function(l, 1, 1, "identity");
+      Benchmark::do_not_optimize(lua_tointeger(l, -1));
+      lua_pop(l, 1);
+    }
+  });
+}
+
+/**
+ * \brief Measures the creation and release of refs to callbacks.
+ */
+void benchmark_refs(Benchmark& benchmark, lua_State* l) {
+
+  benchmark.run("LuaCalls/create_ref", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      lua_pushboolean(l, 1);
+      ScopedLuaRef ref = LuaTools::create_ref(l);
+      Benchmark::do_not_optimize(ref.get());
+    }
+  });
+}
+
+}
+
+/**
+ * \brief Benchmarks of calls between the engine and Lua.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env.get_arguments());
+
+  lua_State* l = luaL_newstate();
+  luaL_openlibs(l);
+  benchmark_calls(benchmark, l);
+  benchmark_refs(benchmark, l);
+  const bool success = benchmark.save_results();
+  lua_close(l);
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Logger.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/core/WorldStateHash.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/RenderTexture.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/ShaderContext.h"
+#include "solarus/graphics/SoftwarePixelFilter.h"
+#include "solarus/graphics/SoftwareVideoMode.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/SpriteBatch.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/TextSurface.h"
+#include "solarus/graphics/TransitionFade.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/lua/ScopedLuaRef.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Draws one frame of a scene and returns the surface to show.
+ */
+using FrameFunction = std::function<SurfacePtr ()>;
+
+/**
+ * \brief A scripted scene to render.
+ *
+ * Starting the scene creates its drawables, so that each run of a scene
+ * gives the same frames.
+ */
+struct Scene {
+  std::string name;                        /**< Name of the scene, like "sprites". */
+  std::function<FrameFunction ()> start;   /**< Creates the scene. */
+};
+
+/**
+ * \brief Draws scrolling 16x16 tiles that cover a surface.
+ */
+void draw_tiles(const SurfacePtr& tiles, const SurfacePtr& dst_surface, int frame) {
+
+  const int num_tiles = (tiles->get_width() / 16) * (tiles->get_height() / 16);
+  const int num_columns = tiles->get_width() / 16;
+  const int shift = frame % 16;
+  const int scroll = frame / 16;
+  for (int row = 0; row * 16 - shift < dst_surface->get_height(); ++row) {
+    for (int column = 0; column * 16 - shift < dst_surface->get_width(); ++column) {
+      const int x = column * 16 - shift;
+      const int y = row * 16 - shift;
+      const int tile = ((column + scroll) * 7 + (row + scroll) * 13) % num_tiles;
+      const Rectangle region((tile % num_columns) * 16, (tile / num_columns) * 16, 16, 16);
+      tiles->draw_region(region, dst_surface, Point(x, y));
+    }
+  }
+}
+
+/**
+ * \brief Creates the scenes to render.
+ * \param thread_pool Threads of software pixel filters.
+ * \return The scenes.
+ */
+std::vector<Scene> create_scenes(ThreadPool& thread_pool) {
+
+  const Size quest_size = Video::get_quest_size();
+  const SurfacePtr tiles = Surface::create("tilesets/overworld.tiles.png", Surface::DIR_DATA);
+  std::vector<Scene> scenes;
+
+  scenes.push_back({ "tiles", [=]() {
+    const SurfacePtr dst_surface = Surface::create(quest_size);
+    auto frame = std::make_shared<int>(0);
+    return [=]() {
+      dst_surface->clear();
+      draw_tiles(tiles, dst_surface, (*frame)++);
+      return dst_surface;
+    };
+  }});
+
+  scenes.push_back({ "sprites", [=]() {
+    const SurfacePtr dst_surface = Surface::create(quest_size);
+    std::vector<SpritePtr> sprites;
+    for (int i = 0; i < 200; ++i) {
+      SpritePtr sprite = std::make_shared<Sprite>(
+          i % 2 == 0 ? "main_heroes/eldran" : "enemies/slime_green");
+      sprite->set_current_animation("walking");
+      sprite->set_current_direction(i % sprite->get_nb_directions());
+      sprites.push_back(sprite);
+    }
+    auto frame = std::make_shared<int>(0);
+    return [=]() {
+      dst_surface->clear();
+      draw_tiles(tiles, dst_surface, 0);
+      for (size_t i = 0; i < sprites.size(); ++i) {
+        const int x = static_cast<int>(i * 37 + *frame) % quest_size.width;
+        const int y = static_cast<int>(i * 53) % quest_size.height;
+        sprites[i]->update();
+        sprites[i]->draw(dst_surface, x, y);
+      }
+      ++*frame;
+      return dst_surface;
+    };
+  }});
+
+  scenes.push_back({ "text", [=]() {
+    const SurfacePtr dst_surface = Surface::create(quest_size);
+    std::vector<std::shared_ptr<TextSurface>> lines;
+    for (int i = 0; i < 15; ++i) {
+      std::shared_ptr<TextSurface> line = std::make_shared<TextSurface>(
+          4,
+          i * 16,
+          TextSurface::HorizontalAlignment::LEFT,
+          TextSurface::VerticalAlignment::TOP
+      );
+      line->set_font(i % 2 == 0 ? "minecraftia" : "8_bit");
+      lines.push_back(line);
+    }
+    auto frame = std::make_shared<int>(0);
+    return [=]() {
+      dst_surface->fill_with_color(Color(32, 32, 64));
+      for (size_t i = 0; i < lines.size(); ++i) {
+        std::ostringstream oss;
+        oss << "Line " << i << ", frame " << *frame << ": The quick brown fox";
+        lines[i]->set_text(oss.str());
+        lines[i]->draw(dst_surface);
+      }
+      ++*frame;
+      return dst_surface;
+    };
+  }});
+
+  scenes.push_back({ "transition", [=]() {
+    const SurfacePtr dst_surface = Surface::create(quest_size);
+    const SurfacePtr layer = Surface::create(quest_size);
+    auto frame = std::make_shared<int>(0);
+    return [=]() {
+      layer->update();
+      if (layer->get_transition() == nullptr) {
+        // Fade out and in again and again.
+        layer->start_transition(std::unique_ptr<Transition>(new TransitionFade(
+            *frame % 2 == 0 ? Transition::Direction::CLOSING : Transition::Direction::OPENING
+        )), ScopedLuaRef());
+      }
+      dst_surface->fill_with_color(Color::black);
+      layer->clear();
+      draw_tiles(tiles, layer, (*frame)++);
+      layer->draw(dst_surface);
+      return dst_surface;
+    };
+  }});
+
+  // Software filters of video modes, like the screen rendering does.
+  for (const SoftwareVideoMode* video_mode: Video::get_video_modes()) {
+    const SoftwarePixelFilter* software_filter = video_mode->get_software_filter();
+    if (software_filter == nullptr) {
+      continue;
+    }
+    scenes.push_back({ "video_mode/" + video_mode->get_name(), [=, &thread_pool]() {
+      const SurfacePtr quest_surface = Surface::create(quest_size);
+      const SurfacePtr scaled_surface = Surface::create(
+          quest_size * software_filter->get_scaling_factor());
+      scaled_surface->fill_with_color(Color::black);  // To initialize the internal surface.
+      auto frame = std::make_shared<int>(0);
+      return [=, &thread_pool]() {
+        quest_surface->clear();
+        draw_tiles(tiles, quest_surface, (*frame)++);
+        quest_surface->apply_pixel_filter(*software_filter, *scaled_surface, &thread_pool);
+        return scaled_surface;
+      };
+    }});
+  }
+
+  // The same scaling done by the shaders of video modes.
+  // Shaders need OpenGL, so they are skipped with -no-video.
+  if (Video::are_shaders_enabled()) {
+    for (const SoftwareVideoMode* video_mode: Video::get_video_modes()) {
+      if (video_mode->get_shader_source().empty()) {
+        continue;
+      }
+      const ShaderPtr shader = ShaderContext::create_built_in_shader(
+          video_mode->get_name(), video_mode->get_shader_source());
+      if (!shader->is_valid()) {
+        Logger::warning("Skipping invalid shader '" + video_mode->get_name() + "'");
+        continue;
+      }
+      scenes.push_back({ "shader/" + video_mode->get_name(), [=]() {
+        const SurfacePtr dst_surface = Surface::create(quest_size);
+        const SurfacePtr layer = Surface::create(quest_size);
+        layer->set_shader(shader);
+        auto frame = std::make_shared<int>(0);
+        return [=]() {
+          layer->clear();
+          draw_tiles(tiles, layer, (*frame)++);
+          dst_surface->clear();
+          layer->draw(dst_surface);
+          return dst_surface;
+        };
+      }});
+    }
+  }
+
+  return scenes;
+}
+
+/**
+ * \brief Counts of rendering work since the previous call.
+ */
+struct RenderCounters {
+  int num_draw_calls;              /**< Draw calls done. */
+  int num_texture_binds;           /**< Source textures bound. */
+  int num_readbacks;               /**< Pixel transfers from render textures. */
+};
+
+/**
+ * \brief Returns the rendering work done since the previous call and
+ * resets the counts.
+ * \return The counts.
+ */
+RenderCounters take_render_counters() {
+
+  SpriteBatch::flush();
+  RenderCounters counters;
+  counters.num_draw_calls = SpriteBatch::take_num_draw_calls();
+  counters.num_texture_binds = SpriteBatch::take_num_texture_binds();
+  counters.num_readbacks = RenderTexture::take_readback_statistics().num_readbacks;
+  return counters;
+}
+
+/**
+ * \brief Renders frames of a scene and hashes their pixels.
+ *
+ * Simulated time advances by one step at each frame like in the main loop.
+ *
+ * \param env The test environment.
+ * \param scene The scene to render from its start.
+ * \param num_frames Number of frames to render.
+ * \return Hash of the pixels of all frames.
+ */
+uint64_t hash_frames(TestEnvironment& env, const Scene& scene, int num_frames) {
+
+  const FrameFunction draw_frame = scene.start();
+  uint64_t hash = WorldStateHash::initial_hash;
+  for (int i = 0; i < num_frames; ++i) {
+    env.step();
+    const SurfacePtr frame_surface = draw_frame();
+    hash = WorldStateHash::combine(hash, frame_surface->get_pixels());
+  }
+  take_render_counters();
+  return hash;
+}
+
+/**
+ * \brief Measures rendering frames of a scene.
+ *
+ * Reports the draw calls, texture binds and readbacks per frame
+ * as counters of the benchmark.
+ *
+ * \param benchmark The benchmark suite.
+ * \param env The test environment.
+ * \param scene The scene to render.
+ */
+void benchmark_scene(Benchmark& benchmark, TestEnvironment& env, const Scene& scene) {
+
+  RenderCounters counters = { 0, 0, 0 };
+  double num_frames = 1.0;
+  const bool done = benchmark.run("Rendering/" + scene.name, [&](uint64_t iterations) {
+    const FrameFunction draw_frame = scene.start();
+    take_render_counters();
+    for (uint64_t i = 0; i < iterations; ++i) {
+      env.step();
+      draw_frame();
+    }
+    counters = take_render_counters();
+    num_frames = static_cast<double>(iterations);
+  });
+  if (!done) {
+    return;
+  }
+
+  const double frame_time = benchmark.get_results().back().real_time;
+  benchmark.set_counter("frames_per_second", frame_time > 0.0 ? 1000000000.0 / frame_time : 0.0);
+  benchmark.set_counter("draw_calls", counters.num_draw_calls / num_frames);
+  benchmark.set_counter("texture_binds", counters.num_texture_binds / num_frames);
+  benchmark.set_counter("readbacks", counters.num_readbacks / num_frames);
+}
+
+/**
+ * \brief Loads golden frame hashes from a file.
+ * \param file_name The file to read.
+ * \param[out] hashes The hash of each scene.
+ * \return \c true in case of success.
+ */
+bool load_golden_frames(const std::string& file_name, std::map<std::string, uint64_t>& hashes) {
+
+  std::ifstream in(file_name.c_str());
+  if (!in) {
+    Logger::error("Cannot read golden frames '" + file_name + "'");
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream iss(line);
+    std::string name;
+    uint64_t hash = 0;
+    if (!(iss >> name)) {
+      continue;  // Empty line.
+    }
+    if (!(iss >> std::hex >> hash)) {
+      Logger::error("Invalid line in golden frames '" + file_name + "': '" + line + "'");
+      return false;
+    }
+    hashes[name] = hash;
+  }
+  return true;
+}
+
+/**
+ * \brief Saves golden frame hashes to a file.
+ * \param file_name The file to write.
+ * \param hashes The hash of each scene.
+ * \return \c true in case of success.
+ */
+bool save_golden_frames(const std::string& file_name, const std::map<std::string, uint64_t>& hashes) {
+
+  std::ofstream out(file_name.c_str());
+  for (const auto& kvp: hashes) {
+    out << kvp.first << " " << std::hex << kvp.second << std::dec << std::endl;
+  }
+  if (!out) {
+    Logger::error("Cannot write golden frames '" + file_name + "'");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Checks the frames of each scene against golden frames.
+ *
+ * Scenes missing from the golden file are added to it,
+ * so the first run on a machine creates it.
+ *
+ * \param env The test environment.
+ * \param scenes The scenes.
+ * \param num_frames Number of frames to hash per scene.
+ * \param file_name The golden file.
+ * \param update \c true to replace all golden hashes.
+ * \return \c true if no scene changed its pixels.
+ */
+bool check_golden_frames(
+    TestEnvironment& env,
+    const std::vector<Scene>& scenes,
+    int num_frames,
+    const std::string& file_name,
+    bool update
+) {
+  std::map<std::string, uint64_t> golden_hashes;
+  const bool golden_exists = std::ifstream(file_name.c_str()).good();
+  if (golden_exists && !update && !load_golden_frames(file_name, golden_hashes)) {
+    return false;
+  }
+
+  bool success = true;
+  bool modified = false;
+  for (const Scene& scene: scenes) {
+    const uint64_t hash = hash_frames(env, scene, num_frames);
+    const auto it = golden_hashes.find(scene.name);
+    if (it == golden_hashes.end()) {
+      golden_hashes[scene.name] = hash;
+      modified = true;
+    }
+    else if (it->second != hash) {
+      std::cerr << "Frames of scene '" << scene.name << "' differ from the golden ones" << std::endl;
+      success = false;
+    }
+  }
+
+  if (success && modified) {
+    std::cerr << "Saving golden frames '" << file_name << "'" << std::endl;
+    return save_golden_frames(file_name, golden_hashes);
+  }
+  return success;
+}
+
+}
+
+/**
+ * \brief Benchmarks of rendering scripted scenes.
+ *
+ * Tiles, many sprites, texts, transitions, software filters of video modes
+ * and their shaders are rendered offscreen.
+ * With -no-video, this uses the SDL software renderer.
+ *
+ * Additional command-line options:
+ *   -render-frames=<n>         frames hashed per scene (default 60)
+ *   -golden-frames=<file>      compares the hashes of frames to this file
+ *   -update-golden-frames      replaces the hashes of the golden file
+ *
+ * Frames are hashed before measuring, so that readbacks are not measured
+ * and optimizations can be checked to give the same pixels.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  const Arguments& args = env.get_arguments();
+  Benchmark benchmark(args);
+
+  int num_frames = 60;
+  const std::string& num_frames_arg = args.get_argument_value("-render-frames");
+  if (!num_frames_arg.empty()) {
+    std::istringstream iss(num_frames_arg);
+    if (!(iss >> num_frames) || num_frames <= 0) {
+      std::cerr << "Invalid value for -render-frames: '" << num_frames_arg << "'" << std::endl;
+      return 1;
+    }
+  }
+
+  const std::vector<Scene> scenes = create_scenes(env.get_main_loop().get_thread_pool());
+
+  const std::string& golden_file_name = args.get_argument_value("-golden-frames");
+  if (!golden_file_name.empty() &&
+      !check_golden_frames(env, scenes, num_frames, golden_file_name,
+          args.has_argument("-update-golden-frames"))) {
+    return 1;
+  }
+
+  for (const Scene& scene: scenes) {
+    benchmark_scene(benchmark, env, scene);
+  }
+
+  return benchmark.save_results() ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/Surface.h"
+#include "test_tools/Benchmark.h"
+#include "test_tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Measures drawing a whole surface of a size onto a screen-sized one.
+ */
+void benchmark_draw(Benchmark& benchmark, const SurfacePtr& dst_surface, int size) {
+
+  SurfacePtr src_surface = Surface::create(size, size);
+  src_surface->fill_with_color(Color(255, 128, 0, 255));
+
+  benchmark.run("Surface/draw/" + std::to_string(size), [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      const int x = static_cast<int>(i * 7 % (dst_surface->get_width() - size + 1));
+      const int y = static_cast<int>(i * 3 % (dst_surface->get_height() - size + 1));
+      src_surface->draw(dst_surface, Point(x, y));
+    }
+  });
+}
+
+/**
+ * \brief Measures drawing 16x16 regions of a tileset image, like tiles.
+ */
+void benchmark_draw_region(Benchmark& benchmark, const SurfacePtr& dst_surface) {
+
+  SurfacePtr tiles = Surface::create("tilesets/castle.tiles.png", Surface::DIR_DATA);
+  const int num_columns = tiles->get_width() / 16;
+  const int num_rows = tiles->get_height() / 16;
+
+  benchmark.run("Surface/draw_region/16", [&](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      const int tile = static_cast<int>(i % (num_columns * num_rows));
+      const Rectangle region((tile % num_columns) * 16, (tile / num_columns) * 16, 16, 16);
+      const int x = static_cast<int>(i * 16 % dst_surface->get_width());
+      const int y = static_cast<int>(i / 20 * 16 % dst_surface->get_height());
+      tiles->draw_region(region, dst_surface, Point(x, y));
+    }
+  });
+}
+
+}
+
+/**
+ * \brief Benchmarks of surface drawing.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env.get_arguments());
+
+  SurfacePtr dst_surface = Surface::create(320, 240);
+  for (int size: { 16, 64, 320 }) {
+    benchmark_draw(benchmark, dst_surface, size);
+  }
+  benchmark_draw_region(benchmark, dst_surface);
+
+  return benchmark.save_results() ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/FrameTimings.h"
+#include "solarus/core/Logger.h"
+#include "test_tools/Benchmark.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Escapes a string for JSON.
+ * \param value The string to escape.
+ * \return The string between double quotes.
+ */
+std::string to_json(const std::string& value) {
+
+  std::ostringstream oss;
+  oss << '"';
+  for (char c: value) {
+    if (c == '"' || c == '\\') {
+      oss << '\\' << c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      oss << ' ';
+    }
+    else {
+      oss << c;
+    }
+  }
+  oss << '"';
+  return oss.str();
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a benchmark suite.
+ * \param args Command-line arguments with the benchmark options.
+ */
+Benchmark::Benchmark(const Arguments& args):
+  program_name(args.get_program_name()),
+  filter(args.get_argument_value("-benchmark-filter")),
+  min_time(200.0),
+  output_file_name(args.get_argument_value("-benchmark-out")),
+  results() {
+
+  const std::string& min_time_arg = args.get_argument_value("-benchmark-min-time");
+  if (!min_time_arg.empty()) {
+    std::istringstream iss(min_time_arg);
+    double value = 0.0;
+    if (iss >> value && value >= 0.0) {
+      min_time = value;
+    }
+  }
+}
+
+/**
+ * \brief Measures a benchmark unless it is filtered out.
+ * \param name Name of the benchmark, like "Quadtree/get_elements/1000".
+ * \param function Function that runs the measured code the number of times
+ * given as parameter.
+ * \return \c false if the benchmark was filtered out.
+ */
+bool Benchmark::run(
+    const std::string& name,
+    const std::function<void (uint64_t)>& function
+) {
+  if (!filter.empty() && name.find(filter) == std::string::npos) {
+    return false;
+  }
+
+  uint64_t iterations = 1;
+  double real_time = 0.0;
+  double cpu_time = 0.0;
+  while (true) {
+    const double start_time = FrameTimings::get_time();
+    const std::clock_t start_clock = std::clock();
+    function(iterations);
+    real_time = FrameTimings::get_time() - start_time;
+    cpu_time = static_cast<double>(std::clock() - start_clock) * 1000.0 / CLOCKS_PER_SEC;
+
+    if (real_time >= min_time || iterations >= 1000000000) {
+      break;
+    }
+
+    // Guess the number of iterations needed, with some margin.
+    const double ratio = min_time * 1.4 / std::max(real_time, 0.001);
+    iterations = std::max(iterations + 1, static_cast<uint64_t>(
+        iterations * std::min(ratio, 100.0)));
+  }
+
+  Result result;
+  result.name = name;
+  result.iterations = iterations;
+  result.real_time = real_time * 1000000.0 / iterations;
+  result.cpu_time = cpu_time * 1000000.0 / iterations;
+  results.push_back(result);
+
+  std::cerr << name << ": " << result.real_time << " ns ("
+            << iterations << " iterations)" << std::endl;
+  return true;
+}
+
+/**
+ * \brief Sets a counter of the last benchmark run.
+ *
+ * Counters are measured by the benchmark itself, usually per iteration
+ * of its last run.
+ *
+ * \param name Name of the counter, like "draw_calls".
+ * \param value Value of the counter.
+ */
+void Benchmark::set_counter(const std::string& name, double value) {
+
+  if (results.empty()) {
+    return;
+  }
+
+  results.back().counters[name] = value;
+  std::cerr << "  " << name << ": " << value << std::endl;
+}
+
+/**
+ * \brief Returns the results of all benchmarks run so far.
+ * \return The results.
+ */
+const std::vector<Benchmark::Result>& Benchmark::get_results() const {
+  return results;
+}
+
+/**
+ * \brief Writes the results in the JSON format of Google Benchmark.
+ *
+ * They go to the file of the -benchmark-out option.
+ * Without this option, results are only printed on stderr while running.
+ *
+ * \return \c true in case of success.
+ */
+bool Benchmark::save_results() const {
+
+  if (output_file_name.empty()) {
+    return true;
+  }
+
+  std::ostringstream json;
+  json << "{" << std::endl
+       << "  \"context\": {" << std::endl
+       << "    \"executable\": " << to_json(program_name) << "," << std::endl
+       << "    \"library_build_type\": "
+#ifdef NDEBUG
+       << "\"release\""
+#else
+       << "\"debug\""
+#endif
+       << std::endl
+       << "  }," << std::endl
+       << "  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    json << (i == 0 ? "" : ",") << std::endl
+         << "    {" << std::endl
+         << "      \"name\": " << to_json(result.name) << "," << std::endl
+         << "      \"run_type\": \"iteration\"," << std::endl
+         << "      \"iterations\": " << result.iterations << "," << std::endl
+         << "      \"real_time\": " << result.real_time << "," << std::endl
+         << "      \"cpu_time\": " << result.cpu_time << "," << std::endl;
+    for (const auto& kvp: result.counters) {
+      json << "      " << to_json(kvp.first) << ": " << kvp.second << "," << std::endl;
+    }
+    json
+         << "      \"time_unit\": \"ns\"" << std::endl
+         << "    }";
+  }
+  json << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+  std::ofstream out(output_file_name.c_str());
+  out << json.str();
+  if (!out) {
+    Logger::error("Cannot write benchmark results to '" + output_file_name + "'");
+    return false;
+  }
+  return true;
+}
+
+}
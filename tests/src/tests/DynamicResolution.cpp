@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/DynamicResolution.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Adds a full window of frames with the same load.
+ * \param resolution The dynamic resolution to feed.
+ * \param load Work time divided by the budget.
+ */
+void add_window(DynamicResolution& resolution, double load) {
+
+  for (int i = 0; i < DynamicResolution::window_size; ++i) {
+    resolution.add_frame(load * 16.0, 16.0);
+  }
+}
+
+/**
+ * \brief Checks that the scale only changes when enabled.
+ */
+void test_disabled(TestEnvironment& /* env */) {
+
+  DynamicResolution resolution;
+  Debug::check_assertion(!resolution.is_enabled(), "Enabled by default");
+  Debug::check_assertion(resolution.get_scale() == 1.0, "Wrong initial scale");
+
+  add_window(resolution, 2.0);
+  Debug::check_assertion(resolution.get_scale() == 1.0, "Scale changed while disabled");
+}
+
+/**
+ * \brief Checks how the scale follows the load.
+ */
+void test_load(TestEnvironment& /* env */) {
+
+  DynamicResolution resolution;
+  resolution.set_enabled(true);
+
+  // Nothing is decided before the end of a window.
+  for (int i = 0; i < DynamicResolution::window_size - 1; ++i) {
+    resolution.add_frame(32.0, 16.0);
+  }
+  Debug::check_assertion(resolution.get_scale() == 1.0, "Scale changed too early");
+  resolution.add_frame(32.0, 16.0);
+  Debug::check_assertion(resolution.get_scale() == 1.0 - DynamicResolution::scale_step,
+      "Scale not lowered under high load");
+
+  for (int i = 0; i < 10; ++i) {
+    add_window(resolution, 2.0);
+  }
+  Debug::check_assertion(resolution.get_scale() == DynamicResolution::min_scale,
+      "Scale lower than the minimum");
+
+  // Between both thresholds, the scale is kept.
+  add_window(resolution, 0.75);
+  Debug::check_assertion(resolution.get_scale() == DynamicResolution::min_scale,
+      "Scale changed in the hysteresis gap");
+
+  add_window(resolution, 0.3);
+  Debug::check_assertion(resolution.get_scale() == DynamicResolution::min_scale + DynamicResolution::scale_step,
+      "Scale not raised under low load");
+
+  for (int i = 0; i < 10; ++i) {
+    add_window(resolution, 0.3);
+  }
+  Debug::check_assertion(resolution.get_scale() == 1.0, "Scale higher than 1");
+
+  resolution.set_enabled(false);
+  Debug::check_assertion(resolution.get_scale() == 1.0, "Scale not reset");
+}
+
+}
+
+/**
+ * Tests for the dynamic resolution of the final rendering pass.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_disabled(env);
+  test_load(env);
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/entities/CustomEntity.h"
+#include "solarus/entities/EntityTransforms.h"
+#include "test_tools/TestEnvironment.h"
+#include <memory>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates a custom entity that is not on the map.
+ */
+std::shared_ptr<CustomEntity> make_entity(TestEnvironment& env, const Point& xy) {
+
+  return std::make_shared<CustomEntity>(
+      env.get_game(), "", 0, 0, xy, Size(16, 16), "", ""
+  );
+}
+
+/**
+ * \brief Checks that slots stay consistent when removing entities.
+ */
+void test_add_remove(TestEnvironment& env) {
+
+  EntityTransforms transforms;
+  std::shared_ptr<CustomEntity> first = make_entity(env, { 0, 0 });
+  std::shared_ptr<CustomEntity> second = make_entity(env, { 32, 0 });
+  std::shared_ptr<CustomEntity> third = make_entity(env, { 64, 0 });
+
+  transforms.add(*first);
+  transforms.add(*second);
+  transforms.add(*third);
+  Debug::check_assertion(transforms.get_num_slots() == 3, "Expected 3 slots");
+  Debug::check_assertion(transforms.contains(*second), "Missing entity");
+  Debug::check_assertion(second->get_transform_slot() == 1, "Unexpected slot");
+  Debug::check_assertion(
+      transforms.get_bounding_box(1) == second->get_bounding_box(),
+      "Unexpected bounding box"
+  );
+
+  // The last entity takes the slot of the removed one.
+  transforms.remove(*second);
+  Debug::check_assertion(transforms.get_num_slots() == 2, "Expected 2 slots");
+  Debug::check_assertion(!transforms.contains(*second), "Entity not removed");
+  Debug::check_assertion(second->get_transform_slot() == -1, "Slot not cleared");
+  Debug::check_assertion(third->get_transform_slot() == 1, "Last entity not moved");
+  Debug::check_assertion(&transforms.get_entity(1) == third.get(), "Wrong entity in slot");
+  Debug::check_assertion(
+      transforms.get_bounding_box(1) == third->get_bounding_box(),
+      "Box not moved with the entity"
+  );
+
+  // Removing twice does nothing.
+  transforms.remove(*second);
+  Debug::check_assertion(transforms.get_num_slots() == 2, "Expected 2 slots");
+}
+
+/**
+ * \brief Checks the sweep done for camera culling.
+ */
+void test_overlapping(TestEnvironment& env) {
+
+  EntityTransforms transforms;
+  std::vector<std::shared_ptr<CustomEntity>> entities;
+  for (int i = 0; i < 10; ++i) {
+    entities.push_back(make_entity(env, { i * 32, 0 }));
+    transforms.add(*entities.back());
+  }
+
+  std::vector<uint8_t> result;
+  transforms.get_slots_overlapping(Rectangle(0, 0, 100, 16), result);
+  Debug::check_assertion(result.size() == 10, "Expected one value per slot");
+  for (int i = 0; i < 10; ++i) {
+    const bool expected = i * 32 < 100;
+    Debug::check_assertion((result[i] != 0) == expected, "Wrong overlapping result");
+  }
+
+  // Boxes are only refreshed by update().
+  entities[9]->set_xy(Point(48, 0));
+  transforms.get_slots_overlapping(Rectangle(0, 0, 100, 16), result);
+  Debug::check_assertion(result[9] == 0, "Box refreshed too early");
+  transforms.update(*entities[9]);
+  transforms.get_slots_overlapping(Rectangle(0, 0, 100, 16), result);
+  Debug::check_assertion(result[9] == 1, "Box not refreshed");
+}
+
+}
+
+/**
+ * \brief Tests for the transform arrays of entities.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_add_remove(env);
+  test_overlapping(env);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/EnumInfo.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/entities/GroundInfo.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that each name gives back its enum value.
+ */
+template<typename E>
+void test_names() {
+
+  for (const auto& kvp: EnumInfoTraits<E>::names) {
+    Debug::check_assertion(name_to_enum<E>(kvp.second) == kvp.first,
+        std::string("Wrong value for name '") + kvp.second + "'");
+    Debug::check_assertion(enum_to_name(kvp.first) == kvp.second,
+        std::string("Wrong name for value '") + kvp.second + "'");
+  }
+  Debug::check_assertion(
+      EnumInfo<E>::names_index().size() == EnumInfoTraits<E>::names.size(),
+      "Wrong number of indexed names"
+  );
+}
+
+/**
+ * \brief Checks the lookup of unknown names.
+ */
+void test_unknown_names() {
+
+  bool success = true;
+  EntityType type = name_to_enum("not_an_entity", EntityType::TILE, success);
+  Debug::check_assertion(!success, "Unknown name found");
+  Debug::check_assertion(type == EntityType::TILE, "Default value not returned");
+
+  type = name_to_enum("custom_entity", EntityType::TILE, success);
+  Debug::check_assertion(success, "Known name not found");
+  Debug::check_assertion(type == EntityType::CUSTOM, "Wrong value");
+
+  Ground ground = name_to_enum("Deep_water", Ground::EMPTY);
+  Debug::check_assertion(ground == Ground::EMPTY, "Names are not case sensitive");
+}
+
+}
+
+/**
+ * \brief Tests for the conversions between enum values and names.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_names<EntityType>();
+  test_names<Ground>();
+  test_unknown_names();
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Geometry.h"
+#include "test_tools/TestEnvironment.h"
+#include <cmath>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that two values are close.
+ */
+void check_close(double value, double expected, double tolerance, const std::string& what) {
+
+  Debug::check_assertion(std::abs(value - expected) <= tolerance,
+      what + ": got " + std::to_string(value) + ", expected " + std::to_string(expected));
+}
+
+/**
+ * \brief Checks that standard functions are used by default.
+ */
+void test_standard_functions() {
+
+  Geometry::set_trigonometry_tables_enabled(false);
+  for (double angle = -7.0; angle < 7.0; angle += 0.37) {
+    Debug::check_assertion(Geometry::get_cos(angle) == std::cos(angle), "Wrong standard cosine");
+    Debug::check_assertion(Geometry::get_sin(angle) == std::sin(angle), "Wrong standard sine");
+    Debug::check_assertion(Geometry::get_atan2(angle, 1.5) == std::atan2(angle, 1.5), "Wrong standard atan2");
+  }
+}
+
+/**
+ * \brief Checks the values of lookup tables.
+ */
+void test_tables() {
+
+  Geometry::set_trigonometry_tables_enabled(true);
+
+  // Main directions are exact.
+  Debug::check_assertion(Geometry::get_cos(0.0) == 1.0, "Wrong cosine of 0");
+  Debug::check_assertion(Geometry::get_sin(0.0) == 0.0, "Wrong sine of 0");
+  Debug::check_assertion(Geometry::get_cos(Geometry::PI_OVER_2) == 0.0, "Wrong cosine of pi/2");
+  Debug::check_assertion(Geometry::get_sin(Geometry::PI_OVER_2) == 1.0, "Wrong sine of pi/2");
+  Debug::check_assertion(Geometry::get_cos(Geometry::PI) == -1.0, "Wrong cosine of pi");
+  Debug::check_assertion(Geometry::get_sin(Geometry::THREE_PI_OVER_2) == -1.0, "Wrong sine of 3pi/2");
+  Debug::check_assertion(Geometry::get_sin(-Geometry::PI_OVER_2) == -1.0, "Wrong sine of -pi/2");
+  Debug::check_assertion(Geometry::get_angle(0, 0, 10, 0) == 0.0, "Wrong angle of right");
+  Debug::check_assertion(Geometry::get_angle(0, 0, -10, 0) == std::lround(Geometry::PI * 65536) / 65536.0,
+      "Wrong angle of left");
+
+  // Other angles are close to the standard ones.
+  for (double angle = -7.0; angle < 7.0; angle += 0.013) {
+    check_close(Geometry::get_cos(angle), std::cos(angle), 2e-3, "Cosine");
+    check_close(Geometry::get_sin(angle), std::sin(angle), 2e-3, "Sine");
+  }
+  for (int y = -20; y <= 20; ++y) {
+    for (int x = -20; x <= 20; ++x) {
+      if (x == 0 && y == 0) {
+        continue;
+      }
+      check_close(Geometry::get_atan2(y, x), std::atan2(y, x), 1e-3, "Arc tangent");
+    }
+  }
+
+  // Straight movements use these functions to get their speed vector.
+  const Point xy = Geometry::get_xy(Geometry::PI_OVER_4, 100);
+  Debug::check_assertion(xy == Point(70, -70), "Wrong diagonal vector");
+
+  Geometry::set_trigonometry_tables_enabled(false);
+}
+
+}
+
+/**
+ * \brief Tests for the trigonometry of movements.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_standard_functions();
+  test_tables();
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/Ground.h"
+#include "solarus/entities/GroundRaster.h"
+#include "test_tools/TestEnvironment.h"
+#include <random>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+constexpr int width8 = 20;
+constexpr int height8 = 12;
+
+/**
+ * \brief Reference wall test of a pixel, like Map::test_collision_with_ground().
+ */
+bool is_wall_reference(Ground ground, int x, int y) {
+
+  const int x_in_tile = x & 7;
+  const int y_in_tile = y & 7;
+  switch (ground) {
+
+  case Ground::WALL:
+    return true;
+
+  case Ground::WALL_TOP_RIGHT:
+  case Ground::WALL_TOP_RIGHT_WATER:
+    return y_in_tile <= x_in_tile;
+
+  case Ground::WALL_TOP_LEFT:
+  case Ground::WALL_TOP_LEFT_WATER:
+    return y_in_tile <= 7 - x_in_tile;
+
+  case Ground::WALL_BOTTOM_LEFT:
+  case Ground::WALL_BOTTOM_LEFT_WATER:
+    return y_in_tile >= x_in_tile;
+
+  case Ground::WALL_BOTTOM_RIGHT:
+  case Ground::WALL_BOTTOM_RIGHT_WATER:
+    return y_in_tile >= 7 - x_in_tile;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Reference test of grounds that depend on the entity.
+ */
+bool is_conditional_reference(Ground ground) {
+
+  switch (ground) {
+
+  case Ground::LOW_WALL:
+  case Ground::DEEP_WATER:
+  case Ground::SHALLOW_WATER:
+  case Ground::GRASS:
+  case Ground::HOLE:
+  case Ground::ICE:
+  case Ground::LADDER:
+  case Ground::PRICKLE:
+  case Ground::LAVA:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Compares the raster with the squares it was built from.
+ */
+void test_raster(TestEnvironment& /* env */) {
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> ground_distribution(
+      0, static_cast<int>(Ground::LAVA));
+  std::uniform_int_distribution<int> percent(0, 99);
+
+  std::vector<Ground> grounds(width8 * height8, Ground::TRAVERSABLE);
+  GroundRaster raster;
+  raster.initialize(width8, height8);
+
+  // Set each square twice to check that old bits are cleared.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int y8 = 0; y8 < height8; ++y8) {
+      for (int x8 = 0; x8 < width8; ++x8) {
+        const Ground ground = percent(random) < 70 ?
+            Ground::TRAVERSABLE : static_cast<Ground>(ground_distribution(random));
+        grounds[y8 * width8 + x8] = ground;
+        raster.set_ground(x8, y8, ground);
+      }
+    }
+  }
+
+  for (int y = 0; y < height8 * 8; ++y) {
+    for (int x = 0; x < width8 * 8; ++x) {
+      const Ground ground = grounds[(y >> 3) * width8 + (x >> 3)];
+      Debug::check_assertion(raster.is_wall(x, y) == is_wall_reference(ground, x, y),
+          "Wrong wall pixel");
+      Debug::check_assertion(raster.is_conditional(x, y) == is_conditional_reference(ground),
+          "Wrong conditional pixel");
+    }
+  }
+
+  // Test the borders of many boxes.
+  for (int i = 0; i < 2000; ++i) {
+    const int box_width = 1 + percent(random) % 80;
+    const int box_height = 1 + percent(random) % 40;
+    const int x = std::uniform_int_distribution<int>(0, width8 * 8 - box_width)(random);
+    const int y = std::uniform_int_distribution<int>(0, height8 * 8 - box_height)(random);
+    const Rectangle box(x, y, box_width, box_height);
+
+    bool expected_wall = false;
+    bool expected_conditional = false;
+    bool expected_wall_inside = false;
+    bool expected_conditional_inside = false;
+    for (int by = y; by < y + box_height; ++by) {
+      for (int bx = x; bx < x + box_width; ++bx) {
+        expected_wall_inside |= raster.is_wall(bx, by);
+        expected_conditional_inside |= raster.is_conditional(bx, by);
+        if (by != y && by != y + box_height - 1 &&
+            bx != x && bx != x + box_width - 1) {
+          continue;
+        }
+        expected_wall |= raster.is_wall(bx, by);
+        expected_conditional |= raster.is_conditional(bx, by);
+      }
+    }
+    Debug::check_assertion(raster.has_wall_on_border(box) == expected_wall,
+        "Wrong wall test on border");
+    Debug::check_assertion(raster.has_conditional_on_border(box) == expected_conditional,
+        "Wrong conditional test on border");
+    Debug::check_assertion(raster.has_wall(box) == expected_wall_inside,
+        "Wrong wall test in box");
+    Debug::check_assertion(raster.has_conditional(box) == expected_conditional_inside,
+        "Wrong conditional test in box");
+  }
+}
+
+}
+
+/**
+ * Tests for the ground raster.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_raster(env);
+
+  return 0;
+}
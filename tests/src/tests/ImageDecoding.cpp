@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include "test_tools/TestEnvironment.h"
+#include <SDL_image.h>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that an image decoded by the engine has the same pixels
+ * as the generic conversion of SDL.
+ * \param file_name Image file to decode.
+ */
+void check_same_pixels(const std::string& file_name) {
+
+  SDL_Surface_UniquePtr decoded(Surface::decode_image(file_name, false));
+  Debug::check_assertion(decoded != nullptr, "Cannot decode '" + file_name + "'");
+
+  SDL_Surface_UniquePtr original(IMG_Load_RW(QuestFiles::data_file_open_rw(file_name), 1));
+  Debug::check_assertion(original != nullptr, "Cannot load '" + file_name + "'");
+  const SDL_PixelFormat& format = *Video::get_rgba_format();
+  SDL_Surface_UniquePtr expected(SDL_ConvertSurface(original.get(), &format, 0));
+  Debug::check_assertion(expected != nullptr, "Cannot convert '" + file_name + "'");
+
+  Debug::check_assertion(decoded->format->format == format.format, "Wrong format");
+  Debug::check_assertion(decoded->w == expected->w && decoded->h == expected->h, "Wrong size");
+
+  for (int y = 0; y < decoded->h; ++y) {
+    const uint32_t* decoded_row = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(decoded->pixels) + y * decoded->pitch);
+    const uint32_t* expected_row = reinterpret_cast<const uint32_t*>(
+        static_cast<const uint8_t*>(expected->pixels) + y * expected->pitch);
+    for (int x = 0; x < decoded->w; ++x) {
+      // The color of fully transparent pixels does not matter.
+      const bool same = (decoded_row[x] & format.Amask) == 0 ?
+          (expected_row[x] & format.Amask) == 0 :
+          decoded_row[x] == expected_row[x];
+      Debug::check_assertion(same, "Wrong pixel in '" + file_name + "' at " +
+          std::to_string(x) + "," + std::to_string(y));
+    }
+  }
+}
+
+/**
+ * \brief Checks decoding palette images of the testing quest.
+ */
+void test_palette_images(TestEnvironment& /* env */) {
+
+  check_same_pixels("tilesets/overworld.tiles.png");
+  check_same_pixels("sprites/hero/carrying.png");
+}
+
+}
+
+/**
+ * \brief Tests the conversion of images to the pixel format of the engine.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_palette_images(env);
+
+  return 0;
+}
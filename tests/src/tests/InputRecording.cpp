@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/InputEvent.h"
+#include "solarus/core/InputRecording.h"
+#include "solarus/core/Random.h"
+#include "test_tools/TestEnvironment.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+const std::string file_name = "input_recording_test.dat";
+
+/**
+ * \brief Creates a keyboard event.
+ */
+std::unique_ptr<InputEvent> create_key_event(uint32_t type, SDL_Keycode key) {
+
+  SDL_Event event;
+  std::memset(&event, 0, sizeof(event));
+  event.type = type;
+  event.key.keysym.sym = key;
+  return InputEvent::create_replayed_event(event);
+}
+
+/**
+ * \brief Checks that replayed events come back at their dates with the seed.
+ */
+void test_record_and_replay(TestEnvironment& /* env */) {
+
+  {
+    InputRecording recording;
+    Debug::check_assertion(recording.start_recording(file_name, 1234),
+        "Failed to create the recording");
+    recording.record_event(*create_key_event(SDL_KEYDOWN, SDLK_a), 0);
+    recording.record_event(*create_key_event(SDL_KEYDOWN, SDLK_b), 20);
+
+    SDL_Event window_event;
+    std::memset(&window_event, 0, sizeof(window_event));
+    window_event.type = SDL_WINDOWEVENT;
+    recording.record_event(*InputEvent::create_replayed_event(window_event), 20);
+
+    recording.record_event(*create_key_event(SDL_KEYUP, SDLK_a), 30);
+  }
+
+  InputRecording replay;
+  Debug::check_assertion(replay.start_replaying(file_name),
+      "Failed to load the recording");
+  Debug::check_assertion(replay.get_random_seed() == 1234,
+      "Wrong random seed");
+
+  std::unique_ptr<InputEvent> event = replay.get_replayed_event(0);
+  Debug::check_assertion(event != nullptr &&
+      event->get_internal_event().type == SDL_KEYDOWN &&
+      event->get_internal_event().key.keysym.sym == SDLK_a,
+      "Missing first event");
+  Debug::check_assertion(replay.get_replayed_event(10) == nullptr,
+      "Event replayed too early");
+
+  event = replay.get_replayed_event(20);
+  Debug::check_assertion(event != nullptr &&
+      event->get_internal_event().key.keysym.sym == SDLK_b,
+      "Missing second event");
+  Debug::check_assertion(replay.get_replayed_event(20) == nullptr,
+      "Window events should not be recorded");
+
+  event = replay.get_replayed_event(40);
+  Debug::check_assertion(event != nullptr &&
+      event->get_internal_event().type == SDL_KEYUP,
+      "Missing late event");
+  Debug::check_assertion(replay.is_replay_finished(),
+      "Replay should be finished");
+}
+
+/**
+ * \brief Checks that the same seed gives the same random numbers.
+ */
+void test_random_seed(TestEnvironment& /* env */) {
+
+  Random::set_seed(42);
+  std::vector<int> numbers;
+  for (int i = 0; i < 16; ++i) {
+    numbers.push_back(Random::get_number(1000));
+  }
+
+  Random::set_seed(42);
+  for (int i = 0; i < 16; ++i) {
+    Debug::check_assertion(Random::get_number(1000) == numbers[i],
+        "Random numbers differ with the same seed");
+  }
+}
+
+}
+
+/**
+ * Tests for input recording and replay.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_record_and_replay(env);
+  test_random_seed(env);
+
+  return 0;
+}
@@ -54,6 +54,20 @@ void check_strings(TestEnvironment& /* env */, const std::string& language_id) {
         << "*** Exported strings file:" << std::endl << exported_string_buffer << std::endl;
     Debug::die("Strings '" + language_id + "': exported file differs from the original one");
   }
+
+  // The binary format must give the same strings too.
+  std::string binary_strings_buffer;
+  success = string_resources.export_to_binary_buffer(
+      binary_strings_buffer, LuaData::compute_source_hash(imported_string_buffer));
+  Debug::check_assertion(success, "Strings binary export failed");
+  StringResources binary_string_resources;
+  success = binary_string_resources.import_from_binary_buffer(binary_strings_buffer, file_name);
+  Debug::check_assertion(success, "Strings binary import failed");
+  success = binary_string_resources.export_to_buffer(exported_string_buffer);
+  Debug::check_assertion(success, "Strings export failed");
+  if (exported_string_buffer != imported_string_buffer) {
+    Debug::die("Strings '" + language_id + "': binary strings differ from the original one");
+  }
 }
 
 /**
@@ -82,6 +96,20 @@ void check_dialogs(TestEnvironment& /* env */, const std::string& language_id) {
         << "*** Exported dialogs file:" << std::endl << exported_dialog_buffer << std::endl;
     Debug::die("Dialogs '" + language_id + "': exported file differs from the original one");
   }
+
+  // The binary format must give the same dialogs too.
+  std::string binary_dialogs_buffer;
+  success = dialog_resources.export_to_binary_buffer(
+      binary_dialogs_buffer, LuaData::compute_source_hash(imported_dialog_buffer));
+  Debug::check_assertion(success, "Dialogs binary export failed");
+  DialogResources binary_dialog_resources;
+  success = binary_dialog_resources.import_from_binary_buffer(binary_dialogs_buffer, file_name);
+  Debug::check_assertion(success, "Dialogs binary import failed");
+  success = binary_dialog_resources.export_to_buffer(exported_dialog_buffer);
+  Debug::check_assertion(success, "Dialogs export failed");
+  if (exported_dialog_buffer != imported_dialog_buffer) {
+    Debug::die("Dialogs '" + language_id + "': binary dialogs differ from the original one");
+  }
 }
 
 }
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include "test_tools/TestEnvironment.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Returns what the logger writes on stdout while calling a function.
+ * \param function The function to call.
+ * \return The output.
+ */
+template<typename Function>
+std::string capture_output(const Function& function) {
+
+  std::ostringstream oss;
+  Logger::flush();
+  std::streambuf* stdout_buffer = std::cout.rdbuf(oss.rdbuf());
+  function();
+  Logger::flush();
+  std::cout.rdbuf(stdout_buffer);
+  return oss.str();
+}
+
+/**
+ * \brief Checks filtering on levels and categories.
+ */
+void test_filters() {
+
+  Debug::check_assertion(Logger::get_min_level() == Logger::Level::VERBOSE,
+      "Debug messages not logged by default");
+
+  Logger::set_min_level(Logger::Level::WARNING);
+  std::string output = capture_output([] {
+    Logger::info("hidden info");
+    Logger::warning("shown warning");
+  });
+  Debug::check_assertion(output.find("hidden info") == std::string::npos, "Info not filtered");
+  Debug::check_assertion(output.find("Warning: shown warning") != std::string::npos, "Warning filtered");
+
+  Debug::check_assertion(Logger::set_min_level("debug"), "Level name not recognized");
+  Debug::check_assertion(Logger::get_min_level() == Logger::Level::VERBOSE, "Wrong level");
+  Debug::check_assertion(!Logger::set_min_level("verbose"), "Wrong level name accepted");
+
+  Logger::set_category_enabled("test", false);
+  output = capture_output([] {
+    Logger::debug("hidden debug", "test");
+    Logger::debug("shown debug", "other");
+  });
+  Debug::check_assertion(output.find("hidden debug") == std::string::npos, "Category not filtered");
+  Debug::check_assertion(output.find("Debug: [other] shown debug") != std::string::npos, "Category filtered");
+  Debug::check_assertion(!Logger::is_enabled(Logger::Level::FATAL, "test"), "Wrong enabled state");
+
+  Logger::set_category_enabled("test", true);
+  Logger::set_min_level(Logger::Level::INFO);
+  Debug::check_assertion(Logger::is_enabled(Logger::Level::INFO, "test"), "Category not enabled again");
+}
+
+/**
+ * \brief Checks the JSON format.
+ */
+void test_json() {
+
+  Debug::check_assertion(Logger::set_format("json"), "Format name not recognized");
+  const std::string output = capture_output([] {
+    Logger::info("a \"quoted\"\tmessage", "test");
+    Logger::print_output("script line");
+  });
+  Logger::set_format(Logger::Format::TEXT);
+
+  Debug::check_assertion(output.find(
+      "\"level\": \"info\", \"category\": \"test\", \"message\": \"a \\\"quoted\\\"\\tmessage\"}\n"
+  ) != std::string::npos, "Wrong JSON message");
+  Debug::check_assertion(output.find("{\"output\": \"script line\"}\n") != std::string::npos,
+      "Wrong JSON output line");
+}
+
+/**
+ * \brief Checks that asynchronous logging keeps the order of messages.
+ */
+void test_order() {
+
+  const bool was_asynchronous = Logger::is_asynchronous();
+  Logger::set_asynchronous(true);
+  const std::string output = capture_output([] {
+    for (int i = 0; i < 1000; ++i) {
+      Logger::print_output(std::to_string(i));
+    }
+  });
+  Logger::set_asynchronous(was_asynchronous);
+
+  std::ostringstream expected;
+  for (int i = 0; i < 1000; ++i) {
+    expected << i << '\n';
+  }
+  Debug::check_assertion(output == expected.str(), "Messages lost or not in order");
+}
+
+/**
+ * \brief Checks that threads can keep logging while the asynchronous mode
+ * is disabled, like during the shutdown of the engine.
+ */
+void test_disable_while_logging() {
+
+  const bool was_asynchronous = Logger::is_asynchronous();
+  Logger::set_asynchronous(true);
+  const int num_threads = 4;
+  const int num_lines = 500;
+  const std::string output = capture_output([&] {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < num_lines; ++j) {
+          Logger::print_output("line");
+        }
+      });
+    }
+    Logger::set_asynchronous(false);
+    for (std::thread& thread: threads) {
+      thread.join();
+    }
+  });
+  Logger::set_asynchronous(was_asynchronous);
+
+  int num_lines_written = 0;
+  std::istringstream iss(output);
+  std::string line;
+  while (std::getline(iss, line)) {
+    Debug::check_assertion(line == "line", "Corrupted line: '" + line + "'");
+    ++num_lines_written;
+  }
+  Debug::check_assertion(num_lines_written == num_threads * num_lines, "Messages lost");
+}
+
+}
+
+/**
+ * \brief Tests for the logger.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_filters();
+  test_json();
+  test_order();
+  test_disable_while_logging();
+
+  return 0;
+}
@@ -75,6 +75,30 @@ void check_map(TestEnvironment& /* env */, const std::string& map_id) {
     Debug::die("Map '" + map_id + "': exported file differs from the original one");
   }
 
+  // The binary format must give the same map too.
+  std::string binary_map_buffer;
+  const uint64_t source_hash = LuaData::compute_source_hash(imported_map_buffer);
+  success = map_data.export_to_binary_buffer(binary_map_buffer, source_hash);
+  Debug::check_assertion(success, "Map binary export failed");
+  uint64_t binary_source_hash = 0;
+  success = map_data.get_binary_source_hash(binary_map_buffer, binary_source_hash);
+  Debug::check_assertion(success, "Invalid binary map header");
+  Debug::check_assertion(binary_source_hash == source_hash, "Binary map source hash differs");
+
+  MapData binary_map_data;
+  success = binary_map_data.import_from_binary_buffer(binary_map_buffer, file_name);
+  Debug::check_assertion(success, "Map binary import failed");
+  success = binary_map_data.export_to_buffer(exported_map_buffer);
+  Debug::check_assertion(success, "Map export failed");
+  if (exported_map_buffer != imported_map_buffer) {
+    Debug::die("Map '" + map_id + "': binary map differs from the original one");
+  }
+
+  // A truncated binary map must be rejected.
+  binary_map_buffer.resize(binary_map_buffer.size() - 1);
+  success = binary_map_data.import_from_binary_buffer(binary_map_buffer, file_name);
+  Debug::check_assertion(!success, "Truncated binary map was accepted");
+
   // Then export and import every entity of the map.
   for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
     for (int j = 0; j < map_data.get_num_entities(layer); ++j) {
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/Quadtree.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/MemoryStats.h"
+#include "solarus/core/Rectangle.h"
+#include "test_tools/TestEnvironment.h"
+#include <memory>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that counters follow the objects added and removed.
+ */
+void test_counters() {
+
+  const MemoryStats::Category category = MemoryStats::Category::SOUND_BUFFERS;
+  const MemoryStats::Counters before = MemoryStats::get_counters(category);
+
+  MemoryStats::add(category, 1000);
+  MemoryStats::add(category, 24);
+  MemoryStats::Counters counters = MemoryStats::get_counters(category);
+  Debug::check_assertion(counters.num_bytes == before.num_bytes + 1024, "Wrong number of bytes");
+  Debug::check_assertion(counters.num_objects == before.num_objects + 2, "Wrong number of objects");
+
+  MemoryStats::remove(category, 1000);
+  MemoryStats::remove(category, 24);
+  counters = MemoryStats::get_counters(category);
+  Debug::check_assertion(counters.num_bytes == before.num_bytes, "Bytes not released");
+  Debug::check_assertion(counters.num_objects == before.num_objects, "Objects not released");
+
+  Debug::check_assertion(MemoryStats::get_category_name(category) == "sound_buffers",
+      "Wrong category name");
+}
+
+/**
+ * \brief Checks that texture origins can be nested.
+ */
+void test_texture_origin() {
+
+  Debug::check_assertion(
+      MemoryStats::get_texture_category() == MemoryStats::Category::OTHER_TEXTURES,
+      "Wrong default texture origin");
+  {
+    MemoryStats::TextureOrigin sprite_origin(MemoryStats::Category::SPRITE_TEXTURES);
+    Debug::check_assertion(
+        MemoryStats::get_texture_category() == MemoryStats::Category::SPRITE_TEXTURES,
+        "Sprite origin not set");
+    {
+      MemoryStats::TextureOrigin text_origin(MemoryStats::Category::TEXT_TEXTURES);
+      Debug::check_assertion(
+          MemoryStats::get_texture_category() == MemoryStats::Category::TEXT_TEXTURES,
+          "Text origin not set");
+    }
+    Debug::check_assertion(
+        MemoryStats::get_texture_category() == MemoryStats::Category::SPRITE_TEXTURES,
+        "Sprite origin not restored");
+  }
+  Debug::check_assertion(
+      MemoryStats::get_texture_category() == MemoryStats::Category::OTHER_TEXTURES,
+      "Default texture origin not restored");
+}
+
+/**
+ * \brief Checks that nodes of quadtrees are counted.
+ */
+void test_quadtree_nodes() {
+
+  const MemoryStats::Category category = MemoryStats::Category::QUADTREE_NODES;
+  const int64_t num_nodes_before = MemoryStats::get_counters(category).num_objects;
+  {
+    std::unique_ptr<Quadtree<int>> quadtree(new Quadtree<int>(Rectangle(0, 0, 1024, 1024)));
+    for (int i = 0; i < 64; ++i) {
+      quadtree->add(i, Rectangle((i % 8) * 128, (i / 8) * 128, 16, 16));
+    }
+    const MemoryStats::Counters counters = MemoryStats::get_counters(category);
+    Debug::check_assertion(counters.num_objects > num_nodes_before, "Nodes not counted");
+    Debug::check_assertion(counters.num_bytes > 0, "Node bytes not counted");
+  }
+  Debug::check_assertion(MemoryStats::get_counters(category).num_objects == num_nodes_before,
+      "Nodes not released");
+}
+
+}
+
+/**
+ * \brief Tests for the memory accounting of the engine.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_counters();
+  test_texture_origin();
+  test_quadtree_nodes();
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/entities/ObstacleTable.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+using Relation = ObstacleTable::Relation;
+
+/**
+ * \brief Checks the relation of two types.
+ */
+void check_relation(EntityType obstacle_type, EntityType other_type, Relation expected) {
+
+  Debug::check_assertion(ObstacleTable::get_relation(obstacle_type, other_type) == expected,
+      "Wrong relation between '" + enum_to_name(obstacle_type) +
+      "' and '" + enum_to_name(other_type) + "'");
+}
+
+/**
+ * \brief Checks relations that only depend on the obstacle type.
+ */
+void test_obstacle_types() {
+
+  check_relation(EntityType::PICKABLE, EntityType::HERO, Relation::NEVER);
+  check_relation(EntityType::EXPLOSION, EntityType::ENEMY, Relation::NEVER);
+  check_relation(EntityType::CHEST, EntityType::HERO, Relation::ALWAYS);
+  check_relation(EntityType::DOOR, EntityType::HERO, Relation::TEST);
+  check_relation(EntityType::ENEMY, EntityType::HERO, Relation::TEST);
+  check_relation(EntityType::WALL, EntityType::ARROW, Relation::TEST);
+}
+
+/**
+ * \brief Checks relations decided by hooks of the other entity.
+ */
+void test_hooks() {
+
+  // Default hooks.
+  check_relation(EntityType::SENSOR, EntityType::ENEMY, Relation::NEVER);
+  check_relation(EntityType::HERO, EntityType::ENEMY, Relation::NEVER);
+  check_relation(EntityType::STAIRS, EntityType::ENEMY, Relation::ALWAYS);
+  check_relation(EntityType::TELETRANSPORTER, EntityType::NPC, Relation::ALWAYS);
+
+  // Overridden hooks.
+  check_relation(EntityType::SENSOR, EntityType::HERO, Relation::TEST);
+  check_relation(EntityType::HERO, EntityType::BLOCK, Relation::TEST);
+  check_relation(EntityType::STREAM, EntityType::PICKABLE, Relation::TEST);
+}
+
+/**
+ * \brief Checks that custom entities always use the virtual test.
+ */
+void test_custom_entities() {
+
+  for (const auto& kvp: EnumInfoTraits<EntityType>::names) {
+    check_relation(EntityType::CUSTOM, kvp.first, Relation::TEST);
+    check_relation(kvp.first, EntityType::CUSTOM, Relation::TEST);
+  }
+}
+
+}
+
+/**
+ * \brief Tests for the obstacle relations between entity types.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_obstacle_types();
+  test_hooks();
+  test_custom_entities();
+
+  return 0;
+}
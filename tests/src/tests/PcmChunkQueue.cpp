@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/PcmChunkQueue.h"
+#include "solarus/core/Debug.h"
+#include "test_tools/TestEnvironment.h"
+#include <thread>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks filling and emptying the queue from a single thread.
+ */
+void test_fill(TestEnvironment& /* env */) {
+
+  PcmChunkQueue queue(3);
+  Debug::check_assertion(queue.get_capacity() == 3, "Wrong capacity");
+  Debug::check_assertion(queue.is_empty(), "Queue not empty");
+  Debug::check_assertion(queue.get_chunk_to_read() == nullptr, "Unexpected chunk");
+
+  for (int i = 0; i < 3; ++i) {
+    PcmChunk* chunk = queue.get_chunk_to_write();
+    Debug::check_assertion(chunk != nullptr, "No chunk to write");
+    chunk->num_bytes = i + 1;
+    queue.push();
+  }
+  Debug::check_assertion(queue.is_full(), "Queue not full");
+  Debug::check_assertion(queue.get_chunk_to_write() == nullptr, "Unexpected chunk to write");
+
+  // Chunks come out in order and the slots are reused.
+  for (int i = 0; i < 10; ++i) {
+    const PcmChunk* chunk = queue.get_chunk_to_read();
+    Debug::check_assertion(chunk != nullptr && chunk->num_bytes == i + 1, "Wrong chunk");
+    queue.pop();
+    PcmChunk* new_chunk = queue.get_chunk_to_write();
+    Debug::check_assertion(new_chunk != nullptr, "No chunk to write");
+    new_chunk->num_bytes = i + 4;
+    queue.push();
+    Debug::check_assertion(queue.get_num_chunks() == 3, "Wrong number of chunks");
+  }
+}
+
+/**
+ * \brief Checks that chunks written by one thread are read in order by another one.
+ */
+void test_threads(TestEnvironment& /* env */) {
+
+  const int num_chunks = 10000;
+  PcmChunkQueue queue(4);
+
+  std::thread producer([&]() {
+    int i = 0;
+    while (i < num_chunks) {
+      PcmChunk* chunk = queue.get_chunk_to_write();
+      if (chunk == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      chunk->samples.assign(8, static_cast<int16_t>(i));
+      chunk->num_bytes = i;
+      queue.push();
+      ++i;
+    }
+  });
+
+  int i = 0;
+  bool ordered = true;
+  while (i < num_chunks) {
+    const PcmChunk* chunk = queue.get_chunk_to_read();
+    if (chunk == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (chunk->num_bytes != i ||
+        chunk->samples.size() != 8 ||
+        chunk->samples.back() != static_cast<int16_t>(i)) {
+      ordered = false;
+    }
+    queue.pop();
+    ++i;
+  }
+  producer.join();
+
+  Debug::check_assertion(ordered, "Chunks received out of order");
+  Debug::check_assertion(queue.is_empty(), "Queue not empty");
+}
+
+}
+
+/**
+ * Tests for the queue of decoded music chunks.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_fill(env);
+  test_threads(env);
+
+  return 0;
+}
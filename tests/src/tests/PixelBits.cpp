@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/PixelBits.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Surface.h"
+#include "test_tools/TestEnvironment.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief An image with the opacity of each pixel.
+ */
+struct Image {
+  int width;
+  int height;
+  std::vector<bool> opaque;
+};
+
+/**
+ * \brief Creates an image with random opaque pixels.
+ *
+ * Some rows are left fully transparent and pixels are concentrated
+ * in the middle so that row spans differ.
+ */
+Image create_image(int width, int height, std::mt19937& random) {
+
+  Image image = { width, height, std::vector<bool>(width * height, false) };
+  std::uniform_int_distribution<int> percent(0, 99);
+  for (int y = 0; y < height; ++y) {
+    if (percent(random) < 15) {
+      continue;
+    }
+    const int margin = percent(random) % (width / 2 + 1);
+    for (int x = margin; x < width - margin; ++x) {
+      image.opaque[y * width + x] = percent(random) < 20;
+    }
+  }
+  return image;
+}
+
+/**
+ * \brief Creates pixel bits from an image.
+ */
+PixelBits create_pixel_bits(const Image& image) {
+
+  std::string pixels(image.width * image.height * 4, '\0');
+  for (int i = 0; i < image.width * image.height; ++i) {
+    if (image.opaque[i]) {
+      pixels[i * 4] = static_cast<char>(0xFF);
+      pixels[i * 4 + 3] = static_cast<char>(0xFF);
+    }
+  }
+
+  SurfacePtr surface = Surface::create(image.width, image.height);
+  surface->set_pixels(pixels);
+  return PixelBits(*surface, Rectangle(0, 0, image.width, image.height));
+}
+
+/**
+ * \brief Reference pixel-precise collision test.
+ */
+bool test_collision_brute_force(
+    const Image& image1,
+    const Image& image2,
+    const Point& location1,
+    const Point& location2
+) {
+  for (int y = 0; y < image1.height; ++y) {
+    for (int x = 0; x < image1.width; ++x) {
+      if (!image1.opaque[y * image1.width + x]) {
+        continue;
+      }
+      const int x2 = location1.x + x - location2.x;
+      const int y2 = location1.y + y - location2.y;
+      if (x2 >= 0 && x2 < image2.width &&
+          y2 >= 0 && y2 < image2.height &&
+          image2.opaque[y2 * image2.width + x2]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Compares collisions with the reference test at many offsets.
+ */
+void test_collisions(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+  const std::vector<Size> sizes = {
+      { 1, 1 }, { 5, 7 }, { 16, 16 }, { 63, 3 }, { 64, 4 }, { 65, 5 }, { 130, 9 }
+  };
+
+  for (const Size& size1 : sizes) {
+    for (const Size& size2 : sizes) {
+      const Image image1 = create_image(size1.width, size1.height, random);
+      const Image image2 = create_image(size2.width, size2.height, random);
+      const PixelBits bits1 = create_pixel_bits(image1);
+      const PixelBits bits2 = create_pixel_bits(image2);
+      const Point location1(10, 20);
+
+      for (int dy = -size2.height; dy <= size1.height; ++dy) {
+        for (int dx = -size2.width; dx <= size1.width; ++dx) {
+          const Point location2(location1.x + dx, location1.y + dy);
+          const bool expected = test_collision_brute_force(
+              image1, image2, location1, location2);
+          Debug::check_assertion(
+              bits1.test_collision(bits2, location1, location2) == expected,
+              "Wrong pixel collision result"
+          );
+          Debug::check_assertion(
+              bits2.test_collision(bits1, location2, location1) == expected,
+              "Pixel collision result is not symmetric"
+          );
+        }
+      }
+    }
+  }
+}
+
+/**
+ * \brief Checks that fully transparent images never collide.
+ */
+void test_transparent(TestEnvironment& /* env */) {
+
+  const Image transparent = { 70, 4, std::vector<bool>(70 * 4, false) };
+  const Image opaque = { 70, 4, std::vector<bool>(70 * 4, true) };
+  const PixelBits transparent_bits = create_pixel_bits(transparent);
+  const PixelBits opaque_bits = create_pixel_bits(opaque);
+
+  Debug::check_assertion(
+      opaque_bits.test_collision(opaque_bits, Point(0, 0), Point(69, 3)),
+      "Opaque images should collide"
+  );
+  Debug::check_assertion(
+      !transparent_bits.test_collision(opaque_bits, Point(0, 0), Point(0, 0)),
+      "Transparent images should not collide"
+  );
+}
+
+}
+
+/**
+ * Tests for pixel-precise collisions.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_collisions(env);
+  test_transparent(env);
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/ThreadPool.h"
+#include "solarus/graphics/Hq2xFilter.h"
+#include "solarus/graphics/Hq3xFilter.h"
+#include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/Scale2xFilter.h"
+#include "test_tools/TestEnvironment.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates an image of random rectangles, like pixel art.
+ */
+std::vector<uint32_t> create_image(int width, int height, std::mt19937& random) {
+
+  const uint32_t palette[] = {
+      0xFF000000, 0xFFFFFFFF, 0xFF3060A0, 0xFFA03020, 0xFF20A040, 0x80102030
+  };
+  std::uniform_int_distribution<int> color(0, 5);
+  std::uniform_int_distribution<int> position(0, width * height - 1);
+  std::uniform_int_distribution<int> size(1, 12);
+
+  std::vector<uint32_t> image(width * height, palette[0]);
+  for (int i = 0; i < 100; ++i) {
+    const int x = position(random) % width;
+    const int y = position(random) / width;
+    const int rect_width = size(random);
+    const int rect_height = size(random);
+    const uint32_t rect_color = palette[color(random)];
+    for (int j = y; j < y + rect_height && j < height; ++j) {
+      for (int k = x; k < x + rect_width && k < width; ++k) {
+        image[j * width + k] = rect_color;
+      }
+    }
+  }
+  return image;
+}
+
+/**
+ * \brief Applies Scale2x with its straightforward definition.
+ */
+std::vector<uint32_t> scale2x(const std::vector<uint32_t>& src, int width, int height) {
+
+  std::vector<uint32_t> dst(width * height * 4);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const uint32_t b = src[(y == 0 ? y : y - 1) * width + x];
+      const uint32_t d = src[y * width + (x == 0 ? x : x - 1)];
+      const uint32_t e = src[y * width + x];
+      const uint32_t f = src[y * width + (x == width - 1 ? x : x + 1)];
+      const uint32_t h = src[(y == height - 1 ? y : y + 1) * width + x];
+      const bool edge = b != h && d != f;
+      uint32_t* dst_pixel = &dst[(y * 2) * width * 2 + x * 2];
+      dst_pixel[0] = (edge && d == b) ? d : e;
+      dst_pixel[1] = (edge && b == f) ? f : e;
+      dst_pixel[width * 2] = (edge && d == h) ? d : e;
+      dst_pixel[width * 2 + 1] = (edge && h == f) ? f : e;
+    }
+  }
+  return dst;
+}
+
+/**
+ * \brief Checks that filtering bands in parallel gives the same result
+ * as filtering the whole image at once.
+ */
+void check_parallel(
+    const SoftwarePixelFilter& filter,
+    const std::vector<uint32_t>& image,
+    int width,
+    int height,
+    ThreadPool& thread_pool,
+    const std::string& name
+) {
+  const int factor = filter.get_scaling_factor();
+  std::vector<uint32_t> sequential(width * height * factor * factor);
+  std::vector<uint32_t> parallel(sequential.size());
+
+  filter.filter(image.data(), width, height, sequential.data());
+  filter.filter(image.data(), width, height, parallel.data(), thread_pool);
+  Debug::check_assertion(sequential == parallel, "Parallel " + name + " differs");
+}
+
+/**
+ * \brief Checks the Scale2x implementation against its definition.
+ */
+void test_scale2x(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+  for (const int size: { 1, 2, 37 }) {
+    const std::vector<uint32_t>& image = create_image(size, size + 3, random);
+    std::vector<uint32_t> result(image.size() * 4);
+    Scale2xFilter().filter(image.data(), size, size + 3, result.data());
+    Debug::check_assertion(result == scale2x(image, size, size + 3),
+        "Wrong Scale2x result with size " + std::to_string(size));
+  }
+}
+
+/**
+ * \brief Checks all filters when the image is split into bands.
+ */
+void test_parallel(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+  const int width = 160;
+  const int height = 123;  // Bands of different heights.
+  const std::vector<uint32_t>& image = create_image(width, height, random);
+  ThreadPool thread_pool(3);
+
+  check_parallel(Scale2xFilter(), image, width, height, thread_pool, "Scale2x");
+  check_parallel(Hq2xFilter(), image, width, height, thread_pool, "hq2x");
+  check_parallel(Hq3xFilter(), image, width, height, thread_pool, "hq3x");
+  check_parallel(Hq4xFilter(), image, width, height, thread_pool, "hq4x");
+}
+
+}
+
+/**
+ * Tests for software pixel filters.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_scale2x(env);
+  test_parallel(env);
+
+  return 0;
+}
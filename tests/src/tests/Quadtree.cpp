@@ -18,6 +18,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Rectangle.h"
 #include "test_tools/TestEnvironment.h"
+#include <algorithm>
 #include <memory>
 #include <sstream>
 
@@ -234,6 +235,180 @@ void test_move_limit(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree)
   Debug::check_assertion(quadtree.get_num_elements() == num_elements, "Wrong number of elements");
 }
 
+/**
+ * \brief Tests that elements overlapping several cells are only returned once
+ * and that result vectors can be reused.
+ */
+void test_get_elements_reuse(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  ElementPtr big_element = add(quadtree, Box(0, 0, 800, 800));
+
+  std::vector<ElementPtr> found_elements;
+  for (int i = 0; i < 3; ++i) {
+    found_elements.clear();
+    quadtree.get_elements(quadtree.get_space(), found_elements);
+
+    std::vector<ElementPtr> unique_elements = found_elements;
+    std::sort(unique_elements.begin(), unique_elements.end());
+    unique_elements.erase(
+        std::unique(unique_elements.begin(), unique_elements.end()),
+        unique_elements.end()
+    );
+    Debug::check_assertion(
+        unique_elements.size() == found_elements.size(),
+        "Duplicate elements found"
+    );
+    Debug::check_assertion(
+        std::count(found_elements.begin(), found_elements.end(), big_element) == 1,
+        "Element found several times"
+    );
+  }
+
+  remove(quadtree, big_element);
+  found_elements.clear();
+  quadtree.get_elements(quadtree.get_space(), found_elements);
+  Debug::check_assertion(
+      std::find(found_elements.begin(), found_elements.end(), big_element) == found_elements.end(),
+      "Removed element still found"
+  );
+}
+
+}
+
+/**
+ * \brief Tests that for_each_element() visits the same elements as get_elements().
+ */
+void test_for_each_element(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  std::vector<ElementPtr> added_elements;
+  for (int i = 0; i < 40; ++i) {
+    added_elements.push_back(add(quadtree, Box(i * 24, 100 + (i % 5) * 40, 32, 32)));
+  }
+
+  const Box region(100, 100, 400, 120);
+  std::vector<ElementPtr> expected_elements;
+  quadtree.get_elements(region, expected_elements);
+
+  std::vector<Element*> visited_elements;
+  quadtree.for_each_element(region, [&visited_elements](const ElementPtr& element) {
+    visited_elements.push_back(element.get());
+  });
+
+  Debug::check_assertion(visited_elements.size() == expected_elements.size(),
+      "Wrong number of elements visited");
+  for (const ElementPtr& element : expected_elements) {
+    Debug::check_assertion(
+        std::count(visited_elements.begin(), visited_elements.end(), element.get()) == 1,
+        "Element not visited exactly once"
+    );
+  }
+
+  for (const ElementPtr& element : added_elements) {
+    remove(quadtree, element);
+  }
+}
+
+/**
+ * \brief Tests adding many elements at once to a quadtree.
+ */
+void test_add_all(TestEnvironment& /* env */, Quadtree<ElementPtr>& shared_quadtree) {
+
+  // Start from an empty quadtree to compare with incremental adds.
+  Quadtree<ElementPtr> quadtree(shared_quadtree.get_space());
+
+  std::vector<std::pair<ElementPtr, Box>> elements;
+  for (int i = 0; i < 100; ++i) {
+    const Box rectangle((i % 10) * 96, (i / 10) * 64, 16, 16);
+    elements.emplace_back(std::make_shared<Element>(rectangle), rectangle);
+  }
+  // Outside the space.
+  const Box outside_rectangle(-500, -500, 16, 16);
+  elements.emplace_back(std::make_shared<Element>(outside_rectangle), outside_rectangle);
+  // Twice the same element.
+  elements.push_back(elements.front());
+
+  const int num_added = quadtree.add_all(elements);
+  Debug::check_assertion(num_added == 101, "Wrong number of elements added");
+  check_num_elements(quadtree, 101);
+
+  // Same results as elements added one by one.
+  Quadtree<ElementPtr> incremental_quadtree(quadtree.get_space());
+  for (size_t i = 0; i < 101; ++i) {
+    incremental_quadtree.add(elements[i].first, elements[i].second);
+  }
+  const Box region(150, 100, 300, 200);
+  std::vector<ElementPtr> found_elements = quadtree.get_elements(region);
+  std::vector<ElementPtr> expected_elements = incremental_quadtree.get_elements(region);
+  std::sort(found_elements.begin(), found_elements.end());
+  std::sort(expected_elements.begin(), expected_elements.end());
+  Debug::check_assertion(!found_elements.empty(), "Expected elements found");
+  Debug::check_assertion(found_elements == expected_elements, "Wrong elements found");
+
+  for (size_t i = 0; i < 101; ++i) {
+    Debug::check_assertion(quadtree.remove(elements[i].first), "Failed to remove element");
+  }
+  check_num_elements(quadtree, 0);
+}
+
+/**
+ * \brief Checks creating a quadtree with all its elements.
+ */
+void test_bulk_constructor(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  std::vector<std::pair<ElementPtr, Box>> elements;
+  for (int i = 0; i < 50; ++i) {
+    const Box rectangle((i % 10) * 128, (i / 10) * 192, 32, 32);
+    elements.emplace_back(std::make_shared<Element>(rectangle), rectangle);
+  }
+
+  Quadtree<ElementPtr> bulk_quadtree(quadtree.get_space(), elements);
+  check_num_elements(bulk_quadtree, 50);
+  for (const std::pair<ElementPtr, Box>& element : elements) {
+    Debug::check_assertion(bulk_quadtree.contains(element.first), "Missing element");
+  }
+  std::vector<ElementPtr> found_elements = bulk_quadtree.get_elements(Box(0, 0, 160, 224));
+  Debug::check_assertion(found_elements.size() == 4, "Wrong number of elements found");
+}
+
+/**
+ * \brief Checks moving elements in a loose quadtree.
+ */
+void test_loose_move(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  Quadtree<ElementPtr> loose_quadtree(quadtree.get_space());
+  loose_quadtree.set_looseness(16);
+  Debug::check_assertion(loose_quadtree.get_looseness() == 16, "Wrong looseness");
+
+  std::vector<ElementPtr> elements;
+  for (int i = 0; i < 100; ++i) {
+    const Box rectangle((i % 10) * 96, (i / 10) * 64, 16, 16);
+    elements.push_back(std::make_shared<Element>(rectangle));
+    loose_quadtree.add(elements.back(), rectangle);
+  }
+
+  // Small moves keep the nodes but queries use the exact boxes.
+  const ElementPtr& element = elements[11];
+  Debug::check_assertion(loose_quadtree.move(element, Box(100, 72, 16, 16)), "Move failed");
+  check_num_elements(loose_quadtree, 100);
+  Debug::check_assertion(loose_quadtree.get_elements(Box(96, 64, 4, 4)).empty(),
+      "Element found at its previous position");
+  std::vector<ElementPtr> found_elements = loose_quadtree.get_elements(Box(114, 86, 4, 4));
+  Debug::check_assertion(found_elements.size() == 1 && found_elements[0] == element,
+      "Element not found at its new position");
+
+  // Bigger moves change the nodes.
+  Debug::check_assertion(loose_quadtree.move(element, Box(600, 500, 16, 16)), "Move failed");
+  check_num_elements(loose_quadtree, 100);
+  found_elements = loose_quadtree.get_elements(Box(600, 500, 16, 16));
+  Debug::check_assertion(found_elements.size() == 1 && found_elements[0] == element,
+      "Element not found after a big move");
+
+  // Same results after changing the looseness.
+  loose_quadtree.set_looseness(0);
+  check_num_elements(loose_quadtree, 100);
+  found_elements = loose_quadtree.get_elements(Box(600, 500, 16, 16));
+  Debug::check_assertion(found_elements.size() == 1 && found_elements[0] == element,
+      "Element not found after a rebuild");
 }
 
 /**
@@ -255,6 +430,11 @@ int main(int argc, char** argv) {
   test_remove(env, quadtree);
   test_move(env, quadtree);
   test_move_limit(env, quadtree);
+  test_get_elements_reuse(env, quadtree);
+  test_for_each_element(env, quadtree);
+  test_add_all(env, quadtree);
+  test_bulk_constructor(env, quadtree);
+  test_loose_move(env, quadtree);
 
   return 0;
 }
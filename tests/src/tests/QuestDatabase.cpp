@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestDatabase.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks the numeric ids of resource elements.
+ */
+void test_resource_ids(TestEnvironment& /* env */) {
+
+  QuestDatabase database;
+  Debug::check_assertion(database.add(ResourceType::SPRITE, "hero/tunic1", "Tunic 1"),
+      "Failed to add an element");
+  Debug::check_assertion(database.add(ResourceType::SPRITE, "hero/sword1", "Sword 1"),
+      "Failed to add an element");
+  Debug::check_assertion(database.add(ResourceType::MAP, "hero/tunic1", "Same id, other type"),
+      "Failed to add an element of another type");
+  Debug::check_assertion(!database.add(ResourceType::SPRITE, "hero/tunic1", "Duplicate"),
+      "Duplicate element added");
+
+  const QuestDatabase::ResourceId tunic_id =
+      database.get_resource_id(ResourceType::SPRITE, "hero/tunic1");
+  const QuestDatabase::ResourceId sword_id =
+      database.get_resource_id(ResourceType::SPRITE, "hero/sword1");
+  Debug::check_assertion(tunic_id != QuestDatabase::invalid_resource_id, "Missing id");
+  Debug::check_assertion(sword_id != QuestDatabase::invalid_resource_id, "Missing id");
+  Debug::check_assertion(tunic_id != sword_id, "Two elements with the same id");
+  Debug::check_assertion(database.get_resource_id(ResourceType::SPRITE, "hero/shield1") ==
+      QuestDatabase::invalid_resource_id, "Unexpected id");
+
+  // Removed elements do not exist anymore but keep their id.
+  Debug::check_assertion(database.remove(ResourceType::SPRITE, "hero/tunic1"),
+      "Failed to remove an element");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SPRITE, "hero/tunic1"),
+      "Removed element still exists");
+  Debug::check_assertion(database.resource_exists(ResourceType::MAP, "hero/tunic1"),
+      "Element of another type removed");
+  database.add(ResourceType::SPRITE, "hero/tunic1", "Tunic 1");
+  Debug::check_assertion(database.get_resource_id(ResourceType::SPRITE, "hero/tunic1") == tunic_id,
+      "Id changed after adding the element again");
+
+  // Renaming declares a new id.
+  Debug::check_assertion(database.rename(ResourceType::SPRITE, "hero/sword1", "hero/sword2"),
+      "Failed to rename an element");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SPRITE, "hero/sword1"),
+      "Old id still exists");
+  Debug::check_assertion(database.resource_exists(ResourceType::SPRITE, "hero/sword2"),
+      "New id does not exist");
+  Debug::check_assertion(database.get_description(ResourceType::SPRITE, "hero/sword2") == "Sword 1",
+      "Description lost by renaming");
+
+  database.clear();
+  Debug::check_assertion(!database.resource_exists(ResourceType::MAP, "hero/tunic1"),
+      "Element still exists after clear");
+  Debug::check_assertion(database.get_resource_elements(ResourceType::SPRITE).empty(),
+      "Elements still listed after clear");
+}
+
+}
+
+/**
+ * \brief Tests the resource lists of the quest database.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_resource_ids(env);
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Random.h"
+#include "test_tools/TestEnvironment.h"
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Returns the first numbers of a stream.
+ */
+std::vector<int> get_numbers(Random::Stream& stream) {
+
+  std::vector<int> numbers;
+  for (int i = 0; i < 100; ++i) {
+    numbers.push_back(stream.get_number(1000000));
+  }
+  return numbers;
+}
+
+/**
+ * \brief Checks that a stream only depends on its key.
+ */
+void test_keys() {
+
+  const uint64_t key = Random::create_key();
+  Random::Stream stream_1(key);
+  Random::Stream stream_2(key);
+  Random::Stream other_stream(Random::derive_key(key, 1));
+
+  const std::vector<int> numbers = get_numbers(stream_1);
+  Debug::check_assertion(get_numbers(stream_2) == numbers,
+      "Streams with the same key should give the same numbers");
+  Debug::check_assertion(get_numbers(other_stream) != numbers,
+      "Streams with different keys should give different numbers");
+  Debug::check_assertion(stream_1.get_counter() == 100, "Wrong counter");
+
+  Debug::check_assertion(Random::derive_key(key, 1) == Random::derive_key(key, 1),
+      "Derived keys should only depend on their parameters");
+  Debug::check_assertion(Random::derive_key(key, 1) != Random::derive_key(key, 2),
+      "Derived keys should be different");
+
+  // Another thread computes the same sequence.
+  std::vector<int> thread_numbers;
+  std::thread thread([&] {
+    Random::Stream thread_stream(key);
+    thread_numbers = get_numbers(thread_stream);
+  });
+  thread.join();
+  Debug::check_assertion(thread_numbers == numbers,
+      "A stream should give the same numbers in any thread");
+}
+
+/**
+ * \brief Checks the bounds of numbers.
+ */
+void test_bounds() {
+
+  Random::Stream stream(Random::create_key());
+  for (int i = 0; i < 1000; ++i) {
+    const int number = stream.get_number(-3, 5);
+    Debug::check_assertion(number >= -3 && number < 5, "Number out of bounds");
+  }
+  Debug::check_assertion(stream.get_number(0) == 0, "Wrong number in an empty interval");
+  Debug::check_assertion(stream.get_number(1) == 0, "Wrong number in a single value interval");
+}
+
+/**
+ * \brief Checks that a stream scope redirects Random::get_number().
+ */
+void test_scope() {
+
+  const uint64_t key = Random::create_key();
+  Random::Stream expected_stream(key);
+  Random::Stream stream(key);
+
+  const uint32_t state_hash = Random::get_state_hash();
+  {
+    Random::StreamScope scope(stream);
+    for (int i = 0; i < 10; ++i) {
+      Debug::check_assertion(Random::get_number(1000000) == expected_stream.get_number(1000000),
+          "Random::get_number() should use the current stream");
+    }
+  }
+  Debug::check_assertion(Random::get_state_hash() == state_hash,
+      "The stream scope changed the generator of the thread");
+
+  Random::get_number(1000000);
+  Debug::check_assertion(Random::get_state_hash() != state_hash,
+      "The generator of the thread should be used again after the scope");
+  Debug::check_assertion(stream.get_counter() == 10, "Wrong counter");
+}
+
+}
+
+/**
+ * \brief Tests for the counter-based random streams.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_keys();
+  test_bounds();
+  test_scope();
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/RecyclingPool.h"
+#include "solarus/entities/Camera.h"
+#include "solarus/entities/Hero.h"
+#include "solarus/movements/StraightMovement.h"
+#include "test_tools/TestEnvironment.h"
+#include <memory>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that freed blocks are reused for the same size.
+ */
+void test_reuse() {
+
+  RecyclingPool::clear();
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 0, "Pool not empty");
+
+  void* block = RecyclingPool::allocate(100);
+  RecyclingPool::deallocate(block, 100);
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 1, "Block not kept");
+
+  // Sizes are rounded: a block of almost the same size can be reused.
+  void* other_block = RecyclingPool::allocate(110);
+  Debug::check_assertion(other_block == block, "Block not reused");
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 0, "Block still free");
+  RecyclingPool::deallocate(other_block, 110);
+
+  // But not for a different size.
+  void* small_block = RecyclingPool::allocate(16);
+  Debug::check_assertion(small_block != block, "Block of another size reused");
+  RecyclingPool::deallocate(small_block, 16);
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 2, "Expected 2 free blocks");
+
+  RecyclingPool::clear();
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 0, "Pool not cleared");
+}
+
+/**
+ * \brief Checks the limits of the pool.
+ */
+void test_limits() {
+
+  RecyclingPool::clear();
+
+  // Big blocks are not kept.
+  void* big_block = RecyclingPool::allocate(RecyclingPool::max_block_size + 1);
+  RecyclingPool::deallocate(big_block, RecyclingPool::max_block_size + 1);
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 0, "Big block kept");
+
+  // Only a few blocks are kept for each size.
+  const std::size_t num_blocks = RecyclingPool::max_free_blocks_per_size + 2;
+  void* blocks[num_blocks];
+  for (std::size_t i = 0; i < num_blocks; ++i) {
+    blocks[i] = RecyclingPool::allocate(64);
+  }
+  for (std::size_t i = 0; i < num_blocks; ++i) {
+    RecyclingPool::deallocate(blocks[i], 64);
+  }
+  Debug::check_assertion(
+      RecyclingPool::get_num_free_blocks() == RecyclingPool::max_free_blocks_per_size,
+      "Too many blocks kept"
+  );
+
+  RecyclingPool::clear();
+}
+
+/**
+ * \brief Checks that shared objects reuse the memory of previous ones.
+ */
+void test_shared_objects() {
+
+  RecyclingPool::clear();
+
+  std::shared_ptr<StraightMovement> movement =
+      make_recycled_shared<StraightMovement>(false, true);
+  movement->set_speed(64);
+  const StraightMovement* address = movement.get();
+  movement = nullptr;
+  Debug::check_assertion(RecyclingPool::get_num_free_blocks() == 1, "Movement memory not kept");
+
+  movement = make_recycled_shared<StraightMovement>(false, true);
+  Debug::check_assertion(movement.get() == address, "Movement memory not reused");
+  Debug::check_assertion(movement->get_speed() == 0, "Movement not constructed again");
+
+  // Objects can be shared with std::shared_from_this() as usual.
+  std::shared_ptr<ExportableToLua> shared = movement->shared_from_this();
+  Debug::check_assertion(shared == movement, "Wrong shared pointer");
+}
+
+/**
+ * \brief Checks that entity states other than hero ones reuse memory too.
+ */
+void test_entity_states(TestEnvironment& env) {
+
+  env.run_map("traversable");
+  Camera& camera = *env.get_map().get_camera();
+  const EntityPtr hero = std::static_pointer_cast<Entity>(env.get_hero().shared_from_this());
+
+  camera.start_tracking(hero);
+  camera.update();
+  const Entity::State* tracking_state = &camera.get_state();
+
+  // The previous state is only destroyed at the next update.
+  camera.start_manual();
+  camera.update();
+  camera.start_tracking(hero);
+  Debug::check_assertion(&camera.get_state() == tracking_state, "State memory not reused");
+}
+
+}
+
+/**
+ * \brief Tests for the pool of recycled memory blocks.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_reuse();
+  test_limits();
+  test_shared_objects();
+  test_entity_states(env);
+
+  return 0;
+}
+
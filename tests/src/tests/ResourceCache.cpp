@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/ResourceCache.h"
+#include "solarus/core/Debug.h"
+#include "test_tools/TestEnvironment.h"
+#include <memory>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+using Cache = ResourceCache<std::string>;
+
+/**
+ * \brief Checks hits and misses of get() and the memory size.
+ */
+void test_get(TestEnvironment& /* env */) {
+
+  Cache cache;
+  Debug::check_assertion(cache.get("a", 1) == nullptr, "Unexpected element");
+
+  cache.add("a", std::make_shared<std::string>("value a"), 100, 2);
+  cache.add("b", std::make_shared<std::string>("value b"), 50, 3);
+  Debug::check_assertion(cache.get_memory_size() == 150, "Wrong memory size");
+
+  std::shared_ptr<std::string> a = cache.get("a", 4);
+  Debug::check_assertion(a != nullptr && *a == "value a", "Wrong element");
+
+  // Replacing an element updates the memory size.
+  cache.add("b", std::make_shared<std::string>("value b2"), 70, 5);
+  Debug::check_assertion(cache.get_memory_size() == 170, "Wrong memory size after replace");
+
+  const ResourceCacheStatistics& statistics = cache.get_statistics();
+  Debug::check_assertion(statistics.hits == 1, "Wrong number of hits");
+  Debug::check_assertion(statistics.misses == 1, "Wrong number of misses");
+  Debug::check_assertion(statistics.num_elements == 2, "Wrong number of elements");
+}
+
+/**
+ * \brief Checks that the least recently used element is evicted first
+ * and that elements in use are never evicted.
+ */
+void test_evict(TestEnvironment& /* env */) {
+
+  Cache cache;
+  cache.add("a", std::make_shared<std::string>("value a"), 10, 1);
+  cache.add("b", std::make_shared<std::string>("value b"), 10, 2);
+  cache.add("c", std::make_shared<std::string>("value c"), 10, 3);
+  cache.get("a", 4);
+
+  uint64_t last_use = 0;
+  Debug::check_assertion(cache.get_least_recently_used(last_use), "No evictable element");
+  Debug::check_assertion(last_use == 2, "Wrong least recently used element");
+
+  // Keep "b" in use: "c" is now the oldest evictable one.
+  std::shared_ptr<std::string> b = cache.get("b", 5);
+  cache.evict_least_recently_used();
+  Debug::check_assertion(!cache.contains("c"), "Wrong element evicted");
+  Debug::check_assertion(cache.contains("b"), "Element in use evicted");
+
+  cache.evict_least_recently_used();
+  Debug::check_assertion(!cache.contains("a"), "Element not evicted");
+
+  cache.evict_least_recently_used();
+  Debug::check_assertion(cache.contains("b"), "Element in use evicted");
+  Debug::check_assertion(!cache.get_least_recently_used(last_use), "Unexpected evictable element");
+  Debug::check_assertion(cache.get_statistics().evictions == 2, "Wrong number of evictions");
+
+  b = nullptr;
+  cache.evict_least_recently_used();
+  Debug::check_assertion(cache.get_memory_size() == 0, "Cache not empty");
+}
+
+/**
+ * \brief Checks removing elements by prefix.
+ */
+void test_remove_prefix(TestEnvironment& /* env */) {
+
+  Cache cache;
+  cache.add("sprites/hero.png", std::make_shared<std::string>(), 10, 1);
+  cache.add("sprites/npc.png", std::make_shared<std::string>(), 10, 2);
+  cache.add("tilesets/house.tiles.png", std::make_shared<std::string>(), 10, 3);
+
+  cache.remove_prefix("sprites/");
+  Debug::check_assertion(!cache.contains("sprites/hero.png"), "Element not removed");
+  Debug::check_assertion(!cache.contains("sprites/npc.png"), "Element not removed");
+  Debug::check_assertion(cache.contains("tilesets/house.tiles.png"), "Wrong element removed");
+  Debug::check_assertion(cache.get_memory_size() == 10, "Wrong memory size");
+}
+
+/**
+ * \brief Checks accessing elements without counting uses.
+ */
+void test_peek(TestEnvironment& /* env */) {
+
+  Cache cache;
+  cache.add("a", std::make_shared<std::string>("value a"), 10, 1);
+  cache.add("b", std::make_shared<std::string>("value b"), 10, 2);
+
+  Debug::check_assertion(*cache.peek("a") == "value a", "Wrong element");
+  Debug::check_assertion(cache.peek("c") == nullptr, "Unexpected element");
+  Debug::check_assertion(cache.get_statistics().hits == 0, "Peek counted as a hit");
+  Debug::check_assertion(cache.get_statistics().misses == 0, "Peek counted as a miss");
+
+  uint64_t last_use = 0;
+  cache.get_least_recently_used(last_use);
+  Debug::check_assertion(last_use == 1, "Peek changed the date of use");
+
+  const std::vector<std::shared_ptr<std::string>>& elements = cache.get_elements();
+  Debug::check_assertion(elements.size() == 2, "Wrong number of elements");
+  Debug::check_assertion(*elements[0] == "value a" && *elements[1] == "value b", "Wrong elements");
+}
+
+}
+
+/**
+ * Tests for the resource cache.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_get(env);
+  test_evict(env);
+  test_remove_prefix(env);
+  test_peek(env);
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Savegame.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks the interning of savegame keys.
+ */
+void test_keys(TestEnvironment& /* env */) {
+
+  Debug::check_assertion(Savegame::KEY_SAVEGAME_VERSION.get_name() == "_version",
+      "Wrong built-in key name");
+  Debug::check_assertion(Savegame::get_key("_current_life").get_id() ==
+      Savegame::KEY_CURRENT_LIFE.get_id(), "Built-in key interned twice");
+
+  Savegame::Key key;
+  Debug::check_assertion(!key.is_valid(), "Default key should be invalid");
+  Debug::check_assertion(!Savegame::find_key("savegame_test_key", key),
+      "Key found before being interned");
+
+  const Savegame::Key& interned_key = Savegame::get_key("savegame_test_key");
+  Debug::check_assertion(interned_key.is_valid(), "Interned key is invalid");
+  Debug::check_assertion(interned_key.get_name() == "savegame_test_key",
+      "Wrong interned key name");
+  Debug::check_assertion(Savegame::find_key("savegame_test_key", key) &&
+      key.get_id() == interned_key.get_id(), "Interned key not found");
+}
+
+/**
+ * \brief Checks setting and getting values by name and by key.
+ */
+void test_values(TestEnvironment& env) {
+
+  Savegame savegame(env.get_main_loop(), "savegame_test.dat");
+
+  savegame.set_integer(Savegame::KEY_MAX_LIFE, 12);
+  Debug::check_assertion(savegame.get_integer("_max_life") == 12, "Wrong integer");
+  Debug::check_assertion(savegame.is_integer(Savegame::KEY_MAX_LIFE), "Not an integer");
+
+  savegame.set_string("savegame_test_string", "hello");
+  const Savegame::Key& string_key = Savegame::get_key("savegame_test_string");
+  Debug::check_assertion(savegame.get_string(string_key) == "hello", "Wrong string");
+  Debug::check_assertion(!savegame.is_boolean(string_key), "Unexpected boolean");
+
+  savegame.set_boolean("savegame_test_boolean", true);
+  Debug::check_assertion(savegame.get_boolean("savegame_test_boolean"), "Wrong boolean");
+
+  savegame.unset(string_key);
+  Debug::check_assertion(!savegame.is_set("savegame_test_string"), "Value still set");
+  Debug::check_assertion(savegame.get_string(string_key).empty(), "Unset value not empty");
+
+  Debug::check_assertion(!savegame.is_set("savegame_never_set"), "Unexpected value");
+  Debug::check_assertion(savegame.get_integer("savegame_never_set") == 0, "Unexpected integer");
+}
+
+}
+
+/**
+ * Tests for the storage of savegame values.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_keys(env);
+  test_values(env);
+
+  return 0;
+}
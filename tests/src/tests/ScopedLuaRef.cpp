@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/lua/LuaTools.h"
+#include "solarus/lua/ScopedLuaRef.h"
+#include "test_tools/TestEnvironment.h"
+#include <lua.hpp>
+#include <utility>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that refs do not use the registry and reuse their slots.
+ */
+void test_pool(lua_State* l) {
+
+  const size_t registry_size = lua_objlen(l, LUA_REGISTRYINDEX);
+
+  lua_newtable(l);
+  ScopedLuaRef ref = LuaTools::create_ref(l, -1);
+  Debug::check_assertion(!ref.is_empty(), "Empty ref");
+  Debug::check_assertion(lua_objlen(l, LUA_REGISTRYINDEX) == registry_size,
+      "Ref stored in the registry");
+
+  ref.push();
+  Debug::check_assertion(lua_rawequal(l, -1, -2), "Wrong referenced value");
+  lua_pop(l, 2);
+
+  const int index = ref.get();
+  ref.clear();
+  Debug::check_assertion(ref.is_empty(), "Ref not cleared");
+
+  lua_pushboolean(l, 1);
+  ScopedLuaRef other_ref = LuaTools::create_ref(l);
+  Debug::check_assertion(other_ref.get() == index, "Slot not reused");
+
+  lua_pushnil(l);
+  ScopedLuaRef nil_ref = LuaTools::create_ref(l);
+  Debug::check_assertion(nil_ref.is_empty(), "Ref to nil not empty");
+  Debug::check_assertion(lua_gettop(l) == 0, "Unbalanced stack");
+}
+
+/**
+ * \brief Checks that moving a ref keeps the same slot.
+ */
+void test_move(lua_State* l) {
+
+  lua_pushinteger(l, 42);
+  ScopedLuaRef ref = LuaTools::create_ref(l);
+  const int index = ref.get();
+
+  ScopedLuaRef moved_ref = std::move(ref);
+  Debug::check_assertion(ref.is_empty(), "Moved ref not empty");
+  Debug::check_assertion(moved_ref.get() == index, "Slot changed by a move");
+
+  ref = std::move(moved_ref);
+  Debug::check_assertion(ref.get() == index, "Slot changed by a move");
+
+  ref.push();
+  Debug::check_assertion(lua_tointeger(l, -1) == 42, "Wrong referenced value");
+  lua_pop(l, 1);
+}
+
+}
+
+/**
+ * \brief Tests for Lua refs.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  lua_State* l = luaL_newstate();
+  test_pool(l);
+  test_move(l);
+  lua_close(l);
+
+  return 0;
+}
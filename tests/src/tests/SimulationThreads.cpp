@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/Savegame.h"
+#include "solarus/core/System.h"
+#include "solarus/lua/LuaContext.h"
+#include "test_tools/TestEnvironment.h"
+#include <lua.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that each thread has its own simulated time.
+ */
+void test_clock(TestEnvironment& env) {
+
+  env.step();
+  const uint32_t main_now = System::now();
+
+  uint32_t thread_start = 1;
+  uint32_t thread_end = 0;
+  std::thread thread([&] {
+    thread_start = System::now();
+    for (int i = 0; i < 3; ++i) {
+      System::update();
+    }
+    thread_end = System::now();
+  });
+  thread.join();
+
+  Debug::check_assertion(thread_start == 0, "The clock of a new thread should start at 0");
+  Debug::check_assertion(thread_end == 3 * System::timestep, "Wrong clock in the thread");
+  Debug::check_assertion(System::now() == main_now, "The thread changed the clock of the main loop");
+}
+
+/**
+ * \brief Checks that each thread has its own random sequence.
+ */
+void test_random() {
+
+  Random::set_seed(1234);
+  const int first = Random::get_number(1000000);
+  const int second = Random::get_number(1000000);
+
+  Random::set_seed(1234);
+  Debug::check_assertion(Random::get_number(1000000) == first, "Wrong first number");
+
+  std::vector<int> thread_numbers;
+  std::thread thread([&] {
+    Random::set_seed(1234);
+    for (int i = 0; i < 2; ++i) {
+      thread_numbers.push_back(Random::get_number(1000000));
+    }
+  });
+  thread.join();
+
+  Debug::check_assertion(Random::get_number(1000000) == second,
+      "The thread changed the random sequence of the main loop");
+  Debug::check_assertion(thread_numbers[0] == first && thread_numbers[1] == second,
+      "The same seed should give the same sequence in another thread");
+}
+
+/**
+ * \brief Checks that a Lua state and its coroutines find their context.
+ */
+void test_lua_context(TestEnvironment& env) {
+
+  LuaContext& lua_context = env.get_main_loop().get_lua_context();
+  lua_State* l = lua_context.get_internal_state();
+  Debug::check_assertion(&LuaContext::get_lua_context(l) == &lua_context,
+      "Wrong context of the main Lua thread");
+
+  lua_State* coroutine = lua_newthread(l);
+  Debug::check_assertion(&LuaContext::get_lua_context(coroutine) == &lua_context,
+      "Wrong context of a coroutine");
+  lua_pop(l, 1);
+}
+
+/**
+ * \brief Checks that savegame keys can be interned from several threads.
+ */
+void test_savegame_keys() {
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 100; ++j) {
+        Savegame::get_key("simulation_threads_key_" + std::to_string(j));
+      }
+    });
+  }
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+
+  for (int j = 0; j < 100; ++j) {
+    const std::string name = "simulation_threads_key_" + std::to_string(j);
+    Savegame::Key key;
+    Debug::check_assertion(Savegame::find_key(name, key) && key.get_name() == name,
+        "Key interned from a thread not found");
+  }
+}
+
+}
+
+/**
+ * \brief Tests for the engine state that belongs to the thread of a simulation.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_clock(env);
+  test_random();
+  test_lua_context(env);
+  test_savegame_keys();
+
+  return 0;
+}
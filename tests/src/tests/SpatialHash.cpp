@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/SpatialHash.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include "test_tools/TestEnvironment.h"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+
+using namespace Solarus;
+
+using Box = Solarus::Rectangle;
+
+namespace {
+
+struct Element {
+  Box rectangle;
+};
+
+using ElementPtr = std::shared_ptr<Element>;
+using ElementHash = SpatialHash<ElementPtr>;
+
+/**
+ * \brief Checks the number of elements of a spatial hash.
+ */
+void check_num_elements(const ElementHash& spatial_hash, int expected) {
+
+  if (spatial_hash.get_num_elements() != expected) {
+    std::ostringstream oss;
+    oss << "Wrong number of elements: expected " << expected << ", got " << spatial_hash.get_num_elements();
+    Debug::die(oss.str());
+  }
+}
+
+/**
+ * \brief Checks that a query returns exactly the elements overlapping it.
+ */
+void check_query(
+    const ElementHash& spatial_hash,
+    const std::vector<ElementPtr>& elements,
+    const Box& region
+) {
+  std::vector<ElementPtr> found_elements = spatial_hash.get_elements(region);
+  std::vector<ElementPtr> expected_elements;
+  for (const ElementPtr& element : elements) {
+    if (element->rectangle.overlaps(region)) {
+      expected_elements.push_back(element);
+    }
+  }
+  std::sort(found_elements.begin(), found_elements.end());
+  std::sort(expected_elements.begin(), expected_elements.end());
+  Debug::check_assertion(found_elements == expected_elements, "Wrong elements found");
+}
+
+/**
+ * \brief Tests adding and removing elements.
+ */
+void test_add_remove(TestEnvironment& /* env */, ElementHash& spatial_hash) {
+
+  std::vector<ElementPtr> elements;
+  for (int i = 0; i < 200; ++i) {
+    ElementPtr element = std::make_shared<Element>();
+    element->rectangle = Box((i % 20) * 24 - 40, (i / 20) * 40 - 40, 16, 16);
+    Debug::check_assertion(spatial_hash.add(element, element->rectangle), "Failed to add element");
+    elements.push_back(element);
+  }
+  check_num_elements(spatial_hash, 200);
+  Debug::check_assertion(!spatial_hash.add(elements[0], elements[0]->rectangle),
+      "Element added twice");
+
+  check_query(spatial_hash, elements, Box(0, 0, 100, 100));
+  check_query(spatial_hash, elements, Box(-64, -64, 640, 480));
+
+  // Big element over many cells: returned once.
+  ElementPtr big_element = std::make_shared<Element>();
+  big_element->rectangle = Box(10, 10, 200, 100);
+  spatial_hash.add(big_element, big_element->rectangle);
+  elements.push_back(big_element);
+  check_query(spatial_hash, elements, Box(0, 0, 320, 240));
+
+  for (const ElementPtr& element : elements) {
+    Debug::check_assertion(spatial_hash.remove(element), "Failed to remove element");
+  }
+  check_num_elements(spatial_hash, 0);
+  Debug::check_assertion(spatial_hash.get_elements(Box(-64, -64, 640, 480)).empty(),
+      "Elements remain after removal");
+}
+
+/**
+ * \brief Tests moving elements inside and across cells.
+ */
+void test_move(TestEnvironment& /* env */, ElementHash& spatial_hash) {
+
+  std::vector<ElementPtr> elements;
+  for (int i = 0; i < 50; ++i) {
+    ElementPtr element = std::make_shared<Element>();
+    element->rectangle = Box((i % 10) * 32, (i / 10) * 32, 16, 16);
+    spatial_hash.add(element, element->rectangle);
+    elements.push_back(element);
+  }
+
+  for (int step = 0; step < 20; ++step) {
+    for (size_t i = 0; i < elements.size(); ++i) {
+      Box& rectangle = elements[i]->rectangle;
+      rectangle.add_xy(static_cast<int>(i % 3) * 3 - 3, static_cast<int>(i % 5) - 2);
+      Debug::check_assertion(spatial_hash.move(elements[i], rectangle), "Failed to move element");
+    }
+    check_query(spatial_hash, elements, Box(40, 40, 120, 80));
+  }
+
+  // Outside the space and back.
+  elements[0]->rectangle = Box(-1000, -1000, 16, 16);
+  spatial_hash.move(elements[0], elements[0]->rectangle);
+  check_query(spatial_hash, elements, Box(-64, -64, 640, 480));
+  elements[0]->rectangle = Box(100, 100, 16, 16);
+  spatial_hash.move(elements[0], elements[0]->rectangle);
+  check_query(spatial_hash, elements, Box(96, 96, 8, 8));
+  check_num_elements(spatial_hash, 50);
+
+  spatial_hash.clear();
+  check_num_elements(spatial_hash, 0);
+}
+
+}
+
+/**
+ * Tests for the spatial hash.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  int margin = 64;
+  Box space(-margin, -margin, 640 + 2 * margin, 480 + 2 * margin);
+  ElementHash spatial_hash(space, Size(32, 32));
+
+  test_add_remove(env, spatial_hash);
+  test_move(env, spatial_hash);
+
+  return 0;
+}
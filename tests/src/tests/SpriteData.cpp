@@ -53,6 +53,20 @@ void check_sprite(TestEnvironment& /* env */, const std::string& sprite_id) {
         << "*** Exported sprite file:" << std::endl << exported_sprite_buffer << std::endl;
     Debug::die("Sprite '" + sprite_id + "': exported file differs from the original one");
   }
+
+  // The binary format must give the same sprite too.
+  std::string binary_sprite_buffer;
+  success = sprite_data.export_to_binary_buffer(
+      binary_sprite_buffer, LuaData::compute_source_hash(imported_sprite_buffer));
+  Debug::check_assertion(success, "Sprite binary export failed");
+  SpriteData binary_sprite_data;
+  success = binary_sprite_data.import_from_binary_buffer(binary_sprite_buffer, file_name);
+  Debug::check_assertion(success, "Sprite binary import failed");
+  success = binary_sprite_data.export_to_buffer(exported_sprite_buffer);
+  Debug::check_assertion(success, "Sprite export failed");
+  if (exported_sprite_buffer != imported_sprite_buffer) {
+    Debug::die("Sprite '" + sprite_id + "': binary sprite differs from the original one");
+  }
 }
 
 }
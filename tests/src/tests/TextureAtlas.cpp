@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/TextureAtlas.h"
+#include "test_tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that the space of released images is used again.
+ */
+void test_reuse() {
+
+  TextureAtlas::Page page(Size(64, 64));
+  Point first;
+  Point second;
+  Point third;
+  Debug::check_assertion(page.allocate(Size(16, 16), first), "No room for the first image");
+  Debug::check_assertion(page.allocate(Size(16, 16), second), "No room for the second image");
+  Debug::check_assertion(page.allocate(Size(16, 16), third), "No room for the third image");
+  Debug::check_assertion(first == Point(0, 0) && second == Point(16, 0), "Wrong positions");
+
+  // A narrower image goes where a released one was.
+  page.release(second, Size(16, 16));
+  Point position;
+  Debug::check_assertion(page.allocate(Size(8, 16), position), "No room for a smaller image");
+  Debug::check_assertion(position == second, "Released space not reused");
+
+  // After releasing everything, the whole page can be used again.
+  page.release(position, Size(8, 16));
+  page.release(first, Size(16, 16));
+  page.release(third, Size(16, 16));
+  Debug::check_assertion(page.allocate(Size(64, 64), position), "Page not empty again");
+  Debug::check_assertion(position == Point(0, 0), "Wrong position in the empty page");
+}
+
+/**
+ * \brief Checks that freed neighbors merge into bigger spaces.
+ */
+void test_merge() {
+
+  TextureAtlas::Page page(Size(64, 64));
+  Point positions[4];
+  for (Point& position: positions) {
+    Debug::check_assertion(page.allocate(Size(12, 16), position), "No room for an image");
+  }
+  Point tail;
+  Debug::check_assertion(page.allocate(Size(16, 16), tail), "No room for the last image");
+
+  page.release(positions[1], Size(12, 16));
+  page.release(positions[3], Size(12, 16));
+  page.release(positions[2], Size(12, 16));
+
+  // The three released images leave room for a wider one.
+  Point position;
+  Debug::check_assertion(page.allocate(Size(36, 16), position), "Spaces not merged");
+  Debug::check_assertion(position == positions[1], "Wrong merged position");
+}
+
+}
+
+/**
+ * \brief Tests for texture atlas pages.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_reuse();
+  test_merge();
+
+  return 0;
+}
@@ -52,6 +52,20 @@ void check_tileset(TestEnvironment& /* env */, const std::string& tileset_id) {
         << "*** Exported tileset file:" << std::endl << exported_tileset_buffer << std::endl;
     Debug::die("Tileset '" + tileset_id + "': exported file differs from the original one");
   }
+
+  // The binary format must give the same tileset too.
+  std::string binary_tileset_buffer;
+  success = tileset_data.export_to_binary_buffer(
+      binary_tileset_buffer, LuaData::compute_source_hash(imported_tileset_buffer));
+  Debug::check_assertion(success, "Tileset binary export failed");
+  TilesetData binary_tileset_data;
+  success = binary_tileset_data.import_from_binary_buffer(binary_tileset_buffer, file_name);
+  Debug::check_assertion(success, "Tileset binary import failed");
+  success = binary_tileset_data.export_to_buffer(exported_tileset_buffer);
+  Debug::check_assertion(success, "Tileset export failed");
+  if (exported_tileset_buffer != imported_tileset_buffer) {
+    Debug::die("Tileset '" + tileset_id + "': binary tileset differs from the original one");
+  }
 }
 
 }
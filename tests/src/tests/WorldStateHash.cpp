@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/WorldStateHash.h"
+#include "test_tools/TestEnvironment.h"
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+const std::string file_name = "world_state_hash_test.txt";
+
+/**
+ * \brief Returns the state of a small fake tick.
+ */
+std::vector<WorldStateHash::Component> create_tick(int hero_x, int enemy_x) {
+
+  return {
+      { "random", WorldStateHash::combine(WorldStateHash::initial_hash, 42) },
+      { "hero", WorldStateHash::combine(WorldStateHash::initial_hash, hero_x) },
+      { "entity 0 enemy 'bat'", WorldStateHash::combine(WorldStateHash::initial_hash, enemy_x) },
+  };
+}
+
+/**
+ * \brief Checks that hashes only depend on their inputs.
+ */
+void test_combine() {
+
+  const uint64_t initial_hash = WorldStateHash::initial_hash;
+  Debug::check_assertion(
+      WorldStateHash::combine(initial_hash, 1) == WorldStateHash::combine(initial_hash, 1),
+      "Hashes of the same value differ");
+  Debug::check_assertion(
+      WorldStateHash::combine(initial_hash, 1) != WorldStateHash::combine(initial_hash, 2),
+      "Hashes of different values are equal");
+  Debug::check_assertion(
+      WorldStateHash::combine(WorldStateHash::combine(initial_hash, std::string("ab")), std::string("c")) !=
+      WorldStateHash::combine(WorldStateHash::combine(initial_hash, std::string("a")), std::string("bc")),
+      "Consecutive strings are confused");
+  Debug::check_assertion(
+      WorldStateHash::get_world_hash(create_tick(1, 2)) == WorldStateHash::get_world_hash(create_tick(1, 2)),
+      "World hashes of the same state differ");
+  Debug::check_assertion(
+      WorldStateHash::get_world_hash(create_tick(1, 2)) != WorldStateHash::get_world_hash(create_tick(1, 3)),
+      "World hashes of different states are equal");
+}
+
+/**
+ * \brief Checks that hashing the random generator does not change it.
+ */
+void test_random_state() {
+
+  Random::set_seed(1234);
+  const uint32_t state_hash = Random::get_state_hash();
+  const int number = Random::get_number(1000000);
+
+  Random::set_seed(1234);
+  Debug::check_assertion(Random::get_state_hash() == state_hash,
+      "Random state hash differs with the same seed");
+  Debug::check_assertion(Random::get_number(1000000) == number,
+      "Random state hash consumed a number");
+  Debug::check_assertion(Random::get_state_hash() != state_hash,
+      "Random state hash does not follow the generator");
+}
+
+/**
+ * \brief Checks that a run identical to the reference has no divergence.
+ */
+void test_identical_run() {
+
+  {
+    WorldStateHash recording;
+    Debug::check_assertion(recording.start_recording(file_name),
+        "Failed to create the reference");
+    for (int tick = 0; tick < 10; ++tick) {
+      Debug::check_assertion(recording.add_tick(create_tick(tick, 100 - tick)),
+          "Recording should not diverge");
+    }
+  }
+
+  WorldStateHash checking;
+  Debug::check_assertion(checking.start_checking(file_name),
+      "Failed to open the reference");
+  for (int tick = 0; tick < 10; ++tick) {
+    Debug::check_assertion(checking.add_tick(create_tick(tick, 100 - tick)),
+        "Identical run diverges: " + checking.get_divergence());
+  }
+  Debug::check_assertion(checking.get_divergence().empty(), "Unexpected divergence");
+
+  // The reference has no more ticks.
+  Debug::check_assertion(!checking.add_tick(create_tick(10, 90)),
+      "Tick missing in the reference not detected");
+  Debug::check_assertion(!checking.is_enabled(), "Checking should stop after a divergence");
+}
+
+/**
+ * \brief Checks that the first diverging tick and component are reported.
+ */
+void test_divergence() {
+
+  WorldStateHash checking;
+  Debug::check_assertion(checking.start_checking(file_name),
+      "Failed to open the reference");
+  for (int tick = 0; tick < 3; ++tick) {
+    Debug::check_assertion(checking.add_tick(create_tick(tick, 100 - tick)),
+        "Identical ticks diverge: " + checking.get_divergence());
+  }
+  Debug::check_assertion(!checking.add_tick(create_tick(3, 0)),
+      "Divergence not detected");
+  Debug::check_assertion(
+      checking.get_divergence() == "World state diverges at tick 3: entity 0 enemy 'bat'",
+      "Wrong divergence: " + checking.get_divergence());
+}
+
+}
+
+/**
+ * \brief Tests for the world state hashes used to compare runs.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_combine();
+  test_random_state();
+  test_identical_run();
+  test_divergence();
+
+  return 0;
+}
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2006-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Arguments.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestDatabase.h"
+#include "solarus/core/ResourceType.h"
+#include "solarus/core/Size.h"
+#include "solarus/entities/EntityData.h"
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace Solarus;
+
+/**
+ * \brief Options of the generator.
+ */
+struct GeneratorOptions {
+  std::string map_id;             /**< Id of the map to write. */
+  std::string quest_path;         /**< Quest where to write the map. */
+  int width = 1280;               /**< Width of the map in pixels. */
+  int height = 960;               /**< Height of the map in pixels. */
+  std::string tileset_id = "castle";  /**< Tileset of the map. */
+  std::string ground_pattern = "3";   /**< Pattern covering the whole map. */
+  std::string enemy_breed = "test_enemy";  /**< Breed of enemies. */
+  uint32_t seed = 0;              /**< Seed of the positions. */
+  int num_tiles = 1000;           /**< Number of decoration tiles. */
+  int num_dynamic_tiles = 100;    /**< Number of dynamic tiles. */
+  int num_enemies = 50;           /**< Number of enemies. */
+  int num_custom_entities = 200;  /**< Number of custom entities with collision tests. */
+  int num_separators = 4;         /**< Number of vertical separators. */
+  int num_streams = 50;           /**< Number of streams. */
+  int num_crystal_blocks = 50;    /**< Number of crystal blocks. */
+};
+
+/**
+ * \brief Traversable 16x16 patterns of the castle tileset used as decorations.
+ */
+const std::vector<std::string> decoration_patterns = {
+    "5", "68", "69", "70", "71", "72", "73", "74", "75", "76"
+};
+
+/**
+ * \brief Animated 16x16 patterns of the castle tileset used as dynamic tiles.
+ */
+const std::vector<std::string> dynamic_patterns = {
+    "6", "7", "8"
+};
+
+/**
+ * \brief Prints the usage of the program.
+ * \param program_name Name of the executable.
+ */
+void print_help(const std::string& program_name) {
+
+  std::cout << "Usage: " << program_name << " -map=<map_id> [options] quest_path"
+            << std::endl << std::endl
+            << "Writes a map with many entities to the quest, for benchmarks and"
+            << " performance tests." << std::endl
+            << "The map is also declared in the quest database." << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  -help                  shows this help message and exits" << std::endl
+            << "  -map=<map_id>          id of the map to write (required)" << std::endl
+            << "  -width=<w>             width of the map in pixels (default 1280)" << std::endl
+            << "  -height=<h>            height of the map in pixels (default 960)" << std::endl
+            << "  -tileset=<id>          tileset of the map (default castle)" << std::endl
+            << "  -ground-pattern=<id>   pattern covering the map (default 3)" << std::endl
+            << "  -enemy-breed=<id>      breed of enemies (default test_enemy)" << std::endl
+            << "  -seed=<n>              seed of the random positions (default 0)" << std::endl
+            << "  -tiles=<n>             decoration tiles (default 1000)" << std::endl
+            << "  -dynamic-tiles=<n>     animated dynamic tiles (default 100)" << std::endl
+            << "  -enemies=<n>           enemies (default 50)" << std::endl
+            << "  -custom-entities=<n>   moving custom entities with collision tests (default 200)" << std::endl
+            << "  -separators=<n>        vertical separators (default 4)" << std::endl
+            << "  -streams=<n>           streams (default 50)" << std::endl
+            << "  -crystal-blocks=<n>    crystal blocks (default 50)" << std::endl;
+}
+
+/**
+ * \brief Parses a non-negative integer option if it is present.
+ * \param args The command-line arguments.
+ * \param key Name of the option.
+ * \param[in,out] result The integer parsed, unchanged if the option is missing.
+ * \return \c false if the option has an invalid value.
+ */
+template<typename T>
+bool parse_count(const Arguments& args, const std::string& key, T& result) {
+
+  const std::string& value = args.get_argument_value(key);
+  if (value.empty()) {
+    return true;
+  }
+  std::istringstream iss(value);
+  long long count = 0;
+  if (!(iss >> count) || !iss.eof() || count < 0) {
+    std::cerr << "Invalid value for " << key << ": '" << value << "'" << std::endl;
+    return false;
+  }
+  result = static_cast<T>(count);
+  return true;
+}
+
+/**
+ * \brief Places entities at random positions of a grid.
+ */
+class Placer {
+
+  public:
+
+    /**
+     * \brief Creates a placer for a map.
+     * \param options Size of the map and seed.
+     */
+    explicit Placer(const GeneratorOptions& options):
+      random(options.seed),
+      x_cell(0, options.width / 8 - 3),
+      y_cell(0, options.height / 8 - 3) {
+
+    }
+
+    /**
+     * \brief Returns a random top-left position aligned on 8 pixels.
+     * \return A position where a 16x16 entity fits in the map.
+     */
+    Point get_position() {
+      return Point(x_cell(random) * 8, y_cell(random) * 8);
+    }
+
+    /**
+     * \brief Returns a random integer in [0, n[.
+     * \param n The number of values.
+     * \return A random integer.
+     */
+    int get_number(int n) {
+      return std::uniform_int_distribution<int>(0, n - 1)(random);
+    }
+
+  private:
+
+    std::mt19937 random;                          /**< Generator of positions. */
+    std::uniform_int_distribution<int> x_cell;    /**< Columns of 8 pixels. */
+    std::uniform_int_distribution<int> y_cell;    /**< Rows of 8 pixels. */
+
+};
+
+/**
+ * \brief Creates a 16x16 entity whose origin is at the bottom center.
+ * \param type Type of entity.
+ * \param layer Layer of the entity.
+ * \param top_left Top-left corner of the entity.
+ * \return The entity data.
+ */
+EntityData create_sprite_entity(EntityType type, int layer, const Point& top_left) {
+
+  EntityData entity(type);
+  entity.set_layer(layer);
+  entity.set_xy(top_left + Point(8, 13));
+  return entity;
+}
+
+/**
+ * \brief Creates the map data.
+ * \param options What to put on the map.
+ * \return The map.
+ */
+MapData create_map(const GeneratorOptions& options) {
+
+  MapData map;
+  map.set_size(Size(options.width, options.height));
+  map.set_min_layer(0);
+  map.set_max_layer(2);
+  map.set_tileset_id(options.tileset_id);
+
+  Placer placer(options);
+
+  EntityData ground(EntityType::TILE);
+  ground.set_integer("width", options.width);
+  ground.set_integer("height", options.height);
+  ground.set_string("pattern", options.ground_pattern);
+  map.add_entity(ground);
+
+  // Decorations that cannot be merged with the ground.
+  for (int i = 0; i < options.num_tiles; ++i) {
+    EntityData tile(EntityType::TILE);
+    tile.set_layer(i % 2);
+    tile.set_xy(placer.get_position());
+    tile.set_string("pattern",
+        decoration_patterns[placer.get_number(decoration_patterns.size())]);
+    map.add_entity(tile);
+  }
+
+  for (int i = 0; i < options.num_dynamic_tiles; ++i) {
+    EntityData tile(EntityType::DYNAMIC_TILE);
+    tile.set_name("stress_dynamic_tile_" + std::to_string(i + 1));
+    tile.set_layer(1);
+    tile.set_xy(placer.get_position());
+    tile.set_string("pattern",
+        dynamic_patterns[placer.get_number(dynamic_patterns.size())]);
+    map.add_entity(tile);
+  }
+
+  // Separators split the map in regions of the same width.
+  for (int i = 0; i < options.num_separators; ++i) {
+    EntityData separator(EntityType::SEPARATOR);
+    const int x = (options.width * (i + 1) / (options.num_separators + 1)) / 8 * 8;
+    separator.set_xy(Point(x, 0));
+    separator.set_integer("width", 16);
+    separator.set_integer("height", options.height);
+    map.add_entity(separator);
+  }
+
+  for (int i = 0; i < options.num_streams; ++i) {
+    EntityData stream = create_sprite_entity(EntityType::STREAM, 0, placer.get_position());
+    stream.set_integer("direction", placer.get_number(8));
+    map.add_entity(stream);
+  }
+
+  for (int i = 0; i < options.num_crystal_blocks; ++i) {
+    EntityData crystal_block(EntityType::CRYSTAL_BLOCK);
+    crystal_block.set_xy(placer.get_position());
+    crystal_block.set_integer("subtype", i % 2);
+    map.add_entity(crystal_block);
+  }
+
+  for (int i = 0; i < options.num_enemies; ++i) {
+    EntityData enemy = create_sprite_entity(EntityType::ENEMY, 0, placer.get_position());
+    enemy.set_name("stress_enemy_" + std::to_string(i + 1));
+    enemy.set_integer("direction", placer.get_number(4));
+    enemy.set_string("breed", options.enemy_breed);
+    map.add_entity(enemy);
+  }
+
+  // Custom entities get their collision tests and movements from the map script.
+  for (int i = 0; i < options.num_custom_entities; ++i) {
+    EntityData custom_entity = create_sprite_entity(EntityType::CUSTOM, 0, placer.get_position());
+    custom_entity.set_name("stress_custom_" + std::to_string(i + 1));
+    custom_entity.set_integer("direction", placer.get_number(4));
+    custom_entity.set_string("sprite", "entities/pot");
+    map.add_entity(custom_entity);
+  }
+
+  EntityData destination = create_sprite_entity(EntityType::DESTINATION, 0,
+      Point(options.width / 2 / 8 * 8, options.height / 2 / 8 * 8));
+  destination.set_integer("direction", 3);
+  map.add_entity(destination);
+
+  return map;
+}
+
+/**
+ * \brief Writes the script of the map.
+ * \param file_name The script file to write.
+ * \param options Options the map was generated with.
+ * \return \c true in case of success.
+ */
+bool save_map_script(const std::string& file_name, const GeneratorOptions& options) {
+
+  std::ofstream out(file_name.c_str());
+  out << "local map = ...\n"
+      << "\n"
+      << "-- Generated by stress_map_generator with the seed " << options.seed << ".\n"
+      << "-- Custom entities move randomly and test collisions with everything.\n"
+      << "-- The map does not exit by itself.\n"
+      << "\n"
+      << "function map:on_started()\n"
+      << "\n"
+      << "  local index = 0\n"
+      << "  for entity in map:get_entities(\"stress_custom_\") do\n"
+      << "    index = index + 1\n"
+      << "    entity:add_collision_test(\"overlapping\", function() end)\n"
+      << "    entity:add_collision_test(\"sprite\", function() end)\n"
+      << "    local movement = sol.movement.create(\"random\")\n"
+      << "    movement:set_speed(32 + index % 32)\n"
+      << "    movement:start(entity)\n"
+      << "  end\n"
+      << "end\n";
+  return static_cast<bool>(out);
+}
+
+/**
+ * \brief Declares the map in the quest database if it is not there yet.
+ * \param file_name The quest database file.
+ * \param map_id Id of the map.
+ * \return \c true in case of success.
+ */
+bool declare_map(const std::string& file_name, const std::string& map_id) {
+
+  QuestDatabase database;
+  if (!database.import_from_file(file_name)) {
+    return false;
+  }
+  if (database.resource_exists(ResourceType::MAP, map_id)) {
+    return true;
+  }
+  database.add(ResourceType::MAP, map_id, "Generated stress map");
+  return database.export_to_file(file_name);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Entry point of the stress map generator.
+ *
+ * Usage: stress_map_generator -map=<map_id> [options] quest_path
+ *
+ * Writes a map with configurable numbers of tiles, dynamic tiles, enemies,
+ * custom entities with collision tests, separators, streams and crystal
+ * blocks at random positions.
+ * The same options and seed always give the same map, so that measures of
+ * solarus-bench on generated maps can be compared from one run to another.
+ *
+ * \param argc Number of command-line arguments.
+ * \param argv Command-line arguments.
+ * \return 0 if the map was written.
+ */
+int main(int argc, char** argv) {
+
+  using namespace Solarus;
+
+  const Arguments args(argc, argv);
+  const std::string program_name = argc > 0 ? argv[0] : "stress_map_generator";
+
+  if (args.has_argument("-help")) {
+    print_help(program_name);
+    return 0;
+  }
+
+  GeneratorOptions options;
+  options.map_id = args.get_argument_value("-map");
+  const std::vector<std::string>& arguments = args.get_arguments();
+  if (!arguments.empty() && !arguments.back().empty() && arguments.back()[0] != '-') {
+    options.quest_path = arguments.back();
+  }
+  if (options.map_id.empty() || options.quest_path.empty()) {
+    std::cerr << "Missing map id or quest path" << std::endl;
+    print_help(program_name);
+    return 1;
+  }
+
+  const std::string& tileset_value = args.get_argument_value("-tileset");
+  if (!tileset_value.empty()) {
+    options.tileset_id = tileset_value;
+  }
+  const std::string& ground_pattern_value = args.get_argument_value("-ground-pattern");
+  if (!ground_pattern_value.empty()) {
+    options.ground_pattern = ground_pattern_value;
+  }
+  const std::string& enemy_breed_value = args.get_argument_value("-enemy-breed");
+  if (!enemy_breed_value.empty()) {
+    options.enemy_breed = enemy_breed_value;
+  }
+  if (!parse_count(args, "-width", options.width) ||
+      !parse_count(args, "-height", options.height) ||
+      !parse_count(args, "-seed", options.seed) ||
+      !parse_count(args, "-tiles", options.num_tiles) ||
+      !parse_count(args, "-dynamic-tiles", options.num_dynamic_tiles) ||
+      !parse_count(args, "-enemies", options.num_enemies) ||
+      !parse_count(args, "-custom-entities", options.num_custom_entities) ||
+      !parse_count(args, "-separators", options.num_separators) ||
+      !parse_count(args, "-streams", options.num_streams) ||
+      !parse_count(args, "-crystal-blocks", options.num_crystal_blocks)) {
+    return 1;
+  }
+  if (options.width < 32 || options.height < 32 ||
+      options.width % 8 != 0 || options.height % 8 != 0) {
+    std::cerr << "The size of the map must be a multiple of 8 of at least 32x32" << std::endl;
+    return 1;
+  }
+
+  const std::string data_path = options.quest_path + "/data/";
+  const std::string map_path = data_path + "maps/" + options.map_id;
+  if (!create_map(options).export_to_file(map_path + ".dat")) {
+    std::cerr << "Cannot write map data file '" << map_path << ".dat'" << std::endl;
+    return 1;
+  }
+  if (!save_map_script(map_path + ".lua", options)) {
+    std::cerr << "Cannot write map script '" << map_path << ".lua'" << std::endl;
+    return 1;
+  }
+  if (!declare_map(data_path + "project_db.dat", options.map_id)) {
+    std::cerr << "Cannot declare the map in '" << data_path << "project_db.dat'" << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote map '" << options.map_id << "'" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,11 @@
+-- Custom entity model counting how many times its script runs.
+local entity = ...
+
+model_script_counter_runs = (model_script_counter_runs or 0) + 1
+
+local count = 0
+
+function entity:increment()
+  count = count + 1
+  return count
+end
@@ -0,0 +1,63 @@
+-- Tests for entities that become dormant far from the camera.
+
+local map = ...
+
+local function create_entity(x, y)
+  return map:create_custom_entity({
+    layer = 0,
+    x = x,
+    y = y,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  assert_equal(map:get_activity_distance(), 64)
+
+  local near = create_entity(100, 100)
+  local far = create_entity(1200, 100)
+  local always_active = create_entity(1200, 150)
+  always_active:set_always_active()
+  assert(always_active:is_always_active())
+  local custom_distance = create_entity(700, 100)
+  custom_distance:set_optimization_distance(1000)
+
+  local far_timer_done = false
+  sol.timer.start(far, 50, function()
+    far_timer_done = true
+  end)
+  local always_active_timer_done = false
+  sol.timer.start(always_active, 50, function()
+    always_active_timer_done = true
+  end)
+
+  sol.timer.start(map, 100, function()
+    assert(not near:is_dormant())
+    assert(far:is_dormant())
+    assert(not always_active:is_dormant())
+    assert(not custom_distance:is_dormant())
+
+    -- Timers of dormant entities wait.
+    assert(not far_timer_done)
+    assert(always_active_timer_done)
+
+    -- Pausing and resuming the game keeps dormant entities asleep.
+    local game = map:get_game()
+    game:set_suspended(true)
+    game:set_suspended(false)
+    assert(far:is_dormant())
+    assert(not near:is_dormant())
+
+    -- Without activity distance, everything wakes up.
+    map:set_activity_distance(nil)
+    assert_equal(map:get_activity_distance(), nil)
+    sol.timer.start(map, 100, function()
+      assert(not far:is_dormant())
+      assert(far_timer_done)
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,3 @@
+local map = ...
+
+-- Map used by solarus-bench: it does not exit by itself.
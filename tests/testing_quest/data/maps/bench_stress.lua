@@ -0,0 +1,42 @@
+local map = ...
+
+-- Stress map used by the performance tests: it does not exit by itself.
+-- Many entities move, collide and run timers at the same time.
+
+local num_walkers = 300
+local num_blinkers = 100
+
+function map:on_started()
+
+  for i = 1, num_walkers do
+    local walker = map:create_custom_entity({
+      layer = 0,
+      x = 16 + (i * 37) % 608,
+      y = 16 + (i * 53) % 448,
+      width = 16,
+      height = 16,
+      direction = i % 4,
+      sprite = "entities/pot",
+    })
+    walker:set_can_traverse("custom_entity", false)
+    walker:add_collision_test("overlapping", function() end)
+    local movement = sol.movement.create("random")
+    movement:set_speed(32 + i % 32)
+    movement:start(walker)
+  end
+
+  for i = 1, num_blinkers do
+    local blinker = map:create_custom_entity({
+      layer = 1,
+      x = 8 + (i * 61) % 624,
+      y = 8 + (i * 29) % 464,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+    sol.timer.start(map, 10 + i % 50, function()
+      blinker:set_enabled(not blinker:is_enabled())
+      return true
+    end)
+  end
+end
@@ -23,5 +23,15 @@ function map:on_started()
   -- Check an entity with larger sprites.
   check_max_box(hero, -12, -10, 72, 64)
 
+  -- Check that the box follows the entity and its sprites.
+  local x, y = block:get_position()
+  block:set_position(x + 16, y)
+  local block_x, block_y, block_width, block_height = block:get_bounding_box()
+  check_max_box(block, block_x, block_y, block_width, block_height)
+
+  local sprite = block:get_sprite()
+  sprite:set_xy(8, 0)
+  check_max_box(block, block_x, block_y, block_width + 8, block_height)
+
   sol.main.exit()
 end
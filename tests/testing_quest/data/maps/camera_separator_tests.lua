@@ -0,0 +1,30 @@
+-- Tests for the camera stopping on separators.
+
+local map = ...
+local camera = map:get_camera()
+local hero = map:get_hero()
+
+function map:on_opening_transition_finished()
+
+  -- The horizontal separator keeps the camera above it.
+  local x, y = camera:get_position()
+  assert_equal(x, 0)
+  assert_equal(y, 0)
+
+  -- Both separators apply near their intersection.
+  hero:set_position(400, 200)
+  sol.timer.start(map, 100, function()
+    x, y = camera:get_position()
+    assert_equal(x, 160)
+    assert_equal(y, 0)
+
+    -- Below the horizontal separator, only the vertical ones apply.
+    hero:set_position(640, 400)
+    sol.timer.start(map, 100, function()
+      x, y = camera:get_position()
+      assert_equal(x, 480)
+      assert_equal(y, 240)
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,56 @@
+-- Tests for map:cast_ray().
+
+local map = ...
+
+local function create_entity(x, y)
+  return map:create_custom_entity({
+    layer = 0,
+    x = x,
+    y = y,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  local map_width = map:get_size()
+  local mover = create_entity(40, 40)
+  local x, y, width, height = mover:get_bounding_box()
+
+  -- Up to the border of the map.
+  local distance, obstacle = map:cast_ray(mover, 0, 1000)
+  assert_equal(distance, map_width - x - width)
+  assert_equal(obstacle, nil)
+
+  distance, obstacle = map:cast_ray(mover, 2, 1000)
+  assert_equal(distance, y)
+  assert_equal(obstacle, nil)
+
+  -- Limited by the maximum distance.
+  distance, obstacle = map:cast_ray(mover, 0, 10)
+  assert_equal(distance, 10)
+  assert_equal(obstacle, nil)
+
+  -- Stopped by an obstacle entity.
+  local blocker = create_entity(140, 40)
+  blocker:set_traversable_by(false)
+  local blocker_x = blocker:get_bounding_box()
+  distance, obstacle = map:cast_ray(mover, 0, 1000)
+  assert_equal(distance, blocker_x - x - width)
+  assert_equal(obstacle, blocker)
+
+  -- Traversable entities are ignored.
+  blocker:set_traversable_by(true)
+  distance, obstacle = map:cast_ray(mover, 0, 1000)
+  assert_equal(distance, map_width - x - width)
+  assert_equal(obstacle, nil)
+
+  -- Nothing moved.
+  local new_x, new_y = mover:get_bounding_box()
+  assert_equal(new_x, x)
+  assert_equal(new_y, y)
+
+  sol.main.exit()
+end
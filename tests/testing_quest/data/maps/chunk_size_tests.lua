@@ -0,0 +1,48 @@
+-- Tests for unnamed entities created and dropped by chunks around the camera.
+
+local map = ...
+
+local function get_num_custom_entities(min_x, max_x)
+
+  local count = 0
+  for entity in map:get_entities_by_type("custom_entity") do
+    local x = entity:get_position()
+    if x >= min_x and x <= max_x then
+      count = count + 1
+    end
+  end
+  return count
+end
+
+function map:on_started()
+
+  -- Named entities always exist.
+  assert(map:has_entity("far_named"))
+
+  -- Only unnamed entities near the hero are created.
+  assert_equal(get_num_custom_entities(0, 320), 2)
+  assert_equal(get_num_custom_entities(2240, 2560), 1)
+
+  -- An entity changed by a script is kept when the camera goes away.
+  local changed
+  for entity in map:get_entities_by_type("custom_entity") do
+    if entity:get_name() == nil and entity:get_position() == 150 then
+      changed = entity
+    end
+  end
+  changed.changed = true
+
+  local hero = map:get_hero()
+  hero:set_position(2400, 200)
+
+  sol.timer.start(map, 100, function()
+    -- Unnamed entities near the camera are now created.
+    assert_equal(get_num_custom_entities(2240, 2560), 3)
+
+    -- Unchanged ones far from the camera are dropped.
+    assert_equal(get_num_custom_entities(0, 320), 1)
+    assert(changed:exists())
+
+    sol.main.exit()
+  end)
+end
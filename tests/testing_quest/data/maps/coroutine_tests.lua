@@ -0,0 +1,72 @@
+-- Tests for coroutines suspended by waiting functions.
+
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  -- Waiting functions need a coroutine.
+  assert(not pcall(sol.main.wait, 10))
+
+  -- The coroutine runs right away until it waits, and gets its arguments.
+  local steps = {}
+  sol.main.start_coroutine(function(a, b)
+    assert_equal(a, "a")
+    assert_equal(b, 2)
+    steps[#steps + 1] = "started"
+    sol.main.wait(0)
+    steps[#steps + 1] = "waited 0"
+    sol.main.wait(100)
+    steps[#steps + 1] = "waited 100"
+  end, "a", 2)
+  assert_equal(#steps, 1)
+
+  -- The coroutine is returned and ends normally.
+  local co = sol.main.start_coroutine(function()
+    sol.main.wait(10)
+  end)
+  assert_equal(type(co), "thread")
+  assert_equal(coroutine.status(co), "suspended")
+
+  -- Waiting for a movement.
+  local entity = map:create_custom_entity({
+    layer = 0,
+    x = 40,
+    y = 112,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  entity:set_origin(8, 13)
+  local movement_finished = false
+  sol.main.start_coroutine(function()
+    entity:wait_movement()  -- No movement: returns immediately.
+    local movement = sol.movement.create("straight")
+    movement:set_speed(200)
+    movement:set_max_distance(16)
+    movement:start(entity)
+    entity:wait_movement()
+    assert_equal(entity:get_x(), 56)
+    movement_finished = true
+  end)
+
+  -- Waiting for a dialog returns its status.
+  local dialog_status
+  sol.main.start_coroutine(function()
+    dialog_status = game:wait_dialog("_treasure.bomb.1")
+  end)
+  assert(game:is_dialog_enabled())
+  -- Map timers are suspended during the dialog.
+  sol.timer.start(sol.main, 50, function()
+    game:stop_dialog("done")
+  end)
+
+  sol.timer.start(sol.main, 500, function()
+    assert_equal(#steps, 3)
+    assert_equal(steps[2], "waited 0")
+    assert_equal(coroutine.status(co), "dead")
+    assert(movement_finished)
+    assert_equal(dialog_status, "done")
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,57 @@
+-- Tests for map:create_entities().
+
+local map = ...
+
+function map:on_started()
+
+  local num_custom_entities = map:get_entities_count_by_type("custom_entity")
+
+  local descriptions = {}
+  for i = 1, 50 do
+    descriptions[i] = {
+      type = "custom_entity",
+      name = "batch",
+      layer = 0,
+      x = 8 + (i % 10) * 16,
+      y = 16 + math.floor(i / 10) * 16,
+      width = 16,
+      height = 16,
+      direction = 0,
+    }
+  end
+  descriptions[51] = {
+    type = "npc",
+    name = "batch_npc",
+    layer = 0,
+    x = 200,
+    y = 200,
+    direction = 3,
+    subtype = 1,
+  }
+
+  local entities = map:create_entities(descriptions)
+  assert_equal(#entities, 51)
+  assert_equal(entities[1]:get_type(), "custom_entity")
+  assert_equal(entities[51]:get_type(), "npc")
+  assert_equal(entities[51]:get_name(), "batch_npc")
+
+  -- Duplicate names get suffixes as usual.
+  assert_equal(entities[1]:get_name(), "batch")
+  assert_equal(entities[2]:get_name(), "batch_2")
+
+  assert_equal(map:get_entities_count_by_type("custom_entity"), num_custom_entities + 50)
+  assert_equal(map:get_first_entity_in_rectangle(190, 180, 20, 30, "npc"), entities[51])
+
+  -- An invalid description creates nothing.
+  local success = pcall(map.create_entities, map, {
+    { type = "custom_entity", layer = 0, x = 0, y = 0, width = 16, height = 16, direction = 0 },
+    { type = "custom_entity", layer = 0, x = 0 },
+  })
+  assert(not success)
+  assert_equal(map:get_entities_count_by_type("custom_entity"), num_custom_entities + 50)
+
+  success = pcall(map.create_entities, map, { { type = "hero", layer = 0, x = 0, y = 0 } })
+  assert(not success)
+
+  sol.main.exit()
+end
@@ -0,0 +1,38 @@
+-- Tests for crystal blocks following the crystal state.
+
+local map = ...
+
+local function check_animations(orange_animation, blue_animation)
+  assert_equal(orange_block:get_sprite():get_animation(), orange_animation)
+  assert_equal(blue_block:get_sprite():get_animation(), blue_animation)
+end
+
+function map:on_started()
+
+  map:set_crystal_state(false)
+  check_animations("orange_lowered", "blue_raised")
+
+  -- Blocks are updated as soon as the state changes.
+  map:change_crystal_state()
+  assert_equal(map:get_crystal_state(), true)
+  check_animations("orange_raised", "blue_lowered")
+
+  -- Blocks created later get the current state.
+  local block = map:create_crystal_block({
+    layer = 0,
+    x = 160,
+    y = 32,
+    width = 16,
+    height = 16,
+    subtype = 0,
+  })
+  assert_equal(block:get_sprite():get_animation(), "orange_raised")
+
+  -- Disabled blocks are updated too.
+  blue_block:set_enabled(false)
+  map:set_crystal_state(false)
+  check_animations("orange_lowered", "blue_raised")
+  assert_equal(block:get_sprite():get_animation(), "orange_lowered")
+
+  sol.main.exit()
+end
@@ -0,0 +1,81 @@
+local map = ...
+
+local detected = {}
+local in_rectangle = {}
+
+local function create(name, x, y, layer, group)
+
+  local entity = map:create_custom_entity({
+    name = name,
+    layer = layer,
+    x = x,
+    y = y,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  entity:set_collision_group(group)
+  return entity
+end
+
+function map:on_started()
+
+  local detector = create("detector", 160, 120, 0, "bullets")
+  create("same_group", 160, 120, 0, "bullets")
+  create("other_group", 156, 118, 0, "walls")
+  create("other_layer", 160, 120, 1, nil)
+  create("right", 176, 120, 0, nil)
+
+  assert_equal(detector:get_collision_group(), "bullets")
+  assert_equal(other_layer:get_collision_group(), nil)
+
+  detector:add_collision_test({
+    entity_type = "custom_entity",
+    layer = "same",
+    ignore_group = true,
+  }, function(_, other)
+    detected[other:get_name()] = true
+  end)
+
+  -- Relative to the origin of the detector: a strip on its right.
+  detector:add_collision_test({
+    rectangle = { 8, -13, 8, 16 },
+  }, function(_, other)
+    in_rectangle[other:get_name()] = true
+  end)
+
+  -- Traversable test functions called once per tick with the cache.
+  local num_calls = 0
+  local blocker = create("blocker", 240, 120, 0, nil)
+  blocker:set_traversable_by("custom_entity", function()
+    num_calls = num_calls + 1
+    return false
+  end)
+  local mover = create("mover", 224, 120, 0, nil)
+
+  for i = 1, 3 do
+    assert(mover:test_obstacles(8, 0))
+  end
+  assert(num_calls >= 3)
+
+  blocker:set_traversable_cache_enabled(true)
+  assert(blocker:is_traversable_cache_enabled())
+  num_calls = 0
+  for i = 1, 3 do
+    assert(mover:test_obstacles(8, 0))
+  end
+  assert_equal(num_calls, 1)
+end
+
+function map:on_opening_transition_finished()
+
+  sol.timer.start(10, function()
+    assert(detected["other_group"])
+    assert(not detected["same_group"])
+    assert(not detected["other_layer"])
+    assert(not detected["right"])
+    assert(in_rectangle["right"])
+    assert(not in_rectangle["other_group"])
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,65 @@
+local map = ...
+
+-- Whether a point is an obstacle for an entity that traverses walls.
+-- Only the wall half of diagonal walls remains an obstacle.
+local function is_obstacle_point(x, y)
+
+  local ground = map:get_ground(x, y, 0)
+  local x_in_square, y_in_square = x % 8, y % 8
+  if ground == "wall_top_right" then
+    return y_in_square <= x_in_square
+  elseif ground == "wall_top_left" then
+    return y_in_square <= 7 - x_in_square
+  elseif ground == "wall_bottom_left" then
+    return y_in_square >= x_in_square
+  elseif ground == "wall_bottom_right" then
+    return y_in_square >= 7 - x_in_square
+  end
+  return false
+end
+
+-- Whether the border of a rectangle has an obstacle point.
+local function is_obstacle_border(x, y, width, height)
+
+  for i = x, x + width - 1 do
+    if is_obstacle_point(i, y) or is_obstacle_point(i, y + height - 1) then
+      return true
+    end
+  end
+  for j = y, y + height - 1 do
+    if is_obstacle_point(x, j) or is_obstacle_point(x + width - 1, j) then
+      return true
+    end
+  end
+  return false
+end
+
+function map:on_started()
+
+  local mover = map:create_custom_entity({
+    x = 0,
+    y = 0,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  mover:set_can_traverse_ground("wall", true)
+
+  -- Whole squares of diagonal walls must give the same result as each point.
+  local num_obstacles = 0
+  for y = 40, 100 do
+    for x = 120, 200, 3 do
+      mover:set_position(x, y)
+      local box_x, box_y, box_width, box_height = mover:get_bounding_box()
+      local expected = is_obstacle_border(box_x, box_y, box_width, box_height)
+      assert_equal(mover:test_obstacles(0, 0), expected)
+      if expected then
+        num_obstacles = num_obstacles + 1
+      end
+    end
+  end
+  assert(num_obstacles > 0)
+
+  sol.main.exit()
+end
@@ -0,0 +1,52 @@
+-- Tests for the update of drawable objects created by scripts.
+
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  -- Many static surfaces, some of them collected later.
+  local surfaces = {}
+  for i = 1, 1000 do
+    surfaces[i] = sol.surface.create(8, 8)
+  end
+
+  local moving = sol.surface.create(8, 8)
+  local movement = sol.movement.create("straight")
+  movement:set_angle(0)
+  movement:set_speed(120)
+  movement:start(moving)
+
+  local faded = false
+  local fading = sol.surface.create(8, 8)
+  fading:fade_out(5, function()
+    faded = true
+  end)
+
+  for i = 1, 1000, 2 do
+    surfaces[i] = nil
+  end
+  collectgarbage()
+
+  sol.timer.start(map, 500, function()
+    -- Drawables with a movement or transition are still updated.
+    local x, y = moving:get_xy()
+    assert(x > 0)
+    assert_equal(y, 0)
+    assert(faded)
+
+    -- Drawables created now are updated too.
+    local late = sol.surface.create(8, 8)
+    local late_movement = sol.movement.create("straight")
+    late_movement:set_angle(math.pi / 2)
+    late_movement:set_speed(120)
+    late_movement:start(late)
+    surfaces = nil
+    collectgarbage()
+
+    sol.timer.start(map, 200, function()
+      local _, late_y = late:get_xy()
+      assert(late_y < 0)
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,46 @@
+local map = ...
+
+function map:on_started()
+
+  -- Enemies start with the same default consequences.
+  assert_equal(enemy_1:get_attack_consequence("sword"), 1)
+  assert_equal(enemy_2:get_attack_consequence("sword"), 1)
+  assert_equal(enemy_1:get_attack_consequence("explosion"), 2)
+  assert_equal(enemy_1:get_attack_consequence("hookshot"), "immobilized")
+  assert_equal(enemy_1:get_attack_consequence("script"), "ignored")
+
+  -- Changing one enemy does not change the others.
+  enemy_1:set_attack_consequence("sword", 5)
+  assert_equal(enemy_1:get_attack_consequence("sword"), 5)
+  assert_equal(enemy_2:get_attack_consequence("sword"), 1)
+  assert_equal(enemy_1:get_attack_consequence("explosion"), 2)
+
+  enemy_2:set_attack_consequence("explosion", "protected")
+  assert_equal(enemy_2:get_attack_consequence("explosion"), "protected")
+  assert_equal(enemy_1:get_attack_consequence("explosion"), 2)
+
+  -- Sprite-specific consequences.
+  local sprite_1 = enemy_1:get_sprite()
+  local sprite_2 = enemy_2:get_sprite()
+  enemy_2:set_attack_consequence_sprite(sprite_2, "arrow", "ignored")
+  assert_equal(enemy_2:get_attack_consequence_sprite(sprite_2, "arrow"), "ignored")
+  assert_equal(enemy_2:get_attack_consequence("arrow"), 2)
+  assert_equal(enemy_1:get_attack_consequence_sprite(sprite_1, "arrow"), 2)
+
+  -- Back to the defaults.
+  enemy_1:set_default_attack_consequences()
+  assert_equal(enemy_1:get_attack_consequence("sword"), 1)
+
+  -- New enemies of the breed are not affected either.
+  local enemy_3 = map:create_enemy({
+    layer = 0,
+    x = 224,
+    y = 109,
+    direction = 0,
+    breed = "test_enemy",
+  })
+  assert_equal(enemy_3:get_attack_consequence("explosion"), 2)
+  assert_equal(enemy_3:get_attack_consequence("sword"), 1)
+
+  sol.main.exit()
+end
@@ -0,0 +1,88 @@
+local map = ...
+
+local function count_by_type(type, layer)
+
+  local count = 0
+  for entity in map:get_entities_by_type(type) do
+    if layer == nil or entity:get_layer() == layer then
+      count = count + 1
+    end
+  end
+  return count
+end
+
+function map:on_started()
+
+  for i = 1, 10 do
+    map:create_custom_entity({
+      name = "entity_" .. i,
+      layer = i % 3,
+      x = 16 * i,
+      y = 32,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+  end
+  assert(count_by_type("custom_entity") == 10)
+  assert(count_by_type("custom_entity", 0) == 3)
+  assert(count_by_type("custom_entity", 1) == 4)
+  assert(count_by_type("custom_entity", 2) == 3)
+
+  -- Change layers.
+  entity_1:set_layer(0)
+  entity_4:set_layer(2)
+  assert(count_by_type("custom_entity", 0) == 4)
+  assert(count_by_type("custom_entity", 1) == 2)
+  assert(count_by_type("custom_entity", 2) == 4)
+
+  -- Remove entities from the middle and the end of the lists.
+  entity_2:remove()
+  entity_5:remove()
+  entity_10:remove()
+end
+
+function map:on_opening_transition_finished()
+
+  assert(count_by_type("custom_entity") == 7)
+  assert(count_by_type("custom_entity", 0) == 4)
+  assert(count_by_type("custom_entity", 1) == 1)
+  assert(count_by_type("custom_entity", 2) == 2)
+  assert(map:get_entity("entity_2") == nil)
+  assert(map:get_entity("entity_7"):get_layer() == 1)
+
+  -- Removing and adding again reuses the lists.
+  entity_3:remove()
+  map:create_custom_entity({
+    name = "entity_11",
+    layer = 0,
+    x = 16,
+    y = 64,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  -- A new entity can take the name of an entity being removed.
+  local old_entity_6 = entity_6
+  old_entity_6:remove()
+  local new_entity_6 = map:create_custom_entity({
+    name = "entity_6",
+    layer = 0,
+    x = 96,
+    y = 64,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  assert(new_entity_6:get_name() == "entity_6")
+
+  sol.timer.start(map, 10, function()
+    assert(count_by_type("custom_entity") == 7)
+    assert(count_by_type("custom_entity", 0) == 4)
+    assert(count_by_type("custom_entity") == map:get_entities_count("entity_"))
+    assert(map:get_entity("entity_6") == new_entity_6)
+    assert(not old_entity_6:exists())
+    sol.main.exit()
+  end)
+end
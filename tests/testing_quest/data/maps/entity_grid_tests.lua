@@ -0,0 +1,60 @@
+local map = ...
+
+-- This map locates entities with a grid of 16x16 cells instead of a quadtree.
+
+local function count_in_rectangle(x, y, width, height)
+
+  local count = 0
+  for entity in map:get_entities_in_rectangle(x, y, width, height) do
+    if entity:get_type() == "custom_entity" then
+      count = count + 1
+    end
+  end
+  return count
+end
+
+function map:on_started()
+
+  for i = 1, 100 do
+    map:create_custom_entity({
+      name = "bullet_" .. i,
+      layer = 1,
+      x = 16 * ((i - 1) % 10) + 8,
+      y = 16 * math.floor((i - 1) / 10) + 13,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+  end
+  assert_equal(count_in_rectangle(0, 0, 160, 160), 100)
+  assert_equal(count_in_rectangle(0, 0, 16, 16), 1)
+  assert_equal(count_in_rectangle(8, 8, 16, 16), 4)
+
+  -- Moving inside a cell and across cells.
+  bullet_1:set_position(bullet_1:get_position() + 3, 13)
+  assert_equal(count_in_rectangle(0, 0, 3, 16), 0)
+  bullet_1:set_position(250, 200)
+  assert_equal(count_in_rectangle(0, 0, 16, 16), 0)
+  assert_equal(count_in_rectangle(240, 190, 20, 20), 1)
+
+  -- Big entities are found once.
+  local big = map:create_custom_entity({
+    layer = 1,
+    x = 200,
+    y = 100,
+    width = 64,
+    height = 64,
+    direction = 0,
+  })
+  assert_equal(count_in_rectangle(160, 64, 160, 112), 1)
+
+  bullet_50:remove()
+  big:remove()
+end
+
+function map:on_opening_transition_finished()
+
+  assert_equal(count_in_rectangle(0, 0, 320, 240), 99)
+  assert(map:get_entity("bullet_50") == nil)
+  sol.main.exit()
+end
@@ -0,0 +1,113 @@
+-- Tests for the entity queries that don't build lists.
+
+local map = ...
+
+function map:on_started()
+
+  -- Counts by type.
+  assert_equal(map:get_entities_count_by_type("custom_entity"), 3)
+  assert_equal(map:get_entities_count_by_type("npc"), 1)
+  assert_equal(map:get_entities_count_by_type("enemy"), 0)
+
+  -- Iteration by type visits each entity of the type once, layer by layer.
+  local names = {}
+  local num_visited = 0
+  local previous_layer = map:get_min_layer()
+  for entity in map:iterate_entities_by_type("custom_entity") do
+    assert_equal(entity:get_type(), "custom_entity")
+    assert(entity:get_layer() >= previous_layer)
+    previous_layer = entity:get_layer()
+    names[entity:get_name()] = true
+    num_visited = num_visited + 1
+  end
+  assert_equal(num_visited, 3)
+  assert(names.low and names.high and names.top)
+
+  for entity in map:iterate_entities_by_type("enemy") do
+    assert(false)
+  end
+
+  -- Counts and first entity in a rectangle.
+  assert_equal(map:get_entities_count_in_rectangle(32, 32, 40, 40, "custom_entity"), 2)
+  assert_equal(map:get_entities_count_in_rectangle(32, 32, 40, 40, "npc"), 1)
+  assert_equal(map:get_entities_count_in_rectangle(200, 100, 10, 10, "custom_entity"), 0)
+  local num_in_rectangle = 0
+  for entity in map:get_entities_in_rectangle(32, 32, 40, 40) do
+    num_in_rectangle = num_in_rectangle + 1
+  end
+  assert_equal(map:get_entities_count_in_rectangle(32, 32, 40, 40), num_in_rectangle)
+
+  assert_equal(map:get_first_entity_in_rectangle(32, 32, 40, 40, "custom_entity"), low)
+  local first
+  for entity in map:get_entities_in_rectangle(32, 32, 40, 40) do
+    first = entity
+    break
+  end
+  assert_equal(map:get_first_entity_in_rectangle(32, 32, 40, 40), first)
+  assert_equal(map:get_first_entity_in_rectangle(200, 100, 10, 10, "custom_entity"), nil)
+
+  -- Bulk queries give the same results as one call per entity.
+  local entities = { low, high, top, npc }
+  local positions = map:get_entities_positions(entities)
+  assert_equal(#positions, 12)
+  for i, entity in ipairs(entities) do
+    local x, y, layer = entity:get_position()
+    assert_equal(positions[i * 3 - 2], x)
+    assert_equal(positions[i * 3 - 1], y)
+    assert_equal(positions[i * 3], layer)
+  end
+
+  local distances = low:get_distances(entities)
+  local angles = low:get_angles(entities)
+  assert_equal(#distances, 4)
+  assert_equal(#angles, 4)
+  for i, entity in ipairs(entities) do
+    assert_equal(distances[i], low:get_distance(entity))
+    assert_equal(angles[i], low:get_angle(entity))
+  end
+
+  -- A result table can be reused, old values after the end are removed.
+  local reused = map:get_entities_positions({ top }, positions)
+  assert_equal(reused, positions)
+  assert_equal(#positions, 3)
+  assert_equal(positions[4], nil)
+  assert_equal(positions[1], 280)
+
+  local ok = pcall(map.get_entities_positions, map, { low, 42 })
+  assert(not ok)
+
+  -- Prefix queries only visit names starting with the prefix.
+  assert_equal(map:get_entities_count("h"), 2)  -- hero and high.
+  assert_equal(map:get_entities_count("hi"), 1)
+  assert_equal(map:get_entities_count("lo"), 1)
+  assert_equal(map:get_entities_count("u"), 0)
+  assert(map:has_entities("to"))
+  assert(not map:has_entities("tops"))
+  assert(not map:has_entities("a"))
+  for entity in map:get_entities("n") do
+    assert_equal(entity, npc)
+  end
+
+  -- Static detectors are found where they are, even after moving.
+  local sensor = map:create_sensor({
+    layer = 0,
+    x = 200,
+    y = 100,
+    width = 16,
+    height = 16,
+  })
+  assert_equal(map:get_first_entity_in_rectangle(200, 100, 10, 10, "sensor"), sensor)
+  sensor:set_position(96, 160)
+  assert_equal(map:get_entities_count_in_rectangle(200, 100, 10, 10, "sensor"), 0)
+  assert_equal(map:get_first_entity_in_rectangle(96, 160, 10, 10, "sensor"), sensor)
+
+  -- Removed entities are not counted anymore.
+  high:remove()
+  sensor:remove()
+  sol.timer.start(map, 10, function()
+    assert_equal(map:get_entities_count_by_type("custom_entity"), 2)
+    assert_equal(map:get_entities_count_in_rectangle(32, 32, 40, 40, "custom_entity"), 1)
+    assert_equal(map:get_entities_count_by_type("sensor"), 0)
+    sol.main.exit()
+  end)
+end
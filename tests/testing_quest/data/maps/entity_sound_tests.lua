@@ -0,0 +1,23 @@
+-- Tests for sounds played by entities.
+
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local camera_x = map:get_camera():get_position()
+  assert_equal(camera_x, 0)
+
+  -- Sounds are played unless they are too far from the camera.
+  assert_equal(visible:play_sound("bird_chirp"), true)
+  assert_equal(near:play_sound("bird_chirp"), true)
+  assert_equal(far:play_sound("bird_chirp"), false)
+  assert_equal(near:play_sound("bird_chirp", { max_distance = 100 }), false)
+  assert_equal(far:play_sound("bird_chirp", { max_distance = 1000, volume = 50 }), true)
+
+  -- Invalid options.
+  assert(not pcall(visible.play_sound, visible, "bird_chirp", { volume = 200 }))
+  assert(not pcall(visible.play_sound, visible, "bird_chirp", { max_distance = 0 }))
+  assert(not pcall(visible.play_sound, visible, "no_such_sound"))
+
+  sol.main.exit()
+end
@@ -0,0 +1,43 @@
+-- Tests for the functions that have a LuaJIT FFI fast path.
+-- They must behave the same with the fast path and with plain Lua.
+
+local map = ...
+
+function map:on_started()
+
+  local x, y, layer = entity:get_position()
+  assert_equal(x, 40)
+  assert_equal(y, 48)
+  assert_equal(layer, 1)
+  assert_equal(entity:get_layer(), 1)
+
+  local box_x, box_y, width, height = entity:get_bounding_box()
+  local origin_x, origin_y = entity:get_origin()
+  assert_equal(box_x, 40 - origin_x)
+  assert_equal(box_y, 48 - origin_y)
+  assert_equal(width, 16)
+  assert_equal(height, 16)
+
+  entity:set_position(64, 80, 0)
+  x, y, layer = entity:get_position()
+  assert_equal(x, 64)
+  assert_equal(y, 80)
+  assert_equal(layer, 0)
+
+  -- Methods of one type keep checking their argument.
+  local sprite = sol.sprite.create("entities/block")
+  assert(not pcall(entity.get_position, sprite))
+  assert(not pcall(sprite.get_frame, entity))
+  assert(not pcall(entity.get_position, { }))
+
+  sprite:set_frame(0)
+  assert_equal(sprite:get_frame(), 0)
+
+  local timer = sol.timer.start(map, 10000, function() end)
+  local remaining_time = timer:get_remaining_time()
+  assert(remaining_time > 9000 and remaining_time <= 10000)
+  timer:stop()
+  assert_equal(timer:get_remaining_time(), 0)
+
+  sol.main.exit()
+end
@@ -0,0 +1,44 @@
+local map = ...
+
+function map:on_started()
+
+  local file_name = "file_tests.txt"
+
+  -- Synchronous operations.
+  assert(sol.file.write(file_name, "first line\n"))
+  assert(sol.file.append(file_name, "second line\n"))
+  assert_equal(sol.file.read(file_name), "first line\nsecond line\n")
+
+  local content, error_message = sol.file.read("file_tests_missing.txt")
+  assert_equal(content, nil)
+  assert(error_message ~= nil)
+
+  -- Files of the data directory are readable too.
+  assert(sol.file.read("maps/file_tests.lua"):find("file_tests") ~= nil)
+
+  -- Background operations are done in order.
+  local num_written = 0
+  sol.file.write(file_name, "a", function(success)
+    assert(success)
+    assert_equal(num_written, 0)
+    num_written = num_written + 1
+  end)
+  sol.file.append(file_name, "b", function(success)
+    assert(success)
+    assert_equal(num_written, 1)
+    num_written = num_written + 1
+  end)
+  sol.file.read(file_name, function(content)
+    assert_equal(num_written, 2)
+    assert_equal(content, "ab")
+
+    sol.file.read("file_tests_missing.txt", function(content, error_message)
+      assert_equal(content, nil)
+      assert(error_message ~= nil)
+
+      sol.file.remove(file_name)
+      assert(not sol.file.exists(file_name))
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,25 @@
+local map = ...
+
+function map:on_started()
+
+  local file_name = "game_save_tests.dat"
+  local savegame = sol.game.load(file_name)
+  savegame:set_value("saved_value", 1)
+  savegame:save(function(success)
+    assert(success)
+
+    -- Changes made after the save started are not written.
+    local loaded_savegame = sol.game.load(file_name)
+    assert(loaded_savegame:get_value("saved_value") == 1)
+
+    -- Saving without callback still writes immediately.
+    savegame:save()
+    loaded_savegame = sol.game.load(file_name)
+    assert(loaded_savegame:get_value("saved_value") == 2)
+
+    sol.game.delete(file_name)
+    assert(not sol.game.exists(file_name))
+    sol.main.exit()
+  end)
+  savegame:set_value("saved_value", 2)
+end
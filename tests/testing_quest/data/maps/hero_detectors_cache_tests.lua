@@ -0,0 +1,40 @@
+-- Tests for the collisions of the hero with detectors while he stands still.
+
+local map = ...
+
+local num_repeats = 0
+function sensor_below:on_activated_repeat()
+  num_repeats = num_repeats + 1
+end
+
+function map:on_started()
+
+  local new_sensor_activated = false
+
+  sol.timer.start(map, 100, function()
+    -- Detectors still see the hero when nothing moves.
+    assert(num_repeats > 1)
+
+    -- A detector created under the hero finds him.
+    local new_sensor = map:create_sensor({
+      layer = 0,
+      x = 152,
+      y = 112,
+      width = 16,
+      height = 16,
+    })
+    function new_sensor:on_activated()
+      new_sensor_activated = true
+    end
+
+    -- A removed detector is forgotten.
+    sensor_below:remove()
+    local previous_repeats = num_repeats
+
+    sol.timer.start(map, 100, function()
+      assert(new_sensor_activated)
+      assert_equal(num_repeats, previous_repeats)
+      sol.main.exit()
+    end)
+  end)
+end
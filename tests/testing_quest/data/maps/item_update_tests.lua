@@ -0,0 +1,41 @@
+-- Tests for the on_update() event of equipment items.
+
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  local bomb = game:get_item("bomb")
+  local sword = game:get_item("sword")
+  local num_bomb_updates = 0
+  local num_sword_updates = 0
+
+  -- An item defining on_update() is updated.
+  function bomb:on_update()
+    num_bomb_updates = num_bomb_updates + 1
+  end
+
+  sol.timer.start(map, 100, function()
+    assert(num_bomb_updates > 0)
+    assert_equal(num_sword_updates, 0)
+
+    -- Removing on_update() stops updates.
+    bomb.on_update = nil
+    local num_bomb_updates_before = num_bomb_updates
+
+    -- Defining it on the metatable applies to all items.
+    local item_meta = sol.main.get_metatable("item")
+    local updated_items = {}
+    function item_meta:on_update()
+      updated_items[self:get_name()] = true
+    end
+
+    sol.timer.start(map, 100, function()
+      assert_equal(num_bomb_updates, num_bomb_updates_before)
+      assert(updated_items["bomb"])
+      assert(updated_items["sword"])
+      item_meta.on_update = nil
+      sol.main.exit()
+    end)
+  end)
+end
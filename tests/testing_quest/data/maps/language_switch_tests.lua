@@ -0,0 +1,38 @@
+local map = ...
+
+local function check_english()
+  assert_equal(sol.language.get_language(), "en")
+  assert_equal(sol.language.get_string("a"), "test A")
+  assert(sol.language.get_dialog("_treasure.bomb.1") ~= nil)
+  assert(sol.language.get_dialog("sample_dialog") == nil)
+end
+
+local function check_french()
+  assert_equal(sol.language.get_language(), "fr")
+  assert_equal(sol.language.get_string("a"), "test A fr")
+  assert(sol.language.get_string("a.1") == nil)
+  assert(sol.language.get_dialog("_treasure.bomb.1") == nil)
+  assert(sol.language.get_dialog("sample_dialog").text:find("français") ~= nil)
+end
+
+function map:on_started()
+
+  check_english()
+
+  sol.language.set_language("fr")
+  check_french()
+
+  -- Languages set before are kept in memory.
+  sol.language.set_language("en")
+  check_english()
+  sol.language.set_language("fr")
+  check_french()
+
+  -- Setting the same language again parses it again.
+  sol.language.set_language("fr")
+  check_french()
+
+  sol.language.set_language("en")
+  check_english()
+  sol.main.exit()
+end
@@ -0,0 +1,22 @@
+local map = ...
+
+function map:on_started()
+
+  local stats = sol.main.get_memory_stats()
+  local pools = stats.lua_pools
+  assert(pools ~= nil)
+  assert(pools.bytes >= 0)
+  assert(pools.objects >= 0)
+  if pools.objects > 0 then
+    -- The engine allocator is used: small Lua blocks come from the pools.
+    assert(pools.bytes > 0)
+
+    local tables = {}
+    for i = 1, 1000 do
+      tables[i] = { i }
+    end
+    assert(sol.main.get_memory_stats().lua_pools.objects > pools.objects)
+  end
+
+  sol.main.exit()
+end
@@ -0,0 +1,47 @@
+local map = ...
+
+local function find_stack(profile, pattern)
+
+  for _, entry in ipairs(profile) do
+    if entry.stack:match(pattern) then
+      return entry
+    end
+  end
+  return nil
+end
+
+function map:on_started()
+
+  sol.main.start_lua_profiler()
+end
+
+function map:on_update()
+
+  -- Allocate something to measure.
+  local garbage = {}
+  for i = 1, 100 do
+    garbage[i] = { i }
+  end
+end
+
+function map:on_opening_transition_finished()
+
+  sol.main.stop_lua_profiler()
+  local profile = sol.main.get_lua_profile()
+
+  local entry = find_stack(profile, "on_update map maps/lua_profiler_tests.lua:%d+$")
+  assert(entry ~= nil)
+  assert(entry.num_calls > 0)
+  assert(entry.time >= 0)
+  assert(entry.memory > 0)
+
+  -- The current call is not finished and not measured yet.
+  assert(find_stack(profile, "on_opening_transition_finished") == nil)
+
+  -- Starting again forgets previous results.
+  sol.main.start_lua_profiler()
+  sol.main.stop_lua_profiler()
+  assert(#sol.main.get_lua_profile() == 0)
+
+  sol.main.exit()
+end
@@ -0,0 +1,53 @@
+-- Tests for menus attached to a map and to other menus.
+
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local parent = {}
+  local child = {}
+  local behind = {}
+  local parent_updates, child_updates = 0, 0
+  local child_finished = false
+
+  function parent:on_update()
+    parent_updates = parent_updates + 1
+  end
+
+  function child:on_update()
+    child_updates = child_updates + 1
+  end
+
+  function child:on_finished()
+    child_finished = true
+  end
+
+  sol.menu.start(map, parent)
+  sol.menu.start(parent, child)
+  sol.menu.start(map, behind, false)
+  assert(sol.menu.is_started(parent))
+  assert(sol.menu.is_started(child))
+  assert(sol.menu.is_started(behind))
+
+  sol.timer.start(map, 100, function()
+    assert(parent_updates > 0)
+    assert_equal(child_updates, parent_updates)
+
+    -- Stopping a menu stops its children.
+    sol.menu.stop(parent)
+    assert(not sol.menu.is_started(parent))
+    assert(not sol.menu.is_started(child))
+    assert(child_finished)
+    assert(sol.menu.is_started(behind))
+
+    sol.menu.stop_all(map)
+    assert(not sol.menu.is_started(behind))
+
+    -- Menus can be started again in a context whose menus were removed.
+    sol.timer.start(map, 10, function()
+      sol.menu.start(map, parent)
+      assert(sol.menu.is_started(parent))
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,32 @@
+local map = ...
+
+local function create_counter()
+  return map:create_custom_entity({
+    x = 40,
+    y = 40,
+    width = 16,
+    height = 16,
+    direction = 0,
+    layer = 0,
+    model = "model_script_counter",
+  })
+end
+
+function map:on_started()
+
+  local first = create_counter()
+  local second = create_counter()
+  local third = create_counter()
+
+  -- The script runs for each instance.
+  assert_equal(model_script_counter_runs, 3)
+
+  -- Each instance has its own local variables.
+  assert_equal(first:increment(), 1)
+  assert_equal(first:increment(), 2)
+  assert_equal(second:increment(), 1)
+  assert_equal(third:increment(), 1)
+  assert_equal(first:increment(), 3)
+
+  sol.main.exit()
+end
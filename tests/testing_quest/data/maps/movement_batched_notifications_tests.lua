@@ -0,0 +1,76 @@
+-- Tests for movements that notify Lua of their position once per cycle.
+
+local map = ...
+
+function map:on_started()
+
+  local marker = map:create_custom_entity({
+    layer = 0,
+    x = 120,
+    y = 112,
+    width = 8,
+    height = 8,
+    direction = 0,
+  })
+  marker:set_traversable_by(true)
+  local marker_reached = false
+
+  local entity = map:create_custom_entity({
+    layer = 0,
+    x = 40,
+    y = 112,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  entity:set_origin(8, 13)
+  entity:add_collision_test("overlapping", function(_, other)
+    if other == marker then
+      marker_reached = true
+    end
+  end)
+
+  local movement = sol.movement.create("straight")
+  assert(not movement:are_position_notifications_batched())
+  movement:set_position_notifications_batched(true)
+  assert(movement:are_position_notifications_batched())
+  movement:set_angle(0)
+  movement:set_speed(1000)
+  movement:set_smooth(false)
+
+  -- Only the final position of each cycle is notified.
+  local num_entity_calls = 0
+  local last_x = entity:get_x()
+  local last_date = nil
+  function entity:on_position_changed(x, y)
+    assert(x > last_x)
+    assert_equal(y, 112)
+    assert_equal(x, entity:get_x())
+    assert(sol.main.get_elapsed_time() ~= last_date)
+    last_x = x
+    last_date = sol.main.get_elapsed_time()
+    num_entity_calls = num_entity_calls + 1
+  end
+
+  local num_movement_calls = 0
+  function movement:on_position_changed()
+    num_movement_calls = num_movement_calls + 1
+  end
+
+  function movement:on_obstacle_reached()
+    -- The wall tile starts at x = 200.
+    assert_equal(entity:get_x(), 192)
+
+    -- Collisions are still checked at each pixel.
+    assert(marker_reached)
+
+    sol.timer.start(map, 10, function()
+      assert_equal(last_x, 192)
+      assert_equal(num_movement_calls, num_entity_calls)
+      assert(num_entity_calls > 1)
+      assert(num_entity_calls < (192 - 40) / 2)
+      sol.main.exit()
+    end)
+  end
+  movement:start(entity)
+end
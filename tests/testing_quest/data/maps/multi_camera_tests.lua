@@ -0,0 +1,30 @@
+local map = ...
+
+function map:on_started()
+
+  local main_camera = map:get_camera()
+  local cameras = map:get_cameras()
+  assert_equal(#cameras, 1)
+  assert_equal(cameras[1], main_camera)
+
+  main_camera:set_size(160, 240)
+  main_camera:set_position_on_screen(0, 0)
+
+  local second_camera = map:create_camera()
+  assert_equal(second_camera:get_type(), "camera")
+  second_camera:set_size(160, 240)
+  second_camera:set_position_on_screen(160, 0)
+
+  cameras = map:get_cameras()
+  assert_equal(#cameras, 2)
+  assert_equal(cameras[1], main_camera)
+  assert_equal(cameras[2], second_camera)
+  assert_equal(map:get_camera(), main_camera)
+end
+
+function map:on_draw()
+
+  -- Both views were drawn once.
+  assert_equal(#map:get_cameras(), 2)
+  sol.main.exit()
+end
@@ -0,0 +1,58 @@
+local map = ...
+
+-- Returns the color of a pixel of the overview.
+local function get_overview_pixel(x, y)
+
+  local surface = map:get_overview_surface()
+  local width = surface:get_size()
+  local index = (y * width + x) * 4
+  return surface:get_pixels():byte(index + 1, index + 4)
+end
+
+function map:on_started()
+
+  local surface = map:get_overview_surface()
+  local width, height = surface:get_size()
+  assert_equal(width, 40)
+  assert_equal(height, 30)
+
+  -- Without fog, squares with tiles are opaque and empty ones transparent.
+  assert_equal(map:get_overview_reveal_radius(), nil)
+  assert(map:is_overview_revealed(300, 200))
+  local r, g, b, a = get_overview_pixel(0, 0)
+  assert_equal(a, 255)
+  r, g, b, a = get_overview_pixel(30, 0)
+  assert_equal(a, 0)
+
+  -- With fog, only squares around the hero are revealed.
+  map:set_overview_reveal_radius(16)
+  assert_equal(map:get_overview_reveal_radius(), 16)
+  sol.timer.start(map, 10, function()
+    assert(map:is_overview_revealed(24, 29))
+    assert(map:is_overview_revealed(12, 28))
+    assert(not map:is_overview_revealed(4, 4))
+    assert(not map:is_overview_revealed(300, 200))
+    r, g, b, a = get_overview_pixel(3, 3)
+    assert_equal(a, 255)
+    r, g, b, a = get_overview_pixel(0, 0)
+    assert_equal(a, 0)
+
+    map:reveal_overview(4, 4)
+    assert(map:is_overview_revealed(4, 4))
+    r, g, b, a = get_overview_pixel(0, 0)
+    assert_equal(a, 255)
+
+    -- Revealed squares can be saved and restored.
+    local revealed_squares = map:get_overview_revealed_squares()
+    assert_equal(#revealed_squares, 40 * 30)
+    assert_equal(revealed_squares:sub(1, 1), "1")
+    map:set_overview_revealed_squares("")
+    assert(not map:is_overview_revealed(4, 4))
+    map:set_overview_revealed_squares(revealed_squares)
+    assert(map:is_overview_revealed(4, 4))
+
+    map:set_overview_reveal_radius(nil)
+    assert(map:is_overview_revealed(300, 200))
+    sol.main.exit()
+  end)
+end
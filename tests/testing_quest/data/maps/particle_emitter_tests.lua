@@ -0,0 +1,55 @@
+-- Tests for native particle emitters.
+
+local map = ...
+
+function map:on_started()
+
+  -- Parameters are checked.
+  assert(not pcall(sol.particle_emitter.create, {}))
+  assert(not pcall(sol.particle_emitter.create, { image = "wrong_file.png" }))
+  assert(not pcall(sol.particle_emitter.create, { image = "menus/solarus_logo.png", rate = -1 }))
+
+  local emitter = sol.particle_emitter.create({
+    image = "menus/solarus_logo.png",
+    width = 32,
+    height = 16,
+    max_particles = 10,
+    lifetime = 100,
+    speed = 40,
+    speed_variation = 10,
+    angle = math.pi / 2,
+    gravity_y = 100,
+  })
+  assert_equal(sol.main.get_type(emitter), "particle_emitter")
+  local width, height = emitter:get_size()
+  assert_equal(width, 32)
+  assert_equal(height, 16)
+  assert_equal(emitter:get_rate(), 0)
+  assert_equal(emitter:get_num_particles(), 0)
+
+  -- Explicit emissions are limited by the maximum.
+  emitter:emit(4)
+  assert_equal(emitter:get_num_particles(), 4)
+  emitter:emit(20)
+  assert_equal(emitter:get_num_particles(), 10)
+  emitter:clear()
+  assert_equal(emitter:get_num_particles(), 0)
+
+  -- Particles disappear at the end of their lifetime.
+  emitter:emit(3)
+  sol.timer.start(map, 300, function()
+    assert_equal(emitter:get_num_particles(), 0)
+
+    -- Automatic emission.
+    emitter:set_rate(1000)
+    assert_equal(emitter:get_rate(), 1000)
+    sol.timer.start(map, 50, function()
+      assert(emitter:get_num_particles() > 0)
+      sol.main.exit()
+    end)
+  end)
+
+  function map:on_draw(dst_surface)
+    emitter:draw(dst_surface, 100, 100)
+  end
+end
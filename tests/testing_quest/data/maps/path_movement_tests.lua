@@ -0,0 +1,44 @@
+-- Tests for path movements.
+
+local map = ...
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    layer = 0,
+    x = 40,
+    y = 40,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  local movement = sol.movement.create("path")
+  movement:set_path({ 0, 0, 6, 6, 6, 7 })
+  movement:set_speed(240)
+  movement:set_ignore_obstacles(true)
+
+  local path = movement:get_path()
+  assert_equal(#path, 6)
+  assert_equal(path[1], 0)
+  assert_equal(path[3], 6)
+  assert_equal(path[6], 7)
+
+  local directions = {}
+  function movement:on_changed()
+    local direction = movement:get_direction4()
+    if directions[#directions] ~= direction then
+      directions[#directions + 1] = direction
+    end
+  end
+
+  movement:start(entity, function()
+    -- Consecutive moves in the same direction are still 8 pixels each.
+    local x, y = entity:get_position()
+    assert_equal(x, 40 + 16 + 8)
+    assert_equal(y, 40 + 24 + 8)
+    assert_equal(directions[1], 0)
+    assert_equal(directions[2], 3)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,9 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  -- Let teletransporter destinations be prefetched in the background.
+  sol.timer.start(map, 500, function()
+    hero:teleport("prefetch_map_tests/2", "destination")
+  end)
+end
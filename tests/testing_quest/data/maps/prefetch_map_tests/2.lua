@@ -0,0 +1,13 @@
+local map = ...
+
+function map:on_started()
+
+  assert(chest ~= nil)
+  assert_equal(chest:get_sprite():get_animation_set(), "entities/chest")
+  assert_equal(map:get_tileset(), "castle")
+end
+
+function map:on_opening_transition_finished()
+
+  sol.main.exit()
+end
@@ -0,0 +1,15 @@
+local map = ...
+
+function map:on_started()
+
+  assert(not pcall(sol.main.preload_map, "preload_map_tests/does_not_exist"))
+
+  sol.main.preload_map("preload_map_tests/2")
+  -- Preloading twice is allowed.
+  sol.main.preload_map("preload_map_tests/2")
+end
+
+function map:on_opening_transition_finished()
+
+  hero:teleport("preload_map_tests/2", "destination")
+end
@@ -0,0 +1,76 @@
+-- Tests for native projectile pools.
+
+local map = ...
+
+function map:on_started()
+
+  -- Parameters are checked.
+  assert(not pcall(map.create_projectile_pool, map, {}))
+  assert(not pcall(map.create_projectile_pool, map, { image = "wrong_file.png", layer = 0 }))
+  assert(not pcall(map.create_projectile_pool, map, { image = "menus/solarus_logo.png", layer = 10 }))
+  assert(not pcall(map.create_projectile_pool, map, { image = "menus/solarus_logo.png", layer = 0, entity_type = "wrong" }))
+
+  local pool = map:create_projectile_pool({
+    image = "menus/solarus_logo.png",
+    layer = 0,
+    width = 4,
+    height = 4,
+    max_projectiles = 3,
+    entity_type = { "hero", "custom_entity" },
+  })
+  assert_equal(sol.main.get_type(pool), "projectile_pool")
+  assert_equal(pool:get_layer(), 0)
+  local width, height = pool:get_size()
+  assert_equal(width, 4)
+  assert_equal(height, 4)
+  assert_equal(pool:get_max_projectiles(), 3)
+  assert_equal(pool:get_num_projectiles(), 0)
+
+  -- Ids stay valid when other projectiles are removed.
+  local first = pool:create_projectile(20, 20, 0, 0)
+  local second = pool:create_projectile(30, 40, 0, 0)
+  local third = pool:create_projectile(50, 60, 0, 0)
+  assert(first ~= nil and second ~= nil and third ~= nil)
+  assert_equal(pool:create_projectile(10, 10, 0, 0), nil)
+  assert_equal(pool:get_num_projectiles(), 3)
+  pool:remove_projectile(first)
+  assert(not pool:has_projectile(first))
+  assert(pool:has_projectile(third))
+  local x, y = pool:get_projectile_position(third)
+  assert_equal(x, 50)
+  assert_equal(y, 60)
+  assert_equal(pool:get_projectile_position(first), nil)
+  pool:clear()
+  assert_equal(pool:get_num_projectiles(), 0)
+
+  local target = map:create_custom_entity({
+    layer = 0,
+    x = 208,
+    y = 61,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  -- One projectile hits the custom entity, one leaves the map silently.
+  local hit_id = pool:create_projectile(150, 56, 0, 200)
+  pool:create_projectile(150, 20, math.pi / 2, 200)
+
+  local num_hits = 0
+  function pool:on_hits(hits)
+    for _, hit in ipairs(hits) do
+      num_hits = num_hits + 1
+      assert_equal(hit.id, hit_id)
+      assert_equal(hit.entity, target)
+      assert(not pool:has_projectile(hit.id))
+    end
+  end
+
+  sol.timer.start(map, 500, function()
+    assert_equal(num_hits, 1)
+    assert_equal(pool:get_num_projectiles(), 0)
+
+    map:remove_projectile_pool(pool)
+    sol.main.exit()
+  end)
+end
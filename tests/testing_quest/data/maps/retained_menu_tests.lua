@@ -0,0 +1,53 @@
+-- Tests for menus whose draws are recorded and replayed.
+
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local retained = {}
+  local normal = {}
+  local retained_draws, normal_draws = 0, 0
+  local square = sol.surface.create(16, 16)
+
+  function retained:on_draw(dst_surface)
+    retained_draws = retained_draws + 1
+    dst_surface:fill_color({ 0, 0, 0, 128 }, 0, 0, 64, 16)
+    square:draw(dst_surface, 4, 4)
+    square:draw_region(0, 0, 8, 8, dst_surface, 4, 20)
+  end
+
+  function normal:on_draw(dst_surface)
+    normal_draws = normal_draws + 1
+  end
+
+  assert(not sol.menu.is_retained(retained))
+  assert(not pcall(sol.menu.set_retained, retained, true))
+
+  sol.menu.start(map, retained)
+  sol.menu.start(map, normal)
+  sol.menu.set_retained(retained, true)
+  assert(sol.menu.is_retained(retained))
+  assert(not sol.menu.is_retained(normal))
+
+  sol.timer.start(map, 100, function()
+    -- on_draw() is only called the first time.
+    assert_equal(retained_draws, math.min(normal_draws, 1))
+
+    sol.menu.invalidate(retained)
+    local previous_normal_draws = normal_draws
+    sol.timer.start(map, 100, function()
+      -- Recorded again once after being invalidated.
+      local expected_draws = math.min(previous_normal_draws, 1) +
+          math.min(normal_draws - previous_normal_draws, 1)
+      assert_equal(retained_draws, expected_draws)
+
+      sol.menu.set_retained(retained, false)
+      assert(not sol.menu.is_retained(retained))
+      retained_draws, normal_draws = 0, 0
+      sol.timer.start(map, 100, function()
+        assert_equal(retained_draws, normal_draws)
+        sol.main.exit()
+      end)
+    end)
+  end)
+end
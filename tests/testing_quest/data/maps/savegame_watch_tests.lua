@@ -0,0 +1,53 @@
+-- Tests for game:watch_value().
+
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  local calls = {}
+  game:watch_value("savegame_watch_tests_value", function(watched_game, key, value)
+    assert_equal(watched_game, game)
+    assert_equal(key, "savegame_watch_tests_value")
+    calls[#calls + 1] = value
+  end)
+
+  local num_once_calls = 0
+  game:watch_value("savegame_watch_tests_value", function()
+    num_once_calls = num_once_calls + 1
+    return false
+  end)
+
+  -- Changes are delivered at the next cycle, once per value.
+  game:set_value("savegame_watch_tests_value", 1)
+  game:set_value("savegame_watch_tests_value", 2)
+  game:set_value("savegame_watch_tests_value", 3)
+  assert_equal(#calls, 0)
+
+  sol.timer.start(map, 10, function()
+    assert_equal(#calls, 1)
+    assert_equal(calls[1], 3)
+    assert_equal(num_once_calls, 1)
+
+    -- Setting the same value is not a change.
+    game:set_value("savegame_watch_tests_value", 3)
+    sol.timer.start(map, 10, function()
+      assert_equal(#calls, 1)
+
+      game:set_value("savegame_watch_tests_value", nil)
+      sol.timer.start(map, 10, function()
+        assert_equal(#calls, 2)
+        assert_equal(calls[2], nil)
+        assert_equal(num_once_calls, 1)
+
+        -- Saved doors follow their variable.
+        assert(saved_door:is_closed())
+        game:set_value("savegame_watch_tests_door", true)
+        sol.timer.start(map, 10, function()
+          assert(saved_door:is_opening() or saved_door:is_open())
+          sol.main.exit()
+        end)
+      end)
+    end)
+  end)
+end
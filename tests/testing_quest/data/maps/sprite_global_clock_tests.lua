@@ -0,0 +1,30 @@
+local map = ...
+
+local function create_walking_sprite()
+
+  local sprite = sol.sprite.create("hero/tunic1")
+  sprite:set_animation("walking")
+  return sprite
+end
+
+function map:on_started()
+
+  local first_sprite = create_walking_sprite()
+  assert(not first_sprite:is_global_clock_enabled())
+  first_sprite:set_global_clock_enabled()
+  assert(first_sprite:is_global_clock_enabled())
+
+  -- Start a second sprite later: the clock should still synchronize them.
+  sol.timer.start(map, 250, function()
+    local second_sprite = create_walking_sprite()
+    second_sprite:set_global_clock_enabled(true)
+
+    sol.timer.start(map, 350, function()
+      assert(first_sprite:get_frame() == second_sprite:get_frame())
+
+      second_sprite:set_global_clock_enabled(false)
+      assert(not second_sprite:is_global_clock_enabled())
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,32 @@
+local map = ...
+
+local function create_walking_sprite()
+
+  local sprite = sol.sprite.create("hero/tunic1")
+  sprite:set_animation("walking")
+  return sprite
+end
+
+function map:on_started()
+
+  -- Without events, this sprite is only brought up to date when used.
+  local lazy_sprite = create_walking_sprite()
+
+  -- This one is updated at each cycle to call its event.
+  local observed_sprite = create_walking_sprite()
+  local num_frame_changes = 0
+  function observed_sprite:on_frame_changed()
+    num_frame_changes = num_frame_changes + 1
+  end
+
+  sol.timer.start(map, 350, function()
+    assert(num_frame_changes > 0)
+    assert(lazy_sprite:get_frame() ~= 0)
+    assert_equal(lazy_sprite:get_frame(), observed_sprite:get_frame())
+
+    -- Changing the animation still works from a late frame.
+    lazy_sprite:set_animation("stopped")
+    assert_equal(lazy_sprite:get_frame(), 0)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,52 @@
+-- Tests for straight movements reaching obstacles.
+
+local map = ...
+
+function map:on_started()
+
+  local marker = map:create_custom_entity({
+    layer = 0,
+    x = 120,
+    y = 112,
+    width = 8,
+    height = 8,
+    direction = 0,
+  })
+  marker:set_traversable_by(true)
+  local marker_reached = false
+
+  local entity = map:create_custom_entity({
+    layer = 0,
+    x = 40,
+    y = 112,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  entity:set_origin(8, 13)
+  entity:add_collision_test("overlapping", function(_, other)
+    if other == marker then
+      marker_reached = true
+    end
+  end)
+
+  -- A fast movement must still go through every pixel.
+  local last_x = entity:get_x()
+  function entity:on_position_changed(x, y)
+    assert(x == last_x + 1)
+    assert(y == 112)
+    last_x = x
+  end
+
+  local movement = sol.movement.create("straight")
+  movement:set_angle(0)
+  movement:set_speed(1000)
+  movement:set_smooth(false)
+  function movement:on_obstacle_reached()
+    -- The wall tile starts at x = 200.
+    assert(entity:get_x() == 192)
+    assert(marker_reached)
+    sol.main.exit()
+  end
+  movement:start(entity)
+end
@@ -31,7 +31,125 @@ local function test_set_pixels()
   assert_equal(a, 255)
 end
 
+-- Test for surface:lock_pixels().
+local function test_lock_pixels()
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({255, 64, 0, 255})
+
+  local pixel_buffer = surface:lock_pixels(4, 2, 8, 20)
+  assert(pixel_buffer:is_locked())
+  assert_equal(pixel_buffer:get_surface(), surface)
+  local x, y, width, height = pixel_buffer:get_region()
+  assert_equal(x, 4)
+  assert_equal(y, 2)
+  assert_equal(width, 8)
+  assert_equal(height, 14)  -- Clipped to the surface.
+  assert_equal(#pixel_buffer:get_pixels(), 8 * 14 * 4)
+
+  local r, g, b, a = pixel_buffer:get_pixel(0, 0)
+  assert_equal(r, 255)
+  assert_equal(g, 64)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+
+  pixel_buffer:set_pixel(1, 0, 10, 20, 30)
+  pixel_buffer:set_pixel(2, 0, 10, 20, 30, 40)
+  r, g, b, a = pixel_buffer:get_pixel(2, 0)
+  assert_equal(r, 10)
+  assert_equal(g, 20)
+  assert_equal(b, 30)
+  assert_equal(a, 40)
+  pixel_buffer:unlock()
+  assert(not pixel_buffer:is_locked())
+  assert(not pcall(pixel_buffer.get_pixel, pixel_buffer, 0, 0))
+
+  -- Pixel (1, 0) of the buffer is pixel (5, 2) of the surface.
+  local pixels = surface:get_pixels()
+  local index = (2 * 16 + 5) * 4
+  r, g, b, a = pixels:byte(index + 1, index + 4)
+  assert_equal(r, 10)
+  assert_equal(g, 20)
+  assert_equal(b, 30)
+  assert_equal(a, 255)
+  r, g, b, a = pixels:byte(1, 4)
+  assert_equal(r, 255)
+  assert_equal(g, 64)
+
+  pixel_buffer:lock()
+  pixel_buffer:fill_color({0, 0, 255})
+  pixel_buffer:set_pixels(pixel_buffer:get_pixels())
+  pixel_buffer:unlock()
+  pixels = surface:get_pixels()
+  r, g, b, a = pixels:byte(index + 1, index + 4)
+  assert_equal(r, 0)
+  assert_equal(g, 0)
+  assert_equal(b, 255)
+
+  -- Without region, the whole surface is locked.
+  pixel_buffer = surface:lock_pixels()
+  x, y, width, height = pixel_buffer:get_region()
+  assert_equal(width, 16)
+  assert_equal(height, 16)
+  assert(not pcall(pixel_buffer.get_pixel, pixel_buffer, 16, 0))
+  pixel_buffer:unlock()
+end
+
+-- Test for drawable:set_scale() and drawable:set_color_modulation().
+local function test_transform()
+
+  local source = sol.surface.create(4, 2)
+  source:fill_color({255, 255, 255, 255})
+  assert_equal(source:get_rotation(), 0)
+  local scale_x, scale_y = source:get_scale()
+  assert_equal(scale_x, 1)
+  assert_equal(scale_y, 1)
+
+  source:set_scale(2)
+  source:set_transformation_origin(0, 0)
+  source:set_color_modulation({0, 255, 128})
+  scale_x, scale_y = source:get_scale()
+  assert_equal(scale_x, 2)
+  assert_equal(scale_y, 2)
+
+  local surface = sol.surface.create(16, 16)
+  source:draw(surface, 4, 4)
+  local pixels = surface:get_pixels()
+
+  -- Pixel (11, 7) is the last one covered by the scaled source.
+  local index = (7 * 16 + 11) * 4
+  local r, g, b, a = pixels:byte(index + 1, index + 4)
+  assert_equal(r, 0)
+  assert_equal(g, 255)
+  assert_equal(b, 128)
+  assert_equal(a, 255)
+
+  index = (8 * 16 + 12) * 4
+  r, g, b, a = pixels:byte(index + 1, index + 4)
+  assert_equal(a, 0)
+end
+
+-- Test for sol.surface.create() with a callback.
+local function test_create_async(callback)
+
+  assert(sol.surface.create("wrong_file.png", function() end) == nil)
+
+  local surface
+  surface = sol.surface.create("menus/solarus_logo.png", false, function(loaded_surface)
+    assert_equal(loaded_surface, surface)
+    local expected_width, expected_height = sol.surface.create("menus/solarus_logo.png"):get_size()
+    local width, height = loaded_surface:get_size()
+    assert_equal(width, expected_width)
+    assert_equal(height, expected_height)
+    callback()
+  end)
+  assert(surface ~= nil)
+end
+
 test_get_pixels()
 test_set_pixels()
-
-sol.main.exit()
+test_lock_pixels()
+test_transform()
+test_create_async(function()
+  sol.main.exit()
+end)
@@ -0,0 +1,47 @@
+-- Tests for target movements following an entity.
+
+local map = ...
+
+local function create_entity(x, y)
+  return map:create_custom_entity({
+    layer = 0,
+    x = x,
+    y = y,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  local mover = create_entity(40, 40)
+  local target = create_entity(120, 40)
+
+  local movement = sol.movement.create("target")
+  movement:set_target(target)
+  movement:set_speed(200)
+  movement:set_ignore_obstacles(true)
+
+  local num_finished = 0
+  movement:start(mover, function()
+    num_finished = num_finished + 1
+  end)
+
+  sol.timer.start(map, 1000, function()
+    -- The target was reached.
+    assert_equal(num_finished, 1)
+    local x, y = mover:get_position()
+    assert_equal(x, 120)
+    assert_equal(y, 40)
+
+    -- The movement is computed again when the target moves.
+    target:set_position(120, 80)
+    sol.timer.start(map, 1000, function()
+      x, y = mover:get_position()
+      assert_equal(x, 120)
+      assert_equal(y, 80)
+      sol.main.exit()
+    end)
+  end)
+end
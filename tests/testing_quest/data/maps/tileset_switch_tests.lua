@@ -0,0 +1,26 @@
+-- Tests for changing the tileset of a map at runtime.
+
+local map = ...
+
+function map:on_started()
+
+  assert_equal(map:get_tileset(), "castle")
+
+  -- A sibling tileset: same patterns, other images.
+  map:set_tileset("castle_no_sprites_file")
+  assert_equal(map:get_tileset(), "castle_no_sprites_file")
+  assert_equal(dynamic_tile_47:get_pattern_id(), "47")
+  assert_equal(dynamic_tile_47:get_modified_ground(), "wall")
+  assert_equal(dynamic_tile_67:get_modified_ground(), "traversable")
+
+  -- Let the tiles be drawn with the new tileset, then switch back.
+  sol.timer.start(map, 100, function()
+    map:set_tileset("castle")
+    assert_equal(map:get_tileset(), "castle")
+    assert_equal(dynamic_tile_47:get_modified_ground(), "wall")
+
+    sol.timer.start(map, 100, function()
+      sol.main.exit()
+    end)
+  end)
+end
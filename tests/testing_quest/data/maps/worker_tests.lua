@@ -0,0 +1,30 @@
+local map = ...
+
+function map:on_started()
+
+  assert_equal(sol.worker.get_num_running(), 0)
+
+  local ok, message = pcall(sol.worker.run, "scripts/workers/sum", { f = print }, function() end)
+  assert(not ok)
+  assert(message:find("function") ~= nil)
+  assert_equal(sol.worker.get_num_running(), 0)
+
+  local values = {}
+  for i = 1, 100 do
+    values[i] = i
+  end
+
+  sol.worker.run("scripts/workers/sum", { values = values, label = "hundred" }, function(result)
+    assert_equal(result.sum, 5050)
+    assert_equal(result.label, "hundred")
+    assert_equal(result.has_quest_file, true)
+
+    sol.worker.run("scripts/workers/sum", { fail = true }, function(result, error_message)
+      assert_equal(result, nil)
+      assert(error_message:find("Failure requested") ~= nil)
+      assert_equal(sol.worker.get_num_running(), 0)
+      sol.main.exit()
+    end)
+  end)
+  assert_equal(sol.worker.get_num_running(), 1)
+end
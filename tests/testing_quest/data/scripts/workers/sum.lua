@@ -0,0 +1,20 @@
+-- Worker script used by the worker_tests map.
+local input = ...
+
+assert(sol.file ~= nil)
+assert(io == nil and os == nil)
+
+if input.fail then
+  error("Failure requested")
+end
+
+local sum = 0
+for _, value in ipairs(input.values) do
+  sum = sum + value
+end
+
+return {
+  sum = sum,
+  label = input.label,
+  has_quest_file = sol.file.exists("quest.dat"),
+}